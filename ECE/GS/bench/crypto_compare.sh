@@ -0,0 +1,50 @@
+#!/bin/sh
+# crypto_compare.sh
+# -----------------------------------------------------------------------------
+# Runs gs_bench.o once per AES-GCM provider (GS_CRYPTO) and prints the
+# crypto rows side by side as a markdown table, the numbers pl/README.md
+# keeps for AF_ALG, the ARMv8 CE code, the CSU and the PL accelerator:
+#
+#   | provider | encrypt_cmd p50 / p99 ns | pkt/s | batch16 p50 ns | pkt/s |
+#
+# pkt/s is 1e9 / ns_op (batch16: 16 packets per op). A provider that is not
+# built in or does not initialise on this board shows "unavailable".
+#
+#   -n iters   gs_bench iterations (default 20000)
+#   PROVIDERS  names to compare (default: af_alg armv8_ce csu pl_gcm)
+# Build with make bench PL=1 (and CSU on, the default) on the board first.
+# -----------------------------------------------------------------------------
+set -eu
+cd "$(dirname "$0")/.."
+
+iters=20000
+while getopts n: opt; do
+  case $opt in
+    n) iters=$OPTARG ;;
+    *) echo "Usage: $0 [-n iters] [PROVIDERS...]" >&2; exit 2 ;;
+  esac
+done
+shift $((OPTIND - 1))
+[ $# -gt 0 ] || set -- af_alg armv8_ce csu pl_gcm
+
+tmp=$(mktemp)
+trap 'rm -f "$tmp"' EXIT
+
+# Field of the {"bench":"<name>",...} line: num <bench> <key>
+num() {
+  sed -n "s/.*\"bench\":\"$1\",[^}]*\"$2\":\([0-9.]*\).*/\1/p" "$tmp"
+}
+
+echo "| provider | encrypt_cmd p50 / p99 ns | pkt/s | encrypt_batch16 p50 ns | pkt/s |"
+echo "|---|---|---|---|---|"
+for p in "$@"; do
+  if ! GS_CRYPTO=$p ./gs_bench.o -n "$iters" -o "$tmp" 2>/dev/null || ! grep -q "\"provider\":\"$p\"" "$tmp"; then
+    echo "| $p | unavailable | | | |"
+    continue
+  fi
+  one=$(num encrypt_cmd ns_op) b=$(num encrypt_batch16 ns_op)
+  echo "| $p | $(num encrypt_cmd p50_ns) / $(num encrypt_cmd p99_ns) |" \
+       "$(awk "BEGIN { printf \"%.0f\", 1e9 / $one }") |" \
+       "$(num encrypt_batch16 p50_ns) |" \
+       "$(awk "BEGIN { printf \"%.0f\", 16e9 / $b }") |"
+done
@@ -0,0 +1,390 @@
+// gs_bench.c
+// -----------------------------------------------------------------------------
+// Benchmarks for the GS bridge pipeline, stage by stage and end to end:
+//   json_parse_pack   handle_node_json(): parse + pack (scheduler never ready)
+//   scan_parse_pack   handle_node_scan(): the UDS fast path for flat commands
+//   cipher_decode     handle_encrypted_data(): hex decode + GCM open + parse/pack
+//   encrypt_cmd       encrypt_cmd() on one 8-byte word
+//   encrypt_cmd_chacha  the same under the ChaCha20-Poly1305 suite
+//   encrypt_batch16   encrypt_batch() of 16 words: one provider submission
+//                     (PL: one DMA TAILDESC write), ns_op per batch
+//   uart_queue        uart_queue_push() + uart_queue_pop() of one AT line
+//   frame_crc         frame_v2_pack() + frame_v2_feed() of one PAYLOAD_BYTES
+//                     frame: CRC-32C both ways (frame_crc.h)
+//   uds_frame         uds_tx_enqueue/flush -> uds_rx_read over a socketpair
+//   e2e_plain         handle_node_json() -> AT write -> fake ESP-AT peer -> OK
+//   e2e_secure        handle_encrypted_data() -> seal -> AT write -> ... -> OK
+//
+// The e2e runs open a PTY; a thread on the master side plays the ESP32 (">"
+// prompt for AT+BLEGATTCWR, swallows the payload, "OK"), so the bridge's own
+// sync AT path and uart_queue run unmodified.
+//
+// Output: one JSON object per line on stdout, first the run info, then
+//   {"bench":"...","iters":N,"ns_op":..,"p50_ns":..,"p99_ns":..,"max_ns":..}
+// Each sample is one op timed with CLOCK_MONOTONIC (clock_ns in the info line
+// is the cost of the timestamp itself). Chatter from the pipeline's own printf
+// calls goes to /dev/null, as it would under the service.
+//
+// Usage: make bench   or   ./gs_bench.o [-n iters] [-o results.jsonl]
+//        GS_CRYPTO=<provider> picks the AES-GCM provider (default: autoselect)
+// -----------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "json_uds.h"
+#include "cmd_parser.h"
+#include "tx_sched.h"
+#include "uart_queue.h"
+#include "crypto_provider.h"
+#include "hex_codec.h"
+#include "frame_crc.h"
+
+#define BENCH_ITERS_DEFAULT 20000
+#define BENCH_E2E_DIV       10             // e2e runs do iters / BENCH_E2E_DIV round trips
+
+static FILE     *g_out;                    // Results (real stdout, or -o file)
+static uint64_t *g_samples;
+static int       g_iters;
+
+static const char BENCH_CMD[] = "{\"T\":\"C\",\"F\":1,\"B\":0,\"L\":0,\"R\":0,\"S\":50,\"PL\":1,\"ID\":7}";
+
+static inline uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Sorts the samples in place and writes one result line
+static void report(const char *name, int n) {
+  uint64_t sum = 0;
+  for (int i = 0; i < n; i++) sum += g_samples[i];
+  qsort(g_samples, (size_t)n, sizeof(g_samples[0]), cmp_u64);
+
+  fprintf(g_out, "{\"bench\":\"%s\",\"iters\":%d,\"ns_op\":%.1f,\"p50_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu}\n",
+          name, n, (double)sum / n, (unsigned long long)g_samples[n / 2],
+          (unsigned long long)g_samples[(size_t)((n - 1) * 0.99)], (unsigned long long)g_samples[n - 1]);
+  fflush(g_out);
+  fprintf(stderr, "  %-16s %10.1f ns/op   p50 %8llu   p99 %8llu\n", name, (double)sum / n,
+          (unsigned long long)g_samples[n / 2], (unsigned long long)g_samples[(size_t)((n - 1) * 0.99)]);
+}
+
+static void skip(const char *name, const char *why) {
+  fprintf(g_out, "{\"bench\":\"%s\",\"skipped\":\"%s\"}\n", name, why);
+  fflush(g_out);
+  fprintf(stderr, "  %-16s skipped: %s\n", name, why);
+}
+
+// Runs op() warmup + n times, one sample per call; op returns <0 on failure
+typedef int (*bench_op_fn)(void *ctx);
+
+static int run(const char *name, int n, bench_op_fn op, void *ctx) {
+  for (int i = 0; i < n / 10 + 1; i++) {
+    if (op(ctx) < 0) { skip(name, "op failed"); return -1; }
+  }
+  for (int i = 0; i < n; i++) {
+    uint64_t t0 = now_ns();
+    int rc = op(ctx);
+    g_samples[i] = now_ns() - t0;
+    if (rc < 0) { skip(name, "op failed"); return -1; }
+  }
+  report(name, n);
+  return 0;
+}
+
+// ------------------------- Stage benches -------------------------
+
+static int never_ready(void) { return 0; }
+static int always_ready(void) { return 1; }
+
+typedef struct {
+  char buf[256];                           // Parsing is in situ: fresh copy per call
+  const char *src;
+  size_t len;
+} json_ctx_t;
+
+static int op_json(void *ctx) {
+  json_ctx_t *c = ctx;
+  memcpy(c->buf, c->src, c->len + 1);
+  return handle_node_json(-1, -1, c->buf);
+}
+
+static int op_scan(void *ctx) {
+  json_ctx_t *c = ctx;
+  return handle_node_scan(-1, -1, c->src, (uint32_t)c->len);
+}
+
+static int op_cipher(void *ctx) {
+  return handle_encrypted_data(-1, -1, ctx);
+}
+
+static int op_encrypt(void *ctx) {
+  uint8_t ct[TOTAL_SZ];
+  size_t n = 0;
+  return encrypt_cmd(ctx, ct, &n);
+}
+
+#define BENCH_BATCH 16
+
+static int op_encrypt_batch(void *ctx) {
+  robot_bt_packet_t words[BENCH_BATCH];
+  uint8_t ct[BENCH_BATCH][TOTAL_SZ];
+  for (int i = 0; i < BENCH_BATCH; i++) words[i] = *(const robot_bt_packet_t *)ctx;
+  return encrypt_batch(words, BENCH_BATCH, ct) == BENCH_BATCH ? 0 : -1;
+}
+
+static int op_uart_queue(void *ctx) {
+  static const char line[] = "+NOTIFY:0,1,0,16,0123456789ABCDEF\r\n";
+  char out[64];
+  (void)ctx;
+  if (uart_queue_push(&uart_queue, line, sizeof(line) - 1) != 0) return -1;
+  return uart_queue_pop(&uart_queue, out, sizeof(out)) == (int)sizeof(line) - 1 ? 0 : -1;
+}
+
+typedef struct {
+  frame_v2_parser_t p;
+  uint8_t payload[PAYLOAD_BYTES];
+  int     got;
+} frame_ctx_t;
+
+static void frame_got(const uint8_t *payload, size_t len, void *ctx) {
+  (void)payload;
+  ((frame_ctx_t *)ctx)->got += len == PAYLOAD_BYTES;
+}
+
+static int op_frame_crc(void *ctx) {
+  frame_ctx_t *c = ctx;
+  uint8_t frame[FRAME_V2_MAX];
+  size_t n = frame_v2_pack(frame, c->payload, sizeof(c->payload));
+  c->got = 0;
+  frame_v2_feed(&c->p, frame, n, frame_got, c);
+  return c->got == 1 ? 0 : -1;
+}
+
+typedef struct {
+  uds_tx_t tx;
+  uds_rx_t rx;
+  int      rd_fd;
+  int      got;
+} uds_ctx_t;
+
+static int on_frame(void *ctx, char *frame, uint32_t len) {
+  (void)frame; (void)len;
+  ((uds_ctx_t *)ctx)->got++;
+  return 0;
+}
+
+static int op_uds(void *ctx) {
+  static const char js[] = "{\"type\":\"SR\",\"id\":7,\"battery\":87,\"rssi\":-61,\"state\":3}";
+  uds_ctx_t *c = ctx;
+  int want = c->got + 1;
+  if (uds_tx_enqueue(&c->tx, js, sizeof(js) - 1, UDS_TX_CMD, 0) != 0) return -1;
+  if (uds_tx_flush(&c->tx) < 0) return -1;
+  while (c->got < want) {
+    if (uds_rx_read(c->rd_fd, &c->rx, on_frame, c) < 0) return -1;
+  }
+  return 0;
+}
+
+// ------------------------- Fake ESP-AT peer -------------------------
+// Master side of the PTY. Understands just enough of ESP-AT for the bridge's
+// write path: AT+BLEGATTCWR=...,<len> -> ">" then <len> payload bytes -> OK;
+// any other AT line -> OK.
+
+static _Atomic uint32_t g_peer_acked;      // Payloads answered with OK
+
+static void *fake_esp(void *arg) {
+  int fd = *(int *)arg;
+  char line[128];
+  size_t line_len = 0, want = 0;
+  uint8_t buf[1024];
+
+  for (;;) {
+    ssize_t r = read(fd, buf, sizeof(buf));
+    if (r <= 0) return NULL;                               // Slave closed
+    for (ssize_t i = 0; i < r; i++) {
+      if (want) {                                          // Swallowing a write payload
+        if (--want) continue;
+        atomic_fetch_add(&g_peer_acked, 1);
+        if (write(fd, "\r\nOK\r\n", 6) < 0) return NULL;
+        continue;
+      }
+      if (line_len < sizeof(line) - 1) line[line_len++] = (char)buf[i];
+      if (buf[i] != '\n') continue;
+      line[line_len] = '\0';
+      line_len = 0;
+      if (strncmp(line, "AT+BLEGATTCWR=", 14) == 0) {
+        const char *comma = strrchr(line, ',');
+        want = comma ? strtoul(comma + 1, NULL, 10) : 0;
+        if (write(fd, want ? "\r\n>" : "\r\nERROR\r\n", want ? 3 : 9) < 0) return NULL;
+      } else if (strncmp(line, "AT", 2) == 0 && write(fd, "\r\nOK\r\n", 6) < 0) {
+        return NULL;
+      }
+    }
+  }
+}
+
+static int e2e_open(int *master, int *uart_fd, pthread_t *th) {
+  *master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (*master < 0 || grantpt(*master) != 0 || unlockpt(*master) != 0) return -1;
+
+  struct termios tio;                                      // No echo, no CR/LF mangling
+  if (tcgetattr(*master, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(*master, TCSANOW, &tio);
+  }
+
+  *uart_fd = uart_open_config(ptsname(*master), DEFAULT_UART_BAUD);
+  if (*uart_fd < 0) return -1;
+  return pthread_create(th, NULL, fake_esp, master) == 0 ? 0 : -1;
+}
+
+typedef struct {
+  int         uart_fd;
+  int         secure;
+  json_ctx_t  json;
+  const char *hex;
+  uint32_t    acked;                       // Peer writes acknowledged after the last op
+} e2e_ctx_t;
+
+static int op_e2e(void *ctx) {
+  e2e_ctx_t *c = ctx;
+  char drain[UART_SLOT_MAX];
+  int rc = c->secure ? handle_encrypted_data(c->uart_fd, -1, c->hex)
+                     : (memcpy(c->json.buf, c->json.src, c->json.len + 1),
+                        handle_node_json(c->uart_fd, -1, c->json.buf));
+  while (uart_queue_pop(&uart_queue, drain, sizeof(drain)) >= 0) {} // Replies the reader thread would consume
+
+  uint32_t acked = atomic_load(&g_peer_acked);              // The write must have completed
+  if (rc < 0 || acked != c->acked + 1) return -1;
+  c->acked = acked;
+  return 0;
+}
+
+// ------------------------- Main -------------------------
+
+int main(int argc, char **argv) {
+  const char *out_path = NULL;
+  g_iters = BENCH_ITERS_DEFAULT;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:o:")) != -1) {
+    if (opt == 'n') g_iters = atoi(optarg);
+    else if (opt == 'o') out_path = optarg;
+    else { fprintf(stderr, "usage: %s [-n iters] [-o results.jsonl]\n", argv[0]); return 2; }
+  }
+  if (g_iters < 100) g_iters = 100;
+
+  g_out = out_path ? fopen(out_path, "w") : fdopen(dup(STDOUT_FILENO), "w");
+  if (!g_out || !freopen("/dev/null", "w", stdout)) { perror("output"); return 1; }
+  g_samples = malloc(sizeof(g_samples[0]) * (size_t)g_iters);
+  if (!g_samples) return 1;
+
+  const char *crypto = getenv("GS_CRYPTO");
+  int have_crypto = (crypto && crypto[0]) ? gs_crypto_use(crypto) == 0 : gs_crypto_autoselect() == 0;
+
+  uint64_t t0 = now_ns();
+  for (int i = 0; i < 1000; i++) (void)now_ns();
+  fprintf(g_out, "{\"suite\":\"gs_pipeline\",\"iters\":%d,\"e2e_iters\":%d,\"provider\":\"%s\",\"clock_ns\":%.1f}\n",
+          g_iters, g_iters / BENCH_E2E_DIV, have_crypto ? gs_crypto_provider()->name : "none",
+          (double)(now_ns() - t0) / 1000);
+  fprintf(stderr, "=== GS pipeline, %d iters (AES-GCM: %s) ===\n", g_iters,
+          have_crypto ? gs_crypto_provider()->name : "none");
+
+  json_ctx_t jc = { .src = BENCH_CMD, .len = sizeof(BENCH_CMD) - 1 };
+  uart_queue_init(&uart_queue);
+
+  // Stage benches: the scheduler holds (and coalesces) every word, nothing is sent
+  tx_sched_init(-1, never_ready);
+  run("json_parse_pack", g_iters, op_json, &jc);
+  run("scan_parse_pack", g_iters, op_scan, &jc);
+
+  char hex[PAYLOAD_HEX_STR_LEN + 1] = "";
+  robot_bt_packet_t word = {0};
+  word.ctrl.type = CONTROL_CMD;
+  word.ctrl.speed = 50;
+  if (have_crypto) {
+    uint8_t ct[TOTAL_SZ];
+    if (encrypt_json(BENCH_CMD, ct) == 0) hexc_encode(ct, TOTAL_SZ, hex, 1);
+    security_level = 1;
+    if (hex[0]) run("cipher_decode", g_iters, op_cipher, hex);
+    else skip("cipher_decode", "encrypt_json failed");
+    run("encrypt_cmd", g_iters, op_encrypt, &word);
+    run("encrypt_batch16", g_iters / BENCH_BATCH, op_encrypt_batch, &word);
+    gs_crypto_suite(GS_SUITE_CHACHA20_POLY1305);        // Same seal, software-endpoint suite
+    run("encrypt_cmd_chacha", g_iters, op_encrypt, &word);
+    gs_crypto_suite(GS_SUITE_AES_GCM);
+    security_level = 0;
+  } else {
+    skip("cipher_decode", "no AES-GCM provider");
+    skip("encrypt_cmd", "no AES-GCM provider");
+    skip("encrypt_batch16", "no AES-GCM provider");
+    skip("encrypt_cmd_chacha", "no AES-GCM provider");
+  }
+
+  run("uart_queue", g_iters, op_uart_queue, NULL);
+
+  static frame_ctx_t fc;
+  crc32c_init();
+  for (size_t i = 0; i < sizeof(fc.payload); i++) fc.payload[i] = (uint8_t)(i * 37);
+  fprintf(stderr, "  (crc32c: %s)\n", crc32c_impl());
+  run("frame_crc", g_iters, op_frame_crc, &fc);
+
+  int sv[2];
+  static uds_ctx_t uc;
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0) {
+    fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+    fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK);
+    uds_tx_init(&uc.tx, sv[0], NULL);
+    uds_rx_init(&uc.rx);
+    uc.rd_fd = sv[1];
+    run("uds_frame", g_iters, op_uds, &uc);
+    uds_tx_close(&uc.tx);
+    uds_rx_reset(&uc.rx);
+    close(sv[0]);
+    close(sv[1]);
+  } else {
+    skip("uds_frame", "socketpair failed");
+  }
+
+  // End to end through the PTY peer: every word is written as it is submitted
+  int master = -1, uart_fd = -1;
+  pthread_t th;
+  if (e2e_open(&master, &uart_fd, &th) == 0) {
+    BLE_CONNECTED = 1;
+    tx_sched_init(uart_fd, always_ready);
+    e2e_ctx_t ec = { .uart_fd = uart_fd, .secure = 0, .json = jc, .hex = hex };
+    run("e2e_plain", g_iters / BENCH_E2E_DIV, op_e2e, &ec);
+    if (have_crypto && hex[0]) {
+      security_level = 1;
+      ec.secure = 1;
+      run("e2e_secure", g_iters / BENCH_E2E_DIV, op_e2e, &ec);
+      security_level = 0;
+    } else {
+      skip("e2e_secure", "no AES-GCM provider");
+    }
+    close(uart_fd);                                        // Peer thread sees EOF/EIO
+    pthread_join(th, NULL);
+    close(master);
+  } else {
+    skip("e2e_plain", "pty unavailable");
+    skip("e2e_secure", "pty unavailable");
+  }
+
+  gs_crypto_shutdown();
+  free(g_samples);
+  fclose(g_out);
+  return 0;
+}
@@ -0,0 +1,502 @@
+// gs_blast.c
+// -----------------------------------------------------------------------------
+// GATT write load generator for the robot's receive path: connects to one
+// robot through the Linux Bluetooth stack (a raw ATT socket, as the hci
+// transport does; no bridge, no ESP-AT, no bleak) and writes commands to
+// 0xFF01 as Write Commands (without response) at a set rate, or stepping
+// through rates, until the firmware starts losing them (gatts_event_handler
+// -> RX pool -> "BT Queue full, dropping packet").
+//
+// Every frame of a step is encoded into a pool before the step starts, so
+// the timed loop only paces and calls send(). The mix is valid:invalid
+// frames:
+//   valid    Query MOTOR_STATUS words with ids 1..2047; each is a latency
+//            probe, answered by an ACK (or an ACK_MODE range) carrying its id
+//   invalid  in turn an unknown command type, a query the robot does not
+//            support (both answered with id 0, counted as rejected) and an
+//            empty batch header (dropped by the framer, no answer)
+// With -e every frame is a compact seal (compact_seal.h) under the build's
+// key, as a robot with SECURITY_LEVEL set expects; invalid seals carry a
+// broken tag, so they cost the robot a full open before it refuses them.
+//
+// A valid id with no ACK by the end of its step (or when its id comes round
+// again) is lost. A step loses commands when lost / valid exceeds -l; the
+// first rate that does is the drop point, and the best ACK rate of the steps
+// below it is the sustained command rate. Writes the local controller could
+// not take (send() EAGAIN: ACL buffers full) are retried and counted as
+// stalls: a step that stalls was limited by the link, not by the robot.
+//
+// Output: one JSON line per step, then a summary, on stdout:
+//   {"blast":"step","build":..,"rate":..,"secs":..,"sent":..,"valid":..,"invalid":..,
+//    "sealed":..,"stalls":..,"cmd_per_s":..,"acked":..,"rejected":..,"lost":..,
+//    "loss_pct":..,"ack_per_s":..,"lat_us_p50":..,"lat_us_p99":..,"lat_us_max":..,
+//    "robot_tx_drops":..}
+//   {"blast":"summary","build":..,"sustained_cmd_per_s":..,"drop_rate":..}
+//
+// Usage: gs_blast.o -m MAC [-b build] [-r per_s | -S from:to:step] [-t secs] [-M valid:invalid]
+//                   [-e aes|chacha] [-d drain_ms] [-l loss_pct] [-R]
+//   -m  robot address (AA:BB:CC:DD:EE:FF)
+//   -b  firmware build label for the report (default "unknown")
+//   -r  writes per second (default 200, 0 = as fast as the controller takes them)
+//   -S  step the rate from..to by step, one -t run each (stops after the drop point)
+//   -t  seconds per step (default 5)
+//   -M  valid:invalid weights (default 1:0)
+//   -e  seal every frame with this suite (robot in a sealed session)
+//   -d  keep reading ACKs this long after each step (default 500 ms)
+//   -l  loss above this percentage marks the drop point (default 0.5)
+//   -R  the robot's address is random, not public
+// Needs CAP_NET_RAW (or root) and a powered-up hci controller. Don't run it
+// against a robot the bridge is connected to.
+//
+// Build example:
+//   make blast
+// -----------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+#include <endian.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "../includes/cmd_structure.h"
+#include "../includes/cmd_parser/cmd_parser.h"
+#include "../includes/pcap_ingest/pcap_ingest.h"
+#include "../includes/hardware_crypto/crypto_provider.h"
+
+#define BT_AF             31                // AF_BLUETOOTH
+#define BT_PROTO_L2CAP    0
+#define BT_LE_PUBLIC      1
+#define BT_LE_RANDOM      2
+#define BT_ATT_CID        4
+
+#define ATT_MTU_WANT      247
+#define ATT_ERROR_RSP     0x01
+#define ATT_MTU_REQ       0x02
+#define ATT_MTU_RSP       0x03
+#define ATT_READ_TYPE_REQ 0x08
+#define ATT_READ_TYPE_RSP 0x09
+#define ATT_WRITE_RSP     0x13
+#define ATT_CONFIRM       0x1E
+#define GATT_CHAR_DECL    0x2803
+#define ROBOT_TX_UUID     0xFF01
+#define ROBOT_RX_UUID     0xFF02
+
+#define BLAST_CONNECT_MS  10000
+#define BLAST_SETUP_MS    3000
+#define BLAST_IDS         2048              // ack.id space; id 0 is left to rejections
+#define BLAST_FRAME_MAX   SEAL_FRAME_LEN(SEAL_WORD_BODY)
+
+struct bt_sockaddr {                        // struct sockaddr_l2
+  sa_family_t family;
+  uint16_t    psm;
+  uint8_t     bdaddr[6];                    // Least significant byte first
+  uint16_t    cid;
+  uint8_t     bdaddr_type;
+};
+
+typedef struct {
+  uint8_t  len;
+  uint8_t  valid;                           // Carries id (a probe)
+  uint16_t id;
+  uint8_t  data[BLAST_FRAME_MAX];
+} blast_frame_t;
+
+static int      g_sock = -1;
+static uint16_t g_mtu = 23, g_tx_handle, g_rx_handle;
+static int      g_sealed;
+
+// Per step
+static uint64_t g_sent_ns[BLAST_IDS];       // Send time of the outstanding id, 0 = none
+static uint64_t g_acked, g_rejected, g_lost;
+static uint32_t *g_lat_us;
+static size_t   g_nlat, g_lat_cap;
+static int64_t  g_tx_drops = -1;            // Last HR tx_drops seen
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// ------------------------- ATT link -------------------------
+
+static int parse_mac(const char *mac, uint8_t out[6]) {
+  unsigned b[6];
+  if (sscanf(mac, "%2x:%2x:%2x:%2x:%2x:%2x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) return -1;
+  for (int i = 0; i < 6; i++) out[5 - i] = (uint8_t)b[i];
+  return 0;
+}
+
+static int att_connect(const char *mac, int random) {
+  struct bt_sockaddr local = { .family = BT_AF, .cid = htole16(BT_ATT_CID), .bdaddr_type = BT_LE_PUBLIC };
+  struct bt_sockaddr peer  = { .family = BT_AF, .cid = htole16(BT_ATT_CID),
+                               .bdaddr_type = random ? BT_LE_RANDOM : BT_LE_PUBLIC };
+  if (parse_mac(mac, peer.bdaddr) != 0) { fprintf(stderr, "bad address %s\n", mac); return -1; }
+
+  g_sock = socket(BT_AF, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, BT_PROTO_L2CAP);
+  if (g_sock < 0) { perror("Bluetooth socket"); return -1; }
+  if (bind(g_sock, (struct sockaddr *)&local, sizeof(local)) != 0 ||
+      (connect(g_sock, (struct sockaddr *)&peer, sizeof(peer)) != 0 && errno != EINPROGRESS)) {
+    perror(mac);
+    return -1;
+  }
+  struct pollfd pfd = { .fd = g_sock, .events = POLLOUT };
+  int err = 0;
+  socklen_t len = sizeof(err);
+  if (poll(&pfd, 1, BLAST_CONNECT_MS) != 1) { fprintf(stderr, "%s: connect timed out\n", mac); return -1; }
+  if (getsockopt(g_sock, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err) {
+    fprintf(stderr, "%s: connect failed (%s)\n", mac, strerror(err ? err : errno));
+    return -1;
+  }
+  return 0;
+}
+
+static int att_send(const uint8_t *pdu, size_t len) {
+  return send(g_sock, pdu, len, MSG_NOSIGNAL | MSG_DONTWAIT) == (ssize_t)len ? 0 : -1;
+}
+
+// Waits for the response to a setup request; answers the robot's own requests meanwhile
+static int att_wait(uint8_t want, uint8_t *rsp, size_t cap) {
+  uint64_t until = now_ns() + (uint64_t)BLAST_SETUP_MS * 1000000u;
+  for (;;) {
+    uint64_t t = now_ns();
+    struct pollfd pfd = { .fd = g_sock, .events = POLLIN };
+    if (t >= until || poll(&pfd, 1, (int)((until - t) / 1000000u) + 1) != 1) return -1;
+    ssize_t n = recv(g_sock, rsp, cap, MSG_DONTWAIT);
+    if (n <= 0) {
+      if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+      return -1;
+    }
+    if (rsp[0] == want || rsp[0] == ATT_ERROR_RSP) return (int)n;
+    if (rsp[0] == ATT_MTU_REQ) {
+      uint8_t r[3] = { ATT_MTU_RSP, (uint8_t)ATT_MTU_WANT, ATT_MTU_WANT >> 8 };
+      att_send(r, sizeof(r));
+    }
+  }
+}
+
+// MTU exchange, the robot's two characteristics, then notifications on
+static int att_setup(void) {
+  uint8_t rsp[ATT_MTU_WANT];
+  uint8_t mtu_req[3] = { ATT_MTU_REQ, (uint8_t)ATT_MTU_WANT, ATT_MTU_WANT >> 8 };
+  int n;
+  if (att_send(mtu_req, sizeof(mtu_req)) != 0 || (n = att_wait(ATT_MTU_RSP, rsp, sizeof(rsp))) < 0) return -1;
+  if (rsp[0] == ATT_MTU_RSP && n >= 3) {
+    uint16_t theirs = (uint16_t)(rsp[1] | rsp[2] << 8);
+    g_mtu = theirs < ATT_MTU_WANT ? theirs : ATT_MTU_WANT;
+  }
+
+  for (uint16_t start = 1; !(g_tx_handle && g_rx_handle); ) {
+    uint8_t req[7] = { ATT_READ_TYPE_REQ, (uint8_t)start, (uint8_t)(start >> 8), 0xFF, 0xFF,
+                       (uint8_t)GATT_CHAR_DECL, (uint8_t)(GATT_CHAR_DECL >> 8) };
+    if (att_send(req, sizeof(req)) != 0 || (n = att_wait(ATT_READ_TYPE_RSP, rsp, sizeof(rsp))) < 2 ||
+        rsp[0] != ATT_READ_TYPE_RSP || rsp[1] < 7) return -1;
+    uint16_t last = 0;
+    for (int off = 2; off + rsp[1] <= n; off += rsp[1]) {
+      const uint8_t *e = rsp + off;
+      last = (uint16_t)(e[0] | e[1] << 8);
+      if (rsp[1] != 7) continue;                      // 128-bit UUIDs: not ours
+      uint16_t uuid = (uint16_t)(e[5] | e[6] << 8);
+      if (uuid == ROBOT_TX_UUID) g_tx_handle = (uint16_t)(e[3] | e[4] << 8);
+      if (uuid == ROBOT_RX_UUID) g_rx_handle = (uint16_t)(e[3] | e[4] << 8);
+    }
+    if (last == 0xFFFF || last < start) break;
+    start = (uint16_t)(last + 1);
+  }
+  if (!g_tx_handle || !g_rx_handle) { fprintf(stderr, "robot service not found\n"); return -1; }
+
+  uint16_t cccd = (uint16_t)(g_rx_handle + 1);
+  uint8_t req[5] = { ATT_WRITE_REQ, (uint8_t)cccd, (uint8_t)(cccd >> 8), 0x01, 0x00 };
+  if (att_send(req, sizeof(req)) != 0 || att_wait(ATT_WRITE_RSP, rsp, sizeof(rsp)) < 1 || rsp[0] != ATT_WRITE_RSP) {
+    fprintf(stderr, "notifications refused\n");
+    return -1;
+  }
+  fprintf(stderr, "blast: robot up (ATT MTU %u, TX 0x%04x, RX 0x%04x)\n", g_mtu, g_tx_handle, g_rx_handle);
+  return 0;
+}
+
+// ------------------------- Reports -------------------------
+
+static void on_acked(uint16_t id, uint64_t t) {
+  if (id == 0 || !g_sent_ns[id]) return;            // Not ours, or ACKed already
+  if (g_nlat == g_lat_cap) {
+    size_t cap = g_lat_cap ? g_lat_cap * 2 : 4096;
+    uint32_t *p = realloc(g_lat_us, cap * sizeof(*p));
+    if (!p) return;
+    g_lat_us = p;
+    g_lat_cap = cap;
+  }
+  g_lat_us[g_nlat++] = (uint32_t)((t - g_sent_ns[id]) / 1000u);
+  g_sent_ns[id] = 0;
+  g_acked++;
+}
+
+static void on_word(robot_bt_packet_t w, uint64_t t) {
+  uint32_t type = cmd_word_type(w.raw);
+  if (type == HEALTH_CMD) { g_tx_drops = cmd_health_get_tx_drops(w.raw); return; }
+  if (type != ACK_CMD) return;
+  uint32_t result = cmd_ack_get_result_code(w.raw);
+  if (result == RESULT_ACK_RANGE) {
+    uint16_t ids[ACK_RANGE_BITS + 1];
+    int n = ack_range_ids(w.raw, ids);
+    for (int i = 0; i < n; i++) on_acked(ids[i], t);
+  } else if (cmd_ack_get_id(w.raw) == 0) {
+    g_rejected++;
+  } else {
+    on_acked((uint16_t)cmd_ack_get_id(w.raw), t);  // Success or a refusal: the command got through
+  }
+}
+
+static void on_notify(const uint8_t *v, size_t n, uint64_t t) {
+  robot_bt_packet_t words[ROBOT_BATCH_MAX];
+  int k = 0;
+  if (n == CIPHER_FRAME_SZ && v[0] == CIPHER_SOF0 && v[n - 2] == CIPHER_EOF0 && v[n - 1] == CIPHER_EOF1)
+    k = v[1] == CIPHER_SOF1_BATCH ? decrypt_report_batch(v + 2, words, ROBOT_BATCH_MAX)
+      : v[1] == CIPHER_SOF1 && decrypt_cmd(v + 2, &words[0]) == 0 ? 1 : 0;
+  else
+    k = sniff_value_words(v, n, words, ROBOT_BATCH_MAX);
+  for (int i = 0; i < k; i++) on_word(words[i], t);
+}
+
+// Reads every PDU that is waiting
+static void att_drain(void) {
+  uint8_t pdu[ATT_MTU_WANT];
+  ssize_t n;
+  while ((n = recv(g_sock, pdu, sizeof(pdu), MSG_DONTWAIT)) > 0) {
+    uint64_t t = now_ns();
+    if (pdu[0] == ATT_INDICATE) {
+      uint8_t c = ATT_CONFIRM;
+      att_send(&c, 1);
+    }
+    if ((pdu[0] == ATT_NOTIFY || pdu[0] == ATT_INDICATE) && n > 3 && (uint16_t)(pdu[1] | pdu[2] << 8) == g_rx_handle)
+      on_notify(pdu + 3, (size_t)n - 3, t);
+  }
+}
+
+// ------------------------- Frame pool -------------------------
+
+static size_t frame_plain(uint8_t *out, uint64_t word) {
+  robot_bt_packet_t p = { .raw = word };
+  memcpy(out, p.bytes, 8);
+  return 8;
+}
+
+static size_t frame_sealed(uint8_t *out, uint64_t word, int broken) {
+  robot_bt_packet_t p = { .raw = word };
+  size_t len = 0;
+  if (encrypt_cmd_compact(&p, 1, out, &len) != 0) return 0;
+  if (broken) out[len - 3] ^= 0x01;                 // Last tag byte
+  return len;
+}
+
+// The step's frames: valid and invalid interleaved by weight (any stretch of
+// the pool has the mix), ids counting up from *next_id
+static int pool_build(blast_frame_t *pool, size_t n, int wv, int wi, uint16_t *next_id) {
+  static const uint8_t empty_batch[2] = { ROBOT_BATCH_MAGIC, 0 };
+  unsigned bad = 0;
+  for (size_t i = 0; i < n; i++) {
+    blast_frame_t *f = &pool[i];
+    uint64_t total = (uint64_t)(wv + wi);
+    f->valid = i * (uint64_t)wi / total == (i + 1) * (uint64_t)wi / total;
+
+    uint64_t word;
+    if (f->valid) {
+      f->id = (*next_id)++;
+      if (*next_id == BLAST_IDS) *next_id = 1;
+      cmd_query_t q = { .pl = 1, .type = Query_CMD, .instruction = MOTOR_STATUS, .id = f->id };
+      word = cmd_query_pack(&q);
+    } else {
+      f->id = 0;
+      if (!g_sealed && bad % 3 == 2) {
+        memcpy(f->data, empty_batch, sizeof(empty_batch));
+        f->len = sizeof(empty_batch);
+        bad++;
+        continue;
+      }
+      cmd_query_t q = { .pl = 1, .type = bad % 3 == 0 ? 0x1F : Query_CMD, .instruction = 0x0F };
+      word = cmd_query_pack(&q);
+      bad++;
+    }
+    size_t len = g_sealed ? frame_sealed(f->data, word, !f->valid) : frame_plain(f->data, word);
+    if (!len) return -1;
+    f->len = (uint8_t)len;
+  }
+  return 0;
+}
+
+// ------------------------- Steps -------------------------
+
+typedef struct {
+  int      rate;
+  double   secs;
+  uint64_t sent, valid, invalid, stalls;
+} blast_step_t;
+
+// One frame as Write Commands (cut at the MTU; the robot reassembles). A
+// chunk the controller can't take yet is retried, never skipped, so the
+// stream stays in step with the robot's framer.
+static int send_frame(const blast_frame_t *f, blast_step_t *st) {
+  uint8_t pdu[3 + BLAST_FRAME_MAX];
+  size_t chunk = (size_t)g_mtu - 3;
+  int stalled = 0;
+  pdu[0] = ATT_WRITE_CMD;
+  pdu[1] = (uint8_t)g_tx_handle;
+  pdu[2] = (uint8_t)(g_tx_handle >> 8);
+  for (size_t off = 0; off < f->len; ) {
+    size_t k = f->len - off < chunk ? f->len - off : chunk;
+    memcpy(pdu + 3, f->data + off, k);
+    if (att_send(pdu, 3 + k) == 0) { off += k; continue; }
+    if (errno != EAGAIN && errno != ENOBUFS && errno != EINTR) { perror("send"); return -1; }
+    if (!stalled++) st->stalls++;
+    struct pollfd pfd = { .fd = g_sock, .events = POLLOUT | POLLIN };
+    if (poll(&pfd, 1, 1000) < 0 && errno != EINTR) return -1;
+    if (pfd.revents & (POLLHUP | POLLERR)) { fprintf(stderr, "link lost\n"); return -1; }
+    att_drain();
+  }
+  return 0;
+}
+
+// Sleeps until t (ns, CLOCK_MONOTONIC), reading reports meanwhile
+static void wait_until(uint64_t t) {
+  for (uint64_t now; (now = now_ns()) < t; ) {
+    struct timespec ts = { (time_t)((t - now) / 1000000000u), (long)((t - now) % 1000000000u) };
+    struct pollfd pfd = { .fd = g_sock, .events = POLLIN };
+    if (ppoll(&pfd, 1, &ts, NULL) > 0) att_drain();
+  }
+}
+
+static int cmp_u32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static int run_step(blast_step_t *st, int secs, int wv, int wi, int drain_ms, uint16_t *next_id) {
+  // Rate 0: as many frames as a 2M PHY link could ever take in the time
+  size_t n = (size_t)(st->rate ? st->rate : 16000) * (size_t)secs;
+  blast_frame_t *pool = malloc(n * sizeof(*pool));
+  if (!pool || pool_build(pool, n, wv, wi, next_id) != 0) {
+    fprintf(stderr, "frame pool not built\n");
+    free(pool);
+    return -1;
+  }
+  memset(g_sent_ns, 0, sizeof(g_sent_ns));
+  g_acked = g_rejected = g_lost = 0;
+  g_nlat = 0;
+
+  uint64_t t0 = now_ns(), end = t0 + (uint64_t)secs * 1000000000u;
+  for (size_t i = 0; i < n; i++) {
+    if (st->rate) wait_until(t0 + (uint64_t)i * 1000000000u / (uint64_t)st->rate);
+    else if (now_ns() >= end) break;
+    const blast_frame_t *f = &pool[i];
+    uint64_t t = now_ns();
+    if (send_frame(f, st) != 0) { free(pool); return -1; }
+    st->sent++;
+    if (f->valid) {
+      if (g_sent_ns[f->id]) g_lost++;               // Its id came round again unanswered
+      g_sent_ns[f->id] = t;
+      st->valid++;
+    } else {
+      st->invalid++;
+    }
+    if ((i & 15) == 15) att_drain();
+  }
+  st->secs = (double)(now_ns() - t0) / 1e9;
+  wait_until(now_ns() + (uint64_t)drain_ms * 1000000u);
+  for (int id = 1; id < BLAST_IDS; id++) g_lost += g_sent_ns[id] != 0;
+  free(pool);
+  return 0;
+}
+
+static void print_step(const char *build, const blast_step_t *st, int sealed) {
+  uint32_t p50 = 0, p99 = 0, max = 0;
+  if (g_nlat) {
+    qsort(g_lat_us, g_nlat, sizeof(*g_lat_us), cmp_u32);
+    p50 = g_lat_us[g_nlat / 2];
+    p99 = g_lat_us[g_nlat * 99 / 100];
+    max = g_lat_us[g_nlat - 1];
+  }
+  printf("{\"blast\":\"step\",\"build\":\"%s\",\"rate\":%d,\"secs\":%.3f,\"sent\":%llu,\"valid\":%llu,"
+         "\"invalid\":%llu,\"sealed\":%d,\"stalls\":%llu,\"cmd_per_s\":%.1f,\"acked\":%llu,\"rejected\":%llu,"
+         "\"lost\":%llu,\"loss_pct\":%.2f,\"ack_per_s\":%.1f,\"lat_us_p50\":%u,\"lat_us_p99\":%u,"
+         "\"lat_us_max\":%u,\"robot_tx_drops\":%lld}\n",
+         build, st->rate, st->secs, (unsigned long long)st->sent, (unsigned long long)st->valid,
+         (unsigned long long)st->invalid, sealed, (unsigned long long)st->stalls, st->sent / st->secs,
+         (unsigned long long)g_acked, (unsigned long long)g_rejected, (unsigned long long)g_lost,
+         st->valid ? 100.0 * (double)g_lost / (double)st->valid : 0.0, g_acked / st->secs, p50, p99, max,
+         (long long)g_tx_drops);
+  fflush(stdout);
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr, "Usage: %s -m MAC [-b build] [-r per_s | -S from:to:step] [-t secs] [-M valid:invalid]\n"
+                  "          [-e aes|chacha] [-d drain_ms] [-l loss_pct] [-R]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+  const char *mac = NULL, *build = "unknown", *suite = NULL;
+  int rate = 200, from = 0, to = 0, step = 0, secs = 5, wv = 1, wi = 0, drain_ms = 500, random = 0, opt;
+  double loss_limit = 0.5;
+  while ((opt = getopt(argc, argv, "m:b:r:S:t:M:e:d:l:R")) != -1) {
+    switch (opt) {
+      case 'm': mac = optarg; break;
+      case 'b': build = optarg; break;
+      case 'r': rate = atoi(optarg); break;
+      case 'S':
+        if (sscanf(optarg, "%d:%d:%d", &from, &to, &step) != 3 || from < 1 || to < from || step < 1) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 't': secs = atoi(optarg); break;
+      case 'M':
+        if (sscanf(optarg, "%d:%d", &wv, &wi) != 2 || wv < 0 || wi < 0 || wv + wi == 0) { usage(argv[0]); return 1; }
+        break;
+      case 'e': suite = optarg; break;
+      case 'd': drain_ms = atoi(optarg); break;
+      case 'l': loss_limit = atof(optarg); break;
+      case 'R': random = 1; break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  if (!mac || secs < 1 || rate < 0 || (suite && strcmp(suite, "aes") && strcmp(suite, "chacha"))) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (!from) from = to = rate, step = 1;
+
+  if (suite) {
+    const char *crypto = getenv("GS_CRYPTO");
+    if (!(crypto && crypto[0] && gs_crypto_use(crypto) == 0) && gs_crypto_autoselect() != 0) {
+      fprintf(stderr, "no crypto provider\n");
+      return 1;
+    }
+    gs_crypto_suite(strcmp(suite, "chacha") == 0 ? GS_SUITE_CHACHA20_POLY1305 : GS_SUITE_AES_GCM);
+    g_sealed = 1;
+  }
+  if (att_connect(mac, random) != 0 || att_setup() != 0) return 1;
+
+  uint16_t next_id = 1;
+  double sustained = 0;
+  int drop_rate = -1;
+  for (int r = from; r <= to; r += step) {
+    blast_step_t st = { .rate = r };
+    if (run_step(&st, secs, wv, wi, drain_ms, &next_id) != 0) break;
+    print_step(build, &st, g_sealed);
+    double loss = st.valid ? 100.0 * (double)g_lost / (double)st.valid : 0.0;
+    if (loss > loss_limit) { drop_rate = r; break; }
+    if (g_acked / st.secs > sustained) sustained = g_acked / st.secs;
+  }
+  printf("{\"blast\":\"summary\",\"build\":\"%s\",\"sustained_cmd_per_s\":%.1f,\"drop_rate\":", build, sustained);
+  if (drop_rate >= 0) printf("%d}\n", drop_rate);
+  else printf("null}\n");
+
+  free(g_lat_us);
+  close(g_sock);
+  if (g_sealed) gs_crypto_shutdown();
+  return 0;
+}
@@ -0,0 +1,179 @@
+// gs_load.c
+// -----------------------------------------------------------------------------
+// UDS load generator for a running bridge: plays the Node side, sending a
+// fixed command mix (per round four Q report queries, one C drive, one A arm
+// command) as length-prefixed JSON at a set rate, and reads back and counts
+// whatever the bridge sends (acks, reports) without parsing it. Used to train
+// the PGO build and to drive bench/sim_load.sh.
+//
+// Output: one JSON line on stdout when done,
+//   {"load":"gs_load","sent":N,"secs":..,"cmd_per_s":..,"rx_frames":..,"rx_bytes":..}
+//
+// Usage: gs_load.o [-s socket] [-q] [-n cmds] [-r per_s] [-w wait_ms] [-d drain_ms]
+//   -s  bridge socket (default /tmp/gs_bridge.sock)
+//   -q  the socket is the bridge's SOCK_SEQPACKET one (GS_UDS_SEQ): one
+//       message per frame, no length prefix
+//   -n  commands to send (default 1000)
+//   -r  commands per second (default 200, 0 = as fast as the socket takes them)
+//   -w  keep retrying the connect this long (default 5000 ms)
+//   -d  keep reading this long after the last command (default 1000 ms)
+//
+// Build example:
+//   make load
+// -----------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOAD_SOCK_DEFAULT "/tmp/gs_bridge.sock"
+#define LOAD_ID_MAX       2047             // Command IDs wrap like the UI's
+
+static uint64_t g_rx_frames, g_rx_bytes;
+static uint32_t g_rx_need;                 // Bytes left in the current reply frame
+static uint8_t  g_rx_hdr[4];
+static int      g_rx_hdr_got;
+static int      g_seq;                     // -q: SOCK_SEQPACKET, message = frame
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int connect_wait(const char *path, int wait_ms) {
+  struct sockaddr_un sa = { .sun_family = AF_UNIX };
+  snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", path);
+  uint64_t until = now_ns() + (uint64_t)wait_ms * 1000000u;
+  for (;;) {
+    int fd = socket(AF_UNIX, (g_seq ? SOCK_SEQPACKET : SOCK_STREAM) | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0) return fd;
+    close(fd);
+    if (now_ns() >= until) return -1;
+    usleep(50 * 1000);
+  }
+}
+
+// Reads whatever is queued and counts whole frames; never blocks
+static void drain_replies(int fd) {
+  uint8_t buf[16384];
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+    g_rx_bytes += (uint64_t)n;
+    if (g_seq) {                           // The message is the frame
+      g_rx_frames++;
+      continue;
+    }
+    for (ssize_t i = 0; i < n;) {
+      if (g_rx_need) {
+        uint32_t take = (uint32_t)(n - i) < g_rx_need ? (uint32_t)(n - i) : g_rx_need;
+        g_rx_need -= take;
+        i += take;
+        if (!g_rx_need) g_rx_frames++;
+        continue;
+      }
+      g_rx_hdr[g_rx_hdr_got++] = buf[i++];
+      if (g_rx_hdr_got == 4) {
+        g_rx_hdr_got = 0;
+        g_rx_need = (uint32_t)g_rx_hdr[0] << 24 | (uint32_t)g_rx_hdr[1] << 16 |
+                    (uint32_t)g_rx_hdr[2] << 8 | g_rx_hdr[3];
+        if (!g_rx_need) g_rx_frames++;
+      }
+    }
+  }
+}
+
+static int send_frame(int fd, const char *json, int len) {
+  uint8_t frame[4 + 256];
+  frame[0] = 0; frame[1] = 0; frame[2] = (uint8_t)(len >> 8); frame[3] = (uint8_t)len;
+  memcpy(frame + 4, json, (size_t)len);
+  size_t off = g_seq ? 4 : 0, total = 4 + (size_t)len; // Seqpacket: no prefix, sent whole
+  while (off < total) {
+    ssize_t w = send(fd, frame + off, total - off, MSG_NOSIGNAL);
+    if (w < 0 && errno == EINTR) continue;
+    if (w < 0 && errno == EAGAIN) { drain_replies(fd); continue; }
+    if (w <= 0) return -1;
+    off += (size_t)w;
+  }
+  return 0;
+}
+
+// Command i of the mix: four Q, then C, then A
+static int format_cmd(char *out, size_t cap, uint64_t i) {
+  unsigned id = (unsigned)(i % LOAD_ID_MAX) + 1;
+  switch (i % 6) {
+    case 4:
+      return snprintf(out, cap, "{\"T\":\"C\",\"F\":1,\"B\":0,\"L\":0,\"R\":0,\"S\":50,\"PL\":1,\"ID\":%u}", id);
+    case 5:
+      return snprintf(out, cap, "{\"T\":\"A\",\"U\":1,\"D\":0,\"L\":0,\"R\":0,\"In\":0,\"O\":0,\"S\":40,"
+                                "\"Re\":0,\"PL\":1,\"ID\":%u}", id);
+    default:
+      return snprintf(out, cap, "{\"T\":\"Q\",\"RI\":5,\"R\":0,\"PL\":1,\"ID\":%u}", id);
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *path = LOAD_SOCK_DEFAULT;
+  uint64_t cmds = 1000;
+  int rate = 200, wait_ms = 5000, drain_ms = 1000, opt;
+  while ((opt = getopt(argc, argv, "s:qn:r:w:d:")) != -1) {
+    switch (opt) {
+      case 's': path = optarg; break;
+      case 'q': g_seq = 1; break;
+      case 'n': cmds = strtoull(optarg, NULL, 10); break;
+      case 'r': rate = atoi(optarg); break;
+      case 'w': wait_ms = atoi(optarg); break;
+      case 'd': drain_ms = atoi(optarg); break;
+      default:
+        fprintf(stderr, "Usage: %s [-s socket] [-q] [-n cmds] [-r per_s] [-w wait_ms] [-d drain_ms]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  int fd = connect_wait(path, wait_ms);
+  if (fd < 0) { fprintf(stderr, "%s: %s\n", path, strerror(errno)); return 1; }
+
+  uint64_t t0 = now_ns(), gap = rate > 0 ? 1000000000u / (uint64_t)rate : 0;
+  uint64_t sent = 0;
+  char js[256];
+  for (; sent < cmds; sent++) {
+    if (gap) {                                             // Paced: sleep until this one is due
+      uint64_t due = t0 + sent * gap, now = now_ns();
+      if (due > now) {
+        struct pollfd p = { .fd = fd, .events = POLLIN };
+        poll(&p, 1, (int)((due - now) / 1000000u));
+        drain_replies(fd);
+        if (now_ns() < due) {
+          struct timespec ts = { 0, (long)(due - now_ns()) };
+          if (ts.tv_nsec > 0) nanosleep(&ts, NULL);
+        }
+      }
+    }
+    int len = format_cmd(js, sizeof(js), sent);
+    if (send_frame(fd, js, len) != 0) { fprintf(stderr, "send: %s\n", strerror(errno)); break; }
+    drain_replies(fd);
+  }
+  double secs = (double)(now_ns() - t0) / 1e9;
+
+  uint64_t until = now_ns() + (uint64_t)drain_ms * 1000000u;
+  for (uint64_t now; (now = now_ns()) < until;) {
+    struct pollfd p = { .fd = fd, .events = POLLIN };
+    if (poll(&p, 1, (int)((until - now) / 1000000u) + 1) > 0) drain_replies(fd);
+    if (p.revents & (POLLHUP | POLLERR)) break;
+  }
+  close(fd);
+
+  printf("{\"load\":\"gs_load\",\"sent\":%llu,\"secs\":%.3f,\"cmd_per_s\":%.0f,\"rx_frames\":%llu,\"rx_bytes\":%llu}\n",
+         (unsigned long long)sent, secs, secs > 0 ? (double)sent / secs : 0.0,
+         (unsigned long long)g_rx_frames, (unsigned long long)g_rx_bytes);
+  return sent == cmds ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#!/bin/sh
+# sim_load.sh
+# -----------------------------------------------------------------------------
+# Runs a bridge binary against the ESP-AT simulator (esp_sim.o on a PTY) and
+# drives it with gs_load.o from the Node side, then stops it with SIGTERM so
+# it shuts down cleanly. make pgo uses it to train the instrumented build,
+# make perf to measure one.
+#
+#   -p        count events in the bridge over the load window and print them
+#             per 1000 commands: IPC, cache misses, context switches. Uses
+#             perf stat; without perf only the context switches (from /proc)
+#   -n cmds   commands to send (default 5000)
+#   -r per_s  command rate (default 500, 0 = as fast as the bridge takes them)
+#   BRIDGE    binary to run (default ./gs_bridge)
+#
+# Output: gs_load's JSON line, and with -p one more:
+#   {"perf":"sim_load","cmds":N,"ipc":..,"insn_per_cmd":..,
+#    "cache_misses_per_1k":..,"ctx_switches_per_1k":..}
+# The bridge listens on its default socket, so no other bridge may be running.
+# -----------------------------------------------------------------------------
+set -eu
+cd "$(dirname "$0")/.."
+
+perf=0 cmds=5000 rate=500
+while getopts pn:r: opt; do
+  case $opt in
+    p) perf=1 ;;
+    n) cmds=$OPTARG ;;
+    r) rate=$OPTARG ;;
+    *) echo "Usage: $0 [-p] [-n cmds] [-r per_s] [BRIDGE]" >&2; exit 2 ;;
+  esac
+done
+shift $((OPTIND - 1))
+bridge=${1:-./gs_bridge}
+
+tmp=$(mktemp -d)
+sim_pid= bridge_pid= perf_pid=
+cleanup() {
+  for p in $perf_pid $bridge_pid $sim_pid; do kill "$p" 2>/dev/null || true; done
+  rm -rf "$tmp"
+}
+trap cleanup EXIT
+
+# All threads' context switches, voluntary and not
+ctx_switches() {
+  cat /proc/"$1"/task/*/status 2>/dev/null | awk '/ctxt_switches/ { n += $2 } END { print n + 0 }'
+}
+
+./esp_sim.o -L "$tmp/uart" -H 100 >"$tmp/sim.log" 2>&1 &
+sim_pid=$!
+for _ in $(seq 50); do [ -e "$tmp/uart" ] && break; sleep 0.1; done
+
+UART_DEV="$tmp/uart" GS_RECORD=0 GS_GATT_CACHE=off "$bridge" >"$tmp/bridge.log" 2>&1 &
+bridge_pid=$!
+for _ in $(seq 150); do grep -q "Bridge up" "$tmp/bridge.log" && break; sleep 0.1; done
+if ! grep -q "Bridge up" "$tmp/bridge.log"; then
+  echo "bridge did not come up:" >&2
+  tail -5 "$tmp/bridge.log" >&2
+  exit 1
+fi
+sleep 1                                                  # Robot link and notifications on
+
+have_perf=0
+if [ $perf = 1 ]; then
+  if command -v perf >/dev/null 2>&1; then
+    have_perf=1
+    perf stat -x, -e instructions,cycles,cache-misses,context-switches -p "$bridge_pid" \
+      -o "$tmp/perf.csv" &
+    perf_pid=$!
+    sleep 0.2
+  else
+    echo "perf not found: context switches only" >&2
+  fi
+  cs0=$(ctx_switches "$bridge_pid")
+fi
+
+./gs_load.o -n "$cmds" -r "$rate"
+
+if [ $perf = 1 ]; then
+  cs1=$(ctx_switches "$bridge_pid")
+  if [ $have_perf = 1 ]; then
+    kill -INT "$perf_pid"
+    wait "$perf_pid" || true
+    perf_pid=
+  else
+    : >"$tmp/perf.csv"
+  fi
+  awk -F, -v cmds="$cmds" -v cs=$((cs1 - cs0)) '
+    /^#/ || NF < 3 { next }
+    { v[$3] = $1 }
+    function num(x) { return x ~ /^[0-9.]+$/ ? x : "" }
+    END {
+      insn = num(v["instructions"]); cyc = num(v["cycles"]); miss = num(v["cache-misses"])
+      sw = num(v["context-switches"]); if (sw == "") sw = cs
+      printf "{\"perf\":\"sim_load\",\"cmds\":%d", cmds
+      printf ",\"ipc\":%s", (insn != "" && cyc > 0) ? sprintf("%.3f", insn / cyc) : "null"
+      printf ",\"insn_per_cmd\":%s", insn != "" ? sprintf("%.0f", insn / cmds) : "null"
+      printf ",\"cache_misses_per_1k\":%s", miss != "" ? sprintf("%.1f", miss * 1000 / cmds) : "null"
+      printf ",\"ctx_switches_per_1k\":%.1f}\n", sw * 1000 / cmds
+    }' "$tmp/perf.csv"
+fi
+
+kill -TERM "$bridge_pid"
+wait "$bridge_pid" || true                               # Instrumented builds write profiles here
+bridge_pid=
@@ -49,6 +49,25 @@
 #include <locale.h>
 #endif
 
+/* 16 byte kernels for whitespace skipping and string scanning; build with -DCJSON_SIMD=0 for the scalar code */
+#ifndef CJSON_SIMD
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON))
+#define CJSON_SIMD 1
+#else
+#define CJSON_SIMD 0
+#endif
+#endif
+
+#if CJSON_SIMD
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#else
+#error "CJSON_SIMD needs SSE2 or NEON"
+#endif
+#endif
+
 #if defined(_MSC_VER)
 #pragma warning (pop)
 #endif
@@ -116,6 +135,87 @@ CJSON_PUBLIC(double) cJSON_GetNumberValue(const cJSON * const item)
     return item->valuedouble;
 }
 
+CJSON_PUBLIC(cJSON_bool) cJSON_SetNumberDecimals(cJSON * const item, int decimals)
+{
+    if (!cJSON_IsNumber(item) || (decimals < -1) || (decimals > 14))
+    {
+        return false;
+    }
+
+    item->type = (item->type & ~cJSON_DecimalsMask) | ((decimals + 1) << cJSON_DecimalsShift);
+    return true;
+}
+
+CJSON_PUBLIC(int) cJSON_GetNumberDecimals(const cJSON * const item)
+{
+    if (!cJSON_IsNumber(item))
+    {
+        return -1;
+    }
+
+    return ((item->type & cJSON_DecimalsMask) >> cJSON_DecimalsShift) - 1;
+}
+
+/* whole doubles up to 2^53 are exact integers */
+static cJSON_bool double_is_exact_integer(double number)
+{
+    return (number >= -9007199254740992.0) && (number <= 9007199254740992.0) && ((double)(cJSON_int64)number == number);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_GetInt64Value(const cJSON * const item, cJSON_int64 * const value)
+{
+    if (!cJSON_IsNumber(item) || (value == NULL))
+    {
+        return false;
+    }
+
+#ifdef CJSON_INT64
+    if (item->type & cJSON_NumberIsInt64)
+    {
+        if (item->type & cJSON_NumberIsUint64)
+        {
+            return false; /* above INT64_MAX */
+        }
+        *value = item->valueint64;
+        return true;
+    }
+#endif
+    if (!double_is_exact_integer(item->valuedouble))
+    {
+        return false;
+    }
+
+    *value = (cJSON_int64)item->valuedouble;
+    return true;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_GetUint64Value(const cJSON * const item, cJSON_uint64 * const value)
+{
+    if (!cJSON_IsNumber(item) || (value == NULL))
+    {
+        return false;
+    }
+
+#ifdef CJSON_INT64
+    if (item->type & cJSON_NumberIsInt64)
+    {
+        if (!(item->type & cJSON_NumberIsUint64) && (item->valueint64 < 0))
+        {
+            return false;
+        }
+        *value = (cJSON_uint64)item->valueint64;
+        return true;
+    }
+#endif
+    if ((item->valuedouble < 0) || !double_is_exact_integer(item->valuedouble))
+    {
+        return false;
+    }
+
+    *value = (cJSON_uint64)item->valuedouble;
+    return true;
+}
+
 /* This is a safeguard to prevent copy-pasters from using incompatible C and header files */
 #if (CJSON_VERSION_MAJOR != 1) || (CJSON_VERSION_MINOR != 7) || (CJSON_VERSION_PATCH != 19)
     #error cJSON.h and cJSON.c have different versions. Make sure that both have the same.
@@ -158,6 +258,7 @@ typedef struct internal_hooks
     void *(CJSON_CDECL *allocate)(size_t size);
     void (CJSON_CDECL *deallocate)(void *pointer);
     void *(CJSON_CDECL *reallocate)(void *pointer, size_t size);
+    cJSON_Arena *arena; /* when set, parse allocations come from here instead */
 } internal_hooks;
 
 #if defined(_MSC_VER)
@@ -183,7 +284,98 @@ static void * CJSON_CDECL internal_realloc(void *pointer, size_t size)
 /* strlen of character literals resolved at compile time */
 #define static_strlen(string_literal) (sizeof(string_literal) - sizeof(""))
 
-static internal_hooks global_hooks = { internal_malloc, internal_free, internal_realloc };
+static internal_hooks global_hooks = { internal_malloc, internal_free, internal_realloc, NULL };
+
+/* open addressing table from member names to members, in member order so the first of several equal names wins */
+struct cJSON_Index
+{
+    /* the list the table was built for; another head or tail means it is stale */
+    const cJSON *first;
+    const cJSON *last;
+    size_t mask;
+    cJSON **slots;
+};
+
+#if CJSON_INDEX_THRESHOLD > 0
+/* marks objects that must never be indexed (their memory belongs to an arena) */
+static struct cJSON_Index never_indexed = { NULL, NULL, 0, NULL };
+#endif
+
+/* CJSON_COMPACT: valuestring, valuedouble and index share storage, only the type says which one is live */
+#ifdef CJSON_COMPACT
+#define holds_valuestring(item) (((item)->type & (cJSON_String | cJSON_Raw)) != 0)
+#define holds_valuedouble(item) (((item)->type & cJSON_Number) != 0)
+#if CJSON_INDEX_THRESHOLD > 0
+#define holds_index(item) (((item)->type & cJSON_Object) != 0)
+#endif
+#else
+#define holds_valuestring(item) true
+#define holds_valuedouble(item) true
+#if CJSON_INDEX_THRESHOLD > 0
+#define holds_index(item) true
+#endif
+#endif
+
+static void drop_index(cJSON * const object)
+{
+#if CJSON_INDEX_THRESHOLD > 0
+    if (holds_index(object) && (object->index != NULL) && (object->index != &never_indexed))
+    {
+        global_hooks.deallocate(object->index);
+        object->index = NULL;
+    }
+#else
+    (void)object;
+#endif
+}
+
+/* every arena allocation is aligned for the strictest member of cJSON */
+#define arena_alignment ((sizeof(double) > sizeof(void*)) ? sizeof(double) : sizeof(void*))
+
+static void *arena_allocate(cJSON_Arena * const arena, size_t size)
+{
+    size_t start = (arena->used + (arena_alignment - 1)) & ~(arena_alignment - 1);
+
+    if ((start > arena->size) || (size > (arena->size - start)))
+    {
+        return NULL;
+    }
+
+    arena->last = start;
+    arena->used = start + size;
+
+    return arena->buffer + start;
+}
+
+/* only the newest allocation can be given back (temporary number buffers, failed strings) */
+static void arena_deallocate(cJSON_Arena * const arena, void *pointer)
+{
+    if ((unsigned char*)pointer == (arena->buffer + arena->last))
+    {
+        arena->used = arena->last;
+    }
+}
+
+static void *hooks_allocate(const internal_hooks * const hooks, size_t size)
+{
+    if (hooks->arena != NULL)
+    {
+        return arena_allocate(hooks->arena, size);
+    }
+
+    return hooks->allocate(size);
+}
+
+static void hooks_deallocate(const internal_hooks * const hooks, void *pointer)
+{
+    if (hooks->arena != NULL)
+    {
+        arena_deallocate(hooks->arena, pointer);
+        return;
+    }
+
+    hooks->deallocate(pointer);
+}
 
 static unsigned char* cJSON_strdup(const unsigned char* string, const internal_hooks * const hooks)
 {
@@ -196,7 +388,7 @@ static unsigned char* cJSON_strdup(const unsigned char* string, const internal_h
     }
 
     length = strlen((const char*)string) + sizeof("");
-    copy = (unsigned char*)hooks->allocate(length);
+    copy = (unsigned char*)hooks_allocate(hooks, length);
     if (copy == NULL)
     {
         return NULL;
@@ -240,7 +432,7 @@ CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks)
 /* Internal constructor. */
 static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
 {
-    cJSON* node = (cJSON*)hooks->allocate(sizeof(cJSON));
+    cJSON* node = (cJSON*)hooks_allocate(hooks, sizeof(cJSON));
     if (node)
     {
         memset(node, '\0', sizeof(cJSON));
@@ -249,32 +441,121 @@ static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
     return node;
 }
 
-/* Delete a cJSON structure. */
-CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
+/* Delete a cJSON structure whose memory came from hooks. */
+static void delete_tree(cJSON *item, const internal_hooks * const hooks)
 {
     cJSON *next = NULL;
     while (item != NULL)
     {
         next = item->next;
+        drop_index(item);
         if (!(item->type & cJSON_IsReference) && (item->child != NULL))
         {
-            cJSON_Delete(item->child);
+            delete_tree(item->child, hooks);
         }
-        if (!(item->type & cJSON_IsReference) && (item->valuestring != NULL))
+        if (!(item->type & cJSON_IsReference) && holds_valuestring(item) && (item->valuestring != NULL))
         {
-            global_hooks.deallocate(item->valuestring);
+            hooks->deallocate(item->valuestring);
             item->valuestring = NULL;
         }
         if (!(item->type & cJSON_StringIsConst) && (item->string != NULL))
         {
-            global_hooks.deallocate(item->string);
+            hooks->deallocate(item->string);
             item->string = NULL;
         }
-        global_hooks.deallocate(item);
+        hooks->deallocate(item);
         item = next;
     }
 }
 
+/* Delete a cJSON structure. */
+CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
+{
+    delete_tree(item, &global_hooks);
+}
+
+/* A context's allocator; like cJSON_InitHooks, realloc only goes with both malloc and free */
+static internal_hooks context_hooks(const cJSON_Context * const ctx)
+{
+    internal_hooks hooks = { internal_malloc, internal_free, internal_realloc, NULL };
+
+    if ((ctx->hooks.malloc_fn != NULL) && (ctx->hooks.malloc_fn != malloc))
+    {
+        hooks.allocate = ctx->hooks.malloc_fn;
+        hooks.reallocate = NULL;
+    }
+    if ((ctx->hooks.free_fn != NULL) && (ctx->hooks.free_fn != free))
+    {
+        hooks.deallocate = ctx->hooks.free_fn;
+        hooks.reallocate = NULL;
+    }
+    hooks.arena = ctx->arena;
+
+    return hooks;
+}
+
+CJSON_PUBLIC(void) cJSON_InitContext(cJSON_Context *ctx, const cJSON_Hooks *hooks, cJSON_Arena *arena)
+{
+    if (ctx == NULL)
+    {
+        return;
+    }
+
+    memset(ctx, 0, sizeof(*ctx));
+    if (hooks != NULL)
+    {
+        ctx->hooks = *hooks;
+    }
+    ctx->arena = arena;
+}
+
+CJSON_PUBLIC(void) cJSON_DeleteCtx(const cJSON_Context *ctx, cJSON *item)
+{
+    internal_hooks hooks;
+
+    if ((ctx == NULL) || (ctx->arena != NULL))
+    {
+        return; /* an arena tree goes back with the arena */
+    }
+
+    hooks = context_hooks(ctx);
+    delete_tree(item, &hooks);
+}
+
+CJSON_PUBLIC(void) cJSON_InitArena(cJSON_Arena *arena, void *buffer, size_t size)
+{
+    size_t skew = 0;
+
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    /* start on an aligned address so offsets only need aligning relative to it */
+    skew = (arena_alignment - ((size_t)buffer & (arena_alignment - 1))) & (arena_alignment - 1);
+    if ((buffer == NULL) || (size < skew))
+    {
+        arena->buffer = NULL;
+        arena->size = 0;
+    }
+    else
+    {
+        arena->buffer = (unsigned char*)buffer + skew;
+        arena->size = size - skew;
+    }
+    arena->used = 0;
+    arena->last = 0;
+}
+
+CJSON_PUBLIC(void) cJSON_ResetArena(cJSON_Arena *arena)
+{
+    if (arena != NULL)
+    {
+        arena->used = 0;
+        arena->last = 0;
+    }
+}
+
 /* get the decimal point character of the current locale */
 static unsigned char get_decimal_point(void)
 {
@@ -293,8 +574,37 @@ typedef struct
     size_t offset;
     size_t depth; /* How deeply nested (in arrays/objects) is the input at the current offset. */
     internal_hooks hooks;
+    unsigned char *insitu; /* writable view of content when strings are parsed in place, else NULL */
 } parse_buffer;
 
+/* Delete a partly parsed tree; an arena tree goes back with the arena. */
+static void delete_parsed(cJSON *item, const parse_buffer * const buffer)
+{
+    cJSON *next = NULL;
+
+    if (buffer->hooks.arena != NULL)
+    {
+        return;
+    }
+    if (buffer->insitu == NULL)
+    {
+        delete_tree(item, &buffer->hooks);
+        return;
+    }
+
+    /* in situ every string points into the input, only the nodes are ours */
+    while (item != NULL)
+    {
+        next = item->next;
+        if (item->child != NULL)
+        {
+            delete_parsed(item->child, buffer);
+        }
+        hooks_deallocate(&buffer->hooks, item);
+        item = next;
+    }
+}
+
 /* check if the given size is left to read in a given parse buffer (starting with 1) */
 #define can_read(buffer, size) ((buffer != NULL) && (((buffer)->offset + size) <= (buffer)->length))
 /* check if the buffer can be accessed at the given index (starting with 0) */
@@ -303,13 +613,107 @@ typedef struct
 /* get a pointer to the buffer at the position */
 #define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
 
+/* 64 bit arithmetic for integers and the number printer (cJSON_uint64 comes from cJSON.h) */
+typedef cJSON_uint64 cjson_uint64;
+#if defined(__GNUC__)
+#define CJSON_U64(constant) (__extension__ constant##ULL)
+#else
+#define CJSON_U64(constant) constant##ULL
+#endif
+#define CJSON_INT64_MIN_MAGNITUDE CJSON_U64(0x8000000000000000)
+
+/* Make item the exact integer -magnitude or +magnitude (CJSON_INT64, else the nearest double), with valuedouble
+ * and the saturated valueint alongside. Returns false (item untouched) below INT64_MIN; all of uint64 fits. */
+static cJSON_bool set_number_integer(cJSON * const item, cjson_uint64 magnitude, cJSON_bool negative)
+{
+    int type = cJSON_Number;
+
+    if (negative)
+    {
+        if (magnitude > CJSON_INT64_MIN_MAGNITUDE)
+        {
+            return false;
+        }
+#ifdef CJSON_INT64
+        /* -(magnitude - 1) - 1 stays in range for INT64_MIN */
+        item->valueint64 = (magnitude == 0) ? 0 : -(cJSON_int64)(magnitude - 1) - 1;
+        type |= cJSON_NumberIsInt64;
+#endif
+        item->valueint = (magnitude > (cjson_uint64)INT_MAX) ? INT_MIN : -(int)magnitude;
+        item->valuedouble = -(double)magnitude;
+    }
+    else
+    {
+#ifdef CJSON_INT64
+        if (magnitude >= CJSON_INT64_MIN_MAGNITUDE)
+        {
+            /* above INT64_MAX: the same bits, so (cJSON_uint64)valueint64 gives magnitude back */
+            item->valueint64 = -(cJSON_int64)(~magnitude) - 1;
+            type |= cJSON_NumberIsUint64;
+        }
+        else
+        {
+            item->valueint64 = (cJSON_int64)magnitude;
+        }
+        type |= cJSON_NumberIsInt64;
+#endif
+        item->valueint = (magnitude >= (cjson_uint64)INT_MAX) ? INT_MAX : (int)magnitude;
+        item->valuedouble = (double)magnitude;
+    }
+
+    item->type = type;
+    return true;
+}
+
 /* Parse the input text to generate a number, and populate the result into item. */
+/* Parse a plain integer literal (optional '-', digits only) into an exact 64 bit integer, without
+ * a temporary copy, strtod or a locale lookup. Returns false and consumes nothing when the number
+ * has a fraction or an exponent or does not fit 64 bits. */
+static cJSON_bool parse_integer_fast(cJSON * const item, parse_buffer * const input_buffer)
+{
+    const unsigned char *input = buffer_at_offset(input_buffer);
+    size_t available = input_buffer->length - input_buffer->offset;
+    size_t i = 0;
+    size_t digits = 0;
+    cJSON_bool negative = false;
+    cjson_uint64 magnitude = 0;
+    const cjson_uint64 limit = CJSON_U64(0xFFFFFFFFFFFFFFFF) / 10;
+
+    if ((available > 0) && (input[0] == '-'))
+    {
+        negative = true;
+        i++;
+    }
+    for (; (i < available) && (input[i] >= '0') && (input[i] <= '9'); i++)
+    {
+        const unsigned int digit = (unsigned int)(input[i] - '0');
+        if ((magnitude > limit) || ((magnitude == limit) && (digit > 5)))
+        {
+            return false;
+        }
+        magnitude = (magnitude * 10) + digit;
+        digits++;
+    }
+    if ((digits == 0) || ((i < available) && ((input[i] == '.') || (input[i] == 'e') || (input[i] == 'E'))))
+    {
+        return false;
+    }
+
+    if (!set_number_integer(item, magnitude, negative))
+    {
+        return false;
+    }
+
+    input_buffer->offset += i;
+    return true;
+}
+
 static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_buffer)
 {
     double number = 0;
     unsigned char *after_end = NULL;
     unsigned char *number_c_string;
-    unsigned char decimal_point = get_decimal_point();
+    unsigned char decimal_point = '.';
     size_t i = 0;
     size_t number_string_length = 0;
     cJSON_bool has_decimal_point = false;
@@ -319,6 +723,11 @@ static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_bu
         return false;
     }
 
+    if (parse_integer_fast(item, input_buffer))
+    {
+        return true;
+    }
+
     /* copy the number into a temporary buffer and replace '.' with the decimal point
      * of the current locale (for strtod)
      * This also takes care of '\0' not necessarily being available for marking the end of the input */
@@ -354,7 +763,7 @@ static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_bu
     }
 loop_end:
     /* malloc for temporary buffer, add 1 for '\0' */
-    number_c_string = (unsigned char *) input_buffer->hooks.allocate(number_string_length + 1);
+    number_c_string = (unsigned char *) hooks_allocate(&input_buffer->hooks, number_string_length + 1);
     if (number_c_string == NULL)
     {
         return false; /* allocation failure */
@@ -365,6 +774,8 @@ loop_end:
 
     if (has_decimal_point)
     {
+        /* only fractions need the locale */
+        decimal_point = get_decimal_point();
         for (i = 0; i < number_string_length; i++)
         {
             if (number_c_string[i] == '.')
@@ -379,7 +790,7 @@ loop_end:
     if (number_c_string == after_end)
     {
         /* free the temporary buffer */
-        input_buffer->hooks.deallocate(number_c_string);
+        hooks_deallocate(&input_buffer->hooks, number_c_string);
         return false; /* parse_error */
     }
 
@@ -403,13 +814,15 @@ loop_end:
 
     input_buffer->offset += (size_t)(after_end - number_c_string);
     /* free the temporary buffer */
-    input_buffer->hooks.deallocate(number_c_string);
+    hooks_deallocate(&input_buffer->hooks, number_c_string);
     return true;
 }
 
 /* don't ask me, but the original cJSON_SetNumberValue returns an integer or double */
 CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number)
 {
+    object->type &= ~(cJSON_NumberIsInt64 | cJSON_NumberIsUint64);
+
     if (number >= INT_MAX)
     {
         object->valueint = INT_MAX;
@@ -423,6 +836,10 @@ CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number)
         object->valueint = (int)number;
     }
 
+    if (!holds_valuedouble(object))
+    {
+        return number; /* not a number: the slot belongs to something else */
+    }
     return object->valuedouble = number;
 }
 
@@ -479,6 +896,9 @@ typedef struct
     cJSON_bool noalloc;
     cJSON_bool format; /* is this print a formatted print */
     internal_hooks hooks;
+    cJSON_WriteFn flush; /* streaming: receives the buffered text whenever the buffer runs full */
+    void *context;
+    size_t flushed; /* bytes already handed to flush */
 } printbuffer;
 
 /* realloc printbuffer if necessary to have at least "needed" bytes more */
@@ -510,6 +930,22 @@ static unsigned char* ensure(printbuffer * const p, size_t needed)
         return p->buffer + p->offset;
     }
 
+    /* streaming: pass on what is there and start over at the beginning of the buffer */
+    if ((p->flush != NULL) && (p->offset > 0))
+    {
+        if (!p->flush(p->context, (const char*)p->buffer, p->offset))
+        {
+            return NULL;
+        }
+        p->flushed += p->offset;
+        needed -= p->offset;
+        p->offset = 0;
+        if (needed <= p->length)
+        {
+            return p->buffer;
+        }
+    }
+
     if (p->noalloc) {
         return NULL;
     }
@@ -587,72 +1023,440 @@ static cJSON_bool compare_double(double a, double b)
     return (fabs(a - b) <= maxVal * DBL_EPSILON);
 }
 
-/* Render the number nicely from the given item into a string. */
-static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
+/* Shortest round-trip double to text (Grisu2, after Florian Loitsch's "Printing Floating-Point Numbers Quickly
+ * and Accurately with Integers" and Milo Yip's dtoa). Produces the digits that parse back to the same double,
+ * almost always the fewest such digits, with integer arithmetic only and no locale. */
+typedef struct
 {
-    unsigned char *output_pointer = NULL;
-    double d = item->valuedouble;
-    int length = 0;
-    size_t i = 0;
-    unsigned char number_buffer[26] = {0}; /* temporary buffer to print the number into */
-    unsigned char decimal_point = get_decimal_point();
-    double test = 0.0;
+    cjson_uint64 f; /* significand */
+    int e;                /* binary exponent: value = f * 2^e */
+} diy_fp;
 
-    if (output_buffer == NULL)
-    {
-        return false;
-    }
+/* 10^k for k = -348, -340, ..., 340, normalized to 64 bits and rounded */
+static const diy_fp cached_powers[] =
+{
+    {CJSON_U64(0xfa8fd5a0081c0288), -1220}, {CJSON_U64(0xbaaee17fa23ebf76), -1193}, {CJSON_U64(0x8b16fb203055ac76), -1166}, {CJSON_U64(0xcf42894a5dce35ea), -1140},
+    {CJSON_U64(0x9a6bb0aa55653b2d), -1113}, {CJSON_U64(0xe61acf033d1a45df), -1087}, {CJSON_U64(0xab70fe17c79ac6ca), -1060}, {CJSON_U64(0xff77b1fcbebcdc4f), -1034},
+    {CJSON_U64(0xbe5691ef416bd60c), -1007}, {CJSON_U64(0x8dd01fad907ffc3c), -980}, {CJSON_U64(0xd3515c2831559a83), -954}, {CJSON_U64(0x9d71ac8fada6c9b5), -927},
+    {CJSON_U64(0xea9c227723ee8bcb), -901}, {CJSON_U64(0xaecc49914078536d), -874}, {CJSON_U64(0x823c12795db6ce57), -847}, {CJSON_U64(0xc21094364dfb5637), -821},
+    {CJSON_U64(0x9096ea6f3848984f), -794}, {CJSON_U64(0xd77485cb25823ac7), -768}, {CJSON_U64(0xa086cfcd97bf97f4), -741}, {CJSON_U64(0xef340a98172aace5), -715},
+    {CJSON_U64(0xb23867fb2a35b28e), -688}, {CJSON_U64(0x84c8d4dfd2c63f3b), -661}, {CJSON_U64(0xc5dd44271ad3cdba), -635}, {CJSON_U64(0x936b9fcebb25c996), -608},
+    {CJSON_U64(0xdbac6c247d62a584), -582}, {CJSON_U64(0xa3ab66580d5fdaf6), -555}, {CJSON_U64(0xf3e2f893dec3f126), -529}, {CJSON_U64(0xb5b5ada8aaff80b8), -502},
+    {CJSON_U64(0x87625f056c7c4a8b), -475}, {CJSON_U64(0xc9bcff6034c13053), -449}, {CJSON_U64(0x964e858c91ba2655), -422}, {CJSON_U64(0xdff9772470297ebd), -396},
+    {CJSON_U64(0xa6dfbd9fb8e5b88f), -369}, {CJSON_U64(0xf8a95fcf88747d94), -343}, {CJSON_U64(0xb94470938fa89bcf), -316}, {CJSON_U64(0x8a08f0f8bf0f156b), -289},
+    {CJSON_U64(0xcdb02555653131b6), -263}, {CJSON_U64(0x993fe2c6d07b7fac), -236}, {CJSON_U64(0xe45c10c42a2b3b06), -210}, {CJSON_U64(0xaa242499697392d3), -183},
+    {CJSON_U64(0xfd87b5f28300ca0e), -157}, {CJSON_U64(0xbce5086492111aeb), -130}, {CJSON_U64(0x8cbccc096f5088cc), -103}, {CJSON_U64(0xd1b71758e219652c), -77},
+    {CJSON_U64(0x9c40000000000000), -50}, {CJSON_U64(0xe8d4a51000000000), -24}, {CJSON_U64(0xad78ebc5ac620000), 3}, {CJSON_U64(0x813f3978f8940984), 30},
+    {CJSON_U64(0xc097ce7bc90715b3), 56}, {CJSON_U64(0x8f7e32ce7bea5c70), 83}, {CJSON_U64(0xd5d238a4abe98068), 109}, {CJSON_U64(0x9f4f2726179a2245), 136},
+    {CJSON_U64(0xed63a231d4c4fb27), 162}, {CJSON_U64(0xb0de65388cc8ada8), 189}, {CJSON_U64(0x83c7088e1aab65db), 216}, {CJSON_U64(0xc45d1df942711d9a), 242},
+    {CJSON_U64(0x924d692ca61be758), 269}, {CJSON_U64(0xda01ee641a708dea), 295}, {CJSON_U64(0xa26da3999aef774a), 322}, {CJSON_U64(0xf209787bb47d6b85), 348},
+    {CJSON_U64(0xb454e4a179dd1877), 375}, {CJSON_U64(0x865b86925b9bc5c2), 402}, {CJSON_U64(0xc83553c5c8965d3d), 428}, {CJSON_U64(0x952ab45cfa97a0b3), 455},
+    {CJSON_U64(0xde469fbd99a05fe3), 481}, {CJSON_U64(0xa59bc234db398c25), 508}, {CJSON_U64(0xf6c69a72a3989f5c), 534}, {CJSON_U64(0xb7dcbf5354e9bece), 561},
+    {CJSON_U64(0x88fcf317f22241e2), 588}, {CJSON_U64(0xcc20ce9bd35c78a5), 614}, {CJSON_U64(0x98165af37b2153df), 641}, {CJSON_U64(0xe2a0b5dc971f303a), 667},
+    {CJSON_U64(0xa8d9d1535ce3b396), 694}, {CJSON_U64(0xfb9b7cd9a4a7443c), 720}, {CJSON_U64(0xbb764c4ca7a44410), 747}, {CJSON_U64(0x8bab8eefb6409c1a), 774},
+    {CJSON_U64(0xd01fef10a657842c), 800}, {CJSON_U64(0x9b10a4e5e9913129), 827}, {CJSON_U64(0xe7109bfba19c0c9d), 853}, {CJSON_U64(0xac2820d9623bf429), 880},
+    {CJSON_U64(0x80444b5e7aa7cf85), 907}, {CJSON_U64(0xbf21e44003acdd2d), 933}, {CJSON_U64(0x8e679c2f5e44ff8f), 960}, {CJSON_U64(0xd433179d9c8cb841), 986},
+    {CJSON_U64(0x9e19db92b4e31ba9), 1013}, {CJSON_U64(0xeb96bf6ebadf77d9), 1039}, {CJSON_U64(0xaf87023b9bf0ee6b), 1066},
+};
+
+static const cjson_uint64 pow10_u64[] =
+{
+    CJSON_U64(1), CJSON_U64(10), CJSON_U64(100), CJSON_U64(1000), CJSON_U64(10000), CJSON_U64(100000), CJSON_U64(1000000), CJSON_U64(10000000), CJSON_U64(100000000), CJSON_U64(1000000000),
+    CJSON_U64(10000000000), CJSON_U64(100000000000), CJSON_U64(1000000000000), CJSON_U64(10000000000000), CJSON_U64(100000000000000),
+    CJSON_U64(1000000000000000), CJSON_U64(10000000000000000), CJSON_U64(100000000000000000), CJSON_U64(1000000000000000000),
+    CJSON_U64(10000000000000000000)
+};
 
-    /* This checks for NaN and Infinity */
-    if (isnan(d) || isinf(d))
-    {
-        length = sprintf((char*)number_buffer, "null");
-    }
-    else if(d == (double)item->valueint)
+#define DIY_HIDDEN_BIT CJSON_U64(0x0010000000000000)
+#define DIY_SIGNIFICAND_MASK CJSON_U64(0x000FFFFFFFFFFFFF)
+
+static diy_fp diy_from_double(double d)
+{
+    diy_fp v;
+    cjson_uint64 bits = 0;
+    int biased_e = 0;
+
+    memcpy(&bits, &d, sizeof(bits));
+    biased_e = (int)((bits >> 52) & 0x7FF);
+    v.f = bits & DIY_SIGNIFICAND_MASK;
+    if (biased_e != 0)
     {
-        length = sprintf((char*)number_buffer, "%d", item->valueint);
+        v.f += DIY_HIDDEN_BIT;
+        v.e = biased_e - 1075;
     }
     else
     {
-        /* Try 15 decimal places of precision to avoid nonsignificant nonzero digits */
-        length = sprintf((char*)number_buffer, "%1.15g", d);
+        v.e = -1074; /* subnormal */
+    }
+    return v;
+}
+
+static diy_fp diy_normalize(diy_fp v)
+{
+    while ((v.f & CJSON_U64(0x8000000000000000)) == 0)
+    {
+        v.f <<= 1;
+        v.e--;
+    }
+    return v;
+}
+
+/* Upper 64 bits of the 128 bit product, rounded */
+static diy_fp diy_multiply(diy_fp x, diy_fp y)
+{
+    const cjson_uint64 mask32 = CJSON_U64(0xFFFFFFFF);
+    const cjson_uint64 a = x.f >> 32, b = x.f & mask32, c = y.f >> 32, d = y.f & mask32;
+    const cjson_uint64 ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    cjson_uint64 tmp = (bd >> 32) + (ad & mask32) + (bc & mask32);
+    diy_fp r;
+
+    tmp += CJSON_U64(1) << 31;
+    r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+/* The halfway points to the neighbouring doubles, both with the upper one's (normalized) exponent */
+static void diy_boundaries(diy_fp v, diy_fp *minus, diy_fp *plus)
+{
+    diy_fp pl;
+    diy_fp mi;
+
+    pl.f = (v.f << 1) + 1;
+    pl.e = v.e - 1;
+    pl = diy_normalize(pl);
+    if (v.f == DIY_HIDDEN_BIT)
+    {
+        mi.f = (v.f << 2) - 1; /* the gap below a power of two is half as wide */
+        mi.e = v.e - 2;
+    }
+    else
+    {
+        mi.f = (v.f << 1) - 1;
+        mi.e = v.e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *minus = mi;
+    *plus = pl;
+}
+
+/* A cached 10^-K that brings the exponent e into [-60, -32] */
+static diy_fp cached_power(int e, int *K)
+{
+    const double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int k = (int)dk;
+    size_t index = 0;
+
+    if ((dk - k) > 0.0)
+    {
+        k++;
+    }
+    index = (size_t)((k >> 3) + 1);
+    *K = -(-348 + (int)index * 8);
+    return cached_powers[index];
+}
+
+static void grisu_round(unsigned char *digits, int length, cjson_uint64 delta, cjson_uint64 rest, cjson_uint64 ten_kappa, cjson_uint64 wp_w)
+{
+    while ((rest < wp_w) && ((delta - rest) >= ten_kappa) && (((rest + ten_kappa) < wp_w) || ((wp_w - rest) > (rest + ten_kappa - wp_w))))
+    {
+        digits[length - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static int count_digits32(unsigned int n)
+{
+    int count = 1;
+    while (n >= 10)
+    {
+        n /= 10;
+        count++;
+    }
+    return count;
+}
+
+static int grisu_digits(diy_fp w, diy_fp mp, cjson_uint64 delta, unsigned char *digits, int *K)
+{
+    const int shift = -mp.e;
+    const cjson_uint64 one = CJSON_U64(1) << shift;
+    const cjson_uint64 wp_w = mp.f - w.f;
+    unsigned int p1 = (unsigned int)(mp.f >> shift);
+    cjson_uint64 p2 = mp.f & (one - 1);
+    int kappa = count_digits32(p1);
+    int length = 0;
+
+    while (kappa > 0)
+    {
+        const unsigned int divisor = (unsigned int)pow10_u64[kappa - 1];
+        const unsigned int d = p1 / divisor;
+        cjson_uint64 rest = 0;
 
-        /* Check whether the original double can be recovered */
-        if ((sscanf((char*)number_buffer, "%lg", &test) != 1) || !compare_double((double)test, d))
+        p1 %= divisor;
+        if ((d != 0) || (length != 0))
         {
-            /* If not, print with 17 decimal places of precision */
-            length = sprintf((char*)number_buffer, "%1.17g", d);
+            digits[length++] = (unsigned char)('0' + d);
+        }
+        kappa--;
+        rest = ((cjson_uint64)p1 << shift) + p2;
+        if (rest <= delta)
+        {
+            *K += kappa;
+            grisu_round(digits, length, delta, rest, pow10_u64[kappa] << shift, wp_w);
+            return length;
         }
     }
 
-    /* sprintf failed or buffer overrun occurred */
-    if ((length < 0) || (length > (int)(sizeof(number_buffer) - 1)))
+    for (;;)
     {
-        return false;
+        unsigned int d = 0;
+
+        p2 *= 10;
+        delta *= 10;
+        d = (unsigned int)(p2 >> shift);
+        if ((d != 0) || (length != 0))
+        {
+            digits[length++] = (unsigned char)('0' + d);
+        }
+        p2 &= one - 1;
+        kappa--;
+        if (p2 < delta)
+        {
+            *K += kappa;
+            grisu_round(digits, length, delta, p2, one, (-kappa < 20) ? wp_w * pow10_u64[-kappa] : 0);
+            return length;
+        }
     }
+}
 
-    /* reserve appropriate space in the output */
-    output_pointer = ensure(output_buffer, (size_t)length + sizeof(""));
-    if (output_pointer == NULL)
+/* Digits of a positive finite d into digits[17]; d = digits * 10^K */
+static int grisu2(double d, unsigned char *digits, int *K)
+{
+    const diy_fp v = diy_from_double(d);
+    diy_fp w_minus;
+    diy_fp w_plus;
+    diy_fp c_mk;
+    diy_fp w;
+
+    diy_boundaries(v, &w_minus, &w_plus);
+    c_mk = cached_power(w_plus.e, K);
+    w = diy_multiply(diy_normalize(v), c_mk);
+    w_plus = diy_multiply(w_plus, c_mk);
+    w_minus = diy_multiply(w_minus, c_mk);
+    w_minus.f++;
+    w_plus.f--;
+    return grisu_digits(w, w_plus, w_plus.f - w_minus.f, digits, K);
+}
+
+/* Unsigned decimal, most significant digit first; returns the digit count */
+static size_t print_uint(unsigned char *out, cjson_uint64 n)
+{
+    unsigned char reversed[20];
+    size_t length = 0;
+    size_t i = 0;
+
+    do
+    {
+        reversed[length++] = (unsigned char)('0' + (n % 10));
+        n /= 10;
+    } while (n != 0);
+    for (i = 0; i < length; i++)
+    {
+        out[i] = reversed[length - 1 - i];
+    }
+    return length;
+}
+
+/* Shortest text for a finite d; out needs 26 bytes. Plain notation for 1e-6 <= |d| < 1e21, else
+ * exponent notation (JSON has no use for a locale's decimal point either way). */
+static size_t print_shortest(unsigned char *out, double d)
+{
+    unsigned char *p = out;
+    unsigned char digits[18];
+    int K = 0;
+    int length = 0;
+    int kk = 0;
+
+    /* grisu2 can't normalize a zero mantissa; -0 prints as 0 like the valueint path does */
+    if (d == 0)
+    {
+        *p = '0';
+        return 1;
+    }
+
+    if (d < 0)
+    {
+        *p++ = '-';
+        d = -d;
+    }
+    length = grisu2(d, digits, &K);
+    kk = length + K; /* 10^(kk-1) <= d < 10^kk */
+
+    if ((K >= 0) && (kk <= 21))
+    {
+        /* 1234e7 -> 12340000000 */
+        memcpy(p, digits, (size_t)length);
+        memset(p + length, '0', (size_t)K);
+        p += kk;
+    }
+    else if ((kk > 0) && (kk <= 21))
+    {
+        /* 1234e-2 -> 12.34 */
+        memcpy(p, digits, (size_t)kk);
+        p[kk] = '.';
+        memcpy(p + kk + 1, digits + kk, (size_t)(length - kk));
+        p += length + 1;
+    }
+    else if ((kk > -6) && (kk <= 0))
+    {
+        /* 1234e-6 -> 0.001234 */
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', (size_t)-kk);
+        memcpy(p - kk, digits, (size_t)length);
+        p += length - kk;
+    }
+    else
+    {
+        /* 1234e30 -> 1.234e+33 */
+        *p++ = digits[0];
+        if (length > 1)
+        {
+            *p++ = '.';
+            memcpy(p, digits + 1, (size_t)(length - 1));
+            p += length - 1;
+        }
+        *p++ = 'e';
+        kk--;
+        if (kk < 0)
+        {
+            *p++ = '-';
+            kk = -kk;
+        }
+        else
+        {
+            *p++ = '+';
+        }
+        if (kk < 10)
+        {
+            *p++ = '0'; /* two exponent digits at least, as printf has it */
+        }
+        p += print_uint(p, (cjson_uint64)kk);
+    }
+    return (size_t)(p - out);
+}
+
+/* d rounded to a fixed number of decimals, or 0 if that doesn't fit an exact double integer */
+static size_t print_fixed(unsigned char *out, double d, int decimals)
+{
+    unsigned char *p = out;
+    const cjson_uint64 scale = pow10_u64[decimals];
+    double scaled = fabs(d) * (double)scale;
+    cjson_uint64 n = 0;
+    cjson_uint64 whole = 0;
+    cjson_uint64 fraction = 0;
+    int i = 0;
+
+    if (!(scaled < 9007199254740992.0)) /* 2^53 */
+    {
+        return 0;
+    }
+    n = (cjson_uint64)(scaled + 0.5);
+    whole = n / scale;
+    fraction = n % scale;
+    if ((d < 0) && (n != 0))
+    {
+        *p++ = '-';
+    }
+    p += print_uint(p, whole);
+    if (decimals > 0)
+    {
+        *p++ = '.';
+        for (i = decimals - 1; i >= 0; i--)
+        {
+            p[i] = (unsigned char)('0' + (fraction % 10));
+            fraction /= 10;
+        }
+        p += decimals;
+    }
+    return (size_t)(p - out);
+}
+
+/* Render the number nicely from the given item into a string. */
+static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output_pointer = NULL;
+    double d = item->valuedouble;
+    const int decimals = cJSON_GetNumberDecimals(item);
+    size_t length = 0;
+    unsigned char number_buffer[32]; /* "-", 17 digits, ".", "e+308" (fixed decimals take fewer) */
+
+    if (output_buffer == NULL)
     {
         return false;
     }
 
-    /* copy the printed number to the output and replace locale
-     * dependent decimal point with '.' */
-    for (i = 0; i < ((size_t)length); i++)
+    /* formatted in place when the buffer has room anyway, so preallocated and streamed output never grow for it */
+    output_pointer = number_buffer;
+    if ((output_buffer->buffer != NULL) && (output_buffer->offset < output_buffer->length) && ((output_buffer->length - output_buffer->offset) > sizeof(number_buffer)))
+    {
+        output_pointer = output_buffer->buffer + output_buffer->offset;
+    }
+
+    /* This checks for NaN and Infinity */
+    if (isnan(d) || isinf(d))
+    {
+        memcpy(output_pointer, "null", 4);
+        length = 4;
+    }
+    else if ((decimals >= 0) && ((length = print_fixed(output_pointer, d, decimals)) != 0))
+    {
+        /* fixed precision (cJSON_SetNumberDecimals) */
+    }
+#ifdef CJSON_INT64
+    else if (item->type & cJSON_NumberIsInt64)
     {
-        if (number_buffer[i] == decimal_point)
+        if ((item->valueint64 < 0) && !(item->type & cJSON_NumberIsUint64))
         {
-            output_pointer[i] = '.';
-            continue;
+            *output_pointer = '-';
+            length = 1 + print_uint(output_pointer + 1, (cjson_uint64)0 - (cjson_uint64)item->valueint64);
+        }
+        else
+        {
+            length = print_uint(output_pointer, (cjson_uint64)item->valueint64);
+        }
+    }
+#endif
+    else if (d == (double)item->valueint)
+    {
+        if (item->valueint < 0)
+        {
+            *output_pointer = '-';
+            length = 1 + print_uint(output_pointer + 1, (cjson_uint64)0 - (cjson_uint64)item->valueint);
         }
+        else
+        {
+            length = print_uint(output_pointer, (cjson_uint64)item->valueint);
+        }
+    }
+    else
+    {
+        length = print_shortest(output_pointer, d);
+    }
 
-        output_pointer[i] = number_buffer[i];
+    if (output_pointer == number_buffer)
+    {
+        output_pointer = ensure(output_buffer, length + sizeof(""));
+        if (output_pointer == NULL)
+        {
+            return false;
+        }
+        memcpy(output_pointer, number_buffer, length);
     }
-    output_pointer[i] = '\0';
+    output_pointer[length] = '\0';
 
-    output_buffer->offset += (size_t)length;
+    output_buffer->offset += length;
 
     return true;
 }
@@ -815,6 +1619,134 @@ fail:
     return 0;
 }
 
+#if CJSON_SIMD
+/* index of the first matching byte among the 16 at input, 16 when none matches */
+#if defined(__SSE2__)
+static size_t simd_first_set(unsigned int mask)
+{
+    return (mask == 0) ? 16 : (size_t)__builtin_ctz(mask);
+}
+
+static size_t simd_first_non_whitespace(const unsigned char *input)
+{
+    const __m128i bytes = _mm_loadu_si128((const __m128i*)(const void*)input);
+    const __m128i space = _mm_set1_epi8(32);
+    /* unsigned byte <= 32 exactly when max(byte, 32) == 32 */
+    const unsigned int whitespace = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(bytes, space), space));
+    return simd_first_set(~whitespace & 0xFFFFU);
+}
+
+static size_t simd_first_quote_or_backslash(const unsigned char *input)
+{
+    const __m128i bytes = _mm_loadu_si128((const __m128i*)(const void*)input);
+    const __m128i quotes = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"'));
+    const __m128i backslashes = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'));
+    return simd_first_set((unsigned int)_mm_movemask_epi8(_mm_or_si128(quotes, backslashes)));
+}
+
+static size_t simd_first_escape(const unsigned char *input)
+{
+    const __m128i bytes = _mm_loadu_si128((const __m128i*)(const void*)input);
+    const __m128i control = _mm_set1_epi8(31);
+    /* unsigned byte <= 31 exactly when max(byte, 31) == 31 */
+    const __m128i controls = _mm_cmpeq_epi8(_mm_max_epu8(bytes, control), control);
+    const __m128i quotes = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"'));
+    const __m128i backslashes = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'));
+    return simd_first_set((unsigned int)_mm_movemask_epi8(_mm_or_si128(controls, _mm_or_si128(quotes, backslashes))));
+}
+#else
+/* NEON has no movemask: narrow every byte of the comparison to a nibble and count in the 64 bit result */
+static size_t simd_first_set(uint8x16_t matches)
+{
+    const uint64_t nibbles = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+    return (nibbles == 0) ? 16 : ((size_t)__builtin_ctzll(nibbles) >> 2);
+}
+
+static size_t simd_first_non_whitespace(const unsigned char *input)
+{
+    return simd_first_set(vcgtq_u8(vld1q_u8(input), vdupq_n_u8(32)));
+}
+
+static size_t simd_first_quote_or_backslash(const unsigned char *input)
+{
+    const uint8x16_t bytes = vld1q_u8(input);
+    return simd_first_set(vorrq_u8(vceqq_u8(bytes, vdupq_n_u8('"')), vceqq_u8(bytes, vdupq_n_u8('\\'))));
+}
+
+static size_t simd_first_escape(const unsigned char *input)
+{
+    const uint8x16_t bytes = vld1q_u8(input);
+    const uint8x16_t quote_or_backslash = vorrq_u8(vceqq_u8(bytes, vdupq_n_u8('"')), vceqq_u8(bytes, vdupq_n_u8('\\')));
+    return simd_first_set(vorrq_u8(vcltq_u8(bytes, vdupq_n_u8(32)), quote_or_backslash));
+}
+#endif
+#endif /* CJSON_SIMD */
+
+/* number of bytes at input (at most available) before the next '"' or '\\',
+ * found in whole 16 byte blocks; 0 leaves it to the scalar loop */
+static size_t string_plain_run(const unsigned char *input, size_t available)
+{
+    size_t run = 0;
+#if CJSON_SIMD
+    size_t found = 0;
+    while ((available - run) >= 16)
+    {
+        found = simd_first_quote_or_backslash(input + run);
+        run += found;
+        if (found < 16)
+        {
+            break;
+        }
+    }
+#else
+    (void)input;
+    (void)available;
+#endif
+    return run;
+}
+
+/* number of bytes at input (at most available) that print as they are, before the first '"', '\\' or
+ * control character */
+static size_t string_clean_run(const unsigned char *input, size_t available)
+{
+    size_t run = 0;
+#if CJSON_SIMD
+    size_t found = 0;
+    while ((available - run) >= 16)
+    {
+        found = simd_first_escape(input + run);
+        run += found;
+        if (found < 16)
+        {
+            return run;
+        }
+    }
+#else
+    /* 8 bytes at a time: a lane is flagged when it is below 32 or equal to '"' or '\\' */
+    const cjson_uint64 ones = CJSON_U64(0x0101010101010101);
+    const cjson_uint64 highs = CJSON_U64(0x8080808080808080);
+    cjson_uint64 word = 0;
+    cjson_uint64 quotes = 0;
+    cjson_uint64 backslashes = 0;
+    while ((available - run) >= 8)
+    {
+        memcpy(&word, input + run, sizeof(word));
+        quotes = word ^ (ones * '\"');
+        backslashes = word ^ (ones * '\\');
+        if ((((word - ones * 32) & ~word) | ((quotes - ones) & ~quotes) | ((backslashes - ones) & ~backslashes)) & highs)
+        {
+            break;
+        }
+        run += 8;
+    }
+#endif
+    while ((run < available) && (input[run] > 31) && (input[run] != '\"') && (input[run] != '\\'))
+    {
+        run++;
+    }
+    return run;
+}
+
 /* Parse the input text into an unescaped cinput, and populate item. */
 static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -835,6 +1767,13 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
         size_t skipped_bytes = 0;
         while (((size_t)(input_end - input_buffer->content) < input_buffer->length) && (*input_end != '\"'))
         {
+            size_t run = string_plain_run(input_end, input_buffer->length - (size_t)(input_end - input_buffer->content));
+            if (run > 0)
+            {
+                input_end += run;
+                continue;
+            }
+
             /* is escape sequence */
             if (input_end[0] == '\\')
             {
@@ -855,10 +1794,18 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 
         /* This is at most how much we need for the output */
         allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
-        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
-        if (output == NULL)
+        if (input_buffer->insitu != NULL)
         {
-            goto fail; /* allocation failure */
+            /* unescaping never makes a string longer, so it can overwrite its own source */
+            output = input_buffer->insitu + input_buffer->offset + 1;
+        }
+        else
+        {
+            output = (unsigned char*)hooks_allocate(&input_buffer->hooks, allocation_length + sizeof(""));
+            if (output == NULL)
+            {
+                goto fail; /* allocation failure */
+            }
         }
     }
 
@@ -919,10 +1866,11 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
         }
     }
 
-    /* zero terminate the output */
+    /* zero terminate the output (in situ this lands on or before the closing quote) */
     *output_pointer = '\0';
 
-    item->type = cJSON_String;
+    /* an in situ string belongs to the input buffer, cJSON_Delete must not free it */
+    item->type = (input_buffer->insitu != NULL) ? (cJSON_String | cJSON_IsReference) : cJSON_String;
     item->valuestring = (char*)output;
 
     input_buffer->offset = (size_t) (input_end - input_buffer->content);
@@ -931,9 +1879,9 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     return true;
 
 fail:
-    if (output != NULL)
+    if ((output != NULL) && (input_buffer->insitu == NULL))
     {
-        input_buffer->hooks.deallocate(output);
+        hooks_deallocate(&input_buffer->hooks, output);
         output = NULL;
     }
 
@@ -952,6 +1900,8 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
     unsigned char *output = NULL;
     unsigned char *output_pointer = NULL;
     size_t output_length = 0;
+    size_t input_length = 0;
+    size_t run = 0;
     /* numbers of additional characters needed for escaping */
     size_t escape_characters = 0;
 
@@ -973,8 +1923,12 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
         return true;
     }
 
-    /* set "flag" to 1 if something needs to be escaped */
-    for (input_pointer = input; *input_pointer; input_pointer++)
+    /* clean runs go by 16 bytes at a time; only the rest is looked at byte by byte */
+    input_length = strlen((const char*)input);
+    run = string_clean_run(input, input_length);
+
+    /* count the additional characters past the clean prefix */
+    for (input_pointer = input + run; *input_pointer; input_pointer++)
     {
         switch (*input_pointer)
         {
@@ -997,7 +1951,7 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
                 break;
         }
     }
-    output_length = (size_t)(input_pointer - input) + escape_characters;
+    output_length = input_length + escape_characters;
 
     output = ensure(output_buffer, output_length + sizeof("\"\""));
     if (output == NULL)
@@ -1017,14 +1971,18 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
     }
 
     output[0] = '\"';
-    output_pointer = output + 1;
+    memcpy(output + 1, input, run);
+    output_pointer = output + 1 + run;
     /* copy the string */
-    for (input_pointer = input; *input_pointer != '\0'; (void)input_pointer++, output_pointer++)
+    for (input_pointer = input + run; *input_pointer != '\0'; (void)input_pointer++, output_pointer++)
     {
-        if ((*input_pointer > 31) && (*input_pointer != '\"') && (*input_pointer != '\\'))
+        run = string_clean_run(input_pointer, input_length - (size_t)(input_pointer - input));
+        if (run > 0)
         {
-            /* normal character, copy */
-            *output_pointer = *input_pointer;
+            /* normal characters, copy */
+            memcpy(output_pointer, input_pointer, run);
+            input_pointer += run - 1;
+            output_pointer += run - 1;
         }
         else
         {
@@ -1084,6 +2042,10 @@ static cJSON_bool print_object(const cJSON * const item, printbuffer * const out
 /* Utility to jump whitespace and cr/lf */
 static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
 {
+#if CJSON_SIMD
+    size_t found = 0;
+#endif
+
     if ((buffer == NULL) || (buffer->content == NULL))
     {
         return NULL;
@@ -1094,6 +2056,19 @@ static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
         return buffer;
     }
 
+#if CJSON_SIMD
+    /* pretty printed documents have long indentation runs */
+    while ((buffer->length - buffer->offset) >= 16)
+    {
+        found = simd_first_non_whitespace(buffer_at_offset(buffer));
+        buffer->offset += found;
+        if (found < 16)
+        {
+            return buffer;
+        }
+    }
+#endif
+
     while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
     {
        buffer->offset++;
@@ -1139,14 +2114,14 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return
 }
 
 /* Parse an object - create a new root, and populate. */
-CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+static cJSON *parse_document(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated, const internal_hooks * const hooks, unsigned char *insitu, error * const parse_error)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL };
     cJSON *item = NULL;
 
     /* reset error position */
-    global_error.json = NULL;
-    global_error.position = 0;
+    parse_error->json = NULL;
+    parse_error->position = 0;
 
     if (value == NULL || 0 == buffer_length)
     {
@@ -1156,9 +2131,10 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer
     buffer.content = (const unsigned char*)value;
     buffer.length = buffer_length;
     buffer.offset = 0;
-    buffer.hooks = global_hooks;
+    buffer.hooks = *hooks;
+    buffer.insitu = insitu;
 
-    item = cJSON_New_Item(&global_hooks);
+    item = cJSON_New_Item(hooks);
     if (item == NULL) /* memory fail */
     {
         goto fail;
@@ -1189,44 +2165,836 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer
 fail:
     if (item != NULL)
     {
-        cJSON_Delete(item);
+        delete_parsed(item, &buffer);
+    }
+
+    if (value != NULL)
+    {
+        error local_error;
+        local_error.json = (const unsigned char*)value;
+        local_error.position = 0;
+
+        if (buffer.offset < buffer.length)
+        {
+            local_error.position = buffer.offset;
+        }
+        else if (buffer.length > 0)
+        {
+            local_error.position = buffer.length - 1;
+        }
+
+        if (return_parse_end != NULL)
+        {
+            *return_parse_end = (const char*)local_error.json + local_error.position;
+        }
+
+        *parse_error = local_error;
+    }
+
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    return parse_document(value, buffer_length, return_parse_end, require_null_terminated, &global_hooks, NULL, &global_error);
+}
+
+/* parse_document; a failed parse leaves the arena, if any, as it was */
+static cJSON *parse_restoring_arena(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated, const internal_hooks * const hooks, unsigned char *insitu, error * const parse_error)
+{
+    cJSON_Arena *arena = hooks->arena;
+    size_t used = 0;
+    size_t last = 0;
+    cJSON *item = NULL;
+
+    if (arena == NULL)
+    {
+        return parse_document(value, buffer_length, return_parse_end, require_null_terminated, hooks, insitu, parse_error);
+    }
+
+    used = arena->used;
+    last = arena->last;
+    item = parse_document(value, buffer_length, return_parse_end, require_null_terminated, hooks, insitu, parse_error);
+    if (item == NULL)
+    {
+        arena->used = used;
+        arena->last = last;
+    }
+
+    return item;
+}
+
+static cJSON *parse_with_arena(const char *value, size_t buffer_length, unsigned char *insitu, cJSON_Arena *arena)
+{
+    internal_hooks hooks = global_hooks;
+
+    if ((arena == NULL) || (arena->buffer == NULL))
+    {
+        return NULL;
+    }
+    hooks.arena = arena;
+
+    return parse_restoring_arena(value, buffer_length, NULL, false, &hooks, insitu, &global_error);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseCtx(cJSON_Context *ctx, const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    internal_hooks hooks;
+    error parse_error = { NULL, 0 };
+    cJSON *item = NULL;
+
+    if (ctx == NULL)
+    {
+        return NULL;
+    }
+    ctx->error = NULL;
+    if ((ctx->arena != NULL) && (ctx->arena->buffer == NULL))
+    {
+        return NULL;
+    }
+
+    hooks = context_hooks(ctx);
+    item = parse_restoring_arena(value, buffer_length, return_parse_end, require_null_terminated, &hooks, NULL, &parse_error);
+    if (parse_error.json != NULL)
+    {
+        ctx->error = (const char*)(parse_error.json + parse_error.position);
+    }
+
+    return item;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithArena(const char *value, size_t buffer_length, cJSON_Arena *arena)
+{
+    return parse_with_arena(value, buffer_length, NULL, arena);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseInSitu(char *value, size_t buffer_length)
+{
+    return parse_document(value, buffer_length, NULL, false, &global_hooks, (unsigned char*)value, &global_error);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseInSituWithArena(char *value, size_t buffer_length, cJSON_Arena *arena)
+{
+    return parse_with_arena(value, buffer_length, (unsigned char*)value, arena);
+}
+
+/* Default options for cJSON_Parse */
+CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
+{
+    return cJSON_ParseWithOpts(value, 0, 0);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_length)
+{
+    return cJSON_ParseWithLengthOpts(value, buffer_length, 0, 0);
+}
+
+/* states of the push parser's boundary scanner */
+#define PUSH_IDLE 0      /* between documents */
+#define PUSH_CONTAINER 1 /* inside an object or array */
+#define PUSH_STRING 2    /* inside a string, at any depth */
+#define PUSH_ESCAPE 3    /* after a backslash in a string */
+#define PUSH_SCALAR 4    /* top-level number or literal */
+
+CJSON_PUBLIC(void) cJSON_InitPushParser(cJSON_PushParser *parser, size_t max_size)
+{
+    if (parser == NULL)
+    {
+        return;
+    }
+
+    parser->buffer = NULL;
+    parser->size = 0;
+    parser->max_size = max_size;
+    cJSON_ResetPushParser(parser);
+}
+
+CJSON_PUBLIC(void) cJSON_ResetPushParser(cJSON_PushParser *parser)
+{
+    if (parser == NULL)
+    {
+        return;
+    }
+
+    parser->length = 0;
+    parser->start = 0;
+    parser->scanned = 0;
+    parser->depth = 0;
+    parser->state = PUSH_IDLE;
+    parser->failed = false;
+}
+
+CJSON_PUBLIC(void) cJSON_FreePushParser(cJSON_PushParser *parser)
+{
+    if (parser == NULL)
+    {
+        return;
+    }
+
+    if (parser->buffer != NULL)
+    {
+        global_hooks.deallocate(parser->buffer);
+    }
+    cJSON_InitPushParser(parser, parser->max_size);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_PushFeed(cJSON_PushParser *parser, const char *chunk, size_t length)
+{
+    size_t needed = 0;
+
+    if ((parser == NULL) || ((chunk == NULL) && (length > 0)))
+    {
+        return false;
+    }
+    if (length == 0)
+    {
+        return true;
+    }
+
+    /* drop the bytes of the documents already returned */
+    if (parser->start > 0)
+    {
+        memmove(parser->buffer, parser->buffer + parser->start, parser->length - parser->start);
+        parser->length -= parser->start;
+        parser->scanned -= parser->start;
+        parser->start = 0;
+    }
+
+    needed = parser->length + length;
+    if ((needed < length) || ((parser->max_size > 0) && (needed > parser->max_size)))
+    {
+        return false;
+    }
+
+    if (needed > parser->size)
+    {
+        size_t newsize = (parser->size > 0) ? parser->size : 256;
+        char *newbuffer = NULL;
+
+        while (newsize < needed)
+        {
+            newsize = (newsize > ((size_t)-1 / 2)) ? needed : newsize * 2;
+        }
+
+        if (global_hooks.reallocate != NULL)
+        {
+            /* on failure the old buffer is still valid */
+            newbuffer = (char*)global_hooks.reallocate(parser->buffer, newsize);
+            if (newbuffer == NULL)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            newbuffer = (char*)global_hooks.allocate(newsize);
+            if (newbuffer == NULL)
+            {
+                return false;
+            }
+            if (parser->buffer != NULL)
+            {
+                memcpy(newbuffer, parser->buffer, parser->length);
+                global_hooks.deallocate(parser->buffer);
+            }
+        }
+        parser->buffer = newbuffer;
+        parser->size = newsize;
+    }
+
+    memcpy(parser->buffer + parser->length, chunk, length);
+    parser->length = needed;
+
+    return true;
+}
+
+/* parse the document that ends (exclusive) at end and move past it */
+static cJSON *push_parse(cJSON_PushParser * const parser, size_t end)
+{
+    cJSON *item = parse_document(parser->buffer + parser->start, end - parser->start, NULL, false, &global_hooks, NULL, &global_error);
+
+    parser->start = end;
+    parser->scanned = end;
+    parser->depth = 0;
+    parser->state = PUSH_IDLE;
+    if (item == NULL)
+    {
+        parser->failed = true;
+    }
+
+    return item;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_PushNext(cJSON_PushParser *parser)
+{
+    const unsigned char *buffer = NULL;
+    size_t position = 0;
+
+    if (parser == NULL)
+    {
+        return NULL;
+    }
+    parser->failed = false;
+    buffer = (const unsigned char*)parser->buffer;
+
+    for (position = parser->scanned; position < parser->length; position++)
+    {
+        unsigned char c = buffer[position];
+
+        switch (parser->state)
+        {
+            case PUSH_IDLE:
+                if (c <= 32)
+                {
+                    parser->start = position + 1;
+                }
+                else if ((c == '{') || (c == '['))
+                {
+                    parser->state = PUSH_CONTAINER;
+                    parser->depth = 1;
+                }
+                else if (c == '\"')
+                {
+                    parser->state = PUSH_STRING;
+                }
+                else if ((c == ',') || (c == ']') || (c == '}'))
+                {
+                    /* can't start a value, fails as a document of its own */
+                    return push_parse(parser, position + 1);
+                }
+                else
+                {
+                    parser->state = PUSH_SCALAR;
+                }
+                break;
+
+            case PUSH_CONTAINER:
+                if (c == '\"')
+                {
+                    parser->state = PUSH_STRING;
+                }
+                else if ((c == '{') || (c == '['))
+                {
+                    parser->depth++;
+                }
+                else if ((c == '}') || (c == ']'))
+                {
+                    parser->depth--;
+                    if (parser->depth == 0)
+                    {
+                        return push_parse(parser, position + 1);
+                    }
+                }
+                break;
+
+            case PUSH_STRING:
+            {
+                size_t run = string_plain_run(buffer + position, parser->length - position);
+                if (run > 0)
+                {
+                    position += run - 1;
+                }
+                else if (c == '\\')
+                {
+                    parser->state = PUSH_ESCAPE;
+                }
+                else if (c == '\"')
+                {
+                    if (parser->depth == 0)
+                    {
+                        return push_parse(parser, position + 1);
+                    }
+                    parser->state = PUSH_CONTAINER;
+                }
+                break;
+            }
+
+            case PUSH_ESCAPE:
+                parser->state = PUSH_STRING;
+                break;
+
+            default:
+                /* a scalar ends at whitespace or the next token */
+                if ((c <= 32) || (c == ',') || (c == ']') || (c == '}') || (c == '{') || (c == '[') || (c == '\"'))
+                {
+                    return push_parse(parser, position);
+                }
+                break;
+        }
+    }
+    parser->scanned = parser->length;
+
+    if ((parser->state == PUSH_IDLE) && (parser->start == parser->length))
+    {
+        parser->length = 0;
+        parser->start = 0;
+        parser->scanned = 0;
+    }
+
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_PushFinish(cJSON_PushParser *parser)
+{
+    cJSON *item = cJSON_PushNext(parser);
+
+    if ((parser == NULL) || (item != NULL) || parser->failed)
+    {
+        return item;
+    }
+
+    if (parser->state == PUSH_SCALAR)
+    {
+        return push_parse(parser, parser->length);
+    }
+    if (parser->state != PUSH_IDLE)
+    {
+        /* the stream ended inside a document */
+        cJSON_ResetPushParser(parser);
+        parser->failed = true;
+    }
+
+    return NULL;
+}
+
+CJSON_PUBLIC(void) cJSON_InitTape(cJSON_Tape *tape, cJSON_TapeEntry *entries, size_t capacity)
+{
+    if (tape == NULL)
+    {
+        return;
+    }
+
+    tape->json = NULL;
+    tape->length = 0;
+    tape->entries = entries;
+    tape->capacity = (entries != NULL) ? capacity : 0;
+    tape->count = 0;
+}
+
+static size_t tape_skip_whitespace(const cJSON_Tape * const tape, size_t offset)
+{
+    while ((offset < tape->length) && (((const unsigned char*)tape->json)[offset] <= 32))
+    {
+        offset++;
+    }
+
+    return offset;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_TapeIndex(cJSON_Tape *tape, const char *json, size_t length)
+{
+    const unsigned char *input = (const unsigned char*)json;
+    cJSON_TapeEntry *entries = NULL;
+    size_t open = (size_t)-1; /* innermost open container, its next links to the enclosing one */
+    size_t position = 0;
+    size_t depth = 0;
+    size_t count = 0;
+    size_t start = 0;
+
+    if ((tape == NULL) || (json == NULL))
+    {
+        return false;
+    }
+    entries = tape->entries;
+    tape->json = NULL;
+    tape->count = 0;
+
+    for (position = 0; position < length; position++)
+    {
+        unsigned char c = input[position];
+
+        if (c == '\"')
+        {
+            /* strings hold no structure, skip to the closing quote */
+            position++;
+            for (;;)
+            {
+                if (position >= length)
+                {
+                    return false;
+                }
+                position += string_plain_run(input + position, length - position);
+                if (position >= length)
+                {
+                    return false;
+                }
+                if (input[position] == '\"')
+                {
+                    break;
+                }
+                position += (input[position] == '\\') ? 2 : 1;
+            }
+            continue;
+        }
+        if ((c != '{') && (c != '[') && (c != '}') && (c != ']') && (c != ',') && (c != ':'))
+        {
+            continue;
+        }
+
+        if (count >= tape->capacity)
+        {
+            return false;
+        }
+        entries[count].offset = position;
+        entries[count].next = count + 1;
+        if ((c == '{') || (c == '['))
+        {
+            if (depth >= CJSON_NESTING_LIMIT)
+            {
+                return false;
+            }
+            depth++;
+            entries[count].next = open;
+            open = count;
+        }
+        else if ((c == '}') || (c == ']'))
+        {
+            size_t parent = 0;
+
+            if ((open == (size_t)-1) || (input[entries[open].offset] != ((c == '}') ? '{' : '[')))
+            {
+                return false;
+            }
+            parent = entries[open].next;
+            entries[open].next = count + 1;
+            open = parent;
+            depth--;
+        }
+        count++;
+    }
+
+    if (open != (size_t)-1)
+    {
+        return false;
+    }
+
+    /* exactly one value: a container root spans the whole tape, a scalar root has no tape */
+    tape->json = json;
+    tape->length = length;
+    start = tape_skip_whitespace(tape, 0);
+    if ((start >= length) ||
+        ((count > 0) && ((entries[0].offset != start) || (entries[0].next != count) || (tape_skip_whitespace(tape, entries[count - 1].offset + 1) != length))))
+    {
+        tape->json = NULL;
+        return false;
+    }
+    tape->count = count;
+
+    return true;
+}
+
+static cJSON_TapeValue tape_none(void)
+{
+    cJSON_TapeValue none;
+
+    none.tape = NULL;
+    none.offset = 0;
+    none.entry = 0;
+    none.key = 0;
+
+    return none;
+}
+
+CJSON_PUBLIC(cJSON_TapeValue) cJSON_TapeRoot(const cJSON_Tape *tape)
+{
+    cJSON_TapeValue root = tape_none();
+
+    if ((tape == NULL) || (tape->json == NULL))
+    {
+        return root;
+    }
+
+    root.tape = tape;
+    root.offset = tape_skip_whitespace(tape, 0);
+
+    return root;
+}
+
+CJSON_PUBLIC(int) cJSON_TapeType(cJSON_TapeValue value)
+{
+    if ((value.tape == NULL) || (value.offset >= value.tape->length))
+    {
+        return cJSON_Invalid;
+    }
+
+    switch (value.tape->json[value.offset])
+    {
+        case '{':
+            return cJSON_Object;
+        case '[':
+            return cJSON_Array;
+        case '\"':
+            return cJSON_String;
+        case 't':
+            return cJSON_True;
+        case 'f':
+            return cJSON_False;
+        case 'n':
+            return cJSON_NULL;
+        case '-':
+            return cJSON_Number;
+        default:
+            break;
+    }
+    if ((value.tape->json[value.offset] >= '0') && (value.tape->json[value.offset] <= '9'))
+    {
+        return cJSON_Number;
+    }
+
+    return cJSON_Invalid;
+}
+
+/* the element that follows the opening bracket or comma at entry */
+static cJSON_TapeValue tape_element(const cJSON_Tape * const tape, size_t entry, cJSON_bool in_object)
+{
+    cJSON_TapeValue element = tape_none();
+    size_t offset = tape_skip_whitespace(tape, tape->entries[entry].offset + 1);
+
+    if (offset >= tape->length)
+    {
+        return element;
+    }
+
+    if (in_object)
+    {
+        /* "name" : value, the name holds no tape entries */
+        if ((tape->json[offset] != '\"') || ((entry + 1) >= tape->count) || (tape->json[tape->entries[entry + 1].offset] != ':'))
+        {
+            return element;
+        }
+        element.key = offset;
+        entry++;
+        offset = tape_skip_whitespace(tape, tape->entries[entry].offset + 1);
+    }
+    entry++;
+
+    if ((offset >= tape->length) || (tape->json[offset] == ',') || (tape->json[offset] == ']') || (tape->json[offset] == '}'))
+    {
+        return tape_none();
+    }
+    element.tape = tape;
+    element.offset = offset;
+    element.entry = entry;
+
+    return element;
+}
+
+CJSON_PUBLIC(cJSON_TapeValue) cJSON_TapeChild(cJSON_TapeValue container)
+{
+    int type = cJSON_TapeType(container);
+
+    if ((type != cJSON_Object) && (type != cJSON_Array))
+    {
+        return tape_none();
+    }
+
+    return tape_element(container.tape, container.entry, type == cJSON_Object);
+}
+
+CJSON_PUBLIC(cJSON_TapeValue) cJSON_TapeNext(cJSON_TapeValue value)
+{
+    const cJSON_Tape *tape = value.tape;
+    size_t after = 0;
+    int type = cJSON_TapeType(value);
+
+    if (type == cJSON_Invalid)
+    {
+        return tape_none();
+    }
+
+    /* jump over a container in one step */
+    after = ((type == cJSON_Object) || (type == cJSON_Array)) ? tape->entries[value.entry].next : value.entry;
+    if ((after >= tape->count) || (tape->json[tape->entries[after].offset] != ','))
+    {
+        return tape_none();
+    }
+
+    return tape_element(tape, after, value.key != 0);
+}
+
+CJSON_PUBLIC(cJSON_TapeValue) cJSON_TapeGetArrayItem(cJSON_TapeValue array, int index)
+{
+    cJSON_TapeValue element = tape_none();
+
+    if ((index < 0) || (cJSON_TapeType(array) != cJSON_Array))
+    {
+        return element;
+    }
+
+    for (element = cJSON_TapeChild(array); (index > 0) && (element.tape != NULL); index--)
+    {
+        element = cJSON_TapeNext(element);
+    }
+
+    return element;
+}
+
+static cJSON_bool tape_parse_string(const cJSON_Tape * const tape, size_t offset, cJSON * const item, const internal_hooks * const hooks)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL };
+
+    buffer.content = (const unsigned char*)tape->json;
+    buffer.length = tape->length;
+    buffer.offset = offset;
+    buffer.hooks = *hooks;
+    memset(item, '\0', sizeof(cJSON));
+
+    return parse_string(item, &buffer);
+}
+
+static cJSON_bool tape_name_equals(const cJSON_Tape * const tape, size_t key, const char * const string, const cJSON_bool case_sensitive)
+{
+    const unsigned char *name = (const unsigned char*)tape->json + key + 1;
+    const unsigned char *end = (const unsigned char*)tape->json + tape->length;
+    const unsigned char *expected = (const unsigned char*)string;
+    cJSON decoded;
+    cJSON_bool equal = false;
+
+    for (; (name < end) && (*name != '\"'); name++, expected++)
+    {
+        if (*name == '\\')
+        {
+            /* escaped names are rare, decode this one */
+            if (!tape_parse_string(tape, key, &decoded, &global_hooks))
+            {
+                return false;
+            }
+            equal = case_sensitive ? (strcmp(decoded.valuestring, string) == 0) : (case_insensitive_strcmp((const unsigned char*)decoded.valuestring, (const unsigned char*)string) == 0);
+            global_hooks.deallocate(decoded.valuestring);
+            return equal;
+        }
+        if ((*expected == '\0') || (case_sensitive ? (*name != *expected) : (tolower(*name) != tolower(*expected))))
+        {
+            return false;
+        }
+    }
+
+    return (name < end) && (*expected == '\0');
+}
+
+static cJSON_TapeValue tape_get_object_item(cJSON_TapeValue object, const char * const string, const cJSON_bool case_sensitive)
+{
+    cJSON_TapeValue member = tape_none();
+
+    if ((string == NULL) || (cJSON_TapeType(object) != cJSON_Object))
+    {
+        return member;
+    }
+
+    for (member = cJSON_TapeChild(object); member.tape != NULL; member = cJSON_TapeNext(member))
+    {
+        if (tape_name_equals(object.tape, member.key, string, case_sensitive))
+        {
+            break;
+        }
+    }
+
+    return member;
+}
+
+CJSON_PUBLIC(cJSON_TapeValue) cJSON_TapeGetObjectItem(cJSON_TapeValue object, const char *string)
+{
+    return tape_get_object_item(object, string, false);
+}
+
+CJSON_PUBLIC(cJSON_TapeValue) cJSON_TapeGetObjectItemCaseSensitive(cJSON_TapeValue object, const char *string)
+{
+    return tape_get_object_item(object, string, true);
+}
+
+CJSON_PUBLIC(double) cJSON_TapeGetNumberValue(cJSON_TapeValue value)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL };
+    cJSON item;
+
+    if (cJSON_TapeType(value) != cJSON_Number)
+    {
+        return (double) NAN;
+    }
+
+    buffer.content = (const unsigned char*)value.tape->json;
+    buffer.length = value.tape->length;
+    buffer.offset = value.offset;
+    buffer.hooks = global_hooks;
+    memset(&item, '\0', sizeof(item));
+    if (!parse_number(&item, &buffer))
+    {
+        return (double) NAN;
     }
 
-    if (value != NULL)
+    return item.valuedouble;
+}
+
+/* unescape the string at offset straight into buffer, through an arena over it */
+static cJSON_bool tape_copy_string(const cJSON_Tape * const tape, size_t offset, char * const buffer, size_t size)
+{
+    cJSON_Arena arena;
+    internal_hooks hooks;
+    cJSON item;
+
+    if ((buffer == NULL) || (size == 0))
     {
-        error local_error;
-        local_error.json = (const unsigned char*)value;
-        local_error.position = 0;
+        return false;
+    }
 
-        if (buffer.offset < buffer.length)
-        {
-            local_error.position = buffer.offset;
-        }
-        else if (buffer.length > 0)
-        {
-            local_error.position = buffer.length - 1;
-        }
+    /* not cJSON_InitArena: strings need no alignment, so they start at buffer itself */
+    arena.buffer = (unsigned char*)buffer;
+    arena.size = size;
+    arena.used = 0;
+    arena.last = 0;
+    hooks = global_hooks;
+    hooks.arena = &arena;
 
-        if (return_parse_end != NULL)
-        {
-            *return_parse_end = (const char*)local_error.json + local_error.position;
-        }
+    return tape_parse_string(tape, offset, &item, &hooks);
+}
 
-        global_error = local_error;
+CJSON_PUBLIC(cJSON_bool) cJSON_TapeCopyString(cJSON_TapeValue value, char *buffer, size_t size)
+{
+    if (cJSON_TapeType(value) != cJSON_String)
+    {
+        return false;
     }
 
-    return NULL;
+    return tape_copy_string(value.tape, value.offset, buffer, size);
 }
 
-/* Default options for cJSON_Parse */
-CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
+CJSON_PUBLIC(cJSON_bool) cJSON_TapeCopyName(cJSON_TapeValue member, char *buffer, size_t size)
 {
-    return cJSON_ParseWithOpts(value, 0, 0);
+    if ((member.tape == NULL) || (member.key == 0))
+    {
+        return false;
+    }
+
+    return tape_copy_string(member.tape, member.key, buffer, size);
 }
 
-CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_length)
+CJSON_PUBLIC(cJSON *) cJSON_TapeMaterialize(cJSON_TapeValue value)
 {
-    return cJSON_ParseWithLengthOpts(value, buffer_length, 0, 0);
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL };
+    cJSON *item = NULL;
+
+    if (cJSON_TapeType(value) == cJSON_Invalid)
+    {
+        return NULL;
+    }
+
+    buffer.content = (const unsigned char*)value.tape->json;
+    buffer.length = value.tape->length;
+    buffer.offset = value.offset;
+    buffer.hooks = global_hooks;
+
+    item = cJSON_New_Item(&global_hooks);
+    if (item == NULL)
+    {
+        return NULL;
+    }
+    if (!parse_value(item, &buffer))
+    {
+        cJSON_Delete(item);
+        return NULL;
+    }
+
+    return item;
 }
 
 #define cjson_min(a, b) (((a) < (b)) ? (a) : (b))
@@ -1309,9 +3077,24 @@ CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item)
     return (char*)print(item, false, &global_hooks);
 }
 
+CJSON_PUBLIC(char *) cJSON_PrintCtx(const cJSON_Context *ctx, const cJSON *item, cJSON_bool format)
+{
+    internal_hooks hooks;
+
+    if (ctx == NULL)
+    {
+        return NULL;
+    }
+
+    /* the text is the caller's to free, so it never comes out of the arena */
+    hooks = context_hooks(ctx);
+    hooks.arena = NULL;
+    return (char*)print(item, format, &hooks);
+}
+
 CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL, NULL, 0 };
 
     if (prebuffer < 0)
     {
@@ -1342,7 +3125,7 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL, NULL, 0 };
 
     if ((length < 0) || (buffer == NULL))
     {
@@ -1359,6 +3142,102 @@ CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, cons
     return print_value(item, &p);
 }
 
+CJSON_PUBLIC(void) cJSON_InitWriter(cJSON_Writer *writer, char *buffer, size_t size)
+{
+    if (writer == NULL)
+    {
+        return;
+    }
+
+    writer->buffer = buffer;
+    writer->size = (buffer != NULL) ? size : 0;
+    writer->length = 0;
+    writer->fixed = (buffer != NULL);
+    writer->write = NULL;
+    writer->context = NULL;
+}
+
+CJSON_PUBLIC(void) cJSON_InitStreamWriter(cJSON_Writer *writer, char *chunk, size_t size, cJSON_WriteFn write, void *context)
+{
+    cJSON_InitWriter(writer, chunk, size);
+    if (writer != NULL)
+    {
+        writer->write = write;
+        writer->context = context;
+    }
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_Write(cJSON_Writer *writer, const cJSON *item, cJSON_bool format)
+{
+    static const size_t default_buffer_size = 256;
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL, NULL, 0 };
+    cJSON_bool printed = false;
+
+    if ((writer == NULL) || (item == NULL) || (writer->fixed && ((writer->buffer == NULL) || (writer->size == 0))))
+    {
+        return false;
+    }
+    writer->length = 0;
+
+    if (writer->buffer == NULL)
+    {
+        writer->buffer = (char*)global_hooks.allocate(default_buffer_size);
+        if (writer->buffer == NULL)
+        {
+            return false;
+        }
+        writer->size = default_buffer_size;
+    }
+
+    p.buffer = (unsigned char*)writer->buffer;
+    p.length = writer->size;
+    p.noalloc = writer->fixed;
+    p.format = format;
+    p.hooks = global_hooks;
+    p.flush = writer->write;
+    p.context = writer->context;
+
+    printed = print_value(item, &p);
+    if (printed)
+    {
+        update_offset(&p);
+        if ((p.flush != NULL) && (p.offset > 0))
+        {
+            printed = p.flush(p.context, (const char*)p.buffer, p.offset);
+            p.flushed += p.offset;
+        }
+    }
+
+    /* a grown buffer replaces the old one, a failed reallocation has freed it */
+    if (!writer->fixed)
+    {
+        writer->buffer = (char*)p.buffer;
+        writer->size = (p.buffer != NULL) ? p.length : 0;
+    }
+    if (printed)
+    {
+        writer->length = (p.flush != NULL) ? p.flushed : p.offset;
+    }
+
+    return printed;
+}
+
+CJSON_PUBLIC(void) cJSON_FreeWriter(cJSON_Writer *writer)
+{
+    if ((writer == NULL) || writer->fixed)
+    {
+        return;
+    }
+
+    if (writer->buffer != NULL)
+    {
+        global_hooks.deallocate(writer->buffer);
+    }
+    writer->buffer = NULL;
+    writer->size = 0;
+    writer->length = 0;
+}
+
 /* Parser core - when encountering text, process appropriately. */
 static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -1580,7 +3459,7 @@ success:
 fail:
     if (head != NULL)
     {
-        cJSON_Delete(head);
+        delete_parsed(head, input_buffer);
     }
 
     return false;
@@ -1740,6 +3619,10 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
         {
             goto fail; /* failed to parse value */
         }
+        if (input_buffer->insitu != NULL)
+        {
+            current_item->type |= cJSON_StringIsConst; /* the name lives in the input too */
+        }
         buffer_skip_whitespace(input_buffer);
     }
     while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
@@ -1757,6 +3640,12 @@ success:
     }
 
     item->type = cJSON_Object;
+#if CJSON_INDEX_THRESHOLD > 0
+    if (input_buffer->hooks.arena != NULL)
+    {
+        item->index = &never_indexed; /* the index would outlive the arena */
+    }
+#endif
     item->child = head;
 
     input_buffer->offset++;
@@ -1765,7 +3654,7 @@ success:
 fail:
     if (head != NULL)
     {
-        cJSON_Delete(head);
+        delete_parsed(head, input_buffer);
     }
 
     return false;
@@ -1943,46 +3832,171 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index)
     return get_array_item(array, (size_t)index);
 }
 
-static cJSON *get_object_item(const cJSON * const object, const char * const name, const cJSON_bool case_sensitive)
-{
-    cJSON *current_element = NULL;
+static void* cast_away_const(const void* string);
 
-    if ((object == NULL) || (name == NULL))
+/* FNV-1a over the lower case name, so one table serves both kinds of lookup */
+static size_t index_hash(const unsigned char *name)
+{
+    size_t hash = (size_t)2166136261U;
+    for (; *name != '\0'; name++)
     {
-        return NULL;
+        hash = (hash ^ (size_t)tolower(*name)) * (size_t)16777619U;
     }
+    return hash;
+}
 
-    current_element = object->child;
+static cJSON_bool name_matches(const cJSON * const item, const char * const name, const cJSON_bool case_sensitive)
+{
     if (case_sensitive)
     {
-        while ((current_element != NULL) && (current_element->string != NULL) && (strcmp(name, current_element->string) != 0))
+        return (item->string != NULL) && (strcmp(name, item->string) == 0);
+    }
+    return case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)(item->string)) == 0;
+}
+
+#if CJSON_INDEX_THRESHOLD > 0
+static cJSON_bool index_is_current(const cJSON * const object)
+{
+    return holds_index(object) && (object->index != NULL) && (object->index != &never_indexed) && (object->child != NULL)
+        && (object->index->first == object->child) && (object->index->last == object->child->prev);
+}
+
+static cJSON_bool build_index(const cJSON * const object)
+{
+    cJSON *writable = (cJSON*)cast_away_const(object);
+    struct cJSON_Index *index = NULL;
+    cJSON *member = NULL;
+    size_t members = 0;
+    size_t slot_count = 1;
+    size_t slot = 0;
+
+    /* a reference shares its member list with the object it refers to, which may change it underneath */
+    if (!holds_index(object) || (object->index == &never_indexed) || (object->type & cJSON_IsReference))
+    {
+        return false;
+    }
+
+    for (member = object->child; member != NULL; member = member->next)
+    {
+        if (member->string == NULL)
         {
-            current_element = current_element->next;
+            return false; /* not a proper object, keep searching linearly */
         }
+        members++;
     }
-    else
+    while (slot_count < (members * 2))
+    {
+        slot_count *= 2;
+    }
+
+    index = (struct cJSON_Index*)global_hooks.allocate(sizeof(struct cJSON_Index) + (slot_count * sizeof(cJSON*)));
+    if (index == NULL)
+    {
+        return false;
+    }
+    index->first = object->child;
+    index->last = object->child->prev;
+    index->mask = slot_count - 1;
+    index->slots = (cJSON**)(void*)(index + 1);
+    memset(index->slots, 0, slot_count * sizeof(cJSON*));
+
+    for (member = object->child; member != NULL; member = member->next)
+    {
+        slot = index_hash((const unsigned char*)member->string) & index->mask;
+        while (index->slots[slot] != NULL)
+        {
+            slot = (slot + 1) & index->mask;
+        }
+        index->slots[slot] = member;
+    }
+
+    drop_index(writable);
+    writable->index = index;
+    return true;
+}
+
+static cJSON *index_find(const struct cJSON_Index * const index, const char * const name, const size_t hash, const cJSON_bool case_sensitive)
+{
+    size_t slot = hash & index->mask;
+
+    while (index->slots[slot] != NULL)
     {
-        while ((current_element != NULL) && (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)(current_element->string)) != 0))
+        if (name_matches(index->slots[slot], name, case_sensitive))
         {
-            current_element = current_element->next;
+            return index->slots[slot];
         }
+        slot = (slot + 1) & index->mask;
     }
 
-    if ((current_element == NULL) || (current_element->string == NULL)) {
+    return NULL;
+}
+#endif
+
+/* hash: index_hash(name) if the caller has it already, else NULL */
+static cJSON *get_object_item(const cJSON * const object, const char * const name, const size_t * const hash, const cJSON_bool case_sensitive)
+{
+    cJSON *current_element = NULL;
+#if CJSON_INDEX_THRESHOLD > 0
+    size_t visited = 0;
+#endif
+
+    if ((object == NULL) || (name == NULL))
+    {
         return NULL;
     }
 
-    return current_element;
+#if CJSON_INDEX_THRESHOLD > 0
+    if (index_is_current(object))
+    {
+        return index_find(object->index, name, (hash != NULL) ? *hash : index_hash((const unsigned char*)name), case_sensitive);
+    }
+#else
+    (void)hash;
+#endif
+
+    /* small objects (and the first members of large ones) are searched linearly */
+    current_element = object->child;
+    while (current_element != NULL)
+    {
+        if (case_sensitive && (current_element->string == NULL))
+        {
+            return NULL;
+        }
+        if (name_matches(current_element, name, case_sensitive))
+        {
+            return current_element;
+        }
+        current_element = current_element->next;
+
+#if CJSON_INDEX_THRESHOLD > 0
+        if ((++visited == CJSON_INDEX_THRESHOLD) && (current_element != NULL) && build_index(object))
+        {
+            return index_find(object->index, name, (hash != NULL) ? *hash : index_hash((const unsigned char*)name), case_sensitive);
+        }
+#endif
+    }
+
+    return NULL;
 }
 
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItem(const cJSON * const object, const char * const string)
 {
-    return get_object_item(object, string, false);
+    return get_object_item(object, string, NULL, false);
 }
 
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItemCaseSensitive(const cJSON * const object, const char * const string)
 {
-    return get_object_item(object, string, true);
+    return get_object_item(object, string, NULL, true);
+}
+
+CJSON_PUBLIC(size_t) cJSON_HashName(const char * const string)
+{
+    return (string != NULL) ? index_hash((const unsigned char*)string) : 0;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_GetObjectItemHashed(const cJSON * const object, const char * const string, const size_t hash, const cJSON_bool case_sensitive)
+{
+    return get_object_item(object, string, &hash, case_sensitive);
 }
 
 CJSON_PUBLIC(cJSON_bool) cJSON_HasObjectItem(const cJSON *object, const char *string)
@@ -2014,6 +4028,12 @@ static cJSON *create_reference(const cJSON *item, const internal_hooks * const h
 
     memcpy(reference, item, sizeof(cJSON));
     reference->string = NULL;
+#if CJSON_INDEX_THRESHOLD > 0
+    if (holds_index(reference))
+    {
+        reference->index = NULL;
+    }
+#endif
     reference->type |= cJSON_IsReference;
     reference->next = reference->prev = NULL;
     return reference;
@@ -2028,6 +4048,7 @@ static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
         return false;
     }
 
+    drop_index(array);
     child = array->child;
     /*
      * To find the last item in array quickly, we use prev in array
@@ -2202,6 +4223,42 @@ CJSON_PUBLIC(cJSON*) cJSON_AddNumberToObject(cJSON * const object, const char *
     return NULL;
 }
 
+CJSON_PUBLIC(cJSON*) cJSON_AddFixedNumberToObject(cJSON * const object, const char * const name, const double number, const int decimals)
+{
+    cJSON *number_item = cJSON_CreateNumber(number);
+    if (cJSON_SetNumberDecimals(number_item, decimals) && add_item_to_object(object, name, number_item, &global_hooks, false))
+    {
+        return number_item;
+    }
+
+    cJSON_Delete(number_item);
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON*) cJSON_AddInt64ToObject(cJSON * const object, const char * const name, const cJSON_int64 number)
+{
+    cJSON *number_item = cJSON_CreateInt64(number);
+    if (add_item_to_object(object, name, number_item, &global_hooks, false))
+    {
+        return number_item;
+    }
+
+    cJSON_Delete(number_item);
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON*) cJSON_AddUint64ToObject(cJSON * const object, const char * const name, const cJSON_uint64 number)
+{
+    cJSON *number_item = cJSON_CreateUint64(number);
+    if (add_item_to_object(object, name, number_item, &global_hooks, false))
+    {
+        return number_item;
+    }
+
+    cJSON_Delete(number_item);
+    return NULL;
+}
+
 CJSON_PUBLIC(cJSON*) cJSON_AddStringToObject(cJSON * const object, const char * const name, const char * const string)
 {
     cJSON *string_item = cJSON_CreateString(string);
@@ -2257,6 +4314,8 @@ CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const it
         return NULL;
     }
 
+    drop_index(parent);
+
     if (item != parent->child)
     {
         /* not the first element */
@@ -2341,6 +4400,8 @@ CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON
         return add_item_to_array(array, newitem);
     }
 
+    drop_index(array);
+
     if (after_inserted != array->child && after_inserted->prev == NULL) {
         /* return false if after_inserted is a corrupted array item */
         return false;
@@ -2372,6 +4433,8 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON
         return true;
     }
 
+    drop_index(parent);
+
     replacement->next = item->next;
     replacement->prev = item->prev;
 
@@ -2439,7 +4502,7 @@ static cJSON_bool replace_item_in_object(cJSON *object, const char *string, cJSO
 
     replacement->type &= ~cJSON_StringIsConst;
 
-    return cJSON_ReplaceItemViaPointer(object, get_object_item(object, string, case_sensitive), replacement);
+    return cJSON_ReplaceItemViaPointer(object, get_object_item(object, string, NULL, case_sensitive), replacement);
 }
 
 CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInObject(cJSON *object, const char *string, cJSON *newitem)
@@ -2523,6 +4586,29 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateNumber(double num)
     return item;
 }
 
+CJSON_PUBLIC(cJSON *) cJSON_CreateInt64(cJSON_int64 num)
+{
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if(item)
+    {
+        /* magnitude without negating INT64_MIN */
+        set_number_integer(item, (num < 0) ? (cjson_uint64)0 - (cjson_uint64)num : (cjson_uint64)num, num < 0);
+    }
+
+    return item;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_CreateUint64(cJSON_uint64 num)
+{
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if(item)
+    {
+        set_number_integer(item, num, false);
+    }
+
+    return item;
+}
+
 CJSON_PUBLIC(cJSON *) cJSON_CreateString(const char *string)
 {
     cJSON *item = cJSON_New_Item(&global_hooks);
@@ -2802,8 +4888,14 @@ cJSON * cJSON_Duplicate_rec(const cJSON *item, size_t depth, cJSON_bool recurse)
     /* Copy over all vars */
     newitem->type = item->type & (~cJSON_IsReference);
     newitem->valueint = item->valueint;
-    newitem->valuedouble = item->valuedouble;
-    if (item->valuestring)
+#ifdef CJSON_INT64
+    newitem->valueint64 = item->valueint64;
+#endif
+    if (holds_valuedouble(item))
+    {
+        newitem->valuedouble = item->valuedouble;
+    }
+    if (holds_valuestring(item) && item->valuestring)
     {
         newitem->valuestring = (char*)cJSON_strdup((unsigned char*)item->valuestring, &global_hooks);
         if (!newitem->valuestring)
@@ -3103,6 +5195,13 @@ CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * cons
             return true;
 
         case cJSON_Number:
+#ifdef CJSON_INT64
+            if ((a->type & b->type & cJSON_NumberIsInt64) != 0)
+            {
+                /* both exact: doubles can't tell 64 bit neighbours apart */
+                return (a->valueint64 == b->valueint64) && ((a->type & cJSON_NumberIsUint64) == (b->type & cJSON_NumberIsUint64));
+            }
+#endif
             if (compare_double(a->valuedouble, b->valuedouble))
             {
                 return true;
@@ -3153,7 +5252,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * cons
             cJSON_ArrayForEach(a_element, a)
             {
                 /* TODO This has O(n^2) runtime, which is horrible! */
-                b_element = get_object_item(b, a_element->string, case_sensitive);
+                b_element = get_object_item(b, a_element->string, NULL, case_sensitive);
                 if (b_element == NULL)
                 {
                     return false;
@@ -3169,7 +5268,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * cons
              * TODO: Do this the proper way, this is just a fix for now */
             cJSON_ArrayForEach(b_element, b)
             {
-                a_element = get_object_item(a, b_element->string, case_sensitive);
+                a_element = get_object_item(a, b_element->string, NULL, case_sensitive);
                 if (a_element == NULL)
                 {
                     return false;
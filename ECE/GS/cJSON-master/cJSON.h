@@ -98,6 +98,47 @@ then using the CJSON_API_VISIBILITY flag to "export" the same symbols the way CJ
 
 #define cJSON_IsReference 256
 #define cJSON_StringIsConst 512
+/* Numbers printed with a fixed number of decimals (cJSON_SetNumberDecimals) keep decimals + 1 in these bits;
+ * 0 prints the shortest text that parses back to the same double. */
+#define cJSON_DecimalsShift 10
+#define cJSON_DecimalsMask (15 << cJSON_DecimalsShift)
+/* With CJSON_INT64 defined, integer literals (no fraction, no exponent) that fit 64 bits keep their exact value in
+ * valueint64 as well as valuedouble; cJSON_NumberIsUint64 marks one above INT64_MAX, stored as its unsigned bits.
+ * Read them with cJSON_GetInt64Value / cJSON_GetUint64Value, which fall back to whole doubles up to 2^53 (all
+ * there is without CJSON_INT64, where these flags are never set). */
+#define cJSON_NumberIsInt64 (1 << 14)
+#define cJSON_NumberIsUint64 (1 << 15)
+
+/* 64 bit integers; C89 has no long long, so GCC is told it's intended */
+#if defined(_MSC_VER)
+typedef __int64 cJSON_int64;
+typedef unsigned __int64 cJSON_uint64;
+#elif defined(__GNUC__)
+__extension__ typedef long long cJSON_int64;
+__extension__ typedef unsigned long long cJSON_uint64;
+#else
+typedef long long cJSON_int64;
+typedef unsigned long long cJSON_uint64;
+#endif
+
+/* Objects with more members than this get a hash index on lookup; 0 disables indexing, and then the default
+ * layout has no index member. */
+#ifndef CJSON_INDEX_THRESHOLD
+#ifdef CJSON_COMPACT
+#define CJSON_INDEX_THRESHOLD 32
+#else
+#define CJSON_INDEX_THRESHOLD 0
+#endif
+#endif
+
+/* CJSON_COMPACT, CJSON_INT64 and CJSON_INDEX_THRESHOLD change the layout of cJSON: define them alike for the
+ * library and everything that includes this header. On 64-bit targets a node is 64 bytes by default and 80 with
+ * CJSON_INT64 and indexing. */
+
+/* Compact node layout (define CJSON_COMPACT; an anonymous union, so C11 or GCC/Clang): valuestring, valuedouble
+ * and the object index share one slot, so a node is 48 bytes (56 with CJSON_INT64). Only the member the type
+ * names is valid: read valuestring only for cJSON_String / cJSON_Raw, valuedouble only for cJSON_Number
+ * (cJSON_IsString() etc. first, or cJSON_GetStringValue / cJSON_GetNumberValue, which check). */
 
 /* The cJSON structure: */
 typedef struct cJSON
@@ -111,15 +152,40 @@ typedef struct cJSON
     /* The type of the item, as above. */
     int type;
 
+#ifndef CJSON_COMPACT
     /* The item's string, if type==cJSON_String  and type == cJSON_Raw */
     char *valuestring;
     /* writing to valueint is DEPRECATED, use cJSON_SetNumberValue instead */
     int valueint;
     /* The item's number, if type==cJSON_Number */
     double valuedouble;
+#else
+    int valueint;
+#if defined(__GNUC__)
+    __extension__ /* anonymous union in C89/C99 */
+#endif
+    union
+    {
+        char *valuestring;
+        double valuedouble;
+        struct cJSON_Index *index;
+    };
+#ifdef CJSON_INT64
+    cJSON_int64 valueint64;
+#endif
+#endif
 
     /* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
     char *string;
+
+#if !defined(CJSON_COMPACT) && (CJSON_INDEX_THRESHOLD > 0)
+    /* Internal: member index of a large object, built by the first lookup. Don't touch. */
+    struct cJSON_Index *index;
+#endif
+#if !defined(CJSON_COMPACT) && defined(CJSON_INT64)
+    /* The item's exact integer, if type has cJSON_NumberIsInt64 */
+    cJSON_int64 valueint64;
+#endif
 } cJSON;
 
 typedef struct cJSON_Hooks
@@ -131,6 +197,15 @@ typedef struct cJSON_Hooks
 
 typedef int cJSON_bool;
 
+/* Caller memory that parse trees are carved out of (see cJSON_ParseWithArena). */
+typedef struct cJSON_Arena
+{
+    unsigned char *buffer;
+    size_t size;
+    size_t used;
+    size_t last; /* offset of the newest allocation */
+} cJSON_Arena;
+
 /* Limits how deeply nested arrays/objects can be before cJSON rejects to parse them.
  * This is to prevent stack overflows. */
 #ifndef CJSON_NESTING_LIMIT
@@ -158,6 +233,115 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
 
+/* Arena parsing for short-lived documents: every node and string of the tree comes out of the arena, nothing is malloc'd.
+ * Never cJSON_Delete such a tree or add items to it; cJSON_ResetArena releases all trees parsed into the arena at once.
+ * Returns NULL if the JSON is invalid or the arena is too small; the arena is then left as it was. */
+CJSON_PUBLIC(void) cJSON_InitArena(cJSON_Arena *arena, void *buffer, size_t size);
+CJSON_PUBLIC(void) cJSON_ResetArena(cJSON_Arena *arena);
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithArena(const char *value, size_t buffer_length, cJSON_Arena *arena);
+
+/* In situ parsing for mutable input: strings and names are unescaped and NUL-terminated inside value itself, and
+ * valuestring/string point into it, so no string is allocated. The tree is only valid while value is; such strings
+ * are read-only (flagged cJSON_IsReference / cJSON_StringIsConst) and cJSON_Delete leaves them alone.
+ * value is modified even when parsing fails. The arena variant takes the nodes from an arena as above. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseInSitu(char *value, size_t buffer_length);
+CJSON_PUBLIC(cJSON *) cJSON_ParseInSituWithArena(char *value, size_t buffer_length, cJSON_Arena *arena);
+
+/* Contexts for parsing and printing on several threads at once: each carries its own allocator, arena and error
+ * position and touches no global state, so cJSON_InitHooks and cJSON_GetErrorPtr don't apply to it (the plain API
+ * above is the process-wide default context). A tree parsed through a context is freed with cJSON_DeleteCtx, or
+ * with its arena; text printed through one is freed with its free_fn. One context per thread; member indexes of
+ * large objects (see cJSON_GetObjectItem) still come from the global hooks. */
+typedef struct cJSON_Context
+{
+    cJSON_Hooks hooks;      /* NULL functions: malloc / free */
+    cJSON_Arena *arena;     /* when set, parsed trees come out of it (as cJSON_ParseWithArena) */
+    const char *error;      /* where the last failed cJSON_ParseCtx stopped, NULL after a success */
+} cJSON_Context;
+
+CJSON_PUBLIC(void) cJSON_InitContext(cJSON_Context *ctx, const cJSON_Hooks *hooks, cJSON_Arena *arena);
+CJSON_PUBLIC(cJSON *) cJSON_ParseCtx(cJSON_Context *ctx, const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
+CJSON_PUBLIC(char *) cJSON_PrintCtx(const cJSON_Context *ctx, const cJSON *item, cJSON_bool format);
+CJSON_PUBLIC(void) cJSON_DeleteCtx(const cJSON_Context *ctx, cJSON *item);
+
+/* Push parsing for streams: feed chunks as they arrive with cJSON_PushFeed, then call cJSON_PushNext until it
+ * returns NULL to collect every top-level value completed so far (several documents may share a chunk). Each
+ * byte is scanned once, as it arrives, and a value is parsed as soon as its closing byte is in. A top-level number,
+ * true, false or null only ends at the next delimiter: at end of stream call cJSON_PushFinish instead, which also
+ * returns such a value and fails a document that was cut off.
+ * A document that fails to parse is dropped and failed is set for that call only; keep calling cJSON_PushNext,
+ * later documents are still returned. max_size bounds the bytes held for one document (0 = unlimited);
+ * cJSON_PushFeed returns false past it, or when out of memory, and cJSON_ResetPushParser discards the input. */
+typedef struct cJSON_PushParser
+{
+    char *buffer;
+    size_t size;
+    size_t length;
+    size_t start;
+    size_t scanned;
+    size_t depth;
+    size_t max_size;
+    int state;
+    cJSON_bool failed;
+} cJSON_PushParser;
+
+CJSON_PUBLIC(void) cJSON_InitPushParser(cJSON_PushParser *parser, size_t max_size);
+CJSON_PUBLIC(cJSON_bool) cJSON_PushFeed(cJSON_PushParser *parser, const char *chunk, size_t length);
+CJSON_PUBLIC(cJSON *) cJSON_PushNext(cJSON_PushParser *parser);
+CJSON_PUBLIC(cJSON *) cJSON_PushFinish(cJSON_PushParser *parser);
+CJSON_PUBLIC(void) cJSON_ResetPushParser(cJSON_PushParser *parser);
+CJSON_PUBLIC(void) cJSON_FreePushParser(cJSON_PushParser *parser);
+
+/* Tape (on-demand) parsing for reading a few fields out of a larger document. cJSON_TapeIndex makes one pass that
+ * records the structural characters ({}[],:) outside strings into caller-provided entries, and nothing else;
+ * values are only decoded when an accessor reaches them, and the document is skipped over container by container.
+ * Indexing checks brackets, strings and nesting depth; a value is fully validated only when it is read, so invalid
+ * text inside a part that is never touched goes unnoticed. The tape points into json, keep it alive.
+ * A document has at most one entry per byte. A cJSON_TapeValue whose tape is NULL is "none" (cJSON_Invalid). */
+typedef struct cJSON_TapeEntry
+{
+    size_t offset; /* of the structural character in json */
+    size_t next; /* entry after the matching close for { and [, else the next entry */
+} cJSON_TapeEntry;
+
+typedef struct cJSON_Tape
+{
+    const char *json;
+    size_t length;
+    cJSON_TapeEntry *entries;
+    size_t capacity;
+    size_t count;
+} cJSON_Tape;
+
+typedef struct cJSON_TapeValue
+{
+    const cJSON_Tape *tape;
+    size_t offset; /* first byte of the value */
+    size_t entry; /* first tape entry after that byte */
+    size_t key; /* opening quote of the member name, 0 outside objects */
+} cJSON_TapeValue;
+
+CJSON_PUBLIC(void) cJSON_InitTape(cJSON_Tape *tape, cJSON_TapeEntry *entries, size_t capacity);
+/* Returns false if the structure is broken or there are more than capacity entries. */
+CJSON_PUBLIC(cJSON_bool) cJSON_TapeIndex(cJSON_Tape *tape, const char *json, size_t length);
+CJSON_PUBLIC(cJSON_TapeValue) cJSON_TapeRoot(const cJSON_Tape *tape);
+/* cJSON_Object, cJSON_Array, cJSON_String, cJSON_Number, cJSON_True, cJSON_False, cJSON_NULL or cJSON_Invalid */
+CJSON_PUBLIC(int) cJSON_TapeType(cJSON_TapeValue value);
+/* First element or member of a container and the one after value; none at the end. */
+CJSON_PUBLIC(cJSON_TapeValue) cJSON_TapeChild(cJSON_TapeValue container);
+CJSON_PUBLIC(cJSON_TapeValue) cJSON_TapeNext(cJSON_TapeValue value);
+CJSON_PUBLIC(cJSON_TapeValue) cJSON_TapeGetArrayItem(cJSON_TapeValue array, int index);
+CJSON_PUBLIC(cJSON_TapeValue) cJSON_TapeGetObjectItem(cJSON_TapeValue object, const char *string);
+CJSON_PUBLIC(cJSON_TapeValue) cJSON_TapeGetObjectItemCaseSensitive(cJSON_TapeValue object, const char *string);
+/* NAN if value is not a valid number. */
+CJSON_PUBLIC(double) cJSON_TapeGetNumberValue(cJSON_TapeValue value);
+/* Unescape a string value (or the name of an object member) into buffer, NUL-terminated. size must also fit the
+ * string as written in the JSON; returns false if it doesn't or the string is invalid. */
+CJSON_PUBLIC(cJSON_bool) cJSON_TapeCopyString(cJSON_TapeValue value, char *buffer, size_t size);
+CJSON_PUBLIC(cJSON_bool) cJSON_TapeCopyName(cJSON_TapeValue member, char *buffer, size_t size);
+/* Build a regular cJSON tree of just this value (cJSON_Delete it); NULL if it is invalid. */
+CJSON_PUBLIC(cJSON *) cJSON_TapeMaterialize(cJSON_TapeValue value);
+
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
 /* Render a cJSON entity to text for transfer/storage without any formatting. */
@@ -167,6 +351,30 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 /* Render a cJSON entity to text using a buffer already allocated in memory with given length. Returns 1 on success and 0 on failure. */
 /* NOTE: cJSON is not always 100% accurate in estimating how much memory it will use, so to be safe allocate 5 bytes more than you actually need */
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format);
+
+/* Writer: print into a buffer that is kept across prints, so repeated output (telemetry) stops allocating.
+ * cJSON_InitWriter with a NULL buffer lets cJSON allocate and grow it (free it with cJSON_FreeWriter); with a
+ * buffer it is caller storage of a fixed size and a document that doesn't fit fails.
+ * cJSON_InitStreamWriter hands the text to write() in chunks of up to size bytes instead of keeping the whole
+ * document, e.g. straight into a socket or a queue; a single string longer than a fixed chunk fails.
+ * After cJSON_Write, length is the size of the text: buffered it is NUL-terminated in buffer, streamed it has
+ * all been passed to write(). write() returns false to abort. */
+typedef cJSON_bool (*cJSON_WriteFn)(void *context, const char *data, size_t length);
+typedef struct cJSON_Writer
+{
+    char *buffer;
+    size_t size;
+    size_t length;
+    cJSON_bool fixed;
+    cJSON_WriteFn write;
+    void *context;
+} cJSON_Writer;
+
+CJSON_PUBLIC(void) cJSON_InitWriter(cJSON_Writer *writer, char *buffer, size_t size);
+CJSON_PUBLIC(void) cJSON_InitStreamWriter(cJSON_Writer *writer, char *chunk, size_t size, cJSON_WriteFn write, void *context);
+CJSON_PUBLIC(cJSON_bool) cJSON_Write(cJSON_Writer *writer, const cJSON *item, cJSON_bool format);
+CJSON_PUBLIC(void) cJSON_FreeWriter(cJSON_Writer *writer);
+
 /* Delete a cJSON entity and all subentities. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item);
 
@@ -174,16 +382,31 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item);
 CJSON_PUBLIC(int) cJSON_GetArraySize(const cJSON *array);
 /* Retrieve item number "index" from array "array". Returns NULL if unsuccessful. */
 CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index);
-/* Get item "string" from object. Case insensitive. */
+/* Get item "string" from object. Case insensitive.
+ * An object with more than CJSON_INDEX_THRESHOLD members (if nonzero) gets a hash index on its first lookup, so the
+ * lookup mutates the object: don't look up in one shared object from several threads at once. The add, detach and
+ * replace functions keep it current; code that relinks object->child by hand should only reorder members. */
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItem(const cJSON * const object, const char * const string);
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItemCaseSensitive(const cJSON * const object, const char * const string);
 CJSON_PUBLIC(cJSON_bool) cJSON_HasObjectItem(const cJSON *object, const char *string);
+/* The same lookup with the name's hash (cJSON_HashName, the same for either case) worked out in advance, for names
+ * that are looked up again and again. Only objects with an index use the hash. */
+CJSON_PUBLIC(size_t) cJSON_HashName(const char * const string);
+CJSON_PUBLIC(cJSON *) cJSON_GetObjectItemHashed(const cJSON * const object, const char * const string, const size_t hash, const cJSON_bool case_sensitive);
 /* For analysing failed parses. This returns a pointer to the parse error. You'll probably need to look a few chars back to make sense of it. Defined when cJSON_Parse() returns 0. 0 when cJSON_Parse() succeeds. */
 CJSON_PUBLIC(const char *) cJSON_GetErrorPtr(void);
 
 /* Check item type and return its value */
 CJSON_PUBLIC(char *) cJSON_GetStringValue(const cJSON * const item);
 CJSON_PUBLIC(double) cJSON_GetNumberValue(const cJSON * const item);
+/* Print a number rounded to 0..14 decimals ("12.50" for 2), e.g. telemetry in known units; -1 goes back to the
+ * shortest round-trip text. Values too large to scale exactly print the shortest way regardless. */
+CJSON_PUBLIC(cJSON_bool) cJSON_SetNumberDecimals(cJSON * const item, int decimals);
+CJSON_PUBLIC(int) cJSON_GetNumberDecimals(const cJSON * const item);   /* -1 = shortest */
+/* Exact integer value: false unless the number is an integer in range. Numbers set from a double qualify while
+ * they are whole and no larger than 2^53. */
+CJSON_PUBLIC(cJSON_bool) cJSON_GetInt64Value(const cJSON * const item, cJSON_int64 * const value);
+CJSON_PUBLIC(cJSON_bool) cJSON_GetUint64Value(const cJSON * const item, cJSON_uint64 * const value);
 
 /* These functions check the type of an item */
 CJSON_PUBLIC(cJSON_bool) cJSON_IsInvalid(const cJSON * const item);
@@ -203,6 +426,9 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateTrue(void);
 CJSON_PUBLIC(cJSON *) cJSON_CreateFalse(void);
 CJSON_PUBLIC(cJSON *) cJSON_CreateBool(cJSON_bool boolean);
 CJSON_PUBLIC(cJSON *) cJSON_CreateNumber(double num);
+/* exact 64 bit integers, printed digit for digit (with CJSON_INT64; otherwise the nearest double) */
+CJSON_PUBLIC(cJSON *) cJSON_CreateInt64(cJSON_int64 num);
+CJSON_PUBLIC(cJSON *) cJSON_CreateUint64(cJSON_uint64 num);
 CJSON_PUBLIC(cJSON *) cJSON_CreateString(const char *string);
 /* raw json */
 CJSON_PUBLIC(cJSON *) cJSON_CreateRaw(const char *raw);
@@ -272,14 +498,17 @@ CJSON_PUBLIC(cJSON*) cJSON_AddTrueToObject(cJSON * const object, const char * co
 CJSON_PUBLIC(cJSON*) cJSON_AddFalseToObject(cJSON * const object, const char * const name);
 CJSON_PUBLIC(cJSON*) cJSON_AddBoolToObject(cJSON * const object, const char * const name, const cJSON_bool boolean);
 CJSON_PUBLIC(cJSON*) cJSON_AddNumberToObject(cJSON * const object, const char * const name, const double number);
+CJSON_PUBLIC(cJSON*) cJSON_AddFixedNumberToObject(cJSON * const object, const char * const name, const double number, const int decimals);
+CJSON_PUBLIC(cJSON*) cJSON_AddInt64ToObject(cJSON * const object, const char * const name, const cJSON_int64 number);
+CJSON_PUBLIC(cJSON*) cJSON_AddUint64ToObject(cJSON * const object, const char * const name, const cJSON_uint64 number);
 CJSON_PUBLIC(cJSON*) cJSON_AddStringToObject(cJSON * const object, const char * const name, const char * const string);
 CJSON_PUBLIC(cJSON*) cJSON_AddRawToObject(cJSON * const object, const char * const name, const char * const raw);
 CJSON_PUBLIC(cJSON*) cJSON_AddObjectToObject(cJSON * const object, const char * const name);
 CJSON_PUBLIC(cJSON*) cJSON_AddArrayToObject(cJSON * const object, const char * const name);
 
-/* When assigning an integer value, it needs to be propagated to valuedouble too. */
-#define cJSON_SetIntValue(object, number) ((object) ? (object)->valueint = (object)->valuedouble = (number) : (number))
-/* helper for the cJSON_SetNumberValue macro */
+/* When assigning an integer value, it needs to be propagated to valuedouble too (and any exact 64 bit value dropped). */
+#define cJSON_SetIntValue(object, number) ((object) ? ((object)->type &= ~(cJSON_NumberIsInt64 | cJSON_NumberIsUint64), (object)->valueint = (object)->valuedouble = (number)) : (number))
+/* helper for the cJSON_SetNumberValue macro, which drops any exact 64 bit value too */
 CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number);
 #define cJSON_SetNumberValue(object, number) ((object != NULL) ? cJSON_SetNumberHelper(object, (double)number) : (number))
 /* Change the valuestring of a cJSON_String object, only takes effect when type of object is cJSON_String */
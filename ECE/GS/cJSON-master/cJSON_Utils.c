@@ -115,6 +115,18 @@ static cJSON_bool compare_double(double a, double b)
     return (fabs(a - b) <= maxVal * DBL_EPSILON);
 }
 
+/* numbers differ (exact 64 bit integers by value, a double can't tell their neighbours apart) */
+static cJSON_bool numbers_differ(const cJSON * const a, const cJSON * const b)
+{
+#ifdef CJSON_INT64
+    if ((a->type & b->type & cJSON_NumberIsInt64) != 0)
+    {
+        return (a->valueint64 != b->valueint64) || ((a->type & cJSON_NumberIsUint64) != (b->type & cJSON_NumberIsUint64));
+    }
+#endif
+    return (a->valueint != b->valueint) || !compare_double(a->valuedouble, b->valuedouble);
+}
+
 
 /* Compare the next path element of two JSON pointers, two NULL pointers are considered unequal: */
 static cJSON_bool compare_pointers(const unsigned char *name, const unsigned char *pointer, const cJSON_bool case_sensitive)
@@ -355,6 +367,131 @@ CJSON_PUBLIC(cJSON *) cJSONUtils_GetPointerCaseSensitive(cJSON * const object, c
     return get_item_from_pointer(object, pointer, true);
 }
 
+/* one reference token of a compiled pointer */
+typedef struct pointer_segment
+{
+    const char *name; /* ~0 and ~1 undone; NULL for an invalid escape, which matches no member */
+    size_t hash; /* cJSON_HashName(name) */
+    size_t index; /* array index, if is_index */
+    cJSON_bool is_index;
+} pointer_segment;
+
+struct cJSONUtils_Pointer
+{
+    size_t count;
+    pointer_segment *segments;
+};
+
+CJSON_PUBLIC(cJSONUtils_Pointer *) cJSONUtils_CompilePointer(const char *pointer)
+{
+    cJSONUtils_Pointer *compiled = NULL;
+    const unsigned char *token = (const unsigned char*)pointer;
+    unsigned char *names = NULL;
+    size_t count = 0;
+    size_t i = 0;
+
+    if (pointer == NULL)
+    {
+        return NULL;
+    }
+
+    /* like cJSONUtils_GetPointer, the path ends at the first token that doesn't start with '/' */
+    for (i = 0; pointer[i] == '/'; count++)
+    {
+        i++;
+        while ((pointer[i] != '\0') && (pointer[i] != '/'))
+        {
+            i++;
+        }
+    }
+
+    /* header, segments, then the decoded names (never longer than the pointer) */
+    compiled = (cJSONUtils_Pointer*)cJSON_malloc(sizeof(cJSONUtils_Pointer) + (count * sizeof(pointer_segment)) + i + 1);
+    if (compiled == NULL)
+    {
+        return NULL;
+    }
+    compiled->count = count;
+    compiled->segments = (pointer_segment*)(void*)(compiled + 1);
+    names = (unsigned char*)(compiled->segments + count);
+
+    for (i = 0; i < count; i++)
+    {
+        pointer_segment *segment = &compiled->segments[i];
+        unsigned char *name = names;
+
+        token++; /* '/' */
+        segment->is_index = decode_array_index_from_pointer(token, &segment->index);
+        segment->name = (const char*)name;
+        for (; (*token != '\0') && (*token != '/'); token++)
+        {
+            if (*token == '~')
+            {
+                if ((token[1] != '0') && (token[1] != '1'))
+                {
+                    segment->name = NULL;
+                }
+                else
+                {
+                    token++;
+                    *names++ = (*token == '0') ? '~' : '/';
+                    continue;
+                }
+            }
+            *names++ = *token;
+        }
+        *names++ = '\0';
+        segment->hash = cJSON_HashName(segment->name);
+    }
+
+    return compiled;
+}
+
+static cJSON *get_item_from_compiled_pointer(cJSON * const object, const cJSONUtils_Pointer * const pointer, const cJSON_bool case_sensitive)
+{
+    cJSON *current_element = object;
+    size_t i = 0;
+
+    if (pointer == NULL)
+    {
+        return NULL;
+    }
+
+    for (i = 0; (i < pointer->count) && (current_element != NULL); i++)
+    {
+        const pointer_segment *segment = &pointer->segments[i];
+        if (cJSON_IsArray(current_element))
+        {
+            current_element = segment->is_index ? get_array_item(current_element, segment->index) : NULL;
+        }
+        else if (cJSON_IsObject(current_element) && (segment->name != NULL))
+        {
+            current_element = cJSON_GetObjectItemHashed(current_element, segment->name, segment->hash, case_sensitive);
+        }
+        else
+        {
+            return NULL;
+        }
+    }
+
+    return current_element;
+}
+
+CJSON_PUBLIC(cJSON *) cJSONUtils_GetCompiledPointer(cJSON * const object, const cJSONUtils_Pointer * const pointer)
+{
+    return get_item_from_compiled_pointer(object, pointer, false);
+}
+
+CJSON_PUBLIC(cJSON *) cJSONUtils_GetCompiledPointerCaseSensitive(cJSON * const object, const cJSONUtils_Pointer * const pointer)
+{
+    return get_item_from_compiled_pointer(object, pointer, true);
+}
+
+CJSON_PUBLIC(void) cJSONUtils_FreePointer(cJSONUtils_Pointer * const pointer)
+{
+    cJSON_free(pointer);
+}
+
 /* JSON Patch implementation. */
 static void decode_pointer_inplace(unsigned char *string)
 {
@@ -374,7 +511,7 @@ static void decode_pointer_inplace(unsigned char *string)
             }
             else if (string[1] == '1')
             {
-                decoded_string[1] = '/';
+                decoded_string[0] = '/';
             }
             else
             {
@@ -384,6 +521,10 @@ static void decode_pointer_inplace(unsigned char *string)
 
             string++;
         }
+        else
+        {
+            decoded_string[0] = string[0];
+        }
     }
 
     decoded_string[0] = '\0';
@@ -612,7 +753,7 @@ static cJSON_bool compare_json(cJSON *a, cJSON *b, const cJSON_bool case_sensiti
     {
         case cJSON_Number:
             /* numeric mismatch. */
-            if ((a->valueint != b->valueint) || (!compare_double(a->valuedouble, b->valuedouble)))
+            if (numbers_differ(a, b))
             {
                 return false;
             }
@@ -792,7 +933,7 @@ static void overwrite_item(cJSON * const root, const cJSON replacement)
     {
         cJSON_free(root->string);
     }
-    if (root->valuestring != NULL)
+    if ((cJSON_IsString(root) || cJSON_IsRaw(root)) && (root->valuestring != NULL))
     {
         cJSON_free(root->valuestring);
     }
@@ -800,6 +941,13 @@ static void overwrite_item(cJSON * const root, const cJSON replacement)
     {
         cJSON_Delete(root->child);
     }
+#if CJSON_INDEX_THRESHOLD > 0
+    if (cJSON_IsObject(root) && (root->index != NULL))
+    {
+        /* the member index goes with the members (an object from an arena can't be patched anyway) */
+        cJSON_free(root->index);
+    }
+#endif
 
     memcpy(root, &replacement, sizeof(cJSON));
 }
@@ -840,7 +988,9 @@ static int apply_patch(cJSON *object, const cJSON *patch, const cJSON_bool case_
     {
         if (opcode == REMOVE)
         {
-            static const cJSON invalid = { NULL, NULL, NULL, cJSON_Invalid, NULL, 0, 0, NULL};
+            cJSON invalid;
+            memset(&invalid, 0, sizeof(invalid));
+            invalid.type = cJSON_Invalid;
 
             overwrite_item(object, invalid);
 
@@ -1154,7 +1304,7 @@ static void create_patches(cJSON * const patches, const unsigned char * const pa
     switch (from->type & 0xFF)
     {
         case cJSON_Number:
-            if ((from->valueint != to->valueint) || !compare_double(from->valuedouble, to->valuedouble))
+            if (numbers_differ(from, to))
             {
                 compose_patch(patches, (const unsigned char*)"replace", path, NULL, to);
             }
@@ -1479,3 +1629,339 @@ CJSON_PUBLIC(cJSON *) cJSONUtils_GenerateMergePatchCaseSensitive(cJSON * const f
 {
     return generate_merge_patch(from, to, true);
 }
+
+/* Incremental merge patches. */
+CJSON_PUBLIC(void) cJSONUtils_InitMergeShadow(cJSONUtils_MergeShadow * const shadow)
+{
+    if (shadow == NULL)
+    {
+        return;
+    }
+
+    shadow->sent = NULL;
+    shadow->current = NULL;
+    shadow->dirty = NULL;
+}
+
+CJSON_PUBLIC(void) cJSONUtils_FreeMergeShadow(cJSONUtils_MergeShadow * const shadow)
+{
+    if (shadow == NULL)
+    {
+        return;
+    }
+
+    cJSON_Delete(shadow->sent);
+    cJSON_Delete(shadow->current);
+    cJSON_Delete(shadow->dirty);
+    cJSONUtils_InitMergeShadow(shadow);
+}
+
+/* record that the member at the decoded path (count tokens, NUL separated) has changed */
+static cJSON_bool mark_dirty(cJSONUtils_MergeShadow * const shadow, const unsigned char *token, size_t count)
+{
+    cJSON *node = NULL;
+
+    if (cJSON_IsTrue(shadow->dirty))
+    {
+        /* already diffing the whole state */
+        return true;
+    }
+    if (count == 0)
+    {
+        cJSON_Delete(shadow->dirty);
+        shadow->dirty = cJSON_CreateTrue();
+        return shadow->dirty != NULL;
+    }
+
+    if (shadow->dirty == NULL)
+    {
+        shadow->dirty = cJSON_CreateObject();
+        if (shadow->dirty == NULL)
+        {
+            return false;
+        }
+    }
+
+    for (node = shadow->dirty; count > 0; count--)
+    {
+        cJSON *child = cJSON_GetObjectItemCaseSensitive(node, (const char*)token);
+
+        if (cJSON_IsTrue(child))
+        {
+            /* the whole subtree is diffed anyway */
+            return true;
+        }
+        if (count == 1)
+        {
+            if (child != NULL)
+            {
+                return cJSON_ReplaceItemInObjectCaseSensitive(node, (const char*)token, cJSON_CreateTrue());
+            }
+            return cJSON_AddTrueToObject(node, (const char*)token) != NULL;
+        }
+        if (child == NULL)
+        {
+            child = cJSON_AddObjectToObject(node, (const char*)token);
+            if (child == NULL)
+            {
+                return false;
+            }
+        }
+        node = child;
+        token += strlen((const char*)token) + 1;
+    }
+
+    return true;
+}
+
+/* value NULL removes the member */
+static cJSON_bool shadow_set(cJSONUtils_MergeShadow * const shadow, const char * const pointer, cJSON *value)
+{
+    unsigned char *path = NULL;
+    unsigned char *token = NULL;
+    unsigned char *end = NULL;
+    cJSON *object = NULL;
+    cJSON *existing = NULL;
+    size_t count = 1;
+    cJSON_bool changed = true;
+
+    if ((shadow == NULL) || (pointer == NULL) || ((pointer[0] != '\0') && (pointer[0] != '/')))
+    {
+        cJSON_Delete(value);
+        return false;
+    }
+
+    if (pointer[0] == '\0')
+    {
+        /* the whole state */
+        if ((value != NULL) && (shadow->current != NULL) && cJSON_Compare(shadow->current, value, true))
+        {
+            cJSON_Delete(value);
+            return true;
+        }
+        cJSON_Delete(shadow->current);
+        shadow->current = value;
+        return mark_dirty(shadow, NULL, 0);
+    }
+
+    path = cJSONUtils_strdup((const unsigned char*)pointer + 1);
+    if (path == NULL)
+    {
+        cJSON_Delete(value);
+        return false;
+    }
+
+    if (!cJSON_IsObject(shadow->current))
+    {
+        if (value == NULL)
+        {
+            /* nothing there to remove */
+            cJSON_free(path);
+            return true;
+        }
+        cJSON_Delete(shadow->current);
+        shadow->current = cJSON_CreateObject();
+        if (shadow->current == NULL)
+        {
+            goto fail;
+        }
+    }
+
+    /* walk down to the parent, creating objects on the way like applying the merge patch would */
+    object = shadow->current;
+    for (token = path; (end = (unsigned char*)strchr((const char*)token, '/')) != NULL; token = end + 1)
+    {
+        cJSON *child = NULL;
+
+        end[0] = '\0';
+        decode_pointer_inplace(token);
+        if ((token + strlen((const char*)token)) < end)
+        {
+            /* keep the decoded tokens back to back for mark_dirty */
+            unsigned char *next = token + strlen((const char*)token) + 1;
+            memmove(next, end + 1, strlen((const char*)end + 1) + 1);
+            end = next - 1;
+        }
+        count++;
+
+        child = cJSON_GetObjectItemCaseSensitive(object, (const char*)token);
+        if (!cJSON_IsObject(child))
+        {
+            cJSON *replacement = NULL;
+
+            if (value == NULL)
+            {
+                cJSON_free(path);
+                return true;
+            }
+            replacement = cJSON_CreateObject();
+            if ((replacement == NULL) ||
+                ((child != NULL) ? !cJSON_ReplaceItemInObjectCaseSensitive(object, (const char*)token, replacement) : !cJSON_AddItemToObject(object, (const char*)token, replacement)))
+            {
+                cJSON_Delete(replacement);
+                goto fail;
+            }
+            child = replacement;
+        }
+        object = child;
+    }
+    decode_pointer_inplace(token);
+
+    existing = cJSON_GetObjectItemCaseSensitive(object, (const char*)token);
+    if (value == NULL)
+    {
+        changed = (existing != NULL);
+        cJSON_Delete(cJSON_DetachItemViaPointer(object, existing));
+    }
+    else if (existing == NULL)
+    {
+        if (!cJSON_AddItemToObject(object, (const char*)token, value))
+        {
+            goto fail;
+        }
+    }
+    else if (cJSON_Compare(existing, value, true))
+    {
+        changed = false;
+        cJSON_Delete(value);
+    }
+    else if (!cJSON_ReplaceItemInObjectCaseSensitive(object, (const char*)token, value))
+    {
+        goto fail;
+    }
+
+    if (changed && !mark_dirty(shadow, path, count))
+    {
+        cJSON_free(path);
+        return false;
+    }
+    cJSON_free(path);
+
+    return true;
+
+fail:
+    cJSON_Delete(value);
+    cJSON_free(path);
+
+    return false;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSONUtils_MergeShadowSet(cJSONUtils_MergeShadow * const shadow, const char * const pointer, cJSON * const value)
+{
+    if (value == NULL)
+    {
+        return false;
+    }
+
+    return shadow_set(shadow, pointer, value);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSONUtils_MergeShadowRemove(cJSONUtils_MergeShadow * const shadow, const char * const pointer)
+{
+    return shadow_set(shadow, pointer, NULL);
+}
+
+/* merge patch from from to to without sorting: members are looked up, so objects use their hash index */
+static cJSON *merge_diff(const cJSON * const from, const cJSON * const to)
+{
+    const cJSON *child = NULL;
+    cJSON *patch = NULL;
+
+    if (to == NULL)
+    {
+        return (from != NULL) ? cJSON_CreateNull() : NULL;
+    }
+    if (!cJSON_IsObject(to) || !cJSON_IsObject(from))
+    {
+        return ((from != NULL) && cJSON_Compare(from, to, true)) ? NULL : cJSON_Duplicate(to, true);
+    }
+
+    patch = cJSON_CreateObject();
+    if (patch == NULL)
+    {
+        return NULL;
+    }
+    for (child = to->child; child != NULL; child = child->next)
+    {
+        cJSON *member = merge_diff(cJSON_GetObjectItemCaseSensitive(from, child->string), child);
+        if (member != NULL)
+        {
+            cJSON_AddItemToObject(patch, child->string, member);
+        }
+    }
+    for (child = from->child; child != NULL; child = child->next)
+    {
+        if (cJSON_GetObjectItemCaseSensitive(to, child->string) == NULL)
+        {
+            cJSON_AddNullToObject(patch, child->string);
+        }
+    }
+
+    if (patch->child == NULL)
+    {
+        cJSON_Delete(patch);
+        return NULL;
+    }
+
+    return patch;
+}
+
+/* only visit the members recorded in dirty */
+static cJSON *shadow_diff(const cJSON * const from, const cJSON * const to, const cJSON * const dirty)
+{
+    const cJSON *member = NULL;
+    cJSON *patch = NULL;
+
+    if (!cJSON_IsObject(dirty) || !cJSON_IsObject(from) || !cJSON_IsObject(to))
+    {
+        return merge_diff(from, to);
+    }
+
+    patch = cJSON_CreateObject();
+    if (patch == NULL)
+    {
+        return NULL;
+    }
+    for (member = dirty->child; member != NULL; member = member->next)
+    {
+        cJSON *change = shadow_diff(cJSON_GetObjectItemCaseSensitive(from, member->string), cJSON_GetObjectItemCaseSensitive(to, member->string), member);
+        if (change != NULL)
+        {
+            cJSON_AddItemToObject(patch, member->string, change);
+        }
+    }
+
+    if (patch->child == NULL)
+    {
+        cJSON_Delete(patch);
+        return NULL;
+    }
+
+    return patch;
+}
+
+CJSON_PUBLIC(cJSON *) cJSONUtils_MergeShadowTakePatch(cJSONUtils_MergeShadow * const shadow)
+{
+    cJSON *patch = NULL;
+
+    if ((shadow == NULL) || (shadow->dirty == NULL))
+    {
+        return NULL;
+    }
+
+    patch = shadow_diff(shadow->sent, shadow->current, shadow->dirty);
+    if (patch != NULL)
+    {
+        /* bring sent up to date the way the receiver does */
+        shadow->sent = merge_patch(shadow->sent, patch, true);
+        if (shadow->sent == NULL)
+        {
+            cJSON_Delete(patch);
+            return NULL;
+        }
+    }
+    cJSON_Delete(shadow->dirty);
+    shadow->dirty = NULL;
+
+    return patch;
+}
@@ -33,6 +33,15 @@ extern "C"
 /* Implement RFC6901 (https://tools.ietf.org/html/rfc6901) JSON Pointer spec. */
 CJSON_PUBLIC(cJSON *) cJSONUtils_GetPointer(cJSON * const object, const char *pointer);
 CJSON_PUBLIC(cJSON *) cJSONUtils_GetPointerCaseSensitive(cJSON * const object, const char *pointer);
+/* A pointer decoded once for paths that are looked up again and again: no reparsing, ~0/~1 already undone, array
+ * indices and member name hashes worked out, and objects with a member index (cJSON_GetObjectItem) are searched
+ * through it. Finds the same items as cJSONUtils_GetPointer. NULL on allocation failure; free with
+ * cJSONUtils_FreePointer. */
+typedef struct cJSONUtils_Pointer cJSONUtils_Pointer;
+CJSON_PUBLIC(cJSONUtils_Pointer *) cJSONUtils_CompilePointer(const char *pointer);
+CJSON_PUBLIC(cJSON *) cJSONUtils_GetCompiledPointer(cJSON * const object, const cJSONUtils_Pointer * const pointer);
+CJSON_PUBLIC(cJSON *) cJSONUtils_GetCompiledPointerCaseSensitive(cJSON * const object, const cJSONUtils_Pointer * const pointer);
+CJSON_PUBLIC(void) cJSONUtils_FreePointer(cJSONUtils_Pointer * const pointer);
 
 /* Implement RFC6902 (https://tools.ietf.org/html/rfc6902) JSON Patch spec. */
 /* NOTE: This modifies objects in 'from' and 'to' by sorting the elements by their key */
@@ -74,6 +83,25 @@ CJSON_PUBLIC(cJSON *) cJSONUtils_MergePatchCaseSensitive(cJSON *target, const cJ
 CJSON_PUBLIC(cJSON *) cJSONUtils_GenerateMergePatch(cJSON * const from, cJSON * const to);
 CJSON_PUBLIC(cJSON *) cJSONUtils_GenerateMergePatchCaseSensitive(cJSON * const from, cJSON * const to);
 
+/* Merge patches for a state that changes a few members at a time (telemetry to a UI). The shadow keeps the
+ * current state and the state as of the last patch; set and remove members by JSON pointer (objects only, missing
+ * ones are created), then cJSONUtils_MergeShadowTakePatch returns a merge patch of everything that changed since
+ * (NULL if nothing did) and only diffs the members that were touched. Nothing is sorted or modified in the trees.
+ * Set takes ownership of value, also on failure; a value equal to the current one is not a change. Pointer "" is
+ * the whole state. Names are case sensitive. null inside a value can't be sent by a merge patch (RFC7396). */
+typedef struct cJSONUtils_MergeShadow
+{
+    cJSON *sent;
+    cJSON *current;
+    cJSON *dirty; /* members touched since the last patch, true for a whole subtree */
+} cJSONUtils_MergeShadow;
+
+CJSON_PUBLIC(void) cJSONUtils_InitMergeShadow(cJSONUtils_MergeShadow * const shadow);
+CJSON_PUBLIC(cJSON_bool) cJSONUtils_MergeShadowSet(cJSONUtils_MergeShadow * const shadow, const char * const pointer, cJSON * const value);
+CJSON_PUBLIC(cJSON_bool) cJSONUtils_MergeShadowRemove(cJSONUtils_MergeShadow * const shadow, const char * const pointer);
+CJSON_PUBLIC(cJSON *) cJSONUtils_MergeShadowTakePatch(cJSONUtils_MergeShadow * const shadow);
+CJSON_PUBLIC(void) cJSONUtils_FreeMergeShadow(cJSONUtils_MergeShadow * const shadow);
+
 /* Given a root object and a target object, construct a pointer from one to the other. */
 CJSON_PUBLIC(char *) cJSONUtils_FindPointerFromObjectTo(const cJSON * const object, const cJSON * const target);
 
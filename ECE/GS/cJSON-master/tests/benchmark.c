@@ -0,0 +1,546 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+/* Throughput, not a test: run the "benchmark" target (CMake or make) to compare builds.
+ * Every document (files on the command line, then generated UDS command, report and
+ * telemetry documents) is parsed in each mode (plain, arena, in situ, in situ into an
+ * arena), printed unformatted and preallocated, deleted, and, if it is an object, has
+ * every member looked up. Results go to stdout as a table and, with --json <file>, to a
+ * JSON report; build the same source with CJSON_SIMD=0 or CJSON_COMPACT to compare. */
+
+#include <time.h>
+
+#include "../cJSON.c"
+
+#define BENCHMARK_SECONDS 0.1
+#define BENCHMARK_BATCH 64         /* operations per timed batch, fewer for documents over BENCHMARK_BATCH_BYTES */
+#define BENCHMARK_BATCH_BYTES (1024 * 1024)
+#define TELEMETRY_RECORDS 20000
+#define LARGE_OBJECT_MEMBERS 512
+
+enum { MODE_PLAIN = 0, MODE_ARENA, MODE_INSITU, MODE_INSITU_ARENA, MODE_COUNT };
+static const char *const mode_names[MODE_COUNT] = { "plain", "arena", "insitu", "insitu_arena" };
+
+typedef struct
+{
+    const char *name;
+    const char *json;
+    size_t length;
+    size_t nodes;
+    size_t batch;
+    char *scratch;           /* writable copies for the in situ modes */
+    unsigned char *arena_memory;
+    size_t arena_size;
+} document;
+
+static char *read_file(const char *path, size_t *length)
+{
+    FILE *file = NULL;
+    char *content = NULL;
+    long size = 0;
+
+    file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    if ((fseek(file, 0, SEEK_END) != 0) || ((size = ftell(file)) < 0) || (fseek(file, 0, SEEK_SET) != 0))
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    content = (char*)malloc((size_t)size + 1);
+    if ((content == NULL) || (fread(content, 1, (size_t)size, file) != (size_t)size))
+    {
+        free(content);
+        fclose(file);
+        return NULL;
+    }
+    content[size] = '\0';
+    *length = (size_t)size;
+
+    fclose(file);
+    return content;
+}
+
+static char *telemetry_log(size_t *length)
+{
+    cJSON *log = cJSON_CreateArray();
+    cJSON *record = NULL;
+    cJSON *pose = NULL;
+    char *printed = NULL;
+    int i = 0;
+
+    for (i = 0; i < TELEMETRY_RECORDS; i++)
+    {
+        record = cJSON_CreateObject();
+        cJSON_AddStringToObject(record, "type", "TLM");
+        cJSON_AddNumberToObject(record, "t_ms", (double)i * 20.0);
+        cJSON_AddStringToObject(record, "robot", "robot-1 (drivetrain \"mecanum\")");
+        pose = cJSON_AddObjectToObject(record, "pose");
+        cJSON_AddNumberToObject(pose, "x_mm", (double)(i % 977));
+        cJSON_AddNumberToObject(pose, "y_mm", (double)(i % 613));
+        cJSON_AddNumberToObject(pose, "yaw_mdeg", (double)((i * 37) % 360000));
+        cJSON_AddNumberToObject(record, "battery", 12.25);
+        cJSON_AddStringToObject(record, "note", "heartbeat, all subsystems nominal, no faults latched");
+        cJSON_AddStringToObject(record, "log", "[exec] lane sys=0 motion=1, arm idle, imu ok, odom ok, ble notify queue 0/16, "
+                                "uart rx 0 dropped, telemetry deadband suppressed 3 of 5 reports since the last heartbeat");
+        cJSON_AddItemToArray(log, record);
+    }
+
+    printed = cJSON_Print(log);
+    cJSON_Delete(log);
+    if (printed != NULL)
+    {
+        *length = strlen(printed);
+    }
+    return printed;
+}
+
+/* a settings style object with many members, for the member index */
+static char *large_object(size_t *length)
+{
+    cJSON *object = cJSON_CreateObject();
+    char *printed = NULL;
+    char name[32];
+    int i = 0;
+
+    for (i = 0; i < LARGE_OBJECT_MEMBERS; i++)
+    {
+        sprintf(name, "robot_%03d_battery_mv", i);
+        cJSON_AddNumberToObject(object, name, (double)(11000 + i));
+    }
+
+    printed = cJSON_PrintUnformatted(object);
+    cJSON_Delete(object);
+    if (printed != NULL)
+    {
+        *length = strlen(printed);
+    }
+    return printed;
+}
+
+static size_t count_nodes(const cJSON *item)
+{
+    size_t nodes = 0;
+
+    for (; item != NULL; item = item->next)
+    {
+        nodes += 1 + count_nodes(item->child);
+    }
+    return nodes;
+}
+
+static double elapsed_seconds(clock_t start)
+{
+    return (double)(clock() - start) / (double)CLOCKS_PER_SEC;
+}
+
+static cJSON *parse_in_mode(document *doc, int mode, size_t copy, cJSON_Arena *arena)
+{
+    char *insitu = doc->scratch + (copy * (doc->length + 1));
+
+    switch (mode)
+    {
+        case MODE_ARENA:
+            return cJSON_ParseWithArena(doc->json, doc->length, arena);
+        case MODE_INSITU:
+            memcpy(insitu, doc->json, doc->length);
+            return cJSON_ParseInSitu(insitu, doc->length);
+        case MODE_INSITU_ARENA:
+            memcpy(insitu, doc->json, doc->length);
+            return cJSON_ParseInSituWithArena(insitu, doc->length, arena);
+        default:
+            return cJSON_ParseWithLength(doc->json, doc->length);
+    }
+}
+
+/* seconds per parse in mode, 0 if the document doesn't parse that way; trees are deleted outside the clock */
+static double time_parse(document *doc, int mode)
+{
+    cJSON *roots[BENCHMARK_BATCH];
+    cJSON_Arena arena;
+    double seconds = 0;
+    unsigned long parses = 0;
+    clock_t start = 0;
+    size_t i = 0;
+    int uses_arena = (mode == MODE_ARENA) || (mode == MODE_INSITU_ARENA);
+
+    cJSON_InitArena(&arena, doc->arena_memory, doc->arena_size);
+    do
+    {
+        cJSON_ResetArena(&arena);
+        start = clock();
+        for (i = 0; i < doc->batch; i++)
+        {
+            /* one tree at a time fits the arena; with it, every parse reuses the same memory */
+            if (uses_arena)
+            {
+                cJSON_ResetArena(&arena);
+            }
+            roots[i] = parse_in_mode(doc, mode, i, &arena);
+        }
+        seconds += elapsed_seconds(start);
+        for (i = 0; i < doc->batch; i++)
+        {
+            if (roots[i] == NULL)
+            {
+                return 0;
+            }
+            if (!uses_arena)
+            {
+                cJSON_Delete(roots[i]);
+            }
+        }
+        parses += (unsigned long)doc->batch;
+    } while (seconds < BENCHMARK_SECONDS);
+
+    return seconds / (double)parses;
+}
+
+/* seconds per delete of a parsed tree */
+static double time_delete(const document *doc)
+{
+    cJSON *roots[BENCHMARK_BATCH];
+    double seconds = 0;
+    unsigned long deletes = 0;
+    clock_t start = 0;
+    size_t i = 0;
+
+    do
+    {
+        for (i = 0; i < doc->batch; i++)
+        {
+            roots[i] = cJSON_ParseWithLength(doc->json, doc->length);
+        }
+        start = clock();
+        for (i = 0; i < doc->batch; i++)
+        {
+            cJSON_Delete(roots[i]);
+        }
+        seconds += elapsed_seconds(start);
+        deletes += (unsigned long)doc->batch;
+    } while (seconds < BENCHMARK_SECONDS);
+
+    return seconds / (double)deletes;
+}
+
+/* seconds per print; preallocated prints into buffer, else into malloc'd text; *printed = its length */
+static double time_print(cJSON *root, size_t batch, char *buffer, int size, size_t *printed)
+{
+    double seconds = 0;
+    unsigned long prints = 0;
+    clock_t start = clock();
+    char *text = NULL;
+    size_t i = 0;
+
+    do
+    {
+        for (i = 0; i < batch; i++)
+        {
+            if (buffer != NULL)
+            {
+                if (!cJSON_PrintPreallocated(root, buffer, size, false))
+                {
+                    return 0;
+                }
+            }
+            else
+            {
+                text = cJSON_PrintUnformatted(root);
+                if (text == NULL)
+                {
+                    return 0;
+                }
+                *printed = strlen(text);
+                cJSON_free(text);
+            }
+        }
+        prints += (unsigned long)batch;
+        seconds = elapsed_seconds(start);
+    } while (seconds < BENCHMARK_SECONDS);
+
+    return seconds / (double)prints;
+}
+
+/* seconds per member lookup, every member of an object by name in turn; 0 for anything else */
+static double time_lookup(const cJSON *root)
+{
+    const cJSON *member = NULL;
+    double seconds = 0;
+    unsigned long lookups = 0;
+    clock_t start = clock();
+
+    if (!cJSON_IsObject(root) || (root->child == NULL))
+    {
+        return 0;
+    }
+
+    do
+    {
+        for (member = root->child; member != NULL; member = member->next)
+        {
+            if (cJSON_GetObjectItemCaseSensitive(root, member->string) == NULL)
+            {
+                return 0;
+            }
+            lookups++;
+        }
+        seconds = elapsed_seconds(start);
+    } while (seconds < BENCHMARK_SECONDS);
+
+    return seconds / (double)lookups;
+}
+
+static double mb_per_s(size_t bytes, double seconds)
+{
+    return (seconds > 0) ? ((double)bytes / (seconds * 1e6)) : 0;
+}
+
+static double ns_per(size_t count, double seconds)
+{
+    return (count > 0) ? ((seconds * 1e9) / (double)count) : 0;
+}
+
+static void benchmark(document *doc, cJSON *results)
+{
+    cJSON *root = NULL;
+    cJSON *result = NULL;
+    cJSON *parse = NULL;
+    cJSON *mode_result = NULL;
+    char *buffer = NULL;
+    size_t printed = 0;
+    double seconds = 0;
+    int mode = 0;
+
+    root = cJSON_ParseWithLength(doc->json, doc->length);
+    if (root == NULL)
+    {
+        printf("%-32s  (does not parse)\n", doc->name);
+        return;
+    }
+    doc->nodes = count_nodes(root);
+    doc->batch = BENCHMARK_BATCH_BYTES / (doc->length + 1);
+    doc->batch = (doc->batch < 1) ? 1 : ((doc->batch > BENCHMARK_BATCH) ? BENCHMARK_BATCH : doc->batch);
+    doc->scratch = (char*)malloc(doc->batch * (doc->length + 1));
+    doc->arena_size = (doc->length / 2 + 2) * sizeof(cJSON) + 2 * doc->length + 256;
+    doc->arena_memory = (unsigned char*)malloc(doc->arena_size);
+    if ((doc->scratch == NULL) || (doc->arena_memory == NULL))
+    {
+        goto end;
+    }
+
+    result = cJSON_CreateObject();
+    cJSON_AddStringToObject(result, "document", doc->name);
+    cJSON_AddNumberToObject(result, "bytes", (double)doc->length);
+    cJSON_AddNumberToObject(result, "nodes", (double)doc->nodes);
+    parse = cJSON_AddObjectToObject(result, "parse");
+    printf("%-32s %9lu B %7lu nodes\n", doc->name, (unsigned long)doc->length, (unsigned long)doc->nodes);
+
+    for (mode = 0; mode < MODE_COUNT; mode++)
+    {
+        seconds = time_parse(doc, mode);
+        if (seconds == 0)
+        {
+            continue; /* e.g. not a complete document on its own for in situ parsing */
+        }
+        mode_result = cJSON_AddObjectToObject(parse, mode_names[mode]);
+        cJSON_AddFixedNumberToObject(mode_result, "mb_per_s", mb_per_s(doc->length, seconds), 1);
+        cJSON_AddFixedNumberToObject(mode_result, "ns_per_node", ns_per(doc->nodes, seconds), 1);
+        printf("    parse %-14s %9.1f MB/s %8.1f ns/node\n", mode_names[mode], mb_per_s(doc->length, seconds), ns_per(doc->nodes, seconds));
+    }
+
+    seconds = time_print(root, doc->batch, NULL, 0, &printed);
+    mode_result = cJSON_AddObjectToObject(result, "print_unformatted");
+    cJSON_AddFixedNumberToObject(mode_result, "mb_per_s", mb_per_s(printed, seconds), 1);
+    cJSON_AddFixedNumberToObject(mode_result, "ns_per_node", ns_per(doc->nodes, seconds), 1);
+    printf("    print unformatted      %9.1f MB/s %8.1f ns/node\n", mb_per_s(printed, seconds), ns_per(doc->nodes, seconds));
+
+    /* cJSON_PrintPreallocated wants 5 bytes more than the text */
+    buffer = (char*)malloc(printed + 5);
+    if (buffer != NULL)
+    {
+        seconds = time_print(root, doc->batch, buffer, (int)(printed + 5), &printed);
+        mode_result = cJSON_AddObjectToObject(result, "print_preallocated");
+        cJSON_AddFixedNumberToObject(mode_result, "mb_per_s", mb_per_s(printed, seconds), 1);
+        cJSON_AddFixedNumberToObject(mode_result, "ns_per_node", ns_per(doc->nodes, seconds), 1);
+        printf("    print preallocated     %9.1f MB/s %8.1f ns/node\n", mb_per_s(printed, seconds), ns_per(doc->nodes, seconds));
+        free(buffer);
+    }
+
+    seconds = time_delete(doc);
+    mode_result = cJSON_AddObjectToObject(result, "delete");
+    cJSON_AddFixedNumberToObject(mode_result, "ns_per_node", ns_per(doc->nodes, seconds), 1);
+    printf("    delete                 %24.1f ns/node\n", ns_per(doc->nodes, seconds));
+
+    seconds = time_lookup(root);
+    if (seconds > 0)
+    {
+        mode_result = cJSON_AddObjectToObject(result, "lookup");
+        cJSON_AddFixedNumberToObject(mode_result, "ns_per_member", seconds * 1e9, 1);
+        printf("    lookup every member    %24.1f ns/member\n", seconds * 1e9);
+    }
+
+    cJSON_AddItemToArray(results, result);
+
+end:
+    cJSON_Delete(root);
+    free(doc->scratch);
+    free(doc->arena_memory);
+}
+
+static cJSON_bool write_report(const char *path, const cJSON *report)
+{
+    FILE *file = NULL;
+    char *text = cJSON_Print(report);
+    cJSON_bool written = false;
+
+    if (text == NULL)
+    {
+        return false;
+    }
+    file = fopen(path, "wb");
+    if (file != NULL)
+    {
+        written = (fputs(text, file) >= 0) && (fputc('\n', file) != EOF);
+        written = (fclose(file) == 0) && written;
+    }
+    cJSON_free(text);
+    return written;
+}
+
+int CJSON_CDECL main(int argc, char **argv)
+{
+    /* the UDS traffic: commands from Node, reports back to it */
+    static const char *const uds_documents[][2] =
+    {
+        { "uds command (CONTROL)", "{\"T\":\"C\",\"F\":1,\"B\":0,\"L\":0,\"R\":0,\"S\":50,\"PL\":1,\"ID\":9}" },
+        { "uds command (SYSTEM)", "{\"T\":\"S\",\"instruction\":12,\"Authorization_Code\":1023,\"PL\":1,\"ID\":7,\"instruction_specific\":0}" },
+        { "uds report (POSE)", "{\"type\":\"POSE\",\"yaw\":183250,\"pitch\":-1250,\"roll\":310}" },
+        { "uds report (INERT)", "{\"type\":\"INERT\",\"ax\":-3,\"ay\":12,\"az\":98,\"gx\":0,\"gy\":-1,\"gz\":4}" },
+        { "uds report (HR)", "{\"type\":\"HR\",\"unchanged\":0,\"battery\":87,\"security\":1,\"motor_enabled\":1,\"arm_enabled\":0,"
+                             "\"tx_queue\":2,\"tx_drops\":0,\"stack_task\":3,\"stack_free\":1184}" }
+    };
+    cJSON *report = cJSON_CreateObject();
+    cJSON *results = NULL;
+    const char *json_path = NULL;
+    const char *label = NULL;
+    document doc;
+    char *json = NULL;
+    size_t length = 0;
+    size_t d = 0;
+    int i = 0;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--json") == 0) && ((i + 1) < argc))
+        {
+            json_path = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--label") == 0) && ((i + 1) < argc))
+        {
+            label = argv[++i];
+        }
+    }
+
+#ifdef CJSON_COMPACT
+    cJSON_AddTrueToObject(report, "compact");
+#else
+    cJSON_AddFalseToObject(report, "compact");
+#endif
+    cJSON_AddBoolToObject(report, "simd", CJSON_SIMD);
+    cJSON_AddStringToObject(report, "label", (label != NULL) ? label : "");
+    cJSON_AddNumberToObject(report, "node_bytes", (double)sizeof(cJSON));
+    results = cJSON_AddArrayToObject(report, "results");
+
+    printf("cJSON benchmark, %s scanning, %lu byte nodes%s%s\n", CJSON_SIMD ? "SIMD" : "scalar",
+           (unsigned long)sizeof(cJSON), (label != NULL) ? ", " : "", (label != NULL) ? label : "");
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--json") == 0) || (strcmp(argv[i], "--label") == 0))
+        {
+            i++;
+            continue;
+        }
+        json = read_file(argv[i], &length);
+        if (json == NULL)
+        {
+            printf("%-32s  (cannot read)\n", argv[i]);
+            continue;
+        }
+        memset(&doc, 0, sizeof(doc));
+        doc.name = argv[i];
+        doc.json = json;
+        doc.length = length;
+        /* fuzzing inputs start with two afl option bytes (see fuzzing/afl.c) */
+        if ((strstr(argv[i], "fuzzing") != NULL) && (length > 2))
+        {
+            doc.json += 2;
+            doc.length -= 2;
+        }
+        benchmark(&doc, results);
+        free(json);
+    }
+
+    for (d = 0; d < (sizeof(uds_documents) / sizeof(uds_documents[0])); d++)
+    {
+        memset(&doc, 0, sizeof(doc));
+        doc.name = uds_documents[d][0];
+        doc.json = uds_documents[d][1];
+        doc.length = strlen(doc.json);
+        benchmark(&doc, results);
+    }
+
+    memset(&doc, 0, sizeof(doc));
+    json = large_object(&length);
+    doc.name = "large object (generated)";
+    doc.json = json;
+    doc.length = length;
+    if (json != NULL)
+    {
+        benchmark(&doc, results);
+    }
+    cJSON_free(json);
+
+    memset(&doc, 0, sizeof(doc));
+    json = telemetry_log(&length);
+    doc.name = "telemetry log (generated)";
+    doc.json = json;
+    doc.length = length;
+    if (json != NULL)
+    {
+        benchmark(&doc, results);
+    }
+    cJSON_free(json);
+
+    if ((json_path != NULL) && !write_report(json_path, report))
+    {
+        printf("cannot write %s\n", json_path);
+        cJSON_Delete(report);
+        return 1;
+    }
+    cJSON_Delete(report);
+
+    return 0;
+}
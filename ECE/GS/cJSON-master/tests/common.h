@@ -31,7 +31,7 @@ void reset(cJSON *item) {
     {
         cJSON_Delete(item->child);
     }
-    if ((item->valuestring != NULL) && !(item->type & cJSON_IsReference))
+    if (holds_valuestring(item) && (item->valuestring != NULL) && !(item->type & cJSON_IsReference))
     {
         global_hooks.deallocate(item->valuestring);
     }
@@ -104,7 +104,8 @@ cleanup:
 #define assert_has_no_reference(item) TEST_ASSERT_BITS_MESSAGE(cJSON_IsReference, 0, item->type, "Item should not have a string as reference.")
 #define assert_has_no_const_string(item) TEST_ASSERT_BITS_MESSAGE(cJSON_StringIsConst, 0, item->type, "Item should not have a const string.")
 #define assert_has_valuestring(item) TEST_ASSERT_NOT_NULL_MESSAGE(item->valuestring, "Valuestring is NULL.")
-#define assert_has_no_valuestring(item) TEST_ASSERT_NULL_MESSAGE(item->valuestring, "Valuestring is not NULL.")
+/* under CJSON_COMPACT only strings have a valuestring to check */
+#define assert_has_no_valuestring(item) TEST_ASSERT_MESSAGE(!holds_valuestring(item) || (item->valuestring == NULL), "Valuestring is not NULL.")
 #define assert_has_string(item) TEST_ASSERT_NOT_NULL_MESSAGE(item->string, "String is NULL")
 #define assert_has_no_string(item) TEST_ASSERT_NULL_MESSAGE(item->string, "String is not NULL.")
 #define assert_not_in_list(item) \
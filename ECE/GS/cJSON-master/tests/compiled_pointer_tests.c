@@ -0,0 +1,118 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity/examples/unity_config.h"
+#include "unity/src/unity.h"
+#include "common.h"
+#include "../cJSON_Utils.h"
+#include "../cJSON_Utils.h"
+
+static const char document[] =
+    "{\"robots\":[{\"name\":\"r0\",\"pose\":{\"yaw\":1}},{\"name\":\"r1\",\"pose\":{\"yaw\":2}}],"
+    "\"a/b\":{\"m~n\":3},\"\":4,\"Mode\":\"auto\",\"7\":{\"x\":5}}";
+
+static const char * const pointers[] =
+{
+    "", "/robots", "/robots/0", "/robots/1/pose/yaw", "/robots/2", "/robots/01", "/robots/x", "/robots/-",
+    "/a~1b", "/a~1b/m~0n", "/a~2b", "/", "/mode", "/Mode/x", "/7/x", "/missing/x", "no slash", "/robots/1/name"
+};
+
+static void assert_same_as_get_pointer(cJSON *root)
+{
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(pointers) / sizeof(pointers[0]); i++)
+    {
+        cJSONUtils_Pointer *compiled = cJSONUtils_CompilePointer(pointers[i]);
+        TEST_ASSERT_NOT_NULL(compiled);
+        TEST_ASSERT_TRUE_MESSAGE(cJSONUtils_GetPointer(root, pointers[i]) == cJSONUtils_GetCompiledPointer(root, compiled), pointers[i]);
+        TEST_ASSERT_TRUE_MESSAGE(cJSONUtils_GetPointerCaseSensitive(root, pointers[i]) == cJSONUtils_GetCompiledPointerCaseSensitive(root, compiled), pointers[i]);
+        cJSONUtils_FreePointer(compiled);
+    }
+}
+
+static void compiled_pointer_should_find_what_get_pointer_finds(void)
+{
+    cJSON *root = cJSON_Parse(document);
+    cJSONUtils_Pointer *compiled = NULL;
+
+    TEST_ASSERT_NOT_NULL(root);
+    assert_same_as_get_pointer(root);
+
+    compiled = cJSONUtils_CompilePointer("/a~1b/m~0n");
+    TEST_ASSERT_EQUAL_DOUBLE(3, cJSON_GetNumberValue(cJSONUtils_GetCompiledPointer(root, compiled)));
+    cJSONUtils_FreePointer(compiled);
+    compiled = cJSONUtils_CompilePointer("/mode");
+    TEST_ASSERT_EQUAL_STRING("auto", cJSON_GetStringValue(cJSONUtils_GetCompiledPointer(root, compiled)));
+    TEST_ASSERT_NULL(cJSONUtils_GetCompiledPointerCaseSensitive(root, compiled));
+    cJSONUtils_FreePointer(compiled);
+
+    TEST_ASSERT_NULL(cJSONUtils_CompilePointer(NULL));
+    TEST_ASSERT_NULL(cJSONUtils_GetCompiledPointer(root, NULL));
+    cJSONUtils_FreePointer(NULL);
+    cJSON_Delete(root);
+}
+
+static void compiled_pointer_should_use_the_member_index(void)
+{
+    cJSON *root = cJSON_Parse(document);
+    cJSON *robots = NULL;
+    cJSONUtils_Pointer *compiled = cJSONUtils_CompilePointer("/Robot47/name");
+    char name[32];
+    int i = 0;
+
+    TEST_ASSERT_NOT_NULL(root);
+    TEST_ASSERT_NOT_NULL(compiled);
+    for (i = 0; i < 64; i++)
+    {
+        sprintf(name, "robot%d", i);
+        robots = cJSON_AddObjectToObject(root, name);
+        TEST_ASSERT_NOT_NULL(robots);
+        TEST_ASSERT_NOT_NULL(cJSON_AddStringToObject(robots, "name", name));
+    }
+
+    /* the first lookup indexes the object, later ones go through the index */
+    TEST_ASSERT_EQUAL_STRING("robot47", cJSON_GetStringValue(cJSONUtils_GetCompiledPointer(root, compiled)));
+#if CJSON_INDEX_THRESHOLD > 0
+    TEST_ASSERT_TRUE(index_is_current(root));
+#endif
+    TEST_ASSERT_EQUAL_STRING("robot47", cJSON_GetStringValue(cJSONUtils_GetCompiledPointer(root, compiled)));
+    TEST_ASSERT_NULL(cJSONUtils_GetCompiledPointerCaseSensitive(root, compiled));
+    assert_same_as_get_pointer(root);
+
+    cJSONUtils_FreePointer(compiled);
+    cJSON_Delete(root);
+}
+
+int CJSON_CDECL main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(compiled_pointer_should_find_what_get_pointer_finds);
+    RUN_TEST(compiled_pointer_should_use_the_member_index);
+
+    return UNITY_END();
+}
@@ -0,0 +1,175 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity/examples/unity_config.h"
+#include "unity/src/unity.h"
+#include "common.h"
+#include "../cJSON_Utils.h"
+
+
+static cJSONUtils_MergeShadow shadow;
+
+static void assert_patch(const char *expected)
+{
+    cJSON *patch = cJSONUtils_MergeShadowTakePatch(&shadow);
+    char *printed = NULL;
+
+    if (expected == NULL)
+    {
+        TEST_ASSERT_NULL(patch);
+        return;
+    }
+    TEST_ASSERT_NOT_NULL(patch);
+    printed = cJSON_PrintUnformatted(patch);
+    TEST_ASSERT_EQUAL_STRING(expected, printed);
+    cJSON_free(printed);
+    cJSON_Delete(patch);
+}
+
+static void merge_shadow_should_send_only_what_changed(void)
+{
+    cJSONUtils_InitMergeShadow(&shadow);
+    TEST_ASSERT_NULL(cJSONUtils_MergeShadowTakePatch(&shadow));
+
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "/pose/yaw", cJSON_CreateNumber(1)));
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "/pose/roll", cJSON_CreateNumber(0)));
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "/battery", cJSON_CreateNumber(90)));
+    assert_patch("{\"pose\":{\"yaw\":1,\"roll\":0},\"battery\":90}");
+    assert_patch(NULL);
+
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "/pose/yaw", cJSON_CreateNumber(2)));
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "/battery", cJSON_CreateNumber(90)));
+    assert_patch("{\"pose\":{\"yaw\":2}}");
+
+    /* changed and changed back before the next patch */
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "/battery", cJSON_CreateNumber(80)));
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "/battery", cJSON_CreateNumber(90)));
+    assert_patch(NULL);
+
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowRemove(&shadow, "/pose/roll"));
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowRemove(&shadow, "/pose/missing"));
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowRemove(&shadow, "/nothing/here"));
+    assert_patch("{\"pose\":{\"roll\":null}}");
+
+    /* member order is left alone */
+    TEST_ASSERT_EQUAL_STRING("pose", shadow.current->child->string);
+
+    cJSONUtils_FreeMergeShadow(&shadow);
+}
+
+static void merge_shadow_should_replace_whole_values(void)
+{
+    cJSONUtils_InitMergeShadow(&shadow);
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "", cJSON_Parse("{\"a\":{\"b\":1,\"c\":2},\"d\":[1]}")));
+    assert_patch("{\"a\":{\"b\":1,\"c\":2},\"d\":[1]}");
+
+    /* a subtree set at once is diffed against what was sent */
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "/a", cJSON_Parse("{\"b\":1,\"e\":3}")));
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "/d", cJSON_Parse("[1,2]")));
+    assert_patch("{\"a\":{\"e\":3,\"c\":null},\"d\":[1,2]}");
+
+    /* a scalar in the way becomes an object */
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "/d/x", cJSON_CreateTrue()));
+    assert_patch("{\"d\":{\"x\":true}}");
+
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "", cJSON_Parse("{\"a\":{\"b\":1,\"e\":3},\"d\":{\"x\":true}}")));
+    assert_patch(NULL);
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "", cJSON_CreateString("flat")));
+    assert_patch("\"flat\"");
+
+    cJSONUtils_FreeMergeShadow(&shadow);
+}
+
+static void merge_shadow_patches_should_rebuild_the_state(void)
+{
+    static const char *const names[] = { "/a", "/b/c", "/b/d", "/e~1f/g~0h", "/b" };
+    cJSON *client = NULL;
+    int step = 0;
+
+    cJSONUtils_InitMergeShadow(&shadow);
+    for (step = 0; step < 60; step++)
+    {
+        const char *name = names[(step * 7) % 5];
+        cJSON *patch = NULL;
+
+        if ((step % 4) == 3)
+        {
+            TEST_ASSERT_TRUE(cJSONUtils_MergeShadowRemove(&shadow, name));
+        }
+        else
+        {
+            TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, name, cJSON_CreateNumber(step % 3)));
+        }
+
+        if ((step % 3) == 0)
+        {
+            patch = cJSONUtils_MergeShadowTakePatch(&shadow);
+            if (patch != NULL)
+            {
+                client = cJSONUtils_MergePatchCaseSensitive(client, patch);
+                cJSON_Delete(patch);
+            }
+            TEST_ASSERT_TRUE(cJSON_Compare(client, shadow.current, true) || ((client == NULL) && (shadow.current->child == NULL)));
+        }
+    }
+    /* the last step removed "g~h" again */
+    TEST_ASSERT_TRUE(cJSON_IsObject(cJSON_GetObjectItemCaseSensitive(shadow.current, "e/f")));
+    cJSON_Delete(cJSONUtils_MergeShadowTakePatch(&shadow));
+    TEST_ASSERT_TRUE(cJSONUtils_MergeShadowSet(&shadow, "/e~1f/g~0h", cJSON_CreateNull()));
+    assert_patch("{\"e/f\":{\"g~h\":null}}");
+
+    cJSON_Delete(client);
+    cJSONUtils_FreeMergeShadow(&shadow);
+}
+
+static void merge_shadow_should_reject_invalid_arguments(void)
+{
+    cJSONUtils_InitMergeShadow(&shadow);
+
+    TEST_ASSERT_FALSE(cJSONUtils_MergeShadowSet(&shadow, "a", cJSON_CreateNumber(1)));
+    TEST_ASSERT_FALSE(cJSONUtils_MergeShadowSet(&shadow, NULL, cJSON_CreateNumber(1)));
+    TEST_ASSERT_FALSE(cJSONUtils_MergeShadowSet(NULL, "/a", cJSON_CreateNumber(1)));
+    TEST_ASSERT_FALSE(cJSONUtils_MergeShadowSet(&shadow, "/a", NULL));
+    TEST_ASSERT_FALSE(cJSONUtils_MergeShadowRemove(NULL, "/a"));
+    TEST_ASSERT_NULL(cJSONUtils_MergeShadowTakePatch(NULL));
+    TEST_ASSERT_NULL(cJSONUtils_MergeShadowTakePatch(&shadow));
+    cJSONUtils_InitMergeShadow(NULL);
+    cJSONUtils_FreeMergeShadow(NULL);
+
+    cJSONUtils_FreeMergeShadow(&shadow);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(merge_shadow_should_send_only_what_changed);
+    RUN_TEST(merge_shadow_should_replace_whole_values);
+    RUN_TEST(merge_shadow_patches_should_rebuild_the_state);
+    RUN_TEST(merge_shadow_should_reject_invalid_arguments);
+
+    return UNITY_END();
+}
@@ -238,7 +238,9 @@ static void cjson_should_not_follow_too_deep_circular_references(void)
 
 static void cjson_set_number_value_should_set_numbers(void)
 {
-    cJSON number[1] = {{NULL, NULL, NULL, cJSON_Number, NULL, 0, 0, NULL}};
+    cJSON number[1];
+    memset(number, 0, sizeof(number));
+    number->type = cJSON_Number;
 
     cJSON_SetNumberValue(number, 1.5);
     TEST_ASSERT_EQUAL(1, number->valueint);
@@ -263,6 +265,7 @@ static void cjson_detach_item_via_pointer_should_detach_items(void)
     cJSON parent[1];
 
     memset(list, '\0', sizeof(list));
+    memset(parent, '\0', sizeof(parent));
 
     /* link the list */
     list[0].next = &(list[1]);
@@ -303,6 +306,7 @@ static void cjson_detach_item_via_pointer_should_return_null_if_item_prev_is_nul
     cJSON parent[1];
 
     memset(list, '\0', sizeof(list));
+    memset(parent, '\0', sizeof(parent));
 
     /* link the list */
     list[0].next = &(list[1]);
@@ -360,11 +364,13 @@ static void cjson_replace_item_via_pointer_should_replace_items(void)
 
 static void cjson_replace_item_in_object_should_preserve_name(void)
 {
-    cJSON root[1] = {{NULL, NULL, NULL, 0, NULL, 0, 0, NULL}};
+    cJSON root[1];
     cJSON *child = NULL;
     cJSON *replacement = NULL;
     cJSON_bool flag = false;
 
+    memset(root, 0, sizeof(root));
+
     child = cJSON_CreateNumber(1);
     TEST_ASSERT_NOT_NULL(child);
     replacement = cJSON_CreateNumber(2);
@@ -515,17 +521,45 @@ static void *CJSON_CDECL failing_realloc(void *pointer, size_t size)
 
 static void ensure_should_fail_on_failed_realloc(void)
 {
-    printbuffer buffer = {NULL, 10, 0, 0, false, false, {&malloc, &free, &failing_realloc}};
+    printbuffer buffer = {NULL, 10, 0, 0, false, false, {&malloc, &free, &failing_realloc, NULL}, NULL, NULL, 0};
     buffer.buffer = (unsigned char *)malloc(100);
     TEST_ASSERT_NOT_NULL(buffer.buffer);
 
     TEST_ASSERT_NULL_MESSAGE(ensure(&buffer, 200), "Ensure didn't fail with failing realloc.");
 }
 
+static void skip_whitespace_should_stop_at_the_first_token(void)
+{
+    unsigned char string[64];
+    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0, 0}, NULL};
+    size_t run = 0;
+
+    buffer.hooks = global_hooks;
+    for (run = 0; run < 48; run++)
+    {
+        /* all bytes <= 32 count as whitespace, bytes >= 128 do not */
+        memset(string, '\t', sizeof(string));
+        memset(string, ' ', run / 2);
+        string[run] = (unsigned char)((run % 2) ? 0xC3 : '{');
+        buffer.content = string;
+        buffer.length = sizeof(string);
+        buffer.offset = 0;
+
+        TEST_ASSERT_TRUE(buffer_skip_whitespace(&buffer) == &buffer);
+        TEST_ASSERT_EQUAL_UINT((unsigned int)run, (unsigned int)buffer.offset);
+    }
+
+    /* only whitespace: stops on the last byte */
+    memset(string, ' ', sizeof(string));
+    buffer.offset = 0;
+    buffer_skip_whitespace(&buffer);
+    TEST_ASSERT_EQUAL_UINT((unsigned int)(sizeof(string) - 1), (unsigned int)buffer.offset);
+}
+
 static void skip_utf8_bom_should_skip_bom(void)
 {
     const unsigned char string[] = "\xEF\xBB\xBF{}";
-    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0, 0}, NULL};
     buffer.content = string;
     buffer.length = sizeof(string);
     buffer.hooks = global_hooks;
@@ -537,7 +571,7 @@ static void skip_utf8_bom_should_skip_bom(void)
 static void skip_utf8_bom_should_not_skip_bom_if_not_at_beginning(void)
 {
     const unsigned char string[] = " \xEF\xBB\xBF{}";
-    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0, 0}, NULL};
     buffer.content = string;
     buffer.length = sizeof(string);
     buffer.hooks = global_hooks;
@@ -819,6 +853,7 @@ int CJSON_CDECL main(void)
     RUN_TEST(cjson_functions_should_not_crash_with_null_pointers);
     RUN_TEST(cjson_set_valuestring_should_return_null_if_strings_overlap);
     RUN_TEST(ensure_should_fail_on_failed_realloc);
+    RUN_TEST(skip_whitespace_should_stop_at_the_first_token);
     RUN_TEST(skip_utf8_bom_should_skip_bom);
     RUN_TEST(skip_utf8_bom_should_not_skip_bom_if_not_at_beginning);
     RUN_TEST(cjson_get_string_value_should_get_a_string);
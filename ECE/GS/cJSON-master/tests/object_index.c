@@ -0,0 +1,212 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "unity/examples/unity_config.h"
+#include "unity/src/unity.h"
+#include "common.h"
+
+#if CJSON_INDEX_THRESHOLD > 0
+#define MEMBERS (CJSON_INDEX_THRESHOLD * 4)
+
+static cJSON *create_large_object(void)
+{
+    cJSON *object = cJSON_CreateObject();
+    char name[16];
+    int i = 0;
+
+    for (i = 0; i < MEMBERS; i++)
+    {
+        sprintf(name, "Key%d", i);
+        TEST_ASSERT_NOT_NULL(cJSON_AddNumberToObject(object, name, i));
+    }
+    return object;
+}
+
+static void large_objects_should_be_indexed_on_lookup(void)
+{
+    cJSON *object = create_large_object();
+    char name[16];
+    int i = 0;
+
+    TEST_ASSERT_NULL(object->index);
+    for (i = MEMBERS - 1; i >= 0; i--)
+    {
+        sprintf(name, "key%d", i);
+        TEST_ASSERT_EQUAL_INT(i, cJSON_GetObjectItem(object, name)->valueint);
+        TEST_ASSERT_NULL(cJSON_GetObjectItemCaseSensitive(object, name));
+        sprintf(name, "Key%d", i);
+        TEST_ASSERT_EQUAL_INT(i, cJSON_GetObjectItemCaseSensitive(object, name)->valueint);
+    }
+    TEST_ASSERT_NOT_NULL(object->index);
+    TEST_ASSERT_NULL(cJSON_GetObjectItem(object, "missing"));
+    TEST_ASSERT_NULL(cJSON_GetObjectItem(object, ""));
+
+    cJSON_Delete(object);
+}
+
+static void small_objects_should_not_be_indexed(void)
+{
+    cJSON *object = cJSON_CreateObject();
+    char name[16];
+    int i = 0;
+
+    for (i = 0; i < CJSON_INDEX_THRESHOLD; i++)
+    {
+        sprintf(name, "key%d", i);
+        cJSON_AddNumberToObject(object, name, i);
+    }
+
+    TEST_ASSERT_NULL(cJSON_GetObjectItem(object, "missing"));
+    TEST_ASSERT_EQUAL_INT(CJSON_INDEX_THRESHOLD - 1, cJSON_GetObjectItem(object, name)->valueint);
+    TEST_ASSERT_NULL(object->index);
+
+    /* found among the first members: no index either */
+    cJSON_AddNumberToObject(object, "one more", 0);
+    TEST_ASSERT_EQUAL_INT(0, cJSON_GetObjectItem(object, "key0")->valueint);
+    TEST_ASSERT_NULL(object->index);
+
+    cJSON_Delete(object);
+}
+
+static void index_should_return_the_first_of_equal_names(void)
+{
+    cJSON *object = create_large_object();
+
+    cJSON_AddStringToObject(object, "dup", "first");
+    cJSON_AddStringToObject(object, "DUP", "second");
+    cJSON_AddStringToObject(object, "dup", "third");
+
+    TEST_ASSERT_EQUAL_STRING("first", cJSON_GetObjectItem(object, "Dup")->valuestring);
+    TEST_ASSERT_EQUAL_STRING("second", cJSON_GetObjectItemCaseSensitive(object, "DUP")->valuestring);
+    TEST_ASSERT_EQUAL_STRING("first", cJSON_GetObjectItemCaseSensitive(object, "dup")->valuestring);
+    TEST_ASSERT_NOT_NULL(object->index);
+
+    cJSON_DeleteItemFromObjectCaseSensitive(object, "dup");
+    TEST_ASSERT_EQUAL_STRING("second", cJSON_GetObjectItem(object, "dup")->valuestring);
+    TEST_ASSERT_EQUAL_STRING("third", cJSON_GetObjectItemCaseSensitive(object, "dup")->valuestring);
+
+    cJSON_Delete(object);
+}
+
+static void index_should_follow_changes(void)
+{
+    cJSON *object = create_large_object();
+    cJSON *detached = NULL;
+    cJSON *head = NULL;
+
+    TEST_ASSERT_NULL(cJSON_GetObjectItem(object, "missing"));
+    TEST_ASSERT_NOT_NULL(object->index);
+
+    /* add */
+    cJSON_AddTrueToObject(object, "added");
+    TEST_ASSERT_NULL(object->index);
+    TEST_ASSERT_TRUE(cJSON_IsTrue(cJSON_GetObjectItem(object, "added")));
+
+    /* detach */
+    detached = cJSON_DetachItemFromObject(object, "key7");
+    TEST_ASSERT_NOT_NULL(detached);
+    TEST_ASSERT_NULL(cJSON_GetObjectItem(object, "key7"));
+    cJSON_Delete(detached);
+
+    /* replace */
+    TEST_ASSERT_TRUE(cJSON_ReplaceItemInObject(object, "key9", cJSON_CreateString("nine")));
+    TEST_ASSERT_EQUAL_STRING("nine", cJSON_GetObjectItem(object, "key9")->valuestring);
+    TEST_ASSERT_EQUAL_INT(10, cJSON_GetObjectItem(object, "key10")->valueint);
+
+    /* delete */
+    cJSON_DeleteItemFromObject(object, "key10");
+    TEST_ASSERT_NULL(cJSON_GetObjectItem(object, "key10"));
+
+    /* a new head linked by hand makes the index stale */
+    TEST_ASSERT_NULL(cJSON_GetObjectItem(object, "missing"));
+    TEST_ASSERT_NOT_NULL(object->index);
+    head = object->child;
+    object->child = head->next;
+    object->child->prev = head->prev;
+    head->next = head->prev = NULL;
+    TEST_ASSERT_NULL(cJSON_GetObjectItem(object, "key0"));
+    TEST_ASSERT_EQUAL_INT(1, cJSON_GetObjectItem(object, "key1")->valueint);
+    cJSON_Delete(head);
+
+    cJSON_Delete(object);
+}
+
+static void arena_objects_should_never_be_indexed(void)
+{
+    static double memory[4096];
+    cJSON_Arena arena;
+    cJSON *object = create_large_object();
+    char *printed = cJSON_PrintUnformatted(object);
+    cJSON *parsed = NULL;
+    char name[16];
+
+    cJSON_Delete(object);
+    TEST_ASSERT_NOT_NULL(printed);
+
+    cJSON_InitArena(&arena, memory, sizeof(memory));
+    parsed = cJSON_ParseWithArena(printed, strlen(printed), &arena);
+    TEST_ASSERT_NOT_NULL(parsed);
+    sprintf(name, "key%d", MEMBERS - 1);
+    TEST_ASSERT_EQUAL_INT(MEMBERS - 1, cJSON_GetObjectItem(parsed, name)->valueint);
+    TEST_ASSERT_TRUE(parsed->index == &never_indexed);
+
+    global_hooks.deallocate(printed);
+}
+
+static void references_should_not_be_indexed(void)
+{
+    cJSON *object = create_large_object();
+    cJSON *reference = NULL;
+    cJSON *holder = cJSON_CreateObject();
+
+    cJSON_AddItemReferenceToObject(holder, "ref", object);
+    reference = cJSON_GetObjectItem(holder, "ref");
+    TEST_ASSERT_EQUAL_INT(5, cJSON_GetObjectItem(reference, "key5")->valueint);
+    TEST_ASSERT_NULL(reference->index);
+
+    cJSON_Delete(holder);
+    cJSON_Delete(object);
+}
+#else
+static void objects_are_not_indexed_with_threshold_zero(void)
+{
+    TEST_IGNORE_MESSAGE("CJSON_INDEX_THRESHOLD is 0, objects are searched linearly");
+}
+#endif
+
+int CJSON_CDECL main(void)
+{
+    UNITY_BEGIN();
+
+#if CJSON_INDEX_THRESHOLD > 0
+    RUN_TEST(large_objects_should_be_indexed_on_lookup);
+    RUN_TEST(small_objects_should_not_be_indexed);
+    RUN_TEST(index_should_return_the_first_of_equal_names);
+    RUN_TEST(index_should_follow_changes);
+    RUN_TEST(arena_objects_should_never_be_indexed);
+    RUN_TEST(references_should_not_be_indexed);
+#else
+    RUN_TEST(objects_are_not_indexed_with_threshold_zero);
+#endif
+
+    return UNITY_END();
+}
@@ -0,0 +1,148 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "unity/examples/unity_config.h"
+#include "unity/src/unity.h"
+#include "common.h"
+
+static double arena_memory[512];
+static cJSON_Arena arena;
+
+static void fresh_arena(void)
+{
+    cJSON_InitArena(&arena, arena_memory, sizeof(arena_memory));
+}
+
+static size_t counted_mallocs = 0;
+static void * CJSON_CDECL counting_malloc(size_t size)
+{
+    counted_mallocs++;
+    return malloc(size);
+}
+
+static void parse_with_arena_should_parse_a_document(void)
+{
+    const char json[] = "{\"T\":\"CTRL\",\"w\":1,\"speed\":42.5,\"keys\":[\"a\",\"\\u00e9\"],\"nested\":{\"ok\":true}}";
+    cJSON *root = NULL;
+    cJSON *keys = NULL;
+
+    fresh_arena();
+    root = cJSON_ParseWithArena(json, sizeof(json) - 1, &arena);
+
+    TEST_ASSERT_NOT_NULL(root);
+    TEST_ASSERT_EQUAL_STRING("CTRL", cJSON_GetObjectItem(root, "T")->valuestring);
+    TEST_ASSERT_EQUAL_DOUBLE(42.5, cJSON_GetObjectItem(root, "speed")->valuedouble);
+    keys = cJSON_GetObjectItem(root, "keys");
+    TEST_ASSERT_EQUAL_INT(2, cJSON_GetArraySize(keys));
+    TEST_ASSERT_EQUAL_STRING("\xC3\xA9", cJSON_GetArrayItem(keys, 1)->valuestring);
+    TEST_ASSERT_TRUE(cJSON_IsTrue(cJSON_GetObjectItem(cJSON_GetObjectItem(root, "nested"), "ok")));
+
+    /* nodes and strings live in the arena */
+    TEST_ASSERT_TRUE(((unsigned char*)root >= arena.buffer) && ((unsigned char*)root < (arena.buffer + arena.used)));
+    TEST_ASSERT_TRUE(((unsigned char*)keys->child->valuestring >= arena.buffer) && ((unsigned char*)keys->child->valuestring < (arena.buffer + arena.used)));
+    TEST_ASSERT_EQUAL_INT(0, ((size_t)root) % sizeof(void*));
+}
+
+static void parse_with_arena_should_not_call_the_allocator(void)
+{
+    cJSON_Hooks hooks = { counting_malloc, free };
+    cJSON *root = NULL;
+
+    fresh_arena();
+
+    cJSON_InitHooks(&hooks);
+    counted_mallocs = 0;
+    root = cJSON_ParseWithArena("[1, 2.5, \"three\", {\"four\": null}]", 33, &arena);
+    cJSON_InitHooks(NULL);
+
+    TEST_ASSERT_NOT_NULL(root);
+    TEST_ASSERT_EQUAL_INT(0, counted_mallocs);
+}
+
+static void parse_with_arena_should_be_released_by_reset(void)
+{
+    cJSON *first = NULL;
+    cJSON *second = NULL;
+
+    fresh_arena();
+    first = cJSON_ParseWithArena("{\"a\":1}", 7, &arena);
+
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_NOT_EQUAL(0, arena.used);
+
+    cJSON_ResetArena(&arena);
+    TEST_ASSERT_EQUAL_INT(0, arena.used);
+
+    second = cJSON_ParseWithArena("{\"a\":1}", 7, &arena);
+    TEST_ASSERT_EQUAL_PTR(first, second);
+}
+
+static void parse_with_arena_should_leave_arena_unchanged_on_failure(void)
+{
+    size_t used = 0;
+
+    fresh_arena();
+
+    TEST_ASSERT_NOT_NULL(cJSON_ParseWithArena("[1]", 3, &arena));
+    used = arena.used;
+
+    TEST_ASSERT_NULL(cJSON_ParseWithArena("{\"a\":[1, 2, \"x\"", 15, &arena));
+    TEST_ASSERT_EQUAL_INT(used, arena.used);
+    TEST_ASSERT_NULL(cJSON_ParseWithArena("{\"a\":1}", 7, NULL));
+}
+
+static void parse_with_arena_should_fail_when_full(void)
+{
+    double small_memory[10];
+    cJSON_Arena small;
+    cJSON_InitArena(&small, small_memory, sizeof(small_memory));
+
+    TEST_ASSERT_NULL(cJSON_ParseWithArena("[1, 2, 3, 4, 5]", 15, &small));
+    TEST_ASSERT_EQUAL_INT(0, small.used);
+    TEST_ASSERT_NOT_NULL(cJSON_ParseWithArena("1", 1, &small));
+}
+
+static void init_arena_should_align_the_buffer(void)
+{
+    cJSON_Arena skewed;
+    cJSON_InitArena(&skewed, (unsigned char*)arena_memory + 1, sizeof(arena_memory) - 1);
+
+    TEST_ASSERT_EQUAL_INT(0, ((size_t)skewed.buffer) % sizeof(void*));
+    TEST_ASSERT_TRUE(skewed.size < sizeof(arena_memory) - 1);
+
+    cJSON_InitArena(&skewed, NULL, 100);
+    TEST_ASSERT_NULL(cJSON_ParseWithArena("1", 1, &skewed));
+}
+
+int CJSON_CDECL main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(parse_with_arena_should_parse_a_document);
+    RUN_TEST(parse_with_arena_should_not_call_the_allocator);
+    RUN_TEST(parse_with_arena_should_be_released_by_reset);
+    RUN_TEST(parse_with_arena_should_leave_arena_unchanged_on_failure);
+    RUN_TEST(parse_with_arena_should_fail_when_full);
+    RUN_TEST(init_arena_should_align_the_buffer);
+
+    return UNITY_END();
+}
@@ -0,0 +1,124 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "unity/examples/unity_config.h"
+#include "unity/src/unity.h"
+#include "common.h"
+
+static size_t live_allocations = 0;
+static void * CJSON_CDECL counting_malloc(size_t size)
+{
+    live_allocations++;
+    return malloc(size);
+}
+static void CJSON_CDECL counting_free(void *pointer)
+{
+    if (pointer != NULL)
+    {
+        live_allocations--;
+    }
+    free(pointer);
+}
+
+static void parse_ctx_should_use_the_context_allocator(void)
+{
+    const char json[] = "{\"T\":\"CTRL\",\"w\":1,\"keys\":[\"a\",\"b\"]}";
+    cJSON_Hooks hooks = { counting_malloc, counting_free };
+    cJSON_Context ctx;
+    cJSON *root = NULL;
+    char *printed = NULL;
+
+    cJSON_InitContext(&ctx, &hooks, NULL);
+    live_allocations = 0;
+    root = cJSON_ParseCtx(&ctx, json, sizeof(json), NULL, true);
+    TEST_ASSERT_NOT_NULL(root);
+    TEST_ASSERT_NULL(ctx.error);
+    TEST_ASSERT_TRUE(live_allocations > 0);
+
+    printed = cJSON_PrintCtx(&ctx, root, false);
+    TEST_ASSERT_EQUAL_STRING(json, printed);
+    counting_free(printed);
+
+    cJSON_DeleteCtx(&ctx, root);
+    TEST_ASSERT_EQUAL_INT(0, live_allocations);
+}
+
+static void parse_ctx_should_keep_its_own_error(void)
+{
+    const char bad[] = "{\"a\":tru}";
+    cJSON_Context ctx;
+    cJSON *global = NULL;
+
+    cJSON_InitContext(&ctx, NULL, NULL);
+    TEST_ASSERT_NULL(cJSON_ParseCtx(&ctx, bad, sizeof(bad) - 1, NULL, false));
+    TEST_ASSERT_EQUAL_PTR(bad + 5, ctx.error);
+
+    /* the global error position is left alone, and a global parse doesn't touch the context */
+    global = cJSON_Parse("[1]");
+    TEST_ASSERT_NOT_NULL(global);
+    TEST_ASSERT_EQUAL_PTR(bad + 5, ctx.error);
+    TEST_ASSERT_NULL(cJSON_ParseCtx(&ctx, bad, sizeof(bad) - 1, NULL, false));
+    TEST_ASSERT_NULL(cJSON_GetErrorPtr());
+    cJSON_Delete(global);
+}
+
+static void parse_ctx_should_parse_into_its_arena(void)
+{
+    static double arena_memory[64];
+    cJSON_Arena arena;
+    cJSON_Context ctx;
+    cJSON *root = NULL;
+    size_t used = 0;
+
+    cJSON_InitArena(&arena, arena_memory, sizeof(arena_memory));
+    cJSON_InitContext(&ctx, NULL, &arena);
+    root = cJSON_ParseCtx(&ctx, "[1, \"two\"]", 10, NULL, false);
+    TEST_ASSERT_NOT_NULL(root);
+    TEST_ASSERT_TRUE(((unsigned char*)root >= arena.buffer) && ((unsigned char*)root < (arena.buffer + arena.used)));
+
+    /* a failed parse leaves the arena as it was, and deleting an arena tree does nothing */
+    used = arena.used;
+    TEST_ASSERT_NULL(cJSON_ParseCtx(&ctx, "[1, tw]", 7, NULL, false));
+    TEST_ASSERT_EQUAL_INT(used, arena.used);
+    cJSON_DeleteCtx(&ctx, root);
+    TEST_ASSERT_EQUAL_STRING("two", cJSON_GetArrayItem(root, 1)->valuestring);
+}
+
+static void ctx_functions_should_handle_null(void)
+{
+    cJSON_InitContext(NULL, NULL, NULL);
+    TEST_ASSERT_NULL(cJSON_ParseCtx(NULL, "1", 1, NULL, false));
+    TEST_ASSERT_NULL(cJSON_PrintCtx(NULL, NULL, false));
+    cJSON_DeleteCtx(NULL, NULL);
+}
+
+int CJSON_CDECL main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(parse_ctx_should_use_the_context_allocator);
+    RUN_TEST(parse_ctx_should_keep_its_own_error);
+    RUN_TEST(parse_ctx_should_parse_into_its_arena);
+    RUN_TEST(ctx_functions_should_handle_null);
+
+    return UNITY_END();
+}
@@ -0,0 +1,152 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "unity/examples/unity_config.h"
+#include "unity/src/unity.h"
+#include "common.h"
+
+static size_t counted_mallocs = 0;
+static void * CJSON_CDECL counting_malloc(size_t size)
+{
+    counted_mallocs++;
+    return malloc(size);
+}
+
+static cJSON_bool points_into(const char *pointer, const char *buffer, size_t length)
+{
+    return (pointer >= buffer) && (pointer < (buffer + length));
+}
+
+static void parse_insitu_should_point_into_the_buffer(void)
+{
+    char json[] = "{\"T\":\"CTRL\",\"keys\":[\"a\",\"bc\"],\"w\":1}";
+    cJSON *root = NULL;
+    cJSON *type = NULL;
+    cJSON *keys = NULL;
+
+    root = cJSON_ParseInSitu(json, sizeof(json) - 1);
+    TEST_ASSERT_NOT_NULL(root);
+
+    type = cJSON_GetObjectItem(root, "T");
+    TEST_ASSERT_EQUAL_STRING("CTRL", type->valuestring);
+    TEST_ASSERT_TRUE(points_into(type->valuestring, json, sizeof(json)));
+    TEST_ASSERT_TRUE(points_into(type->string, json, sizeof(json)));
+    TEST_ASSERT_BITS(cJSON_IsReference | cJSON_StringIsConst, cJSON_IsReference | cJSON_StringIsConst, type->type);
+    TEST_ASSERT_TRUE(cJSON_IsString(type));
+
+    keys = cJSON_GetObjectItem(root, "keys");
+    TEST_ASSERT_EQUAL_STRING("bc", cJSON_GetArrayItem(keys, 1)->valuestring);
+    TEST_ASSERT_TRUE(points_into(cJSON_GetArrayItem(keys, 1)->valuestring, json, sizeof(json)));
+    TEST_ASSERT_EQUAL_DOUBLE(1, cJSON_GetObjectItem(root, "w")->valuedouble);
+
+    /* a read-only string cannot be replaced */
+    TEST_ASSERT_NULL(cJSON_SetValuestring(type, "DRIVE"));
+
+    cJSON_Delete(root);
+}
+
+static void parse_insitu_should_unescape_in_place(void)
+{
+    char json[] = "[\"a\\\"b\\\\c\\n\", \"\\u00e9\\ud83d\\ude00\", \"\"]";
+    cJSON *root = NULL;
+
+    root = cJSON_ParseInSitu(json, sizeof(json) - 1);
+    TEST_ASSERT_NOT_NULL(root);
+
+    TEST_ASSERT_EQUAL_STRING("a\"b\\c\n", cJSON_GetArrayItem(root, 0)->valuestring);
+    TEST_ASSERT_EQUAL_STRING("\xC3\xA9\xF0\x9F\x98\x80", cJSON_GetArrayItem(root, 1)->valuestring);
+    TEST_ASSERT_EQUAL_STRING("", cJSON_GetArrayItem(root, 2)->valuestring);
+    TEST_ASSERT_EQUAL_PTR(json + 2, cJSON_GetArrayItem(root, 0)->valuestring);
+
+    cJSON_Delete(root);
+}
+
+static void parse_insitu_should_not_allocate_strings(void)
+{
+    cJSON_Hooks hooks = { counting_malloc, free };
+    char json[] = "{\"one\":\"1\",\"two\":[\"2\",\"3\"]}";
+    cJSON *root = NULL;
+
+    cJSON_InitHooks(&hooks);
+    counted_mallocs = 0;
+    root = cJSON_ParseInSitu(json, sizeof(json) - 1);
+
+    TEST_ASSERT_NOT_NULL(root);
+    /* object, two members, array: one node each, no string copies */
+    TEST_ASSERT_EQUAL_INT(5, counted_mallocs);
+
+    cJSON_Delete(root);
+    cJSON_InitHooks(NULL);
+}
+
+static void parse_insitu_should_fail_cleanly(void)
+{
+    char unterminated[] = "{\"a\":[\"x\", {\"b\":\"y\"}, \"z";
+    char trailing[] = "[\"x\"] junk";
+
+    TEST_ASSERT_NULL(cJSON_ParseInSitu(unterminated, sizeof(unterminated) - 1));
+    TEST_ASSERT_NOT_NULL(cJSON_GetErrorPtr());
+    TEST_ASSERT_NULL(cJSON_ParseInSitu(NULL, 10));
+
+    /* parsing stops after the first value, like cJSON_ParseWithLength */
+    cJSON_Delete(cJSON_ParseInSitu(trailing, sizeof(trailing) - 1));
+}
+
+static void parse_insitu_with_arena_should_allocate_nothing(void)
+{
+    double memory[128];
+    cJSON_Arena arena;
+    cJSON_Hooks hooks = { counting_malloc, free };
+    char json[] = "{\"speed\":42.5,\"name\":\"w\\tx\"}";
+    cJSON *root = NULL;
+    size_t used = 0;
+
+    cJSON_InitArena(&arena, memory, sizeof(memory));
+    cJSON_InitHooks(&hooks);
+    counted_mallocs = 0;
+    root = cJSON_ParseInSituWithArena(json, sizeof(json) - 1, &arena);
+    cJSON_InitHooks(NULL);
+
+    TEST_ASSERT_NOT_NULL(root);
+    TEST_ASSERT_EQUAL_INT(0, counted_mallocs);
+    TEST_ASSERT_EQUAL_STRING("w\tx", cJSON_GetObjectItem(root, "name")->valuestring);
+    TEST_ASSERT_TRUE(points_into(cJSON_GetObjectItem(root, "name")->valuestring, json, sizeof(json)));
+    /* only the three nodes came from the arena */
+    TEST_ASSERT_TRUE(arena.used <= 3 * (sizeof(cJSON) + sizeof(void*)));
+
+    used = arena.used;
+    TEST_ASSERT_NULL(cJSON_ParseInSituWithArena(json, 3, &arena));
+    TEST_ASSERT_EQUAL_INT(used, arena.used);
+}
+
+int CJSON_CDECL main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(parse_insitu_should_point_into_the_buffer);
+    RUN_TEST(parse_insitu_should_unescape_in_place);
+    RUN_TEST(parse_insitu_should_not_allocate_strings);
+    RUN_TEST(parse_insitu_should_fail_cleanly);
+    RUN_TEST(parse_insitu_with_arena_should_allocate_nothing);
+
+    return UNITY_END();
+}
@@ -45,7 +45,7 @@ static void assert_is_number(cJSON *number_item)
 
 static void assert_parse_number(const char *string, int integer, double real)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL };
     buffer.content = (const unsigned char*)string;
     buffer.length = strlen(string) + sizeof("");
     buffer.hooks = global_hooks;
@@ -58,7 +58,7 @@ static void assert_parse_number(const char *string, int integer, double real)
 
 static void assert_parse_big_number(const char *string)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL };
     buffer.content = (const unsigned char*)string;
     buffer.length = strlen(string) + sizeof("");
     buffer.hooks = global_hooks;
@@ -108,6 +108,45 @@ static void parse_number_should_parse_negative_reals(void)
     assert_parse_number("-123e-128", 0, -123e-128);
 }
 
+static void parse_number_should_stop_after_an_integer(void)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL };
+    buffer.content = (const unsigned char*)"42,-7]";
+    buffer.length = strlen("42,-7]") + sizeof("");
+    buffer.hooks = global_hooks;
+
+    TEST_ASSERT_TRUE(parse_number(item, &buffer));
+    TEST_ASSERT_EQUAL_INT(42, item->valueint);
+    TEST_ASSERT_EQUAL_UINT(2, buffer.offset);
+
+    buffer.offset = 3;
+    TEST_ASSERT_TRUE(parse_number(item, &buffer));
+    TEST_ASSERT_EQUAL_INT(-7, item->valueint);
+    TEST_ASSERT_EQUAL_UINT(5, buffer.offset);
+
+    /* the length bounds the literal even without a terminator */
+    buffer.content = (const unsigned char*)"123";
+    buffer.length = 2;
+    buffer.offset = 0;
+    TEST_ASSERT_TRUE(parse_number(item, &buffer));
+    TEST_ASSERT_EQUAL_INT(12, item->valueint);
+
+    buffer.content = (const unsigned char*)"-";
+    buffer.length = 2;
+    buffer.offset = 0;
+    TEST_ASSERT_FALSE(parse_number(item, &buffer));
+}
+
+static void parse_number_should_saturate_long_integers(void)
+{
+    assert_parse_number("999999999999999", INT_MAX, 999999999999999.0);
+    assert_parse_number("-999999999999999", INT_MIN, -999999999999999.0);
+    assert_parse_number("2147483648", INT_MAX, 2147483648.0);
+    assert_parse_number("-2147483649", INT_MIN, -2147483649.0);
+    assert_parse_number("12345678901234567890", INT_MAX, 12345678901234567890.0);
+    assert_parse_number("007", 7, 7.0);
+}
+
 static void parse_number_should_parse_big_numbers(void)
 {
     assert_parse_big_number("9999999999999999999999999999999999999999999999912345678901234567");
@@ -115,6 +154,74 @@ static void parse_number_should_parse_big_numbers(void)
     assert_parse_big_number("999999999999999999999999999999999999999999999991234567890.1234567");
 }
 
+static void assert_parse_int64(const char *string, cJSON_bool is_int64, cJSON_int64 expected)
+{
+    cJSON_int64 value = 0;
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL };
+    buffer.content = (const unsigned char*)string;
+    buffer.length = strlen(string) + sizeof("");
+    buffer.hooks = global_hooks;
+
+    TEST_ASSERT_TRUE(parse_number(item, &buffer));
+    assert_is_number(item);
+    TEST_ASSERT_EQUAL_INT(is_int64, cJSON_GetInt64Value(item, &value));
+    if (is_int64)
+    {
+        TEST_ASSERT_TRUE_MESSAGE(value == expected, "Exact integer is not as expected.");
+    }
+}
+
+#ifdef CJSON_INT64
+static void parse_number_should_keep_exact_64_bit_integers(void)
+{
+    cJSON_uint64 unsigned_value = 0;
+
+    /* 2^53 + 1 has no double */
+    assert_parse_int64("9007199254740993", true, (cJSON_int64)9007199254740992.0 + 1);
+    TEST_ASSERT_BITS(cJSON_NumberIsInt64, cJSON_NumberIsInt64, item->type);
+    TEST_ASSERT_EQUAL_INT(INT_MAX, item->valueint);
+    assert_parse_int64("-9223372036854775808", true, -(cJSON_int64)4611686018427387904.0 * 2);
+    TEST_ASSERT_EQUAL_INT(INT_MIN, item->valueint);
+    TEST_ASSERT_FALSE(cJSON_GetUint64Value(item, &unsigned_value));
+    assert_parse_int64("-42", true, -42);
+    TEST_ASSERT_EQUAL_INT(-42, item->valueint);
+
+    /* above INT64_MAX only as unsigned */
+    assert_parse_int64("18446744073709551615", false, 0);
+    TEST_ASSERT_BITS(cJSON_NumberIsUint64, cJSON_NumberIsUint64, item->type);
+    TEST_ASSERT_TRUE(cJSON_GetUint64Value(item, &unsigned_value));
+    TEST_ASSERT_TRUE(unsigned_value == (cJSON_uint64)0 - 1);
+
+    /* too long, or a fraction or exponent: a double, exact only while whole and within 2^53 */
+    assert_parse_int64("18446744073709551616", false, 0);
+    TEST_ASSERT_BITS(cJSON_NumberIsInt64, 0, item->type);
+    assert_parse_int64("-9223372036854775809", false, 0);
+    assert_parse_int64("1e3", true, 1000);
+    TEST_ASSERT_BITS(cJSON_NumberIsInt64, 0, item->type);
+    assert_parse_int64("2.0", true, 2);
+    assert_parse_int64("2.5", false, 0);
+
+    /* setting a double drops the exact value */
+    assert_parse_int64("9007199254740993", true, (cJSON_int64)9007199254740992.0 + 1);
+    cJSON_SetNumberValue(item, 7);
+    assert_parse_int64("7", true, 7);
+    cJSON_SetNumberValue(item, 3.5);
+    TEST_ASSERT_FALSE(cJSON_GetInt64Value(item, NULL));
+    TEST_ASSERT_FALSE(cJSON_GetUint64Value(NULL, &unsigned_value));
+}
+#else
+static void parse_number_should_read_whole_doubles_as_64_bit_integers(void)
+{
+    /* without CJSON_INT64 every number is a double, exact while whole and within 2^53 */
+    assert_parse_int64("9007199254740992", true, (cJSON_int64)9007199254740992.0);
+    TEST_ASSERT_BITS(cJSON_NumberIsInt64 | cJSON_NumberIsUint64, 0, item->type);
+    assert_parse_int64("-42", true, -42);
+    TEST_ASSERT_EQUAL_INT(-42, item->valueint);
+    assert_parse_int64("9007199254740994", false, 0);
+    assert_parse_int64("2.5", false, 0);
+}
+#endif
+
 int CJSON_CDECL main(void)
 {
     /* initialize cJSON item */
@@ -125,6 +232,13 @@ int CJSON_CDECL main(void)
     RUN_TEST(parse_number_should_parse_positive_integers);
     RUN_TEST(parse_number_should_parse_positive_reals);
     RUN_TEST(parse_number_should_parse_negative_reals);
+    RUN_TEST(parse_number_should_stop_after_an_integer);
+    RUN_TEST(parse_number_should_saturate_long_integers);
     RUN_TEST(parse_number_should_parse_big_numbers);
+#ifdef CJSON_INT64
+    RUN_TEST(parse_number_should_keep_exact_64_bit_integers);
+#else
+    RUN_TEST(parse_number_should_read_whole_doubles_as_64_bit_integers);
+#endif
     return UNITY_END();
 }
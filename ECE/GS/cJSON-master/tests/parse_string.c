@@ -45,7 +45,7 @@ static void assert_is_string(cJSON *string_item)
 
 static void assert_parse_string(const char *string, const char *expected)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL };
     buffer.content = (const unsigned char*)string;
     buffer.length = strlen(string) + sizeof("");
     buffer.hooks = global_hooks;
@@ -59,7 +59,7 @@ static void assert_parse_string(const char *string, const char *expected)
 
 static void assert_not_parse_string(const char * const string)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL };
     buffer.content = (const unsigned char*)string;
     buffer.length = strlen(string) + sizeof("");
     buffer.hooks = global_hooks;
@@ -119,6 +119,38 @@ static void parse_string_should_parse_bug_94(void)
     reset(item);
 }
 
+static void parse_string_should_find_the_end_at_any_offset(void)
+{
+    /* the scan runs 16 bytes at a time, so move the quote and an escape through several blocks */
+    char string[64];
+    char expected[64];
+    size_t length = 0;
+    size_t escape = 0;
+
+    for (length = 0; length < 48; length++)
+    {
+        for (escape = 0; escape <= length; escape += 7)
+        {
+            memset(string, 'a', sizeof(string));
+            string[0] = '\"';
+            string[length + 1] = '\"';
+            string[length + 2] = 'x';
+            string[length + 3] = '\0';
+            memset(expected, 'a', length);
+            expected[length] = '\0';
+            if (escape + 1 < length)
+            {
+                string[escape + 1] = '\\';
+                string[escape + 2] = 'n';
+                expected[escape] = '\n';
+                memmove(expected + escape + 1, expected + escape + 2, length - escape - 1);
+            }
+            assert_parse_string(string, expected);
+        }
+    }
+    reset(item);
+}
+
 int CJSON_CDECL main(void)
 {
     /* initialize cJSON item and error pointer */
@@ -131,5 +163,6 @@ int CJSON_CDECL main(void)
     RUN_TEST(parse_string_should_not_parse_invalid_backslash);
     RUN_TEST(parse_string_should_parse_bug_94);
     RUN_TEST(parse_string_should_not_overflow_with_closing_backslash);
+    RUN_TEST(parse_string_should_find_the_end_at_any_offset);
     return UNITY_END();
 }
@@ -0,0 +1,165 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "unity/examples/unity_config.h"
+#include "unity/src/unity.h"
+#include "common.h"
+
+static cJSON_TapeEntry entries[64];
+static cJSON_Tape tape;
+
+static cJSON_TapeValue index_json(const char *json)
+{
+    cJSON_InitTape(&tape, entries, sizeof(entries) / sizeof(entries[0]));
+    TEST_ASSERT_TRUE(cJSON_TapeIndex(&tape, json, strlen(json)));
+    return cJSON_TapeRoot(&tape);
+}
+
+static size_t counted_mallocs = 0;
+static void * CJSON_CDECL counting_malloc(size_t size)
+{
+    counted_mallocs++;
+    return malloc(size);
+}
+
+static void tape_should_read_fields_without_building_a_tree(void)
+{
+    static const char json[] = " {\"T\":\"C\", \"skip\":{\"a\":[1,{\"b\":\"]}\"}],\"c\":null}, \"F\":1, \"S\":-40 } ";
+    cJSON_Hooks hooks = { counting_malloc, free };
+    cJSON_TapeValue root;
+    char type[4];
+
+    cJSON_InitHooks(&hooks);
+    counted_mallocs = 0;
+    root = index_json(json);
+
+    TEST_ASSERT_EQUAL_INT(cJSON_Object, cJSON_TapeType(root));
+    TEST_ASSERT_TRUE(cJSON_TapeCopyString(cJSON_TapeGetObjectItemCaseSensitive(root, "T"), type, sizeof(type)));
+    TEST_ASSERT_EQUAL_STRING("C", type);
+    TEST_ASSERT_EQUAL_DOUBLE(1, cJSON_TapeGetNumberValue(cJSON_TapeGetObjectItemCaseSensitive(root, "F")));
+    TEST_ASSERT_EQUAL_DOUBLE(-40, cJSON_TapeGetNumberValue(cJSON_TapeGetObjectItem(root, "s")));
+    TEST_ASSERT_NULL(cJSON_TapeGetObjectItemCaseSensitive(root, "s").tape);
+    TEST_ASSERT_NULL(cJSON_TapeGetObjectItem(root, "missing").tape);
+    TEST_ASSERT_EQUAL_INT(0, counted_mallocs);
+
+    cJSON_InitHooks(NULL);
+}
+
+static void tape_should_walk_nested_values(void)
+{
+    cJSON_TapeValue root = index_json("[[], {}, [1, [2, 3]], \"x\", true, false, null, {\"k\": [4]}]");
+    cJSON_TapeValue item;
+    char name[4];
+    int count = 0;
+
+    for (item = cJSON_TapeChild(root); item.tape != NULL; item = cJSON_TapeNext(item))
+    {
+        count++;
+    }
+    TEST_ASSERT_EQUAL_INT(8, count);
+
+    TEST_ASSERT_NULL(cJSON_TapeChild(cJSON_TapeGetArrayItem(root, 0)).tape);
+    TEST_ASSERT_NULL(cJSON_TapeChild(cJSON_TapeGetArrayItem(root, 1)).tape);
+    item = cJSON_TapeGetArrayItem(cJSON_TapeGetArrayItem(root, 2), 1);
+    TEST_ASSERT_EQUAL_DOUBLE(3, cJSON_TapeGetNumberValue(cJSON_TapeGetArrayItem(item, 1)));
+    TEST_ASSERT_EQUAL_INT(cJSON_String, cJSON_TapeType(cJSON_TapeGetArrayItem(root, 3)));
+    TEST_ASSERT_EQUAL_INT(cJSON_True, cJSON_TapeType(cJSON_TapeGetArrayItem(root, 4)));
+    TEST_ASSERT_EQUAL_INT(cJSON_False, cJSON_TapeType(cJSON_TapeGetArrayItem(root, 5)));
+    TEST_ASSERT_EQUAL_INT(cJSON_NULL, cJSON_TapeType(cJSON_TapeGetArrayItem(root, 6)));
+    TEST_ASSERT_NULL(cJSON_TapeGetArrayItem(root, 8).tape);
+    TEST_ASSERT_NULL(cJSON_TapeGetArrayItem(root, -1).tape);
+
+    item = cJSON_TapeChild(cJSON_TapeGetArrayItem(root, 7));
+    TEST_ASSERT_TRUE(cJSON_TapeCopyName(item, name, sizeof(name)));
+    TEST_ASSERT_EQUAL_STRING("k", name);
+    TEST_ASSERT_FALSE(cJSON_TapeCopyName(root, name, sizeof(name)));
+}
+
+static void tape_should_decode_escapes_on_access(void)
+{
+    cJSON_TapeValue root = index_json("{\"a\\\"b\":\"x\\u00e9\\n\",\"n\":1.5e2}");
+    char text[16];
+
+    TEST_ASSERT_TRUE(cJSON_TapeCopyString(cJSON_TapeGetObjectItemCaseSensitive(root, "a\"b"), text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("x\xc3\xa9\n", text);
+    TEST_ASSERT_FALSE(cJSON_TapeCopyString(cJSON_TapeGetObjectItemCaseSensitive(root, "a\"b"), text, 4));
+    TEST_ASSERT_TRUE(cJSON_TapeCopyName(cJSON_TapeChild(root), text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("a\"b", text);
+    TEST_ASSERT_EQUAL_DOUBLE(150, cJSON_TapeGetNumberValue(cJSON_TapeGetObjectItem(root, "N")));
+    TEST_ASSERT_TRUE(isnan(cJSON_TapeGetNumberValue(root)));
+}
+
+static void tape_should_materialize_a_subtree(void)
+{
+    cJSON_TapeValue root = index_json("{\"meta\":{\"a\":1},\"list\":[1,2,{\"b\":[true]}],\"bad\":[1,]}");
+    cJSON *list = cJSON_TapeMaterialize(cJSON_TapeGetObjectItem(root, "list"));
+    char *printed = NULL;
+
+    TEST_ASSERT_NOT_NULL(list);
+    printed = cJSON_PrintUnformatted(list);
+    TEST_ASSERT_EQUAL_STRING("[1,2,{\"b\":[true]}]", printed);
+    cJSON_free(printed);
+    cJSON_Delete(list);
+
+    /* only what is read gets validated */
+    TEST_ASSERT_NULL(cJSON_TapeMaterialize(cJSON_TapeGetObjectItem(root, "bad")));
+    TEST_ASSERT_NULL(cJSON_TapeMaterialize(root));
+}
+
+static void tape_index_should_reject_broken_structure(void)
+{
+    static const char *const broken[] = { "", "  ", "{", "[}", "{]", "[1]]", "\"abc", "[\"a\\\"]", "{} {}", "[1] x", "1,2" };
+    cJSON_TapeEntry small[3];
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(broken) / sizeof(broken[0]); i++)
+    {
+        cJSON_InitTape(&tape, entries, sizeof(entries) / sizeof(entries[0]));
+        TEST_ASSERT_FALSE_MESSAGE(cJSON_TapeIndex(&tape, broken[i], strlen(broken[i])), broken[i]);
+        TEST_ASSERT_NULL(cJSON_TapeRoot(&tape).tape);
+    }
+
+    cJSON_InitTape(&tape, small, 3);
+    TEST_ASSERT_TRUE(cJSON_TapeIndex(&tape, "[1,2]", 5));
+    TEST_ASSERT_FALSE(cJSON_TapeIndex(&tape, "[1,2,3]", 7));
+
+    /* a scalar root has no tape entries */
+    TEST_ASSERT_TRUE(cJSON_TapeIndex(&tape, " 42 ", 4));
+    TEST_ASSERT_EQUAL_DOUBLE(42, cJSON_TapeGetNumberValue(cJSON_TapeRoot(&tape)));
+    TEST_ASSERT_NULL(cJSON_TapeNext(cJSON_TapeRoot(&tape)).tape);
+
+    TEST_ASSERT_FALSE(cJSON_TapeIndex(NULL, "1", 1));
+    TEST_ASSERT_FALSE(cJSON_TapeIndex(&tape, NULL, 1));
+}
+
+int CJSON_CDECL main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(tape_should_read_fields_without_building_a_tree);
+    RUN_TEST(tape_should_walk_nested_values);
+    RUN_TEST(tape_should_decode_escapes_on_access);
+    RUN_TEST(tape_should_materialize_a_subtree);
+    RUN_TEST(tape_index_should_reject_broken_structure);
+
+    return UNITY_END();
+}
@@ -30,7 +30,7 @@ static void assert_print_number(const char *expected, double input)
     unsigned char new_buffer[26];
     unsigned int i = 0;
     cJSON item[1];
-    printbuffer buffer = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    printbuffer buffer = { 0, 0, 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL, NULL, 0 };
     buffer.buffer = printed;
     buffer.length = sizeof(printed);
     buffer.offset = 0;
@@ -40,6 +40,7 @@ static void assert_print_number(const char *expected, double input)
 
     memset(item, 0, sizeof(item));
     memset(new_buffer, 0, sizeof(new_buffer));
+    item->type = cJSON_Number;
     cJSON_SetNumberValue(item, input);
     TEST_ASSERT_TRUE_MESSAGE(print_number(item, &buffer), "Failed to print number.");
     
@@ -67,6 +68,26 @@ static void print_number_should_print_zero(void)
     assert_print_number("0", 0);
 }
 
+static void print_number_should_print_zero_with_stale_valueint(void)
+{
+    /* valuedouble written directly leaves valueint behind, so this takes the shortest round-trip path */
+    char *printed = NULL;
+    cJSON *number = cJSON_CreateNumber(5);
+    TEST_ASSERT_NOT_NULL(number);
+    number->valuedouble = 0;
+
+    printed = cJSON_PrintUnformatted(number);
+    TEST_ASSERT_EQUAL_STRING("0", printed);
+
+    number->valuedouble = -0.0;
+    cJSON_free(printed);
+    printed = cJSON_PrintUnformatted(number);
+    TEST_ASSERT_EQUAL_STRING("0", printed);
+
+    cJSON_free(printed);
+    cJSON_Delete(number);
+}
+
 static void print_number_should_print_negative_integers(void)
 {
     assert_print_number("-1", -1.0);
@@ -88,7 +109,7 @@ static void print_number_should_print_positive_reals(void)
     assert_print_number("1000000000000", 10e11);
     assert_print_number("1.23e+129", 123e+127);
     assert_print_number("1.23e-126", 123e-128);
-    assert_print_number("3.1415926535897931", 3.1415926535897931);
+    assert_print_number("3.141592653589793", 3.1415926535897931);
 }
 
 static void print_number_should_print_negative_reals(void)
@@ -100,6 +121,105 @@ static void print_number_should_print_negative_reals(void)
     assert_print_number("-1.23e-126", -123e-128);
 }
 
+static void print_number_should_print_shortest_round_trip(void)
+{
+    assert_print_number("0.1", 0.1);
+    assert_print_number("0.30000000000000004", 0.1 + 0.2);
+    assert_print_number("2.5e-07", 25e-8);
+    assert_print_number("0.0000025", 25e-7);
+    assert_print_number("123456789012345680", 123456789012345678.0);
+    assert_print_number("5e-324", 4.9406564584124654e-324);
+    assert_print_number("1.7976931348623157e+308", 1.7976931348623157e+308);
+}
+
+static void assert_print_fixed(const char *expected, double input, int decimals)
+{
+    unsigned char printed[64];
+    cJSON item[1];
+    printbuffer buffer = { 0, 0, 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL, NULL, 0 };
+    buffer.buffer = printed;
+    buffer.length = sizeof(printed);
+    buffer.noalloc = true;
+    buffer.hooks = global_hooks;
+
+    memset(item, 0, sizeof(item));
+    item->type = cJSON_Number;
+    cJSON_SetNumberValue(item, input);
+    TEST_ASSERT_TRUE(cJSON_SetNumberDecimals(item, decimals));
+    TEST_ASSERT_EQUAL_INT(decimals, cJSON_GetNumberDecimals(item));
+    TEST_ASSERT_TRUE_MESSAGE(print_number(item, &buffer), "Failed to print number.");
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(expected, (char*)printed, "Printed number is not as expected.");
+}
+
+static void print_number_should_print_fixed_decimals(void)
+{
+    assert_print_fixed("123.457", 123.4567, 3);
+    assert_print_fixed("2.00", 2.0, 2);
+    assert_print_fixed("-0.5", -0.45, 1);
+    assert_print_fixed("0.000", -0.0004, 3);
+    assert_print_fixed("-1", -1.4, 0);
+    /* too large to scale exactly: shortest instead */
+    assert_print_fixed("1e+300", 1e300, 2);
+    assert_print_fixed("0.1", 0.1, -1);
+
+    TEST_ASSERT_FALSE(cJSON_SetNumberDecimals(NULL, 2));
+    TEST_ASSERT_EQUAL_INT(-1, cJSON_GetNumberDecimals(NULL));
+}
+
+#ifdef CJSON_INT64
+static void print_number_should_print_exact_64_bit_integers(void)
+{
+    const char json[] = "[9007199254740993,-9223372036854775808,18446744073709551615,12]";
+    char *printed = NULL;
+    cJSON *array = cJSON_Parse(json);
+    cJSON *number = NULL;
+    cJSON_int64 value = 0;
+
+    TEST_ASSERT_NOT_NULL(array);
+    printed = cJSON_PrintUnformatted(array);
+    TEST_ASSERT_EQUAL_STRING(json, printed);
+    cJSON_free(printed);
+
+    /* cJSON_Compare and cJSON_Duplicate keep 64 bit neighbours apart */
+    number = cJSON_Parse("9007199254740992");
+    TEST_ASSERT_NOT_NULL(number);
+    TEST_ASSERT_FALSE(cJSON_Compare(cJSON_GetArrayItem(array, 0), number, true));
+    cJSON_Delete(number);
+    number = cJSON_Duplicate(cJSON_GetArrayItem(array, 0), false);
+    TEST_ASSERT_TRUE(cJSON_Compare(cJSON_GetArrayItem(array, 0), number, true));
+    cJSON_Delete(number);
+    cJSON_Delete(array);
+
+    array = cJSON_CreateArray();
+    TEST_ASSERT_NOT_NULL(array);
+    cJSON_AddItemToArray(array, cJSON_CreateInt64(-(cJSON_int64)4611686018427387904.0 * 2));
+    cJSON_AddItemToArray(array, cJSON_CreateUint64((cJSON_uint64)0 - 1));
+    number = cJSON_CreateInt64((cJSON_int64)1000000 * 1000000 * 1000000 + 1);
+    cJSON_AddItemToArray(array, number);
+    TEST_ASSERT_TRUE(cJSON_GetInt64Value(number, &value));
+    TEST_ASSERT_TRUE(value == (cJSON_int64)1000000 * 1000000 * 1000000 + 1);
+    printed = cJSON_PrintUnformatted(array);
+    TEST_ASSERT_EQUAL_STRING("[-9223372036854775808,18446744073709551615,1000000000000000001]", printed);
+    cJSON_free(printed);
+    cJSON_Delete(array);
+}
+#else
+static void print_number_should_print_64_bit_integers_as_doubles(void)
+{
+    /* without CJSON_INT64 they are stored as the nearest double */
+    char *printed = NULL;
+    cJSON *array = cJSON_CreateArray();
+
+    TEST_ASSERT_NOT_NULL(array);
+    cJSON_AddItemToArray(array, cJSON_CreateInt64(-12));
+    cJSON_AddItemToArray(array, cJSON_CreateUint64((cJSON_uint64)9007199254740992.0 + 1));
+    printed = cJSON_PrintUnformatted(array);
+    TEST_ASSERT_EQUAL_STRING("[-12,9007199254740992]", printed);
+    cJSON_free(printed);
+    cJSON_Delete(array);
+}
+#endif
+
 static void print_number_should_print_non_number(void)
 {
     TEST_IGNORE();
@@ -115,10 +235,18 @@ int CJSON_CDECL main(void)
     UNITY_BEGIN();
 
     RUN_TEST(print_number_should_print_zero);
+    RUN_TEST(print_number_should_print_zero_with_stale_valueint);
     RUN_TEST(print_number_should_print_negative_integers);
     RUN_TEST(print_number_should_print_positive_integers);
     RUN_TEST(print_number_should_print_positive_reals);
     RUN_TEST(print_number_should_print_negative_reals);
+    RUN_TEST(print_number_should_print_shortest_round_trip);
+    RUN_TEST(print_number_should_print_fixed_decimals);
+#ifdef CJSON_INT64
+    RUN_TEST(print_number_should_print_exact_64_bit_integers);
+#else
+    RUN_TEST(print_number_should_print_64_bit_integers_as_doubles);
+#endif
     RUN_TEST(print_number_should_print_non_number);
 
     return UNITY_END();
@@ -27,7 +27,7 @@
 static void assert_print_string(const char *expected, const char *input)
 {
     unsigned char printed[1024];
-    printbuffer buffer = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    printbuffer buffer = { 0, 0, 0, 0, 0, 0, { 0, 0, 0, 0 }, NULL, NULL, 0 };
     buffer.buffer = printed;
     buffer.length = sizeof(printed);
     buffer.offset = 0;
@@ -65,6 +65,38 @@ static void print_string_should_print_utf8(void)
     assert_print_string("\"ü猫慕\"", "ü猫慕");
 }
 
+static void print_string_should_escape_at_any_offset(void)
+{
+    char input[80];
+    char expected[90];
+    size_t position = 0;
+
+    /* one character to escape at every position of a string that spans several 16 byte blocks */
+    for (position = 0; position < 64; position++)
+    {
+        memset(input, 'a', 64);
+        input[64] = '\0';
+        input[position] = '\n';
+
+        expected[0] = '\"';
+        memset(expected + 1, 'a', position);
+        memcpy(expected + 1 + position, "\\n", 2);
+        memset(expected + 3 + position, 'a', 63 - position);
+        memcpy(expected + 66, "\"", 2);
+
+        assert_print_string(expected, input);
+    }
+}
+
+static void print_string_should_copy_long_clean_runs(void)
+{
+    static const char hex[] = "00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff0011223344";
+
+    assert_print_string("\"00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff0011223344\"", hex);
+    assert_print_string("\"00112233445566778899aabbccddeeff\\\"quoted\\\"00112233445566778899aabbccddeeff\\\\\"",
+            "00112233445566778899aabbccddeeff\"quoted\"00112233445566778899aabbccddeeff\\");
+}
+
 int CJSON_CDECL main(void)
 {
     /* initialize cJSON item */
@@ -73,6 +105,8 @@ int CJSON_CDECL main(void)
     RUN_TEST(print_string_should_print_empty_strings);
     RUN_TEST(print_string_should_print_ascii);
     RUN_TEST(print_string_should_print_utf8);
+    RUN_TEST(print_string_should_escape_at_any_offset);
+    RUN_TEST(print_string_should_copy_long_clean_runs);
 
     return UNITY_END();
 }
@@ -0,0 +1,238 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "unity/examples/unity_config.h"
+#include "unity/src/unity.h"
+#include "common.h"
+
+static size_t counted_mallocs = 0;
+static void * CJSON_CDECL counting_malloc(size_t size)
+{
+    counted_mallocs++;
+    return malloc(size);
+}
+
+typedef struct
+{
+    char text[4096];
+    size_t length;
+    size_t calls;
+    size_t largest;
+    size_t fail_after;
+} sink;
+
+static cJSON_bool sink_write(void *context, const char *data, size_t length)
+{
+    sink *s = (sink*)context;
+
+    if ((s->fail_after > 0) && (s->calls == s->fail_after))
+    {
+        return false;
+    }
+    TEST_ASSERT_TRUE((s->length + length) < sizeof(s->text));
+    memcpy(s->text + s->length, data, length);
+    s->length += length;
+    s->text[s->length] = '\0';
+    s->calls++;
+    if (length > s->largest)
+    {
+        s->largest = length;
+    }
+    return true;
+}
+
+static cJSON *create_report(void)
+{
+    cJSON *report = cJSON_CreateObject();
+    cJSON *imu = NULL;
+    cJSON_AddStringToObject(report, "type", "NAV");
+    cJSON_AddNumberToObject(report, "px", 1234);
+    cJSON_AddNumberToObject(report, "py", -56);
+    cJSON_AddNumberToObject(report, "speed", 12.5);
+    imu = cJSON_AddArrayToObject(report, "imu");
+    cJSON_AddItemToArray(imu, cJSON_CreateNumber(1));
+    cJSON_AddItemToArray(imu, cJSON_CreateTrue());
+    cJSON_AddItemToArray(imu, cJSON_CreateString("q \"x\"\n"));
+    return report;
+}
+
+static void writer_should_reuse_its_buffer(void)
+{
+    cJSON_Hooks hooks = { counting_malloc, free };
+    cJSON_Writer writer;
+    cJSON *report = NULL;
+    char *expected = NULL;
+    char *first = NULL;
+
+    cJSON_InitHooks(&hooks);
+    report = create_report();
+    expected = cJSON_PrintUnformatted(report);
+
+    cJSON_InitWriter(&writer, NULL, 0);
+    TEST_ASSERT_TRUE(cJSON_Write(&writer, report, false));
+    TEST_ASSERT_EQUAL_STRING(expected, writer.buffer);
+    TEST_ASSERT_EQUAL_UINT((unsigned int)strlen(expected), (unsigned int)writer.length);
+    first = writer.buffer;
+
+    /* the second print of the same shape allocates nothing */
+    counted_mallocs = 0;
+    TEST_ASSERT_TRUE(cJSON_Write(&writer, report, false));
+    TEST_ASSERT_EQUAL_INT(0, counted_mallocs);
+    TEST_ASSERT_EQUAL_PTR(first, writer.buffer);
+    TEST_ASSERT_EQUAL_STRING(expected, writer.buffer);
+
+    cJSON_FreeWriter(&writer);
+    TEST_ASSERT_NULL(writer.buffer);
+    cJSON_free(expected);
+    cJSON_Delete(report);
+    cJSON_InitHooks(NULL);
+}
+
+static void writer_should_grow_for_large_documents(void)
+{
+    cJSON_Writer writer;
+    cJSON *array = cJSON_CreateArray();
+    char *expected = NULL;
+    int i = 0;
+
+    for (i = 0; i < 200; i++)
+    {
+        cJSON_AddItemToArray(array, create_report());
+    }
+    expected = cJSON_Print(array);
+
+    cJSON_InitWriter(&writer, NULL, 0);
+    TEST_ASSERT_TRUE(cJSON_Write(&writer, array, true));
+    TEST_ASSERT_EQUAL_STRING(expected, writer.buffer);
+    TEST_ASSERT_TRUE(writer.size > writer.length);
+
+    cJSON_FreeWriter(&writer);
+    cJSON_free(expected);
+    cJSON_Delete(array);
+}
+
+static void fixed_writer_should_fail_when_full(void)
+{
+    char storage[256];
+    cJSON_Writer writer;
+    cJSON *report = create_report();
+    char *expected = cJSON_PrintUnformatted(report);
+
+    cJSON_InitWriter(&writer, storage, 16);
+    TEST_ASSERT_FALSE(cJSON_Write(&writer, report, false));
+    TEST_ASSERT_EQUAL_PTR(storage, writer.buffer);
+    TEST_ASSERT_EQUAL_UINT(0U, (unsigned int)writer.length);
+
+    cJSON_InitWriter(&writer, storage, sizeof(storage));
+    TEST_ASSERT_TRUE(cJSON_Write(&writer, report, false));
+    TEST_ASSERT_EQUAL_STRING(expected, storage);
+
+    /* caller storage is never freed */
+    cJSON_FreeWriter(&writer);
+    TEST_ASSERT_EQUAL_PTR(storage, writer.buffer);
+
+    cJSON_free(expected);
+    cJSON_Delete(report);
+}
+
+static void stream_writer_should_emit_chunks(void)
+{
+    static sink out;
+    char chunk[16];
+    cJSON_Writer writer;
+    cJSON *report = create_report();
+    char *expected = NULL;
+    cJSON_bool format = false;
+
+    for (format = false; format <= true; format++)
+    {
+        expected = format ? cJSON_Print(report) : cJSON_PrintUnformatted(report);
+        memset(&out, 0, sizeof(out));
+
+        cJSON_InitStreamWriter(&writer, chunk, sizeof(chunk), sink_write, &out);
+        TEST_ASSERT_TRUE(cJSON_Write(&writer, report, format));
+        TEST_ASSERT_EQUAL_STRING(expected, out.text);
+        TEST_ASSERT_EQUAL_UINT((unsigned int)strlen(expected), (unsigned int)writer.length);
+        TEST_ASSERT_TRUE(out.calls > 1);
+        TEST_ASSERT_TRUE(out.largest < sizeof(chunk));
+
+        cJSON_free(expected);
+    }
+
+    cJSON_Delete(report);
+}
+
+static void stream_writer_should_stop_when_write_fails(void)
+{
+    static sink out;
+    char chunk[16];
+    cJSON_Writer writer;
+    cJSON *report = create_report();
+
+    memset(&out, 0, sizeof(out));
+    out.fail_after = 2;
+    cJSON_InitStreamWriter(&writer, chunk, sizeof(chunk), sink_write, &out);
+    TEST_ASSERT_FALSE(cJSON_Write(&writer, report, false));
+    TEST_ASSERT_EQUAL_UINT(2U, (unsigned int)out.calls);
+
+    cJSON_Delete(report);
+}
+
+static void stream_writer_should_handle_long_strings(void)
+{
+    static sink out;
+    char chunk[16];
+    char *expected = NULL;
+    cJSON_Writer writer;
+    cJSON *item = cJSON_CreateString("a string that is longer than one chunk");
+
+    expected = cJSON_PrintUnformatted(item);
+
+    /* a fixed chunk can't hold it */
+    memset(&out, 0, sizeof(out));
+    cJSON_InitStreamWriter(&writer, chunk, sizeof(chunk), sink_write, &out);
+    TEST_ASSERT_FALSE(cJSON_Write(&writer, item, false));
+
+    /* a chunk buffer owned by cJSON grows */
+    memset(&out, 0, sizeof(out));
+    cJSON_InitStreamWriter(&writer, NULL, 0, sink_write, &out);
+    TEST_ASSERT_TRUE(cJSON_Write(&writer, item, false));
+    TEST_ASSERT_EQUAL_STRING(expected, out.text);
+    cJSON_FreeWriter(&writer);
+
+    cJSON_free(expected);
+    cJSON_Delete(item);
+}
+
+int CJSON_CDECL main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(writer_should_reuse_its_buffer);
+    RUN_TEST(writer_should_grow_for_large_documents);
+    RUN_TEST(fixed_writer_should_fail_when_full);
+    RUN_TEST(stream_writer_should_emit_chunks);
+    RUN_TEST(stream_writer_should_stop_when_write_fails);
+    RUN_TEST(stream_writer_should_handle_long_strings);
+
+    return UNITY_END();
+}
@@ -0,0 +1,193 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "unity/examples/unity_config.h"
+#include "unity/src/unity.h"
+#include "common.h"
+
+static cJSON_PushParser parser;
+
+static void feed(const char *text)
+{
+    TEST_ASSERT_TRUE(cJSON_PushFeed(&parser, text, strlen(text)));
+}
+
+static void push_parser_should_wait_for_the_closing_byte(void)
+{
+    static const char json[] = "{\"name\":\"a}b\",\"list\":[1,{\"x\":[]}]}";
+    cJSON *item = NULL;
+    size_t i = 0;
+
+    cJSON_InitPushParser(&parser, 0);
+    for (i = 0; i < sizeof(json) - 2; i++)
+    {
+        TEST_ASSERT_TRUE(cJSON_PushFeed(&parser, json + i, 1));
+        TEST_ASSERT_NULL(cJSON_PushNext(&parser));
+        TEST_ASSERT_FALSE(parser.failed);
+    }
+    TEST_ASSERT_TRUE(cJSON_PushFeed(&parser, json + i, 1));
+    item = cJSON_PushNext(&parser);
+
+    TEST_ASSERT_NOT_NULL(item);
+    TEST_ASSERT_EQUAL_STRING("a}b", cJSON_GetObjectItem(item, "name")->valuestring);
+    TEST_ASSERT_EQUAL_INT(2, cJSON_GetArraySize(cJSON_GetObjectItem(item, "list")));
+    TEST_ASSERT_NULL(cJSON_PushNext(&parser));
+    TEST_ASSERT_EQUAL_UINT(0, (unsigned int)parser.length);
+
+    cJSON_Delete(item);
+    cJSON_FreePushParser(&parser);
+}
+
+static void push_parser_should_split_a_stream_of_documents(void)
+{
+    cJSON *item = NULL;
+
+    cJSON_InitPushParser(&parser, 0);
+    feed(" {\"a\":1}[2,3]\n\"s\\\"]\" 42 tr");
+    feed("ue");
+
+    item = cJSON_PushNext(&parser);
+    TEST_ASSERT_TRUE(cJSON_IsObject(item));
+    cJSON_Delete(item);
+    item = cJSON_PushNext(&parser);
+    TEST_ASSERT_TRUE(cJSON_IsArray(item));
+    cJSON_Delete(item);
+    item = cJSON_PushNext(&parser);
+    TEST_ASSERT_EQUAL_STRING("s\"]", cJSON_GetStringValue(item));
+    cJSON_Delete(item);
+    item = cJSON_PushNext(&parser);
+    TEST_ASSERT_EQUAL_DOUBLE(42, cJSON_GetNumberValue(item));
+    cJSON_Delete(item);
+
+    /* a top-level literal may still continue */
+    TEST_ASSERT_NULL(cJSON_PushNext(&parser));
+    TEST_ASSERT_FALSE(parser.failed);
+    item = cJSON_PushFinish(&parser);
+    TEST_ASSERT_TRUE(cJSON_IsTrue(item));
+    cJSON_Delete(item);
+    TEST_ASSERT_NULL(cJSON_PushFinish(&parser));
+    TEST_ASSERT_FALSE(parser.failed);
+
+    cJSON_FreePushParser(&parser);
+}
+
+static void push_parser_should_handle_long_strings_across_chunks(void)
+{
+    static const char json[] = "[\"0123456789abcdef0123456789abcdef\\\\\\\"0123456789abcdef\",\"]\"]";
+    cJSON *item = NULL;
+    size_t i = 0;
+    size_t step = 0;
+
+    for (step = 1; step < sizeof(json); step += 5)
+    {
+        cJSON_InitPushParser(&parser, 0);
+        item = NULL;
+        for (i = 0; (i < sizeof(json) - 1) && (item == NULL); i += step)
+        {
+            size_t length = ((sizeof(json) - 1 - i) < step) ? (sizeof(json) - 1 - i) : step;
+            TEST_ASSERT_TRUE(cJSON_PushFeed(&parser, json + i, length));
+            item = cJSON_PushNext(&parser);
+        }
+        TEST_ASSERT_NOT_NULL(item);
+        TEST_ASSERT_EQUAL_STRING("0123456789abcdef0123456789abcdef\\\"0123456789abcdef", cJSON_GetArrayItem(item, 0)->valuestring);
+        TEST_ASSERT_EQUAL_STRING("]", cJSON_GetArrayItem(item, 1)->valuestring);
+        cJSON_Delete(item);
+        cJSON_FreePushParser(&parser);
+    }
+}
+
+static void push_parser_should_drop_a_bad_document_and_continue(void)
+{
+    cJSON *item = NULL;
+
+    cJSON_InitPushParser(&parser, 0);
+    feed("{\"a\":} ] {\"b\":2}");
+
+    TEST_ASSERT_NULL(cJSON_PushNext(&parser));
+    TEST_ASSERT_TRUE(parser.failed);
+    TEST_ASSERT_NULL(cJSON_PushNext(&parser));
+    TEST_ASSERT_TRUE(parser.failed);
+    item = cJSON_PushNext(&parser);
+    TEST_ASSERT_FALSE(parser.failed);
+    TEST_ASSERT_EQUAL_DOUBLE(2, cJSON_GetNumberValue(cJSON_GetObjectItem(item, "b")));
+    cJSON_Delete(item);
+
+    feed("[1,");
+    TEST_ASSERT_NULL(cJSON_PushFinish(&parser));
+    TEST_ASSERT_TRUE(parser.failed);
+    TEST_ASSERT_EQUAL_UINT(0, (unsigned int)parser.length);
+
+    cJSON_FreePushParser(&parser);
+}
+
+static void push_parser_should_respect_max_size(void)
+{
+    cJSON *item = NULL;
+
+    cJSON_InitPushParser(&parser, 8);
+    feed("[1,2]");
+    TEST_ASSERT_FALSE(cJSON_PushFeed(&parser, "[3,4]", 5));
+
+    /* returned documents don't count against the limit */
+    item = cJSON_PushNext(&parser);
+    TEST_ASSERT_NOT_NULL(item);
+    cJSON_Delete(item);
+    feed("[3,4,5]");
+    TEST_ASSERT_FALSE(cJSON_PushFeed(&parser, "]]", 2));
+
+    cJSON_ResetPushParser(&parser);
+    feed("[6]");
+    item = cJSON_PushNext(&parser);
+    TEST_ASSERT_EQUAL_DOUBLE(6, cJSON_GetNumberValue(cJSON_GetArrayItem(item, 0)));
+    cJSON_Delete(item);
+
+    cJSON_FreePushParser(&parser);
+}
+
+static void push_parser_should_reject_invalid_arguments(void)
+{
+    cJSON_InitPushParser(NULL, 0);
+    TEST_ASSERT_FALSE(cJSON_PushFeed(NULL, "1", 1));
+    TEST_ASSERT_NULL(cJSON_PushNext(NULL));
+    TEST_ASSERT_NULL(cJSON_PushFinish(NULL));
+
+    cJSON_InitPushParser(&parser, 0);
+    TEST_ASSERT_FALSE(cJSON_PushFeed(&parser, NULL, 1));
+    TEST_ASSERT_TRUE(cJSON_PushFeed(&parser, NULL, 0));
+    TEST_ASSERT_NULL(cJSON_PushFinish(&parser));
+    TEST_ASSERT_FALSE(parser.failed);
+    cJSON_FreePushParser(&parser);
+}
+
+int CJSON_CDECL main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(push_parser_should_wait_for_the_closing_byte);
+    RUN_TEST(push_parser_should_split_a_stream_of_documents);
+    RUN_TEST(push_parser_should_handle_long_strings_across_chunks);
+    RUN_TEST(push_parser_should_drop_a_bad_document_and_continue);
+    RUN_TEST(push_parser_should_respect_max_size);
+    RUN_TEST(push_parser_should_reject_invalid_arguments);
+
+    return UNITY_END();
+}
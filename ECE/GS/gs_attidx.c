@@ -0,0 +1,328 @@
+// gs_attidx.c
+// -----------------------------------------------------------------------------
+// Offline ATT analysis of a sniffed capture (replaces ubertooth/script.py):
+//   The capture (pcap or pcapng, as ubertooth-btle or gs_sniff's sources
+//   write it) is decoded once into a columnar index next to it,
+//   <capture>.attidx: frame number, time, handle, opcode, value hash and
+//   value offset per ATT write/notification, then the values themselves.
+//   Queries only read the columns they filter on, so picking the unique
+//   values of one opcode out of a long session takes milliseconds instead
+//   of one tshark pass over the whole file per filter. The index is rebuilt
+//   when the capture's size or mtime no longer match.
+//
+// Output, like script.py, one section per ATT opcode:
+//   Frame <n> | <opcode name> | <value hex> | <robot words>
+//   Robot words are decoded the way gs_sniff does: notifications through
+//   the report templates, writes as command type and priority.
+//
+// Usage: gs_attidx.o [-m write|notify|both] [-H HANDLE] [-a] [-r] [-i INDEX] CAPTURE
+//   -m  which packets (default both: write request/command, notification/indication)
+//   -H  only this attribute handle
+//   -a  every packet, not only the first one with each value
+//   -r  rebuild the index even if it is current
+//   -i  index file (default CAPTURE.attidx)
+//
+// Build example:
+//   make attidx
+// -----------------------------------------------------------------------------
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "includes/cmd_structure.h"
+#include "includes/cmd_parser/cmd_parser.h"
+#include "includes/cmd_parser/report_json.h"
+#include "includes/pcap_ingest/pcap_ingest.h"
+#include "hex_codec.h"
+
+#define ATTIDX_MAGIC "GSATTIX1"
+
+// Index file: header, then the columns (each padded to 8 bytes), then the values
+typedef struct {
+  char     magic[8];
+  uint64_t cap_size;                      // Capture it was built from
+  int64_t  cap_mtime_ns;
+  uint64_t n;                             // ATT packets
+  uint64_t blob;                          // Value bytes
+} attidx_hdr_t;
+
+typedef struct {
+  uint64_t  n;
+  uint64_t *frame;
+  uint64_t *ts_us;
+  uint32_t *value_off;                    // Into values
+  uint32_t *hash;                         // FNV-1a of the value
+  uint16_t *handle;
+  uint16_t *value_len;
+  uint8_t  *opcode;
+  uint8_t  *values;
+} attidx_t;
+
+static size_t pad8(size_t n) { return (n + 7) & ~(size_t)7; }
+
+// Column layout for n packets; returns the file size
+static size_t attidx_layout(attidx_t *ix, uint8_t *base, uint64_t n, uint64_t blob) {
+  size_t off = sizeof(attidx_hdr_t);
+  ix->n = n;
+  ix->frame     = (uint64_t *)(void *)(base + off); off += pad8(n * sizeof(uint64_t));
+  ix->ts_us     = (uint64_t *)(void *)(base + off); off += pad8(n * sizeof(uint64_t));
+  ix->value_off = (uint32_t *)(void *)(base + off); off += pad8(n * sizeof(uint32_t));
+  ix->hash      = (uint32_t *)(void *)(base + off); off += pad8(n * sizeof(uint32_t));
+  ix->handle    = (uint16_t *)(void *)(base + off); off += pad8(n * sizeof(uint16_t));
+  ix->value_len = (uint16_t *)(void *)(base + off); off += pad8(n * sizeof(uint16_t));
+  ix->opcode    = base + off;                       off += pad8(n);
+  ix->values    = base + off;                       off += pad8(blob);
+  return off;
+}
+
+static uint32_t fnv1a(const uint8_t *p, size_t n) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < n; i++) h = (h ^ p[i]) * 16777619u;
+  return h;
+}
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+// ------------------------- Building -------------------------
+
+typedef struct {
+  attidx_t ix;                            // Columns in separate growing arrays
+  uint64_t cap, blob, blob_cap;
+  int      oom;
+} attidx_build_t;
+
+static int grow(void **p, uint64_t count, size_t size) {
+  void *q = realloc(*p, count * size);
+  if (!q) return -1;
+  *p = q;
+  return 0;
+}
+
+static void on_record(void *ctx, const pcap_record_t *rec) {
+  attidx_build_t *b = (attidx_build_t *)ctx;
+  att_event_t ev;
+  if (b->oom || !ble_att_decode(rec->linktype, rec->data, rec->len, &ev)) return;
+
+  attidx_t *ix = &b->ix;
+  if (ix->n == b->cap) {
+    uint64_t c = b->cap ? b->cap * 2 : 1024;
+    if (grow((void **)&ix->frame, c, 8) || grow((void **)&ix->ts_us, c, 8) ||
+        grow((void **)&ix->value_off, c, 4) || grow((void **)&ix->hash, c, 4) ||
+        grow((void **)&ix->handle, c, 2) || grow((void **)&ix->value_len, c, 2) ||
+        grow((void **)&ix->opcode, c, 1)) { b->oom = 1; return; }
+    b->cap = c;
+  }
+  if (b->blob + ev.value_len > b->blob_cap) {
+    uint64_t c = b->blob_cap ? b->blob_cap * 2 : 65536;
+    while (c < b->blob + ev.value_len) c *= 2;
+    if (c > UINT32_MAX || grow((void **)&ix->values, c, 1)) { b->oom = 1; return; }
+    b->blob_cap = c;
+  }
+
+  uint64_t i = ix->n++;
+  ix->frame[i]     = rec->frame;
+  ix->ts_us[i]     = rec->ts_us;
+  ix->value_off[i] = (uint32_t)b->blob;
+  ix->hash[i]      = fnv1a(ev.value, ev.value_len);
+  ix->handle[i]    = ev.handle;
+  ix->value_len[i] = ev.value_len;
+  ix->opcode[i]    = ev.opcode;
+  memcpy(ix->values + b->blob, ev.value, ev.value_len);
+  b->blob += ev.value_len;
+}
+
+static int attidx_build(const char *cap_path, const struct stat *cst, const char *idx_path) {
+  static pcap_follow_t pf;                // 64 KiB window
+  attidx_build_t b;
+  memset(&b, 0, sizeof(b));
+
+  pcap_follow_init(&pf, cap_path);
+  int r = pcap_follow_poll(&pf, on_record, &b);   // Reads to the end of the file
+  pcap_follow_close(&pf);
+  if (r < 0 || pf.format <= 0) { fprintf(stderr, "%s: not a pcap/pcapng capture\n", cap_path); return -1; }
+  if (b.oom) { fprintf(stderr, "%s: out of memory\n", cap_path); return -1; }
+
+  attidx_t out;
+  size_t size = attidx_layout(&out, NULL, b.ix.n, b.blob);
+  uint8_t *buf = calloc(1, size);
+  if (!buf) { fprintf(stderr, "%s: out of memory\n", cap_path); return -1; }
+  attidx_layout(&out, buf, b.ix.n, b.blob);
+
+  attidx_hdr_t *h = (attidx_hdr_t *)(void *)buf;
+  memcpy(h->magic, ATTIDX_MAGIC, sizeof(h->magic));
+  h->cap_size = (uint64_t)cst->st_size;
+  h->cap_mtime_ns = (int64_t)cst->st_mtim.tv_sec * 1000000000 + cst->st_mtim.tv_nsec;
+  h->n = b.ix.n;
+  h->blob = b.blob;
+  if (b.ix.n) {
+    memcpy(out.frame, b.ix.frame, b.ix.n * 8);
+    memcpy(out.ts_us, b.ix.ts_us, b.ix.n * 8);
+    memcpy(out.value_off, b.ix.value_off, b.ix.n * 4);
+    memcpy(out.hash, b.ix.hash, b.ix.n * 4);
+    memcpy(out.handle, b.ix.handle, b.ix.n * 2);
+    memcpy(out.value_len, b.ix.value_len, b.ix.n * 2);
+    memcpy(out.opcode, b.ix.opcode, b.ix.n);
+  }
+  if (b.blob) memcpy(out.values, b.ix.values, b.blob);
+
+  // Written next to it and renamed, so a reader never sees half an index
+  char tmp[4096];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", idx_path);
+  FILE *f = fopen(tmp, "wb");
+  int ok = f && fwrite(buf, 1, size, f) == size;
+  if (f && fclose(f) != 0) ok = 0;
+  if (!ok || rename(tmp, idx_path) != 0) { perror(idx_path); unlink(tmp); ok = 0; }
+
+  free(buf);
+  free(b.ix.frame); free(b.ix.ts_us); free(b.ix.value_off); free(b.ix.hash);
+  free(b.ix.handle); free(b.ix.value_len); free(b.ix.opcode); free(b.ix.values);
+  return ok ? 0 : -1;
+}
+
+// ------------------------- Loading -------------------------
+
+// 0 = mapped and current for the capture, -1 = missing, stale or damaged
+static int attidx_open(attidx_t *ix, const char *idx_path, const struct stat *cst, void **map, size_t *map_len) {
+  int fd = open(idx_path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(attidx_hdr_t)) { close(fd); return -1; }
+  void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (m == MAP_FAILED) return -1;
+
+  const attidx_hdr_t *h = (const attidx_hdr_t *)m;
+  int64_t mtime_ns = (int64_t)cst->st_mtim.tv_sec * 1000000000 + cst->st_mtim.tv_nsec;
+  if (memcmp(h->magic, ATTIDX_MAGIC, sizeof(h->magic)) != 0 || h->cap_size != (uint64_t)cst->st_size ||
+      h->cap_mtime_ns != mtime_ns || h->n > (uint64_t)st.st_size || h->blob > UINT32_MAX ||
+      attidx_layout(ix, (uint8_t *)m, h->n, h->blob) != (size_t)st.st_size) {
+    munmap(m, (size_t)st.st_size);
+    return -1;
+  }
+  *map = m;
+  *map_len = (size_t)st.st_size;
+  return 0;
+}
+
+// ------------------------- Queries -------------------------
+
+static void print_words(uint8_t opcode, const uint8_t *v, size_t n) {
+  robot_bt_packet_t words[ROBOT_BATCH_MAX];
+  int k = sniff_value_words(v, n, words, ROBOT_BATCH_MAX);
+  int notify = (opcode == ATT_NOTIFY || opcode == ATT_INDICATE);
+  for (int i = 0; i < k; i++) {
+    char js[REPORT_JSON_MAX];
+    fputs(i ? ", " : " | ", stdout);
+    if (notify && robot_report_json(words[i], js, sizeof(js)) > 0) fputs(js, stdout);
+    else printf("cmd type=%u pl=%u", (unsigned)words[i].ctrl.type, (unsigned)words[i].ctrl.pl);
+  }
+}
+
+// One section: packets with this opcode (and handle), first of each value unless all
+static uint64_t query_opcode(const attidx_t *ix, uint8_t opcode, long handle, int all, uint64_t *seen, uint64_t mask) {
+  uint64_t shown = 0;
+  if (seen) memset(seen, 0, (mask + 1) * sizeof(*seen));
+
+  printf("\n=== %s ===\n", att_opcode_name(opcode));
+  for (uint64_t i = 0; i < ix->n; i++) {
+    if (ix->opcode[i] != opcode) continue;
+    if (handle >= 0 && ix->handle[i] != (uint16_t)handle) continue;
+    const uint8_t *v = ix->values + ix->value_off[i];
+    if (!ix->value_len[i]) continue;                  // script.py skips empty values too
+
+    if (!all) {                                       // Open addressing over earlier rows, by value hash
+      uint64_t s = ix->hash[i] & mask;
+      int dup = 0;
+      for (; seen[s]; s = (s + 1) & mask) {
+        uint64_t j = seen[s] - 1;
+        if (ix->hash[j] == ix->hash[i] && ix->value_len[j] == ix->value_len[i] &&
+            memcmp(ix->values + ix->value_off[j], v, ix->value_len[i]) == 0) { dup = 1; break; }
+      }
+      if (dup) continue;
+      seen[s] = i + 1;
+    }
+
+    char hex[2 * 65535 + 1];
+    hexc_encode(v, ix->value_len[i], hex, 0);
+    printf("Frame %llu | %s | %s", (unsigned long long)ix->frame[i], att_opcode_name(opcode), hex);
+    print_words(opcode, v, ix->value_len[i]);
+    putchar('\n');
+    shown++;
+  }
+  if (!shown) puts("No values found.");
+  return shown;
+}
+
+int main(int argc, char **argv) {
+  const char *mode = "both", *idx_arg = NULL;
+  long handle = -1;
+  int all = 0, rebuild = 0, opt;
+  while ((opt = getopt(argc, argv, "m:H:ari:")) != -1) {
+    switch (opt) {
+      case 'm': mode = optarg; break;
+      case 'H': handle = strtol(optarg, NULL, 0); break;
+      case 'a': all = 1; break;
+      case 'r': rebuild = 1; break;
+      case 'i': idx_arg = optarg; break;
+      default:
+        fprintf(stderr, "Usage: %s [-m write|notify|both] [-H HANDLE] [-a] [-r] [-i INDEX] CAPTURE\n", argv[0]);
+        return 1;
+    }
+  }
+  int want_write = strcmp(mode, "notify") != 0, want_notify = strcmp(mode, "write") != 0;
+  if (optind >= argc || (!want_write && !want_notify) ||
+      (strcmp(mode, "both") && strcmp(mode, "write") && strcmp(mode, "notify"))) {
+    fprintf(stderr, "Usage: %s [-m write|notify|both] [-H HANDLE] [-a] [-r] [-i INDEX] CAPTURE\n", argv[0]);
+    return 1;
+  }
+  const char *cap_path = argv[optind];
+  char idx_path[4096];
+  snprintf(idx_path, sizeof(idx_path), "%s", idx_arg ? idx_arg : cap_path);
+  if (!idx_arg) strncat(idx_path, ".attidx", sizeof(idx_path) - strlen(idx_path) - 1);
+
+  struct stat cst;
+  if (stat(cap_path, &cst) != 0) { perror(cap_path); return 1; }
+
+  attidx_t ix;
+  void *map = NULL;
+  size_t map_len = 0;
+  double t0 = now_ms();
+  if (rebuild || attidx_open(&ix, idx_path, &cst, &map, &map_len) != 0) {
+    if (attidx_build(cap_path, &cst, idx_path) != 0) return 1;
+    if (attidx_open(&ix, idx_path, &cst, &map, &map_len) != 0) { fprintf(stderr, "%s: unreadable\n", idx_path); return 1; }
+    fprintf(stderr, "Indexed %llu ATT packets of %s in %.1f ms\n", (unsigned long long)ix.n, cap_path, now_ms() - t0);
+  }
+
+  double t1 = now_ms();
+  uint64_t mask = 1, *seen = NULL;
+  while (mask < 2 * ix.n) mask <<= 1;
+  if (!all && !(seen = malloc(mask * sizeof(*seen)))) { fprintf(stderr, "out of memory\n"); return 1; }
+  mask--;
+
+  uint64_t shown = 0;
+  if (want_write) {
+    shown += query_opcode(&ix, ATT_WRITE_REQ, handle, all, seen, mask);
+    shown += query_opcode(&ix, ATT_WRITE_CMD, handle, all, seen, mask);
+  }
+  if (want_notify) {
+    shown += query_opcode(&ix, ATT_NOTIFY, handle, all, seen, mask);
+    shown += query_opcode(&ix, ATT_INDICATE, handle, all, seen, mask);
+  }
+  fflush(stdout);
+  fprintf(stderr, "%llu of %llu packets shown, query %.2f ms\n", (unsigned long long)shown,
+          (unsigned long long)ix.n, now_ms() - t1);
+
+  free(seen);
+  munmap(map, map_len);
+  return 0;
+}
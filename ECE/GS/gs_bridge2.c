@@ -2,13 +2,20 @@
 // -----------------------------------------------------------------------------
 // Bridge daemon:
 //   Node.js <-> Unix Domain Socket (JSON, length-prefixed) <-> C bridge
+//   (any number of UDS clients, up to UDS_MAX_CLIENTS, served by one epoll loop;
+//    GS_TCP_PORT takes the same clients over TCP, optionally TLS)
 //   C bridge <-> UART (BT2/RN-42 SPP) (binary framed 64-bit payload) <-> ESP32
+//   (a reader thread frames UART input into AT lines / +NOTIFY payloads)
 //
 // UART frame format (v1):
 //   [0]=0xAA [1]=0x55 [2]=len(=8) [3..10]=payload(8 bytes, big-endian) [11]=xor
+// UART frame format (v2, the RN-42 link with GS_RN42_FRAME=crc):
+//   [0]=0xAA [1]=0x55 [2]=len [3..3+len)=payload [+4]=CRC-32C (frame_crc.h)
 //
 // UDS frame format:
 //   4-byte big-endian length, then JSON bytes
+//   (or, once a client negotiates "bin1", a 12-byte pre-packed binary command
+//    or a 157-byte raw ciphertext frame, see UDS_BIN_* in cmd_parser.h)
 //
 // Build example:
 //   make all
@@ -17,23 +24,61 @@
 
 #define _GNU_SOURCE                     // Enables some GNU extensions (safe on Linux)
 #include <arpa/inet.h>                  // htonl/ntohl for endian conversion
+#include <netinet/tcp.h>                // TCP_NODELAY for GS_TCP_PORT peers
 #include <errno.h>                      // errno and error codes
 #include <fcntl.h>                      // open(), fcntl() flags
+#include <pthread.h>                    // pthread_sigmask()
+#include <signal.h>                     // SIGINT/SIGTERM set
 #include <stdint.h>                     // uint8_t/uint16_t/uint32_t/uint64_t
 #include <stdio.h>                      // printf(), perror()
 #include <stdlib.h>                     // malloc(), free(), getenv()
 #include <string.h>                     // memset(), memcpy(), strncpy(), strcmp()
-#include <sys/select.h>                 // select()
+#include <sys/eventfd.h>                // eventfd() for replay yields
+#include <sys/signalfd.h>               // signalfd() for a clean shutdown
 #include <sys/socket.h>                 // socket(), bind(), listen(), accept()
 #include <sys/stat.h>                   // chmod()
 #include <sys/un.h>                     // sockaddr_un for Unix domain sockets
 #include <termios.h>                    // termios UART config
+#include <time.h>                       // clock_gettime() for the UI's ts fields
 #include <unistd.h>                     // read(), write(), close(), unlink()
 #include "includes/cmd_structure.h"
 #include "../includes/ble/pmod_esp32.h"
 #include "includes/ble/uart_queue.h"
+#include "includes/ble/uart_reader.h"
+#include "includes/ble/ble_wnr.h"
+#include "includes/ble/gatt_cache.h"
+#include "includes/ble/link_sup.h"
+#include "includes/transport/transport.h"
 #include "includes/cmd_parser/cmd_parser.h"
+#include "includes/cmd_parser/tx_sched.h"
+#include "includes/cmd_parser/traj_upload.h"
+#include "includes/cmd_parser/link_bench.h"
+#include "includes/cmd_parser/cmd_trace.h"
+#include "includes/cmd_parser/robot_metrics.h"
+#include "includes/metrics/metrics.h"
+#include "includes/metrics/prof.h"
+#include "includes/recorder/recorder.h"
+#include "includes/recorder/rec_compact.h"
+#include "includes/recorder/replay.h"
+#include "includes/recorder/standby.h"
+#include "includes/log/gs_log.h"
+#include "includes/cmd_parser/report_json.h"
+#include "includes/cmd_parser/robot_state.h"
+#include "includes/cmd_parser/report_agg.h"
+#include "includes/cmd_parser/report_fec.h"
+#include "includes/tsdb/tsdb.h"
+#include "includes/config/gs_config.h"
+#include "includes/cmd_parser/ack_track.h"
+#include "includes/cmd_parser/clock_sync.h"
+#include "includes/cmd_parser/link_quality.h"
+#include "includes/cmd_parser/crypto_stage.h"
 #include "includes/json_uds/json_uds.h"
+#include "includes/json_uds/frame_pool.h"
+#include "includes/json_uds/uds_tls.h"
+#include "includes/event_loop/event_loop.h"
+#include "includes/event_loop/rt_tune.h"
+#include "includes/ws/ws_server.h"
+#include "includes/hardware_crypto/crypto_provider.h"
 
 #include "cJSON.h"                     // cJSON library header (vendored)
 // 004B1224B0A6
@@ -50,176 +95,1899 @@ int looks_like_json(const char *s) {
 }
 
 
+// ------------------------- Bridge state -------------------------
+// Every UDS peer (primary server, telemetry/recorder, ...) gets a slot, and
+// so does every UI client on the embedded WebSocket endpoint (c->ws).
+
+typedef struct {
+  int      fd;                                             // Client socket (-1 = free)
+  uds_rx_t rx;                                             // Partial-frame reassembly state
+  uds_tx_t tx;                                             // Outbound queue (writev + EPOLLOUT)
+  int      bin_mode;                                       // Negotiated binary command frames
+  int      gs_seal;                                        // Plaintext over TLS, the bridge seals
+  int      warned_plain;                                   // Unsealed plaintext in secure mode logged
+  shm_ring_t shm;                                          // {"T":"SHM"} transport (hdr NULL = socket)
+  ws_conn_t *ws;                                           // WebSocket UI client (NULL = UDS peer)
+  int        tcp;                                          // Peer on the GS_TCP_PORT listener
+  uds_tls_t *tls;                                          // ... behind TLS (GS_TCP_CERT), else NULL
+  int        seq;                                          // SOCK_SEQPACKET peer (GS_UDS_SEQ): no length prefix
+  uint16_t   ack_seq;                                      // rbw1: last word forwarded ...
+  uint16_t   ack_count;                                    // ... and words since the last ack
+} uds_client_t;
+
+static ev_loop_t    g_loop;                                // Single reactor for all fds
+static uds_client_t g_clients[UDS_MAX_CLIENTS];            // Connected Node-side clients
+static int          g_uart_fd = -1;                        // ESP32 UART (radio 0)
+static int          g_radio_fd[ESP_RADIOS_MAX] = { [0 ... ESP_RADIOS_MAX - 1] = -1 }; // UART per radio
+static int          g_radios_booting = 0;                  // Radios whose bring-up is still running
+static int          g_bt_connect_attempted = 0;            // Connect once on first client
+static int          g_at_tfd[ESP_RADIOS_MAX] = { [0 ... ESP_RADIOS_MAX - 1] = -1 }; // AT engine response timeout
+static int          g_wnr_tfd = -1;                        // Write-without-response pacing / guard
+static int          g_admit_tfd = -1;                      // tx_sched admission (parked words, ADMIT report)
+static int          g_sup_tfd[BLE_LINKS_MAX] = { [0 ... BLE_LINKS_MAX - 1] = -1 }; // Per-link reconnect backoff
+static int          g_transport_tfd = -1;                  // RN backends: reply timeouts
+static int          g_config_tfd = -1;                     // Deferred settings retry
+static int          g_bench_tfd = -1;                      // Link benchmark tick (link_bench.h)
+static int          g_tcp_tls = 0;                         // GS_TCP_PORT peers speak TLS (GS_TCP_CERT)
+static int          g_transport_retry_ms = LINK_SUP_BASE_MS; // RN backends: reconnect backoff
+
+static void uds_client_close(uds_client_t *c) {
+  if (c->fd < 0) return;
+  tx_sched_source_close((int)(c - g_clients));             // Its parked drive / arm words go
+  link_bench_client_gone(c->fd);
+  ev_del(&g_loop, c->fd);                                  // Stop watching before close
+#ifdef GS_WITH_TLS
+  uds_tls_close(c->tls);
+#endif
+  c->tls = NULL;
+  close(c->fd);
+  if (c->shm.hdr) {
+    ev_del(&g_loop, c->shm.bell[SHM_TO_BRIDGE]);
+    shm_ring_destroy(&c->shm);
+  }
+  uds_rx_reset(&c->rx);
+  uds_tx_close(&c->tx);
+  if (c->tcp) LOG_INFO("TCP client fd=%d disconnected.", c->fd);
+  else if (c->seq) LOG_INFO("Seqpacket client fd=%d disconnected.", c->fd);
+  else if (!c->ws) LOG_INFO("Node client fd=%d disconnected.", c->fd);
+  else if (c->ws->open) LOG_INFO("WS client fd=%d disconnected.", c->fd); // Refused Upgrades stay quiet
+  free(c->ws);
+  c->ws = NULL;
+  c->tcp = 0;
+  c->seq = 0;
+  c->fd = -1;
+}
+
+#define UDS_CLIENT_EVENTS (EPOLLIN | EPOLLRDHUP)
+
+// Outbound queue hook: arm EPOLLOUT only while a client has a backlog.
+static void uds_client_want_write(int fd, int on) {
+  ev_mod(&g_loop, fd, UDS_CLIENT_EVENTS | (on ? EPOLLOUT : 0));
+}
+
+// ------------------------- UDS frame dispatch -------------------------
+
+// {"T":"MODE","proto":"bin1"|"json"} switches how this client's frames are read.
+// Returns 1 if root was a MODE request (and has been answered).
+// {"T":"MODE","proto":"bin1"|"json","seal":"gs"|"ui"}
+// seal "gs": the client's UI link is TLS-protected and it sends plaintext
+// commands; in secure mode robot_send_packet applies the one GCM seal, so
+// there is no UI encrypt + GS decrypt round per command.
+static int handle_mode_request(uds_client_t *c, const cJSON *root) {
+  const cJSON *t = cJSON_GetObjectItemCaseSensitive(root, "T");
+  if (!cJSON_IsString(t) || strcmp(t->valuestring, "MODE") != 0) return 0;
+  if (c->ws) return 0;                                     // A UI client's framing is the WebSocket's
+
+  const cJSON *proto = cJSON_GetObjectItemCaseSensitive(root, "proto");
+  c->bin_mode = cJSON_IsString(proto) && strcmp(proto->valuestring, UDS_BIN_PROTO) == 0;
+
+  const cJSON *seal = cJSON_GetObjectItemCaseSensitive(root, "seal");
+  if (cJSON_IsString(seal)) c->gs_seal = strcmp(seal->valuestring, "gs") == 0;
+
+  char reply[96];
+  snprintf(reply, sizeof(reply), "{\"type\":\"MODE\",\"proto\":\"%s\",\"seal\":\"%s\"}",
+           c->bin_mode ? UDS_BIN_PROTO : "json", c->gs_seal ? "gs" : "ui");
+  uds_send_json(c->fd, reply);
+  LOG_INFO("UDS: client fd=%d using %s frames, %s sealing", c->fd,
+         c->bin_mode ? "binary" : "JSON", c->gs_seal ? "bridge" : "UI");
+  return 1;
+}
+
+static int on_uds_frame(void *ctx, char *frame, uint32_t len);
+
+// Bell 0: Node put frames in ring 0, or took enough of ring 1 to unblock us
+static void on_shm_bell(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events;
+  uds_client_t *c = (uds_client_t *)ctx;
+  if (uds_tx_flush(&c->tx) < 0) { uds_client_close(c); return; }
+  if (uds_rx_read_shm(&c->shm, &c->rx, on_uds_frame, c) < 0) {
+    LOG_WARN("UDS: bad frame in fd=%d's ring, dropping client", c->fd);
+    uds_client_close(c);
+  }
+}
+
+// {"T":"SHM"}: move this client's frames to shared-memory rings. The reply
+// carries the memfd and both bells; the socket then only signals liveness.
+static int handle_shm_request(uds_client_t *c, const cJSON *root) {
+  const cJSON *t = cJSON_GetObjectItemCaseSensitive(root, "T");
+  if (!cJSON_IsString(t) || strcmp(t->valuestring, "SHM") != 0) return 0;
+  if (c->ws || c->tcp || c->seq) return 0;                 // No fd passing over TCP; seqpacket needs no rings
+
+  const char *err = NULL;
+  if (c->shm.hdr) err = "shm already active";
+  else if (uds_tx_flush(&c->tx) != 0) err = "socket busy";  // The reply must not overtake queued frames
+  else if (shm_ring_create(&c->shm) != 0) err = "shm unavailable";
+  if (err) {
+    char reply[80];
+    snprintf(reply, sizeof(reply), "{\"type\":\"ERR\",\"msg\":\"%s\"}", err);
+    uds_send_json(c->fd, reply);
+    return 1;
+  }
+
+  char reply[64];
+  snprintf(reply, sizeof(reply), "{\"type\":\"SHM\",\"ring_bytes\":%u}", (unsigned)SHM_RING_BYTES);
+  if (ev_add(&g_loop, c->shm.bell[SHM_TO_BRIDGE], EPOLLIN, on_shm_bell, c) != 0
+      || shm_ring_send_fds(c->fd, reply, &c->shm) != 0) {
+    ev_del(&g_loop, c->shm.bell[SHM_TO_BRIDGE]);
+    shm_ring_destroy(&c->shm);
+    uds_send_json(c->fd, "{\"type\":\"ERR\",\"msg\":\"shm handoff failed\"}");
+    return 1;
+  }
+  c->tx.shm = &c->shm;
+  LOG_INFO("UDS: client fd=%d on shared-memory rings (%u KiB each way)", c->fd,
+           (unsigned)(SHM_RING_BYTES >> 10));
+  uds_send_json(c->fd, gs_crypto_report());                // The connect-time report, now on the ring
+  return 1;
+}
+
+// {"T":"SUB","topics":["acks","imu",...],"robots":[0,2]}: the broadcasts this
+// client gets (json_uds.h topics). A list left out means all of them; the
+// reply echoes what is now in force. Filtering happens at fan-out, so an
+// unsubscribed topic costs the client neither queue slots nor bytes.
+static int handle_sub_request(uds_client_t *c, const cJSON *root) {
+  const cJSON *t = cJSON_GetObjectItemCaseSensitive(root, "T");
+  if (!cJSON_IsString(t) || strcmp(t->valuestring, "SUB") != 0) return 0;
+
+  const cJSON *tl = cJSON_GetObjectItemCaseSensitive(root, "topics");
+  const cJSON *rl = cJSON_GetObjectItemCaseSensitive(root, "robots");
+  const cJSON *it;
+  uint32_t topics = UDS_TOPIC_ALL, robots = UINT32_MAX;
+  if (cJSON_IsArray(tl)) {
+    topics = 0;
+    cJSON_ArrayForEach(it, tl) {
+      uint32_t bit = cJSON_IsString(it) ? uds_topic_bit(it->valuestring) : 0;
+      if (!bit) { uds_send_json(c->fd, "{\"type\":\"ERR\",\"msg\":\"unknown topic\"}"); return 1; }
+      topics |= bit;
+    }
+  }
+  if (cJSON_IsArray(rl)) {
+    robots = 0;
+    cJSON_ArrayForEach(it, rl) {
+      if (!cJSON_IsNumber(it) || it->valueint < 0 || it->valueint > 31) {
+        uds_send_json(c->fd, "{\"type\":\"ERR\",\"msg\":\"robot out of range\"}");
+        return 1;
+      }
+      robots |= 1u << it->valueint;
+    }
+  }
+  c->tx.topics = topics;
+  c->tx.robots = robots;
+
+  char list[96], reply[512];
+  int n = snprintf(reply, sizeof(reply), "{\"type\":\"SUB\",\"topics\":%s,\"robots\":",
+                   uds_topic_list(topics, list, sizeof(list)) < 0 ? "[]" : list);
+  if (robots == UINT32_MAX) n += snprintf(reply + n, sizeof(reply) - (size_t)n, "\"all\"");
+  else {
+    n += snprintf(reply + n, sizeof(reply) - (size_t)n, "[");
+    for (int r = 0, first = 1; r < 32; r++) {
+      if (!(robots >> r & 1)) continue;
+      n += snprintf(reply + n, sizeof(reply) - (size_t)n, "%s%d", first ? "" : ",", r);
+      first = 0;
+    }
+    n += snprintf(reply + n, sizeof(reply) - (size_t)n, "]");
+  }
+  snprintf(reply + n, sizeof(reply) - (size_t)n, "}");
+  uds_send_json(c->fd, reply);
+  LOG_INFO("UDS: client fd=%d subscribed, topics 0x%02x robots 0x%08x", c->fd, topics, robots);
+  return 1;
+}
+
+// {"T":"METRICS"}: registry snapshot plus the queue depths sampled now
+static int handle_metrics_request(uds_client_t *c, const cJSON *root) {
+  const cJSON *t = cJSON_GetObjectItemCaseSensitive(root, "T");
+  if (!cJSON_IsString(t) || strcmp(t->valuestring, "METRICS") != 0) return 0;
+
+  uint64_t uds_clients = 0, ws_clients = 0, uds_queued = 0;
+  for (int i = 0; i < UDS_MAX_CLIENTS; i++) {
+    if (g_clients[i].fd < 0) continue;
+    if (g_clients[i].ws) ws_clients++;
+    else uds_clients++;
+    uds_queued += (uint64_t)g_clients[i].tx.count;
+  }
+  // Radio queues summed; per-radio depths only differ under load imbalance
+  uint64_t at_depth = 0, ring_depth = 0, ring_drops = 0, notify_depth = 0, notify_drops = 0;
+  int unit = at_engine_unit();
+  for (int r = 0; r < ble_radios(); r++) {
+    uart_queue_t *lq = uart_reader_lines(r), *nq = uart_reader_notify(r);
+    at_engine_use(r);
+    at_depth     += at_engine_depth();
+    ring_depth   += atomic_load(&lq->tail) - atomic_load(&lq->head);
+    ring_drops   += atomic_load(&lq->drops);
+    notify_depth += atomic_load(&nq->tail) - atomic_load(&nq->head);
+    notify_drops += atomic_load(&nq->drops);
+  }
+  at_engine_use(unit);
+
+  const tx_sched_stats_t *tx = tx_sched_stats();
+  const frame_pool_stats_t *fp = frame_pool_stats();
+  const metrics_gauge_t gauges[] = {
+    { "uds_clients",        uds_clients },
+    { "ws_clients",         ws_clients },
+    { "uds_tx_queued",      uds_queued },
+    { "at_queue_depth",     at_depth },
+    { "uart_ring_depth",    ring_depth },
+    { "uart_ring_drops",    ring_drops },
+    { "notify_ring_depth",  notify_depth },
+    { "notify_ring_drops",  notify_drops },
+    { "tx_sched_sent",      tx->sent },
+    { "tx_sched_coalesced", tx->coalesced },
+    { "tx_sched_fifo_full", tx->fifo_full },
+    { "tx_sched_stale",     tx->stale },
+    { "tx_sched_batched",   tx->batched },
+    { "tx_sched_shed",      tx->shed },
+    { "tx_sched_credit_waits", tx->credit_waits },
+    { "tx_sched_held",      tx->held },
+    { "tx_batch_window_us", tx_sched_window_us(0) },  // First robot's link
+    { "ack_inflight",       ack_track_inflight() },
+    { "ack_rto_us",         ack_track_rto_us(0) },     // First robot's link
+    { "link_quality",       (uint64_t)link_quality_level(0) },
+    { "link_loss_pm",       link_quality_loss_pm(0) },
+    { "exec_delay_ms",      clock_sync_delay_ms() },
+    { "clock_synced",       clock_sync_synced() },
+    { "crypto_stage_depth", crypto_stage_depth() },
+    { "recorder_slots",     rec_count() },
+    { "recorder_segments",  rec_compact_segments() },
+    { "recorder_lapped",    rec_compact_lapped() },
+    { "frame_heap_frames",  fp->heap_frames },
+    { "frame_heap_peak",    fp->heap_peak },
+    { "tsdb_bytes",         tsdb_bytes() },
+    { "config_pending",     (uint64_t)gs_config_pending() },
+  };
+
+  static char js[16384];                                   // Sparse buckets keep it far below this
+  int n = metrics_json(js, sizeof(js), gauges, (int)(sizeof(gauges) / sizeof(gauges[0])));
+  if (n < 0) uds_send_json(c->fd, "{\"type\":\"ERR\",\"msg\":\"metrics too large\"}");
+  else uds_send_json(c->fd, js);
+  return 1;
+}
+
+// {"T":"TSQ",...}: range / downsample query on the telemetry store (tsdb.h)
+static int handle_tsq_request(uds_client_t *c, const cJSON *root) {
+  const cJSON *t = cJSON_GetObjectItemCaseSensitive(root, "T");
+  if (!cJSON_IsString(t) || strcmp(t->valuestring, "TSQ") != 0) return 0;
+  if (!tsdb_enabled()) {
+    uds_send_json(c->fd, "{\"type\":\"ERR\",\"msg\":\"telemetry store off\"}");
+    return 1;
+  }
+
+  static char js[TSDB_REPLY_MAX];
+  const cJSON *src = cJSON_GetObjectItemCaseSensitive(root, "src");
+  tsdb_query_t q = { .rid = -1 };
+  json_get_i64(root, "rid", &q.rid);                   // Left alone unless an exact integer
+  if (!src) {
+    uds_send_json(c->fd, tsdb_stats_json(q.rid, js, sizeof(js)) < 0 ? "{\"type\":\"ERR\",\"msg\":\"tsq failed\"}" : js);
+    return 1;
+  }
+  q.src = cJSON_IsString(src) ? tsdb_src(src->valuestring) : -1;
+  if (q.src < 0) {
+    uds_send_json(c->fd, "{\"type\":\"ERR\",\"msg\":\"unknown src\"}");
+    return 1;
+  }
+  const cJSON *robot = cJSON_GetObjectItemCaseSensitive(root, "robot");
+  q.robot = cJSON_IsNumber(robot) ? robot->valueint : 0;
+  if (q.robot < 0 || q.robot >= BLE_LINKS_MAX) {
+    uds_send_json(c->fd, "{\"type\":\"ERR\",\"msg\":\"robot out of range\"}");
+    return 1;
+  }
+  const cJSON *fl = cJSON_GetObjectItemCaseSensitive(root, "fields"), *it;
+  if (cJSON_IsArray(fl)) {
+    cJSON_ArrayForEach(it, fl) {
+      int f = cJSON_IsString(it) ? tsdb_field(q.src, it->valuestring) : -1;
+      if (f < 0) { uds_send_json(c->fd, "{\"type\":\"ERR\",\"msg\":\"unknown field\"}"); return 1; }
+      q.fields |= 1u << f;
+    }
+  }
+  const cJSON *limit = cJSON_GetObjectItemCaseSensitive(root, "limit");
+  if (json_get_i64(root, "to", &q.to_ms) < 0) q.to_ms = tsdb_now_ms();
+  if (json_get_i64(root, "from", &q.from_ms) < 0) q.from_ms = q.to_ms - 60000;
+  if (json_get_i64(root, "step", &q.step_ms) < 0 || q.step_ms < 0) q.step_ms = 0;
+  q.limit = cJSON_IsNumber(limit) ? limit->valueint : 0;
+  uds_send_json(c->fd, tsdb_query_json(&q, js, sizeof(js)) < 0 ? "{\"type\":\"ERR\",\"msg\":\"tsq failed\"}" : js);
+  return 1;
+}
+
+// {"T":"PROF"[,"reset":1]}: folded stacks from the sampling profiler (prof.h)
+static int handle_prof_request(uds_client_t *c, const cJSON *root) {
+  const cJSON *t = cJSON_GetObjectItemCaseSensitive(root, "T");
+  if (!cJSON_IsString(t) || strcmp(t->valuestring, "PROF") != 0) return 0;
+  if (!prof_enabled()) {
+    uds_send_json(c->fd, "{\"type\":\"ERR\",\"msg\":\"profiler off (GS_PROF)\"}");
+    return 1;
+  }
+  static char js[PROF_REPLY_MAX];
+  const cJSON *reset = cJSON_GetObjectItemCaseSensitive(root, "reset");
+  int n = prof_folded_json(js, sizeof(js), cJSON_IsTrue(reset) || (cJSON_IsNumber(reset) && reset->valueint));
+  uds_send_json(c->fd, n < 0 ? "{\"type\":\"ERR\",\"msg\":\"prof failed\"}" : js);
+  return 1;
+}
+
+// ------------------------- Hot settings -------------------------
+// gs_config.h calls these when a key changes at runtime. Each one applies the
+// new value the way main did at startup, or asks to wait (CFG_PENDING) until
+// the work the old value governs has drained.
+
+static int config_log(const char *value) {
+  return gs_log_set_level(value) == 0 ? CFG_APPLIED : CFG_INVALID;
+}
+
+// The stage's in-flight seals finish on the provider that started them
+static int config_crypto(const char *value) {
+  if (crypto_stage_depth() > 0) return CFG_PENDING;
+  if (!value[0] || strcmp(value, "auto") == 0) {
+    if (gs_crypto_autoselect() != 0) return CFG_INVALID;
+  } else if (gs_crypto_use(value) != 0) {
+    return CFG_INVALID;
+  }
+  LOG_INFO("GCM provider: %s", gs_crypto_provider()->name);
+  return CFG_APPLIED;
+}
+
+static void on_uart_rate_done(int status, const char *value, void *ctx) {
+  (void)value;
+  if (status != AT_OK) LOG_WARN("radio %d: rate change failed (%d)", (int)(intptr_t)ctx, status);
+}
+
+// Every radio's AT queue empty, then the fast-UART steps on each
+static int config_uart_baud(const char *value) {
+  if (!transport_is_esp() || !at_engine_active()) return CFG_RESTART;
+  if (g_radios_booting > 0) return CFG_PENDING;
+  int unit = at_engine_unit(), busy = 0;
+  for (int r = 0; r < ble_radios(); r++) {
+    at_engine_use(r);
+    if (at_engine_depth() > 0) busy = 1;
+  }
+  at_engine_use(unit);
+  if (busy) return CFG_PENDING;
+
+  const char *flow = getenv("GS_UART_FLOW");
+  int rtscts = !(flow && strcmp(flow, "0") == 0);
+  if (!value[0] || ble_set_uart_rate(atoi(value), rtscts) != 0) return CFG_INVALID;
+  for (int r = 0; r < ble_radios(); r++) {
+    at_engine_use(r);
+    if (ble_uart_rate_async(g_radio_fd[r], on_uart_rate_done, (void *)(intptr_t)r) != 0)
+      LOG_WARN("radio %d: rate change could not be queued", r);
+  }
+  at_engine_use(unit);
+  return CFG_APPLIED;
+}
+
+static int config_mac_ok(const char *mac) {
+  unsigned b[6];
+  char end;
+  return strlen(mac) == 17 &&
+         sscanf(mac, "%2x:%2x:%2x:%2x:%2x:%2x%c", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &end) == 6;
+}
+
+// Same robots, some MACs changed: only those links drop and reconnect. A
+// different robot count needs new supervisor timers, so it waits for a restart.
+static int config_robots(const char *value) {
+  if (!transport_is_esp() || !link_sup_active()) return CFG_RESTART;
+  char list[BLE_LINKS_MAX * 20];
+  const char *mac[BLE_LINKS_MAX];
+  int n = 0;
+  if (strlen(value) >= sizeof(list)) return CFG_INVALID;
+  snprintf(list, sizeof(list), "%s", value);
+  for (char *save, *m = strtok_r(list, ",", &save); m; m = strtok_r(NULL, ",", &save)) {
+    if (n == BLE_LINKS_MAX || !config_mac_ok(m)) return CFG_INVALID;
+    mac[n++] = m;
+  }
+  if (n != ble_robots()) return CFG_RESTART;
+  for (int i = 0; i < n; i++)
+    if (strcasecmp(mac[i], ble_peer(i)) != 0 && link_sup_connecting(i)) return CFG_PENDING;
+
+  for (int i = 0; i < n; i++) {
+    if (strcasecmp(mac[i], ble_peer(i)) == 0) continue;
+    ble_set_peer(i, mac[i]);
+    LOG_INFO("Robot %d: now %s", i, mac[i]);
+    if (link_sup_kept(i)) link_sup_start(i);
+  }
+  return CFG_APPLIED;
+}
+
+static void config_arm(void) {
+  if (g_config_tfd >= 0) ev_timer_set(&g_loop, g_config_tfd, gs_config_pending() ? CONFIG_RETRY_MS : 0, 0);
+}
+
+static void on_config_timer(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  gs_config_poll();
+  config_arm();
+}
+
+// {"T":"CONFIG"[,"set":{KEY:value,...}][,"reload":true]}: runtime settings (gs_config.h)
+static int handle_config_request(uds_client_t *c, const cJSON *root) {
+  const cJSON *t = cJSON_GetObjectItemCaseSensitive(root, "T");
+  if (!cJSON_IsString(t) || strcmp(t->valuestring, "CONFIG") != 0) return 0;
+
+  static char js[4096];
+  const cJSON *set = cJSON_GetObjectItemCaseSensitive(root, "set");
+  const cJSON *reload = cJSON_GetObjectItemCaseSensitive(root, "reload");
+  if (!cJSON_IsObject(set) && !cJSON_IsTrue(reload)) {
+    uds_send_json(c->fd, gs_config_show(js, sizeof(js)) < 0 ? "{\"type\":\"ERR\",\"msg\":\"config failed\"}" : js);
+    return 1;
+  }
+  if (cJSON_IsTrue(reload) && gs_config_reload() < 0) {
+    uds_send_json(c->fd, "{\"type\":\"ERR\",\"msg\":\"config file unreadable\"}");
+    return 1;
+  }
+  const cJSON *it;
+  if (cJSON_IsObject(set)) {
+    cJSON_ArrayForEach(it, set) {
+      char num[32];
+      const char *v = cJSON_IsString(it) ? it->valuestring : NULL;
+      if (cJSON_IsNumber(it)) {
+        snprintf(num, sizeof(num), "%.15g", it->valuedouble);
+        v = num;
+      }
+      gs_config_set(it->string, v ? v : "\"");            // Not a string or number: counted invalid
+    }
+  }
+  config_arm();
+  uds_send_json(c->fd, gs_config_reply(js, sizeof(js)) < 0 ? "{\"type\":\"ERR\",\"msg\":\"config failed\"}" : js);
+  return 1;
+}
+
+static void dispatch_frame(uds_client_t *c, char *buf, uint32_t len) {
+  if (cmd_trace_enabled()) {                               // Binary frames carry the Node seq
+    int bin = (uint8_t)buf[0] == UDS_BIN_MAGIC && len >= UDS_BIN_HDR_LEN;
+    cmd_trace_frame(bin ? ((uint8_t)buf[2] << 8 | (uint8_t)buf[3]) : -1);
+  }
+
+  // Binary drive path: pre-packed word, no text parsing at all
+  if ((uint8_t)buf[0] == UDS_BIN_MAGIC) {
+    if (!c->bin_mode) {
+      uds_send_json(c->fd, "{\"type\":\"ERR\",\"msg\":\"binary mode not negotiated\"}");
+      return;
+    }
+    handle_node_bin(g_uart_fd, c->fd, (const uint8_t *)buf, len);
+    return;
+  }
+  if ((uint8_t)buf[0] == UDS_BIN_CIPHER_MAGIC) {
+    if (!c->bin_mode) {
+      uds_send_json(c->fd, "{\"type\":\"ERR\",\"msg\":\"binary mode not negotiated\"}");
+      return;
+    }
+    handle_encrypted_bin(g_uart_fd, c->fd, (const uint8_t *)buf, len);
+    return;
+  }
+
+  // Secure mode expects ciphertext unless this client handed sealing to us;
+  // the command is still sent (sealed below), but say so once
+  if (security_any() && !c->gs_seal && !c->warned_plain && looks_like_json(buf)) {
+    LOG_WARN("UDS: plaintext command from fd=%d in secure mode without seal negotiation", c->fd);
+    c->warned_plain = 1;
+  }
+
+  // Fast path: flat command objects are scanned in place with no allocation
+  if (handle_node_scan(g_uart_fd, c->fd, buf, len) != CMD_SCAN_FALLBACK) return;
+  // Longer documents: read just the command fields off a tape
+  if (len > CMD_INSITU_MAX && handle_node_tape(g_uart_fd, c->fd, buf, len) != CMD_SCAN_FALLBACK) return;
+
+  // Generic path: if it looks like JSON and parses, hand the tree straight to
+  // the dispatcher so each frame is parsed exactly once
+  if (looks_like_json(buf)) {
+    cJSON *root = cmd_json_parse(buf, len);
+    if (root) {
+      LOG_DEBUG("UDS->C plaintext JSON");
+      if (!handle_mode_request(c, root) && !handle_metrics_request(c, root) && !handle_shm_request(c, root)
+          && !handle_sub_request(c, root) && !handle_tsq_request(c, root)
+          && !handle_prof_request(c, root)
+          && !handle_config_request(c, root) && !handle_traj_request(g_uart_fd, c->fd, root)
+          && !handle_bench_request(g_uart_fd, c->fd, root))
+        handle_node_cmd(g_uart_fd, c->fd, root);
+      cmd_json_release(root);
+      return;
+    }
+    METRIC_INC(parse_failures);                            // Falls through to the cipher path
+  }
+  // If not handled, attempt decrypt path or send raw string over Bluetooth
+  handle_encrypted_data(g_uart_fd, c->fd, buf);
+}
+
+// ------------------------- Event handlers -------------------------
+
+// Called by the frame decoder for every complete frame on this client.
+static int on_uds_frame(void *ctx, char *frame, uint32_t len) {
+  uds_client_t *c = (uds_client_t *)ctx;
+  uint64_t t0 = metrics_now_us();
+  METRIC_INC(uds_frames_in);
+  rec_put(REC_UDS_IN, c->fd, frame, len);
+  tx_sched_source((int)(c - g_clients));                   // Admission bucket of this client
+  dispatch_frame(c, frame, len);
+  tx_sched_source(-1);
+  METRIC_OBSERVE(frame_us, metrics_now_us() - t0);
+  return 0;
+}
+
+static void on_uds_client(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd;
+  uds_client_t *c = (uds_client_t *)ctx;
+
+  if ((events & EPOLLOUT) && uds_tx_flush(&c->tx) < 0) { uds_client_close(c); return; }
+
+#ifdef GS_WITH_TLS
+  if (c->tls) {                                            // A record or the handshake may need either edge
+    if (!(events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && !uds_tls_want_write(c->tls)) return;
+    int r = uds_tls_read(c->tls, &c->rx, on_uds_frame, c);
+    if (r == -2) LOG_WARN("TCP: bad frame from fd=%d, dropping client", c->fd);
+    if (r < 0 || (events & (EPOLLHUP | EPOLLERR))) { uds_client_close(c); return; }
+    if (uds_tls_want_write(c->tls)) uds_client_want_write(c->fd, 1);
+    if (uds_tx_flush(&c->tx) < 0) uds_client_close(c);    // Writes a stalled read held back
+    return;
+  }
+#endif
+  if (!(events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) return;
+
+  // Edge-triggered: the decoder drains to EAGAIN and keeps any partial frame
+  // (a seqpacket peer's messages are whole frames, a batch per syscall)
+  int r = c->seq ? uds_rx_read_seq(c->fd, on_uds_frame, c) : uds_rx_read(c->fd, &c->rx, on_uds_frame, c);
+  if (r == -2) LOG_WARN("UDS: bad frame from fd=%d, dropping client", c->fd);
+  if (r < 0 || (events & (EPOLLHUP | EPOLLERR))) uds_client_close(c);
+}
+
+static void on_ble_connect_done(int status, const char *value, void *ctx) {
+  (void)value; (void)ctx;
+  connection_status = (status == AT_OK);
+  if (status != AT_OK)
+    LOG_INFO("BLE: connect attempt failed (%d, will not retry unless Node reconnects)", status);
+  else
+    LOG_INFO("BLE: connected, notifications enabled.");
+}
+
+static void on_ble_connect_timer(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)events; (void)ctx;
+  ev_timer_del(loop, fd);                                  // One-shot
+
+  //ONLY CONNECT ONCE BASED ON UI CONNECTION MAYBE REMOVE TO LET UI HAVE FULL CONTROL
+  const char *esp32_mac = ESP32_MAC;
+  if (ble_robots() > 1) LOG_INFO("BLE: connecting to %d robots...", ble_robots());
+  else LOG_INFO("BLE: connecting to ESP32 MAC %s...", esp32_mac);
+  if (link_sup_start(-1) == 0) return;                     // Supervised: every robot, reconnects on its own
+  if (at_engine_active()) {
+    if (ble_connect_async(g_uart_fd, esp32_mac, on_ble_connect_done, NULL) != 0)
+      LOG_INFO("BLE: connect could not be queued");
+    return;
+  }
+  if (ble_connect(g_uart_fd, esp32_mac) != 0) {
+    LOG_INFO("BLE: connect attempt failed (will not retry unless Node reconnects)");
+  } else {
+    LOG_INFO("BLE: connect command sent.");
+  }
+}
+
+// Async bring-up finished: connect straight away instead of waiting for the
+// first Node client; on failure that client still triggers the attempt.
+// With several radios the connect waits for the last one to finish booting.
+static void on_ble_init_done(int status, const char *value, void *ctx) {
+  (void)value;
+  int radio = (int)(intptr_t)ctx;
+  g_radios_booting--;
+  if (status != AT_OK) {
+    if (ble_radios() > 1) LOG_INFO("BLE: radio %d bring-up failed (%d)", radio, status);
+    else LOG_INFO("BLE: ESP32 bring-up failed (%d), connect deferred to first client", status);
+    return;
+  }
+  if (ble_radios() > 1) LOG_INFO("BLE: radio %d ready", radio);
+  else LOG_INFO("BLE: ESP32 ready");
+  if (g_bt_connect_attempted || g_radios_booting > 0) return;
+  g_bt_connect_attempted = 1;
+  ev_timer_add(&g_loop, 1, 0, on_ble_connect_timer, NULL);
+}
+
+// A slot for an accepted Node peer (UDS stream, UDS seqpacket or TCP)
+static int node_client_open(uds_client_t *c, int cfd, int tcp, int seq) {
+  c->fd = cfd;
+  c->bin_mode = 0;
+  c->gs_seal = 0;
+  c->warned_plain = 0;
+  c->tcp = tcp;
+  c->seq = seq;
+  c->tls = NULL;
+#ifdef GS_WITH_TLS
+  if (tcp && g_tcp_tls && !(c->tls = uds_tls_open(cfd))) {
+    close(cfd);
+    c->fd = -1;
+    return -1;
+  }
+#endif
+  uds_rx_init(&c->rx);
+  if (ev_add(&g_loop, cfd, UDS_CLIENT_EVENTS, on_uds_client, c) != 0) {
+#ifdef GS_WITH_TLS
+    uds_tls_close(c->tls);
+#endif
+    c->tls = NULL;
+    close(cfd);
+    c->fd = -1;
+    return -1;
+  }
+  uds_tx_init(&c->tx, cfd, uds_client_want_write);
+  c->tx.seq = (uint8_t)seq;
+#ifdef GS_WITH_TLS
+  if (c->tls) {
+    c->tx.io_writev = uds_tls_writev;
+    c->tx.io = c->tls;
+  }
+#endif
+  return 0;
+}
+
+static uds_client_t *client_slot(void) {
+  for (int i = 0; i < UDS_MAX_CLIENTS; i++) {
+    if (g_clients[i].fd < 0) return &g_clients[i];
+  }
+  return NULL;
+}
+
+// Try the BLE connect ONCE after the first client shows up. Deferred to a
+// timer so the accept path returns to the loop immediately.
+static void ble_connect_once(void) {
+  if (g_bt_connect_attempted) return;
+  g_bt_connect_attempted = 1;
+  ev_timer_add(&g_loop, 1, 0, on_ble_connect_timer, NULL);
+}
+
+static void on_uds_listen(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)events; (void)ctx;
+
+  while (1) {                                              // Accept every pending client
+    int cfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (cfd < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+      return;
+    }
+
+    uds_client_t *c = client_slot();
+    if (!c) {
+      LOG_WARN("UDS: client limit (%d) reached, rejecting", UDS_MAX_CLIENTS);
+      close(cfd);
+      continue;
+    }
+
+    if (node_client_open(c, cfd, 0, 0) != 0) continue;
+    LOG_INFO("Node client fd=%d connected.", cfd);
+    uds_send_json(cfd, gs_crypto_report());                // Health: active crypto provider + throughput
+    ble_connect_once();
+  }
+}
+
+// GS_UDS_SEQ=<path>: a second local socket, SOCK_SEQPACKET, for native
+// peers. The kernel keeps message boundaries, so frames carry no length
+// prefix either way and arrive a batch per recvmmsg() with no reassembly
+// (json_uds.h). Everything else is the stream client's.
+static void on_seq_listen(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)events; (void)ctx;
+
+  while (1) {
+    int cfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (cfd < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept seqpacket");
+      return;
+    }
+
+    uds_client_t *c = client_slot();
+    if (!c) {
+      LOG_WARN("UDS: client limit (%d) reached, rejecting", UDS_MAX_CLIENTS);
+      close(cfd);
+      continue;
+    }
+    if (node_client_open(c, cfd, 0, 1) != 0) continue;
+    LOG_INFO("Seqpacket client fd=%d connected.", cfd);
+    uds_send_json(cfd, gs_crypto_report());
+    ble_connect_once();
+  }
+}
+
+static int seq_setup(const char *path) {
+  if (!(path && path[0])) return -1;
+  int fd = uds_seq_listen(path);
+  if (fd >= 0 && ev_add(&g_loop, fd, EPOLLIN, on_seq_listen, NULL) != 0) {
+    close(fd);
+    unlink(path);
+    fd = -1;
+  }
+  if (fd < 0) LOG_WARN("UDS: no seqpacket listener at %s", path);
+  else LOG_INFO("UDS: seqpacket peers on %s (frames up to %d bytes)", path, UDS_SEQ_MSG_MAX);
+  return fd;
+}
+
+// ------------------------- TCP peers -------------------------
+// GS_TCP_PORT: a Node peer on another host (the fleet gateway in
+// server/production-server.js, GS_BRIDGES) gets the UDS protocol unchanged:
+// same length-prefixed frames, same slot, same handlers. Only the
+// shared-memory handoff needs the local socket. With GS_TCP_CERT/GS_TCP_KEY
+// the stream is TLS (uds_tls.h).
+
+static void on_tcp_listen(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)events; (void)ctx;
+
+  while (1) {
+    int cfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (cfd < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept tcp");
+      return;
+    }
+    int one = 1;
+    setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Commands are small frames
+
+    uds_client_t *c = client_slot();
+    if (!c) {
+      LOG_WARN("TCP: client limit (%d) reached, rejecting", UDS_MAX_CLIENTS);
+      close(cfd);
+      continue;
+    }
+    if (node_client_open(c, cfd, 1, 0) != 0) continue;
+    LOG_INFO("TCP client fd=%d connected%s.", cfd, c->tls ? " (TLS)" : "");
+    uds_send_json(cfd, gs_crypto_report());
+    ble_connect_once();
+  }
+}
+
+// GS_TCP_PORT=<n> [GS_TCP_BIND=<ipv4>, loopback by default]
+// [GS_TCP_CERT=<pem> GS_TCP_KEY=<pem>, needs make TLS=1]
+static int tcp_setup(void) {
+  const char *port = getenv("GS_TCP_PORT");
+  if (!(port && atoi(port) > 0)) return -1;
+  const char *bind_addr = getenv("GS_TCP_BIND");
+  const char *cert = getenv("GS_TCP_CERT");
+  if (cert && cert[0]) {
+#ifdef GS_WITH_TLS
+    const char *key = getenv("GS_TCP_KEY");               // Unset: the key is in the cert file
+    if (uds_tls_setup(cert, key && key[0] ? key : cert) != 0) {
+      LOG_WARN("TCP: TLS setup failed, no listener on port %s", port);
+      return -1;
+    }
+    g_tcp_tls = 1;
+#else
+    LOG_WARN("TCP: GS_TCP_CERT needs a make TLS=1 build, no listener on port %s", port);
+    return -1;
+#endif
+  }
+
+  int fd = uds_tcp_listen(bind_addr, atoi(port));
+  if (fd >= 0 && ev_add(&g_loop, fd, EPOLLIN, on_tcp_listen, NULL) != 0) {
+    close(fd);
+    fd = -1;
+  }
+  if (fd < 0) { LOG_WARN("TCP: no listener on port %s", port); return -1; }
+  LOG_INFO("TCP: peers on %s:%s%s", bind_addr && bind_addr[0] ? bind_addr : "127.0.0.1", port,
+           g_tcp_tls ? " (TLS)" : "");
+  if (!g_tcp_tls && bind_addr && bind_addr[0] && strncmp(bind_addr, "127.", 4) != 0)
+    LOG_WARN("TCP: plaintext commands off this host, set GS_TCP_CERT/GS_TCP_KEY for TLS");
+  return fd;
+}
+
+// ------------------------- WebSocket UI clients -------------------------
+// GS_WS_PORT: the controller UI connects to the bridge directly (ws_server.h).
+// A UI client holds a g_clients slot like a Node peer, so command replies and
+// robot reports reach it through the same send queue, and each message is
+// turned into the frame Node would have sent for it (wsOnMessage in
+// server/production-server.js):
+//   {"direction":"w|a|s|d",...}    compact Control, as directionToC builds it
+//   {"T"|"type":"C",...}           compact Control, every field clamped
+//   any other bridge type          forwarded, a legacy "type" key renamed "T"
+//   other text, a JSON string      raw, down the ciphertext path
+//   rbw1 word / 156-byte binary    binary command / ciphertext frame
+// The {"type":"ack"} Node answers with goes out before the bridge's own reply;
+// rbw1 words are acked in batches, at WS_ACK_BATCH_MAX or the end of the pass.
+
+#define WS_WORD_FRAME    (2 + 8)                           // rbw1: [seq u16 BE][robot_bt_packet_t]
+#define WS_ACK_MAGIC     0xAC                              // [magic][status 0][seq u16 BE][count u16 BE]
+#define WS_ACK_BATCH_MAX 32
+
+static int  g_ws_rbw1 = 1;                                 // GS_WS_BINARY=0: JSON only
+static int  g_ws_speed = 50;                               // DEFAULT_SPEED, read like the Node server does
+static int  g_ws_priority = 0;                             // DEFAULT_PRIORITY
+static int  g_ws_speed_override = 1;                       // ALLOW_SPEED_OVERRIDE
+static char g_ws_scratch[WS_RX_MAX + 1];                   // Parsed copy: the message stays intact to forward
+static char g_ws_out[WS_RX_MAX + 128];                     // Rewritten frame, or an ERR quoting the message
+
+static unsigned long long ws_now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);                      // The UI's ts fields are Date.now()
+  return (unsigned long long)ts.tv_sec * 1000 + (unsigned long long)ts.tv_nsec / 1000000;
+}
+
+// clampInt(): Number(v) truncated into [lo, hi], fallback when not finite
+static int ws_clamp(const cJSON *v, int lo, int hi, int fallback) {
+  double d;
+  if (!v) return fallback;
+  if (cJSON_IsNumber(v)) d = v->valuedouble;
+  else if (cJSON_IsBool(v)) d = cJSON_IsTrue(v);
+  else if (cJSON_IsNull(v)) d = 0;
+  else if (cJSON_IsString(v)) {
+    char *end;
+    d = strtod(v->valuestring, &end);
+    while (*end == ' ' || *end == '\t') end++;
+    if (*end) return fallback;
+  } else return fallback;
+  if (!(d == d) || d < -1e18 || d > 1e18) return fallback;  // NaN / Infinity
+  if (d < lo) return lo;
+  if (d > hi) return hi;
+  return (int)d;
+}
+
+static int ws_truthy(const cJSON *v) {
+  if (!v || cJSON_IsFalse(v) || cJSON_IsNull(v)) return 0;
+  if (cJSON_IsString(v)) return v->valuestring[0] != '\0';
+  if (cJSON_IsNumber(v)) return v->valuedouble != 0;
+  return 1;
+}
+
+static const cJSON *ws_field(const cJSON *o, const char *key) {
+  return cJSON_GetObjectItemCaseSensitive(o, key);
+}
+
+static int ws_control(char *out, size_t n, int f, int b, int l, int r, int s, int pl, int id) {
+  return snprintf(out, n, "{\"T\":\"C\",\"F\":%d,\"B\":%d,\"L\":%d,\"R\":%d,\"S\":%d,\"PL\":%d,\"ID\":%d}",
+                  f, b, l, r, s, pl, id);
+}
+
+static void ws_reply(uds_client_t *c, const char *type, const char *msg, const char *sent) {
+  char js[192];
+  int n = snprintf(js, sizeof(js), "{\"type\":\"%s\"", type);
+  if (msg) n += snprintf(js + n, sizeof(js) - (size_t)n, ",\"msg\":\"%s\"", msg);
+  if (sent) n += snprintf(js + n, sizeof(js) - (size_t)n, ",\"sent\":%s", sent);
+  snprintf(js + n, sizeof(js) - (size_t)n, ",\"ts\":%llu}", ws_now_ms());
+  uds_send_json(c->fd, js);
+}
+
+static void ws_ack_flush(uds_client_t *c) {
+  if (c->ack_count == 0) return;
+  uint8_t a[6] = { WS_ACK_MAGIC, 0, (uint8_t)(c->ack_seq >> 8), (uint8_t)c->ack_seq,
+                   (uint8_t)(c->ack_count >> 8), (uint8_t)c->ack_count };
+  c->ack_count = 0;
+  if (uds_tx_enqueue_ws(&c->tx, WS_OP_BINARY, a, sizeof(a)) == 0) uds_tx_flush(&c->tx);
+}
+
+// Pong / close echo from the frame parser, queued behind whatever is pending
+static int ws_send_ctl(void *ctx, int op, const void *data, uint32_t len) {
+  uds_client_t *c = (uds_client_t *)ctx;
+  if (uds_tx_enqueue_ws(&c->tx, op, data, len) != 0) return -1;
+  return uds_tx_flush(&c->tx) < 0 ? -1 : 0;
+}
+
+// One whole UI message. Every branch is done with the parsed tree before the
+// frame goes in: dispatch parses into the same arena.
+static int on_ws_message(void *ctx, int op, char *msg, uint32_t len) {
+  uds_client_t *c = (uds_client_t *)ctx;
+  METRIC_INC(ws_msgs_in);
+
+  if (op == WS_OP_BINARY && c->ws->rbw1 && len == WS_WORD_FRAME) {
+    char frame[UDS_BIN_FRAME_LEN + 1] = { 0 };
+    frame[0] = (char)UDS_BIN_MAGIC;
+    frame[1] = (char)(((uint8_t)msg[2] >> 2) & 0x1F);      // Type bits of the word itself
+    memcpy(frame + 2, msg, WS_WORD_FRAME);                 // seq, then the word
+    on_uds_frame(c, frame, UDS_BIN_FRAME_LEN);
+    c->ack_seq = (uint16_t)((uint8_t)msg[0] << 8 | (uint8_t)msg[1]);
+    if (++c->ack_count >= WS_ACK_BATCH_MAX) ws_ack_flush(c);
+    return 0;
+  }
+  if (op == WS_OP_BINARY && len == TOTAL_SZ) {              // One raw ciphertext packet
+    char frame[UDS_BIN_CIPHER_LEN + 1] = { 0 };
+    frame[0] = (char)UDS_BIN_CIPHER_MAGIC;
+    memcpy(frame + 1, msg, TOTAL_SZ);
+    ws_reply(c, "ack", "sent", NULL);
+    on_uds_frame(c, frame, UDS_BIN_CIPHER_LEN);
+    return 0;
+  }
+
+  memcpy(g_ws_scratch, msg, (size_t)len + 1);
+  cJSON *root = cmd_json_parse(g_ws_scratch, len);
+  char *fwd = msg;
+  uint32_t fwd_len = len;
+
+  if (!root || cJSON_IsString(root)) {                     // Plain string: raw to the bridge
+    if (root) {
+      fwd_len = (uint32_t)strlen(root->valuestring);
+      memcpy(g_ws_out, root->valuestring, (size_t)fwd_len + 1);
+      fwd = g_ws_out;
+      cmd_json_release(root);
+    }
+    ws_reply(c, "ack", "sent", NULL);
+    on_uds_frame(c, fwd, fwd_len);
+    return 0;
+  }
+
+  cJSON *type = (cJSON *)ws_field(root, "type");
+  const cJSON *tc = ws_field(root, "T");
+  const cJSON *dir = ws_field(root, "direction");
+  const char *t = tc ? (cJSON_IsString(tc) ? tc->valuestring : NULL)
+                     : (cJSON_IsString(type) ? type->valuestring : NULL);
+
+  if (cJSON_IsString(type) && strcmp(type->valuestring, "ping") == 0) {
+    cmd_json_release(root);
+    ws_reply(c, "pong", NULL, NULL);
+    return 0;
+  }
+
+  if (ws_truthy(dir)) {                                    // directionToC
+    const char *d = cJSON_IsString(dir) ? dir->valuestring : "";
+    int speed = g_ws_speed_override ? ws_clamp(ws_field(root, "speed"), 0, 100, g_ws_speed) : g_ws_speed;
+    fwd_len = (uint32_t)ws_control(g_ws_out, sizeof(g_ws_out), strcasecmp(d, "w") == 0, strcasecmp(d, "s") == 0,
+                                   strcasecmp(d, "a") == 0, strcasecmp(d, "d") == 0, speed, g_ws_priority,
+                                   ws_clamp(ws_field(root, "id"), 0, 255, 1));
+    cmd_json_release(root);
+    ws_reply(c, "ack", "sent", g_ws_out);
+    on_uds_frame(c, g_ws_out, fwd_len);
+    return 0;
+  }
+
+  if (t && strcmp(t, "C") == 0) {                          // compactControlMessage
+    int compact = tc != NULL;
+    const cJSON *id = compact ? ws_field(root, "ID") : ws_field(root, "id");
+    if (!compact && (!id || cJSON_IsNull(id))) id = ws_field(root, "ID");
+    fwd_len = (uint32_t)ws_control(g_ws_out, sizeof(g_ws_out),
+                                   ws_clamp(ws_field(root, compact ? "F" : "forward"), 0, 1, 0),
+                                   ws_clamp(ws_field(root, compact ? "B" : "backward"), 0, 1, 0),
+                                   ws_clamp(ws_field(root, compact ? "L" : "left"), 0, 1, 0),
+                                   ws_clamp(ws_field(root, compact ? "R" : "right"), 0, 1, 0),
+                                   ws_clamp(ws_field(root, compact ? "S" : "speed"), 0, 100, g_ws_speed),
+                                   ws_clamp(ws_field(root, compact ? "PL" : "priority_level"), 0, 3, g_ws_priority),
+                                   ws_clamp(id, 0, 255, 1));
+    fwd = g_ws_out;
+  } else if (t && t[0] && strcmp(t, "ping") && strcmp(t, "pong") && strcmp(t, "hello")
+             && strcmp(t, "ack") && strcmp(t, "ERR") && strcmp(t, "INFO")) {
+    if (!tc) {                                             // Legacy key: "type" becomes "T" in place
+      memcpy(type->string, "T", 2);                        // (the key buffer held "type")
+      cJSON_Writer w;
+      cJSON_InitWriter(&w, g_ws_out, sizeof(g_ws_out));
+      if (!cJSON_Write(&w, root, 0)) {
+        cmd_json_release(root);
+        ws_reply(c, "ERR", "message too large", NULL);
+        return 0;
+      }
+      fwd = g_ws_out;
+      fwd_len = (uint32_t)w.length;
+    }                                                      // Already "T": the bytes go as they came
+  } else {
+    cmd_json_release(root);
+    snprintf(g_ws_out, sizeof(g_ws_out), "{\"type\":\"ERR\",\"msg\":\"unknown message format\",\"got\":%s,\"ts\":%llu}",
+             msg, ws_now_ms());
+    uds_send_json(c->fd, g_ws_out);
+    return 0;
+  }
+
+  cmd_json_release(root);
+  ws_reply(c, "ack", "sent", NULL);
+  on_uds_frame(c, fwd, fwd_len);
+  return 0;
+}
+
+// Upgrade answered: from here on the client has a send queue like a Node peer
+static void ws_client_open(uds_client_t *c) {
+  uds_tx_init(&c->tx, c->fd, uds_client_want_write);
+  c->tx.ws = 1;
+  LOG_INFO("WS client fd=%d connected%s.", c->fd, c->ws->rbw1 ? " (" WS_SUBPROTO ")" : "");
+  ws_reply(c, "hello", NULL, NULL);
+  uds_send_json(c->fd, gs_crypto_report());
+  ble_connect_once();
+}
+
+static void on_ws_client(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd;
+  uds_client_t *c = (uds_client_t *)ctx;
+
+  if ((events & EPOLLOUT) && uds_tx_flush(&c->tx) < 0) { uds_client_close(c); return; }
+  if (!(events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) return;
+
+  int r;
+  while ((r = ws_read(c->fd, c->ws, g_ws_rbw1, on_ws_message, ws_send_ctl, c)) == 1) ws_client_open(c);
+  if (c->ws->open) ws_ack_flush(c);
+  if (r == -2) LOG_WARN("WS: protocol error from fd=%d, dropping client", c->fd);
+  if (r < 0 || (events & (EPOLLHUP | EPOLLERR))) uds_client_close(c);
+}
+
+static void on_ws_listen(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)events; (void)ctx;
+
+  while (1) {
+    int cfd = ws_accept(fd);
+    if (cfd < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept ws");
+      return;
+    }
+
+    uds_client_t *c = client_slot();
+    ws_conn_t *ws = c ? malloc(sizeof(*ws)) : NULL;
+    if (!ws) {
+      LOG_WARN("WS: client limit (%d) reached, rejecting", UDS_MAX_CLIENTS);
+      close(cfd);
+      continue;
+    }
+    ws_conn_init(ws);
+    c->fd = cfd;
+    c->ws = ws;
+    c->bin_mode = 1;                                       // Binary frames are built by the bridge itself
+    c->gs_seal = 0;
+    c->warned_plain = 0;
+    c->ack_count = 0;
+    uds_rx_init(&c->rx);
+    if (ev_add(loop, cfd, UDS_CLIENT_EVENTS, on_ws_client, c) != 0) {
+      close(cfd);
+      free(ws);
+      c->ws = NULL;
+      c->fd = -1;
+    }
+  }
+}
+
+// GS_WS_PORT=<n> [GS_WS_BIND=<ipv4>] [GS_WS_BINARY=0]; the Control defaults
+// come from the Node server's own variables so both endpoints map alike
+static int ws_setup(void) {
+  const char *port = getenv("GS_WS_PORT");
+  if (!(port && atoi(port) > 0)) return -1;
+  const char *bind_addr = getenv("GS_WS_BIND");
+  const char *bin = getenv("GS_WS_BINARY");
+  const char *speed = getenv("DEFAULT_SPEED");
+  const char *prio = getenv("DEFAULT_PRIORITY");
+  const char *over = getenv("ALLOW_SPEED_OVERRIDE");
+  if (bin && strcmp(bin, "0") == 0) g_ws_rbw1 = 0;
+  if (speed && speed[0]) g_ws_speed = atoi(speed);
+  if (prio && prio[0]) g_ws_priority = atoi(prio);
+  if (over && strcmp(over, "0") == 0) g_ws_speed_override = 0;
+
+  int fd = ws_listen(bind_addr, atoi(port));
+  if (fd >= 0 && ev_add(&g_loop, fd, EPOLLIN, on_ws_listen, NULL) != 0) {
+    close(fd);
+    fd = -1;
+  }
+  if (fd < 0) LOG_WARN("WS: no listener on port %s, the UI stays on the Node server", port);
+  else LOG_INFO("WS: UI endpoint ws://%s:%s%s", bind_addr && bind_addr[0] ? bind_addr : "0.0.0.0", port,
+                g_ws_rbw1 ? " (" WS_SUBPROTO " offered)" : "");
+  return fd;
+}
+
+static void on_uart(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)events; (void)ctx;
+
+  int n;
+  do {
+    n = ble_uart_check(fd);                                // read() lands in a ring slot
+
+    const uint8_t *span;
+    size_t len;
+    while ((span = uart_queue_peek(&uart_queue, &len)) != NULL) {
+      rec_put(REC_UART_RX, 0, span, len);
+      LOG_INFO("[UART OUTPUT] %.*s", (int)len, (const char *)span);
+      uart_queue_release(&uart_queue);
+    }
+  } while (n > 0);                                         // Until EAGAIN (edge-triggered)
+}
+
+// ------------------------- Robot notifications -------------------------
+
+// One report word from robot ble_route, through every consumer
+static void on_robot_word(robot_bt_packet_t *w) {
+  robot_bt_packet_t acks[ACK_RANGE_BITS + 1];              // An ACK range is handled as its ACKs
+  tx_sched_credit(ble_route, w);
+  int k = robot_ack_expand(w, acks);
+  for (int j = 0; j < k; j++) {
+    char js[REPORT_JSON_MAX];                              // Templated, no cJSON tree
+    if (clock_sync_ack(ble_route, &acks[j])) continue;     // The bridge's own CLOCK_SYNC
+    robot_bt_packet_t wire = acks[j];                      // Trace records go by the id on the wire
+    int own = link_quality_ack(ble_route, &acks[j]);       // The bridge's own telemetry gap SUBSCRIBE
+    ack_track_ack(ble_route, &acks[j]);                    // Client's id back in the ACK
+    if (own) continue;
+    link_bench_ack(ble_route, &acks[j]);                   // A BENCH run's LINK_ECHO 1
+    robot_state_report(ble_route, &acks[j]);               // Feeds the query cache
+    report_agg_sample(ble_route, &acks[j]);
+    tsdb_sample(ble_route, &acks[j]);
+    int jl = robot_report_json(acks[j], js, sizeof(js));
+    if (jl > 0) {
+      LOG_INFO("  %s", js);
+      robot_state_publish(ble_route, &acks[j], js, jl, -1);
+    }
+    cmd_trace_ack(&wire);
+  }
+}
+
+// ble_route is the robot the notification came from
+static void on_robot_notify(const uint8_t *buf, size_t len) {
+  robot_bt_packet_t words[ROBOT_BATCH_MAX], rec[REPORT_FEC_REC_MAX];
+  if (link_bench_rx(ble_route, buf, len)) return;          // LINK_ECHO frames are the bench's, not reports
+  int n = robot_report_unpack(buf, len, words, ROBOT_BATCH_MAX);
+  if (n > 0) {
+    int nrec;
+    METRIC_ADD(robot_words, n);
+    for (int i = 0; i < n; i++) rec_put(REC_WORD_RX, ble_route, words[i].bytes, 8);
+    if (ble_robots() > 1) LOG_INFO("[UART NOTIFY] robot %d: %d report word%s", ble_route, n, n == 1 ? "" : "s");
+    else LOG_INFO("[UART NOTIFY] %d report word%s", n, n == 1 ? "" : "s");
+    n = report_fec_rx(ble_route, words, n, rec, &nrec);    // FEC tag off; parity batches end here
+    for (int i = 0; i < n; i++) on_robot_word(&words[i]);
+    for (int i = 0; i < nrec; i++) on_robot_word(&rec[i]);
+  } else {
+    LOG_INFO("[UART NOTIFY] %zu bytes", len);
+  }
+}
+
+// RTO scan: retries, or drops, the words the robots have not ACKed in time
+static void on_ack_tick(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  ack_track_poll();
+}
+
+// Hot standby: the session the standby needs, every STANDBY_BEAT_MS and on
+// link changes (standby.h)
+static void state_publish(void) {
+  static standby_state_t s;
+  if (!standby_enabled()) return;
+  s.authorization_code = authorization_code;
+  for (int i = 0; i < BLE_LINKS_MAX; i++) {
+    s.security[i] = security_levels[i];
+    s.link_up[i] = (uint8_t)(ble_connected[i] != 0);
+  }
+  s.words = (uint32_t)ack_track_export(s.word, STANDBY_WORDS_MAX);
+  standby_publish(&s);
+}
+
+static void on_state_tick(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  state_publish();
+}
+
+// Link ratings, and the traffic they shape
+static void on_link_quality_tick(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  link_quality_poll();
+}
+
+// Robot clock samples for scheduled execution
+static void on_clock_tick(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  clock_sync_poll();
+}
+
+// A BENCH run's next writes and lost echoes
+static void on_bench_timer(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  link_bench_timer();
+}
+
+static void bench_arm_timer(int ms) {
+  ev_timer_set(&g_loop, g_bench_tfd, ms, 0);
+}
+
+// Closes AGG windows whose stream went quiet
+static void on_agg_tick(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  report_agg_poll();
+}
+
+// SPP passthrough hands over robot notifications as one unframed byte
+// stream. Binary notify mode tags every notification, so split it by tag;
+// bytes that cannot start a frame (e.g. text-mode hex words) are skipped.
+static uint8_t g_notify_acc[2 * ROBOT_NOTIFY_MAX];
+static size_t  g_notify_acc_len = 0;
+
+static void notify_stream_feed(const uint8_t *p, size_t n) {
+  size_t skipped = 0;
+  while (n) {
+    size_t take = sizeof(g_notify_acc) - g_notify_acc_len;
+    if (take > n) take = n;
+    memcpy(g_notify_acc + g_notify_acc_len, p, take);
+    g_notify_acc_len += take;
+    p += take;
+    n -= take;
+
+    size_t off = 0;
+    for (;;) {
+      int fl = robot_notify_frame_len(g_notify_acc + off, g_notify_acc_len - off);
+      if (fl < 0) { off++; skipped++; continue; }        // Not a frame start: resync
+      if (fl == 0 || (size_t)fl > g_notify_acc_len - off) break;
+      on_robot_notify(g_notify_acc + off, (size_t)fl);
+      off += (size_t)fl;
+    }
+    memmove(g_notify_acc, g_notify_acc + off, g_notify_acc_len - off);
+    g_notify_acc_len -= off;
+  }
+  if (skipped) LOG_INFO("[UART NOTIFY] skipped %zu stray bytes", skipped);
+}
+
+// One robot notification (or passthrough chunk) from the UART
+static void uart_rx_notify(int robot, const uint8_t *span, size_t len, int stream) {
+  ble_route = robot;
+  rec_put_flags(REC_NOTIFY_RX, robot, stream ? REC_F_STREAM : 0, span, len);
+  if (stream) notify_stream_feed(span, len);               // Passthrough: spans are arbitrary chunks
+  else on_robot_notify(span, len);                         // +NOTIFY: one span per notification
+}
+
+// One AT line from a radio, fed to that radio's AT engine
+static void uart_rx_line(int radio, const uint8_t *span, size_t len) {
+  rec_put(REC_UART_RX, radio, span, len);
+  at_engine_use(radio);
+  if (at_engine_feed(span, len)) return;                   // Reply to a queued AT command
+  link_sup_observe(span, len);                             // +BLEDISCONN: schedule a reconnect
+  gatt_cache_observe(span, len);                           // Discovery lines feed the db hash
+  while (len && (span[len - 1] == '\r' || span[len - 1] == '\n')) len--;
+  if (len && ble_radios() > 1) LOG_INFO("[UART OUTPUT %d] %.*s", radio, (int)len, (const char *)span);
+  else if (len) LOG_INFO("[UART OUTPUT] %.*s", (int)len, (const char *)span);
+}
+
+// Reader-thread mode: the thread has already split the stream into AT lines
+// and +NOTIFY payloads, so each span here is one complete message. ctx is
+// the radio whose reader woke us; its AT engine is selected for every line
+// (a completion callback may select another radio's on the way).
+static void on_uart_rx(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)events;
+  int radio = (int)(intptr_t)ctx;
+  uart_queue_t *nq = uart_reader_notify(radio), *lq = uart_reader_lines(radio);
+
+  uint64_t wakes;
+  while (read(fd, &wakes, sizeof(wakes)) > 0) {}           // Reset eventfd counter
+
+  const uint8_t *span;
+  size_t len;
+  while ((span = uart_queue_peek(nq, &len)) != NULL) {
+    uint8_t tag = uart_queue_tag(nq);
+    int robot = ble_robot_at(radio, tag & UART_TAG_CONN);   // +NOTIFY conn_index on this radio
+    if (tag & UART_TAG_METRICS) {
+      robot_metrics_rx(robot < 0 ? CONN_IDX : robot, span, len);
+    } else {
+      if (tag & UART_TAG_PRIO) METRIC_INC(prio_notifies);  // Same words, ahead of the robot's telemetry
+      uart_rx_notify(robot < 0 ? CONN_IDX : robot, span, len, ble_wnr_active());
+    }
+    uart_queue_release(nq);
+  }
+  int unit = at_engine_unit();
+  while ((span = uart_queue_peek(lq, &len)) != NULL) {
+    uart_rx_line(radio, span, len);
+    uart_queue_release(lq);
+  }
+  at_engine_use(unit);
+  tx_sched_pump();                                         // Replies may have freed the link
+}
+
+static void on_at_timer(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events;
+  int unit = at_engine_unit();
+  at_engine_use((int)(intptr_t)ctx);
+  at_engine_timeout();                                     // Head AT command ran out of time
+  at_engine_use(unit);
+  tx_sched_pump();
+}
+
+static void at_arm_timer(int ms) {
+  ev_timer_set(&g_loop, g_at_tfd[at_engine_unit()], ms, 0); // 0 disarms
+}
+
+static void on_wnr_timer(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  ble_wnr_timer();                                         // Credit refill or passthrough exit step
+  tx_sched_pump();
+}
+
+static void on_admit_timer(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  tx_sched_timer();                                        // Parked words whose tokens are back
+}
+
+static void admit_arm_timer(int ms) {
+  ev_timer_set(&g_loop, g_admit_tfd, ms, 0);
+}
+
+// Per-client / per-robot admission in front of the link (tx_sched.h), GS_ADMIT=0 turns it off
+static void admit_setup(void) {
+  const char *admit = getenv("GS_ADMIT");
+  if (admit && strcmp(admit, "0") == 0) return;
+  if (g_admit_tfd < 0) g_admit_tfd = ev_timer_add(&g_loop, 0, 0, on_admit_timer, NULL);
+  if (g_admit_tfd >= 0) tx_sched_admit(admit_arm_timer);
+}
+
+static void wnr_arm_timer(int ms) {
+  ev_timer_set(&g_loop, g_wnr_tfd, ms, 0);
+}
+
+static void on_sup_timer(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events;
+  link_sup_timer((int)(intptr_t)ctx);                      // Backoff expired: next connect attempt
+}
+
+static void sup_arm_timer(int conn, int ms) {
+  ev_timer_set(&g_loop, g_sup_tfd[conn], ms, 0);
+}
+
+// connection_status stays "connected" while any robot is
+static void on_link_change(int conn, int up) {
+  connection_status = ble_links_up() > 0;
+  if (ble_robots() > 1)
+    LOG_INFO("BLE: robot %d %s", conn, up ? "connected, notifications enabled." : "link down, words held for reconnect");
+  else
+    LOG_INFO("BLE: %s", up ? "connected, notifications enabled." : "link down, words held for reconnect");
+  uint8_t state = (uint8_t)up;
+  rec_put(REC_LINK, conn, &state, 1);
+  if (up) robot_replay_reset(conn);
+  if (up) robot_state_forget(conn);
+  if (up) tx_sched_credit_reset(conn);                     // Unlimited until it advertises
+  if (up) tx_sched_pump();                                 // Flush what is still fresh
+  state_publish();
+}
+
+// The modem runs one AT command at a time: hold robot words in the TX
+// scheduler until nothing is queued ahead of them, so a burst of stream
+// updates collapses to the newest word instead of a backlog. Nothing goes
+// out while the link is down; the scheduler ages words out instead.
+// Each radio runs its own AT queue, so robots on different radios send in
+// parallel. The transport decides what "ready" means for its module.
+// A word still in the crypto stage counts as on the modem already.
+static int tx_link_ready(void) {
+  return transport_ready() && !crypto_stage_busy(ble_route);
+}
+
+// Crypto stage results: sealed frames to the modem, opened Node commands
+// to dispatch
+static void on_crypto_done(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  crypto_stage_drain();
+  tx_sched_pump();                                         // Its links read as ready again
+}
+
+// ------------------------- RN / L2CAP / HCI transports -------------------------
+// GS_TRANSPORT=rn42 / rn4871 / l2cap / hci: the module's dialogue (or the
+// socket) runs in the transport on readability and its timer; the bridge reconnects with the link
+// supervisor's backoff and feeds reports to the same decoder.
+
+static void on_transport_rx(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  transport()->poll_rx();
+  tx_sched_pump();
+}
+
+static void on_transport_timer(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  transport()->timer();
+  tx_sched_pump();
+}
+
+static void transport_arm_timer(int ms) {
+  ev_timer_set(&g_loop, g_transport_tfd, ms, 0);
+}
+
+static void on_transport_report(const uint8_t *data, size_t len, int whole) {
+  uart_rx_notify(CONN_IDX, data, len, !whole);             // Not whole: SPP chunks
+}
+
+static void on_transport_connect(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)events; (void)ctx;
+  ev_timer_del(loop, fd);                                  // One-shot
+  const char *mac = ble_peer(CONN_IDX) ? ble_peer(CONN_IDX) : ESP32_MAC;
+  LOG_INFO("%s: connecting to %s...", transport()->name, mac);
+  if (transport()->connect(mac) != 0) LOG_INFO("%s: connect could not be started", transport()->name);
+}
+
+static void on_transport_link(int up) {
+  uint8_t state = (uint8_t)up;
+  connection_status = up;
+  rec_put(REC_LINK, CONN_IDX, &state, 1);
+  LOG_INFO("%s: %s", transport()->name, up ? "connected." : "link down, words held for reconnect");
+  if (up) {
+    g_transport_retry_ms = LINK_SUP_BASE_MS;
+    robot_replay_reset(CONN_IDX);
+    robot_state_forget(CONN_IDX);
+    tx_sched_pump();
+    return;
+  }
+  ev_timer_add(&g_loop, g_transport_retry_ms, 0, on_transport_connect, NULL);
+  g_transport_retry_ms *= 2;
+  if (g_transport_retry_ms > LINK_SUP_MAX_MS) g_transport_retry_ms = LINK_SUP_MAX_MS;
+}
+
+static int transport_setup(void) {
+  const transport_ops_t *t = transport();
+  if (t->baud && uart_set_line(g_uart_fd, uart_speed(t->baud), t->rtscts) != 0) return -1;
+  g_transport_tfd = ev_timer_add(&g_loop, 0, 0, on_transport_timer, NULL);
+  if (g_transport_tfd < 0 || t->open(g_uart_fd, transport_arm_timer) != 0) return -1;
+  transport_set_handlers(on_transport_report, on_transport_link);
+  if (ev_add(&g_loop, t->fd ? t->fd() : g_uart_fd, EPOLLIN, on_transport_rx, NULL) != 0) return -1;
+  tx_sched_init(g_uart_fd, tx_link_ready);
+  admit_setup();
+  g_bt_connect_attempted = 1;                              // Connects now, not on the first client
+  ev_timer_add(&g_loop, 1, 0, on_transport_connect, NULL);
+  if (t->no_uart) LOG_INFO("Transport: %s", t->name);
+  else LOG_INFO("Transport: %s at %d baud", t->name, t->baud);
+  return 0;
+}
+
+// ------------------------- Session replay -------------------------
+// GS_REPLAY=<file>: recorded UDS frames come from pseudo clients (one per
+// recorded client fd in g_clients, replies go to /dev/null), AT lines and notifications
+// are fed where the reader thread would hand them over, and every radio's
+// UART is a PTY whose far end is drained. No UDS socket, no reader thread.
+
+static int          g_replay = 0;
+static int          g_replay_ch[UDS_MAX_CLIENTS];          // Recorded fd of each pseudo client
+static int          g_replay_pty[ESP_RADIOS_MAX] = { [0 ... ESP_RADIOS_MAX - 1] = -1 };
+static int          g_replay_tfd = -1;                     // Next item due (recorded timing)
+static int          g_replay_efd = -1;                     // Yield and come straight back (full speed)
+
+static void replay_uds_in(int ch, const uint8_t *data, size_t len) {
+  uds_client_t *c = NULL;
+  for (int i = 0; i < UDS_MAX_CLIENTS && !c; i++)
+    if (g_clients[i].fd >= 0 && g_replay_ch[i] == ch) c = &g_clients[i];
+  for (int i = 0; i < UDS_MAX_CLIENTS && !c; i++) {
+    if (g_clients[i].fd >= 0) continue;
+    memset(&g_clients[i], 0, sizeof(g_clients[i]));
+    g_clients[i].fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (g_clients[i].fd < 0) return;
+    g_replay_ch[i] = ch;
+    c = &g_clients[i];
+  }
+  if (!c) return;
+
+  static char frame[REC_PARTS_MAX * REC_DATA + 1];          // Decoders expect a NUL after the frame
+  memcpy(frame, data, len);
+  frame[len] = '\0';
+  on_uds_frame(c, frame, (uint32_t)len);
+}
+
+static void replay_uart_line(int radio, const uint8_t *data, size_t len) {
+  if (radio >= ble_radios()) return;
+  int unit = at_engine_unit();
+  uart_rx_line(radio, data, len);
+  at_engine_use(unit);
+}
+
+static void on_replay_pty(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events;
+  replay_uart_drain((int)(intptr_t)ctx);                   // What the bridge sent the "module"
+}
+
+static void on_replay_end(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)events; (void)ctx;
+  ev_timer_del(loop, fd);
+  ev_loop_stop(loop);
+}
+
+static void on_replay(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)events; (void)ctx;
+  uint64_t wakes;
+  if (fd == g_replay_efd) while (read(fd, &wakes, sizeof(wakes)) > 0) {}
+
+  int ms = 0;
+  int more = replay_step(&ms);
+  tx_sched_pump();
+  if (more && ms == 0) {
+    wakes = 1;
+    if (write(g_replay_efd, &wakes, sizeof(wakes)) < 0) ev_timer_set(loop, g_replay_tfd, 1, 0);
+  } else if (more) {
+    ev_timer_set(loop, g_replay_tfd, ms, 0);
+  } else {
+    replay_report();
+    ev_timer_add(loop, REPLAY_DRAIN_MS, 0, on_replay_end, NULL); // Let queued words go out
+  }
+}
+
+static int replay_start(void) {
+  for (int r = 0; r < ESP_RADIOS_MAX; r++)
+    if (g_replay_pty[r] >= 0 && ev_add(&g_loop, g_replay_pty[r], EPOLLIN, on_replay_pty, (void *)(intptr_t)r) != 0) return -1;
+  g_replay_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (g_replay_efd < 0 || ev_add(&g_loop, g_replay_efd, EPOLLIN, on_replay, NULL) != 0) return -1;
+  g_replay_tfd = ev_timer_add(&g_loop, 1, 0, on_replay, NULL);
+  return g_replay_tfd < 0 ? -1 : 0;
+}
+
+// ------------------------- Memory footprint -------------------------
+// What the bridge holds up front (linker-reported data + bss, with the big
+// buffers broken out) and what it adds at run time. make LOWMEM=1 shrinks
+// the queue depths and slot sizes; -D<limit>=N sets one (json_uds.h,
+// uart_queue.h, gs_log.h, recorder.h).
+
+extern char __data_start[], edata[], __bss_start[], end[];
+
+static void log_footprint(size_t rec_bytes) {
+  size_t data = (size_t)(edata - __data_start), bss = (size_t)(end - __bss_start);
+  size_t log_ring, log_out = gs_log_footprint(&log_ring);
+#ifdef GS_LOWMEM
+  const char *mode = "LOWMEM";
+#else
+  const char *mode = "default";
+#endif
+  LOG_INFO("Memory (%s): static %zu KiB (data %zu KiB, bss %zu KiB)", mode,
+           (data + bss) >> 10, data >> 10, bss >> 10);
+  LOG_INFO("Memory: UART queues %zu KiB, UDS clients %zu KiB, frame pool %zu KiB, log batches %zu KiB",
+           (2 * UART_READERS_MAX * sizeof(uart_queue_t)) >> 10, sizeof(g_clients) >> 10,
+           frame_pool_static_bytes() >> 10, log_out >> 10);
+  LOG_INFO("Memory: + %zu KiB per logging thread, recorder %zu KiB mapped, "
+           "UDS frames over %u B from the heap (%u B max)",
+           log_ring >> 10, rec_bytes >> 10, FRAME_POOL_LARGE, UDS_MAX_FRAME);
+}
+
+// SIGINT / SIGTERM stop the loop so main's cleanup runs: clients closed,
+// socket file removed, recorder unmapped (and profile data written by an
+// instrumented build, see make pgo). SIGHUP re-reads GS_CONFIG.
+static void on_signal(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)events; (void)ctx;
+  struct signalfd_siginfo si;
+  if (read(fd, &si, sizeof(si)) != (ssize_t)sizeof(si)) return;
+  if (si.ssi_signo == SIGHUP) {
+    char js[1024];
+    if (gs_config_reload() < 0) LOG_WARN("SIGHUP: %s unreadable", gs_config_path() ? gs_config_path() : "GS_CONFIG");
+    else if (gs_config_reply(js, sizeof(js)) >= 0) LOG_INFO("SIGHUP: %s", js);
+    config_arm();
+    return;
+  }
+  LOG_INFO("Signal %u, shutting down", si.ssi_signo);
+  ev_loop_stop(loop);
+}
+
 // ------------------------- Main -------------------------
 
 int main(int argc, char **argv) {
-  setvbuf(stdout, NULL, _IOLBF, 0);  // Line-buffer stdout immediately
+  setvbuf(stdout, NULL, _IOLBF, 0);  // Line-buffer stdout immediately (crypto self-tests still printf)
+
+  sigset_t stop_sigs;                // Blocked before any thread starts; the loop reads them
+  sigemptyset(&stop_sigs);
+  sigaddset(&stop_sigs, SIGINT);
+  sigaddset(&stop_sigs, SIGTERM);
+  sigaddset(&stop_sigs, SIGHUP);
+  pthread_sigmask(SIG_BLOCK, &stop_sigs, NULL);
+  signal(SIGPIPE, SIG_IGN);          // A client gone mid-writev is EPIPE on its queue, not our exit
+
+  int cfg = gs_config_load();        // GS_CONFIG: before anything reads the environment
+  gs_log_start();                    // Everything else logs through the writer thread
+  prof_start();                      // GS_PROF: sampling profiler, UDS {"T":"PROF"}
+  if (gs_config_path()) {
+    if (cfg < 0) LOG_WARN("GS_CONFIG=%s unreadable", gs_config_path());
+    else LOG_INFO("Config: %d settings from %s", cfg, gs_config_path());
+  }
+
+  // GS_REPLAY=<file>, GS_REPLAY_SPEED: drive the bridge from a recorded session
+  const char *replay_path = getenv("GS_REPLAY");
+  static const replay_sink_t replay_sink = { replay_uds_in, replay_uart_line, uart_rx_notify };
+  g_replay = replay_path && replay_path[0];
+  if (g_replay && replay_open(replay_path, getenv("GS_REPLAY_SPEED"), &replay_sink) != 0) return 1;
+  if (g_replay) setenv("GS_GATT_CACHE", "off", 0);         // Don't touch the live cache; discovery as recorded
+
+  // GS_STATE=<path> | 0: session snapshot for a hot standby; GS_STANDBY=1
+  // waits for the active bridge holding it to go, then takes over (standby.h).
+  // Before the recorder, which would rotate the active bridge's ring.
+  const char *state_path = getenv("GS_STATE");
+  const char *standby = getenv("GS_STANDBY");
+  static standby_state_t takeover;
+  if (!(state_path && state_path[0])) state_path = STANDBY_DEFAULT_PATH;
+  if (g_replay || strcmp(state_path, "0") == 0) {
+    if (standby && strcmp(standby, "1") == 0) LOG_WARN("GS_STANDBY needs the state file (GS_STATE), ignored");
+  } else if (standby && strcmp(standby, "1") == 0) {
+    pmod_esp32_gpio_prepare();                             // Pins resolved while the active holds them
+    if (standby_wait(state_path, &stop_sigs, &takeover) != 0) return 0;
+    uint64_t age = takeover.beat_ns ? (metrics_now_us() * 1000u - takeover.beat_ns) / 1000000u : 0;
+    if (takeover.beat_ns)
+      LOG_INFO("Standby: taking over from pid %u (snapshot %llu ms old, %u words in flight)",
+               (unsigned)takeover.pid, (unsigned long long)age, (unsigned)takeover.words);
+    else LOG_INFO("Standby: taking over, no snapshot from the previous bridge");
+  } else if (standby_open(state_path) != 0) {
+    LOG_WARN("GS_STATE=%s held by another bridge or unusable, no standby can follow this one", state_path);
+  }
+  if (takeover.beat_ns) {                     // Before anything seals a word
+    authorization_code = takeover.authorization_code;
+    for (int i = 0; i < BLE_LINKS_MAX; i++) security_levels[i] = takeover.security[i];
+  }
+
+  // GS_RECORD=<path> | 0, GS_RECORD_MB: flight recorder ring (on by default;
+  // GS_RECORD_DIR adds segments behind it, rec_compact.h;
+  // a replay only records when GS_RECORD names another file)
+  const char *rec_path = getenv("GS_RECORD");
+  const char *rec_mb = getenv("GS_RECORD_MB");
+  if (g_replay && !(rec_path && rec_path[0] && strcmp(rec_path, replay_path) != 0)) rec_path = "0";
+  size_t rec_bytes = 0;
+  if (!(rec_path && strcmp(rec_path, "0") == 0)) {
+    if (!(rec_path && rec_path[0])) rec_path = REC_DEFAULT_PATH;
+    size_t mb = (rec_mb && atoi(rec_mb) > 0) ? (size_t)atoi(rec_mb) : REC_DEFAULT_MB;
+    if (rec_open(rec_path, mb << 20) == 0) {
+      rec_bytes = mb << 20;
+      LOG_INFO("Recorder: %s (%zu MiB ring)", rec_path, mb);
+      rec_compact_start();                                 // GS_RECORD_DIR: segments behind the ring
+    } else LOG_WARN("recorder could not open %s, recording off", rec_path);
+  }
 
   const char *uart_dev = DEFAULT_UART_DEV;
   const char *env_uart = getenv("UART_DEV");
   if (env_uart && env_uart[0]) uart_dev = env_uart;
   if (argc >= 2) uart_dev = argv[1];
 
-  printf("Hello — uart_dev=%s\n", uart_dev);  // Will now appear
+  // GS_RADIOS="dev0,dev1": one PmodESP32 per UART (PMOD n pins for radio n),
+  // robots spread over them; replaces UART_DEV
+  const char *radio_devs[ESP_RADIOS_MAX] = { uart_dev };
+  char radio_list[256];
+  int radios = 1;
+  const char *env_radios = getenv("GS_RADIOS");
+  if (env_radios && env_radios[0]) {
+    snprintf(radio_list, sizeof(radio_list), "%s", env_radios);
+    radios = 0;
+    for (char *save, *dev = strtok_r(radio_list, ",", &save); dev; dev = strtok_r(NULL, ",", &save)) {
+      if (radios == ESP_RADIOS_MAX) { LOG_WARN("GS_RADIOS: more than %d radios, rest ignored", ESP_RADIOS_MAX); break; }
+      radio_devs[radios++] = dev;
+    }
+    if (radios == 0) radios = 1;
+    uart_dev = radio_devs[0];
+  }
 
-  int uart_fd = uart_open_config(uart_dev, DEFAULT_UART_BAUD);
-  if (uart_fd < 0) {
-    fprintf(stderr, "ERROR: uart_open_config(%s) failed: %s\n",
-            uart_dev, strerror(errno));
+  // GS_TRANSPORT=esp-at (default) | rn42 | rn4871: which module sits on the UART;
+  // l2cap: the GS's own Bluetooth controller, no UART opened; hci: the PmodESP32
+  // as an HCI controller under the Linux stack
+  const char *tname = getenv("GS_TRANSPORT");
+  if (transport_select(tname) != 0) {
+    LOG_ERR("GS_TRANSPORT=%s unknown (" TRANSPORT_NAMES ")", tname);
+    return 1;
+  }
+  if (!transport_is_esp() && radios > 1) {
+    LOG_WARN("%s drives one link, GS_RADIOS beyond the first ignored", transport()->name);
+    radios = 1;
+  }
+  if (g_replay && !transport_is_esp()) {
+    LOG_ERR("GS_REPLAY needs GS_TRANSPORT=esp-at (other transports are not recorded)");
     return 1;
   }
-  printf("UART opened: fd=%d\n", uart_fd);
-  // ...
-  ble_init(uart_fd);
-  
-  const char *uds_path = DEFAULT_UDS_PATH;                 // UDS path (could also make configurable)
 
-  int uds_listen = uds_server_listen(uds_path);            // Create UDS listening socket
-  if (uds_listen < 0) return 1;                            // If failed, exit
-
-  printf("Bridge up. UDS=%s UART=%s\n", uds_path, uart_dev);// Helpful startup message
-
-  int uds_client = -1;                                     // Node client fd (none yet)
-  int bt_connect_attempted = 0;
-
-  while (1) {                                              // Run forever
-    if (uds_client < 0) {                                  // If Node not connected
-      printf("Waiting for Node connection...\n");          // Tell user
-      uds_client = accept(uds_listen, NULL, NULL);         // Accept one client
-      if (uds_client < 0) { perror("accept"); continue; }  // Retry on failure
-      fcntl(uds_client, F_SETFL, O_NONBLOCK);              // Make Node socket nonblocking
-      printf("Node connected.\n");                         // Confirm
-
-      //ONLY CONNECT ONCE BASED ON UI CONNECTION MAYBE REMOVE TO LET UI HAVE FULL CONTROL
-      // Connect RN-42 to ESP32 now that Node is connected
-      // Try RN-42 connect ONCE after Node connects
-      printf("%d", bt_connect_attempted);
-      if (!bt_connect_attempted) {
-        bt_connect_attempted = 1;
-
-        printf("%d", bt_connect_attempted);
-
-
-        const char *esp32_mac = ESP32_MAC;  
-        
-        printf("Entering cmd\n");
-        printf("BLE: connecting to ESP32 MAC %s...\n", esp32_mac);
-        if (ble_connect(uart_fd, esp32_mac) != 0) {
-          printf("BLE: connect attempt failed (will not retry unless Node reconnects)\n");
-        } else {
-          printf("BLE: connect command sent.\n");
-        }
-        
-      }
+  static char pty_dev[ESP_RADIOS_MAX][64];
+  for (int r = 0; g_replay && r < radios; r++) {            // Replay: PTYs stand in for the radios
+    g_replay_pty[r] = replay_uart_open(r, pty_dev[r], sizeof(pty_dev[r]));
+    if (g_replay_pty[r] < 0) { LOG_ERR("replay PTY: %s", strerror(errno)); return 1; }
+    radio_devs[r] = pty_dev[r];
+  }
+  if (g_replay) uart_dev = radio_devs[0];
+
+  LOG_INFO("Hello — uart_dev=%s", transport()->no_uart ? "none" : uart_dev);  // Will now appear
+
+  for (int r = 0; r < radios && !transport()->no_uart; r++) {
+    g_radio_fd[r] = uart_open_config(radio_devs[r], DEFAULT_UART_BAUD);
+    if (g_radio_fd[r] < 0) {
+      LOG_ERR("uart_open_config(%s) failed: %s",
+              radio_devs[r], strerror(errno));
+      return 1;
     }
+    LOG_INFO("UART opened: fd=%d%s%s", g_radio_fd[r], radios > 1 ? " " : "", radios > 1 ? radio_devs[r] : "");
+  }
+  g_uart_fd = g_radio_fd[0];
 
-    fd_set rfds;                                           // Read fd set
-    FD_ZERO(&rfds);                                        // Clear set
-    FD_SET(uds_client, &rfds);                             // Watch Node socket
-    FD_SET(uart_fd, &rfds);                                // Watch UART
-    int maxfd = (uds_client > uart_fd) ? uds_client : uart_fd; // select needs max+1
+  if (ev_loop_init(&g_loop) != 0) return 1;
+  const char *uring = getenv("GS_IO_URING");               // 1: io_uring instead of epoll (ev_uring.h)
+  if (uring && strcmp(uring, "1") == 0) {
+    if (ev_loop_use_uring(&g_loop) == 0) LOG_INFO("Event loop: io_uring");
+    else LOG_WARN("GS_IO_URING: io_uring unavailable, staying on epoll");
+  }
+  int sig_fd = signalfd(-1, &stop_sigs, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (sig_fd < 0 || ev_add(&g_loop, sig_fd, EPOLLIN, on_signal, NULL) != 0) return 1;
 
-    struct timeval tv;                                     // Timeout for select()
-    tv.tv_sec = 0;                                         // 0 seconds
-    tv.tv_usec = 20000;                                    // 20ms tick (gives responsiveness)
+  // GS_ROBOTS="mac0,mac1,..." drives several robots, robot n on conn_index n
+  // (one radio) or balanced over the radios
+  if (transport_is_esp()) transport()->open(g_uart_fd, NULL);
 
-    int rc = select(maxfd + 1, &rfds, NULL, NULL, &tv);     // Wait for readable fd(s)
-    if (rc < 0) {                                          // Error
-      if (errno == EINTR) continue;                        // Interrupted -> retry
-      perror("select");                                    // Print error
-      break;                                               // Exit loop
+  const char *reader = getenv("UART_READER");
+  if (radios > 1 && reader && strcmp(reader, "0") == 0) {
+    LOG_WARN("UART_READER=0 drives one radio, GS_RADIOS beyond the first ignored");
+    radios = 1;
+  }
+  ble_set_radios(radios);
+  const char *robots = getenv("GS_ROBOTS");
+  if (robots && robots[0]) {
+    char list[BLE_LINKS_MAX * 20];
+    snprintf(list, sizeof(list), "%s", robots);
+    int n = 0;
+    for (char *save, *mac = strtok_r(list, ",", &save); mac; mac = strtok_r(NULL, ",", &save)) {
+      if (n == BLE_LINKS_MAX) { LOG_WARN("GS_ROBOTS: more than %d robots, rest ignored", BLE_LINKS_MAX); break; }
+      if (ble_set_peer(n, mac) == 0) n++;
+      else LOG_WARN("GS_ROBOTS: bad MAC '%s'", mac);
     }
+    LOG_INFO("Robots: %d", ble_robots());
+    if (!transport_is_esp() && ble_robots() > 1)
+      LOG_WARN("%s drives robot 0 only", transport()->name);
+    if (radios > 1)
+      for (int i = 0; i < ble_robots(); i++)
+        if (ble_peer(i)) LOG_INFO("  robot %d: radio %d conn %d", i, ble_radio_of(i), ble_conn_of(i));
+  }
 
-    // ----- If Node socket readable: read 1 framed JSON message -----
-
-    if (FD_ISSET(uds_client, &rfds)) {         
-                  // Node has data
-      uint32_t len_be = 0;                                 // 4-byte big-endian length
-      int r = read_full(uds_client, &len_be, 4);           // Read length
-      if (r == 0) {                                        // Node disconnected
-        close(uds_client);                                 // Close client fd
-        uds_client = -1;                                   // Mark as disconnected
-        continue;                                          // Go back to accept()
+  // UART_READER=0 keeps the old in-loop reads (debugging on a single core)
+  // (a replay feeds the spans itself and runs no reader thread)
+  int no_reader = !transport_is_esp() || g_replay || (reader && strcmp(reader, "0") == 0);
+  rt_setup();                                              // GS_RT_PRIO, GS_CPU_*, GS_MLOCK: readers inherit
+  int uart_rx_efd = no_reader ? -1 : uart_reader_start(g_uart_fd);
+  if (!transport_is_esp()) {
+    if (transport_setup() != 0) return 1;
+  } else if (uart_rx_efd >= 0 || g_replay) {
+    if (!g_replay) {
+      if (ev_add(&g_loop, uart_rx_efd, EPOLLIN, on_uart_rx, (void *)(intptr_t)0) != 0) return 1;
+      for (int r = 1; r < radios; r++) {
+        int efd = uart_reader_start_unit(r, g_radio_fd[r]);
+        if (efd < 0 || ev_add(&g_loop, efd, EPOLLIN, on_uart_rx, (void *)(intptr_t)r) != 0) return 1;
       }
-      if (r < 0) {
-        // -2 would mean "would block" in nonblocking mode; ignore for now.
-      } else {
-        uint32_t len = ntohl(len_be);                      // Convert length to host endian
-        if (len == 0 || len > (1024*1024)) {               // Sanity check (max 1MB)
-          close(uds_client);                               // Drop connection if invalid
-          uds_client = -1;
-          continue;
-        }
-
-        char *buf = (char*)malloc(len + 1);                // Allocate buffer
-        if (!buf) {                                        // OOM
-          close(uds_client);
-          uds_client = -1;
-          continue;
-        }
-
-        int r2 = read_full(uds_client, buf, len);          // Read JSON payload bytes
-        if (r2 <= 0) {                                     // Error/disconnect
-          free(buf);
-          close(uds_client);
-          uds_client = -1;
-          continue;
-        }
-
-        buf[len] = '\0';                                   // Null-terminate JSON string
-        int handled = 0;
-
-        // Fast path: if it looks like JSON and parses, treat as plaintext JSON
-        
-
-        if (looks_like_json(buf)) {
-          //printf("I GOT a JSON\r\n");
-          cJSON *probe = cJSON_Parse(buf);
-          if (probe) {
-            cJSON_Delete(probe);
-            printf("UDS->C plaintext JSON\n");
-            handle_node_json(uart_fd, uds_client, buf);
-            handled = 1;
-          }
-        }
-        // If not handled, attempt decrypt path or send raw string over Bluetooth
-        if (!handled) {
-          //printf("I GOT SOMETHING ENCRYPTED\r\n");
-          handle_encrypted_data(uart_fd, uds_client, buf);
-        }
-
-        free(buf);                                         // Free buffer
+      LOG_INFO("UART reader thread%s up", radios > 1 ? "s" : "");
+    }
+
+    // Framed replies are available, so AT commands can be queued instead of
+    // blocking the loop until each OK arrives.
+    for (int r = radios - 1; r >= 0; r--) {                // Ends with radio 0 selected
+      at_engine_use(r);
+      g_at_tfd[r] = ev_timer_add(&g_loop, 0, 0, on_at_timer, (void *)(intptr_t)r);
+      if (g_at_tfd[r] >= 0) at_engine_init(g_radio_fd[r], at_arm_timer);
+    }
+
+    // GS_BLE_WNR=1: CONTROL/ARM words open SPP passthrough (GATT Write Commands);
+    // while it is up every robot word streams through it
+    const char *wnr = getenv("GS_BLE_WNR");
+    if (wnr && strcmp(wnr, "1") == 0 && ble_robots() > 1) {
+      LOG_WARN("GS_BLE_WNR ignored, SPP passthrough drives a single link");
+    } else if (wnr && strcmp(wnr, "1") == 0 && at_engine_active()) {
+      g_wnr_tfd = ev_timer_add(&g_loop, 0, 0, on_wnr_timer, NULL);
+      if (g_wnr_tfd >= 0 && ble_wnr_init(g_uart_fd, wnr_arm_timer) == 0) {
+        ble_wnr_enable(1);
+        LOG_INFO("BLE: write-without-response fast path enabled");
       }
     }
+    if (at_engine_active()) {
+      tx_sched_init(g_uart_fd, tx_link_ready);
+      admit_setup();
+    }
 
-    // ----- If UART readable: read bytes, parse frames, forward to Node -----
-    /*
-    if (FD_ISSET(uart_fd, &rfds)) {                         // UART has data
-      uint8_t tmp[256];                                     // Temp read buffer
-      ssize_t n = read(uart_fd, tmp, sizeof(tmp));          // Read available bytes
-      if (n > 0) {                                          // If bytes received
-        for (ssize_t i = 0; i < n; i++) {                   // Feed each byte into parser
-          uint64_t word = 0;                                // Output word
-          //int got = uart_parser_feed(&up, tmp[i], &word);   // Parser state update
-          //if (got == 1 && uds_client >= 0) {                // If we got a complete frame
-            //robot_word_to_node_json(uds_client, word);      // Convert to JSON and send to Node
-          //}
-        }
+    // Reconnect on +BLEDISCONN / failed connects without waiting for Node
+    if (at_engine_active()) {
+      int links = ble_robots(), ok = 1;
+      for (int i = 0; i < links; i++) {
+        g_sup_tfd[i] = ev_timer_add(&g_loop, 0, 0, on_sup_timer, (void *)(intptr_t)i);
+        if (g_sup_tfd[i] < 0) ok = 0;
       }
+      if (ok) link_sup_init(g_uart_fd, links, sup_arm_timer, on_link_change);
     }
-      */
-    ble_uart_check(uart_fd);
-    char rx_buffer[1024]; 
-    if (uart_queue_pop(&uart_queue, rx_buffer) == 0){
-       printf("[UART OUTPUT] %s\r\n", rx_buffer);
+  } else if (ev_add(&g_loop, g_uart_fd, EPOLLIN, on_uart, NULL) != 0) {
+    return 1;
+  }
+
+  // With the AT engine up the ESP32 reset + setup runs as a reply-driven chain
+  // and the module boots while the crypto benchmark and UDS setup below run;
+  // every radio boots at the same time
+  if (!transport_is_esp()) {}                              // Already connecting
+  else if (!at_engine_active()) ble_init(g_uart_fd);
+  else {
+    // GS_UART_BAUD: rate asked for once the module is up (115200 = stay at
+    // the boot rate); GS_UART_FLOW=0 leaves RTS/CTS off
+    const char *baud = getenv("GS_UART_BAUD");
+    const char *flow = getenv("GS_UART_FLOW");
+    int bps = (baud && baud[0]) ? atoi(baud) : UART_FAST_BPS;
+    int rtscts = !(flow && strcmp(flow, "0") == 0);
+    if (ble_set_uart_rate(bps, rtscts) != 0)
+      LOG_WARN("GS_UART_BAUD=%s not supported, using %d", baud, UART_FAST_BPS);
+
+    g_radios_booting = radios;
+    for (int r = radios - 1; r >= 0; r--) {
+      at_engine_use(r);
+      if (ble_init_async(g_radio_fd[r], on_ble_init_done, (void *)(intptr_t)r) != 0) {
+        LOG_WARN("ESP32 bring-up could not be queued");
+        g_radios_booting--;
+      }
     }
   }
 
+  // Benchmark the AES-GCM providers and keep the fastest (GS_CRYPTO=<name> forces one)
+  const char *crypto = getenv("GS_CRYPTO");
+  if (!(crypto && crypto[0] && gs_crypto_use(crypto) == 0)) {
+    if (crypto && crypto[0]) LOG_WARN("crypto provider '%s' unavailable", crypto);
+    if (gs_crypto_autoselect() != 0) LOG_WARN("no working AES-GCM provider, encrypted mode will fail");
+  }
+  LOG_INFO("GCM provider: %s", gs_crypto_provider()->name);
+  const char *iv_mode = getenv("GCM_IV_MODE");            // "random" = pooled random IVs (no replay sequence)
+  if (iv_mode && strcmp(iv_mode, "random") == 0 && gs_nonce_set_mode(GS_NONCE_RANDOM) == 0)
+    LOG_INFO("GCM IVs: random (robots will refuse most sealed commands as replays)");
+  else if (gs_nonce_set_mode(GS_NONCE_COUNTER) == 0)
+    LOG_INFO("GCM IVs: session salt + sequence");
+  const char *seal = getenv("GS_SEAL");                   // "legacy" = 160-byte padded frames
+  int compact = !(seal && strcmp(seal, "legacy") == 0) && !(iv_mode && strcmp(iv_mode, "random") == 0);
+  LOG_INFO("Sealed commands: %s", robot_seal_set(compact) ? "compact (40-byte frames)"
+                                                          : "legacy (160-byte frames)");
+
+  const char *trace = getenv("GS_TRACE");                 // 1 = per-command latency records
+  cmd_trace_init(trace && strcmp(trace, "1") == 0);
+  robot_state_setup();                                     // GS_STATE_MAX_MS
+  ack_track_setup();                                       // GS_ACK_TRACK
+  if (ack_track_enabled() && ev_timer_add(&g_loop, ACK_TRACK_TICK_MS, ACK_TRACK_TICK_MS, on_ack_tick, NULL) < 0)
+    LOG_WARN("ACK tracker timer failed, unanswered words will not be retried");
+  for (uint32_t i = 0; i < takeover.words && i < STANDBY_WORDS_MAX; i++)
+    ack_track_adopt(&takeover.word[i]);                    // Out again once their link is up
+  link_quality_setup(g_uart_fd);                           // GS_LINK_QUALITY
+  if (link_quality_enabled() && ev_timer_add(&g_loop, LQ_TICK_MS, LQ_TICK_MS, on_link_quality_tick, NULL) < 0)
+    LOG_WARN("Link quality timer failed, telemetry and batching will not follow the link");
+  if (standby_enabled() && ev_timer_add(&g_loop, STANDBY_BEAT_MS, STANDBY_BEAT_MS, on_state_tick, NULL) < 0)
+    LOG_WARN("Standby snapshot timer failed, a standby would take over a stale session");
+  gs_config_hot("GS_LOG", config_log);                     // Settings that change in place
+  gs_config_hot("GS_CRYPTO", config_crypto);
+  gs_config_hot("GS_UART_BAUD", config_uart_baud);
+  gs_config_hot("GS_ROBOTS", config_robots);
+  g_config_tfd = ev_timer_add(&g_loop, 0, 0, on_config_timer, NULL);
+  report_agg_setup();                                      // GS_AGG_MS
+  tsdb_setup();                                            // GS_TSDB_MB
+  if (report_agg_enabled() && ev_timer_add(&g_loop, AGG_TICK_MS, AGG_TICK_MS, on_agg_tick, NULL) < 0)
+    LOG_WARN("Aggregation timer failed, AGG windows close only on the next sample");
+  g_bench_tfd = ev_timer_add(&g_loop, 0, 0, on_bench_timer, NULL);
+  if (g_bench_tfd >= 0) link_bench_init(bench_arm_timer);
+  else LOG_WARN("Link benchmark timer failed, BENCH runs will not start");
+  clock_sync_setup();                                      // GS_EXEC_DELAY_MS
+  if (clock_sync_enabled()) {
+    if (ev_timer_add(&g_loop, CLOCK_SYNC_TICK_MS, CLOCK_SYNC_TICK_MS, on_clock_tick, NULL) < 0)
+      LOG_WARN("Clock sync timer failed, commands will run on arrival");
+    else LOG_INFO("Scheduled execution: motion runs %u ms after submit", clock_sync_delay_ms());
+  }
+  int crypto_efd = g_replay ? -1 : crypto_stage_start();  // GS_CRYPTO_THREAD
+  if (crypto_efd >= 0 && ev_add(&g_loop, crypto_efd, EPOLLIN, on_crypto_done, NULL) != 0) {
+    crypto_stage_stop();
+    LOG_WARN("Crypto stage not watched, sealing stays on the event loop");
+  }
+  if (cmd_trace_enabled()) LOG_INFO("Command latency trace on (ids assigned by the bridge)");
+
+  const char *uds_path = DEFAULT_UDS_PATH;                 // UDS path (could also make configurable)
+  const char *seq_path = getenv("GS_UDS_SEQ");            // Optional SOCK_SEQPACKET socket
+  int uds_listen = -1, ws_listen_fd = -1, tcp_listen_fd = -1, seq_listen_fd = -1;
+
+  for (int i = 0; i < UDS_MAX_CLIENTS; i++) g_clients[i].fd = -1;
+
+  if (g_replay) {                                          // Recorded clients only
+    if (replay_start() != 0) return 1;
+    const char *speed = getenv("GS_REPLAY_SPEED");
+    if (!(speed && speed[0]) || strcmp(speed, "1") == 0) LOG_INFO("Bridge up. Replaying %s at recorded timing", replay_path);
+    else if (strcmp(speed, "0") == 0 || strcmp(speed, "max") == 0) LOG_INFO("Bridge up. Replaying %s at full speed", replay_path);
+    else LOG_INFO("Bridge up. Replaying %s %sx faster", replay_path, speed);
+  } else {
+    uds_listen = uds_server_listen(uds_path);              // Create UDS listening socket
+    if (uds_listen < 0) return 1;                          // If failed, exit
+    fcntl(uds_listen, F_SETFL, O_NONBLOCK);                // ET accept loop needs nonblocking
+
+    if (ev_add(&g_loop, uds_listen, EPOLLIN, on_uds_listen, NULL) != 0) return 1;
+    ws_listen_fd = ws_setup();                             // GS_WS_PORT: UI straight to the bridge
+    tcp_listen_fd = tcp_setup();                           // GS_TCP_PORT: Node peers on other hosts
+    seq_listen_fd = seq_setup(seq_path);                   // GS_UDS_SEQ: native peers, whole messages
+
+    LOG_INFO("Bridge up. UDS=%s UART=%s", uds_path, transport()->no_uart ? "none" : uart_dev);// Helpful startup message
+  }
+
+  log_footprint(rec_bytes);
+  if (rt_probe_start(&g_loop) != 0) LOG_WARN("jitter probe timer failed");
+  ev_loop_run(&g_loop);                                    // Runs until error/stop
+
   // Cleanup on exit
-  if (uds_client >= 0) close(uds_client);                   // Close Node connection
-  close(uds_listen);                                        // Close UDS server
-  close(uart_fd);                                           // Close UART
-  unlink(uds_path);                                         // Remove socket file
- 
+  rt_report();
+  for (int i = 0; i < UDS_MAX_CLIENTS; i++) uds_client_close(&g_clients[i]);
+  ev_loop_close(&g_loop);
+  close(sig_fd);
+  uart_reader_stop();                                       // Join reader before closing the UART
+  crypto_stage_stop();                                      // ... and the crypto stage before the provider goes
+  prof_stop();
+  gs_crypto_shutdown();                                     // Release AF_ALG sockets / CSU mappings
+  for (int r = 0; r < radios; r++) close(g_radio_fd[r]);   // Close UARTs
+  if (uds_listen >= 0) {
+    close(uds_listen);                                      // Close UDS server
+    unlink(uds_path);                                       // Remove socket file
+  }
+  if (ws_listen_fd >= 0) close(ws_listen_fd);
+  if (tcp_listen_fd >= 0) close(tcp_listen_fd);
+  if (seq_listen_fd >= 0) {
+    close(seq_listen_fd);
+    unlink(seq_path);
+  }
+  if (g_replay) replay_close();
+  rec_compact_stop();                                       // Last items into the segments, sealed
+  rec_close();                                              // Unmap the recorder ring
+  standby_close();                                          // Last: a standby moves in now
+
   return 0;                                                 // Exit
-}
\ No newline at end of file
+}
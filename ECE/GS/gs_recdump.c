@@ -0,0 +1,140 @@
+// gs_recdump.c
+// -----------------------------------------------------------------------------
+// Flight recorder reader:
+//   Prints a GS_RECORD ring file (includes/recorder/recorder.h), a segment or
+//   a GS_RECORD_DIR of them (rec_segment.h) oldest record first, one line
+//   per item:
+//     <time> <kind> ch=<n> <bytes>B <payload>
+//   Text payloads (UDS JSON, AT lines) print as text, the rest as hex; robot
+//   report words are also decoded with the report templates. Works on the
+//   live file of a running bridge (slots still being written are skipped)
+//   and on the <path>.prev a restart leaves behind.
+//
+// Usage: gs_recdump.o [-w] [-k KIND] [-n LAST] [-s FROM] [-e TO] [FILE|DIR]
+//   -w  wall-clock times instead of seconds since the bridge opened the file
+//   -k  only this kind (UDS_IN, WORD_TX, ...)
+//   -n  only the last N items
+//   -s  from this time on (unix seconds, fractions allowed); segments before
+//       it are not decompressed
+//   -e  up to this time
+//
+// Build example:
+//   make recdump
+// -----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "includes/cmd_structure.h"
+#include "includes/cmd_parser/report_json.h"
+#include "includes/recorder/recorder.h"
+
+static int printable(const uint8_t *p, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    if ((p[i] < 0x20 || p[i] > 0x7E) && p[i] != '\r' && p[i] != '\n') return 0;
+  return n > 0;
+}
+
+static void print_payload(int kind, const uint8_t *p, size_t n) {
+  if (kind == REC_LINK && n == 1) { fputs(p[0] ? "up" : "down", stdout); return; }
+  if ((kind == REC_WORD_RX || kind == REC_WORD_TX) && n == 8) {
+    robot_bt_packet_t w;
+    memcpy(w.bytes, p, 8);
+    for (int i = 0; i < 8; i++) printf("%02X", p[i]);
+    char js[REPORT_JSON_MAX];
+    if (kind == REC_WORD_RX && robot_report_json(w, js, sizeof(js)) > 0) printf(" %s", js);
+    else printf(" type=%u", (unsigned)w.ctrl.type);
+    return;
+  }
+  if (kind != REC_CIPHER_TX && kind != REC_CIPHER_RX && kind != REC_NOTIFY_RX && printable(p, n)) {
+    for (size_t i = 0; i < n; i++) {
+      if (p[i] == '\r') fputs("\\r", stdout);
+      else if (p[i] == '\n') fputs("\\n", stdout);
+      else putchar(p[i]);
+    }
+    return;
+  }
+  for (size_t i = 0; i < n; i++) printf("%02X", p[i]);
+}
+
+// CLOCK_REALTIME of an item, from the clocks of the run that recorded it
+static uint64_t item_real(const rec_hdr_t *h, const rec_item_t *it) {
+  return h->real_ns + (it->t_ns - h->mono_ns);
+}
+
+static void start(rec_reader_t *r, uint64_t from) {
+  if (from) rec_reader_seek(r, from);
+  else rec_reader_rewind(r);
+}
+
+int main(int argc, char **argv) {
+  int wall = 0, only = 0, opt;
+  uint64_t last = 0, from = 0, to = UINT64_MAX;
+  while ((opt = getopt(argc, argv, "wk:n:s:e:")) != -1) {
+    switch (opt) {
+      case 'w': wall = 1; break;
+      case 'k':
+        only = rec_kind_of(optarg);
+        if (only < 0) { fprintf(stderr, "unknown kind %s\n", optarg); return 1; }
+        break;
+      case 'n': last = strtoull(optarg, NULL, 10); break;
+      case 's': from = (uint64_t)(strtod(optarg, NULL) * 1e9); break;
+      case 'e': to = (uint64_t)(strtod(optarg, NULL) * 1e9); break;
+      default:
+        fprintf(stderr, "Usage: %s [-w] [-k KIND] [-n LAST] [-s FROM] [-e TO] [FILE|DIR]\n", argv[0]);
+        return 1;
+    }
+  }
+  const char *path = optind < argc ? argv[optind] : REC_DEFAULT_PATH;
+
+  rec_reader_t r;
+  int rc = rec_reader_open(&r, path);
+  if (rc == -1) { perror(path); return 1; }
+  if (rc != 0) { fprintf(stderr, "%s: not a recorder file\n", path); return 1; }
+  const rec_hdr_t *h = r.hdr;
+
+  // Count the items first, so -n can start from the end
+  static rec_item_t it;
+  uint64_t items = 0;
+  start(&r, from);
+  while (rec_reader_next(&r, &it) && item_real(h, &it) <= to)
+    if (!only || it.kind == only) items++;
+  uint64_t skip_items = (last && items > last) ? items - last : 0;
+  start(&r, from);
+
+  while (rec_reader_next(&r, &it) && item_real(h, &it) <= to) {
+    if (only && it.kind != only) continue;
+    if (skip_items) { skip_items--; continue; }
+
+    if (wall) {
+      uint64_t t = item_real(h, &it);
+      time_t sec = (time_t)(t / 1000000000u);
+      struct tm tm;
+      char ts[32];
+      localtime_r(&sec, &tm);
+      strftime(ts, sizeof(ts), "%H:%M:%S", &tm);
+      printf("%s.%06llu", ts, (unsigned long long)(t % 1000000000u / 1000u));
+    } else {
+      double rel = (double)(int64_t)(it.t_ns - h->mono_ns) / 1e9;
+      printf("%12.6f", rel);
+    }
+    printf(" %-9s ch=%-3u %4uB ", rec_kind_name(it.kind), it.ch, it.total);
+    if (it.flags & REC_F_STREAM) fputs("~", stdout);       // Passthrough chunk
+    print_payload(it.kind, it.data, it.len);
+    if (!it.whole) fputs(" [torn]", stdout);
+    else if (it.len < it.total) printf(" [+%zuB cut]", (size_t)it.total - it.len);
+    putchar('\n');
+  }
+  if (r.seg)
+    fprintf(stderr, "%llu items, %llu items skipped (torn, or zstd blocks in a build without ZSTD=1)\n",
+            (unsigned long long)items, (unsigned long long)r.skipped);
+  else
+    fprintf(stderr, "%llu items, %llu slots skipped, ring %llu of %llu slots used\n",
+            (unsigned long long)items, (unsigned long long)r.skipped,
+            (unsigned long long)(r.head - r.start), (unsigned long long)h->capacity);
+  rec_reader_close(&r);
+  return 0;
+}
@@ -0,0 +1,394 @@
+// gs_recexport.c
+// -----------------------------------------------------------------------------
+// Columnar export of the flight recorder:
+//   Converts recorder segments (a GS_RECORD_DIR, rec_segment.h), one segment
+//   or a ring file into Parquet tables for offline analysis, one table per
+//   record kind, written as one file per segment:
+//     <OUT>/<kind>/<segment>.parquet         e.g. out/word_rx/rec-20261015-083000-0.parquet
+//   so a table is the glob of its directory:
+//     duckdb: SELECT type, count(*) FROM 'out/word_tx/*.parquet' GROUP BY type;
+//     pandas: pd.read_parquet('out/word_rx')
+//
+// Columns of every table:
+//   time     TIMESTAMP (us, UTC)  when the bridge recorded the item
+//   mono_ns  INT64                the recording bridge's CLOCK_MONOTONIC, for
+//                                 latencies between kinds within a run
+//   run      TIMESTAMP (us, UTC)  when that bridge opened its recorder: one run
+//   ch, flags, total (INT32), whole (BOOLEAN), data (BINARY, as recorded)
+// WORD_TX / WORD_RX add the decoded robot_bt_packet_t: word (INT64), pl,
+// type (INT32), msg (the layout: ctrl, ack, health, ...) and one nullable
+// INT64 column <msg>_<field> per field of cmd_codec.h's tables, set on the
+// rows of that layout. UDS, UART and LINK tables add text (data when it
+// is UTF-8, else null) and up (LINK) respectively.
+//
+// Each segment is streamed through its own writers, which hold one row
+// group per table (-g rows); -j segments are exported in parallel. A
+// sealed segment, once exported whole, is skipped by later runs (a
+// .<segment>.done stamp in OUT) unless -f, so a cron job keeps OUT current.
+//
+// Usage: gs_recexport.o [-o OUT] [-j JOBS] [-g ROWS] [-s FROM] [-e TO] [-f] SRC
+//   -o  output directory (default recexport)
+//   -j  segments exported at once (default: online CPUs)
+//   -g  rows per row group (default PQ_GROUP_ROWS)
+//   -s  only items from this time on (unix seconds, fractions allowed)
+//   -e  only items up to this time
+//   -f  export sealed segments again
+//
+// Build example:
+//   make recexport            (ZSTD=1: zstd pages, and reads zstd segments)
+// -----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "includes/cmd_structure.h"
+#include "includes/recorder/recorder.h"
+#include "includes/recorder/rec_segment.h"
+#include "includes/recorder/pq_write.h"
+
+#define EXPORT_JOBS_MAX 64
+
+// ------------------------- Tables -------------------------
+
+enum { C_TIME, C_MONO, C_RUN, C_CH, C_FLAGS, C_TOTAL, C_WHOLE, C_DATA, C_COMMON };
+#define COMMON_COLS \
+  { "time", PQ_INT64, 0, PQ_CONV_TS_MICROS }, \
+  { "mono_ns", PQ_INT64, 0, PQ_CONV_NONE }, \
+  { "run", PQ_INT64, 0, PQ_CONV_TS_MICROS }, \
+  { "ch", PQ_INT32, 0, PQ_CONV_NONE }, \
+  { "flags", PQ_INT32, 0, PQ_CONV_NONE }, \
+  { "total", PQ_INT32, 0, PQ_CONV_NONE }, \
+  { "whole", PQ_BOOL, 0, PQ_CONV_NONE }, \
+  { "data", PQ_BYTES, 0, PQ_CONV_NONE }
+
+// Layouts of a word, one per CMD_CODEC_MESSAGES entry
+#define MSG_ENUM(m, bf_t, FIELDS) WM_##m,
+enum { CMD_CODEC_MESSAGES(MSG_ENUM) WM_COUNT, WM_NONE = WM_COUNT };
+#undef MSG_ENUM
+#define MSG_NAME(m, bf_t, FIELDS) #m,
+static const char *const msg_names[WM_COUNT] = { CMD_CODEC_MESSAGES(MSG_NAME) };
+#undef MSG_NAME
+
+typedef struct {
+  uint8_t msg, lo, width, sign;
+  const char *field;
+} word_field_t;
+
+#define FIELD_SIGN_U 0
+#define FIELD_SIGN_S 1
+#define FIELD_SIGN_W 0
+#define FIELD_ROW(m, f, lo, wd, k) { WM_##m, lo, wd, FIELD_SIGN_##k, #f },
+#define MSG_FIELDS(m, bf_t, FIELDS) FIELDS(FIELD_ROW)
+static const word_field_t word_fields[] = { CMD_CODEC_MESSAGES(MSG_FIELDS) };
+#undef MSG_FIELDS
+#undef FIELD_ROW
+#define WORD_FIELDS ((int)(sizeof(word_fields) / sizeof(word_fields[0])))
+
+enum { C_WORD = C_COMMON, C_PL, C_TYPE, C_MSG, C_FIELDS };
+
+static const pq_col_t plain_cols[] = { COMMON_COLS };
+static const pq_col_t text_cols[] = { COMMON_COLS, { "text", PQ_BYTES, 1, PQ_CONV_UTF8 } };
+static const pq_col_t link_cols[] = { COMMON_COLS, { "up", PQ_BOOL, 1, PQ_CONV_NONE } };
+static pq_col_t word_cols[C_FIELDS + WORD_FIELDS];
+static char     word_col_names[WORD_FIELDS][48];
+static int      word_col_of[WORD_FIELDS];        // Column of each field, -1 = one of the common ones
+static int      word_ncols;
+
+static void word_schema(void) {
+  static const pq_col_t head[] = {
+    COMMON_COLS,
+    { "word", PQ_INT64, 0, PQ_CONV_NONE },
+    { "pl", PQ_INT32, 0, PQ_CONV_NONE },
+    { "type", PQ_INT32, 0, PQ_CONV_NONE },
+    { "msg", PQ_BYTES, 1, PQ_CONV_UTF8 },
+  };
+  memcpy(word_cols, head, sizeof(head));
+  word_ncols = C_FIELDS;
+  for (int i = 0; i < WORD_FIELDS; i++) {
+    const word_field_t *wf = &word_fields[i];
+    word_col_of[i] = -1;
+    if (strcmp(wf->field, "pl") == 0 || strcmp(wf->field, "type") == 0) continue;
+    snprintf(word_col_names[i], sizeof(word_col_names[i]), "%s_%s", msg_names[wf->msg], wf->field);
+    word_cols[word_ncols] = (pq_col_t){ word_col_names[i], PQ_INT64, 1, PQ_CONV_NONE };
+    word_col_of[i] = word_ncols++;
+  }
+}
+
+static int word_msg(uint64_t w) {
+  switch (cmd_word_type(w)) {
+    case CONTROL_CMD:      return WM_ctrl;
+    case ARM_CMD:          return WM_arm;
+    case System_CMD:       return WM_sys;
+    case Query_CMD:        return WM_query;
+    case HEALTH_CMD:       return WM_health;
+    case ACK_CMD:          return WM_ack;
+    case HPR_CMD:          return WM_hpr;
+    case ARM_TARGET_CMD:   return WM_armt;
+    case FEC_CMD:          return WM_fec;
+    case ROBOT_UPDATE_CMD: {
+      uint32_t part = cmd_nav_get_part(w);
+      return part == 0 ? WM_nav : part == 1 ? WM_pose : part == 2 ? WM_inert : WM_NONE;
+    }
+    case TRAJ_CMD: {
+      uint32_t op = cmd_trajd_get_op(w);
+      return op == TRAJ_OP_DRIVE ? WM_trajd : op == TRAJ_OP_ARM ? WM_traja : WM_trajc;
+    }
+    default: return WM_NONE;
+  }
+}
+
+static int is_word(int kind) { return kind == REC_WORD_TX || kind == REC_WORD_RX; }
+static int is_text(int kind) {
+  return kind == REC_UDS_IN || kind == REC_UDS_OUT || kind == REC_UART_TX || kind == REC_UART_RX;
+}
+
+static const pq_col_t *kind_cols(int kind, int *n) {
+  if (is_word(kind)) { *n = word_ncols; return word_cols; }
+  if (is_text(kind)) { *n = (int)(sizeof(text_cols) / sizeof(text_cols[0])); return text_cols; }
+  if (kind == REC_LINK) { *n = (int)(sizeof(link_cols) / sizeof(link_cols[0])); return link_cols; }
+  *n = (int)(sizeof(plain_cols) / sizeof(plain_cols[0]));
+  return plain_cols;
+}
+
+// Strict enough for DuckDB, which refuses a string column with bad UTF-8
+static int utf8_ok(const uint8_t *p, size_t n) {
+  for (size_t i = 0; i < n;) {
+    uint8_t c = p[i];
+    size_t k;
+    uint8_t lo = 0x80, hi = 0xBF;                          // Range of the second byte
+    if (c < 0x80) { i++; continue; }
+    else if (c >= 0xC2 && c <= 0xDF) k = 1;
+    else if (c >= 0xE0 && c <= 0xEF) { k = 2; if (c == 0xE0) lo = 0xA0; if (c == 0xED) hi = 0x9F; }
+    else if (c >= 0xF0 && c <= 0xF4) { k = 3; if (c == 0xF0) lo = 0x90; if (c == 0xF4) hi = 0x8F; }
+    else return 0;
+    if (i + k >= n || p[i + 1] < lo || p[i + 1] > hi) return 0;
+    for (size_t j = 2; j <= k; j++)
+      if ((p[i + j] & 0xC0) != 0x80) return 0;
+    i += k + 1;
+  }
+  return 1;
+}
+
+// ------------------------- One segment -------------------------
+
+typedef struct {
+  const char *out;
+  uint32_t    group_rows;
+  uint64_t    from, to;                     // CLOCK_REALTIME ns, 0 / UINT64_MAX = open
+  int         force;
+  char      **paths;
+  int         n;
+  atomic_int  next;
+  _Atomic uint64_t rows, done, skipped, failed;
+} export_t;
+
+typedef struct {
+  pq_file_t *pq[REC_KIND_COUNT];
+  char       part[REC_KIND_COUNT][800];
+} tables_t;
+
+static void kind_dir(char *buf, size_t n, const char *out, int kind) {
+  int len = snprintf(buf, n, "%s/%s", out, rec_kind_name(kind));
+  for (int i = (int)strlen(out) + 1; i < len && (size_t)i < n; i++)
+    if (buf[i] >= 'A' && buf[i] <= 'Z') buf[i] = (char)(buf[i] - 'A' + 'a');
+}
+
+static pq_file_t *table(tables_t *t, const export_t *x, int kind, const char *stem) {
+  if (t->pq[kind]) return t->pq[kind];
+  char dir[512];
+  int ncols;
+  const pq_col_t *cols = kind_cols(kind, &ncols);
+  kind_dir(dir, sizeof(dir), x->out, kind);
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) { perror(dir); return NULL; }
+  snprintf(t->part[kind], sizeof(t->part[kind]), "%s/%s.parquet.part", dir, stem);
+  t->pq[kind] = pq_open(t->part[kind], cols, ncols, x->group_rows);
+  if (!t->pq[kind]) perror(t->part[kind]);
+  return t->pq[kind];
+}
+
+static int put_item(pq_file_t *pq, const rec_hdr_t *h, const rec_item_t *it) {
+  uint64_t real = h->real_ns + (it->t_ns - h->mono_ns);
+  pq_int(pq, C_TIME, (int64_t)(real / 1000u));
+  pq_int(pq, C_MONO, (int64_t)it->t_ns);
+  pq_int(pq, C_RUN, (int64_t)(h->real_ns / 1000u));
+  pq_int(pq, C_CH, it->ch);
+  pq_int(pq, C_FLAGS, it->flags);
+  pq_int(pq, C_TOTAL, it->total);
+  pq_int(pq, C_WHOLE, it->whole);
+  pq_bytes(pq, C_DATA, it->data, it->len);
+
+  if (is_word(it->kind) && it->len == 8) {
+    robot_bt_packet_t pkt;
+    memcpy(pkt.bytes, it->data, 8);
+    uint64_t w = pkt.raw;
+    int msg = word_msg(w);
+    pq_int(pq, C_WORD, (int64_t)w);
+    pq_int(pq, C_PL, cmd_word_pl(w));
+    pq_int(pq, C_TYPE, cmd_word_type(w));
+    if (msg != WM_NONE) {
+      pq_bytes(pq, C_MSG, msg_names[msg], strlen(msg_names[msg]));
+      for (int i = 0; i < WORD_FIELDS; i++) {
+        const word_field_t *wf = &word_fields[i];
+        if (wf->msg != msg || word_col_of[i] < 0) continue;
+        pq_int(pq, word_col_of[i], wf->sign ? cmd_bits_sget(w, wf->lo, wf->width)
+                                            : (int64_t)cmd_bits_get(w, wf->lo, wf->width));
+      }
+    }
+  } else if (is_text(it->kind) && utf8_ok(it->data, it->len)) {
+    pq_bytes(pq, C_COMMON, it->data, it->len);
+  } else if (it->kind == REC_LINK && it->len == 1) {
+    pq_int(pq, C_COMMON, it->data[0]);
+  }
+  return pq_row(pq);
+}
+
+// Whether a segment has anything in [from, to]: from its trailer, no block read
+static int in_range(const export_t *x, const char *path) {
+  rec_seg_hdr_t h;
+  rec_seg_trailer_t tr;
+  if ((x->from == 0 && x->to == UINT64_MAX) || rec_seg_stat(path, &h, &tr) != 0) return 1;
+  if (!tr.items) return 0;
+  uint64_t first = h.real_ns + (tr.t_first - h.mono_ns), last = h.real_ns + (tr.t_last - h.mono_ns);
+  return last >= x->from && first <= x->to;
+}
+
+static int export_one(export_t *x, const char *path) {
+  const char *base = strrchr(path, '/');
+  base = base ? base + 1 : path;
+  char stem[256], stamp[600];
+  snprintf(stem, sizeof(stem), "%s", base);
+  char *dot = strstr(stem, ".seg");
+  if (!dot) dot = strrchr(stem, '.');
+  if (dot && dot != stem) *dot = '\0';
+  snprintf(stamp, sizeof(stamp), "%s/.%s.done", x->out, stem);
+
+  // Only a .seg read whole gets a stamp: sealed, or kept from a crash, it no
+  // longer grows; a .part (or a ring) does
+  size_t plen = strlen(path);
+  int sealed = plen > 4 && strcmp(path + plen - 4, ".seg") == 0;
+  int whole = x->from == 0 && x->to == UINT64_MAX;
+  if (sealed && whole && !x->force && access(stamp, F_OK) == 0) {
+    atomic_fetch_add(&x->skipped, 1);
+    return 0;
+  }
+  if (!in_range(x, path)) return 0;
+
+  rec_reader_t r;
+  int rc = rec_reader_open(&r, path);
+  if (rc != 0) {
+    fprintf(stderr, "%s: %s\n", path, rc == -1 ? strerror(errno) : "not a recorder file");
+    return -1;
+  }
+  if (x->from && rec_reader_seek(&r, x->from) != 0) {
+    rec_reader_close(&r);
+    return 0;
+  }
+
+  rec_item_t it;
+  tables_t *t = calloc(1, sizeof(*t));
+  int err = !t;
+  uint64_t rows = 0, skipped;
+  while (!err && rec_reader_next(&r, &it)) {
+    if (r.hdr->real_ns + (it.t_ns - r.hdr->mono_ns) > x->to) break;
+    if (it.kind >= REC_KIND_COUNT) continue;
+    pq_file_t *pq = table(t, x, it.kind, stem);
+    if (!pq || put_item(pq, r.hdr, &it) != 0) err = 1;
+    rows++;
+  }
+  skipped = r.skipped;                                     // zstd blocks in a build without it, torn items
+  if (skipped) fprintf(stderr, "%s: %llu unreadable items skipped\n", path, (unsigned long long)skipped);
+  rec_reader_close(&r);
+
+  for (int k = 0; t && k < REC_KIND_COUNT; k++) {
+    if (!t->pq[k]) continue;
+    char final[800];
+    snprintf(final, sizeof(final), "%.*s", (int)(strlen(t->part[k]) - 5), t->part[k]);
+    if (pq_close(t->pq[k]) != 0 || err) {
+      fprintf(stderr, "%s: write failed\n", t->part[k]);
+      unlink(t->part[k]);
+      err = 1;
+    } else if (rename(t->part[k], final) != 0) {
+      perror(final);
+      err = 1;
+    }
+  }
+  free(t);
+  if (err) return -1;
+  atomic_fetch_add(&x->rows, rows);
+  atomic_fetch_add(&x->done, 1);
+  if (sealed && whole && !skipped) {
+    FILE *fp = fopen(stamp, "w");
+    if (fp) fclose(fp);
+  }
+  return 0;
+}
+
+static void *worker(void *arg) {
+  export_t *x = arg;
+  for (int i; (i = atomic_fetch_add(&x->next, 1)) < x->n;)
+    if (export_one(x, x->paths[i]) != 0) atomic_fetch_add(&x->failed, 1);
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  static export_t x;
+  int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN), opt;
+  x.out = "recexport";
+  x.group_rows = PQ_GROUP_ROWS;
+  x.to = UINT64_MAX;
+  while ((opt = getopt(argc, argv, "o:j:g:s:e:f")) != -1) {
+    switch (opt) {
+      case 'o': x.out = optarg; break;
+      case 'j': jobs = atoi(optarg); break;
+      case 'g': x.group_rows = (uint32_t)strtoul(optarg, NULL, 10); break;
+      case 's': x.from = (uint64_t)(strtod(optarg, NULL) * 1e9); break;
+      case 'e': x.to = (uint64_t)(strtod(optarg, NULL) * 1e9); break;
+      case 'f': x.force = 1; break;
+      default:
+        fprintf(stderr, "Usage: %s [-o OUT] [-j JOBS] [-g ROWS] [-s FROM] [-e TO] [-f] SRC\n", argv[0]);
+        return 1;
+    }
+  }
+  if (optind != argc - 1) {                  // Exactly one SRC; OUT only via -o
+    fprintf(stderr, "Usage: %s [-o OUT] [-j JOBS] [-g ROWS] [-s FROM] [-e TO] [-f] SRC\n", argv[0]);
+    return 1;
+  }
+  const char *src = argv[optind];
+  if (jobs < 1) jobs = 1;
+  if (jobs > EXPORT_JOBS_MAX) jobs = EXPORT_JOBS_MAX;
+  if (!x.group_rows) x.group_rows = PQ_GROUP_ROWS;
+  word_schema();
+
+  struct stat st;
+  if (stat(src, &st) != 0) { perror(src); return 1; }
+  if (S_ISDIR(st.st_mode)) {
+    x.n = rec_seg_list(src, &x.paths);
+    if (x.n < 0) { perror(src); return 1; }
+  } else {
+    static char *one[1];
+    one[0] = (char *)src;
+    x.paths = one;
+    x.n = 1;
+  }
+  if (mkdir(x.out, 0755) != 0 && errno != EEXIST) { perror(x.out); return 1; }
+
+  pthread_t th[EXPORT_JOBS_MAX];
+  int started = 0;
+  if (jobs > x.n) jobs = x.n;
+  for (int j = 0; j < jobs; j++)
+    if (pthread_create(&th[j], NULL, worker, &x) == 0) started++;
+  if (!started) worker(&x);
+  for (int j = 0; j < started; j++) pthread_join(th[j], NULL);
+
+  fprintf(stderr, "%llu rows from %llu segments into %s, %llu already exported, %llu failed\n",
+          (unsigned long long)x.rows, (unsigned long long)x.done, x.out,
+          (unsigned long long)x.skipped, (unsigned long long)x.failed);
+  if (S_ISDIR(st.st_mode)) rec_seg_list_free(x.paths, x.n);
+  return x.failed ? 1 : 0;
+}
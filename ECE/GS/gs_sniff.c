@@ -0,0 +1,380 @@
+// gs_sniff.c
+// -----------------------------------------------------------------------------
+// Capture daemon:
+//   ubertooth-btle -f -c <pcap> keeps appending to a capture file; this
+//   daemon follows it (only the bytes written since the last poll are read),
+//   decodes ATT writes/notifications on the robot characteristic straight
+//   into robot_bt_packet_t words and pushes them to the attacker UI.
+//   Replaces re-running tshark over the whole file every second.
+//
+// UDS frame format (same as the bridge):
+//   4-byte big-endian length, then JSON bytes
+//   {"type":"sniffed_packet","frame":N,"time":"0.123456","protocol":"ATT",
+//    "info":"Write Request","handle":42,"value":"1234567854230804"}
+//   then one {"type":"sniffed_word",...} per robot word in the value
+//
+// Config (env): SNIFF_PCAP (or argv[1]), SNIFF_UDS, SNIFF_HANDLE (0 = all)
+//
+// Several dongles (capture_merge.h): SNIFF_PCAP as a comma-separated list
+// (or several arguments) follows one file per sniffer and merges them into
+// one ordered, deduplicated stream. SNIFF_DEVICES=n starts the sniffers as
+// well: ubertooth-btle -U i -f -A 37+i%3 -c <pcap>.i, or SNIFF_CAPTURE_CMD
+// through /bin/sh with CAPTURE_INDEX, CAPTURE_CHANNEL and CAPTURE_PCAP set
+// (e.g. an nRF sniffer). They are stopped with the daemon (SIGINT/SIGTERM).
+// SNIFF_MERGE_HOLD_MS / SNIFF_DEDUP_US tune the merge.
+//
+// Build example:
+//   make sniff
+// -----------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+#include <errno.h>                      // errno and error codes
+#include <fcntl.h>                      // fcntl() flags
+#include <signal.h>                     // kill()
+#include <spawn.h>                      // posix_spawnp() for the capture processes
+#include <stdint.h>
+#include <stdio.h>                      // printf(), snprintf()
+#include <stdlib.h>                     // getenv(), strtoul()
+#include <string.h>
+#include <sys/signalfd.h>               // signalfd() for a clean shutdown
+#include <sys/socket.h>                 // accept4()
+#include <sys/wait.h>                   // waitpid()
+#include <unistd.h>                     // close(), unlink()
+#include "includes/cmd_structure.h"
+#include "includes/cmd_parser/cmd_parser.h"
+#include "includes/cmd_parser/report_json.h"
+#include "includes/pcap_ingest/pcap_ingest.h"
+#include "includes/pcap_ingest/capture_merge.h"
+#include "includes/json_uds/json_uds.h"
+#include "includes/event_loop/event_loop.h"
+#include "hex_codec.h"
+
+// ------------------------- Defaults / Config -------------------------
+
+#define DEFAULT_SNIFF_PCAP "/tmp/ubertooth_live.pcap" // Written by ubertooth-btle -c
+#define DEFAULT_SNIFF_UDS  "/tmp/gs_sniff.sock"
+#define DEFAULT_SNIFF_HANDLE 0x002a                   // Robot characteristic value
+#define SNIFF_POLL_MS      20                         // Capture file poll period
+#define SNIFF_JSON_MAX     (UDS_TX_SLOT_MAX - 1)
+#define SNIFF_PATH_MAX     256
+
+typedef struct {
+  int      fd;                                        // Client socket (-1 = free)
+  uds_rx_t rx;                                        // Inbound frames are read and ignored
+  uds_tx_t tx;
+} sniff_client_t;
+
+static ev_loop_t      g_loop;
+static sniff_client_t g_clients[UDS_MAX_CLIENTS];
+static pcap_follow_t  g_pcap;                         // 64 KiB window, keep it off the stack
+static capture_merge_t g_merge;                       // Several capture files (g_n_pcap > 1)
+static int            g_n_pcap = 1;
+static pid_t          g_capture_pid[CAPTURE_MAX_SOURCES];
+static uint32_t       g_handle = DEFAULT_SNIFF_HANDLE;
+static uint64_t       g_ts0 = 0;                      // First record, for relative times
+static int            g_have_ts0 = 0;
+static uint64_t       g_events = 0;
+
+#define SNIFF_CLIENT_EVENTS (EPOLLIN | EPOLLRDHUP)
+
+static void sniff_client_close(sniff_client_t *c) {
+  if (c->fd < 0) return;
+  ev_del(&g_loop, c->fd);
+  close(c->fd);
+  uds_rx_reset(&c->rx);
+  uds_tx_close(&c->tx);
+  printf("UI client fd=%d disconnected.\n", c->fd);
+  c->fd = -1;
+}
+
+static void sniff_client_want_write(int fd, int on) {
+  ev_mod(&g_loop, fd, SNIFF_CLIENT_EVENTS | (on ? EPOLLOUT : 0));
+}
+
+// ------------------------- Event encoding -------------------------
+
+// Robot word as seen on air: notifications are reports (templated like the
+// bridge prints them), writes are GS commands (type and priority only, the
+// payload layout depends on the command).
+static void emit_word(uint64_t frame, const att_event_t *ev, robot_bt_packet_t w) {
+  char js[SNIFF_JSON_MAX + 1];
+  char hex[17];
+  hexc_encode(w.bytes, 8, hex, 0);
+
+  int notify = (ev->opcode == ATT_NOTIFY || ev->opcode == ATT_INDICATE);
+  int n = snprintf(js, sizeof(js), "{\"type\":\"sniffed_word\",\"frame\":%llu,\"dir\":\"%s\",\"word\":\"%s\",",
+                   (unsigned long long)frame, notify ? "robot" : "gs", hex);
+  if (n < 0 || (size_t)n >= sizeof(js)) return;
+
+  if (notify) {
+    int r = robot_report_json(w, js + n + 9, sizeof(js) - (size_t)n - 10);
+    if (r < 0) return;
+    memcpy(js + n, "\"report\":", 9);
+    n += 9 + r;
+  } else {
+    int r = snprintf(js + n, sizeof(js) - (size_t)n, "\"cmd\":{\"type\":%u,\"pl\":%u}",
+                     (unsigned)w.ctrl.type, (unsigned)w.ctrl.pl);
+    if (r < 0 || (size_t)r >= sizeof(js) - (size_t)n) return;
+    n += r;
+  }
+  if ((size_t)n + 2 > sizeof(js)) return;
+  js[n++] = '}';
+  js[n] = '\0';
+  uds_tx_broadcast(js, UDS_TX_TELEM, 0, UDS_TOPIC_SNIFF, UDS_ROBOT_ANY);
+}
+
+static void on_record(void *ctx, const pcap_record_t *rec) {
+  (void)ctx;
+  att_event_t ev;
+  if (!ble_att_decode(rec->linktype, rec->data, rec->len, &ev)) return;
+  if (g_handle && ev.handle != g_handle) return;
+
+  if (!g_have_ts0) { g_ts0 = rec->ts_us; g_have_ts0 = 1; }
+  uint64_t rel = rec->ts_us >= g_ts0 ? rec->ts_us - g_ts0 : 0;
+
+  // Value as hex, capped so the frame always fits a TX slot
+  char hex[2 * 256 + 1];
+  size_t vlen = ev.value_len > 256 ? 256 : ev.value_len;
+  hexc_encode(ev.value, vlen, hex, 0);
+
+  char js[SNIFF_JSON_MAX + 1];
+  int n = snprintf(js, sizeof(js),
+                   "{\"type\":\"sniffed_packet\",\"frame\":%llu,\"time\":\"%llu.%06llu\",\"protocol\":\"ATT\","
+                   "\"info\":\"%s\",\"handle\":%u,\"value\":\"%s\"}",
+                   (unsigned long long)rec->frame, (unsigned long long)(rel / 1000000u),
+                   (unsigned long long)(rel % 1000000u), att_opcode_name(ev.opcode),
+                   (unsigned)ev.handle, hex);
+  if (n < 0 || (size_t)n >= sizeof(js)) return;
+  uds_tx_broadcast(js, UDS_TX_TELEM, 0, UDS_TOPIC_SNIFF, UDS_ROBOT_ANY);
+  printf("[SNIFF] #%llu %s handle=0x%04x %s\n", (unsigned long long)rec->frame,
+         att_opcode_name(ev.opcode), (unsigned)ev.handle, hex);
+  g_events++;
+
+  robot_bt_packet_t words[ROBOT_BATCH_MAX];
+  int k = sniff_value_words(ev.value, ev.value_len, words, ROBOT_BATCH_MAX);
+  for (int i = 0; i < k; i++) emit_word(rec->frame, &ev, words[i]);
+}
+
+// ------------------------- Loop handlers -------------------------
+
+static void on_poll_timer(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  if (g_n_pcap > 1) {
+    capture_merge_poll(&g_merge, on_record, NULL);
+    return;
+  }
+  if (pcap_follow_poll(&g_pcap, on_record, NULL) < 0)
+    fprintf(stderr, "SNIFF: %s is not a pcap/pcapng capture, waiting for a new one\n", g_pcap.path);
+}
+
+static int on_client_frame(void *ctx, char *frame, uint32_t len) {
+  (void)ctx; (void)frame; (void)len;
+  return 0;                                           // The UI only listens
+}
+
+static void on_client(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd;
+  sniff_client_t *c = (sniff_client_t *)ctx;
+
+  if ((events & EPOLLOUT) && uds_tx_flush(&c->tx) < 0) { sniff_client_close(c); return; }
+  if (!(events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) return;
+
+  int r = uds_rx_read(c->fd, &c->rx, on_client_frame, c);
+  if (r < 0 || (events & (EPOLLHUP | EPOLLERR))) sniff_client_close(c);
+}
+
+static void on_listen(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)events; (void)ctx;
+
+  while (1) {
+    int cfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (cfd < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+      return;
+    }
+
+    sniff_client_t *c = NULL;
+    for (int i = 0; i < UDS_MAX_CLIENTS; i++) {
+      if (g_clients[i].fd < 0) { c = &g_clients[i]; break; }
+    }
+    if (!c) {
+      fprintf(stderr, "UDS: client limit (%d) reached, rejecting\n", UDS_MAX_CLIENTS);
+      close(cfd);
+      continue;
+    }
+
+    c->fd = cfd;
+    uds_rx_init(&c->rx);
+    if (ev_add(loop, cfd, SNIFF_CLIENT_EVENTS, on_client, c) != 0) {
+      close(cfd);
+      c->fd = -1;
+      continue;
+    }
+    uds_tx_init(&c->tx, cfd, sniff_client_want_write);
+    printf("UI client fd=%d connected.\n", cfd);
+  }
+}
+
+// SIGINT / SIGTERM stop the loop so the capture processes are stopped too;
+// SIGCHLD reports one that exited on its own.
+static void on_signal(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)events; (void)ctx;
+  struct signalfd_siginfo si;
+  if (read(fd, &si, sizeof(si)) != (ssize_t)sizeof(si)) return;
+  if (si.ssi_signo == SIGCHLD) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+      for (int i = 0; i < CAPTURE_MAX_SOURCES; i++) {
+        if (g_capture_pid[i] != pid) continue;
+        fprintf(stderr, "SNIFF: capture %d (pid %d) exited with status %d\n", i, (int)pid, status);
+        g_capture_pid[i] = 0;
+      }
+    }
+    return;
+  }
+  printf("Signal %u, shutting down\n", si.ssi_signo);
+  ev_loop_stop(loop);
+}
+
+// Capture process i writing path: SNIFF_CAPTURE_CMD, or ubertooth-btle
+// following connections from advertising channel 37 + i % 3
+static pid_t capture_spawn(int i, const char *path, const char *cmd) {
+  char idx[12], ch[12];
+  snprintf(idx, sizeof(idx), "%d", i);
+  snprintf(ch, sizeof(ch), "%d", 37 + i % 3);
+
+  posix_spawnattr_t attr;
+  sigset_t none, dflt;
+  sigemptyset(&none);
+  sigemptyset(&dflt);
+  sigaddset(&dflt, SIGINT);
+  sigaddset(&dflt, SIGTERM);
+  sigaddset(&dflt, SIGPIPE);
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setsigmask(&attr, &none);           // Ours are blocked for the signalfd
+  posix_spawnattr_setsigdefault(&attr, &dflt);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+  pid_t pid = 0;
+  int r;
+  if (cmd && cmd[0]) {
+    setenv("CAPTURE_INDEX", idx, 1);
+    setenv("CAPTURE_CHANNEL", ch, 1);
+    setenv("CAPTURE_PCAP", path, 1);
+    char *argv[] = { "sh", "-c", (char *)cmd, NULL };
+    r = posix_spawn(&pid, "/bin/sh", NULL, &attr, argv, environ);
+  } else {
+    char *argv[] = { "ubertooth-btle", "-U", idx, "-f", "-A", ch, "-c", (char *)path, NULL };
+    r = posix_spawnp(&pid, "ubertooth-btle", NULL, &attr, argv, environ);
+  }
+  posix_spawnattr_destroy(&attr);
+  if (r != 0) {
+    fprintf(stderr, "SNIFF: capture %d: %s\n", i, strerror(r));
+    return 0;
+  }
+  printf("Capture %d (pid %d) on channel %s -> %s\n", i, (int)pid, ch, path);
+  return pid;
+}
+
+// ------------------------- Main -------------------------
+
+int main(int argc, char **argv) {
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  const char *pcap_path = DEFAULT_SNIFF_PCAP;
+  const char *env_pcap = getenv("SNIFF_PCAP");
+  if (env_pcap && env_pcap[0]) pcap_path = env_pcap;
+  if (argc >= 2) pcap_path = argv[1];
+
+  // One file per sniffer: several arguments, a comma-separated list, or
+  // SNIFF_DEVICES sniffers started here writing <pcap>.0, <pcap>.1, ...
+  static char paths[CAPTURE_MAX_SOURCES][SNIFF_PATH_MAX];
+  const char *path_list[CAPTURE_MAX_SOURCES];
+  const char *env_devices = getenv("SNIFF_DEVICES");
+  int devices = env_devices && env_devices[0] ? atoi(env_devices) : 0;
+  if (devices > CAPTURE_MAX_SOURCES) devices = CAPTURE_MAX_SOURCES;
+  g_n_pcap = 0;
+  if (devices > 0) {
+    for (; g_n_pcap < devices; g_n_pcap++)
+      snprintf(paths[g_n_pcap], SNIFF_PATH_MAX, "%s.%d", pcap_path, g_n_pcap);
+  } else if (argc > 2) {
+    for (int i = 1; i < argc && g_n_pcap < CAPTURE_MAX_SOURCES; i++)
+      snprintf(paths[g_n_pcap++], SNIFF_PATH_MAX, "%s", argv[i]);
+  } else {
+    for (const char *p = pcap_path; *p && g_n_pcap < CAPTURE_MAX_SOURCES; g_n_pcap++) {
+      size_t n = strcspn(p, ",");
+      snprintf(paths[g_n_pcap], SNIFF_PATH_MAX, "%.*s", (int)n, p);
+      p += n + (p[n] == ',');
+    }
+  }
+  for (int i = 0; i < g_n_pcap; i++) path_list[i] = paths[i];
+  if (g_n_pcap == 0) path_list[g_n_pcap++] = pcap_path;
+  pcap_path = path_list[0];
+
+  const char *uds_path = DEFAULT_SNIFF_UDS;
+  const char *env_uds = getenv("SNIFF_UDS");
+  if (env_uds && env_uds[0]) uds_path = env_uds;
+
+  const char *env_handle = getenv("SNIFF_HANDLE");
+  if (env_handle && env_handle[0]) g_handle = (uint32_t)strtoul(env_handle, NULL, 0);
+
+  int uds_listen = uds_server_listen(uds_path);
+  if (uds_listen < 0) return 1;
+  fcntl(uds_listen, F_SETFL, O_NONBLOCK);
+
+  for (int i = 0; i < UDS_MAX_CLIENTS; i++) g_clients[i].fd = -1;
+  if (g_n_pcap > 1) {
+    const char *env_hold = getenv("SNIFF_MERGE_HOLD_MS");
+    const char *env_dedup = getenv("SNIFF_DEDUP_US");
+    uint64_t hold_us = env_hold && env_hold[0] ? strtoull(env_hold, NULL, 0) * 1000u : 0;
+    uint64_t dedup_us = env_dedup && env_dedup[0] ? strtoull(env_dedup, NULL, 0) : 0;
+    if (capture_merge_init(&g_merge, path_list, g_n_pcap, hold_us, dedup_us) != 0) return 1;
+  } else {
+    pcap_follow_init(&g_pcap, pcap_path);
+  }
+
+  sigset_t sigs;                                      // Blocked before the captures start
+  sigemptyset(&sigs);
+  sigaddset(&sigs, SIGINT);
+  sigaddset(&sigs, SIGTERM);
+  sigaddset(&sigs, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &sigs, NULL);
+
+  if (ev_loop_init(&g_loop) != 0) return 1;
+  int sig_fd = signalfd(-1, &sigs, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (sig_fd < 0 || ev_add(&g_loop, sig_fd, EPOLLIN, on_signal, NULL) != 0) return 1;
+  if (ev_add(&g_loop, uds_listen, EPOLLIN, on_listen, NULL) != 0) return 1;
+  if (ev_timer_add(&g_loop, 1, SNIFF_POLL_MS, on_poll_timer, NULL) < 0) return 1;
+
+  for (int i = 0; i < devices; i++) g_capture_pid[i] = capture_spawn(i, path_list[i], getenv("SNIFF_CAPTURE_CMD"));
+
+  printf("Sniffer up. PCAP=%s%s UDS=%s handle=0x%04x\n", pcap_path, g_n_pcap > 1 ? " (+ more, merged)" : "",
+         uds_path, (unsigned)g_handle);
+
+  ev_loop_run(&g_loop);
+
+  for (int i = 0; i < devices; i++) {
+    if (g_capture_pid[i] <= 0) continue;
+    kill(g_capture_pid[i], SIGTERM);
+    waitpid(g_capture_pid[i], NULL, 0);
+  }
+  if (g_n_pcap > 1) {
+    capture_merge_poll(&g_merge, on_record, NULL);      // What the captures wrote last
+    capture_merge_flush(&g_merge, on_record, NULL);
+    printf("Merged %llu records from %d captures: %llu duplicates, %llu out of order, %llu queue overflows\n",
+           (unsigned long long)g_merge.frame, g_n_pcap, (unsigned long long)g_merge.dup,
+           (unsigned long long)g_merge.late, (unsigned long long)g_merge.overflow);
+  }
+
+  for (int i = 0; i < UDS_MAX_CLIENTS; i++) sniff_client_close(&g_clients[i]);
+  ev_loop_close(&g_loop);
+  if (g_n_pcap > 1) capture_merge_close(&g_merge);
+  else pcap_follow_close(&g_pcap);
+  close(sig_fd);
+  close(uds_listen);
+  unlink(uds_path);
+  printf("Sniffer down after %llu ATT events\n", (unsigned long long)g_events);
+  return 0;
+}
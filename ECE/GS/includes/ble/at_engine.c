@@ -0,0 +1,337 @@
+#include "at_engine.h"
+#include "at_tok.h"
+#include "../metrics/metrics.h"
+#include "../recorder/recorder.h"
+#include "../log/gs_log.h"
+#include "../event_loop/event_loop.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define AT_QUEUE_MASK (AT_QUEUE_MAX - 1)
+
+typedef enum {
+    AT_ST_QUEUED = 0,                       /* Not written yet */
+    AT_ST_PROMPT,                           /* Waiting for ">" before the payload */
+    AT_ST_RESULT                            /* Waiting for OK / ERROR (or the expect token) */
+} at_stage_t;
+
+typedef struct {
+    char       cmd[AT_CMD_MAX];             /* "" for expect-only entries */
+    char       token[AT_VALUE_MAX];         /* Reply prefix to capture, or line to expect */
+    uint8_t    data[AT_DATA_MAX];
+    uint16_t   data_len;
+    uint8_t    expect;
+    int        timeout_ms;
+    at_done_fn done;
+    void      *ctx;
+    char       value[AT_VALUE_MAX];
+    at_stage_t stage;
+    uint64_t   t_write_us;                  /* Command line written (round-trip metric) */
+} at_cmd_t;
+
+typedef struct {
+    at_cmd_t    q[AT_QUEUE_MAX];
+    uint32_t    head, tail;                 /* Free-running, main thread only */
+    uint32_t    urgent_end;                 /* Slot after the last urgent entry */
+    int         fd;
+    at_timer_fn arm;
+    at_gate_fn  gate;
+} at_unit_t;
+
+static at_unit_t g_units[AT_UNITS_MAX] = { [0 ... AT_UNITS_MAX - 1] = { .fd = -1 } };
+static int       g_cur = 0;                 /* Unit the public calls address */
+static int       g_urgent = 0;              /* at_engine_urgent(): commit at the front */
+
+static void kick(at_unit_t *u);
+
+/* The timer callback reads at_engine_unit() to find the radio's timer */
+static void arm(at_unit_t *u, int ms)
+{
+    if (!u->arm) return;
+    int cur = g_cur;
+    g_cur = (int)(u - g_units);
+    u->arm(ms);
+    g_cur = cur;
+}
+
+/* The UART is O_NONBLOCK; a 160-byte write only waits if the tty buffer is
+ * genuinely full, which is bounded by the baud rate, not the modem. */
+static int write_all(at_unit_t *u, const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+    rec_put(REC_UART_TX, (int)(u - g_units), buf, len);
+    int q = ev_write(u->fd, buf, len);                  /* io_uring loop: rides the next enter */
+    if (q == 0) { METRIC_ADD(uart_tx_bytes, len); return 0; }
+    if (q < -1) return -1;
+    while (len) {
+        ssize_t n = write(u->fd, p, len);
+        if (n > 0) { p += n; len -= (size_t)n; METRIC_ADD(uart_tx_bytes, n); continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) {
+            struct pollfd pfd = { .fd = u->fd, .events = POLLOUT };
+            if (poll(&pfd, 1, 100) > 0) continue;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/* The callback runs with u selected, so a chain's next step goes to the
+ * same radio */
+static void complete(at_unit_t *u, int status)
+{
+    at_cmd_t *c = &u->q[u->head & AT_QUEUE_MASK];
+    at_done_fn done = c->done;
+    void *ctx = c->ctx;
+    char value[AT_VALUE_MAX];
+    memcpy(value, c->value, sizeof(value));
+
+    METRIC_INC(at_commands);
+    if (status == AT_ERR) METRIC_INC(at_errors);
+    if (status == AT_TIMEOUT) METRIC_INC(at_timeouts);
+    if (c->t_write_us) METRIC_OBSERVE(at_rtt_us, metrics_now_us() - c->t_write_us);
+
+    arm(u, 0);
+    u->head++;                              /* Free the slot before the callback resubmits */
+    g_cur = (int)(u - g_units);
+    if (done) done(status, value, ctx);
+    else if (status != AT_OK) LOG_WARN("AT: '%.*s' failed (%d)",
+                                      (int)strcspn(c->cmd, "\r\n"), c->cmd, status);
+    kick(u);
+}
+
+static void kick(at_unit_t *u)
+{
+    if (u->head == u->tail || u->fd < 0) return;
+
+    at_cmd_t *c = &u->q[u->head & AT_QUEUE_MASK];
+    if (c->stage != AT_ST_QUEUED) return;   /* Already in flight */
+    if (u->gate && !u->gate()) return;      /* Modem not in AT mode yet */
+
+    if (c->cmd[0] && write_all(u, c->cmd, strlen(c->cmd)) < 0) {
+        complete(u, AT_ERR);
+        return;
+    }
+    c->stage = (c->data_len && !c->expect) ? AT_ST_PROMPT : AT_ST_RESULT;
+    c->t_write_us = c->cmd[0] ? metrics_now_us() : 0;   /* Expect-only: nothing to time */
+    arm(u, c->timeout_ms);
+}
+
+static int line_is(const uint8_t *l, size_t n, const char *s)
+{
+    size_t k = strlen(s);
+    return n == k && memcmp(l, s, k) == 0;
+}
+
+static at_cmd_t *enqueue(const char *cmd, int timeout_ms, at_done_fn done, void *ctx)
+{
+    at_unit_t *u = &g_units[g_cur];
+    if (u->fd < 0) return NULL;
+    if (u->tail - u->head == AT_QUEUE_MAX) return NULL;
+    if (cmd && strlen(cmd) >= AT_CMD_MAX) return NULL;
+
+    at_cmd_t *c = &u->q[u->tail & AT_QUEUE_MASK];
+    memset(c, 0, offsetof(at_cmd_t, data));
+    if (cmd) strcpy(c->cmd, cmd);
+    c->data_len   = 0;
+    c->expect     = 0;
+    c->timeout_ms = timeout_ms > 0 ? timeout_ms : 1000;
+    c->done       = done;
+    c->ctx        = ctx;
+    c->value[0]   = '\0';
+    c->stage      = AT_ST_QUEUED;
+    c->t_write_us = 0;
+    return c;
+}
+
+/* An urgent entry goes right behind the one in flight (and any urgent ones
+ * already there), so it is the next command the modem sees */
+static void hop(at_unit_t *u)
+{
+    uint32_t pos = u->head;
+    if (pos != u->tail && u->q[pos & AT_QUEUE_MASK].stage != AT_ST_QUEUED) pos++;
+    if ((int32_t)(u->urgent_end - pos) > 0) pos = u->urgent_end;
+    while (pos != u->tail && !u->q[pos & AT_QUEUE_MASK].cmd[0]) pos++;   /* Expect-only: part of the one before */
+    if (pos != u->tail) {
+        at_cmd_t c = u->q[u->tail & AT_QUEUE_MASK];
+        for (uint32_t i = u->tail; i != pos; i--) u->q[i & AT_QUEUE_MASK] = u->q[(i - 1) & AT_QUEUE_MASK];
+        u->q[pos & AT_QUEUE_MASK] = c;
+    }
+    u->urgent_end = pos + 1;
+}
+
+static int commit(void)
+{
+    at_unit_t *u = &g_units[g_cur];
+    if (g_urgent) hop(u);
+    u->tail++;
+    kick(u);
+    return AT_OK;
+}
+
+// ------------------------- Public API -------------------------
+
+/* Initialises the selected unit */
+int at_engine_init(int uart_fd, at_timer_fn arm_timer)
+{
+    if (uart_fd < 0) return AT_EINVAL;
+    at_unit_t *u = &g_units[g_cur];
+    u->fd   = uart_fd;
+    u->arm  = arm_timer;
+    u->head = u->tail = u->urgent_end = 0;
+    return AT_OK;
+}
+
+void at_engine_use(int unit)
+{
+    if (unit >= 0 && unit < AT_UNITS_MAX) g_cur = unit;
+}
+
+int at_engine_unit(void)
+{
+    return g_cur;
+}
+
+int at_engine_active(void)
+{
+    return g_units[g_cur].fd >= 0;
+}
+
+size_t at_engine_depth(void)
+{
+    return g_units[g_cur].tail - g_units[g_cur].head;
+}
+
+void at_engine_set_gate(at_gate_fn gate)
+{
+    g_units[g_cur].gate = gate;
+}
+
+void at_engine_urgent(int on)
+{
+    g_urgent = on;
+}
+
+void at_engine_kick(void)
+{
+    kick(&g_units[g_cur]);
+}
+
+void at_engine_flush(void)
+{
+    at_unit_t *u = &g_units[g_cur];
+    while (u->head != u->tail) {
+        at_cmd_t *c = &u->q[u->head & AT_QUEUE_MASK];
+        at_done_fn done = c->done;
+        void *ctx = c->ctx;
+        u->head++;
+        if (done) done(AT_EFLUSH, "", ctx);
+    }
+    arm(u, 0);
+}
+
+int at_submit(const char *cmd, const char *prefix, int timeout_ms, at_done_fn done, void *ctx)
+{
+    if (!cmd) return AT_EINVAL;
+    if (prefix && strlen(prefix) >= AT_VALUE_MAX) return AT_EINVAL;
+
+    at_cmd_t *c = enqueue(cmd, timeout_ms, done, ctx);
+    if (!c) return AT_EFULL;
+    if (prefix) strcpy(c->token, prefix);
+    return commit();
+}
+
+int at_submit_write(const char *cmd, const uint8_t *data, size_t len, int timeout_ms,
+                    at_done_fn done, void *ctx)
+{
+    if (!cmd || !data || len == 0 || len > AT_DATA_MAX) return AT_EINVAL;
+
+    at_cmd_t *c = enqueue(cmd, timeout_ms, done, ctx);
+    if (!c) return AT_EFULL;
+    memcpy(c->data, data, len);
+    c->data_len = (uint16_t)len;
+    return commit();
+}
+
+/* Write cmd (NULL = write nothing) and complete on the first line that
+ * contains token instead of OK, e.g. the ">" that opens passthrough. */
+int at_submit_until(const char *cmd, const char *token, int timeout_ms, at_done_fn done, void *ctx)
+{
+    if (!token || !token[0] || strlen(token) >= AT_VALUE_MAX) return AT_EINVAL;
+
+    at_cmd_t *c = enqueue(cmd, timeout_ms, done, ctx);
+    if (!c) return AT_EFULL;
+    strcpy(c->token, token);
+    c->expect = 1;
+    return commit();
+}
+
+/* Queue a wait for an unsolicited line (e.g. "ready" after a module reset)
+ * so commands behind it are held until the modem is listening again. */
+int at_submit_expect(const char *token, int timeout_ms, at_done_fn done, void *ctx)
+{
+    return at_submit_until(NULL, token, timeout_ms, done, ctx);
+}
+
+int at_engine_feed(const uint8_t *line, size_t len)
+{
+    at_unit_t *u = &g_units[g_cur];
+    if (u->head == u->tail) return 0;
+    at_cmd_t *c = &u->q[u->head & AT_QUEUE_MASK];
+    if (c->stage == AT_ST_QUEUED) return 0;
+
+    while (len && (line[len - 1] == '\r' || line[len - 1] == '\n')) len--;
+
+    if (c->expect) {
+        size_t k = strlen(c->token);
+        for (size_t i = 0; i + k <= len; i++) {
+            if (memcmp(line + i, c->token, k) == 0) { complete(u, AT_OK); return 1; }
+        }
+        if (c->cmd[0] && line_is(line, len, "ERROR")) { complete(u, AT_ERR); return 1; }
+        return c->cmd[0] && line_is(line, len, "OK");   /* OK ahead of the token */
+    }
+
+    size_t pl = strlen(c->token);
+    if (pl && len >= pl && memcmp(line, c->token, pl) == 0) {
+        size_t v = 0;                               /* First token, like sscanf("%s") */
+        while (pl + v < len && v < AT_VALUE_MAX - 1 &&
+               line[pl + v] != ' ' && line[pl + v] != '\t')
+            v++;
+        memcpy(c->value, line + pl, v);
+        c->value[v] = '\0';
+        return 1;
+    }
+
+    at_line_t kind = at_line_class(line, len);
+    if (kind == AT_LINE_ERROR) {
+        complete(u, AT_ERR);
+        return 1;
+    }
+
+    if (c->stage == AT_ST_PROMPT) {
+        if (kind == AT_LINE_PROMPT) {
+            if (write_all(u, c->data, c->data_len) < 0) { complete(u, AT_ERR); return 1; }
+            c->stage = AT_ST_RESULT;
+            arm(u, c->timeout_ms);
+            return 1;
+        }
+        return kind == AT_LINE_OK;                  /* Some firmwares OK before ">" */
+    }
+
+    if (kind == AT_LINE_OK) {
+        complete(u, AT_OK);
+        return 1;
+    }
+    return 0;
+}
+
+void at_engine_timeout(void)
+{
+    at_unit_t *u = &g_units[g_cur];
+    if (u->head == u->tail) return;
+    if (u->q[u->head & AT_QUEUE_MASK].stage == AT_ST_QUEUED) return;
+    complete(u, AT_TIMEOUT);
+}
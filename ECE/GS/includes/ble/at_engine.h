@@ -0,0 +1,72 @@
+#ifndef AT_ENGINE_H
+#define AT_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Non-blocking ESP-AT command engine.
+ *
+ * Commands are queued and written to the modem back-to-back: the next one
+ * goes out the moment the previous OK/ERROR line arrives, and write payloads
+ * go out the moment the ">" prompt arrives. Nothing here sleeps or reads the
+ * UART; the main loop hands every framed AT line (from uart_reader) to
+ * at_engine_feed() and calls at_engine_timeout() when the engine's timer
+ * fires. Completion callbacks run on the main loop thread.
+ *
+ * The modem executes one command at a time, so "in flight" is the queue
+ * head; everything behind it is already staged and costs no extra wait.
+ *
+ * at_engine_urgent(1) makes every submit until at_engine_urgent(0) jump the
+ * queue: it lands right behind the command in flight (and earlier urgent
+ * ones), ahead of everything staged. The one in flight is never aborted;
+ * the modem has it already. Used for the e-stop (TRANSPORT_URGENT).
+ *
+ * One engine (unit) per ESP-AT radio. Every call below addresses the unit
+ * at_engine_use() selected (0 unless changed); completion callbacks and
+ * the timer callback run with their own unit selected.
+ */
+
+#define AT_QUEUE_MAX   32                   /* Power of two */
+#define AT_UNITS_MAX   2                    /* Radios: PMOD 0 and PMOD 1 */
+#define AT_CMD_MAX     128
+#define AT_DATA_MAX    160                  /* Largest GATT write (framed packet) */
+#define AT_VALUE_MAX   128
+
+#define AT_OK        0
+#define AT_ERR      -1                      /* Modem replied ERROR / SEND FAIL */
+#define AT_TIMEOUT  -2
+#define AT_EFULL    -3                      /* Queue full, nothing was queued */
+#define AT_EINVAL   -4
+#define AT_EFLUSH   -5                      /* Dropped by at_engine_flush() */
+
+/* value: text after the requested prefix (first token), or "" */
+typedef void (*at_done_fn)(int status, const char *value, void *ctx);
+
+/* Arms (ms > 0) or disarms (ms == 0) the caller's one-shot timer */
+typedef void (*at_timer_fn)(int ms);
+
+/* Asked before each command is written; return 0 to hold the queue (e.g.
+ * modem in passthrough) and call at_engine_kick() once AT mode is back. */
+typedef int (*at_gate_fn)(void);
+
+int    at_engine_init(int uart_fd, at_timer_fn arm_timer);
+void   at_engine_use(int unit);
+int    at_engine_unit(void);
+int    at_engine_active(void);
+void   at_engine_flush(void);
+size_t at_engine_depth(void);
+void   at_engine_set_gate(at_gate_fn gate);
+void   at_engine_kick(void);
+void   at_engine_urgent(int on);
+
+int at_submit(const char *cmd, const char *prefix, int timeout_ms, at_done_fn done, void *ctx);
+int at_submit_write(const char *cmd, const uint8_t *data, size_t len, int timeout_ms,
+                    at_done_fn done, void *ctx);
+int at_submit_expect(const char *token, int timeout_ms, at_done_fn done, void *ctx);
+int at_submit_until(const char *cmd, const char *token, int timeout_ms, at_done_fn done, void *ctx);
+
+int  at_engine_feed(const uint8_t *line, size_t len);  /* 1 = consumed by the queue head */
+void at_engine_timeout(void);
+
+#endif
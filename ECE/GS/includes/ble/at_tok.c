@@ -0,0 +1,170 @@
+#include "at_tok.h"
+#include "uart_reader.h"
+#include "pmod_esp32.h"
+#include <string.h>
+
+static const char *const g_urc[] = {
+    "+BLECONN:", "+BLEDISCONN:", "+BLECONNPARAM:", "+BLEAUTHCMPL:",
+    "+BLESCAN:", "+INDICATE:", "+WRITE:", "ready",
+};
+
+static int line_is(const uint8_t *l, size_t n, const char *s)
+{
+    size_t k = strlen(s);
+    return n == k && memcmp(l, s, k) == 0;
+}
+
+at_line_t at_line_class(const uint8_t *line, size_t len)
+{
+    while (len && (line[len - 1] == '\r' || line[len - 1] == '\n')) len--;
+    if (len == 0) return AT_LINE_BLANK;
+
+    switch (line[0]) {
+    case 'O': if (line_is(line, len, "OK")) return AT_LINE_OK; break;
+    case 'E': if (line_is(line, len, "ERROR")) return AT_LINE_ERROR; break;
+    case 'S':
+        if (line_is(line, len, "SEND OK")) return AT_LINE_OK;
+        if (line_is(line, len, "SEND FAIL")) return AT_LINE_ERROR;
+        break;
+    case '>': if (len == 1) return AT_LINE_PROMPT; break;
+    case '+': case 'r':
+        for (size_t i = 0; i < sizeof(g_urc) / sizeof(g_urc[0]); i++) {
+            size_t k = strlen(g_urc[i]);
+            if (len >= k && memcmp(line, g_urc[i], k) == 0) return AT_LINE_URC;
+        }
+        break;
+    }
+    return AT_LINE_DATA;
+}
+
+static int line_len(const uint8_t *p, size_t n, size_t *used)
+{
+    const uint8_t *nl = memchr(p, '\n', n);
+    if (nl) {
+        *used = (size_t)(nl - p) + 1;
+        return 1;
+    }
+    if (n >= UART_SLOT_MAX - 1) {           /* Overlong line: flush what fits */
+        *used = UART_SLOT_MAX - 1;
+        return 1;
+    }
+    return 0;
+}
+
+/* Parses "+NOTIFY:<conn>,<srv>,<chr>,<len>," then expects <len> raw bytes.
+ * Returns 1 with hdr, conn (the span tag) and len set, 0 if more input is
+ * needed, -1 if malformed. */
+static int notify_header(const uint8_t *p, size_t n, size_t *hdr, uint8_t *conn, size_t *len)
+{
+    size_t i = sizeof(UART_NOTIFY_PREFIX) - 1;
+    int commas = 0;
+    size_t v = 0, c0 = 0, chr = 0;
+
+    while (i < n && commas < 4) {
+        uint8_t c = p[i++];
+        if (c == ',') { commas++; continue; }
+        if (c < '0' || c > '9') return -1;
+        if (commas == 0) c0 = c0 * 10 + (size_t)(c - '0');
+        if (commas == 2 && chr < 256) chr = chr * 10 + (size_t)(c - '0');
+        if (commas == 3) {
+            v = v * 10 + (size_t)(c - '0');
+            if (v > UART_SLOT_MAX - 1) return -1;
+        }
+    }
+    if (commas < 4) return (i < 32) ? 0 : -1;
+    if (c0 > UART_TAG_CONN) return -1;
+
+    *hdr = i;
+    *conn = (uint8_t)(c0 | (chr == ROBOT_METRICS_CHR ? UART_TAG_METRICS : chr == ROBOT_PRIO_CHR ? UART_TAG_PRIO : 0));
+    *len = v;
+    return 1;
+}
+
+size_t at_tok_frame(const uint8_t *p, size_t n, at_frame_t *f)
+{
+    const size_t pl = sizeof(UART_NOTIFY_PREFIX) - 1;
+    size_t used;
+
+    if (n == 0) return 0;
+    f->off = 0;
+    f->tag = 0;
+
+    if (p[0] == '\r' || p[0] == '\n') {     /* Blank line / notify trailer */
+        f->kind = AT_LINE_BLANK;
+        f->len = 1;
+        return 1;
+    }
+
+    if (p[0] == '>') {                      /* AT+BLEGATTCWR prompt, no CRLF */
+        f->kind = AT_LINE_PROMPT;
+        f->len = 1;
+        return 1;
+    }
+
+    if (memcmp(p, UART_NOTIFY_PREFIX, n < pl ? n : pl) == 0) {
+        size_t hdr, len;
+        uint8_t conn;
+        int r = (n < pl) ? 0 : notify_header(p, n, &hdr, &conn, &len);
+        if (r == 0) return 0;
+        if (r > 0) {
+            if (n - hdr < len) return 0;
+            f->kind = AT_LINE_NOTIFY;
+            f->off = hdr;
+            f->len = len;
+            f->tag = conn;
+            return hdr + len;
+        }
+        /* Malformed: fall through and pass it on as a plain line */
+    }
+
+    if (!line_len(p, n, &used)) return 0;
+    f->kind = at_line_class(p, used);
+    f->len = used;
+    return used;
+}
+
+void at_tok_reset(at_tok_t *t)
+{
+    t->len = 0;
+}
+
+/* Free room after what is held; a full buffer that frames nothing is dropped */
+uint8_t *at_tok_tail(at_tok_t *t, size_t *cap)
+{
+    if (t->len == sizeof(t->acc)) t->len = 0;
+    *cap = sizeof(t->acc) - t->len;
+    return t->acc + t->len;
+}
+
+void at_tok_commit(at_tok_t *t, size_t n)
+{
+    if (n > sizeof(t->acc) - t->len) n = sizeof(t->acc) - t->len;
+    t->len += n;
+}
+
+int at_tok_next(at_tok_t *t, at_tok_fn fn, void *ctx)
+{
+    size_t off = 0, used;
+    at_frame_t f;
+    int stop = 0;
+
+    while (!stop && off < t->len && (used = at_tok_frame(t->acc + off, t->len - off, &f)) > 0) {
+        stop = fn(&f, t->acc + off, ctx);
+        off += used;
+    }
+    if (off) {
+        memmove(t->acc, t->acc + off, t->len - off);
+        t->len -= off;
+    }
+    return stop;
+}
+
+void at_tok_flush(at_tok_t *t, at_tok_fn fn, void *ctx)
+{
+    while (at_tok_next(t, fn, ctx)) {}
+    if (t->len) {
+        at_frame_t f = { .kind = AT_LINE_DATA, .off = 0, .len = t->len, .tag = 0 };
+        fn(&f, t->acc, ctx);
+    }
+    t->len = 0;
+}
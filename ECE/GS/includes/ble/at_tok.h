@@ -0,0 +1,60 @@
+#ifndef AT_TOK_H
+#define AT_TOK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "uart_queue.h"
+
+/*
+ * ESP-AT stream tokenizer. at_tok_frame() takes one message off the front of
+ * the UART byte stream: a CRLF-terminated line, the bare ">" write prompt, or
+ * a +NOTIFY:<conn>,<srv>,<chr>,<len>, header together with its <len> raw
+ * payload bytes (binary, so an "OK" or a newline inside a robot report is
+ * never taken for a line). Each line is classified once, as it completes;
+ * nobody has to search a reply buffer for "OK" again.
+ *
+ * The reader thread frames its rings with at_tok_frame(). at_tok_t adds the
+ * partial-message buffer for the blocking AT helpers, which read the UART
+ * themselves: read into at_tok_tail(), at_tok_commit() the count, then
+ * at_tok_next() hands out every complete message until the callback says
+ * stop, and the rest stays for the next call.
+ */
+
+typedef enum {
+    AT_LINE_BLANK,                          /* A lone CR or LF */
+    AT_LINE_DATA,                           /* Echo, info reply ("+NAME:..." to a query), text */
+    AT_LINE_OK,                             /* Final result: OK, SEND OK */
+    AT_LINE_ERROR,                          /* Final result: ERROR, SEND FAIL */
+    AT_LINE_PROMPT,                         /* ">" of AT+BLEGATTCWR, no CRLF */
+    AT_LINE_URC,                            /* Unsolicited: +BLECONN:, +BLEDISCONN:, ready, ... */
+    AT_LINE_NOTIFY,                         /* +NOTIFY: the span is the <len> payload bytes */
+} at_line_t;
+
+typedef struct {
+    at_line_t kind;
+    size_t    off, len;                     /* Span within the message: the line (CRLF kept) or payload */
+    uint8_t   tag;                          /* AT_LINE_NOTIFY: <conn> | UART_TAG_METRICS / _PRIO */
+} at_frame_t;
+
+/* Largest message held back (a notify header + UART_SLOT_MAX - 1 payload)
+ * plus a full slot of room to read into */
+#define AT_TOK_MAX (UART_SLOT_MAX * 3)
+
+typedef struct {
+    uint8_t acc[AT_TOK_MAX];
+    size_t  len;
+} at_tok_t;
+
+/* msg is the whole message, its span at msg + f->off; return non-zero to stop */
+typedef int (*at_tok_fn)(const at_frame_t *f, const uint8_t *msg, void *ctx);
+
+at_line_t at_line_class(const uint8_t *line, size_t len);         /* Trailing CR/LF ignored */
+size_t    at_tok_frame(const uint8_t *p, size_t n, at_frame_t *f); /* Bytes used, 0 = need more */
+
+void     at_tok_reset(at_tok_t *t);
+uint8_t *at_tok_tail(at_tok_t *t, size_t *cap);
+void     at_tok_commit(at_tok_t *t, size_t n);
+int      at_tok_next(at_tok_t *t, at_tok_fn fn, void *ctx);        /* fn's non-zero, or 0 when drained */
+void     at_tok_flush(at_tok_t *t, at_tok_fn fn, void *ctx);       /* Everything, a partial one as DATA */
+
+#endif
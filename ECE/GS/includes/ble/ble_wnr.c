@@ -0,0 +1,267 @@
+#include "ble_wnr.h"
+#include "pmod_esp32.h"
+#include "uart_reader.h"
+#include "../metrics/metrics.h"
+#include "../recorder/recorder.h"
+#include "../log/gs_log.h"
+#include "../event_loop/event_loop.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define WNR_PENDING_MASK (WNR_PENDING - 1)
+
+typedef enum {
+    WNR_IDLE = 0,                           /* AT mode */
+    WNR_ENTERING,                           /* SPPCFG / SPP queued on the AT engine */
+    WNR_ACTIVE,                             /* Passthrough: raw writes */
+    WNR_GUARD,                              /* Quiet period, then "+++" */
+    WNR_EXITING                             /* Waiting for AT mode to come back */
+} wnr_state_t;
+
+typedef struct {
+    uint16_t len;
+    uint8_t  data[WNR_MAX_LEN];
+} wnr_pkt_t;
+
+static int         g_fd      = -1;
+static at_timer_fn g_arm     = NULL;
+static int         g_enabled = 0;
+static int         g_failed  = 0;           /* Modem refused SPP: stay on AT writes */
+static wnr_state_t g_state   = WNR_IDLE;
+static int         g_credits = WNR_CREDITS_MAX;
+static int         g_armed   = 0;
+
+static wnr_pkt_t g_pend[WNR_PENDING];
+static uint32_t  g_phead = 0, g_ptail = 0;
+
+/* One credit per connection interval once it has been read back */
+static int credit_ms(void)
+{
+    if (g_ble_link.interval <= 0) return WNR_CREDIT_MS;
+    return (g_ble_link.interval * 5 + 3) / 4;           /* x1.25 ms, rounded up */
+}
+
+static void arm(int ms)
+{
+    g_armed = ms > 0;
+    if (g_arm) g_arm(ms);
+}
+
+static int raw_write(const uint8_t *p, size_t len)
+{
+    rec_put(REC_UART_TX, 0, p, len);
+    int q = ev_write(g_fd, p, len);                     /* Same queue as the AT engine's writes */
+    if (q == 0) { METRIC_ADD(uart_tx_bytes, len); return 0; }
+    if (q < -1) return -1;
+    while (len) {
+        ssize_t n = write(g_fd, p, len);
+        if (n > 0) { p += n; len -= (size_t)n; METRIC_ADD(uart_tx_bytes, n); continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) {
+            struct pollfd pfd = { .fd = g_fd, .events = POLLOUT };
+            if (poll(&pfd, 1, 100) > 0) continue;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+static void pend_push(const uint8_t *data, size_t len)
+{
+    if (g_ptail - g_phead == WNR_PENDING) g_phead++;    /* Full: oldest motion word is stale */
+    wnr_pkt_t *p = &g_pend[g_ptail++ & WNR_PENDING_MASK];
+    memcpy(p->data, data, len);
+    p->len = (uint16_t)len;
+}
+
+/* Send paced words while credit lasts (ignore_credit: flush everything) */
+static void pend_drain(int ignore_credit)
+{
+    while (g_phead != g_ptail && (ignore_credit || g_credits > 0)) {
+        wnr_pkt_t *p = &g_pend[g_phead++ & WNR_PENDING_MASK];
+        raw_write(p->data, p->len);
+        if (g_credits > 0) g_credits--;
+    }
+}
+
+/* Pending words that never made it into passthrough go out as AT writes */
+static void pend_fallback(void)
+{
+    while (g_phead != g_ptail) {
+        wnr_pkt_t *p = &g_pend[g_phead++ & WNR_PENDING_MASK];
+        ble_write(g_fd, ROBOT_SRV, ROBOT_TX_CHR, -1, p->data, p->len);
+    }
+}
+
+static void begin_exit(void)
+{
+    pend_drain(1);
+    g_state = WNR_GUARD;
+    arm(WNR_GUARD_MS);
+}
+
+// AT engine gate: commands may only be written in AT mode
+static int wnr_gate(void)
+{
+    switch (g_state) {
+    case WNR_IDLE:
+    case WNR_ENTERING:
+        return 1;
+    case WNR_ACTIVE:
+        begin_exit();
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+static void on_spp_open(int status, const char *value, void *ctx)
+{
+    (void)value; (void)ctx;
+    if (status != AT_OK) {
+        LOG_WARN("BLE WNR: passthrough refused (%d), using AT writes", status);
+        g_failed = 1;
+        g_state = WNR_IDLE;
+        ble_prio_notify(1, NULL, NULL);
+        pend_fallback();
+        return;
+    }
+
+    g_state = WNR_ACTIVE;
+    g_credits = WNR_CREDITS_MAX;
+    uart_reader_set_raw(1);
+    pend_drain(0);
+    if (g_phead != g_ptail || g_credits < WNR_CREDITS_MAX) arm(credit_ms());
+    if (at_engine_depth()) at_engine_kick();           /* AT work queued meanwhile: close again */
+}
+
+static void on_spp_cfg(int status, const char *value, void *ctx)
+{
+    if (status != AT_OK ||
+        at_submit_until("AT+BLESPP\r\n", ">", 2000, on_spp_open, NULL) != AT_OK)
+        on_spp_open(status != AT_OK ? status : AT_EFULL, value, ctx);
+}
+
+static int submit_cfg(void)
+{
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "AT+BLESPPCFG=1,%d,%d,%d,%d\r\n",
+             ROBOT_SRV, ROBOT_TX_CHR, ROBOT_SRV, ROBOT_RX_CHR);
+    return at_submit(cmd, NULL, 1000, on_spp_cfg, NULL);
+}
+
+static void on_prio_off(int status, const char *value, void *ctx)
+{
+    (void)status;
+    if (submit_cfg() != AT_OK) on_spp_open(AT_EFULL, value, ctx);
+}
+
+/* Passthrough only forwards ROBOT_RX_CHR: the robot's ACKs move back there
+ * first (ble_prio_notify), and return to ROBOT_PRIO_CHR on the way out */
+static int begin_enter(void)
+{
+    if (ble_prio_notify(0, on_prio_off, NULL) != 0 && submit_cfg() != AT_OK) return -1;
+    g_state = WNR_ENTERING;
+    return 0;
+}
+
+// ------------------------- Public API -------------------------
+
+int ble_wnr_init(int uart_fd, at_timer_fn arm_timer)
+{
+    if (uart_fd < 0) return -1;
+    g_fd    = uart_fd;
+    g_arm   = arm_timer;
+    g_state = WNR_IDLE;
+    g_phead = g_ptail = 0;
+    at_engine_set_gate(wnr_gate);
+    return 0;
+}
+
+void ble_wnr_enable(int on)
+{
+    g_enabled = on;
+    g_failed  = 0;
+}
+
+int ble_wnr_enabled(void)
+{
+    return g_enabled;
+}
+
+int ble_wnr_active(void)
+{
+    return g_state == WNR_ACTIVE;
+}
+
+/* 1 if a word sent now goes straight out instead of waiting for credit */
+int ble_wnr_ready(void)
+{
+    if (g_state != WNR_ACTIVE) return 1;
+    return g_credits > 0 && g_phead == g_ptail;
+}
+
+int ble_wnr_send(const uint8_t *data, size_t len, int open)
+{
+    uint8_t tagged[ROBOT_WRITE_TAGGED_LEN];
+
+    if (!g_enabled || g_failed || g_fd < 0 || !BLE_CONNECTED) return 0;
+    if (!data || len == 0 || len > WNR_MAX_LEN) return 0;
+    if (len == 8) {                                     /* Plain word: frame it for the robot */
+        tagged[0] = ROBOT_WRITE_TAG;
+        memcpy(tagged + 1, data, 8);
+        data = tagged;
+        len = sizeof(tagged);
+    }
+    if ((int)len > ble_link_payload_max()) return 0;    /* Write Command can't fragment: AT write */
+
+    switch (g_state) {
+    case WNR_IDLE:
+        if (!open || at_engine_depth()) return 0;       /* One-shot / modem busy: plain AT write */
+        if (begin_enter() != 0) return 0;
+        pend_push(data, len);
+        return 1;
+    case WNR_ENTERING:
+        pend_push(data, len);
+        return 1;
+    case WNR_ACTIVE:
+        if (g_credits > 0 && g_phead == g_ptail) {
+            if (raw_write(data, len) != 0) return 0;
+            g_credits--;
+        } else {
+            pend_push(data, len);
+        }
+        if (!g_armed) arm(credit_ms());
+        return 1;
+    default:
+        return 0;                                       /* Closing: queue behind the AT work */
+    }
+}
+
+void ble_wnr_timer(void)
+{
+    g_armed = 0;
+    switch (g_state) {
+    case WNR_ACTIVE:
+        if (g_credits < WNR_CREDITS_MAX) g_credits++;
+        pend_drain(0);
+        if (g_phead != g_ptail || g_credits < WNR_CREDITS_MAX) arm(credit_ms());
+        break;
+    case WNR_GUARD:
+        raw_write((const uint8_t *)"+++", 3);
+        uart_reader_set_raw(0);
+        g_state = WNR_EXITING;
+        arm(WNR_EXIT_MS);
+        break;
+    case WNR_EXITING:
+        g_state = WNR_IDLE;
+        ble_prio_notify(1, NULL, NULL);
+        at_engine_kick();                               /* Release the held AT queue */
+        break;
+    default:
+        break;
+    }
+}
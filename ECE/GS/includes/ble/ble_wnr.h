@@ -0,0 +1,44 @@
+#ifndef BLE_WNR_H
+#define BLE_WNR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "at_engine.h"
+
+/*
+ * Write-without-response streaming through BLE SPP passthrough.
+ *
+ * ESP-AT's GATT client only exposes write-without-response through BLE SPP
+ * passthrough (AT+BLESPPCFG + AT+BLESPP): once the ">" prompt is up, every
+ * UART byte goes straight to ROBOT_TX_CHR as a Write Command and robot
+ * notifications come back unframed. CONTROL / ARM words open it; while it
+ * is up every robot word rides it, so one-shot commands between stream
+ * updates no longer bounce the modem back to AT mode. The modem cuts the
+ * byte stream into writes as it likes, so plain words are framed with
+ * ROBOT_WRITE_TAG (sealed packets carry their own frame) and notifications
+ * are split by their tags on the way back. Words are paced by a small
+ * credit bucket (one credit back per connection interval) so the modem's
+ * SPP buffer cannot overrun. An AT command (reconnect, link read-back,
+ * RSSI, ...) closes passthrough first ("+++" with the required guard
+ * times) via the AT engine gate, and the next stream word re-opens it.
+ * Passthrough only forwards ROBOT_RX_CHR, so the robot's priority
+ * characteristic is unsubscribed while it is up.
+ */
+
+#define WNR_PENDING      16                 /* Paced words waiting for credit (power of two) */
+#define WNR_CREDITS_MAX  4                  /* Burst allowance */
+#define WNR_CREDIT_MS    8                  /* ~ one 7.5 ms interval, until g_ble_link has it */
+#define WNR_GUARD_MS     20                 /* Silence before "+++" */
+#define WNR_EXIT_MS      1000               /* ESP-AT wait after "+++" before AT */
+#define WNR_MAX_LEN      160
+
+int  ble_wnr_init(int uart_fd, at_timer_fn arm_timer);
+void ble_wnr_enable(int on);
+int  ble_wnr_enabled(void);
+int  ble_wnr_active(void);
+int  ble_wnr_ready(void);
+int  ble_wnr_send(const uint8_t *data, size_t len, int open);  /* 1 = taken, 0 = use the AT write;
+                                                                   open = may start passthrough */
+void ble_wnr_timer(void);
+
+#endif
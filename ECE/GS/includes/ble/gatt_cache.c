@@ -0,0 +1,151 @@
+#include "gatt_cache.h"
+#include "pmod_esp32.h"
+#include "../log/gs_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define GATT_MAC_LEN 18                     /* "44:1d:64:f1:70:66" + NUL */
+
+typedef struct {
+    char     mac[GATT_MAC_LEN];
+    uint32_t hash;
+    int      usable;
+} gatt_entry_t;
+
+static gatt_entry_t g_ent[GATT_CACHE_MAX];
+static int          g_n         = 0;
+static int          g_loaded    = 0;
+static int          g_recording[BLE_LINKS_MAX];
+static uint32_t     g_hash[BLE_LINKS_MAX];
+
+static uint32_t fnv1a(uint32_t h, const void *p, size_t n)
+{
+    const uint8_t *b = p;
+    while (n--) { h ^= *b++; h *= 16777619u; }
+    return h;
+}
+
+static const char *cache_path(void)
+{
+    const char *p = getenv("GS_GATT_CACHE");
+    if (p && strcmp(p, "off") == 0) return NULL;
+    return (p && p[0]) ? p : GATT_CACHE_PATH;
+}
+
+static void load(void)
+{
+    g_loaded = 1;
+    g_n = 0;
+    const char *path = cache_path();
+    FILE *f = path ? fopen(path, "r") : NULL;
+    if (!f) return;
+
+    char mac[GATT_MAC_LEN];
+    unsigned hash;
+    int usable;
+    while (g_n < GATT_CACHE_MAX && fscanf(f, "%17s %x %d", mac, &hash, &usable) == 3) {
+        strcpy(g_ent[g_n].mac, mac);
+        g_ent[g_n].hash   = hash;
+        g_ent[g_n].usable = usable != 0;
+        g_n++;
+    }
+    fclose(f);
+}
+
+/* Rewrite via rename so a crash mid-write never leaves a torn file */
+static void save(void)
+{
+    const char *path = cache_path();
+    if (!path) return;
+
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return;
+    for (int i = 0; i < g_n; i++)
+        fprintf(f, "%s %08x %d\n", g_ent[i].mac, (unsigned)g_ent[i].hash, g_ent[i].usable);
+    if (fclose(f) != 0 || rename(tmp, path) != 0) {
+        LOG_WARN("[BLE] GATT cache not saved: %s", path);
+        remove(tmp);
+    }
+}
+
+static gatt_entry_t *find(const char *mac)
+{
+    if (!g_loaded) load();
+    for (int i = 0; i < g_n; i++)
+        if (strcasecmp(g_ent[i].mac, mac) == 0) return &g_ent[i];
+    return NULL;
+}
+
+// ------------------------- Public API -------------------------
+
+int gatt_cache_usable(const char *mac)
+{
+    if (!mac || !cache_path()) return 0;
+    gatt_entry_t *e = find(mac);
+    return e && e->usable;
+}
+
+void gatt_cache_begin(int conn)
+{
+    static const int layout[] = { ROBOT_SRV, ROBOT_TX_CHR, ROBOT_RX_CHR, ROBOT_RX_DESC, ROBOT_PRIO_CHR, ROBOT_PRIO_DESC };
+    if (conn < 0 || conn >= BLE_LINKS_MAX) return;
+    g_hash[conn] = fnv1a(2166136261u, layout, sizeof(layout));  /* A rebuilt GS with new indices misses */
+    g_recording[conn] = 1;
+}
+
+/* "+BLEGATTCPRIMSRV:<conn>,..." / "+BLEGATTCCHAR:"char"|"desc",<conn>,..." */
+void gatt_cache_observe(const uint8_t *line, size_t len)
+{
+    static const char srv[] = "+BLEGATTCPRIMSRV:", chr[] = "+BLEGATTCCHAR:";
+    size_t i;
+    if (len >= sizeof(srv) - 1 && memcmp(line, srv, sizeof(srv) - 1) == 0) {
+        i = sizeof(srv) - 1;
+    } else if (len >= sizeof(chr) - 1 && memcmp(line, chr, sizeof(chr) - 1) == 0) {
+        i = sizeof(chr) - 1;
+        while (i < len && line[i] != ',') i++;
+        i++;
+    } else {
+        return;
+    }
+    if (i >= len || line[i] < '0' || line[i] > '9') return;
+    int conn = ble_robot_at(at_engine_unit(), line[i] - '0');
+    if (conn < 0 || !g_recording[conn]) return;
+
+    while (len && (line[len - 1] == '\r' || line[len - 1] == '\n')) len--;
+    g_hash[conn] = fnv1a(g_hash[conn], line, len);
+    g_hash[conn] = fnv1a(g_hash[conn], "\n", 1);
+}
+
+void gatt_cache_commit(int conn, const char *mac)
+{
+    if (conn < 0 || conn >= BLE_LINKS_MAX || !g_recording[conn]) return;
+    g_recording[conn] = 0;
+    uint32_t hash = g_hash[conn];
+    if (!mac || strlen(mac) >= GATT_MAC_LEN || !cache_path()) return;
+
+    gatt_entry_t *e = find(mac);
+    if (e && e->hash == hash) return;       /* Unchanged (and if it was rejected, still is) */
+    if (!e) {
+        if (g_n == GATT_CACHE_MAX) memmove(&g_ent[0], &g_ent[1], --g_n * sizeof(g_ent[0]));
+        e = &g_ent[g_n++];
+        strcpy(e->mac, mac);
+    }
+    e->hash   = hash;
+    e->usable = 1;
+    LOG_INFO("[BLE] GATT cache: stored %s (db %08x)", mac, (unsigned)hash);
+    save();
+}
+
+void gatt_cache_reject(int conn, const char *mac)
+{
+    if (conn >= 0 && conn < BLE_LINKS_MAX) g_recording[conn] = 0;
+    gatt_entry_t *e = mac ? find(mac) : NULL;
+    if (!e || !e->usable) return;
+    e->usable = 0;
+    LOG_WARN("[BLE] GATT cache: %s rejected, discovering on every connect", mac);
+    save();
+}
@@ -0,0 +1,36 @@
+#ifndef GATT_CACHE_H
+#define GATT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Persisted GATT discovery cache, keyed by peer MAC.
+ *
+ * A full discovery (AT+BLEGATTCPRIMSRV / AT+BLEGATTCCHAR) folds every
+ * +BLEGATTCPRIMSRV / +BLEGATTCCHAR line into a database hash together with
+ * the service/characteristic indices this build writes to. The hash is
+ * stored per MAC; while an entry is usable, the connect chain skips both
+ * discovery commands and goes straight to the CCCD write.
+ *
+ * An entry stops being used when the first write on a cached link fails
+ * (stale layout, or modem firmware that needs discovery on every link); the
+ * next full discovery re-enables it only if it produces a different hash.
+ *
+ * File: GS_GATT_CACHE (default GATT_CACHE_PATH), "off" disables the cache.
+ * One line per peer: "<mac> <hash hex> <usable 0/1>".
+ */
+
+#define GATT_CACHE_PATH  "/var/tmp/gs_gatt_cache"
+#define GATT_CACHE_MAX   8                  /* Peers remembered */
+
+/* conn: robot (ble_route); discovery lines are attributed by the radio that
+ * at_engine_unit() selects and their conn_index, so discoveries on several
+ * links may interleave */
+int  gatt_cache_usable(const char *mac);    /* 1 = discovery can be skipped */
+void gatt_cache_begin(int conn);            /* Start hashing a full discovery */
+void gatt_cache_observe(const uint8_t *line, size_t len);
+void gatt_cache_commit(int conn, const char *mac);  /* Discovery done: store the hash */
+void gatt_cache_reject(int conn, const char *mac);  /* Cached link failed: stop skipping */
+
+#endif
@@ -0,0 +1,153 @@
+#include "gpio_cdev.h"
+#include "../log/gs_log.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+typedef struct {
+    int  gpio_num;                          /* -1 = free slot */
+    int  fd;                                /* Line request fd, -1 = not held (yet) */
+    int  offset;
+    char chip[288];                         /* Resolved by gpio_cdev_prepare(), "" = not yet */
+} gpio_line_t;
+
+static gpio_line_t g_lines[GPIO_CDEV_LINES] = {
+    [0 ... GPIO_CDEV_LINES - 1] = { .gpio_num = -1, .fd = -1 }
+};
+
+static gpio_line_t *line_of(int gpio_num)
+{
+    for (int i = 0; i < GPIO_CDEV_LINES; i++)
+        if (g_lines[i].fd >= 0 && g_lines[i].gpio_num == gpio_num) return &g_lines[i];
+    return NULL;
+}
+
+static int read_int(const char *path, int *out)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int ok = fscanf(f, "%d", out) == 1;
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+/* /dev/gpiochipN and the line offset of global pin gpio_num */
+static int chip_of(int gpio_num, char *chip, size_t size, int *offset)
+{
+    const char *env = getenv("GS_GPIO_CHIP");
+    if (env && env[0]) {
+        const char *b = getenv("GS_GPIO_BASE");
+        int base = b ? atoi(b) : 0;
+        if (gpio_num < base) return -1;
+        snprintf(chip, size, "%s", env);
+        *offset = gpio_num - base;
+        return 0;
+    }
+
+    DIR *d = opendir("/sys/class/gpio");
+    if (!d) return -1;
+    struct dirent *e;
+    int found = -1;
+    while (found < 0 && (e = readdir(d)) != NULL) {
+        if (strncmp(e->d_name, "gpiochip", 8) != 0) continue;
+        char path[320];
+        int base, ngpio;
+        snprintf(path, sizeof(path), "/sys/class/gpio/%s/base", e->d_name);
+        if (read_int(path, &base) != 0) continue;
+        snprintf(path, sizeof(path), "/sys/class/gpio/%s/ngpio", e->d_name);
+        if (read_int(path, &ngpio) != 0 || gpio_num < base || gpio_num >= base + ngpio) continue;
+
+        snprintf(path, sizeof(path), "/sys/class/gpio/%s/device", e->d_name);
+        DIR *dev = opendir(path);           /* The chardev's name sits under the parent device */
+        if (!dev) break;
+        struct dirent *c;
+        while ((c = readdir(dev)) != NULL) {
+            if (strncmp(c->d_name, "gpiochip", 8) != 0) continue;
+            snprintf(chip, size, "/dev/%s", c->d_name);
+            *offset = gpio_num - base;
+            found = 0;
+            break;
+        }
+        closedir(dev);
+        break;
+    }
+    closedir(d);
+    return found;
+}
+
+/* A slot for gpio_num: its prepared one, else a free one */
+static gpio_line_t *slot_for(int gpio_num)
+{
+    gpio_line_t *free_slot = NULL;
+    for (int i = 0; i < GPIO_CDEV_LINES; i++) {
+        if (g_lines[i].gpio_num == gpio_num) return &g_lines[i];
+        if (!free_slot && g_lines[i].gpio_num < 0) free_slot = &g_lines[i];
+    }
+    return free_slot;
+}
+
+int gpio_cdev_prepare(int gpio_num)
+{
+    const char *mode = getenv("GS_GPIO");
+    if (mode && strcmp(mode, "sysfs") == 0) return -1;
+    gpio_line_t *slot = slot_for(gpio_num);
+    if (!slot) return -1;
+    if (slot->chip[0]) return 0;
+    if (chip_of(gpio_num, slot->chip, sizeof(slot->chip), &slot->offset) != 0) {
+        slot->chip[0] = '\0';
+        return -1;
+    }
+    slot->gpio_num = gpio_num;
+    return 0;
+}
+
+int gpio_cdev_output(int gpio_num, uint32_t value)
+{
+    if (line_of(gpio_num)) return gpio_cdev_write(gpio_num, value);
+    if (gpio_cdev_prepare(gpio_num) != 0) return -1;
+    gpio_line_t *slot = slot_for(gpio_num);
+    const char *chip = slot->chip;
+    int offset = slot->offset;
+
+    int cfd = open(chip, O_RDWR | O_CLOEXEC);
+    if (cfd < 0) return -1;
+    struct gpio_v2_line_request req;
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = (uint32_t)offset;
+    req.num_lines = 1;
+    snprintf(req.consumer, sizeof(req.consumer), "%s", GPIO_CDEV_CONSUMER);
+    req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+    req.config.num_attrs = 1;                /* Level from the moment it drives */
+    req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+    req.config.attrs[0].attr.values = value ? 1 : 0;
+    req.config.attrs[0].mask = 1;
+    int rc = ioctl(cfd, GPIO_V2_GET_LINE_IOCTL, &req);
+    close(cfd);                              /* The line fd stands alone */
+    if (rc < 0) {
+        LOG_INFO("[GPIO] %s line %d: request failed, using sysfs for pin %d", chip, offset, gpio_num);
+        return -1;
+    }
+    slot->fd = req.fd;
+    return 0;
+}
+
+int gpio_cdev_write(int gpio_num, uint32_t value)
+{
+    gpio_line_t *l = line_of(gpio_num);
+    if (!l) return -1;
+    struct gpio_v2_line_values v = { .bits = value ? 1 : 0, .mask = 1 };
+    return ioctl(l->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &v) < 0 ? -1 : 0;
+}
+
+uint32_t gpio_cdev_read(int gpio_num)
+{
+    gpio_line_t *l = line_of(gpio_num);
+    struct gpio_v2_line_values v = { .bits = 0, .mask = 1 };
+    if (!l || ioctl(l->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &v) < 0) return 0xFFFFFFFF;
+    return (uint32_t)(v.bits & 1);
+}
@@ -0,0 +1,35 @@
+#ifndef GPIO_CDEV_H
+#define GPIO_CDEV_H
+
+#include <stdint.h>
+
+/*
+ * GPIO character device (/dev/gpiochipN, kernel uAPI v2) backend for the
+ * PMOD pins.
+ *
+ * Each pin is requested as an output once and its line fd is kept, so a
+ * write is one GPIO_V2_LINE_SET_VALUES ioctl instead of the sysfs open /
+ * read direction / open value / write sequence. A line request also fixes
+ * the level at the moment it becomes an output (no glitch on EN).
+ *
+ * Pins are the global numbers the sysfs interface uses. The chip and the
+ * offset come from /sys/class/gpio/gpiochip<base> (base, ngpio and the
+ * gpiochipN node under device/). Kernels without GPIO sysfs set
+ * GS_GPIO_CHIP=/dev/gpiochipN (and GS_GPIO_BASE, default 0) instead.
+ * GS_GPIO=sysfs skips this backend; pmod_esp32.c falls back to sysfs for
+ * any pin that cannot be requested here.
+ *
+ * gpio_cdev_prepare() does the sysfs walk for a pin ahead of time (a hot
+ * standby bridge, whose active peer still holds the lines), so the later
+ * gpio_cdev_output() is one open and one line request.
+ */
+
+#define GPIO_CDEV_LINES    8                /* Both PMODs' four pins */
+#define GPIO_CDEV_CONSUMER "gs_bridge"
+
+int      gpio_cdev_prepare(int gpio_num);                 /* Chip + offset resolved, line not requested */
+int      gpio_cdev_output(int gpio_num, uint32_t value);  /* Request as output at value; -1 = use sysfs */
+int      gpio_cdev_write(int gpio_num, uint32_t value);   /* -1 = not held here */
+uint32_t gpio_cdev_read(int gpio_num);                    /* 0xFFFFFFFF = not held here */
+
+#endif
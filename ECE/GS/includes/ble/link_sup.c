@@ -0,0 +1,170 @@
+#include "link_sup.h"
+#include "pmod_esp32.h"
+#include "../metrics/metrics.h"
+#include "../log/gs_log.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef enum {
+    SUP_OFF = 0,                            /* Not started yet */
+    SUP_HELD,                               /* UI disconnected on purpose */
+    SUP_CONNECTING,                         /* Connect chain queued on the AT engine */
+    SUP_UP,
+    SUP_WAIT                                /* Backoff timer armed */
+} sup_state_t;
+
+typedef struct {
+    sup_state_t state;
+    int         attempts;                   /* Failed attempts since the link was last up */
+    int         up;                         /* Last state reported through g_change */
+} sup_link_t;
+
+static int             g_fd     = -1;
+static int             g_links  = 0;
+static link_sup_arm_fn g_arm    = NULL;
+static link_sup_fn     g_change = NULL;
+static sup_link_t      g_link[BLE_LINKS_MAX];
+static uint32_t        g_rng    = 1;
+
+static uint32_t rnd(void)
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 17;
+    g_rng ^= g_rng << 5;
+    return g_rng;
+}
+
+static void arm(int conn, int ms)
+{
+    if (g_arm) g_arm(conn, ms);
+}
+
+static void report(int conn, int up)
+{
+    if (g_link[conn].up == up) return;
+    g_link[conn].up = up;
+    if (g_change) g_change(conn, up);
+}
+
+static void schedule_retry(int conn)
+{
+    sup_link_t *l = &g_link[conn];
+    int shift = l->attempts < 6 ? l->attempts : 6;
+    uint32_t delay = (uint32_t)LINK_SUP_BASE_MS << shift;
+    if (delay > LINK_SUP_MAX_MS) delay = LINK_SUP_MAX_MS;
+    uint32_t wait = delay / 2 + rnd() % (delay / 2 + 1);  /* Equal jitter */
+
+    l->attempts++;
+    l->state = SUP_WAIT;
+    LOG_INFO("BLE: link %d reconnect attempt %d in %u ms", conn, l->attempts, (unsigned)wait);
+    arm(conn, (int)wait);
+}
+
+static void on_connect_done(int status, const char *value, void *ctx)
+{
+    (void)value;
+    int conn = (int)(intptr_t)ctx;
+    sup_link_t *l = &g_link[conn];
+    if (l->state != SUP_CONNECTING) {       /* Held meanwhile: keep whatever came up */
+        report(conn, status == AT_OK);
+        return;
+    }
+    if (status == AT_OK) {
+        if (l->attempts) METRIC_INC(ble_reconnects);
+        l->attempts = 0;
+        l->state = SUP_UP;
+        report(conn, 1);
+        return;
+    }
+    report(conn, 0);
+    schedule_retry(conn);
+}
+
+static void connect_now(int conn)
+{
+    g_link[conn].state = SUP_CONNECTING;
+    int route = ble_route;
+    ble_route = conn;
+    int r = ble_connect_async(g_fd, NULL, on_connect_done, (void *)(intptr_t)conn);
+    ble_route = route;
+    if (r == 0) return;
+    if (r != -2) LOG_WARN("BLE: link %d connect could not be queued (%d)", conn, r);
+    schedule_retry(conn);                   /* -2: someone else's chain is in flight */
+}
+
+// ------------------------- Public API -------------------------
+
+int link_sup_init(int uart_fd, int links, link_sup_arm_fn arm_timer, link_sup_fn on_change)
+{
+    if (uart_fd < 0 || !at_engine_active() || links < 1 || links > BLE_LINKS_MAX) return -1;
+    g_fd     = uart_fd;
+    g_links  = links;
+    g_arm    = arm_timer;
+    g_change = on_change;
+    memset(g_link, 0, sizeof(g_link));
+    g_rng    = (uint32_t)metrics_now_us() | 1u;
+    return 0;
+}
+
+int link_sup_active(void)
+{
+    return g_fd >= 0;
+}
+
+int link_sup_start(int conn)
+{
+    if (g_fd < 0 || conn >= g_links) return -1;
+    if (conn < 0) {
+        for (int i = 0; i < g_links; i++) link_sup_start(i);
+        return 0;
+    }
+    arm(conn, 0);
+    g_link[conn].attempts = 0;
+    if (g_link[conn].state != SUP_CONNECTING) connect_now(conn);
+    return 0;
+}
+
+void link_sup_hold(int conn, int on)
+{
+    if (g_fd < 0 || conn < 0 || conn >= g_links) return;
+    if (on) {
+        arm(conn, 0);
+        g_link[conn].state = SUP_HELD;
+    } else if (g_link[conn].state == SUP_HELD) {
+        g_link[conn].state = SUP_OFF;
+    }
+}
+
+int link_sup_kept(int conn)
+{
+    return conn >= 0 && conn < g_links && g_link[conn].state != SUP_OFF && g_link[conn].state != SUP_HELD;
+}
+
+int link_sup_connecting(int conn)
+{
+    return conn >= 0 && conn < g_links && g_link[conn].state == SUP_CONNECTING;
+}
+
+/* "+BLEDISCONN:<conn>,"<mac>"", from the radio at_engine_unit() selects */
+int link_sup_observe(const uint8_t *line, size_t len)
+{
+    static const char urc[] = "+BLEDISCONN:";
+    const size_t ul = sizeof(urc) - 1;
+    if (len <= ul || memcmp(line, urc, ul) != 0) return 0;
+
+    int conn = ble_robot_at(at_engine_unit(), line[ul] - '0');
+    if (conn < 0) return 1;
+    ble_connected[conn] = 0;
+    METRIC_INC(ble_link_drops);
+    if (conn < g_links && g_link[conn].state == SUP_UP) {  /* While connecting the chain fails by itself */
+        LOG_INFO("BLE: link %d dropped", conn);
+        report(conn, 0);
+        schedule_retry(conn);
+    }
+    return 1;
+}
+
+void link_sup_timer(int conn)
+{
+    if (conn >= 0 && conn < g_links && g_link[conn].state == SUP_WAIT) connect_now(conn);
+}
@@ -0,0 +1,41 @@
+#ifndef LINK_SUP_H
+#define LINK_SUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "at_engine.h"
+
+/*
+ * BLE link supervisor (event loop mode only).
+ *
+ * Once started it keeps the robot link up on its own: a +BLEDISCONN URC or
+ * a failed connect chain schedules the next ble_connect_async() on a timer,
+ * with exponential backoff and equal jitter (delay/2 + rand(delay/2)), so a
+ * dropped link comes back without waiting for Node to reconnect. Nothing
+ * here blocks; the connect chain is queued on the AT engine and robot words
+ * wait in the TX scheduler (bounded by its staleness limits) until the link
+ * is up again.
+ *
+ * link_sup_hold(1) is the UI's DISCONNECT: no reconnects until the next
+ * link_sup_start() (Connect_Reconnect, or the bridge's first connect).
+ *
+ * Every robot's link (on whichever radio) is supervised on its own, with its
+ * own backoff timer; link_sup_start(-1) brings up all of them.
+ */
+
+#define LINK_SUP_BASE_MS  100               /* First retry after a drop */
+#define LINK_SUP_MAX_MS   5000              /* Backoff ceiling */
+
+typedef void (*link_sup_fn)(int conn, int up);          /* Link came up (1) / went down (0) */
+typedef void (*link_sup_arm_fn)(int conn, int ms);      /* One-shot timer per link, 0 disarms */
+
+int  link_sup_init(int uart_fd, int links, link_sup_arm_fn arm_timer, link_sup_fn on_change);
+int  link_sup_active(void);
+int  link_sup_start(int conn);              /* Connect now and keep the link up */
+void link_sup_hold(int conn, int on);
+int  link_sup_kept(int conn);               /* Started and not held */
+int  link_sup_connecting(int conn);         /* A connect chain is in flight */
+int  link_sup_observe(const uint8_t *line, size_t len);  /* 1 = disconnect URC */
+void link_sup_timer(int conn);
+
+#endif
@@ -1,7 +1,37 @@
 #include "pmod_esp32.h" 
 #include "uart_queue.h" // Software buffer for UART data
-
-volatile int BLE_CONNECTED = 0; // variable may be changed asynchronously (UART responses, timing)
+#include "at_engine.h"  // Queued AT commands once the main loop is running
+#include "at_tok.h"     // Line framing for the blocking fallback
+#include "uart_reader.h"
+#include "ble_wnr.h"    // SPP passthrough streaming of robot words
+#include "gatt_cache.h" // Skip GATT discovery on reconnect
+#include "gpio_cdev.h"  // Held chardev lines, sysfs below is the fallback
+#include "../log/gs_log.h"
+#include "../metrics/metrics.h"
+#include <libgen.h>
+#include <limits.h>
+#include <linux/serial.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+
+int ble_route = CONN_IDX;
+volatile int ble_connected[BLE_LINKS_MAX]; // variable may be changed asynchronously (UART responses, timing)
+ble_link_params_t g_ble_links[BLE_LINKS_MAX] = {
+    [0 ... BLE_LINKS_MAX - 1] = { BLE_ATT_MTU_DEFAULT, 0, 0, 0, 0, 0, 1 }
+};
+static char g_peer_mac[BLE_LINKS_MAX][18] = { ESP32_MAC };
+static int  g_radios = 1;
+static int  g_uart_bps = UART_FAST_BPS;       // Rate asked for after bring-up
+static int  g_uart_rtscts = 1;
+static int  g_robot_radio[BLE_LINKS_MAX];
+static int  g_robot_conn[BLE_LINKS_MAX] = { 0, 1, 2, 3 };
+
+typedef struct { int gpio_0, rst, mode, gpio_1; } pmod_pins_t;
+
+static const pmod_pins_t g_pmod_pins[ESP_RADIOS_MAX] = {
+    { PMOD_0_GPIO_0, PMOD_0_RST, PMOD_0_MODE, PMOD_0_GPIO_1 },
+    { PMOD_1_GPIO_0, PMOD_1_RST, PMOD_1_MODE, PMOD_1_GPIO_3 },
+};
 
 
 uint64_t get_now_ms() { // gets system updates
@@ -17,12 +47,59 @@ int uart_open_config(const char *dev, speed_t baud) { // UART Configuration
     return -1;                                        // Error
   }
 
+  tcflush(fd, TCIFLUSH);                               // Flush any stale input bytes
+  if (uart_set_line(fd, baud, 0) != 0) {               // 8N1 raw, no HW flow control
+    close(fd);                                         // Close fd
+    return -1;                                         // Error
+  }
+  uart_low_latency(fd, dev);                           // Best effort, see below
+
+  return fd;                                           // Return UART fd
+}
+
+// Low-latency receive path, on unless GS_UART_LOWLAT=0:
+//  - ASYNC_LOW_LATENCY (TIOCSSERIAL): drivers that honour it push received
+//    bytes to the tty layer at once instead of on the next flip-buffer tick
+//  - GS_UART_RX_TRIG=<bytes>: RX FIFO interrupt threshold through sysfs
+//    (rx_trig_bytes, 8250-family UARTs). A higher threshold means fewer
+//    interrupts per burst; a short reply still arrives on the FIFO's
+//    character timeout. Off by default: the right value depends on the FIFO
+// PTYs and USB adapters refuse TIOCSSERIAL; that is not an error.
+void uart_low_latency(int fd, const char *dev) {
+  const char *on = getenv("GS_UART_LOWLAT");
+  if (on && strcmp(on, "0") == 0) return;
+
+  struct serial_struct ss;
+  if (ioctl(fd, TIOCGSERIAL, &ss) == 0) {
+    ss.flags |= ASYNC_LOW_LATENCY;
+    if (ioctl(fd, TIOCSSERIAL, &ss) != 0)
+      LOG_WARN("[ESP32] %s: ASYNC_LOW_LATENCY refused: %s", dev, strerror(errno));
+  }
+
+  const char *trig = getenv("GS_UART_RX_TRIG");
+  if (!(trig && trig[0])) return;
+  char real[PATH_MAX], path[PATH_MAX + 32];
+  if (!realpath(dev, real)) return;
+  snprintf(path, sizeof(path), "/sys/class/tty/%s/rx_trig_bytes", basename(real));
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    LOG_WARN("[ESP32] %s: no RX FIFO threshold to set (%s)", dev, strerror(errno));
+    return;
+  }
+  int ok = fprintf(f, "%d\n", atoi(trig)) > 0;
+  if (fclose(f) != 0) ok = 0;                          // The driver rejects a bad value here
+  if (ok) LOG_INFO("[ESP32] %s: RX FIFO threshold %d bytes", dev, atoi(trig));
+  else LOG_WARN("[ESP32] %s: RX FIFO threshold %s refused", dev, trig);
+}
+
+// Rate and flow control of an open UART; output already queued is drained
+// first so it still leaves at the old rate
+int uart_set_line(int fd, speed_t baud, int rtscts) {
   struct termios tio;                                 // termios structure
   memset(&tio, 0, sizeof(tio));                        // Clear it
 
   if (tcgetattr(fd, &tio) != 0) {                      // Read current UART settings
     perror("tcgetattr");                               // Print error
-    close(fd);                                         // Close fd
     return -1;                                         // Error
   }
 
@@ -33,20 +110,37 @@ int uart_open_config(const char *dev, speed_t baud) { // UART Configuration
   tio.c_cflag |= (CLOCAL | CREAD);                     // Local (ignore modem), enable receiver
   tio.c_cflag &= ~(PARENB | PARODD);                   // No parity
   tio.c_cflag &= ~CSTOPB;                              // 1 stop bit
-  tio.c_cflag &= ~CRTSCTS;                             // No HW flow control
+  if (rtscts) tio.c_cflag |= CRTSCTS;                  // RTS/CTS: the modem can hold us off
+  else tio.c_cflag &= ~CRTSCTS;                        // No HW flow control
 
   tio.c_iflag = IGNPAR;                                // Ignore framing/parity errors (v1)
   tio.c_oflag = 0;                                     // Raw output
   tio.c_lflag = 0;                                     // Raw input (no canonical mode)
+  tio.c_cc[VMIN]  = 1;                                 // Readable on the first byte: n_tty would hold
+  tio.c_cc[VTIME] = 0;                                 // poll() back until VMIN arrive, stranding a
+                                                       // short "OK"; the reader batches with readv
 
-  tcflush(fd, TCIFLUSH);                               // Flush any stale input bytes
+  tcdrain(fd);
   if (tcsetattr(fd, TCSANOW, &tio) != 0) {              // Apply settings immediately
     perror("tcsetattr");                               // Print error
-    close(fd);                                         // Close fd
     return -1;                                         // Error
   }
+  return 0;
+}
 
-  return fd;                                           // Return UART fd
+// termios constant for a rate in bit/s, 0 if the host cannot do it
+speed_t uart_speed(int bps) {
+  switch (bps) {
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+    case 460800:  return B460800;
+    case 921600:  return B921600;
+    case 1000000: return B1000000;
+    case 1500000: return B1500000;
+    case 2000000: return B2000000;
+    case 3000000: return B3000000;
+    default:      return 0;
+  }
 }
 
 int gpio_export(int gpio_num) {
@@ -64,11 +158,12 @@ int gpio_export(int gpio_num) {
     fprintf(exp, "%d", gpio_num);
     fclose(exp);
 
-    usleep(200000);  
-
-    f = fopen(path, "r");
-    if (!f) return -1;
-    fclose(f);
+    // udev creates the node and fixes its permissions asynchronously: poll
+    // until direction is writable instead of sleeping for the worst case
+    for (int waited = 0; access(path, W_OK) != 0; waited += GPIO_EXPORT_POLL_MS) {
+        if (waited >= GPIO_EXPORT_WAIT_MS) return -1;
+        usleep(GPIO_EXPORT_POLL_MS * 1000);
+    }
     return 0;
 }
 
@@ -87,10 +182,19 @@ int gpio_set_direction(int gpio_num, const char *dir) {
     return 0;
 }
 
+// Output at value from the start: a held chardev line, else sysfs
+// ("high" / "low" set direction and level in one write)
+int gpio_output(int gpio_num, uint32_t value) {
+    if (gpio_cdev_output(gpio_num, value) == 0) return 0;
+    return gpio_set_direction(gpio_num, value ? "high" : "low");
+}
+
 int gpio_write(int gpio_num, uint32_t value) {
     char path[64];
     char dir[8] = {0};
 
+    if (gpio_cdev_write(gpio_num, value) == 0) return 0;  // One ioctl on a held line
+
     // Check direction only write to outputs
     snprintf(path, sizeof(path),"/sys/class/gpio/gpio%d/direction", gpio_num);
     FILE *f = fopen(path, "r");
@@ -110,7 +214,8 @@ int gpio_write(int gpio_num, uint32_t value) {
 
 uint32_t gpio_read(int gpio_num) {
     char path[64];
-    uint32_t val = 0xFFFFFFFF;
+    uint32_t val = gpio_cdev_read(gpio_num);
+    if (val != 0xFFFFFFFF) return val;
 
     snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/value", gpio_num);
 
@@ -122,111 +227,193 @@ uint32_t gpio_read(int gpio_num) {
     return val;
 }
 
+// ------------------------- Blocking AT replies -------------------------
+// Without the AT engine the helpers below read the reply themselves. Every
+// byte goes through one tokenizer, so each line is classified once, as it
+// completes, instead of searching the growing reply for "OK" after every
+// read. What is not the awaited reply (URCs, +NOTIFY reports, lines after
+// the final result) goes on to uart_queue as one message, for the loop.
+
+typedef struct {
+    const char *prefix;          // Info line whose first token is the value
+    char       *out_value;       // AT_VALUE_MAX bytes
+    const char *token;           // A line holding this ends the wait instead
+    int         prompt;          // Wait for ">" instead of the final result
+    int         status;          // 1 while waiting, then 0 / -1
+} at_wait_t;
+
+static at_tok_t g_at_tok;
+
+// With the reader thread up the lines came out of uart_queue already, and
+// only that thread may push to it
+static int at_wait_route(const at_frame_t *f, const uint8_t *msg, void *ctx) {
+    (void)ctx;
+    if (f->kind != AT_LINE_BLANK && !uart_reader_active())
+        uart_queue_push(&uart_queue, msg, f->off + f->len);
+    return 0;
+}
+
+static int at_wait_line(const at_frame_t *f, const uint8_t *msg, void *ctx) {
+    at_wait_t *w = ctx;
+    const uint8_t *line = msg + f->off;
+    size_t len = f->len;
+
+    if (f->kind == AT_LINE_NOTIFY || f->kind == AT_LINE_BLANK) return at_wait_route(f, msg, NULL);
+    while (len && (line[len - 1] == '\r' || line[len - 1] == '\n')) len--;
+
+    if (w->token) {
+        size_t k = strlen(w->token);
+        for (size_t i = 0; i + k <= len; i++) {
+            if (memcmp(line + i, w->token, k) == 0) { w->status = 0; return 1; }
+        }
+        return at_wait_route(f, msg, NULL);
+    }
+
+    size_t pl = w->prefix ? strlen(w->prefix) : 0;
+    if (pl && w->out_value && len >= pl && memcmp(line, w->prefix, pl) == 0) {
+        size_t v = 0;                                // First token, like sscanf("%s")
+        while (pl + v < len && v < AT_VALUE_MAX - 1 && line[pl + v] != ' ' && line[pl + v] != '\t') v++;
+        memcpy(w->out_value, line + pl, v);
+        w->out_value[v] = '\0';
+        return 0;
+    }
+
+    switch (f->kind) {
+    case AT_LINE_OK:
+        if (w->prompt) return 0;                     // Some firmwares OK before ">"
+        w->status = 0;
+        return 1;
+    case AT_LINE_ERROR:
+        w->status = -1;
+        return 1;
+    case AT_LINE_PROMPT:
+        if (!w->prompt) break;
+        w->status = 0;
+        return 1;
+    default:
+        break;
+    }
+    return at_wait_route(f, msg, NULL);
+}
+
+// 0 / -1 from the reply, -2 on timeout. What was read past the end of the
+// reply is handed on as well, so the next wait starts clean.
+static int at_wait(int uart_fd, at_wait_t *w, int timeout_ms) {
+    uint64_t start_time = get_now_ms();
+
+    w->status = 1;
+    while (!at_tok_next(&g_at_tok, at_wait_line, w) && get_now_ms() - start_time < (uint64_t)timeout_ms) {
+        size_t cap;
+        uint8_t *dst = at_tok_tail(&g_at_tok, &cap);
+        int n = uart_reader_active() ? uart_queue_pop(&uart_queue, (char *)dst, cap)
+                                     : (int)read(uart_fd, dst, cap);
+        if (n <= 0) {
+            usleep(5);
+            continue;
+        }
+        if (!uart_reader_active()) METRIC_ADD(uart_rx_bytes, n);
+        at_tok_commit(&g_at_tok, (size_t)n);
+    }
+    at_tok_flush(&g_at_tok, at_wait_route, NULL);
+    return w->status == 1 ? -2 : w->status;
+}
+
 int send_at_cmd(int uart_fd, const char *cmd, const char *prefix, char *out_value, int timeout_ms) {
-    char buffer[1024];
-    int bytes_received = 0;
-    long start_time = get_now_ms();
-    
-    memset(buffer, 0, sizeof(buffer));
+    // Inside the event loop commands are queued; callers that need a reply
+    // value must use at_submit() with a callback instead.
+    if (at_engine_active()) {
+        if (out_value != NULL) return -3;
+        return at_submit(cmd, prefix, timeout_ms, NULL, NULL) == AT_OK ? 0 : -1;
+    }
+
+    at_wait_t w = { .prefix = prefix, .out_value = out_value };
     write(uart_fd, cmd, strlen(cmd));
+    return at_wait(uart_fd, &w, timeout_ms);
+}
 
-    while (get_now_ms() - start_time < timeout_ms) {
-        int n = uart_read_and_queue(uart_fd, buffer + bytes_received, sizeof(buffer) - bytes_received - 1);
-        if (n > 0) {
-            bytes_received += n;
-            buffer[bytes_received] = '\0';
-
-            if (prefix != NULL && out_value != NULL) {
-                char *data_ptr = strstr(buffer, prefix);
-                if (data_ptr) {
-                    sscanf(data_ptr + strlen(prefix), "%s", out_value);
-                }
-            }
-
-            if (strstr(buffer, "OK")) return 0;
-            if (strstr(buffer, "ERROR")) {
-                return -1;
-            }
-        }
-        usleep(5); 
+static void ble_write_cmd(char *cmd, size_t size, int srv, int chr, int desc, int len) {
+    if (desc >= 0) {
+        snprintf(cmd, size, "AT+BLEGATTCWR=%d,%d,%d,%d,%d\r\n", ble_conn_of(ble_route), srv, chr, desc, len);
+    } else {
+        snprintf(cmd, size, "AT+BLEGATTCWR=%d,%d,%d,,%d\r\n", ble_conn_of(ble_route), srv, chr, len);
     }
-    return -2; 
 }
 
 int ble_write(int uart_fd, int srv, int chr, int desc, uint8_t *data, int len) {
     if (!BLE_CONNECTED) return -1;
 
     char cmd[64];
-    if (desc >= 0) {
-        snprintf(cmd, sizeof(cmd), "AT+BLEGATTCWR=0,%d,%d,%d,%d\r\n", srv, chr, desc, len);
-    } else {
-        snprintf(cmd, sizeof(cmd), "AT+BLEGATTCWR=0,%d,%d,,%d\r\n", srv, chr, len);
-    }
+    ble_write_cmd(cmd, sizeof(cmd), srv, chr, desc, len);
 
-    char buffer[256];
-    int bytes_received = 0;
-    long start_time = get_now_ms();
-    memset(buffer, 0, sizeof(buffer));
+    // Queued: prompt and payload are handled by the engine, back-to-back
+    // with any other writes already waiting.
+    ble_use_radio();
+    if (at_engine_active()) {
+        return at_submit_write(cmd, data, (size_t)len, 3000, NULL, NULL) == AT_OK ? 0 : -1;
+    }
 
+    at_wait_t w = { .prompt = 1 };
     write(uart_fd, cmd, strlen(cmd));
-    while (get_now_ms() - start_time < 3000) {
-        int n = uart_read_and_queue(uart_fd, buffer + bytes_received, sizeof(buffer) - bytes_received - 1);
-        if (n > 0) {
-            bytes_received += n;
-            buffer[bytes_received] = '\0';
-            if (strstr(buffer, ">")) break;
-            if (strstr(buffer, "ERROR")) return -1;
-        }
-        usleep(5);
-    }
-    if (!strstr(buffer, ">")) return -2;
+    int ret = at_wait(uart_fd, &w, 3000);
+    if (ret != 0) return ret;
 
     write(uart_fd, data, len);
     return send_at_cmd(uart_fd, "", NULL, NULL, 3000);
 }
 
+// EN low for PMOD_RST_PULSE_US, then release: the module boots and prints "ready".
+// The pins are those of the selected AT engine's radio.
+static int pmod_esp32_pulse_reset(void) {
+    const pmod_pins_t *pin = &g_pmod_pins[at_engine_unit()];
+    if (gpio_write(pin->rst, 0) != 0) return -1;
+    usleep(PMOD_RST_PULSE_US);
+    return gpio_write(pin->rst, 1);
+}
+
 int pmod_esp32_reset(int uart_fd) {
-    char response[256];
-    int timeout_ms = 3000; 
-    int elapsed_ms = 0;
-    int interval_ms = 10;
-
-    if (gpio_write(PMOD_0_RST, 0) != 0) return -1;
-    usleep(200000);
-    if (gpio_write(PMOD_0_RST, 1) != 0) return -1;
-
-    while (elapsed_ms < timeout_ms) {
-        if (uart_read_and_queue(uart_fd, response, sizeof(response)) > 0) {
-            if (strstr(response, "ready") != NULL) {
-                return 0;
-            }
-        }
+    int timeout_ms = PMOD_READY_TIMEOUT_MS;
+
+    if (pmod_esp32_pulse_reset() != 0) return -1;
 
-        usleep(interval_ms * 1000);
-        elapsed_ms += interval_ms;
+    if (at_engine_active()) {
+        // Hold everything queued behind the reset until the module boots
+        return at_submit_expect("ready", timeout_ms, NULL, NULL) == AT_OK ? 0 : -1;
     }
 
-    printf("[ESP32] Reset timeout - no ready response\n");
+    at_wait_t w = { .token = "ready" };
+    if (at_wait(uart_fd, &w, timeout_ms) == 0) return 0;
+
+    LOG_INFO("[ESP32] Reset timeout - no ready response");
     return -1;
 }
 
-int pmod_esp32_init(int uart_fd) {
+static int pmod_esp32_gpio_setup(void) {
+    const pmod_pins_t *pin = &g_pmod_pins[at_engine_unit()];
     int ret = 0;
-    uart_queue_init(&uart_queue);
 
-    // Set directions
-    ret |= gpio_set_direction(PMOD_0_GPIO_0,  "out");
-    ret |= gpio_set_direction(PMOD_0_GPIO_1,  "out");
-    ret |= gpio_set_direction(PMOD_0_RST,     "out");
-    ret |= gpio_set_direction(PMOD_0_MODE,  "out");
+    // Outputs at their idle levels (EN high: no reset while setting up)
+    ret |= gpio_output(pin->rst,    1);
+    ret |= gpio_output(pin->mode,   0);
+    ret |= gpio_output(pin->gpio_0, 0);
+    ret |= gpio_output(pin->gpio_1, 0);
 
-    if (ret != 0) return -1;
+    return ret != 0 ? -1 : 0;
+}
 
-    gpio_write(PMOD_0_RST,    1);   
-    gpio_write(PMOD_0_MODE, 0);   
-    gpio_write(PMOD_0_GPIO_0, 0);
-    gpio_write(PMOD_0_GPIO_1, 0);
+void pmod_esp32_gpio_prepare(void) {
+    for (int r = 0; r < ESP_RADIOS_MAX; r++) {
+        const pmod_pins_t *pin = &g_pmod_pins[r];
+        gpio_cdev_prepare(pin->rst);
+        gpio_cdev_prepare(pin->mode);
+        gpio_cdev_prepare(pin->gpio_0);
+        gpio_cdev_prepare(pin->gpio_1);
+    }
+}
 
+int pmod_esp32_init(int uart_fd) {
+    uart_queue_init(&uart_queue);
+
+    if (pmod_esp32_gpio_setup() != 0) return -1;
     if (pmod_esp32_reset(uart_fd) < 0) return -1;
 
     return send_at_cmd(uart_fd, "ATE0\r\n", NULL, NULL, 50);;
@@ -253,9 +440,134 @@ int pmod_name(int uart_fd, const char *set_name, char *out_name) {
     return 0;
 }
 
+// ------------------------- Link parameters -------------------------
+
+#define BLE_STR_(x) #x
+#define BLE_STR(x)  BLE_STR_(x)
+#define BLE_LINK_TUNE_CMD "AT+BLECONNPARAM=%d," BLE_STR(BLE_LINK_INTERVAL_MIN) "," \
+                          BLE_STR(BLE_LINK_INTERVAL_MAX) "," BLE_STR(BLE_LINK_LATENCY) "," \
+                          BLE_STR(BLE_LINK_TIMEOUT) "\r\n"
+#define BLE_MTU_PREFIX    "+BLECFGMTU:"
+#define BLE_PARAM_PREFIX  "+BLECONNPARAM:"
+#define BLE_PREFIX_MAX    24
+
+static void ble_link_reset(void) {
+    ble_link_params_t fresh = { BLE_ATT_MTU_DEFAULT, 0, 0, 0, 0, 0, 1, 0, 0 };
+    g_ble_link = fresh;
+}
+
+// Read-backs list every link; "+BLECFGMTU:<conn>," only matches the routed one
+static const char *ble_link_prefix(char *buf, const char *base) {
+    snprintf(buf, BLE_PREFIX_MAX, "%s%d,", base, ble_conn_of(ble_route));
+    return buf;
+}
+
+// value is the reply after the routed prefix: "<mtu>" or
+// "<min>,<max>,<cur>,<latency>,<timeout>"
+static int ble_link_parse(const char *prefix, const char *value) {
+    ble_link_params_t l = g_ble_link;
+    if (!value) return -1;
+    if (strncmp(prefix, BLE_MTU_PREFIX, sizeof(BLE_MTU_PREFIX) - 1) == 0) {
+        if (sscanf(value, "%d", &l.mtu) != 1 || l.mtu < BLE_ATT_MTU_DEFAULT) return -1;
+    } else if (strncmp(prefix, BLE_PARAM_PREFIX, sizeof(BLE_PARAM_PREFIX) - 1) == 0) {
+        if (sscanf(value, "%d,%d,%d,%d,%d", &l.interval_min, &l.interval_max,
+                   &l.interval, &l.latency, &l.timeout) != 5) return -1;
+    } else {
+        return -1;
+    }
+    g_ble_link = l;
+    return 0;
+}
+
+static void ble_link_log(void) {
+    LOG_INFO("[BLE] link %d: MTU %d, interval %.2f ms (asked %.1f-%.1f), latency %d, timeout %d ms, PHY %dM",
+           ble_route, g_ble_link.mtu, g_ble_link.interval * 1.25,
+           BLE_LINK_INTERVAL_MIN * 1.25, BLE_LINK_INTERVAL_MAX * 1.25,
+           g_ble_link.latency, g_ble_link.timeout * 10, g_ble_link.phy);
+}
+
+int ble_link_payload_max(void) {
+    return g_ble_link.mtu - BLE_ATT_HDR;
+}
+
+// Robots in order, each to the radio with the fewest so far (lowest index
+// on a tie) at that radio's next conn_index
+static void ble_assign_radios(void) {
+    int load[ESP_RADIOS_MAX] = {0};
+    for (int r = 0; r < BLE_LINKS_MAX; r++) {
+        if (g_radios == 1) {                 // One radio: conn_index = robot, as always
+            g_robot_radio[r] = 0;
+            g_robot_conn[r] = r;
+            continue;
+        }
+        int best = 0;
+        for (int i = 1; i < g_radios; i++) if (load[i] < load[best]) best = i;
+        g_robot_radio[r] = best;
+        g_robot_conn[r] = load[best];
+        if (g_peer_mac[r][0]) load[best]++;
+    }
+}
+
+int ble_set_peer(int conn, const char *mac) {
+    if (conn < 0 || conn >= BLE_LINKS_MAX || !mac || strlen(mac) >= sizeof(g_peer_mac[0])) return -1;
+    strcpy(g_peer_mac[conn], mac);
+    ble_assign_radios();
+    return 0;
+}
+
+int ble_set_radios(int n) {
+    if (n < 1 || n > ESP_RADIOS_MAX) return -1;
+    g_radios = n;
+    ble_assign_radios();
+    return 0;
+}
+
+int ble_radios(void) {
+    return g_radios;
+}
+
+int ble_radio_of(int robot) {
+    return (robot >= 0 && robot < BLE_LINKS_MAX) ? g_robot_radio[robot] : 0;
+}
+
+int ble_conn_of(int robot) {
+    return (robot >= 0 && robot < BLE_LINKS_MAX) ? g_robot_conn[robot] : CONN_IDX;
+}
+
+int ble_robot_at(int radio, int conn) {
+    for (int r = 0; r < BLE_LINKS_MAX; r++)
+        if (g_peer_mac[r][0] && g_robot_radio[r] == radio && g_robot_conn[r] == conn) return r;
+    return -1;
+}
+
+void ble_use_radio(void) {
+    at_engine_use(g_robot_radio[ble_route]);
+}
+
+const char *ble_peer(int conn) {
+    if (conn < 0 || conn >= BLE_LINKS_MAX || !g_peer_mac[conn][0]) return NULL;
+    return g_peer_mac[conn];
+}
+
+int ble_robots(void) {
+    int n = 0;
+    for (int i = 0; i < BLE_LINKS_MAX; i++) if (g_peer_mac[i][0]) n = i + 1;
+    return n;
+}
+
+int ble_links_up(void) {
+    int n = 0;
+    for (int i = 0; i < BLE_LINKS_MAX; i++) n += ble_connected[i] != 0;
+    return n;
+}
+
 int ble_discon(int uart_fd){
+    char cmd[32];
     BLE_CONNECTED = 0;
-    return send_at_cmd(uart_fd, "AT+BLEDISCONN=0\r\n", NULL, NULL, 1000);
+    ble_link_reset();
+    snprintf(cmd, sizeof(cmd), "AT+BLEDISCONN=%d\r\n", ble_conn_of(ble_route));
+    ble_use_radio();
+    return send_at_cmd(uart_fd, cmd, NULL, NULL, 1000);
 }
 
 int ble_notification(int uart_fd, int enable) {
@@ -271,16 +583,171 @@ int ble_notification(int uart_fd, int enable) {
     return ble_write(uart_fd, ROBOT_SRV, ROBOT_RX_CHR, ROBOT_RX_DESC, enable_cccd, 2);
 }
 
-int ble_connect(int uart_fd, const char *MAC) {
-    if (MAC == NULL) {
-        MAC = ESP32_MAC;
+// The priority characteristic's CCCD on the routed link. ACKs follow it on
+// the robot, so it is off while SPP passthrough (which only forwards
+// ROBOT_RX_CHR) is up.
+int ble_prio_notify(int enable, at_done_fn done, void *ctx) {
+    static const uint8_t cccd[2][2] = { {0x00, 0x00}, {0x01, 0x00} };
+    if (!BLE_CONNECTED || !g_ble_link.prio || !at_engine_active()) return -1;
+    char cmd[64];
+    ble_write_cmd(cmd, sizeof(cmd), ROBOT_SRV, ROBOT_PRIO_CHR, ROBOT_PRIO_DESC, 2);
+    ble_use_radio();
+    return at_submit_write(cmd, cccd[enable != 0], 2, 3000, done, ctx) == AT_OK ? 0 : -1;
+}
+
+// ------------------------- Async connect -------------------------
+// Same sequence as ble_connect(), one queued command per step. Each step is
+// submitted from the previous step's completion so a failure stops the chain.
+// With a usable GATT cache entry for the peer the discovery steps are
+// skipped; if the CCCD write then fails the entry is rejected and the chain
+// falls back to a full discovery on the same link. Every link has its own
+// chain; steps re-select ble_route, so chains for several robots can
+// interleave on one AT engine or run side by side on several radios.
+
+typedef struct {
+    int        step;                 // 0 = BLECONN in flight, -1 = idle
+    int        conn;                 // Robot (ble_route); its AT conn_index is ble_conn_of()
+    int        cached;               // Discovery skipped (gatt_cache hit)
+    char       mac[18];
+    at_done_fn done;
+    void      *ctx;
+} ble_conn_chain_t;
+
+static ble_conn_chain_t g_conn_chain[BLE_LINKS_MAX] = { [0 ... BLE_LINKS_MAX - 1] = { .step = -1 } };
+
+// cmd: format taking the conn_index.
+// prefix != NULL: read-back step whose reply goes to ble_link_parse().
+// optional: a failure is logged but does not abort the connect.
+// discover: skipped when the peer's GATT layout is cached.
+static const struct { const char *cmd; const char *prefix; int timeout_ms; int optional; int discover; } ble_conn_steps[] = {
+    { "AT+BLEDATALEN=%d,251\r\n",  NULL,             2000, 0, 0 },   // Set Data Length
+    { "AT+BLECFGMTU=%d,512\r\n",   NULL,             2000, 0, 0 },   // Set MTU
+    { BLE_LINK_TUNE_CMD,          NULL,             2000, 1, 0 },   // Ask for a 7.5-15 ms interval
+    { "AT+BLEGATTCPRIMSRV=%d\r\n", NULL,             5000, 0, 1 },   // Get BLE Connection Service and makes index
+    { "AT+BLEGATTCCHAR=%d,3\r\n",  NULL,             5000, 0, 1 },   // Get Robot custom service characteristics
+    { "AT+BLECFGMTU?\r\n",        BLE_MTU_PREFIX,   1000, 1, 0 },   // Read back exchanged MTU
+    { "AT+BLECONNPARAM?\r\n",     BLE_PARAM_PREFIX, 1000, 1, 0 },   // Read back interval/latency
+};
+#define BLE_CONN_STEPS ((int)(sizeof(ble_conn_steps) / sizeof(ble_conn_steps[0])))
+#define BLE_CONN_DISCOVER 3          // First discover entry
+
+static void ble_connect_finish(ble_conn_chain_t *ch, int status) {
+    at_done_fn done = ch->done;
+    void *ctx = ch->ctx;
+    ch->step = -1;
+    if (done) done(status, "", ctx);
+}
+
+static void ble_connect_step(int status, const char *value, void *ctx) {
+    ble_conn_chain_t *ch = (ble_conn_chain_t *)ctx;
+    int prev = ch->step - 1;                 // ble_conn_steps[] entry that just completed
+    ble_route = ch->conn;
+
+    if (status != AT_OK && prev >= 0 && prev < BLE_CONN_STEPS && ble_conn_steps[prev].optional) {
+        LOG_WARN("[BLE] optional step failed (%d): %s", status, ble_conn_steps[prev].cmd);
+        status = AT_OK;
+    } else if (status != AT_OK && ch->step >= BLE_CONN_STEPS + 2) {
+        status = AT_OK;                      // No metrics / priority characteristic: older firmware
+    } else if (status == AT_OK && ch->step == BLE_CONN_STEPS + 3) {
+        g_ble_link.prio = 1;
+    } else if (status == AT_OK && prev >= 0 && prev < BLE_CONN_STEPS && ble_conn_steps[prev].prefix) {
+        ble_link_parse(ble_conn_steps[prev].prefix, value);
+    }
+
+    if (status != AT_OK && ch->cached && ch->step == BLE_CONN_STEPS + 1) {
+        gatt_cache_reject(ch->conn, ch->mac); // CCCD write refused on the cached layout
+        ch->cached = 0;
+        gatt_cache_begin(ch->conn);
+        ch->step = BLE_CONN_DISCOVER;
+        status = AT_OK;
+    }
+    if (status != AT_OK) {
+        if (ch->step == 0) BLE_CONNECTED = 0;
+        ble_connect_finish(ch, status);
+        return;
+    }
+    if (ch->step == 0) BLE_CONNECTED = 1;
+
+    int r;
+    ch->step++;
+    while (ch->cached && ch->step <= BLE_CONN_STEPS && ble_conn_steps[ch->step - 1].discover)
+        ch->step++;
+    if (ch->step <= BLE_CONN_STEPS) {
+        char cmd[AT_CMD_MAX], prefix[BLE_PREFIX_MAX];
+        const char *base = ble_conn_steps[ch->step - 1].prefix;
+        snprintf(cmd, sizeof(cmd), ble_conn_steps[ch->step - 1].cmd, ble_conn_of(ch->conn));
+        r = at_submit(cmd, base ? ble_link_prefix(prefix, base) : NULL,
+                      ble_conn_steps[ch->step - 1].timeout_ms, ble_connect_step, ch);
+    } else if (ch->step == BLE_CONN_STEPS + 1) {
+        if (!ch->cached) gatt_cache_commit(ch->conn, ch->mac);
+        // Enable notifications on RX characteristic (0xFF02)
+        static const uint8_t enable_cccd[2] = {0x01, 0x00};
+        char cmd[64];
+        ble_write_cmd(cmd, sizeof(cmd), ROBOT_SRV, ROBOT_RX_CHR, ROBOT_RX_DESC, 2);
+        r = at_submit_write(cmd, enable_cccd, sizeof(enable_cccd), 3000, ble_connect_step, ch);
+    } else if (ch->step == BLE_CONN_STEPS + 2) {
+        // And on the metrics characteristic (0xFF03), where the firmware has it
+        static const uint8_t enable_cccd[2] = {0x01, 0x00};
+        char cmd[64];
+        ble_write_cmd(cmd, sizeof(cmd), ROBOT_SRV, ROBOT_METRICS_CHR, ROBOT_METRICS_DESC, 2);
+        r = at_submit_write(cmd, enable_cccd, sizeof(enable_cccd), 3000, ble_connect_step, ch);
+    } else if (ch->step == BLE_CONN_STEPS + 3) {
+        // And on the priority characteristic (0xFF04): ACK / HPR come there
+        static const uint8_t enable_cccd[2] = {0x01, 0x00};
+        char cmd[64];
+        ble_write_cmd(cmd, sizeof(cmd), ROBOT_SRV, ROBOT_PRIO_CHR, ROBOT_PRIO_DESC, 2);
+        r = at_submit_write(cmd, enable_cccd, sizeof(enable_cccd), 3000, ble_connect_step, ch);
+    } else {
+        ble_link_log();
+        ble_connect_finish(ch, AT_OK);
+        return;
+    }
+    if (r != AT_OK) ble_connect_finish(ch, r);
+}
+
+// Connects the routed link; MAC == NULL uses its ble_set_peer() address
+int ble_connect_async(int uart_fd, const char *MAC, at_done_fn done, void *ctx) {
+    (void)uart_fd;
+    ble_use_radio();
+    if (!at_engine_active()) return -1;
+    ble_conn_chain_t *ch = &g_conn_chain[ble_route];
+    if (ch->step >= 0) return -2;            // Already connecting
+    if (MAC == NULL) MAC = ble_peer(ble_route);
+    if (MAC == NULL) return -1;
+
+    if (BLE_CONNECTED) ble_discon(uart_fd);
+    ble_link_reset();
+    ble_use_radio();                         // The chain stays on this radio (callbacks)
+
+    char cmd_buffer[128];
+    snprintf(cmd_buffer, sizeof(cmd_buffer), "AT+BLECONN=%d,\"%s\"\r\n", ble_conn_of(ble_route), MAC);
+
+    snprintf(ch->mac, sizeof(ch->mac), "%s", MAC);
+    ch->conn   = ble_route;
+    ch->cached = gatt_cache_usable(MAC);
+    if (!ch->cached) gatt_cache_begin(ch->conn);
+    ch->step = 0;
+    ch->done = done;
+    ch->ctx  = ctx;
+    if (at_submit(cmd_buffer, NULL, 10000, ble_connect_step, ch) != AT_OK) {
+        ch->step = -1;
+        return -1;
     }
+    return 0;
+}
+
+int ble_connect(int uart_fd, const char *MAC) {
+    if (at_engine_active()) return ble_connect_async(uart_fd, MAC, NULL, NULL);
+
+    if (MAC == NULL) MAC = ble_peer(ble_route);
+    if (MAC == NULL) return -1;
 
     // Disconnect
     if (BLE_CONNECTED) ble_discon(uart_fd);
+    ble_link_reset();
 
-    char cmd_buffer[1024];
-    snprintf(cmd_buffer, sizeof(cmd_buffer), "AT+BLECONN=%d,\"%s\"\r\n", CONN_IDX, MAC);
+    char cmd_buffer[AT_CMD_MAX];
+    snprintf(cmd_buffer, sizeof(cmd_buffer), "AT+BLECONN=%d,\"%s\"\r\n", ble_conn_of(ble_route), MAC);
     int results = send_at_cmd(uart_fd, cmd_buffer, NULL, NULL, 10000);
 
     if (results < 0) {
@@ -288,36 +755,127 @@ int ble_connect(int uart_fd, const char *MAC) {
         return -1;
     }
 
-    usleep(500000); 
-    BLE_CONNECTED = 1;
+    BLE_CONNECTED = 1;                       // OK follows +BLECONN: the link is already up
 
-    if (send_at_cmd(uart_fd, "AT+BLEDATALEN=0,251\r\n", NULL, NULL, 2000) < 0) return -1;  // Set Data Length
-    if (send_at_cmd(uart_fd, "AT+BLECFGMTU=0,512\r\n", NULL, NULL, 2000) < 0) return -1;   // Set MTU
-    if (send_at_cmd(uart_fd, "AT+BLEGATTCPRIMSRV=0\r\n", NULL, NULL, 5000) < 0) return -1; // Get BLE Connection Service and makes index
-    if (send_at_cmd(uart_fd, "AT+BLEGATTCCHAR=0,3\r\n", NULL, NULL, 5000) < 0) return -1;  // Get Robot custom service characteristics
+    // Set Data Length, Set MTU, ask for a 7.5-15 ms interval (optional), get BLE Connection
+    // Service and makes index, get Robot custom service characteristics
+    for (int i = 0; i < BLE_CONN_DISCOVER + 2; i++) {
+        snprintf(cmd_buffer, sizeof(cmd_buffer), ble_conn_steps[i].cmd, ble_conn_of(ble_route));
+        if (send_at_cmd(uart_fd, cmd_buffer, NULL, NULL, ble_conn_steps[i].timeout_ms) < 0 &&
+            !ble_conn_steps[i].optional) return -1;
+    }
     if (ble_notification(uart_fd, 1) < 0) return -1;                                       // Enable notifications on RX characteristic (0xFF02)
+    uint8_t metrics_cccd[2] = {0x01, 0x00};
+    ble_write(uart_fd, ROBOT_SRV, ROBOT_METRICS_CHR, ROBOT_METRICS_DESC, metrics_cccd, 2);    // Metrics (0xFF03): older firmware refuses
+    g_ble_link.prio = ble_write(uart_fd, ROBOT_SRV, ROBOT_PRIO_CHR, ROBOT_PRIO_DESC, metrics_cccd, 2) == 0;   // Priority (0xFF04): same
 
+    if (get_ble_conn_params(uart_fd, NULL) == 0) ble_link_log();                          // Read back what was negotiated
     return 0;
 }
 
-int get_ble_conn_params(int uart_fd, char *params_out) {
+// ctx: the conn_index the read-back was queued for
+static void on_link_mtu(int status, const char *value, void *ctx) {
+    ble_route = (int)(intptr_t)ctx;
+    if (status == AT_OK) ble_link_parse(BLE_MTU_PREFIX, value);
+}
+
+static void on_link_param(int status, const char *value, void *ctx) {
+    ble_route = (int)(intptr_t)ctx;
+    if (status == AT_OK) ble_link_parse(BLE_PARAM_PREFIX, value);
+}
+
+// Refresh g_ble_link from the modem and copy it to out (if non-NULL).
+// Inside the event loop the queries are queued and out gets the values
+// from the last completed read-back (the connect chain does one).
+int get_ble_conn_params(int uart_fd, ble_link_params_t *out) {
     if (!BLE_CONNECTED) return -1;
-    return send_at_cmd(uart_fd, "AT+BLECONNPARAM?\r\n", "+BLECONNPARAM:", params_out, 1000);
+
+    char prefix[BLE_PREFIX_MAX];
+    ble_use_radio();
+    if (at_engine_active()) {
+        at_submit("AT+BLECFGMTU?\r\n", ble_link_prefix(prefix, BLE_MTU_PREFIX), 1000,
+                  on_link_mtu, (void *)(intptr_t)ble_route);
+        at_submit("AT+BLECONNPARAM?\r\n", ble_link_prefix(prefix, BLE_PARAM_PREFIX), 1000,
+                  on_link_param, (void *)(intptr_t)ble_route);
+    } else {
+        char value[AT_VALUE_MAX] = {0};
+        if (send_at_cmd(uart_fd, "AT+BLECFGMTU?\r\n", ble_link_prefix(prefix, BLE_MTU_PREFIX), value, 1000) == 0)
+            ble_link_parse(BLE_MTU_PREFIX, value);
+        value[0] = '\0';
+        if (send_at_cmd(uart_fd, "AT+BLECONNPARAM?\r\n", ble_link_prefix(prefix, BLE_PARAM_PREFIX), value, 1000) < 0) return -1;
+        if (ble_link_parse(BLE_PARAM_PREFIX, value) < 0) return -1;
+    }
+    if (out) *out = g_ble_link;
+    return 0;
+}
+
+// ------------------------- RSSI -------------------------
+// Stock ESP-AT has no query for a connected link's RSSI (only scan results
+// carry one). Modem firmware built with the custom command answers
+// AT+BLERSSI=<conn> with +BLERSSI:<conn>,<dBm>; the first ERROR marks the
+// radio as without it and it is not asked again. A reading is skipped
+// while SPP passthrough is up: leaving it costs a second of guard times.
+
+#define BLE_RSSI_CMD     "AT+BLERSSI=%d\r\n"
+#define BLE_RSSI_PREFIX  "+BLERSSI:"
+
+static int g_rssi_none[ESP_RADIOS_MAX];  // Radio answered ERROR
+static int g_rssi_pending[BLE_LINKS_MAX];
+
+static int ble_rssi_parse(int robot, const char *value) {
+    int dbm;
+    if (!value || sscanf(value, "%d", &dbm) != 1 || dbm >= 0 || dbm < -127) return -1;
+    g_ble_links[robot].rssi = dbm;
+    return 0;
+}
+
+// ctx: the robot the reading was queued for
+static void on_link_rssi(int status, const char *value, void *ctx) {
+    int robot = (int)(intptr_t)ctx;
+    g_rssi_pending[robot] = 0;
+    if (status == AT_ERR) g_rssi_none[g_robot_radio[robot]] = 1;
+    else if (status == AT_OK) ble_rssi_parse(robot, value);
+}
+
+// Last RSSI of the ble_route link into rssi_out; -1 while there is none.
+// Inside the event loop a fresh reading is queued (one at a time per link)
+// and lands in g_ble_link.rssi; outside it the modem is asked directly.
+int ble_get_rssi(int uart_fd, int *rssi_out) {
+    if (!BLE_CONNECTED || g_rssi_none[g_robot_radio[ble_route]]) return -1;
+
+    char cmd[AT_CMD_MAX], prefix[BLE_PREFIX_MAX];
+    snprintf(cmd, sizeof(cmd), BLE_RSSI_CMD, ble_conn_of(ble_route));
+    ble_use_radio();
+    if (at_engine_active()) {
+        if (!g_rssi_pending[ble_route] && !ble_wnr_active() &&
+            at_submit(cmd, ble_link_prefix(prefix, BLE_RSSI_PREFIX), 1000,
+                      on_link_rssi, (void *)(intptr_t)ble_route) == AT_OK)
+            g_rssi_pending[ble_route] = 1;
+    } else {
+        char value[AT_VALUE_MAX] = {0};
+        if (send_at_cmd(uart_fd, cmd, ble_link_prefix(prefix, BLE_RSSI_PREFIX), value, 1000) < 0) {
+            g_rssi_none[g_robot_radio[ble_route]] = 1;
+            return -1;
+        }
+        ble_rssi_parse(ble_route, value);
+    }
+    if (!g_ble_link.rssi) return -1;
+    if (rssi_out) *rssi_out = g_ble_link.rssi;
+    return 0;
 }
 
+// Each step waits for its own OK ("ready" after the reset), so no settling
+// sleeps are needed between them.
 int ble_init(int uart_fd) {
     ble_discon(uart_fd);
 
     if (pmod_esp32_init(uart_fd) < 0) return -1;  
-    usleep(1000000);
 
     // Wifi off
     if (send_at_cmd(uart_fd, "AT+CWMODE=0\r\n", NULL, NULL, 1000) < 0) return -1;
-    usleep(100000);
 
     // BLE init
     if (send_at_cmd(uart_fd, "AT+BLEINIT=1\r\n", NULL, NULL, 1000) < 0) return -1;
-    usleep(100000);
 
     // Set Device Name
     if (pmod_name(uart_fd, PMOD_DEV_NAME, NULL) < 0) return -1;
@@ -325,20 +883,298 @@ int ble_init(int uart_fd) {
     return 0;
 }
 
-int ble_send_pkt(int uart_fd, uint8_t *data, int data_len) {
-    if (data_len != PAYLOAD_BYTES) return -1;
-    if (!BLE_CONNECTED) return -1;
+// ------------------------- Async bring-up -------------------------
+// ble_init() as a chain on the AT engine: the reset pulse is issued here and
+// every later step is submitted from the previous step's completion, so the
+// modem boots while the caller carries on (crypto benchmark, UDS listen).
+// Without the reset GPIO (no sysfs access) the module is initialised in
+// place: BLEDISCONN drops a link left by a previous run, and BLEINIT may
+// answer ERROR because BLE is already up, so both are optional then.
+
+#define BLE_BRINGUP_NAME_CMD "AT+BLENAME=\"" PMOD_DEV_NAME "\"\r\n"
+
+enum { BOOT_ALWAYS, BOOT_RESET, BOOT_IN_PLACE };   // Which bring-up a step belongs to
+
+// soft: a failure is tolerated when initialising in place
+static const struct { const char *cmd; const char *token; int timeout_ms; int when; int soft; } ble_init_steps[] = {
+    { NULL,                   "ready", PMOD_READY_TIMEOUT_MS, BOOT_RESET,    0 }, // Boot banner
+    { "AT+BLEDISCONN=0\r\n",  NULL,    1000,                  BOOT_IN_PLACE, 1 },
+    { "ATE0\r\n",             NULL,    1000,                  BOOT_ALWAYS,   0 }, // Echo off
+    { "AT+CWMODE=0\r\n",      NULL,    1000,                  BOOT_ALWAYS,   0 }, // Wifi off
+    { "AT+BLEINIT=1\r\n",     NULL,    1000,                  BOOT_ALWAYS,   1 }, // BLE client role
+    { BLE_BRINGUP_NAME_CMD,   NULL,    1000,                  BOOT_ALWAYS,   0 }, // Device name
+};
+#define BLE_INIT_STEPS ((int)(sizeof(ble_init_steps) / sizeof(ble_init_steps[0])))
+
+typedef struct {
+    int        step;                 // Next ble_init_steps[] entry, -1 = idle
+    int        in_place;             // No reset pulse was possible
+    int        fd;                   // UART, re-rated by the fast-link steps
+    int        fast;                 // BLE_FAST_* stage
+    int        fast_failed;          // Rebooted after a failed rate change: stay at the default
+    at_done_fn done;
+    void      *ctx;
+} ble_init_chain_t;
+
+static ble_init_chain_t g_init_chain[ESP_RADIOS_MAX] = { [0 ... ESP_RADIOS_MAX - 1] = { .step = -1, .fd = -1 } };
+
+static int ble_init_applies(const ble_init_chain_t *ch, int i) {
+    int when = ble_init_steps[i].when;
+    return when == BOOT_ALWAYS || (when == BOOT_IN_PLACE) == ch->in_place;
+}
 
-    uint8_t packet[PACKET_BYTES];
+static void ble_init_finish(ble_init_chain_t *ch, int status) {
+    at_done_fn done = ch->done;
+    void *ctx = ch->ctx;
+    ch->step = -1;
+    if (done) done(status, "", ctx);
+}
+
+// ------------------------- Fast UART -------------------------
+// Last bring-up step: AT+UART_CUR moves the module to g_uart_bps (with
+// RTS/CTS if asked), the host follows once the OK is in, and an "AT" at the
+// new rate proves the link. The setting is not saved to flash, so a reset
+// brings the module back to DEFAULT_UART_BAUD: if the probe fails the host
+// drops back and the radio is rebooted and brought up at the default rate.
+// Without the reset pin the module is asked to return to the default rate
+// at the new rate, flow control off, which is all that can be tried then.
+
+enum { BLE_FAST_OFF, BLE_FAST_SET, BLE_FAST_PROBE, BLE_FAST_RESCUE, BLE_FAST_VERIFY };
+
+static void ble_init_step(int status, const char *value, void *ctx);
+static void ble_fast_step(int status, const char *value, void *ctx);
+
+static int ble_fast_submit(ble_init_chain_t *ch, int stage, int bps, int flow) {
+    char cmd[48];
+    ch->fast = stage;
+    if (stage == BLE_FAST_PROBE || stage == BLE_FAST_VERIFY)
+        return at_submit("AT\r\n", NULL, UART_FAST_PROBE_MS, ble_fast_step, ch);
+    snprintf(cmd, sizeof(cmd), "AT+UART_CUR=%d,8,1,0,%d\r\n", bps, flow ? 3 : 0);
+    return at_submit(cmd, NULL, 1000, ble_fast_step, ch);
+}
+
+static void ble_fast_start(ble_init_chain_t *ch) {
+    if (ch->fast_failed || ch->fd < 0 || g_uart_bps == UART_DEFAULT_BPS || !uart_speed(g_uart_bps)) {
+        ble_init_finish(ch, AT_OK);
+        return;
+    }
+    if (ble_fast_submit(ch, BLE_FAST_SET, g_uart_bps, g_uart_rtscts) != AT_OK) ble_init_finish(ch, AT_OK);
+}
+
+static void ble_fast_default(ble_init_chain_t *ch) {
+    uart_set_line(ch->fd, DEFAULT_UART_BAUD, 0);
+}
+
+static void ble_fast_step(int status, const char *value, void *ctx) {
+    ble_init_chain_t *ch = (ble_init_chain_t *)ctx;
+    int radio = (int)(ch - g_init_chain);
+    int r = AT_OK;
+    (void)value;
+
+    switch (ch->fast) {
+    case BLE_FAST_SET:                       // Refused: the module stays at the default rate
+        if (status != AT_OK) {
+            LOG_WARN("[ESP32] radio %d: %d baud refused (%d), staying at %d",
+                    radio, g_uart_bps, status, UART_DEFAULT_BPS);
+            break;
+        }
+        if (uart_set_line(ch->fd, uart_speed(g_uart_bps), g_uart_rtscts) != 0) {
+            r = ble_fast_submit(ch, BLE_FAST_RESCUE, UART_DEFAULT_BPS, 0);
+            if (r == AT_OK) return;
+            break;
+        }
+        r = ble_fast_submit(ch, BLE_FAST_PROBE, 0, 0);
+        if (r == AT_OK) return;
+        /* fall through */
+    case BLE_FAST_PROBE:
+        if (status == AT_OK && r == AT_OK) {
+            LOG_INFO("[ESP32] radio %d: UART at %d baud%s", radio, g_uart_bps,
+                   g_uart_rtscts ? ", RTS/CTS" : "");
+            break;
+        }
+        LOG_WARN("[ESP32] radio %d: no reply at %d baud, falling back to %d",
+                radio, g_uart_bps, UART_DEFAULT_BPS);
+        ble_fast_default(ch);
+        if (!ch->in_place && pmod_esp32_pulse_reset() == 0) {
+            ch->fast = BLE_FAST_OFF;
+            ch->fast_failed = 1;
+            ch->step = 0;                    // Whole bring-up again, from the boot banner
+            ble_init_step(AT_OK, "", ch);
+            return;
+        }
+        uart_set_line(ch->fd, uart_speed(g_uart_bps), 0);
+        r = ble_fast_submit(ch, BLE_FAST_RESCUE, UART_DEFAULT_BPS, 0);
+        if (r == AT_OK) return;
+        ble_fast_default(ch);
+        break;
+    case BLE_FAST_RESCUE:
+        ble_fast_default(ch);
+        r = ble_fast_submit(ch, BLE_FAST_VERIFY, 0, 0);
+        if (r == AT_OK) return;
+        break;
+    case BLE_FAST_VERIFY:
+        ch->fast = BLE_FAST_OFF;
+        ble_init_finish(ch, status);         // Module unreachable at either rate
+        return;
+    }
+    ch->fast = BLE_FAST_OFF;
+    ble_init_finish(ch, r == AT_OK ? AT_OK : r);
+}
+
+static void ble_init_step(int status, const char *value, void *ctx) {
+    ble_init_chain_t *ch = (ble_init_chain_t *)ctx;
+    int prev = ch->step - 1;                 // ble_init_steps[] entry that just completed
+    (void)value;
+
+    if (status != AT_OK && prev >= 0) {
+        LOG_WARN("[ESP32] bring-up step failed (%d): %s", status,
+                ble_init_steps[prev].cmd ? ble_init_steps[prev].cmd : "no ready banner\n");
+        if (!(ch->in_place && ble_init_steps[prev].soft)) {
+            ble_init_finish(ch, status);
+            return;
+        }
+    }
+
+    while (ch->step < BLE_INIT_STEPS && !ble_init_applies(ch, ch->step)) ch->step++;
+    if (ch->step == BLE_INIT_STEPS) {
+        ble_fast_start(ch);
+        return;
+    }
+
+    int i = ch->step++;
+    int r = ble_init_steps[i].cmd
+          ? at_submit(ble_init_steps[i].cmd, NULL, ble_init_steps[i].timeout_ms, ble_init_step, ch)
+          : at_submit_expect(ble_init_steps[i].token, ble_init_steps[i].timeout_ms, ble_init_step, ch);
+    if (r != AT_OK) ble_init_finish(ch, r);
+}
+
+// Brings up the radio of the selected AT engine; radios boot in parallel.
+// uart_fd is that radio's UART, re-rated by the fast-UART steps.
+int ble_init_async(int uart_fd, at_done_fn done, void *ctx) {
+    if (!at_engine_active()) return -1;
+    int radio = at_engine_unit();
+    ble_init_chain_t *ch = &g_init_chain[radio];
+    if (ch->step >= 0) return -2;            // Already in progress
+
+    int route = ble_route;                   // A reset (or the in-place disconnect) drops every link
+    for (ble_route = 0; ble_route < BLE_LINKS_MAX; ble_route++) {
+        if (g_robot_radio[ble_route] != radio) continue;
+        BLE_CONNECTED = 0;
+        ble_link_reset();
+    }
+    ble_route = route;
+
+    ch->in_place = pmod_esp32_gpio_setup() != 0 || pmod_esp32_pulse_reset() != 0;
+    if (ch->in_place) LOG_INFO("[ESP32] radio %d: no reset GPIO, initialising the module in place", radio);
+
+    ch->step = 0;
+    ch->fd   = uart_fd;
+    ch->fast = BLE_FAST_OFF;
+    ch->fast_failed = 0;
+    ch->done = done;
+    ch->ctx  = ctx;
+    ble_init_step(AT_OK, "", ch);
+    return 0;
+}
+
+// A radio that is up moves to the rate ble_set_uart_rate() last set: the
+// fast-UART steps of the bring-up on their own, as in place (no reset
+// pin), so a rate the link does not take ends back at DEFAULT_UART_BAUD
+int ble_uart_rate_async(int uart_fd, at_done_fn done, void *ctx) {
+    if (!at_engine_active()) return -1;
+    ble_init_chain_t *ch = &g_init_chain[at_engine_unit()];
+    if (!uart_speed(g_uart_bps)) return -1;
+    if (ch->step >= 0) return -2;            // Bring-up in progress
+    ch->step     = BLE_INIT_STEPS;
+    ch->fd       = uart_fd;
+    ch->in_place = 1;
+    ch->fast     = BLE_FAST_OFF;
+    ch->fast_failed = 0;
+    ch->done     = done;
+    ch->ctx      = ctx;
+    if (uart_fd < 0 || ble_fast_submit(ch, BLE_FAST_SET, g_uart_bps, g_uart_rtscts) != AT_OK) {
+        ch->step = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int ble_set_uart_rate(int bps, int rtscts) {
+    if (bps != UART_DEFAULT_BPS && !uart_speed(bps)) return -1;
+    g_uart_bps = bps;
+    g_uart_rtscts = rtscts ? 1 : 0;
+    return 0;
+}
+
+static void ble_frame_payload(const uint8_t *data, uint8_t packet[PACKET_BYTES], uint8_t mark) {
     packet[0] = 0x0A;
-    packet[1] = 0xD0;
+    packet[1] = mark;
     memcpy(packet + 2, data, PAYLOAD_BYTES);
     packet[158] = 0xDA;
     packet[159] = 0x0D;
+}
+
+int ble_send_pkt(int uart_fd, uint8_t *data, int data_len) {
+    if (data_len != PAYLOAD_BYTES) return -1;
+    if (!BLE_CONNECTED) return -1;
 
+    uint8_t packet[PACKET_BYTES];
+    ble_frame_payload(data, packet, ROBOT_CIPHER_MARK);
+
+    if (ble_wnr_send(packet, PACKET_BYTES, 0)) return 0;       // Passthrough already up
     return ble_write(uart_fd, ROBOT_SRV, ROBOT_TX_CHR, -1, packet, PACKET_BYTES);
 }
 
+// CONTROL / ARM words (8-byte plaintext or 156-byte ciphertext): write
+// without response when the fast path is up, otherwise a normal AT write.
+int ble_send_stream(int uart_fd, uint8_t *data, int data_len) {
+    if (!BLE_CONNECTED) return -1;
+
+    uint8_t packet[PACKET_BYTES];
+    uint8_t *out = data;
+    int out_len = data_len;
+
+    if (data_len == PAYLOAD_BYTES) {
+        ble_frame_payload(data, packet, ROBOT_CIPHER_MARK);
+        out = packet;
+        out_len = PACKET_BYTES;
+    } else if (data_len != 8) {
+        return -1;
+    }
+
+    if (ble_wnr_send(out, (size_t)out_len, 1)) return 0;
+    return ble_write(uart_fd, ROBOT_SRV, ROBOT_TX_CHR, -1, out, out_len);
+}
+
+// Several words in one write: a plain ROBOT_BATCH_MAGIC | n | n words frame
+// (it must fit one ATT write) or the PAYLOAD_BYTES seal of [n][n words]
+int ble_send_batch(int uart_fd, uint8_t *data, int data_len, int stream) {
+    if (!BLE_CONNECTED) return -1;
+
+    uint8_t packet[PACKET_BYTES];
+    uint8_t *out = data;
+    int out_len = data_len;
+
+    if (data_len == PAYLOAD_BYTES) {
+        ble_frame_payload(data, packet, ROBOT_CIPHER_MARK_BATCH);
+        out = packet;
+        out_len = PACKET_BYTES;
+    } else if (data_len > ble_link_payload_max()) {
+        return -1;
+    }
+
+    if (ble_wnr_send(out, (size_t)out_len, stream)) return 0;
+    return ble_write(uart_fd, ROBOT_SRV, ROBOT_TX_CHR, -1, out, out_len);
+}
+
+// A link frame the caller built (compact seal, compact_seal.h), as-is
+int ble_send_frame(int uart_fd, const uint8_t *data, int data_len, int stream) {
+    if (!BLE_CONNECTED) return -1;
+    if (ble_wnr_send(data, (size_t)data_len, stream)) return 0;
+    return ble_write(uart_fd, ROBOT_SRV, ROBOT_TX_CHR, -1, (uint8_t *)data, data_len);
+}
+
 int ble_send_instruction(int uart_fd, uint8_t instruction[8]) {
+    if (ble_wnr_send(instruction, 8, 0)) return 0;             // Passthrough already up
     return ble_write(uart_fd, ROBOT_SRV, ROBOT_TX_CHR, -1, instruction, 8);
 }
\ No newline at end of file
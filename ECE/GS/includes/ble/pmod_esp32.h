@@ -10,9 +10,13 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <time.h>
+#include "at_engine.h"
 
 #define DEFAULT_UART_DEV "/dev/ttyPS2"         // Default UART device (Zynq PS UART)
 #define DEFAULT_UART_BAUD B115200  
+#define UART_DEFAULT_BPS  115200        // DEFAULT_UART_BAUD in bit/s: the module's boot rate
+#define UART_FAST_BPS     921600        // Asked for with AT+UART_CUR after bring-up
+#define UART_FAST_PROBE_MS 300          // "AT" at the new rate must answer within this
 #define PMOD_0_GPIO_0 516 // ESP GPIO #1
 #define PMOD_0_RST 517 // ESP RST
 #define PMOD_0_MODE 518 // ESP Mode
@@ -22,6 +26,13 @@
 #define PMOD_1_GPIO_1 521
 #define PMOD_1_GPIO_2 522
 #define PMOD_1_GPIO_3 523
+#define PMOD_1_RST  PMOD_1_GPIO_1 // Second PmodESP32, wired like PMOD 0
+#define PMOD_1_MODE PMOD_1_GPIO_2
+
+#define PMOD_RST_PULSE_US     10000   // EN held low for the reset (>= 50 us per datasheet)
+#define PMOD_READY_TIMEOUT_MS 3000    // Reset -> "ready" boot banner
+#define GPIO_EXPORT_WAIT_MS   200     // Longest wait for udev after a sysfs export
+#define GPIO_EXPORT_POLL_MS   2
 
 #define PMOD_DEV_NAME "SDP_2635_GS"
 #define ESP32_MAC "44:1d:64:f1:70:66"
@@ -30,23 +41,84 @@
 // real "44:1d:64:f1:70:66"
 #define CONN_IDX 0
 
+// Multi-robot: robot n is ESP-AT conn_index n (peer MAC set with
+// ble_set_peer), and the top two bits of a command's 11-bit id select it;
+// the low nine bits stay the tag the robot echoes in its ACK. Stock ESP-AT
+// builds allow three BLE links (conn_index 0-2); a fourth robot needs the
+// firmware's connection limit raised, or a second radio.
+#define BLE_LINKS_MAX      4
+#define ROBOT_ID_SHIFT     9
+#define ROBOT_ID_TAG_MASK  ((1u << ROBOT_ID_SHIFT) - 1)
+#define ROBOT_OF_ID(id)    ((int)((unsigned)(id) >> ROBOT_ID_SHIFT) & (BLE_LINKS_MAX - 1))
+
+// Multi-radio: radio n is AT engine unit n on its own UART, driven through
+// PMOD n's reset/mode pins. With ble_set_radios(n > 1) robots are spread
+// over the radios by load (fewest robots first) and take the lowest free
+// conn_index on theirs, so robot n is no longer conn_index n.
+#define ESP_RADIOS_MAX     AT_UNITS_MAX
+
 #define PAYLOAD_BYTES    156
 #define PAYLOAD_HEX_LEN  (PAYLOAD_BYTES * 2)  
 #define PACKET_BYTES     160                   
 #define PACKET_HEX_LEN   (PACKET_BYTES * 2)
 
+// SPP passthrough has no write boundaries: plain 8-byte words go out as
+// ROBOT_WRITE_TAG | word (a tag no word can start with), sealed packets are
+// already framed by 0x0A 0xD0 .. 0xDA 0x0D (0xD1: the seal holds a batch)
+#define ROBOT_WRITE_TAG  0xB5
+#define ROBOT_WRITE_TAGGED_LEN 9
+#define ROBOT_CIPHER_MARK       0xD0
+#define ROBOT_CIPHER_MARK_BATCH 0xD1
+
 // Custom GATT service indices (discovered via AT+BLEGATTCCHAR)
 #define ROBOT_SRV      3  // Custom robot service
 #define ROBOT_TX_CHR   1  // 0xFF01 — central writes commands here
 #define ROBOT_RX_CHR   2  // 0xFF02 — peripheral notifies responses here
 #define ROBOT_RX_DESC  1  // CCCD descriptor on RX characteristic
+#define ROBOT_METRICS_CHR  3  // 0xFF03 — runtime metrics (newer firmware only)
+#define ROBOT_METRICS_DESC 1  // Its CCCD
+#define ROBOT_PRIO_CHR     4  // 0xFF04 — ACK / HPR ahead of telemetry (newer firmware only)
+#define ROBOT_PRIO_DESC    1  // Its CCCD
+
+// Link tuning profile requested after BLECONN (ESP-AT units: interval
+// x1.25 ms, supervision timeout x10 ms). 6..12 = 7.5..15 ms.
+#define BLE_LINK_INTERVAL_MIN  6
+#define BLE_LINK_INTERVAL_MAX  12
+#define BLE_LINK_LATENCY       0
+#define BLE_LINK_TIMEOUT       500
+#define BLE_ATT_MTU_DEFAULT    23        // Until the exchanged MTU is read back
+#define BLE_ATT_HDR            3         // Opcode + handle in every write/notify
+
+// Effective link parameters, read back after connect (get_ble_conn_params).
+// The PmodESP32 (ESP32, BLE 4.2) only has the 1M PHY. rssi comes from
+// ble_get_rssi(); prio is set when the robot took the priority CCCD.
+typedef struct {
+    int mtu;                             // Negotiated ATT MTU
+    int interval_min, interval_max;      // Requested range, x1.25 ms
+    int interval;                        // Current interval, x1.25 ms (0 = unknown)
+    int latency;                         // Slave latency, events
+    int timeout;                         // Supervision timeout, x10 ms
+    int phy;                             // 1 = 1M, 2 = 2M
+    int rssi;                            // dBm, last reading (0 = unknown)
+    int prio;                            // Robot has ROBOT_PRIO_CHR
+} ble_link_params_t;
 
-extern volatile int BLE_CONNECTED;
+// Per-link state; BLE_CONNECTED / g_ble_link are views of the link that
+// ble_route selects, which every BLE call below addresses
+extern int ble_route;
+extern volatile int ble_connected[BLE_LINKS_MAX];
+extern ble_link_params_t g_ble_links[BLE_LINKS_MAX];
+#define BLE_CONNECTED (ble_connected[ble_route])
+#define g_ble_link    (g_ble_links[ble_route])
 
 // UART and GPIO Functions
 int uart_open_config(const char *dev, speed_t baud);
+int uart_set_line(int fd, speed_t baud, int rtscts);
+void uart_low_latency(int fd, const char *dev); // ASYNC_LOW_LATENCY, GS_UART_RX_TRIG
+speed_t uart_speed(int bps);             // 0 = no termios constant for this rate
 int gpio_export(int gpio_num);
 int gpio_set_direction(int gpio_num, const char *dir);
+int gpio_output(int gpio_num, uint32_t value); // gpio_cdev.h line, sysfs fallback
 int gpio_write(int gpio_num, uint32_t value);
 uint32_t gpio_read(int gpio_num);
 
@@ -55,20 +127,40 @@ int send_at_cmd(int uart_fd, const char *cmd, const char *prefix, char *out_valu
 int ble_write(int uart_fd, int srv, int chr, int desc, uint8_t *data, int len);
 int pmod_esp32_reset(int uart_fd);
 int pmod_esp32_init(int uart_fd);
+void pmod_esp32_gpio_prepare(void);     // Every radio's pins resolved, none requested (standby.h)
 
 // BLE Functions
 int get_pmod_mac(int uart_fd, char *MAC_Output);
 int pmod_name(int uart_fd, const char *set_name, char *out_name); 
 
 int ble_init(int uart_fd);
+int ble_init_async(int uart_fd, at_done_fn done, void *ctx);
+int ble_set_uart_rate(int bps, int rtscts);  // Before ble_init_async; UART_DEFAULT_BPS = no change
+int ble_uart_rate_async(int uart_fd, at_done_fn done, void *ctx); // Running radio to that rate
 int ble_discon(int uart_fd);
 int ble_notification(int uart_fd, int enable);
+int ble_prio_notify(int enable, at_done_fn done, void *ctx);  // Queued CCCD write; -1: robot has none (done not called)
 int ble_connect(int uart_fd, const char *MAC);
-int get_ble_conn_params(int uart_fd, char *params_out);
-int ble_get_rssi(int uart_fd, int *rssi_out);
+int ble_connect_async(int uart_fd, const char *MAC, at_done_fn done, void *ctx);
+int get_ble_conn_params(int uart_fd, ble_link_params_t *out);
+int ble_link_payload_max(void);             // Largest single ATT write/notify payload
+int ble_set_peer(int conn, const char *mac);
+const char *ble_peer(int conn);
+int ble_links_up(void);                  // Links currently connected
+int ble_robots(void);                    // Robots configured: highest peer conn_index + 1
+int ble_set_radios(int n);               // Radios robots are spread over (default 1)
+int ble_radios(void);
+int ble_radio_of(int robot);
+int ble_conn_of(int robot);              // conn_index on its radio
+int ble_robot_at(int radio, int conn);   // -1 = no robot there
+void ble_use_radio(void);                // Select the ble_route robot's AT engine
+int ble_get_rssi(int uart_fd, int *rssi_out);  // Last reading; in the event loop, queues the next
 
 int ble_send_pkt(int uart_fd, uint8_t *data, int data_len);
 int ble_send_instruction(int uart_fd, uint8_t instruction[8]);
+int ble_send_stream(int uart_fd, uint8_t *data, int data_len);
+int ble_send_batch(int uart_fd, uint8_t *data, int data_len, int stream);
+int ble_send_frame(int uart_fd, const uint8_t *data, int data_len, int stream);
 uint64_t get_now_ms();
 
 #endif
\ No newline at end of file
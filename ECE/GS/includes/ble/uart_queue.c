@@ -1,4 +1,6 @@
 #include "uart_queue.h"
+#include "uart_reader.h"
+#include "../metrics/metrics.h"
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -7,47 +9,144 @@ uart_queue_t uart_queue;
 
 void uart_queue_init(uart_queue_t *q)
 {
-    q->head = 0;
-    q->tail = 0;
-    q->count = 0;
+    atomic_store_explicit(&q->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&q->tail, 0, memory_order_relaxed);
+    atomic_store_explicit(&q->drops, 0, memory_order_relaxed);
 }
 
-int uart_queue_push(uart_queue_t *q, const char *msg)
+/* Returns the free tail slot (cap = usable bytes, one is kept for the NUL),
+ * or NULL when the ring is full. Nothing is visible until commit. */
+uint8_t *uart_queue_reserve(uart_queue_t *q, size_t *cap)
 {
-    if(q->count == UART_QUEUE_MAX)
-        return -1;
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_acquire);
 
-    snprintf(q->data[q->tail], UART_MSG_MAX, "%s", msg);
+    if (tail - head == UART_RING_SLOTS)
+        return NULL;
 
-    q->tail = (q->tail + 1) % UART_QUEUE_MAX;
-    q->count++;
+    if (cap) *cap = UART_SLOT_MAX - 1;
+    return q->slot[tail & UART_RING_MASK].data;
+}
 
-    return 0;
+void uart_queue_commit(uart_queue_t *q, size_t len)
+{
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    uart_slot_t *s = &q->slot[tail & UART_RING_MASK];
+
+    if (len > UART_SLOT_MAX - 1) len = UART_SLOT_MAX - 1;
+    s->len = (uint16_t)len;
+    s->data[len] = '\0';
+
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
 }
 
-int uart_queue_pop(uart_queue_t *q, char *out)
+int uart_queue_push_tag(uart_queue_t *q, uint8_t tag, const void *data, size_t len)
 {
-    if(q->count == 0)
+    size_t cap;
+    uint8_t *dst = uart_queue_reserve(q, &cap);
+    if (!dst) {
+        atomic_fetch_add_explicit(&q->drops, 1, memory_order_relaxed);
         return -1;
+    }
+
+    if (len > cap) len = cap;
+    memcpy(dst, data, len);
+    q->slot[atomic_load_explicit(&q->tail, memory_order_relaxed) & UART_RING_MASK].tag = tag;
+    uart_queue_commit(q, len);
+    return 0;
+}
+
+int uart_queue_push(uart_queue_t *q, const void *data, size_t len)
+{
+    return uart_queue_push_tag(q, 0, data, len);
+}
 
-    strcpy(out, q->data[q->head]);
+/* Returns the head span in place, or NULL when empty. The pointer stays
+ * valid until uart_queue_release(). */
+const uint8_t *uart_queue_peek(uart_queue_t *q, size_t *len)
+{
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
 
-    q->head = (q->head + 1) % UART_QUEUE_MAX;
-    q->count--;
+    if (head == tail)
+        return NULL;
 
-    return 0;
+    const uart_slot_t *s = &q->slot[head & UART_RING_MASK];
+    if (len) *len = s->len;
+    return s->data;
+}
+
+uint8_t uart_queue_tag(uart_queue_t *q)
+{
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    return q->slot[head & UART_RING_MASK].tag;
+}
+
+void uart_queue_release(uart_queue_t *q)
+{
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+}
+
+/* Copying pop for callers that want their own buffer; returns the span
+ * length (truncated to out_sz - 1 and NUL-terminated) or -1 when empty. */
+int uart_queue_pop(uart_queue_t *q, char *out, size_t out_sz)
+{
+    size_t len;
+    const uint8_t *src = uart_queue_peek(q, &len);
+    if (!src || out_sz == 0)
+        return -1;
+
+    if (len > out_sz - 1) len = out_sz - 1;
+    memcpy(out, src, len);
+    out[len] = '\0';
+
+    uart_queue_release(q);
+    return (int)len;
 }
 
+/* read() lands directly in the reserved slot. When a caller buffer is given
+ * (AT reply waiters) the span is also copied there, NUL-terminated. A full
+ * ring still services the caller, the bytes are just not queued. Once the
+ * reader thread is running it is the only one touching the fd. */
 static int uart_read_to_queue(int uart_fd, char *buffer, size_t size)
 {
+    size_t cap;
+
+    /* Reader thread owns the fd: hand out one framed AT line at a time */
+    if (uart_reader_active()) {
+        int n = (buffer && size > 0) ? uart_queue_pop(&uart_queue, buffer, size) : -1;
+        if (n < 0 && buffer && size > 0) buffer[0] = '\0';
+        return n < 0 ? 0 : n;
+    }
+
+    uint8_t *dst = uart_queue_reserve(&uart_queue, &cap);
     int n;
 
-    memset(buffer, 0, size);
-    n = read(uart_fd, buffer, size - 1);
+    if (buffer && size > 0 && size - 1 < cap)
+        cap = size - 1;
+
+    if (!dst) {
+        atomic_fetch_add_explicit(&uart_queue.drops, 1, memory_order_relaxed);
+        if (!buffer || size == 0) {
+            char scratch[UART_SLOT_MAX];                  /* Drain so ET readiness re-arms */
+            return (int)read(uart_fd, scratch, sizeof(scratch));
+        }
+        n = read(uart_fd, buffer, size - 1);
+        buffer[n > 0 ? n : 0] = '\0';
+        return n;
+    }
 
+    n = read(uart_fd, dst, cap);
     if (n > 0) {
-        buffer[n] = '\0';
-        uart_queue_push(&uart_queue, buffer);
+        METRIC_ADD(uart_rx_bytes, n);
+        if (buffer && size > 0) {
+            memcpy(buffer, dst, (size_t)n);
+            buffer[n] = '\0';
+        }
+        uart_queue_commit(&uart_queue, (size_t)n);
+    } else if (buffer && size > 0) {
+        buffer[0] = '\0';
     }
 
     return n;
@@ -61,6 +160,5 @@ int uart_read_and_queue(int uart_fd, char *buffer, size_t size)
 
 int ble_uart_check(int uart_fd)
 {
-    char buffer[1024];
-    return uart_read_to_queue(uart_fd, buffer, sizeof(buffer));
-}
\ No newline at end of file
+    return uart_read_to_queue(uart_fd, NULL, 0);
+}
@@ -1,26 +1,74 @@
 #ifndef UART_QUEUE_H
 #define UART_QUEUE_H
 
-#define UART_QUEUE_MAX 256
-#define UART_MSG_MAX   1024
 #include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/*
+ * Single-producer / single-consumer ring of length-tagged UART spans.
+ * The producer reserves the tail slot, read()s straight into it and commits
+ * the byte count; the consumer peeks the head slot as (ptr, len) and releases
+ * it when done. head/tail are free-running counters, so full/empty never
+ * need a separate count and the two sides only share two atomics.
+ * Spans are binary-safe (len is authoritative); a NUL is kept after the
+ * data so text consumers can still use string functions on AT replies.
+ */
+
+/* make LOWMEM=1: 256-byte slots still hold a whole +NOTIFY line (header +
+ * PACKET_BYTES of sealed payload) and the longest AT reply line */
+#ifndef UART_RING_SLOTS
+#ifdef GS_LOWMEM
+#define UART_RING_SLOTS 16
+#else
+#define UART_RING_SLOTS 64                  /* Must be a power of two */
+#endif
+#endif
+#ifndef UART_SLOT_MAX
+#ifdef GS_LOWMEM
+#define UART_SLOT_MAX   256
+#else
+#define UART_SLOT_MAX   1024                /* Bytes per slot incl. trailing NUL */
+#endif
+#endif
+#define UART_RING_MASK  (UART_RING_SLOTS - 1)
+
+#if (UART_RING_SLOTS & UART_RING_MASK) != 0
+#error "UART_RING_SLOTS must be a power of two"
+#endif
 
 typedef struct
 {
-    char data[UART_QUEUE_MAX][UART_MSG_MAX];
-
-    int head;
-    int tail;
-    int count;
+    uint16_t len;
+    uint8_t  tag;                           /* Producer's label, e.g. +NOTIFY conn_index */
+    uint8_t  data[UART_SLOT_MAX];
+} uart_slot_t;
 
+typedef struct
+{
+    _Alignas(64) _Atomic uint32_t head;     /* Consumer-owned */
+    _Alignas(64) _Atomic uint32_t tail;     /* Producer-owned */
+    _Atomic uint32_t drops;                 /* Reads discarded because the ring was full */
+    uart_slot_t slot[UART_RING_SLOTS];
 } uart_queue_t;
 
 extern uart_queue_t uart_queue;
 
 void uart_queue_init(uart_queue_t *q);
-int uart_queue_push(uart_queue_t *q, const char *msg);
-int uart_queue_pop(uart_queue_t *q, char *out);
+
+/* Producer side */
+uint8_t *uart_queue_reserve(uart_queue_t *q, size_t *cap);
+void uart_queue_commit(uart_queue_t *q, size_t len);
+int uart_queue_push(uart_queue_t *q, const void *data, size_t len);
+int uart_queue_push_tag(uart_queue_t *q, uint8_t tag, const void *data, size_t len);
+
+/* Consumer side */
+const uint8_t *uart_queue_peek(uart_queue_t *q, size_t *len);
+uint8_t uart_queue_tag(uart_queue_t *q);   /* Tag of the span uart_queue_peek() returned */
+void uart_queue_release(uart_queue_t *q);
+int uart_queue_pop(uart_queue_t *q, char *out, size_t out_sz);
+
 int uart_read_and_queue(int uart_fd, char *buffer, size_t size);
 int ble_uart_check(int uart_fd);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,217 @@
+#include "uart_reader.h"
+#include "at_tok.h"
+#include "../metrics/metrics.h"
+#include "../event_loop/rt_tune.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define UART_ACC_MAX (UART_SLOT_MAX * 2)    /* Room for a full notify header + payload */
+#define UART_SPILL_MAX (UART_SLOT_MAX * 4)  /* Second readv segment: a burst beyond acc */
+#define UART_READER_STACK (256 * 1024)      /* Reader thread stack: a few frames, no big locals */
+
+uart_queue_t uart_notify_queue;
+
+/* Reader 0 publishes to uart_queue / uart_notify_queue, the rest to their own
+ * rings (uart_reader_lines() / uart_reader_notify()) */
+typedef struct {
+    pthread_t     thread;
+    int           uart_fd;
+    int           wake_efd;                 /* Reader -> main loop */
+    int           stop_efd;                 /* Main -> reader */
+    _Atomic int   active;
+    _Atomic int   raw;                      /* Modem in BLE SPP passthrough */
+    uart_queue_t *lines, *notify;
+    uint8_t       acc[UART_ACC_MAX];        /* Reader-thread only */
+    size_t        acc_len;
+    uint8_t       spill[UART_SPILL_MAX];    /* Read past acc, fed in as acc frees up */
+} uart_reader_t;
+
+static uart_queue_t  g_lines[UART_READERS_MAX - 1], g_notify[UART_READERS_MAX - 1];
+static uart_reader_t g_rd[UART_READERS_MAX] = {
+    [0 ... UART_READERS_MAX - 1] = { .uart_fd = -1, .wake_efd = -1, .stop_efd = -1 }
+};
+
+int uart_reader_active(void)
+{
+    return atomic_load_explicit(&g_rd[0].active, memory_order_acquire);
+}
+
+void uart_reader_set_raw(int on)
+{
+    atomic_store_explicit(&g_rd[0].raw, on ? 1 : 0, memory_order_release);
+}
+
+uart_queue_t *uart_reader_lines(int unit)
+{
+    if (unit < 0 || unit >= UART_READERS_MAX) return NULL;
+    return unit ? &g_lines[unit - 1] : &uart_queue;
+}
+
+uart_queue_t *uart_reader_notify(int unit)
+{
+    if (unit < 0 || unit >= UART_READERS_MAX) return NULL;
+    return unit ? &g_notify[unit - 1] : &uart_notify_queue;
+}
+
+/* Consumes one message from the front of p. Returns bytes used (0 = need
+ * more input) and sets *published when a span went out. */
+static size_t frame_one(uart_reader_t *rd, const uint8_t *p, size_t n, int *published)
+{
+    at_frame_t f;
+    size_t used = at_tok_frame(p, n, &f);
+
+    if (used == 0 || f.kind == AT_LINE_BLANK) return used;
+    if (f.kind == AT_LINE_NOTIFY) uart_queue_push_tag(rd->notify, f.tag, p + f.off, f.len);
+    else uart_queue_push(rd->lines, p + f.off, f.len);
+    *published = 1;
+    return used;
+}
+
+/* Publishes what acc holds (framed, or as-is in passthrough) and keeps the
+ * incomplete tail at the front */
+static void consume(uart_reader_t *rd, int *published)
+{
+    size_t off = 0, used;
+    if (atomic_load_explicit(&rd->raw, memory_order_acquire)) {
+        /* Passthrough has no +NOTIFY header: every read is payload */
+        while (off < rd->acc_len) {
+            used = rd->acc_len - off;
+            if (used > UART_SLOT_MAX - 1) used = UART_SLOT_MAX - 1;
+            uart_queue_push(rd->notify, rd->acc + off, used);
+            off += used;
+        }
+        *published = 1;
+    }
+    while (off < rd->acc_len && (used = frame_one(rd, rd->acc + off, rd->acc_len - off, published)) > 0)
+        off += used;
+
+    if (off) {
+        memmove(rd->acc, rd->acc + off, rd->acc_len - off);
+        rd->acc_len -= off;
+    }
+}
+
+static void *reader_main(void *arg)
+{
+    uart_reader_t *rd = arg;
+    rt_thread(RT_READER);                   /* GS_RT_PRIO / GS_CPU_READER, if set */
+    struct pollfd pfd[2] = {
+        { .fd = rd->uart_fd,  .events = POLLIN },
+        { .fd = rd->stop_efd, .events = POLLIN },
+    };
+
+    for (;;) {
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("uart reader poll");
+            break;
+        }
+        if (pfd[1].revents) break;
+        if (pfd[0].revents & POLLNVAL) break;
+        if (!(pfd[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+        /* One syscall per wakeup even for a burst bigger than acc's free
+         * space: the rest lands in spill and is framed below */
+        struct iovec iov[2] = {
+            { rd->acc + rd->acc_len, sizeof(rd->acc) - rd->acc_len },
+            { rd->spill, sizeof(rd->spill) },
+        };
+        ssize_t n = readv(rd->uart_fd, iov, 2);
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN && errno != EINTR) break;
+            if (n == 0 || (pfd[0].revents & POLLHUP))
+                usleep(10000);              /* Peer gone (pty/USB): don't spin */
+            continue;
+        }
+        size_t spilled = (size_t)n > iov[0].iov_len ? (size_t)n - iov[0].iov_len : 0;
+        rd->acc_len += (size_t)n - spilled;
+        METRIC_ADD(uart_rx_bytes, n);
+
+        int published = 0;
+        consume(rd, &published);
+        for (size_t s = 0; s < spilled;) {
+            size_t take = sizeof(rd->acc) - rd->acc_len;
+            if (take == 0) {                /* Nothing framable in a full acc: drop it */
+                rd->acc_len = 0;
+                continue;
+            }
+            if (take > spilled - s) take = spilled - s;
+            memcpy(rd->acc + rd->acc_len, rd->spill + s, take);
+            rd->acc_len += take;
+            s += take;
+            consume(rd, &published);
+        }
+        if (published) {
+            uint64_t one = 1;
+            (void)write(rd->wake_efd, &one, sizeof(one));
+        }
+    }
+    return NULL;
+}
+
+static void reader_stop(uart_reader_t *rd)
+{
+    if (atomic_load_explicit(&rd->active, memory_order_acquire)) {
+        uint64_t one = 1;
+        (void)write(rd->stop_efd, &one, sizeof(one));
+        pthread_join(rd->thread, NULL);
+        atomic_store_explicit(&rd->active, 0, memory_order_release);
+    }
+    if (rd->wake_efd >= 0) close(rd->wake_efd);
+    if (rd->stop_efd >= 0) close(rd->stop_efd);
+    rd->wake_efd = rd->stop_efd = -1;
+}
+
+int uart_reader_start_unit(int unit, int uart_fd)
+{
+    if (unit < 0 || unit >= UART_READERS_MAX) return -1;
+    uart_reader_t *rd = &g_rd[unit];
+    if (atomic_load_explicit(&rd->active, memory_order_acquire)) return rd->wake_efd;
+
+    rd->wake_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    rd->stop_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (rd->wake_efd < 0 || rd->stop_efd < 0) {
+        perror("eventfd");
+        reader_stop(rd);
+        return -1;
+    }
+
+    rd->uart_fd = uart_fd;
+    rd->acc_len = 0;
+    rd->lines   = uart_reader_lines(unit);
+    rd->notify  = uart_reader_notify(unit);
+    atomic_store_explicit(&rd->raw, 0, memory_order_relaxed);
+    uart_queue_init(rd->lines);
+    uart_queue_init(rd->notify);
+
+    pthread_attr_t attr;                    /* Small stack: GS_MLOCK locks all of it */
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, UART_READER_STACK);
+    int rc = pthread_create(&rd->thread, &attr, reader_main, rd);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        perror("pthread_create");
+        reader_stop(rd);
+        return -1;
+    }
+
+    atomic_store_explicit(&rd->active, 1, memory_order_release);
+    return rd->wake_efd;
+}
+
+int uart_reader_start(int uart_fd)
+{
+    return uart_reader_start_unit(0, uart_fd);
+}
+
+void uart_reader_stop(void)
+{
+    for (int i = 0; i < UART_READERS_MAX; i++) reader_stop(&g_rd[i]);
+}
@@ -0,0 +1,46 @@
+#ifndef UART_READER_H
+#define UART_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "uart_queue.h"
+
+/*
+ * Dedicated UART reader thread. It blocks in poll() on the UART, splits the
+ * byte stream into complete ESP-AT messages and publishes them through two
+ * SPSC rings, then wakes the main loop via an eventfd:
+ *
+ *   uart_queue         AT reply / URC lines (CRLF kept, so the AT helpers
+ *                      can keep concatenating them) and the ">" write
+ *                      prompt, one line per span
+ *   uart_notify_queue  +NOTIFY:<conn>,<srv>,<chr>,<len>,<data> payloads,
+ *                      exactly <len> raw bytes per span (binary-safe),
+ *                      tagged with <conn> (| UART_TAG_METRICS or
+ *                      UART_TAG_PRIO)
+ *
+ * Both rings are drained only on the main thread (event handler or the
+ * blocking AT helpers), so each ring keeps one producer and one consumer.
+ *
+ * With several radios every UART gets its own reader thread, rings and
+ * eventfd (uart_reader_start_unit); unit 0 uses the two rings above.
+ * uart_reader_active() / uart_reader_set_raw() refer to unit 0, the only
+ * one the blocking helpers and SPP passthrough drive.
+ */
+
+#define UART_NOTIFY_PREFIX "+NOTIFY:"
+#define UART_TAG_METRICS   0x80             /* Span tag: conn | this when <chr> is ROBOT_METRICS_CHR */
+#define UART_TAG_PRIO      0x40             /* ... when it is ROBOT_PRIO_CHR */
+#define UART_TAG_CONN      0x3F             /* The conn part */
+#define UART_READERS_MAX   2                /* One per radio (AT_UNITS_MAX) */
+
+extern uart_queue_t uart_notify_queue;
+
+int  uart_reader_start(int uart_fd);        /* Returns the wake eventfd, or -1 */
+int  uart_reader_start_unit(int unit, int uart_fd);
+void uart_reader_stop(void);                /* Stops every unit */
+uart_queue_t *uart_reader_lines(int unit);
+uart_queue_t *uart_reader_notify(int unit);
+int  uart_reader_active(void);
+void uart_reader_set_raw(int on);           /* Passthrough: publish reads to uart_notify_queue unframed */
+
+#endif
@@ -0,0 +1,255 @@
+#include "ack_track.h"
+#include "cmd_trace.h"
+#include "tx_sched.h"
+#include "../json_uds/json_uds.h"
+#include "../metrics/metrics.h"
+#include "../log/gs_log.h"
+#include "../ble/pmod_esp32.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ACK_TRACK_MASK (ACK_TRACK_SLOTS - 1)
+
+typedef struct {
+  uint16_t id;                                             // Id on the wire, 0 = never used
+  uint16_t ui_id;                                          // Id the client gave (kept after the ACK)
+  uint8_t  live;                                           // Waiting for its ACK
+  uint8_t  robot;
+  uint8_t  retries;                                        // Resubmits so far
+  robot_bt_packet_t pkt;                                   // As tagged, for a retry
+  uint64_t t_tag, t_first, t_sent, t_due;                  // Submit, first write, last write, RTO expiry
+} ack_entry_t;
+
+typedef struct {
+  uint32_t srtt, rttvar, rto;                              // us; srtt 0 = no sample yet
+  uint16_t newest_arm;                                     // Last arm id submitted
+  uint32_t acked, lost;                                    // Written words ACKed / run out of RTO
+} ack_link_t;
+
+static int         g_enabled = 1;
+static uint16_t    g_next_tag = 0;
+static uint32_t    g_live = 0;
+static ack_entry_t g_tab[ACK_TRACK_SLOTS];
+static ack_link_t  g_link[BLE_LINKS_MAX];
+
+void ack_track_setup(void) {
+  const char *on = getenv("GS_ACK_TRACK");
+  g_enabled = !(on && strcmp(on, "0") == 0);
+  g_next_tag = 0;
+  g_live = 0;
+  memset(g_tab, 0, sizeof(g_tab));
+  memset(g_link, 0, sizeof(g_link));
+  for (int i = 0; i < BLE_LINKS_MAX; i++) g_link[i].rto = ACK_RTO_INIT_MS * 1000u;
+}
+
+int ack_track_enabled(void) {
+  return g_enabled;
+}
+
+static void set_id(robot_bt_packet_t *p, uint32_t id) {
+  switch (p->ctrl.type) {
+    case CONTROL_CMD: p->ctrl.id  = id; break;
+    case ARM_CMD:     p->arm.id   = id; break;
+    case ARM_TARGET_CMD: p->armt.id = id; break;
+    case TRAJ_CMD:    p->trajc.id = id; break;        // RUN / ABORT only (cmd_word_id)
+    case System_CMD:  p->sys.id   = id; break;
+    case Query_CMD:   p->query.id = id; break;
+  }
+}
+
+// How long tx_sched may hold a word of this type before it drops it
+static uint64_t stale_us(int type) {
+  int stream = type == CONTROL_CMD || type == ARM_CMD;
+  return (stream ? TX_STREAM_STALE_MS : TX_FIFO_STALE_MS) * 1000ull + ACK_TRACK_TICK_MS * 1000ull;
+}
+
+static void retire(ack_entry_t *e) {
+  if (e->live) g_live--;
+  e->live = 0;
+}
+
+void ack_track_tag(robot_bt_packet_t *packet, int robot) {
+  int ui = cmd_word_id(packet);
+  if (!g_enabled || ui < 0 || robot < 0 || robot >= BLE_LINKS_MAX) return;
+
+  uint32_t id = (uint32_t)ui;
+  if (!cmd_trace_enabled()) {                              // The trace tag is unique already
+    g_next_tag = g_next_tag % CMD_TRACE_ID_MAX + 1;        // 0 = robot error ACKs
+    id = ((uint32_t)ui & ~(uint32_t)CMD_TRACE_ID_MAX) | g_next_tag;
+    set_id(packet, id);
+  }
+  if ((id & CMD_TRACE_ID_MAX) == 0) return;                // A client's own 0 cannot be told apart
+
+  ack_entry_t *e = &g_tab[id & ACK_TRACK_MASK];            // Replaces a word 511 tags old
+  retire(e);
+  memset(e, 0, sizeof(*e));
+  e->id = (uint16_t)id;
+  e->ui_id = (uint16_t)ui;
+  e->robot = (uint8_t)robot;
+  e->pkt = *packet;
+  e->t_tag = metrics_now_us();
+  e->t_due = e->t_tag + stale_us(packet->ctrl.type);       // Never written by then: coalesced or aged out
+  e->live = 1;
+  g_live++;
+  if (packet->ctrl.type == ARM_CMD || packet->ctrl.type == ARM_TARGET_CMD) g_link[robot].newest_arm = (uint16_t)id;
+}
+
+static ack_entry_t *entry_of(int id) {
+  if (id <= 0) return NULL;
+  ack_entry_t *e = &g_tab[id & ACK_TRACK_MASK];
+  return e->id == id ? e : NULL;
+}
+
+void ack_track_written(const robot_bt_packet_t *packet) {
+  ack_entry_t *e = g_enabled ? entry_of(cmd_word_id(packet)) : NULL;
+  if (!e || !e->live) return;
+
+  uint64_t now = metrics_now_us();
+  if (!e->t_first) e->t_first = now;
+  e->t_sent = now;
+  uint64_t rto = (uint64_t)g_link[e->robot].rto << e->retries;  // Backoff per retry
+  if (rto > ACK_RTO_MAX_MS * 1000ull) rto = ACK_RTO_MAX_MS * 1000ull;
+  e->t_due = now + rto;
+}
+
+// RFC 6298 section 2, in microseconds; the clock granularity is the tick
+static void rtt_sample(ack_link_t *l, uint32_t r) {
+  if (!l->srtt) {
+    l->srtt = r;
+    l->rttvar = r / 2;
+  } else {
+    uint32_t dev = l->srtt > r ? l->srtt - r : r - l->srtt;
+    l->rttvar = (3 * l->rttvar + dev) / 4;
+    l->srtt = (7 * l->srtt + r) / 8;
+  }
+  uint32_t k = 4 * l->rttvar;
+  if (k < ACK_TRACK_TICK_MS * 1000u) k = ACK_TRACK_TICK_MS * 1000u;
+  uint32_t rto = l->srtt + k;
+  if (rto < ACK_RTO_MIN_MS * 1000u) rto = ACK_RTO_MIN_MS * 1000u;
+  if (rto > ACK_RTO_MAX_MS * 1000u) rto = ACK_RTO_MAX_MS * 1000u;
+  l->rto = rto;
+}
+
+void ack_track_ack(int robot, robot_bt_packet_t *ack) {
+  if (ack->ctrl.type != ACK_CMD) return;
+  if (ack->ack.result_code == RESULT_CMD_FAILURE && ack->ack.instruction_specific == CMD_EXPIRED)
+    METRIC_INC(expired_robot);
+  if (!g_enabled) return;
+  ack_entry_t *e = entry_of(ack->ack.id);
+  if (!e || e->robot != robot) return;
+
+  if (e->live && e->t_sent) {
+    uint64_t now = metrics_now_us();
+    g_link[robot].acked++;
+    if (!e->retries) {
+      rtt_sample(&g_link[robot], (uint32_t)(now - e->t_sent));
+      METRIC_OBSERVE(ack_rtt_us, now - e->t_sent);
+    }
+    METRIC_OBSERVE(cmd_delivery_us, now - e->t_first);
+    if (cmd_word_is_estop(e->pkt.raw)) METRIC_OBSERVE(estop_us, now - e->t_tag);
+  }
+  retire(e);
+  ack->ack.id = e->ui_id;                                  // Late duplicates map back too
+}
+
+static void give_up(ack_entry_t *e) {
+  char js[128];
+  int n = snprintf(js, sizeof(js), "{\"type\":\"ACK_TIMEOUT\",\"id\":%u,\"cmd\":%u,\"tries\":%u",
+                   (unsigned)e->ui_id, (unsigned)e->pkt.ctrl.type, (unsigned)e->retries + 1);
+  if (ble_robots() > 1) n += snprintf(js + n, sizeof(js) - (size_t)n, ",\"robot\":%u", (unsigned)e->robot);
+  snprintf(js + n, sizeof(js) - (size_t)n, "}");
+  LOG_WARN("ACK: robot %u type %u id %u unanswered after %u tries", (unsigned)e->robot,
+           (unsigned)e->pkt.ctrl.type, (unsigned)e->ui_id, (unsigned)e->retries + 1);
+  METRIC_INC(ack_timeouts);
+  retire(e);
+  uds_tx_broadcast(js, UDS_TX_CMD, 0, UDS_TOPIC_ACKS, e->robot);
+}
+
+static void expire(ack_entry_t *e, uint64_t now) {
+  int type = e->pkt.ctrl.type;
+  if (!e->t_sent) { retire(e); return; }                   // tx_sched replaced or dropped it unsent
+  g_link[e->robot].lost++;
+  int arm = type == ARM_CMD || type == ARM_TARGET_CMD;
+  if (type == CONTROL_CMD || (arm && g_link[e->robot].newest_arm != e->id)) {
+    METRIC_INC(ack_superseded);
+    retire(e);
+    return;
+  }
+  if (type == ARM_CMD && now - e->t_tag > TX_STREAM_STALE_MS * 1000ull) {
+    METRIC_INC(expired_retry);                             // Past its deadline: a retry would run late
+    retire(e);
+    return;
+  }
+  if (e->retries >= ACK_RETRY_MAX) { give_up(e); return; }
+
+  e->retries++;
+  e->t_due = now + stale_us(type);                         // Until the retry is written
+  METRIC_INC(ack_retransmits);
+  if (tx_sched_retry(e->robot, &e->pkt) < 0) give_up(e);
+}
+
+void ack_track_poll(void) {
+  if (!g_enabled || !g_live) return;
+  uint64_t now = metrics_now_us();
+  for (int i = 1; i < ACK_TRACK_SLOTS; i++) {
+    ack_entry_t *e = &g_tab[i];
+    if (e->live && now >= e->t_due) expire(e, now);
+  }
+}
+
+uint32_t ack_track_inflight(void) {
+  return g_live;
+}
+
+uint32_t ack_track_rto_us(int robot) {
+  return (robot >= 0 && robot < BLE_LINKS_MAX) ? g_link[robot].rto : 0;
+}
+
+void ack_track_link(int robot, ack_link_stats_t *out) {
+  memset(out, 0, sizeof(*out));
+  if (robot < 0 || robot >= BLE_LINKS_MAX) return;
+  out->acked = g_link[robot].acked;
+  out->lost = g_link[robot].lost;
+  out->srtt_us = g_link[robot].srtt;
+}
+
+int ack_track_export(ack_word_t *out, int max) {
+  int n = 0;
+  if (!g_enabled || !g_live) return 0;
+  for (int k = 1; k <= ACK_TRACK_SLOTS && n < max; k++) {  // From the slot after the newest tag
+    ack_entry_t *e = &g_tab[(g_next_tag + k) & ACK_TRACK_MASK];
+    int type = e->pkt.ctrl.type;
+    if (!e->live || (type != System_CMD && type != Query_CMD)) continue;
+    out[n].id = e->id;
+    out[n].ui_id = e->ui_id;
+    out[n].robot = e->robot;
+    out[n].retries = e->retries;
+    out[n].pkt = e->pkt;
+    n++;
+  }
+  return n;
+}
+
+// The previous bridge wrote it and may have seen its ACK go missing with the
+// process: one more try, counted against the word's retry budget
+void ack_track_adopt(const ack_word_t *w) {
+  if (!g_enabled || w->robot >= BLE_LINKS_MAX || (w->id & CMD_TRACE_ID_MAX) == 0) return;
+
+  ack_entry_t *e = &g_tab[w->id & ACK_TRACK_MASK];
+  retire(e);
+  memset(e, 0, sizeof(*e));
+  e->id = w->id;
+  e->ui_id = w->ui_id;
+  e->robot = w->robot;
+  e->retries = w->retries < ACK_RETRY_MAX ? w->retries + 1 : ACK_RETRY_MAX;
+  e->pkt = w->pkt;
+  e->t_tag = metrics_now_us();
+  e->t_due = e->t_tag + stale_us(w->pkt.ctrl.type);
+  e->live = 1;
+  g_live++;
+  uint16_t tag = w->id & CMD_TRACE_ID_MAX;
+  if (tag > g_next_tag) g_next_tag = tag;                  // New tags start after the adopted ones
+  METRIC_INC(ack_retransmits);
+  if (tx_sched_retry(w->robot, &e->pkt) < 0) give_up(e);
+}
@@ -0,0 +1,71 @@
+#ifndef ACK_TRACK_H
+#define ACK_TRACK_H
+
+#include <stdint.h>
+#include "../cmd_structure.h"
+
+// ------------------------- ACK tracker -------------------------
+// Every command word the robot ACKs by id is in flight from its first write
+// until its ACK. On by default, GS_ACK_TRACK=0 turns it off.
+//
+// The UI mostly reuses one id, so the tracker gives each word a rolling tag
+// (1..CMD_TRACE_ID_MAX, robot select bits kept, as cmd_trace.h does) and
+// writes the client's id back into the ACK before it is published. With
+// GS_TRACE=1 the trace tag is used as is and ACKs keep it.
+//
+// Each link keeps an RFC 6298 estimate: SRTT / RTTVAR from write -> ACK of
+// words sent once (Karn: a retransmitted word gives no sample), RTO = SRTT
+// + 4 RTTVAR clamped to ACK_RTO_MIN_MS..ACK_RTO_MAX_MS, doubled per retry.
+// When a word's RTO runs out:
+//   CONTROL   dropped; drive words are never retried, the next one
+//             supersedes it (ack_superseded)
+//   ARM       retried while it is still the robot's newest arm word and
+//             within its deadline (tx_sched.h; expired_retry), otherwise
+//             superseded like CONTROL
+//   SYSTEM /  retried through tx_sched up to ACK_RETRY_MAX times, then
+//   QUERY     given up (ack_timeouts) and clients are told:
+//               {"type":"ACK_TIMEOUT","id":N,"cmd":T,"tries":K[,"robot":R]}
+// A retry is a fresh seal, so the replay window takes it; if only the ACK
+// was lost the robot runs the command twice.
+//
+// METRICS: ack_rtt_us (written -> ACK, first sends), cmd_delivery_us
+// (first write -> ACK, retries included), ack_retransmits, estop_us (an
+// e-stop's submit -> ACK, the bound the emergency lane is measured by),
+// expired_robot (CMD_EXPIRED ACKs: words the robot dropped past their
+// deadline).
+
+#define ACK_TRACK_SLOTS   512               // CMD_TRACE_ID_MAX + 1, indexed by tag
+#define ACK_RTO_INIT_MS   300               // Before the first sample
+#define ACK_RTO_MIN_MS    60
+#define ACK_RTO_MAX_MS    2000
+#define ACK_RETRY_MAX     3
+#define ACK_TRACK_TICK_MS 10                // RTO scan period
+
+// Running totals of a link for link_quality.h: written words ACKed, RTO
+// expiries of written words (every try's), and the smoothed RTT
+typedef struct {
+  uint32_t acked, lost;
+  uint32_t srtt_us;                         // 0 = no sample yet
+} ack_link_stats_t;
+
+// A live SYSTEM / QUERY word as a standby bridge takes it over (standby.h):
+// CONTROL / ARM words are superseded long before a failover completes
+typedef struct {
+  uint16_t id, ui_id;                       // Tag on the wire, the client's id
+  uint8_t  robot, retries;
+  robot_bt_packet_t pkt;                    // As tagged
+} ack_word_t;
+
+void     ack_track_setup(void);                                  // Reads GS_ACK_TRACK
+int      ack_track_enabled(void);
+void     ack_track_tag(robot_bt_packet_t *packet, int robot);    // At submit; assigns the id
+void     ack_track_written(const robot_bt_packet_t *packet);     // Write issued to the ESP32
+void     ack_track_ack(int robot, robot_bt_packet_t *ack);       // Ends the word; restores the client id
+void     ack_track_poll(void);                                   // Every ACK_TRACK_TICK_MS
+uint32_t ack_track_inflight(void);
+uint32_t ack_track_rto_us(int robot);
+void     ack_track_link(int robot, ack_link_stats_t *out);
+int      ack_track_export(ack_word_t *out, int max);             // Live SYSTEM / QUERY words, oldest tag first
+void     ack_track_adopt(const ack_word_t *w);                   // Tracked again and resent through tx_sched
+
+#endif
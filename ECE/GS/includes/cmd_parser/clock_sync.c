@@ -0,0 +1,121 @@
+#include "clock_sync.h"
+#include "cmd_trace.h"
+#include "tx_sched.h"
+#include "../metrics/metrics.h"
+#include "../log/gs_log.h"
+#include "../ble/pmod_esp32.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  uint8_t  up;                                             // Link was up at the last poll
+  uint8_t  pending;                                        // A sync query is out
+  uint8_t  sent;                                           // Queries since the link came up (saturates)
+  uint8_t  n, next;                                        // Samples in the filter, next slot
+  uint64_t t_sub, t1, t_next;                              // Submitted, written, next query due
+  uint32_t s_off[CLOCK_SYNC_FILTER], s_rtt[CLOCK_SYNC_FILTER];
+  uint32_t off;                                            // robot clock - (uint32_t)metrics_now_us()
+} clock_link_t;
+
+static uint32_t     g_delay_ms = 0;
+static clock_link_t g_clk[BLE_LINKS_MAX];
+
+void clock_sync_setup(void) {
+  const char *ms = getenv("GS_EXEC_DELAY_MS");
+  long v = ms ? strtol(ms, NULL, 10) : 0;
+  if (v < 0) v = 0;
+  if (v > EXEC_DELAY_MAX_MS) v = EXEC_DELAY_MAX_MS;
+  g_delay_ms = (uint32_t)v;
+  memset(g_clk, 0, sizeof(g_clk));
+}
+
+int clock_sync_enabled(void) {
+  return g_delay_ms > 0;
+}
+
+uint32_t clock_sync_delay_ms(void) {
+  return g_delay_ms;
+}
+
+int clock_sync_synced(void) {
+  int n = 0;
+  for (int i = 0; i < BLE_LINKS_MAX; i++) n += g_clk[i].up && g_clk[i].n > 0;
+  return n;
+}
+
+static void sync_send(int robot, clock_link_t *c, uint64_t now) {
+  robot_bt_packet_t q = {0};
+  q.query.pl = 1;
+  q.query.type = Query_CMD;
+  q.query.instruction = CLOCK_SYNC;
+  q.query.id = (uint32_t)robot << ROBOT_ID_SHIFT;          // Tag 0: not tracked
+  c->pending = 1;
+  c->t_sub = now;
+  c->t1 = 0;
+  if (c->sent < 0xFF) c->sent++;
+  c->t_next = now + (c->sent < CLOCK_SYNC_BURST ? CLOCK_SYNC_FAST_MS : CLOCK_SYNC_PERIOD_MS) * 1000ull;
+  if (tx_sched_retry(robot, &q) < 0) c->pending = 0;       // Queued like a retry: id as is
+}
+
+void clock_sync_poll(void) {
+  if (!g_delay_ms) return;
+  uint64_t now = metrics_now_us();
+  int robots = ble_robots();
+  for (int i = 0; i < robots && i < BLE_LINKS_MAX; i++) {
+    clock_link_t *c = &g_clk[i];
+    if (!ble_connected[i]) {                               // A reconnect may be a rebooted robot
+      if (c->up) memset(c, 0, sizeof(*c));
+      continue;
+    }
+    c->up = 1;
+    if (c->pending && now - c->t_sub > CLOCK_SYNC_LOST_MS * 1000ull) c->pending = 0;
+    if (!c->pending && now >= c->t_next) sync_send(i, c, now);
+  }
+}
+
+static int is_sync(const robot_bt_packet_t *p) {
+  return p->ctrl.type == Query_CMD && p->query.instruction == CLOCK_SYNC
+      && (p->query.id & CMD_TRACE_ID_MAX) == 0;
+}
+
+void clock_sync_written(const robot_bt_packet_t *packet) {
+  if (!g_delay_ms || !is_sync(packet)) return;
+  int robot = ROBOT_OF_ID(packet->query.id);
+  if (robot < BLE_LINKS_MAX && g_clk[robot].pending) g_clk[robot].t1 = metrics_now_us();
+}
+
+int clock_sync_ack(int robot, const robot_bt_packet_t *ack) {
+  if (!g_delay_ms || ack->ctrl.type != ACK_CMD || (ack->ack.id & CMD_TRACE_ID_MAX) != 0) return 0;
+  if (robot < 0 || robot >= BLE_LINKS_MAX || !g_clk[robot].pending) return 0;
+  clock_link_t *c = &g_clk[robot];
+  c->pending = 0;
+  if (ack->ack.result_code != RESULT_SUCCESS) return 1;    // Firmware without CLOCK_SYNC: words stay unstamped
+  uint64_t info = ack->ack.instruction_specific;
+
+  uint32_t hold = (uint32_t)(info >> 32) & CLOCK_HOLD_MAX;
+  if (!c->t1 || hold == CLOCK_HOLD_MAX) return 1;          // Never written, or held too long to use
+  uint64_t t4 = metrics_now_us(), hold_us = hold * CLOCK_HOLD_UNIT_US;
+  uint64_t rtt = t4 - c->t1 > hold_us ? t4 - c->t1 - hold_us : 0;
+  uint32_t t2 = (uint32_t)info;
+  uint32_t off = t2 - (uint32_t)c->t1 - (uint32_t)(rtt / 2);
+
+  c->s_off[c->next] = off;
+  c->s_rtt[c->next] = (uint32_t)rtt;
+  c->next = (uint8_t)((c->next + 1) % CLOCK_SYNC_FILTER);
+  if (c->n < CLOCK_SYNC_FILTER) c->n++;
+  int best = 0;
+  for (int k = 1; k < c->n; k++) if (c->s_rtt[k] < c->s_rtt[best]) best = k;
+  c->off = c->s_off[best];
+  METRIC_INC(clock_syncs);
+  METRIC_OBSERVE(clock_rtt_us, rtt);
+  return 1;
+}
+
+void clock_sync_stamp(robot_bt_packet_t *packet, int robot) {
+  if (!g_delay_ms || robot < 0 || robot >= BLE_LINKS_MAX || !g_clk[robot].n) return;
+  uint32_t at = exec_at_of((uint32_t)metrics_now_us() + g_delay_ms * 1000u + g_clk[robot].off);
+  switch (packet->ctrl.type) {
+    case CONTROL_CMD: if (!packet->ctrl.at) packet->ctrl.at = at; break;
+    case ARM_CMD:     if (!packet->arm.at)  packet->arm.at  = at; break;
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <stdint.h>
+#include "../cmd_structure.h"
+
+// ------------------------- Robot clock sync -------------------------
+// Off unless GS_EXEC_DELAY_MS > 0. Then every CONTROL / ARM word a client
+// submits is stamped to run that long after the bridge took it, on the
+// robot's clock (cmd_codec.h, Scheduled execution). The robot holds early
+// words, so UDS / AT / BLE jitter shorter than the delay becomes a fixed
+// delay instead of motion jitter. Words go out unstamped until a robot's
+// first sample, and again while its link is down.
+//
+// The robot clock comes from CLOCK_SYNC queries: CLOCK_SYNC_BURST of them
+// CLOCK_SYNC_FAST_MS apart once a link is up, then one every
+// CLOCK_SYNC_PERIOD_MS. Each is one NTP exchange: t1 = write issued, t2 =
+// robot arrival, hold = robot arrival -> ACK, t4 = ACK here.
+//   rtt = t4 - t1 - hold        offset = t2 - t1 - rtt / 2
+// Of the last CLOCK_SYNC_FILTER samples the one with the smallest rtt is
+// used (the least queueing in it). Asymmetry between the two directions
+// (AT write vs notify) shows up as a constant part of the delay.
+//
+// Sync queries carry id tag 0 (robot select bits only), so the ACK tracker
+// leaves them alone: a lost one is just a lost sample. Their ACKs are not
+// published to clients.
+//
+// METRICS: clock_syncs, clock_rtt_us (per sample); gauges exec_delay_ms,
+// clock_synced (robots with an offset).
+
+#define CLOCK_SYNC_TICK_MS    50                // Poll period
+#define CLOCK_SYNC_FAST_MS    100
+#define CLOCK_SYNC_BURST      8
+#define CLOCK_SYNC_PERIOD_MS  2000
+#define CLOCK_SYNC_FILTER     8
+#define CLOCK_SYNC_LOST_MS    1000              // No ACK by then: the sample is lost
+#define EXEC_DELAY_MAX_MS     500
+
+void     clock_sync_setup(void);                                    // Reads GS_EXEC_DELAY_MS
+int      clock_sync_enabled(void);
+uint32_t clock_sync_delay_ms(void);
+int      clock_sync_synced(void);                                   // Robots with an offset
+void     clock_sync_poll(void);                                     // Every CLOCK_SYNC_TICK_MS
+void     clock_sync_stamp(robot_bt_packet_t *packet, int robot);    // At submit; sets at
+void     clock_sync_written(const robot_bt_packet_t *packet);       // Write issued to ble_route
+int      clock_sync_ack(int robot, const robot_bt_packet_t *ack);   // 1 = a sync ACK, not for clients
+
+#endif
@@ -1,18 +1,83 @@
 #include "cmd_parser.h"
 #include "../cmd_structure.h"
-
-volatile int security_level = 0; // use for sendback from bruidge for confirmation of secuirty level
+#include "tx_sched.h"
+#include "cmd_trace.h"
+#include "ack_track.h"
+#include "clock_sync.h"
+#include "crypto_stage.h"
+#include "../metrics/metrics.h"
+#include "../recorder/recorder.h"
+#include "../log/gs_log.h"
+#include "report_json.h"
+#include "robot_state.h"
+#include "link_sup.h"
+#include "transport.h"
+#include "hex_codec.h"
+#include "frame_pool.h"
+#include "../hardware_crypto/crypto_provider.h"
+#include <math.h>
+
+volatile int security_levels[BLE_LINKS_MAX] = {0}; // use for sendback from bruidge for confirmation of secuirty level
 volatile int connection_status = 0;
 volatile int authorization_code = 0x3FF;
 
+static double      cmd_arena_mem[CMD_ARENA_BYTES / sizeof(double)];
+static cJSON_Arena cmd_arena;
+static cJSON_TapeEntry cmd_tape_mem[CMD_TAPE_ENTRIES];
+
+// Completion for a queued connect (event loop mode)
+static void on_connect_done(int status, const char *value, void *ctx) {
+  (void)value; (void)ctx;
+  connection_status = (status == AT_OK);
+  LOG_INFO("BLE connect %s (%d)", status == AT_OK ? "complete" : "failed", status);
+}
+
+int security_any(void) {
+  for (int i = 0; i < BLE_LINKS_MAX; i++) if (security_levels[i]) return 1;
+  return 0;
+}
+
+// 1 if the routed robot's link is sealed, with the crypto calls switched to
+// the suite it negotiated; 0 on a plain link
+int security_route(void) {
+  int level = security_level;
+  if (level == SEC_PLAIN) return 0;
+  gs_crypto_suite(level == SEC_CHACHA20_POLY1305 ? GS_SUITE_CHACHA20_POLY1305 : GS_SUITE_AES_GCM);
+  return 1;
+}
+
+// Multi-robot: the top bits of the id pick the robot (ROBOT_OF_ID) and every
+// BLE / security / scheduler call after this addresses it. With one robot
+// the id is left alone and everything goes to CONN_IDX as before.
+int cmd_route(const robot_bt_packet_t *packet) {
+  int robots = ble_robots();
+  if (robots <= 1) { ble_route = CONN_IDX; return 0; }
+
+  int id = cmd_word_id(packet);
+  int rb = id < 0 ? 0 : ROBOT_OF_ID(id);
+  if (rb >= robots || !ble_peer(rb)) {
+    METRIC_INC(cmd_rejects);
+    LOG_WARN("CMD: id %d addresses robot %d, not configured", id, rb);
+    return -1;
+  }
+  ble_route = rb;
+  return 0;
+}
+
 // Do sys instructions for the robot
 int sys_cmd(int uart_fd, system_format_t sys_inst){
   int robot_send_need = 1;
 
   switch(sys_inst.instruction){
     case SECURITY_LEVEL:
-      printf("Changing Security Level\r\n");
-      if(sys_inst.specific == 1){
+      if (sys_inst.specific > SEC_CHACHA20_POLY1305) {
+        LOG_WARN("Security level %u not supported", (unsigned)sys_inst.specific);
+        robot_send_need = 0;
+        break;
+      }
+      LOG_INFO("Changing Security Level (%s)", sys_inst.specific == SEC_CHACHA20_POLY1305 ? "ChaCha20-Poly1305" :
+               sys_inst.specific == SEC_AES_GCM ? "AES-256-GCM" : "off");
+      if(sys_inst.specific != SEC_PLAIN){        // Sent in the clear: the robot switches on receipt
         robot_bt_packet_t packet = {0};
         packet.sys.pl          = sys_inst.pl;
         packet.sys.type        = System_CMD;
@@ -20,15 +85,22 @@ int sys_cmd(int uart_fd, system_format_t sys_inst){
         packet.sys.ac          = sys_inst.ac;
         packet.sys.id          = sys_inst.id;
         packet.sys.specific    = sys_inst.specific;
-        ble_send_instruction(uart_fd, packet.bytes);
+        transport_send_frame(packet.bytes, 8, 0);
         robot_send_need = 0;
       }
       security_level = sys_inst.specific;
     break;
 
     case Connect_Reconnect:
-      printf("Attempting Connection\r\n");
-      if (ble_connect(uart_fd, NULL) < 0){ connection_status = 0;}
+      LOG_INFO("Attempting Connection");
+      if (!transport_is_esp()) {                        // RN backends: one robot, async connect
+        if (transport()->connect(ble_peer(ble_route)) != 0) connection_status = 0;
+      }
+      else if (link_sup_start(ble_route) == 0) {}            // Supervisor connects and keeps it up
+      else if (at_engine_active()) {
+        if (ble_connect_async(uart_fd, NULL, on_connect_done, NULL) < 0) connection_status = 0;
+      }
+      else if (ble_connect(uart_fd, NULL) < 0){ connection_status = 0;}
       else { connection_status = 1; }
       robot_send_need = 0;
 
@@ -36,9 +108,10 @@ int sys_cmd(int uart_fd, system_format_t sys_inst){
       break;
 
     case DISCONNECT:
-      if (ble_discon(uart_fd) == 0) connection_status = 0;
+      link_sup_hold(ble_route, 1);                       // Deliberate: no auto-reconnect
+      if (transport_is_esp() && ble_discon(uart_fd) == 0) connection_status = 0;
       robot_send_need = 0;
-      printf("Disconnected\r\n");
+      LOG_INFO("Disconnected");
       // ADD SEND ACK to UI FUNCTION
 
       break;
@@ -49,7 +122,7 @@ int sys_cmd(int uart_fd, system_format_t sys_inst){
       memcpy(new_name, &specific_val, 4);
       new_name[4] = '\0';
       pmod_name(uart_fd, new_name, NULL); 
-      printf("Name Changed\r\n");
+      LOG_INFO("Name Changed");
     break;
 
     case GS_BLE_RESET:
@@ -67,254 +140,519 @@ int sys_cmd(int uart_fd, system_format_t sys_inst){
 }
 
 int query_cmd(int uart_fd, query_format_t query_inst){
-  int robot_send_need = 1;
-
-  switch(query_inst.instruction){
-    case CONNNECTION_STAT:
-      robot_send_need = 0;
+  // Bridge-side facts and fresh cached state are answered here (robot_state.h)
+  return !robot_state_answer(ble_route, query_inst);
+}
 
-      // SEND ACK to UI
-    break;
+// Opens one IV || CT || tag packet from Node into json_out[CT_SZ + 1]; the
+// crypto stage's thread runs this too
+int node_cipher_open(const uint8_t encrypted_bytes[TOTAL_SZ], char *json_out) {
+    gs_crypto_suite(GS_SUITE_AES_GCM);                  // Node seals with AES-GCM whatever the robot link uses
+    return decrypt_json(encrypted_bytes, json_out, CT_SZ + 1);
+}
 
-    case SECURITY_STATUS:
-      robot_send_need = 0;
+// Dispatches what node_cipher_open() returned (len < 0: it failed)
+int node_cipher_dispatch(int uart_fd, int uds_fd, char *json_out, int len) {
+    if (len < 0) {
+        METRIC_INC(decrypt_failures);
+        LOG_ERR("[encrypt] decrypt_json failed (returned %d)", len);
+        return -4;
+    }
 
-      // Send ACK to UI
-    break;
+    json_out[CT_SZ] = '\0';
 
-    case ROBOT_NAME:
-      robot_send_need = 0;
+    //printf("[encrypt] Decrypted JSON (%d bytes): %s\n", len, json_out);
+    fflush(stdout);
 
-      // Send ACK to UI
-    break;
+    handle_node_json(uart_fd, uds_fd, json_out);
+    return 0;
+}
 
-  }
-  return robot_send_need;
+// Decrypt one IV || CT || tag packet from Node and dispatch the JSON inside.
+static int handle_encrypted_bytes(int uart_fd, int uds_fd, const uint8_t encrypted_bytes[TOTAL_SZ]) {
+    if (crypto_stage_active()) return crypto_stage_open(uart_fd, uds_fd, encrypted_bytes);
+    char json_out[CT_SZ + 1] = {0};
+    int len = node_cipher_open(encrypted_bytes, json_out);
+    return node_cipher_dispatch(uart_fd, uds_fd, json_out, len);
 }
 
+// The small UDS frame class must hold this whole frame: the hex record
+// plus its JSON envelope and key names
+_Static_assert(FRAME_POOL_SMALL >= PAYLOAD_HEX_STR_LEN + 128,
+               "FRAME_POOL_SMALL cannot hold a hex-sealed command frame");
+
+// Legacy text mode: 312 hex chars (whitespace tolerated)
 int handle_encrypted_data(int uart_fd, int uds_fd, const char *encrypt_str) {
-    if (!security_level){
-        fprintf(stderr, "[encrypt] ERROR: null input\n");
+    if (!security_any()){
+        LOG_ERR("[encrypt] null input");
         return -1;
     }
 
-    /* Strip all whitespace into a clean buffer */
-    char clean[PAYLOAD_HEX_STR_LEN + 1] = {0};
-    size_t clean_len = 0;
-    for (size_t i = 0; encrypt_str[i] != '\0'; i++) {
-        unsigned char c = (unsigned char)encrypt_str[i];
-        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') continue;
-        if (clean_len >= PAYLOAD_HEX_STR_LEN) {
-            fprintf(stderr, "[encrypt] ERROR: input too long after stripping whitespace\n");
-            return -2;
-        }
-        clean[clean_len++] = encrypt_str[i];
+    uint8_t encrypted_bytes[TOTAL_SZ] = {0};
+    int rc = cipher_payload_decode((const uint8_t *)encrypt_str, strlen(encrypt_str), encrypted_bytes);
+    if (rc == -2) {
+        LOG_ERR("[encrypt] bad length, expected %d hex chars", PAYLOAD_HEX_STR_LEN);
+        return -2;
+    }
+    if (rc != 0) {
+        LOG_ERR("[encrypt] hex parse failed");
+        return -3;
     }
-    clean[clean_len] = '\0';
 
-    if (clean_len != PAYLOAD_HEX_STR_LEN) {
-        fprintf(stderr, "[encrypt] ERROR: bad length — got %zu, expected %d\n",
-                clean_len, PAYLOAD_HEX_STR_LEN);
+    return handle_encrypted_bytes(uart_fd, uds_fd, encrypted_bytes);
+}
+
+// Binary mode: [UDS_BIN_CIPHER_MAGIC][156 raw bytes], no hex round trip
+int handle_encrypted_bin(int uart_fd, int uds_fd, const uint8_t *frame, uint32_t len) {
+    if (!security_any()) {
+        uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"not in secure mode\"}");
+        return -1;
+    }
+    if (len != UDS_BIN_CIPHER_LEN || frame[0] != UDS_BIN_CIPHER_MAGIC) {
+        uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"bad cipher frame\"}");
         return -2;
     }
+    return handle_encrypted_bytes(uart_fd, uds_fd, frame + 1);
+}
 
-    uint8_t encrypted_bytes[TOTAL_SZ] = {0};
-    for (int i = 0; i < TOTAL_SZ; i++) {
-        if (sscanf(clean + i * 2, "%02hhx", &encrypted_bytes[i]) != 1) {
-            fprintf(stderr, "[encrypt] ERROR: hex parse failed at byte %d\n", i);
-            return -3;
-        }
-    }
+// ------------------------- Robot send -------------------------
+static int g_seal_compact = 0;                          // robot_seal_set()
 
-    char json_out[CT_SZ + 1] = {0};
-    int len = decrypt_json(encrypted_bytes, json_out, sizeof(json_out));
-    if (len < 0) {
-        fprintf(stderr, "[encrypt] ERROR: decrypt_json failed (returned %d)\n", len);
-        return -4;
-    }
+// Compact seals (compact_seal.h) when the transport can carry them,
+// otherwise the 160-byte padded frame
+int robot_seal_set(int compact) {
+  g_seal_compact = compact && transport_framed();
+  return g_seal_compact;
+}
 
-    json_out[CT_SZ] = '\0';
+_Static_assert(SEAL_FRAME_MAX <= ROBOT_SEAL_MAX, "ROBOT_SEAL_MAX cannot hold a compact batch");
 
-    //printf("[encrypt] Decrypted JSON (%d bytes): %s\n", len, json_out);
-    fflush(stdout);
+// Seals n words for the ble_route robot, its suite already selected by
+// security_route(): one compact frame, or a 160-byte frame holding one
+// word or a batch. Runs on the crypto stage's thread when that is on.
+int robot_seal(const robot_bt_packet_t *packets, int n, uint8_t *frame, size_t *len, int *flags) {
+  if (g_seal_compact) {
+    *flags |= TRANSPORT_FRAMED;
+    return encrypt_cmd_compact(packets, n, frame, len);
+  }
+  return n == 1 ? encrypt_cmd(packets, frame, len) : encrypt_cmd_batch(packets, n, frame, len);
+}
 
-    handle_node_json(uart_fd, uds_fd, json_out);
-    return 0;
+static void robot_written(const robot_bt_packet_t *packets, int n) {
+  for (int i = 0; i < n; i++) {
+    cmd_trace_written(&packets[i]);
+    ack_track_written(&packets[i]);
+    clock_sync_written(&packets[i]);
+  }
 }
 
-// ------------------------- Handle Node JSON -------------------------
-// Parse incoming JSON from Node and transmit appropriate 64-bit word(s) over UART.
-int handle_node_json(int uart_fd, int uds_fd, const char *json_str) {
-  cJSON *root = cJSON_Parse(json_str);
-  if (!root) {
-    uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"bad json\"}");
+// Writes the frame robot_seal() made of these words to the ble_route robot
+int robot_seal_send(const robot_bt_packet_t *packets, int n, const uint8_t *frame, size_t len, int flags) {
+  for (int i = 0; i < n; i++) cmd_trace_sealed(&packets[i]);
+  rec_put(REC_CIPHER_TX, ble_route, frame, len);
+  int rc = transport_send_frame(frame, len, flags);
+  if (rc >= 0) robot_written(packets, n);
+  return rc;
+}
+
+// Sealed words: inline, or handed to the crypto stage, which comes back
+// through robot_seal_send() once the frame is ready
+static int robot_send_sealed(const robot_bt_packet_t *packets, int n, int flags) {
+  if (crypto_stage_active()) return crypto_stage_seal(packets, n, flags);
+  uint8_t frame[ROBOT_SEAL_MAX];
+  size_t len = 0;
+  if (robot_seal(packets, n, frame, &len, &flags) != 0) return -1;
+  return robot_seal_send(packets, n, frame, len, flags);
+}
+
+// Transmit one packed command, encrypting it first when security is on.
+int robot_send_packet(int uart_fd, robot_bt_packet_t *packet) {
+  (void)uart_fd;                                      // The selected transport owns the UART
+  int stream = packet->ctrl.type == CONTROL_CMD || packet->ctrl.type == ARM_CMD; // Write-without-response eligible
+  int flags = stream ? TRANSPORT_STREAM : 0;
+  if (cmd_word_is_estop(packet->raw)) flags |= TRANSPORT_URGENT;   // Next write on the modem
+  cmd_trace_send(packet);
+  rec_put(REC_WORD_TX, ble_route, packet->bytes, 8);
+
+  if (security_route()) {
+    const uint8_t *b = packet->bytes;
+    LOG_DEBUG("Packet (8 bytes): %02X %02X %02X %02X %02X %02X %02X %02X",
+              b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7]);
+    return robot_send_sealed(packet, 1, flags);
+  }
+  int rc = transport_send_frame(packet->bytes, 8, flags);
+  if (rc >= 0) robot_written(packet, 1);
+  return rc;
+}
+
+// Words the next robot write may carry: ROBOT_BATCH_MAX in one seal, or as
+// many as a plain batch frame the link takes in one write; 1 = no batching.
+int robot_batch_max(void) {
+  return transport_batch_max(security_level != SEC_PLAIN);
+}
+
+// Several words for the ble_route robot in one write (robot batch format,
+// see ROBOT_BATCH_MAGIC): one seal over [n][n words] when security is on,
+// otherwise ROBOT_BATCH_MAGIC | n | n words. A lone word goes out as usual.
+int robot_send_batch(int uart_fd, robot_bt_packet_t *packets, int n) {
+  if (n == 1) return robot_send_packet(uart_fd, &packets[0]);
+  if (n < 1 || n > ROBOT_BATCH_MAX) return -1;
+
+  int flags = TRANSPORT_BATCH | TRANSPORT_STREAM;        // Write-without-response only if every word may
+  for (int i = 0; i < n; i++) {
+    if (packets[i].ctrl.type != CONTROL_CMD && packets[i].ctrl.type != ARM_CMD) flags &= ~TRANSPORT_STREAM;
+    cmd_trace_send(&packets[i]);
+    rec_put(REC_WORD_TX, ble_route, packets[i].bytes, 8);
+  }
+
+  if (security_route()) return robot_send_sealed(packets, n, flags);
+  uint8_t frame[2 + ROBOT_BATCH_MAX * 8];
+  frame[0] = ROBOT_BATCH_MAGIC;
+  frame[1] = (uint8_t)n;
+  for (int i = 0; i < n; i++) memcpy(frame + 2 + i * 8, packets[i].bytes, 8);
+  int rc = transport_send_frame(frame, 2 + (size_t)n * 8, flags);
+  if (rc >= 0) robot_written(packets, n);
+  return rc;
+}
+
+// ------------------------- Handle Node binary frame -------------------------
+// Pre-packed command from a client that negotiated binary mode. No text
+// parsing: validate the header and the fields the bitfield width can't bound,
+// run the same GS-side hooks as the JSON path, then send.
+int handle_node_bin(int uart_fd, int uds_fd, const uint8_t *frame, uint32_t len) {
+  if (len != UDS_BIN_FRAME_LEN || frame[0] != UDS_BIN_MAGIC) {
+    uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"bad bin frame\"}");
     return -1;
   }
 
-  cJSON *type_item = cJSON_GetObjectItemCaseSensitive(root, "T");
-  if (!cJSON_IsString(type_item) || !type_item->valuestring) {
-    cJSON_Delete(root);
-    uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"missing type\"}");
+  robot_bt_packet_t packet;
+  memcpy(packet.bytes, frame + UDS_BIN_HDR_LEN, sizeof(packet.bytes));
+  if (packet.ctrl.type != frame[1]) {                  // Header type must match the word
+    uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"bin type mismatch\"}");
     return -1;
   }
 
-  const char *t = type_item->valuestring;
-  robot_bt_packet_t packet = {0}; // Initialize to clear all 64 bits (including "unused")
-  int send_to_robot = 1;
+  if (cmd_route(&packet) < 0) {
+    uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"unknown robot\"}");
+    return -1;
+  }
 
-  //printf("IM PARSING\r\n");
-  // CONTROL (C)
-  if (strcmp(t, "C") == 0) {
-    uint8_t f, b, l, r_move, speed, pl;
-    uint16_t id_tag = 0;
-
-    if (json_get_u8(root, "F",  &f,     0, 1)   ||
-        json_get_u8(root, "B",  &b,     0, 1)   ||
-        json_get_u8(root, "L",  &l,     0, 1)   ||
-        json_get_u8(root, "R",  &r_move,0, 1)   ||
-        json_get_u8(root, "S",  &speed, 0, 100) ||
-        json_get_u8(root, "PL", &pl,    0, 3) )  //||
-        //json_get_u8(root, "ID", &pl,    1, 2047)) 
-    {
-      uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"bad C fields\"}");
-      cJSON_Delete(root);
+  int send_to_robot = 1;
+  switch (packet.ctrl.type) {
+    case CONTROL_CMD:
+      if (packet.ctrl.speed > 100) goto bad_fields;
+      break;
+    case ARM_CMD:
+      if (packet.arm.speed > 100) goto bad_fields;
+      break;
+    case ARM_TARGET_CMD:
+      if (packet.armt.speed > 100) goto bad_fields;
+      break;
+    case TRAJ_CMD:                                     // Uploaded one word at a time; the RUN crc checks it
+      if (packet.trajc.op == TRAJ_OP_ARM && packet.traja.speed > 100) goto bad_fields;
+      break;
+    case System_CMD:
+      send_to_robot = sys_cmd(uart_fd, packet.sys);
+      break;
+    case Query_CMD:
+      send_to_robot = query_cmd(uart_fd, packet.query);
+      break;
+    default:
+      uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"unknown type\"}");
       return -1;
-    }
-    packet.ctrl.type  = CONTROL_CMD;
-    packet.ctrl.pl    = pl;
-    packet.ctrl.w     = f;
-    packet.ctrl.s     = b;
-    packet.ctrl.a     = l;
-    packet.ctrl.d     = r_move;
-    packet.ctrl.speed = speed;
-    //packet.ctrl.id    = id_tag;
   }
 
-  // ARM (A)
-  else if (strcmp(t, "A") == 0) {
-    uint8_t  up, down, left, right, in, out, reset, pl;
-    uint8_t  speed;
-    uint16_t id_tag;
-
-    printf("I Got An ARM CMD");
-
-    if (json_get_u8(root,  "U",  &up,    0, 1)    ||
-        json_get_u8(root,  "D",  &down,  0, 1)    ||
-        json_get_u8(root,  "L",  &left,  0, 1)    ||
-        json_get_u8(root,  "R",  &right, 0, 1)    ||
-        json_get_u8(root,  "In", &in,    0, 1)    ||
-        json_get_u8(root,  "O",  &out,   0, 1)    ||
-        json_get_u8(root,  "S",  &speed, 0, 100)  ||
-        json_get_u8(root,  "Re", &reset, 0, 1)    ||
-        json_get_u8(root,  "PL", &pl,    0, 3)    ||
-        json_get_u16(root, "ID", &id_tag, 1, 2047))
-    {
-        uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"bad A fields\"}");
-        cJSON_Delete(root);
-        return -1;
-    }
+  if (send_to_robot == 1) return tx_sched_submit(uart_fd, &packet);
+  return 0;
+
+bad_fields:
+  METRIC_INC(cmd_rejects);
+  uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"bad bin fields\"}");
+  return -1;
+}
 
-    printf("Packaging an arm cmd");
-
-    packet.arm.type  = ARM_CMD;
-    packet.arm.pl    = pl;
-    packet.arm.up    = up;
-    packet.arm.down  = down;
-    packet.arm.left  = left;
-    packet.arm.right = right;
-    packet.arm.in    = in;
-    packet.arm.out   = out;
-    packet.arm.speed = speed;
-    packet.arm.reset = reset;
-    packet.arm.id    = id_tag;
+// ------------------------- Command field tables -------------------------
+// One descriptor per JSON key: where its value lands in the 64-bit packet
+// (bit offset/width, see cmd_structure.h) and the accepted range. Packing
+// writes packet.raw directly, so the bitfield structs and these tables must
+// agree (little-endian, LSB-first bitfields as laid out by GCC).
+
+typedef struct {
+  const char *key;        // JSON member name
+  uint8_t     lo;         // First bit in the 64-bit word
+  uint8_t     width;      // Field width in bits
+  uint8_t     required;   // Missing -> reject the command
+  int64_t     minv;       // Inclusive range check; minv < 0 = two's complement field
+  int64_t     maxv;
+} cmd_field_t;
+
+typedef struct {
+  char               t;             // Single-character "T" value
+  command_type_t     type;          // Packet type written to bits 2-6
+  const cmd_field_t *fields;
+  uint8_t            nfields;
+  const char        *err_json;      // Reply on missing/out-of-range fields
+  int (*post)(int uart_fd, robot_bt_packet_t *packet); // GS-side hook, 1 = send to robot
+} cmd_desc_t;
+
+#define CMD_MAX_FIELDS 16
+
+static const cmd_field_t control_fields[] = {
+  { "F",  7,  1, 1, 0, 1   },                       // w
+  { "L",  8,  1, 1, 0, 1   },                       // a
+  { "B",  9,  1, 1, 0, 1   },                       // s
+  { "R",  10, 1, 1, 0, 1   },                       // d
+  { "S",  11, 7, 1, 0, 100 },                       // speed
+  { "PL", 0,  2, 1, 0, 3   },
+  { "ID", 18, 11, 0, 0, 2047 },                     // optional tag echoed in ACKs
+};
+
+static const cmd_field_t arm_fields[] = {
+  { "U",  7,  1, 1, 0, 1   },
+  { "D",  8,  1, 1, 0, 1   },
+  { "L",  9,  1, 1, 0, 1   },
+  { "R",  10, 1, 1, 0, 1   },
+  { "In", 11, 1, 1, 0, 1   },
+  { "O",  12, 1, 1, 0, 1   },
+  { "S",  13, 7, 1, 0, 100 },
+  { "Re", 20, 1, 1, 0, 1   },
+  { "PL", 0,  2, 1, 0, 3   },
+  { "ID", 21, 11, 1, 1, 2047 },
+};
+
+// Absolute arm target, 0.01 in per unit (ARMT_UNITS_PER_IN)
+static const cmd_field_t arm_target_fields[] = {
+  { "X",  25, 12, 1, -2048, 2047 },
+  { "Y",  37, 12, 1, -2048, 2047 },
+  { "Z",  49, 12, 1, -2048, 2047 },
+  { "S",  7,  7,  1, 0, 100 },
+  { "PL", 0,  2,  1, 0, 3   },
+  { "ID", 14, 11, 1, 1, 2047 },
+};
+
+static const cmd_field_t system_fields[] = {
+  { "instruction",          7,  4,  1, 0, 15 },
+  { "Authorization_Code",   11, 10, 1, 0, 1023 },
+  { "PL",                   0,  2,  1, 0, 3 },
+  { "ID",                   21, 11, 1, 0, 2047 },
+  { "instruction_specific", 32, 32, 1, 0, 0xFFFFFFFFu },
+};
+
+static const cmd_field_t query_fields[] = {
+  { "RI", 7,  4,  1, 0, 15 },
+  { "R",  22, 1,  1, 0, 1 },
+  { "PL", 0,  2,  1, 0, 3 },
+  { "ID", 11, 11, 1, 0, 2047 },
+};
+
+static int post_system(int uart_fd, robot_bt_packet_t *packet) { return sys_cmd(uart_fd, packet->sys); }
+static int post_query(int uart_fd, robot_bt_packet_t *packet)  { return query_cmd(uart_fd, packet->query); }
+
+#define FIELDS(tbl) tbl, (uint8_t)(sizeof(tbl) / sizeof(tbl[0]))
+
+static const cmd_desc_t cmd_table[] = {
+  { 'C', CONTROL_CMD, FIELDS(control_fields), "{\"type\":\"ERR\",\"msg\":\"bad C fields\"}", NULL },
+  { 'A', ARM_CMD,     FIELDS(arm_fields),     "{\"type\":\"ERR\",\"msg\":\"bad A fields\"}", NULL },
+  { 'G', ARM_TARGET_CMD, FIELDS(arm_target_fields), "{\"type\":\"ERR\",\"msg\":\"bad G fields\"}", NULL },
+  { 'S', System_CMD,  FIELDS(system_fields),  "{\"type\":\"ERR\",\"msg\":\"bad S fields\"}", post_system },
+  { 'Q', Query_CMD,   FIELDS(query_fields),   "{\"type\":\"ERR\",\"msg\":\"bad Q fields\"}", post_query },
+};
+
+static const cmd_desc_t *cmd_desc_lookup(const char *t, size_t len) {
+  if (!t || len != 1) return NULL;                // T is always one character
+  for (size_t i = 0; i < sizeof(cmd_table) / sizeof(cmd_table[0]); i++) {
+    if (cmd_table[i].t == t[0]) return &cmd_table[i];
   }
+  return NULL;
+}
 
-  // SYSTEM (S)
-  else if (strcmp(t, "S") == 0) {
-    uint8_t  pl, instr;
-    uint16_t id, ac;
-    uint32_t spec;
-    
-
-    if (json_get_u8(root, "instruction",   &instr, 0, 15)   ||
-        json_get_u16(root,"Authorization_Code",  &ac,    0, 1024) ||
-        json_get_u8(root, "PL",  &pl,    0, 3)    ||
-        json_get_u16(root,"ID",  &id,    0, 2047) ||
-        json_get_u32(root,"instruction_specific", &spec)) 
-    {
-      printf("I GOT AN ERROR WITH THE S INSTRUCTION\n");
-      uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"bad S fields\"}");
-      cJSON_Delete(root);
-      return -1;
-    }
-    printf("I GOT AN S INSTRUCTION\n");
+static inline void set_bits(uint64_t *w, int lo, int width, uint64_t v) {
+  uint64_t mask = (width == 64) ? ~0ULL : ((1ULL << width) - 1ULL);
+  *w = (*w & ~(mask << lo)) | ((v & mask) << lo);
+}
 
-    packet.sys.type         = System_CMD;
-    packet.sys.pl           = pl;
-    packet.sys.instruction  = instr;
-    packet.sys.ac           = ac;
-    packet.sys.id           = id;
-    packet.sys.specific     = spec;
+// Range check one member and pack it into packet->raw. Unknown keys are
+// ignored; the first occurrence of a key wins. 0 = ok, <0 = reject command.
+static int cmd_pack_field(const cmd_desc_t *d, const char *key, size_t klen, int is_num, double v,
+                          uint32_t *seen, robot_bt_packet_t *packet) {
+  for (uint8_t i = 0; i < d->nfields; i++) {
+    const cmd_field_t *f = &d->fields[i];
+    if (strncmp(key, f->key, klen) != 0 || f->key[klen] != '\0') continue;
+    if (*seen & (1u << i)) return 0;
+    if (!is_num) return -1;                              // Must be a number
+    if (v < (double)f->minv || v > (double)f->maxv) return -2; // Range check
+    set_bits(&packet->raw, f->lo, f->width, (uint64_t)(int64_t)v);
+    *seen |= 1u << i;
+    return 0;
+  }
+  return 0;
+}
 
-    send_to_robot = sys_cmd(uart_fd, packet.sys);
+static int cmd_check_required(const cmd_desc_t *d, uint32_t seen) {
+  for (uint8_t i = 0; i < d->nfields; i++) {
+    if (d->fields[i].required && !(seen & (1u << i))) return -1;
   }
+  return 0;
+}
+
+// Shared tail for both decoders: stamp the type, run the GS-side hook, send.
+static int cmd_dispatch_packet(int uart_fd, const cmd_desc_t *d, robot_bt_packet_t *packet) {
+  packet->ctrl.type = d->type;
+  if (cmd_route(packet) < 0) return -1;
 
-  // QUERY (Q)
-  else if (strcmp(t, "Q") == 0) {
-    uint8_t  pl, instr, report;
-    uint16_t id;
-
-    if (json_get_u8(root, "RI",    &instr,  0, 15)  ||
-        json_get_u8(root, "R",         &report, 0, 1)   ||
-        json_get_u8(root, "PL", &pl,     0, 3)   ||
-        json_get_u16(root,"ID",             &id,     0, 2047)) 
-    {
-      uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"bad Q fields\"}");
-      cJSON_Delete(root);
+  int send_to_robot = d->post ? d->post(uart_fd, packet) : 1;
+
+  //Put a connection check and send back ACK
+  if (send_to_robot == 1) return tx_sched_submit(uart_fd, packet);
+  return 0;
+}
+
+// ------------------------- Handle Node JSON -------------------------
+// Dispatch an already-parsed command tree and transmit the 64-bit word over UART.
+// The caller owns root and frees it; this lets the UDS path parse each frame once.
+int handle_node_cmd(int uart_fd, int uds_fd, const cJSON *root) {
+  cJSON *type_item = cJSON_GetObjectItemCaseSensitive(root, "T");
+  if (!cJSON_IsString(type_item) || !type_item->valuestring) {
+    uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"missing type\"}");
+    return -1;
+  }
+
+  const cmd_desc_t *d = cmd_desc_lookup(type_item->valuestring, strlen(type_item->valuestring));
+  if (!d) {
+    uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"unknown type\"}");
+    return -1;
+  }
+
+  // Single pass over the object's members, packing straight into packet.raw
+  robot_bt_packet_t packet = {0}; // Initialize to clear all 64 bits (including "unused")
+  uint32_t seen = 0;
+  for (const cJSON *it = root->child; it; it = it->next) {
+    if (!it->string) continue;
+    if (cmd_pack_field(d, it->string, strlen(it->string), cJSON_IsNumber(it), cJSON_IsNumber(it) ? it->valuedouble : 0,
+                       &seen, &packet) != 0) {
+      METRIC_INC(cmd_rejects);
+      uds_send_json(uds_fd, d->err_json);
       return -1;
     }
+  }
+  if (cmd_check_required(d, seen) != 0) {
+    METRIC_INC(cmd_rejects);
+    uds_send_json(uds_fd, d->err_json);
+    return -1;
+  }
 
-    packet.query.type        = Query_CMD;
-    packet.query.pl          = pl;
-    packet.query.instruction = instr;
-    packet.query.id          = id;
-    packet.query.r           = report; 
+  return cmd_dispatch_packet(uart_fd, d, &packet);
+}
 
-      
-    send_to_robot = query_cmd(uart_fd, packet.query);
+// Same dispatch, driven by the allocation-free scanner instead of a cJSON tree.
+// Returns CMD_SCAN_FALLBACK (nothing sent, no reply) when the frame is not a
+// flat command object with a known T, so the caller can take the cJSON path.
+int handle_node_scan(int uart_fd, int uds_fd, const char *json, uint32_t len) {
+  cmd_scan_kv_t kv[CMD_SCAN_MAX_KV];
+  int n = cmd_scan(json, len, kv, CMD_SCAN_MAX_KV);
+  if (n < 0) return CMD_SCAN_FALLBACK;
+
+  const cmd_desc_t *d = NULL;
+  for (int i = 0; i < n; i++) {
+    if (kv[i].klen == 1 && kv[i].key[0] == 'T') {       // First "T" wins, as in cJSON
+      if (kv[i].str) d = cmd_desc_lookup(kv[i].str, kv[i].slen);
+      break;
+    }
   }
-    
-  // ERROR HANDLING
-  else {
-      uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"unknown type\"}");
-      cJSON_Delete(root);
+  if (!d) return CMD_SCAN_FALLBACK;                      // Let cJSON path report it
+
+  robot_bt_packet_t packet = {0};
+  uint32_t seen = 0;
+  for (int i = 0; i < n; i++) {
+    if (cmd_pack_field(d, kv[i].key, kv[i].klen, kv[i].str == NULL, (double)kv[i].num,
+                       &seen, &packet) != 0) {
+      METRIC_INC(cmd_rejects);
+      uds_send_json(uds_fd, d->err_json);
+      return -1;
+    }
+  }
+  if (cmd_check_required(d, seen) != 0) {
+    METRIC_INC(cmd_rejects);
+    uds_send_json(uds_fd, d->err_json);
+    return -1;
+  }
+
+  return cmd_dispatch_packet(uart_fd, d, &packet);
+}
+
+// And once more off a tape: members are visited in order like the tree
+// path, but nested values are jumped over instead of built. Same
+// CMD_SCAN_FALLBACK contract as handle_node_scan()
+int handle_node_tape(int uart_fd, int uds_fd, const char *json, uint32_t len) {
+  cJSON_Tape tape;
+  cJSON_InitTape(&tape, cmd_tape_mem, CMD_TAPE_ENTRIES);
+  if (!cJSON_TapeIndex(&tape, json, len)) return CMD_SCAN_FALLBACK;
+
+  cJSON_TapeValue root = cJSON_TapeRoot(&tape);
+  char type[16];
+  if (!cJSON_TapeCopyString(cJSON_TapeGetObjectItemCaseSensitive(root, "T"), type, sizeof(type)))
+    return CMD_SCAN_FALLBACK;
+  const cmd_desc_t *d = cmd_desc_lookup(type, strlen(type));
+  if (!d) return CMD_SCAN_FALLBACK;
+
+  robot_bt_packet_t packet = {0};
+  uint32_t seen = 0;
+  for (cJSON_TapeValue m = cJSON_TapeChild(root); m.tape; m = cJSON_TapeNext(m)) {
+    char key[32];
+    if (!cJSON_TapeCopyName(m, key, sizeof(key))) return CMD_SCAN_FALLBACK;
+    int is_num = cJSON_TapeType(m) == cJSON_Number;
+    double v = is_num ? cJSON_TapeGetNumberValue(m) : 0;
+    if (is_num && isnan(v)) return CMD_SCAN_FALLBACK;    // Bad number: cJSON rejects the frame
+    if (cmd_pack_field(d, key, strlen(key), is_num, v, &seen, &packet) != 0) {
+      METRIC_INC(cmd_rejects);
+      uds_send_json(uds_fd, d->err_json);
       return -1;
+    }
+  }
+  if (cmd_check_required(d, seen) != 0) {
+    METRIC_INC(cmd_rejects);
+    uds_send_json(uds_fd, d->err_json);
+    return -1;
   }
 
-  // Cleanup JSON memory
-  cJSON_Delete(root);
+  return cmd_dispatch_packet(uart_fd, d, &packet);
+}
 
-  //Put a connection check and send back ACK
-  if (send_to_robot == 1){
-    if (security_level == 1) {
-      uint8_t ciphertext[TOTAL_SZ] = {0};
-      size_t out_len = 0;
+// A document of n bytes has at most n / 2 + 1 nodes, plus one number scratch
+// copy; with that much room an in-place parse can only fail on bad JSON
+_Static_assert(CMD_ARENA_BYTES >= (CMD_INSITU_MAX / 2 + 2) * sizeof(cJSON) + CMD_INSITU_MAX + 64,
+               "CMD_ARENA_BYTES too small for a CMD_INSITU_MAX document");
 
-      printf("Packet (8 bytes): ");
-      for (int i = 0; i < 8; i++) printf("%02X ", packet.bytes[i]);
-      printf("\n");
+// One document at a time: every parse resets the arena, so nodes cost a
+// pointer bump and the previous tree goes away in O(1). Short documents
+// are parsed in situ and copy no strings at all
+cJSON *cmd_json_parse(char *json, size_t len) {
+  if (!cmd_arena.buffer) cJSON_InitArena(&cmd_arena, cmd_arena_mem, sizeof(cmd_arena_mem));
+  cJSON_ResetArena(&cmd_arena);
 
-      if (encrypt_cmd(&packet, ciphertext, &out_len) != 0) return -1;
-      //printf("Ciphertext (%zu bytes): ", out_len);
-      //for (size_t i = 0; i < out_len; i++) printf("%02X ", ciphertext[i]);
-      //printf("\n");
+  if (len <= CMD_INSITU_MAX) return cJSON_ParseInSituWithArena(json, len, &cmd_arena);
 
-      return ble_send_pkt(uart_fd, ciphertext, out_len);
-    }
-    // TODO add priority Queue   
-    return ble_send_instruction(uart_fd, packet.bytes);
+  cJSON *root = cJSON_ParseWithArena(json, len, &cmd_arena);
+  if (!root) root = cJSON_ParseWithLength(json, len);  // Too big for the arena (or bad JSON)
+  return root;
+}
+
+void cmd_json_release(cJSON *root) {
+  const unsigned char *p = (const unsigned char *)root;
+  if (p >= cmd_arena.buffer && p < cmd_arena.buffer + cmd_arena.size) return;
+  cJSON_Delete(root);
+}
+
+// Parse incoming JSON from Node and transmit appropriate 64-bit word(s) over UART.
+int handle_node_json(int uart_fd, int uds_fd, char *json_str) {
+  cJSON *root = cmd_json_parse(json_str, strlen(json_str));
+  if (!root) {
+    uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"bad json\"}");
+    return -1;
   }
-  return 0;
+  int rc = handle_node_cmd(uart_fd, uds_fd, root);
+  cmd_json_release(root);                              // Arena trees are dropped by the next parse
+  return rc;
 }
 
 cJSON *robot_packet_to_json(robot_bt_packet_t pkt) {
@@ -326,11 +664,24 @@ cJSON *robot_packet_to_json(robot_bt_packet_t pkt) {
         // HEALTH REPORT (HR)
         // =========================
         case HEALTH_CMD: {
+            // Heartbeat: nothing moved past a deadband, repeat the last full
+            // report so clients always see complete HR objects
+            int have_health = robot_health_expand(&pkt);
+
             cJSON_AddStringToObject(root, "type", "HR");
+            cJSON_AddNumberToObject(root, "unchanged", pkt.health.unchanged);
+            if (!have_health) break;                        // Bridge restarted mid-link
             cJSON_AddNumberToObject(root, "battery", pkt.health.battery);
             cJSON_AddNumberToObject(root, "security", pkt.health.sec_en);
             cJSON_AddNumberToObject(root, "motor_enabled", pkt.health.motor_en);
             cJSON_AddNumberToObject(root, "arm_enabled", pkt.health.arm_en);
+            cJSON_AddNumberToObject(root, "tx_queue", pkt.health.tx_depth);
+            cJSON_AddNumberToObject(root, "tx_drops", pkt.health.tx_drops);
+            cJSON_AddNumberToObject(root, "stack_task", pkt.health.stack_task);
+            cJSON_AddNumberToObject(root, "stack_free", pkt.health.stack_free);
+            cJSON_AddNumberToObject(root, "traj", pkt.health.traj);
+            cJSON_AddNumberToObject(root, "traj_seg", pkt.health.traj_seg);
+            cJSON_AddNumberToObject(root, "credits", pkt.health.credits);
             break;
         }
 
@@ -391,6 +742,10 @@ cJSON *robot_packet_to_json(robot_bt_packet_t pkt) {
         case HPR_CMD: {
             cJSON_AddStringToObject(root, "type", "HPR");
             cJSON_AddNumberToObject(root, "alert", pkt.hpr.alert_type);
+            cJSON_AddNumberToObject(root, "cleared", pkt.hpr.cleared);
+            cJSON_AddNumberToObject(root, "value", pkt.hpr.value);
+            cJSON_AddNumberToObject(root, "limit", pkt.hpr.limit);
+            cJSON_AddNumberToObject(root, "seq", pkt.hpr.seq);
             break;
         }
 
@@ -405,4 +760,96 @@ cJSON *robot_packet_to_json(robot_bt_packet_t pkt) {
     }
 
     return root;
-}
\ No newline at end of file
+}
+
+// ------------------------- Robot report unpack -------------------------
+// Sealed reports from each robot pass its replay window (replay_window.h):
+// the robot's sequence restarts with its boot, and a reboot drops the link,
+// so the window is cleared whenever that robot's link comes up.
+static replay_window_t g_report_replay[BLE_LINKS_MAX];
+
+void robot_replay_reset(int robot) {
+  if (robot >= 0 && robot < BLE_LINKS_MAX) replay_reset(&g_report_replay[robot]);
+}
+
+// Window check, GCM open, then window update (a forged frame never moves it)
+static int robot_report_open(uint8_t mark, const uint8_t *frame, robot_bt_packet_t *words, int max) {
+  replay_window_t *w = &g_report_replay[ble_route];
+  uint64_t seq;
+  rec_put(REC_CIPHER_RX, ble_route, frame, TOTAL_SZ);
+  if (!replay_nonce_seq(frame, REPLAY_DIR_ROBOT, &seq) || !replay_check(w, seq)) {
+    METRIC_INC(replay_drops);
+    return -5;
+  }
+  security_route();                                     // Open with the suite this robot negotiated
+  int n = mark == CIPHER_SOF1_BATCH ? decrypt_report_batch(frame, words, max)
+                                    : (decrypt_cmd(frame, &words[0]) == 0 ? 1 : -4);
+  if (n >= 0) replay_accept(w, seq);
+  return n;
+}
+
+// Split one robot notification into report words, whatever its shape (see
+// ROBOT_BATCH_MAGIC). Returns the word count, or < 0 if the notification is
+// not a report (or fails authentication, or is a replay).
+int robot_report_unpack(const uint8_t *buf, size_t len, robot_bt_packet_t *words, int max) {
+  if (!buf || !words || max < 1) return -1;
+
+  if (len == 9 && buf[0] == ROBOT_WORD_TAG) {
+    memcpy(words[0].bytes, buf + 1, 8);
+    return 1;
+  }
+
+  if (len >= 2 && buf[0] == ROBOT_BATCH_MAGIC) {
+    int n = buf[1];
+    if (n > ROBOT_BATCH_MAX || n > max || len != 2 + (size_t)n * 8) return -2;
+    for (int i = 0; i < n; i++) memcpy(words[i].bytes, buf + 2 + i * 8, 8);
+    return n;
+  }
+
+  if (len == CIPHER_FRAME_SZ && buf[0] == CIPHER_SOF0 &&
+      buf[CIPHER_FRAME_SZ - 2] == CIPHER_EOF0 && buf[CIPHER_FRAME_SZ - 1] == CIPHER_EOF1) {
+    if (buf[1] == CIPHER_SOF1_BATCH || buf[1] == CIPHER_SOF1) return robot_report_open(buf[1], buf + 2, words, max);
+    return -2;
+  }
+
+  if (len == 16 && hexc_decode((const char *)buf, 16, words[0].bytes) == 8) return 1;
+  return -2;
+}
+
+int robot_ack_expand(const robot_bt_packet_t *w, robot_bt_packet_t out[ACK_RANGE_BITS + 1]) {
+  if (w->ack.type != ACK_CMD || w->ack.result_code != RESULT_ACK_RANGE) {
+    out[0] = *w;
+    return 1;
+  }
+  uint16_t ids[ACK_RANGE_BITS + 1];
+  int n = ack_range_ids(w->raw, ids);
+  METRIC_OBSERVE(robot_ack_range_ids, (uint64_t)n);
+  for (int i = 0; i < n; i++) {
+    cmd_ack_t a = { .pl = w->ack.pl, .type = ACK_CMD, .id = ids[i], .result_code = RESULT_SUCCESS };
+    out[i].raw = cmd_ack_pack(&a);
+  }
+  return n;
+}
+
+// Length of the binary notification at the front of buf: > 0 when known,
+// 0 when more bytes are needed, -1 if buf does not start with a frame tag.
+int robot_notify_frame_len(const uint8_t *buf, size_t len) {
+  if (len == 0) return 0;
+  switch (buf[0]) {
+    case ROBOT_WORD_TAG:
+      return 9;
+    case ROBOT_BATCH_MAGIC:
+      if (len < 2) return 0;
+      if (buf[1] == 0 || buf[1] > ROBOT_BATCH_MAX) return -1;
+      return 2 + buf[1] * 8;
+    case CIPHER_SOF0:
+      if (len < 2) return 0;
+      if (buf[1] != CIPHER_SOF1 && buf[1] != CIPHER_SOF1_BATCH) return -1;
+      return CIPHER_FRAME_SZ;
+    case LINK_ECHO_TAG:                               // link_bench.h: an echoed benchmark frame
+      if (len < 2) return 0;
+      return buf[1] < LINK_ECHO_HDR ? -1 : buf[1];
+    default:
+      return -1;
+  }
+}
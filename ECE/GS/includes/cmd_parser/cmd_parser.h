@@ -6,15 +6,84 @@
 #include "../cmd_structure.h"
 #include "../includes/ble/pmod_esp32.h"
 #include "../hardware_crypto/software_cryptography.h"
+#include "cmd_scan.h"
 //#include "../json_uds/json_uds.h"
 
-extern volatile int security_level;
+// Binary UDS command frame (payload after the 4-byte length), enabled per
+// client by sending {"T":"MODE","proto":"bin1"}:
+//   [0]=UDS_BIN_MAGIC [1]=command_type_t [2..3]=seq (big-endian, reserved)
+//   [4..11]=robot_bt_packet_t bytes exactly as sent to the robot
+#define UDS_BIN_MAGIC     0xB1
+#define UDS_BIN_HDR_LEN   4
+#define UDS_BIN_FRAME_LEN (UDS_BIN_HDR_LEN + 8)
+#define UDS_BIN_PROTO     "bin1"
+
+// Binary ciphertext frame (same negotiation): [0]=UDS_BIN_CIPHER_MAGIC
+// [1..156]=IV || CT || tag, instead of the 312-char hex string
+#define UDS_BIN_CIPHER_MAGIC 0xB2
+#define UDS_BIN_CIPHER_LEN   (1 + TOTAL_SZ)
+
+// Robot -> GS report notifications. One word arrives as 16 hex chars (text
+// notify mode), [0]=ROBOT_WORD_TAG [1..8]=packet bytes (binary notify mode)
+// or a 0x0A 0xD0 cipher frame; a batch of reports arrives as
+//   plain:  [0]=ROBOT_BATCH_MAGIC [1]=n [2..]=n x 8 raw packet bytes
+//   secure: 0x0A 0xD1 cipher frame whose plaintext is [n][n x 8 bytes]
+// Every binary shape starts with its tag, so robot_notify_frame_len() can
+// split the unframed stream that BLE SPP passthrough delivers. Commands to
+// the robot batch the same way (robot_send_batch; 0x0A 0xD1 when sealed,
+// or 0x0A 0xD2 / 0xD3 compact seals, compact_seal.h).
+#define ROBOT_WORD_TAG    0xB6
+#define ROBOT_BATCH_MAGIC 0xB7
+#define ROBOT_BATCH_MAX   15              // (CT_SZ - 1) / 8
+#define ROBOT_NOTIFY_MAX  CIPHER_FRAME_SZ // Longest binary notification
+#define ROBOT_SEAL_MAX    TOTAL_SZ        // Longest robot_seal() frame (compact ones are shorter)
+
+// Command documents are parsed into one static arena (event loop thread
+// only); a document too big for it falls back to a heap tree. Up to
+// CMD_INSITU_MAX bytes the strings are also unescaped in place, so the
+// input buffer is rewritten and the tree points into it
+#define CMD_ARENA_BYTES   8192
+#define CMD_INSITU_MAX    192             // Covers a decrypted CT_SZ document
+
+// Longer documents (batch/replay wrappers around a command) go through a
+// cJSON tape first: T and the top-level fields are decoded, nested values
+// are skipped without being parsed (or validated). Documents with more
+// structural characters than this take the tree path
+#define CMD_TAPE_ENTRIES  256
+
+// Security is per robot; security_level is the routed robot's (ble_route)
+extern volatile int security_levels[BLE_LINKS_MAX];
+#define security_level (security_levels[ble_route])
 extern volatile int connection_status;
 extern volatile int authorization_code;
 
+int security_any(void);                               // 1 = some robot is in secure mode
+int security_route(void);                             // 1 = routed robot is sealed; selects its cipher suite
+int cmd_route(const robot_bt_packet_t *packet);        // Select the robot the id addresses
 int sys_cmd(int uart_fd, system_format_t sys_inst);
 int query_cmd(int uart_fd, query_format_t query_inst);
 int handle_encrypted_data(int uart_fd, int uds_fd, const char *encrypt_str);
-int handle_node_json(int uart_fd, int uds_fd, const char *json_str);
+int handle_encrypted_bin(int uart_fd, int uds_fd, const uint8_t *frame, uint32_t len);
+int node_cipher_open(const uint8_t encrypted_bytes[TOTAL_SZ], char *json_out);   // json_out[CT_SZ + 1]
+int node_cipher_dispatch(int uart_fd, int uds_fd, char *json_out, int len);
+int robot_send_packet(int uart_fd, robot_bt_packet_t *packet);
+int robot_send_batch(int uart_fd, robot_bt_packet_t *packets, int n);
+int robot_batch_max(void);
+int robot_seal_set(int compact);                      // 1 = compact seals in use
+int robot_seal(const robot_bt_packet_t *packets, int n, uint8_t *frame, size_t *len, int *flags);
+int robot_seal_send(const robot_bt_packet_t *packets, int n, const uint8_t *frame, size_t len, int flags);
+int handle_node_bin(int uart_fd, int uds_fd, const uint8_t *frame, uint32_t len);
+int handle_node_cmd(int uart_fd, int uds_fd, const cJSON *root);
+int handle_node_scan(int uart_fd, int uds_fd, const char *json, uint32_t len);
+int handle_node_tape(int uart_fd, int uds_fd, const char *json, uint32_t len);
+int handle_node_json(int uart_fd, int uds_fd, char *json_str);
+cJSON *cmd_json_parse(char *json, size_t len);         // Replaces the previous arena tree
+void cmd_json_release(cJSON *root);                    // Frees heap fallbacks only
+int robot_report_unpack(const uint8_t *buf, size_t len, robot_bt_packet_t *words, int max);
+// A RESULT_ACK_RANGE word (ACK_MODE 1) as the per-command ACKs it stands
+// for, oldest first: RESULT_SUCCESS, NO_INFO. Any other word is copied.
+int robot_ack_expand(const robot_bt_packet_t *w, robot_bt_packet_t out[ACK_RANGE_BITS + 1]);
+void robot_replay_reset(int robot);                   // Link came up: the robot may have rebooted
+int robot_notify_frame_len(const uint8_t *buf, size_t len);
 
 #endif
@@ -0,0 +1,84 @@
+#include "cmd_scan.h"
+
+// ------------------------- Scanner helpers -------------------------
+
+static const char *skip_ws(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+  return p;
+}
+
+// Escape-free string body; p points just past the opening quote.
+static const char *scan_str(const char *p, const char *end, const char **out, size_t *out_len) {
+  const char *s = p;
+  while (p < end && *p != '"') {
+    if (*p == '\\' || (unsigned char)*p < 0x20) return NULL; // Leave escapes to cJSON
+    p++;
+  }
+  if (p >= end) return NULL;
+  *out     = s;
+  *out_len = (size_t)(p - s);
+  return p + 1;
+}
+
+// Plain integer: -?[0-9]{1,10}. Fractions/exponents are left to cJSON.
+static const char *scan_int(const char *p, const char *end, int64_t *out) {
+  int neg = 0, digits = 0;
+  int64_t v = 0;
+
+  if (p < end && *p == '-') { neg = 1; p++; }
+  while (p < end && *p >= '0' && *p <= '9') {
+    if (++digits > 10) return NULL;
+    v = v * 10 + (*p - '0');
+    p++;
+  }
+  if (digits == 0) return NULL;
+  if (p < end && (*p == '.' || *p == 'e' || *p == 'E')) return NULL;
+  *out = neg ? -v : v;
+  return p;
+}
+
+// ------------------------- Public API -------------------------
+
+int cmd_scan(const char *json, size_t len, cmd_scan_kv_t *kv, int max_kv) {
+  const char *p = json, *end = json + len;
+  int n = 0;
+
+  p = skip_ws(p, end);
+  if (p >= end || *p != '{') return -1;
+  p = skip_ws(p + 1, end);
+  if (p < end && *p == '}') { p++; goto done; }           // {}
+
+  for (;;) {
+    if (n >= max_kv) return -1;
+    cmd_scan_kv_t *e = &kv[n];
+
+    if (p >= end || *p != '"') return -1;
+    if (!(p = scan_str(p + 1, end, &e->key, &e->klen))) return -1;
+
+    p = skip_ws(p, end);
+    if (p >= end || *p != ':') return -1;
+    p = skip_ws(p + 1, end);
+    if (p >= end) return -1;
+
+    if (*p == '"') {
+      if (!(p = scan_str(p + 1, end, &e->str, &e->slen))) return -1;
+      e->num = 0;
+    } else {
+      e->str  = NULL;
+      e->slen = 0;
+      if (!(p = scan_int(p, end, &e->num))) return -1;
+    }
+    n++;
+
+    p = skip_ws(p, end);
+    if (p >= end) return -1;
+    if (*p == ',') { p = skip_ws(p + 1, end); continue; }
+    if (*p == '}') { p++; break; }
+    return -1;
+  }
+
+done:
+  p = skip_ws(p, end);
+  while (p < end && *p == '\0') p++;                      // Tolerate a trailing NUL
+  return (p == end) ? n : -1;
+}
@@ -0,0 +1,29 @@
+#ifndef CMD_SCAN_H
+#define CMD_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ------------------------- Flat command scanner -------------------------
+// Allocation-free, single-pass tokenizer for the UI's command objects:
+// one flat JSON object whose members are integers or escape-free strings,
+// e.g. {"T":"C","F":1,"B":0,"L":0,"R":0,"S":40,"PL":0}. Keys and strings
+// point into the caller's buffer (not NUL-terminated). Anything outside that
+// shape (nesting, arrays, escapes, fractions, true/false/null) makes
+// cmd_scan() return -1 so the caller can hand the frame to cJSON instead.
+
+#define CMD_SCAN_MAX_KV    16             // More members than this -> fallback
+#define CMD_SCAN_FALLBACK  1              // handle_node_scan(): not handled, use cJSON
+
+typedef struct {
+  const char *key;                        // Member name (not NUL-terminated)
+  size_t      klen;
+  const char *str;                        // String value, NULL for numbers
+  size_t      slen;
+  int64_t     num;                        // Integer value when str == NULL
+} cmd_scan_kv_t;
+
+// Returns the member count, or -1 if the frame is not a flat command object.
+int cmd_scan(const char *json, size_t len, cmd_scan_kv_t *kv, int max_kv);
+
+#endif
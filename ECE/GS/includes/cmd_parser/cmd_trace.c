@@ -0,0 +1,142 @@
+#include "cmd_trace.h"
+#include "../json_uds/json_uds.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define CMD_TRACE_MASK (CMD_TRACE_SLOTS - 1)
+
+typedef struct {
+  uint16_t id;                                             // 0 = free
+  uint8_t  type;
+  int32_t  seq;                                            // UDS frame seq, -1 = none
+  uint64_t t_frame, t_parsed, t_send, t_sealed, t_written;
+} cmd_trace_rec_t;
+
+static int             g_enabled = 0;
+static uint16_t        g_next_id = 0;
+static int32_t         g_frame_seq = -1;
+static uint64_t        g_frame_us = 0;                     // Dispatch time of the current frame
+static cmd_trace_rec_t g_recs[CMD_TRACE_SLOTS];
+
+static uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+void cmd_trace_init(int enabled) {
+  g_enabled = enabled;
+  g_next_id = 0;
+  memset(g_recs, 0, sizeof(g_recs));
+}
+
+int cmd_trace_enabled(void) {
+  return g_enabled;
+}
+
+void cmd_trace_frame(int seq) {
+  if (!g_enabled) return;
+  g_frame_seq = seq;
+  g_frame_us = now_us();
+}
+
+// id field of the command word; -1 for types the robot does not ACK by id
+int cmd_word_id(const robot_bt_packet_t *p) {
+  switch (p->ctrl.type) {
+    case CONTROL_CMD: return p->ctrl.id;
+    case ARM_CMD:     return p->arm.id;
+    case ARM_TARGET_CMD: return p->armt.id;
+    case TRAJ_CMD:    return p->trajc.op >= TRAJ_OP_RUN ? (int)p->trajc.id : -1;   // Segments carry none
+    case System_CMD:  return p->sys.id;
+    case Query_CMD:   return p->query.id;
+    default:          return -1;
+  }
+}
+
+static cmd_trace_rec_t *rec_of(const robot_bt_packet_t *p) {
+  int id = cmd_word_id(p);
+  if (id <= 0) return NULL;
+  cmd_trace_rec_t *r = &g_recs[id & CMD_TRACE_MASK];
+  return r->id == id ? r : NULL;
+}
+
+void cmd_trace_tag(robot_bt_packet_t *packet) {
+  if (!g_enabled || cmd_word_id(packet) < 0) return;
+
+  g_next_id = g_next_id % CMD_TRACE_ID_MAX + 1;            // 1..CMD_TRACE_ID_MAX, 0 = robot error ACKs
+  uint32_t id = ((uint32_t)cmd_word_id(packet) & ~(uint32_t)CMD_TRACE_ID_MAX) | g_next_id;
+  switch (packet->ctrl.type) {
+    case CONTROL_CMD: packet->ctrl.id  = id; break;
+    case ARM_CMD:     packet->arm.id   = id; break;
+    case ARM_TARGET_CMD: packet->armt.id = id; break;
+    case TRAJ_CMD:    packet->trajc.id = id; break;
+    case System_CMD:  packet->sys.id   = id; break;
+    case Query_CMD:   packet->query.id = id; break;
+  }
+
+  cmd_trace_rec_t *r = &g_recs[id & CMD_TRACE_MASK];       // Overwrites a record never ACKed
+  memset(r, 0, sizeof(*r));
+  r->id = (uint16_t)id;
+  r->type = packet->ctrl.type;
+  r->seq = g_frame_seq;
+  r->t_parsed = now_us();
+  r->t_frame = g_frame_us ? g_frame_us : r->t_parsed;
+  g_frame_us = 0;                                          // One frame, one stamp
+  g_frame_seq = -1;
+}
+
+void cmd_trace_send(const robot_bt_packet_t *packet) {
+  cmd_trace_rec_t *r = g_enabled ? rec_of(packet) : NULL;
+  if (r) r->t_send = now_us();
+}
+
+void cmd_trace_sealed(const robot_bt_packet_t *packet) {
+  cmd_trace_rec_t *r = g_enabled ? rec_of(packet) : NULL;
+  if (r) r->t_sealed = now_us();
+}
+
+void cmd_trace_written(const robot_bt_packet_t *packet) {
+  cmd_trace_rec_t *r = g_enabled ? rec_of(packet) : NULL;
+  if (r) r->t_written = now_us();
+}
+
+static unsigned long long span(uint64_t from, uint64_t to) {
+  return (from && to >= from) ? (unsigned long long)(to - from) : 0;
+}
+
+void cmd_trace_ack(const robot_bt_packet_t *ack) {
+  if (!g_enabled || ack->ctrl.type != ACK_CMD || ack->ack.id == 0) return;
+  cmd_trace_rec_t *r = &g_recs[ack->ack.id & CMD_TRACE_MASK];
+  if (r->id != ack->ack.id || !r->t_written) return;       // Not ours, or coalesced away
+
+  uint64_t t_ack = now_us();
+  uint64_t t_before_write = r->t_sealed ? r->t_sealed : r->t_send;
+  char js[320];
+  int n = snprintf(js, sizeof(js),
+                   "{\"type\":\"TRACE\",\"id\":%u,\"seq\":%d,\"cmd\":%u,\"result\":%u,"
+                   "\"parse_us\":%llu,\"queue_us\":%llu,\"seal_us\":%llu,\"at_us\":%llu,\"rtt_us\":%llu",
+                   (unsigned)r->id, (int)r->seq, (unsigned)r->type, (unsigned)ack->ack.result_code,
+                   span(r->t_frame, r->t_parsed), span(r->t_parsed, r->t_send),
+                   span(r->t_send, r->t_sealed), span(t_before_write, r->t_written),
+                   span(r->t_written, t_ack));
+  if (n < 0 || (size_t)n >= sizeof(js)) return;
+
+  uint64_t info = ack->ack.instruction_specific;
+  if (info & CMD_TRACE_LAT_MARK) {
+    const uint64_t m = ((uint64_t)1 << CMD_TRACE_LAT_BITS) - 1;
+    int k = snprintf(js + n, sizeof(js) - (size_t)n,
+                     ",\"robot\":{\"rx_dec_us\":%llu,\"dec_exec_us\":%llu,\"exec_ack_us\":%llu}",
+                     (unsigned long long)((info & m) * CMD_TRACE_LAT_UNIT_US),
+                     (unsigned long long)(((info >> CMD_TRACE_LAT_BITS) & m) * CMD_TRACE_LAT_UNIT_US),
+                     (unsigned long long)(((info >> (2 * CMD_TRACE_LAT_BITS)) & m) * CMD_TRACE_LAT_UNIT_US));
+    if (k < 0 || (size_t)k >= sizeof(js) - (size_t)n) return;
+    n += k;
+  }
+  if ((size_t)n + 2 > sizeof(js)) return;
+  js[n++] = '}';
+  js[n] = '\0';
+
+  r->id = 0;
+  uds_tx_broadcast(js, UDS_TX_TELEM, 0, UDS_TOPIC_TRACE, UDS_ROBOT_ANY);
+}
@@ -0,0 +1,44 @@
+#ifndef CMD_TRACE_H
+#define CMD_TRACE_H
+
+#include <stdint.h>
+#include "../cmd_structure.h"
+
+// ------------------------- Command latency trace -------------------------
+// Off unless GS_TRACE=1. When on, every command word leaving the bridge gets
+// a rolling tag (1..CMD_TRACE_ID_MAX) in its id field, keeping the robot
+// select bits above it (ROBOT_ID_SHIFT), and the bridge stamps
+// a monotonic time at each GS stage:
+//   frame   UDS frame dispatched                (cmd_trace_frame)
+//   parsed  word packed, handed to tx_sched     (tx_sched_submit)
+//   send    picked by tx_sched                  (robot_send_packet)
+//   sealed  GCM done (secure mode only)
+//   written AT/stream write issued to the ESP32
+//   ack     robot ACK with the same id arrived
+// When the ACK comes back the record is broadcast to UDS clients:
+//   {"type":"TRACE","id":N,"seq":S,"cmd":T,"parse_us":..,"queue_us":..,
+//    "seal_us":..,"at_us":..,"rtt_us":..[,"robot":{"rx_dec_us":..,
+//    "dec_exec_us":..,"exec_ack_us":..}]}
+// "robot" is present when the firmware was built with TRACE_LAT=1 and
+// packed its own stage times into the ACK (CMD_TRACE_LAT_* below).
+
+#define CMD_TRACE_SLOTS   256             // In-flight records, power of two
+#define CMD_TRACE_ID_MAX  511             // Tag bits of the id; the top two pick the robot
+
+// Robot-side stamps in ack.instruction_specific (TRACE_LAT firmware):
+// bit 40 marks them, three 13-bit stage times in CMD_TRACE_LAT_UNIT_US
+#define CMD_TRACE_LAT_MARK    ((uint64_t)1 << 40)
+#define CMD_TRACE_LAT_BITS    13
+#define CMD_TRACE_LAT_UNIT_US 20
+
+int  cmd_word_id(const robot_bt_packet_t *p);            // id field, -1 for types without one
+void cmd_trace_init(int enabled);
+int  cmd_trace_enabled(void);
+void cmd_trace_frame(int seq);                             // seq < 0: frame carries none
+void cmd_trace_tag(robot_bt_packet_t *packet);             // Assigns the id
+void cmd_trace_send(const robot_bt_packet_t *packet);
+void cmd_trace_sealed(const robot_bt_packet_t *packet);
+void cmd_trace_written(const robot_bt_packet_t *packet);
+void cmd_trace_ack(const robot_bt_packet_t *ack);          // Emits the finished record
+
+#endif
@@ -0,0 +1,184 @@
+#include "crypto_stage.h"
+#include "cmd_parser.h"
+#include "../hardware_crypto/crypto_provider.h"
+#include "../event_loop/rt_tune.h"
+#include "../json_uds/json_uds.h"
+#include "../log/gs_log.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define CS_MASK (CRYPTO_STAGE_SLOTS - 1)
+
+#if (CRYPTO_STAGE_SLOTS & CS_MASK) != 0
+#error "CRYPTO_STAGE_SLOTS must be a power of two"
+#endif
+
+enum { CS_SEAL, CS_OPEN };
+
+typedef struct {
+  uint8_t  kind, robot, suite, n;
+  int      flags;                                          // Seal: transport flags
+  int      uart_fd, uds_fd;                                // Open: where the command came from
+  int      rc;                                             // Thread's result
+  size_t   len;
+  robot_bt_packet_t words[ROBOT_BATCH_MAX];
+  uint8_t  buf[ROBOT_SEAL_MAX > CT_SZ + 1 ? ROBOT_SEAL_MAX : CT_SZ + 1];  // Seal: frame, open: cipher in, JSON out
+} cs_slot_t;
+
+static cs_slot_t        g_slot[CRYPTO_STAGE_SLOTS];
+static _Alignas(64) _Atomic uint32_t g_post;               // Loop-owned
+static _Alignas(64) _Atomic uint32_t g_done;               // Thread-owned
+static _Alignas(64) uint32_t g_head;                       // Loop-only
+static _Atomic int      g_stop;
+static int              g_on = 0;
+static int              g_job_efd = -1, g_done_efd = -1;
+static pthread_t        g_thread;
+static uint8_t          g_busy[BLE_LINKS_MAX];             // Loop-only
+
+static void run(cs_slot_t *s) {
+  if (s->kind == CS_SEAL) {
+    gs_crypto_suite(s->suite);
+    s->rc = robot_seal(s->words, s->n, s->buf, &s->len, &s->flags);
+  } else {
+    uint8_t in[TOTAL_SZ];
+    memcpy(in, s->buf, sizeof(in));
+    memset(s->buf, 0, CT_SZ + 1);
+    s->rc = node_cipher_open(in, (char *)s->buf);
+  }
+}
+
+static void *stage_main(void *arg) {
+  (void)arg;
+  rt_thread(RT_CRYPTO);
+  uint32_t done = atomic_load_explicit(&g_done, memory_order_relaxed);
+  while (!atomic_load_explicit(&g_stop, memory_order_relaxed)) {
+    uint64_t v;
+    if (read(g_job_efd, &v, sizeof(v)) < 0 && errno != EINTR) break;
+    uint32_t post;
+    int ran = 0;
+    while (done != (post = atomic_load_explicit(&g_post, memory_order_acquire))) {
+      for (; done != post; done++, ran++) {
+        run(&g_slot[done & CS_MASK]);
+        atomic_store_explicit(&g_done, done + 1, memory_order_release);
+      }
+    }
+    uint64_t one = 1;
+    if (ran) (void)!write(g_done_efd, &one, sizeof(one));
+  }
+  return NULL;
+}
+
+int crypto_stage_start(void) {
+  const char *on = getenv("GS_CRYPTO_THREAD");
+  if (!(on && strcmp(on, "1") == 0)) return -1;
+
+  g_job_efd = eventfd(0, EFD_CLOEXEC);
+  g_done_efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (g_job_efd < 0 || g_done_efd < 0) goto fail;
+  atomic_store(&g_post, 0);
+  atomic_store(&g_done, 0);
+  atomic_store(&g_stop, 0);
+  g_head = 0;
+  memset(g_busy, 0, sizeof(g_busy));
+  if (pthread_create(&g_thread, NULL, stage_main, NULL) != 0) goto fail;
+  g_on = 1;
+  LOG_INFO("Crypto stage: seals and Node cipher frames on their own thread");
+  return g_done_efd;
+
+fail:
+  LOG_WARN("Crypto stage could not start, sealing stays on the event loop");
+  if (g_job_efd >= 0) close(g_job_efd);
+  if (g_done_efd >= 0) close(g_done_efd);
+  g_job_efd = g_done_efd = -1;
+  return -1;
+}
+
+void crypto_stage_stop(void) {
+  if (!g_on) return;
+  g_on = 0;
+  atomic_store(&g_stop, 1);
+  uint64_t one = 1;
+  (void)!write(g_job_efd, &one, sizeof(one));
+  pthread_join(g_thread, NULL);
+  close(g_job_efd);
+  close(g_done_efd);
+  g_job_efd = g_done_efd = -1;
+}
+
+int crypto_stage_active(void) {
+  return g_on;
+}
+
+int crypto_stage_busy(int robot) {
+  return g_on && robot >= 0 && robot < BLE_LINKS_MAX && g_busy[robot];
+}
+
+uint32_t crypto_stage_depth(void) {
+  return g_on ? atomic_load_explicit(&g_post, memory_order_relaxed) - g_head : 0;
+}
+
+static cs_slot_t *claim(void) {
+  uint32_t post = atomic_load_explicit(&g_post, memory_order_relaxed);
+  return post - g_head < CRYPTO_STAGE_SLOTS ? &g_slot[post & CS_MASK] : NULL;
+}
+
+static void publish(void) {
+  atomic_store_explicit(&g_post, atomic_load_explicit(&g_post, memory_order_relaxed) + 1, memory_order_release);
+  uint64_t one = 1;
+  (void)!write(g_job_efd, &one, sizeof(one));
+}
+
+int crypto_stage_seal(const robot_bt_packet_t *packets, int n, int flags) {
+  cs_slot_t *s = claim();
+  if (!s || n < 1 || n > ROBOT_BATCH_MAX) return -1;
+  s->kind = CS_SEAL;
+  s->robot = (uint8_t)ble_route;
+  s->suite = security_level == SEC_CHACHA20_POLY1305 ? GS_SUITE_CHACHA20_POLY1305 : GS_SUITE_AES_GCM;
+  s->n = (uint8_t)n;
+  s->flags = flags;
+  memcpy(s->words, packets, (size_t)n * sizeof(*packets));
+  g_busy[ble_route]++;
+  publish();
+  return 0;
+}
+
+int crypto_stage_open(int uart_fd, int uds_fd, const uint8_t encrypted[TOTAL_SZ]) {
+  cs_slot_t *s = claim();
+  if (!s) {
+    LOG_WARN("Crypto stage full, Node cipher frame dropped");
+    uds_send_json(uds_fd, "{\"type\":\"ERR\",\"msg\":\"crypto stage full\"}");
+    return -5;
+  }
+  s->kind = CS_OPEN;
+  s->uart_fd = uart_fd;
+  s->uds_fd = uds_fd;
+  memcpy(s->buf, encrypted, TOTAL_SZ);
+  publish();
+  return 0;
+}
+
+void crypto_stage_drain(void) {
+  uint64_t v;
+  while (read(g_done_efd, &v, sizeof(v)) > 0) {}           // Reset eventfd counter
+
+  uint32_t done = atomic_load_explicit(&g_done, memory_order_acquire);
+  int route = ble_route;
+  for (; g_head != done; g_head++) {
+    cs_slot_t *s = &g_slot[g_head & CS_MASK];
+    if (s->kind == CS_OPEN) {
+      node_cipher_dispatch(s->uart_fd, s->uds_fd, (char *)s->buf, s->rc);
+      continue;
+    }
+    ble_route = s->robot;
+    g_busy[s->robot]--;
+    if (s->rc != 0 || robot_seal_send(s->words, s->n, s->buf, s->len, s->flags) < 0)
+      LOG_WARN("TX: robot %u type %u word%s not sent", (unsigned)s->robot,
+               (unsigned)s->words[0].ctrl.type, s->n > 1 ? "s" : "");
+  }
+  ble_route = route;
+}
@@ -0,0 +1,49 @@
+#ifndef CRYPTO_STAGE_H
+#define CRYPTO_STAGE_H
+
+#include <stdint.h>
+#include "../cmd_structure.h"
+#include "../hardware_crypto/software_cryptography.h"
+
+// ------------------------- Crypto stage -------------------------
+// GS_CRYPTO_THREAD=1 moves the AEAD work that arrives on the event loop to
+// a thread of its own, so a slow AF_ALG / CSU call no longer holds up UDS
+// clients, AT replies and ACKs behind it:
+//   seal   robot_send_packet / robot_send_batch words (robot_seal())
+//   open   Node cipher frames (node_cipher_open())
+// Sealed robot reports are still opened on the loop; the provider calls
+// take turns (gs_crypto_encrypt / gs_crypto_decrypt).
+//
+// Jobs live in one ring of CRYPTO_STAGE_SLOTS preallocated slots with
+// three free-running counters, each written by one side only:
+//   post  loop: slot filled      -> thread (eventfd wake)
+//   done  thread: sealed/opened  -> loop (eventfd in the epoll set)
+//   head  loop: result consumed
+// so it is an SPSC pipeline both ways with no locks. Results are consumed
+// in order: frames reach the modem in seal (nonce) order and Node commands
+// run in arrival order. The loop then writes the frame and runs the write
+// hooks (trace, recorder, ack_track / clock_sync) as an inline seal would.
+//
+// While a robot has a word in the stage its link reads as busy
+// (crypto_stage_busy), so tx_sched keeps coalescing instead of queueing
+// words here. A full ring fails the send (tx_sched logs it) or answers the
+// Node frame with an ERR.
+//
+// The thread is pinned with GS_CPU_CRYPTO (rt_tune.h). METRICS gauge:
+// crypto_stage_depth (posted, result not yet consumed).
+
+#define CRYPTO_STAGE_SLOTS 32               // Power of two
+
+int      crypto_stage_start(void);          // Reads GS_CRYPTO_THREAD; the result eventfd, or -1 = off
+void     crypto_stage_stop(void);           // Joins the thread; unconsumed results are dropped
+int      crypto_stage_active(void);
+int      crypto_stage_busy(int robot);      // Words of this robot not yet written
+uint32_t crypto_stage_depth(void);
+
+// Loop side: post a job (0 = queued, -1 = ring full) ...
+int  crypto_stage_seal(const robot_bt_packet_t *packets, int n, int flags);   // For ble_route
+int  crypto_stage_open(int uart_fd, int uds_fd, const uint8_t encrypted[TOTAL_SZ]);
+// ... and finish every job the thread is done with (eventfd readable)
+void crypto_stage_drain(void);
+
+#endif
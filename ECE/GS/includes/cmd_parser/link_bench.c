@@ -0,0 +1,407 @@
+#include "link_bench.h"
+#include "cmd_parser.h"
+#include "tx_sched.h"
+#include "../json_uds/json_uds.h"
+#include "../metrics/metrics.h"
+#include "../log/gs_log.h"
+#include "../ble/pmod_esp32.h"
+#include "../ble/ble_wnr.h"
+#include "../transport/transport.h"
+#include "../hardware_crypto/crypto_provider.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_SEAL_OVERHEAD (IV_SZ + TAG_SZ)
+#define BENCH_SEAL_LEN_MAX  (LINK_ECHO_HDR + BENCH_SEAL_OVERHEAD + CT_SZ)   // Plaintext no longer than a seal's
+
+enum { BENCH_IDLE = 0, BENCH_ARMING, BENCH_RUN };
+enum { FATE_UNSENT = 0, FATE_OUT, FATE_BACK, FATE_LOST, FATE_BAD };
+
+typedef struct {
+  const char *name;
+  int         wire;                                        // enum security_suites, frame byte 4
+  int         gs;                                          // gs_crypto_suite_t, -1 = plain
+} bench_suite_t;
+
+static const bench_suite_t g_suites[] = {
+  { "plain",             SEC_PLAIN,             -1 },
+  { "aes-gcm",           SEC_AES_GCM,           GS_SUITE_AES_GCM },
+  { "chacha20-poly1305", SEC_CHACHA20_POLY1305, GS_SUITE_CHACHA20_POLY1305 },
+};
+
+typedef struct {
+  int phase;
+  int uds_fd, id, robot;
+  int count, len, window, stream, wnr_was;
+  const bench_suite_t *suite;
+  int next, oldest, out;                                   // Next seq to send, lowest maybe out, out now
+  int echoed, lost, corrupt;
+  uint64_t t_arm, t_first, t_last;                         // LINK_ECHO queued, first write, last echo
+  uint64_t good_bytes, wire_bytes;
+  uint8_t  part[LINK_ECHO_MAX];                            // Echo cut across notifications (hci, ATT-sized)
+  size_t   part_len, part_want;
+} bench_run_t;
+
+static int                 g_uart_fd = -1;
+static link_bench_timer_fn g_arm = NULL;
+static bench_run_t         g_b = { .uds_fd = -1 };
+static uint64_t            g_sent_us[LINK_BENCH_COUNT_MAX];
+static uint8_t             g_fate[LINK_BENCH_COUNT_MAX];
+static uint32_t            g_rtt[LINK_BENCH_COUNT_MAX];   // Echoed frames' RTTs, arrival order
+
+void link_bench_init(link_bench_timer_fn arm_timer) {
+  g_arm = arm_timer;
+}
+
+static void arm(int ms) {
+  if (g_arm) g_arm(ms);
+}
+
+static uint8_t pattern(int seq, size_t i) {
+  return (uint8_t)(seq * 31 + (int)i * 7 + 0x5A);
+}
+
+static size_t body_len(void) {                             // Pattern bytes per frame
+  return (size_t)g_b.len - LINK_ECHO_HDR - (g_b.suite->gs >= 0 ? BENCH_SEAL_OVERHEAD : 0);
+}
+
+// LINK_ECHO on / off for the run's robot, through the FIFO like any system word
+static int echo_word(int on) {
+  robot_bt_packet_t w = {0};
+  w.sys.pl = 1;
+  w.sys.type = System_CMD;
+  w.sys.instruction = LINK_ECHO;
+  w.sys.id = g_b.id;
+  w.sys.specific = on;
+  if (cmd_route(&w) < 0) return -1;
+  return tx_sched_submit(g_uart_fd, &w);
+}
+
+// Passthrough back the way the run found it (an rsp run held it closed)
+static void wnr_restore(void) {
+  if (transport_is_esp() && !g_b.stream) ble_wnr_enable(g_b.wnr_was);
+}
+
+static int bench_err(int uds_fd, const char *msg) {
+  char js[96];
+  snprintf(js, sizeof(js), "{\"type\":\"ERR\",\"msg\":\"%s\"}", msg);
+  if (uds_fd >= 0) uds_send_json(uds_fd, js);
+  return 1;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static uint32_t pct(const uint32_t *sorted, int n, int p) {
+  return n ? sorted[(n - 1) * p / 100] : 0;
+}
+
+static const char *write_name(void) {
+  if (!transport_is_esp()) return transport()->name;
+  return g_b.stream ? "spp" : "rsp";
+}
+
+static void bench_end(const char *why) {
+  if (g_b.phase == BENCH_IDLE) return;
+  uint64_t now = metrics_now_us();
+  if (g_b.phase == BENCH_RUN) {
+    for (int s = g_b.oldest; s < g_b.next; s++) {
+      if (g_fate[s] != FATE_OUT) continue;
+      g_fate[s] = FATE_LOST;
+      g_b.lost++;
+    }
+  }
+  g_b.out = 0;
+  echo_word(0);
+  wnr_restore();
+  arm(0);
+
+  int n = g_b.echoed;
+  uint64_t sum = 0;
+  for (int i = 0; i < n; i++) sum += g_rtt[i];
+  qsort(g_rtt, (size_t)n, sizeof(g_rtt[0]), cmp_u32);
+  uint64_t t_end = g_b.t_last ? g_b.t_last : now;
+  uint64_t us = g_b.t_first && t_end > g_b.t_first ? t_end - g_b.t_first : 0;
+  double loss = g_b.next ? (double)g_b.lost / g_b.next : 0.0;
+
+  char js[640];
+  snprintf(js, sizeof(js),
+           "{\"type\":\"BENCH\",\"id\":%d,\"robot\":%d,\"transport\":\"%s\",\"write\":\"%s\",\"suite\":\"%s\","
+           "\"len\":%d,\"window\":%d,\"sent\":%d,\"echoed\":%d,\"lost\":%d,\"corrupt\":%d,\"loss\":%.4f,"
+           "\"ms\":%llu,\"rtt_us\":{\"min\":%u,\"p50\":%u,\"p90\":%u,\"p99\":%u,\"max\":%u,\"mean\":%llu},"
+           "\"goodput_bps\":%llu,\"wire_bps\":%llu,\"end\":\"%s\"}",
+           g_b.id, g_b.robot, transport()->name, write_name(), g_b.suite->name, g_b.len, g_b.window,
+           g_b.next, n, g_b.lost, g_b.corrupt, loss, (unsigned long long)(us / 1000),
+           n ? g_rtt[0] : 0, pct(g_rtt, n, 50), pct(g_rtt, n, 90), pct(g_rtt, n, 99), n ? g_rtt[n - 1] : 0,
+           (unsigned long long)(n ? sum / (uint64_t)n : 0),
+           (unsigned long long)(us ? g_b.good_bytes * 8000000ull / us : 0),
+           (unsigned long long)(us ? g_b.wire_bytes * 8000000ull / us : 0), why);
+  LOG_INFO("BENCH %d: %s", g_b.id, js);
+  if (g_b.uds_fd >= 0) uds_send_json(g_b.uds_fd, js);
+  g_b.phase = BENCH_IDLE;
+  g_b.uds_fd = -1;
+  g_b.part_len = g_b.part_want = 0;
+}
+
+// Frame seq into buf (g_b.len bytes); 0 = built
+static int build(int seq, uint8_t *buf) {
+  size_t plen = body_len();
+  buf[0] = LINK_ECHO_TAG;
+  buf[1] = (uint8_t)g_b.len;
+  buf[2] = (uint8_t)seq;
+  buf[3] = (uint8_t)(seq >> 8);
+  buf[4] = (uint8_t)g_b.suite->wire;
+  uint8_t *body = buf + LINK_ECHO_HDR;
+  if (g_b.suite->gs < 0) {
+    for (size_t i = 0; i < plen; i++) body[i] = pattern(seq, i);
+    return 0;
+  }
+  uint8_t pt[CT_SZ];
+  for (size_t i = 0; i < plen; i++) pt[i] = pattern(seq, i);
+  if (gs_nonce_next(body) != 0) return -1;                 // The GS's own sequence: never a command's nonce
+  gs_crypto_suite(g_b.suite->gs);
+  return gs_crypto_encrypt(body, pt, plen, body + IV_SZ) == 0 ? 0 : -1;
+}
+
+// Writes frames while the window and the link allow
+static void pump(void) {
+  uint8_t buf[LINK_ECHO_MAX];
+  int flags = TRANSPORT_ECHO | (g_b.stream ? TRANSPORT_STREAM : 0);
+  while (g_b.phase == BENCH_RUN && g_b.next < g_b.count && g_b.out < g_b.window) {
+    ble_route = g_b.robot;
+    if (!transport_ready()) return;
+    if (build(g_b.next, buf) != 0) {
+      LOG_WARN("BENCH %d: %s seal failed", g_b.id, g_b.suite->name);
+      bench_end("seal failed");
+      return;
+    }
+    if (transport_send_frame(buf, (size_t)g_b.len, flags) != 0) return;   // Next tick
+    uint64_t now = metrics_now_us();
+    if (!g_b.t_first) g_b.t_first = now;
+    g_sent_us[g_b.next] = now;
+    g_fate[g_b.next++] = FATE_OUT;
+    g_b.out++;
+  }
+}
+
+// One whole echoed frame
+static void echo_frame(const uint8_t *f, size_t n) {
+  int seq = f[2] | f[3] << 8;
+  if (g_b.phase != BENCH_RUN || n != (size_t)g_b.len || seq >= g_b.next || g_fate[seq] != FATE_OUT) return;  // Late or foreign
+  uint64_t now = metrics_now_us();
+  g_b.out--;
+
+  size_t plen = body_len();
+  const uint8_t *body = f + LINK_ECHO_HDR;
+  uint8_t pt[LINK_ECHO_MAX];
+  int ok = f[4] == g_b.suite->wire;
+  if (ok && g_b.suite->gs >= 0) {
+    gs_crypto_suite(g_b.suite->gs);
+    ok = gs_crypto_decrypt(body, body + IV_SZ, plen, pt) == 0;
+    body = pt;
+  }
+  for (size_t i = 0; ok && i < plen; i++) ok = body[i] == pattern(seq, i);
+  if (!ok) {
+    g_fate[seq] = FATE_BAD;
+    g_b.corrupt++;
+    return;
+  }
+  g_fate[seq] = FATE_BACK;
+  g_rtt[g_b.echoed++] = (uint32_t)(now - g_sent_us[seq]);
+  g_b.t_last = now;
+  g_b.good_bytes += plen;
+  g_b.wire_bytes += n;
+}
+
+int link_bench_rx(int robot, const uint8_t *buf, size_t len) {
+  if (g_b.part_want) {                                     // The rest of a cut echo comes first
+    if (robot != g_b.robot) return 0;
+    size_t take = g_b.part_want - g_b.part_len;
+    if (take > len) take = len;
+    memcpy(g_b.part + g_b.part_len, buf, take);
+    g_b.part_len += take;
+    buf += take;
+    len -= take;
+    if (g_b.part_len < g_b.part_want) return 1;
+    echo_frame(g_b.part, g_b.part_len);
+    g_b.part_len = g_b.part_want = 0;
+    if (!len) {
+      pump();
+      return 1;
+    }
+  }
+  if (!len || buf[0] != LINK_ECHO_TAG) return 0;
+  while (len >= 2 && buf[0] == LINK_ECHO_TAG && buf[1] >= LINK_ECHO_HDR) {   // Several echoes in one notification
+    size_t fl = buf[1];
+    if (fl > len) {
+      memcpy(g_b.part, buf, len);
+      g_b.part_len = len;
+      g_b.part_want = fl;
+      break;
+    }
+    if (robot == g_b.robot) echo_frame(buf, fl);
+    buf += fl;
+    len -= fl;
+  }
+  pump();
+  return 1;
+}
+
+void link_bench_ack(int robot, const robot_bt_packet_t *ack) {
+  if (g_b.phase != BENCH_ARMING || robot != g_b.robot || ack->ctrl.type != ACK_CMD || (int)ack->ack.id != g_b.id)
+    return;
+  if (ack->ack.result_code == RESULT_SUCCESS && ack->ack.instruction_specific != ECHO_ON) return;   // The last run's LINK_ECHO 0
+  if (ack->ack.result_code != RESULT_SUCCESS) {
+    char msg[64];
+    snprintf(msg, sizeof(msg), "robot refused LINK_ECHO (result %u)", (unsigned)ack->ack.result_code);
+    LOG_WARN("BENCH %d: %s", g_b.id, msg);
+    bench_err(g_b.uds_fd, msg);
+    g_b.phase = BENCH_IDLE;
+    wnr_restore();
+    arm(0);
+    return;
+  }
+  g_b.phase = BENCH_RUN;
+  LOG_INFO("BENCH %d: robot %d echoing, %d x %d bytes, window %d", g_b.id, g_b.robot, g_b.count, g_b.len, g_b.window);
+  pump();
+}
+
+void link_bench_timer(void) {
+  uint64_t now = metrics_now_us();
+  if (g_b.phase == BENCH_ARMING) {
+    if (now - g_b.t_arm < LINK_BENCH_START_MS * 1000ull) {
+      arm(LINK_BENCH_TICK_MS);
+      return;
+    }
+    LOG_WARN("BENCH %d: no LINK_ECHO ACK from robot %d", g_b.id, g_b.robot);
+    bench_err(g_b.uds_fd, "no LINK_ECHO ACK");
+    g_b.phase = BENCH_IDLE;
+    wnr_restore();
+    return;
+  }
+  if (g_b.phase != BENCH_RUN) return;
+
+  ble_route = g_b.robot;
+  if (transport()->link_state() != TRANSPORT_UP) {
+    bench_end("link down");
+    return;
+  }
+  for (int s = g_b.oldest; s < g_b.next; s++) {
+    if (g_fate[s] == FATE_OUT && now - g_sent_us[s] > LINK_BENCH_LOST_MS * 1000ull) {
+      g_fate[s] = FATE_LOST;
+      g_b.lost++;
+      g_b.out--;
+    }
+  }
+  while (g_b.oldest < g_b.next && g_fate[g_b.oldest] != FATE_OUT) g_b.oldest++;
+  pump();
+  if (g_b.phase != BENCH_RUN) return;
+  if (g_b.next == g_b.count && g_b.out == 0) bench_end("done");
+  else arm(LINK_BENCH_TICK_MS);
+}
+
+void link_bench_client_gone(int uds_fd) {
+  if (g_b.phase != BENCH_IDLE && g_b.uds_fd == uds_fd) g_b.uds_fd = -1;   // The run finishes unheard
+}
+
+// Optional integer member in [minv, maxv]; 0 = ok (absent leaves *out)
+static int get_int(const cJSON *root, const char *key, int minv, int maxv, int *out) {
+  const cJSON *it = cJSON_GetObjectItemCaseSensitive(root, key);
+  if (!it) return 0;
+  if (!cJSON_IsNumber(it) || !(it->valuedouble >= minv && it->valuedouble <= maxv)) return -1;
+  if (it->valuedouble != (double)(int)it->valuedouble) return -1;
+  *out = (int)it->valuedouble;
+  return 0;
+}
+
+int handle_bench_request(int uart_fd, int uds_fd, const cJSON *root) {
+  const cJSON *t = cJSON_GetObjectItemCaseSensitive(root, "T");
+  if (!cJSON_IsString(t) || strcmp(t->valuestring, "BENCH") != 0) return 0;
+
+  if (cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(root, "abort"))) {
+    if (g_b.phase == BENCH_IDLE) return bench_err(uds_fd, "no BENCH running");
+    if (g_b.phase == BENCH_ARMING) g_b.phase = BENCH_RUN;  // Nothing sent yet; still turn LINK_ECHO off
+    bench_end("abort");
+    return 1;
+  }
+  if (g_b.phase != BENCH_IDLE) return bench_err(uds_fd, "BENCH already running");
+  if (!g_arm) return bench_err(uds_fd, "no BENCH timer");
+  g_uart_fd = uart_fd;
+
+  int id = 0, count = LINK_BENCH_COUNT_DEF, len = LINK_BENCH_LEN_DEF, window = 1;
+  if (!cJSON_GetObjectItemCaseSensitive(root, "ID") || get_int(root, "ID", 1, 2047, &id) != 0)
+    return bench_err(uds_fd, "bad BENCH ID");
+  if (get_int(root, "count", 1, LINK_BENCH_COUNT_MAX, &count) != 0) return bench_err(uds_fd, "bad BENCH count");
+  if (get_int(root, "len", LINK_BENCH_LEN_MIN, LINK_ECHO_MAX, &len) != 0) return bench_err(uds_fd, "bad BENCH len");
+  if (get_int(root, "window", 1, LINK_BENCH_WINDOW_MAX, &window) != 0) return bench_err(uds_fd, "bad BENCH window");
+
+  const bench_suite_t *suite = &g_suites[0];
+  const cJSON *s = cJSON_GetObjectItemCaseSensitive(root, "suite");
+  if (s) {
+    suite = NULL;
+    for (size_t i = 0; cJSON_IsString(s) && i < sizeof(g_suites) / sizeof(g_suites[0]); i++)
+      if (strcmp(s->valuestring, g_suites[i].name) == 0) suite = &g_suites[i];
+    if (!suite) return bench_err(uds_fd, "bad BENCH suite");
+  }
+
+  int stream = transport_is_esp() && ble_wnr_enabled();   // esp-at default: passthrough when it is on
+  const cJSON *wr = cJSON_GetObjectItemCaseSensitive(root, "write");
+  if (wr) {
+    if (!cJSON_IsString(wr) || (strcmp(wr->valuestring, "rsp") != 0 && strcmp(wr->valuestring, "spp") != 0))
+      return bench_err(uds_fd, "bad BENCH write");
+    stream = strcmp(wr->valuestring, "spp") == 0;
+    if (stream && !transport_is_esp()) return bench_err(uds_fd, "spp is an esp-at write");
+    if (stream && !ble_wnr_enabled()) return bench_err(uds_fd, "spp needs GS_BLE_WNR=1");
+  }
+  if (!transport_framed()) return bench_err(uds_fd, "transport cannot carry echo frames");
+
+  memset(&g_b, 0, sizeof(g_b));
+  g_b.uds_fd = -1;
+  g_b.id = id;
+  robot_bt_packet_t probe = {0};                          // Routes by ID, as echo_word() will
+  probe.sys.type = System_CMD;
+  probe.sys.id = id;
+  if (cmd_route(&probe) < 0) return bench_err(uds_fd, "unknown robot");
+  if (transport()->link_state() != TRANSPORT_UP) return bench_err(uds_fd, "link down");
+
+  if (transport_is_esp()) {                                // One write, no long writes
+    int cap = ble_link_payload_max();
+    if (stream && cap > WNR_MAX_LEN) cap = WNR_MAX_LEN;
+    if (len > cap) len = cap;
+  }
+  if (suite->gs >= 0 && len > BENCH_SEAL_LEN_MAX) len = BENCH_SEAL_LEN_MAX;
+  if (suite->gs >= 0 && len < LINK_ECHO_HDR + BENCH_SEAL_OVERHEAD + 1) return bench_err(uds_fd, "BENCH len too short to seal");
+  if (len < LINK_BENCH_LEN_MIN) return bench_err(uds_fd, "link MTU too small for BENCH");
+  if (suite->gs >= 0) {                                    // A provider that cannot seal fails here, not mid-run
+    uint8_t iv[IV_SZ], pt[1] = {0}, ct[1 + TAG_SZ];
+    gs_crypto_suite(suite->gs);
+    if (gs_nonce_next(iv) != 0 || gs_crypto_encrypt(iv, pt, sizeof(pt), ct) != 0)
+      return bench_err(uds_fd, "BENCH suite has no working provider");
+  }
+
+  g_b.uds_fd = uds_fd;
+  g_b.robot = ble_route;
+  g_b.count = count;
+  g_b.len = len;
+  g_b.window = window;
+  g_b.stream = stream;
+  g_b.suite = suite;
+  memset(g_fate, 0, (size_t)count);
+  if (transport_is_esp() && !stream) {                     // Hold passthrough closed: AT writes only
+    g_b.wnr_was = ble_wnr_enabled();
+    ble_wnr_enable(0);
+  }
+  if (echo_word(1) < 0) {
+    wnr_restore();
+    return bench_err(uds_fd, "BENCH queue full");
+  }
+  g_b.phase = BENCH_ARMING;
+  g_b.t_arm = metrics_now_us();
+  arm(LINK_BENCH_TICK_MS);
+  LOG_INFO("BENCH %d: LINK_ECHO 1 queued for robot %d (%s, %s, %s)", id, g_b.robot, transport()->name,
+           write_name(), suite->name);
+  return 1;
+}
@@ -0,0 +1,59 @@
+#ifndef LINK_BENCH_H
+#define LINK_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cJSON.h"
+#include "../cmd_structure.h"
+
+// ------------------------- Link benchmark -------------------------
+// Measures the robot link on its own, without the executor: the bridge
+// turns on the robot's LINK_ECHO (cmd_codec.h, Link benchmark), writes
+// count LINK_ECHO_TAG frames of len bytes straight to the transport, at
+// most window of them unanswered, and times each one until the robot's
+// echo comes back. A frame not back within LINK_BENCH_LOST_MS is lost; the
+// robot's LINK_ECHO is turned off again at the end.
+//
+//   {"T":"BENCH","ID":n[,"count":c][,"len":l][,"window":w]
+//    [,"write":"rsp"|"spp"][,"suite":"plain"|"aes-gcm"|"chacha20-poly1305"]}
+//   {"T":"BENCH","abort":true}
+//
+// The transport is the one the bridge runs (GS_TRANSPORT). On esp-at,
+// write picks AT+BLEGATTCWR (Write Requests, passthrough held closed for
+// the run) or SPP passthrough (Write Commands, needs GS_BLE_WNR=1); l2cap
+// sends CoC SDUs and hci ATT Write Commands. With a cipher suite the body
+// is IV || ciphertext || tag of a pattern under the GS's next nonce and is
+// opened again on the way back, so the seal, the open and the 28 bytes of
+// overhead are in the numbers; the robot echoes it without touching it.
+// window 1 gives the unloaded RTT, a large window the most the link
+// sustains. Other traffic keeps flowing and shares the link. Reply, once
+// every frame is back or lost:
+//   {"type":"BENCH","id":n,"robot":r,"transport":"..","write":"..",
+//    "suite":"..","len":l,"window":w,"sent":s,"echoed":e,"lost":k,
+//    "corrupt":c,"loss":f,"ms":t,"rtt_us":{"min":..,"p50":..,"p90":..,
+//    "p99":..,"max":..,"mean":..},"goodput_bps":g,"wire_bps":b,"end":".."}
+// goodput counts the pattern bytes echoed intact, wire every byte of the
+// echoed frames, both in bit/s over the run (first write -> last echo).
+// end is "done", "abort", "link down" or "seal failed". An ERR comes back
+// instead if the run cannot start (no working provider for the suite among
+// them) or the robot refuses LINK_ECHO.
+
+#define LINK_BENCH_COUNT_MAX  4096           // Frames per run (seq is their index)
+#define LINK_BENCH_COUNT_DEF  200
+#define LINK_BENCH_LEN_MIN    16             // Never an 8-byte write (a bare word)
+#define LINK_BENCH_LEN_DEF    64
+#define LINK_BENCH_WINDOW_MAX 64
+#define LINK_BENCH_LOST_MS    2000
+#define LINK_BENCH_START_MS   3000           // LINK_ECHO 1 sent -> its ACK
+#define LINK_BENCH_TICK_MS    1              // Send / loss scan while a run is on
+
+typedef void (*link_bench_timer_fn)(int ms);  // 0 disarms
+
+void link_bench_init(link_bench_timer_fn arm_timer);
+int  handle_bench_request(int uart_fd, int uds_fd, const cJSON *root);   // 0 = not a BENCH request
+void link_bench_ack(int robot, const robot_bt_packet_t *ack);      // Every ACK, after ack_track_ack()
+int  link_bench_rx(int robot, const uint8_t *buf, size_t len);     // 1 = echo bytes, not a report
+void link_bench_timer(void);
+void link_bench_client_gone(int uds_fd);
+
+#endif
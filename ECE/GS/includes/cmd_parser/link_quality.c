@@ -0,0 +1,159 @@
+#include "link_quality.h"
+#include "ack_track.h"
+#include "tx_sched.h"
+#include "cmd_trace.h"
+#include "../json_uds/json_uds.h"
+#include "../metrics/metrics.h"
+#include "../log/gs_log.h"
+#include "../ble/pmod_esp32.h"
+#include "../transport/transport.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// What each level asks of the robot and of tx_sched
+static const uint16_t lq_gap_ms[LQ_LEVELS]       = { 0, 200, 1000 };
+static const int      lq_admit_pct[LQ_LEVELS]    = { TX_ADMIT_LINK_PCT, 60, 40 };
+static const uint32_t lq_win_floor_us[LQ_LEVELS] = { 0, 2000, 4000 };
+static const char    *const lq_names[LQ_LEVELS]  = { "good", "fair", "poor" };
+
+typedef struct {
+  uint8_t  up;                                             // Link was up at the last poll
+  uint8_t  level;
+  uint8_t  better;                                         // Ticks in a row that rated it higher
+  uint8_t  no_pace;                                        // Robot refused the gap
+  uint16_t pace_id;                                        // Pace word out, 0 = none
+  uint32_t acked, lost;                                    // ack_track totals at the last tick
+  uint32_t loss_pm;
+  uint64_t t_rssi;                                         // Next reading due
+} lq_link_t;
+
+static int       g_enabled = 0;
+static int       g_uart_fd = -1;
+static lq_link_t g_lq[BLE_LINKS_MAX];
+
+void link_quality_setup(int uart_fd) {
+  const char *on = getenv("GS_LINK_QUALITY");
+  g_enabled = ack_track_enabled() && !(on && strcmp(on, "0") == 0);
+  g_uart_fd = uart_fd;
+  memset(g_lq, 0, sizeof(g_lq));
+}
+
+int link_quality_enabled(void) {
+  return g_enabled;
+}
+
+int link_quality_level(int robot) {
+  return (robot >= 0 && robot < BLE_LINKS_MAX) ? g_lq[robot].level : LQ_GOOD;
+}
+
+uint32_t link_quality_loss_pm(int robot) {
+  return (robot >= 0 && robot < BLE_LINKS_MAX) ? g_lq[robot].loss_pm : 0;
+}
+
+// SUBSCRIBE every topic with the level's gap, queued like a retry
+static void pace_send(int robot, lq_link_t *q) {
+  robot_bt_packet_t w = {0};
+  w.sys.pl = 1;
+  w.sys.type = System_CMD;
+  w.sys.instruction = SUBSCRIBE;
+  w.sys.id = (uint32_t)robot << ROBOT_ID_SHIFT;
+  w.sys.specific = TOPIC_ALL | (uint32_t)lq_gap_ms[q->level] << 8;
+  ack_track_tag(&w, robot);
+  q->pace_id = (uint16_t)w.sys.id;
+  if ((w.sys.id & CMD_TRACE_ID_MAX) == 0 || tx_sched_retry(robot, &w) < 0) q->pace_id = 0;   // Untracked: not paced
+}
+
+static void apply(int robot, lq_link_t *q, int rssi, uint32_t srtt_ms) {
+  tx_sched_link_quality(robot, lq_admit_pct[q->level], lq_win_floor_us[q->level]);
+  if (!q->no_pace) pace_send(robot, q);
+
+  char js[160];
+  int n = snprintf(js, sizeof(js), "{\"type\":\"LINK_QUALITY\",\"level\":\"%s\",\"loss_pm\":%u,\"srtt_ms\":%u,\"rssi\":%d",
+                   lq_names[q->level], q->loss_pm, srtt_ms, rssi);
+  if (ble_robots() > 1) n += snprintf(js + n, sizeof(js) - (size_t)n, ",\"robot\":%d", robot);
+  snprintf(js + n, sizeof(js) - (size_t)n, "}");
+  LOG_INFO("Link quality: robot %d %s (loss %u/1000, SRTT %u ms, RSSI %d dBm)", robot, lq_names[q->level],
+           q->loss_pm, srtt_ms, rssi);
+  uds_tx_broadcast(js, UDS_TX_TELEM, 0, UDS_TOPIC_METRICS, robot);
+}
+
+// The worst of loss, RTT and RSSI
+static int rate(uint32_t loss_pm, uint32_t srtt_ms, int rssi) {
+  if (loss_pm >= LQ_POOR_LOSS_PM || srtt_ms >= LQ_POOR_RTT_MS || (rssi && rssi <= LQ_POOR_RSSI)) return LQ_POOR;
+  if (loss_pm >= LQ_FAIR_LOSS_PM || srtt_ms >= LQ_FAIR_RTT_MS || (rssi && rssi <= LQ_FAIR_RSSI)) return LQ_FAIR;
+  return LQ_GOOD;
+}
+
+// Last reading (0 = none); queues the next one every LQ_RSSI_MS
+static int rssi_of(int robot, uint64_t now) {
+  lq_link_t *q = &g_lq[robot];
+  if (!transport_is_esp()) return 0;
+  if (now >= q->t_rssi) {
+    int route = ble_route;
+    q->t_rssi = now + LQ_RSSI_MS * 1000ull;
+    ble_route = robot;
+    ble_get_rssi(g_uart_fd, NULL);
+    ble_route = route;
+    ble_use_radio();
+  }
+  return g_ble_links[robot].rssi;
+}
+
+void link_quality_poll(void) {
+  if (!g_enabled) return;
+  uint64_t now = metrics_now_us();
+  int robots = ble_robots();
+  for (int i = 0; i < robots && i < BLE_LINKS_MAX; i++) {
+    lq_link_t *q = &g_lq[i];
+    ack_link_stats_t st;
+    ack_track_link(i, &st);
+    if (!ble_connected[i]) {                               // Up again at LQ_GOOD, the robot's gap 0
+      if (q->up) {
+        memset(q, 0, sizeof(*q));
+        tx_sched_link_quality(i, lq_admit_pct[LQ_GOOD], lq_win_floor_us[LQ_GOOD]);
+      }
+      continue;
+    }
+    if (!q->up) {
+      q->up = 1;
+      q->acked = st.acked;
+      q->lost = st.lost;
+    }
+
+    uint32_t acked = st.acked - q->acked, lost = st.lost - q->lost;
+    q->acked = st.acked;
+    q->lost = st.lost;
+    if (acked + lost >= LQ_MIN_WORDS) q->loss_pm = (3 * q->loss_pm + lost * 1000u / (acked + lost)) / 4;
+    else q->loss_pm = 3 * q->loss_pm / 4;                  // Quiet link: the old loss fades
+
+    int rssi = rssi_of(i, now);
+    uint32_t srtt_ms = st.srtt_us / 1000;
+    int r = rate(q->loss_pm, srtt_ms, rssi);
+    if (r > q->level) {
+      q->level = (uint8_t)r;
+      q->better = 0;
+      METRIC_INC(link_degrades);
+      apply(i, q, rssi, srtt_ms);
+    } else if (r < q->level && ++q->better >= LQ_RECOVER_TICKS) {
+      q->level--;
+      q->better = 0;
+      METRIC_INC(link_recovers);
+      apply(i, q, rssi, srtt_ms);
+    } else if (r >= q->level) {
+      q->better = 0;
+    }
+  }
+}
+
+int link_quality_ack(int robot, const robot_bt_packet_t *ack) {
+  if (!g_enabled || robot < 0 || robot >= BLE_LINKS_MAX || ack->ctrl.type != ACK_CMD) return 0;
+  lq_link_t *q = &g_lq[robot];
+  if (!q->pace_id || ack->ack.id != q->pace_id) return 0;
+  q->pace_id = 0;
+  if (ack->ack.result_code == RESULT_INVALID_PARAMS) {
+    q->no_pace = 1;
+    LOG_WARN("Link quality: robot %d firmware takes no telemetry gap, telemetry stays at full rate", robot);
+  }
+  return 1;
+}
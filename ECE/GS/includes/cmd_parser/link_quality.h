@@ -0,0 +1,65 @@
+#ifndef LINK_QUALITY_H
+#define LINK_QUALITY_H
+
+#include <stdint.h>
+#include "../cmd_structure.h"
+
+// ------------------------- Link quality -------------------------
+// On with the ACK tracker (its loss and RTT are the input); GS_LINK_QUALITY=0
+// turns it off. Every LQ_TICK_MS each connected robot's link is rated from
+//   loss   written words that ran out of RTO over all written words that
+//          ended (ack_track_link()), per mille, EWMA over the ticks that
+//          saw at least LQ_MIN_WORDS of them; a quieter tick lets it fade
+//   rtt    the tracker's SRTT
+//   rssi   the modem's reading (ble_get_rssi(), asked every LQ_RSSI_MS;
+//          esp-at only, and only on modem firmware that has the query)
+// into LQ_GOOD, LQ_FAIR or LQ_POOR: the worst of the three decides. A link
+// drops a level as soon as a tick rates it lower and climbs back one level
+// after LQ_RECOVER_TICKS ticks in a row rate it higher, so a noisy link does
+// not flap. A link that comes up starts at LQ_GOOD.
+//
+// Each level moves bandwidth from telemetry to commands and ACKs:
+//   telemetry   SUBSCRIBE with a gap (cmd_codec.h, Multi-central): the
+//               robot sends telemetry batches at least lq_gap_ms apart,
+//               merging what came due in between
+//   admission   CONTROL / ARM get lq_admit_pct of the measured capacity
+//               (tx_sched.h), so held keys coalesce in their slots sooner
+//               and SYSTEM / QUERY words find room
+//   batching    the TX window does not close below lq_win_floor_us while
+//               the link is loaded: fewer, fuller writes
+// PHY selection has nothing to work with: the PmodESP32 (BLE 4.2) and the
+// robot's ESP32 only have the 1M PHY.
+//
+// The pace word is a SUBSCRIBE with every topic, tracked and retried like a
+// client's; its ACK is not published. Firmware that does not know the gap
+// refuses it (RESULT_INVALID_PARAMS) and the link is not paced again until
+// it reconnects. A client's own SUBSCRIBE replaces the gap until the next
+// level change.
+//
+// A level change goes to UDS clients on the "metrics" topic:
+//   {"type":"LINK_QUALITY","level":"poor","loss_pm":N,"srtt_ms":N,"rssi":N[,"robot":R]}
+// (rssi 0 = no reading). METRICS: link_degrades, link_recovers; gauges
+// link_quality (first robot's level, 0 = good) and link_loss_pm.
+
+#define LQ_TICK_MS         1000
+#define LQ_RSSI_MS         2000
+#define LQ_MIN_WORDS       4                // Ended words a tick needs to count for loss
+#define LQ_RECOVER_TICKS   3
+
+#define LQ_FAIR_LOSS_PM    50
+#define LQ_POOR_LOSS_PM    150
+#define LQ_FAIR_RTT_MS     100
+#define LQ_POOR_RTT_MS     250
+#define LQ_FAIR_RSSI       -75              // dBm, at or below
+#define LQ_POOR_RSSI       -85
+
+enum { LQ_GOOD = 0, LQ_FAIR, LQ_POOR, LQ_LEVELS };
+
+void link_quality_setup(int uart_fd);                                 // Reads GS_LINK_QUALITY
+int  link_quality_enabled(void);
+void link_quality_poll(void);                                         // Every LQ_TICK_MS
+int  link_quality_level(int robot);
+uint32_t link_quality_loss_pm(int robot);
+int  link_quality_ack(int robot, const robot_bt_packet_t *ack);       // 1 = the pace word's ACK; before ack_track_ack
+
+#endif
@@ -0,0 +1,116 @@
+#include "report_agg.h"
+#include "report_json.h"
+#include "../json_uds/json_uds.h"
+#include "../metrics/metrics.h"
+#include "../log/gs_log.h"
+#include "../ble/pmod_esp32.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+  uint64_t t0;                                             // Window start (ms)
+  uint32_t n;                                              // Samples so far, 0 = empty
+  int64_t  min[REPORT_FIELDS_MAX], max[REPORT_FIELDS_MAX];
+  int64_t  sum[REPORT_FIELDS_MAX], last[REPORT_FIELDS_MAX];
+} agg_win_t;
+
+static const char *const g_src[AGG_PARTS] = { "NAV", "POSE", "INERT" };
+
+static uint32_t     g_win_ms[AGG_WINDOWS_MAX];
+static int          g_nwin = 0;
+static agg_win_t    g_agg[BLE_LINKS_MAX][AGG_PARTS][AGG_WINDOWS_MAX];
+static const char  *g_keys[AGG_PARTS][REPORT_FIELDS_MAX];  // Key fragments, from report_json
+static int          g_nkeys[AGG_PARTS];
+
+static uint64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+void report_agg_setup(void) {
+  const char *spec = getenv("GS_AGG_MS");
+  if (!spec || !spec[0]) spec = "100,1000";
+  g_nwin = 0;
+  memset(g_agg, 0, sizeof(g_agg));
+  for (const char *p = spec; *p && g_nwin < AGG_WINDOWS_MAX; ) {
+    char *end;
+    unsigned long ms = strtoul(p, &end, 10);
+    if (end == p) break;
+    if (ms >= 10 && ms <= 60000) g_win_ms[g_nwin++] = (uint32_t)ms;
+    else if (ms) LOG_WARN("GS_AGG_MS: %lu ms window ignored (10..60000)", ms);
+    p = *end == ',' ? end + 1 : end;
+  }
+}
+
+int report_agg_enabled(void) {
+  return g_nwin > 0;
+}
+
+static void publish(int robot, int part, int wi) {
+  agg_win_t *a = &g_agg[robot][part][wi];
+  char out[768];
+  int n = 1;
+  out[0] = '{';
+  if (ble_robots() > 1) n += snprintf(out + n, sizeof(out) - (size_t)n, "\"robot\":%d,", robot);
+  n += snprintf(out + n, sizeof(out) - (size_t)n, "\"type\":\"AGG\",\"src\":\"%s\",\"win_ms\":%u,\"t_ms\":%llu,\"n\":%u",
+                g_src[part], g_win_ms[wi], (unsigned long long)a->t0, a->n);
+  for (int f = 0; f < g_nkeys[part]; f++) {
+    n += snprintf(out + n, sizeof(out) - (size_t)n, "%s[%lld,%lld,%.2f,%lld]", g_keys[part][f],
+                  (long long)a->min[f], (long long)a->max[f], (double)a->sum[f] / a->n, (long long)a->last[f]);
+  }
+  snprintf(out + n, sizeof(out) - (size_t)n, "}");
+  a->n = 0;
+
+  // Clear of robot_state_publish's keys: bits 6-7 are never set by a report type
+  uint16_t key = (uint16_t)(1 + (((unsigned)robot & 0xFF) << 8 | 0xC0 | wi << 2 | part));
+  uds_tx_broadcast(out, UDS_TX_TELEM, key, UDS_TOPIC_AGG, robot);
+  METRIC_INC(agg_reports);
+}
+
+void report_agg_sample(int robot, const robot_bt_packet_t *w) {
+  if (!g_nwin || robot < 0 || robot >= BLE_LINKS_MAX || w->ctrl.type != ROBOT_UPDATE_CMD) return;
+  int64_t v[REPORT_FIELDS_MAX];
+  const char *keys[REPORT_FIELDS_MAX];
+  int nf = robot_report_fields(*w, v, keys);
+  if (nf == 0) return;
+  int part = w->nav.part;
+  if (!g_nkeys[part]) {
+    memcpy(g_keys[part], keys, sizeof(keys[0]) * (size_t)nf);
+    g_nkeys[part] = nf;
+  }
+
+  uint64_t now = now_ms();
+  for (int wi = 0; wi < g_nwin; wi++) {
+    agg_win_t *a = &g_agg[robot][part][wi];
+    if (a->n && now >= a->t0 + g_win_ms[wi]) publish(robot, part, wi);
+    if (!a->n) {
+      a->t0 = now - now % g_win_ms[wi];
+      for (int f = 0; f < nf; f++) {
+        a->min[f] = a->max[f] = v[f];
+        a->sum[f] = 0;
+      }
+    }
+    for (int f = 0; f < nf; f++) {
+      if (v[f] < a->min[f]) a->min[f] = v[f];
+      if (v[f] > a->max[f]) a->max[f] = v[f];
+      a->sum[f] += v[f];
+      a->last[f] = v[f];
+    }
+    a->n++;
+  }
+}
+
+void report_agg_poll(void) {
+  uint64_t now = now_ms();
+  for (int r = 0; r < BLE_LINKS_MAX; r++) {
+    for (int part = 0; part < AGG_PARTS; part++) {
+      for (int wi = 0; wi < g_nwin; wi++) {
+        const agg_win_t *a = &g_agg[r][part][wi];
+        if (a->n && now >= a->t0 + g_win_ms[wi]) publish(r, part, wi);
+      }
+    }
+  }
+}
@@ -0,0 +1,33 @@
+#ifndef REPORT_AGG_H
+#define REPORT_AGG_H
+
+#include "../cmd_structure.h"
+
+// ------------------------- Report aggregation -------------------------
+// NAV, POSE and INERT reports (ROBOT_UPDATE parts 0-2) can come faster than
+// a UI draws them. Besides being published as they are (topic "imu"), each
+// sample is folded into per robot, per part windows of GS_AGG_MS (comma
+// separated ms, default "100,1000"; 0 = off), and every window that closes
+// is published once on topic "agg":
+//   {["robot":R,]"type":"AGG","src":"INERT","win_ms":100,"t_ms":T,"n":12,
+//    "ax":[min,max,mean,last],...}
+// t_ms is the window's start on the bridge's monotonic clock; windows are
+// aligned to their length, so a 1 s window holds exactly ten 100 ms ones.
+// A sample costs O(1) per window (min, max, sum, last); a window closes on
+// the first sample after it, or on the AGG_TICK_MS poll once a stream stops.
+// Clients pick raw or aggregated with {"T":"SUB","topics":["agg"]} or
+// ["imu"]; AGG frames coalesce per robot, part and window like the rest of
+// the telemetry, so a slow client gets the latest of each.
+//
+// METRICS: agg_reports (windows published).
+
+#define AGG_WINDOWS_MAX 4
+#define AGG_PARTS       3                   // NAV, POSE, INERT
+#define AGG_TICK_MS     50
+
+void report_agg_setup(void);                                   // Reads GS_AGG_MS
+int  report_agg_enabled(void);
+void report_agg_sample(int robot, const robot_bt_packet_t *w); // Every decoded report word
+void report_agg_poll(void);                                    // Every AGG_TICK_MS
+
+#endif
@@ -0,0 +1,105 @@
+#include "report_fec.h"
+#include "../metrics/metrics.h"
+#include "../log/gs_log.h"
+#include "../ble/pmod_esp32.h"
+#include <string.h>
+
+typedef struct {
+  uint8_t  active;                                         // A group is open
+  uint8_t  group;
+  uint8_t  done;                                           // Whole, or rebuilt
+  uint8_t  k, slots;                                       // From a parity batch; k 0 = none yet
+  uint8_t  top;                                            // Highest data index seen + 1
+  uint32_t have;                                           // Data batches received, bit per index
+  uint8_t  len[FEC_K_MAX];                                 // Their words, tag excluded
+  uint64_t d[FEC_K_MAX][FEC_SLOTS_MAX];
+  uint64_t p[FEC_SLOTS_MAX], q[FEC_SLOTS_MAX];
+  uint8_t  rows;                                           // Bit 0 = P held, bit 1 = Q
+} fec_grp_t;
+
+static fec_grp_t g_fec[BLE_LINKS_MAX];
+
+static int missing(const fec_grp_t *g, int k) {
+  return k - __builtin_popcount(g->have & ((1u << k) - 1));
+}
+
+// The group is over: what was neither received nor rebuilt is lost
+static void group_open(fec_grp_t *g, uint8_t group) {
+  if (g->active && !g->done) {
+    int lost = missing(g, g->k ? g->k : g->top);
+    if (lost > 0) METRIC_ADD(fec_unrecovered, lost);
+  }
+  memset(g, 0, sizeof(*g));
+  g->active = 1;
+  g->group = group;
+}
+
+static uint16_t word_key(const robot_bt_packet_t *w) {
+  return (uint16_t)(w->ctrl.type << 2 | (w->ctrl.type == ROBOT_UPDATE_CMD ? w->nav.part : 0));
+}
+
+// A later received batch of the group carries a newer one of w
+static int superseded(const fec_grp_t *g, int idx, const robot_bt_packet_t *w) {
+  for (int i = idx + 1; i < FEC_K_MAX; i++) {
+    if (!(g->have & (1u << i))) continue;
+    for (int j = 0; j < g->len[i]; j++) {
+      robot_bt_packet_t o = { .raw = g->d[i][j] };
+      if (word_key(&o) == word_key(w)) return 1;
+    }
+  }
+  return 0;
+}
+
+static void try_recover(int robot, fec_grp_t *g, robot_bt_packet_t *rec, int *nrec) {
+  if (g->done || !g->k) return;
+  int m = missing(g, g->k);
+  if (m == 0) { g->done = 1; return; }
+  uint32_t had = g->have;
+  int r = fec_recover(g->k, had, g->slots, g->d, g->rows & 1 ? g->p : NULL, g->rows & 2 ? g->q : NULL);
+  if (r == 0) return;                                      // Two lost: wait for the other row
+  g->done = 1;
+  METRIC_ADD(fec_recovered, r);
+  LOG_INFO("[FEC] robot %d: group %u, %d batch%s rebuilt", robot, g->group, r, r == 1 ? "" : "es");
+  for (int i = 0; i < g->k; i++) {
+    if (had & (1u << i)) continue;
+    g->have |= 1u << i;
+    g->len[i] = g->slots;
+    for (int j = 0; j < g->slots; j++) {
+      robot_bt_packet_t w = { .raw = g->d[i][j] };
+      if (!w.raw) continue;                                // Beyond that batch's length
+      if (superseded(g, i, &w)) { METRIC_INC(fec_stale); continue; }
+      if (*nrec < REPORT_FEC_REC_MAX) rec[(*nrec)++] = w;
+    }
+  }
+}
+
+int report_fec_rx(int robot, robot_bt_packet_t *words, int n, robot_bt_packet_t *rec, int *nrec) {
+  *nrec = 0;
+  if (n <= 0 || robot < 0 || robot >= BLE_LINKS_MAX) return n;
+  fec_grp_t *g = &g_fec[robot];
+
+  const robot_bt_packet_t *tag = &words[n - 1];
+  if (tag->ctrl.type == FEC_CMD && tag->fec.row == 0) {    // Data batch
+    int idx = tag->fec.index, len = n - 1;
+    if (!g->active || g->group != tag->fec.group) group_open(g, (uint8_t)tag->fec.group);
+    if (len > FEC_SLOTS_MAX || (g->have & (1u << idx))) return len;
+    g->have |= 1u << idx;
+    g->len[idx] = (uint8_t)len;
+    for (int j = 0; j < FEC_SLOTS_MAX; j++) g->d[idx][j] = j < len ? words[j].raw : 0;
+    if (idx + 1 > g->top) g->top = (uint8_t)(idx + 1);
+    return len;
+  }
+
+  tag = &words[0];
+  if (tag->ctrl.type != FEC_CMD || tag->fec.row == 0) return n;
+  int row = tag->fec.row, k = tag->fec.k, slots = tag->fec.slots;
+  if (row > FEC_ROWS_MAX || k == 0 || k > FEC_K_MAX || slots > FEC_SLOTS_MAX || n != 1 + slots) return 0;
+  if (!g->active || g->group != tag->fec.group) group_open(g, (uint8_t)tag->fec.group);
+  g->k = (uint8_t)k;
+  g->slots = (uint8_t)slots;
+  uint64_t *r = row == 1 ? g->p : g->q;
+  for (int j = 0; j < slots; j++) r[j] = words[1 + j].raw;
+  g->rows |= (uint8_t)(1u << (row - 1));
+  try_recover(robot, g, rec, nrec);
+  return 0;
+}
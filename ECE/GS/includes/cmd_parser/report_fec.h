@@ -0,0 +1,27 @@
+#ifndef REPORT_FEC_H
+#define REPORT_FEC_H
+
+#include "../cmd_structure.h"
+#include "../../../robot/components/cmd_codec/tlm_fec.h"
+
+// ------------------------- Telemetry FEC -------------------------
+// With TLM_FEC on, each robot telemetry batch ends in a FEC_CMD tag word and
+// every group of k batches is followed by one or two parity batches
+// (tlm_fec.h). Per robot, the bridge keeps the current group's batches and
+// parity rows; one lost batch is rebuilt from either row, two from both,
+// with no round trip. Rebuilt words join the report pipeline as if received,
+// less any a later batch of the group already superseded (same type and
+// part): the cache and clients never go back in time. Batches without a tag
+// pass through untouched, so FEC is the robot's choice alone.
+//
+// METRICS: fec_recovered (batches rebuilt), fec_unrecovered (lost, parity
+// short or lost too), fec_stale (rebuilt words dropped as superseded).
+
+#define REPORT_FEC_REC_MAX (FEC_ROWS_MAX * FEC_SLOTS_MAX)
+
+// One notification's words: strips the tag of a data batch and returns the
+// words left, 0 for a parity batch. Words rebuilt on the way land in rec
+// (REPORT_FEC_REC_MAX), *nrec of them, to be handled after words.
+int report_fec_rx(int robot, robot_bt_packet_t *words, int n, robot_bt_packet_t *rec, int *nrec);
+
+#endif
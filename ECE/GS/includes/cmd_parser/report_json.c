@@ -0,0 +1,209 @@
+#include "report_json.h"
+#include <stdint.h>
+#include <string.h>
+
+// One integer slot: the key fragment in front of it and where the value
+// sits in the 64-bit word (bitfields are LSB first, as in cmd_structure.h)
+typedef struct {
+  const char *frag;
+  uint8_t     flen;
+  uint8_t     shift;
+  uint8_t     width;
+  uint8_t     sign;                       // Two's complement field
+} rj_slot_t;
+
+typedef struct {
+  const char      *head;                  // Opening brace and "type" member
+  uint8_t          hlen;
+  uint8_t          nslots;
+  const rj_slot_t *slots;
+} rj_template_t;
+
+#define RJ_U(key, shift, width) { key, sizeof(key) - 1, shift, width, 0 }
+#define RJ_S(key, shift, width) { key, sizeof(key) - 1, shift, width, 1 }
+#define RJ_T(head, slots, n)    { head, sizeof(head) - 1, n, slots }
+
+static const rj_slot_t rj_hr_slots[] = {
+  RJ_U(",\"unchanged\":",     33, 1),
+  RJ_U(",\"battery\":",        7, 7),
+  RJ_U(",\"security\":",      14, 1),
+  RJ_U(",\"motor_enabled\":", 15, 1),
+  RJ_U(",\"arm_enabled\":",   16, 1),
+  RJ_U(",\"tx_queue\":",      17, 4),
+  RJ_U(",\"tx_drops\":",      21, 12),
+  RJ_U(",\"stack_task\":",    34, 3),
+  RJ_U(",\"stack_free\":",    37, 12),
+  RJ_U(",\"traj\":",          49, 2),
+  RJ_U(",\"traj_seg\":",      51, 6),
+  RJ_U(",\"credits\":",       57, 5),
+};
+static const rj_slot_t rj_ack_slots[] = {
+  RJ_U(",\"id\":",      7, 11),
+  RJ_U(",\"result\":", 18, 5),
+  RJ_U(",\"info\":",   23, 41),
+};
+static const rj_slot_t rj_nav_slots[] = {
+  RJ_S(",\"px\":",    16, 16),
+  RJ_S(",\"py\":",    32, 16),
+  RJ_S(",\"pz\":",    48, 16),
+  RJ_U(",\"speed\":",  9, 7),
+};
+static const rj_slot_t rj_pose_slots[] = {
+  RJ_U(",\"yaw\":",    9, 18),
+  RJ_S(",\"pitch\":", 27, 18),
+  RJ_S(",\"roll\":",  45, 18),
+};
+static const rj_slot_t rj_inert_slots[] = {
+  RJ_S(",\"ax\":",  9, 9),
+  RJ_S(",\"ay\":", 18, 9),
+  RJ_S(",\"az\":", 27, 9),
+  RJ_S(",\"gx\":", 36, 9),
+  RJ_S(",\"gy\":", 45, 9),
+  RJ_S(",\"gz\":", 54, 9),
+};
+static const rj_slot_t rj_hpr_slots[] = {
+  RJ_U(",\"alert\":",    7,  5),
+  RJ_U(",\"cleared\":", 12,  1),
+  RJ_S(",\"value\":",   13, 16),
+  RJ_U(",\"limit\":",   29, 16),
+  RJ_U(",\"seq\":",     45,  8),
+};
+static const rj_slot_t rj_unknown_slots[] = { RJ_U(",\"raw_type\":", 2, 5) };
+
+static const rj_template_t rj_hr      = RJ_T("{\"type\":\"HR\"",      rj_hr_slots,      12);
+static const rj_template_t rj_hr_beat = RJ_T("{\"type\":\"HR\"",      rj_hr_slots,      1); // No history
+static const rj_template_t rj_ack     = RJ_T("{\"type\":\"ACK\"",     rj_ack_slots,     3);
+static const rj_template_t rj_nav     = RJ_T("{\"type\":\"NAV\"",     rj_nav_slots,     4);
+static const rj_template_t rj_pose    = RJ_T("{\"type\":\"POSE\"",    rj_pose_slots,    3);
+static const rj_template_t rj_inert   = RJ_T("{\"type\":\"INERT\"",   rj_inert_slots,   6);
+static const rj_template_t rj_hpr     = RJ_T("{\"type\":\"HPR\"",     rj_hpr_slots,     5);
+static const rj_template_t rj_unknown = RJ_T("{\"type\":\"UNKNOWN\"", rj_unknown_slots, 1);
+static const rj_template_t rj_empty   = RJ_T("{",                     NULL,             0); // Update part 3
+
+static const char rj_digits2[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+// Fields are at most 41 bits, so 20 chars (sign + digits) always fit
+#define RJ_INT_MAX 21
+
+static size_t rj_itoa(int64_t v, char *out) {
+  uint64_t u = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+  char tmp[RJ_INT_MAX];
+  char *p = tmp + sizeof(tmp);
+  size_t n = 0;
+
+  if (v < 0) out[n++] = '-';
+  if (u < 10) {                                           // Flags and small counters
+    out[n++] = (char)('0' + u);
+    return n;
+  }
+  while (u >= 100) {
+    unsigned d = (unsigned)(u % 100) * 2;
+    u /= 100;
+    *--p = rj_digits2[d + 1];
+    *--p = rj_digits2[d];
+  }
+  if (u >= 10) {
+    *--p = rj_digits2[u * 2 + 1];
+    *--p = rj_digits2[u * 2];
+  } else {
+    *--p = (char)('0' + u);
+  }
+  size_t len = (size_t)(tmp + sizeof(tmp) - p);
+  memcpy(out + n, p, len);
+  return n + len;
+}
+
+static int64_t rj_field(uint64_t raw, const rj_slot_t *s) {
+  uint64_t mask = (s->width < 64) ? ((uint64_t)1 << s->width) - 1 : ~(uint64_t)0;
+  uint64_t u = (raw >> s->shift) & mask;
+  if (s->sign && (u >> (s->width - 1))) return (int64_t)(u | ~mask);
+  return (int64_t)u;
+}
+
+static int rj_emit(const rj_template_t *t, uint64_t raw, char *out, size_t cap) {
+  size_t n = t->hlen;
+  if (cap < n + 2) return -1;                             // Head + '}' + NUL
+  memcpy(out, t->head, n);
+
+  for (int i = 0; i < t->nslots; i++) {
+    const rj_slot_t *s = &t->slots[i];
+    if (cap - n < (size_t)s->flen + RJ_INT_MAX + 2) return -1;
+    memcpy(out + n, s->frag, s->flen);
+    n += s->flen;
+    n += rj_itoa(rj_field(raw, s), out + n);
+  }
+  out[n++] = '}';
+  out[n] = '\0';
+  return (int)n;
+}
+
+// ------------------------- Public API -------------------------
+
+int robot_health_expand(robot_bt_packet_t *pkt) {
+  static health_format_t last_health;
+  static int have_health = 0;
+
+  if (!pkt->health.unchanged) {
+    last_health = pkt->health;
+    have_health = 1;
+    return 1;
+  }
+  if (!have_health) return 0;
+  health_format_t beat = pkt->health;
+  pkt->health = last_health;
+  pkt->health.unchanged = 1;                              // Still reported as a heartbeat
+  pkt->health.stack_task = beat.stack_task;               // Heartbeats carry their own
+  pkt->health.stack_free = beat.stack_free;
+  pkt->health.credits = beat.credits;
+  return 1;
+}
+
+int robot_report_json(robot_bt_packet_t pkt, char *out, size_t cap) {
+  const rj_template_t *t;
+
+  switch (pkt.ctrl.type) {
+    case HEALTH_CMD:
+      t = robot_health_expand(&pkt) ? &rj_hr : &rj_hr_beat;
+      break;
+    case ACK_CMD:
+      t = &rj_ack;
+      break;
+    case ROBOT_UPDATE_CMD:
+      if (pkt.nav.part == 0)      t = &rj_nav;
+      else if (pkt.nav.part == 1) t = &rj_pose;
+      else if (pkt.nav.part == 2) t = &rj_inert;
+      else                        t = &rj_empty;
+      break;
+    case HPR_CMD:
+      t = &rj_hpr;
+      break;
+    default:
+      t = &rj_unknown;
+      break;
+  }
+  return rj_emit(t, pkt.raw, out, cap);
+}
+
+int robot_report_fields(robot_bt_packet_t pkt, int64_t *vals, const char **keys) {
+  const rj_slot_t *slots;
+  int n;
+  if (pkt.ctrl.type == HEALTH_CMD) {
+    if (pkt.health.unchanged) return 0;
+    slots = rj_hr_slots + 1;                              // battery..tx_drops
+    n = 6;
+  } else if (pkt.ctrl.type == ROBOT_UPDATE_CMD && pkt.nav.part < 3) {
+    const rj_template_t *t = pkt.nav.part == 0 ? &rj_nav : pkt.nav.part == 1 ? &rj_pose : &rj_inert;
+    slots = t->slots;
+    n = t->nslots;
+  } else {
+    return 0;
+  }
+  for (int i = 0; i < n; i++) {
+    vals[i] = rj_field(pkt.raw, &slots[i]);
+    keys[i] = slots[i].frag;
+  }
+  return n;
+}
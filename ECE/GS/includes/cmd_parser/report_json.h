@@ -0,0 +1,34 @@
+#ifndef REPORT_JSON_H
+#define REPORT_JSON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../cmd_structure.h"
+
+// ------------------------- Report templates -------------------------
+// Robot reports (HR, ACK, NAV, POSE, INERT, HPR) carry a fixed set of
+// integer fields, so each type has a precompiled template: static key
+// fragments with an integer slot after each, filled straight from the
+// packet bits. One pass into the caller's buffer, no cJSON tree, no heap.
+// Output matches robot_packet_to_json() printed unformatted, e.g.
+//   {"type":"NAV","px":-120,"py":40,"pz":0,"speed":12}
+
+#define REPORT_JSON_MAX 224               // Longest report (HR) incl. the NUL, with slack
+
+// HR heartbeats (unchanged=1) are expanded to the last full report. Shared
+// by both encoders so they keep one history; returns 0 if there is none yet
+// (bridge restarted mid-link) and the report is left as is.
+int robot_health_expand(robot_bt_packet_t *pkt);
+
+// Returns the length written (NUL-terminated), or -1 if cap is too small.
+// Applies robot_health_expand() to HR words.
+int robot_report_json(robot_bt_packet_t pkt, char *out, size_t cap);
+
+#define REPORT_FIELDS_MAX 6               // INERT: ax..gz, HR: battery..tx_drops
+
+// The integer fields of a NAV / POSE / INERT word or a full HR (not a
+// heartbeat), in template order, with each one's key fragment (",\"px\":");
+// returns their count, 0 for any other report.
+int robot_report_fields(robot_bt_packet_t pkt, int64_t *vals, const char **keys);
+
+#endif
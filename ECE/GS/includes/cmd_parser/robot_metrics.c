@@ -0,0 +1,74 @@
+#include "robot_metrics.h"
+#include "../json_uds/json_uds.h"
+#include "../metrics/metrics.h"
+#include "../ble/pmod_esp32.h"
+#include <stdio.h>
+#include <string.h>
+
+static int robot_prefix(char *out, size_t cap, int robot) {
+  int n = 1;
+  out[0] = '{';
+  if (ble_robots() > 1) n += snprintf(out + n, cap - (size_t)n, "\"robot\":%d,", robot);
+  return n;
+}
+
+static void metrics_sys(int robot, const metrics_sys_t *s) {
+  char out[640];
+  int n = robot_prefix(out, sizeof(out), robot);
+  n += snprintf(out + n, sizeof(out) - (size_t)n,
+                "\"type\":\"METRICS\",\"seq\":%u,\"up_ms\":%u,\"load_pm\":[%u,%u],\"heap\":[%u,%u],"
+                "\"rx\":[%u,%u],\"tx\":[%u,%u],\"lanes\":[%u,%u,%u],\"tasks\":%u,"
+                "\"drops\":{\"rx\":%u,\"tx\":%u,\"auth\":%u,\"replay\":%u},\"congest\":[%u,%u],\"dec_hist\":[",
+                s->h.seq, s->uptime_ms, s->load_pm[0], s->load_pm[1], s->heap_free, s->heap_min,
+                s->rx_used, s->rx_peak, s->tx_depth, s->tx_peak, s->lane[0], s->lane[1], s->lane[2], s->ntasks,
+                s->rx_drops, s->tx_drops, s->auth_fail, s->replay_drops, s->congest, s->congest_ms);
+  for (int i = 0; i < METRICS_DEC_BUCKETS; i++)
+    n += snprintf(out + n, sizeof(out) - (size_t)n, "%s%u", i ? "," : "", s->dec_hist[i]);
+  n += snprintf(out + n, sizeof(out) - (size_t)n, "]}");
+  if (n < 0 || (size_t)n >= sizeof(out)) return;
+  uds_tx_broadcast(out, UDS_TX_TELEM, 0, UDS_TOPIC_METRICS, robot);
+}
+
+static void metrics_tasks(int robot, const metrics_tasks_t *h, const metrics_task_t *rows, int count) {
+  char out[UDS_TX_SLOT_MAX];
+  int n = robot_prefix(out, sizeof(out), robot);
+  n += snprintf(out + n, sizeof(out) - (size_t)n, "\"type\":\"METRICS_TASKS\",\"seq\":%u,\"first\":%u,\"rows\":[",
+                h->h.seq, h->first);
+  for (int i = 0; i < count && (size_t)n < sizeof(out); i++) {
+    const metrics_task_t *r = &rows[i];
+    char name[METRICS_TASK_NAME + 1];
+    size_t k = 0;
+    for (; k < METRICS_TASK_NAME && r->name[k]; k++)      // Task names are plain ASCII; keep the JSON valid
+      name[k] = (r->name[k] == '"' || r->name[k] == '\\' || (uint8_t)r->name[k] < 0x20) ? '_' : r->name[k];
+    name[k] = '\0';
+    n += snprintf(out + n, sizeof(out) - (size_t)n, "%s[\"%s\",%d,%u,%u,%u]", i ? "," : "",
+                  name, r->core == 0xFF ? -1 : r->core, r->prio, r->cpu_pm, r->stack_free);
+  }
+  if ((size_t)n >= sizeof(out)) return;
+  n += snprintf(out + n, sizeof(out) - (size_t)n, "]}");
+  if (n < 0 || (size_t)n >= sizeof(out)) return;
+  uds_tx_broadcast(out, UDS_TX_TELEM, 0, UDS_TOPIC_METRICS, robot);
+}
+
+void robot_metrics_rx(int robot, const uint8_t *data, size_t len) {
+  metrics_hdr_t h;
+  if (len < sizeof(h)) return;
+  memcpy(&h, data, sizeof(h));
+  if (h.version != METRICS_VERSION) return;                 // Newer firmware: skip, don't misread
+
+  if (h.kind == METRICS_SYS && len >= sizeof(metrics_sys_t)) {
+    metrics_sys_t s;
+    memcpy(&s, data, sizeof(s));
+    metrics_sys(robot, &s);
+    METRIC_INC(robot_metrics);
+  } else if (h.kind == METRICS_TASKS && len >= sizeof(metrics_tasks_t)) {
+    metrics_tasks_t t;
+    metrics_task_t rows[512 / sizeof(metrics_task_t)];     // An ATT value is 512 bytes at most
+    memcpy(&t, data, sizeof(t));
+    size_t count = (len - sizeof(t)) / sizeof(metrics_task_t);
+    if (count > t.count) count = t.count;
+    if (count > sizeof(rows) / sizeof(rows[0])) count = sizeof(rows) / sizeof(rows[0]);
+    memcpy(rows, data + sizeof(t), count * sizeof(metrics_task_t));
+    metrics_tasks(robot, &t, rows, (int)count);
+  }
+}
@@ -0,0 +1,22 @@
+#ifndef ROBOT_METRICS_H
+#define ROBOT_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../cmd_structure.h"
+
+// ------------------------- Robot runtime metrics -------------------------
+// Notifications from the robot's metrics characteristic (ROBOT_METRICS_UUID,
+// cmd_codec.h; the connect chain subscribes when the firmware has one) go
+// out to UDS clients on the "metrics" topic:
+//   {"type":"METRICS","seq":S,"up_ms":..,"load_pm":[c0,c1],"heap":[free,min],
+//    "rx":[used,peak],"tx":[depth,peak],"lanes":[sys,motion,obs],"tasks":N,
+//    "drops":{"rx":..,"tx":..,"auth":..,"replay":..},"congest":[n,ms],
+//    "dec_hist":[8 buckets, < 32 us then doubling]}
+//   {"type":"METRICS_TASKS","seq":S,"first":F,
+//    "rows":[["name",core,prio,cpu_pm,stack_free],..]}       core -1 = either
+// Both carry "robot" with more than one robot. cpu_pm / load_pm are 0.1 %.
+
+void robot_metrics_rx(int robot, const uint8_t *data, size_t len);
+
+#endif
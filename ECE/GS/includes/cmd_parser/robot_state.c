@@ -0,0 +1,187 @@
+#include "robot_state.h"
+#include "cmd_parser.h"
+#include "report_json.h"
+#include "../json_uds/json_uds.h"
+#include "../metrics/metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum { RS_BATTERY, RS_MOTOR, RS_ARM, RS_SHTDWN, RS_POSITION, RS_FIELDS };
+
+typedef struct {
+  uint64_t t_ms[RS_FIELDS];                 // When each value was last heard, 0 = never
+  uint8_t  battery;
+  uint8_t  motor_en, arm_en, shtdwn;
+  robot_bt_packet_t nav;                    // Last NAV report word
+} robot_state_t;
+
+static robot_state_t g_state[BLE_LINKS_MAX];
+static uint64_t      g_max_ms = ROBOT_STATE_MAX_MS;
+
+static uint64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+void robot_state_setup(void) {
+  const char *max = getenv("GS_STATE_MAX_MS");
+  if (max && max[0]) g_max_ms = (uint64_t)strtoull(max, NULL, 10);
+}
+
+void robot_state_forget(int robot) {
+  if (robot >= 0 && robot < BLE_LINKS_MAX) memset(&g_state[robot], 0, sizeof(g_state[robot]));
+}
+
+void robot_state_report(int robot, const robot_bt_packet_t *w) {
+  if (robot < 0 || robot >= BLE_LINKS_MAX) return;
+  robot_state_t *s = &g_state[robot];
+  uint64_t now = now_ms();
+
+  switch (w->ctrl.type) {
+    case HEALTH_CMD:
+      if (w->health.unchanged) {              // Heartbeat: what we hold is still current
+        for (int f = RS_BATTERY; f <= RS_ARM; f++) if (s->t_ms[f]) s->t_ms[f] = now;
+        break;
+      }
+      s->battery  = w->health.battery;
+      s->motor_en = w->health.motor_en;
+      s->arm_en   = w->health.arm_en;
+      s->t_ms[RS_BATTERY] = s->t_ms[RS_MOTOR] = s->t_ms[RS_ARM] = now;
+      break;
+
+    case ROBOT_UPDATE_CMD:
+      if (w->nav.part != 0) break;
+      s->nav = *w;
+      s->t_ms[RS_POSITION] = now;
+      break;
+
+    case ACK_CMD:                             // State codes say the same whatever the result
+      switch (w->ack.instruction_specific) {
+        case MOTORS_ENABLED:  s->motor_en = 1; s->t_ms[RS_MOTOR]  = now; break;
+        case MOTORS_DISABLED: s->motor_en = 0; s->t_ms[RS_MOTOR]  = now; break;
+        case ARM_ENABLED:     s->arm_en = 1;   s->t_ms[RS_ARM]    = now; break;
+        case ARM_DISABLED:    s->arm_en = 0;   s->t_ms[RS_ARM]    = now; break;
+        case SHTDWN_ENABLED:                  // An e-stop drops both powers too
+          s->shtdwn = 1;
+          s->motor_en = s->arm_en = 0;
+          s->t_ms[RS_SHTDWN] = s->t_ms[RS_MOTOR] = s->t_ms[RS_ARM] = now;
+          break;
+        case SHTDWN_DISABLED: s->shtdwn = 0;   s->t_ms[RS_SHTDWN] = now; break;
+        default: break;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+// Age of a cached field in ms, or -1 if it is unknown or too old to use
+static int fresh_ms(const robot_state_t *s, int f, uint64_t now) {
+  if (!g_max_ms || !s->t_ms[f] || now - s->t_ms[f] > g_max_ms) return -1;
+  return (int)(now - s->t_ms[f]);
+}
+
+static void answer_ack(int robot, query_format_t q, uint8_t result, uint64_t info, int age_ms) {
+  robot_bt_packet_t ack = {0};
+  ack.ack.pl = q.pl;
+  ack.ack.type = ACK_CMD;
+  ack.ack.id = q.id;
+  ack.ack.result_code = result;
+  ack.ack.instruction_specific = info;
+  char js[REPORT_JSON_MAX];
+  int len = robot_report_json(ack, js, sizeof(js));
+  if (len > 0) robot_state_publish(robot, &ack, js, len, age_ms);
+}
+
+int robot_state_answer(int robot, query_format_t q) {
+  if (robot < 0 || robot >= BLE_LINKS_MAX) return 0;
+  const robot_state_t *s = &g_state[robot];
+  uint64_t now = now_ms();
+  int age;
+
+  switch (q.instruction) {
+    case CONNNECTION_STAT: {                  // The bridge holds the link
+      int up = ble_robots() > 1 ? ble_connected[robot] : connection_status;
+      answer_ack(robot, q, up ? RESULT_SUCCESS : RESULT_BT_NOT_INITIALIZED, NO_INFO, 0);
+      break;
+    }
+
+    case SECURITY_STATUS: {                   // ... and picked the suite
+      int level = security_levels[robot];
+      answer_ack(robot, q, RESULT_SUCCESS, level == SEC_PLAIN ? SECURITY_OFF :
+                 level == SEC_CHACHA20_POLY1305 ? SECURITY_ON_CHACHA : SECURITY_ON, 0);
+      break;
+    }
+
+    case ROBOT_NAME:                          // No room for a name in an ACK
+      answer_ack(robot, q, RESULT_UNSUPPORTED_CMD, NO_INFO, 0);
+      break;
+
+    case ROBOT_BATT:
+      if ((age = fresh_ms(s, RS_BATTERY, now)) < 0) return 0;
+      answer_ack(robot, q, RESULT_SUCCESS, s->battery, age);
+      break;
+
+    case MOTOR_STATUS:
+      if ((age = fresh_ms(s, RS_MOTOR, now)) < 0) return 0;
+      answer_ack(robot, q, RESULT_SUCCESS, s->motor_en ? MOTORS_ENABLED : MOTORS_DISABLED, age);
+      break;
+
+    case ARM_POWER:
+      if ((age = fresh_ms(s, RS_ARM, now)) < 0) return 0;
+      answer_ack(robot, q, RESULT_SUCCESS, s->arm_en ? ARM_ENABLED : ARM_DISABLED, age);
+      break;
+
+    case SHTDWN_STATUS:
+      if ((age = fresh_ms(s, RS_SHTDWN, now)) < 0) return 0;
+      answer_ack(robot, q, RESULT_SUCCESS, s->shtdwn ? SHTDWN_ENABLED : SHTDWN_DISABLED, age);
+      break;
+
+    case CURRENT_POSITION: {
+      if ((age = fresh_ms(s, RS_POSITION, now)) < 0) return 0;
+      char js[REPORT_JSON_MAX];
+      int len = robot_report_json(s->nav, js, sizeof(js));
+      if (len > 0) robot_state_publish(robot, &s->nav, js, len, age);
+      answer_ack(robot, q, RESULT_SUCCESS, NO_INFO, age);
+      break;
+    }
+
+    default:
+      return 0;
+  }
+  METRIC_INC(state_hits);
+  return 1;
+}
+
+// ACKs and HPR alerts queue like replies (never evicted); the rest is telemetry keyed per
+// robot and report kind, so a client that falls behind gets the latest of
+// each rather than a backlog. Queue and writev() only: a slow client never
+// stalls the loop.
+void robot_state_publish(int robot, const robot_bt_packet_t *w, const char *js, int len, int age_ms) {
+  if (len <= 2) return;                                    // "{}": nothing to tell
+  char out[REPORT_JSON_MAX + 48];                          // {"robot":N, + body + ,"cached_ms":N}
+  int n = 1;
+  out[0] = '{';
+  if (ble_robots() > 1) n += snprintf(out + n, sizeof(out) - (size_t)n, "\"robot\":%d,", robot);
+  memcpy(out + n, js + 1, (size_t)len - 2);                // Body without the braces
+  n += len - 2;
+  if (age_ms >= 0) n += snprintf(out + n, sizeof(out) - (size_t)n, ",\"cached_ms\":%d", age_ms);
+  out[n++] = '}';
+  out[n] = '\0';
+
+  if (w->ctrl.type == ACK_CMD) {
+    uds_tx_broadcast(out, UDS_TX_CMD, 0, UDS_TOPIC_ACKS, robot);
+  } else if (w->ctrl.type == HPR_CMD) {
+    uds_tx_broadcast(out, UDS_TX_CMD, 0, UDS_TOPIC_ALERTS, robot);
+  } else {
+    uint16_t key = (uint16_t)(1 + (((unsigned)robot & 0xFF) << 8 | (w->ctrl.type & 0xF) << 2 |
+                                   (w->ctrl.type == ROBOT_UPDATE_CMD ? w->nav.part : 0)));
+    uint32_t topic = w->ctrl.type == HEALTH_CMD ? UDS_TOPIC_HEALTH
+                   : w->ctrl.type == ROBOT_UPDATE_CMD ? UDS_TOPIC_IMU : UDS_TOPIC_OTHER;
+    uds_tx_broadcast(out, UDS_TX_TELEM, key, topic, robot);
+  }
+}
@@ -0,0 +1,33 @@
+#ifndef ROBOT_STATE_H
+#define ROBOT_STATE_H
+
+#include <stdint.h>
+#include "../cmd_structure.h"
+
+// ------------------------- Robot state cache -------------------------
+// What the bridge last heard from each robot and when. Fed by every decoded
+// report: HR (battery, motor and arm power), NAV (position) and ACKs whose
+// info is a state code (query replies, and system commands that change the
+// state). query_cmd() answers from here while the value is younger than
+// GS_STATE_MAX_MS (default ROBOT_STATE_MAX_MS) and only lets the query go
+// over the radio once it is older; GS_STATE_MAX_MS=0 turns the cache off.
+//
+// A cached answer is the ACK the robot would have sent, broadcast the same
+// way, with the age of the value it came from:
+//   {"type":"ACK","id":5,"result":0,"info":2,"cached_ms":140}
+// ROBOT_BATT puts the battery percentage in info; CURRENT_POSITION sends
+// the cached NAV report (with cached_ms) before its ACK. CONNNECTION_STAT,
+// SECURITY_STATUS and ROBOT_NAME are never sent to the robot: the bridge
+// knows the first two (cached_ms 0) and the robot cannot report the third.
+
+#define ROBOT_STATE_MAX_MS 2000             // HR arrives at least this often on a live link
+
+void robot_state_setup(void);                                  // Reads GS_STATE_MAX_MS
+void robot_state_report(int robot, const robot_bt_packet_t *w); // A decoded report word
+void robot_state_forget(int robot);                            // Link (re)established: nothing known
+int  robot_state_answer(int robot, query_format_t q);          // 1 = answered, don't send
+// Broadcasts a report's JSON (from robot_report_json) to every UDS client;
+// age_ms >= 0 marks it as served from the cache
+void robot_state_publish(int robot, const robot_bt_packet_t *w, const char *js, int len, int age_ms);
+
+#endif
@@ -0,0 +1,122 @@
+#include "traj_upload.h"
+#include "cmd_parser.h"
+#include "tx_sched.h"
+#include "../json_uds/json_uds.h"
+#include "../metrics/metrics.h"
+#include "../log/gs_log.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TRAJ_WHEELS 4                                      // v[]: fl, fr, bl, br
+
+_Static_assert(TRAJ_WORDS_MAX <= TX_FIFO_MAX, "a trajectory upload must fit in the tx_sched FIFO");
+
+// Integer member in [minv, maxv]; 0 = ok
+static int get_int(const cJSON *it, int minv, int maxv, int *out) {
+  if (!cJSON_IsNumber(it) || !(it->valuedouble >= minv && it->valuedouble <= maxv)) return -1;
+  if (it->valuedouble != (double)(int)it->valuedouble) return -1;
+  *out = (int)it->valuedouble;
+  return 0;
+}
+
+// n integers of an array, each in [minv, maxv]; 0 = ok
+static int get_ints(const cJSON *arr, int n, int minv, int maxv, int *out) {
+  if (!cJSON_IsArray(arr) || cJSON_GetArraySize(arr) != n) return -1;
+  const cJSON *it;
+  int i = 0;
+  cJSON_ArrayForEach(it, arr) {
+    if (get_int(it, minv, maxv, &out[i++]) != 0) return -1;
+  }
+  return 0;
+}
+
+// Segment i into its drive word and, with "arm", its arm word; returns the
+// words written to w (1 or 2), <0 if the segment is malformed
+static int pack_seg(const cJSON *seg, int i, int pl, robot_bt_packet_t *w) {
+  int ms, v[TRAJ_WHEELS], xyz[3], speed;
+  if (!cJSON_IsObject(seg)) return -1;
+  if (get_int(cJSON_GetObjectItemCaseSensitive(seg, "ms"), 1, 0xFFFF, &ms) != 0) return -1;
+  if (get_ints(cJSON_GetObjectItemCaseSensitive(seg, "v"), TRAJ_WHEELS, -100, 100, v) != 0) return -1;
+
+  memset(w, 0, 2 * sizeof(*w));
+  w[0].trajd.pl = pl;
+  w[0].trajd.type = TRAJ_CMD;
+  w[0].trajd.op = TRAJ_OP_DRIVE;
+  w[0].trajd.idx = i;
+  w[0].trajd.ms = ms;
+  w[0].trajd.fl = v[0];
+  w[0].trajd.fr = v[1];
+  w[0].trajd.bl = v[2];
+  w[0].trajd.br = v[3];
+
+  const cJSON *arm = cJSON_GetObjectItemCaseSensitive(seg, "arm");
+  if (!arm) return 1;
+  if (get_ints(arm, 3, -2048, 2047, xyz) != 0) return -1;
+  if (get_int(cJSON_GetObjectItemCaseSensitive(seg, "S"), 0, 100, &speed) != 0) return -1;
+  w[1].traja.pl = pl;
+  w[1].traja.type = TRAJ_CMD;
+  w[1].traja.op = TRAJ_OP_ARM;
+  w[1].traja.idx = i;
+  w[1].traja.speed = speed;
+  w[1].traja.x = xyz[0];
+  w[1].traja.y = xyz[1];
+  w[1].traja.z = xyz[2];
+  return 2;
+}
+
+static int traj_err(int uds_fd, const char *msg) {
+  char js[96];
+  METRIC_INC(cmd_rejects);
+  snprintf(js, sizeof(js), "{\"type\":\"ERR\",\"msg\":\"%s\"}", msg);
+  uds_send_json(uds_fd, js);
+  return 1;
+}
+
+int handle_traj_request(int uart_fd, int uds_fd, const cJSON *root) {
+  const cJSON *t = cJSON_GetObjectItemCaseSensitive(root, "T");
+  if (!cJSON_IsString(t) || strcmp(t->valuestring, "TRAJ") != 0) return 0;
+
+  int id, pl = 0;
+  const cJSON *pl_item = cJSON_GetObjectItemCaseSensitive(root, "PL");
+  if (get_int(cJSON_GetObjectItemCaseSensitive(root, "ID"), 1, 2047, &id) != 0) return traj_err(uds_fd, "bad TRAJ ID");
+  if (pl_item && get_int(pl_item, 0, 3, &pl) != 0) return traj_err(uds_fd, "bad TRAJ PL");
+
+  robot_bt_packet_t w[TRAJ_WORDS_MAX] = {0};
+  robot_bt_packet_t *ctl = &w[0];                          // Routes the lot; sent last
+  ctl->trajc.pl = pl;
+  ctl->trajc.type = TRAJ_CMD;
+  ctl->trajc.id = id;
+  if (cmd_route(ctl) < 0) return traj_err(uds_fd, "unknown robot");
+
+  int n = 0;                                               // Segment words, w[1..n]
+  if (cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(root, "abort"))) {
+    ctl->trajc.op = TRAJ_OP_ABORT;
+  } else {
+    const cJSON *segs = cJSON_GetObjectItemCaseSensitive(root, "segs"), *seg;
+    int count = cJSON_IsArray(segs) ? cJSON_GetArraySize(segs) : 0;
+    if (count < 1 || count > TRAJ_SEGS_MAX) return traj_err(uds_fd, "bad TRAJ segs");
+
+    uint16_t crc = 0xFFFF;
+    int i = 0;
+    cJSON_ArrayForEach(seg, segs) {
+      int k = pack_seg(seg, i++, pl, &w[1 + n]);
+      if (k < 0) return traj_err(uds_fd, "bad TRAJ segment");
+      for (int j = 1; j <= k; j++) crc = traj_crc(crc, w[n + j].raw);
+      n += k;
+    }
+    ctl->trajc.op = TRAJ_OP_RUN;
+    ctl->trajc.count = count;
+    ctl->trajc.crc = crc;
+  }
+  if (tx_sched_room() < n + 1) return traj_err(uds_fd, "TRAJ queue full");
+
+  for (int i = 1; i <= n; i++) tx_sched_submit(uart_fd, &w[i]);
+  tx_sched_submit(uart_fd, ctl);
+  LOG_INFO("TRAJ %d: robot %d, %d words, op %d", id, ble_route, n + 1, (int)ctl->trajc.op);
+
+  char js[128];
+  snprintf(js, sizeof(js), "{\"type\":\"TRAJ\",\"id\":%d,\"segs\":%d,\"words\":%d,\"crc\":%u}", id,
+           (int)ctl->trajc.count, n + 1, (unsigned)ctl->trajc.crc);
+  uds_send_json(uds_fd, js);
+  return 1;
+}
@@ -0,0 +1,29 @@
+#ifndef TRAJ_UPLOAD_H
+#define TRAJ_UPLOAD_H
+
+#include "cJSON.h"
+#include "../cmd_structure.h"
+
+// ------------------------- Trajectory upload -------------------------
+// One UDS request becomes a whole maneuver on the robot (cmd_codec.h,
+// Trajectory): the segment words, then a TRAJ_OP_RUN carrying their count
+// and traj_crc(). All of them queue in the robot's tx_sched FIFO back to
+// back, so they leave in as few batched writes as the link allows, and
+// the robot runs the segments on its own clock. Only RUN and ABORT carry
+// an id; their ACKs come back like any other command's.
+//
+//   {"T":"TRAJ","ID":n[,"PL":p],"segs":[{"ms":..,"v":[fl,fr,bl,br]
+//                                        [,"arm":[x,y,z],"S":speed]},..]}
+//   {"T":"TRAJ","ID":n,"abort":true}
+//
+// ms 1..65535, v -100..100 per wheel (drivetrain_set), arm in 0.01 in
+// (ARMT_UNITS_PER_IN) with S 0..100. ID picks the robot (ROBOT_OF_ID) as
+// it does for every command. Reply, once everything is queued:
+//   {"type":"TRAJ","id":n,"segs":k,"words":w,"crc":c}
+// or an ERR; nothing is sent unless the whole upload fits in the FIFO.
+
+#define TRAJ_WORDS_MAX  (TRAJ_SEGS_MAX * 2 + 1)
+
+int handle_traj_request(int uart_fd, int uds_fd, const cJSON *root);   // 0 = not a TRAJ request
+
+#endif
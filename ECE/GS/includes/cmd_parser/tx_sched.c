@@ -0,0 +1,547 @@
+#include "tx_sched.h"
+#include "cmd_parser.h"
+#include "cmd_trace.h"
+#include "ack_track.h"
+#include "clock_sync.h"
+#include "../metrics/metrics.h"
+#include "../json_uds/json_uds.h"
+#include "../log/gs_log.h"
+#include "../ble/pmod_esp32.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TX_FIFO_MASK (TX_FIFO_MAX - 1)
+#define TX_ADMIT_SRC       UDS_MAX_CLIENTS                 // Sources are bridge client slots
+#define TX_ADMIT_SAMPLE_MAX_US 500000ull                   // A longer write was an outage, not the link's pace
+#define TX_ADMIT_RATE_MIN  5.0                             // Words/s, whatever was measured
+
+enum { TX_SRC_NONE = -1, TX_SRC_FIFO, TX_SRC_CTRL, TX_SRC_ARM };
+
+typedef struct {
+  robot_bt_packet_t pkt;
+  int               full;
+  uint64_t          t_us;                                  // Submitted; the deadline runs from here
+} tx_slot_t;
+
+typedef struct {
+  double   tokens;
+  uint64_t t_us;                                           // Last refill, 0 = never (starts full)
+} tx_bucket_t;
+
+typedef struct {
+  tx_slot_t         ctrl, arm;                             // Latest-wins stream slots
+  robot_bt_packet_t fifo[TX_FIFO_MAX];                     // Lossless system/query words
+  uint64_t          fifo_t[TX_FIFO_MAX];
+  uint32_t          fhead, ftail;
+  tx_bucket_t       bucket;                                // Admission, shared by every source
+  uint64_t          t_write;                               // Last write, until the link was ready again
+  uint32_t          svc_us;                                // EWMA of that, 0 = not measured yet
+  double            cap_wps;                               // Words/s it allows
+  int               credit;                                // Words it can still take, -1 = not limited
+  int               credit_max;                            // Most it was granted since the link came up
+  uint64_t          credit_us;                             // Last advertisement, ACK or probe
+  uint32_t          win_us;                                // Batching window, 0 = write at once
+  uint64_t          hold_us;                               // Holding for it since, 0 = not holding
+  int               hold_n;                                // Words waiting when the hold began
+  uint64_t          t_sent;                                // Last write (t_write is cleared when ready)
+  int               admit_pct;                             // Share of cap_wps admitted (link quality)
+  uint32_t          win_floor_us;                          // Least window while loaded (link quality)
+} tx_robot_t;
+
+typedef struct {
+  tx_bucket_t bucket[BLE_LINKS_MAX];
+  uint64_t    last_us[BLE_LINKS_MAX];                      // Last stream word per robot (active share)
+  tx_slot_t   park[BLE_LINKS_MAX][2];                      // Over-budget CONTROL / ARM word per robot
+  uint32_t    admitted, shed;
+} tx_source_t;
+
+static int               g_inited  = 0;
+static int               g_uart_fd = -1;
+static tx_ready_fn       g_ready   = NULL;
+static tx_robot_t        g_rb[BLE_LINKS_MAX];              // Indexed by robot (conn_index)
+static int               g_rr      = 0;                    // Robot whose turn is next
+static tx_sched_stats_t  g_stats;
+static int               g_pumping = 0;                    // Send can re-enter via callbacks
+static tx_timer_fn       g_admit   = NULL;                 // Admission timer; NULL = admission off
+static int               g_src_cur = -1;                   // tx_sched_source()
+static tx_source_t       g_src[TX_ADMIT_SRC];
+static int               g_shed_dirty = 0;                 // Shed since the last ADMIT report
+static uint64_t          g_report_us = 0;
+static uint64_t          g_admit_due = 0;                  // Next parked-word release, 0 = none
+
+void tx_sched_init(int uart_fd, tx_ready_fn ready) {
+  g_uart_fd = uart_fd;
+  g_ready   = ready;
+  memset(g_rb, 0, sizeof(g_rb));
+  for (int rb = 0; rb < BLE_LINKS_MAX; rb++) {
+    tx_sched_credit_reset(rb);
+    g_rb[rb].admit_pct = TX_ADMIT_LINK_PCT;
+  }
+  g_rr = 0;
+  memset(&g_stats, 0, sizeof(g_stats));
+  memset(g_src, 0, sizeof(g_src));
+  g_admit = NULL;
+  g_src_cur = -1;
+  g_shed_dirty = 0;
+  g_admit_due = 0;
+  g_inited = 1;
+}
+
+const tx_sched_stats_t *tx_sched_stats(void) {
+  return &g_stats;
+}
+
+uint32_t tx_sched_window_us(int robot) {
+  if (robot < 0 || robot >= BLE_LINKS_MAX) return 0;
+  const tx_robot_t *b = &g_rb[robot];
+  return metrics_now_us() - b->t_sent > TX_BATCH_IDLE_MS * 1000ull ? 0 : b->win_us;
+}
+
+void tx_sched_link_quality(int robot, int admit_pct, uint32_t win_floor_us) {
+  if (robot < 0 || robot >= BLE_LINKS_MAX) return;
+  g_rb[robot].admit_pct = admit_pct;
+  g_rb[robot].win_floor_us = win_floor_us < TX_BATCH_WIN_MAX_US ? win_floor_us : TX_BATCH_WIN_MAX_US;
+}
+
+// ------------------------- Credits -------------------------
+
+void tx_sched_credit(int robot, const robot_bt_packet_t *word) {
+  if (robot < 0 || robot >= BLE_LINKS_MAX) return;
+  tx_robot_t *b = &g_rb[robot];
+  uint32_t adv;
+  if (word->ctrl.type == HEALTH_CMD) adv = word->health.credits;
+  else if (word->ctrl.type != ACK_CMD) return;
+  else if (word->ack.result_code == RESULT_ACK_RANGE) adv = ack_range_credits(word->raw);
+  else {                                                   // Its word's slot is free again
+    if (b->credit < 0) return;
+    if (b->credit < b->credit_max) b->credit++;
+    b->credit_us = metrics_now_us();
+    return;
+  }
+  if (adv == 0) return;                                    // Not advertised
+  int free = (int)adv - 1 - TX_CREDIT_RESERVE;
+  b->credit = free > 0 ? free : 0;
+  if (b->credit > b->credit_max) b->credit_max = b->credit;
+  b->credit_us = metrics_now_us();
+}
+
+void tx_sched_credit_reset(int robot) {
+  if (robot < 0 || robot >= BLE_LINKS_MAX) return;
+  g_rb[robot].credit = -1;
+  g_rb[robot].credit_max = 0;
+  g_rb[robot].win_us = 0;
+  g_rb[robot].hold_us = 0;
+}
+
+static int stream_put(tx_slot_t *s, const robot_bt_packet_t *packet, uint64_t now) {
+  if (s->full) g_stats.coalesced++;
+  s->pkt  = *packet;
+  s->full = 1;
+  s->t_us = now;
+  return 0;
+}
+
+static int stream_type(int type) {
+  return type == CONTROL_CMD || type == ARM_CMD;
+}
+
+// Submit time t_us plus the budget of the word's class
+static uint64_t deadline(const robot_bt_packet_t *p, uint64_t t_us) {
+  return t_us + (stream_type(p->ctrl.type) ? TX_STREAM_STALE_MS : TX_FIFO_STALE_MS) * 1000ull;
+}
+
+static void stale_drop(const robot_bt_packet_t *p) {
+  g_stats.stale++;
+  METRIC_INC(tx_stale_drops);
+  if (stream_type(p->ctrl.type)) METRIC_INC(expired_queued);
+}
+
+// ------------------------- Admission -------------------------
+
+void tx_sched_admit(tx_timer_fn arm_timer) {
+  g_admit = arm_timer;
+  g_report_us = metrics_now_us();
+}
+
+void tx_sched_source(int src) {
+  g_src_cur = (src >= 0 && src < TX_ADMIT_SRC) ? src : -1;
+}
+
+static void shed(tx_source_t *s, tx_slot_t *pk) {
+  pk->full = 0;
+  s->shed++;
+  g_stats.shed++;
+  g_shed_dirty = 1;
+}
+
+void tx_sched_source_close(int src) {
+  if (src < 0 || src >= TX_ADMIT_SRC) return;
+  tx_source_t *s = &g_src[src];
+  for (int rb = 0; rb < BLE_LINKS_MAX; rb++)
+    for (int k = 0; k < 2; k++)
+      if (s->park[rb][k].full) shed(s, &s->park[rb][k]);
+  uint32_t n = s->shed;
+  memset(s, 0, sizeof(*s));
+  s->shed = n;                                             // Still reported once
+  if (g_src_cur == src) g_src_cur = -1;
+}
+
+static double robot_rate(const tx_robot_t *b) {
+  double r = b->svc_us ? b->cap_wps * b->admit_pct / 100.0 : TX_ADMIT_RATE_INIT;
+  return r < TX_ADMIT_RATE_MIN ? TX_ADMIT_RATE_MIN : r;
+}
+
+static void refill(tx_bucket_t *k, double rate, uint64_t now) {
+  if (!k->t_us) k->tokens = TX_ADMIT_BURST;
+  else k->tokens += rate * (double)(now - k->t_us) / 1e6;
+  if (k->tokens > TX_ADMIT_BURST) k->tokens = TX_ADMIT_BURST;
+  k->t_us = now;
+}
+
+// Sources that sent robot rb a stream word lately; at least 1
+static int active(int rb, uint64_t now) {
+  int n = 0;
+  for (int i = 0; i < TX_ADMIT_SRC; i++)
+    n += g_src[i].last_us[rb] && now - g_src[i].last_us[rb] <= TX_ADMIT_ACTIVE_MS * 1000ull;
+  return n ? n : 1;
+}
+
+// Takes a token from both buckets, or neither; returns 0 when over budget
+// and sets *wait_us to when both will have one
+static int admit_take(int src, int rb, uint64_t now, uint64_t *wait_us) {
+  tx_bucket_t *rk = &g_rb[rb].bucket, *sk = &g_src[src].bucket[rb];
+  double rate = robot_rate(&g_rb[rb]), share = rate / active(rb, now);
+  refill(rk, rate, now);
+  refill(sk, share, now);
+  if (rk->tokens >= 1 && sk->tokens >= 1) {
+    rk->tokens -= 1;
+    sk->tokens -= 1;
+    g_src[src].admitted++;
+    return 1;
+  }
+  double w = 0;
+  if (rk->tokens < 1) w = (1 - rk->tokens) / rate;
+  if (sk->tokens < 1 && (1 - sk->tokens) / share > w) w = (1 - sk->tokens) / share;
+  *wait_us = (uint64_t)(w * 1e6) + 1;
+  return 0;
+}
+
+static void admit_report(uint64_t now) {
+  if (!g_shed_dirty || now - g_report_us < TX_ADMIT_REPORT_MS * 1000ull) return;
+  char js[UDS_TX_SLOT_MAX];
+  int n = snprintf(js, sizeof(js), "{\"type\":\"ADMIT\",\"cap_wps\":[");
+  int robots = ble_robots() < 1 ? 1 : ble_robots();
+  for (int rb = 0; rb < robots && rb < BLE_LINKS_MAX; rb++)
+    n += snprintf(js + n, sizeof(js) - (size_t)n, "%s%.0f", rb ? "," : "", robot_rate(&g_rb[rb]));
+  n += snprintf(js + n, sizeof(js) - (size_t)n, "],\"clients\":[");
+  int first = 1;
+  for (int i = 0; i < TX_ADMIT_SRC; i++) {
+    if (!g_src[i].admitted && !g_src[i].shed) continue;
+    n += snprintf(js + n, sizeof(js) - (size_t)n, "%s[%d,%u,%u]", first ? "" : ",", i,
+                  (unsigned)g_src[i].admitted, (unsigned)g_src[i].shed);
+    first = 0;
+  }
+  n += snprintf(js + n, sizeof(js) - (size_t)n, "]}");
+  if (n > 0 && (size_t)n < sizeof(js)) uds_tx_broadcast(js, UDS_TX_TELEM, 0, UDS_TOPIC_METRICS, UDS_ROBOT_ANY);
+  g_shed_dirty = 0;
+  g_report_us = now;
+}
+
+// One timer serves admission and batching windows: the earlier of the two
+static void timer_arm(uint64_t now) {
+  uint64_t due = g_admit_due;
+  for (int rb = 0; rb < BLE_LINKS_MAX; rb++) {
+    const tx_robot_t *b = &g_rb[rb];
+    uint64_t end = b->hold_us + b->win_us;                 // One run out flushes on the next pump
+    if (b->hold_us && end > now && (!due || end < due)) due = end;
+  }
+  if (!due) { g_admit(0); return; }
+  g_admit(due > now ? (int)((due - now + 999) / 1000) : 1);
+}
+
+// Parked words whose tokens are back go to their robot's slot (stale ones
+// are shed); then the timer is armed for the next one, or the report
+static void admit_release(uint64_t now) {
+  if (!g_admit) return;
+  uint64_t next = UINT64_MAX, wait;
+  for (int i = 0; i < TX_ADMIT_SRC; i++) {
+    tx_source_t *s = &g_src[i];
+    for (int rb = 0; rb < BLE_LINKS_MAX; rb++) {
+      for (int k = 0; k < 2; k++) {
+        tx_slot_t *pk = &s->park[rb][k];
+        if (!pk->full) continue;
+        if (now > deadline(&pk->pkt, pk->t_us)) { METRIC_INC(expired_queued); shed(s, pk); continue; }
+        if (!admit_take(i, rb, now, &wait)) { if (wait < next) next = wait; continue; }
+        stream_put(k ? &g_rb[rb].arm : &g_rb[rb].ctrl, &pk->pkt, pk->t_us);
+        pk->full = 0;
+      }
+    }
+  }
+  admit_report(now);
+  if (g_shed_dirty) {
+    uint64_t due = g_report_us + TX_ADMIT_REPORT_MS * 1000ull;
+    uint64_t w = due > now ? due - now : 1;
+    if (w < next) next = w;
+  }
+  g_admit_due = next == UINT64_MAX ? 0 : now + next;
+  timer_arm(now);
+}
+
+// 1 = into the slot now; 0 = parked (the source's previous parked word shed)
+static int admit(int rb, int arm, const robot_bt_packet_t *packet, uint64_t now) {
+  if (!g_admit || g_src_cur < 0) return 1;
+  tx_source_t *s = &g_src[g_src_cur];
+  tx_slot_t *pk = &s->park[rb][arm];
+  uint64_t wait;
+  s->last_us[rb] = now;
+  if (!pk->full && admit_take(g_src_cur, rb, now, &wait)) return 1;
+  if (pk->full) shed(s, pk);
+  pk->pkt  = *packet;
+  pk->full = 1;
+  pk->t_us = now;
+  admit_release(now);                                      // Arms the timer
+  return 0;
+}
+
+void tx_sched_timer(void) {
+  admit_release(metrics_now_us());
+  tx_sched_pump();
+}
+
+// FIFO entries are in submit order, and a FIFO word's deadline is never
+// before the one of a word behind it, so only the head needs checking
+static void prune(tx_robot_t *b, uint64_t now) {
+  if (b->ctrl.full && now > deadline(&b->ctrl.pkt, b->ctrl.t_us)) { b->ctrl.full = 0; stale_drop(&b->ctrl.pkt); }
+  if (b->arm.full  && now > deadline(&b->arm.pkt, b->arm.t_us))   { b->arm.full  = 0; stale_drop(&b->arm.pkt); }
+  while (b->fhead != b->ftail) {
+    uint32_t h = b->fhead & TX_FIFO_MASK;
+    if (now <= deadline(&b->fifo[h], b->fifo_t[h])) break;
+    b->fhead++;
+    stale_drop(&b->fifo[h]);
+  }
+}
+
+// E-stop: drive and arm words still waiting are dropped (the robot would
+// refuse them now), and the stop is written at once, readiness or not;
+// TRANSPORT_URGENT puts it ahead of whatever the modem has queued. Only if
+// that write fails does it wait, at the head of the FIFO.
+static int estop(int uart_fd, tx_robot_t *b, const robot_bt_packet_t *packet, uint64_t now) {
+  METRIC_INC(estops);
+  if (b->ctrl.full) g_stats.coalesced++;
+  if (b->arm.full)  g_stats.coalesced++;
+  b->ctrl.full = b->arm.full = 0;
+  for (int i = 0; i < TX_ADMIT_SRC; i++)                   // Nor may a parked one follow the stop
+    for (int k = 0; k < 2; k++)
+      if (g_src[i].park[ble_route][k].full) shed(&g_src[i], &g_src[i].park[ble_route][k]);
+
+  robot_bt_packet_t p = *packet;
+  if (robot_send_packet(uart_fd, &p) >= 0) {
+    g_stats.sent++;
+    return 0;
+  }
+  LOG_WARN("TX: robot %d e-stop not written, holding it first in line", ble_route);
+  if (b->ftail - b->fhead == TX_FIFO_MAX) { b->ftail--; g_stats.fifo_full++; }   // Newest word makes room
+  b->fhead--;
+  b->fifo_t[b->fhead & TX_FIFO_MASK] = now;
+  b->fifo[b->fhead & TX_FIFO_MASK] = *packet;
+  return 0;
+}
+
+static int enqueue(int uart_fd, const robot_bt_packet_t *packet) {
+  if (!g_inited) {                                         // No scheduler: send inline
+    robot_bt_packet_t p = *packet;
+    return robot_send_packet(uart_fd, &p);
+  }
+
+  int r = 0;
+  uint64_t now = metrics_now_us();
+  tx_robot_t *b = &g_rb[ble_route];
+  if (cmd_word_is_estop(packet->raw)) return estop(uart_fd, b, packet, now);
+  switch (packet->ctrl.type) {
+    case CONTROL_CMD:
+      if (!admit(ble_route, 0, packet, now)) return 0;
+      r = stream_put(&b->ctrl, packet, now);
+      break;
+    case ARM_CMD:
+      if (!admit(ble_route, 1, packet, now)) return 0;
+      r = stream_put(&b->arm, packet, now);
+      break;
+    default:
+      if (b->ftail - b->fhead == TX_FIFO_MAX) prune(b, now);
+      if (b->ftail - b->fhead == TX_FIFO_MAX) { g_stats.fifo_full++; return -1; }
+      b->fifo_t[b->ftail & TX_FIFO_MASK] = now;
+      b->fifo[b->ftail++ & TX_FIFO_MASK] = *packet;
+      break;
+  }
+  tx_sched_pump();
+  return r;
+}
+
+int tx_sched_submit(int uart_fd, const robot_bt_packet_t *packet) {
+  robot_bt_packet_t tagged = *packet;
+  clock_sync_stamp(&tagged, ble_route);                    // No-op unless GS_EXEC_DELAY_MS
+  cmd_trace_tag(&tagged);                                  // No-op unless GS_TRACE=1
+  ack_track_tag(&tagged, ble_route);
+  return enqueue(uart_fd, &tagged);
+}
+
+int tx_sched_room(void) {
+  if (!g_inited) return TX_FIFO_MAX;                       // Sent inline
+  const tx_robot_t *b = &g_rb[ble_route];
+  return TX_FIFO_MAX - (int)(b->ftail - b->fhead);
+}
+
+int tx_sched_retry(int robot, const robot_bt_packet_t *packet) {
+  int route = ble_route, src = g_src_cur;
+  ble_route = robot;
+  g_src_cur = -1;                                          // Admitted once already
+  int r = enqueue(g_uart_fd, packet);                      // Already tagged
+  g_src_cur = src;
+  ble_route = route;
+  return r;
+}
+
+// 1 = pl, then deadline, put the candidate ahead of the best so far
+static int ahead(const robot_bt_packet_t *p, uint64_t t_us, int best_pl, uint64_t best_dl) {
+  return (int)p->ctrl.pl > best_pl || ((int)p->ctrl.pl == best_pl && deadline(p, t_us) < best_dl);
+}
+
+// Highest pl, then earliest deadline
+static int pick(const tx_robot_t *b) {
+  int best = TX_SRC_NONE, best_pl = -1;
+  uint64_t best_dl = UINT64_MAX;
+
+  if (b->fhead != b->ftail) {
+    uint32_t h = b->fhead & TX_FIFO_MASK;
+    best = TX_SRC_FIFO;
+    best_pl = b->fifo[h].ctrl.pl;
+    best_dl = deadline(&b->fifo[h], b->fifo_t[h]);
+  }
+  if (b->ctrl.full && ahead(&b->ctrl.pkt, b->ctrl.t_us, best_pl, best_dl)) {
+    best = TX_SRC_CTRL;
+    best_pl = b->ctrl.pkt.ctrl.pl;
+    best_dl = deadline(&b->ctrl.pkt, b->ctrl.t_us);
+  }
+  if (b->arm.full && ahead(&b->arm.pkt, b->arm.t_us, best_pl, best_dl)) best = TX_SRC_ARM;
+  return best;
+}
+
+static int take(tx_robot_t *b, robot_bt_packet_t *p) {
+  switch (pick(b)) {
+    case TX_SRC_FIFO: *p = b->fifo[b->fhead++ & TX_FIFO_MASK]; return 1;
+    case TX_SRC_CTRL: *p = b->ctrl.pkt; b->ctrl.full = 0; return 1;
+    case TX_SRC_ARM:  *p = b->arm.pkt;  b->arm.full  = 0; return 1;
+    default: return 0;
+  }
+}
+
+// Words waiting for robot rb; *urgent = one of them is pl 3
+static int pending(const tx_robot_t *b, int *urgent) {
+  int n = (int)(b->ftail - b->fhead) + b->ctrl.full + b->arm.full;
+  *urgent = (b->ctrl.full && b->ctrl.pkt.ctrl.pl == 3) || (b->arm.full && b->arm.pkt.ctrl.pl == 3);
+  for (uint32_t i = b->fhead; i != b->ftail && !*urgent; i++)
+    *urgent = b->fifo[i & TX_FIFO_MASK].ctrl.pl == 3;
+  return n;
+}
+
+// The window follows the backlog: a write that left words behind (or went
+// out full) doubles it; one that carried a lone word, or a hold that
+// gathered nothing, halves it, down to 0. It never passes half the link's
+// service time (a longer wait costs more than the write it saves) nor
+// TX_BATCH_WIN_MAX_US. A degraded link keeps at least win_floor_us while
+// it is open.
+static void window_adapt(tx_robot_t *b, int n, int max, int gathered) {
+  int urgent, left = pending(b, &urgent);
+  uint32_t cap = b->svc_us / 2;
+  if (cap > TX_BATCH_WIN_MAX_US) cap = TX_BATCH_WIN_MAX_US;
+  if (left > 0 || (n == max && max > 1)) b->win_us = b->win_us ? b->win_us * 2 : TX_BATCH_WIN_STEP_US;
+  else if (n == 1 || gathered == 0) b->win_us /= 2;
+  if (b->win_us > cap) b->win_us = cap;
+  if (b->win_us < TX_BATCH_WIN_STEP_US) b->win_us = 0;
+  else if (b->win_us < b->win_floor_us) b->win_us = b->win_floor_us;
+}
+
+// 1 = hold robot rb's words for its window: fewer than a full write are
+// waiting, none urgent, and the window has not run out. The timer flushes
+// what gathered when it does.
+static int window_hold(tx_robot_t *b, int max, uint64_t now) {
+  int urgent, n = pending(b, &urgent);
+  if (n == 0) { b->hold_us = 0; return 0; }
+  if (now - b->t_sent > TX_BATCH_IDLE_MS * 1000ull) b->win_us = 0;   // The backlog is long gone
+  if (!b->win_us || !g_admit || urgent || n >= max) return 0;
+  if (!b->hold_us) {
+    b->hold_us = now;
+    b->hold_n  = n;
+    timer_arm(now);
+  }
+  return now - b->hold_us < b->win_us;
+}
+
+// One write (a word, or a batch of what is pending) to robot rb if its link
+// is ready; 0 = nothing sent
+static int send_one(int rb) {
+  tx_robot_t *b = &g_rb[rb];
+  robot_bt_packet_t p[ROBOT_BATCH_MAX];
+
+  ble_route = rb;
+  if (g_ready && !g_ready()) return 0;
+  uint64_t now = metrics_now_us();
+  int max = robot_batch_max(), n = 0;
+  if (b->t_write && g_ready) {                             // The last write is done: the link's pace
+    uint64_t dt = now - b->t_write;
+    if (dt < 100) dt = 100;
+    if (dt <= TX_ADMIT_SAMPLE_MAX_US) {
+      b->svc_us  = b->svc_us ? (uint32_t)((7ull * b->svc_us + dt) / 8) : (uint32_t)dt;
+      b->cap_wps = max * 1e6 / b->svc_us;
+    }
+    b->t_write = 0;
+  }
+  prune(b, now);
+  if (b->credit == 0 && now - b->credit_us > TX_CREDIT_STALE_MS * 1000ull) {
+    b->credit = 1;                                         // Probe: what would have freed it may be lost
+    b->credit_us = now;
+  }
+  if (b->credit >= 0 && max > b->credit) max = b->credit;
+  if (max == 0) {
+    if (pick(b) != TX_SRC_NONE) g_stats.credit_waits++;
+    return 0;
+  }
+  if (window_hold(b, max, now)) return 0;
+  while (n < max && take(b, &p[n])) n++;
+  if (n == 0) return 0;
+  int gathered = -1;                                       // Words that came in while held; -1 = not held
+  if (b->hold_us) {
+    gathered = n > b->hold_n ? n - b->hold_n : 0;
+    g_stats.held++;
+    METRIC_OBSERVE(tx_batch_wait_us, now - b->hold_us);
+    b->hold_us = 0;
+  }
+  METRIC_OBSERVE(tx_batch_words, (uint64_t)n);
+  window_adapt(b, n, max, gathered);
+  if (b->credit > 0) b->credit -= n;
+  if (robot_send_batch(g_uart_fd, p, n) < 0)
+    LOG_WARN("TX: robot %d type %u word%s not sent", rb, (unsigned)p[0].ctrl.type, n > 1 ? "s" : "");
+  else b->t_write = metrics_now_us();
+  b->t_sent = now;
+  g_stats.sent += n;
+  if (n > 1) g_stats.batched++;
+  return 1;
+}
+
+void tx_sched_pump(void) {
+  if (!g_inited || g_pumping) return;
+  g_pumping = 1;
+
+  int route = ble_route;
+  int n = ble_robots();
+  if (n < 1) n = 1;
+  int idle = 0;                                            // Robots passed over since the last send
+  while (idle < n) {
+    int rb = g_rr % n;
+    g_rr = rb + 1;
+    if (send_one(rb)) idle = 0;
+    else idle++;
+  }
+  ble_route = route;
+  g_pumping = 0;
+}
@@ -0,0 +1,125 @@
+#ifndef TX_SCHED_H
+#define TX_SCHED_H
+
+#include <stdint.h>
+#include "../cmd_structure.h"
+
+// ------------------------- Robot TX scheduler -------------------------
+// Sits between command dispatch and the BLE link:
+//   CONTROL / ARM   one slot per stream, latest word wins (held key repeats
+//                   replace the pending word instead of queueing behind it)
+//   SYSTEM / QUERY  lossless FIFO, strict order
+// Whenever the link can take a word, the candidate with the highest pl
+// (3 = most urgent) goes next; ties go to the earliest deadline, then FIFO,
+// CONTROL, ARM. A word's deadline is its submit time plus its class's
+// budget: TX_STREAM_STALE_MS for CONTROL / ARM (the robot's own motion
+// deadline, cmd_codec.h), TX_FIFO_STALE_MS for the rest. Only the FIFO's
+// head competes, so SYSTEM / QUERY keep their order.
+// Words are kept in plaintext and encrypted only when they are sent.
+// While the link is down words wait here; anything past its deadline is
+// dropped instead of being sent late on reconnect (tx_stale_drops; motion
+// words also count as expired_queued). The modem's AT queue holds no robot
+// word behind another command (the link is ready only when it is empty), so
+// nothing ages there; the robot drops what reaches it too late.
+// With several robots (ble_robots() > 1) every robot has its own slots and
+// FIFO, filled for the robot ble_route selects at submit time; the pump
+// gives robots one write per turn round-robin, so a robot with a deep FIFO
+// cannot starve the others' motion words on the shared modem.
+// When words have piled up behind a busy link, the write drains up to
+// robot_batch_max() of them at once, in pick order (one seal, one write).
+// Under sustained load a robot's link also gets a batching window: with
+// fewer than a full write waiting, the ready link holds them up to win_us
+// for more to arrive. The window starts at 0 (an idle link writes each word
+// at once), doubles from TX_BATCH_WIN_STEP_US after every write that left
+// words behind or went out full, halves after one that carried a lone word
+// or a hold that gathered nothing, and is capped at half the link's
+// measured service time and TX_BATCH_WIN_MAX_US; TX_BATCH_IDLE_MS without a
+// write resets it. pl 3 words are never held, nor is anything while
+// admission (its timer) is off.
+// Link quality (link_quality.h) raises a degraded robot's floor: once its
+// window has opened it does not close below win_floor_us until the link
+// goes idle, so a busy lossy link sends fewer, fuller writes.
+// Words per write and time held go to the tx_batch_words / tx_batch_wait_us
+// histograms, the first robot's window to the tx_batch_window_us gauge.
+// Words the robot does not ACK in time come back through tx_sched_retry()
+// (ack_track.h) and queue like any other word of their type.
+// An e-stop (cmd_word_is_estop) does not queue: it empties the robot's
+// CONTROL / ARM slots and is written at once, ahead of the modem's queue.
+//
+// Credits (tx_sched_credit()): a robot that advertises them (health.credits,
+// an ACK range's top bits; cmd_codec.h) gets at most that many words, less
+// TX_CREDIT_RESERVE for words still on their way. Each word written takes
+// one, each single ACK gives one back (the robot frees a word's slot as it
+// ACKs it; never past the most granted), and every advertisement resets the
+// count. Meanwhile CONTROL / ARM keep coalescing in their slots and the
+// FIFO waits.
+// E-stops take no credit. A robot that never advertised (older firmware, or
+// a link that just came up) is not limited. One left at 0 for
+// TX_CREDIT_STALE_MS gets a single word as a probe, in case what would have
+// freed it was lost; its ACK, or the next advertisement, goes on from there.
+//
+// Admission (tx_sched_admit(); the bridge turns it on unless GS_ADMIT=0):
+// CONTROL / ARM words pass two token buckets before they reach a slot, one
+// for their source (tx_sched_source(): the bridge client whose frame is
+// being dispatched) and one for their robot. A robot's bucket refills at
+// TX_ADMIT_LINK_PCT (less on a degraded link, tx_sched_link_quality()) of
+// its link's measured capacity: robot_batch_max()
+// words per write over the EWMA of the time from a write to the link being
+// ready again (TX_ADMIT_RATE_INIT until the first write). Every source that
+// sent stream words within TX_ADMIT_ACTIVE_MS gets an equal share of that.
+// Over budget, the word is parked as the source's latest of its stream,
+// replacing (shedding) any word parked before, and enters the slot when
+// tokens come back. SYSTEM / QUERY words, e-stops, retries and the bridge's
+// own words (source -1) are always admitted and take no tokens. Every
+// TX_ADMIT_REPORT_MS in which something was shed, the counts go to UDS
+// clients on the "metrics" topic:
+//   {"type":"ADMIT","cap_wps":[per robot],"clients":[[src,admitted,shed],..]}
+
+#define TX_FIFO_MAX         128           // Power of two; holds a whole trajectory upload (traj_upload.h)
+#define TX_STREAM_STALE_MS  MOTION_DEADLINE_MS   // CONTROL / ARM: a late motion word is worse than none
+#define TX_FIFO_STALE_MS    5000          // SYSTEM / QUERY
+
+#define TX_CREDIT_RESERVE   4             // Words an advertisement may not have seen yet
+#define TX_CREDIT_STALE_MS  500
+
+#define TX_BATCH_WIN_STEP_US 1000         // Smallest window; the timer counts whole ms
+#define TX_BATCH_WIN_MAX_US  8000
+#define TX_BATCH_IDLE_MS     100
+
+#define TX_ADMIT_LINK_PCT   80            // Of measured capacity; the rest is headroom for SYSTEM / QUERY
+#define TX_ADMIT_RATE_INIT  50            // Words/s per robot until a write has been timed
+#define TX_ADMIT_BURST      4             // Bucket depth, words
+#define TX_ADMIT_ACTIVE_MS  1000          // A source shares the link this long after its last word
+#define TX_ADMIT_REPORT_MS  1000
+
+typedef int (*tx_ready_fn)(void);         // 1 = the ble_route link can take a word now
+
+typedef struct {
+  uint32_t sent;
+  uint32_t coalesced;                     // Stream words replaced before sending
+  uint32_t fifo_full;                     // Lossless words rejected
+  uint32_t stale;                         // Words dropped past their staleness limit
+  uint32_t batched;                       // Writes that carried more than one word
+  uint32_t shed;                          // Parked stream words replaced or gone stale (admission)
+  uint32_t credit_waits;                  // Pump passes that held words back for want of credit
+  uint32_t held;                          // Writes that waited for a batching window
+} tx_sched_stats_t;
+
+typedef void (*tx_timer_fn)(int ms);      // Arms (ms > 0) or disarms (0) a one-shot timer
+
+void tx_sched_init(int uart_fd, tx_ready_fn ready);
+int  tx_sched_submit(int uart_fd, const robot_bt_packet_t *packet);
+int  tx_sched_retry(int robot, const robot_bt_packet_t *packet);  // ack_track.h resend, id kept
+int  tx_sched_room(void);                                          // Free FIFO slots for ble_route
+void tx_sched_pump(void);
+void tx_sched_credit(int robot, const robot_bt_packet_t *word);   // Every report word, before expansion
+void tx_sched_credit_reset(int robot);                             // The link (re)connected
+const tx_sched_stats_t *tx_sched_stats(void);
+uint32_t tx_sched_window_us(int robot);                            // Its batching window now
+void tx_sched_link_quality(int robot, int admit_pct, uint32_t win_floor_us);
+void tx_sched_admit(tx_timer_fn arm_timer);                        // After tx_sched_init
+void tx_sched_source(int src);                                     // -1 = the bridge itself
+void tx_sched_source_close(int src);                               // Its parked words are shed
+void tx_sched_timer(void);                                         // The arm_timer timer fired
+
+#endif
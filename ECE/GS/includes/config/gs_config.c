@@ -0,0 +1,189 @@
+#include "gs_config.h"
+#include "../log/gs_log.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  const char  *key;
+  gs_config_fn fn;
+} cfg_hot_t;
+
+typedef struct {
+  char key[64];
+  char value[CONFIG_VALUE_MAX];
+} cfg_pending_t;
+
+enum { LIST_APPLIED, LIST_PENDING, LIST_RESTART, LIST_INVALID, LISTS };
+
+static char          g_path_buf[256];
+static const char   *g_path = NULL;
+static cfg_hot_t     g_hot[CONFIG_HOT_MAX];
+static int           g_nhot = 0;
+static cfg_pending_t g_pending[CONFIG_PENDING_MAX];
+static int           g_npending = 0;
+static char          g_list[LISTS][512];                   // Reply lists: "\"K\",\"K\""
+static const char   *g_list_names[LISTS] = { "applied", "pending", "restart", "invalid" };
+
+static void list_add(int list, const char *key) {
+  size_t n = strlen(g_list[list]);
+  snprintf(g_list[list] + n, sizeof(g_list[list]) - n, "%s\"%s\"", n ? "," : "", key);
+}
+
+static int key_ok(const char *k) {
+  if (!k[0] || strlen(k) >= sizeof(g_pending[0].key)) return 0;
+  for (; *k; k++) if (!(isupper((unsigned char)*k) || isdigit((unsigned char)*k) || *k == '_')) return 0;
+  return 1;
+}
+
+// Echoed unescaped in replies: no quotes, backslashes or control bytes
+static int value_ok(const char *v) {
+  if (strlen(v) >= CONFIG_VALUE_MAX) return 0;
+  for (; *v; v++) if (*v == '"' || *v == '\\' || (unsigned char)*v < 0x20) return 0;
+  return 1;
+}
+
+static char *trim(char *s) {
+  while (isspace((unsigned char)*s)) s++;
+  char *e = s + strlen(s);
+  while (e > s && isspace((unsigned char)e[-1])) *--e = '\0';
+  return s;
+}
+
+// Calls fn(key, value) for every setting in the file
+static int read_file(void (*fn)(const char *key, const char *value)) {
+  FILE *f = fopen(g_path, "r");
+  if (!f) return -1;
+  char line[512];
+  int n = 0;
+  while (fgets(line, sizeof(line), f)) {
+    char *s = trim(line), *eq = strchr(s, '=');
+    if (!s[0] || s[0] == '#' || !eq) continue;
+    *eq = '\0';
+    char *key = trim(s), *value = trim(eq + 1);
+    size_t vl = strlen(value);
+    if (vl >= 2 && (value[0] == '"' || value[0] == '\'') && value[vl - 1] == value[0]) {
+      value[vl - 1] = '\0';
+      value++;
+    }
+    if (!key_ok(key) || !value_ok(value)) continue;
+    fn(key, value);
+    n++;
+  }
+  fclose(f);
+  return n;
+}
+
+static void load_one(const char *key, const char *value) {
+  setenv(key, value, 1);
+}
+
+int gs_config_load(void) {
+  const char *path = getenv("GS_CONFIG");
+  if (!path || !path[0]) return 0;
+  snprintf(g_path_buf, sizeof(g_path_buf), "%s", path);    // The file may set GS_CONFIG itself
+  g_path = g_path_buf;
+  return read_file(load_one);
+}
+
+const char *gs_config_path(void) {
+  return g_path;
+}
+
+void gs_config_hot(const char *key, gs_config_fn fn) {
+  if (g_nhot < CONFIG_HOT_MAX) g_hot[g_nhot++] = (cfg_hot_t){ key, fn };
+}
+
+static const cfg_hot_t *hot_of(const char *key) {
+  for (int i = 0; i < g_nhot; i++) if (strcmp(g_hot[i].key, key) == 0) return &g_hot[i];
+  return NULL;
+}
+
+static cfg_pending_t *pending_of(const char *key) {
+  for (int i = 0; i < g_npending; i++) if (strcmp(g_pending[i].key, key) == 0) return &g_pending[i];
+  return NULL;
+}
+
+static void pending_drop(cfg_pending_t *p) {
+  *p = g_pending[--g_npending];
+}
+
+int gs_config_set(const char *key, const char *value) {
+  if (!key_ok(key) || !value_ok(value)) {
+    list_add(LIST_INVALID, key_ok(key) ? key : "?");
+    return CFG_INVALID;
+  }
+  const cfg_hot_t *h = hot_of(key);
+  cfg_pending_t *p = pending_of(key);
+  int r = h ? h->fn(value) : CFG_RESTART;
+  if (r == CFG_PENDING) {
+    if (!p && g_npending == CONFIG_PENDING_MAX) r = CFG_INVALID;
+    else {
+      if (!p) p = &g_pending[g_npending++];
+      snprintf(p->key, sizeof(p->key), "%s", key);
+      snprintf(p->value, sizeof(p->value), "%s", value);
+    }
+  } else if (p) {
+    pending_drop(p);                                       // A newer value took its place
+  }
+  if (r == CFG_APPLIED || r == CFG_RESTART) setenv(key, value, 1);
+  list_add(r == CFG_APPLIED ? LIST_APPLIED : r == CFG_PENDING ? LIST_PENDING
+           : r == CFG_RESTART ? LIST_RESTART : LIST_INVALID, key);
+  return r;
+}
+
+static void reload_one(const char *key, const char *value) {
+  const char *now = getenv(key);
+  cfg_pending_t *p = pending_of(key);
+  if (p ? strcmp(p->value, value) == 0 : (now && strcmp(now, value) == 0)) return;
+  gs_config_set(key, value);
+}
+
+int gs_config_reload(void) {
+  if (!g_path) return -1;
+  return read_file(reload_one);
+}
+
+int gs_config_reply(char *out, size_t cap) {
+  int n = snprintf(out, cap, "{\"type\":\"CONFIG\"");
+  for (int l = 0; l < LISTS; l++) {
+    n += snprintf(out + n, cap - (size_t)n, ",\"%s\":[%s]", g_list_names[l], g_list[l]);
+    g_list[l][0] = '\0';
+  }
+  n += snprintf(out + n, cap - (size_t)n, "}");
+  return n < (int)cap ? n : -1;
+}
+
+int gs_config_show(char *out, size_t cap) {
+  int n = snprintf(out, cap, "{\"type\":\"CONFIG\",\"file\":");
+  n += snprintf(out + n, cap - (size_t)n, g_path ? "\"%s\"" : "null", g_path);
+  n += snprintf(out + n, cap - (size_t)n, ",\"hot\":{");
+  for (int i = 0; i < g_nhot; i++) {
+    const char *v = getenv(g_hot[i].key);
+    n += snprintf(out + n, cap - (size_t)n, "%s\"%s\":", i ? "," : "", g_hot[i].key);
+    n += snprintf(out + n, cap - (size_t)n, v ? "\"%s\"" : "null", v);
+  }
+  n += snprintf(out + n, cap - (size_t)n, "},\"pending\":[");
+  for (int i = 0; i < g_npending; i++) n += snprintf(out + n, cap - (size_t)n, "%s\"%s\"", i ? "," : "", g_pending[i].key);
+  n += snprintf(out + n, cap - (size_t)n, "]}");
+  return n < (int)cap ? n : -1;
+}
+
+int gs_config_pending(void) {
+  return g_npending;
+}
+
+void gs_config_poll(void) {
+  for (int i = 0; i < g_npending; ) {
+    cfg_pending_t *p = &g_pending[i];
+    int r = hot_of(p->key)->fn(p->value);
+    if (r == CFG_PENDING) { i++; continue; }
+    if (r == CFG_INVALID) LOG_WARN("Config: %s=%s could not be applied", p->key, p->value);
+    else {
+      setenv(p->key, p->value, 1);
+      LOG_INFO("Config: %s=%s applied", p->key, p->value);
+    }
+    pending_drop(p);
+  }
+}
@@ -0,0 +1,46 @@
+#ifndef GS_CONFIG_H
+#define GS_CONFIG_H
+
+#include <stddef.h>
+
+// ------------------------- Runtime config -------------------------
+// GS_CONFIG=<file> holds settings the way the environment does: KEY=value
+// lines ('#' comments and blank lines skipped, optional quotes around the
+// value). It is read first thing in main, before anything looks at the
+// environment, and overrides what is already set there, so every setting
+// keeps the one name and the one parser it has always had.
+//
+// While the bridge runs a setting changes with
+//   {"T":"CONFIG","set":{"GS_LOG":"debug","GS_ROBOTS":"aa:..,bb:.."}}
+// on the UDS, or by editing the file and sending SIGHUP (only the keys
+// whose value changed are applied). A key with a hot handler takes effect
+// in place; the handler may defer it until in-flight work has drained, and
+// is then called again every CONFIG_RETRY_MS. Any other key is stored for
+// the next start. Either way the reply (logged for SIGHUP) says which:
+//   {"type":"CONFIG","applied":[..],"pending":[..],"restart":[..],"invalid":[..]}
+// {"T":"CONFIG"} alone lists the hot keys and their values, and
+// {"T":"CONFIG","reload":true} re-reads the file.
+
+#define CONFIG_RETRY_MS   100
+#define CONFIG_PENDING_MAX 8
+#define CONFIG_HOT_MAX    16
+#define CONFIG_VALUE_MAX  256
+
+enum { CFG_INVALID = -1, CFG_APPLIED = 0, CFG_PENDING = 1, CFG_RESTART = 2 };
+
+typedef int (*gs_config_fn)(const char *value);             // CFG_*
+
+int         gs_config_load(void);                           // Settings read, -1 = GS_CONFIG unreadable
+const char *gs_config_path(void);                           // NULL = no file
+void        gs_config_hot(const char *key, gs_config_fn fn);
+
+// One change, counted into the reply that gs_config_reply() writes
+int         gs_config_set(const char *key, const char *value);
+int         gs_config_reload(void);                         // Sets every changed key; -1 = unreadable
+int         gs_config_reply(char *out, size_t cap);         // And starts the next one
+int         gs_config_show(char *out, size_t cap);
+
+int         gs_config_pending(void);
+void        gs_config_poll(void);                           // Retries deferred keys
+
+#endif
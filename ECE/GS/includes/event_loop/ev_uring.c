@@ -0,0 +1,434 @@
+#include "ev_uring.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define EVU_FILES (EV_MAX_WATCHES + EVU_WFDS)   // Watch slots, then write targets
+#define EVU_NONE  0xFFFF
+
+enum { UD_POLL = 1, UD_WRITE, UD_REMOVE };
+#define UD(kind, gen, idx) (((uint64_t)(kind) << 56) | ((uint64_t)(gen) << 16) | (uint64_t)(idx))
+#define UD_KIND(ud)        ((unsigned)((ud) >> 56))
+#define UD_GEN(ud)         ((uint32_t)((ud) >> 16))
+#define UD_IDX(ud)         ((unsigned)((ud) & 0xFFFF))
+
+enum { B_FREE, B_QUEUED, B_FLIGHT, B_DONE };
+
+typedef struct {
+  uint16_t next;                          // Next in the fd FIFO / free list
+  uint16_t len, off;                      // Bytes held, bytes already written
+  uint8_t  wfd;                           // Index into wfd[]
+  uint8_t  state;
+} evu_buf_t;
+
+typedef struct {
+  int      fd;                            // -1 = slot free
+  uint16_t head, tail;                    // Buffer FIFO, in write order
+  int      inflight;                      // Submitted, completion not reaped
+} evu_wfd_t;
+
+struct ev_uring {
+  ev_loop_t *loop;
+  int       fd;
+  unsigned  sq_entries;
+  unsigned *sq_head, *sq_tail, *sq_mask;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void     *sq_map, *cq_map;
+  size_t    sq_map_sz, cq_map_sz, sqes_sz;
+  unsigned  pending;                      // SQEs queued since the last enter
+  int       multishot;                    // Cleared on the first -EINVAL (kernel < 5.13)
+
+  uint32_t  gen[EV_MAX_WATCHES];          // Bumped on mod/del: stale CQEs are ignored
+  uint32_t  events[EV_MAX_WATCHES];
+  uint32_t  ready[EV_MAX_WATCHES];        // Readiness reaped, handler not yet run
+
+  evu_wfd_t wfd[EVU_WFDS];
+  evu_buf_t buf[EVU_BUFS];
+  uint16_t  free_head;
+  int       nfree;
+  uint8_t   mem[EVU_BUFS][EVU_BUF_SZ];
+};
+
+static struct ev_uring  g_ur;             // One loop per process
+static struct ev_uring *g_live = NULL;    // Set while evu_run() dispatches: ev_write queues
+
+// ------------------------- Syscalls -------------------------
+
+static int sys_setup(unsigned entries, struct io_uring_params *p) {
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_register(int fd, unsigned op, const void *arg, unsigned nr) {
+  return (int)syscall(__NR_io_uring_register, fd, op, arg, nr);
+}
+
+// ------------------------- Rings -------------------------
+
+static struct io_uring_sqe *sqe_get(struct ev_uring *u);
+
+// Submit what is queued; wait = 1 also blocks for at least one completion
+static int submit(struct ev_uring *u, int wait) {
+  for (;;) {
+    int rc = sys_enter(u->fd, u->pending, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0);
+    if (rc >= 0) {
+      u->pending -= (unsigned)rc < u->pending ? (unsigned)rc : u->pending;
+      return 0;
+    }
+    if (errno == EINTR) return 0;                         // Signal: let the caller look at running
+    if (errno == EAGAIN || errno == EBUSY) return 0;      // CQ backlog: reap first
+    return -1;
+  }
+}
+
+static unsigned sq_space(struct ev_uring *u) {
+  return u->sq_entries - (*u->sq_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE));
+}
+
+static struct io_uring_sqe *sqe_get(struct ev_uring *u) {
+  if (sq_space(u) == 0) submit(u, 0);
+  if (sq_space(u) == 0) return NULL;
+  struct io_uring_sqe *s = &u->sqes[*u->sq_tail & *u->sq_mask];
+  memset(s, 0, sizeof(*s));
+  return s;
+}
+
+static void sqe_push(struct ev_uring *u) {
+  __atomic_store_n(u->sq_tail, *u->sq_tail + 1, __ATOMIC_RELEASE);
+  u->pending++;
+}
+
+static int files_set(struct ev_uring *u, unsigned slot, int fd) {
+  struct io_uring_files_update up;
+  memset(&up, 0, sizeof(up));
+  up.offset = slot;
+  up.fds = (uint64_t)(uintptr_t)&fd;
+  return sys_register(u->fd, IORING_REGISTER_FILES_UPDATE, &up, 1) == 1 ? 0 : -1;
+}
+
+// ------------------------- Polls -------------------------
+
+static int poll_arm(struct ev_uring *u, unsigned idx) {
+  struct io_uring_sqe *s = sqe_get(u);
+  if (!s) return -1;
+  s->opcode        = IORING_OP_POLL_ADD;
+  s->fd            = (int)idx;                            // Fixed file slot
+  s->flags         = IOSQE_FIXED_FILE;
+  s->poll32_events = u->events[idx];                      // EPOLL* bits are the POLL* bits
+  s->len           = u->multishot ? IORING_POLL_ADD_MULTI : 0;
+  s->user_data     = UD(UD_POLL, u->gen[idx], idx);
+  sqe_push(u);
+  return 0;
+}
+
+static void poll_remove(struct ev_uring *u, unsigned idx) {
+  struct io_uring_sqe *s = sqe_get(u);
+  if (!s) return;
+  s->opcode    = IORING_OP_POLL_REMOVE;
+  s->addr      = UD(UD_POLL, u->gen[idx], idx);
+  s->user_data = UD(UD_REMOVE, 0, 0);
+  sqe_push(u);
+}
+
+static void on_poll(struct ev_uring *u, uint64_t ud, int res, unsigned flags) {
+  unsigned idx = UD_IDX(ud);
+  if (idx >= EV_MAX_WATCHES || UD_GEN(ud) != u->gen[idx] || u->loop->watches[idx].fd < 0) return;
+  if (res < 0) {
+    if (res == -ECANCELED) return;
+    if (res == -EINVAL && u->multishot) {                 // No multishot: one-shot, re-armed
+      u->multishot = 0;
+      poll_arm(u, idx);
+      return;
+    }
+    u->ready[idx] |= EPOLLERR;                            // Handler sees it; not re-armed
+    return;
+  }
+  u->ready[idx] |= (uint32_t)res;
+  if (!(flags & IORING_CQE_F_MORE)) poll_arm(u, idx);     // One-shot, or the kernel ended it
+}
+
+// ------------------------- Writes -------------------------
+
+static void buf_release(struct ev_uring *u, evu_wfd_t *t) {
+  while (t->head != EVU_NONE && u->buf[t->head].state == B_DONE) {
+    uint16_t b = t->head;
+    t->head = u->buf[b].next;
+    if (t->head == EVU_NONE) t->tail = EVU_NONE;
+    u->buf[b].state = B_FREE;
+    u->buf[b].next = u->free_head;
+    u->free_head = b;
+    u->nfree++;
+  }
+}
+
+static void on_write(struct ev_uring *u, uint64_t ud, int res) {
+  unsigned b = UD_IDX(ud);
+  if (b >= EVU_BUFS || u->buf[b].state != B_FLIGHT) return;
+  evu_buf_t *x = &u->buf[b];
+  evu_wfd_t *t = &u->wfd[x->wfd];
+  t->inflight--;
+  if (res == -ECANCELED || res == -EAGAIN || res == -EINTR) {
+    x->state = B_QUEUED;                                  // Chain broken earlier: goes again
+  } else if (res <= 0) {
+    fprintf(stderr, "ev_write: fd %d: %s\n", t->fd, res ? strerror(-res) : "wrote nothing");
+    x->state = B_DONE;                                    // Dropped, as a failed write() would be
+  } else {
+    x->off = (uint16_t)(x->off + res);
+    x->state = x->off >= x->len ? B_DONE : B_QUEUED;      // Short: the rest goes next pass
+  }
+  buf_release(u, t);
+}
+
+// Each fd's queued buffers go out as one linked chain once its previous
+// chain has fully completed, so bytes never overtake each other
+static void writes_flush(struct ev_uring *u) {
+  for (int w = 0; w < EVU_WFDS; w++) {
+    evu_wfd_t *t = &u->wfd[w];
+    if (t->fd < 0 || t->inflight || t->head == EVU_NONE) continue;
+    unsigned n = 0;
+    for (uint16_t b = t->head; b != EVU_NONE; b = u->buf[b].next) n++;
+    if (sq_space(u) < n) submit(u, 0);                    // A chain must not straddle two enters
+    if (sq_space(u) < n) return;
+
+    for (uint16_t b = t->head; b != EVU_NONE; b = u->buf[b].next) {
+      evu_buf_t *x = &u->buf[b];
+      struct io_uring_sqe *s = sqe_get(u);
+      s->opcode    = IORING_OP_WRITE_FIXED;
+      s->fd        = EV_MAX_WATCHES + w;
+      s->flags     = IOSQE_FIXED_FILE | (x->next != EVU_NONE ? IOSQE_IO_LINK : 0);
+      s->addr      = (uint64_t)(uintptr_t)(u->mem[b] + x->off);
+      s->len       = (uint32_t)(x->len - x->off);
+      s->buf_index = b;
+      s->user_data = UD(UD_WRITE, 0, b);
+      sqe_push(u);
+      x->state = B_FLIGHT;
+      t->inflight++;
+    }
+  }
+}
+
+// Completions become ready bits (dispatched by evu_run) and freed buffers
+static void reap(struct ev_uring *u) {
+  unsigned head = *u->cq_head;
+  unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+  for (; head != tail; head++) {
+    struct io_uring_cqe *c = &u->cqes[head & *u->cq_mask];
+    switch (UD_KIND(c->user_data)) {
+      case UD_POLL:  on_poll(u, c->user_data, c->res, c->flags); break;
+      case UD_WRITE: on_write(u, c->user_data, c->res); break;
+      default: break;                                     // POLL_REMOVE results
+    }
+  }
+  __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static int wfd_of(struct ev_uring *u, int fd) {
+  int free_slot = -1;
+  for (int w = 0; w < EVU_WFDS; w++) {
+    if (u->wfd[w].fd == fd) return w;
+    if (u->wfd[w].fd < 0 && free_slot < 0) free_slot = w;
+  }
+  if (free_slot < 0 || files_set(u, EV_MAX_WATCHES + (unsigned)free_slot, fd) != 0) return -1;
+  u->wfd[free_slot].fd = fd;
+  return free_slot;
+}
+
+int ev_write(int fd, const void *buf, size_t len) {
+  struct ev_uring *u = g_live;
+  if (!u || fd < 0) return -1;
+  int w = wfd_of(u, fd);
+  if (w < 0) return -1;                                   // Nothing queued for it yet: write() is safe
+
+  int need = (int)((len + EVU_BUF_SZ - 1) / EVU_BUF_SZ);
+  if (u->nfree < need) {                                  // Reclaim whatever has completed
+    writes_flush(u);
+    submit(u, 0);
+    reap(u);
+  }
+  if (u->nfree < need) {
+    fprintf(stderr, "ev_write: fd %d: write queue full\n", fd);
+    return -2;
+  }
+
+  evu_wfd_t *t = &u->wfd[w];
+  const uint8_t *p = buf;
+  while (len) {
+    uint16_t b = u->free_head;
+    evu_buf_t *x = &u->buf[b];
+    u->free_head = x->next;
+    u->nfree--;
+    size_t n = len < EVU_BUF_SZ ? len : EVU_BUF_SZ;
+    memcpy(u->mem[b], p, n);
+    x->len = (uint16_t)n;
+    x->off = 0;
+    x->wfd = (uint8_t)w;
+    x->state = B_QUEUED;
+    x->next = EVU_NONE;
+    if (t->tail == EVU_NONE) t->head = b;
+    else u->buf[t->tail].next = b;
+    t->tail = b;
+    p += n;
+    len -= n;
+  }
+  return 0;
+}
+
+// ------------------------- Lifecycle -------------------------
+
+int evu_init(ev_loop_t *loop) {
+  struct ev_uring *u = &g_ur;
+  struct io_uring_params p;
+  memset(u, 0, sizeof(*u));
+  memset(&p, 0, sizeof(p));
+  u->fd = sys_setup(EVU_ENTRIES, &p);
+  if (u->fd < 0) return -1;
+
+  u->sq_entries = p.sq_entries;
+  u->sq_map_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  u->cq_map_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (u->cq_map_sz > u->sq_map_sz) u->sq_map_sz = u->cq_map_sz;
+    u->cq_map_sz = 0;
+  }
+  u->sq_map = mmap(NULL, u->sq_map_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+  if (u->sq_map == MAP_FAILED) goto fail;
+  u->cq_map = u->cq_map_sz ? mmap(NULL, u->cq_map_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  u->fd, IORING_OFF_CQ_RING)
+                           : u->sq_map;
+  if (u->cq_map == MAP_FAILED) { u->cq_map = NULL; goto fail; }
+  u->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+  u->sqes = mmap(NULL, u->sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+  if (u->sqes == MAP_FAILED) { u->sqes = NULL; goto fail; }
+
+  uint8_t *sq = u->sq_map, *cq = u->cq_map;
+  u->sq_head = (unsigned *)(sq + p.sq_off.head);
+  u->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+  u->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+  unsigned *array = (unsigned *)(sq + p.sq_off.array);
+  for (unsigned i = 0; i < p.sq_entries; i++) array[i] = i;   // SQE i always sits in slot i
+  u->cq_head = (unsigned *)(cq + p.cq_off.head);
+  u->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+  u->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+  u->cqes    = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+  int files[EVU_FILES];                                   // Sparse: filled by evu_add / ev_write
+  for (int i = 0; i < EVU_FILES; i++) files[i] = -1;
+  if (sys_register(u->fd, IORING_REGISTER_FILES, files, EVU_FILES) < 0) goto fail;
+  struct iovec iov[EVU_BUFS];
+  for (int i = 0; i < EVU_BUFS; i++) {
+    iov[i].iov_base = u->mem[i];
+    iov[i].iov_len = EVU_BUF_SZ;
+  }
+  if (sys_register(u->fd, IORING_REGISTER_BUFFERS, iov, EVU_BUFS) < 0) goto fail;
+
+  for (int w = 0; w < EVU_WFDS; w++) {
+    u->wfd[w].fd = -1;
+    u->wfd[w].head = u->wfd[w].tail = EVU_NONE;
+  }
+  for (int i = 0; i < EVU_BUFS; i++) u->buf[i].next = (uint16_t)(i + 1 < EVU_BUFS ? i + 1 : EVU_NONE);
+  u->free_head = 0;
+  u->nfree = EVU_BUFS;
+  u->multishot = 1;
+  u->loop = loop;
+  loop->ur = u;
+  return 0;
+
+fail:
+  loop->ur = u;
+  evu_close(loop);
+  return -1;
+}
+
+void evu_close(ev_loop_t *loop) {
+  struct ev_uring *u = loop->ur;
+  if (!u) return;
+  if (u->sqes) munmap(u->sqes, u->sqes_sz);
+  if (u->cq_map && u->cq_map != u->sq_map) munmap(u->cq_map, u->cq_map_sz);
+  if (u->sq_map && u->sq_map != MAP_FAILED) munmap(u->sq_map, u->sq_map_sz);
+  if (u->fd >= 0) close(u->fd);
+  memset(u, 0, sizeof(*u));
+  u->fd = -1;
+  loop->ur = NULL;
+  g_live = NULL;
+}
+
+// ------------------------- Watches -------------------------
+
+int evu_add(ev_loop_t *loop, ev_watch_t *w, uint32_t events) {
+  struct ev_uring *u = loop->ur;
+  unsigned idx = (unsigned)(w - loop->watches);
+  if (files_set(u, idx, w->fd) != 0) { perror("io_uring files update"); return -1; }
+  u->gen[idx]++;
+  u->events[idx] = events;
+  u->ready[idx] = 0;
+  return poll_arm(u, idx);
+}
+
+int evu_mod(ev_loop_t *loop, ev_watch_t *w, uint32_t events) {
+  struct ev_uring *u = loop->ur;
+  unsigned idx = (unsigned)(w - loop->watches);
+  if (events == u->events[idx]) return 0;
+  poll_remove(u, idx);
+  u->gen[idx]++;
+  u->events[idx] = events;
+  return poll_arm(u, idx);
+}
+
+void evu_del(ev_loop_t *loop, ev_watch_t *w) {
+  struct ev_uring *u = loop->ur;
+  unsigned idx = (unsigned)(w - loop->watches);
+  poll_remove(u, idx);
+  u->gen[idx]++;
+  u->ready[idx] = 0;
+  files_set(u, idx, -1);                                  // The table must not keep the file open
+}
+
+// ------------------------- Dispatch -------------------------
+
+int evu_run(ev_loop_t *loop) {
+  struct ev_uring *u = loop->ur;
+  loop->running = 1;
+  g_live = u;
+
+  while (loop->running) {
+    int ready = 0;                                        // ev_write may have reaped some already
+    for (int i = 0; i < EV_MAX_WATCHES && !ready; i++) ready = u->ready[i] != 0;
+    writes_flush(u);
+    if (submit(u, !ready) < 0) {                          // Submit the pass's SQEs, wait for one CQE
+      perror("io_uring_enter");
+      g_live = NULL;
+      return -1;
+    }
+    reap(u);
+
+    for (int i = 0; i < EV_MAX_WATCHES; i++) {
+      uint32_t events = u->ready[i];
+      if (!events) continue;
+      u->ready[i] = 0;
+      ev_watch_t *w = &loop->watches[i];
+      if (w->fd < 0 || !w->handler) continue;             // Removed earlier in this pass
+
+      if (w->is_timer) {
+        uint64_t expirations;
+        while (read(w->fd, &expirations, sizeof(expirations)) > 0) {}
+      }
+      w->handler(loop, w->fd, events, w->ctx);
+    }
+  }
+
+  writes_flush(u);                                        // Last words before shutdown
+  submit(u, 0);
+  g_live = NULL;
+  return 0;
+}
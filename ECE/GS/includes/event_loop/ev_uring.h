@@ -0,0 +1,37 @@
+#ifndef EV_URING_H
+#define EV_URING_H
+
+#include "event_loop.h"
+
+// ------------------------- io_uring backend -------------------------
+// GS_IO_URING=1 runs the loop on an io_uring instead of epoll (raw
+// io_uring_setup/enter/register, no liburing). The handler contract does not
+// change: a watch is a multishot POLL_ADD on a fixed file (the watch's slot
+// in the registered file table), its completions turn into the same readiness
+// mask epoll would report, and handlers still drain to EAGAIN.
+//
+// What it saves is syscalls per command on a busy bridge:
+//   - one io_uring_enter per loop pass both waits for readiness and submits
+//     everything queued during the previous pass, so the multishot polls are
+//     never re-armed and there is no epoll_ctl / epoll_wait pair;
+//   - UART writes (ev_write) are copied into registered buffers and go out as
+//     WRITE_FIXED on a fixed file with that same enter. Writes to one fd in a
+//     pass are linked (IOSQE_IO_LINK) so the modem sees them in order; a short
+//     write cancels the rest of the chain and the remainder is resubmitted.
+//
+// Kernels without multishot poll (< 5.13) fall back to re-armed one-shot
+// polls; a kernel or sandbox without io_uring leaves the loop on epoll.
+
+#define EVU_ENTRIES 256                   // SQ depth (CQ is twice that)
+#define EVU_WFDS    4                     // Write targets (one per radio)
+#define EVU_BUFS    32                    // Registered write buffers
+#define EVU_BUF_SZ  512                   // AT command + longest payload fits one
+
+int  evu_init(ev_loop_t *loop);
+void evu_close(ev_loop_t *loop);
+int  evu_add(ev_loop_t *loop, ev_watch_t *w, uint32_t events);
+int  evu_mod(ev_loop_t *loop, ev_watch_t *w, uint32_t events);
+void evu_del(ev_loop_t *loop, ev_watch_t *w);
+int  evu_run(ev_loop_t *loop);
+
+#endif
@@ -0,0 +1,191 @@
+#include "event_loop.h"
+#include "ev_uring.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+// ------------------------- Watch table helpers -------------------------
+// epoll events carry the slot and its generation rather than a pointer: a
+// slot freed by ev_del() and handed to a new fd in the same epoll_wait()
+// batch must not get the old fd's remaining events (a stale EPOLLHUP would
+// close the new client).
+
+#define EV_TAG(gen, idx) (((uint64_t)(gen) << 32) | (uint32_t)(idx))
+#define EV_TAG_GEN(tag)  ((uint32_t)((tag) >> 32))
+#define EV_TAG_IDX(tag)  ((uint32_t)(tag))
+
+static ev_watch_t *watch_find(ev_loop_t *loop, int fd) {
+  for (int i = 0; i < EV_MAX_WATCHES; i++) {
+    if (loop->watches[i].fd == fd) return &loop->watches[i];
+  }
+  return NULL;
+}
+
+static ev_watch_t *watch_alloc(ev_loop_t *loop) {
+  return watch_find(loop, -1);                            // First free slot
+}
+
+// ------------------------- Loop lifecycle -------------------------
+
+int ev_loop_init(ev_loop_t *loop) {
+  memset(loop, 0, sizeof(*loop));
+  for (int i = 0; i < EV_MAX_WATCHES; i++) loop->watches[i].fd = -1;
+
+  loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (loop->epfd < 0) { perror("epoll_create1"); return -1; }
+  return 0;
+}
+
+void ev_loop_close(ev_loop_t *loop) {
+  for (int i = 0; i < EV_MAX_WATCHES; i++) {
+    ev_watch_t *w = &loop->watches[i];
+    if (w->fd >= 0 && w->is_timer) close(w->fd);          // Loop owns timerfds only
+    w->fd = -1;
+  }
+  evu_close(loop);
+  if (loop->epfd >= 0) close(loop->epfd);
+  loop->epfd = -1;
+}
+
+int ev_loop_use_uring(ev_loop_t *loop) {
+  if (loop->ur) return 0;
+  for (int i = 0; i < EV_MAX_WATCHES; i++)
+    if (loop->watches[i].fd >= 0) return -1;              // Watches already live in epoll
+  return evu_init(loop);
+}
+
+// ------------------------- fd registration -------------------------
+
+int ev_add(ev_loop_t *loop, int fd, uint32_t events, ev_handler_fn handler, void *ctx) {
+  if (fd < 0 || !handler) return -1;
+  if (watch_find(loop, fd)) return -2;                    // Already watched
+
+  ev_watch_t *w = watch_alloc(loop);
+  if (!w) { fprintf(stderr, "ev_add: watch table full\n"); return -3; }
+
+  if (loop->ur) {
+    w->fd = fd;
+    if (evu_add(loop, w, events) != 0) { w->fd = -1; return -4; }
+  } else {
+    struct epoll_event ev = { .events = events | EPOLLET,
+                              .data.u64 = EV_TAG(w->gen, w - loop->watches) };
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      perror("epoll_ctl add");
+      return -4;
+    }
+  }
+
+  w->fd       = fd;
+  w->is_timer = 0;
+  w->handler  = handler;
+  w->ctx      = ctx;
+  return 0;
+}
+
+int ev_mod(ev_loop_t *loop, int fd, uint32_t events) {
+  ev_watch_t *w = watch_find(loop, fd);
+  if (!w || fd < 0) return -1;
+  if (loop->ur) return evu_mod(loop, w, events) == 0 ? 0 : -2;
+
+  struct epoll_event ev = { .events = events | EPOLLET,
+                            .data.u64 = EV_TAG(w->gen, w - loop->watches) };
+  if (epoll_ctl(loop->epfd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+    perror("epoll_ctl mod");
+    return -2;
+  }
+  return 0;
+}
+
+int ev_del(ev_loop_t *loop, int fd) {
+  ev_watch_t *w = watch_find(loop, fd);
+  if (!w || fd < 0) return -1;
+
+  if (loop->ur) evu_del(loop, w);
+  else epoll_ctl(loop->epfd, EPOLL_CTL_DEL, fd, NULL);    // Ignore errors (fd may be closed)
+  w->fd      = -1;
+  w->handler = NULL;
+  w->ctx     = NULL;
+  w->gen++;
+  return 0;
+}
+
+// ------------------------- Timers (timerfd) -------------------------
+// Timers are ordinary watches on a timerfd, so they wake the same epoll_wait()
+// as sockets and there is no polling tick. interval_ms == 0 means one-shot.
+
+int ev_timer_set(ev_loop_t *loop, int tfd, int first_ms, int interval_ms) {
+  ev_watch_t *w = watch_find(loop, tfd);
+  if (!w || !w->is_timer) return -1;
+
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  its.it_value.tv_sec     = first_ms / 1000;
+  its.it_value.tv_nsec    = (long)(first_ms % 1000) * 1000000L;
+  its.it_interval.tv_sec  = interval_ms / 1000;
+  its.it_interval.tv_nsec = (long)(interval_ms % 1000) * 1000000L;
+  if (first_ms > 0 && its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+    its.it_value.tv_nsec = 1;                             // 0 would disarm
+
+  if (timerfd_settime(tfd, 0, &its, NULL) < 0) { perror("timerfd_settime"); return -2; }
+  return 0;
+}
+
+int ev_timer_add(ev_loop_t *loop, int first_ms, int interval_ms, ev_handler_fn handler, void *ctx) {
+  int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (tfd < 0) { perror("timerfd_create"); return -1; }
+
+  if (ev_add(loop, tfd, EPOLLIN, handler, ctx) != 0) { close(tfd); return -1; }
+  watch_find(loop, tfd)->is_timer = 1;
+
+  if (ev_timer_set(loop, tfd, first_ms, interval_ms) != 0) {
+    ev_timer_del(loop, tfd);
+    return -1;
+  }
+  return tfd;
+}
+
+int ev_timer_del(ev_loop_t *loop, int tfd) {
+  if (ev_del(loop, tfd) != 0) return -1;
+  close(tfd);
+  return 0;
+}
+
+// ------------------------- Dispatch -------------------------
+
+int ev_loop_run(ev_loop_t *loop) {
+  if (loop->ur) return evu_run(loop);
+
+  struct epoll_event events[EV_MAX_EVENTS];
+  loop->running = 1;
+
+  while (loop->running) {
+    int n = epoll_wait(loop->epfd, events, EV_MAX_EVENTS, -1); // Block until something is ready
+    if (n < 0) {
+      if (errno == EINTR) continue;                       // Signal -> retry
+      perror("epoll_wait");
+      return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+      uint64_t tag = events[i].data.u64;
+      if (EV_TAG_IDX(tag) >= EV_MAX_WATCHES) continue;
+      ev_watch_t *w = &loop->watches[EV_TAG_IDX(tag)];
+      if (w->fd < 0 || !w->handler) continue;             // Removed earlier in this batch
+      if (w->gen != EV_TAG_GEN(tag)) continue;            // Slot reused since; not this fd's event
+
+      if (w->is_timer) {
+        uint64_t expirations;                             // Must be drained to re-arm ET
+        while (read(w->fd, &expirations, sizeof(expirations)) > 0) {}
+      }
+      w->handler(loop, w->fd, events[i].events, w->ctx);
+    }
+  }
+  return 0;
+}
+
+void ev_loop_stop(ev_loop_t *loop) {
+  loop->running = 0;
+}
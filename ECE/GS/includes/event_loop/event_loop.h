@@ -0,0 +1,51 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+
+// ------------------------- epoll reactor -------------------------
+// One loop drives every fd the bridge cares about (UDS listener, UDS clients,
+// UART, timers). Watches are edge-triggered, so handlers must drain their fd
+// until EAGAIN before returning. ev_loop_use_uring() swaps epoll for an
+// io_uring with the same contract (ev_uring.h).
+
+#define EV_MAX_WATCHES 64                 // Listener + clients + UART + timers
+#define EV_MAX_EVENTS  32                 // Events pulled per epoll_wait()
+
+typedef struct ev_loop ev_loop_t;
+typedef void (*ev_handler_fn)(ev_loop_t *loop, int fd, uint32_t events, void *ctx);
+
+typedef struct {
+  int           fd;                       // Watched fd (-1 = slot free)
+  int           is_timer;                 // 1 if fd is a timerfd owned by the loop
+  uint32_t      gen;                      // Bumped on del: events for an old occupant are dropped
+  ev_handler_fn handler;                  // Callback on readiness
+  void         *ctx;                      // User pointer passed to handler
+} ev_watch_t;
+
+struct ev_loop {
+  int        epfd;                        // epoll instance
+  int        running;                     // Cleared by ev_loop_stop()
+  struct ev_uring *ur;                    // io_uring backend, NULL = epoll
+  ev_watch_t watches[EV_MAX_WATCHES];     // Fixed watch table (no heap)
+};
+
+int  ev_loop_init(ev_loop_t *loop);
+void ev_loop_close(ev_loop_t *loop);
+int  ev_loop_use_uring(ev_loop_t *loop);  // Before the first ev_add; -1 = stays on epoll
+int  ev_add(ev_loop_t *loop, int fd, uint32_t events, ev_handler_fn handler, void *ctx);
+int  ev_mod(ev_loop_t *loop, int fd, uint32_t events);
+int  ev_del(ev_loop_t *loop, int fd);
+int  ev_timer_add(ev_loop_t *loop, int first_ms, int interval_ms, ev_handler_fn handler, void *ctx);
+int  ev_timer_set(ev_loop_t *loop, int tfd, int first_ms, int interval_ms);
+int  ev_timer_del(ev_loop_t *loop, int tfd);
+int  ev_loop_run(ev_loop_t *loop);
+void ev_loop_stop(ev_loop_t *loop);
+
+// Queue a write on the io_uring loop (loop thread, inside ev_loop_run):
+// 0 = queued, -1 = no ring (write() it yourself), -2 = queue full
+int  ev_write(int fd, const void *buf, size_t len);
+
+#endif
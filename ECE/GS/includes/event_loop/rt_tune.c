@@ -0,0 +1,160 @@
+#define _GNU_SOURCE                         /* cpu_set_t, pthread_setaffinity_np() */
+#include "rt_tune.h"
+#include "../metrics/metrics.h"
+#include "../log/gs_log.h"
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+static struct {
+  int       prio;                           // SCHED_FIFO priority, 0 = leave CFS
+  int       has_cpus[RT_ROLES];             // Per role: a CPU list was given
+  cpu_set_t cpus[RT_ROLES];
+  uint64_t  probe_ns;                       // GS_JITTER period, 0 = off
+  uint64_t  next_ns;                        // Next probe expiry not yet seen
+  uint64_t  report_ns;                      // Next summary line
+} g_rt;
+
+static const char *const role_name[] = { "event loop", "UART reader", "crypto stage" };
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// "2", "1,3", "0-1,4" -> set; 0 = parsed and not empty
+static int parse_cpus(const char *s, cpu_set_t *set) {
+  CPU_ZERO(set);
+  while (*s) {
+    char *end;
+    long lo = strtol(s, &end, 10), hi = lo;
+    if (end == s || lo < 0) return -1;
+    s = end;
+    if (*s == '-') {
+      hi = strtol(s + 1, &end, 10);
+      if (end == s + 1 || hi < lo) return -1;
+      s = end;
+    }
+    if (hi >= CPU_SETSIZE) return -1;
+    for (long c = lo; c <= hi; c++) CPU_SET((int)c, set);
+    if (*s == ',') s++;
+    else if (*s) return -1;
+  }
+  return CPU_COUNT(set) ? 0 : -1;
+}
+
+static void read_cpus(const char *env, int role) {
+  const char *v = getenv(env);
+  if (!(v && v[0])) return;
+  if (parse_cpus(v, &g_rt.cpus[role]) == 0) g_rt.has_cpus[role] = 1;
+  else LOG_WARN("%s=%s: not a CPU list, ignored", env, v);
+}
+
+// Touches the stack the loop will use, so a deep call never faults
+static __attribute__((noinline)) void prefault_stack(void) {
+  volatile char buf[RT_PREFAULT_STACK];
+  for (size_t i = 0; i < sizeof(buf); i += 4096) buf[i] = 0;
+}
+
+void rt_thread(int role) {
+  if (g_rt.has_cpus[role]) {
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &g_rt.cpus[role]);
+    if (rc != 0) LOG_WARN("%s: CPU affinity refused: %s", role_name[role], strerror(rc));
+  }
+  if (g_rt.prio > 0) {
+    struct sched_param sp = { .sched_priority = g_rt.prio + (role == RT_READER) };  // Readers above the loop
+    int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+    if (rc != 0) LOG_WARN("%s: SCHED_FIFO %d refused: %s", role_name[role], sp.sched_priority, strerror(rc));
+  }
+}
+
+void rt_setup(void) {
+  const char *prio = getenv("GS_RT_PRIO");
+  if (prio && prio[0]) {
+    int p = atoi(prio);
+    int max = sched_get_priority_max(SCHED_FIFO) - 1;      // Room for the readers' +1
+    if (p < 1 || p > max) LOG_WARN("GS_RT_PRIO=%s out of range 1..%d, ignored", prio, max);
+    else g_rt.prio = p;
+  }
+  read_cpus("GS_CPU_LOOP", RT_LOOP);
+  read_cpus("GS_CPU_READER", RT_READER);
+  read_cpus("GS_CPU_CRYPTO", RT_CRYPTO);
+  const char *jitter = getenv("GS_JITTER");
+  if (jitter && atoi(jitter) > 0) g_rt.probe_ns = (uint64_t)atoi(jitter) * 1000000u;
+
+  const char *lock = getenv("GS_MLOCK");
+  if (lock && strcmp(lock, "1") == 0) {
+    mallopt(M_TRIM_THRESHOLD, -1);                         // Freed heap stays mapped (and locked)
+    mallopt(M_MMAP_MAX, 0);                                // ... and big blocks come from it too
+    mallopt(M_ARENA_MAX, 1);                               // No per-thread arenas to lock as well
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+      LOG_WARN("mlockall: %s (raise RLIMIT_MEMLOCK or run with CAP_IPC_LOCK)", strerror(errno));
+    } else {
+      prefault_stack();
+      LOG_INFO("Memory locked, %d KiB of stack prefaulted", RT_PREFAULT_STACK / 1024);
+    }
+  }
+
+  rt_thread(RT_LOOP);
+  if (g_rt.prio || g_rt.has_cpus[RT_LOOP] || g_rt.has_cpus[RT_READER] || g_rt.has_cpus[RT_CRYPTO]) {
+    const char *loop_cpus = getenv("GS_CPU_LOOP"), *reader_cpus = getenv("GS_CPU_READER");
+    const char *crypto_cpus = getenv("GS_CPU_CRYPTO");
+    LOG_INFO("Realtime: SCHED_%s %d, loop CPUs %s, reader CPUs %s, crypto CPUs %s", g_rt.prio ? "FIFO" : "OTHER",
+             g_rt.prio, g_rt.has_cpus[RT_LOOP] ? loop_cpus : "any",
+             g_rt.has_cpus[RT_READER] ? reader_cpus : "with the loop",
+             g_rt.has_cpus[RT_CRYPTO] ? crypto_cpus : "with the loop");
+  }
+}
+
+// ------------------------- Jitter probe -------------------------
+
+// Smallest bucket bound with at least q of the samples at or below it
+static uint64_t hist_quantile(const metrics_histogram_t *h, double q) {
+  uint64_t n = atomic_load_explicit(&h->count, memory_order_relaxed), seen = 0;
+  uint64_t want = (uint64_t)(q * (double)n + 0.5);
+  if (want == 0) want = 1;
+  for (unsigned b = 0; b < METRICS_BUCKETS; b++) {
+    seen += atomic_load_explicit(&h->bucket[b], memory_order_relaxed);
+    if (seen >= want) return metrics_bucket_le(b);
+  }
+  return atomic_load_explicit(&h->max, memory_order_relaxed);
+}
+
+void rt_report(void) {
+  const metrics_histogram_t *h = &metrics_histograms[MH_loop_lag_us];
+  uint64_t n = atomic_load_explicit(&h->count, memory_order_relaxed);
+  if (!n) return;
+  LOG_INFO("Loop lag: %llu probes, p50 %llu us, p99 %llu us, p99.9 %llu us, max %llu us",
+           (unsigned long long)n, (unsigned long long)hist_quantile(h, 0.5),
+           (unsigned long long)hist_quantile(h, 0.99), (unsigned long long)hist_quantile(h, 0.999),
+           (unsigned long long)atomic_load_explicit(&h->max, memory_order_relaxed));
+}
+
+static void on_probe(ev_loop_t *loop, int fd, uint32_t events, void *ctx) {
+  (void)loop; (void)fd; (void)events; (void)ctx;
+  uint64_t now = now_ns();
+  if (now < g_rt.next_ns) return;                          // Early wakeup (clock granularity)
+  METRIC_OBSERVE(loop_lag_us, (now - g_rt.next_ns) / 1000u);
+  g_rt.next_ns += g_rt.probe_ns * ((now - g_rt.next_ns) / g_rt.probe_ns + 1);
+  if (now >= g_rt.report_ns) {
+    rt_report();
+    g_rt.report_ns = now + (uint64_t)RT_REPORT_S * 1000000000u;
+  }
+}
+
+int rt_probe_start(ev_loop_t *loop) {
+  if (!g_rt.probe_ns) return 0;
+  int ms = (int)(g_rt.probe_ns / 1000000u);
+  uint64_t now = now_ns();
+  g_rt.next_ns = now + g_rt.probe_ns;
+  g_rt.report_ns = now + (uint64_t)RT_REPORT_S * 1000000000u;
+  if (ev_timer_add(loop, ms, ms, on_probe, NULL) < 0) return -1;
+  LOG_INFO("Jitter probe every %d ms (METRICS loop_lag_us)", ms);
+  return 0;
+}
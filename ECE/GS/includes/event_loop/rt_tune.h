@@ -0,0 +1,36 @@
+#ifndef RT_TUNE_H
+#define RT_TUNE_H
+
+#include "event_loop.h"
+
+// ------------------------- Realtime options -------------------------
+// Keeps Node.js, the sniffers and their GC pauses off the command path when
+// they share the Zynq's cores. All off by default:
+//
+//   GS_RT_PRIO=<1..98>   SCHED_FIFO for the event loop, UART readers one above
+//   GS_CPU_LOOP=<list>   pin the event loop ("2", "2-3", "1,3"); best on
+//                        cores kept free with isolcpus=
+//   GS_CPU_READER=<list> pin the UART reader threads (default: with the loop)
+//   GS_CPU_CRYPTO=<list> pin the crypto stage thread (crypto_stage.h; default:
+//                        with the loop), at the loop's priority
+//   GS_MLOCK=1           mlockall() current and future pages, prefault
+//                        RT_PREFAULT_STACK of stack, keep freed heap mapped
+//   GS_JITTER=<ms>       probe timer every <ms>: how late the loop wakes up
+//                        goes to the loop_lag_us histogram (METRICS) and a
+//                        p50/p99/max summary is logged every RT_REPORT_S
+//
+// The log writer thread is started before any of this and stays a normal,
+// unpinned thread. Settings the kernel refuses (no CAP_SYS_NICE, a CPU not
+// online) are logged and skipped; the bridge runs on without them.
+
+#define RT_PREFAULT_STACK (256 * 1024)
+#define RT_REPORT_S       10
+
+enum { RT_LOOP = 0, RT_READER, RT_CRYPTO, RT_ROLES };
+
+void rt_setup(void);                        // Reads the env; memory locking, then the calling (loop) thread
+void rt_thread(int role);                   // Applies the role's priority and CPUs to the calling thread
+int  rt_probe_start(ev_loop_t *loop);       // GS_JITTER probe; 0 = started or not asked for
+void rt_report(void);                       // Logs the loop lag summary (no-op without samples)
+
+#endif
@@ -0,0 +1,355 @@
+#include "crypto_provider.h"
+
+#include <pthread.h>
+#include <time.h>
+
+#ifdef GS_WITH_OPENSSL
+#include <openssl/evp.h>
+#include "hex_codec.h"
+#endif
+
+#define BENCH_WARMUP   16
+#define BENCH_PKTS     512              /* Encrypt + decrypt round trips per provider */
+#define REPORT_SZ      1024
+
+static const gs_crypto_provider_t *g_providers[] = {
+    &gs_provider_af_alg,
+#ifndef GS_NO_CE
+    &gs_provider_ce,
+#endif
+#ifndef GS_NO_CSU
+    &gs_provider_csu,
+#endif
+#ifdef GS_WITH_PL
+    &gs_provider_pl,
+#endif
+#ifdef GS_WITH_OPENSSL
+    &gs_provider_openssl,
+#endif
+    &gs_provider_af_alg_chacha,
+#ifdef GS_WITH_OPENSSL
+    &gs_provider_openssl_chacha,
+#endif
+};
+#define N_PROVIDERS (sizeof(g_providers) / sizeof(g_providers[0]))
+
+static const char *const g_suite_name[GS_SUITES] = { "aes-256-gcm", "chacha20-poly1305" };
+
+/* Per suite: the provider in use and whether its init() has succeeded.
+ * AF_ALG is the lazy default for both. */
+static const gs_crypto_provider_t *g_active[GS_SUITES] = { &gs_provider_af_alg, &gs_provider_af_alg_chacha };
+static int      g_active_ready[GS_SUITES];
+static __thread int g_suite = GS_SUITE_AES_GCM; /* Suite this thread's seal / open calls use */
+static pthread_mutex_t g_op_lock = PTHREAD_MUTEX_INITIALIZER;
+static double   g_rate[N_PROVIDERS];    /* Packets/s from the last benchmark, <0 = unusable */
+static int      g_benched = 0;
+static char     g_report[REPORT_SZ];
+
+#ifdef GS_WITH_OPENSSL
+/* ------------------------- OpenSSL EVP providers ------------------------- */
+/* One keyed context per direction and suite; each packet only resets the IV.
+ * The EVP_CTRL_AEAD_* controls drive GCM and ChaCha20-Poly1305 alike. */
+
+typedef struct {
+    const EVP_CIPHER *(*cipher)(void);
+    EVP_CIPHER_CTX *enc, *dec;
+} ossl_pair_t;
+
+static ossl_pair_t g_ossl[GS_SUITES] = {
+    [GS_SUITE_AES_GCM]           = { EVP_aes_256_gcm,        NULL, NULL },
+    [GS_SUITE_CHACHA20_POLY1305] = { EVP_chacha20_poly1305,  NULL, NULL },
+};
+
+static void ossl_pair_free(ossl_pair_t *o)
+{
+    EVP_CIPHER_CTX_free(o->enc);
+    EVP_CIPHER_CTX_free(o->dec);
+    o->enc = o->dec = NULL;
+}
+
+static int ossl_pair_init(ossl_pair_t *o)
+{
+    if (o->enc && o->dec) return 0;
+
+    uint8_t key[KEY_SIZE];
+    if (hexc_decode(AES_KEY_HEX, KEY_SIZE * 2, key) != KEY_SIZE) return -1;
+
+    o->enc = EVP_CIPHER_CTX_new();
+    o->dec = EVP_CIPHER_CTX_new();
+    int ok = o->enc && o->dec &&
+        EVP_EncryptInit_ex(o->enc, o->cipher(), NULL, NULL, NULL) == 1 &&
+        EVP_CIPHER_CTX_ctrl(o->enc, EVP_CTRL_AEAD_SET_IVLEN, IV_SZ, NULL) == 1 &&
+        EVP_EncryptInit_ex(o->enc, NULL, NULL, key, NULL) == 1 &&
+        EVP_DecryptInit_ex(o->dec, o->cipher(), NULL, NULL, NULL) == 1 &&
+        EVP_CIPHER_CTX_ctrl(o->dec, EVP_CTRL_AEAD_SET_IVLEN, IV_SZ, NULL) == 1 &&
+        EVP_DecryptInit_ex(o->dec, NULL, NULL, key, NULL) == 1;
+    memset(key, 0, sizeof(key));
+
+    if (!ok) { ossl_pair_free(o); return -1; }
+    return 0;
+}
+
+static int ossl_seal(ossl_pair_t *o, const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    int n = 0, fin = 0;
+    if (ossl_pair_init(o) != 0) return -6;
+    if (EVP_EncryptInit_ex(o->enc, NULL, NULL, NULL, iv) != 1) return -7;
+    if (EVP_EncryptUpdate(o->enc, out, &n, in, (int)len) != 1) return -7;
+    if (EVP_EncryptFinal_ex(o->enc, out + n, &fin) != 1) return -7;
+    if (EVP_CIPHER_CTX_ctrl(o->enc, EVP_CTRL_AEAD_GET_TAG, TAG_SZ, out + len) != 1) return -7;
+    return 0;
+}
+
+static int ossl_unseal(ossl_pair_t *o, const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    int n = 0, fin = 0;
+    if (ossl_pair_init(o) != 0) return -6;
+    if (EVP_DecryptInit_ex(o->dec, NULL, NULL, NULL, iv) != 1) return -7;
+    if (EVP_DecryptUpdate(o->dec, out, &n, in, (int)len) != 1) return -7;
+    if (EVP_CIPHER_CTX_ctrl(o->dec, EVP_CTRL_AEAD_SET_TAG, TAG_SZ, (void *)(in + len)) != 1) return -7;
+    if (EVP_DecryptFinal_ex(o->dec, out + n, &fin) != 1) return GS_CRYPTO_EAUTH;
+    return 0;
+}
+
+static int  ossl_init(void)   { return ossl_pair_init(&g_ossl[GS_SUITE_AES_GCM]); }
+static void ossl_deinit(void) { ossl_pair_free(&g_ossl[GS_SUITE_AES_GCM]); }
+
+static int ossl_encrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    return ossl_seal(&g_ossl[GS_SUITE_AES_GCM], iv, in, len, out);
+}
+
+static int ossl_decrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    return ossl_unseal(&g_ossl[GS_SUITE_AES_GCM], iv, in, len, out);
+}
+
+static int  ossl_chacha_init(void)   { return ossl_pair_init(&g_ossl[GS_SUITE_CHACHA20_POLY1305]); }
+static void ossl_chacha_deinit(void) { ossl_pair_free(&g_ossl[GS_SUITE_CHACHA20_POLY1305]); }
+
+static int ossl_chacha_encrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    return ossl_seal(&g_ossl[GS_SUITE_CHACHA20_POLY1305], iv, in, len, out);
+}
+
+static int ossl_chacha_decrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    return ossl_unseal(&g_ossl[GS_SUITE_CHACHA20_POLY1305], iv, in, len, out);
+}
+
+const gs_crypto_provider_t gs_provider_openssl = {
+    "openssl", GS_SUITE_AES_GCM, ossl_init, ossl_encrypt, ossl_decrypt, ossl_deinit, NULL, NULL
+};
+
+const gs_crypto_provider_t gs_provider_openssl_chacha = {
+    "openssl_chacha", GS_SUITE_CHACHA20_POLY1305, ossl_chacha_init, ossl_chacha_encrypt,
+    ossl_chacha_decrypt, ossl_chacha_deinit, NULL, NULL
+};
+#endif
+
+/* ------------------------- Selection ------------------------- */
+
+const gs_crypto_provider_t *gs_crypto_provider(void)
+{
+    return g_active[g_suite];
+}
+
+/* The bridge switches suite per routed robot before every seal or open;
+ * the choice is per thread */
+int gs_crypto_suite(int suite)
+{
+    if (suite < 0 || suite >= GS_SUITES) return -1;
+    g_suite = suite;
+    return 0;
+}
+
+/* Providers keep one socket / context per suite, so the crypto stage and
+ * the event loop take turns on them */
+int gs_crypto_encrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    pthread_mutex_lock(&g_op_lock);
+    int res = g_active[g_suite]->encrypt(iv, in, len, out);
+    pthread_mutex_unlock(&g_op_lock);
+    return res;
+}
+
+int gs_crypto_decrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    pthread_mutex_lock(&g_op_lock);
+    int res = g_active[g_suite]->decrypt(iv, in, len, out);
+    pthread_mutex_unlock(&g_op_lock);
+    return res;
+}
+
+/* A provider with a batch path gets the whole batch in one submission
+ * (PL: one TAILDESC write); the others take the jobs one at a time under
+ * a single lock */
+static int run_batch(gs_crypto_job_t *jobs, int n, int decrypt)
+{
+    const gs_crypto_provider_t *p = g_active[g_suite];
+    int (*batch)(gs_crypto_job_t *, int) = decrypt ? p->decrypt_batch : p->encrypt_batch;
+    int res = 0;
+
+    pthread_mutex_lock(&g_op_lock);
+    if (batch) {
+        res = batch(jobs, n);
+    } else {
+        for (int i = 0; i < n; i++) {
+            gs_crypto_job_t *j = &jobs[i];
+            j->rc = decrypt ? p->decrypt(j->iv, j->in, j->len, j->out) : p->encrypt(j->iv, j->in, j->len, j->out);
+        }
+    }
+    pthread_mutex_unlock(&g_op_lock);
+    return res;
+}
+
+int gs_crypto_encrypt_batch(gs_crypto_job_t *jobs, int n)
+{
+    return run_batch(jobs, n, 0);
+}
+
+int gs_crypto_decrypt_batch(gs_crypto_job_t *jobs, int n)
+{
+    return run_batch(jobs, n, 1);
+}
+
+static void activate(const gs_crypto_provider_t *p)
+{
+    int s = p->suite;
+    if (g_active[s] != p && g_active_ready[s]) g_active[s]->deinit();
+    g_active[s] = p;
+    g_active_ready[s] = 1;
+}
+
+static double provider_rate(const gs_crypto_provider_t *p)
+{
+    for (size_t i = 0; g_benched && i < N_PROVIDERS; i++)
+        if (g_providers[i] == p) return g_rate[i] < 0 ? 0.0 : g_rate[i];
+    return 0.0;
+}
+
+static void build_report(void)
+{
+    const gs_crypto_provider_t *aes = g_active[GS_SUITE_AES_GCM], *cc = g_active[GS_SUITE_CHACHA20_POLY1305];
+    double pps = provider_rate(aes), cc_pps = provider_rate(cc);
+
+    int off = snprintf(g_report, sizeof(g_report),
+                       "{\"type\":\"HEALTH\",\"crypto\":{\"provider\":\"%s\",\"pkts_per_s\":%.0f,"
+                       "\"mb_per_s\":%.3f,\"chacha20_poly1305\":{\"provider\":\"%s\",\"pkts_per_s\":%.0f,"
+                       "\"mb_per_s\":%.3f},\"candidates\":[",
+                       aes->name, pps, pps * TOTAL_SZ / 1e6, cc->name, cc_pps, cc_pps * TOTAL_SZ / 1e6);
+
+    for (size_t i = 0; g_benched && i < N_PROVIDERS && off > 0 && (size_t)off < sizeof(g_report); i++) {
+        off += snprintf(g_report + off, sizeof(g_report) - off,
+                        "%s{\"name\":\"%s\",\"suite\":\"%s\",\"pkts_per_s\":%.0f}",
+                        i ? "," : "", g_providers[i]->name, g_suite_name[g_providers[i]->suite],
+                        g_rate[i] < 0 ? 0.0 : g_rate[i]);
+    }
+    if (off > 0 && (size_t)off < sizeof(g_report))
+        snprintf(g_report + off, sizeof(g_report) - off, "]}}");
+}
+
+/* Pins the named provider for its suite; the other suite keeps its own */
+int gs_crypto_use(const char *name)
+{
+    for (size_t i = 0; i < N_PROVIDERS; i++) {
+        const gs_crypto_provider_t *p = g_providers[i];
+        if (strcmp(p->name, name) != 0) continue;
+        if (p != g_active[p->suite] || !g_active_ready[p->suite]) {
+            if (p->init() != 0) { p->deinit(); return -2; }
+            activate(p);
+        }
+        build_report();
+        return 0;
+    }
+    return -1;
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Round-trip BENCH_PKTS padded 128-byte payloads (one 156-byte packet each)
+ * through p. Returns packets/s, or -1 if p fails or disagrees with ref_ct
+ * (the first working provider's ciphertext of the same suite and IV). */
+static double bench_one(const gs_crypto_provider_t *p, uint8_t ref_ct[CT_SZ + TAG_SZ], int *have_ref)
+{
+    uint8_t iv[IV_SZ] = {0};
+    uint8_t pt[CT_SZ], ct[CT_SZ + TAG_SZ], back[CT_SZ];
+    memset(pt, PAD_BYTE, sizeof(pt));
+    memcpy(pt, "{\"T\":\"C\",\"F\":1}", 15);
+
+    if (p->encrypt(iv, pt, CT_SZ, ct) != 0) return -1;
+    if (p->decrypt(iv, ct, CT_SZ, back) != 0 || memcmp(back, pt, CT_SZ) != 0) return -1;
+    if (*have_ref && memcmp(ct, ref_ct, sizeof(ct)) != 0) return -1;    /* Wrong answer */
+    if (!*have_ref) { memcpy(ref_ct, ct, sizeof(ct)); *have_ref = 1; }
+
+    for (int i = 0; i < BENCH_WARMUP; i++) p->encrypt(iv, pt, CT_SZ, ct);
+
+    double t0 = now_sec();
+    for (int i = 0; i < BENCH_PKTS; i++) {
+        iv[IV_SZ - 1] = (uint8_t)i;
+        if (p->encrypt(iv, pt, CT_SZ, ct) != 0) return -1;
+        if (p->decrypt(iv, ct, CT_SZ, back) != 0) return -1;
+    }
+    double dt = now_sec() - t0;
+    return dt > 0 ? BENCH_PKTS / dt : -1;
+}
+
+/* Benchmark every provider whose init() succeeds and keep, per suite, the
+ * fastest one that round-trips and matches the others of its suite.
+ * Returns 0, or -1 if no AES-GCM provider works (a suite without one keeps
+ * its lazy AF_ALG default and fails when a link asks for it). */
+int gs_crypto_autoselect(void)
+{
+    uint8_t ref_ct[GS_SUITES][CT_SZ + TAG_SZ];
+    int have_ref[GS_SUITES] = {0};
+    size_t best[GS_SUITES];
+
+    for (int s = 0; s < GS_SUITES; s++) {
+        best[s] = N_PROVIDERS;
+        if (g_active_ready[s]) { g_active[s]->deinit(); g_active_ready[s] = 0; }
+    }
+
+    for (size_t i = 0; i < N_PROVIDERS; i++) {
+        const gs_crypto_provider_t *p = g_providers[i];
+        int s = p->suite;
+        g_rate[i] = -1;
+        if (p->init() == 0) g_rate[i] = bench_one(p, ref_ct[s], &have_ref[s]);
+        p->deinit();
+        printf("[crypto] %-14s %-17s %s", p->name, g_suite_name[s], g_rate[i] < 0 ? "unavailable\n" : "");
+        if (g_rate[i] >= 0) printf("%.0f pkt/s\n", g_rate[i]);
+        if (g_rate[i] >= 0 && (best[s] == N_PROVIDERS || g_rate[i] > g_rate[best[s]])) best[s] = i;
+    }
+    g_benched = 1;
+
+    for (int s = 0; s < GS_SUITES; s++) {
+        if (best[s] != N_PROVIDERS && g_providers[best[s]]->init() == 0) {
+            g_active[s] = g_providers[best[s]];
+            g_active_ready[s] = 1;
+        } else {
+            g_active[s] = s == GS_SUITE_AES_GCM ? &gs_provider_af_alg : &gs_provider_af_alg_chacha;
+            g_active_ready[s] = 0;
+        }
+    }
+    build_report();
+    return g_active_ready[GS_SUITE_AES_GCM] ? 0 : -1;
+}
+
+/* {"type":"HEALTH","crypto":{...}} line for UDS clients */
+const char *gs_crypto_report(void)
+{
+    if (!g_report[0]) build_report();
+    return g_report;
+}
+
+void gs_crypto_shutdown(void)
+{
+    for (int s = 0; s < GS_SUITES; s++) {
+        if (g_active_ready[s]) g_active[s]->deinit();
+        g_active_ready[s] = 0;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef CRYPTO_PROVIDER_H
+#define CRYPTO_PROVIDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "software_cryptography.h"
+
+/* AEAD engine used by encrypt_* / decrypt_*, one per cipher suite.
+ *   encrypt: in[len] -> out = ciphertext[len] || tag[TAG_SZ]
+ *   decrypt: in = ciphertext[len] || tag[TAG_SZ] -> out[len]
+ * Both return 0 on success, GS_CRYPTO_EAUTH on a tag mismatch, <0 otherwise. */
+#define GS_CRYPTO_EAUTH  (-9)
+
+/* Cipher suites, negotiated per robot link by SECURITY_LEVEL (cmd_codec.h
+ * security_suites). Same 12-byte IV, 16-byte tag and frames in both. */
+typedef enum {
+    GS_SUITE_AES_GCM           = 0,
+    GS_SUITE_CHACHA20_POLY1305 = 1,
+    GS_SUITES
+} gs_crypto_suite_t;
+
+/* One packet of a batch, same buffers as encrypt / decrypt; rc per packet */
+typedef struct {
+    const uint8_t *iv;
+    const uint8_t *in;
+    size_t         len;
+    uint8_t       *out;
+    int            rc;
+} gs_crypto_job_t;
+
+typedef struct {
+    const char *name;
+    int   suite;                        /* gs_crypto_suite_t it implements */
+    int  (*init)(void);
+    int  (*encrypt)(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out);
+    int  (*decrypt)(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out);
+    void (*deinit)(void);
+    /* Optional, NULL = one encrypt / decrypt per job: n jobs in one
+     * submission. <0 if the batch could not run, else 0 with every rc set. */
+    int  (*encrypt_batch)(gs_crypto_job_t *jobs, int n);
+    int  (*decrypt_batch)(gs_crypto_job_t *jobs, int n);
+} gs_crypto_provider_t;
+
+#define GS_CRYPTO_BATCH_MAX 16          /* Jobs per gs_crypto_*_batch call from the seal paths */
+
+extern const gs_crypto_provider_t gs_provider_af_alg;          /* software_cryptography.c */
+extern const gs_crypto_provider_t gs_provider_af_alg_chacha;   /* software_cryptography.c */
+extern const gs_crypto_provider_t gs_provider_csu;             /* hardware_encryption.c, not with GS_NO_CSU */
+#ifndef GS_NO_CE
+extern const gs_crypto_provider_t gs_provider_ce;              /* ce_gcm.c, aarch64 only  */
+#endif
+#ifdef GS_WITH_PL
+extern const gs_crypto_provider_t gs_provider_pl;              /* pl_gcm.c, make PL=1     */
+#endif
+#ifdef GS_WITH_OPENSSL
+extern const gs_crypto_provider_t gs_provider_openssl;         /* crypto_provider.c       */
+extern const gs_crypto_provider_t gs_provider_openssl_chacha;  /* crypto_provider.c       */
+#endif
+
+const gs_crypto_provider_t *gs_crypto_provider(void);   /* Active provider of the current suite */
+int  gs_crypto_suite(int suite);                        /* Sets the calling thread's suite; -1 if unknown */
+/* The current suite's provider, one call at a time across threads */
+int  gs_crypto_encrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out);
+int  gs_crypto_decrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out);
+int  gs_crypto_encrypt_batch(gs_crypto_job_t *jobs, int n);
+int  gs_crypto_decrypt_batch(gs_crypto_job_t *jobs, int n);
+int  gs_crypto_use(const char *name);
+int  gs_crypto_autoselect(void);
+const char *gs_crypto_report(void);
+void gs_crypto_shutdown(void);
+
+#endif
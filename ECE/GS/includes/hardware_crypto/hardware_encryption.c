@@ -4,23 +4,88 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include "hardware_encryption.h"
+#include "crypto_provider.h"
+#include "hex_codec.h"
 
+// Mapped register windows (NULL = not mapped, use the sysfs config_reg path)
+static volatile uint32_t *csu_win     = NULL;
+static volatile uint32_t *csu_dma_win = NULL;
+static int csu_mem_fd = -1;
 
+static uint32_t AES_KEY[AES_KEY_LEN];
+static int aes_key_ready = 0;
+
+// DMA slot pool (one mapping of the u-dma-buf region)
+static uint8_t  *dma_virt = NULL;
+static uint64_t  dma_phys = 0;
+static int       dma_fd   = -1;
+static uint32_t  dma_used = 0;       // Bit per slot
 
 void convert_hex_to_uint32_8(const char *hex_str, uint32_t out_array[8]) {
-    char temp[9]; 
-    temp[8] = '\0';
+    uint8_t b[32] = {0};
+    hexc_decode(hex_str, 64, b);      // Big-endian words, same as the old strtoul walk
 
     for (int i = 0; i < 8; i++) {
-        memcpy(temp, &hex_str[i * 8], 8); 
-        out_array[i] = (uint32_t)strtoul(temp, NULL, 16);
+        out_array[i] = ((uint32_t)b[i * 4] << 24) | ((uint32_t)b[i * 4 + 1] << 16) |
+                       ((uint32_t)b[i * 4 + 2] << 8) | (uint32_t)b[i * 4 + 3];
     }
 }
 
+// Map the CSU and CSU_DMA windows once so register access is a plain
+// volatile load/store instead of a shell fork per access. Needs root and a
+// kernel that allows /dev/mem; on failure the sysfs path stays in use.
+int csu_mmap_init(void) {
+    if (csu_win && csu_dma_win) return 0;
+
+    csu_mem_fd = open(CSU_MEM_DEV, O_RDWR | O_SYNC | O_CLOEXEC);
+    if (csu_mem_fd < 0) {
+        perror("open " CSU_MEM_DEV);
+        return -1;
+    }
+
+    void *a = mmap(NULL, CSU_WIN_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, csu_mem_fd, CSU_WIN_BASE);
+    void *b = mmap(NULL, CSU_DMA_WIN_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, csu_mem_fd, CSU_DMA_WIN_BASE);
+    if (a == MAP_FAILED || b == MAP_FAILED) {
+        perror("mmap CSU");
+        if (a != MAP_FAILED) munmap(a, CSU_WIN_SIZE);
+        if (b != MAP_FAILED) munmap(b, CSU_DMA_WIN_SIZE);
+        close(csu_mem_fd);
+        csu_mem_fd = -1;
+        return -2;
+    }
+
+    csu_win     = (volatile uint32_t *)a;
+    csu_dma_win = (volatile uint32_t *)b;
+    return 0;
+}
+
+void csu_mmap_deinit(void) {
+    if (csu_win)     munmap((void *)csu_win, CSU_WIN_SIZE);
+    if (csu_dma_win) munmap((void *)csu_dma_win, CSU_DMA_WIN_SIZE);
+    if (csu_mem_fd >= 0) close(csu_mem_fd);
+    csu_win     = NULL;
+    csu_dma_win = NULL;
+    csu_mem_fd  = -1;
+}
+
+// Pointer to a mapped register, or NULL if addr is outside both windows
+static volatile uint32_t *csu_reg_ptr(uint64_t addr) {
+    if (addr & 3) return NULL;
+    if (csu_win && addr >= CSU_WIN_BASE && addr < CSU_WIN_BASE + CSU_WIN_SIZE)
+        return csu_win + (addr - CSU_WIN_BASE) / 4;
+    if (csu_dma_win && addr >= CSU_DMA_WIN_BASE && addr < CSU_DMA_WIN_BASE + CSU_DMA_WIN_SIZE)
+        return csu_dma_win + (addr - CSU_DMA_WIN_BASE) / 4;
+    return NULL;
+}
+
 // Read register
 uint32_t read_csu_reg(uint64_t addr) {
+    volatile uint32_t *reg = csu_reg_ptr(addr);
+    if (reg) return *reg;
+
     char cmd[128];
 
     /* Step 1: Write address to config_reg */
@@ -44,7 +109,15 @@ uint32_t read_csu_reg(uint64_t addr) {
     return val;
 }
 
+// Masked write, same semantics as "addr mask value" on config_reg
 int write_csu_reg(uint64_t addr, uint32_t mask, uint32_t value) {
+    volatile uint32_t *reg = csu_reg_ptr(addr);
+    if (reg) {
+        uint32_t cur = (mask == 0xFFFFFFFF) ? 0 : *reg;
+        *reg = (cur & ~mask) | (value & mask);
+        return 0;
+    }
+
     char cmd[256];
 
     /* echo <address> <mask> <value> > config_reg */
@@ -68,6 +141,9 @@ int reg_write_check(uint64_t addr, uint32_t mask, uint32_t value){
 
 int hw_crypto_init(void)
 {
+    if (csu_mmap_init() != 0)
+        printf("    CSU mmap unavailable, falling back to %s\n", CSU_CONFIG_REG);
+
     /* Step 0: Reset AES engine first to clear any bad state */
     printf("[0] Resetting AES engine...\n");
     write_csu_reg(AES_RESET, 0x00000001, 0x00000001);  /* assert reset */
@@ -155,4 +231,172 @@ int hw_crypto_init(void)
 
     printf("ERROR: key never loaded — last status=0x%08X\n", read_csu_reg(AES_STATUS_ADDR));
     return -4;
-}
\ No newline at end of file
+}
+
+// ------------------------- DMA buffer pool -------------------------
+// CSU_DMA needs physical addresses, so payloads are staged in a u-dma-buf
+// region (contiguous, mapped uncached via O_SYNC) instead of malloc'd memory.
+
+static int hw_dma_pool_init(void) {
+    if (dma_virt) return 0;
+
+    FILE *f = fopen(HW_DMA_PHYS_ATTR, "r");
+    if (!f) { perror("open " HW_DMA_PHYS_ATTR); return -1; }
+    unsigned long long phys = 0;
+    int ok = fscanf(f, "%llx", &phys) == 1;
+    fclose(f);
+    if (!ok || phys == 0 || phys + HW_DMA_SLOT_SZ * HW_DMA_SLOTS > 0x100000000ULL) {
+        printf("ERROR: bad DMA phys_addr 0x%llX\n", phys);
+        return -2;
+    }
+
+    dma_fd = open(HW_DMA_DEV, O_RDWR | O_SYNC | O_CLOEXEC);
+    if (dma_fd < 0) { perror("open " HW_DMA_DEV); return -3; }
+
+    void *v = mmap(NULL, HW_DMA_SLOT_SZ * HW_DMA_SLOTS, PROT_READ | PROT_WRITE, MAP_SHARED, dma_fd, 0);
+    if (v == MAP_FAILED) {
+        perror("mmap " HW_DMA_DEV);
+        close(dma_fd);
+        dma_fd = -1;
+        return -4;
+    }
+
+    dma_virt = (uint8_t *)v;
+    dma_phys = phys;
+    dma_used = 0;
+    return 0;
+}
+
+static void hw_dma_pool_deinit(void) {
+    if (dma_virt) munmap(dma_virt, HW_DMA_SLOT_SZ * HW_DMA_SLOTS);
+    if (dma_fd >= 0) close(dma_fd);
+    dma_virt = NULL;
+    dma_fd   = -1;
+    dma_used = 0;
+}
+
+static int hw_dma_slot_get(void) {
+    for (int i = 0; i < HW_DMA_SLOTS; i++) {
+        if (!(dma_used & (1u << i))) { dma_used |= 1u << i; return i; }
+    }
+    return -1;
+}
+
+static void hw_dma_slot_put(int slot) {
+    if (slot >= 0) dma_used &= ~(1u << slot);
+}
+
+// ------------------------- CSU AES-GCM -------------------------
+
+static int csu_poll(uint64_t addr, uint32_t mask, uint32_t want) {
+    for (int i = 0; i < HW_DMA_POLL_LIMIT; i++) {
+        if ((read_csu_reg(addr) & mask) == want) return 0;
+    }
+    return -1;
+}
+
+static int csu_dma_src(uint64_t phys, uint32_t len, int last) {
+    write_csu_reg(CSU_DMA_SRC_I_STS, 0xFFFFFFFF, CSU_DMA_I_DONE);             // W1C
+    write_csu_reg(CSU_DMA_SRC_MSB,   0xFFFFFFFF, (uint32_t)(phys >> 32));
+    write_csu_reg(CSU_DMA_SRC_ADDR,  0xFFFFFFFF, (uint32_t)phys);
+    write_csu_reg(CSU_DMA_SRC_SIZE,  0xFFFFFFFF, len | (last ? CSU_DMA_SIZE_LAST : 0));
+    return csu_poll(CSU_DMA_SRC_I_STS, CSU_DMA_I_DONE, CSU_DMA_I_DONE);
+}
+
+// One GCM pass through the engine. Slot layout: [0..15] IV block,
+// [16..16+len) payload, then 16 bytes of tag. The engine writes len bytes of
+// output (plus the tag on encrypt) starting at [16].
+static int hw_gcm_run(uint32_t cfg, const uint8_t iv[IV_SZ], const uint8_t *in, uint32_t len,
+                      const uint8_t *tag_in, uint8_t *out, uint8_t *tag_out) {
+    if (!csu_win || !csu_dma_win) return -1;              // Needs the mmap path
+    if (len == 0 || len % 4 || 16 + len + TAG_SZ > HW_DMA_SLOT_SZ) return -1;
+    if (hw_dma_pool_init() != 0) return -2;
+
+    int slot = hw_dma_slot_get();
+    if (slot < 0) return -3;
+
+    uint8_t *buf  = dma_virt + slot * HW_DMA_SLOT_SZ;
+    uint64_t phys = dma_phys + (uint64_t)slot * HW_DMA_SLOT_SZ;
+    int rc = 0;
+
+    memset(buf, 0, 16);
+    memcpy(buf, iv, IV_SZ);                               // 96-bit IV, zero padded
+    memcpy(buf + 16, in, len);
+    if (tag_in) memcpy(buf + 16 + len, tag_in, TAG_SZ);
+
+    write_csu_reg(CSU_SSS_CFG_ADDR, 0x00000FF0, CSU_SSS_DMA_AES);
+    write_csu_reg(CSU_DMA_SRC_CTRL, CSU_DMA_CTRL_ENDIAN, CSU_DMA_CTRL_ENDIAN);
+    write_csu_reg(CSU_DMA_DST_CTRL, CSU_DMA_CTRL_ENDIAN, CSU_DMA_CTRL_ENDIAN);
+    write_csu_reg(AES_CFG_ADDR, 0x1, cfg);
+
+    // Destination first so output can stream while the source runs
+    uint32_t out_len = len + (cfg == AES_CFG_ENCRYPT ? TAG_SZ : 0);
+    write_csu_reg(CSU_DMA_DST_I_STS, 0xFFFFFFFF, CSU_DMA_I_DONE);
+    write_csu_reg(CSU_DMA_DST_MSB,   0xFFFFFFFF, (uint32_t)((phys + 16) >> 32));
+    write_csu_reg(CSU_DMA_DST_ADDR,  0xFFFFFFFF, (uint32_t)(phys + 16));
+    write_csu_reg(CSU_DMA_DST_SIZE,  0xFFFFFFFF, out_len);
+
+    write_csu_reg(AES_START_MSG_ADDR, 0x1, 0x1);
+
+    if (csu_dma_src(phys, 16, 0) != 0) { rc = -5; goto done; }           // IV
+    if (cfg == AES_CFG_ENCRYPT) {
+        if (csu_dma_src(phys + 16, len, 1) != 0) { rc = -5; goto done; } // Plaintext (last)
+    } else {
+        if (csu_dma_src(phys + 16, len, 0) != 0) { rc = -5; goto done; } // Ciphertext
+        if (csu_dma_src(phys + 16 + len, TAG_SZ, 1) != 0) { rc = -5; goto done; } // Tag (last)
+    }
+
+    if (csu_poll(CSU_DMA_DST_I_STS, CSU_DMA_I_DONE, CSU_DMA_I_DONE) != 0) { rc = -6; goto done; }
+    if (csu_poll(AES_STATUS_ADDR, AES_STS_DONE, AES_STS_DONE) != 0)       { rc = -6; goto done; }
+
+    if (cfg == AES_CFG_DECRYPT && !(read_csu_reg(AES_STATUS_ADDR) & AES_STS_TAG_PASS)) {
+        rc = -4;                                          // Authentication failed
+        goto done;
+    }
+
+    memcpy(out, buf + 16, len);
+    if (tag_out) memcpy(tag_out, buf + 16 + len, TAG_SZ);
+
+done:
+    memset(buf, 0, HW_DMA_SLOT_SZ);                       // Don't leave plaintext in the pool
+    hw_dma_slot_put(slot);
+    return rc;
+}
+
+int hw_gcm_encrypt(const uint8_t iv[IV_SZ], const uint8_t *in, uint32_t len,
+                   uint8_t *out, uint8_t tag[TAG_SZ]) {
+    return hw_gcm_run(AES_CFG_ENCRYPT, iv, in, len, NULL, out, tag);
+}
+
+int hw_gcm_decrypt(const uint8_t iv[IV_SZ], const uint8_t *in, uint32_t len,
+                   const uint8_t tag[TAG_SZ], uint8_t *out) {
+    return hw_gcm_run(AES_CFG_DECRYPT, iv, in, len, tag, out, NULL);
+}
+
+void hw_crypto_deinit(void) {
+    hw_dma_pool_deinit();
+    csu_mmap_deinit();
+}
+
+// ------------------------- Provider glue -------------------------
+
+static int csu_provider_init(void) {
+    // DMA needs the mmap'ed windows, the sysfs fallback is too slow
+    if (hw_crypto_init() != 0 || csu_mmap_init() != 0) return -1;
+    return 0;
+}
+
+static int csu_provider_encrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out) {
+    return hw_gcm_encrypt(iv, in, len, out, out + len) == 0 ? 0 : -7;
+}
+
+static int csu_provider_decrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out) {
+    int rc = hw_gcm_decrypt(iv, in, len, in + len, out);
+    if (rc == -4) return GS_CRYPTO_EAUTH;
+    return rc == 0 ? 0 : -7;
+}
+
+const gs_crypto_provider_t gs_provider_csu = {
+    "csu", GS_SUITE_AES_GCM, csu_provider_init, csu_provider_encrypt, csu_provider_decrypt, hw_crypto_deinit,
+    NULL, NULL
+};
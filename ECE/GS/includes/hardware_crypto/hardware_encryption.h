@@ -1,7 +1,16 @@
 #ifndef HARDWARE_ENCRYPTION_H
 #define HARDWARE_ENCRYPTION_H
 
+#include <stdint.h>
+
 #define CSU_CONFIG_REG "/sys/firmware/zynqmp/config_reg"
+#define CSU_MEM_DEV    "/dev/mem"
+
+// mmap windows covering every register below (page aligned)
+#define CSU_WIN_BASE        0x00FFCA0000
+#define CSU_WIN_SIZE        0x2000       // SSS_CFG (0x0008) .. AES_IV_3 (0x104C)
+#define CSU_DMA_WIN_BASE    0x00FFC80000
+#define CSU_DMA_WIN_SIZE    0x1000       // SRC (0x000..) and DST (0x800..) channels
 //CSU Registers Address
 #define AES_STATUS_ADDR     0x00FFCA1000
 #define AES_KEY_SRC         0x00FFCA1004
@@ -29,6 +38,30 @@
 #define CSU_DMA_DST_ADDR    0x00FFC80800
 #define CSU_DMA_DST_SIZE    0x00FFC80804
 #define CSU_DMA_DST_STS     0x00FFC80808
+#define CSU_DMA_SRC_CTRL    0x00FFC8000C
+#define CSU_DMA_SRC_I_STS   0x00FFC80014
+#define CSU_DMA_SRC_MSB     0x00FFC80028
+#define CSU_DMA_DST_CTRL    0x00FFC8080C
+#define CSU_DMA_DST_I_STS   0x00FFC80814
+#define CSU_DMA_DST_MSB     0x00FFC80828
+
+// Register bits used by the GCM backend
+#define AES_CFG_DECRYPT     0x0
+#define AES_CFG_ENCRYPT     0x1
+#define AES_STS_DONE        (1u << 2)
+#define AES_STS_TAG_PASS    (1u << 3)
+#define CSU_SSS_DMA_AES     0x000005A0   // DMA -> AES -> DMA
+#define CSU_DMA_STS_BUSY    (1u << 0)
+#define CSU_DMA_I_DONE      (1u << 1)
+#define CSU_DMA_SIZE_LAST   0x1          // LAST_WORD flag in the SIZE register
+#define CSU_DMA_CTRL_ENDIAN (1u << 23)   // Byte swap 32-bit words (AES wants big-endian)
+
+// Physically contiguous DMA memory (u-dma-buf driver), carved into fixed slots
+#define HW_DMA_DEV          "/dev/udmabuf0"
+#define HW_DMA_PHYS_ATTR    "/sys/class/u-dma-buf/udmabuf0/phys_addr"
+#define HW_DMA_SLOT_SZ      256          // IV block (16) + payload (128) + tag (16), padded
+#define HW_DMA_SLOTS        16
+#define HW_DMA_POLL_LIMIT   100000       // Status polls before giving up
 
 #define IV_SZ               12
 #define TAG_SZ              16
@@ -40,13 +73,17 @@
 #define AES_KEY_HEX "a1b2c3d4e5f6789012345678901234567890abcdef1234567890abcdef123456"
 #define AES_KEY_LEN 8 // words
 
-static uint32_t AES_KEY[AES_KEY_LEN];
-static int aes_key_ready = 0;
-
 void convert_hex_to_uint32_8(const char *hex_str, uint32_t out_array[8]);
+int csu_mmap_init(void);
+void csu_mmap_deinit(void);
 uint32_t read_csu_reg(uint64_t addr);
 int reg_write_check(uint64_t addr, uint32_t mask, uint32_t value);
 int write_csu_reg(uint64_t addr, uint32_t mask, uint32_t value);
 int hw_crypto_init(void);
+void hw_crypto_deinit(void);
+int hw_gcm_encrypt(const uint8_t iv[IV_SZ], const uint8_t *in, uint32_t len,
+                   uint8_t *out, uint8_t tag[TAG_SZ]);
+int hw_gcm_decrypt(const uint8_t iv[IV_SZ], const uint8_t *in, uint32_t len,
+                   const uint8_t tag[TAG_SZ], uint8_t *out);
 
 #endif
\ No newline at end of file
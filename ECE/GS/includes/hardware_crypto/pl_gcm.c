@@ -0,0 +1,375 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "pl_gcm.h"
+#include "software_cryptography.h"
+#include "hex_codec.h"
+
+typedef struct {
+    int       fd;
+    void     *map[2];
+    size_t    size[2];
+    uint64_t  phys[2];
+} pl_uio_t;
+
+static pl_uio_t uio_dma  = { -1, { NULL, NULL }, { 0, 0 }, { 0, 0 } };
+static pl_uio_t uio_core = { -1, { NULL, NULL }, { 0, 0 }, { 0, 0 } };
+
+static volatile uint32_t *dma_regs  = NULL;
+static volatile uint32_t *core_regs = NULL;
+static uint8_t           *ring      = NULL;   // PL_GCM_SLOTS slots, uncached (UIO maps memory that way)
+static uint64_t           ring_phys = 0;
+
+// Free-running counters: slot = counter % PL_GCM_SLOTS
+static uint32_t          ring_head = 0;       // Next slot submitted
+static uint32_t          ring_done = 0;       // Next slot completed
+static gs_crypto_job_t  *ring_job[PL_GCM_SLOTS];
+static uint8_t           ring_op[PL_GCM_SLOTS];
+
+// ------------------------- UIO -------------------------
+
+static int sysfs_u64(const char *path, uint64_t *out) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    unsigned long long v = 0;
+    int ok = fscanf(f, "%llx", &v) == 1;
+    fclose(f);
+    *out = v;
+    return ok ? 0 : -1;
+}
+
+// /dev/uioN whose sysfs name is want, or the env override
+static int uio_find(const char *env, const char *want, char *dev, size_t cap) {
+    const char *over = getenv(env);
+    if (over && over[0]) {
+        snprintf(dev, cap, "%s", over);
+        return 0;
+    }
+    for (int i = 0; i < 16; i++) {
+        char path[64], name[64] = "";
+        snprintf(path, sizeof(path), "/sys/class/uio/uio%d/name", i);
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+        int ok = fgets(name, sizeof(name), f) != NULL;
+        fclose(f);
+        name[strcspn(name, "\n")] = '\0';
+        if (ok && strcmp(name, want) == 0) {
+            snprintf(dev, cap, "/dev/uio%d", i);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Maps the first n maps of the device; map M is at offset M * page size
+static int uio_open(pl_uio_t *u, const char *env, const char *name, int n) {
+    char dev[64];
+    if (uio_find(env, name, dev, sizeof(dev)) != 0) {
+        printf("ERROR: no UIO device named %s (%s unset)\n", name, env);
+        return -1;
+    }
+    const char *idx = dev + strlen("/dev/uio");
+
+    u->fd = open(dev, O_RDWR | O_SYNC | O_CLOEXEC);
+    if (u->fd < 0) { perror(dev); return -2; }
+
+    for (int m = 0; m < n; m++) {
+        char path[96];
+        uint64_t size = 0;
+        snprintf(path, sizeof(path), "/sys/class/uio/uio%s/maps/map%d/size", idx, m);
+        if (sysfs_u64(path, &size) != 0 || size == 0) { printf("ERROR: %s unreadable\n", path); return -3; }
+        snprintf(path, sizeof(path), "/sys/class/uio/uio%s/maps/map%d/addr", idx, m);
+        if (sysfs_u64(path, &u->phys[m]) != 0) { printf("ERROR: %s unreadable\n", path); return -3; }
+
+        void *v = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, u->fd, (off_t)m * getpagesize());
+        if (v == MAP_FAILED) { perror("mmap UIO"); return -4; }
+        u->map[m]  = v;
+        u->size[m] = size;
+    }
+    return 0;
+}
+
+static void uio_close(pl_uio_t *u) {
+    for (int m = 0; m < 2; m++) {
+        if (u->map[m]) munmap(u->map[m], u->size[m]);
+        u->map[m]  = NULL;
+        u->size[m] = 0;
+    }
+    if (u->fd >= 0) close(u->fd);
+    u->fd = -1;
+}
+
+static inline uint32_t dma_rd(uint32_t off)             { return dma_regs[off / 4]; }
+static inline void     dma_wr(uint32_t off, uint32_t v) { dma_regs[off / 4] = v; }
+
+// ------------------------- Descriptor ring -------------------------
+// PG021 scatter-gather descriptor, 64-byte aligned; the app words are unused
+
+typedef struct {
+    uint32_t next, next_msb;
+    uint32_t buf, buf_msb;
+    uint32_t rsvd[2];
+    uint32_t ctrl;
+    uint32_t status;
+    uint32_t app[5];
+    uint32_t pad[3];
+} axidma_desc_t;
+
+_Static_assert(sizeof(axidma_desc_t) == 64, "AXI DMA descriptors are 64 bytes apart");
+
+static inline uint8_t *slot_ptr(uint32_t i) { return ring + (size_t)(i % PL_GCM_SLOTS) * PL_GCM_SLOT_SZ; }
+static inline uint64_t slot_phys(uint32_t i) { return ring_phys + (uint64_t)(i % PL_GCM_SLOTS) * PL_GCM_SLOT_SZ; }
+
+static inline volatile axidma_desc_t *slot_desc(uint32_t i, uint32_t off) {
+    return (volatile axidma_desc_t *)(slot_ptr(i) + off);
+}
+
+static void ring_link(void) {
+    for (uint32_t i = 0; i < PL_GCM_SLOTS; i++) {
+        volatile axidma_desc_t *tx = slot_desc(i, PL_GCM_SLOT_MM2S);
+        volatile axidma_desc_t *rx = slot_desc(i, PL_GCM_SLOT_S2MM);
+        uint64_t next = slot_phys(i + 1);
+        uint64_t in   = slot_phys(i) + PL_GCM_SLOT_IN;
+        uint64_t out  = slot_phys(i) + PL_GCM_SLOT_OUT;
+
+        memset((void *)tx, 0, sizeof(*tx));
+        memset((void *)rx, 0, sizeof(*rx));
+        tx->next = (uint32_t)(next + PL_GCM_SLOT_MM2S);  tx->next_msb = (uint32_t)((next + PL_GCM_SLOT_MM2S) >> 32);
+        rx->next = (uint32_t)(next + PL_GCM_SLOT_S2MM);  rx->next_msb = (uint32_t)((next + PL_GCM_SLOT_S2MM) >> 32);
+        tx->buf  = (uint32_t)in;                         tx->buf_msb  = (uint32_t)(in >> 32);
+        rx->buf  = (uint32_t)out;                        rx->buf_msb  = (uint32_t)(out >> 32);
+    }
+}
+
+// Reset both channels and point them at the slot ring_head will use
+static int dma_start(void) {
+    dma_wr(AXIDMA_MM2S_CR, AXIDMA_CR_RESET);             // Resets both channels
+    for (int i = 0; i < PL_GCM_POLL_LIMIT && (dma_rd(AXIDMA_MM2S_CR) & AXIDMA_CR_RESET); i++) {}
+    if (dma_rd(AXIDMA_MM2S_CR) & AXIDMA_CR_RESET) {
+        printf("ERROR: AXI DMA stuck in reset\n");
+        return -1;
+    }
+
+    ring_link();
+    uint64_t tx = slot_phys(ring_head) + PL_GCM_SLOT_MM2S;
+    uint64_t rx = slot_phys(ring_head) + PL_GCM_SLOT_S2MM;
+    dma_wr(AXIDMA_MM2S_CUR_MSB, (uint32_t)(tx >> 32));
+    dma_wr(AXIDMA_MM2S_CUR,     (uint32_t)tx);
+    dma_wr(AXIDMA_S2MM_CUR_MSB, (uint32_t)(rx >> 32));
+    dma_wr(AXIDMA_S2MM_CUR,     (uint32_t)rx);
+    dma_wr(AXIDMA_MM2S_CR, AXIDMA_CR_RS);                // Polled: no interrupt enables
+    dma_wr(AXIDMA_S2MM_CR, AXIDMA_CR_RS);
+
+    if ((dma_rd(AXIDMA_MM2S_SR) | dma_rd(AXIDMA_S2MM_SR)) & AXIDMA_SR_HALTED) {
+        printf("ERROR: AXI DMA did not start (MM2S_SR=0x%08X S2MM_SR=0x%08X)\n",
+               dma_rd(AXIDMA_MM2S_SR), dma_rd(AXIDMA_S2MM_SR));
+        return -2;
+    }
+    return 0;
+}
+
+// ------------------------- Core -------------------------
+
+static int core_load_key(void) {
+    uint8_t key[KEY_SIZE];
+    if (hexc_decode(AES_KEY_HEX, KEY_SIZE * 2, key) != KEY_SIZE) return -1;
+    for (int i = 0; i < KEY_SIZE / 4; i++) {
+        core_regs[PL_GCM_REG_KEY / 4 + i] = (uint32_t)key[i * 4] | (uint32_t)key[i * 4 + 1] << 8 |
+                                            (uint32_t)key[i * 4 + 2] << 16 | (uint32_t)key[i * 4 + 3] << 24;
+    }
+    memset(key, 0, sizeof(key));
+    core_regs[PL_GCM_REG_CTRL / 4] = PL_GCM_CTRL_AUTO | PL_GCM_CTRL_START;
+    return 0;
+}
+
+int pl_gcm_init(void) {
+    if (ring) return 0;
+
+    if (uio_open(&uio_dma, "GS_PL_UIO_DMA", PL_GCM_UIO_DMA, 2) != 0 ||
+        uio_open(&uio_core, "GS_PL_UIO_CORE", PL_GCM_UIO_CORE, 1) != 0) {
+        pl_gcm_deinit();
+        return -1;
+    }
+    if (uio_dma.size[1] < (size_t)PL_GCM_SLOTS * PL_GCM_SLOT_SZ || uio_dma.phys[1] % 64) {
+        printf("ERROR: PL buffer map is %zu bytes at 0x%llX, need %d aligned\n", uio_dma.size[1],
+               (unsigned long long)uio_dma.phys[1], PL_GCM_SLOTS * PL_GCM_SLOT_SZ);
+        pl_gcm_deinit();
+        return -2;
+    }
+
+    dma_regs  = (volatile uint32_t *)uio_dma.map[0];
+    core_regs = (volatile uint32_t *)uio_core.map[0];
+    ring      = (uint8_t *)uio_dma.map[1];
+    ring_phys = uio_dma.phys[1];
+    ring_head = ring_done = 0;
+
+    if (core_load_key() != 0 || dma_start() != 0) {
+        pl_gcm_deinit();
+        return -3;
+    }
+    return 0;
+}
+
+void pl_gcm_deinit(void) {
+    if (dma_regs) {
+        dma_wr(AXIDMA_MM2S_CR, AXIDMA_CR_RESET);         // Stop the engine before the ring goes away
+    }
+    if (core_regs) {
+        core_regs[PL_GCM_REG_CTRL / 4] = 0;              // Clears auto_restart; the key stays until reload
+        for (int i = 0; i < KEY_SIZE / 4; i++) core_regs[PL_GCM_REG_KEY / 4 + i] = 0;
+    }
+    if (ring) memset(ring, 0, (size_t)PL_GCM_SLOTS * PL_GCM_SLOT_SZ);
+    uio_close(&uio_dma);
+    uio_close(&uio_core);
+    dma_regs  = NULL;
+    core_regs = NULL;
+    ring      = NULL;
+    ring_head = ring_done = 0;
+}
+
+uint32_t pl_gcm_inflight(void) {
+    return ring_head - ring_done;
+}
+
+// ------------------------- Submit / poll -------------------------
+
+int pl_gcm_submit(gs_crypto_job_t *jobs, int n, int op) {
+    if (!ring) return -1;
+    int k = 0;
+
+    int queued = 0;
+
+    for (; k < n && pl_gcm_inflight() < PL_GCM_SLOTS; k++) {
+        gs_crypto_job_t *j = &jobs[k];
+        if (j->len == 0 || j->len % 16 || j->len > PL_GCM_LEN_MAX) { j->rc = -1; continue; }
+
+        uint32_t i = ring_head;
+        uint8_t *in = slot_ptr(i) + PL_GCM_SLOT_IN;
+        in[0] = (uint8_t)op;
+        in[1] = 0;
+        in[2] = (uint8_t)j->len;
+        in[3] = (uint8_t)(j->len >> 8);
+        memcpy(in + 4, j->iv, IV_SZ);
+        memcpy(in + 16, j->in, j->len);
+        size_t in_len = 16 + j->len;
+        if (op == PL_GCM_OP_DECRYPT) {
+            memcpy(in + in_len, j->in + j->len, TAG_SZ);
+            in_len += TAG_SZ;
+        }
+
+        volatile axidma_desc_t *tx = slot_desc(i, PL_GCM_SLOT_MM2S);
+        volatile axidma_desc_t *rx = slot_desc(i, PL_GCM_SLOT_S2MM);
+        rx->status = 0;
+        rx->ctrl   = (uint32_t)(j->len + 16);
+        tx->status = 0;
+        tx->ctrl   = (uint32_t)in_len | AXIDMA_DESC_CTRL_SOF | AXIDMA_DESC_CTRL_EOF;
+
+        ring_job[i % PL_GCM_SLOTS] = j;
+        ring_op[i % PL_GCM_SLOTS]  = (uint8_t)op;
+        ring_head++;
+        queued++;
+    }
+    if (queued == 0) return k;
+
+    // Descriptors and records before the tail moves; S2MM first so the
+    // output side is armed when the core starts streaming
+    __sync_synchronize();
+    uint64_t rx_tail = slot_phys(ring_head - 1) + PL_GCM_SLOT_S2MM;
+    uint64_t tx_tail = slot_phys(ring_head - 1) + PL_GCM_SLOT_MM2S;
+    dma_wr(AXIDMA_S2MM_TAIL_MSB, (uint32_t)(rx_tail >> 32));
+    dma_wr(AXIDMA_S2MM_TAIL,     (uint32_t)rx_tail);
+    dma_wr(AXIDMA_MM2S_TAIL_MSB, (uint32_t)(tx_tail >> 32));
+    dma_wr(AXIDMA_MM2S_TAIL,     (uint32_t)tx_tail);
+    return k;
+}
+
+// Fails every job in flight and restarts the engine at ring_head
+static int pl_gcm_fail_all(int rc) {
+    printf("ERROR: PL AES-GCM DMA error (MM2S_SR=0x%08X S2MM_SR=0x%08X), %u jobs lost\n",
+           dma_rd(AXIDMA_MM2S_SR), dma_rd(AXIDMA_S2MM_SR), pl_gcm_inflight());
+    for (; ring_done != ring_head; ring_done++) ring_job[ring_done % PL_GCM_SLOTS]->rc = rc;
+    dma_start();
+    return rc;
+}
+
+int pl_gcm_poll(void) {
+    if (!ring) return -1;
+    if ((dma_rd(AXIDMA_MM2S_SR) | dma_rd(AXIDMA_S2MM_SR)) & AXIDMA_SR_ERR) return pl_gcm_fail_all(-7);
+
+    int done = 0;
+    while (ring_done != ring_head) {
+        uint32_t i = ring_done;
+        uint32_t st = slot_desc(i, PL_GCM_SLOT_S2MM)->status;
+        if (!(st & AXIDMA_DESC_CMPLT)) break;
+        __sync_synchronize();
+
+        gs_crypto_job_t *j = ring_job[i % PL_GCM_SLOTS];
+        const uint8_t *out = slot_ptr(i) + PL_GCM_SLOT_OUT;
+        if (st & AXIDMA_DESC_ERR || (st & AXIDMA_DESC_LEN_MASK) != j->len + 16) {
+            j->rc = -7;
+        } else if (ring_op[i % PL_GCM_SLOTS] == PL_GCM_OP_ENCRYPT) {
+            memcpy(j->out, out, j->len + TAG_SZ);        // Ciphertext || tag
+            j->rc = 0;
+        } else if (out[j->len] == 1) {
+            memcpy(j->out, out, j->len);
+            j->rc = 0;
+        } else {
+            j->rc = GS_CRYPTO_EAUTH;
+        }
+        memset(slot_ptr(i) + PL_GCM_SLOT_IN, 0, PL_GCM_SLOT_SZ - PL_GCM_SLOT_IN);   // No plaintext left behind
+        ring_done++;
+        done++;
+    }
+    return done;
+}
+
+// ------------------------- Provider glue -------------------------
+
+// Submits every job (in ring-sized pieces) and waits for all of them. The
+// provider calls are serialized (gs_crypto_*), so the ring is empty on entry.
+static int pl_run(gs_crypto_job_t *jobs, int n, int op) {
+    int taken = 0, idle = 0;
+
+    while (taken < n || pl_gcm_inflight()) {
+        if (taken < n) {
+            int q = pl_gcm_submit(jobs + taken, n - taken, op);
+            if (q < 0) return q;
+            taken += q;
+        }
+        int d = pl_gcm_poll();
+        if (d < 0) return d;
+        idle = d ? 0 : idle + 1;
+        if (idle > PL_GCM_POLL_LIMIT) return pl_gcm_fail_all(-6);
+    }
+    return 0;
+}
+
+static int pl_encrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out) {
+    gs_crypto_job_t j = { iv, in, len, out, 0 };
+    int rc = pl_run(&j, 1, PL_GCM_OP_ENCRYPT);
+    return rc < 0 ? rc : j.rc;
+}
+
+static int pl_decrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out) {
+    gs_crypto_job_t j = { iv, in, len, out, 0 };
+    int rc = pl_run(&j, 1, PL_GCM_OP_DECRYPT);
+    return rc < 0 ? rc : j.rc;
+}
+
+static int pl_encrypt_batch(gs_crypto_job_t *jobs, int n) {
+    return pl_run(jobs, n, PL_GCM_OP_ENCRYPT);
+}
+
+static int pl_decrypt_batch(gs_crypto_job_t *jobs, int n) {
+    return pl_run(jobs, n, PL_GCM_OP_DECRYPT);
+}
+
+const gs_crypto_provider_t gs_provider_pl = {
+    "pl_gcm", GS_SUITE_AES_GCM, pl_gcm_init, pl_encrypt, pl_decrypt, pl_gcm_deinit,
+    pl_encrypt_batch, pl_decrypt_batch
+};
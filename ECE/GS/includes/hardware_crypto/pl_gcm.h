@@ -0,0 +1,90 @@
+#ifndef PL_GCM_H
+#define PL_GCM_H
+
+#include <stdint.h>
+
+#include "crypto_provider.h"
+
+// ------------------------- PL AES-GCM accelerator -------------------------
+// AES-256-GCM in the Zynq PL (ECE/GS/pl: HLS core + bitstream scripts), so
+// sealing for many robot links costs no PS core at all. The core takes one
+// record per packet on an AXI4-Stream and returns one; an AXI DMA in
+// scatter-gather mode moves them between the stream and a ring of slots in
+// a reserved-memory buffer. Both come to user space through UIO (generic-uio
+// nodes from pl/pl_gcm_overlay.dtsi):
+//   PL_GCM_UIO_DMA   map0 = AXI DMA registers, map1 = the buffer ring
+//   PL_GCM_UIO_CORE  map0 = the core's AXI-Lite registers (key, ap_ctrl)
+// GS_PL_UIO_DMA / GS_PL_UIO_CORE (/dev/uioN) override the lookup by name.
+//
+// Ring slot i holds the MM2S and S2MM descriptors of job i and its input
+// and output records; the descriptors of consecutive slots are chained in a
+// circle, so a batch of k jobs is k filled slots and one TAILDESC write per
+// channel. Completion is polled on the S2MM descriptors' Cmplt bit, in
+// submission order; no interrupts, no syscalls per packet.
+//
+// Stream records (16-byte beats, little-endian):
+//   in   [op u8][0][len u16][iv 12] | payload[len] | tag[16] (decrypt only)
+//   out  payload'[len] | trailer[16]: encrypt = tag, decrypt = byte 0 is 1
+//        when the tag matched (the payload is then the plaintext)
+// len is a multiple of 16 up to PL_GCM_LEN_MAX (CT_SZ and compact seals are).
+
+#define PL_GCM_UIO_DMA      "pl_gcm_dma"
+#define PL_GCM_UIO_CORE     "pl_gcm_core"
+
+#define PL_GCM_SLOTS        64              // Ring slots = jobs in flight (power of two)
+#define PL_GCM_SLOT_SZ      1024
+#define PL_GCM_LEN_MAX      256
+#define PL_GCM_POLL_LIMIT   1000000         // Empty polls before a job counts as lost
+
+// Slot layout
+#define PL_GCM_SLOT_MM2S    0x000           // MM2S descriptor (64-byte aligned)
+#define PL_GCM_SLOT_S2MM    0x040           // S2MM descriptor
+#define PL_GCM_SLOT_IN      0x080           // Input record (16 + len + 16)
+#define PL_GCM_SLOT_OUT     0x200           // Output record (len + 16)
+
+// Core AXI-Lite registers (HLS ap_ctrl_hs block, then the key argument)
+#define PL_GCM_REG_CTRL     0x00
+#define PL_GCM_CTRL_START   (1u << 0)
+#define PL_GCM_CTRL_IDLE    (1u << 2)
+#define PL_GCM_CTRL_AUTO    (1u << 7)       // auto_restart: one record per run, forever
+#define PL_GCM_REG_KEY      0x10            // 8 words, key byte i at bits 8i..8i+7
+
+// AXI DMA (PG021) registers and descriptor fields
+#define AXIDMA_MM2S_CR      0x00
+#define AXIDMA_MM2S_SR      0x04
+#define AXIDMA_MM2S_CUR     0x08
+#define AXIDMA_MM2S_CUR_MSB 0x0C
+#define AXIDMA_MM2S_TAIL    0x10
+#define AXIDMA_MM2S_TAIL_MSB 0x14
+#define AXIDMA_S2MM_CR      0x30
+#define AXIDMA_S2MM_SR      0x34
+#define AXIDMA_S2MM_CUR     0x38
+#define AXIDMA_S2MM_CUR_MSB 0x3C
+#define AXIDMA_S2MM_TAIL    0x40
+#define AXIDMA_S2MM_TAIL_MSB 0x44
+#define AXIDMA_CR_RS        (1u << 0)
+#define AXIDMA_CR_RESET     (1u << 2)
+#define AXIDMA_SR_HALTED    (1u << 0)
+#define AXIDMA_SR_ERR       0x00000770u     // Internal / slave / decode and SG errors
+#define AXIDMA_DESC_CTRL_SOF (1u << 27)
+#define AXIDMA_DESC_CTRL_EOF (1u << 26)
+#define AXIDMA_DESC_LEN_MASK 0x03FFFFFFu
+#define AXIDMA_DESC_CMPLT   (1u << 31)
+#define AXIDMA_DESC_ERR     (7u << 28)
+
+#define PL_GCM_OP_ENCRYPT   0
+#define PL_GCM_OP_DECRYPT   1
+
+int  pl_gcm_init(void);
+void pl_gcm_deinit(void);
+// Queues jobs[0..n) until the ring is full; jobs[] must stay valid until
+// pl_gcm_poll() has completed them. Returns how many were taken: queued,
+// or finished at once with rc = -1 (len not a multiple of 16 up to
+// PL_GCM_LEN_MAX).
+int  pl_gcm_submit(gs_crypto_job_t *jobs, int n, int op);
+// Completes finished jobs in submission order (out and rc filled).
+// Returns how many, or <0 on a DMA error (the ring is then reset).
+int  pl_gcm_poll(void);
+uint32_t pl_gcm_inflight(void);
+
+#endif
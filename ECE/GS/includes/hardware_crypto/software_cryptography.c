@@ -1,21 +1,92 @@
 #include "software_cryptography.h"
+#include "crypto_provider.h"
+#include "hex_codec.h"
+
+/* One keyed transform / op socket pair per suite */
+typedef struct {
+    const char *alg;
+    int tfmfd, opfd;
+} af_alg_pair_t;
+
+static af_alg_pair_t g_alg[GS_SUITES] = {
+    [GS_SUITE_AES_GCM]           = { "gcm(aes)",                   -1, -1 },
+    [GS_SUITE_CHACHA20_POLY1305] = { "rfc7539(chacha20,poly1305)", -1, -1 },
+};
+
+/* Nonce source shared by every encrypt path */
+#define NONCE_POOL_SZ (IV_SZ * 32)                  /* 32 random IVs per getrandom() */
+
+static gs_nonce_mode_t g_nonce_mode = GS_NONCE_COUNTER;
+static uint8_t  g_nonce_pool[NONCE_POOL_SZ];
+static size_t   g_nonce_pos  = NONCE_POOL_SZ;       /* Empty until first use */
+static uint8_t  g_nonce_salt[4];                    /* Counter mode: per-session fixed field */
+static uint64_t g_nonce_ctr  = 0;                   /* Counter mode: invocation field */
+static int      g_nonce_seeded = 0;                 /* Counter mode: salt and start drawn */
+static uint8_t  g_nonce_dir  = REPLAY_DIR_GS;
+
+static int fill_random(uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = getrandom(buf, len, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
 
-#define AES_KEY_HEX "a1b2c3d4e5f6789012345678901234567890abcdef1234567890abcdef123456"
+/* GCM only needs IVs to be unique per key. GS_NONCE_COUNTER (default) is the
+ * SP 800-38D deterministic form the robot's replay window reads
+ * (replay_window.h): 4-byte random session salt with the direction bit ||
+ * 64-bit big-endian sequence, no syscalls after the salt is drawn. The
+ * sequence starts at the wall clock in microseconds, so a restarted bridge
+ * still counts up past everything the robot has already accepted on a link
+ * that stayed up. GS_NONCE_RANDOM hands out 12-byte slices of a getrandom()
+ * pool (one syscall per 32 packets); it carries no usable sequence, so the
+ * robot refuses most of those packets as replays. */
+static int nonce_seed(void)
+{
+    struct timespec ts;
+    if (fill_random(g_nonce_salt, sizeof(g_nonce_salt)) != 0) return -2;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    g_nonce_ctr = (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+    g_nonce_seeded = 1;
+    return 0;
+}
 
-static int g_tfmfd = -1;
-static int g_opfd  = -1;
+int gs_nonce_set_mode(gs_nonce_mode_t mode)
+{
+    if (mode != GS_NONCE_RANDOM && mode != GS_NONCE_COUNTER) return -1;
+    if (mode == GS_NONCE_COUNTER && nonce_seed() != 0) return -2;
+    g_nonce_mode = mode;
+    return 0;
+}
 
-static void convert_key_str(const char *hex, uint8_t *out)
+/* REPLAY_DIR_GS unless this process seals as the robot (esp_sim) */
+void gs_nonce_set_dir(uint8_t dir)
 {
-    for (int i = 0; i < KEY_SIZE; i++)
-        sscanf(hex + i * 2, "%02hhx", &out[i]);
+    g_nonce_dir = dir & REPLAY_DIR_MASK;
 }
 
-static void convert_msg_str(const char *hex, uint8_t *out)
+int gs_nonce_next(uint8_t iv[IV_SZ])
 {
-    int len = strlen(hex) / 2;
-    for (int i = 0; i < len; i++)
-        sscanf(hex + i * 2, "%02hhx", &out[i]);
+    if (g_nonce_mode == GS_NONCE_COUNTER) {
+        if (!g_nonce_seeded && nonce_seed() != 0) return -1;
+        return replay_nonce_next(iv, g_nonce_salt, g_nonce_dir, &g_nonce_ctr) ? 0 : -1;   /* Never wrap */
+    }
+
+    if (g_nonce_pos + IV_SZ > NONCE_POOL_SZ) {
+        if (fill_random(g_nonce_pool, NONCE_POOL_SZ) != 0) return -1;
+        g_nonce_pos = 0;
+    }
+    memcpy(iv, g_nonce_pool + g_nonce_pos, IV_SZ);
+    memset(g_nonce_pool + g_nonce_pos, 0, IV_SZ);   /* Never hand out a slice twice */
+    g_nonce_pos += IV_SZ;
+    iv[0] = (uint8_t)((iv[0] & ~REPLAY_DIR_MASK) | g_nonce_dir);
+    return 0;
 }
 
 int strip_pad(const uint8_t *buf, int len)
@@ -25,45 +96,193 @@ int strip_pad(const uint8_t *buf, int len)
     return len;
 }
 
-int gs_sw_crypto_init()
+/* Accept a ciphertext packet in any of the wire forms and return the raw
+ * IV || CT || tag bytes:
+ *   - TOTAL_SZ raw bytes (binary UDS / notify payload)
+ *   - CIPHER_FRAME_SZ bytes framed 0x0A 0xD0 .. 0xDA 0x0D (robot link framing)
+ *   - PAYLOAD_HEX_STR_LEN hex chars, whitespace ignored (legacy text mode)
+ * Returns 0, or -2 (bad size) / -3 (bad hex). */
+int cipher_payload_decode(const uint8_t *buf, size_t len, uint8_t out[TOTAL_SZ])
 {
+    if (!buf || !out) return -1;
+
+    if (len == TOTAL_SZ) { memcpy(out, buf, TOTAL_SZ); return 0; }
+
+    if (len == CIPHER_FRAME_SZ && buf[0] == CIPHER_SOF0 && buf[1] == CIPHER_SOF1 &&
+        buf[CIPHER_FRAME_SZ - 2] == CIPHER_EOF0 && buf[CIPHER_FRAME_SZ - 1] == CIPHER_EOF1) {
+        memcpy(out, buf + 2, TOTAL_SZ);
+        return 0;
+    }
+
+    /* Hex: strip whitespace into a clean buffer first */
+    char clean[PAYLOAD_HEX_STR_LEN + 1] = {0};
+    size_t clean_len = 0;
+    for (size_t i = 0; i < len && buf[i] != '\0'; i++) {
+        unsigned char c = buf[i];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') continue;
+        if (clean_len >= PAYLOAD_HEX_STR_LEN) return -2;
+        clean[clean_len++] = (char)c;
+    }
+    if (clean_len != PAYLOAD_HEX_STR_LEN) return -2;
+
+    if (hexc_decode(clean, PAYLOAD_HEX_STR_LEN, out) != TOTAL_SZ) return -3;
+    return 0;
+}
+
+/* The keyed transform socket and its op socket live for the whole bridge
+ * session; each packet is one sendmsg()/read() pair on opfd. Safe to call
+ * repeatedly: returns 0 immediately when the pair is already open. */
+static void af_alg_close(af_alg_pair_t *a)
+{
+    if (a->opfd  >= 0) { close(a->opfd);  a->opfd  = -1; }
+    if (a->tfmfd >= 0) { close(a->tfmfd); a->tfmfd = -1; }
+}
+
+static int af_alg_open(af_alg_pair_t *a)
+{
+    if (a->opfd >= 0) return 0;
+
     uint8_t key[KEY_SIZE];
 
     struct sockaddr_alg sa = {
         .salg_family = AF_ALG,
         .salg_type   = "aead",
-        .salg_name   = "gcm(aes)"
     };
+    strncpy((char *)sa.salg_name, a->alg, sizeof(sa.salg_name) - 1);
 
-    convert_key_str(AES_KEY_HEX, key);
+    if (hexc_decode(AES_KEY_HEX, KEY_SIZE * 2, key) != KEY_SIZE) return -1;
 
-    g_tfmfd = socket(AF_ALG, SOCK_SEQPACKET, 0);
-    if (g_tfmfd < 0) return -1;
+    a->tfmfd = socket(AF_ALG, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (a->tfmfd < 0) return -1;
 
-    if (bind(g_tfmfd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
-        close(g_tfmfd); return -2;
+    if (bind(a->tfmfd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        af_alg_close(a); return -2;
     }
 
-    if (setsockopt(g_tfmfd, SOL_ALG, ALG_SET_AEAD_AUTHSIZE, NULL, TAG_SZ) < 0) {
-        close(g_tfmfd); return -3;
+    if (setsockopt(a->tfmfd, SOL_ALG, ALG_SET_AEAD_AUTHSIZE, NULL, TAG_SZ) < 0) {
+        af_alg_close(a); return -3;
     }
 
-    if (setsockopt(g_tfmfd, SOL_ALG, ALG_SET_KEY, key, KEY_SIZE) < 0) {
-        close(g_tfmfd); return -4;
+    if (setsockopt(a->tfmfd, SOL_ALG, ALG_SET_KEY, key, KEY_SIZE) < 0) {
+        af_alg_close(a); return -4;
     }
 
-    g_opfd = accept(g_tfmfd, NULL, 0);
-    if (g_opfd < 0) { close(g_tfmfd); return -5; }
+    a->opfd = accept(a->tfmfd, NULL, 0);
+    if (a->opfd < 0) { af_alg_close(a); return -5; }
 
     return 0;
 }
 
+int gs_sw_crypto_init()
+{
+    return af_alg_open(&g_alg[GS_SUITE_AES_GCM]);
+}
+
 void gs_sw_crypto_deinit()
 {
-    if (g_opfd  >= 0) { close(g_opfd);  g_opfd  = -1; }
-    if (g_tfmfd >= 0) { close(g_tfmfd); g_tfmfd = -1; }
+    af_alg_close(&g_alg[GS_SUITE_AES_GCM]);
+}
+
+static int af_alg_chacha_init(void)
+{
+    return af_alg_open(&g_alg[GS_SUITE_CHACHA20_POLY1305]);
+}
+
+static void af_alg_chacha_deinit(void)
+{
+    af_alg_close(&g_alg[GS_SUITE_CHACHA20_POLY1305]);
+}
+
+/* One AEAD operation on the persistent op socket:
+ *   op = ALG_OP_ENCRYPT / ALG_OP_DECRYPT, iv = IV_SZ bytes,
+ *   in/in_len -> out/out_len. Returns bytes read, or a negative code.
+ * A failed tag check (EBADMSG) is a normal result and keeps the socket; any
+ * other socket error drops the pair and retries once on a fresh one. */
+static int af_alg_op(af_alg_pair_t *a, uint32_t op, const uint8_t iv[IV_SZ],
+                        const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len)
+{
+    char cbuf[CMSG_SPACE(4) + CMSG_SPACE(sizeof(struct af_alg_iv) + IV_SZ)];
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (af_alg_open(a) != 0) return -6;
+
+        memset(cbuf, 0, sizeof(cbuf));
+        struct msghdr msg = { .msg_control = cbuf, .msg_controllen = sizeof(cbuf) };
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_ALG;
+        cmsg->cmsg_type  = ALG_SET_OP;
+        cmsg->cmsg_len   = CMSG_LEN(4);
+        *((__u32 *)CMSG_DATA(cmsg)) = op;
+
+        cmsg = CMSG_NXTHDR(&msg, cmsg);
+        cmsg->cmsg_level = SOL_ALG;
+        cmsg->cmsg_type  = ALG_SET_IV;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(struct af_alg_iv) + IV_SZ);
+        struct af_alg_iv *alg_iv = (struct af_alg_iv *)CMSG_DATA(cmsg);
+        alg_iv->ivlen = IV_SZ;
+        memcpy(alg_iv->iv, iv, IV_SZ);
+
+        struct iovec iov = { .iov_base = (void *)in, .iov_len = in_len };
+        msg.msg_iov    = &iov;
+        msg.msg_iovlen = 1;
+
+        if (sendmsg(a->opfd, &msg, 0) < 0) { af_alg_close(a); continue; }
+
+        ssize_t res = read(a->opfd, out, out_len);
+        if (res >= 0) return (int)res;
+        if (errno == EBADMSG) return GS_CRYPTO_EAUTH;    /* Authentication failed */
+        af_alg_close(a);
+    }
+    return -7;
+}
+
+static int af_alg_seal(af_alg_pair_t *a, const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    int res = af_alg_op(a, ALG_OP_ENCRYPT, iv, in, len, out, len + TAG_SZ);
+    if (res < 0) return res;
+    return (res == (int)(len + TAG_SZ)) ? 0 : -8;
+}
+
+static int af_alg_unseal(af_alg_pair_t *a, const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    int res = af_alg_op(a, ALG_OP_DECRYPT, iv, in, len + TAG_SZ, out, len);
+    if (res < 0) return res;
+    return (res == (int)len) ? 0 : -8;
+}
+
+static int af_alg_encrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    return af_alg_seal(&g_alg[GS_SUITE_AES_GCM], iv, in, len, out);
+}
+
+static int af_alg_decrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    return af_alg_unseal(&g_alg[GS_SUITE_AES_GCM], iv, in, len, out);
+}
+
+/* RFC 7539 AEAD: the kernel takes the same 12-byte IV and appends the
+ * Poly1305 tag where GCM puts its own, so packets keep their layout */
+static int af_alg_chacha_encrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    return af_alg_seal(&g_alg[GS_SUITE_CHACHA20_POLY1305], iv, in, len, out);
+}
+
+static int af_alg_chacha_decrypt(const uint8_t iv[IV_SZ], const uint8_t *in, size_t len, uint8_t *out)
+{
+    return af_alg_unseal(&g_alg[GS_SUITE_CHACHA20_POLY1305], iv, in, len, out);
 }
 
+const gs_crypto_provider_t gs_provider_af_alg = {
+    "af_alg", GS_SUITE_AES_GCM, gs_sw_crypto_init, af_alg_encrypt, af_alg_decrypt, gs_sw_crypto_deinit,
+    NULL, NULL
+};
+
+const gs_crypto_provider_t gs_provider_af_alg_chacha = {
+    "af_alg_chacha", GS_SUITE_CHACHA20_POLY1305, af_alg_chacha_init, af_alg_chacha_encrypt,
+    af_alg_chacha_decrypt, af_alg_chacha_deinit, NULL, NULL
+};
+
 int encrypt_json(const char *Plaintext, uint8_t Ciphertext[TOTAL_SZ])
 {
     if (!Plaintext || !Ciphertext) return -1;
@@ -77,50 +296,16 @@ int encrypt_json(const char *Plaintext, uint8_t Ciphertext[TOTAL_SZ])
     memset(input, PAD_BYTE, CT_SZ);
     memcpy(input, Plaintext, str_len);
 
-    /* Generate random IV */
+    /* Fresh IV from the shared nonce source */
     uint8_t iv[IV_SZ];
-    FILE *f = fopen("/dev/urandom", "rb");
-    if (!f) return -4;
-    if ((int)fread(iv, 1, IV_SZ, f) != IV_SZ) { fclose(f); return -5; }
-    fclose(f);
-
-    if (gs_sw_crypto_init() != 0) return -6;
-
-    char cbuf[CMSG_SPACE(4) + CMSG_SPACE(sizeof(struct af_alg_iv) + IV_SZ)];
-    memset(cbuf, 0, sizeof(cbuf));
-
-    struct msghdr msg = { .msg_control = cbuf, .msg_controllen = sizeof(cbuf) };
-
-    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
-    cmsg->cmsg_level = SOL_ALG;
-    cmsg->cmsg_type  = ALG_SET_OP;
-    cmsg->cmsg_len   = CMSG_LEN(4);
-    *((__u32 *)CMSG_DATA(cmsg)) = ALG_OP_ENCRYPT;
-
-    cmsg = CMSG_NXTHDR(&msg, cmsg);
-    cmsg->cmsg_level = SOL_ALG;
-    cmsg->cmsg_type  = ALG_SET_IV;
-    cmsg->cmsg_len   = CMSG_LEN(sizeof(struct af_alg_iv) + IV_SZ);
-    struct af_alg_iv *alg_iv = (struct af_alg_iv *)CMSG_DATA(cmsg);
-    alg_iv->ivlen = IV_SZ;
-    memcpy(alg_iv->iv, iv, IV_SZ);
-
-    struct iovec iov = { .iov_base = input, .iov_len = CT_SZ };
-    msg.msg_iov    = &iov;
-    msg.msg_iovlen = 1;
+    if (gs_nonce_next(iv) != 0) return -4;
 
-    if (sendmsg(g_opfd, &msg, 0) < 0) { gs_sw_crypto_deinit(); return -7; }
-
-    uint8_t raw_out[CT_SZ + TAG_SZ];
-    if (read(g_opfd, raw_out, CT_SZ + TAG_SZ) != CT_SZ + TAG_SZ) {
-        gs_sw_crypto_deinit(); return -8;
-    }
-
-    gs_sw_crypto_deinit();
+    /* Ciphertext || tag land directly after the IV in the output */
+    int res = gs_crypto_encrypt(iv, input, CT_SZ, Ciphertext + IV_SZ);
+    if (res < 0) return res;
 
     /* Pack raw bytes: IV || ciphertext || tag → TOTAL_SZ(156) bytes */
-    memcpy(Ciphertext,          iv,      IV_SZ);
-    memcpy(Ciphertext + IV_SZ,  raw_out, CT_SZ + TAG_SZ);
+    memcpy(Ciphertext, iv, IV_SZ);
 
     return 0;
 }
@@ -134,49 +319,13 @@ int encrypt_cmd(const robot_bt_packet_t *packet, uint8_t *cipher_out, size_t *ci
     memcpy(input, packet->bytes, sizeof(robot_bt_packet_t));
 
     uint8_t iv[IV_SZ];
-    FILE *f = fopen("/dev/urandom", "rb");
-    if (!f) return -4;
-    if ((int)fread(iv, 1, IV_SZ, f) != IV_SZ) { fclose(f); return -5; }
-    fclose(f);
-
-    if (gs_sw_crypto_init() != 0) return -6;
-
-    char cbuf[CMSG_SPACE(4) + CMSG_SPACE(sizeof(struct af_alg_iv) + IV_SZ)];
-    memset(cbuf, 0, sizeof(cbuf));
-
-    struct msghdr msg = { .msg_control = cbuf, .msg_controllen = sizeof(cbuf) };
-
-    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
-    cmsg->cmsg_level = SOL_ALG;
-    cmsg->cmsg_type  = ALG_SET_OP;
-    cmsg->cmsg_len   = CMSG_LEN(4);
-    *((__u32 *)CMSG_DATA(cmsg)) = ALG_OP_ENCRYPT;
-
-    cmsg = CMSG_NXTHDR(&msg, cmsg);
-    cmsg->cmsg_level = SOL_ALG;
-    cmsg->cmsg_type  = ALG_SET_IV;
-    cmsg->cmsg_len   = CMSG_LEN(sizeof(struct af_alg_iv) + IV_SZ);
-    struct af_alg_iv *alg_iv = (struct af_alg_iv *)CMSG_DATA(cmsg);
-    alg_iv->ivlen = IV_SZ;
-    memcpy(alg_iv->iv, iv, IV_SZ);
-
-    struct iovec iov = { .iov_base = input, .iov_len = CT_SZ };
-    msg.msg_iov    = &iov;
-    msg.msg_iovlen = 1;
-
-    if (sendmsg(g_opfd, &msg, 0) < 0) { gs_sw_crypto_deinit(); return -7; }
+    if (gs_nonce_next(iv) != 0) return -4;
 
     // Output buffer: IV || ciphertext || tag  (all raw bytes)
-    uint8_t raw_out[CT_SZ + TAG_SZ];
-    if (read(g_opfd, raw_out, CT_SZ + TAG_SZ) != CT_SZ + TAG_SZ) {
-        gs_sw_crypto_deinit(); return -8;
-    }
+    int res = gs_crypto_encrypt(iv, input, CT_SZ, cipher_out + IV_SZ);
+    if (res < 0) return res;
 
-    gs_sw_crypto_deinit();
-
-    // Pack IV || ciphertext || tag into output buffer
-    memcpy(cipher_out,          iv,      IV_SZ);
-    memcpy(cipher_out + IV_SZ,  raw_out, CT_SZ + TAG_SZ);
+    memcpy(cipher_out, iv, IV_SZ);
     *cipher_out_len = IV_SZ + CT_SZ + TAG_SZ;
 
     return 0;
@@ -189,42 +338,10 @@ int decrypt_json(const uint8_t *encrypted, char *json_out, size_t json_out_len)
     _Static_assert(TOTAL_SZ == 156, "TOTAL_SZ must be 156 bytes (IV_SZ + CT_SZ + TAG_SZ)");
 
     uint8_t output[CT_SZ + 1] = {0};
-    struct msghdr  msg  = {0};
-    struct cmsghdr *cmsg;
-    char cbuf[CMSG_SPACE(4) + CMSG_SPACE(sizeof(struct af_alg_iv) + IV_SZ)] = {0};
-
-    if (gs_sw_crypto_init() != 0) return -2;
-
-    msg.msg_control    = cbuf;
-    msg.msg_controllen = sizeof(cbuf);
-
-    cmsg = CMSG_FIRSTHDR(&msg);
-    cmsg->cmsg_level = SOL_ALG;
-    cmsg->cmsg_type  = ALG_SET_OP;
-    cmsg->cmsg_len   = CMSG_LEN(4);
-    *(uint32_t *)CMSG_DATA(cmsg) = ALG_OP_DECRYPT;
-
-    cmsg = CMSG_NXTHDR(&msg, cmsg);
-    cmsg->cmsg_level = SOL_ALG;
-    cmsg->cmsg_type  = ALG_SET_IV;
-    cmsg->cmsg_len   = CMSG_LEN(sizeof(struct af_alg_iv) + IV_SZ);
-    struct af_alg_iv *iv_ptr = (void *)CMSG_DATA(cmsg);
-    iv_ptr->ivlen = IV_SZ;
-    memcpy(iv_ptr->iv, encrypted, IV_SZ);
-
-    struct iovec iov = {
-        .iov_base = (void *)(encrypted + IV_SZ),
-        .iov_len  = CT_SZ + TAG_SZ
-    };
-    msg.msg_iov    = &iov;
-    msg.msg_iovlen = 1;
 
-    if (sendmsg(g_opfd, &msg, 0) < 0) { gs_sw_crypto_deinit(); return -3; }
-
-    int res = read(g_opfd, output, CT_SZ);
-    gs_sw_crypto_deinit();
-
-    if (res < 0) return -4;
+    /* IV is the first IV_SZ(12) bytes; ciphertext || tag follow */
+    if (gs_crypto_decrypt(encrypted, encrypted + IV_SZ, CT_SZ, output) != 0) return -4;
+    int res = CT_SZ;
 
     /* Strip PAD_BYTE (0xFF) from end of decrypted buffer */
     int str_len = res;
@@ -247,45 +364,181 @@ int decrypt_cmd(const uint8_t *encrypted, robot_bt_packet_t *pkt_out)
     _Static_assert(TOTAL_SZ == 156, "TOTAL_SZ must be 156 bytes (IV_SZ + CT_SZ + TAG_SZ)");
 
     uint8_t output[CT_SZ] = {0};
-    struct msghdr msg = {0};
-    struct cmsghdr *cmsg;
-    char cbuf[CMSG_SPACE(4) + CMSG_SPACE(sizeof(struct af_alg_iv) + IV_SZ)] = {0};
-
-    if (gs_sw_crypto_init() != 0) return -2;
-
-    msg.msg_control    = cbuf;
-    msg.msg_controllen = sizeof(cbuf);
-
-    cmsg = CMSG_FIRSTHDR(&msg);
-    cmsg->cmsg_level = SOL_ALG;
-    cmsg->cmsg_type  = ALG_SET_OP;
-    cmsg->cmsg_len   = CMSG_LEN(4);
-    *(uint32_t *)CMSG_DATA(cmsg) = ALG_OP_DECRYPT;
-
-    cmsg = CMSG_NXTHDR(&msg, cmsg);
-    cmsg->cmsg_level = SOL_ALG;
-    cmsg->cmsg_type  = ALG_SET_IV;
-    cmsg->cmsg_len   = CMSG_LEN(sizeof(struct af_alg_iv) + IV_SZ);
-    struct af_alg_iv *iv_ptr = (void *)CMSG_DATA(cmsg);
-    iv_ptr->ivlen = IV_SZ;
-    memcpy(iv_ptr->iv, encrypted, IV_SZ);             /* first IV_SZ(12) bytes */
-
-    struct iovec iov = {
-        .iov_base = (void *)(encrypted + IV_SZ),      /* skip IV_SZ(12) prefix */
-        .iov_len  = CT_SZ + TAG_SZ                    /* 128 + 16 = 144 bytes  */
-    };
-    msg.msg_iov    = &iov;
-    msg.msg_iovlen = 1;
-
-    if (sendmsg(g_opfd, &msg, 0) < 0) { gs_sw_crypto_deinit(); return -3; }
 
-    int res = read(g_opfd, output, CT_SZ);
-    gs_sw_crypto_deinit();
-
-    if (res < 0) return -4;
+    int res = gs_crypto_decrypt(encrypted,          /* first IV_SZ(12) bytes */
+                                            encrypted + IV_SZ,  /* skip IV_SZ(12) prefix */
+                                            CT_SZ,              /* 128 + 16(tag) bytes   */
+                                            output);
+    if (res != 0) return -4;
 
     memset(pkt_out, 0, sizeof(robot_bt_packet_t));
     memcpy(pkt_out->bytes, output, sizeof(robot_bt_packet_t));
 
     return 0;
-}
\ No newline at end of file
+}
+
+/* Batched forms for bursts (IMU parts 0/1/2, queued UI commands). Every
+ * packet still gets its own IV and tag; the batch shares one provider lookup,
+ * one padded staging buffer and the already-keyed context / op socket.
+ * encrypt_batch returns n or the first error; decrypt_batch returns how many
+ * packets authenticated, with per-packet status (0 / -4) when status != NULL. */
+/* Up to GS_CRYPTO_BATCH_MAX packets per provider call, so a batching
+ * provider (PL) gets them in one submission */
+int encrypt_batch(const robot_bt_packet_t *packets, size_t n, uint8_t (*cipher_out)[TOTAL_SZ])
+{
+    if (!packets || !cipher_out) return -1;
+
+    uint8_t input[GS_CRYPTO_BATCH_MAX][CT_SZ];
+    gs_crypto_job_t jobs[GS_CRYPTO_BATCH_MAX];
+
+    for (size_t i = 0; i < n; ) {
+        int k = 0;
+        for (; k < GS_CRYPTO_BATCH_MAX && i + k < n; k++) {
+            memset(input[k], PAD_BYTE, CT_SZ);
+            memcpy(input[k], packets[i + k].bytes, sizeof(robot_bt_packet_t));
+            if (gs_nonce_next(cipher_out[i + k]) != 0) return -4;   /* IV goes straight to the output */
+            jobs[k] = (gs_crypto_job_t){ cipher_out[i + k], input[k], CT_SZ, cipher_out[i + k] + IV_SZ, 0 };
+        }
+
+        int res = gs_crypto_encrypt_batch(jobs, k);
+        if (res < 0) return res;
+        for (int j = 0; j < k; j++)
+            if (jobs[j].rc < 0) return jobs[j].rc;
+        i += (size_t)k;
+    }
+    return (int)n;
+}
+
+int decrypt_batch(const uint8_t (*encrypted)[TOTAL_SZ], size_t n, robot_bt_packet_t *pkt_out, int *status)
+{
+    if (!encrypted || !pkt_out) return -1;
+
+    uint8_t output[GS_CRYPTO_BATCH_MAX][CT_SZ];
+    gs_crypto_job_t jobs[GS_CRYPTO_BATCH_MAX];
+    int ok = 0;
+
+    for (size_t i = 0; i < n; ) {
+        int k = 0;
+        for (; k < GS_CRYPTO_BATCH_MAX && i + k < n; k++)
+            jobs[k] = (gs_crypto_job_t){ encrypted[i + k], encrypted[i + k] + IV_SZ, CT_SZ, output[k], 0 };
+
+        if (gs_crypto_decrypt_batch(jobs, k) < 0)
+            for (int j = 0; j < k; j++) jobs[j].rc = -7;
+
+        for (int j = 0; j < k; j++) {
+            memset(&pkt_out[i + j], 0, sizeof(robot_bt_packet_t));
+            if (jobs[j].rc == 0) {
+                memcpy(pkt_out[i + j].bytes, output[j], sizeof(robot_bt_packet_t));
+                ok++;
+            }
+            if (status) status[i + j] = (jobs[j].rc == 0) ? 0 : -4;
+        }
+        i += (size_t)k;
+    }
+    return ok;
+}
+
+/* Command batch, the inbound twin of a report batch: one seal over
+ * [n][n x 8 bytes], framed 0x0A 0xD1 by the link. Same output layout as
+ * encrypt_cmd; -5 when n does not fit the block. */
+int encrypt_cmd_batch(const robot_bt_packet_t *packets, int n, uint8_t *cipher_out, size_t *cipher_out_len)
+{
+    if (!packets || !cipher_out || !cipher_out_len) return -1;
+    if (n < 1 || n > (CT_SZ - 1) / 8) return -5;
+
+    uint8_t input[CT_SZ];
+    memset(input, PAD_BYTE, CT_SZ);
+    input[0] = (uint8_t)n;
+    for (int i = 0; i < n; i++) memcpy(input + 1 + i * 8, packets[i].bytes, 8);
+
+    uint8_t iv[IV_SZ];
+    if (gs_nonce_next(iv) != 0) return -4;
+
+    int res = gs_crypto_encrypt(iv, input, CT_SZ, cipher_out + IV_SZ);
+    if (res < 0) return res;
+
+    memcpy(cipher_out, iv, IV_SZ);
+    *cipher_out_len = IV_SZ + CT_SZ + TAG_SZ;
+    return 0;
+}
+
+/* Robot report batch (0x0A 0xD1 frame): one seal over [n][n x 8 bytes]
+ * instead of one packet per word. Returns n, -4 on auth failure or -5 when
+ * the count does not fit the block or max. */
+int decrypt_report_batch(const uint8_t *encrypted, robot_bt_packet_t *pkt_out, int max)
+{
+    if (!encrypted || !pkt_out) return -1;
+
+    uint8_t output[CT_SZ];
+    if (gs_crypto_decrypt(encrypted, encrypted + IV_SZ, CT_SZ, output) != 0) return -4;
+
+    int n = output[0];
+    if (n > (CT_SZ - 1) / 8 || n > max) return -5;
+    for (int i = 0; i < n; i++) {
+        memset(&pkt_out[i], 0, sizeof(robot_bt_packet_t));
+        memcpy(pkt_out[i].bytes, output + 1 + i * 8, 8);
+    }
+    return n;
+}
+
+/* Compact seal (compact_seal.h): the n words alone, no padding, framed
+ * 0x0A 0xD2 (one word) or 0x0A 0xD3 (a batch) ready for the link, 40 bytes
+ * for one word instead of CIPHER_FRAME_SZ. A lone e-stop word is marked
+ * 0x0A 0xD4 so the robot opens it in its BLE callback. The IV is the
+ * session's counter nonce, sent whole. -4 without counter IVs, -5 when n is
+ * out of range. */
+int encrypt_cmd_compact(const robot_bt_packet_t *packets, int n, uint8_t *frame_out, size_t *frame_len)
+{
+    if (!packets || !frame_out || !frame_len) return -1;
+    if (n < 1 || n > SEAL_BATCH_MAX) return -5;
+
+    uint8_t mark = n > 1 ? SEAL_MARK_BATCH : cmd_word_is_estop(packets[0].raw) ? SEAL_MARK_ESTOP : SEAL_MARK_WORD;
+    uint8_t input[SEAL_BATCH_MAX * 8];
+    for (int i = 0; i < n; i++) memcpy(input + i * 8, packets[i].bytes, 8);
+
+    uint8_t iv[IV_SZ];
+    if (g_nonce_mode != GS_NONCE_COUNTER) return -4;        /* Random IVs carry no sequence */
+    if (gs_nonce_next(iv) != 0) return -4;
+
+    uint8_t *body = frame_out + 2;
+    size_t iv_off = seal_nonce_off(mark);
+    size_t body_len = iv_off + SEAL_NONCE_LEN + (size_t)n * 8 + TAG_SZ;
+    frame_out[0] = SEAL_SOF;
+    frame_out[1] = mark;
+    if (mark == SEAL_MARK_BATCH) body[0] = (uint8_t)n;
+    memcpy(body + iv_off, iv, SEAL_NONCE_LEN);
+
+    int res = gs_crypto_encrypt(iv, input, (size_t)n * 8, body + iv_off + SEAL_NONCE_LEN);
+    if (res < 0) return res;
+
+    body[body_len]     = SEAL_EOF0;
+    body[body_len + 1] = SEAL_EOF1;
+    *frame_len = SEAL_FRAME_LEN(body_len);
+    return 0;
+}
+
+/* Opens a compact frame sealed by the GS (the robot side of
+ * encrypt_cmd_compact, used by the simulator). Returns the word count with
+ * *seq set for the replay window, -2 for a bad frame, -4 on auth failure
+ * or -5 when the words do not fit max. */
+int decrypt_cmd_compact(const uint8_t *frame, size_t len, robot_bt_packet_t *pkt_out, int max, uint64_t *seq)
+{
+    if (!frame || !pkt_out || !seq) return -1;
+    int flen = seal_frame_len(frame, len);
+    if (flen <= 0 || (size_t)flen != len || frame[len - 2] != SEAL_EOF0 || frame[len - 1] != SEAL_EOF1) return -2;
+
+    const uint8_t *body = frame + 2;
+    int n = seal_words(frame[1], body);
+    if (n > max) return -5;
+
+    const uint8_t *iv = body + seal_nonce_off(frame[1]);
+    uint8_t output[SEAL_BATCH_MAX * 8];
+    if (!replay_nonce_seq(iv, REPLAY_DIR_GS, seq)) return -2;
+    if (gs_crypto_decrypt(iv, iv + SEAL_NONCE_LEN, (size_t)n * 8, output) != 0) return -4;
+
+    for (int i = 0; i < n; i++) {
+        memset(&pkt_out[i], 0, sizeof(robot_bt_packet_t));
+        memcpy(pkt_out[i].bytes, output + i * 8, 8);
+    }
+    return n;
+}
@@ -10,6 +10,8 @@
 #include <stdint.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <sys/random.h>
+#include <time.h>
 
 #ifndef SOL_ALG
 #define SOL_ALG 279
@@ -21,11 +23,30 @@
 #define TOTAL_SZ            (IV_SZ + CT_SZ + TAG_SZ)   /* 156 bytes        */
 #define PAYLOAD_HEX_STR_LEN (TOTAL_SZ * 2)             /* 312 hex chars    */
 #define PAD_BYTE            0xFF
+#define CIPHER_SOF0         0x0A                       /* Robot link framing */
+#define CIPHER_SOF1         0xD0
+#define CIPHER_SOF1_BATCH   0xD1                       /* Sealed report batch */
+#define CIPHER_EOF0         0xDA
+#define CIPHER_EOF1         0x0D
+#define CIPHER_FRAME_SZ     (TOTAL_SZ + 4)             /* 160 bytes        */
 #define KEY_SIZE            32
+#define AES_KEY_HEX "a1b2c3d4e5f6789012345678901234567890abcdef1234567890abcdef123456"
 
 #include "../cmd_structure.h"
+#include "../../../robot/components/cmd_codec/replay_window.h"
+#include "../../../robot/components/cmd_codec/compact_seal.h"
+
+typedef enum {
+    GS_NONCE_RANDOM  = 0,   /* getrandom() pool (no replay sequence) */
+    GS_NONCE_COUNTER = 1    /* 32-bit session salt || 64-bit sequence (default) */
+} gs_nonce_mode_t;
+
+int gs_nonce_set_mode(gs_nonce_mode_t mode);
+void gs_nonce_set_dir(uint8_t dir);
+int gs_nonce_next(uint8_t iv[IV_SZ]);
 
 int strip_pad(const uint8_t *buf, int len);
+int cipher_payload_decode(const uint8_t *buf, size_t len, uint8_t out[TOTAL_SZ]);
 
 int encrypt_json(const char *Plaintext, uint8_t Ciphertext[TOTAL_SZ]);
 int encrypt_cmd(const robot_bt_packet_t *packet, uint8_t *cipher_out, size_t *cipher_out_len);
@@ -33,6 +54,13 @@ int encrypt_cmd(const robot_bt_packet_t *packet, uint8_t *cipher_out, size_t *ci
 int decrypt_json(const uint8_t *encrypted, char *json_out, size_t json_out_len);
 int decrypt_cmd(const uint8_t *encrypted, robot_bt_packet_t *pkt_out);
 
+int encrypt_batch(const robot_bt_packet_t *packets, size_t n, uint8_t (*cipher_out)[TOTAL_SZ]);
+int decrypt_batch(const uint8_t (*encrypted)[TOTAL_SZ], size_t n, robot_bt_packet_t *pkt_out, int *status);
+int encrypt_cmd_batch(const robot_bt_packet_t *packets, int n, uint8_t *cipher_out, size_t *cipher_out_len);
+int decrypt_report_batch(const uint8_t *encrypted, robot_bt_packet_t *pkt_out, int max);
+int encrypt_cmd_compact(const robot_bt_packet_t *packets, int n, uint8_t *frame_out, size_t *frame_len);
+int decrypt_cmd_compact(const uint8_t *frame, size_t len, robot_bt_packet_t *pkt_out, int max, uint64_t *seq);
+
 
 int gs_sw_crypto_init();
 void gs_sw_crypto_deinit();
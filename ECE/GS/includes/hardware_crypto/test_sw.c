@@ -6,7 +6,7 @@
 #include "software_cryptography.h"
 #include "../cmd_structure.h"
 
-// gcc -O2 -Wall -Wextra test_sw.c software_cryptography.c -I.../includes/cmd_structure -o test_sw.o
+// gcc -O2 -Wall -Wextra test_sw.c software_cryptography.c hardware_encryption.c -I.../includes/cmd_structure -o test_sw.o
 
 #define TEST_CIPHERTEXT "8BDF573D3D50AF81FAD29D955B91D6BC09FF99709565F114ACDA91469379B86EC63824B37339EEC7AA903929137BD367D00B0A99534505FB3E603E24D02D77B1DBECA6931B981D18AE316FA14F2B32B8CB778305174D6961FDD3BEA0BE071223C75C3856286788AAEA14BCCD93A3F76FD1DDDD58C824E3467B73FF81F4D4AFAD61DB4398F119542F136E2C6AAB3B68615BCE9D26E148F04226C4994C"
 
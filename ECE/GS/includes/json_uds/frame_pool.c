@@ -0,0 +1,71 @@
+#include "frame_pool.h"
+#include <stdlib.h>
+
+static char     g_small[FRAME_POOL_SMALL_N][FRAME_POOL_SMALL];
+static char     g_large[FRAME_POOL_LARGE_N][FRAME_POOL_LARGE];
+static uint32_t g_small_used, g_large_used;  // Bit per buffer
+static frame_pool_stats_t g_stats;
+
+_Static_assert(FRAME_POOL_SMALL_N <= 32 && FRAME_POOL_LARGE_N <= 32, "frame pool bitmaps are 32 bits");
+
+static char *take(uint32_t *used, int n, char *base, size_t size) {
+  for (int i = 0; i < n; i++) {
+    if (*used & (1u << i)) continue;
+    *used |= 1u << i;
+    return base + (size_t)i * size;
+  }
+  return NULL;
+}
+
+char *frame_pool_get(uint32_t need, uint32_t *cap) {
+  char *p;
+  if (need <= FRAME_POOL_SMALL && (p = take(&g_small_used, FRAME_POOL_SMALL_N, &g_small[0][0], FRAME_POOL_SMALL))) {
+    *cap = FRAME_POOL_SMALL;
+    return p;
+  }
+  if (need <= FRAME_POOL_LARGE && (p = take(&g_large_used, FRAME_POOL_LARGE_N, &g_large[0][0], FRAME_POOL_LARGE))) {
+    *cap = FRAME_POOL_LARGE;
+    return p;
+  }
+  p = malloc(need);                                        // Oversized, or the classes ran dry
+  if (!p) return NULL;
+  *cap = need;
+  g_stats.heap_frames++;
+  g_stats.heap_bytes += need;
+  if (g_stats.heap_bytes > g_stats.heap_peak) g_stats.heap_peak = g_stats.heap_bytes;
+  return p;
+}
+
+// Index of buf in a class, -1 = not one of its buffers
+static int slot_of(const char *buf, const char *base, int n, size_t size) {
+  uintptr_t off = (uintptr_t)buf - (uintptr_t)base;
+  return off < (uintptr_t)n * size ? (int)(off / size) : -1;
+}
+
+int frame_pool_owns(const char *buf) {
+  return slot_of(buf, &g_small[0][0], FRAME_POOL_SMALL_N, FRAME_POOL_SMALL) >= 0 ||
+         slot_of(buf, &g_large[0][0], FRAME_POOL_LARGE_N, FRAME_POOL_LARGE) >= 0;
+}
+
+void frame_pool_put(char *buf, uint32_t cap) {
+  if (!buf) return;
+  int i;
+  if ((i = slot_of(buf, &g_small[0][0], FRAME_POOL_SMALL_N, FRAME_POOL_SMALL)) >= 0) {
+    g_small_used &= ~(1u << i);
+  } else if ((i = slot_of(buf, &g_large[0][0], FRAME_POOL_LARGE_N, FRAME_POOL_LARGE)) >= 0) {
+    g_large_used &= ~(1u << i);
+  } else {
+    g_stats.heap_bytes -= cap;
+    free(buf);
+  }
+}
+
+const frame_pool_stats_t *frame_pool_stats(void) {
+  g_stats.small_free = (uint32_t)(FRAME_POOL_SMALL_N - __builtin_popcount(g_small_used));
+  g_stats.large_free = (uint32_t)(FRAME_POOL_LARGE_N - __builtin_popcount(g_large_used));
+  return &g_stats;
+}
+
+size_t frame_pool_static_bytes(void) {
+  return sizeof(g_small) + sizeof(g_large);
+}
@@ -0,0 +1,33 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "json_uds.h"
+
+// ------------------------- UDS receive buffers -------------------------
+// Size classes for the per-connection frame arena instead of a UDS_MAX_FRAME
+// malloc per client. Nearly every frame is a command: a 12-byte binary word,
+// a 157-byte raw cipher frame or a JSON object carrying at most a hex-sealed
+// record (2 * TOTAL_SZ chars), all of which fit the small class; the large
+// class takes longer documents and METRICS requests. Anything bigger comes
+// from the heap for that one frame and goes straight back. Event loop only.
+
+#define FRAME_POOL_SMALL   512              // 2 * TOTAL_SZ hex + JSON envelope, see cmd_parser.c
+#define FRAME_POOL_LARGE   4096
+#define FRAME_POOL_SMALL_N UDS_MAX_CLIENTS  // One idle connection each
+#define FRAME_POOL_LARGE_N 2
+
+typedef struct {
+  uint32_t small_free, large_free;
+  uint64_t heap_frames;                     // Frames that needed a heap buffer
+  size_t   heap_bytes, heap_peak;           // Heap buffers held now / at most
+} frame_pool_stats_t;
+
+char  *frame_pool_get(uint32_t need, uint32_t *cap);  // need includes the NUL; NULL = no memory
+void   frame_pool_put(char *buf, uint32_t cap);
+int    frame_pool_owns(const char *buf);    // 1 = a class buffer, worth keeping between frames
+const frame_pool_stats_t *frame_pool_stats(void);
+size_t frame_pool_static_bytes(void);
+
+#endif
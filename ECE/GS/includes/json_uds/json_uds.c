@@ -1,4 +1,8 @@
 #include "json_uds.h"
+#include "../metrics/metrics.h"
+#include "../recorder/recorder.h"
+#include "../ws/ws_server.h"
+#include "frame_pool.h"
 
 // ------------------------- UDS framing utilities -------------------------
 // Because sockets are byte streams, we send "len + JSON bytes" so receiver knows boundaries.
@@ -19,11 +23,462 @@ int read_full(int fd, void *buf, size_t n) {
   return 1;                                             // Success
 }
 
+// ------------------------- Incremental frame decoder -------------------------
+
+void uds_rx_init(uds_rx_t *rx) {
+  memset(rx, 0, sizeof(*rx));
+}
+
+void uds_rx_reset(uds_rx_t *rx) {
+  frame_pool_put(rx->buf, rx->cap);                     // Release the arena (connection closed)
+  uds_rx_init(rx);
+}
+
+// Consume n bytes. Calls fn once per completed frame (payload NUL-terminated).
+// The payload lives in the connection's arena and is only valid during fn.
+// Returns number of frames delivered, -1 on a bad length header, or -2 if
+// fn asked to stop / allocation failed.
+int uds_rx_feed(uds_rx_t *rx, const uint8_t *data, size_t n, uds_frame_fn fn, void *ctx) {
+  int frames = 0;
+  size_t off = 0;
+
+  while (off < n) {
+    if (rx->hdr_got < 4) {                              // Still collecting the length
+      rx->hdr[rx->hdr_got++] = data[off++];
+      if (rx->hdr_got < 4) continue;
+
+      uint32_t len_be;
+      memcpy(&len_be, rx->hdr, 4);
+      rx->need = ntohl(len_be);                         // Convert length to host endian
+      if (rx->need == 0 || rx->need > UDS_MAX_FRAME) return -1; // Sanity check
+
+      if (rx->need + 1 > rx->cap) {                     // Arena kept while frames fit in it
+        frame_pool_put(rx->buf, rx->cap);
+        rx->cap = 0;
+        rx->buf = frame_pool_get(rx->need + 1, &rx->cap);
+        if (!rx->buf) return -2;
+      }
+      rx->got = 0;
+    }
+
+    size_t take = rx->need - rx->got;                   // Copy as much payload as we have
+    if (take > n - off) take = n - off;
+    memcpy(rx->buf + rx->got, data + off, take);
+    rx->got += (uint32_t)take;
+    off += take;
+
+    if (rx->got == rx->need) {                          // Frame complete
+      rx->buf[rx->need] = '\0';
+      int stop = fn(ctx, rx->buf, rx->need);
+      rx->hdr_got = 0;
+      rx->need = rx->got = 0;
+      if (!frame_pool_owns(rx->buf)) {                  // One-off heap buffer: give it back now
+        frame_pool_put(rx->buf, rx->cap);
+        rx->buf = NULL;
+        rx->cap = 0;
+      }
+      frames++;
+      if (stop) return -2;
+    }
+  }
+  return frames;
+}
+
+// Drain a nonblocking socket into the decoder until EAGAIN.
+// Returns 0 when drained, -1 on EOF/error, -2 on bad framing or stop request.
+int uds_rx_read(int fd, uds_rx_t *rx, uds_frame_fn fn, void *ctx) {
+  uint8_t chunk[UDS_RX_CHUNK];
+  while (1) {
+    ssize_t r = recv(fd, chunk, sizeof(chunk), 0);
+    if (r == 0) return -1;                              // Peer disconnected
+    if (r < 0) {
+      if (errno == EINTR) continue;                     // Interrupted -> retry
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return 0; // Drained, keep partial state
+      return -1;                                        // Real error
+    }
+    if (uds_rx_feed(rx, chunk, (size_t)r, fn, ctx) < 0) return -2;
+  }
+}
+
+// Drain ring 0 of a shared-memory client into the same decoder, then go
+// idle. Same returns as uds_rx_read() (the ring has no EOF: the socket does).
+int uds_rx_read_shm(shm_ring_t *shm, uds_rx_t *rx, uds_frame_fn fn, void *ctx) {
+  uint64_t bell;
+  while (read(shm->bell[SHM_TO_BRIDGE], &bell, sizeof(bell)) > 0) {}
+  do {
+    const uint8_t *p[2];
+    uint32_t n[2];
+    uint32_t avail = shm_ring_peek(shm, SHM_TO_BRIDGE, p, n);
+    for (int i = 0; i < 2; i++) {
+      if (n[i] && uds_rx_feed(rx, p[i], n[i], fn, ctx) < 0) return -2;
+    }
+    shm_ring_take(shm, SHM_TO_BRIDGE, avail);
+  } while (shm_ring_idle(shm, SHM_TO_BRIDGE));
+  return 0;
+}
+
+int uds_rx_read_seq(int fd, uds_frame_fn fn, void *ctx) {
+  static char           buf[UDS_SEQ_BATCH][UDS_SEQ_MSG_MAX + 1]; // +1: payloads are NUL-terminated
+  static struct iovec   iov[UDS_SEQ_BATCH];
+  static struct mmsghdr mm[UDS_SEQ_BATCH];
+
+  while (1) {
+    for (int i = 0; i < UDS_SEQ_BATCH; i++) {
+      iov[i].iov_base = buf[i];
+      iov[i].iov_len  = UDS_SEQ_MSG_MAX;
+      memset(&mm[i].msg_hdr, 0, sizeof(mm[i].msg_hdr));
+      mm[i].msg_hdr.msg_iov = &iov[i];
+      mm[i].msg_hdr.msg_iovlen = 1;
+    }
+    int n = recvmmsg(fd, mm, UDS_SEQ_BATCH, MSG_DONTWAIT, NULL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+      return -1;
+    }
+    for (int i = 0; i < n; i++) {
+      uint32_t len = mm[i].msg_len;
+      if (len == 0) return -1;                          // Zero-length message: the peer's EOF
+      if (mm[i].msg_hdr.msg_flags & MSG_TRUNC) return -2; // Larger than UDS_SEQ_MSG_MAX
+      buf[i][len] = '\0';
+      if (fn(ctx, buf[i], len)) return -2;
+    }
+    if (n < UDS_SEQ_BATCH) return 0;                    // Short batch: drained
+  }
+}
+
+// ------------------------- Outbound frame queue -------------------------
+
+static uds_tx_t *g_tx_registry[UDS_MAX_CLIENTS];       // Queues reachable by fd
+
+static uds_tx_t *uds_tx_find(int fd) {
+  for (int i = 0; i < UDS_MAX_CLIENTS; i++) {
+    if (g_tx_registry[i] && g_tx_registry[i]->fd == fd) return g_tx_registry[i];
+  }
+  return NULL;
+}
+
+void uds_tx_init(uds_tx_t *tx, int fd, uds_want_write_fn on_want_write) {
+  memset(tx, 0, sizeof(*tx));
+  tx->fd = fd;
+  tx->on_want_write = on_want_write;
+  tx->topics = UDS_TOPIC_ALL;
+  tx->robots = UINT32_MAX;
+  for (int i = 0; i < UDS_MAX_CLIENTS; i++) {
+    if (!g_tx_registry[i]) { g_tx_registry[i] = tx; break; }
+  }
+}
+
+void uds_tx_close(uds_tx_t *tx) {
+  for (int i = 0; i < UDS_MAX_CLIENTS; i++) {
+    if (g_tx_registry[i] == tx) g_tx_registry[i] = NULL;
+  }
+  tx->fd = -1;
+  tx->count = 0;
+  tx->sent = 0;
+}
+
+static void tx_set_want_write(uds_tx_t *tx, int on) {
+  if (tx->want_write == on) return;
+  tx->want_write = on;
+  if (tx->on_want_write) tx->on_want_write(tx->fd, on);
+}
+
+// Remove the frame at send position pos (never the partially-sent head).
+static void tx_remove_at(uds_tx_t *tx, int pos) {
+  tx->slots[tx->order[pos]].used = 0;
+  memmove(&tx->order[pos], &tx->order[pos + 1], (size_t)(tx->count - pos - 1));
+  tx->count--;
+}
+
+// Slot for the next frame. Latest-wins: an older queued report with the same
+// key is reused in place (*pos = its send position), otherwise a free slot is
+// picked (*pos = -1, committed by tx_commit). NULL with *rc set when full.
+static uds_tx_slot_t *tx_claim(uds_tx_t *tx, int kind, uint16_t key, int *pos, int *rc) {
+  int first = (tx->sent > 0) ? 1 : 0;                   // Head may be mid-write: leave it alone
+
+  if (kind == UDS_TX_TELEM && key != 0) {
+    for (int i = first; i < tx->count; i++) {
+      uds_tx_slot_t *sl = &tx->slots[tx->order[i]];
+      if (sl->kind == UDS_TX_TELEM && sl->key == key) {
+        *pos = i;
+        return sl;
+      }
+    }
+  }
+
+  if (tx->count == UDS_TX_SLOTS) {                      // Full: evict the oldest telemetry
+    int victim = -1;
+    for (int i = first; i < tx->count; i++) {
+      if (tx->slots[tx->order[i]].kind == UDS_TX_TELEM) { victim = i; break; }
+    }
+    if (victim < 0) {
+      tx->dropped++;
+      METRIC_INC(uds_tx_drops);
+      *rc = (kind == UDS_TX_TELEM) ? 1 : -1;            // Only commands queued
+      return NULL;
+    }
+    tx_remove_at(tx, victim);
+    tx->dropped++;
+    METRIC_INC(uds_tx_drops);
+  }
+
+  int idx = 0;
+  while (tx->slots[idx].used) idx++;                    // count < UDS_TX_SLOTS guarantees a hit
+  *pos = -1;
+  return &tx->slots[idx];
+}
+
+// Frame header for len payload bytes: the length prefix, or for a WebSocket
+// client an unmasked header of opcode op. Returns its size.
+static uint8_t tx_frame_hdr(const uds_tx_t *tx, uint8_t *hdr, int op, uint32_t len) {
+  if (tx && tx->ws) return ws_frame_hdr(hdr, op, len);
+  if (tx && tx->seq) return 0;                          // The message is the frame
+  uint32_t len_be = htonl(len);
+  memcpy(hdr, &len_be, 4);
+  return 4;
+}
+
+// Seal a filled slot: frame header, and a fresh slot joins the send order.
+static void tx_commit(uds_tx_t *tx, uds_tx_slot_t *sl, uint32_t len, int kind, uint16_t key, int pos, int op) {
+  sl->hlen = tx_frame_hdr(tx, sl->hdr, op, len);         // A slot payload fits the 4-byte WebSocket form
+  sl->len = len;
+  METRIC_INC(uds_frames_out);
+  rec_put(REC_UDS_OUT, tx->fd, sl->data, len);
+  if (pos >= 0) { tx->coalesced++; METRIC_INC(uds_tx_coalesced); return; }
+  sl->kind = (uint8_t)kind;
+  sl->key  = key;
+  sl->used = 1;
+  tx->order[tx->count++] = (uint8_t)(sl - tx->slots);
+}
+
+// Queue one frame. Returns 0 if queued/coalesced, 1 if the frame was telemetry
+// and got dropped, -1 if a command could not be queued, -3 if too large.
+int uds_tx_enqueue(uds_tx_t *tx, const char *data, uint32_t len, int kind, uint16_t key) {
+  if (len == 0 || len > UDS_TX_SLOT_MAX) return -3;
+  int pos, rc;
+  uds_tx_slot_t *sl = tx_claim(tx, kind, key, &pos, &rc);
+  if (!sl) return rc;
+  memcpy(sl->data, data, len);
+  tx_commit(tx, sl, len, kind, key, pos, WS_OP_TEXT);
+  return 0;
+}
+
+// WebSocket client only: a binary or control message (may be empty), queued
+// like a command reply so it keeps its place among the text frames
+int uds_tx_enqueue_ws(uds_tx_t *tx, int op, const void *data, uint32_t len) {
+  if (!tx->ws || len > UDS_TX_SLOT_MAX) return -3;
+  int pos, rc;
+  uds_tx_slot_t *sl = tx_claim(tx, UDS_TX_CMD, 0, &pos, &rc);
+  if (!sl) return rc;
+  if (len) memcpy(sl->data, data, len);
+  tx_commit(tx, sl, len, UDS_TX_CMD, 0, pos, op);
+  return 0;
+}
+
+// Same, but prints the tree straight into the slot: no intermediate string,
+// no allocation. -3 if it does not fit in a slot (a report it was meant to
+// replace is dropped, its bytes are gone).
+int uds_tx_enqueue_json(uds_tx_t *tx, const cJSON *item, int kind, uint16_t key) {
+  int pos, rc;
+  uds_tx_slot_t *sl = tx_claim(tx, kind, key, &pos, &rc);
+  if (!sl) return rc;
+
+  cJSON_Writer w;
+  cJSON_InitWriter(&w, sl->data, sizeof(sl->data));     // Needs 1 byte for the NUL
+  if (!cJSON_Write(&w, item, 0) || w.length == 0) {
+    if (pos >= 0) { tx_remove_at(tx, pos); tx->dropped++; METRIC_INC(uds_tx_drops); }
+    return -3;
+  }
+  tx_commit(tx, sl, (uint32_t)w.length, kind, key, pos, WS_OP_TEXT);
+  return 0;
+}
+
+// Write as many queued frames as the socket accepts with one writev() per pass.
+// Returns 0 when the queue is empty, 1 if data is still pending (EPOLLOUT is
+// armed), -1 on a socket error.
+int uds_tx_flush(uds_tx_t *tx) {
+  while (tx->shm && tx->count > 0) {                    // Whole frames into ring 1
+    uds_tx_slot_t *sl = &tx->slots[tx->order[0]];
+    int rc = shm_ring_put(tx->shm, SHM_TO_NODE, sl->hdr, sl->hlen, sl->data, sl->len);
+    if (rc > 0) return 1;                               // Full: Node's bell resumes it
+    tx_remove_at(tx, 0);
+  }
+
+  while (tx->seq && tx->count > 0) {                   // One message per frame, a batch per syscall
+    struct iovec   iov[UDS_TX_IOV];
+    struct mmsghdr mm[UDS_TX_IOV];
+    int n = 0;
+    for (; n < tx->count && n < UDS_TX_IOV; n++) {
+      uds_tx_slot_t *sl = &tx->slots[tx->order[n]];
+      iov[n].iov_base = sl->data;
+      iov[n].iov_len  = sl->len;
+      memset(&mm[n].msg_hdr, 0, sizeof(mm[n].msg_hdr));
+      mm[n].msg_hdr.msg_iov = &iov[n];
+      mm[n].msg_hdr.msg_iovlen = 1;
+    }
+    int w = sendmmsg(tx->fd, mm, (unsigned)n, MSG_NOSIGNAL);
+    if (w < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        tx_set_want_write(tx, 1);
+        return 1;
+      }
+      return -1;
+    }
+    for (int i = 0; i < w; i++) tx_remove_at(tx, 0);   // Messages go whole or not at all
+  }
+
+  while (tx->count > 0) {
+    struct iovec iov[UDS_TX_IOV];
+    int niov = 0;
+    size_t skip = tx->sent;
+
+    for (int i = 0; i < tx->count && niov + 2 <= UDS_TX_IOV; i++) {
+      uds_tx_slot_t *sl = &tx->slots[tx->order[i]];
+      if (skip < sl->hlen) {                            // Header (maybe partially sent)
+        iov[niov].iov_base = sl->hdr + skip;
+        iov[niov].iov_len  = sl->hlen - skip;
+        niov++;
+        skip = 0;
+      } else {
+        skip -= sl->hlen;
+      }
+      iov[niov].iov_base = sl->data + skip;             // Payload
+      iov[niov].iov_len  = sl->len - skip;
+      niov++;
+      skip = 0;
+    }
+
+    ssize_t w = tx->io_writev ? tx->io_writev(tx->io, iov, niov) : writev(tx->fd, iov, niov);
+    if (w < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {    // Socket buffer full: wait for EPOLLOUT
+        tx_set_want_write(tx, 1);
+        return 1;
+      }
+      return -1;
+    }
+
+    size_t left = (size_t)w;                            // Retire fully written frames
+    while (left > 0 && tx->count > 0) {
+      uds_tx_slot_t *sl = &tx->slots[tx->order[0]];
+      size_t remain = sl->hlen + sl->len - tx->sent;
+      if (left < remain) { tx->sent += left; left = 0; break; }
+      left -= remain;
+      tx->sent = 0;
+      tx_remove_at(tx, 0);
+    }
+  }
+
+  while (tx->io_writev && tx->io_writev(tx->io, NULL, 0) < 0) { // Bytes the layer took but still holds
+    if (errno == EINTR) continue;
+    if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+    tx_set_want_write(tx, 1);
+    return 1;
+  }
+
+  tx_set_want_write(tx, 0);
+  return 0;
+}
+
+// ------------------------- Topics -------------------------
+
+static const char *const g_topic_names[] = { "acks", "health", "imu", "sniffed", "trace", "other", "agg", "metrics", "alerts" };
+#define UDS_TOPICS (int)(sizeof(g_topic_names) / sizeof(g_topic_names[0]))
+
+uint32_t uds_topic_bit(const char *name) {
+  for (int i = 0; i < UDS_TOPICS; i++) {
+    if (strcmp(name, g_topic_names[i]) == 0) return 1u << i;
+  }
+  return 0;
+}
+
+int uds_topic_list(uint32_t mask, char *out, size_t n) {
+  size_t o = 0;
+  if (n < 3) return -1;
+  out[o++] = '[';
+  for (int i = 0; i < UDS_TOPICS; i++) {
+    if (!(mask >> i & 1)) continue;
+    int w = snprintf(out + o, n - o, "%s\"%s\"", o > 1 ? "," : "", g_topic_names[i]);
+    if (w < 0 || (size_t)w >= n - o) return -1;
+    o += (size_t)w;
+  }
+  if (o + 2 > n) return -1;
+  out[o++] = ']';
+  out[o] = '\0';
+  return (int)o;
+}
+
+static int tx_subscribed(const uds_tx_t *tx, uint32_t topic, int robot) {
+  if (!(tx->topics & topic)) return 0;
+  return robot < 0 || robot >= 32 || (tx->robots >> robot & 1);
+}
+
+// Queue a frame on every client subscribed to its topic (and robot) and kick
+// a flush. Returns the number of clients the frame was queued for.
+int uds_tx_broadcast(const char *json, int kind, uint16_t key, uint32_t topic, int robot) {
+  int n = 0;
+  uint32_t len = (uint32_t)strlen(json);
+  for (int i = 0; i < UDS_MAX_CLIENTS; i++) {
+    uds_tx_t *tx = g_tx_registry[i];
+    if (!tx || tx->fd < 0) continue;
+    if (!tx_subscribed(tx, topic, robot)) { METRIC_INC(uds_tx_filtered); continue; }
+    if (uds_tx_enqueue(tx, json, len, kind, key) == 0) n++;
+    uds_tx_flush(tx);
+  }
+  return n;
+}
+
+static cJSON_Writer g_json_writer;                      // Zeroed = grown by cJSON, kept across sends
+
+// Same for a tree: printed once, then copied to each subscriber
+int uds_tx_broadcast_json(const cJSON *item, int kind, uint16_t key, uint32_t topic, int robot) {
+  if (!cJSON_Write(&g_json_writer, item, 0)) return 0;
+  return uds_tx_broadcast(g_json_writer.buffer, kind, key, topic, robot);
+}
+
+int uds_send_cjson(int fd, const cJSON *item) {
+  uds_tx_t *tx = uds_tx_find(fd);
+  if (tx) {
+    int rc = uds_tx_enqueue_json(tx, item, UDS_TX_CMD, 0);
+    if (rc == 0) return (uds_tx_flush(tx) < 0) ? -1 : 0;
+    if (rc != -3) return -1;
+  }
+  // Unqueued client or larger than a slot: print once into the reused buffer
+  if (!cJSON_Write(&g_json_writer, item, 0)) return -1;
+  return uds_send_json(fd, g_json_writer.buffer);
+}
+
 int uds_send_json(int fd, const char *json) {
   uint32_t len = (uint32_t)strlen(json);                // Length of JSON string
-  uint32_t len_be = htonl(len);                         // Convert to big-endian length
-  if (write(fd, &len_be, 4) != 4) return -1;            // Write 4-byte length
-  if (write(fd, json, len) != (ssize_t)len) return -1;  // Write JSON bytes
+
+  uds_tx_t *tx = uds_tx_find(fd);                       // Queued client: keep frame order
+  if (tx && len <= UDS_TX_SLOT_MAX) {
+    if (uds_tx_enqueue(tx, json, len, UDS_TX_CMD, 0) != 0) return -1;
+    return (uds_tx_flush(tx) < 0) ? -1 : 0;
+  }
+  if (tx && tx->count > 0) return -1;                   // Oversized frame would interleave
+
+  uint8_t hdr[WS_HDR_MAX];                              // Big-endian length (or WebSocket header)
+  uint8_t hlen = tx_frame_hdr(tx, hdr, WS_OP_TEXT, len);
+  if (tx && tx->shm) {                                  // Straight into the ring, or dropped
+    if (shm_ring_put(tx->shm, SHM_TO_NODE, hdr, hlen, json, len) != 0) return -1;
+    METRIC_INC(uds_frames_out);
+    rec_put(REC_UDS_OUT, fd, json, len);
+    return 0;
+  }
+  struct iovec iov[2] = {                               // Length + JSON in one syscall
+    { .iov_base = hdr,          .iov_len = hlen },
+    { .iov_base = (void *)json, .iov_len = len  },
+  };
+  if (tx && tx->io_writev) {                            // Whole into the layer's stage, then pushed
+    if (tx->io_writev(tx->io, iov, 2) != (ssize_t)(hlen + len) || uds_tx_flush(tx) < 0) return -1;
+  } else if (writev(fd, iov, 2) != (ssize_t)(hlen + len)) {
+    return -1;
+  }
+  METRIC_INC(uds_frames_out);
+  rec_put(REC_UDS_OUT, fd, json, len);
   return 0;                                             // Success
 }
 
@@ -51,17 +506,26 @@ int json_get_u16(const cJSON *obj, const char *key, uint16_t *out, int minv, int
 int json_get_u32(const cJSON *obj, const char *key, uint32_t *out) {
   cJSON *it = cJSON_GetObjectItemCaseSensitive((cJSON*)obj, key); // Look up key
   if (!cJSON_IsNumber(it)) return -1;                    // Must be number
-  double dv = it->valuedouble;                           // Read as double
-  if (dv < 0 || dv > 4294967295.0) return -2;            // Range check for u32
-  *out = (uint32_t)dv;                                   // Output as u32
+  cJSON_uint64 v;                                        // Exact integer, no double
+  if (!cJSON_GetUint64Value(it, &v) || v > UINT32_MAX) return -2; // Whole, range check for u32
+  *out = (uint32_t)v;                                    // Output as u32
+  return 0;                                              // Success
+}
+
+int json_get_i64(const cJSON *obj, const char *key, int64_t *out) {
+  cJSON *it = cJSON_GetObjectItemCaseSensitive((cJSON*)obj, key); // Look up key
+  if (!cJSON_IsNumber(it)) return -1;                    // Must be number
+  cJSON_int64 v;                                         // Exact integer, no double
+  if (!cJSON_GetInt64Value(it, &v)) return -2;           // Whole and within int64
+  *out = (int64_t)v;                                     // Output
   return 0;                                              // Success
 }
 
 // ------------------------- UDS server setup -------------------------
-// Create a Unix domain socket server that waits for Node to connect.
+// Create a Unix domain socket server that Node-side clients connect to.
 
-int uds_server_listen(const char *path) {
-  int fd = socket(AF_UNIX, SOCK_STREAM, 0);                // Create UDS stream socket
+static int uds_listen_type(const char *path, int type) {
+  int fd = socket(AF_UNIX, type, 0);                       // Create UDS socket
   if (fd < 0) { perror("socket uds"); return -1; }         // Error check
 
   struct sockaddr_un addr;                                 // Address struct for UDS
@@ -79,7 +543,7 @@ int uds_server_listen(const char *path) {
 
   chmod(path, 0660);                                       // Allow owner/group access (adjust later)
 
-  if (listen(fd, 1) < 0) {                                 // Listen with backlog=1 (single-client)
+  if (listen(fd, UDS_MAX_CLIENTS) < 0) {                   // Backlog sized for all clients
     perror("listen uds");
     close(fd);
     return -1;
@@ -87,3 +551,41 @@ int uds_server_listen(const char *path) {
 
   return fd;                                               // Return listening socket fd
 }
+
+int uds_server_listen(const char *path) {
+  return uds_listen_type(path, SOCK_STREAM);               // Length-prefixed stream (Node)
+}
+
+// Same, but every message is one frame (native peers; Node's net has no
+// SOCK_SEQPACKET, so the stream socket stays for it)
+int uds_seq_listen(const char *path) {
+  return uds_listen_type(path, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC);
+}
+
+// ------------------------- TCP server setup -------------------------
+// The same length-prefixed frames for peers on other hosts (a fleet gateway
+// in front of several bridges). Nonblocking, like the accepted sockets.
+
+int uds_tcp_listen(const char *bind_addr, int port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) { perror("socket tcp"); return -1; }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)); // Restart without TIME_WAIT
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);           // Loopback unless a bind address is given
+  if (bind_addr && bind_addr[0] && inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1) {
+    fprintf(stderr, "tcp: bad bind address %s\n", bind_addr);
+    close(fd);
+    return -1;
+  }
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, UDS_MAX_CLIENTS) < 0) {
+    perror("bind/listen tcp");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
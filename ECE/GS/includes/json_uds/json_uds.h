@@ -12,16 +12,159 @@
 #include <sys/select.h>                 // select()
 #include <sys/socket.h>                 // socket(), bind(), listen(), accept()
 #include <sys/stat.h>                   // chmod()
+#include <sys/uio.h>                    // writev()
 #include <sys/un.h>                     // sockaddr_un for Unix domain sockets
 #include <termios.h>                    // termios UART config
 #include <unistd.h>                     // read(), write(), close(), unlink()
 #include "cJSON.h" // CHANGE       
+#include "shm_ring.h"
 
+// make LOWMEM=1 (GS_LOWMEM) takes the small values; -D<name>=N sets one
+#ifndef UDS_MAX_CLIENTS
+#ifdef GS_LOWMEM
+#define UDS_MAX_CLIENTS 4
+#else
+#define UDS_MAX_CLIENTS 8                // Concurrent Node-side clients (server, recorder, ...)
+#endif
+#endif
+#ifndef UDS_MAX_FRAME
+#ifdef GS_LOWMEM
+#define UDS_MAX_FRAME   (64*1024)
+#else
+#define UDS_MAX_FRAME   (1024*1024)      // Largest accepted UDS frame payload (1MB)
+#endif
+#endif
+#define UDS_RX_CHUNK    4096             // Bytes pulled per recv() by the frame decoder
+#ifdef GS_LOWMEM
+#define UDS_SEQ_BATCH   4
+#define UDS_SEQ_MSG_MAX 4096
+#else
+#define UDS_SEQ_BATCH   16               // Messages per recvmmsg() on a SOCK_SEQPACKET peer
+#define UDS_SEQ_MSG_MAX (16*1024)        // Largest frame a SOCK_SEQPACKET peer may send
+#endif
+
+// ------------------------- Incremental frame decoder -------------------------
+// Per-connection reassembly state. Survives EAGAIN, so a frame split across
+// several wakeups is stitched back together, and one recv() holding several
+// frames hands back every one of them.
+
+typedef int (*uds_frame_fn)(void *ctx, char *frame, uint32_t len); // nonzero = stop
+
+typedef struct {
+  uint8_t  hdr[4];                       // Partial 4-byte big-endian length
+  uint32_t hdr_got;                      // Header bytes collected so far
+  uint32_t need;                         // Payload length of current frame
+  uint32_t got;                          // Payload bytes collected so far
+  char    *buf;                          // Frame arena from frame_pool, kept while frames fit
+  uint32_t cap;                          // ... and its size
+} uds_rx_t;
+
+void uds_rx_init(uds_rx_t *rx);
+void uds_rx_reset(uds_rx_t *rx);
+int  uds_rx_feed(uds_rx_t *rx, const uint8_t *data, size_t n, uds_frame_fn fn, void *ctx);
+int  uds_rx_read(int fd, uds_rx_t *rx, uds_frame_fn fn, void *ctx);
+int  uds_rx_read_shm(shm_ring_t *shm, uds_rx_t *rx, uds_frame_fn fn, void *ctx); // Bell 0 fired
+
+// SOCK_SEQPACKET peers (uds_seq_listen): the kernel keeps message boundaries,
+// so one message is one frame, without the length prefix and without
+// reassembly state. Up to UDS_SEQ_BATCH whole frames come in per recvmmsg()
+// into preallocated buffers; a frame over UDS_SEQ_MSG_MAX counts as bad
+// framing. Same returns as uds_rx_read().
+int  uds_rx_read_seq(int fd, uds_frame_fn fn, void *ctx);
+
+// ------------------------- Outbound frame queue -------------------------
+// Per-client send queue. Pending frames are coalesced into one writev(); when
+// the socket buffer is full the rest waits for EPOLLOUT. A client on the
+// shared-memory transport (tx->shm) has its frames copied into ring 1
+// instead, and a full ring waits for Node's bell. Under pressure stale
+// telemetry is coalesced (same key, latest wins) or evicted before any
+// command/ack frame is dropped. A WebSocket UI client (tx->ws) gets the same
+// queue with a WebSocket frame header in place of the length prefix.
+
+#ifndef UDS_TX_SLOTS
+#ifdef GS_LOWMEM
+#define UDS_TX_SLOTS     16
+#else
+#define UDS_TX_SLOTS     64              // Queued frames per client
+#endif
+#endif
+#define UDS_TX_SLOT_MAX  1024            // Largest queued frame payload
+#define UDS_TX_IOV       64              // iovecs per writev() (2 per frame)
+
+enum uds_tx_kind {
+  UDS_TX_CMD   = 0,                      // Replies/acks: never evicted for telemetry
+  UDS_TX_TELEM = 1,                      // Robot reports: may be coalesced/evicted
+};
+
+// Every broadcast names its topic, and its robot when it has one; a client
+// gets the topics and robots it subscribed to ({"T":"SUB"}), everything until
+// it asks. The frame is rendered once and copied into each subscriber's queue.
+enum uds_topic {
+  UDS_TOPIC_ACKS   = 1u << 0,            // ACK, ACK_TIMEOUT
+  UDS_TOPIC_HEALTH = 1u << 1,            // HR
+  UDS_TOPIC_IMU    = 1u << 2,            // NAV, POSE, INERT
+  UDS_TOPIC_SNIFF  = 1u << 3,            // gs_sniff: sniffed_packet, sniffed_word
+  UDS_TOPIC_TRACE  = 1u << 4,            // TRACE latency records
+  UDS_TOPIC_OTHER  = 1u << 5,            // Any other robot report
+  UDS_TOPIC_AGG    = 1u << 6,            // AGG windows over NAV, POSE, INERT (report_agg.h)
+  UDS_TOPIC_METRICS = 1u << 7,           // METRICS, METRICS_TASKS (robot_metrics.h), ADMIT (tx_sched.h)
+  UDS_TOPIC_ALERTS = 1u << 8,            // HPR, sent as UDS_TX_CMD: never coalesced
+};
+#define UDS_TOPIC_ALL  0x1FFu
+#define UDS_ROBOT_ANY  (-1)              // Not tied to one robot (or robot >= 32)
+
+uint32_t uds_topic_bit(const char *name);                  // 0 = no such topic
+int      uds_topic_list(uint32_t mask, char *out, size_t n); // JSON array of names, -1 if it does not fit
+
+typedef void (*uds_want_write_fn)(int fd, int on); // Arm/disarm EPOLLOUT
+typedef ssize_t (*uds_writev_fn)(void *io, const struct iovec *iov, int n); // writev() stand-in, same returns
+
+typedef struct {
+  uint8_t  hdr[4];                       // Big-endian length prefix, or a WebSocket header
+  uint8_t  hlen;                         // Bytes of hdr in use (4; 2 or 4 for WebSocket)
+  uint32_t len;                          // Payload length
+  uint8_t  kind;                         // enum uds_tx_kind
+  uint8_t  used;                         // Slot holds a queued frame
+  uint16_t key;                          // Telemetry coalescing key (0 = none)
+  char     data[UDS_TX_SLOT_MAX];        // Payload bytes
+} uds_tx_slot_t;
+
+typedef struct {
+  int               fd;                  // Client socket (-1 = unregistered)
+  uds_tx_slot_t     slots[UDS_TX_SLOTS]; // Frame storage (no heap)
+  uint8_t           order[UDS_TX_SLOTS]; // Slot indices in send order
+  int               count;               // Frames queued
+  size_t            sent;                // Bytes of the head frame already written
+  int               want_write;          // EPOLLOUT currently armed
+  uds_want_write_fn on_want_write;       // Reactor hook (may be NULL)
+  uint32_t          dropped;             // Frames dropped/evicted
+  uint32_t          coalesced;           // Telemetry frames replaced in place
+  shm_ring_t       *shm;                 // Shared-memory transport (NULL = socket)
+  uint8_t           ws;                  // Frames go out as WebSocket messages (ws_server.h)
+  uint32_t          topics;              // Subscribed UDS_TOPIC_* (all by default)
+  uint32_t          robots;              // Subscribed robots, bit per index (all by default)
+  uds_writev_fn     io_writev;           // Stream layered on the fd (TLS, uds_tls.h); NULL = writev()
+  void             *io;                  // ... and its state
+  uint8_t           seq;                 // SOCK_SEQPACKET peer: a message per frame, no prefix, sendmmsg()
+} uds_tx_t;
+
+void uds_tx_init(uds_tx_t *tx, int fd, uds_want_write_fn on_want_write);
+void uds_tx_close(uds_tx_t *tx);
+int  uds_tx_enqueue(uds_tx_t *tx, const char *data, uint32_t len, int kind, uint16_t key);
+int  uds_tx_enqueue_ws(uds_tx_t *tx, int op, const void *data, uint32_t len); // Binary / control message
+int  uds_tx_flush(uds_tx_t *tx);
+int  uds_tx_broadcast(const char *json, int kind, uint16_t key, uint32_t topic, int robot);
+int  uds_tx_enqueue_json(uds_tx_t *tx, const cJSON *item, int kind, uint16_t key);
+int  uds_tx_broadcast_json(const cJSON *item, int kind, uint16_t key, uint32_t topic, int robot);
 
 int read_full(int fd, void *buf, size_t n);
 int uds_send_json(int fd, const char *json);
+int uds_send_cjson(int fd, const cJSON *item);           // Printed in place, no cJSON_Print copy
 int json_get_u8(const cJSON *obj, const char *key, uint8_t *out, int minv, int maxv);
 int json_get_u16(const cJSON *obj, const char *key, uint16_t *out, int minv, int maxv);
 int json_get_u32(const cJSON *obj, const char *key, uint32_t *out);
+int json_get_i64(const cJSON *obj, const char *key, int64_t *out);   // Ids, timestamps: exact
 int uds_server_listen(const char *path);
+int uds_seq_listen(const char *path);                    // GS_UDS_SEQ: SOCK_SEQPACKET, nonblocking
+int uds_tcp_listen(const char *bind_addr, int port);     // GS_TCP_PORT: same frames over TCP (IPv4)
 #endif
\ No newline at end of file
@@ -0,0 +1,99 @@
+#define _GNU_SOURCE                         // memfd_create
+#include "shm_ring.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+static void ring_reset(shm_ring_t *r) {
+  memset(r, 0, sizeof(*r));
+  r->memfd = r->bell[0] = r->bell[1] = -1;
+}
+
+static int ring_map(shm_ring_t *r, uint32_t ring_bytes) {
+  r->map_len = SHM_HDR_BYTES + 2 * (size_t)ring_bytes;
+  void *m = mmap(NULL, r->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->memfd, 0);
+  if (m == MAP_FAILED) return -1;
+  r->hdr = m;
+  r->data[0] = (uint8_t *)m + SHM_HDR_BYTES;
+  r->data[1] = r->data[0] + ring_bytes;
+  r->mask = ring_bytes - 1;
+  return 0;
+}
+
+int shm_ring_create(shm_ring_t *r) {
+  ring_reset(r);
+  r->memfd = memfd_create("gs_bridge_shm", MFD_CLOEXEC);
+  r->bell[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  r->bell[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (r->memfd < 0 || r->bell[0] < 0 || r->bell[1] < 0) goto fail;
+  if (ftruncate(r->memfd, SHM_HDR_BYTES + 2 * (off_t)SHM_RING_BYTES) != 0) goto fail;
+  if (ring_map(r, SHM_RING_BYTES) != 0) goto fail;
+
+  r->hdr->magic = SHM_MAGIC;                               // Fresh memfd: the rest is zero
+  r->hdr->ring_bytes = SHM_RING_BYTES;
+  atomic_store(&r->hdr->ctl[0].wait, 1);                   // Both consumers start idle
+  atomic_store(&r->hdr->ctl[1].wait, 1);
+  return 0;
+
+fail:
+  shm_ring_destroy(r);
+  return -1;
+}
+
+// The ring size is the creator's (a LOWMEM bridge has smaller rings), read
+// off the control page and checked against the memfd's size
+int shm_ring_attach(shm_ring_t *r, int memfd, int bell0, int bell1) {
+  ring_reset(r);
+  r->memfd = memfd;
+  r->bell[0] = bell0;
+  r->bell[1] = bell1;
+  struct stat st;
+  shm_hdr_t hdr;
+  if (fstat(memfd, &st) != 0 || pread(memfd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)) goto fail;
+  uint32_t n = hdr.ring_bytes;
+  if (hdr.magic != SHM_MAGIC || n == 0 || (n & (n - 1)) != 0
+      || st.st_size != SHM_HDR_BYTES + 2 * (off_t)n) goto fail;
+  if (ring_map(r, n) == 0) return 0;
+
+fail:
+  shm_ring_destroy(r);
+  return -1;
+}
+
+void shm_ring_destroy(shm_ring_t *r) {
+  if (r->hdr) munmap(r->hdr, r->map_len);
+  if (r->memfd >= 0) close(r->memfd);
+  for (int i = 0; i < 2; i++) if (r->bell[i] >= 0) close(r->bell[i]);
+  ring_reset(r);
+}
+
+// The reply goes out as one sendmsg so the fds ride on its first byte; the
+// caller has flushed the client's queue, so the short reply fits.
+int shm_ring_send_fds(int sock, const char *json, const shm_ring_t *r) {
+  uint32_t len = (uint32_t)strlen(json), len_be = htonl(len);
+  struct iovec iov[2] = {
+    { .iov_base = &len_be,      .iov_len = 4   },
+    { .iov_base = (void *)json, .iov_len = len },
+  };
+  int fds[3] = { r->memfd, r->bell[0], r->bell[1] };
+  union {
+    char           buf[CMSG_SPACE(sizeof(fds))];
+    struct cmsghdr align;
+  } u;
+  memset(&u, 0, sizeof(u));
+  struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2, .msg_control = u.buf, .msg_controllen = sizeof(u.buf) };
+  struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+  cm->cmsg_level = SOL_SOCKET;
+  cm->cmsg_type = SCM_RIGHTS;
+  cm->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+
+  ssize_t w;
+  do { w = sendmsg(sock, &msg, MSG_NOSIGNAL); } while (w < 0 && errno == EINTR);
+  return w == (ssize_t)(4 + len) ? 0 : -1;
+}
@@ -0,0 +1,141 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+// ------------------------- Shared-memory UDS transport -------------------------
+// A client that sends {"T":"SHM"} on its socket gets a memfd and two eventfds
+// back (SCM_RIGHTS on the {"type":"SHM"} reply). From then on its frames go
+// through two SPSC byte rings in the memfd instead of the socket:
+//   ring 0  Node -> bridge      bell 0 wakes the bridge
+//   ring 1  bridge -> Node      bell 1 wakes Node
+// A ring holds exactly the socket's byte stream ([4-byte BE length][frame]),
+// so both ends keep their decoders. The socket stays open as the liveness
+// signal only: either side closing it ends the session.
+//
+// A bell is rung only when the other side asked for one, so a busy pair
+// trades frames with no syscall at all:
+//   wait  the consumer found the ring empty and went back to its loop
+//   full  the producer had no room for a frame and is holding it
+// Each flag is set and then the ring re-checked (seq_cst on both sides), so
+// a wakeup can't fall between the check and the flag.
+//
+// This header is shared with the Node addon (server/shm_ring), which maps the
+// same memfd; keep the layout in step with it.
+
+#define SHM_MAGIC      0x31525347u          // "GSR1"
+#define SHM_HDR_BYTES  4096                 // Control page; rings follow it
+#ifndef SHM_RING_BYTES
+#ifdef GS_LOWMEM
+#define SHM_RING_BYTES (64 * 1024)
+#else
+#define SHM_RING_BYTES (256 * 1024)         // Per direction, power of two
+#endif
+#endif
+
+#if (SHM_RING_BYTES & (SHM_RING_BYTES - 1)) != 0
+#error "SHM_RING_BYTES must be a power of two"
+#endif
+
+enum { SHM_TO_BRIDGE = 0, SHM_TO_NODE = 1 };
+
+typedef struct {
+  _Alignas(64) _Atomic uint32_t head;       // Consumer: bytes taken (free-running)
+  _Atomic uint32_t wait;                    // Consumer idle: ring bell on put
+  _Alignas(64) _Atomic uint32_t tail;       // Producer: bytes put
+  _Atomic uint32_t full;                    // Producer stalled: ring bell on take
+} shm_ctl_t;
+
+typedef struct {
+  uint32_t  magic;
+  uint32_t  ring_bytes;
+  shm_ctl_t ctl[2];
+} shm_hdr_t;
+
+_Static_assert(sizeof(shm_hdr_t) <= SHM_HDR_BYTES, "shm control page overflow");
+
+typedef struct {
+  shm_hdr_t *hdr;                           // NULL = not mapped
+  uint8_t   *data[2];
+  uint32_t   mask;
+  int        memfd;
+  int        bell[2];                       // eventfds, by the ring whose consumer they wake
+  size_t     map_len;
+} shm_ring_t;
+
+int  shm_ring_create(shm_ring_t *r);                       // Bridge: memfd + bells, both rings empty
+int  shm_ring_attach(shm_ring_t *r, int memfd, int bell0, int bell1); // Node: map what was passed, any ring size
+void shm_ring_destroy(shm_ring_t *r);                      // Unmap, close the fds
+int  shm_ring_send_fds(int sock, const char *json, const shm_ring_t *r); // Framed reply + the 3 fds
+
+static inline void shm_bell(int efd) {
+  uint64_t one = 1;
+  (void)!write(efd, &one, sizeof(one));
+}
+
+// Producer: a then b as one unit, or nothing. 0 = put, 1 = no room now (the
+// consumer rings once it frees some), -1 = larger than the ring.
+static inline int shm_ring_put(shm_ring_t *r, int ring, const void *a, uint32_t na,
+                               const void *b, uint32_t nb) {
+  shm_ctl_t *c = &r->hdr->ctl[ring];
+  uint32_t size = r->mask + 1, n = na + nb;
+  uint32_t tail = atomic_load_explicit(&c->tail, memory_order_relaxed);
+  if (n > size) return -1;
+  if (size - (tail - atomic_load_explicit(&c->head, memory_order_acquire)) < n) {
+    atomic_store(&c->full, 1);
+    if (size - (tail - atomic_load(&c->head)) < n) return 1;
+    atomic_store_explicit(&c->full, 0, memory_order_relaxed);
+  }
+  const uint8_t *src[2] = { a, b };
+  uint32_t len[2] = { na, nb };
+  for (int i = 0; i < 2; i++) {
+    if (!len[i]) continue;
+    uint32_t off = tail & r->mask, first = size - off < len[i] ? size - off : len[i];
+    memcpy(r->data[ring] + off, src[i], first);
+    memcpy(r->data[ring], src[i] + first, len[i] - first);
+    tail += len[i];
+  }
+  atomic_store_explicit(&c->tail, tail, memory_order_release);
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&c->wait, memory_order_relaxed) && atomic_exchange(&c->wait, 0))
+    shm_bell(r->bell[ring]);
+  return 0;
+}
+
+// Consumer: readable bytes as up to two spans (the second after the wrap)
+static inline uint32_t shm_ring_peek(shm_ring_t *r, int ring, const uint8_t *p[2], uint32_t n[2]) {
+  shm_ctl_t *c = &r->hdr->ctl[ring];
+  uint32_t head = atomic_load_explicit(&c->head, memory_order_relaxed);
+  uint32_t avail = atomic_load_explicit(&c->tail, memory_order_acquire) - head;
+  uint32_t off = head & r->mask, size = r->mask + 1;
+  n[0] = size - off < avail ? size - off : avail;
+  n[1] = avail - n[0];
+  p[0] = r->data[ring] + off;
+  p[1] = r->data[ring];
+  return avail;
+}
+
+static inline void shm_ring_take(shm_ring_t *r, int ring, uint32_t n) {
+  shm_ctl_t *c = &r->hdr->ctl[ring];
+  atomic_store_explicit(&c->head, atomic_load_explicit(&c->head, memory_order_relaxed) + n,
+                        memory_order_release);
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&c->full, memory_order_relaxed) && atomic_exchange(&c->full, 0))
+    shm_bell(r->bell[!ring]);                              // The producer is the other side
+}
+
+// Consumer going back to its loop: 0 = asleep (the next put rings),
+// 1 = bytes arrived meanwhile, read again
+static inline int shm_ring_idle(shm_ring_t *r, int ring) {
+  shm_ctl_t *c = &r->hdr->ctl[ring];
+  atomic_store(&c->wait, 1);
+  if (atomic_load(&c->tail) == atomic_load_explicit(&c->head, memory_order_relaxed)) return 0;
+  atomic_store_explicit(&c->wait, 0, memory_order_relaxed);
+  return 1;
+}
+
+#endif
@@ -0,0 +1,134 @@
+#include "uds_tls.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include "../log/gs_log.h"
+
+#define TLS_STAGE 16384                                 // Plaintext of one TLS record, the stage's first size
+
+struct uds_tls {
+  SSL     *ssl;
+  int      want_write;                                  // Last read stalled on a full socket
+  size_t   off;                                         // Stage bytes already written ...
+  size_t   len;                                         // ... of the ones taken from the queue
+  size_t   cap;
+  uint8_t *stage;
+};
+
+static SSL_CTX *g_ctx;                                  // Shared by every TCP peer
+
+static void tls_log(const char *what) {
+  unsigned long e = ERR_get_error();
+  char msg[160] = "no detail";
+  if (e) ERR_error_string_n(e, msg, sizeof(msg));
+  LOG_WARN("TLS: %s: %s", what, msg);
+  ERR_clear_error();
+}
+
+int uds_tls_setup(const char *cert, const char *key) {
+  SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+  if (!ctx) { tls_log("no context"); return -1; }
+  SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+  SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE);
+  if (SSL_CTX_use_certificate_chain_file(ctx, cert) != 1) { tls_log(cert); SSL_CTX_free(ctx); return -1; }
+  if (SSL_CTX_use_PrivateKey_file(ctx, key, SSL_FILETYPE_PEM) != 1 || SSL_CTX_check_private_key(ctx) != 1) {
+    tls_log(key);
+    SSL_CTX_free(ctx);
+    return -1;
+  }
+  g_ctx = ctx;
+  return 0;
+}
+
+uds_tls_t *uds_tls_open(int fd) {
+  if (!g_ctx) return NULL;
+  uds_tls_t *t = calloc(1, sizeof(*t));
+  if (!t) return NULL;
+  t->cap = TLS_STAGE;
+  t->stage = malloc(t->cap);
+  t->ssl = t->stage ? SSL_new(g_ctx) : NULL;
+  if (!t->ssl || SSL_set_fd(t->ssl, fd) != 1) {
+    tls_log("session");
+    SSL_free(t->ssl);
+    free(t->stage);
+    free(t);
+    return NULL;
+  }
+  SSL_set_accept_state(t->ssl);                         // Handshake inside the first read / write
+  return t;
+}
+
+void uds_tls_close(uds_tls_t *t) {
+  if (!t) return;
+  if (SSL_is_init_finished(t->ssl)) SSL_shutdown(t->ssl); // One try at close_notify, the socket goes next
+  ERR_clear_error();
+  SSL_free(t->ssl);
+  free(t->stage);
+  free(t);
+}
+
+int uds_tls_read(uds_tls_t *t, uds_rx_t *rx, uds_frame_fn fn, void *ctx) {
+  uint8_t chunk[UDS_RX_CHUNK];
+  t->want_write = 0;
+  while (1) {
+    ERR_clear_error();
+    int r = SSL_read(t->ssl, chunk, sizeof(chunk));
+    if (r > 0) {
+      if (uds_rx_feed(rx, chunk, (size_t)r, fn, ctx) < 0) return -2;
+      continue;
+    }
+    int e = SSL_get_error(t->ssl, r);
+    if (e == SSL_ERROR_WANT_READ) return 0;             // Drained, keep partial state
+    if (e == SSL_ERROR_WANT_WRITE) { t->want_write = 1; return 0; }
+    if (e == SSL_ERROR_SSL) tls_log("read");            // Failed handshake, bad record
+    ERR_clear_error();
+    return -1;                                          // close_notify or EOF
+  }
+}
+
+int uds_tls_want_write(const uds_tls_t *t) {
+  return t->want_write;
+}
+
+// Write what is left of the stage: 0 when empty, -1 with errno like write()
+static int tls_push(uds_tls_t *t) {
+  while (t->off < t->len) {
+    ERR_clear_error();
+    int r = SSL_write(t->ssl, t->stage + t->off, (int)(t->len - t->off)); // Same bytes on every retry
+    if (r > 0) { t->off += (size_t)r; continue; }
+    int e = SSL_get_error(t->ssl, r);
+    if (e == SSL_ERROR_WANT_READ || e == SSL_ERROR_WANT_WRITE) { errno = EAGAIN; return -1; }
+    if (e == SSL_ERROR_SSL) tls_log("write");
+    ERR_clear_error();
+    errno = EPIPE;
+    return -1;
+  }
+  t->off = t->len = 0;
+  return 0;
+}
+
+// Takes all of iov once the stage is out (the send queue offers at most
+// UDS_TX_IOV frames at a time; a frame too big for a slot comes whole, so it
+// is never torn across calls), and nothing while it is not
+ssize_t uds_tls_writev(void *io, const struct iovec *iov, int n) {
+  uds_tls_t *t = (uds_tls_t *)io;
+  if (tls_push(t) < 0) return -1;                       // The stage goes out first, in order
+  size_t want = 0;
+  for (int i = 0; i < n; i++) want += iov[i].iov_len;
+  if (want > t->cap) {
+    uint8_t *grown = realloc(t->stage, want);
+    if (!grown) { errno = ENOMEM; return -1; }
+    t->stage = grown;
+    t->cap = want;
+  }
+  size_t took = 0;
+  for (int i = 0; i < n; i++) {
+    memcpy(t->stage + took, iov[i].iov_base, iov[i].iov_len);
+    took += iov[i].iov_len;
+  }
+  t->len = took;
+  if (tls_push(t) < 0 && errno != EAGAIN) return -1;
+  return (ssize_t)took;                                 // Taken: the stage owns them now
+}
@@ -0,0 +1,32 @@
+#ifndef UDS_TLS_H
+#define UDS_TLS_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "json_uds.h"
+
+// ------------------------- TLS for TCP peers -------------------------
+// GS_TCP_CERT / GS_TCP_KEY (PEM) put the GS_TCP_PORT listener behind TLS:
+// the same [4-byte BE length][frame] stream, inside TLS 1.2+. The handshake
+// runs inside the first reads and writes, so an accepted socket joins the
+// loop at once like a plaintext one. Reads feed the client's frame decoder
+// (uds_rx_feed); its send queue writes through uds_tls_writev (io_writev),
+// which copies what it is offered into a stage and owns it from then on (an
+// SSL_write that would block must be retried with the same bytes, and the
+// queue may have evicted its head by then). While the stage has not gone out
+// it takes nothing, so the queue backs up as it would on a full socket.
+// n == 0 pushes the stage alone; the queue does that last on every flush.
+//
+// Built with make TLS=1 (OpenSSL libssl, GS_WITH_TLS); without it the TCP
+// listener is plaintext only and asking for TLS is refused at startup.
+
+typedef struct uds_tls uds_tls_t;
+
+int        uds_tls_setup(const char *cert, const char *key);  // Server context, -1 with the reason logged
+uds_tls_t *uds_tls_open(int fd);                              // Server side of an accepted socket
+void       uds_tls_close(uds_tls_t *t);                       // Best-effort close_notify, then free
+int        uds_tls_read(uds_tls_t *t, uds_rx_t *rx, uds_frame_fn fn, void *ctx); // uds_rx_read() returns
+ssize_t    uds_tls_writev(void *t, const struct iovec *iov, int n);          // uds_tx_t.io_writev
+int        uds_tls_want_write(const uds_tls_t *t);           // A read stalled on a full socket
+
+#endif
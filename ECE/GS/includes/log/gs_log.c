@@ -0,0 +1,243 @@
+#include "gs_log.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+int gs_log_level = GS_LOG_INFO;
+
+typedef struct {
+  uint64_t t_ns;
+  uint8_t  level;
+  uint16_t len;
+  char     text[GS_LOG_LINE];
+} gs_log_line_t;
+
+// One per logging thread, linked once and kept until exit
+typedef struct gs_log_ring {
+  struct gs_log_ring *next;
+  _Atomic uint64_t    head;                 // Next line the owner writes
+  _Atomic uint64_t    tail;                 // Next line the writer reads
+  _Atomic uint64_t    dropped;              // Lines lost to a full ring
+  gs_log_line_t       line[GS_LOG_SLOTS];
+} gs_log_ring_t;
+
+_Static_assert((GS_LOG_SLOTS & (GS_LOG_SLOTS - 1)) == 0, "GS_LOG_SLOTS must be a power of two");
+
+static _Atomic(gs_log_ring_t *) g_rings = NULL;
+static __thread gs_log_ring_t  *t_ring  = NULL;
+static _Atomic int g_running  = 0;          // Writer thread owns the output
+static _Atomic int g_stop     = 0;
+static _Atomic int g_sleeping = 0;          // Writer is (about to be) parked on g_efd
+static int         g_efd      = -1;
+static pthread_t   g_writer;
+static uint64_t    g_t0;
+
+static const char level_tag[] = "EWID";
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void write_all(int fd, const char *p, size_t n) {
+  while (n) {
+    ssize_t w = write(fd, p, n);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return;                                    // Nowhere to go: drop it
+    p += w;
+    n -= (size_t)w;
+  }
+}
+
+static int out_fd(int level) {
+  return level <= GS_LOG_WARN ? STDERR_FILENO : STDOUT_FILENO;
+}
+
+// "<t> <L> <text>\n" into out (cap >= GS_LOG_LINE + 32)
+static size_t format_line(char *out, size_t cap, const gs_log_line_t *l) {
+  uint64_t t = l->t_ns - g_t0;
+  int n = snprintf(out, cap, "%6llu.%06llu %c ", (unsigned long long)(t / 1000000000u),
+                   (unsigned long long)(t % 1000000000u / 1000u), level_tag[l->level & 3]);
+  memcpy(out + n, l->text, l->len);
+  out[n + l->len] = '\n';
+  return (size_t)n + l->len + 1;
+}
+
+static gs_log_ring_t *ring_self(void) {
+  if (t_ring) return t_ring;
+  gs_log_ring_t *r = calloc(1, sizeof(*r));
+  if (!r) return NULL;
+  r->next = atomic_load(&g_rings);
+  while (!atomic_compare_exchange_weak(&g_rings, &r->next, r)) {}
+  return t_ring = r;
+}
+
+// ------------------------- Writer thread -------------------------
+
+static char g_out[2][GS_LOG_OUT_BYTES];     // stdout, stderr batches
+static size_t g_out_len[2];
+
+static void flush_out(int i) {
+  if (g_out_len[i]) write_all(i ? STDERR_FILENO : STDOUT_FILENO, g_out[i], g_out_len[i]);
+  g_out_len[i] = 0;
+}
+
+static void emit(const gs_log_line_t *l) {
+  int i = out_fd(l->level) == STDERR_FILENO;
+  if (sizeof(g_out[i]) - g_out_len[i] < GS_LOG_LINE + 32) flush_out(i);
+  g_out_len[i] += format_line(g_out[i] + g_out_len[i], sizeof(g_out[i]) - g_out_len[i], l);
+}
+
+static size_t drain(void) {
+  size_t lines = 0;
+  for (gs_log_ring_t *r = atomic_load(&g_rings); r; r = r->next) {
+    uint64_t t = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint64_t h = atomic_load_explicit(&r->head, memory_order_acquire);
+    for (; t < h; t++, lines++) emit(&r->line[t & (GS_LOG_SLOTS - 1)]);
+    atomic_store_explicit(&r->tail, t, memory_order_release);
+
+    uint64_t lost = atomic_exchange_explicit(&r->dropped, 0, memory_order_relaxed);
+    if (lost) {
+      gs_log_line_t l = { .t_ns = now_ns(), .level = GS_LOG_WARN };
+      l.len = (uint16_t)snprintf(l.text, sizeof(l.text), "log: %llu lines dropped, ring full",
+                                 (unsigned long long)lost);
+      emit(&l);
+    }
+  }
+  flush_out(0);
+  flush_out(1);
+  return lines;
+}
+
+static void *writer_main(void *arg) {
+  (void)arg;
+  for (;;) {
+    if (drain()) continue;
+    if (atomic_load(&g_stop)) break;
+    atomic_store(&g_sleeping, 1);                          // Producers wake us from here on
+    atomic_thread_fence(memory_order_seq_cst);             // ... and see it before we re-check
+    if (drain()) { atomic_store(&g_sleeping, 0); continue; }
+    struct pollfd p = { .fd = g_efd, .events = POLLIN };
+    poll(&p, 1, 100);
+    uint64_t v;
+    if (read(g_efd, &v, sizeof(v)) < 0) {}
+    atomic_store(&g_sleeping, 0);
+  }
+  drain();
+  return NULL;
+}
+
+static void wake(void) {
+  atomic_thread_fence(memory_order_seq_cst);               // Line published before the check
+  if (atomic_load(&g_sleeping) && atomic_exchange(&g_sleeping, 0)) {
+    uint64_t one = 1;
+    if (write(g_efd, &one, sizeof(one)) < 0) {}
+  }
+}
+
+size_t gs_log_footprint(size_t *per_thread) {
+  if (per_thread) *per_thread = sizeof(gs_log_ring_t);
+  return sizeof(g_out);
+}
+
+int gs_log_set_level(const char *name) {
+  if (strcmp(name, "err") == 0) gs_log_level = GS_LOG_ERR;
+  else if (strcmp(name, "warn") == 0) gs_log_level = GS_LOG_WARN;
+  else if (strcmp(name, "info") == 0) gs_log_level = GS_LOG_INFO;
+  else if (strcmp(name, "debug") == 0) gs_log_level = GS_LOG_DEBUG;
+  else return -1;
+  return 0;
+}
+
+int gs_log_start(void) {
+  if (atomic_load(&g_running)) return 0;
+  if (!g_t0) g_t0 = now_ns();
+  const char *lv = getenv("GS_LOG");
+  if (lv && lv[0]) gs_log_set_level(lv);
+  g_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (g_efd < 0) return -1;
+  atomic_store(&g_stop, 0);
+  pthread_attr_t attr;                                     // Small stack: GS_MLOCK locks all of it
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, GS_LOG_STACK);
+  int rc = pthread_create(&g_writer, &attr, writer_main, NULL);
+  pthread_attr_destroy(&attr);
+  if (rc != 0) {
+    close(g_efd);
+    g_efd = -1;
+    return -1;
+  }
+  atomic_store(&g_running, 1);
+  atexit(gs_log_stop);                                     // Error returns from main still flush
+  return 0;
+}
+
+void gs_log_stop(void) {
+  if (!atomic_exchange(&g_running, 0)) return;             // New lines go out directly from here
+  atomic_store(&g_stop, 1);
+  atomic_store(&g_sleeping, 1);
+  wake();
+  pthread_join(g_writer, NULL);
+  close(g_efd);
+  g_efd = -1;
+}
+
+// ------------------------- Producers -------------------------
+
+void gs_log_write(int level, gs_log_site_t *site, const char *fmt, ...) {
+  uint64_t now = now_ns();
+  if (!g_t0) g_t0 = now;
+
+  // Rate limit per call site; a racing window reset only lets a line or two extra through
+  uint64_t w = atomic_load_explicit(&site->window_ns, memory_order_relaxed);
+  if (now - w >= (uint64_t)GS_LOG_WINDOW_MS * 1000000u &&
+      atomic_compare_exchange_strong(&site->window_ns, &w, now))
+    atomic_store_explicit(&site->count, 0, memory_order_relaxed);
+  if (atomic_fetch_add_explicit(&site->count, 1, memory_order_relaxed) >= GS_LOG_BURST) {
+    atomic_fetch_add_explicit(&site->held, 1, memory_order_relaxed);
+    return;
+  }
+  uint32_t held = atomic_exchange_explicit(&site->held, 0, memory_order_relaxed);
+
+  gs_log_ring_t *r = atomic_load_explicit(&g_running, memory_order_acquire) ? ring_self() : NULL;
+  gs_log_line_t direct, *l = &direct;
+  uint64_t h = 0;
+  if (r) {
+    h = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (h - atomic_load_explicit(&r->tail, memory_order_acquire) >= GS_LOG_SLOTS) {
+      atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+      return;                                              // Never wait for the writer
+    }
+    l = &r->line[h & (GS_LOG_SLOTS - 1)];
+  }
+
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(l->text, sizeof(l->text), fmt, ap);
+  va_end(ap);
+  if (n < 0) n = 0;
+  if ((size_t)n >= sizeof(l->text)) n = sizeof(l->text) - 1;
+  while (n && (l->text[n - 1] == '\n' || l->text[n - 1] == '\r')) n--;
+  if (held && (size_t)n < sizeof(l->text) - 1)
+    n += snprintf(l->text + n, sizeof(l->text) - (size_t)n, " [+%u suppressed]", held);
+  if ((size_t)n >= sizeof(l->text)) n = sizeof(l->text) - 1;
+  l->len = (uint16_t)n;
+  l->level = (uint8_t)level;
+  l->t_ns = now;
+
+  if (!r) {                                                // No writer: straight out
+    char out[GS_LOG_LINE + 32];
+    write_all(out_fd(level), out, format_line(out, sizeof(out), l));
+    return;
+  }
+  atomic_store_explicit(&r->head, h + 1, memory_order_release);
+  wake();
+}
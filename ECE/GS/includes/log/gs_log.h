@@ -0,0 +1,82 @@
+#ifndef GS_LOG_H
+#define GS_LOG_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ------------------------- Asynchronous bridge log -------------------------
+// The event loop and the UART reader threads must never wait on a slow
+// terminal or a full pipe. A log call formats its line into a ring owned by
+// the calling thread (single producer, no lock) and returns; one writer
+// thread drains every ring and does the blocking write()s, ERR/WARN to
+// stderr, the rest to stdout. A full ring drops the line and the writer
+// reports how many went.
+//
+// Each line goes out as "<seconds since start> <E|W|I|D> <text>".
+//
+// Levels: lines above GS_LOG_LEVEL (compile time, -DGS_LOG_LEVEL=...) are
+// not compiled in at all; GS_LOG=err|warn|info|debug lowers it at run time
+// (default info). Every call site keeps at most GS_LOG_BURST lines per
+// GS_LOG_WINDOW_MS and counts the rest, reported when it speaks next.
+//
+// Before gs_log_start() and after gs_log_stop() lines are written
+// synchronously, so startup errors and exit paths still print.
+
+#define GS_LOG_ERR   0
+#define GS_LOG_WARN  1
+#define GS_LOG_INFO  2
+#define GS_LOG_DEBUG 3
+
+#ifndef GS_LOG_LEVEL
+#define GS_LOG_LEVEL GS_LOG_DEBUG
+#endif
+
+#define GS_LOG_LINE      256                // Bytes per line, longer text is cut
+#ifndef GS_LOG_SLOTS
+#ifdef GS_LOWMEM
+#define GS_LOG_SLOTS     128
+#else
+#define GS_LOG_SLOTS     512                // Lines per thread ring (power of two)
+#endif
+#endif
+#ifndef GS_LOG_OUT_BYTES
+#ifdef GS_LOWMEM
+#define GS_LOG_OUT_BYTES (16 * 1024)
+#else
+#define GS_LOG_OUT_BYTES (64 * 1024)        // Writer batch per stream
+#endif
+#endif
+#define GS_LOG_BURST     50                 // Lines per call site per window
+#define GS_LOG_STACK     (128 * 1024)       // Writer thread stack
+#define GS_LOG_WINDOW_MS 1000
+
+typedef struct {
+  _Atomic uint64_t window_ns;               // Start of the current window
+  _Atomic uint32_t count;                   // Lines in it so far
+  _Atomic uint32_t held;                    // Lines held back since the last report
+} gs_log_site_t;
+
+extern int gs_log_level;                    // Run-time level, <= GS_LOG_LEVEL applies too
+
+int  gs_log_start(void);                    // Reads GS_LOG, starts the writer thread
+int  gs_log_set_level(const char *name);    // err / warn / info / debug; -1 = no such level
+void gs_log_stop(void);                     // Drains every ring and joins the writer
+size_t gs_log_footprint(size_t *per_thread); // Batch buffers; *per_thread = one ring
+void gs_log_write(int level, gs_log_site_t *site, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define GS_LOG_AT(level, ...)                                             \
+  do {                                                                    \
+    if ((level) <= GS_LOG_LEVEL && (level) <= gs_log_level) {             \
+      static gs_log_site_t gs_log_site_;                                  \
+      gs_log_write((level), &gs_log_site_, __VA_ARGS__);                  \
+    }                                                                     \
+  } while (0)
+
+#define LOG_ERR(...)   GS_LOG_AT(GS_LOG_ERR, __VA_ARGS__)
+#define LOG_WARN(...)  GS_LOG_AT(GS_LOG_WARN, __VA_ARGS__)
+#define LOG_INFO(...)  GS_LOG_AT(GS_LOG_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) GS_LOG_AT(GS_LOG_DEBUG, __VA_ARGS__)
+
+#endif
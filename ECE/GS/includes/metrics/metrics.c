@@ -0,0 +1,93 @@
+#include "metrics.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+_Atomic uint64_t    metrics_counters[MC_COUNT];
+metrics_histogram_t metrics_histograms[MH_COUNT];
+
+#define METRICS_NAME(name) #name,
+static const char *const counter_names[MC_COUNT] = { METRICS_COUNTERS(METRICS_NAME) };
+static const char *const hist_names[MH_COUNT]    = { METRICS_HISTOGRAMS(METRICS_NAME) };
+#undef METRICS_NAME
+
+uint64_t metrics_now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static unsigned bucket_of(uint64_t v) {
+  if (v < METRICS_SUB) return (unsigned)v;
+  if (v >> 32) return METRICS_BUCKETS - 1;               // Clamp past 2^32
+  unsigned e = 63u - (unsigned)__builtin_clzll(v);        // v in [2^e, 2^(e+1))
+  unsigned m = (unsigned)(v >> (e - METRICS_SUB_BITS)) & (METRICS_SUB - 1);
+  return (e - METRICS_SUB_BITS + 1) * METRICS_SUB + m;
+}
+
+uint64_t metrics_bucket_le(unsigned idx) {
+  if (idx < METRICS_SUB) return idx;
+  unsigned e = idx / METRICS_SUB + METRICS_SUB_BITS - 1;
+  unsigned m = idx % METRICS_SUB;
+  uint64_t lo = (uint64_t)(METRICS_SUB + m) << (e - METRICS_SUB_BITS);
+  return lo + ((uint64_t)1 << (e - METRICS_SUB_BITS)) - 1;
+}
+
+void metrics_observe(metrics_hist_t h, uint64_t v) {
+  metrics_histogram_t *m = &metrics_histograms[h];
+  atomic_fetch_add_explicit(&m->bucket[bucket_of(v)], 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&m->count, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&m->sum, v, memory_order_relaxed);
+
+  uint64_t cur = atomic_load_explicit(&m->max, memory_order_relaxed);
+  while (v > cur && !atomic_compare_exchange_weak_explicit(&m->max, &cur, v, memory_order_relaxed,
+                                                           memory_order_relaxed)) {}
+}
+
+// Appends with the usual snprintf truncation check; returns -1 once full
+__attribute__((format(printf, 4, 5)))
+static int put(char *out, size_t cap, size_t *n, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int r = vsnprintf(out + *n, cap - *n, fmt, ap);
+  va_end(ap);
+  if (r < 0 || (size_t)r >= cap - *n) return -1;
+  *n += (size_t)r;
+  return 0;
+}
+
+int metrics_json(char *out, size_t cap, const metrics_gauge_t *gauges, int n_gauges) {
+  size_t n = 0;
+  if (put(out, cap, &n, "{\"type\":\"METRICS\",\"counters\":{") < 0) return -1;
+  for (int i = 0; i < MC_COUNT; i++) {
+    unsigned long long v = atomic_load_explicit(&metrics_counters[i], memory_order_relaxed);
+    if (put(out, cap, &n, "%s\"%s\":%llu", i ? "," : "", counter_names[i], v) < 0) return -1;
+  }
+
+  if (put(out, cap, &n, "},\"gauges\":{") < 0) return -1;
+  for (int i = 0; i < n_gauges; i++) {
+    if (put(out, cap, &n, "%s\"%s\":%llu", i ? "," : "", gauges[i].name,
+            (unsigned long long)gauges[i].value) < 0) return -1;
+  }
+
+  if (put(out, cap, &n, "},\"histograms\":{") < 0) return -1;
+  for (int h = 0; h < MH_COUNT; h++) {
+    metrics_histogram_t *m = &metrics_histograms[h];
+    if (put(out, cap, &n, "%s\"%s\":{\"count\":%llu,\"sum\":%llu,\"max\":%llu,\"buckets\":[",
+            h ? "," : "", hist_names[h],
+            (unsigned long long)atomic_load_explicit(&m->count, memory_order_relaxed),
+            (unsigned long long)atomic_load_explicit(&m->sum, memory_order_relaxed),
+            (unsigned long long)atomic_load_explicit(&m->max, memory_order_relaxed)) < 0) return -1;
+    int first = 1;
+    for (unsigned b = 0; b < METRICS_BUCKETS; b++) {
+      uint32_t c = atomic_load_explicit(&m->bucket[b], memory_order_relaxed);
+      if (!c) continue;
+      if (put(out, cap, &n, "%s[%llu,%u]", first ? "" : ",",
+              (unsigned long long)metrics_bucket_le(b), (unsigned)c) < 0) return -1;
+      first = 0;
+    }
+    if (put(out, cap, &n, "]}") < 0) return -1;
+  }
+  if (put(out, cap, &n, "}}") < 0) return -1;
+  return (int)n;
+}
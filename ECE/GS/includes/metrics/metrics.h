@@ -0,0 +1,109 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ------------------------- Bridge metrics registry -------------------------
+// Fixed set of counters and latency histograms, declared once in the tables
+// below. Every update is a relaxed atomic add, so the UART reader thread and
+// the event loop can both count without locks; a snapshot is a plain read of
+// each cell (a histogram read mid-update is off by that one sample).
+//
+// Histograms are HDR-style log-linear: values below METRICS_SUB are exact,
+// above that every power of two is split into METRICS_SUB buckets (12.5 %
+// relative error), up to 2^32 us. A snapshot lists only non-empty buckets.
+//
+// Node asks for it with {"T":"METRICS"} on the UDS and gets
+//   {"type":"METRICS","counters":{...},"gauges":{...},
+//    "histograms":{"at_rtt_us":{"count":N,"sum":S,"max":M,"buckets":[[le,n],...]}}}
+
+#define METRICS_COUNTERS(X) \
+  X(uds_frames_in)                       /* Frames received from UDS clients */ \
+  X(uds_frames_out)                      /* Frames queued or written to clients */ \
+  X(uds_tx_drops)                        /* Frames dropped or evicted, client queue full */ \
+  X(uds_tx_coalesced)                    /* Telemetry frames replaced in place */ \
+  X(uds_tx_filtered)                     /* Broadcasts skipped for a client not subscribed */ \
+  X(ws_msgs_in)                          /* Messages from WebSocket UI clients (ws_server.h) */ \
+  X(parse_failures)                      /* JSON-looking frames that did not parse */ \
+  X(cmd_rejects)                         /* Commands refused for bad or missing fields */ \
+  X(decrypt_failures)                    /* UI ciphertext that failed GCM auth */ \
+  X(replay_drops)                        /* Sealed robot reports replayed or reflected */ \
+  X(uart_rx_bytes)                       /* Bytes read from the ESP32 UART */ \
+  X(uart_tx_bytes)                       /* Bytes written to the ESP32 UART */ \
+  X(at_commands)                         /* AT commands completed (any status) */ \
+  X(at_errors)                           /* ... answered ERROR / SEND FAIL */ \
+  X(at_timeouts)                         /* ... with no reply in time */ \
+  X(robot_words)                         /* Report words received from the robot */ \
+  X(prio_notifies)                       /* ... notifications of them on its priority characteristic */ \
+  X(state_hits)                          /* Queries answered by the bridge (robot_state.h) */ \
+  X(agg_reports)                         /* AGG windows published (report_agg.h) */ \
+  X(fec_recovered)                       /* Lost telemetry batches rebuilt (report_fec.h) */ \
+  X(fec_unrecovered)                     /* ... lost for good */ \
+  X(fec_stale)                           /* ... rebuilt words already superseded */ \
+  X(robot_metrics)                       /* Robot metrics snapshots forwarded (robot_metrics.h) */ \
+  X(tsdb_samples)                        /* Values kept by the telemetry store (tsdb.h) */ \
+  X(tsdb_evicted)                        /* ... blocks reused for newer history */ \
+  X(tx_stale_drops)                      /* Queued robot words too old to send */ \
+  X(expired_queued)                      /* Drive / arm words past their deadline in tx_sched (tx_sched.h) */ \
+  X(expired_retry)                       /* ... when their retry was due (ack_track.h) */ \
+  X(expired_robot)                       /* ... on the robot, reported by CMD_EXPIRED ACKs */ \
+  X(ble_link_drops)                      /* +BLEDISCONN URCs */ \
+  X(ble_reconnects)                      /* Link restored after failed attempts */ \
+  X(link_degrades)                       /* Link quality dropped a level (link_quality.h) */ \
+  X(link_recovers)                       /* ... climbed back one */ \
+  X(ack_retransmits)                     /* Unanswered words sent again (ack_track.h) */ \
+  X(ack_timeouts)                        /* ... given up after ACK_RETRY_MAX retries */ \
+  X(ack_superseded)                      /* Drive / arm words left unanswered for a newer one */ \
+  X(estops)                              /* E-stops written ahead of the queue (tx_sched.h) */ \
+  X(clock_syncs)                         /* Robot clock samples taken (clock_sync.h) */
+
+#define METRICS_HISTOGRAMS(X) \
+  X(at_rtt_us)                           /* AT command written -> final reply */ \
+  X(frame_us)                            /* UDS frame dispatch, parse through submit */ \
+  X(loop_lag_us)                         /* GS_JITTER probe: event loop wakeup lateness */ \
+  X(ack_rtt_us)                          /* Robot word written -> ACK, sent once */ \
+  X(cmd_delivery_us)                     /* First write -> ACK, retries included */ \
+  X(estop_us)                            /* E-stop submitted -> robot ACK */ \
+  X(clock_rtt_us)                        /* CLOCK_SYNC written -> ACK, robot hold removed */ \
+  X(tx_batch_words)                      /* Robot words per link write (tx_sched.h) */ \
+  X(tx_batch_wait_us)                    /* ... time a write was held for its batching window */ \
+  X(robot_ack_range_ids)                 /* Ids per robot ACK range (its adaptive ACK hold) */
+
+#define METRICS_COUNTER_ENUM(name) MC_##name,
+#define METRICS_HIST_ENUM(name)    MH_##name,
+typedef enum { METRICS_COUNTERS(METRICS_COUNTER_ENUM) MC_COUNT } metrics_counter_t;
+typedef enum { METRICS_HISTOGRAMS(METRICS_HIST_ENUM) MH_COUNT } metrics_hist_t;
+#undef METRICS_COUNTER_ENUM
+#undef METRICS_HIST_ENUM
+
+#define METRICS_SUB_BITS 3
+#define METRICS_SUB      (1u << METRICS_SUB_BITS)
+#define METRICS_BUCKETS  ((32 - METRICS_SUB_BITS + 1) * METRICS_SUB)
+
+typedef struct {
+  _Atomic uint64_t count, sum, max;
+  _Atomic uint32_t bucket[METRICS_BUCKETS];
+} metrics_histogram_t;
+
+extern _Atomic uint64_t    metrics_counters[MC_COUNT];
+extern metrics_histogram_t metrics_histograms[MH_COUNT];
+
+#define METRIC_ADD(name, n) \
+  atomic_fetch_add_explicit(&metrics_counters[MC_##name], (uint64_t)(n), memory_order_relaxed)
+#define METRIC_INC(name)    METRIC_ADD(name, 1)
+#define METRIC_OBSERVE(name, v) metrics_observe(MH_##name, (v))
+
+// Sampled by the caller at snapshot time (queue depths, ring drops, ...)
+typedef struct {
+  const char *name;
+  uint64_t    value;
+} metrics_gauge_t;
+
+uint64_t metrics_now_us(void);                            // CLOCK_MONOTONIC
+void     metrics_observe(metrics_hist_t h, uint64_t v);
+uint64_t metrics_bucket_le(unsigned idx);                 // Largest value in bucket idx
+int      metrics_json(char *out, size_t cap, const metrics_gauge_t *gauges, int n_gauges);
+
+#endif
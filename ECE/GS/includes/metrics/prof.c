@@ -0,0 +1,500 @@
+#define _GNU_SOURCE                                        // dladdr(), dl_iterate_phdr()
+#include "prof.h"
+#include "../log/gs_log.h"
+#include <dirent.h>
+#include <dlfcn.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
+#include <linux/perf_event.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#if (PROF_RING_PAGES & (PROF_RING_PAGES - 1)) != 0
+#error "PROF_RING_PAGES must be a power of two"
+#endif
+
+#define PROF_FDS      64                                   // Threads sampled at once
+#define PROF_RESCAN_MS 1000                                // New threads picked up within this
+#define PROF_THREADS  64                                   // Named threads; later ones share "other"
+#define PROF_NAME     16                                   // comm, as the kernel keeps it
+
+typedef struct {
+  uint64_t hash;                                           // 0 = free
+  uint32_t count;
+  uint8_t  thread, depth;
+  uint64_t pc[PROF_DEPTH];                                 // Leaf first
+} prof_stack_t;
+
+typedef struct {
+  pid_t tid;
+  char  name[PROF_NAME];
+} prof_thread_t;
+
+typedef struct {
+  pid_t   tid;
+  int     fd;
+  uint8_t seen;
+} prof_fd_t;
+
+static prof_fd_t        g_fd[PROF_FDS];                    // [0]: the main thread, owns the ring
+static int              g_nfd;
+static struct perf_event_attr g_attr;
+static struct perf_event_mmap_page *g_ring;
+static size_t           g_ring_len, g_data_len;
+static pthread_t        g_thread;
+static _Atomic int      g_stop;
+static int              g_on = 0;
+static int              g_hz;
+static const char      *g_event = "task-clock";
+
+static pthread_mutex_t  g_lock = PTHREAD_MUTEX_INITIALIZER;  // Table, threads and counts
+static prof_stack_t    *g_stacks;
+static int              g_nstacks;
+static prof_thread_t    g_threads[PROF_THREADS];
+static int              g_nthreads;
+static uint64_t         g_samples, g_lost, g_dropped, g_cpu_ns;
+
+// ------------------------- Sampling -------------------------
+
+static int perf_open(struct perf_event_attr *a, pid_t tid, int group) {
+  return (int)syscall(SYS_perf_event_open, a, tid, -1, group, PERF_FLAG_FD_CLOEXEC);
+}
+
+static void attr_init(struct perf_event_attr *a, int cycles) {
+  memset(a, 0, sizeof(*a));
+  a->size = sizeof(*a);
+  if (cycles) {
+    a->type = PERF_TYPE_HARDWARE;
+    a->config = PERF_COUNT_HW_CPU_CYCLES;
+    a->freq = 1;
+    a->sample_freq = (uint64_t)g_hz;
+  } else {
+    a->type = PERF_TYPE_SOFTWARE;
+    a->config = PERF_COUNT_SW_TASK_CLOCK;
+    a->sample_period = 1000000000ull / (uint64_t)g_hz;    // ns of the thread's own CPU time
+  }
+  a->sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN;
+  a->exclude_kernel = 1;
+  a->exclude_hv = 1;
+  a->exclude_callchain_kernel = 1;
+  a->sample_max_stack = PROF_DEPTH + 1;                    // Bounds the walk; +1 for PERF_CONTEXT_USER
+  a->watermark = 1;
+  a->wakeup_watermark = (uint32_t)(g_data_len / 2);
+}
+
+// One event per thread, every one writing to the main thread's ring. The
+// kernel will not map an inherited per-thread event, so threads started
+// later are attached by rescan() rather than through inheritance.
+static int attach(pid_t tid) {
+  if (g_nfd == PROF_FDS) return -1;
+  int fd = perf_open(&g_attr, tid, -1);
+  if (fd < 0) return -1;
+  if (g_nfd > 0 && ioctl(fd, PERF_EVENT_IOC_SET_OUTPUT, g_fd[0].fd) != 0) {
+    close(fd);
+    return -1;
+  }
+  g_fd[g_nfd++] = (prof_fd_t){ tid, fd, 1 };
+  return 0;
+}
+
+// Attach threads not seen before, close the events of threads gone
+static void rescan(void) {
+  DIR *d = opendir("/proc/self/task");
+  if (!d) return;
+  for (int i = 1; i < g_nfd; i++) g_fd[i].seen = 0;
+  struct dirent *e;
+  while ((e = readdir(d))) {
+    pid_t tid = (pid_t)atoi(e->d_name);
+    if (tid <= 0) continue;
+    int i = 0;
+    while (i < g_nfd && g_fd[i].tid != tid) i++;
+    if (i < g_nfd) g_fd[i].seen = 1;
+    else (void)attach(tid);                                // Failed: it exited already
+  }
+  closedir(d);
+  for (int i = 1; i < g_nfd; ) {
+    if (g_fd[i].seen) { i++; continue; }
+    close(g_fd[i].fd);
+    g_fd[i] = g_fd[--g_nfd];
+  }
+}
+
+static void close_all(void) {
+  if (g_ring) munmap(g_ring, g_ring_len);
+  for (int i = 0; i < g_nfd; i++) close(g_fd[i].fd);
+  g_ring = NULL;
+  g_nfd = 0;
+}
+
+static int open_main(int cycles) {
+  attr_init(&g_attr, cycles);
+  if (attach(getpid()) != 0) return -1;                    // The event itself is refused
+  g_ring = mmap(NULL, g_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED, g_fd[0].fd, 0);
+  if (g_ring == MAP_FAILED) {
+    int err = errno;
+    g_ring = NULL;
+    close_all();
+    errno = err;
+    return -1;
+  }
+  rescan();
+  return 0;
+}
+
+// ------------------------- Symbols -------------------------
+// The executable's own .symtab (static functions included, which dladdr
+// cannot see), read once from /proc/self/exe at start; shared libraries
+// go through dladdr.
+
+typedef struct {
+  uintptr_t   addr, size;
+  const char *name;
+} prof_sym_t;
+
+static prof_sym_t *g_syms;
+static int         g_nsyms = -1;                           // -1 = not loaded yet
+static uintptr_t   g_exe_base, g_exe_lo, g_exe_hi;
+
+static int exe_range(struct dl_phdr_info *info, size_t size, void *ctx) {
+  (void)size;
+  (void)ctx;
+  g_exe_base = info->dlpi_addr;                            // First object: the executable
+  for (int i = 0; i < info->dlpi_phnum; i++) {
+    const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+    if (ph->p_type != PT_LOAD) continue;
+    uintptr_t lo = info->dlpi_addr + ph->p_vaddr, hi = lo + ph->p_memsz;
+    if (!g_exe_lo || lo < g_exe_lo) g_exe_lo = lo;
+    if (hi > g_exe_hi) g_exe_hi = hi;
+  }
+  return 1;
+}
+
+static int sym_cmp(const void *a, const void *b) {
+  uintptr_t x = ((const prof_sym_t *)a)->addr, y = ((const prof_sym_t *)b)->addr;
+  return x < y ? -1 : x > y;
+}
+
+static void syms_load(void) {
+  g_nsyms = 0;
+  dl_iterate_phdr(exe_range, NULL);
+  int fd = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return;
+  struct stat st;
+  void *map = fstat(fd, &st) == 0 ? mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (map == MAP_FAILED) return;                           // Stays mapped: names point into it
+
+  const ElfW(Ehdr) *eh = map;
+  if ((size_t)st.st_size < sizeof(*eh) || memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 ||
+      eh->e_shoff + (size_t)eh->e_shnum * sizeof(ElfW(Shdr)) > (size_t)st.st_size) return;
+  const ElfW(Shdr) *sh = (const ElfW(Shdr) *)((const uint8_t *)map + eh->e_shoff);
+  const ElfW(Shdr) *symtab = NULL;
+  for (int i = 0; i < eh->e_shnum; i++) {
+    if (sh[i].sh_type == SHT_SYMTAB || (sh[i].sh_type == SHT_DYNSYM && !symtab)) symtab = &sh[i];
+  }
+  if (!symtab || symtab->sh_link >= eh->e_shnum) return;
+  const ElfW(Shdr) *strtab = &sh[symtab->sh_link];
+  const ElfW(Sym) *sym = (const ElfW(Sym) *)((const uint8_t *)map + symtab->sh_offset);
+  const char *str = (const char *)map + strtab->sh_offset;
+  size_t n = symtab->sh_size / sizeof(ElfW(Sym));
+
+  g_syms = calloc(n, sizeof(*g_syms));
+  if (!g_syms) return;
+  for (size_t i = 0; i < n; i++) {
+    if (ELF64_ST_TYPE(sym[i].st_info) != STT_FUNC || !sym[i].st_value || sym[i].st_name >= strtab->sh_size) continue;
+    g_syms[g_nsyms++] = (prof_sym_t){ g_exe_base + sym[i].st_value, sym[i].st_size, str + sym[i].st_name };
+  }
+  qsort(g_syms, (size_t)g_nsyms, sizeof(*g_syms), sym_cmp);
+}
+
+// Executable symbol covering pc, or NULL
+static const prof_sym_t *sym_find(uintptr_t pc) {
+  if (pc < g_exe_lo || pc >= g_exe_hi) return NULL;
+  int lo = 0, hi = g_nsyms;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (g_syms[mid].addr <= pc) lo = mid + 1;
+    else hi = mid;
+  }
+  if (lo == 0) return NULL;
+  const prof_sym_t *y = &g_syms[lo - 1];
+  return pc < y->addr + y->size || !y->size ? y : NULL;
+}
+
+// Start of the function holding pc, so every sample in one function counts
+// as one frame; pc itself when nothing covers it
+static uintptr_t sym_start(uintptr_t pc) {
+  static uintptr_t cache[256][2];                          // Library pcs: dladdr() is a walk of every object
+  if (pc >= g_exe_lo && pc < g_exe_hi) {
+    const prof_sym_t *y = sym_find(pc);
+    return y ? y->addr : pc;
+  }
+  uintptr_t *c = cache[(pc >> 2) & 255];
+  if (c[0] == pc) return c[1];
+  Dl_info di;
+  c[0] = pc;
+  c[1] = dladdr((void *)pc, &di) && di.dli_saddr ? (uintptr_t)di.dli_saddr : pc;
+  return c[1];
+}
+
+// Folded-format frame name: no ';', spaces or JSON escapes
+static int sym_name(uintptr_t pc, char *out, size_t cap) {
+  const prof_sym_t *y = sym_find(pc);
+  const char *name = y ? y->name : NULL;
+  char tmp[128];
+  Dl_info di;
+  if (!name && dladdr((void *)pc, &di) && di.dli_fname) {
+    if (di.dli_sname) {
+      name = di.dli_sname;
+    } else {
+      const char *base = strrchr(di.dli_fname, '/');
+      snprintf(tmp, sizeof(tmp), "[%s+0x%lx]", base ? base + 1 : di.dli_fname,
+               (unsigned long)(pc - (uintptr_t)di.dli_fbase));
+      name = tmp;
+    }
+  }
+  if (!name) {
+    snprintf(tmp, sizeof(tmp), "[0x%lx]", (unsigned long)pc);
+    name = tmp;
+  }
+  size_t n = 0;
+  for (; name[n] && n + 1 < cap; n++) {
+    char ch = name[n];
+    out[n] = (ch == ';' || ch == ' ' || ch == '"' || ch == '\\' || (unsigned char)ch < 0x20) ? '_' : ch;
+  }
+  out[n] = '\0';
+  return (int)n;
+}
+
+// ------------------------- Aggregation -------------------------
+
+static int thread_slot(pid_t tid) {
+  for (int i = 0; i < g_nthreads; i++) {
+    if (g_threads[i].tid == tid) return i;
+  }
+  if (g_nthreads == PROF_THREADS) return PROF_THREADS - 1;  // Last slot stands for the rest
+  prof_thread_t *t = &g_threads[g_nthreads];
+  t->tid = tid;
+  snprintf(t->name, sizeof(t->name), "tid-%d", (int)tid);
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/self/task/%d/comm", (int)tid);
+  FILE *f = fopen(path, "r");
+  if (f) {
+    if (fgets(t->name, sizeof(t->name), f)) t->name[strcspn(t->name, "\n")] = '\0';
+    fclose(f);
+  }
+  if (g_nthreads == PROF_THREADS - 1) snprintf(t->name, sizeof(t->name), "other");
+  return g_nthreads++;
+}
+
+static uint64_t stack_hash(uint8_t thread, const uint64_t *pc, int n) {
+  uint64_t h = 0xcbf29ce484222325ull ^ thread;
+  for (int i = 0; i < n; i++) h = (h ^ pc[i]) * 0x100000001b3ull;
+  return h | 1;
+}
+
+static void count_stack(pid_t tid, const uint64_t *chain, uint64_t nr) {
+  uint64_t pc[PROF_DEPTH];
+  int n = 0;
+  for (uint64_t i = 0; i < nr && n < PROF_DEPTH; i++) {
+    if (chain[i] >= (uint64_t)PERF_CONTEXT_MAX) continue;  // PERF_CONTEXT_USER and friends
+    pc[n] = sym_start((uintptr_t)chain[i] - (n > 0));      // Return address -> its call -> the function
+    n++;
+  }
+  if (n == 0) return;
+
+  uint8_t thread = (uint8_t)thread_slot(tid);
+  uint64_t h = stack_hash(thread, pc, n);
+  g_samples++;
+  for (int probe = 0, i = (int)(h % PROF_STACKS); probe < PROF_STACKS; probe++, i = (i + 1) % PROF_STACKS) {
+    prof_stack_t *s = &g_stacks[i];
+    if (s->hash == 0) {
+      if (g_nstacks >= PROF_STACKS * 3 / 4) break;         // Full enough: keep probes short
+      s->hash = h;
+      s->count = 1;
+      s->thread = thread;
+      s->depth = (uint8_t)n;
+      memcpy(s->pc, pc, (size_t)n * sizeof(pc[0]));
+      g_nstacks++;
+      return;
+    }
+    if (s->hash == h && s->thread == thread && s->depth == n && memcmp(s->pc, pc, (size_t)n * sizeof(pc[0])) == 0) {
+      s->count++;
+      return;
+    }
+  }
+  g_dropped++;
+}
+
+// Every whole record in the ring; a record that wraps is copied out first
+static void drain(void) {
+  uint8_t *data = (uint8_t *)g_ring + g_ring->data_offset;
+  uint64_t head = __atomic_load_n(&g_ring->data_head, __ATOMIC_ACQUIRE);
+  uint64_t tail = g_ring->data_tail;
+  uint64_t rec[(sizeof(struct perf_event_header) + 16 + 8 * (PROF_DEPTH + 1)) / 8 + 8];
+
+  pthread_mutex_lock(&g_lock);
+  while (tail < head) {
+    size_t off = (size_t)(tail & (g_data_len - 1));
+    struct perf_event_header h;
+    memcpy(&h, data + off, sizeof(h));                     // The header never wraps (8-byte records)
+    if (h.size < sizeof(h)) break;
+    size_t first = g_data_len - off < h.size ? g_data_len - off : h.size;
+    if (h.size <= sizeof(rec)) {
+      memcpy(rec, data + off, first);
+      memcpy((uint8_t *)rec + first, data, h.size - first);
+      if (h.type == PERF_RECORD_SAMPLE && h.size >= sizeof(h) + 16) {
+        const uint32_t *ids = (const uint32_t *)((uint8_t *)rec + sizeof(h));   // pid, tid
+        const uint64_t *cc = (const uint64_t *)((uint8_t *)rec + sizeof(h) + 8);
+        uint64_t nr = cc[0];
+        if (sizeof(h) + 16 + nr * 8 <= h.size) count_stack((pid_t)ids[1], cc + 1, nr);
+      } else if (h.type == PERF_RECORD_LOST) {
+        g_lost += rec[2];                                  // header, id, lost
+      }
+    }
+    tail += h.size;
+  }
+  pthread_mutex_unlock(&g_lock);
+  __atomic_store_n(&g_ring->data_tail, tail, __ATOMIC_RELEASE);
+}
+
+static void *prof_main(void *arg) {
+  (void)arg;
+  struct pollfd p = { .fd = g_fd[0].fd, .events = POLLIN };
+  uint64_t rescan_ms = 0;
+  while (!atomic_load_explicit(&g_stop, memory_order_relaxed)) {
+    (void)poll(&p, 1, PROF_DRAIN_MS);                      // Half-full ring, or the drain period
+    drain();
+    if ((rescan_ms += PROF_DRAIN_MS) >= PROF_RESCAN_MS) {
+      rescan();
+      rescan_ms = 0;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    pthread_mutex_lock(&g_lock);
+    g_cpu_ns = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+    pthread_mutex_unlock(&g_lock);
+  }
+  return NULL;
+}
+
+int prof_start(void) {
+  const char *env = getenv("GS_PROF");
+  if (!env || !env[0] || strcmp(env, "0") == 0) return 0;
+  g_hz = atoi(env);
+  if (g_hz <= 1) g_hz = PROF_HZ;
+  const char *ev = getenv("GS_PROF_EVENT");
+  int cycles = ev && strcmp(ev, "cycles") == 0;
+
+  long page = sysconf(_SC_PAGESIZE);
+  g_data_len = (size_t)page * PROF_RING_PAGES;
+  g_ring_len = g_data_len + (size_t)page;                  // Control page + data
+  g_stacks = calloc(PROF_STACKS, sizeof(*g_stacks));
+  if (!g_stacks) return -1;
+
+  int rc = open_main(cycles);
+  if (rc != 0 && cycles) {
+    LOG_WARN("Profiler: no cycles event (%s), using task-clock", strerror(errno));
+    cycles = 0;
+    rc = open_main(0);
+  }
+  if (rc != 0) {
+    LOG_WARN("Profiler: perf_event_open failed (%s; perf_event_paranoid > 2?)", strerror(errno));
+    goto fail;
+  }
+  g_event = cycles ? "cycles" : "task-clock";
+  if (g_nsyms < 0) syms_load();
+
+  atomic_store(&g_stop, 0);
+  if (pthread_create(&g_thread, NULL, prof_main, NULL) != 0) goto fail;
+  g_on = 1;
+  LOG_INFO("Profiler: %s at %d Hz, {\"T\":\"PROF\"} for folded stacks", g_event, g_hz);
+  return 0;
+
+fail:
+  close_all();
+  free(g_stacks);
+  g_stacks = NULL;
+  return -1;
+}
+
+void prof_stop(void) {
+  if (!g_on) return;
+  g_on = 0;
+  atomic_store(&g_stop, 1);
+  pthread_join(g_thread, NULL);
+  close_all();
+  free(g_stacks);
+  g_stacks = NULL;
+}
+
+int prof_enabled(void) {
+  return g_on;
+}
+
+// ------------------------- Query -------------------------
+
+static int by_count(const void *a, const void *b) {
+  uint32_t x = g_stacks[*(const int *)a].count, y = g_stacks[*(const int *)b].count;
+  return x < y ? 1 : x > y ? -1 : 0;
+}
+
+int prof_folded_json(char *out, size_t cap, int reset) {
+  static int order[PROF_STACKS];
+  if (!g_on) return -1;
+
+  pthread_mutex_lock(&g_lock);
+  int k = 0;
+  for (int i = 0; i < PROF_STACKS; i++) {
+    if (g_stacks[i].hash) order[k++] = i;
+  }
+  qsort(order, (size_t)k, sizeof(order[0]), by_count);
+
+  int n = snprintf(out, cap,
+                   "{\"type\":\"PROF\",\"event\":\"%s\",\"hz\":%d,\"samples\":%llu,\"lost\":%llu,"
+                   "\"dropped\":%llu,\"stacks\":%d,\"agg_cpu_us\":%llu,\"folded\":\"",
+                   g_event, g_hz, (unsigned long long)g_samples, (unsigned long long)g_lost,
+                   (unsigned long long)g_dropped, k, (unsigned long long)(g_cpu_ns / 1000u));
+  int truncated = 0;
+  const size_t tail = 24;                                  // "\",\"truncated\":1}" and NUL
+  if (n < 0 || (size_t)n + tail > cap) {
+    pthread_mutex_unlock(&g_lock);
+    return -1;
+  }
+  char line[PROF_DEPTH * 96 + 64];
+  for (int i = 0; i < k && !truncated; i++) {
+    const prof_stack_t *s = &g_stacks[order[i]];
+    int m = snprintf(line, sizeof(line), "%s", g_threads[s->thread].name);
+    for (int f = s->depth - 1; f >= 0; f--) {              // Root to leaf
+      line[m++] = ';';
+      m += sym_name((uintptr_t)s->pc[f], line + m, sizeof(line) - (size_t)m - 32);
+    }
+    m += snprintf(line + m, sizeof(line) - (size_t)m, " %u\\n", s->count);
+    if ((size_t)(n + m) + tail > cap) truncated = 1;
+    else {
+      memcpy(out + n, line, (size_t)m);
+      n += m;
+    }
+  }
+  n += snprintf(out + n, cap - (size_t)n, truncated ? "\",\"truncated\":1}" : "\"}");
+
+  if (reset) {
+    memset(g_stacks, 0, PROF_STACKS * sizeof(*g_stacks));
+    g_nstacks = 0;
+    g_samples = g_lost = g_dropped = 0;
+  }
+  pthread_mutex_unlock(&g_lock);
+  return n;
+}
@@ -0,0 +1,64 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ------------------------- In-process sampling profiler -------------------------
+// GS_PROF=<hz> (or 1 for PROF_HZ) samples the bridge's own threads with
+// perf_event_open: thread CPU time (task-clock), or CPU cycles with
+// GS_PROF_EVENT=cycles where the board exposes a PMU. The kernel walks each
+// sampled user stack by frame pointers into one mmap'd ring shared by every
+// thread; a background thread drains it every PROF_DRAIN_MS and counts each
+// distinct stack in a fixed table. Nothing runs on the sampled threads but
+// the kernel's walk, a few microseconds a sample: at 99 Hz that is well
+// under 1 % of a busy core, and an idle thread is not sampled at all.
+//
+// The walk needs frame pointers: build with make PROF=1
+// (-fno-omit-frame-pointer). Without them each stack is the leaf alone.
+// Each thread has its own event; the drain thread attaches new threads
+// within a second of their start, so short-lived ones may go unsampled.
+// perf_event_paranoid <= 2 is enough (user space only, own process).
+//
+// Node (or socat) asks with {"T":"PROF"} on the UDS and gets
+//   {"type":"PROF","event":"task-clock","hz":99,"samples":N,"lost":N,
+//    "dropped":N,"stacks":N,"agg_cpu_us":N,"folded":"thread;outer;...;leaf N\n..."}
+// folded is flamegraph.pl / speedscope input, most frequent stacks first,
+// cut at the reply size ("truncated":1). "reset":1 clears the counts after
+// the reply, so each query covers the time since the last one.
+
+#ifndef PROF_HZ
+#define PROF_HZ        99                  // Off the 100 Hz timer beat
+#endif
+#ifndef PROF_DEPTH
+#define PROF_DEPTH     32                  // Frames kept per stack, leaf first
+#endif
+#ifndef PROF_STACKS
+#ifdef GS_LOWMEM
+#define PROF_STACKS    512
+#else
+#define PROF_STACKS    2048                // Distinct stacks; further ones count as dropped
+#endif
+#endif
+#ifndef PROF_RING_PAGES
+#define PROF_RING_PAGES 64                 // Sample ring, a power of two
+#endif
+#ifndef PROF_DRAIN_MS
+#define PROF_DRAIN_MS  100
+#endif
+#ifndef PROF_REPLY_MAX
+#ifdef GS_LOWMEM
+#define PROF_REPLY_MAX (48 * 1024)
+#else
+#define PROF_REPLY_MAX (256 * 1024)
+#endif
+#endif
+
+int  prof_start(void);                     // GS_PROF set: 0 started, -1 failed; unset: 0
+void prof_stop(void);
+int  prof_enabled(void);
+
+// The {"T":"PROF"} reply into out; -1 if it does not fit at all
+int  prof_folded_json(char *out, size_t cap, int reset);
+
+#endif
@@ -0,0 +1,160 @@
+#include "capture_merge.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define PPI_FIELD_BTLE 30006              // PPI-BTLE (ubertooth -c): version, channel, ...
+
+static uint64_t mono_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+// RF channel from the capture header when it has one: the same PDU on two
+// advertising channels is two transmissions, not a duplicate
+static uint32_t capture_channel(uint32_t linktype, const uint8_t *p, uint32_t len) {
+  if (linktype == LINKTYPE_BLUETOOTH_LE_PHDR && len >= 1) return p[0];
+  if (linktype == LINKTYPE_PPI && len >= 8) {
+    uint32_t hl = (uint32_t)(p[2] | p[3] << 8);
+    for (uint32_t off = 8; off + 4 <= hl && hl <= len; ) {
+      uint32_t type = (uint32_t)(p[off] | p[off + 1] << 8);
+      uint32_t flen = (uint32_t)(p[off + 2] | p[off + 3] << 8);
+      if (type == PPI_FIELD_BTLE && flen >= 3 && off + 4 + flen <= hl) return (uint32_t)(p[off + 5] | p[off + 6] << 8);
+      off += 4 + flen;
+    }
+  }
+  return 0xFFFFu;
+}
+
+// FNV-1a over channel + LL PDU (access address, header, payload); 0 = no PDU
+static uint32_t capture_hash(uint32_t linktype, const uint8_t *data, uint32_t len) {
+  const uint8_t *p = data;
+  uint32_t n = len;
+  if (!ble_ll_pdu(linktype, &p, &n)) return 0;
+  uint32_t pdu = 6u + p[5];
+  if (pdu < n) n = pdu;
+
+  uint32_t h = 2166136261u;
+  uint32_t ch = capture_channel(linktype, data, len);
+  h = (h ^ (ch & 0xFF)) * 16777619u;
+  h = (h ^ (ch >> 8)) * 16777619u;
+  for (uint32_t i = 0; i < n; i++) h = (h ^ p[i]) * 16777619u;
+  return h ? h : 1;
+}
+
+int capture_merge_init(capture_merge_t *cm, const char *const *paths, int n, uint64_t hold_us, uint64_t dedup_us) {
+  if (n < 1 || n > CAPTURE_MAX_SOURCES) return -1;
+  memset(cm, 0, sizeof(*cm));
+  cm->n_src = n;
+  cm->hold_us = hold_us ? hold_us : CAPTURE_HOLD_US;
+  cm->dedup_us = dedup_us ? dedup_us : CAPTURE_DEDUP_US;
+  for (int i = 0; i < n; i++) pcap_follow_init(&cm->src[i].pf, paths[i]);
+  return 0;
+}
+
+void capture_merge_close(capture_merge_t *cm) {
+  for (int i = 0; i < cm->n_src; i++) pcap_follow_close(&cm->src[i].pf);
+}
+
+// Heard by another dongle already: same PDU hash within dedup_us
+static int capture_is_dup(capture_merge_t *cm, const capture_rec_t *r) {
+  if (!r->hash) return 0;
+  uint32_t n = cm->n_recent < CAPTURE_RECENT ? cm->n_recent : CAPTURE_RECENT;
+  for (uint32_t i = 0; i < n; i++) {
+    uint64_t t = cm->recent[i].ts_us;
+    uint64_t d = t > r->ts_us ? t - r->ts_us : r->ts_us - t;
+    if (cm->recent[i].hash == r->hash && d <= cm->dedup_us) return 1;
+  }
+  return 0;
+}
+
+// Hands on the oldest queued record. 1 = one was taken (delivered or dropped).
+static int capture_take(capture_merge_t *cm, uint64_t now, int force, pcap_record_fn fn, void *ctx, int *delivered) {
+  capture_src_t *best = NULL;
+  int all_queued = 1;
+  for (int i = 0; i < cm->n_src; i++) {
+    capture_src_t *s = &cm->src[i];
+    if (s->head == s->tail) { all_queued = 0; continue; }
+    if (!best || s->q[s->head % CAPTURE_QUEUE].ts_us < best->q[best->head % CAPTURE_QUEUE].ts_us) best = s;
+  }
+  if (!best) return 0;
+
+  capture_rec_t *r = &best->q[best->head % CAPTURE_QUEUE];
+  if (!force && !all_queued && now - r->rx_us < cm->hold_us) return 0;  // A quiet source may still have older ones
+  best->head++;
+
+  if (capture_is_dup(cm, r)) { cm->dup++; return 1; }
+  if (r->hash) {
+    cm->recent[cm->n_recent % CAPTURE_RECENT].ts_us = r->ts_us;
+    cm->recent[cm->n_recent % CAPTURE_RECENT].hash = r->hash;
+    cm->n_recent++;
+  }
+  if (r->ts_us < cm->last_ts_us) cm->late++;
+  else cm->last_ts_us = r->ts_us;
+
+  pcap_record_t out = { ++cm->frame, r->ts_us, r->linktype, r->data, r->len };
+  fn(ctx, &out);
+  (*delivered)++;
+  return 1;
+}
+
+typedef struct {
+  capture_merge_t *cm;
+  capture_src_t   *src;
+  uint64_t         now;
+  pcap_record_fn   fn;
+  void            *ctx;
+  int              delivered;
+} capture_poll_t;
+
+static void capture_on_record(void *ctx, const pcap_record_t *rec) {
+  capture_poll_t *cp = (capture_poll_t *)ctx;
+  capture_merge_t *cm = cp->cm;
+  capture_src_t *s = cp->src;
+
+  s->records++;
+  if (rec->len > CAPTURE_REC_MAX) { cm->oversize++; return; }
+  while (s->tail - s->head >= CAPTURE_QUEUE) {        // Full: the merge can't wait for the others
+    cm->overflow++;
+    capture_take(cm, cp->now, 1, cp->fn, cp->ctx, &cp->delivered);
+  }
+
+  capture_rec_t *r = &s->q[s->tail % CAPTURE_QUEUE];
+  r->ts_us = rec->ts_us;
+  r->rx_us = cp->now;
+  r->linktype = rec->linktype;
+  r->len = rec->len;
+  memcpy(r->data, rec->data, rec->len);
+  r->hash = capture_hash(rec->linktype, r->data, r->len);
+  s->tail++;
+}
+
+// Reads a file at most as far as its queue can take (a record is at least
+// CAPTURE_REC_MIN bytes on file), merging between rounds, so catching up
+// with a long capture keeps the sources interleaved instead of forcing one
+// out ahead of the others
+int capture_merge_poll(capture_merge_t *cm, pcap_record_fn fn, void *ctx) {
+  capture_poll_t cp = { cm, NULL, mono_us(), fn, ctx, 0 };
+  for (int progress = 1; progress; ) {
+    progress = 0;
+    for (int i = 0; i < cm->n_src; i++) {
+      capture_src_t *s = &cm->src[i];
+      size_t room = CAPTURE_QUEUE - (s->tail - s->head);
+      if (room == 0) continue;
+      off_t before = s->pf.offset;
+      cp.src = s;
+      if (pcap_follow_poll_max(&s->pf, capture_on_record, &cp, room * CAPTURE_REC_MIN) < 0)
+        fprintf(stderr, "CAPTURE: %s is not a pcap/pcapng capture, waiting for a new one\n", s->pf.path);
+      if (s->pf.offset != before) progress = 1;
+    }
+    while (capture_take(cm, cp.now, 0, fn, ctx, &cp.delivered)) {}
+  }
+  return cp.delivered;
+}
+
+int capture_merge_flush(capture_merge_t *cm, pcap_record_fn fn, void *ctx) {
+  int delivered = 0;
+  while (capture_take(cm, mono_us(), 1, fn, ctx, &delivered)) {}
+  return delivered;
+}
@@ -0,0 +1,74 @@
+#ifndef CAPTURE_MERGE_H
+#define CAPTURE_MERGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pcap_ingest.h"
+
+// ------------------------- Multi-capture merge -------------------------
+// Several sniffers (one ubertooth-btle -f per dongle, each parked on another
+// advertising channel so a CONNECT_IND on any of them is caught, or nRF
+// sniffers) write one capture file each. Every file is followed with
+// pcap_follow_t; records are stamped with the monotonic clock as they are
+// read and queued per source. The merge hands them on in capture time
+// order: the earliest queued record goes out as soon as every source has
+// something queued, or once it has waited hold_us (a quiet or dead dongle
+// never stalls the stream for longer). k is small, so the merge takes the
+// minimum over the queue heads instead of keeping a heap.
+//
+// A packet two dongles both heard is passed on once: the link-layer PDU
+// (access address, header, payload; not the per-dongle capture header) is
+// hashed and a match within dedup_us of an already merged one is dropped.
+// BLE connection events are >= 7.5 ms apart, so a retransmission of the
+// same PDU is never mistaken for a duplicate. Records get fresh 1-based
+// frame numbers in merged order; the sources' linktypes may differ.
+
+#define CAPTURE_MAX_SOURCES 4
+#define CAPTURE_QUEUE       128            // Records queued per source (power of two)
+#define CAPTURE_REC_MAX     320            // Capture header + the longest LL PDU
+#define CAPTURE_REC_MIN     24             // Smallest record on file (pcap header + bare LL PDU)
+#define CAPTURE_RECENT      64             // Merged PDU hashes kept for dedup
+#define CAPTURE_HOLD_US     100000
+#define CAPTURE_DEDUP_US    1000
+
+typedef struct {
+  uint64_t ts_us;                          // Capture time
+  uint64_t rx_us;                          // Read from the file (CLOCK_MONOTONIC)
+  uint32_t hash;                           // LL PDU hash, 0 = not an LL packet
+  uint32_t linktype;
+  uint32_t len;
+  uint8_t  data[CAPTURE_REC_MAX];
+} capture_rec_t;
+
+typedef struct {
+  pcap_follow_t pf;
+  capture_rec_t q[CAPTURE_QUEUE];
+  uint32_t      head, tail;                // q[head % CAPTURE_QUEUE] is the oldest
+  uint64_t      records;                   // Read from the file
+} capture_src_t;
+
+typedef struct {
+  capture_src_t src[CAPTURE_MAX_SOURCES];
+  int           n_src;
+  uint64_t      hold_us;
+  uint64_t      dedup_us;
+  uint64_t      frame;                     // Merged records so far
+  uint64_t      last_ts_us;
+  struct { uint64_t ts_us; uint32_t hash; } recent[CAPTURE_RECENT];
+  uint32_t      n_recent;
+  uint64_t      dup;                       // Dropped as heard by another dongle
+  uint64_t      late;                      // Merged after a later record (beyond hold_us)
+  uint64_t      oversize;                  // Longer than CAPTURE_REC_MAX, dropped
+  uint64_t      overflow;                  // Forced out early by a full queue
+} capture_merge_t;
+
+// paths: n capture files (n <= CAPTURE_MAX_SOURCES); 0 hold/dedup = defaults
+int  capture_merge_init(capture_merge_t *cm, const char *const *paths, int n, uint64_t hold_us, uint64_t dedup_us);
+void capture_merge_close(capture_merge_t *cm);
+// Reads every file and delivers the records that are due. Returns how many
+// were delivered; a file that is not a capture is reported on stderr once.
+int  capture_merge_poll(capture_merge_t *cm, pcap_record_fn fn, void *ctx);
+// Everything still queued, in order (shutdown)
+int  capture_merge_flush(capture_merge_t *cm, pcap_record_fn fn, void *ctx);
+
+#endif
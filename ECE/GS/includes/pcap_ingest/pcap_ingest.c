@@ -0,0 +1,368 @@
+#include "pcap_ingest.h"
+#include "../cmd_parser/cmd_parser.h"
+#include "hex_codec.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PCAP_MAGIC_US    0xA1B2C3D4u
+#define PCAP_MAGIC_NS    0xA1B23C4Du
+#define PCAPNG_SHB       0x0A0D0D0Au
+#define PCAPNG_BOM       0x1A2B3C4Du
+#define PCAPNG_IDB       1u
+#define PCAPNG_PB        2u               // Obsolete packet block
+#define PCAPNG_SPB       3u
+#define PCAPNG_EPB       6u
+
+#define BLE_ADV_AA       0x8E89BED6u
+#define L2CAP_CID_ATT    0x0004
+
+static uint16_t rd16le(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+static uint32_t rd32le(const uint8_t *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+static uint32_t bswap32(uint32_t v) { return __builtin_bswap32(v); }
+
+// Field in file byte order (host is little-endian on every GS target)
+static uint32_t rd32(const pcap_follow_t *pf, const uint8_t *p) {
+  uint32_t v = rd32le(p);
+  return pf->swapped ? bswap32(v) : v;
+}
+static uint16_t rd16(const pcap_follow_t *pf, const uint8_t *p) {
+  uint16_t v = rd16le(p);
+  return pf->swapped ? (uint16_t)(v >> 8 | v << 8) : v;
+}
+
+// ------------------------- Capture follower -------------------------
+
+static void pcap_follow_reset(pcap_follow_t *pf) {
+  pf->offset   = 0;
+  pf->format   = 0;
+  pf->swapped  = 0;
+  pf->nsec     = 0;
+  pf->linktype = 0;
+  pf->n_ifaces = 0;
+  pf->frame    = 0;
+  pf->skip     = 0;
+  pf->len      = 0;
+}
+
+void pcap_follow_init(pcap_follow_t *pf, const char *path) {
+  pf->path = path;
+  pf->fd   = -1;
+  pf->ino  = 0;
+  pcap_follow_reset(pf);
+}
+
+void pcap_follow_close(pcap_follow_t *pf) {
+  if (pf->fd >= 0) close(pf->fd);
+  pf->fd = -1;
+}
+
+// (Re)open when the file first appears or was replaced/truncated by a new capture
+static int pcap_follow_check(pcap_follow_t *pf) {
+  struct stat st;
+  if (stat(pf->path, &st) != 0) return -1;
+  if (pf->fd >= 0 && st.st_ino == pf->ino && st.st_size >= pf->offset) return 0;
+
+  pcap_follow_close(pf);
+  pf->fd = open(pf->path, O_RDONLY | O_CLOEXEC);
+  if (pf->fd < 0) return -1;
+  pf->ino = st.st_ino;
+  pcap_follow_reset(pf);
+  return 0;
+}
+
+// pcapng timestamp units -> microseconds (if_tsresol: 10^-n, or 2^-n with bit 7)
+static uint64_t pcapng_ts_us(uint64_t ts, uint8_t resol) {
+  uint8_t n = resol & 0x7F;
+  if (resol & 0x80) {
+    if (n >= 64) return 0;
+    return (ts >> n) * 1000000u + (((ts & ((1ull << n) - 1)) * 1000000u) >> n);
+  }
+  uint64_t scale = 1;
+  if (n > 6) {
+    for (uint8_t i = 6; i < n; i++) scale *= 10;
+    return ts / scale;
+  }
+  for (uint8_t i = n; i < 6; i++) scale *= 10;
+  return ts * scale;
+}
+
+static void pcapng_add_iface(pcap_follow_t *pf, const uint8_t *b, uint32_t blen) {
+  if (pf->n_ifaces >= PCAP_MAX_IFACES) return;   // Packets on it are dropped below
+  int i = pf->n_ifaces++;
+  pf->if_linktype[i] = rd16(pf, b + 8);
+  pf->if_tsresol[i]  = 6;
+
+  // Options after linktype/reserved/snaplen: code, length, value padded to 4
+  uint32_t off = 16;
+  while (off + 4 <= blen - 4) {
+    uint16_t code = rd16(pf, b + off), olen = rd16(pf, b + off + 2);
+    if (code == 0 || off + 4 + olen > blen - 4) break;
+    if (code == 9 && olen >= 1) pf->if_tsresol[i] = b[off + 4];
+    off += 4 + ((olen + 3u) & ~3u);
+  }
+}
+
+static int pcap_emit(pcap_follow_t *pf, uint32_t iface, uint64_t ts_us, const uint8_t *data,
+                     uint32_t caplen, pcap_record_fn fn, void *ctx) {
+  pf->frame++;
+  if (pf->format == 2 && iface >= (uint32_t)pf->n_ifaces) return 0;
+  pcap_record_t rec = {
+    .frame    = pf->frame,
+    .ts_us    = ts_us,
+    .linktype = pf->format == 2 ? pf->if_linktype[iface] : pf->linktype,
+    .data     = data,
+    .len      = caplen,
+  };
+  fn(ctx, &rec);
+  return 1;
+}
+
+// One pcapng block at b (complete). Returns records delivered or -1.
+static int pcapng_block(pcap_follow_t *pf, const uint8_t *b, uint32_t blen, pcap_record_fn fn, void *ctx) {
+  uint32_t type = rd32(pf, b);
+  switch (type) {
+    case PCAPNG_SHB:
+      pf->n_ifaces = 0;                              // Interfaces are per section
+      return 0;
+    case PCAPNG_IDB:
+      if (blen >= 20) pcapng_add_iface(pf, b, blen);
+      return 0;
+    case PCAPNG_EPB: {
+      if (blen < 32) return -1;
+      uint32_t cap = rd32(pf, b + 20);
+      if (cap > blen - 32) return -1;
+      uint32_t iface = rd32(pf, b + 8);
+      uint64_t ts = (uint64_t)rd32(pf, b + 12) << 32 | rd32(pf, b + 16);
+      uint8_t resol = iface < (uint32_t)pf->n_ifaces ? pf->if_tsresol[iface] : 6;
+      return pcap_emit(pf, iface, pcapng_ts_us(ts, resol), b + 28, cap, fn, ctx);
+    }
+    case PCAPNG_SPB: {
+      if (blen < 16) return -1;
+      uint32_t cap = rd32(pf, b + 8);
+      if (cap > blen - 16) cap = blen - 16;          // Snaplen applied
+      return pcap_emit(pf, 0, 0, b + 12, cap, fn, ctx);
+    }
+    case PCAPNG_PB: {
+      if (blen < 32) return -1;
+      uint32_t cap = rd32(pf, b + 20);
+      if (cap > blen - 32) return -1;
+      uint32_t iface = rd16(pf, b + 8);
+      uint64_t ts = (uint64_t)rd32(pf, b + 12) << 32 | rd32(pf, b + 16);
+      uint8_t resol = iface < (uint32_t)pf->n_ifaces ? pf->if_tsresol[iface] : 6;
+      return pcap_emit(pf, iface, pcapng_ts_us(ts, resol), b + 28, cap, fn, ctx);
+    }
+    default:
+      return 0;                                      // Name resolution, stats, custom...
+  }
+}
+
+static int is_packet_block(const pcap_follow_t *pf, const uint8_t *b) {
+  uint32_t type = rd32(pf, b);
+  return type == PCAPNG_EPB || type == PCAPNG_SPB || type == PCAPNG_PB;
+}
+
+// Consume every complete record in buf; keeps the partial tail.
+static int pcap_parse(pcap_follow_t *pf, pcap_record_fn fn, void *ctx) {
+  size_t off = 0;
+  int n = 0;
+
+  if (pf->skip) {
+    size_t take = pf->skip < pf->len ? pf->skip : pf->len;
+    off += take;
+    pf->skip -= take;
+  }
+
+  for (;;) {
+    const uint8_t *p = pf->buf + off;
+    size_t avail = pf->len - off;
+
+    if (pf->format == 0) {
+      if (avail < 24) break;
+      uint32_t magic = rd32le(p);
+      if (magic == PCAPNG_SHB) {
+        uint32_t bom = rd32le(p + 8);
+        if (bom != PCAPNG_BOM && bswap32(bom) != PCAPNG_BOM) return -1;
+        pf->swapped = (bom != PCAPNG_BOM);
+        pf->format = 2;
+        continue;                                    // SHB is parsed as a block
+      }
+      if (magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS) {
+        pf->swapped = 0;
+      } else if (bswap32(magic) == PCAP_MAGIC_US || bswap32(magic) == PCAP_MAGIC_NS) {
+        pf->swapped = 1;
+        magic = bswap32(magic);
+      } else {
+        return -1;
+      }
+      pf->nsec     = (magic == PCAP_MAGIC_NS);
+      pf->linktype = rd32(pf, p + 20);
+      pf->format   = 1;
+      off += 24;
+      continue;
+    }
+
+    if (pf->format == 1) {
+      if (avail < 16) break;
+      uint32_t incl = rd32(pf, p + 8);
+      if (incl > PCAP_BUF_MAX - 16) {                // Can never fit the window
+        pf->frame++;
+        pf->skip = 16 + (size_t)incl;
+        size_t take = pf->skip < avail ? pf->skip : avail;
+        off += take;
+        pf->skip -= take;
+        continue;
+      }
+      if (avail < 16 + (size_t)incl) break;
+      uint64_t us = (uint64_t)rd32(pf, p) * 1000000u + rd32(pf, p + 4) / (pf->nsec ? 1000u : 1u);
+      n += pcap_emit(pf, 0, us, p + 16, incl, fn, ctx);
+      off += 16 + (size_t)incl;
+      continue;
+    }
+
+    if (avail < 12) break;
+    if (rd32le(p) == PCAPNG_SHB) {                   // A new section may flip byte order
+      uint32_t bom = rd32le(p + 8);
+      if (bom != PCAPNG_BOM && bswap32(bom) != PCAPNG_BOM) return -1;
+      pf->swapped = (bom != PCAPNG_BOM);
+    }
+    uint32_t blen = rd32(pf, p + 4);
+    if (blen < 12 || (blen & 3)) return -1;
+    if (blen > PCAP_BUF_MAX) {
+      if (is_packet_block(pf, p)) pf->frame++;
+      pf->skip = blen;
+      size_t take = pf->skip < avail ? pf->skip : avail;
+      off += take;
+      pf->skip -= take;
+      continue;
+    }
+    if (avail < blen) break;
+    int r = pcapng_block(pf, p, blen, fn, ctx);
+    if (r < 0) return -1;
+    n += r;
+    off += blen;
+  }
+
+  memmove(pf->buf, pf->buf + off, pf->len - off);
+  pf->len -= off;
+  return n;
+}
+
+int pcap_follow_poll(pcap_follow_t *pf, pcap_record_fn fn, void *ctx) {
+  return pcap_follow_poll_max(pf, fn, ctx, (size_t)-1);
+}
+
+int pcap_follow_poll_max(pcap_follow_t *pf, pcap_record_fn fn, void *ctx, size_t max_bytes) {
+  if (pcap_follow_check(pf) != 0) return 0;          // Not there (yet)
+  if (pf->format < 0) return 0;                      // Rejected; waits for a new file
+
+  int n = 0;
+  while (max_bytes > 0) {
+    size_t want = sizeof(pf->buf) - pf->len;
+    if (want > max_bytes) want = max_bytes;
+    ssize_t r = read(pf->fd, pf->buf + pf->len, want);
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    if (r == 0) break;                               // Caught up with the writer
+    pf->offset += r;
+    pf->len += (size_t)r;
+    max_bytes -= (size_t)r;
+
+    int c = pcap_parse(pf, fn, ctx);
+    if (c < 0) {
+      pf->format = -1;
+      return -1;
+    }
+    n += c;
+  }
+  return n;
+}
+
+// ------------------------- BLE ATT decode -------------------------
+
+int ble_ll_pdu(uint32_t linktype, const uint8_t **pp, uint32_t *plen) {
+  const uint8_t *p = *pp;
+  uint32_t len = *plen;
+  switch (linktype) {
+    case LINKTYPE_BLUETOOTH_LE_PHDR:
+      if (len < 10) return 0;
+      p += 10; len -= 10;                            // RF channel, signal, noise, ref AA, flags
+      break;
+    case LINKTYPE_PPI: {
+      if (len < 8) return 0;
+      uint16_t hl = rd16le(p + 2);
+      if (hl < 8 || hl > len || rd32le(p + 4) != LINKTYPE_BLUETOOTH_LE_LL) return 0;
+      p += hl; len -= hl;
+      break;
+    }
+    case LINKTYPE_BLUETOOTH_LE_LL:
+      break;
+    default:
+      return 0;
+  }
+  if (len < 6) return 0;
+  *pp = p;
+  *plen = len;
+  return 1;
+}
+
+int ble_att_decode(uint32_t linktype, const uint8_t *p, uint32_t len, att_event_t *ev) {
+  if (!ble_ll_pdu(linktype, &p, &len)) return 0;
+
+  // LL: access address, 2-byte header (LLID in bits 0-1, payload length), payload, CRC
+  uint32_t aa = rd32le(p);
+  if (aa == BLE_ADV_AA) return 0;
+  if ((p[4] & 0x03) != 0x02) return 0;               // Not the start of an L2CAP frame
+  uint8_t pdu_len = p[5];
+  if ((uint32_t)pdu_len + 6 > len || pdu_len < 7) return 0;
+
+  const uint8_t *l2 = p + 6;
+  uint16_t l2_len = rd16le(l2);
+  if (rd16le(l2 + 2) != L2CAP_CID_ATT || l2_len < 3 || (uint32_t)l2_len + 4 > pdu_len) return 0;
+
+  uint8_t op = l2[4];
+  if (op != ATT_WRITE_REQ && op != ATT_WRITE_CMD && op != ATT_NOTIFY && op != ATT_INDICATE) return 0;
+
+  ev->access_addr = aa;
+  ev->opcode      = op;
+  ev->handle      = rd16le(l2 + 5);
+  ev->value       = l2 + 7;
+  ev->value_len   = (uint16_t)(l2_len - 3);
+  return 1;
+}
+
+const char *att_opcode_name(uint8_t opcode) {
+  switch (opcode) {
+    case ATT_WRITE_REQ: return "Write Request";
+    case ATT_WRITE_CMD: return "Write Command";
+    case ATT_NOTIFY:    return "Handle Value Notification";
+    case ATT_INDICATE:  return "Handle Value Indication";
+    default:            return "ATT";
+  }
+}
+
+int sniff_value_words(const uint8_t *v, size_t n, robot_bt_packet_t *words, int max) {
+  if (max < 1) return 0;
+  if (n == 8) {
+    memcpy(words[0].bytes, v, 8);
+    return 1;
+  }
+  if (n == 9 && v[0] == ROBOT_WORD_TAG) {
+    memcpy(words[0].bytes, v + 1, 8);
+    return 1;
+  }
+  if (n >= 2 && v[0] == ROBOT_BATCH_MAGIC) {
+    int k = v[1];
+    if (k < 1 || k > ROBOT_BATCH_MAX || k > max || n != 2 + (size_t)k * 8) return 0;
+    for (int i = 0; i < k; i++) memcpy(words[i].bytes, v + 2 + i * 8, 8);
+    return k;
+  }
+  if (n == 16 && hexc_decode((const char *)v, 16, words[0].bytes) == 8) return 1;
+  return 0;
+}
@@ -0,0 +1,90 @@
+#ifndef PCAP_INGEST_H
+#define PCAP_INGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "../cmd_structure.h"
+
+// ------------------------- Capture follower -------------------------
+// Follows a capture file that another process (ubertooth-btle) is still
+// appending to. Every poll reads only the bytes written since the last one
+// and hands each complete record on, so a session costs O(bytes) in total
+// and no record is ever seen twice. Classic pcap and pcapng are accepted;
+// a partial record at the tail waits for the next poll. If the file is
+// replaced or truncated (capture restarted) it is followed from the start.
+
+#define PCAP_BUF_MAX      65536           // Read window; larger records are skipped
+#define PCAP_MAX_IFACES   8               // pcapng interfaces per section
+
+typedef struct {
+  uint64_t       frame;                   // 1-based packet number (tshark frame.number)
+  uint64_t       ts_us;                   // Capture time, microseconds
+  uint32_t       linktype;                // LINKTYPE_* of the record
+  const uint8_t *data;
+  uint32_t       len;
+} pcap_record_t;
+
+typedef void (*pcap_record_fn)(void *ctx, const pcap_record_t *rec);
+
+typedef struct {
+  const char *path;
+  int         fd;                         // -1 until the file exists
+  ino_t       ino;
+  off_t       offset;                     // Bytes read so far
+  int         format;                     // 0 = not known yet, 1 = pcap, 2 = pcapng, -1 = bad
+  int         swapped;                    // File byte order differs from ours
+  int         nsec;                       // Classic pcap with nanosecond stamps
+  uint32_t    linktype;                   // Classic pcap
+  uint32_t    if_linktype[PCAP_MAX_IFACES];
+  uint8_t     if_tsresol[PCAP_MAX_IFACES];
+  int         n_ifaces;
+  uint64_t    frame;
+  size_t      skip;                       // Bytes left of an oversized record
+  size_t      len;                        // Unparsed bytes in buf
+  uint8_t     buf[PCAP_BUF_MAX];
+} pcap_follow_t;
+
+void pcap_follow_init(pcap_follow_t *pf, const char *path);
+void pcap_follow_close(pcap_follow_t *pf);
+// Records delivered (0 when the file is missing or nothing new). -1 once when the
+// file turns out not to be a capture; it is then ignored until replaced.
+int  pcap_follow_poll(pcap_follow_t *pf, pcap_record_fn fn, void *ctx);
+// The same, reading at most max_bytes of the file (the rest waits for the next call)
+int  pcap_follow_poll_max(pcap_follow_t *pf, pcap_record_fn fn, void *ctx, size_t max_bytes);
+
+// ------------------------- BLE ATT decode -------------------------
+// One BLE link-layer data PDU carrying an unfragmented ATT PDU. Link types:
+// LE_LL_WITH_PHDR (ubertooth -q, Wireshark exports), PPI (ubertooth -c)
+// and bare LE_LL.
+
+#define LINKTYPE_PPI               192
+#define LINKTYPE_BLUETOOTH_LE_LL   251
+#define LINKTYPE_BLUETOOTH_LE_PHDR 256
+
+#define ATT_WRITE_REQ   0x12
+#define ATT_WRITE_CMD   0x52
+#define ATT_NOTIFY      0x1B
+#define ATT_INDICATE    0x1D
+
+typedef struct {
+  uint32_t       access_addr;
+  uint8_t        opcode;                  // ATT_* above
+  uint16_t       handle;
+  const uint8_t *value;
+  uint16_t       value_len;
+} att_event_t;
+
+// Strips the capture header: *p / *len then cover the LL packet from its
+// access address on (at least 6 bytes). 0 = not a BLE LL record.
+int ble_ll_pdu(uint32_t linktype, const uint8_t **p, uint32_t *len);
+// 1 = ev holds an ATT write/notify/indication, 0 = anything else
+int ble_att_decode(uint32_t linktype, const uint8_t *p, uint32_t len, att_event_t *ev);
+const char *att_opcode_name(uint8_t opcode);
+
+// Robot words in a characteristic value, in the GS notify/write shapes:
+// 8 raw bytes, 16 hex chars, tagged word or plain batch (cmd_parser.h).
+// Returns the number of words, 0 for anything else (e.g. ciphertext).
+int sniff_value_words(const uint8_t *v, size_t n, robot_bt_packet_t *words, int max);
+
+#endif
@@ -0,0 +1,406 @@
+#include "pq_write.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef GS_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#define PQ_MAGIC      "PAR1"
+#define PQ_CREATED_BY "gs_recexport version 1.0.0"
+#define PQ_ZSTD_LEVEL 3
+
+// parquet.thrift enums
+enum { T_BOOLEAN = 0, T_INT32 = 1, T_INT64 = 2, T_BYTE_ARRAY = 6 };
+enum { REP_REQUIRED = 0, REP_OPTIONAL = 1 };
+enum { CONV_UTF8 = 0, CONV_TIMESTAMP_MICROS = 10 };
+enum { ENC_PLAIN = 0, ENC_RLE = 3 };
+enum { CODEC_UNCOMPRESSED = 0, CODEC_ZSTD = 6 };
+enum { PAGE_DATA = 0 };
+
+// Thrift compact protocol field / element types
+enum { TC_TRUE = 1, TC_FALSE = 2, TC_I32 = 5, TC_I64 = 6, TC_BINARY = 8, TC_LIST = 9, TC_STRUCT = 12 };
+
+typedef struct {
+  uint8_t *p;
+  size_t   len, cap;
+  int      err;
+} pq_buf_t;
+
+typedef struct {
+  uint64_t off;                             // Page header in the file
+  uint64_t usize, csize;                    // Header + page, before / after compression
+  uint64_t values, nulls;
+  int64_t  min, max;
+  int      have_stats, codec;
+} pq_chunk_t;
+
+typedef struct {
+  pq_buf_t vals;                            // PLAIN values (PQ_BOOL: one byte each until the page)
+  uint8_t *defs;                            // Nullable columns: 1 = value, 0 = null, per row
+  uint32_t n, nulls;
+  int64_t  min, max;
+  int      have;
+} pq_colbuf_t;
+
+struct pq_file {
+  FILE           *fp;
+  const pq_col_t *cols;
+  int             ncols;
+  uint32_t        group_rows, rows;
+  uint64_t        total_rows, off;
+  pq_colbuf_t    *cb;
+  pq_chunk_t     *chunks;                   // groups x ncols
+  uint32_t       *group_n;                  // Rows of each group
+  uint32_t        groups, groups_cap;
+  pq_buf_t        page, comp, tc;
+  int             err;
+};
+
+// ------------------------- Buffers -------------------------
+
+static int buf_need(pq_buf_t *b, size_t n) {
+  if (b->len + n <= b->cap) return 0;
+  size_t cap = b->cap ? b->cap : 4096;
+  while (cap < b->len + n) cap *= 2;
+  uint8_t *p = realloc(b->p, cap);
+  if (!p) { b->err = 1; return -1; }
+  b->p = p;
+  b->cap = cap;
+  return 0;
+}
+
+static void buf_put(pq_buf_t *b, const void *p, size_t n) {
+  if (buf_need(b, n) != 0) return;
+  memcpy(b->p + b->len, p, n);
+  b->len += n;
+}
+
+static void buf_byte(pq_buf_t *b, uint8_t v) { buf_put(b, &v, 1); }
+
+static void buf_le(pq_buf_t *b, uint64_t v, int bytes) {
+  uint8_t le[8];
+  for (int i = 0; i < bytes; i++) le[i] = (uint8_t)(v >> (8 * i));
+  buf_put(b, le, (size_t)bytes);
+}
+
+static void buf_varint(pq_buf_t *b, uint64_t v) {
+  while (v >= 0x80) { buf_byte(b, (uint8_t)(v | 0x80)); v >>= 7; }
+  buf_byte(b, (uint8_t)v);
+}
+
+// ------------------------- Thrift compact protocol -------------------------
+// Field ids go as deltas from the previous one in the same struct, so every
+// struct keeps its last id; nesting is at most four deep here.
+
+typedef struct {
+  pq_buf_t *b;
+  int16_t   last[8];
+  int       depth;
+} tc_t;
+
+static uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+
+static void tc_field(tc_t *t, int type, int16_t id) {
+  int16_t delta = (int16_t)(id - t->last[t->depth]);
+  if (delta > 0 && delta <= 15) buf_byte(t->b, (uint8_t)(delta << 4 | type));
+  else { buf_byte(t->b, (uint8_t)type); buf_varint(t->b, zigzag(id)); }
+  t->last[t->depth] = id;
+}
+
+static void tc_i32(tc_t *t, int16_t id, int32_t v) { tc_field(t, TC_I32, id); buf_varint(t->b, zigzag(v)); }
+static void tc_i64(tc_t *t, int16_t id, int64_t v) { tc_field(t, TC_I64, id); buf_varint(t->b, zigzag(v)); }
+
+static void tc_bin(tc_t *t, int16_t id, const void *p, size_t n) {
+  tc_field(t, TC_BINARY, id);
+  buf_varint(t->b, n);
+  buf_put(t->b, p, n);
+}
+
+static void tc_list(tc_t *t, int16_t id, int elem, size_t n) {
+  tc_field(t, TC_LIST, id);
+  if (n < 15) buf_byte(t->b, (uint8_t)(n << 4 | (size_t)elem));
+  else { buf_byte(t->b, (uint8_t)(0xF0 | elem)); buf_varint(t->b, n); }
+}
+
+static void tc_begin(tc_t *t) { t->last[++t->depth] = 0; }              // List element struct
+static void tc_struct(tc_t *t, int16_t id) { tc_field(t, TC_STRUCT, id); tc_begin(t); }
+static void tc_end(tc_t *t) { buf_byte(t->b, 0); t->depth--; }
+
+// ------------------------- Row groups -------------------------
+
+static int col_parquet_type(const pq_col_t *c) {
+  switch (c->type) {
+    case PQ_BOOL:  return T_BOOLEAN;
+    case PQ_INT32: return T_INT32;
+    case PQ_INT64: return T_INT64;
+    default:       return T_BYTE_ARRAY;
+  }
+}
+
+static void f_write(pq_file_t *f, const void *p, size_t n) {
+  if (n && fwrite(p, 1, n, f->fp) != n) f->err = 1;
+  f->off += n;
+}
+
+// Definition levels of a page: RLE runs (bit width 1), after their length
+static void page_defs(pq_buf_t *b, const uint8_t *defs, uint32_t n) {
+  size_t at = b->len;
+  buf_le(b, 0, 4);
+  for (uint32_t i = 0; i < n;) {
+    uint32_t j = i;
+    while (j < n && defs[j] == defs[i]) j++;
+    buf_varint(b, (uint64_t)(j - i) << 1);
+    buf_byte(b, defs[i]);
+    i = j;
+  }
+  if (b->err) return;
+  uint32_t len = (uint32_t)(b->len - at - 4);
+  for (int i = 0; i < 4; i++) b->p[at + (size_t)i] = (uint8_t)(len >> (8 * i));
+}
+
+static void flush_column(pq_file_t *f, int col, pq_chunk_t *ch) {
+  const pq_col_t *c = &f->cols[col];
+  pq_colbuf_t *cb = &f->cb[col];
+  pq_buf_t *page = &f->page;
+
+  page->len = 0;
+  if (c->nullable) page_defs(page, cb->defs, cb->n);
+  if (c->type == PQ_BOOL) {                                // LSB first, 8 per byte
+    size_t vals = cb->vals.len;
+    if (buf_need(page, (vals + 7) / 8) == 0) {
+      memset(page->p + page->len, 0, (vals + 7) / 8);
+      for (size_t i = 0; i < vals; i++)
+        if (cb->vals.p[i]) page->p[page->len + i / 8] |= (uint8_t)(1u << (i % 8));
+      page->len += (vals + 7) / 8;
+    }
+  } else {
+    buf_put(page, cb->vals.p, cb->vals.len);
+  }
+
+  const uint8_t *body = page->p;
+  size_t usize = page->len, csize = page->len;
+  ch->codec = CODEC_UNCOMPRESSED;
+#ifdef GS_WITH_ZSTD
+  size_t bound = ZSTD_compressBound(usize);
+  f->comp.len = 0;
+  if (buf_need(&f->comp, bound) == 0) {
+    size_t n = ZSTD_compress(f->comp.p, bound, page->p, usize, PQ_ZSTD_LEVEL);
+    if (!ZSTD_isError(n)) {
+      body = f->comp.p;
+      csize = n;
+      ch->codec = CODEC_ZSTD;
+    }
+  }
+#endif
+
+  f->tc.len = 0;
+  tc_t t = { .b = &f->tc };
+  tc_i32(&t, 1, PAGE_DATA);
+  tc_i32(&t, 2, (int32_t)usize);
+  tc_i32(&t, 3, (int32_t)csize);
+  tc_struct(&t, 5);                                        // DataPageHeader
+  tc_i32(&t, 1, (int32_t)cb->n);
+  tc_i32(&t, 2, ENC_PLAIN);
+  tc_i32(&t, 3, ENC_RLE);
+  tc_i32(&t, 4, ENC_RLE);
+  tc_end(&t);
+  buf_byte(&f->tc, 0);
+  if (page->err || f->tc.err) f->err = 1;
+
+  ch->off        = f->off;
+  ch->usize      = f->tc.len + usize;
+  ch->csize      = f->tc.len + csize;
+  ch->values     = cb->n;
+  ch->nulls      = cb->nulls;
+  ch->min        = cb->min;
+  ch->max        = cb->max;
+  ch->have_stats = cb->have;
+  f_write(f, f->tc.p, f->tc.len);
+  f_write(f, body, csize);
+
+  if (cb->vals.err) f->err = 1;
+  cb->vals.len = 0;
+  cb->n = cb->nulls = 0;
+  cb->have = 0;
+}
+
+static int flush_group(pq_file_t *f) {
+  if (!f->rows) return f->err ? -1 : 0;
+  if (f->groups == f->groups_cap) {
+    uint32_t cap = f->groups_cap ? f->groups_cap * 2 : 16;
+    pq_chunk_t *chunks = realloc(f->chunks, (size_t)cap * (size_t)f->ncols * sizeof(*chunks));
+    if (chunks) f->chunks = chunks;
+    uint32_t *group_n = realloc(f->group_n, (size_t)cap * sizeof(*group_n));
+    if (group_n) f->group_n = group_n;
+    if (!chunks || !group_n) { f->err = 1; return -1; }
+    f->groups_cap = cap;
+  }
+  for (int c = 0; c < f->ncols; c++) flush_column(f, c, &f->chunks[(size_t)f->groups * (size_t)f->ncols + (size_t)c]);
+  f->group_n[f->groups++] = f->rows;
+  f->rows = 0;
+  return f->err ? -1 : 0;
+}
+
+// ------------------------- API -------------------------
+
+pq_file_t *pq_open(const char *path, const pq_col_t *cols, int ncols, uint32_t group_rows) {
+  pq_file_t *f = calloc(1, sizeof(*f));
+  if (!f) return NULL;
+  f->cols = cols;
+  f->ncols = ncols;
+  f->group_rows = group_rows ? group_rows : PQ_GROUP_ROWS;
+  f->cb = calloc((size_t)ncols, sizeof(*f->cb));
+  if (!f->cb) { free(f); return NULL; }
+  for (int c = 0; c < ncols; c++) {
+    if (cols[c].nullable && !(f->cb[c].defs = malloc(f->group_rows))) { pq_close(f); errno = ENOMEM; return NULL; }
+  }
+  f->fp = fopen(path, "wb");
+  if (!f->fp) { int e = errno; pq_close(f); errno = e; return NULL; }
+  f_write(f, PQ_MAGIC, 4);
+  return f;
+}
+
+void pq_int(pq_file_t *f, int col, int64_t v) {
+  pq_colbuf_t *cb = &f->cb[col];
+  const pq_col_t *c = &f->cols[col];
+  if (cb->n > f->rows) return;                             // Already set in this row
+  if (c->nullable) cb->defs[cb->n] = 1;
+  if (c->type == PQ_BOOL) buf_byte(&cb->vals, v != 0);
+  else buf_le(&cb->vals, (uint64_t)v, c->type == PQ_INT32 ? 4 : 8);
+  if (c->type != PQ_BOOL) {
+    if (!cb->have || v < cb->min) cb->min = v;
+    if (!cb->have || v > cb->max) cb->max = v;
+    cb->have = 1;
+  }
+  cb->n++;
+}
+
+void pq_bytes(pq_file_t *f, int col, const void *p, size_t n) {
+  pq_colbuf_t *cb = &f->cb[col];
+  if (cb->n > f->rows) return;
+  if (f->cols[col].nullable) cb->defs[cb->n] = 1;
+  buf_le(&cb->vals, n, 4);
+  buf_put(&cb->vals, p, n);
+  cb->n++;
+}
+
+int pq_row(pq_file_t *f) {
+  for (int c = 0; c < f->ncols; c++) {
+    pq_colbuf_t *cb = &f->cb[c];
+    if (cb->n > f->rows) continue;
+    if (f->cols[c].nullable) {
+      cb->defs[cb->n++] = 0;
+      cb->nulls++;
+    } else if (f->cols[c].type == PQ_BYTES) {
+      pq_bytes(f, c, NULL, 0);
+    } else {
+      pq_int(f, c, 0);
+    }
+  }
+  f->total_rows++;
+  if (++f->rows == f->group_rows) return flush_group(f);
+  return f->err ? -1 : 0;
+}
+
+uint64_t pq_rows(const pq_file_t *f) {
+  return f->total_rows;
+}
+
+static void footer(pq_file_t *f) {
+  pq_buf_t *b = &f->tc;
+  b->len = 0;
+  tc_t t = { .b = b };
+  tc_i32(&t, 1, 1);                                        // version
+  tc_list(&t, 2, TC_STRUCT, (size_t)f->ncols + 1);         // schema: the root, then the columns
+  tc_begin(&t);
+  tc_bin(&t, 4, "schema", 6);
+  tc_i32(&t, 5, f->ncols);
+  tc_end(&t);
+  for (int c = 0; c < f->ncols; c++) {
+    const pq_col_t *col = &f->cols[c];
+    tc_begin(&t);
+    tc_i32(&t, 1, col_parquet_type(col));
+    tc_i32(&t, 3, col->nullable ? REP_OPTIONAL : REP_REQUIRED);
+    tc_bin(&t, 4, col->name, strlen(col->name));
+    if (col->conv == PQ_CONV_UTF8) tc_i32(&t, 6, CONV_UTF8);
+    else if (col->conv == PQ_CONV_TS_MICROS) tc_i32(&t, 6, CONV_TIMESTAMP_MICROS);
+    tc_end(&t);
+  }
+  tc_i64(&t, 3, (int64_t)f->total_rows);
+  tc_list(&t, 4, TC_STRUCT, f->groups);                    // row_groups
+  for (uint32_t g = 0; g < f->groups; g++) {
+    uint64_t bytes = 0;
+    tc_begin(&t);
+    tc_list(&t, 1, TC_STRUCT, (size_t)f->ncols);
+    for (int c = 0; c < f->ncols; c++) {
+      const pq_col_t *col = &f->cols[c];
+      const pq_chunk_t *ch = &f->chunks[(size_t)g * (size_t)f->ncols + (size_t)c];
+      bytes += ch->usize;
+      tc_begin(&t);                                        // ColumnChunk
+      tc_i64(&t, 2, (int64_t)ch->off);
+      tc_struct(&t, 3);                                    // ColumnMetaData
+      tc_i32(&t, 1, col_parquet_type(col));
+      tc_list(&t, 2, TC_I32, 2);
+      buf_varint(b, zigzag(ENC_PLAIN));
+      buf_varint(b, zigzag(ENC_RLE));
+      tc_list(&t, 3, TC_BINARY, 1);
+      buf_varint(b, strlen(col->name));
+      buf_put(b, col->name, strlen(col->name));
+      tc_i32(&t, 4, ch->codec);
+      tc_i64(&t, 5, (int64_t)ch->values);
+      tc_i64(&t, 6, (int64_t)ch->usize);
+      tc_i64(&t, 7, (int64_t)ch->csize);
+      tc_i64(&t, 9, (int64_t)ch->off);
+      tc_struct(&t, 12);                                   // Statistics
+      tc_i64(&t, 3, (int64_t)ch->nulls);
+      if (ch->have_stats) {
+        uint8_t mn[8], mx[8];
+        int n = col->type == PQ_INT32 ? 4 : 8;
+        for (int i = 0; i < n; i++) {
+          mn[i] = (uint8_t)((uint64_t)ch->min >> (8 * i));
+          mx[i] = (uint8_t)((uint64_t)ch->max >> (8 * i));
+        }
+        tc_bin(&t, 5, mx, (size_t)n);
+        tc_bin(&t, 6, mn, (size_t)n);
+      }
+      tc_end(&t);
+      tc_end(&t);
+      tc_end(&t);
+    }
+    tc_i64(&t, 2, (int64_t)bytes);
+    tc_i64(&t, 3, f->group_n[g]);
+    tc_end(&t);
+  }
+  tc_bin(&t, 6, PQ_CREATED_BY, strlen(PQ_CREATED_BY));
+  buf_byte(b, 0);
+  if (b->err) f->err = 1;
+
+  f_write(f, b->p, b->len);
+  uint8_t le[4];
+  for (int i = 0; i < 4; i++) le[i] = (uint8_t)(b->len >> (8 * i));
+  f_write(f, le, 4);
+  f_write(f, PQ_MAGIC, 4);
+}
+
+int pq_close(pq_file_t *f) {
+  if (f->fp) {
+    flush_group(f);
+    footer(f);
+    if (fclose(f->fp) != 0) f->err = 1;
+  }
+  int rc = f->err ? -1 : 0;
+  for (int c = 0; c < f->ncols && f->cb; c++) {
+    free(f->cb[c].vals.p);
+    free(f->cb[c].defs);
+  }
+  free(f->cb);
+  free(f->chunks);
+  free(f->group_n);
+  free(f->page.p);
+  free(f->comp.p);
+  free(f->tc.p);
+  free(f);
+  return rc;
+}
@@ -0,0 +1,46 @@
+#ifndef PQ_WRITE_H
+#define PQ_WRITE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ------------------------- Parquet writer -------------------------
+// Just enough of Apache Parquet for flat tables of integers, booleans and
+// byte strings, so recordings export (gs_recexport.c) without Arrow or a
+// Thrift runtime on the board: PLAIN values, RLE definition levels for
+// nullable columns, one data page per column per row group, min / max and
+// null counts on integer columns (DuckDB and pyarrow skip row groups on
+// them), and the footer in Thrift's compact protocol, written by hand.
+//
+// Rows are appended column by column into buffers; every group_rows rows
+// they go out as one row group and the buffers are reused, so a writer
+// holds one row group however long the file gets. Pages are zstd-
+// compressed in builds with ZSTD=1, else stored.
+
+#define PQ_GROUP_ROWS 65536                 // Default rows per row group
+
+enum { PQ_BOOL, PQ_INT32, PQ_INT64, PQ_BYTES };
+enum { PQ_CONV_NONE, PQ_CONV_UTF8, PQ_CONV_TS_MICROS };
+
+typedef struct {
+  const char *name;
+  uint8_t     type;                         // PQ_BOOL ...
+  uint8_t     nullable;
+  uint8_t     conv;                         // PQ_CONV_*: how readers present it
+} pq_col_t;
+
+typedef struct pq_file pq_file_t;
+
+// cols must outlive the writer; NULL with errno set on failure
+pq_file_t *pq_open(const char *path, const pq_col_t *cols, int ncols, uint32_t group_rows);
+
+// One value per column and row, then pq_row(); a column left out of a row
+// is null (nullable) or 0 / empty
+void pq_int(pq_file_t *f, int col, int64_t v);                 // PQ_BOOL, PQ_INT32, PQ_INT64
+void pq_bytes(pq_file_t *f, int col, const void *p, size_t n); // PQ_BYTES
+int  pq_row(pq_file_t *f);                                     // 0 ok, -1 write failed
+uint64_t pq_rows(const pq_file_t *f);
+
+int  pq_close(pq_file_t *f);                // Last row group and the footer; 0 ok, -1 the file is unusable
+
+#endif
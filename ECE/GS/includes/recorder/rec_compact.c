@@ -0,0 +1,444 @@
+#include "rec_compact.h"
+#include "rec_segment.h"
+#include "recorder.h"
+#include "gs_log.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef GS_WITH_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+static pthread_t        g_thread;
+static int              g_on;
+static atomic_int       g_stop;
+static _Atomic uint64_t g_sealed, g_lapped;
+
+static char     g_dir[256];
+static uint64_t g_seg_bytes, g_seg_ns, g_keep_bytes;
+static int      g_level;
+static rec_reader_t g_r;
+
+// Segment being written (thread only)
+static int              g_fd = -1;
+static char             g_part[336];
+static rec_seg_block_t *g_index;
+static uint32_t         g_blocks, g_index_cap;
+static uint64_t         g_off, g_seg_raw, g_seg_items, g_seg_first, g_seg_last, g_seg_opened;
+
+// Block being filled
+static uint8_t  g_raw[REC_SEG_BLOCK];
+static size_t   g_raw_len;
+static uint32_t g_items;
+static uint64_t g_t_first, g_t_last;
+
+#ifdef GS_WITH_ZSTD
+static ZSTD_CCtx  *g_cctx;
+static ZSTD_CDict *g_cdict;
+static uint32_t    g_dict_id;
+static uint8_t    *g_comp;
+static size_t      g_comp_cap;
+static uint8_t    *g_samples;                // Training input while there is no dictionary
+static size_t     *g_sample_sizes;
+static size_t      g_sample_len;
+static unsigned    g_nsamples;
+#endif
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t env_u64(const char *name, uint64_t dflt) {
+  const char *v = getenv(name);
+  return v && v[0] ? strtoull(v, NULL, 10) : dflt;
+}
+
+static int write_all(int fd, const struct iovec *iov, int n) {
+  struct iovec v[4];
+  memcpy(v, iov, (size_t)n * sizeof(*iov));
+  while (n) {
+    ssize_t k = writev(fd, v, n);
+    if (k < 0 && errno == EINTR) continue;
+    if (k <= 0) return -1;
+    while (n && (size_t)k >= v[0].iov_len) { k -= (ssize_t)v[0].iov_len; memmove(v, v + 1, (size_t)--n * sizeof(*v)); }
+    if (n) { v[0].iov_base = (uint8_t *)v[0].iov_base + k; v[0].iov_len -= (size_t)k; }
+  }
+  return 0;
+}
+
+// Keeps at most GS_RECORD_KEEP_MB of sealed segments, deleting the oldest
+static void retention(void) {
+  char **paths;
+  int n = rec_seg_list(g_dir, &paths);
+  if (n <= 0 || !g_keep_bytes) { if (n >= 0) rec_seg_list_free(paths, n); return; }
+  uint64_t total = 0, *sizes = calloc((size_t)n, sizeof(*sizes));
+  if (!sizes) { rec_seg_list_free(paths, n); return; }
+  for (int i = 0; i < n; i++) {
+    struct stat st;
+    size_t len = strlen(paths[i]);
+    if (len > 4 && strcmp(paths[i] + len - 4, ".seg") == 0 && stat(paths[i], &st) == 0) sizes[i] = (uint64_t)st.st_size;
+    total += sizes[i];
+  }
+  for (int i = 0; i < n - 1 && total > g_keep_bytes; i++) {  // Never the newest
+    if (!sizes[i] || unlink(paths[i]) != 0) continue;
+    total -= sizes[i];
+    LOG_INFO("Recorder: dropped %s (GS_RECORD_KEEP_MB)", paths[i]);
+  }
+  free(sizes);
+  rec_seg_list_free(paths, n);
+}
+
+static void seg_abandon(const char *what) {
+  LOG_WARN("Recorder: %s %s: %s, segment closed", what, g_part, strerror(errno));
+  close(g_fd);
+  g_fd = -1;
+}
+
+static int seg_open(uint64_t t_first) {
+  const rec_hdr_t *h = g_r.hdr;
+  time_t sec = (time_t)((h->real_ns + (t_first - h->mono_ns)) / 1000000000u);
+  struct tm tm;
+  gmtime_r(&sec, &tm);
+  for (unsigned n = 0; n < 100 && g_fd < 0; n++) {         // Another run in the same second: next free <n>
+    char sealed[320];
+    int len = snprintf(sealed, sizeof(sealed), "%s/rec-%04d%02d%02d-%02d%02d%02d-%u.seg", g_dir, tm.tm_year + 1900,
+                       tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, n);
+    if (len < 0 || (size_t)len >= sizeof(sealed)) return -1;
+    if (access(sealed, F_OK) == 0) continue;
+    snprintf(g_part, sizeof(g_part), "%s.part", sealed);
+    g_fd = open(g_part, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (g_fd < 0 && errno != EEXIST) break;
+  }
+  if (g_fd < 0) {
+    LOG_WARN("Recorder: no segment in %s: %s", g_dir, strerror(errno));
+    return -1;
+  }
+
+  rec_seg_hdr_t sh = {0};
+  memcpy(sh.magic, REC_SEG_MAGIC, sizeof(REC_SEG_MAGIC));
+  sh.hdr_size = sizeof(sh);
+  sh.version  = 1;
+  sh.mono_ns  = h->mono_ns;
+  sh.real_ns  = h->real_ns;
+  struct iovec v = { &sh, sizeof(sh) };
+  if (write_all(g_fd, &v, 1) != 0) { seg_abandon("writing"); return -1; }
+  g_off = sizeof(sh);
+  g_blocks = 0;
+  g_seg_raw = g_seg_items = g_seg_first = g_seg_last = 0;
+  g_seg_opened = now_ns();
+  return 0;
+}
+
+// Index, trailer, fsync, then the rename that makes it a .seg
+static void seg_seal(void) {
+  if (g_fd < 0) return;
+  rec_seg_trailer_t tr = {0};
+  tr.index_off = g_off;
+  tr.blocks    = g_blocks;
+  tr.items     = g_seg_items;
+  tr.t_first   = g_seg_first;
+  tr.t_last    = g_seg_last;
+  memcpy(tr.magic, REC_SEG_TRAILER, sizeof(REC_SEG_TRAILER));
+  struct iovec v[2] = { { g_index, (size_t)g_blocks * sizeof(*g_index) }, { &tr, sizeof(tr) } };
+  if (write_all(g_fd, v, 2) != 0 || fsync(g_fd) != 0) { seg_abandon("sealing"); return; }
+  close(g_fd);
+  g_fd = -1;
+
+  char sealed[320];
+  snprintf(sealed, sizeof(sealed), "%.*s", (int)(strlen(g_part) - 5), g_part);
+  if (rename(g_part, sealed) != 0) {
+    LOG_WARN("Recorder: could not seal %s: %s", g_part, strerror(errno));
+    return;
+  }
+  atomic_fetch_add_explicit(&g_sealed, 1, memory_order_relaxed);
+  retention();
+}
+
+static void block_flush(void) {
+  if (!g_items) return;
+  if (g_fd < 0 && seg_open(g_t_first) != 0) {
+    g_raw_len = 0;                                         // Dropped; the ring still has it
+    g_items = 0;
+    return;
+  }
+  rec_seg_block_t b = {0};
+  memcpy(b.magic, REC_SEG_BLOCK_MAGIC, sizeof(b.magic));
+  b.codec    = REC_CODEC_RAW;
+  b.raw_len  = (uint32_t)g_raw_len;
+  b.comp_len = (uint32_t)g_raw_len;
+  b.items    = g_items;
+  b.t_first  = g_t_first;
+  b.t_last   = g_t_last;
+  b.offset   = g_off;
+  const void *out = g_raw;
+#ifdef GS_WITH_ZSTD
+  if (g_cctx) {
+    size_t n = g_cdict ? ZSTD_compress_usingCDict(g_cctx, g_comp, g_comp_cap, g_raw, g_raw_len, g_cdict)
+                       : ZSTD_compressCCtx(g_cctx, g_comp, g_comp_cap, g_raw, g_raw_len, g_level);
+    if (!ZSTD_isError(n) && n < g_raw_len) {
+      b.codec    = REC_CODEC_ZSTD;
+      b.comp_len = (uint32_t)n;
+      b.dict_id  = g_cdict ? g_dict_id : 0;
+      out = g_comp;
+    }
+  }
+#endif
+  if (g_blocks == g_index_cap) {
+    uint32_t cap = g_index_cap ? g_index_cap * 2 : 256;
+    rec_seg_block_t *grown = realloc(g_index, (size_t)cap * sizeof(*g_index));
+    if (!grown) { errno = ENOMEM; seg_abandon("indexing"); g_raw_len = 0; g_items = 0; return; }
+    g_index = grown;
+    g_index_cap = cap;
+  }
+  struct iovec v[2] = { { &b, sizeof(b) }, { (void *)out, b.comp_len } };
+  if (write_all(g_fd, v, 2) != 0) {
+    seg_abandon("writing");
+    g_raw_len = 0;
+    g_items = 0;
+    return;
+  }
+  g_index[g_blocks++] = b;
+  g_off += sizeof(b) + b.comp_len;
+  if (!g_seg_items || g_t_first < g_seg_first) g_seg_first = g_t_first;
+  if (g_t_last > g_seg_last) g_seg_last = g_t_last;
+  g_seg_raw   += g_raw_len;
+  g_seg_items += g_items;
+  g_raw_len = 0;
+  g_items = 0;
+  if (g_seg_raw >= g_seg_bytes || now_ns() - g_seg_opened >= g_seg_ns) seg_seal();
+}
+
+#ifdef GS_WITH_ZSTD
+static int dict_use(const void *dict, size_t len) {
+  g_cdict = ZSTD_createCDict(dict, len, g_level);
+  g_dict_id = ZSTD_getDictID_fromDict(dict, len);
+  if (g_cdict && g_dict_id) return 0;
+  ZSTD_freeCDict(g_cdict);
+  g_cdict = NULL;
+  return -1;
+}
+
+// The newest rec-*.dict of the directory, from an earlier run
+static int dict_load(void) {
+  DIR *d = opendir(g_dir);
+  if (!d) return -1;
+  char best[600] = "";
+  time_t best_t = 0;
+  for (struct dirent *e; (e = readdir(d));) {
+    size_t n = strlen(e->d_name);
+    if (strncmp(e->d_name, "rec-", 4) != 0 || n < 9 || strcmp(e->d_name + n - 5, ".dict") != 0) continue;
+    char path[600];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s", g_dir, e->d_name);
+    if (stat(path, &st) == 0 && (!best[0] || st.st_mtime > best_t)) {
+      snprintf(best, sizeof(best), "%s", path);
+      best_t = st.st_mtime;
+    }
+  }
+  closedir(d);
+  if (!best[0]) return -1;
+
+  uint8_t buf[REC_DICT_BYTES * 2];
+  int fd = open(best, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+  ssize_t n = read(fd, buf, sizeof(buf));
+  close(fd);
+  if (n <= 0 || dict_use(buf, (size_t)n) != 0) {
+    LOG_WARN("Recorder: dictionary %s unusable, training a new one", best);
+    return -1;
+  }
+  LOG_INFO("Recorder: segments compressed with %s", best);
+  return 0;
+}
+
+static void dict_train(void) {
+  uint8_t dict[REC_DICT_BYTES];
+  size_t n = ZDICT_trainFromBuffer(dict, sizeof(dict), g_samples, g_sample_sizes, g_nsamples);
+  free(g_samples);
+  free(g_sample_sizes);
+  g_samples = NULL;
+  g_sample_sizes = NULL;
+  if (ZDICT_isError(n)) {
+    LOG_WARN("Recorder: no dictionary from %u items (%s), blocks compressed without", g_nsamples, ZDICT_getErrorName(n));
+    return;
+  }
+  if (dict_use(dict, n) != 0) return;
+
+  char path[600], tmp[620];
+  rec_seg_dict_path(path, sizeof(path), g_dir, g_dict_id);
+  snprintf(tmp, sizeof(tmp), "%s.part", path);
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  struct iovec v = { dict, n };
+  if (fd < 0 || write_all(fd, &v, 1) != 0 || fsync(fd) != 0 || rename(tmp, path) != 0) {
+    LOG_WARN("Recorder: could not write %s: %s, blocks compressed without", path, strerror(errno));
+    if (fd >= 0) { close(fd); unlink(tmp); }
+    ZSTD_freeCDict(g_cdict);
+    g_cdict = NULL;
+    return;
+  }
+  close(fd);
+  LOG_INFO("Recorder: trained %s (%zu bytes from %u items)", path, n, g_nsamples);
+}
+
+static void dict_sample(const uint8_t *item, size_t len) {
+  if (g_sample_len + len > REC_DICT_SAMPLE_BYTES) {
+    dict_train();
+    return;
+  }
+  memcpy(g_samples + g_sample_len, item, len);
+  g_sample_sizes[g_nsamples++] = len;
+  g_sample_len += len;
+}
+#endif
+
+static void item_add(const rec_item_t *it) {
+  size_t need = rec_seg_item_size(it->len);
+  if (g_raw_len + need > sizeof(g_raw)) block_flush();
+  rec_seg_item_t h = {
+    .kind = it->kind, .ch = it->ch, .flags = it->flags, .whole = (uint8_t)it->whole,
+    .total = it->total, .len = (uint16_t)it->len, .t_ns = it->t_ns,
+  };
+  memcpy(g_raw + g_raw_len, &h, sizeof(h));
+  memcpy(g_raw + g_raw_len + sizeof(h), it->data, it->len);
+#ifdef GS_WITH_ZSTD
+  if (g_samples) dict_sample(g_raw + g_raw_len, need);
+#endif
+  g_raw_len += need;
+  if (!g_items || it->t_ns < g_t_first) g_t_first = it->t_ns;
+  if (!g_items || it->t_ns > g_t_last) g_t_last = it->t_ns;
+  g_items++;
+}
+
+static void *compact_main(void *arg) {
+  (void)arg;
+  static rec_item_t it;
+  struct timespec poll = { 0, REC_COMPACT_POLL_MS * 1000000L };
+  for (;;) {
+    int stop = atomic_load(&g_stop);                       // Read first: the last pass drains what came before it
+    while (rec_reader_next(&g_r, &it) == 1) item_add(&it);
+    atomic_store_explicit(&g_lapped, g_r.skipped, memory_order_relaxed);
+    if (stop) break;
+    uint64_t now = now_ns();
+    if (g_items && now - g_t_first >= (uint64_t)REC_COMPACT_FLUSH_S * 1000000000u) block_flush();
+    if (g_fd >= 0 && now - g_seg_opened >= g_seg_ns) seg_seal();  // Quiet link: rotate by age all the same
+    nanosleep(&poll, NULL);
+  }
+  block_flush();
+  seg_seal();
+  return NULL;
+}
+
+// A .part left by a crash keeps what it had: renamed .seg, read without a trailer
+static void recover_parts(void) {
+  char **paths;
+  int n = rec_seg_list(g_dir, &paths);
+  if (n < 0) return;
+  for (int i = 0; i < n; i++) {
+    size_t len = strlen(paths[i]);
+    if (len < 5 || strcmp(paths[i] + len - 5, ".part") != 0) continue;
+    paths[i][len - 5] = '\0';
+    char part[520];
+    snprintf(part, sizeof(part), "%s.part", paths[i]);
+    if (rename(part, paths[i]) == 0) LOG_INFO("Recorder: kept %s from an unclean stop", paths[i]);
+  }
+  rec_seg_list_free(paths, n);
+}
+
+int rec_compact_start(void) {
+  const char *dir = getenv("GS_RECORD_DIR");
+  if (!(dir && dir[0]) || !rec_g || g_on) return -1;
+  if (snprintf(g_dir, sizeof(g_dir), "%s", dir) >= (int)sizeof(g_dir)) return -1;
+  if (mkdir(g_dir, 0755) != 0 && errno != EEXIST) {
+    LOG_WARN("Recorder: GS_RECORD_DIR=%s: %s, ring only", g_dir, strerror(errno));
+    return -1;
+  }
+  g_seg_bytes  = env_u64("GS_RECORD_SEG_MB", REC_SEG_DEFAULT_MB) << 20;
+  g_seg_ns     = env_u64("GS_RECORD_SEG_S", REC_SEG_DEFAULT_S) * 1000000000u;
+  g_keep_bytes = env_u64("GS_RECORD_KEEP_MB", REC_KEEP_DEFAULT_MB) << 20;
+  g_level      = (int)env_u64("GS_RECORD_LEVEL", REC_ZSTD_LEVEL);
+  if (!g_seg_bytes) g_seg_bytes = (uint64_t)REC_SEG_DEFAULT_MB << 20;
+  if (!g_seg_ns) g_seg_ns = (uint64_t)REC_SEG_DEFAULT_S * 1000000000u;
+  recover_parts();
+  if (rec_reader_live(&g_r) != 0) return -1;
+
+#ifdef GS_WITH_ZSTD
+  g_cctx = ZSTD_createCCtx();
+  g_comp_cap = ZSTD_compressBound(REC_SEG_BLOCK);
+  g_comp = malloc(g_comp_cap);
+  if (!g_cctx || !g_comp) {
+    ZSTD_freeCCtx(g_cctx);
+    free(g_comp);
+    g_cctx = NULL;
+    g_comp = NULL;
+  } else if (dict_load() != 0) {
+    g_samples = malloc(REC_DICT_SAMPLE_BYTES);
+    g_sample_sizes = malloc(REC_DICT_SAMPLE_BYTES / sizeof(rec_seg_item_t) * sizeof(size_t));
+    g_sample_len = 0;
+    g_nsamples = 0;
+    if (!g_samples || !g_sample_sizes) {
+      free(g_samples);
+      free(g_sample_sizes);
+      g_samples = NULL;
+      g_sample_sizes = NULL;
+    }
+  }
+#endif
+
+  atomic_store(&g_stop, 0);
+  if (pthread_create(&g_thread, NULL, compact_main, NULL) != 0) {
+    LOG_WARN("Recorder: compactor thread could not start, ring only");
+    return -1;
+  }
+  g_on = 1;
+#ifdef GS_WITH_ZSTD
+  const char *codec = g_cctx ? "zstd" : "raw";
+#else
+  const char *codec = "raw";
+#endif
+  LOG_INFO("Recorder: segments in %s (%s, %llu MiB / %llu s each, keep %llu MiB)", g_dir, codec,
+           (unsigned long long)(g_seg_bytes >> 20), (unsigned long long)(g_seg_ns / 1000000000u),
+           (unsigned long long)(g_keep_bytes >> 20));
+  return 0;
+}
+
+void rec_compact_stop(void) {
+  if (!g_on) return;
+  atomic_store(&g_stop, 1);
+  pthread_join(g_thread, NULL);
+  g_on = 0;
+  free(g_index);
+  g_index = NULL;
+  g_index_cap = 0;
+#ifdef GS_WITH_ZSTD
+  free(g_samples);
+  free(g_sample_sizes);
+  free(g_comp);
+  ZSTD_freeCDict(g_cdict);
+  ZSTD_freeCCtx(g_cctx);
+  g_samples = NULL;
+  g_sample_sizes = NULL;
+  g_comp = NULL;
+  g_cdict = NULL;
+  g_cctx = NULL;
+#endif
+}
+
+uint64_t rec_compact_segments(void) {
+  return atomic_load_explicit(&g_sealed, memory_order_relaxed);
+}
+
+uint64_t rec_compact_lapped(void) {
+  return atomic_load_explicit(&g_lapped, memory_order_relaxed);
+}
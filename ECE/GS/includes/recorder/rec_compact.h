@@ -0,0 +1,40 @@
+#ifndef REC_COMPACT_H
+#define REC_COMPACT_H
+
+#include <stdint.h>
+
+// ------------------------- Recorder compactor -------------------------
+// Background thread that follows this process's ring (rec_reader_live())
+// and copies its items into segments under GS_RECORD_DIR (rec_segment.h).
+// Appends stay what they were, a few stores into the ring, which also stays
+// the crash-safe copy of the last seconds; the thread looks at it every
+// REC_COMPACT_POLL_MS and packs what is new into REC_SEG_BLOCK blocks,
+// written once full or REC_COMPACT_FLUSH_S after their first item.
+//
+//   GS_RECORD_DIR=<dir>      where segments go (unset = ring only)
+//   GS_RECORD_SEG_MB=<n>     raw MiB of items per segment (default REC_SEG_DEFAULT_MB)
+//   GS_RECORD_SEG_S=<s>      and its age at most, in seconds (default REC_SEG_DEFAULT_S)
+//   GS_RECORD_KEEP_MB=<n>    sealed segments kept on disk, oldest deleted
+//                            first (default REC_KEEP_DEFAULT_MB, 0 = all)
+//   GS_RECORD_LEVEL=<n>      zstd level (default REC_ZSTD_LEVEL)
+//
+// Built with ZSTD=1, blocks are zstd-compressed with the directory's
+// dictionary, trained here once and reused by later runs. Slots a lap of
+// the ring overwrote before the thread copied them are counted
+// (rec_compact_lapped(), METRICS recorder_lapped): a bigger GS_RECORD_MB
+// is the fix. Started before rt_setup(), so it stays a normal, unpinned
+// thread like the log writer.
+
+#define REC_COMPACT_POLL_MS  50
+#define REC_COMPACT_FLUSH_S  2
+#define REC_SEG_DEFAULT_MB   64
+#define REC_SEG_DEFAULT_S    3600
+#define REC_KEEP_DEFAULT_MB  2048
+#define REC_ZSTD_LEVEL       3
+
+int  rec_compact_start(void);               // After rec_open; 0 = running, -1 = off or failed
+void rec_compact_stop(void);                // Copies what is left and seals; before rec_close
+uint64_t rec_compact_segments(void);        // Sealed since start
+uint64_t rec_compact_lapped(void);          // Ring slots lost to the segments
+
+#endif
@@ -0,0 +1,320 @@
+#include "rec_segment.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef GS_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#define REC_SEG_COMP_MAX (REC_SEG_BLOCK + REC_SEG_BLOCK / 2)  // Bigger than any block the compactor writes
+
+struct rec_seg_reader {
+  char           **files;                   // Segments in name (= time) order
+  int              nfiles, fi;              // fi: the one open, -1 = none yet
+  int              fd;
+  rec_seg_block_t *index;                   // Its blocks
+  uint32_t         blocks, bi;              // bi: next one to load
+  uint8_t         *raw, *comp;
+  size_t           raw_len, raw_pos;        // Block loaded, decompressed
+  uint64_t         from;                    // After a seek: items before this CLOCK_MONOTONIC skipped
+#ifdef GS_WITH_ZSTD
+  ZSTD_DCtx       *dctx;
+  ZSTD_DDict      *ddict;
+  uint32_t         ddict_id;
+#endif
+};
+
+static int pread_all(int fd, void *buf, size_t n, uint64_t off) {
+  uint8_t *p = buf;
+  while (n) {
+    ssize_t k = pread(fd, p, n, (off_t)off);
+    if (k <= 0) return -1;
+    p += k;
+    off += (uint64_t)k;
+    n -= (size_t)k;
+  }
+  return 0;
+}
+
+// Header and blocks of an open segment: from the trailer when it was
+// sealed, else by walking the block headers (a crash's leftover)
+static int seg_load(int fd, rec_seg_hdr_t *hdr, rec_seg_trailer_t *tr, rec_seg_block_t **index) {
+  struct stat st;
+  if (fstat(fd, &st) != 0) return -1;
+  uint64_t size = (uint64_t)st.st_size;
+  if (pread_all(fd, hdr, sizeof(*hdr), 0) != 0 || memcmp(hdr->magic, REC_SEG_MAGIC, sizeof(REC_SEG_MAGIC)) != 0 ||
+      hdr->hdr_size < sizeof(*hdr) || hdr->hdr_size > size)
+    return -2;
+  if (index) *index = NULL;
+
+  if (size >= hdr->hdr_size + sizeof(*tr) && pread_all(fd, tr, sizeof(*tr), size - sizeof(*tr)) == 0 &&
+      memcmp(tr->magic, REC_SEG_TRAILER, sizeof(REC_SEG_TRAILER)) == 0 && tr->index_off >= hdr->hdr_size &&
+      tr->index_off + (uint64_t)tr->blocks * sizeof(rec_seg_block_t) + sizeof(*tr) == size) {
+    if (!index || !tr->blocks) return 0;
+    *index = malloc((size_t)tr->blocks * sizeof(rec_seg_block_t));
+    if (!*index) return -1;
+    if (pread_all(fd, *index, (size_t)tr->blocks * sizeof(rec_seg_block_t), tr->index_off) != 0) {
+      free(*index);
+      *index = NULL;
+      return -1;
+    }
+    return 0;
+  }
+
+  memset(tr, 0, sizeof(*tr));
+  rec_seg_block_t b, *ix = NULL;
+  uint32_t cap = 0;
+  uint64_t off = hdr->hdr_size;
+  while (off + sizeof(b) <= size && pread_all(fd, &b, sizeof(b), off) == 0 &&
+         memcmp(b.magic, REC_SEG_BLOCK_MAGIC, sizeof(b.magic)) == 0 && off + sizeof(b) + b.comp_len <= size) {
+    b.offset = off;
+    if (index) {
+      if (tr->blocks == cap) {
+        cap = cap ? cap * 2 : 64;
+        rec_seg_block_t *grown = realloc(ix, (size_t)cap * sizeof(*ix));
+        if (!grown) { free(ix); return -1; }
+        ix = grown;
+      }
+      ix[tr->blocks] = b;
+    }
+    if (!tr->blocks || b.t_first < tr->t_first) tr->t_first = b.t_first;
+    if (b.t_last > tr->t_last) tr->t_last = b.t_last;
+    tr->blocks++;
+    tr->items += b.items;
+    off += sizeof(b) + b.comp_len;
+  }
+  tr->index_off = off;
+  if (index) *index = ix;
+  return 0;
+}
+
+int rec_seg_stat(const char *path, rec_seg_hdr_t *hdr, rec_seg_trailer_t *tr) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+  int rc = seg_load(fd, hdr, tr, NULL);
+  close(fd);
+  return rc;
+}
+
+static int seg_name(const struct dirent *d) {
+  size_t n = strlen(d->d_name);
+  if (strncmp(d->d_name, "rec-", 4) != 0) return 0;
+  return (n > 8 && strcmp(d->d_name + n - 4, ".seg") == 0) ||
+         (n > 13 && strcmp(d->d_name + n - 9, ".seg.part") == 0);
+}
+
+int rec_seg_list(const char *dir, char ***paths) {
+  struct dirent **names;
+  int n = scandir(dir, &names, seg_name, alphasort);
+  if (n < 0) return -1;
+  *paths = calloc((size_t)n + 1, sizeof(char *));
+  int kept = 0;
+  for (int i = 0; i < n; i++) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, names[i]->d_name);
+    if (*paths && ((*paths)[kept] = strdup(path))) kept++;
+    free(names[i]);
+  }
+  free(names);
+  return *paths ? kept : -1;
+}
+
+void rec_seg_list_free(char **paths, int n) {
+  for (int i = 0; i < n; i++) free(paths[i]);
+  free(paths);
+}
+
+void rec_seg_dict_path(char *buf, size_t n, const char *dir, uint32_t id) {
+  snprintf(buf, n, "%s/rec-%08x.dict", dir, (unsigned)id);
+}
+
+static void seg_file_close(struct rec_seg_reader *s) {
+  if (s->fd >= 0) close(s->fd);
+  free(s->index);
+  s->fd = -1;
+  s->index = NULL;
+  s->blocks = s->bi = 0;
+  s->raw_len = s->raw_pos = 0;
+}
+
+// Opens segment fi and points hdr at its clocks; -1 / -2 leave it closed
+// and next() moves on to the one after
+static int seg_file(rec_reader_t *r, int fi) {
+  struct rec_seg_reader *s = r->seg;
+  seg_file_close(s);
+  s->fi = fi;
+  if (fi >= s->nfiles) return -1;
+  s->fd = open(s->files[fi], O_RDONLY | O_CLOEXEC);
+  if (s->fd < 0) return -1;
+
+  rec_seg_hdr_t h;
+  rec_seg_trailer_t tr;
+  int rc = seg_load(s->fd, &h, &tr, &s->index);
+  if (rc != 0) {
+    seg_file_close(s);
+    return rc;
+  }
+  s->blocks = tr.blocks;
+  memcpy(r->seg_hdr.magic, REC_SEG_MAGIC, sizeof(r->seg_hdr.magic));
+  r->seg_hdr.hdr_size = h.hdr_size;
+  r->seg_hdr.mono_ns  = h.mono_ns;
+  r->seg_hdr.real_ns  = h.real_ns;
+  return 0;
+}
+
+#ifdef GS_WITH_ZSTD
+static int seg_dict(struct rec_seg_reader *s, uint32_t id) {
+  if (s->ddict && s->ddict_id == id) return 0;
+  char dir[512], path[600];
+  const char *file = s->files[s->fi], *slash = strrchr(file, '/');
+  if (slash) snprintf(dir, sizeof(dir), "%.*s", (int)(slash - file), file);
+  else snprintf(dir, sizeof(dir), ".");
+  rec_seg_dict_path(path, sizeof(path), dir, id);
+
+  uint8_t buf[REC_DICT_BYTES * 2];
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+  ssize_t n = read(fd, buf, sizeof(buf));
+  close(fd);
+  if (n <= 0) return -1;
+  ZSTD_freeDDict(s->ddict);
+  s->ddict = ZSTD_createDDict(buf, (size_t)n);
+  s->ddict_id = id;
+  return s->ddict ? 0 : -1;
+}
+#endif
+
+// One block into raw; -1 = unreadable, its items count as skipped
+static int seg_block(struct rec_seg_reader *s, const rec_seg_block_t *b) {
+  s->raw_len = s->raw_pos = 0;
+  if (memcmp(b->magic, REC_SEG_BLOCK_MAGIC, sizeof(b->magic)) != 0 ||
+      b->raw_len > REC_SEG_BLOCK || b->comp_len > REC_SEG_COMP_MAX)
+    return -1;
+  uint64_t off = b->offset + sizeof(*b);
+
+  if (b->codec == REC_CODEC_RAW) {
+    if (b->comp_len != b->raw_len || pread_all(s->fd, s->raw, b->raw_len, off) != 0) return -1;
+  } else if (b->codec == REC_CODEC_ZSTD) {
+#ifdef GS_WITH_ZSTD
+    if (!s->dctx || pread_all(s->fd, s->comp, b->comp_len, off) != 0) return -1;
+    if (b->dict_id && seg_dict(s, b->dict_id) != 0) return -1;
+    size_t n = b->dict_id ? ZSTD_decompress_usingDDict(s->dctx, s->raw, REC_SEG_BLOCK, s->comp, b->comp_len, s->ddict)
+                          : ZSTD_decompressDCtx(s->dctx, s->raw, REC_SEG_BLOCK, s->comp, b->comp_len);
+    if (ZSTD_isError(n) || n != b->raw_len) return -1;
+#else
+    return -1;                                             // Built without zstd
+#endif
+  } else {
+    return -1;
+  }
+  s->raw_len = b->raw_len;
+  return 0;
+}
+
+int rec_seg_open(rec_reader_t *r, const char *path, int dir) {
+  struct rec_seg_reader *s = calloc(1, sizeof(*s));
+  if (!s) return -1;
+  s->fd = -1;
+  s->fi = -1;
+  r->seg = s;
+  r->hdr = &r->seg_hdr;
+  s->raw = malloc(REC_SEG_BLOCK);
+  s->comp = malloc(REC_SEG_COMP_MAX);
+  if (!s->raw || !s->comp) { rec_seg_close(r); return -1; }
+#ifdef GS_WITH_ZSTD
+  s->dctx = ZSTD_createDCtx();
+#endif
+
+  if (dir) {
+    s->nfiles = rec_seg_list(path, &s->files);
+    if (s->nfiles < 0) { s->nfiles = 0; rec_seg_close(r); return -1; }
+  } else {
+    s->files = calloc(1, sizeof(char *));
+    if (!s->files || !(s->files[0] = strdup(path))) { rec_seg_close(r); return -1; }
+    s->nfiles = 1;
+  }
+  if (!s->nfiles) return 0;                                // Empty directory: nothing to read yet
+  int rc = seg_file(r, 0);
+  if (rc != 0 && !dir) { rec_seg_close(r); return rc; }
+  return 0;
+}
+
+int rec_seg_next(rec_reader_t *r, rec_item_t *it) {
+  struct rec_seg_reader *s = r->seg;
+  for (;;) {
+    if (s->raw_pos < s->raw_len) {
+      rec_seg_item_t h;
+      size_t left = s->raw_len - s->raw_pos;
+      if (left < sizeof(h)) { s->raw_pos = s->raw_len; r->skipped++; continue; }
+      memcpy(&h, s->raw + s->raw_pos, sizeof(h));
+      if (h.len > sizeof(it->data) || left - sizeof(h) < h.len) { s->raw_pos = s->raw_len; r->skipped++; continue; }
+      const uint8_t *d = s->raw + s->raw_pos + sizeof(h);
+      s->raw_pos += rec_seg_item_size(h.len);
+      if (h.t_ns < s->from) continue;
+      s->from = 0;
+      it->kind  = h.kind;
+      it->ch    = h.ch;
+      it->flags = h.flags;
+      it->whole = h.whole;
+      it->t_ns  = h.t_ns;
+      it->total = h.total;
+      it->len   = h.len;
+      memcpy(it->data, d, h.len);
+      return 1;
+    }
+    if (s->fd >= 0 && s->bi < s->blocks) {
+      const rec_seg_block_t *b = &s->index[s->bi++];
+      if (seg_block(s, b) != 0) r->skipped += b->items;
+      continue;
+    }
+    if (s->fi + 1 >= s->nfiles) return 0;
+    seg_file(r, s->fi + 1);
+  }
+}
+
+void rec_seg_rewind(rec_reader_t *r) {
+  struct rec_seg_reader *s = r->seg;
+  r->skipped = 0;
+  s->from = 0;
+  if (s->nfiles) seg_file(r, 0);
+}
+
+int rec_seg_seek(rec_reader_t *r, uint64_t real_ns) {
+  struct rec_seg_reader *s = r->seg;
+  r->skipped = 0;
+  s->from = 0;
+  for (int fi = 0; fi < s->nfiles; fi++) {                 // Trailers and indexes only, no block is read
+    if (seg_file(r, fi) != 0) continue;
+    uint64_t from = rec_mono_of(r->hdr, real_ns);
+    for (uint32_t b = 0; b < s->blocks; b++) {
+      if (s->index[b].t_last >= from) {
+        s->bi = b;
+        s->from = from;
+        return 0;
+      }
+    }
+  }
+  seg_file_close(s);
+  s->fi = s->nfiles;
+  return -1;
+}
+
+void rec_seg_close(rec_reader_t *r) {
+  struct rec_seg_reader *s = r->seg;
+  if (!s) return;
+  seg_file_close(s);
+  if (s->files) rec_seg_list_free(s->files, s->nfiles);
+#ifdef GS_WITH_ZSTD
+  ZSTD_freeDDict(s->ddict);
+  ZSTD_freeDCtx(s->dctx);
+#endif
+  free(s->raw);
+  free(s->comp);
+  free(s);
+  r->seg = NULL;
+  r->hdr = NULL;
+}
@@ -0,0 +1,114 @@
+#ifndef REC_SEGMENT_H
+#define REC_SEGMENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "recorder.h"
+
+// ------------------------- Recorder segments -------------------------
+// Long-term storage behind the flight recorder ring. With GS_RECORD_DIR set,
+// a compactor thread (rec_compact.h) follows the ring and copies its items
+// into segment files there, so the ring only has to hold the last few
+// seconds and the SD card keeps days of sessions.
+//
+// A segment is one file, <dir>/rec-YYYYMMDD-HHMMSS-<n>.seg (UTC time of its
+// first item, so names sort in time order), written append-only:
+//   header    rec_seg_hdr_t: the recording's clocks (as rec_hdr_t)
+//   blocks    rec_seg_block_t, then comp_len bytes: up to REC_SEG_BLOCK raw
+//             bytes of items, each a rec_seg_item_t and its data, compressed
+//             on their own (zstd, REC_CODEC_ZSTD) or stored (REC_CODEC_RAW)
+//   index     one rec_seg_block_t per block, offset set
+//   trailer   rec_seg_trailer_t: where the index is, the time range, totals
+// The segment being written is <name>.seg.part; sealing writes the index
+// and trailer, fsyncs and renames it. A .part left by a crash is renamed
+// .seg at the next start; with no trailer, readers walk its block headers
+// up to the last whole block.
+//
+// zstd blocks use the dictionary of the recording directory
+// (<dir>/rec-<id>.dict, REC_DICT_BYTES), trained by the compactor on the
+// first REC_DICT_SAMPLE_BYTES of items it sees (one sample per item, so
+// the repeated framing of each record kind lands in the dictionary), then
+// kept for every later run. Blocks before it exists have dict_id 0.
+//
+// Readers go through rec_reader_open() (recorder.h), which takes a ring
+// file, one segment or a directory of them (in name order), and
+// rec_reader_seek(), which uses the trailers and the index to decompress
+// only the blocks at or after the time asked for. Built without zstd
+// (make without ZSTD=1) the compactor stores blocks raw and a reader
+// skips zstd blocks, counting their items in skipped.
+
+#define REC_SEG_MAGIC    "GSSEG01"
+#define REC_SEG_TRAILER  "GSSEGIX"
+#define REC_SEG_BLOCK    (64 * 1024)        // Raw bytes per block, at most
+#define REC_SEG_BLOCK_MAGIC "GSBK"
+#define REC_DICT_BYTES   (16 * 1024)
+#define REC_DICT_SAMPLE_BYTES (1024 * 1024) // Items the dictionary is trained on
+
+enum { REC_CODEC_RAW = 0, REC_CODEC_ZSTD = 1 };
+
+typedef struct {
+  char     magic[8];                        // REC_SEG_MAGIC
+  uint32_t hdr_size;
+  uint32_t version;                         // 1
+  uint64_t mono_ns;                         // Recording's CLOCK_MONOTONIC and
+  uint64_t real_ns;                         // CLOCK_REALTIME, sampled together
+  uint64_t reserved[4];
+} rec_seg_hdr_t;
+
+typedef struct {
+  char     magic[4];                        // REC_SEG_BLOCK_MAGIC
+  uint8_t  codec;                           // REC_CODEC_*
+  uint8_t  pad[3];
+  uint32_t raw_len;
+  uint32_t comp_len;
+  uint32_t items;
+  uint32_t dict_id;                         // 0 = none
+  uint64_t t_first;                         // CLOCK_MONOTONIC of the recording
+  uint64_t t_last;
+  uint64_t offset;                          // Index entries: file offset of the header
+} rec_seg_block_t;
+
+typedef struct {
+  uint64_t index_off;
+  uint32_t blocks;
+  uint32_t pad;
+  uint64_t items;
+  uint64_t t_first;
+  uint64_t t_last;
+  char     magic[8];                        // REC_SEG_TRAILER
+} rec_seg_trailer_t;
+
+typedef struct __attribute__((packed)) {
+  uint8_t  kind, ch, flags, whole;
+  uint16_t total;
+  uint16_t len;
+  uint64_t t_ns;
+} rec_seg_item_t;                           // Then len bytes of data
+
+_Static_assert(sizeof(rec_seg_hdr_t) == 64, "rec_seg_hdr_t layout");
+_Static_assert(sizeof(rec_seg_block_t) == 48, "rec_seg_block_t layout");
+_Static_assert(sizeof(rec_seg_trailer_t) == 48, "rec_seg_trailer_t layout");
+_Static_assert(sizeof(rec_seg_item_t) == 16, "rec_seg_item_t layout");
+
+// Called by recorder.c for segments and directories
+int  rec_seg_open(rec_reader_t *r, const char *path, int dir);   // As rec_reader_open
+int  rec_seg_next(rec_reader_t *r, rec_item_t *it);
+void rec_seg_rewind(rec_reader_t *r);
+int  rec_seg_seek(rec_reader_t *r, uint64_t real_ns);
+void rec_seg_close(rec_reader_t *r);
+
+// One segment's header and trailer (without one, its blocks walked): 0 ok,
+// -1 errno, -2 not a segment
+int  rec_seg_stat(const char *path, rec_seg_hdr_t *hdr, rec_seg_trailer_t *tr);
+
+// <dir>'s segments (.seg and .seg.part) as paths, oldest first: count, -1 errno
+int  rec_seg_list(const char *dir, char ***paths);
+void rec_seg_list_free(char **paths, int n);
+void rec_seg_dict_path(char *buf, size_t n, const char *dir, uint32_t id);
+
+// Serialized length of an item in a block
+static inline size_t rec_seg_item_size(size_t len) {
+  return sizeof(rec_seg_item_t) + len;
+}
+
+#endif
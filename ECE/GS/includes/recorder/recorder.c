@@ -0,0 +1,256 @@
+#include "recorder.h"
+#include "rec_segment.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+rec_hdr_t *rec_g = NULL;
+
+static rec_slot_t *g_slots;
+static uint64_t    g_mask;
+static size_t      g_map_len;
+
+static uint64_t clock_ns(clockid_t id) {
+  struct timespec ts;
+  clock_gettime(id, &ts);                                  // vDSO for MONOTONIC / REALTIME
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+int rec_open(const char *path, size_t bytes) {
+  if (rec_g || !path || !path[0]) return -1;
+
+  uint64_t cap = 1;                                        // Largest power of two that fits
+  while ((cap << 1) * REC_SIZE <= bytes) cap <<= 1;
+  if (cap < REC_PARTS_MAX * 2) return -1;
+
+  char prev[512];
+  snprintf(prev, sizeof(prev), "%s.prev", path);
+  if (rename(path, prev) != 0 && errno != ENOENT)
+    fprintf(stderr, "Recorder: could not keep %s: %s\n", prev, strerror(errno));
+
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return -1;
+  g_map_len = REC_HDR_SIZE + (size_t)cap * REC_SIZE;
+  if (ftruncate(fd, (off_t)g_map_len) != 0) { close(fd); return -1; }
+  // Populated up front: the first lap does not page-fault on the hot path
+  void *map = mmap(NULL, g_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return -1;
+
+  rec_hdr_t *h = map;
+  memcpy(h->magic, REC_MAGIC, sizeof(h->magic));
+  h->rec_size = REC_SIZE;
+  h->hdr_size = REC_HDR_SIZE;
+  h->capacity = cap;
+  h->mono_ns  = clock_ns(CLOCK_MONOTONIC);
+  h->real_ns  = clock_ns(CLOCK_REALTIME);
+  atomic_store_explicit(&h->head, 0, memory_order_relaxed);
+
+  g_slots = (rec_slot_t *)((uint8_t *)map + REC_HDR_SIZE);
+  g_mask  = cap - 1;
+  atomic_thread_fence(memory_order_release);
+  rec_g = h;
+  return 0;
+}
+
+void rec_close(void) {
+  if (!rec_g) return;
+  rec_hdr_t *h = rec_g;
+  rec_g = NULL;
+  msync(h, g_map_len, MS_ASYNC);
+  munmap(h, g_map_len);
+}
+
+uint64_t rec_count(void) {
+  return rec_g ? atomic_load_explicit(&rec_g->head, memory_order_relaxed) : 0;
+}
+
+void rec_append(rec_kind_t kind, int ch, int flags, const void *data, size_t len) {
+  rec_hdr_t *h = rec_g;
+  if (!h) return;
+
+  size_t parts = len ? (len + REC_DATA - 1) / REC_DATA : 1;
+  if (parts > REC_PARTS_MAX) parts = REC_PARTS_MAX;
+  uint64_t idx = atomic_fetch_add_explicit(&h->head, parts, memory_order_relaxed);
+  uint64_t t = clock_ns(CLOCK_MONOTONIC);
+  const uint8_t *p = data;
+
+  for (size_t i = 0; i < parts; i++) {
+    rec_slot_t *s = &g_slots[(idx + i) & g_mask];
+    atomic_store_explicit(&s->seq, 0, memory_order_relaxed);   // A reader skips it until published
+    atomic_thread_fence(memory_order_release);
+    size_t off = i * REC_DATA, n = len > off ? len - off : 0;
+    if (n > REC_DATA) n = REC_DATA;
+    s->kind     = (uint8_t)kind;
+    s->ch       = (uint8_t)ch;
+    s->part     = (uint8_t)i;
+    s->parts    = (uint8_t)parts;
+    s->t_ns     = t;
+    s->total    = len > 0xFFFF ? 0xFFFF : (uint16_t)len;
+    s->len      = (uint8_t)n;
+    s->flags    = (uint8_t)flags;
+    if (n) memcpy(s->data, p + off, n);
+    atomic_store_explicit(&s->seq, (uint32_t)(idx + i + 1), memory_order_release);
+  }
+}
+
+// ------------------------- Reader -------------------------
+
+#define REC_KIND_NAME(name) #name,
+static const char *const kind_names[REC_KIND_COUNT] = { "NONE", REC_KINDS(REC_KIND_NAME) };
+#undef REC_KIND_NAME
+
+const char *rec_kind_name(int kind) {
+  return kind >= 0 && kind < REC_KIND_COUNT ? kind_names[kind] : "?";
+}
+
+int rec_kind_of(const char *name) {
+  for (int k = 1; k < REC_KIND_COUNT; k++)
+    if (strcmp(kind_names[k], name) == 0) return k;
+  return -1;
+}
+
+int rec_reader_open(rec_reader_t *r, const char *path) {
+  memset(r, 0, sizeof(*r));
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  char magic[8] = {0};
+  if (fd < 0) return -1;
+  if (fstat(fd, &st) != 0) { close(fd); return -1; }
+  if (S_ISDIR(st.st_mode)) { close(fd); return rec_seg_open(r, path, 1); }
+  if (pread(fd, magic, sizeof(magic), 0) == (ssize_t)sizeof(magic) &&
+      memcmp(magic, REC_SEG_MAGIC, sizeof(REC_SEG_MAGIC)) == 0) {
+    close(fd);
+    return rec_seg_open(r, path, 0);
+  }
+  if ((size_t)st.st_size < REC_HDR_SIZE) { close(fd); return -2; }
+  void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return -1;
+
+  const rec_hdr_t *h = map;
+  if (memcmp(h->magic, REC_MAGIC, sizeof(REC_MAGIC)) != 0 || h->rec_size != REC_SIZE ||
+      !h->capacity || (h->capacity & (h->capacity - 1)) ||
+      h->hdr_size + h->capacity * REC_SIZE > (uint64_t)st.st_size) {
+    munmap(map, (size_t)st.st_size);
+    return -2;
+  }
+  r->hdr     = h;
+  r->slots   = (const rec_slot_t *)((const uint8_t *)map + h->hdr_size);
+  r->map_len = (size_t)st.st_size;
+  r->mask    = h->capacity - 1;
+  r->head    = atomic_load_explicit(&((rec_hdr_t *)h)->head, memory_order_acquire);
+  r->start   = r->head > h->capacity ? r->head - h->capacity : 0;
+  r->pos     = r->start;
+  return 0;
+}
+
+int rec_reader_live(rec_reader_t *r) {
+  memset(r, 0, sizeof(*r));
+  if (!rec_g) return -1;
+  r->hdr    = rec_g;
+  r->slots  = g_slots;
+  r->mask   = g_mask;
+  r->head   = atomic_load_explicit(&rec_g->head, memory_order_acquire);
+  r->start  = r->head > rec_g->capacity ? r->head - rec_g->capacity : 0;
+  r->pos    = r->start;
+  r->follow = 1;
+  return 0;
+}
+
+void rec_reader_rewind(rec_reader_t *r) {
+  if (r->seg) { rec_seg_rewind(r); return; }
+  r->pos = r->start;
+  r->skipped = 0;
+}
+
+// Slot i of a live ring: 1 published, 0 not yet (or being written), -1 lapped
+static int slot_state(const rec_slot_t *s, uint64_t i) {
+  uint32_t seq = atomic_load_explicit(&((rec_slot_t *)s)->seq, memory_order_acquire);
+  if (seq == (uint32_t)(i + 1)) return 1;
+  if (seq == 0 || (int32_t)(seq - (uint32_t)(i + 1)) < 0) return 0;
+  return -1;
+}
+
+int rec_reader_next(rec_reader_t *r, rec_item_t *it) {
+  if (r->seg) return rec_seg_next(r, it);
+  if (r->follow) {
+    if (r->pos >= r->head) r->head = atomic_load_explicit(&((rec_hdr_t *)r->hdr)->head, memory_order_acquire);
+    if (r->head - r->pos > r->hdr->capacity) {             // Lapped while we were away
+      r->skipped += r->head - r->hdr->capacity - r->pos;
+      r->pos = r->head - r->hdr->capacity;
+    }
+  }
+  while (r->pos < r->head) {
+    uint64_t i = r->pos;
+    const rec_slot_t *s = &r->slots[i & r->mask];
+    if (r->follow) {
+      int st = slot_state(s, i);
+      if (st == 0) return 0;                               // Reserved, not published yet
+      if (st < 0 || s->part != 0) { r->skipped++; r->pos++; continue; }
+      int parts = s->parts ? s->parts : 1;                 // Wait for the whole item
+      for (int k = 1; k < parts; k++) {
+        if (i + (uint64_t)k >= r->head) r->head = atomic_load_explicit(&((rec_hdr_t *)r->hdr)->head, memory_order_acquire);
+        if (i + (uint64_t)k < r->head && slot_state(&r->slots[(i + (uint64_t)k) & r->mask], i + (uint64_t)k) == 0) return 0;
+      }
+    } else if (atomic_load_explicit(&((rec_slot_t *)s)->seq, memory_order_acquire) != (uint32_t)(i + 1) || s->part != 0) {
+      r->skipped++;                                        // Torn, in flight or a lapped tail
+      r->pos++;
+      continue;
+    }
+    int parts = s->parts ? s->parts : 1;
+    it->kind  = s->kind;
+    it->ch    = s->ch;
+    it->flags = s->flags;
+    it->t_ns  = s->t_ns;
+    it->total = s->total;
+    it->len   = 0;
+    it->whole = 1;
+    for (int k = 0; k < parts && i + (uint64_t)k < r->head; k++) {
+      const rec_slot_t *p = &r->slots[(i + (uint64_t)k) & r->mask];
+      uint32_t want = (uint32_t)(i + (uint64_t)k + 1);
+      if (p->seq != want || p->part != k) { it->whole = 0; break; }
+      memcpy(it->data + it->len, p->data, p->len);
+      it->len += p->len;
+      atomic_thread_fence(memory_order_acquire);
+      if (atomic_load_explicit(&((rec_slot_t *)p)->seq, memory_order_relaxed) != want) {
+        it->whole = 0;                                     // Overwritten while copied
+        break;
+      }
+    }
+    r->pos += (uint64_t)parts;
+    return 1;
+  }
+  return 0;
+}
+
+// CLOCK_MONOTONIC of the recording at a CLOCK_REALTIME time (0 = before it opened)
+uint64_t rec_mono_of(const rec_hdr_t *h, uint64_t real_ns) {
+  return real_ns > h->real_ns ? h->mono_ns + (real_ns - h->real_ns) : 0;
+}
+
+int rec_reader_seek(rec_reader_t *r, uint64_t real_ns) {
+  if (r->seg) return rec_seg_seek(r, real_ns);
+  uint64_t from = rec_mono_of(r->hdr, real_ns);
+  rec_reader_rewind(r);
+  for (uint64_t i = r->start; i < r->head; i++) {          // Slots are in time order, give or take a writer
+    const rec_slot_t *s = &r->slots[i & r->mask];
+    if (s->seq == (uint32_t)(i + 1) && s->part == 0 && s->t_ns >= from) {
+      r->pos = i;
+      return 0;
+    }
+  }
+  r->pos = r->head;
+  return -1;
+}
+
+void rec_reader_close(rec_reader_t *r) {
+  if (r->seg) { rec_seg_close(r); return; }
+  if (r->hdr && r->map_len) munmap((void *)r->hdr, r->map_len);
+  r->hdr = NULL;
+}
@@ -0,0 +1,148 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ------------------------- Session flight recorder -------------------------
+// Always-on binary log of what crossed the bridge: UDS frames both ways,
+// every robot word sent or received, the sealed frames around them, UART
+// traffic and link changes. Records are fixed 64-byte slots in a ring file
+// that is mmap'd MAP_SHARED, so the kernel writes it back and it survives a
+// crash of the bridge; the previous run's file is kept as <path>.prev.
+//
+// An append reserves its slots with one atomic add on the header's head,
+// fills them in place and publishes each with a release store of its seq.
+// No lock and no syscall per record (CLOCK_MONOTONIC is read through the
+// vDSO), so the UART reader thread and the event loop can both append.
+// Items longer than one slot take up to REC_PARTS_MAX consecutive slots;
+// the rest is cut (total still has the full length).
+//
+// Env: GS_RECORD=<path> (default REC_DEFAULT_PATH, 0 = off),
+//      GS_RECORD_MB=<ring size> (default REC_DEFAULT_MB),
+//      GS_RECORD_DIR=<dir>: also keep compressed segments there, past what
+//      the ring holds (rec_compact.h, rec_segment.h).
+// Read it back with gs_recdump.o (make recdump); GS_REPLAY=<file> drives
+// a bridge from it (replay.h).
+
+#define REC_MAGIC        "GSREC01"
+#define REC_DEFAULT_PATH "/var/tmp/gs_flight.rec"
+#ifndef REC_DEFAULT_MB
+#ifdef GS_LOWMEM
+#define REC_DEFAULT_MB   2
+#else
+#define REC_DEFAULT_MB   16
+#endif
+#endif
+#define REC_HDR_SIZE     4096
+#define REC_SIZE         64
+#define REC_DATA         44                 // Payload bytes per slot
+#define REC_PARTS_MAX    8                  // Slots one item may take (352 bytes)
+
+#define REC_KINDS(X) \
+  X(UDS_IN)                                 /* Frame from a UDS client (ch = fd) */ \
+  X(UDS_OUT)                                /* Frame queued or written to a client (ch = fd) */ \
+  X(WORD_TX)                                /* Command word handed to the link (ch = robot) */ \
+  X(WORD_RX)                                /* Report word from the robot (ch = robot) */ \
+  X(CIPHER_TX)                              /* Sealed IV||CT||TAG sent (ch = robot) */ \
+  X(CIPHER_RX)                              /* Sealed IV||CT||TAG received, before checks */ \
+  X(UART_TX)                                /* Bytes written to the radio UART (ch = radio) */ \
+  X(UART_RX)                                /* AT line from the UART (ch = radio) */ \
+  X(LINK)                                   /* data[0] = 1 up / 0 down (ch = robot) */ \
+  X(NOTIFY_RX)                              /* Notification payload (ch = robot), see REC_F_STREAM */
+
+#define REC_F_STREAM     0x01               // NOTIFY_RX: passthrough chunk, not one whole notification
+
+#define REC_KIND_ENUM(name) REC_##name,
+typedef enum { REC_NONE = 0, REC_KINDS(REC_KIND_ENUM) REC_KIND_COUNT } rec_kind_t;
+#undef REC_KIND_ENUM
+
+typedef struct {
+  _Atomic uint32_t seq;                     // Low 32 bits of (index + 1); 0 while being written
+  uint8_t          kind;
+  uint8_t          ch;                      // Robot, radio or UDS fd, see REC_KINDS
+  uint8_t          part;                    // Slot of the item, 0..parts-1
+  uint8_t          parts;
+  uint64_t         t_ns;                    // CLOCK_MONOTONIC, same for every part
+  uint16_t         total;                   // Item length in bytes (saturates at 65535)
+  uint8_t          len;                     // Bytes of data[] used
+  uint8_t          flags;                   // REC_F_*
+  uint8_t          data[REC_DATA];
+} rec_slot_t;
+
+typedef struct {
+  char             magic[8];
+  uint32_t         rec_size;
+  uint32_t         hdr_size;
+  uint64_t         capacity;                // Slots, power of two
+  uint64_t         mono_ns;                 // CLOCK_MONOTONIC and CLOCK_REALTIME
+  uint64_t         real_ns;                 // sampled together at open
+  _Atomic uint64_t head;                    // Slots reserved so far (never wraps)
+} rec_hdr_t;
+
+_Static_assert(sizeof(rec_slot_t) == REC_SIZE, "rec_slot_t must stay one 64-byte slot");
+_Static_assert(sizeof(rec_hdr_t) <= REC_HDR_SIZE, "rec_hdr_t must fit its page");
+
+extern rec_hdr_t *rec_g;                    // NULL = recording off
+
+int  rec_open(const char *path, size_t bytes);  // 0 = recording; previous file moved to .prev
+void rec_close(void);
+void rec_append(rec_kind_t kind, int ch, int flags, const void *data, size_t len);
+uint64_t rec_count(void);                   // Slots written since open
+
+// One predictable branch when recording is off
+static inline void rec_put(rec_kind_t kind, int ch, const void *data, size_t len) {
+  if (rec_g) rec_append(kind, ch, 0, data, len);
+}
+
+static inline void rec_put_flags(rec_kind_t kind, int ch, int flags, const void *data, size_t len) {
+  if (rec_g) rec_append(kind, ch, flags, data, len);
+}
+
+// ------------------------- Reading a recording -------------------------
+// Maps a ring file read-only (the live one of a running bridge works too:
+// items published after rec_reader_open are not seen) and walks its items
+// oldest first, gluing the parts back together. Slots still being written,
+// torn by a crash or overwritten by a lap are skipped and counted.
+// Segment files and directories of them (rec_segment.h) read the same way;
+// hdr then has the clocks of the segment the last item came from, since
+// every run of the bridge has its own.
+
+struct rec_seg_reader;
+
+typedef struct {
+  const rec_hdr_t  *hdr;
+  const rec_slot_t *slots;
+  size_t            map_len;                // 0 = this process's ring, not mapped by the reader
+  uint64_t          mask, start, head, pos;
+  uint64_t          skipped;                // Slots (segments: items) not part of a readable item
+  int               follow;                 // rec_reader_live(): wait at slots being written
+  struct rec_seg_reader *seg;               // Segment reader, NULL = ring
+  rec_hdr_t         seg_hdr;                // hdr of segments: capacity 0
+} rec_reader_t;
+
+typedef struct {
+  uint8_t  kind, ch, flags;
+  int      whole;                           // 0 = a later part was missing
+  uint64_t t_ns;                            // CLOCK_MONOTONIC of the recording bridge
+  uint16_t total;                           // Original length; len < total when cut
+  size_t   len;
+  uint8_t  data[REC_PARTS_MAX * REC_DATA];
+} rec_item_t;
+
+int  rec_reader_open(rec_reader_t *r, const char *path);  // Ring, segment or directory: 0 ok, -1 errno, -2 none of them
+int  rec_reader_next(rec_reader_t *r, rec_item_t *it);    // 1 = item, 0 = end
+void rec_reader_rewind(rec_reader_t *r);
+int  rec_reader_seek(rec_reader_t *r, uint64_t real_ns);  // To the first item at or after a CLOCK_REALTIME time; -1 = none
+
+// This process's ring as it grows (the compactor): next() refreshes head
+// when it catches up, returns 0 at a slot still being written (call again
+// later) and jumps over what a lap overwrote, counting it in skipped.
+int  rec_reader_live(rec_reader_t *r);                    // 0 ok, -1 recording off
+void rec_reader_close(rec_reader_t *r);
+uint64_t rec_mono_of(const rec_hdr_t *h, uint64_t real_ns);  // Recording's CLOCK_MONOTONIC then; 0 = before it opened
+const char *rec_kind_name(int kind);
+int  rec_kind_of(const char *name);         // -1 = unknown
+
+#endif
@@ -0,0 +1,167 @@
+#define _GNU_SOURCE                         /* ptsname_r() */
+#include "replay.h"
+#include "recorder.h"
+#include "../log/gs_log.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static struct {
+  rec_reader_t  r;
+  rec_item_t    it;
+  int           has_item;
+  uint64_t      t_ns;                       // Its CLOCK_REALTIME: a directory of segments spans runs
+  replay_sink_t sink;
+  double        speed;                      // 0 = as fast as possible
+  int           started;
+  uint64_t      base_ns;                    // First item, recorded realtime
+  uint64_t      last_ns;                    // Last item fed, recorded realtime
+  uint64_t      wall0_ns;                   // Replay start, our clock
+  uint64_t      fed[REC_KIND_COUNT];
+  uint64_t      cut;                        // Torn or cut items, not fed
+  int           pty[REPLAY_UARTS];          // Master side of each radio's PTY
+  uint64_t      rec_tx[REPLAY_UARTS];       // Bytes the recorded bridge had written so far
+  uint64_t      live_tx[REPLAY_UARTS];      // Bytes this bridge has written
+  uint64_t      gate;                       // UART_RX item: rec_tx of its radio when it arrived
+  uint64_t      stall_ns;                   // Gate closed since (0 = open)
+  uint64_t      stalls;                     // Gates given up on
+} g;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Next item the bridge consumes; what it produced itself is skipped
+static int load_next(void) {
+  while (rec_reader_next(&g.r, &g.it)) {
+    if (g.it.kind == REC_UART_TX && g.it.ch < REPLAY_UARTS) g.rec_tx[g.it.ch] += g.it.total;
+    if (g.it.kind != REC_UDS_IN && g.it.kind != REC_UART_RX && g.it.kind != REC_NOTIFY_RX) continue;
+    if (!g.it.whole || g.it.len < g.it.total) { g.cut++; continue; }
+    if (g.it.kind == REC_UART_RX) g.gate = g.it.ch < REPLAY_UARTS ? g.rec_tx[g.it.ch] : 0;
+    g.t_ns = g.r.hdr->real_ns + (g.it.t_ns - g.r.hdr->mono_ns);
+    return g.has_item = 1;
+  }
+  return g.has_item = 0;
+}
+
+// 1 = the line may go: the bridge has caught up with the recorded writes
+// (or gave up waiting), 0 = try again shortly
+static int gate_open(uint64_t now) {
+  int radio = g.it.ch;
+  if (g.it.kind != REC_UART_RX || radio >= REPLAY_UARTS || g.pty[radio] < 0) return 1;
+  replay_uart_drain(radio);
+  if (g.live_tx[radio] >= g.gate) {
+    if (g.stall_ns) g.wall0_ns += now - g.stall_ns;        // Keep the recorded gaps after a wait
+    g.stall_ns = 0;
+    return 1;
+  }
+  if (!g.stall_ns) g.stall_ns = now;
+  if (now - g.stall_ns < (uint64_t)REPLAY_STALL_MS * 1000000u) return 0;
+  g.stalls++;
+  g.live_tx[radio] = g.gate;                               // Resync, or every later line stalls too
+  g.stall_ns = 0;
+  return 1;
+}
+
+int replay_open(const char *path, const char *speed, const replay_sink_t *sink) {
+  memset(&g, 0, sizeof(g));
+  for (int r = 0; r < REPLAY_UARTS; r++) g.pty[r] = -1;    // replay_uart_open() comes after
+  int rc = rec_reader_open(&g.r, path);
+  if (rc != 0) {
+    LOG_ERR("Replay: %s: %s", path, rc == -1 ? strerror(errno) : "not a recorder file");
+    return -1;
+  }
+  g.sink = *sink;
+  g.speed = 1.0;
+  if (speed && speed[0]) g.speed = strcmp(speed, "max") == 0 ? 0.0 : strtod(speed, NULL);
+  if (g.speed < 0) g.speed = 0;
+  const char *from = getenv("GS_REPLAY_FROM");
+  if (from && from[0] && rec_reader_seek(&g.r, (uint64_t)(strtod(from, NULL) * 1e9)) != 0)
+    LOG_WARN("Replay: nothing recorded after GS_REPLAY_FROM=%s", from);
+  load_next();
+  return 0;
+}
+
+int replay_step(int *next_ms) {
+  uint64_t now = now_ns();
+  if (!g.started && g.has_item) {
+    g.started = 1;
+    g.base_ns = g.t_ns;
+    g.wall0_ns = now;
+  }
+  for (int n = 0; g.has_item; n++) {
+    if (g.speed > 0) {
+      uint64_t rel = g.t_ns > g.base_ns ? g.t_ns - g.base_ns : 0;
+      uint64_t due = g.wall0_ns + (uint64_t)((double)rel / g.speed);
+      if (due > now) {
+        *next_ms = (int)((due - now + 999999u) / 1000000u);
+        return 1;
+      }
+    } else if (n == REPLAY_BURST) {
+      *next_ms = 0;
+      return 1;
+    }
+    if (!gate_open(now)) {
+      *next_ms = 1;
+      return 1;
+    }
+    int kind = g.it.kind;
+    g.fed[kind]++;
+    g.last_ns = g.t_ns;
+    switch (kind) {
+      case REC_UDS_IN:    g.sink.uds_in(g.it.ch, g.it.data, g.it.len); break;
+      case REC_UART_RX:   g.sink.uart_line(g.it.ch, g.it.data, g.it.len); break;
+      case REC_NOTIFY_RX: g.sink.notify(g.it.ch, g.it.data, g.it.len, g.it.flags & REC_F_STREAM); break;
+    }
+    load_next();
+    // Full speed: let the loop run what an AT reply set off (the next
+    // command, a timer due now) before the next line arrives
+    if (g.speed == 0 && kind == REC_UART_RX && g.has_item) {
+      *next_ms = 0;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void replay_report(void) {
+  double rec_s = (double)(g.last_ns - g.base_ns) / 1e9;
+  double run_s = g.started ? (double)(now_ns() - g.wall0_ns) / 1e9 : 0;
+  uint64_t items = g.fed[REC_UDS_IN] + g.fed[REC_UART_RX] + g.fed[REC_NOTIFY_RX];
+  LOG_INFO("Replay: %llu items (%llu UDS_IN, %llu UART_RX, %llu NOTIFY_RX, %llu cut), "
+         "%.3f s recorded in %.3f s, %.0f items/s, %llu stalls\n",
+         (unsigned long long)items, (unsigned long long)g.fed[REC_UDS_IN],
+         (unsigned long long)g.fed[REC_UART_RX], (unsigned long long)g.fed[REC_NOTIFY_RX],
+         (unsigned long long)g.cut, rec_s, run_s, run_s > 0 ? (double)items / run_s : 0.0,
+         (unsigned long long)g.stalls);
+}
+
+void replay_close(void) {
+  rec_reader_close(&g.r);
+  for (int r = 0; r < REPLAY_UARTS; r++)
+    if (g.pty[r] >= 0) close(g.pty[r]);
+}
+
+int replay_uart_open(int radio, char *dev, size_t cap) {
+  if (radio < 0 || radio >= REPLAY_UARTS) return -1;
+  int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) return -1;
+  if (grantpt(fd) != 0 || unlockpt(fd) != 0 || ptsname_r(fd, dev, cap) != 0) {
+    close(fd);
+    return -1;
+  }
+  g.pty[radio] = fd;
+  return fd;
+}
+
+void replay_uart_drain(int radio) {
+  uint8_t buf[4096];
+  ssize_t n;
+  while ((n = read(g.pty[radio], buf, sizeof(buf))) > 0) g.live_tx[radio] += (uint64_t)n;
+}
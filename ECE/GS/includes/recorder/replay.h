@@ -0,0 +1,49 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ------------------------- Session replay -------------------------
+// Drives the bridge from a flight recorder file instead of live peers: the
+// recorded UDS_IN frames go back through the UDS dispatch (scan, tape,
+// cJSON and cipher paths), the UART_RX lines through the AT engine and the
+// NOTIFY_RX payloads through the report decoder, in recorded order. What
+// the bridge sends in reaction (AT commands, sealed words, UDS replies)
+// goes to a PTY and /dev/null; record the replay to a second file and diff
+// its WORD_TX items against the original to check a change.
+//
+// A recorded UART line is only fed once the bridge has written as many
+// bytes to that radio as it had when the line arrived, so a reply never
+// overtakes the command it answers. The AT dialogue itself is the recorded
+// one: a change that writes different bytes stalls the gate, which gives
+// way after REPLAY_STALL_MS (counted in the summary).
+//
+// GS_REPLAY=<file>, GS_REPLAY_SPEED=1 (recorded timing, default) | N (N
+// times faster) | 0 or max (as fast as possible, input order only).
+// The file may be a GS_RECORD_DIR or one segment of it (rec_segment.h);
+// GS_REPLAY_FROM=<unix seconds> starts at that time instead of the first
+// item, decompressing nothing before it.
+// Run it with the same GS_ROBOTS / GS_RADIOS / GS_BLE_WNR as the session;
+// GS_GATT_CACHE defaults to off (a session that skipped discovery needs a
+// copy of the cache file it used).
+
+#define REPLAY_BURST   4096                 // Items per loop turn at full speed
+#define REPLAY_DRAIN_MS 500                 // Loop keeps running this long after the last item
+#define REPLAY_STALL_MS 200                 // Longest wait for the bytes a line answers
+#define REPLAY_UARTS    8                   // Radios (recorded ch of UART items)
+
+typedef struct {
+  void (*uds_in)(int ch, const uint8_t *data, size_t len);            // ch = recorded client fd
+  void (*uart_line)(int radio, const uint8_t *data, size_t len);
+  void (*notify)(int robot, const uint8_t *data, size_t len, int stream);
+} replay_sink_t;
+
+int  replay_open(const char *path, const char *speed, const replay_sink_t *sink); // 0 ok
+int  replay_step(int *next_ms);             // 1 = more, due in *next_ms (0 = yield, then at once); 0 = done
+void replay_report(void);                   // Counts, recorded vs replay time, items/s
+void replay_close(void);
+int  replay_uart_open(int radio, char *dev, size_t cap); // PTY for a radio: master fd, dev = slave path
+void replay_uart_drain(int radio);          // Reads and counts what the bridge wrote to it
+
+#endif
@@ -0,0 +1,123 @@
+#include "standby.h"
+#include "../log/gs_log.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static standby_state_t *g_map = NULL;
+static int              g_fd  = -1;
+
+static uint64_t mono_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// The lock is held: the file is ours, cleared until the first snapshot
+static int state_map(int fd) {
+  if (ftruncate(fd, sizeof(standby_state_t)) != 0) return -1;
+  void *map = mmap(NULL, sizeof(standby_state_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) return -1;
+  g_map = map;
+  g_fd = fd;
+  memset(g_map, 0, sizeof(*g_map));
+  memcpy(g_map->magic, STANDBY_MAGIC, sizeof(g_map->magic));
+  g_map->pid = (uint32_t)getpid();
+  return 0;
+}
+
+int standby_open(const char *path) {
+  if (g_map || !path || !path[0]) return -1;
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) return -1;
+  if (flock(fd, LOCK_EX | LOCK_NB) != 0 || state_map(fd) != 0) {
+    close(fd);
+    return -1;
+  }
+  return 0;
+}
+
+// Seqlock read of what the active bridge last wrote; 0 = a consistent,
+// stamped copy in out
+static int state_peek(int fd, standby_state_t *out) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(standby_state_t)) return -1;
+  void *map = mmap(NULL, sizeof(standby_state_t), PROT_READ, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) return -1;
+  const standby_state_t *m = map;
+  int r = -1;
+  for (int tries = 0; r != 0 && tries < 64; tries++) {
+    uint32_t s0 = atomic_load_explicit(&m->seq, memory_order_acquire);
+    if (s0 & 1) continue;
+    memcpy(out, map, sizeof(*out));
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&m->seq, memory_order_relaxed) == s0) r = 0;
+  }
+  munmap(map, sizeof(standby_state_t));
+  if (r == 0 && (memcmp(out->magic, STANDBY_MAGIC, sizeof(out->magic)) != 0 || out->beat_ns == 0)) r = -1;
+  return r;
+}
+
+int standby_wait(const char *path, const sigset_t *stop, standby_state_t *last) {
+  if (g_map || !path || !path[0]) return -1;
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) return -1;
+
+  const struct timespec poll = { 0, STANDBY_POLL_MS * 1000000L };
+  standby_state_t snap;
+  int warned = 0;
+  memset(last, 0, sizeof(*last));
+  LOG_INFO("Standby: waiting on %s", path);
+  while (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+    if (errno != EWOULDBLOCK && errno != EINTR) { close(fd); return -1; }
+    int sig = sigtimedwait(stop, NULL, &poll);             // The probe period, stop signals included
+    if (sig > 0 && sig != SIGHUP) { close(fd); return -1; }
+    if (state_peek(fd, &snap) != 0) continue;
+
+    uint64_t age_ms = (mono_ns() - snap.beat_ns) / 1000000u;
+    if (age_ms < STANDBY_STALE_MS) warned = 0;
+    else if (!warned) {
+      LOG_WARN("Standby: active bridge pid %u silent for %llu ms but still holds %s",
+               (unsigned)snap.pid, (unsigned long long)age_ms, path);
+      warned = 1;
+    }
+  }
+
+  // The active bridge's last words, written after the final probe perhaps
+  if (state_peek(fd, &snap) == 0) *last = snap;
+  if (state_map(fd) != 0) { close(fd); return -1; }
+  return 0;
+}
+
+void standby_publish(standby_state_t *s) {
+  standby_state_t *m = g_map;
+  if (!m) return;
+  memcpy(s->magic, STANDBY_MAGIC, sizeof(s->magic));
+  s->pid = m->pid;
+  s->beat_ns = mono_ns();
+
+  uint32_t seq = atomic_load_explicit(&m->seq, memory_order_relaxed);
+  atomic_store_explicit(&m->seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  memcpy((uint8_t *)m + offsetof(standby_state_t, pid), (const uint8_t *)s + offsetof(standby_state_t, pid),
+         sizeof(*s) - offsetof(standby_state_t, pid));
+  atomic_store_explicit(&m->seq, seq + 2, memory_order_release);
+}
+
+int standby_enabled(void) {
+  return g_map != NULL;
+}
+
+void standby_close(void) {
+  if (!g_map) return;
+  munmap(g_map, sizeof(standby_state_t));
+  close(g_fd);                                             // Releases the lock: a standby moves in
+  g_map = NULL;
+  g_fd = -1;
+}
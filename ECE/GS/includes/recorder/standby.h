@@ -0,0 +1,60 @@
+#ifndef STANDBY_H
+#define STANDBY_H
+
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include "ack_track.h"
+#include "pmod_esp32.h"
+
+// ------------------------- Hot standby -------------------------
+// A second bridge on the same host waits to take the radios over when the
+// active one dies. Both map one small state file MAP_SHARED (tmpfs, like
+// the recorder's ring but rewritten in place): the active bridge holds an
+// exclusive flock on it for its lifetime and publishes a snapshot of the
+// session every STANDBY_BEAT_MS, and on every link change:
+//   security level per robot, authorization_code, link up per robot,
+//   the live SYSTEM / QUERY words of the ACK tracker (ack_word_t)
+// under a sequence count (odd while it writes), so a reader never takes a
+// torn copy. The snapshot carries the heartbeat (CLOCK_MONOTONIC).
+//
+// The standby (GS_STANDBY=1) resolves the ESP32 reset / mode pins up front
+// and then probes the lock every STANDBY_POLL_MS. The kernel drops the
+// lock the moment the active process exits, however it exits, so takeover
+// starts within one probe: the standby keeps the last snapshot, opens the
+// UARTs, resets the modules and reconnects with the cached GATT handles
+// (gatt_cache.h) while the restored security levels seal words the way the
+// robots expect and the adopted words go out again once their link is up.
+// A heartbeat older than STANDBY_STALE_MS with the lock still held is an
+// active bridge that hangs; the standby only warns, as two processes must
+// never drive one UART.
+//
+// Env: GS_STATE=<path> (default STANDBY_DEFAULT_PATH, 0 = off),
+//      GS_STANDBY=1 (wait for the active bridge first).
+
+#define STANDBY_MAGIC        "GSSTBY1"
+#define STANDBY_DEFAULT_PATH "/dev/shm/gs_bridge.state"
+#define STANDBY_BEAT_MS      50             // Active: snapshot + heartbeat period
+#define STANDBY_POLL_MS      20             // Standby: lock probe period, the takeover bound
+#define STANDBY_STALE_MS     1000           // Heartbeat age reported as a hung active bridge
+#define STANDBY_WORDS_MAX    32
+
+typedef struct {
+  char             magic[8];
+  _Atomic uint32_t seq;                     // Odd while the active bridge writes
+  uint32_t         pid;                     // Active bridge
+  uint64_t         beat_ns;                 // CLOCK_MONOTONIC of the snapshot
+  int32_t          authorization_code;
+  int32_t          security[BLE_LINKS_MAX];
+  uint8_t          link_up[BLE_LINKS_MAX];
+  uint32_t         words;
+  ack_word_t       word[STANDBY_WORDS_MAX];
+} standby_state_t;
+
+int  standby_open(const char *path);                        // Active: lock + map; -1 = held or unusable
+int  standby_wait(const char *path, const sigset_t *stop, standby_state_t *last);  // Blocks until held; -1 = stop signal
+void standby_publish(standby_state_t *s);                   // Stamps s and copies it in
+int  standby_enabled(void);
+void standby_close(void);
+
+#endif
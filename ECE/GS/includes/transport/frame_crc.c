@@ -0,0 +1,164 @@
+#include "frame_crc.h"
+#include <string.h>
+
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#include <arm_acle.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+#define CRC32C_POLY 0x82F63B78u             /* Castagnoli, reflected */
+
+typedef uint32_t (*crc_fn)(uint32_t c, const uint8_t *p, size_t n);
+
+static uint32_t g_tab[8][256];
+static crc_fn   g_crc;
+static const char *g_name = "table";
+
+/* ------------------------- Slice-by-8 ------------------------- */
+
+static void table_build(void)
+{
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c >> 1) ^ (CRC32C_POLY & (0u - (c & 1)));
+        g_tab[0][i] = c;
+    }
+    for (int t = 1; t < 8; t++)
+        for (int i = 0; i < 256; i++)
+            g_tab[t][i] = (g_tab[t - 1][i] >> 8) ^ g_tab[0][g_tab[t - 1][i] & 0xFF];
+}
+
+static uint32_t crc_table(uint32_t c, const uint8_t *p, size_t n)
+{
+    while (n >= 8) {
+        uint32_t lo = c ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+        c = g_tab[7][lo & 0xFF] ^ g_tab[6][(lo >> 8) & 0xFF] ^
+            g_tab[5][(lo >> 16) & 0xFF] ^ g_tab[4][lo >> 24] ^
+            g_tab[3][p[4]] ^ g_tab[2][p[5]] ^ g_tab[1][p[6]] ^ g_tab[0][p[7]];
+        p += 8;
+        n -= 8;
+    }
+    while (n--) c = (c >> 8) ^ g_tab[0][(c ^ *p++) & 0xFF];
+    return c;
+}
+
+/* ------------------------- ARMv8 CRC32C ------------------------- */
+
+#if defined(__aarch64__)
+__attribute__((target("+crc")))
+static uint32_t crc_armv8(uint32_t c, const uint8_t *p, size_t n)
+{
+    while (n && ((uintptr_t)p & 7)) { c = __crc32cb(c, *p++); n--; }
+    while (n >= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        c = __crc32cd(c, v);
+        p += 8;
+        n -= 8;
+    }
+    while (n--) c = __crc32cb(c, *p++);
+    return c;
+}
+#endif
+
+void crc32c_init(void)
+{
+    if (g_crc) return;
+    table_build();
+    g_crc = crc_table;
+#if defined(__aarch64__)
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32) {
+        g_crc = crc_armv8;
+        g_name = "armv8";
+    }
+#endif
+}
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t len)
+{
+    return ~g_crc(~crc, data, len);
+}
+
+const char *crc32c_impl(void)
+{
+    return g_name;
+}
+
+/* ------------------------- Frames ------------------------- */
+
+size_t frame_v2_pack(uint8_t *out, const uint8_t *payload, size_t len)
+{
+    if (len > FRAME_V2_MAX_LEN) return 0;
+    out[0] = FRAME_V2_SYNC0;
+    out[1] = FRAME_V2_SYNC1;
+    out[2] = (uint8_t)len;
+    memcpy(out + FRAME_V2_HDR, payload, len);
+    uint32_t c = crc32c(0, out + 2, len + 1);
+    uint8_t *t = out + FRAME_V2_HDR + len;
+    t[0] = (uint8_t)c;
+    t[1] = (uint8_t)(c >> 8);
+    t[2] = (uint8_t)(c >> 16);
+    t[3] = (uint8_t)(c >> 24);
+    return FRAME_V2_HDR + len + FRAME_V2_CRC;
+}
+
+void frame_v2_reset(frame_v2_parser_t *p)
+{
+    p->len = 0;
+}
+
+/* Delivers every whole frame in acc; what is left is a partial frame (< FRAME_V2_MAX) */
+static void frame_v2_scan(frame_v2_parser_t *p, frame_v2_fn fn, void *ctx)
+{
+    size_t off = 0;
+
+    while (off < p->len) {
+        const uint8_t *q = memchr(p->acc + off, FRAME_V2_SYNC0, p->len - off);
+        if (!q) {
+            p->skipped += (uint32_t)(p->len - off);
+            off = p->len;
+            break;
+        }
+        p->skipped += (uint32_t)(q - (p->acc + off));
+        off = (size_t)(q - p->acc);
+
+        if (p->len - off < FRAME_V2_HDR) break;
+        if (p->acc[off + 1] != FRAME_V2_SYNC1) { p->skipped++; off++; continue; }
+
+        size_t len = p->acc[off + 2];
+        size_t total = FRAME_V2_HDR + len + FRAME_V2_CRC;
+        if (p->len - off < total) break;
+
+        const uint8_t *t = p->acc + off + FRAME_V2_HDR + len;
+        uint32_t want = (uint32_t)t[0] | (uint32_t)t[1] << 8 | (uint32_t)t[2] << 16 | (uint32_t)t[3] << 24;
+        if (crc32c(0, p->acc + off + 2, len + 1) != want) {
+            p->crc_errors++;
+            p->skipped++;
+            off++;                          /* Only this 0xAA: a real frame may start inside */
+            continue;
+        }
+        p->frames++;
+        fn(p->acc + off + FRAME_V2_HDR, len, ctx);
+        off += total;
+    }
+    if (off) {
+        memmove(p->acc, p->acc + off, p->len - off);
+        p->len -= off;
+    }
+}
+
+void frame_v2_feed(frame_v2_parser_t *p, const uint8_t *data, size_t n, frame_v2_fn fn, void *ctx)
+{
+    while (n) {
+        size_t k = sizeof(p->acc) - p->len;
+        if (k > n) k = n;
+        memcpy(p->acc + p->len, data, k);
+        p->len += k;
+        data += k;
+        n -= k;
+        frame_v2_scan(p, fn, ctx);
+    }
+}
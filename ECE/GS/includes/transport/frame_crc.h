@@ -0,0 +1,54 @@
+#ifndef FRAME_CRC_H
+#define FRAME_CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * v2 serial link frame, for byte-stream links without a checksum of their
+ * own (the RN-42 SPP link; see transport_rn42.c, GS_RN42_FRAME=crc):
+ *
+ *   [0]=0xAA [1]=0x55 [2]=len [3..3+len)=payload [+4]=CRC-32C, little-endian
+ *
+ * The CRC covers len and the payload. CRC-32C (Castagnoli) catches every
+ * burst up to 32 bits and all odd bit counts, where the v1 frame's xor8
+ * missed any even number of flips in one bit column; a frame it lets
+ * through costs a whole command round trip before the retry.
+ *
+ * crc32c() runs on the ARMv8 CRC32C instructions when the core has them
+ * (the A53 does; HWCAP_CRC32 is checked once in crc32c_init()), and
+ * slice-by-8 tables elsewhere.
+ *
+ * The parser takes any chunking of the stream. It looks for the preamble
+ * with memchr, so noise between frames costs one scan, not a state
+ * machine step per byte; a bad CRC or an impossible length drops only the
+ * 0xAA it started at and the scan resumes from the next byte.
+ */
+
+#define FRAME_V2_SYNC0    0xAA
+#define FRAME_V2_SYNC1    0x55
+#define FRAME_V2_HDR      3
+#define FRAME_V2_CRC      4
+#define FRAME_V2_MAX_LEN  255
+#define FRAME_V2_MAX      (FRAME_V2_HDR + FRAME_V2_MAX_LEN + FRAME_V2_CRC)
+
+void     crc32c_init(void);                 /* Picks the implementation; once, before use */
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);   /* crc = 0 to start */
+const char *crc32c_impl(void);              /* "armv8" or "table" */
+
+size_t frame_v2_pack(uint8_t *out, const uint8_t *payload, size_t len);   /* 0 = len too large */
+
+typedef void (*frame_v2_fn)(const uint8_t *payload, size_t len, void *ctx);
+
+typedef struct {
+    uint8_t  acc[2 * FRAME_V2_MAX];
+    size_t   len;
+    uint32_t frames;                        /* Good frames delivered */
+    uint32_t crc_errors;
+    uint32_t skipped;                       /* Bytes dropped while resyncing */
+} frame_v2_parser_t;
+
+void frame_v2_reset(frame_v2_parser_t *p);
+void frame_v2_feed(frame_v2_parser_t *p, const uint8_t *data, size_t n, frame_v2_fn fn, void *ctx);
+
+#endif
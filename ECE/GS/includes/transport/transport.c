@@ -0,0 +1,198 @@
+#include "transport.h"
+#include "pmod_esp32.h"
+#include "ble_wnr.h"
+#include "../cmd_parser/cmd_parser.h"
+#include "../metrics/metrics.h"
+#include "../recorder/recorder.h"
+#include <ctype.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static const transport_ops_t *g_transport = &transport_esp_at;
+static transport_rx_fn   g_rx   = NULL;
+static transport_link_fn g_link = NULL;
+
+// ------------------------- ESP-AT -------------------------
+// The ESP-AT path keeps its own reader thread, AT engine and link
+// supervisor (set up by the bridge); the ops only pick the write.
+
+static int g_esp_fd = -1;
+
+static int esp_open(int uart_fd, at_timer_fn arm_timer)
+{
+    (void)arm_timer;
+    g_esp_fd = uart_fd;
+    return 0;
+}
+
+static int esp_send(const uint8_t *data, size_t len, int flags)
+{
+    if (flags & TRANSPORT_FRAMED) return ble_send_frame(g_esp_fd, data, (int)len, flags & TRANSPORT_STREAM);
+    if (flags & TRANSPORT_BATCH) return ble_send_batch(g_esp_fd, (uint8_t *)data, (int)len, flags & TRANSPORT_STREAM);
+    if (flags & TRANSPORT_STREAM) return ble_send_stream(g_esp_fd, (uint8_t *)data, (int)len);
+    if (len == PAYLOAD_BYTES) return ble_send_pkt(g_esp_fd, (uint8_t *)data, (int)len);
+    if (len == 8) return ble_send_instruction(g_esp_fd, (uint8_t *)data);
+    return -1;
+}
+
+/* TRANSPORT_URGENT: the write jumps the AT queue (at_engine_urgent) */
+static int esp_send_frame(const uint8_t *data, size_t len, int flags)
+{
+    if (!(flags & TRANSPORT_URGENT)) return esp_send(data, len, flags);
+    at_engine_urgent(1);
+    int rc = esp_send(data, len, flags);
+    at_engine_urgent(0);
+    return rc;
+}
+
+static int esp_link_state(void)
+{
+    return BLE_CONNECTED ? TRANSPORT_UP : TRANSPORT_DOWN;
+}
+
+/* The modem runs one AT command at a time: a word only goes out when
+ * nothing is queued ahead of it on the routed robot's radio */
+static int esp_ready(void)
+{
+    ble_use_radio();
+    return BLE_CONNECTED && at_engine_depth() == 0 && ble_wnr_ready();
+}
+
+/* A seal carries up to ROBOT_BATCH_MAX words whatever the MTU (the frame is
+ * the same 160 bytes as one word's); a plain batch has to fit one ATT write */
+static int esp_batch_max(int sealed)
+{
+    if (sealed) return ROBOT_BATCH_MAX;
+    return (ble_link_payload_max() - 2) / 8;
+}
+
+const transport_ops_t transport_esp_at = {
+    .name       = "esp-at",
+    .open       = esp_open,
+    .send_frame = esp_send_frame,
+    .link_state = esp_link_state,
+    .ready      = esp_ready,
+    .batch_max  = esp_batch_max,
+    .framed     = 1,
+};
+
+// ------------------------- Selection -------------------------
+
+static const transport_ops_t *const g_all[] = {
+    &transport_esp_at,
+    &transport_l2cap,
+    &transport_hci,
+#ifndef GS_NO_RN
+    &transport_rn42,
+    &transport_rn4871,
+#endif
+};
+
+int transport_select(const char *name)
+{
+    if (!name || !name[0]) name = transport_esp_at.name;
+    for (size_t i = 0; i < sizeof(g_all) / sizeof(g_all[0]); i++) {
+        if (strcmp(g_all[i]->name, name) == 0) {
+            g_transport = g_all[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const transport_ops_t *transport(void)
+{
+    return g_transport;
+}
+
+int transport_is_esp(void)
+{
+    return g_transport == &transport_esp_at;
+}
+
+void transport_set_handlers(transport_rx_fn rx, transport_link_fn link)
+{
+    g_rx   = rx;
+    g_link = link;
+}
+
+int transport_send_frame(const uint8_t *data, size_t len, int flags)
+{
+    if (!data) return -1;
+    if (flags & TRANSPORT_ECHO) {
+        if (!g_transport->framed || len <= 8 || len > LINK_ECHO_MAX || data[0] != LINK_ECHO_TAG || data[1] != len)
+            return -1;
+        flags = (flags & ~TRANSPORT_ECHO) | TRANSPORT_FRAMED;  /* The backends write it like a compact seal */
+    } else if (flags & TRANSPORT_FRAMED) {
+        if (!g_transport->framed || seal_frame_len(data, len) != (int)len) return -1;
+    } else if (flags & TRANSPORT_BATCH) {
+        if (len != PAYLOAD_BYTES && (len < 2 + 8 || len > 2 + ROBOT_BATCH_MAX * 8 || (len - 2) % 8)) return -1;
+    } else if (len != 8 && len != PAYLOAD_BYTES) {
+        return -1;
+    }
+    return g_transport->send_frame(data, len, flags);
+}
+
+int transport_ready(void)
+{
+    return g_transport->ready ? g_transport->ready() : 1;
+}
+
+int transport_framed(void)
+{
+    return g_transport->framed;
+}
+
+int transport_batch_max(int sealed)
+{
+    int n = g_transport->batch_max ? g_transport->batch_max(sealed) : 1;
+    if (n > ROBOT_BATCH_MAX) n = ROBOT_BATCH_MAX;
+    return n < 1 ? 1 : n;
+}
+
+// ------------------------- Backend helpers -------------------------
+
+void transport_deliver(const uint8_t *data, size_t len, int whole)
+{
+    if (g_rx && len) g_rx(data, len, whole);
+}
+
+void transport_link(int up)
+{
+    if (g_link) g_link(up);
+}
+
+/* O_NONBLOCK UART: only waits while the tty buffer drains */
+int transport_write(int fd, const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+    rec_put(REC_UART_TX, 0, buf, len);
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        if (n > 0) { p += n; len -= (size_t)n; METRIC_ADD(uart_tx_bytes, n); continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) {
+            struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+            if (poll(&pfd, 1, 100) > 0) continue;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/* RN modules take the address as 12 hex digits */
+int transport_mac_compact(const char *mac, char *out, size_t out_len)
+{
+    size_t n = 0;
+    if (!mac || out_len < 13) return -1;
+    for (; *mac; mac++) {
+        if (*mac == ':' || *mac == '-') continue;
+        if (!isxdigit((unsigned char)*mac) || n == 12) return -1;
+        out[n++] = (char)toupper((unsigned char)*mac);
+    }
+    out[n] = '\0';
+    return n == 12 ? 0 : -1;
+}
@@ -0,0 +1,94 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "at_engine.h"
+
+/*
+ * Robot link transports.
+ *
+ * The TX scheduler and the crypto layer hand finished robot frames (an
+ * 8-byte word or a PAYLOAD_BYTES sealed payload; with TRANSPORT_BATCH a
+ * plain ROBOT_BATCH_MAGIC | n | n words frame or the seal of [n][n words];
+ * with TRANSPORT_FRAMED a compact seal already framed for the link, see
+ * compact_seal.h) to whichever transport
+ * was selected at start-up (GS_TRANSPORT), and robot reports come back
+ * through the rx handler the bridge installs. Every backend is
+ * non-blocking: module dialogues are state machines driven by the UART fd
+ * becoming readable (poll_rx) and by one timer (timer), never by sleeps.
+ *
+ *   esp-at   PmodESP32 over ESP-AT (default). Its reader thread, AT engine,
+ *            link supervisor and radios stay as they are; the ops here
+ *            cover sending, readiness and link state.
+ *   rn42     RN-42 classic SPP ($$$ / C,<mac> / ---), frames as
+ *            0x0A | 156 bytes | 0x0D, reports as a raw byte stream
+ *            (GS_RN42_FRAME=crc: CRC-32C v2 frames both ways, frame_crc.h).
+ *   rn4871   RN4871 BLE client (C,0,<mac> / CI / CHW writes in hex),
+ *            reports from %-delimited notification status strings.
+ *   l2cap    The GS's own Bluetooth controller (Linux), one LE L2CAP
+ *            channel to the robot's ROBOT_L2CAP_PSM; no UART at all.
+ *   hci      PmodESP32 as an HCI-over-UART controller under the Linux
+ *            stack; a raw ATT client on the robot's GATT service.
+ *
+ * The RN, l2cap and hci backends drive one robot. Building with GS_NO_RN
+ * (make RN=0) leaves them out.
+ */
+
+#define TRANSPORT_STREAM  0x1               /* CONTROL / ARM: write-without-response eligible */
+#define TRANSPORT_BATCH   0x2               /* Several words in one frame (batch_max) */
+#define TRANSPORT_FRAMED  0x4               /* Compact seal: a whole link frame, written as-is */
+#define TRANSPORT_URGENT  0x8               /* E-stop: ahead of everything queued (esp-at only) */
+#define TRANSPORT_ECHO    0x10              /* LINK_ECHO_TAG frame (link_bench.h): written as-is, like FRAMED */
+
+enum { TRANSPORT_DOWN = 0, TRANSPORT_CONNECTING, TRANSPORT_UP };
+
+/* whole = 1: one complete report; 0: a chunk of an unframed byte stream */
+typedef void (*transport_rx_fn)(const uint8_t *data, size_t len, int whole);
+typedef void (*transport_link_fn)(int up);
+
+typedef struct {
+    const char *name;
+    int  (*open)(int uart_fd, at_timer_fn arm_timer);   /* UART already configured */
+    int  (*connect)(const char *mac);       /* Async; result through the link handler */
+    int  (*send_frame)(const uint8_t *data, size_t len, int flags);  /* 0 = written or queued */
+    void (*poll_rx)(void);                  /* UART readable */
+    void (*timer)(void);                    /* The backend's timer fired */
+    int  (*link_state)(void);
+    int  (*ready)(void);                    /* 1 = a frame sent now goes straight out */
+    int  (*batch_max)(int sealed);          /* Words one TRANSPORT_BATCH frame may carry (NULL = 1) */
+    int  (*fd)(void);                       /* Watched for poll_rx instead of a UART (NULL = UART) */
+    int  baud;                              /* Module's UART rate, bit/s (0 = leave it) */
+    int  rtscts;                            /* Hardware flow control on the UART */
+    int  no_uart;                           /* The UART is not opened at all */
+    int  framed;                            /* Takes TRANSPORT_FRAMED (the robot's BLE firmware) */
+} transport_ops_t;
+
+extern const transport_ops_t transport_esp_at;
+extern const transport_ops_t transport_l2cap;
+extern const transport_ops_t transport_hci;
+#ifndef GS_NO_RN
+extern const transport_ops_t transport_rn42;
+extern const transport_ops_t transport_rn4871;
+#define TRANSPORT_NAMES "esp-at, l2cap, hci, rn42, rn4871"
+#else
+#define TRANSPORT_NAMES "esp-at, l2cap, hci"
+#endif
+
+int  transport_select(const char *name);    /* NULL / "" = esp-at; -1 = unknown name */
+const transport_ops_t *transport(void);
+int  transport_is_esp(void);
+void transport_set_handlers(transport_rx_fn rx, transport_link_fn link);
+
+int  transport_send_frame(const uint8_t *data, size_t len, int flags);
+int  transport_ready(void);
+int  transport_batch_max(int sealed);       /* 1 = no batching */
+int  transport_framed(void);                /* 1 = compact seals can go out */
+
+/* For the backends */
+void transport_deliver(const uint8_t *data, size_t len, int whole);
+void transport_link(int up);
+int  transport_write(int fd, const void *buf, size_t len);
+int  transport_mac_compact(const char *mac, char *out, size_t out_len);   /* "AA:BB.." -> "AABB.." */
+
+#endif
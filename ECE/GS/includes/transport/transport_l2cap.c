@@ -0,0 +1,476 @@
+#include "transport.h"
+#include "pmod_esp32.h"
+#include "../cmd_parser/cmd_parser.h"
+#include "../metrics/metrics.h"
+#include <endian.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/*
+ * Robot links on the Linux Bluetooth stack: binary socket operations with
+ * kernel buffering instead of AT strings. Two backends share the socket
+ * plumbing here:
+ *
+ *   l2cap  One LE credit-based channel to the robot's ROBOT_L2CAP_PSM, on
+ *          whatever controller the kernel has (no UART opened). Every send
+ *          is one SDU carrying a whole frame, every recv one whole report.
+ *   hci    The PmodESP32 flashed with ESP-IDF's HCI-over-UART controller
+ *          firmware instead of ESP-AT: open() attaches the UART as an hci
+ *          device (N_HCI line discipline, H4, brought up); GS_HCI_ATTACH=0
+ *          skips that when btattach already did it. The link is a raw ATT
+ *          socket (fixed channel 4) running a minimal GATT client: MTU
+ *          exchange, Read By Type for the 0xFF01 / 0xFF02 value handles,
+ *          the CCCD write, then Write Commands out and notifications in.
+ *
+ * Frames go out as the robot's framer expects them on a write: a word, a
+ * plain batch or a compact seal as they are, a sealed packet framed
+ * 0x0A 0xD0 .. 0xDA 0x0D (0xD1 for a batch). An ATT write longer than the
+ * MTU allows is cut; the robot reassembles the stream. ready() is the
+ * socket being writable, so the channel's credits or the controller's ACL
+ * buffers pace the scheduler. The socket changes with every connect; the
+ * bridge watches one epoll fd (link_fd) that holds it. Only the kernel ABI
+ * is used (no libbluetooth, no bluetoothd): the robot's address is public
+ * unless GS_L2CAP_RANDOM=1.
+ */
+
+#define BT_AF               31              /* AF_BLUETOOTH */
+#define BT_PROTO_L2CAP      0
+#define BT_PROTO_HCI        1
+#define BT_SOL              274             /* SOL_BLUETOOTH */
+#define BT_OPT_RCVMTU       13              /* BT_RCVMTU */
+#define BT_LE_PUBLIC        1               /* BDADDR_LE_PUBLIC */
+#define BT_LE_RANDOM        2               /* BDADDR_LE_RANDOM */
+#define BT_ATT_CID          4
+#define HCI_LDISC           15              /* N_HCI */
+#define HCI_UART_H4         0
+#define HCIUARTSETPROTO     _IOW('U', 200, int)
+#define HCIUARTGETDEVICE    _IOR('U', 202, int)
+#define HCIDEVUP            _IOW('H', 201, int)
+
+#define LINK_CONNECT_MS     10000
+#define LINK_SETUP_MS       3000            /* Each ATT request during setup */
+#define LINK_SDU_MAX        ROBOT_L2CAP_MTU
+
+#define ATT_MTU_WANT        247
+#define ATT_ERROR_RSP       0x01
+#define ATT_MTU_REQ         0x02
+#define ATT_MTU_RSP         0x03
+#define ATT_READ_TYPE_REQ   0x08
+#define ATT_READ_TYPE_RSP   0x09
+#define ATT_WRITE_REQ       0x12
+#define ATT_WRITE_RSP       0x13
+#define ATT_NOTIFY          0x1B
+#define ATT_INDICATE        0x1D
+#define ATT_CONFIRM         0x1E
+#define ATT_WRITE_CMD       0x52
+#define ATT_ERR_NOT_FOUND   0x0A
+#define ATT_ERR_UNSUPPORTED 0x06
+#define GATT_CHAR_DECL      0x2803
+#define ROBOT_TX_UUID       0xFF01          /* GS -> robot */
+#define ROBOT_RX_UUID       0xFF02          /* Robot -> GS, notify */
+
+struct bt_sockaddr {                        /* struct sockaddr_l2 */
+    sa_family_t family;
+    uint16_t    psm;                        /* Little endian */
+    uint8_t     bdaddr[6];                  /* Least significant byte first */
+    uint16_t    cid;                        /* Little endian */
+    uint8_t     bdaddr_type;
+};
+
+typedef enum {
+    LINK_DOWN = 0,
+    LINK_CONNECTING,                        /* connect() in progress */
+    LINK_ATT_MTU,                           /* hci: MTU request sent */
+    LINK_ATT_DISCOVER,                      /* hci: Read By Type sent */
+    LINK_ATT_CCCD,                          /* hci: CCCD write sent */
+    LINK_UP
+} link_state_t;
+
+static int          g_ep    = -1;           /* Watched by the bridge */
+static int          g_sock  = -1;
+static int          g_att   = 0;            /* 1: hci backend (ATT), 0: CoC */
+static link_state_t g_state = LINK_DOWN;
+static at_timer_fn  g_arm   = NULL;
+static const char  *g_tag   = "L2CAP";
+
+static uint16_t g_att_mtu = 23;
+static uint16_t g_tx_handle, g_rx_handle;  /* Value handles; the CCCD follows g_rx_handle */
+
+static void arm(int ms)
+{
+    if (g_arm) g_arm(ms);
+}
+
+static void link_down(const char *why)
+{
+    int was_up = g_state == LINK_UP;
+    if (why) fprintf(stderr, "%s: %s\n", g_tag, why);
+    if (g_sock >= 0) close(g_sock);         /* Leaves the epoll set with it */
+    g_sock = -1;
+    g_state = LINK_DOWN;
+    arm(0);
+    if (why || was_up) transport_link(0);
+}
+
+static void link_up(void)
+{
+    g_state = LINK_UP;
+    arm(0);
+    transport_link(1);
+}
+
+static int sock_send(const uint8_t *data, size_t len)
+{
+    ssize_t n = send(g_sock, data, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n != (ssize_t)len) return -1;       /* No credits / ACL room: the scheduler holds it */
+    METRIC_ADD(uart_tx_bytes, n);
+    return 0;
+}
+
+/* "AA:BB:CC:DD:EE:FF" -> kernel order */
+static int parse_mac(const char *mac, uint8_t out[6])
+{
+    char hex[13];
+    if (transport_mac_compact(mac, hex, sizeof(hex)) != 0) return -1;
+    for (int i = 0; i < 6; i++) {
+        unsigned v;
+        if (sscanf(hex + 2 * i, "%2x", &v) != 1) return -1;
+        out[5 - i] = (uint8_t)v;
+    }
+    return 0;
+}
+
+static int link_open(int att, at_timer_fn arm_timer)
+{
+    g_att = att;
+    g_tag = att ? "HCI" : "L2CAP";
+    g_arm = arm_timer;
+    g_state = LINK_DOWN;
+    if (g_ep < 0) g_ep = epoll_create1(EPOLL_CLOEXEC);
+    return g_ep < 0 ? -1 : 0;
+}
+
+static int link_fd(void)
+{
+    return g_ep;
+}
+
+static int link_connect(const char *mac)
+{
+    if (g_state != LINK_DOWN) return g_state == LINK_UP ? 0 : -1;
+    const char *rnd = getenv("GS_L2CAP_RANDOM");
+    uint8_t type = rnd && strcmp(rnd, "1") == 0 ? BT_LE_RANDOM : BT_LE_PUBLIC;
+
+    struct bt_sockaddr local = { .family = BT_AF, .bdaddr_type = BT_LE_PUBLIC };
+    struct bt_sockaddr peer  = { .family = BT_AF, .bdaddr_type = type };
+    if (g_att) {
+        local.cid = htole16(BT_ATT_CID);
+        peer.cid  = htole16(BT_ATT_CID);
+    } else {
+        peer.psm  = htole16(ROBOT_L2CAP_PSM);
+    }
+    if (parse_mac(mac, peer.bdaddr) != 0) return -1;
+
+    g_sock = socket(BT_AF, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, BT_PROTO_L2CAP);
+    if (g_sock < 0) {
+        fprintf(stderr, "%s: no Bluetooth socket (%s)\n", g_tag, strerror(errno));
+        return -1;
+    }
+    uint16_t mtu = LINK_SDU_MAX;
+    struct epoll_event ev = { .events = EPOLLOUT | EPOLLIN, .data.fd = g_sock };
+    if (bind(g_sock, (struct sockaddr *)&local, sizeof(local)) != 0 ||
+        (!g_att && setsockopt(g_sock, BT_SOL, BT_OPT_RCVMTU, &mtu, sizeof(mtu)) != 0) ||
+        (connect(g_sock, (struct sockaddr *)&peer, sizeof(peer)) != 0 && errno != EINPROGRESS) ||
+        epoll_ctl(g_ep, EPOLL_CTL_ADD, g_sock, &ev) != 0) {
+        fprintf(stderr, "%s: connect to %s not started (%s)\n", g_tag, mac, strerror(errno));
+        close(g_sock);
+        g_sock = -1;
+        return -1;
+    }
+    g_state = LINK_CONNECTING;
+    arm(LINK_CONNECT_MS);
+    return 0;
+}
+
+// ------------------------- ATT client (hci) -------------------------
+
+static int att_read_type(uint16_t start)
+{
+    uint8_t req[7] = { ATT_READ_TYPE_REQ, (uint8_t)start, (uint8_t)(start >> 8), 0xFF, 0xFF,
+                       (uint8_t)GATT_CHAR_DECL, (uint8_t)(GATT_CHAR_DECL >> 8) };
+    g_state = LINK_ATT_DISCOVER;
+    arm(LINK_SETUP_MS);
+    return sock_send(req, sizeof(req));
+}
+
+static void att_write_cccd(void)
+{
+    uint16_t cccd = (uint16_t)(g_rx_handle + 1);
+    uint8_t req[5] = { ATT_WRITE_REQ, (uint8_t)cccd, (uint8_t)(cccd >> 8), 0x01, 0x00 };
+    g_state = LINK_ATT_CCCD;
+    arm(LINK_SETUP_MS);
+    if (sock_send(req, sizeof(req)) != 0) link_down("CCCD write not sent");
+}
+
+/* Characteristic declarations: handle(2) props(1) value handle(2) uuid */
+static void att_on_chars(const uint8_t *p, size_t len)
+{
+    if (len < 2 || p[1] < 7) {
+        link_down("bad Read By Type response");
+        return;
+    }
+    size_t each = p[1];
+    uint16_t last = 0;
+    for (size_t off = 2; off + each <= len; off += each) {
+        const uint8_t *e = p + off;
+        last = (uint16_t)(e[0] | e[1] << 8);
+        if (each != 7) continue;            /* 128-bit UUIDs: not ours */
+        uint16_t value = (uint16_t)(e[3] | e[4] << 8);
+        uint16_t uuid  = (uint16_t)(e[5] | e[6] << 8);
+        if (uuid == ROBOT_TX_UUID) g_tx_handle = value;
+        if (uuid == ROBOT_RX_UUID) g_rx_handle = value;
+    }
+    if (g_tx_handle && g_rx_handle) att_write_cccd();
+    else if (last == 0xFFFF || att_read_type((uint16_t)(last + 1)) != 0) link_down("robot service not found");
+}
+
+/* The robot's host may ask things of us too (its own MTU exchange, mostly) */
+static void att_on_request(const uint8_t *p, size_t len)
+{
+    if (p[0] == ATT_MTU_REQ && len >= 3) {
+        uint8_t rsp[3] = { ATT_MTU_RSP, (uint8_t)ATT_MTU_WANT, ATT_MTU_WANT >> 8 };
+        uint16_t theirs = (uint16_t)(p[1] | p[2] << 8);
+        g_att_mtu = theirs < ATT_MTU_WANT ? theirs : ATT_MTU_WANT;
+        sock_send(rsp, sizeof(rsp));
+        return;
+    }
+    uint8_t err[5] = { ATT_ERROR_RSP, p[0], 0, 0, ATT_ERR_UNSUPPORTED };
+    sock_send(err, sizeof(err));
+}
+
+static void att_on_pdu(const uint8_t *p, size_t len)
+{
+    if (len == 0) return;
+    uint8_t op = p[0];
+    if (op == ATT_NOTIFY || op == ATT_INDICATE) {
+        if (op == ATT_INDICATE) {
+            uint8_t c = ATT_CONFIRM;
+            sock_send(&c, 1);
+        }
+        if (len > 3 && g_state == LINK_UP && (uint16_t)(p[1] | p[2] << 8) == g_rx_handle)
+            transport_deliver(p + 3, len - 3, 1);
+        return;
+    }
+    if (!(op & 0x40) && !(op & 1) && op != ATT_CONFIRM) {
+        att_on_request(p, len);             /* Even opcodes without the command bit */
+        return;
+    }
+
+    switch (g_state) {
+    case LINK_ATT_MTU:
+        if (op == ATT_MTU_RSP && len >= 3) {
+            uint16_t theirs = (uint16_t)(p[1] | p[2] << 8);
+            g_att_mtu = theirs < ATT_MTU_WANT ? theirs : ATT_MTU_WANT;
+        }
+        if ((op == ATT_MTU_RSP || op == ATT_ERROR_RSP) && att_read_type(0x0001) != 0)
+            link_down("discovery not sent");
+        break;
+    case LINK_ATT_DISCOVER:
+        if (op == ATT_READ_TYPE_RSP) att_on_chars(p, len);
+        else if (op == ATT_ERROR_RSP)
+            link_down(len >= 5 && p[4] == ATT_ERR_NOT_FOUND ? "robot service not found" : "discovery refused");
+        break;
+    case LINK_ATT_CCCD:
+        if (op == ATT_WRITE_RSP) {
+            fprintf(stderr, "HCI: robot up (ATT MTU %u, TX 0x%04x, RX 0x%04x)\n",
+                    g_att_mtu, g_tx_handle, g_rx_handle);
+            link_up();
+        } else if (op == ATT_ERROR_RSP) {
+            link_down("notifications refused");
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// ------------------------- Socket events -------------------------
+
+static void on_connected(void)
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(g_sock, SOL_SOCKET, SO_ERROR, &err, &len) != 0) err = errno;
+    if (err) {
+        char why[96];
+        snprintf(why, sizeof(why), "connect failed (%s)", strerror(err));
+        link_down(why);
+        return;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = g_sock };
+    epoll_ctl(g_ep, EPOLL_CTL_MOD, g_sock, &ev);
+    if (!g_att) {
+        link_up();
+        return;
+    }
+    uint8_t req[3] = { ATT_MTU_REQ, (uint8_t)ATT_MTU_WANT, ATT_MTU_WANT >> 8 };
+    g_att_mtu = 23;
+    g_tx_handle = g_rx_handle = 0;
+    g_state = LINK_ATT_MTU;
+    arm(LINK_SETUP_MS);
+    if (sock_send(req, sizeof(req)) != 0) link_down("MTU request not sent");
+}
+
+static void link_poll_rx(void)
+{
+    struct epoll_event ev;
+    while (g_sock >= 0 && epoll_wait(g_ep, &ev, 1, 0) == 1) {
+        if (g_state == LINK_CONNECTING) {
+            on_connected();
+            continue;
+        }
+        uint8_t sdu[LINK_SDU_MAX];
+        ssize_t n;
+        while (g_sock >= 0 && (n = recv(g_sock, sdu, sizeof(sdu), 0)) > 0) {
+            METRIC_ADD(uart_rx_bytes, n);
+            if (g_att) att_on_pdu(sdu, (size_t)n);
+            else transport_deliver(sdu, (size_t)n, 1);
+        }
+        if (g_sock < 0) return;             /* A PDU took the link down */
+        if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            link_down(n == 0 ? NULL : strerror(errno));
+            return;
+        }
+        if (ev.events & (EPOLLHUP | EPOLLERR)) {
+            link_down(NULL);
+            return;
+        }
+    }
+}
+
+static void link_timer(void)
+{
+    if (g_state == LINK_CONNECTING) link_down("connect timed out");
+    else if (g_state != LINK_DOWN && g_state != LINK_UP) link_down("no ATT response during setup");
+}
+
+static int link_send_frame(const uint8_t *data, size_t len, int flags)
+{
+    uint8_t packet[PACKET_BYTES];
+    if (g_state != LINK_UP) return -1;
+    if (len == PAYLOAD_BYTES && !(flags & TRANSPORT_FRAMED)) {
+        packet[0] = 0x0A;
+        packet[1] = flags & TRANSPORT_BATCH ? ROBOT_CIPHER_MARK_BATCH : ROBOT_CIPHER_MARK;
+        memcpy(packet + 2, data, PAYLOAD_BYTES);
+        packet[PACKET_BYTES - 2] = 0xDA;
+        packet[PACKET_BYTES - 1] = 0x0D;
+        data = packet;
+        len = sizeof(packet);
+    }
+    if (!g_att) return sock_send(data, len);
+
+    uint8_t pdu[3 + PACKET_BYTES];
+    size_t chunk = (size_t)g_att_mtu - 3;
+    pdu[0] = ATT_WRITE_CMD;
+    pdu[1] = (uint8_t)g_tx_handle;
+    pdu[2] = (uint8_t)(g_tx_handle >> 8);
+    for (size_t off = 0; off < len; off += chunk) {
+        size_t k = len - off < chunk ? len - off : chunk;
+        memcpy(pdu + 3, data + off, k);
+        if (sock_send(pdu, 3 + k) != 0) return off ? 0 : -1;   /* A cut frame resyncs on the next 0x0A */
+    }
+    return 0;
+}
+
+static int link_state(void)
+{
+    if (g_state == LINK_UP) return TRANSPORT_UP;
+    return g_state == LINK_DOWN ? TRANSPORT_DOWN : TRANSPORT_CONNECTING;
+}
+
+static int link_ready(void)
+{
+    struct pollfd pfd = { .fd = g_sock, .events = POLLOUT };
+    return g_state == LINK_UP && poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLOUT);
+}
+
+static int link_batch_max(int sealed)
+{
+    if (sealed || !g_att) return ROBOT_BATCH_MAX;
+    int n = (g_att_mtu - 3 - 2) / 8;        /* A plain batch in one Write Command */
+    return n < ROBOT_BATCH_MAX ? n : ROBOT_BATCH_MAX;
+}
+
+// ------------------------- Backends -------------------------
+
+static int l2cap_open(int uart_fd, at_timer_fn arm_timer)
+{
+    (void)uart_fd;
+    return link_open(0, arm_timer);
+}
+
+/* N_HCI hands the UART to the kernel's H4 driver (the bridge never reads
+ * it again); closing the fd at exit detaches the controller */
+static int hci_attach(int uart_fd)
+{
+    int ldisc = HCI_LDISC, dev, s;
+    if (ioctl(uart_fd, TIOCSETD, &ldisc) != 0 || ioctl(uart_fd, HCIUARTSETPROTO, HCI_UART_H4) != 0 ||
+        (dev = ioctl(uart_fd, HCIUARTGETDEVICE, 0)) < 0) {
+        fprintf(stderr, "HCI: UART not attached (%s)\n", strerror(errno));
+        return -1;
+    }
+    s = socket(BT_AF, SOCK_RAW | SOCK_CLOEXEC, BT_PROTO_HCI);
+    if (s < 0 || (ioctl(s, HCIDEVUP, dev) != 0 && errno != EALREADY)) {
+        fprintf(stderr, "HCI: hci%d not brought up (%s)\n", dev, strerror(errno));
+        if (s >= 0) close(s);
+        return -1;
+    }
+    close(s);
+    fprintf(stderr, "HCI: controller on the UART is hci%d\n", dev);
+    return 0;
+}
+
+static int hci_open(int uart_fd, at_timer_fn arm_timer)
+{
+    const char *attach = getenv("GS_HCI_ATTACH");
+    if (!(attach && strcmp(attach, "0") == 0) && (uart_fd < 0 || hci_attach(uart_fd) != 0)) return -1;
+    return link_open(1, arm_timer);
+}
+
+const transport_ops_t transport_l2cap = {
+    .name       = "l2cap",
+    .open       = l2cap_open,
+    .connect    = link_connect,
+    .send_frame = link_send_frame,
+    .poll_rx    = link_poll_rx,
+    .timer      = link_timer,
+    .link_state = link_state,
+    .ready      = link_ready,
+    .batch_max  = link_batch_max,
+    .fd         = link_fd,
+    .no_uart    = 1,
+    .framed     = 1,
+};
+
+const transport_ops_t transport_hci = {
+    .name       = "hci",
+    .open       = hci_open,
+    .connect    = link_connect,
+    .send_frame = link_send_frame,
+    .poll_rx    = link_poll_rx,
+    .timer      = link_timer,
+    .link_state = link_state,
+    .ready      = link_ready,
+    .batch_max  = link_batch_max,
+    .fd         = link_fd,
+    .baud       = 921600,                   /* ESP-IDF's HCI UART default */
+    .rtscts     = 1,
+    .framed     = 1,
+};
@@ -0,0 +1,202 @@
+#include "transport.h"
+#include "pmod_esp32.h"
+#include "frame_crc.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * RN-42 classic SPP. The module is in data mode unless "$$$" put it into
+ * command mode; a successful C,<mac> drops it back into data mode on its
+ * own, a failed one is left with "---". The robot's SPP server takes every
+ * frame as 0x0A | 156 bytes | 0x0D (a word is zero-padded), and whatever
+ * the robot sends arrives as an unframed byte stream.
+ *
+ * GS_RN42_FRAME=crc switches both directions to the v2 frame (frame_crc.h):
+ * preamble, length and CRC-32C, for a robot-side SPP server that speaks it.
+ * Reports then come up as whole frames and a corrupted one is dropped here.
+ */
+
+#define RN42_CMD_MS      600                /* "$$$" -> "CMD" */
+#define RN42_CONNECT_MS  10000              /* C,<mac> -> CONNECT / CONNECT failed */
+#define RN42_EXIT_MS     500                /* "---" -> "END" */
+#define RN42_FRAME_LEN   (PAYLOAD_BYTES + 2)
+#define RN42_TEXT_MAX    128
+
+typedef enum {
+    RN42_IDLE = 0,                          /* Data mode, no link */
+    RN42_CMD,                               /* "$$$" sent */
+    RN42_CONNECTING,                        /* C,<mac> sent */
+    RN42_EXITING,                           /* "---" after a failure */
+    RN42_UP                                 /* Data mode, linked */
+} rn42_state_t;
+
+static int          g_fd    = -1;
+static at_timer_fn  g_arm   = NULL;
+static rn42_state_t g_state = RN42_IDLE;
+static char         g_mac[13];
+static char         g_text[RN42_TEXT_MAX];  /* Command-mode replies so far */
+static size_t       g_text_len = 0;
+static int          g_v2 = 0;               /* GS_RN42_FRAME=crc */
+static frame_v2_parser_t g_rx;
+
+static void arm(int ms)
+{
+    if (g_arm) g_arm(ms);
+}
+
+static int send_str(const char *s)
+{
+    return transport_write(g_fd, s, strlen(s));
+}
+
+static void enter(rn42_state_t st, int ms)
+{
+    g_state = st;
+    g_text_len = 0;
+    g_text[0] = '\0';
+    arm(ms);
+}
+
+static void fail(const char *why)
+{
+    fprintf(stderr, "RN42: %s\n", why);
+    if (send_str("---\r") == 0) enter(RN42_EXITING, RN42_EXIT_MS);
+    else enter(RN42_IDLE, 0);
+    transport_link(0);
+}
+
+static void on_text(void)
+{
+    switch (g_state) {
+    case RN42_CMD:
+        if (!strstr(g_text, "CMD")) return;
+        {
+            char cmd[32];
+            snprintf(cmd, sizeof(cmd), "C,%s\r", g_mac);
+            if (send_str(cmd) != 0) { fail("connect command not written"); return; }
+        }
+        enter(RN42_CONNECTING, RN42_CONNECT_MS);
+        return;
+    case RN42_CONNECTING:
+        if (strstr(g_text, "CONNECT failed") || strstr(g_text, "ERR") || strchr(g_text, '?')) {
+            fail("connect failed");
+            return;
+        }
+        if (strstr(g_text, "CONNECT")) {     /* Back in data mode by itself */
+            enter(RN42_UP, 0);
+            frame_v2_reset(&g_rx);
+            transport_link(1);
+        }
+        return;
+    case RN42_EXITING:
+        if (strstr(g_text, "END")) enter(RN42_IDLE, 0);
+        return;
+    default:
+        return;
+    }
+}
+
+static int rn42_open(int uart_fd, at_timer_fn arm_timer)
+{
+    if (uart_fd < 0) return -1;
+    const char *fr = getenv("GS_RN42_FRAME");
+    g_fd  = uart_fd;
+    g_arm = arm_timer;
+    g_v2  = fr && strcmp(fr, "crc") == 0;
+    if (g_v2) {
+        crc32c_init();
+        printf("RN42: v2 frames, CRC-32C (%s)\n", crc32c_impl());
+    }
+    enter(RN42_IDLE, 0);
+    return 0;
+}
+
+static int rn42_connect(const char *mac)
+{
+    if (g_state != RN42_IDLE) return g_state == RN42_UP ? 0 : -1;
+    if (transport_mac_compact(mac, g_mac, sizeof(g_mac)) != 0) return -1;
+    if (send_str("$$$") != 0) return -1;
+    enter(RN42_CMD, RN42_CMD_MS);
+    return 0;
+}
+
+static int rn42_send_frame(const uint8_t *data, size_t len, int flags)
+{
+    uint8_t frame[FRAME_V2_MAX > RN42_FRAME_LEN ? FRAME_V2_MAX : RN42_FRAME_LEN] = { 0 };
+    (void)flags;
+    if (g_state != RN42_UP) return -1;
+    if (g_v2) {
+        size_t n = frame_v2_pack(frame, data, len);
+        return n ? transport_write(g_fd, frame, n) : -1;
+    }
+
+    frame[0] = 0x0A;
+    memcpy(frame + 1, data, len);           /* Words are zero-padded */
+    frame[RN42_FRAME_LEN - 1] = 0x0D;
+    return transport_write(g_fd, frame, RN42_FRAME_LEN);
+}
+
+static void on_frame(const uint8_t *payload, size_t len, void *ctx)
+{
+    (void)ctx;
+    transport_deliver(payload, len, 1);
+}
+
+static void rn42_poll_rx(void)
+{
+    uint8_t buf[512];
+    ssize_t n;
+    while ((n = read(g_fd, buf, sizeof(buf))) > 0) {
+        if (g_state == RN42_UP) {
+            if (g_v2) frame_v2_feed(&g_rx, buf, (size_t)n, on_frame, NULL);
+            else transport_deliver(buf, (size_t)n, 0);
+            continue;
+        }
+        for (ssize_t i = 0; i < n; i++) {   /* Command mode: text, NULs dropped */
+            if (!buf[i]) continue;
+            if (g_text_len == sizeof(g_text) - 1) {
+                memmove(g_text, g_text + sizeof(g_text) / 2, sizeof(g_text) / 2);
+                g_text_len -= sizeof(g_text) / 2;
+            }
+            g_text[g_text_len++] = (char)buf[i];
+        }
+        g_text[g_text_len] = '\0';
+        on_text();
+    }
+}
+
+static void rn42_timer(void)
+{
+    switch (g_state) {
+    case RN42_CMD:        fail("no CMD prompt"); break;
+    case RN42_CONNECTING: fail("connect timed out"); break;
+    case RN42_EXITING:    enter(RN42_IDLE, 0); break;
+    default:              break;
+    }
+}
+
+static int rn42_link_state(void)
+{
+    if (g_state == RN42_UP) return TRANSPORT_UP;
+    return g_state == RN42_IDLE ? TRANSPORT_DOWN : TRANSPORT_CONNECTING;
+}
+
+static int rn42_ready(void)
+{
+    return g_state == RN42_UP;
+}
+
+const transport_ops_t transport_rn42 = {
+    .name       = "rn42",
+    .open       = rn42_open,
+    .connect    = rn42_connect,
+    .send_frame = rn42_send_frame,
+    .poll_rx    = rn42_poll_rx,
+    .timer      = rn42_timer,
+    .link_state = rn42_link_state,
+    .ready      = rn42_ready,
+    .baud       = 115200,
+};
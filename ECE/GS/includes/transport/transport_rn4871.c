@@ -0,0 +1,314 @@
+#define _GNU_SOURCE                         /* memmem() */
+#include "transport.h"
+#include "pmod_esp32.h"
+#include "../cmd_parser/cmd_parser.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * RN4871 BLE client. Bring-up is "$$$" (CMD> prompt), C,0,<mac> (%CONNECT
+ * status), CI (client mode) and a CCCD write enabling notifications; each
+ * step waits for its reply line, never for a fixed sleep. Writes to the
+ * robot's TX characteristic are CHW,<handle>,<hex> command lines, one in
+ * flight at a time until its AOK: a word is one line, a sealed packet is
+ * framed (0x0A 0xD0 .. 0xDA 0x0D, 0xD1 for a batch) and cut into ATT-sized
+ * lines, as are a plain batch and a compact seal (the robot reassembles
+ * the stream). Robot
+ * notifications come back as %<handle>,<hex>% status strings; %DISCONNECT%
+ * drops the link.
+ */
+
+#define RN4871_TX_HANDLE   "002A"           /* Robot TX characteristic value */
+#define RN4871_CCCD_HANDLE "002B"           /* Robot RX notify CCCD */
+#define RN4871_CHUNK_HEX   40               /* 20-byte writes: default ATT MTU */
+#define RN4871_TXQ         32               /* Command lines waiting for AOK (power of two) */
+#define RN4871_LINE_MAX    80
+#define RN4871_NOTIFY_MAX  244              /* Largest notification payload (MTU 247) */
+#define RN4871_CMD_MS      600
+#define RN4871_CONNECT_MS  10000
+#define RN4871_REPLY_MS    1000             /* Any other command -> AOK / Err */
+
+typedef enum {
+    RN4871_IDLE = 0,
+    RN4871_CMD,                             /* "$$$" sent */
+    RN4871_CONNECTING,                      /* C,0,<mac> sent */
+    RN4871_CLIENT,                          /* CI sent */
+    RN4871_NOTIFY,                          /* CCCD write sent */
+    RN4871_UP
+} rn4871_state_t;
+
+static int            g_fd    = -1;
+static at_timer_fn    g_arm   = NULL;
+static rn4871_state_t g_state = RN4871_IDLE;
+static char           g_mac[13];
+static char           g_rx[512];            /* Partial line / status string */
+static size_t         g_rx_len = 0;
+
+static char     g_txq[RN4871_TXQ][RN4871_LINE_MAX];
+static uint32_t g_txq_head = 0, g_txq_tail = 0;
+static int      g_tx_busy = 0;              /* Head line written, AOK pending */
+
+static void arm(int ms)
+{
+    if (g_arm) g_arm(ms);
+}
+
+static int send_str(const char *s)
+{
+    return transport_write(g_fd, s, strlen(s));
+}
+
+static void enter(rn4871_state_t st, int ms)
+{
+    g_state = st;
+    arm(ms);
+}
+
+static void tx_reset(void)
+{
+    g_txq_head = g_txq_tail = 0;
+    g_tx_busy = 0;
+}
+
+static void tx_kick(void)
+{
+    if (g_tx_busy || g_txq_head == g_txq_tail || g_state != RN4871_UP) return;
+    if (send_str(g_txq[g_txq_head & (RN4871_TXQ - 1)]) != 0) {
+        g_txq_head++;                       /* Lost on the UART: next line */
+        return;
+    }
+    g_tx_busy = 1;
+    arm(RN4871_REPLY_MS);
+}
+
+static void tx_done(void)
+{
+    if (!g_tx_busy) return;
+    g_tx_busy = 0;
+    g_txq_head++;
+    arm(0);
+    tx_kick();
+}
+
+static void link_down(const char *why)
+{
+    int was_up = g_state == RN4871_UP;
+    if (why) fprintf(stderr, "RN4871: %s\n", why);
+    tx_reset();
+    enter(RN4871_IDLE, 0);
+    if (why || was_up) transport_link(0);
+}
+
+static int hex_val(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+/* "%<handle>,<hex>" (status text between the % delimiters) */
+static void on_status(const char *s)
+{
+    if (strncmp(s, "DISCONNECT", 10) == 0) { link_down(g_state == RN4871_UP ? NULL : "disconnected"); return; }
+    if (strncmp(s, "CONNECT", 7) == 0) {
+        if (g_state != RN4871_CONNECTING) return;
+        if (send_str("CI\r") != 0) { link_down("CI not written"); return; }
+        enter(RN4871_CLIENT, RN4871_REPLY_MS);
+        return;
+    }
+
+    const char *comma = strrchr(s, ',');
+    if (g_state != RN4871_UP || !comma) return;
+    const char *hex = comma + 1;
+    size_t n = strlen(hex);
+    if (n == 0 || n % 2 || n / 2 > RN4871_NOTIFY_MAX) return;
+    uint8_t buf[RN4871_NOTIFY_MAX];
+    for (size_t i = 0; i < n / 2; i++) {
+        int hi = hex_val(hex[2 * i]), lo = hex_val(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return;       /* Some other status string */
+        buf[i] = (uint8_t)(hi << 4 | lo);
+    }
+    transport_deliver(buf, n / 2, 1);
+}
+
+static void on_line(const char *l)
+{
+    switch (g_state) {
+    case RN4871_CMD:
+        if (strstr(l, "CMD")) {
+            char cmd[32];
+            snprintf(cmd, sizeof(cmd), "C,0,%s\r", g_mac);
+            if (send_str(cmd) != 0) { link_down("connect command not written"); return; }
+            enter(RN4871_CONNECTING, RN4871_CONNECT_MS);
+        }
+        return;
+    case RN4871_CONNECTING:
+        if (strstr(l, "Err")) link_down("connect refused");
+        return;
+    case RN4871_CLIENT:
+        if (strstr(l, "AOK")) {
+            if (send_str("CHW," RN4871_CCCD_HANDLE ",0100\r") != 0) { link_down("CCCD write not written"); return; }
+            enter(RN4871_NOTIFY, RN4871_REPLY_MS);
+        } else if (strstr(l, "Err")) {
+            link_down("client mode refused");
+        }
+        return;
+    case RN4871_NOTIFY:
+        if (strstr(l, "AOK")) {
+            enter(RN4871_UP, 0);
+            transport_link(1);
+        } else if (strstr(l, "Err")) {
+            link_down("notifications refused");
+        }
+        return;
+    case RN4871_UP:
+        if (strstr(l, "AOK")) tx_done();
+        else if (strstr(l, "Err")) { fprintf(stderr, "RN4871: write refused\n"); tx_done(); }
+        return;
+    default:
+        return;
+    }
+}
+
+/* Lines end in \r or \n; %...% status strings may sit inside a line */
+static void rx_parse(void)
+{
+    size_t start = 0;
+    for (size_t i = 0; i < g_rx_len; i++) {
+        char c = g_rx[i];
+        if (c == '%') {
+            char *end = memchr(g_rx + i + 1, '%', g_rx_len - i - 1);
+            if (!end) break;                /* Status string still arriving */
+            *end = '\0';
+            on_status(g_rx + i + 1);
+            i = (size_t)(end - g_rx);
+            start = i + 1;
+        } else if (c == '\r' || c == '\n') {
+            g_rx[i] = '\0';
+            if (i > start) on_line(g_rx + start);
+            start = i + 1;
+        }
+    }
+    if (g_state == RN4871_CMD && start < g_rx_len &&          /* "CMD> " has no line end */
+        memmem(g_rx + start, g_rx_len - start, "CMD>", 4)) {
+        g_rx[g_rx_len] = '\0';
+        on_line(g_rx + start);
+        start = g_rx_len;
+    }
+    memmove(g_rx, g_rx + start, g_rx_len - start);
+    g_rx_len -= start;
+}
+
+static int rn4871_open(int uart_fd, at_timer_fn arm_timer)
+{
+    if (uart_fd < 0) return -1;
+    g_fd  = uart_fd;
+    g_arm = arm_timer;
+    g_rx_len = 0;
+    tx_reset();
+    enter(RN4871_IDLE, 0);
+    return 0;
+}
+
+static int rn4871_connect(const char *mac)
+{
+    if (g_state != RN4871_IDLE) return g_state == RN4871_UP ? 0 : -1;
+    if (transport_mac_compact(mac, g_mac, sizeof(g_mac)) != 0) return -1;
+    if (send_str("$$$") != 0) return -1;
+    enter(RN4871_CMD, RN4871_CMD_MS);
+    return 0;
+}
+
+static int queue_hex(const uint8_t *data, size_t len)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    size_t lines = (len * 2 + RN4871_CHUNK_HEX - 1) / RN4871_CHUNK_HEX;
+    if (RN4871_TXQ - (g_txq_tail - g_txq_head) < lines) return -1;
+
+    for (size_t off = 0; off < len; ) {
+        char *l = g_txq[g_txq_tail++ & (RN4871_TXQ - 1)];
+        size_t k = (size_t)snprintf(l, RN4871_LINE_MAX, "CHW," RN4871_TX_HANDLE ",");
+        for (size_t i = 0; i < RN4871_CHUNK_HEX / 2 && off < len; i++, off++) {
+            l[k++] = digits[data[off] >> 4];
+            l[k++] = digits[data[off] & 0xF];
+        }
+        l[k++] = '\r';
+        l[k] = '\0';
+    }
+    tx_kick();
+    return 0;
+}
+
+static int rn4871_send_frame(const uint8_t *data, size_t len, int flags)
+{
+    uint8_t packet[PACKET_BYTES];
+    if (g_state != RN4871_UP) return -1;
+    if (len != PAYLOAD_BYTES || (flags & TRANSPORT_FRAMED))    /* Word, plain batch or compact seal */
+        return queue_hex(data, len);
+
+    packet[0] = 0x0A;
+    packet[1] = flags & TRANSPORT_BATCH ? ROBOT_CIPHER_MARK_BATCH : ROBOT_CIPHER_MARK;
+    memcpy(packet + 2, data, PAYLOAD_BYTES);
+    packet[PACKET_BYTES - 2] = 0xDA;
+    packet[PACKET_BYTES - 1] = 0x0D;
+    return queue_hex(packet, sizeof(packet));
+}
+
+static void rn4871_poll_rx(void)
+{
+    ssize_t n;
+    while ((n = read(g_fd, g_rx + g_rx_len, sizeof(g_rx) - 1 - g_rx_len)) > 0) {
+        g_rx_len += (size_t)n;
+        rx_parse();
+        if (g_rx_len == sizeof(g_rx) - 1) g_rx_len = 0;        /* No delimiter in a full buffer */
+    }
+}
+
+static void rn4871_timer(void)
+{
+    switch (g_state) {
+    case RN4871_CMD:        link_down("no CMD prompt"); break;
+    case RN4871_CONNECTING: link_down("connect timed out"); break;
+    case RN4871_CLIENT:
+    case RN4871_NOTIFY:     link_down("no AOK during setup"); break;
+    case RN4871_UP:
+        if (g_tx_busy) { fprintf(stderr, "RN4871: no AOK, write dropped\n"); tx_done(); }
+        break;
+    default:
+        break;
+    }
+}
+
+static int rn4871_link_state(void)
+{
+    if (g_state == RN4871_UP) return TRANSPORT_UP;
+    return g_state == RN4871_IDLE ? TRANSPORT_DOWN : TRANSPORT_CONNECTING;
+}
+
+static int rn4871_ready(void)
+{
+    return g_state == RN4871_UP && g_txq_head == g_txq_tail;
+}
+
+static int rn4871_batch_max(int sealed)
+{
+    (void)sealed;
+    return ROBOT_BATCH_MAX;
+}
+
+const transport_ops_t transport_rn4871 = {
+    .name       = "rn4871",
+    .open       = rn4871_open,
+    .connect    = rn4871_connect,
+    .send_frame = rn4871_send_frame,
+    .poll_rx    = rn4871_poll_rx,
+    .timer      = rn4871_timer,
+    .link_state = rn4871_link_state,
+    .ready      = rn4871_ready,
+    .batch_max  = rn4871_batch_max,
+    .baud       = 921600,
+    .framed     = 1,
+};
@@ -0,0 +1,362 @@
+#include "tsdb.h"
+#include "../cmd_parser/report_json.h"
+#include "../metrics/metrics.h"
+#include "../log/gs_log.h"
+#include "../ble/pmod_esp32.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TSDB_BLOCK_BITS  (TSDB_BLOCK_BYTES * 8)
+#define TSDB_SAMPLE_BITS 113                // Worst case: 4 + 32 time, 2 + 5 + 6 + 64 value
+#define TSDB_FIELDS_MAX  REPORT_FIELDS_MAX
+#define TSDB_NO_WINDOW   0xFF               // No XOR window yet in this block
+
+typedef struct {
+  int32_t  next;                            // Next block of the series, -1 = none
+  int16_t  series;                          // Owner, -1 = free
+  uint16_t n;                               // Samples
+  uint16_t bits;                            // Bits of data written
+  uint8_t  lead, trail;                     // Last XOR window
+  int64_t  t_first, t_last, delta;
+  uint64_t v_first, v_last;
+  uint8_t  data[TSDB_BLOCK_BYTES];
+} tsdb_block_t;
+
+typedef struct {
+  int32_t head, tail;                       // Oldest and newest block, -1 = empty
+} tsdb_series_t;
+
+// Field names per source, in report_json's order
+static const char *const g_src_names[TSDB_SRCS] = { "HR", "NAV", "POSE", "INERT" };
+static const char *const g_field_names[TSDB_SRCS][TSDB_FIELDS_MAX] = {
+  { "battery", "security", "motor_enabled", "arm_enabled", "tx_queue", "tx_drops" },
+  { "px", "py", "pz", "speed" },
+  { "yaw", "pitch", "roll" },
+  { "ax", "ay", "az", "gx", "gy", "gz" },
+};
+static const int g_field_count[TSDB_SRCS] = { 6, 4, 3, 6 };
+
+#define SERIES(robot, src, f) (((robot) * TSDB_SRCS + (src)) * TSDB_FIELDS_MAX + (f))
+
+static tsdb_block_t  *g_blocks = NULL;
+static uint32_t       g_nblocks = 0, g_next = 0, g_used = 0;
+static tsdb_series_t  g_series[BLE_LINKS_MAX * TSDB_SRCS * TSDB_FIELDS_MAX];
+
+int64_t tsdb_now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void tsdb_setup(void) {
+  const char *mb = getenv("GS_TSDB_MB");
+  unsigned long size = (mb && mb[0]) ? strtoul(mb, NULL, 10) : TSDB_MB_DEFAULT;
+  free(g_blocks);
+  g_blocks = NULL;
+  g_nblocks = g_next = g_used = 0;
+  for (size_t i = 0; i < sizeof(g_series) / sizeof(g_series[0]); i++) g_series[i].head = g_series[i].tail = -1;
+  if (!size) return;
+
+  g_nblocks = (uint32_t)(size * 1024 * 1024 / sizeof(tsdb_block_t));
+  g_blocks = calloc(g_nblocks, sizeof(tsdb_block_t));
+  if (!g_blocks) {
+    LOG_WARN("Telemetry store: %lu MB not available, history off", size);
+    g_nblocks = 0;
+    return;
+  }
+  for (uint32_t i = 0; i < g_nblocks; i++) g_blocks[i].series = -1;
+  LOG_INFO("Telemetry store: %lu MB, %u blocks of %d bytes", size, g_nblocks, TSDB_BLOCK_BYTES);
+}
+
+int tsdb_enabled(void) {
+  return g_nblocks > 0;
+}
+
+uint64_t tsdb_bytes(void) {
+  return (uint64_t)g_used * sizeof(tsdb_block_t);
+}
+
+int tsdb_src(const char *name) {
+  for (int s = 0; s < TSDB_SRCS; s++) if (strcmp(name, g_src_names[s]) == 0) return s;
+  return -1;
+}
+
+int tsdb_field(int src, const char *name) {
+  for (int f = 0; f < g_field_count[src]; f++) if (strcmp(name, g_field_names[src][f]) == 0) return f;
+  return -1;
+}
+
+// ------------------------- Bits -------------------------
+
+static void put_bits(tsdb_block_t *b, uint64_t v, int n) {
+  while (n > 0) {                                          // MSB first, into zeroed bytes
+    int room = 8 - (b->bits & 7), take = n < room ? n : room;
+    uint8_t chunk = (uint8_t)((v >> (n - take)) & ((1u << take) - 1));
+    b->data[b->bits >> 3] |= (uint8_t)(chunk << (room - take));
+    b->bits += (uint16_t)take;
+    n -= take;
+  }
+}
+
+typedef struct {
+  const uint8_t *d;
+  uint32_t       pos;
+} bit_rd_t;
+
+static uint64_t get_bits(bit_rd_t *r, int n) {
+  uint64_t v = 0;
+  while (n > 0) {
+    int room = 8 - (r->pos & 7), take = n < room ? n : room;
+    v = v << take | ((uint64_t)(r->d[r->pos >> 3] >> (room - take)) & ((1u << take) - 1));
+    r->pos += (uint32_t)take;
+    n -= take;
+  }
+  return v;
+}
+
+static int64_t sign_extend(uint64_t v, int bits) {
+  return (int64_t)(v << (64 - bits)) >> (64 - bits);
+}
+
+// ------------------------- Append -------------------------
+
+// The next block in the ring; when all are in use that is the oldest one,
+// which is always the head of its series
+static tsdb_block_t *block_new(int series) {
+  uint32_t i = g_next;
+  g_next = (g_next + 1) % g_nblocks;
+  tsdb_block_t *b = &g_blocks[i];
+  if (b->series >= 0) {
+    tsdb_series_t *old = &g_series[b->series];
+    old->head = b->next;
+    if (old->head < 0) old->tail = -1;
+    METRIC_INC(tsdb_evicted);
+  } else {
+    g_used++;
+  }
+  memset(b, 0, sizeof(*b));
+  b->series = (int16_t)series;
+  b->next = -1;
+  b->lead = TSDB_NO_WINDOW;
+
+  tsdb_series_t *s = &g_series[series];
+  if (s->tail >= 0) g_blocks[s->tail].next = (int32_t)i;
+  else s->head = (int32_t)i;
+  s->tail = (int32_t)i;
+  return b;
+}
+
+static void append(int series, int64_t t, uint64_t v) {
+  tsdb_series_t *s = &g_series[series];
+  tsdb_block_t *b = s->tail >= 0 ? &g_blocks[s->tail] : NULL;
+  if (b && t < b->t_last) t = b->t_last;                  // Wall clock stepped back
+  int64_t delta = b ? t - b->t_last : 0, dod = b ? delta - b->delta : 0;
+
+  if (!b || b->bits + TSDB_SAMPLE_BITS > TSDB_BLOCK_BITS || b->n == UINT16_MAX
+      || dod < INT32_MIN || dod > INT32_MAX) {
+    b = block_new(series);
+    b->t_first = b->t_last = t;
+    b->v_first = b->v_last = v;
+    b->n = 1;
+    return;
+  }
+
+  if (dod == 0)                       put_bits(b, 0x0, 1);
+  else if (dod >= -64 && dod < 64)     { put_bits(b, 0x2, 2);  put_bits(b, (uint64_t)dod, 7); }
+  else if (dod >= -256 && dod < 256)   { put_bits(b, 0x6, 3);  put_bits(b, (uint64_t)dod, 9); }
+  else if (dod >= -2048 && dod < 2048) { put_bits(b, 0xE, 4);  put_bits(b, (uint64_t)dod, 12); }
+  else                                 { put_bits(b, 0xF, 4);  put_bits(b, (uint64_t)dod, 32); }
+
+  uint64_t x = v ^ b->v_last;
+  if (!x) {
+    put_bits(b, 0x0, 1);
+  } else {
+    int lead = __builtin_clzll(x), trail = __builtin_ctzll(x);
+    if (lead > 31) lead = 31;
+    if (b->lead != TSDB_NO_WINDOW && lead >= b->lead && trail >= b->trail) {
+      put_bits(b, 0x2, 2);
+      put_bits(b, x >> b->trail, 64 - b->lead - b->trail);
+    } else {
+      int sig = 64 - lead - trail;
+      put_bits(b, 0x3, 2);
+      put_bits(b, (uint64_t)lead, 5);
+      put_bits(b, (uint64_t)(sig - 1), 6);
+      put_bits(b, x >> trail, sig);
+      b->lead = (uint8_t)lead;
+      b->trail = (uint8_t)trail;
+    }
+  }
+  b->t_last = t;
+  b->delta = delta;
+  b->v_last = v;
+  b->n++;
+}
+
+void tsdb_sample(int robot, const robot_bt_packet_t *w) {
+  if (!g_nblocks || robot < 0 || robot >= BLE_LINKS_MAX) return;
+  int64_t v[REPORT_FIELDS_MAX];
+  const char *keys[REPORT_FIELDS_MAX];
+  int nf = robot_report_fields(*w, v, keys);
+  if (nf == 0) return;
+  int src = w->ctrl.type == HEALTH_CMD ? TSDB_SRC_HR : TSDB_SRC_NAV + (int)w->nav.part;
+  int64_t t = tsdb_now_ms();
+  for (int f = 0; f < nf; f++) append(SERIES(robot, src, f), t, (uint64_t)v[f]);
+  METRIC_ADD(tsdb_samples, nf);
+}
+
+// ------------------------- Query -------------------------
+
+typedef struct {
+  const tsdb_block_t *b;
+  bit_rd_t            rd;
+  uint16_t            i;
+  uint8_t             lead, trail;
+  int64_t             t, delta;
+  uint64_t            v;
+} block_rd_t;
+
+static void block_rd_init(block_rd_t *r, const tsdb_block_t *b) {
+  memset(r, 0, sizeof(*r));
+  r->b = b;
+  r->rd.d = b->data;
+}
+
+static int block_rd_next(block_rd_t *r, int64_t *t, int64_t *v) {
+  if (r->i >= r->b->n) return 0;
+  if (r->i++ == 0) {
+    r->t = r->b->t_first;
+    r->v = r->b->v_first;
+  } else {
+    int64_t dod = 0;
+    if (get_bits(&r->rd, 1)) {
+      if (!get_bits(&r->rd, 1))      dod = sign_extend(get_bits(&r->rd, 7), 7);
+      else if (!get_bits(&r->rd, 1)) dod = sign_extend(get_bits(&r->rd, 9), 9);
+      else if (!get_bits(&r->rd, 1)) dod = sign_extend(get_bits(&r->rd, 12), 12);
+      else                           dod = sign_extend(get_bits(&r->rd, 32), 32);
+    }
+    r->delta += dod;
+    r->t += r->delta;
+    if (get_bits(&r->rd, 1)) {
+      if (get_bits(&r->rd, 1)) {
+        r->lead = (uint8_t)get_bits(&r->rd, 5);
+        int sig = (int)get_bits(&r->rd, 6) + 1;
+        r->trail = (uint8_t)(64 - r->lead - sig);
+      }
+      r->v ^= get_bits(&r->rd, 64 - r->lead - r->trail) << r->trail;
+    }
+  }
+  *t = r->t;
+  *v = (int64_t)r->v;
+  return 1;
+}
+
+typedef struct {
+  char    *out;
+  size_t   n, end;                          // Write position, end of this field's share
+  int      points, limit;
+  int64_t  cut;                             // First point left out, INT64_MAX = none
+} emit_t;
+
+static int emit_point(emit_t *e, const char *p, int len, int64_t t) {
+  if (e->points >= e->limit || e->n + (size_t)len + 1 > e->end) {
+    e->cut = t;
+    return -1;
+  }
+  if (e->points++) e->out[e->n++] = ',';
+  memcpy(e->out + e->n, p, (size_t)len);
+  e->n += (size_t)len;
+  return 0;
+}
+
+typedef struct {
+  int64_t  t0, min, max, sum;
+  uint32_t n;
+} bucket_t;
+
+static int emit_bucket(emit_t *e, const bucket_t *k) {
+  char p[96];
+  int len = snprintf(p, sizeof(p), "[%lld,%lld,%lld,%.2f]", (long long)k->t0, (long long)k->min,
+                     (long long)k->max, (double)k->sum / k->n);
+  return emit_point(e, p, len, k->t0);
+}
+
+static void query_series(const tsdb_query_t *q, int series, emit_t *e) {
+  bucket_t k = { 0 };
+  for (int32_t i = g_series[series].head; i >= 0; i = g_blocks[i].next) {
+    const tsdb_block_t *b = &g_blocks[i];
+    if (b->t_last < q->from_ms) continue;
+    if (b->t_first > q->to_ms) break;
+    block_rd_t r;
+    block_rd_init(&r, b);
+    int64_t t, v;
+    while (block_rd_next(&r, &t, &v)) {
+      if (t < q->from_ms) continue;
+      if (t > q->to_ms) goto done;
+      if (!q->step_ms) {
+        char p[48];
+        int len = snprintf(p, sizeof(p), "[%lld,%lld]", (long long)t, (long long)v);
+        if (emit_point(e, p, len, t) != 0) return;
+        continue;
+      }
+      int64_t t0 = q->from_ms + (t - q->from_ms) / q->step_ms * q->step_ms;
+      if (k.n && t0 != k.t0) {
+        if (emit_bucket(e, &k) != 0) return;
+        k.n = 0;
+      }
+      if (!k.n) k = (bucket_t){ t0, v, v, 0, 0 };
+      if (v < k.min) k.min = v;
+      if (v > k.max) k.max = v;
+      k.sum += v;
+      k.n++;
+    }
+  }
+done:
+  if (k.n) emit_bucket(e, &k);
+}
+
+int tsdb_query_json(const tsdb_query_t *q, char *out, size_t cap) {
+  int src = q->src, nf = 0;
+  uint32_t fields = q->fields ? q->fields : (1u << g_field_count[src]) - 1;
+  for (int f = 0; f < g_field_count[src]; f++) nf += fields >> f & 1;
+
+  size_t n = 0;
+  n += (size_t)snprintf(out, cap, "{\"type\":\"TSQ\"");
+  if (q->rid >= 0) n += (size_t)snprintf(out + n, cap - n, ",\"rid\":%lld", (long long)q->rid);
+  n += (size_t)snprintf(out + n, cap - n, ",\"src\":\"%s\",\"robot\":%d,\"from\":%lld,\"to\":%lld,\"step\":%lld,\"fields\":{",
+                        g_src_names[src], q->robot, (long long)q->from_ms, (long long)q->to_ms, (long long)q->step_ms);
+  if (n + 64 >= cap) return -1;
+
+  // Each field gets an equal share of what is left, so a long one cannot
+  // starve the rest
+  size_t share = (cap - n - 64) / (size_t)(nf ? nf : 1);
+  int64_t next = INT64_MAX;
+  for (int f = 0, first = 1; f < g_field_count[src]; f++) {
+    if (!(fields >> f & 1)) continue;
+    n += (size_t)snprintf(out + n, cap - n, "%s\"%s\":[", first ? "" : ",", g_field_names[src][f]);
+    first = 0;
+    emit_t e = { out, n, n + share - 24, 0, q->limit > 0 && q->limit < TSDB_POINTS_MAX ? q->limit : TSDB_POINTS_MAX,
+                 INT64_MAX };
+    if (g_nblocks) query_series(q, SERIES(q->robot, src, f), &e);
+    n = e.n;
+    out[n++] = ']';
+    if (e.cut < next) next = e.cut;
+  }
+  n += (size_t)snprintf(out + n, cap - n, "}");
+  if (next != INT64_MAX) n += (size_t)snprintf(out + n, cap - n, ",\"next\":%lld", (long long)next);
+  n += (size_t)snprintf(out + n, cap - n, "}");
+  return n < cap ? (int)n : -1;
+}
+
+int tsdb_stats_json(int64_t rid, char *out, size_t cap) {
+  int64_t oldest = INT64_MAX;
+  for (size_t i = 0; i < sizeof(g_series) / sizeof(g_series[0]); i++) {
+    if (g_series[i].head >= 0 && g_blocks[g_series[i].head].t_first < oldest) oldest = g_blocks[g_series[i].head].t_first;
+  }
+  int n = snprintf(out, cap, "{\"type\":\"TSQ\"");
+  if (rid >= 0) n += snprintf(out + n, cap - (size_t)n, ",\"rid\":%lld", (long long)rid);
+  n += snprintf(out + n, cap - (size_t)n, ",\"blocks\":%u,\"blocks_max\":%u,\"bytes\":%llu,\"oldest\":%lld}",
+                g_used, g_nblocks, (unsigned long long)tsdb_bytes(), oldest == INT64_MAX ? 0LL : (long long)oldest);
+  return n < (int)cap ? n : -1;
+}
@@ -0,0 +1,72 @@
+#ifndef TSDB_H
+#define TSDB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../cmd_structure.h"
+
+// ------------------------- Telemetry store -------------------------
+// Every decoded HR (full reports, not heartbeats), NAV, POSE and INERT field
+// of every robot is kept as its own series, compressed the Gorilla way
+// (Pelkonen et al., VLDB 2015) into fixed-size blocks:
+//   time   wall clock ms; a block's first sample whole in its header, then
+//          the delta of deltas: '0' (same spacing) | '10'+7 | '110'+9 |
+//          '1110'+12 | '1111'+32 bits
+//   value  XOR with the previous one: '0' (same) | '10' + the bits inside
+//          the previous leading / trailing zero window | '11' + 5 bits
+//          leading zeros + 6 bits length - 1 + the meaningful bits
+// Steady 100 Hz telemetry costs a few bits per value, so hours of it fit in
+// GS_TSDB_MB (default TSDB_MB_DEFAULT; 0 = off), allocated once at start.
+// When the pool is used up the oldest block of all is reused: the store
+// always holds the most recent history.
+//
+// Queries come over the UDS (or the bridge's WebSocket):
+//   {"T":"TSQ","src":"NAV","robot":0,"fields":["px","py"],
+//    "from":ms,"to":ms,"step":ms,"limit":n,"rid":n}
+// src is HR, NAV, POSE or INERT; fields defaults to all of the source's,
+// to to now and from to a minute before it. step 0 returns the samples as
+// [t,v], step > 0 one [t,min,max,mean] per non-empty step-long bucket
+// (aligned to from). rid, if given, is echoed so a proxy can route the reply:
+//   {"type":"TSQ","rid":n,"src":"NAV","robot":0,"from":F,"to":T,"step":S,
+//    "fields":{"px":[[t,v],...],...},"next":t}
+// next is there when a field ran into limit (default and at most
+// TSDB_POINTS_MAX) or its share of the reply: ask again from there. Fields
+// that did not may return points past it. {"T":"TSQ"} without src returns
+// the store's size instead.
+//
+// METRICS: tsdb_samples (values stored), tsdb_evicted (blocks reused);
+// gauge tsdb_bytes (blocks in use).
+
+#ifdef GS_LOWMEM
+#define TSDB_MB_DEFAULT   2
+#define TSDB_REPLY_MAX    8192
+#else
+#define TSDB_MB_DEFAULT   16
+#define TSDB_REPLY_MAX    (48 * 1024)
+#endif
+#define TSDB_BLOCK_BYTES  512
+#define TSDB_POINTS_MAX   2000              // Per field and query
+
+enum { TSDB_SRC_HR, TSDB_SRC_NAV, TSDB_SRC_POSE, TSDB_SRC_INERT, TSDB_SRCS };
+
+typedef struct {
+  int      src;                             // TSDB_SRC_*
+  int      robot;
+  uint32_t fields;                          // Bit per field of src, 0 = all
+  int64_t  from_ms, to_ms;                  // Wall clock, inclusive
+  int64_t  step_ms;                         // 0 = samples as stored
+  int      limit;                           // Points per field, 0 = TSDB_POINTS_MAX
+  int64_t  rid;                             // Echoed when >= 0
+} tsdb_query_t;
+
+void     tsdb_setup(void);                                     // Reads GS_TSDB_MB
+int      tsdb_enabled(void);
+void     tsdb_sample(int robot, const robot_bt_packet_t *w);   // Every decoded report word
+int      tsdb_src(const char *name);                           // -1 = unknown
+int      tsdb_field(int src, const char *name);                // Index in src, -1 = unknown
+int64_t  tsdb_now_ms(void);                                    // The clock samples are stamped with
+int      tsdb_query_json(const tsdb_query_t *q, char *out, size_t cap); // Length, -1 = too small
+int      tsdb_stats_json(int64_t rid, char *out, size_t cap);
+uint64_t tsdb_bytes(void);
+
+#endif
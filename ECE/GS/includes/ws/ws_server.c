@@ -0,0 +1,293 @@
+#define _GNU_SOURCE                         // accept4, memmem
+#include "ws_server.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define WS_GUID      "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WS_KEY_MAX   64                     // A real key is 24 base64 chars
+
+// ------------------------- Accept key -------------------------
+// SHA-1 is only ever run over key + GUID (one or two blocks per Upgrade), so
+// a plain implementation does; the bridge may be built without OpenSSL.
+
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void sha1_block(uint32_t h[5], const uint8_t *p) {
+  uint32_t w[80];
+  for (int i = 0; i < 16; i++)
+    w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+  for (int i = 16; i < 80; i++) w[i] = ROL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+  uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+  for (int i = 0; i < 80; i++) {
+    uint32_t f, k;
+    if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+    else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+    else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+    else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+    uint32_t t = ROL(a, 5) + f + e + k + w[i];
+    e = d; d = c; c = ROL(b, 30); b = a; a = t;
+  }
+  h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+}
+
+static void sha1(const uint8_t *msg, size_t n, uint8_t out[20]) {
+  uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+  size_t off = 0;
+  for (; n - off >= 64; off += 64) sha1_block(h, msg + off);
+
+  uint8_t tail[128] = { 0 };                               // Rest + 0x80 + bit length
+  size_t rest = n - off, blocks = rest < 56 ? 1 : 2;
+  memcpy(tail, msg + off, rest);
+  tail[rest] = 0x80;
+  uint64_t bits = (uint64_t)n * 8;
+  for (int i = 0; i < 8; i++) tail[blocks * 64 - 1 - i] = (uint8_t)(bits >> (8 * i));
+  for (size_t b = 0; b < blocks; b++) sha1_block(h, tail + 64 * b);
+
+  for (int i = 0; i < 5; i++) {
+    out[4 * i]     = (uint8_t)(h[i] >> 24);
+    out[4 * i + 1] = (uint8_t)(h[i] >> 16);
+    out[4 * i + 2] = (uint8_t)(h[i] >> 8);
+    out[4 * i + 3] = (uint8_t)h[i];
+  }
+}
+
+static void base64(const uint8_t *in, size_t n, char *out) {
+  static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  size_t o = 0;
+  for (size_t i = 0; i < n; i += 3) {
+    uint32_t v = (uint32_t)in[i] << 16 | (i + 1 < n ? (uint32_t)in[i + 1] << 8 : 0) | (i + 2 < n ? in[i + 2] : 0);
+    out[o++] = tbl[(v >> 18) & 63];
+    out[o++] = tbl[(v >> 12) & 63];
+    out[o++] = i + 1 < n ? tbl[(v >> 6) & 63] : '=';
+    out[o++] = i + 2 < n ? tbl[v & 63] : '=';
+  }
+  out[o] = '\0';
+}
+
+// ------------------------- Upgrade -------------------------
+
+// Value of one request header (case-insensitive name), trimmed; NULL if absent
+static const char *hdr_value(const char *req, const char *name, size_t *vlen) {
+  size_t nlen = strlen(name);
+  for (const char *l = strstr(req, "\r\n"); l; l = strstr(l, "\r\n")) {
+    l += 2;
+    if (strncasecmp(l, name, nlen) != 0 || l[nlen] != ':') continue;
+    const char *v = l + nlen + 1, *end = strstr(v, "\r\n");
+    while (*v == ' ' || *v == '\t') v++;
+    while (end > v && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    *vlen = (size_t)(end - v);
+    return v;
+  }
+  return NULL;
+}
+
+// Comma-separated header value holds this token
+static int has_token(const char *v, size_t vlen, const char *tok) {
+  size_t tlen = strlen(tok);
+  const char *end = v + vlen;
+  while (v < end) {
+    while (v < end && (*v == ' ' || *v == ',')) v++;
+    const char *e = v;
+    while (e < end && *e != ',') e++;
+    const char *t = e;
+    while (t > v && t[-1] == ' ') t--;
+    if ((size_t)(t - v) == tlen && strncasecmp(v, tok, tlen) == 0) return 1;
+    v = e;
+  }
+  return 0;
+}
+
+static int send_all(int fd, const char *s, size_t n) {
+  while (n > 0) {
+    ssize_t w = send(fd, s, n, MSG_NOSIGNAL);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return -1;                                 // A fresh socket takes a header whole
+    s += w;
+    n -= (size_t)w;
+  }
+  return 0;
+}
+
+// 1 = answered, 0 = header incomplete, -1 = refused, -2 = oversized
+static int parse_upgrade(int fd, ws_conn_t *ws, int allow_rbw1) {
+  uint8_t *end = memmem(ws->buf, ws->len, "\r\n\r\n", 4);
+  if (!end) return ws->len == WS_RX_MAX ? -2 : 0;
+  uint32_t hlen = (uint32_t)(end + 4 - ws->buf);
+  end[2] = '\0';                                           // The last header line keeps its CRLF
+  const char *req = (const char *)ws->buf;
+
+  size_t klen = 0, ulen = 0, vlen = 0, plen = 0;
+  const char *key = hdr_value(req, "Sec-WebSocket-Key", &klen);
+  const char *upg = hdr_value(req, "Upgrade", &ulen);
+  const char *ver = hdr_value(req, "Sec-WebSocket-Version", &vlen);
+  const char *pro = hdr_value(req, "Sec-WebSocket-Protocol", &plen);
+  if (strncmp(req, "GET ", 4) != 0 || !key || klen == 0 || klen > WS_KEY_MAX
+      || !upg || !has_token(upg, ulen, "websocket") || !ver || vlen != 2 || strncmp(ver, "13", 2) != 0) {
+    static const char refuse[] = "HTTP/1.1 426 Upgrade Required\r\nSec-WebSocket-Version: 13\r\n"
+                                 "Content-Length: 0\r\nConnection: close\r\n\r\n";
+    send_all(fd, refuse, sizeof(refuse) - 1);
+    return -1;
+  }
+
+  char kg[WS_KEY_MAX + sizeof(WS_GUID)], accept_key[32];
+  uint8_t digest[20];
+  memcpy(kg, key, klen);
+  memcpy(kg + klen, WS_GUID, sizeof(WS_GUID) - 1);
+  sha1((const uint8_t *)kg, klen + sizeof(WS_GUID) - 1, digest);
+  base64(digest, sizeof(digest), accept_key);
+  ws->rbw1 = allow_rbw1 && pro && has_token(pro, plen, WS_SUBPROTO);
+
+  char resp[192];
+  int n = snprintf(resp, sizeof(resp),
+                   "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                   "Sec-WebSocket-Accept: %s\r\n%s\r\n",
+                   accept_key, ws->rbw1 ? "Sec-WebSocket-Protocol: " WS_SUBPROTO "\r\n" : "");
+  if (send_all(fd, resp, (size_t)n) != 0) return -1;
+
+  ws->len -= hlen;                                         // Frames sent right behind the request stay
+  memmove(ws->buf, ws->buf + hlen, ws->len);
+  ws->open = 1;
+  return 1;
+}
+
+// ------------------------- Frames -------------------------
+
+static int fail(ws_send_fn send, void *ctx, uint16_t code) {
+  uint8_t c[2] = { (uint8_t)(code >> 8), (uint8_t)code };
+  send(ctx, WS_OP_CLOSE, c, 2);
+  return -2;
+}
+
+// Hand fn a message in place with a NUL behind it (the byte there is put back)
+static int deliver(ws_msg_fn fn, void *ctx, int op, uint8_t *p, uint32_t n) {
+  uint8_t save = p[n];
+  p[n] = '\0';
+  int rc = fn(ctx, op, (char *)p, n);
+  p[n] = save;
+  return rc;
+}
+
+// Every complete frame in buf[pos..len). An unfragmented message (what the UI
+// sends) is handed up where it lies; fragments are moved down behind each
+// other at buf[0..msg). What is left over is compacted behind them.
+static int parse_frames(ws_conn_t *ws, ws_msg_fn fn, ws_send_fn send, void *ctx) {
+  while (ws->len - ws->pos >= 2) {
+    uint8_t *f = ws->buf + ws->pos;
+    uint32_t avail = ws->len - ws->pos, h = 2;
+    int fin = f[0] & 0x80, op = f[0] & 0x0F;
+    uint64_t plen = f[1] & 0x7F;
+
+    if ((f[0] & 0x70) || !(f[1] & 0x80)) return fail(send, ctx, 1002); // No extensions; clients mask
+    if (plen == 126) {
+      if (avail < 4) break;
+      plen = (uint64_t)f[2] << 8 | f[3];
+      h = 4;
+    } else if (plen == 127) {
+      if (avail < 10) break;
+      plen = 0;
+      for (int i = 0; i < 8; i++) plen = plen << 8 | f[2 + i];
+      h = 10;
+    }
+    h += 4;                                                // Masking key
+    if (plen > WS_RX_MAX || h + plen > WS_RX_MAX - ws->msg) return fail(send, ctx, 1009);
+    if (avail < h + plen) break;
+
+    uint8_t *p = f + h;
+    const uint8_t *mask = f + h - 4;
+    for (uint32_t i = 0; i < (uint32_t)plen; i++) p[i] ^= mask[i & 3];
+    ws->pos += h + (uint32_t)plen;
+
+    if (op & 0x8) {                                        // Control: may sit between fragments
+      if (!fin || plen > 125) return fail(send, ctx, 1002);
+      if (op == WS_OP_PING) send(ctx, WS_OP_PONG, p, (uint32_t)plen);
+      else if (op == WS_OP_CLOSE) {
+        send(ctx, WS_OP_CLOSE, p, plen >= 2 ? 2 : 0);      // Echo the status code
+        return -1;
+      } else if (op != WS_OP_PONG) return fail(send, ctx, 1002);
+      continue;
+    }
+    if (op != WS_OP_CONT && op != WS_OP_TEXT && op != WS_OP_BINARY) return fail(send, ctx, 1002);
+    if ((op == WS_OP_CONT) != (ws->frag_op != 0)) return fail(send, ctx, 1002);
+
+    if (fin && op != WS_OP_CONT) {                         // Whole message in one frame
+      if (deliver(fn, ctx, op, p, (uint32_t)plen) != 0) return -1;
+      continue;
+    }
+    if (op != WS_OP_CONT) ws->frag_op = op;
+    memmove(ws->buf + ws->msg, p, (size_t)plen);
+    ws->msg += (uint32_t)plen;
+    if (fin) {
+      int rc = deliver(fn, ctx, ws->frag_op, ws->buf, ws->msg);
+      ws->msg = 0;
+      ws->frag_op = 0;
+      if (rc != 0) return -1;
+    }
+  }
+
+  memmove(ws->buf + ws->msg, ws->buf + ws->pos, ws->len - ws->pos);
+  ws->len = ws->msg + (ws->len - ws->pos);
+  ws->pos = ws->msg;
+  return 0;
+}
+
+int ws_read(int fd, ws_conn_t *ws, int allow_rbw1, ws_msg_fn fn, ws_send_fn send, void *ctx) {
+  while (1) {
+    int rc = ws->open ? parse_frames(ws, fn, send, ctx) : parse_upgrade(fd, ws, allow_rbw1);
+    if (rc != 0) return rc;
+
+    ssize_t r = recv(fd, ws->buf + ws->len, WS_RX_MAX - ws->len, 0);
+    if (r > 0) { ws->len += (uint32_t)r; continue; }
+    if (r == 0) return -1;                                 // EOF
+    if (errno == EINTR) continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+    return -1;
+  }
+}
+
+void ws_conn_init(ws_conn_t *ws) {
+  ws->open = ws->rbw1 = ws->frag_op = 0;
+  ws->msg = ws->pos = ws->len = 0;                         // buf is left as is: only [0..len) counts
+}
+
+// ------------------------- Listener -------------------------
+
+int ws_listen(const char *bind_addr, int port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) { perror("socket ws"); return -1; }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)); // Restart without TIME_WAIT
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind_addr && bind_addr[0] && inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1) {
+    fprintf(stderr, "ws: bad bind address %s\n", bind_addr);
+    close(fd);
+    return -1;
+  }
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+    perror("bind/listen ws");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int ws_accept(int listen_fd) {
+  int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (fd < 0) return -1;
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // One small frame per keypress
+  return fd;
+}
@@ -0,0 +1,81 @@
+#ifndef WS_SERVER_H
+#define WS_SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ------------------------- Embedded WebSocket endpoint -------------------------
+// GS_WS_PORT=<n> opens a ws:// listener in the bridge itself, so the
+// controller UI can send its commands straight to the event loop instead of
+// through Node (which keeps serving the static assets and admin endpoints).
+// Server side of RFC 6455 only, no TLS and no extensions:
+//   - the HTTP Upgrade is read and answered in place (SHA-1 + base64 accept
+//     key, the "rbw1" sub-protocol when the client offers it and it is allowed)
+//   - client frames are unmasked in the connection's buffer and handed up one
+//     whole message at a time; fragments are joined, pings answered and a
+//     close echoed through the caller's send hook
+//   - server frames are never masked: ws_frame_hdr() builds the header and the
+//     bytes go out through the client's UDS send queue like any other frame
+// The UI protocol on top (the directionToC mapping, rbw1 words and their
+// batched acks) is the bridge's, see on_ws_message in gs_bridge2.c.
+
+#define WS_OP_CONT    0x0
+#define WS_OP_TEXT    0x1
+#define WS_OP_BINARY  0x2
+#define WS_OP_CLOSE   0x8
+#define WS_OP_PING    0x9
+#define WS_OP_PONG    0xA
+
+#define WS_HDR_MAX    10                 // Server frame header, 64-bit length form
+#define WS_SUBPROTO   "rbw1"             // Binary command words, as the Node server speaks it
+
+#ifndef WS_RX_MAX
+#ifdef GS_LOWMEM
+#define WS_RX_MAX     4096
+#else
+#define WS_RX_MAX     16384              // Largest message plus the frames queued behind it
+#endif
+#endif
+
+typedef int (*ws_msg_fn)(void *ctx, int op, char *msg, uint32_t len);           // nonzero = close
+typedef int (*ws_send_fn)(void *ctx, int op, const void *data, uint32_t len);   // Pong / close replies
+
+typedef struct {
+  int      open;                         // Upgrade answered, frames from here on
+  int      rbw1;                         // Binary word sub-protocol agreed
+  int      frag_op;                      // Opcode of the message being joined (0 = none)
+  uint32_t msg;                          // Joined fragment bytes at buf[0..msg)
+  uint32_t pos;                          // Unparsed bytes start here ...
+  uint32_t len;                          // ... and end here
+  uint8_t  buf[WS_RX_MAX + 1];           // +1: NUL behind a message handed up in place
+} ws_conn_t;
+
+int  ws_listen(const char *bind_addr, int port);          // Nonblocking TCP listener, NULL = any
+int  ws_accept(int listen_fd);                            // accept4 + TCP_NODELAY, -1 with errno
+void ws_conn_init(ws_conn_t *ws);
+
+// Drain the socket to EAGAIN. fn gets every whole message (NUL-terminated,
+// valid during the call). Returns 0 when drained, 1 right after the Upgrade
+// was answered (register the client, then call again for frames that came
+// with it), -1 on EOF / close / refused Upgrade, -2 on a protocol error.
+int  ws_read(int fd, ws_conn_t *ws, int allow_rbw1, ws_msg_fn fn, ws_send_fn send, void *ctx);
+
+// Unmasked server frame header for one whole message; returns its length
+static inline uint8_t ws_frame_hdr(uint8_t *hdr, int op, uint64_t len) {
+  hdr[0] = (uint8_t)(0x80 | op);                          // FIN: never fragmented
+  if (len < 126) {
+    hdr[1] = (uint8_t)len;
+    return 2;
+  }
+  if (len <= 0xFFFF) {
+    hdr[1] = 126;
+    hdr[2] = (uint8_t)(len >> 8);
+    hdr[3] = (uint8_t)len;
+    return 4;
+  }
+  hdr[1] = 127;
+  for (int i = 0; i < 8; i++) hdr[2 + i] = (uint8_t)(len >> (56 - 8 * i));
+  return 10;
+}
+
+#endif
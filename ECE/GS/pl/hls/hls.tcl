@@ -0,0 +1,21 @@
+# hls.tcl: synthesize pl_gcm.cpp and export it as a Vivado IP
+#   vitis_hls -f hls.tcl   (pl/Makefile: make ip)
+# Env: PL_PART (default the ZCU102's xczu9eg), PL_CLOCK_NS (default 4 = 250 MHz),
+#      VITIS_LIBS = a Vitis_Libraries checkout (security/L1/include is used)
+
+set part     [expr {[info exists ::env(PL_PART)]     ? $::env(PL_PART)     : "xczu9eg-ffvb1156-2-e"}]
+set clock_ns [expr {[info exists ::env(PL_CLOCK_NS)] ? $::env(PL_CLOCK_NS) : 4}]
+if {![info exists ::env(VITIS_LIBS)]} {
+    error "VITIS_LIBS must point at a Vitis_Libraries checkout"
+}
+set sec_inc $::env(VITIS_LIBS)/security/L1/include
+
+open_project -reset pl_gcm_prj
+set_top pl_gcm
+add_files pl_gcm.cpp -cflags "-I$sec_inc -std=c++14"
+open_solution -reset sol -flow_target vivado
+set_part $part
+create_clock -period $clock_ns -name default
+csynth_design
+export_design -format ip_catalog -vendor gs -library crypto -ipname pl_gcm -version 1.0
+exit
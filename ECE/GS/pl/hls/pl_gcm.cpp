@@ -0,0 +1,110 @@
+// pl_gcm.cpp
+// -----------------------------------------------------------------------------
+// AES-256-GCM stream core for the GS PL (Vitis HLS). One run of the top
+// function is one record; ap_ctrl_hs with auto_restart (set by pl_gcm.c)
+// keeps it running. Record format: includes/hardware_crypto/pl_gcm.h.
+//
+//   in   beat 0: [op][0][len lo][len hi][iv 12]; len / 16 payload beats;
+//        decrypt: one tag beat (TLAST on the last beat either way)
+//   out  len / 16 payload beats, then the trailer beat (TLAST):
+//        encrypt = tag, decrypt = byte 0 is 1 when the tag matched
+//
+// The GCM itself is the Vitis Security Library (L1 xf_security/gcm.hpp);
+// hls.tcl adds its include path. The key register holds key byte i at bits
+// 8i..8i+7 and a beat holds stream byte i at bits 8i..8i+7 (AXI DMA order);
+// to_lib()/from_lib() reorder into the library's byte order. The bridge's
+// crypto autoselect cross-checks every provider's ciphertext, so a core
+// that disagrees with AF_ALG is never selected.
+// -----------------------------------------------------------------------------
+#include <ap_axi_sdata.h>
+#include <ap_int.h>
+#include <hls_stream.h>
+
+#include "xf_security/gcm.hpp"
+
+typedef ap_axiu<128, 0, 0, 0> beat_t;
+
+#define PL_GCM_LEN_MAX 256
+
+// Byte i of x (bits 8i..) to byte W/8-1-i: the library works big-endian
+template <int W>
+static ap_uint<W> to_lib(ap_uint<W> x) {
+#pragma HLS INLINE
+    ap_uint<W> r;
+    for (int i = 0; i < W / 8; i++) {
+#pragma HLS UNROLL
+        r.range(W - 1 - 8 * i, W - 8 - 8 * i) = x.range(8 * i + 7, 8 * i);
+    }
+    return r;
+}
+
+template <int W>
+static ap_uint<W> from_lib(ap_uint<W> x) {
+#pragma HLS INLINE
+    return to_lib<W>(x);                                 // The swap is its own inverse
+}
+
+void pl_gcm(hls::stream<beat_t> &in, hls::stream<beat_t> &out, ap_uint<256> key) {
+#pragma HLS INTERFACE axis port=in
+#pragma HLS INTERFACE axis port=out
+#pragma HLS INTERFACE s_axilite port=key
+#pragma HLS INTERFACE s_axilite port=return
+
+    hls::stream<ap_uint<128> > data_s("data"), aad_s("aad"), res_s("res"), tag_s("tag");
+    hls::stream<ap_uint<256> > key_s("key");
+    hls::stream<ap_uint<96> >  iv_s("iv");
+    hls::stream<ap_uint<64> >  len_aad_s("len_aad"), len_s("len"), len_out_s("len_out");
+    hls::stream<bool>          end_len_s("end_len"), end_tag_s("end_tag");
+#pragma HLS STREAM variable=data_s depth=PL_GCM_LEN_MAX/16
+#pragma HLS STREAM variable=res_s  depth=PL_GCM_LEN_MAX/16
+
+    beat_t hdr = in.read();
+    ap_uint<8>  op  = hdr.data.range(7, 0);
+    ap_uint<16> len = hdr.data.range(31, 16);
+    ap_uint<16> beats = len >> 4;
+
+    for (ap_uint<16> i = 0; i < beats; i++) {
+#pragma HLS LOOP_TRIPCOUNT max=16
+#pragma HLS PIPELINE II=1
+        data_s.write(to_lib<128>(in.read().data));
+    }
+    ap_uint<128> want_tag = 0;
+    if (op == 1) want_tag = to_lib<128>(in.read().data);
+
+    key_s.write(to_lib<256>(key));
+    iv_s.write(to_lib<96>(hdr.data.range(127, 32)));
+    len_aad_s.write(0);                                  // No AAD: the robot link seals the payload only
+    len_s.write((ap_uint<64>)len);                       // Byte count, per the library's L1 tests
+    end_len_s.write(false);
+    end_len_s.write(true);
+
+    if (op == 0) {
+        xf::security::aes256GcmEncrypt(data_s, key_s, iv_s, aad_s, len_aad_s, len_s, end_len_s,
+                                       res_s, len_out_s, tag_s, end_tag_s);
+    } else {
+        xf::security::aes256GcmDecrypt(data_s, key_s, iv_s, aad_s, len_aad_s, len_s, end_len_s,
+                                       res_s, len_out_s, tag_s, end_tag_s);
+    }
+    len_out_s.read();
+    end_tag_s.read();
+    end_tag_s.read();                                    // The closing true
+
+    for (ap_uint<16> i = 0; i < beats; i++) {
+#pragma HLS LOOP_TRIPCOUNT max=16
+#pragma HLS PIPELINE II=1
+        beat_t b;
+        b.data = from_lib<128>(res_s.read());
+        b.keep = -1;
+        b.strb = -1;
+        b.last = 0;
+        out.write(b);
+    }
+
+    ap_uint<128> tag = tag_s.read();
+    beat_t t;
+    t.data = op == 0 ? from_lib<128>(tag) : ap_uint<128>(tag == want_tag ? 1 : 0);
+    t.keep = -1;
+    t.strb = -1;
+    t.last = 1;
+    out.write(t);
+}
@@ -0,0 +1,75 @@
+# build.tcl: block design + bitstream for the PL AES-GCM accelerator
+#   vivado -mode batch -source build.tcl   (pl/Makefile: make bit)
+# Needs the HLS IP from ../hls (make ip). Env: PL_PART, PL_BOARD (board
+# part, default the ZCU102), PL_JOBS (default 4).
+#
+# Zynq UltraScale+ PS, AXI DMA in scatter-gather mode (128-bit streams) and
+# the pl_gcm core between its MM2S and S2MM streams. The DMA masters go to
+# S_AXI_HP0_FPD; both register blocks hang off M_AXI_HPM0_FPD at the
+# addresses pl_gcm_overlay.dtsi declares:
+#   0xA000_0000  AXI DMA (64 KiB)
+#   0xA001_0000  pl_gcm s_axi_control (64 KiB)
+
+set part  [expr {[info exists ::env(PL_PART)]  ? $::env(PL_PART)  : "xczu9eg-ffvb1156-2-e"}]
+set board [expr {[info exists ::env(PL_BOARD)] ? $::env(PL_BOARD) : "xilinx.com:zcu102:part0:3.4"}]
+set jobs  [expr {[info exists ::env(PL_JOBS)]  ? $::env(PL_JOBS)  : 4}]
+
+create_project -force pl_gcm_bd ./pl_gcm_bd -part $part
+set_property board_part $board [current_project]
+set_property ip_repo_paths [list ../hls/pl_gcm_prj/sol/impl/ip] [current_project]
+update_ip_catalog
+
+create_bd_design gs_pl
+set ps [create_bd_cell -type ip -vlnv xilinx.com:ip:zynq_ultra_ps_e zynq_ps]
+apply_bd_automation -rule xilinx.com:bd_rule:zynq_ultra_ps_e -config {apply_board_preset "1"} $ps
+set_property -dict [list CONFIG.PSU__USE__S_AXI_GP2 {1} CONFIG.PSU__USE__M_AXI_GP0 {1} \
+                         CONFIG.PSU__USE__M_AXI_GP1 {0}] $ps
+
+set dma [create_bd_cell -type ip -vlnv xilinx.com:ip:axi_dma axi_dma]
+set_property -dict [list CONFIG.c_include_sg {1} CONFIG.c_sg_include_stscntrl_strm {0} \
+                         CONFIG.c_sg_length_width {26} CONFIG.c_addr_width {40} \
+                         CONFIG.c_m_axis_mm2s_tdata_width {128} CONFIG.c_s_axis_s2mm_tdata_width {128} \
+                         CONFIG.c_mm2s_burst_size {16} CONFIG.c_s2mm_burst_size {16}] $dma
+
+set gcm [create_bd_cell -type ip -vlnv gs:crypto:pl_gcm:1.0 pl_gcm]
+
+connect_bd_intf_net [get_bd_intf_pins axi_dma/M_AXIS_MM2S] [get_bd_intf_pins pl_gcm/in_r]
+connect_bd_intf_net [get_bd_intf_pins pl_gcm/out_r] [get_bd_intf_pins axi_dma/S_AXIS_S2MM]
+
+# Register blocks on HPM0, DMA masters on HP0 (interconnect, clocks, resets)
+apply_bd_automation -rule xilinx.com:bd_rule:axi4 \
+    -config {Master "/zynq_ps/M_AXI_HPM0_FPD" Clk_master "Auto" Clk_slave "Auto" Clk_xbar "Auto" intc_ip "New AXI SmartConnect"} \
+    [get_bd_intf_pins axi_dma/S_AXI_LITE]
+apply_bd_automation -rule xilinx.com:bd_rule:axi4 \
+    -config {Master "/zynq_ps/M_AXI_HPM0_FPD" Clk_master "Auto" Clk_slave "Auto" Clk_xbar "Auto" intc_ip "Auto"} \
+    [get_bd_intf_pins pl_gcm/s_axi_control]
+foreach m {M_AXI_SG M_AXI_MM2S M_AXI_S2MM} {
+    apply_bd_automation -rule xilinx.com:bd_rule:axi4 \
+        -config {Slave "/zynq_ps/S_AXI_HP0_FPD" Clk_master "Auto" Clk_slave "Auto" Clk_xbar "Auto" intc_ip "Auto"} \
+        [get_bd_intf_pins axi_dma/$m]
+}
+apply_bd_automation -rule xilinx.com:bd_rule:clkrst -config {Clk "/zynq_ps/pl_clk0"} [get_bd_pins pl_gcm/ap_clk]
+
+assign_bd_address
+set_property offset 0xA0000000 [get_bd_addr_segs {zynq_ps/Data/SEG_axi_dma_Reg}]
+set_property range 64K         [get_bd_addr_segs {zynq_ps/Data/SEG_axi_dma_Reg}]
+set_property offset 0xA0010000 [get_bd_addr_segs {zynq_ps/Data/SEG_pl_gcm_Reg}]
+set_property range 64K         [get_bd_addr_segs {zynq_ps/Data/SEG_pl_gcm_Reg}]
+
+validate_bd_design
+save_bd_design
+make_wrapper -files [get_files gs_pl.bd] -top
+add_files -norecurse ./pl_gcm_bd/pl_gcm_bd.gen/sources_1/bd/gs_pl/hdl/gs_pl_wrapper.v
+set_property top gs_pl_wrapper [current_fileset]
+
+launch_runs impl_1 -to_step write_bitstream -jobs $jobs
+wait_on_run impl_1
+if {[get_property PROGRESS [get_runs impl_1]] ne "100%"} {
+    error "implementation failed"
+}
+open_run impl_1
+report_utilization -file pl_gcm_utilization.rpt
+report_timing_summary -file pl_gcm_timing.rpt
+file copy -force ./pl_gcm_bd/pl_gcm_bd.runs/impl_1/gs_pl_wrapper.bit ./gs_pl.bit
+write_hw_platform -fixed -force -include_bit ./gs_pl.xsa
+exit
@@ -0,0 +1,976 @@
+// esp_sim.c
+// -----------------------------------------------------------------------------
+// ESP-AT + robot simulator on a PTY, for load-testing gs_bridge2 without
+// hardware:
+//   ./esp_sim.o -L /tmp/esp_sim &        then   UART_DEV=/tmp/esp_sim ./gs_bridge
+//
+// Modem side: answers the AT commands the bridge issues (init, BLECONN chain,
+// MTU / conn-param read-back, GATTC writes with the ">" prompt, SPP
+// passthrough entered with AT+BLESPP and left with "+++"). Robot side: every
+// command word written to ROBOT_TX_CHR is ACKed with its id, sealed frames
+// are opened and the ACK sealed the same way, and a HEALTH word goes out every
+// -H ms once notifications are enabled. Notifications use the firmware's
+// binary shape ([ROBOT_WORD_TAG][8 bytes]) or, with -x, 16 hex chars.
+//
+// Options:
+//   -L path   symlink to the PTY slave (default: only print its name)
+//   -d ms     AT reply latency           -j ms   extra random jitter (0..j)
+//   -a ms     robot command -> ACK time  -c ms   BLECONN time (default 200)
+//   -p pct    BLE packet loss, each direction (write reaches OK but the robot
+//             never sees it / a notification is dropped)
+//   -e pct    AT commands answered ERROR
+//   -H ms     health report period (0 = off, default 1000)
+//   -I ms     NAV / POSE / INERT report period (0 = off, the default)
+//   -m mtu    MTU reported by AT+BLECFGMTU? (default 247)
+//   -T        pack TRACE_LAT robot stage times into ACKs
+//   -F rows   -I reports go out as one plain batch with the firmware's FEC
+//             tag, and rows (1 or 2) parity batches every SIM_FEC_K batches
+//             (tlm_fec.h; stats: fec_parity). Sealed links send them as
+//             before
+//
+// ACK_MODE 1 (System word, as on the robot) holds plain successes and sends
+// them as RESULT_ACK_RANGE words after the hold time or before any other ACK.
+// LINK_ECHO 1 makes a link return every LINK_ECHO_TAG write as it came, the
+// link benchmark's loopback (stats: echoes).
+//   -x        hex text notifications      -S seed  RNG seed (runs repeat)
+//   -D ms     drop the BLE link every ms while connected (+BLEDISCONN URC)
+//   -g        GATTC writes need PRIMSRV + CHAR discovery on the current link
+//             (stock ESP-AT; exercises the bridge's GATT cache fallback)
+//   -s sec    print stats every sec seconds (always printed on exit)
+//   -b mode   AT+UART_CUR: 0 = accept (default), 1 = answer ERROR, 2 = OK
+//             but nothing is heard at the new rate until AT+UART_CUR back
+//             to 115200 (exercises the bridge's rate fallback)
+//   -r dBm    answer AT+BLERSSI=<conn> with this RSSI (default: ERROR, as
+//             stock ESP-AT, which has no such query)
+//
+// A link whose CCCD on ROBOT_PRIO_CHR is on gets its ACKs there, as the
+// firmware's priority characteristic (stats: prio); passthrough forwards
+// ROBOT_RX_CHR only, so one sent there meanwhile is lost.
+//
+// SUBSCRIBE's telemetry gap (bits 8-23) spaces a link's -I reports at least
+// that far apart; the ones in between are not sent (stats: paced).
+//
+// The robot clock (esp_timer on the firmware) runs at a random offset from
+// the host's. CLOCK_SYNC queries are answered from it, and a drive / arm
+// word with an execute-at time is ACKed that much later, as the executor
+// would run it (stats: sched, sched_late = arrived after its time,
+// sched_lead_min_us = least time to spare). One that arrives more than
+// EXEC_AT_LATE_MS late is ACKed CMD_EXPIRED instead (stats: expired).
+//
+// Each robot has the firmware's 16-slot RX pool: a word holds a slot until
+// it is ACKed, a word that finds none is dropped (stats: pool_full), and the
+// free slots go out as credits in HEALTH and ACK range words. After a low
+// advertisement the robot sends a HEALTH word as soon as slots come back,
+// as ble_rx_pool_credit_due() makes the executor do.
+//
+// Every conn_index the bridge connects (up to BLE_LINKS_MAX) is its own
+// robot with its own link state; -D drops the connected links in turn.
+//
+// Stats are one JSON line on stderr: {"type":"SIM_STATS",...}
+// -----------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cmd_parser.h"
+#include "crypto_provider.h"
+#include "cmd_trace.h"
+#include "hex_codec.h"
+#include "report_fec.h"
+
+#define SIM_EVENTS   4096                  // Pending timed outputs (replies, notifications)
+#define SIM_EV_MAX   288                   // Longest single output (+NOTIFY of a LINK_ECHO_MAX echo)
+#define SIM_LINE_MAX 256
+#define SIM_RAW_MAX  (2 * CIPHER_FRAME_SZ)
+#define SIM_RX_POOL  16                    // BLE_RX_POOL_SIZE on the robot
+#define SIM_CREDIT_LOW  4                  // BLE_RX_CREDIT_LOW / _STEP
+#define SIM_CREDIT_STEP 4
+#define SIM_FEC_K    4                     // TLM_FEC_K on the robot
+
+// ------------------------- Config / state -------------------------
+
+typedef struct {
+  int         at_ms, jitter_ms, ack_ms, conn_ms, health_ms, imu_ms, drop_ms, mtu, stats_s;
+  double      loss, at_err;                // Fractions 0..1
+  int         hex_notify, trace_lat, need_disc, baud_mode, fec_rows;
+  int         rssi;                        // -r, 0 = AT+BLERSSI answers ERROR
+  uint32_t    seed;
+  const char *link;
+} sim_cfg_t;
+
+typedef struct {
+  uint64_t at_cmds, at_errors, writes, words, sealed, compact, batches, acks, ack_ranges, health, imu, link_drops;
+  uint64_t estops, estop_marks;            // E-stop words; ones that came as SEAL_MARK_ESTOP
+  uint64_t echoes;                         // LINK_ECHO_TAG writes returned
+  uint64_t fec_parity;                     // -F parity batches
+  uint64_t paced;                          // -I reports skipped for a SUBSCRIBE gap
+  uint64_t prio;                           // Notifications on ROBOT_PRIO_CHR
+  uint64_t pool_full;                      // Words dropped: every RX slot taken
+  uint64_t sched, sched_late, sched_lead_min_us;
+  uint64_t expired;                        // Scheduled words past their deadline (CMD_EXPIRED)
+  uint64_t lost_in, lost_out, bad_frames, auth_fail, replays, ev_drops, bytes_in, bytes_out;
+} sim_stats_t;
+
+enum { RX_AT_LINE, RX_AT_DATA, RX_RAW };
+
+typedef struct {
+  uint64_t due_us;
+  uint32_t seq;                            // FIFO among equal due times
+  uint16_t len;
+  uint8_t  data[SIM_EV_MAX];
+} sim_ev_t;
+
+static sim_cfg_t   g_cfg = { .conn_ms = 200, .health_ms = 1000, .mtu = 247, .seed = 1 };
+static sim_stats_t g_st;
+static int         g_fd = -1;              // PTY master
+static volatile sig_atomic_t g_stop = 0;
+
+static sim_ev_t g_ev[SIM_EVENTS];          // Binary min-heap on (due_us, seq)
+static int      g_nev = 0;
+static uint32_t g_ev_seq = 0;
+
+static int      g_rx_mode = RX_AT_LINE;
+static char     g_line[SIM_LINE_MAX];
+static size_t   g_line_len = 0;
+static uint8_t  g_data[SIM_RAW_MAX];       // GATTC write payload / passthrough bytes
+static size_t   g_data_len = 0, g_data_want = 0;
+static int      g_wr_conn = 0, g_wr_chr = -1, g_wr_desc = -1;
+static int      g_garbled = 0;             // -b 2 after a rate change: lines are lost
+
+typedef struct {
+  int connected, notify_on, secure_seen;
+  int suite;                               // gs_crypto_suite_t from the last SECURITY_LEVEL word
+  int discovered;                          // PRIMSRV + CHAR ran on this link (-g)
+  int prio_on;                             // CCCD on ROBOT_PRIO_CHR: ACKs go there
+  char mac[24];
+  replay_window_t replay;                  // Sealed commands accepted, as on the robot
+  int ack_mode;                            // ACK_MODE 1: successes held in acks
+  int echo;                                // LINK_ECHO 1: LINK_ECHO_TAG writes come back
+  uint32_t ack_hold_ms;
+  ack_range_t acks;
+  int acks_sealed;                         // The held range goes out sealed
+  uint64_t ack_due_us;
+  uint64_t slot_end[SIM_RX_POOL];          // RX slot busy until its word has run
+  int told;                                // Free slots last advertised
+  fec_enc_t fec;                           // -F: the open parity group
+  uint32_t tlm_gap_ms;                     // SUBSCRIBE telemetry gap
+  uint64_t tlm_us;                         // Last -I report
+} sim_link_t;
+
+static sim_link_t g_link[BLE_LINKS_MAX];
+static int      g_drop_next = 0;
+static uint32_t g_battery = 100;
+static uint32_t g_rng;
+static uint32_t g_clock_off;               // Robot clock - host clock (low 32 bits)
+
+static uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static uint32_t robot_clock(void) {
+  return (uint32_t)now_us() + g_clock_off;
+}
+
+static uint32_t rnd(void) {                // xorshift32
+  g_rng ^= g_rng << 13;
+  g_rng ^= g_rng >> 17;
+  g_rng ^= g_rng << 5;
+  return g_rng;
+}
+
+static int chance(double p) {
+  return p > 0 && (double)rnd() / 4294967296.0 < p;
+}
+
+static uint64_t at_delay_us(void) {
+  uint64_t d = (uint64_t)g_cfg.at_ms * 1000u;
+  if (g_cfg.jitter_ms > 0) d += rnd() % ((uint32_t)g_cfg.jitter_ms * 1000u + 1);
+  return d;
+}
+
+// ------------------------- Timed output queue -------------------------
+
+static int ev_before(const sim_ev_t *a, const sim_ev_t *b) {
+  return a->due_us != b->due_us ? a->due_us < b->due_us : (int32_t)(a->seq - b->seq) < 0;
+}
+
+static void ev_swap(int i, int j) {
+  sim_ev_t t = g_ev[i];
+  g_ev[i] = g_ev[j];
+  g_ev[j] = t;
+}
+
+static void ev_push(uint64_t delay_us, const void *data, size_t len) {
+  if (g_nev == SIM_EVENTS || len > SIM_EV_MAX) { g_st.ev_drops++; return; }
+  int i = g_nev++;
+  g_ev[i].due_us = now_us() + delay_us;
+  g_ev[i].seq = g_ev_seq++;
+  g_ev[i].len = (uint16_t)len;
+  memcpy(g_ev[i].data, data, len);
+  while (i && ev_before(&g_ev[i], &g_ev[(i - 1) / 2])) {
+    ev_swap(i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+static void ev_pop(void) {
+  g_ev[0] = g_ev[--g_nev];
+  for (int i = 0;;) {
+    int l = 2 * i + 1, r = l + 1, m = i;
+    if (l < g_nev && ev_before(&g_ev[l], &g_ev[m])) m = l;
+    if (r < g_nev && ev_before(&g_ev[r], &g_ev[m])) m = r;
+    if (m == i) break;
+    ev_swap(i, m);
+    i = m;
+  }
+}
+
+static void write_all(const uint8_t *p, size_t n) {
+  while (n) {
+    ssize_t w = write(g_fd, p, n);
+    if (w < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN && poll(&(struct pollfd){ .fd = g_fd, .events = POLLOUT }, 1, 100) > 0) continue;
+      g_st.ev_drops++;                     // Nobody reading the slave: drop
+      return;
+    }
+    g_st.bytes_out += (uint64_t)w;
+    p += w;
+    n -= (size_t)w;
+  }
+}
+
+// Writes everything due; returns ms until the next event (-1 = none)
+static int ev_run(void) {
+  while (g_nev) {
+    uint64_t t = now_us();
+    if (g_ev[0].due_us > t) return (int)((g_ev[0].due_us - t + 999) / 1000);
+    write_all(g_ev[0].data, g_ev[0].len);
+    ev_pop();
+  }
+  return -1;
+}
+
+static void at_reply(const char *s) {
+  ev_push(at_delay_us(), s, strlen(s));
+}
+
+// ------------------------- Robot -------------------------
+
+// One notification of n bytes on link conn's characteristic chr, as the
+// modem hands it over
+static void notify_chr(int conn, int chr, const uint8_t *frame, size_t n, uint64_t delay_us) {
+  if (!g_link[conn].connected || !g_link[conn].notify_on) return;
+  if (chance(g_cfg.loss) || (g_rx_mode == RX_RAW && chr != ROBOT_RX_CHR)) { g_st.lost_out++; return; }
+
+  uint8_t out[SIM_EV_MAX];
+  size_t off = 0;
+  if (g_rx_mode != RX_RAW)                 // Passthrough: notifications arrive unframed
+    off = (size_t)snprintf((char *)out, sizeof(out), "+NOTIFY:%d,%d,%d,%zu,", conn, ROBOT_SRV, chr, n);
+  memcpy(out + off, frame, n);
+  off += n;
+  if (g_rx_mode != RX_RAW) { out[off++] = '\r'; out[off++] = '\n'; }
+  ev_push(delay_us, out, off);
+}
+
+static void notify_bytes(int conn, const uint8_t *frame, size_t n, uint64_t delay_us) {
+  notify_chr(conn, ROBOT_RX_CHR, frame, n, delay_us);
+}
+
+static void robot_notify(int conn, robot_bt_packet_t w, int sealed, uint64_t delay_us) {
+  uint8_t frame[CIPHER_FRAME_SZ];
+  size_t n;
+
+  if (!g_link[conn].connected || !g_link[conn].notify_on) return;
+
+  if (sealed) {
+    size_t ct_len = 0;
+    gs_crypto_suite(g_link[conn].suite);
+    frame[0] = CIPHER_SOF0;
+    frame[1] = CIPHER_SOF1;
+    if (encrypt_cmd(&w, frame + 2, &ct_len) != 0 || ct_len != TOTAL_SZ) { g_st.auth_fail++; return; }
+    frame[CIPHER_FRAME_SZ - 2] = CIPHER_EOF0;
+    frame[CIPHER_FRAME_SZ - 1] = CIPHER_EOF1;
+    n = CIPHER_FRAME_SZ;
+  } else if (g_cfg.hex_notify) {
+    char hex[17];
+    hexc_encode(w.bytes, 8, hex, 1);
+    memcpy(frame, hex, 16);
+    n = 16;
+  } else {
+    frame[0] = ROBOT_WORD_TAG;
+    memcpy(frame + 1, w.bytes, 8);
+    n = 9;
+  }
+  if (cmd_word_type(w.raw) == ACK_CMD && g_link[conn].prio_on) {
+    g_st.prio++;
+    notify_chr(conn, ROBOT_PRIO_CHR, frame, n, delay_us);
+  } else {
+    notify_bytes(conn, frame, n, delay_us);
+  }
+}
+
+// n words as one plain ROBOT_BATCH_MAGIC notification
+static void robot_batch_notify(int conn, const robot_bt_packet_t *w, int n) {
+  uint8_t frame[2 + 8 * ROBOT_BATCH_MAX];
+  frame[0] = ROBOT_BATCH_MAGIC;
+  frame[1] = (uint8_t)n;
+  for (int i = 0; i < n; i++) memcpy(frame + 2 + 8 * i, w[i].bytes, 8);
+  notify_bytes(conn, frame, 2 + 8 * (size_t)n, 0);
+}
+
+static int word_id(uint64_t raw) {
+  switch (cmd_word_type(raw)) {
+    case CONTROL_CMD: return (int)cmd_ctrl_get_id(raw);
+    case ARM_CMD:     return (int)cmd_arm_get_id(raw);
+    case ARM_TARGET_CMD: return (int)cmd_armt_get_id(raw);
+    case TRAJ_CMD:    return cmd_trajc_get_op(raw) >= TRAJ_OP_RUN ? (int)cmd_trajc_get_id(raw) : -1;
+    case System_CMD:  return (int)cmd_sys_get_id(raw);
+    case Query_CMD:   return (int)cmd_query_get_id(raw);
+    default:          return -1;
+  }
+}
+
+static int pool_free(const sim_link_t *l, uint64_t t) {
+  int n = 0;
+  for (int i = 0; i < SIM_RX_POOL; i++) n += l->slot_end[i] <= t;
+  return n;
+}
+
+// health.credits / ACK range credits, remembered as told
+static uint32_t sim_credits(sim_link_t *l) {
+  l->told = pool_free(l, now_us());
+  return (uint32_t)l->told + 1;
+}
+
+// Sends the held ACK range of link conn, if any
+static void ack_range_flush(int conn) {
+  sim_link_t *l = &g_link[conn];
+  if (!l->acks.n) return;
+  robot_bt_packet_t w = { .raw = ack_range_word(&l->acks, 1, sim_credits(l)) };
+  l->acks.n = 0;
+  g_st.acks++;
+  g_st.ack_ranges++;
+  robot_notify(conn, w, l->acks_sealed, (uint64_t)g_cfg.ack_ms * 1000u);
+}
+
+// One command word reached the robot: ACK it like the executor does
+static void robot_word(int conn, robot_bt_packet_t w, int sealed) {
+  sim_link_t *l = &g_link[conn];
+  uint64_t t0 = now_us();
+  int slot = -1;
+  for (int i = 0; i < SIM_RX_POOL && slot < 0; i++)
+    if (l->slot_end[i] <= t0) slot = i;
+  if (slot < 0) { g_st.pool_full++; return; }             // Dropped unseen, as on the robot
+  g_st.words++;
+  if (cmd_word_type(w.raw) == System_CMD && cmd_sys_get_instruction(w.raw) == SECURITY_LEVEL)
+    g_link[conn].suite = cmd_sys_get_specific(w.raw) == SEC_CHACHA20_POLY1305 ? GS_SUITE_CHACHA20_POLY1305
+                                                                              : GS_SUITE_AES_GCM;
+
+  int id = word_id(w.raw);
+  uint64_t exec_us = (uint64_t)g_cfg.ack_ms * 1000u;
+  uint32_t at = cmd_word_type(w.raw) == CONTROL_CMD ? cmd_ctrl_get_at(w.raw)
+              : cmd_word_type(w.raw) == ARM_CMD     ? cmd_arm_get_at(w.raw) : 0;
+  if (at) {                                // Held until then, like motion_pop() on the robot
+    int32_t wait = exec_at_until_us(at, robot_clock());
+    g_st.sched++;
+    if (wait < -EXEC_AT_LATE_MS * 1000) {  // Past its deadline: dropped unrun
+      cmd_ack_t a = { .pl = cmd_word_pl(w.raw), .type = ACK_CMD, .id = id > 0 ? (uint32_t)id : 0,
+                      .result_code = RESULT_CMD_FAILURE, .instruction_specific = CMD_EXPIRED };
+      l->slot_end[slot] = t0 + exec_us + 1;
+      g_st.expired++;
+      g_st.acks++;
+      ack_range_flush(conn);
+      robot_notify(conn, (robot_bt_packet_t){ .raw = cmd_ack_pack(&a) }, sealed, exec_us);
+      return;
+    }
+    if (wait <= 0 || wait > EXEC_AT_HORIZON_MS * 1000) g_st.sched_late++;
+    else {
+      if (!g_st.sched_lead_min_us || (uint64_t)wait < g_st.sched_lead_min_us) g_st.sched_lead_min_us = (uint64_t)wait;
+      exec_us += (uint64_t)wait;
+    }
+  }
+  l->slot_end[slot] = t0 + exec_us + 1;
+  if (cmd_word_type(w.raw) == System_CMD) ack_range_flush(conn);   // Like system_cmd() on the robot
+  uint64_t info = NO_INFO;
+  if (cmd_word_type(w.raw) == System_CMD && cmd_sys_get_instruction(w.raw) == ACK_MODE) {
+    uint32_t spec = cmd_sys_get_specific(w.raw), hold = (spec >> 8) & 0xFFFF;
+    l->ack_mode = (spec & 0xFF) == 1;
+    l->ack_hold_ms = hold ? hold : ACK_RANGE_HOLD_MS;
+    info = l->ack_mode ? ACK_RANGES : ACK_EACH;
+  }
+  if (cmd_word_type(w.raw) == System_CMD && cmd_sys_get_instruction(w.raw) == SUBSCRIBE) {
+    l->tlm_gap_ms = (cmd_sys_get_specific(w.raw) >> 8) & 0xFFFF;
+    info = TOPICS_SET;
+  }
+  if (cmd_word_type(w.raw) == System_CMD && cmd_sys_get_instruction(w.raw) == LINK_ECHO) {
+    l->echo = cmd_sys_get_specific(w.raw) == 1;
+    info = l->echo ? ECHO_ON : ECHO_OFF;
+  }
+  if (cmd_word_type(w.raw) == System_CMD && cmd_sys_get_instruction(w.raw) == EMERGENCY_SHTDWN) {
+    info = cmd_word_is_estop(w.raw) ? SHTDWN_ENABLED : SHTDWN_DISABLED;
+    if (info == SHTDWN_ENABLED) g_st.estops++;
+  }
+  if (cmd_word_type(w.raw) == Query_CMD && cmd_query_get_instruction(w.raw) == CLOCK_SYNC)
+    info = clock_sync_info(robot_clock(), (uint32_t)exec_us);
+  if (l->ack_mode && id >= 0 && info == NO_INFO && !g_cfg.trace_lat) {
+    if (ack_range_add(&l->acks, (uint32_t)id) != 0) {
+      ack_range_flush(conn);
+      ack_range_add(&l->acks, (uint32_t)id);
+    }
+    if (l->acks.n == 1) l->ack_due_us = now_us() + (uint64_t)l->ack_hold_ms * 1000u;
+    l->acks_sealed = sealed;
+    return;
+  }
+  ack_range_flush(conn);
+
+  cmd_ack_t a = {
+    .pl = cmd_word_pl(w.raw),
+    .type = ACK_CMD,
+    .id = id > 0 ? (uint32_t)id : 0,
+    .result_code = id < 0 ? RESULT_UNKNOWN_CMD : RESULT_SUCCESS,
+    .instruction_specific = info,
+  };
+  if (g_cfg.trace_lat && id >= 0) {        // Same packing as trace_lat_ack() in the firmware
+    uint64_t exec = (uint64_t)g_cfg.ack_ms * 1000u / CMD_TRACE_LAT_UNIT_US;
+    uint64_t m = ((uint64_t)1 << CMD_TRACE_LAT_BITS) - 1;
+    a.instruction_specific = CMD_TRACE_LAT_MARK | 1u | ((exec > m ? m : exec) << (2 * CMD_TRACE_LAT_BITS));
+  }
+  g_st.acks++;
+  robot_notify(conn, (robot_bt_packet_t){ .raw = cmd_ack_pack(&a) }, sealed, exec_us);
+}
+
+// One GATT write to ROBOT_TX_CHR of link conn: an 8-byte word, a plain
+// ROBOT_BATCH_MAGIC batch, a sealed 160-byte frame (0xD1: a batch) or a
+// compact seal (0xD2 / 0xD3, 0xD4 for an e-stop)
+static void robot_rx(int conn, const uint8_t *p, size_t n) {
+  robot_bt_packet_t w[ROBOT_BATCH_MAX];
+  int count = 1, sealed = 0, compact = n >= 2 && seal_frame_len(p, n) == (int)n;
+
+  if (chance(g_cfg.loss)) { g_st.lost_in++; return; }
+
+  if (n && p[0] == LINK_ECHO_TAG && g_link[conn].echo) {   // Straight back from the receive path
+    g_st.echoes++;
+    notify_bytes(conn, p, n, 0);
+    return;
+  }
+  if (n == 8) {
+    memcpy(w[0].bytes, p, 8);
+  } else if (n >= 2 + 8 && p[0] == ROBOT_BATCH_MAGIC && p[1] >= 1 && p[1] <= ROBOT_BATCH_MAX &&
+             n == 2 + (size_t)p[1] * 8) {
+    count = p[1];
+    for (int i = 0; i < count; i++) memcpy(w[i].bytes, p + 2 + i * 8, 8);
+    g_st.batches++;
+  } else if (compact || (n == CIPHER_FRAME_SZ && p[0] == CIPHER_SOF0 &&
+                         (p[1] == CIPHER_SOF1 || p[1] == CIPHER_SOF1_BATCH))) {
+    uint64_t seq = 0;
+    uint8_t nonce[IV_SZ];
+    if (compact) memcpy(nonce, p + 2 + seal_nonce_off(p[1]), IV_SZ);
+    else memcpy(nonce, p + 2, IV_SZ);
+    if (!replay_nonce_seq(nonce, REPLAY_DIR_GS, &seq) || !replay_check(&g_link[conn].replay, seq)) {
+      cmd_ack_t a = { .type = ACK_CMD, .result_code = RESULT_DUPLICATE_PACKET };
+      g_st.replays++;
+      robot_notify(conn, (robot_bt_packet_t){ .raw = cmd_ack_pack(&a) }, 0, (uint64_t)g_cfg.ack_ms * 1000u);
+      return;
+    }
+    gs_crypto_suite(g_link[conn].suite);
+    if (compact) count = decrypt_cmd_compact(p, n, w, ROBOT_BATCH_MAX, &seq);
+    else count = p[1] == CIPHER_SOF1 ? (decrypt_cmd(p + 2, &w[0]) == 0 ? 1 : -1)
+                                     : decrypt_report_batch(p + 2, w, ROBOT_BATCH_MAX);
+    if (count < 1) {
+      cmd_ack_t a = { .type = ACK_CMD, .result_code = RESULT_AUTH_FAIL };
+      g_st.auth_fail++;
+      robot_notify(conn, (robot_bt_packet_t){ .raw = cmd_ack_pack(&a) }, 0, (uint64_t)g_cfg.ack_ms * 1000u);
+      return;
+    }
+    replay_accept(&g_link[conn].replay, seq);
+    if (p[1] == CIPHER_SOF1_BATCH || p[1] == SEAL_MARK_BATCH) g_st.batches++;
+    if (compact) g_st.compact++;
+    if (compact && p[1] == SEAL_MARK_ESTOP) g_st.estop_marks++;
+    sealed = g_link[conn].secure_seen = 1;
+    g_st.sealed++;
+  } else {
+    g_st.bad_frames++;
+    return;
+  }
+  for (int i = 0; i < count; i++) robot_word(conn, w[i], sealed);
+}
+
+static void robot_health(int conn) {
+  static uint32_t n = 0;
+  if (++n % 60 == 0 && g_battery > 5) g_battery--;
+  cmd_health_t h = {
+    .type = HEALTH_CMD,
+    .battery = g_battery,
+    .sec_en = (uint32_t)g_link[conn].secure_seen,
+    .motor_en = 1,
+    .arm_en = 1,
+    .tx_depth = (uint32_t)(g_nev > 15 ? 15 : g_nev),
+    .tx_drops = (uint32_t)(g_st.lost_out & 0xfff),
+    .stack_task = n % 7,                              // Round robin, as telemetry.c
+    .stack_free = 300 + n % 7 * 40,
+    .credits = sim_credits(&g_link[conn]),
+  };
+  g_st.health++;
+  robot_notify(conn, (robot_bt_packet_t){ .raw = cmd_health_pack(&h) }, g_link[conn].secure_seen, 0);
+}
+
+// NAV, POSE and INERT (ROBOT_UPDATE parts 0-2): the robot driving back and
+// forth along x, with a little noise on the inertial part
+static void robot_imu(int conn) {
+  static uint32_t n = 0;
+  sim_link_t *l = &g_link[conn];
+  uint64_t t = now_us();
+  if (l->tlm_gap_ms && t - l->tlm_us < (uint64_t)l->tlm_gap_ms * 1000u) {
+    if (l->connected && l->notify_on) g_st.paced++;
+    return;
+  }
+  l->tlm_us = t;
+  int32_t step = (int32_t)(n++ % 400);
+  cmd_nav_t nav = {
+    .type = ROBOT_UPDATE_CMD, .part = 0, .speed = 40,
+    .pos_x = (step < 200 ? step : 400 - step) * 10 - 1000, .pos_y = 250, .pos_z = 0,
+  };
+  cmd_pose_t pose = { .type = ROBOT_UPDATE_CMD, .part = 1, .yaw = step < 200 ? 0 : 180000 };
+  cmd_inert_t inert = {
+    .type = ROBOT_UPDATE_CMD, .part = 2,
+    .accel_x = (int32_t)(rnd() % 21) - 10, .accel_y = (int32_t)(rnd() % 21) - 10, .accel_z = 98,
+    .gyro_z = 2,
+  };
+  int sealed = g_link[conn].secure_seen;
+  if (g_cfg.fec_rows && !sealed) {
+    robot_bt_packet_t b[FEC_SLOTS_MAX + 1] = { { .raw = cmd_nav_pack(&nav) }, { .raw = cmd_pose_pack(&pose) },
+                                               { .raw = cmd_inert_pack(&inert) } };
+    fec_enc_t *e = &g_link[conn].fec;
+    robot_batch_notify(conn, b, fec_enc_data(e, b, 3));
+    if (e->count >= SIM_FEC_K) {
+      for (int row = 1; row <= g_cfg.fec_rows && row <= FEC_ROWS_MAX; row++) {
+        robot_batch_notify(conn, b, fec_enc_parity(e, row, b));
+        g_st.fec_parity++;
+      }
+      fec_enc_next(e);
+    }
+    g_st.imu++;
+    return;
+  }
+  robot_notify(conn, (robot_bt_packet_t){ .raw = cmd_nav_pack(&nav) }, sealed, 0);
+  robot_notify(conn, (robot_bt_packet_t){ .raw = cmd_pose_pack(&pose) }, sealed, 0);
+  robot_notify(conn, (robot_bt_packet_t){ .raw = cmd_inert_pack(&inert) }, sealed, 0);
+  g_st.imu++;
+}
+
+// ------------------------- Modem -------------------------
+
+static int starts(const char *s, const char *prefix) {
+  return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+// AT+BLEGATTCWR=<conn>,<srv>,<chr>,[<desc>],<len>
+static int parse_gattcwr(const char *args, int *conn, int *chr, int *desc, size_t *len) {
+  int k, srv, c, d = -1;
+  unsigned l;
+  if (sscanf(args, "%d,%d,%d,,%u", &k, &srv, &c, &l) != 4 &&
+      sscanf(args, "%d,%d,%d,%d,%u", &k, &srv, &c, &d, &l) != 5) return -1;
+  if (l == 0 || l > SIM_RAW_MAX || k < 0 || k >= BLE_LINKS_MAX) return -1;
+  *conn = k;
+  *chr = c;
+  *desc = d;
+  *len = l;
+  return 0;
+}
+
+// Leading conn_index of the command's arguments; -1 if out of range
+static int arg_conn(const char *args) {
+  int c = atoi(args);
+  return (args[0] >= '0' && args[0] <= '9' && c < BLE_LINKS_MAX) ? c : -1;
+}
+
+static void at_line(char *line) {
+  size_t n = strlen(line);
+  while (n && (line[n - 1] == '\r' || line[n - 1] == '\n')) line[--n] = '\0';
+  if (!n) return;
+  if (!starts(line, "AT")) return;         // Stray bytes: a real modem ignores them too
+  if (g_garbled) {
+    if (!starts(line, "AT+UART_CUR=115200,")) return;
+    g_garbled = 0;
+  }
+  g_st.at_cmds++;
+
+  if (chance(g_cfg.at_err)) { g_st.at_errors++; at_reply("\r\nERROR\r\n"); return; }
+
+  char buf[SIM_EV_MAX];
+  size_t off = 0;
+  int conn;
+  if (starts(line, "AT+BLEGATTCWR=")) {
+    if (parse_gattcwr(line + 14, &g_wr_conn, &g_wr_chr, &g_wr_desc, &g_data_want) != 0 ||
+        !g_link[g_wr_conn].connected || (g_cfg.need_disc && !g_link[g_wr_conn].discovered)) {
+      g_st.at_errors++;
+      at_reply("\r\nERROR\r\n");
+      return;
+    }
+    g_data_len = 0;
+    g_rx_mode = RX_AT_DATA;
+    at_reply("\r\n>");
+  } else if (starts(line, "AT+BLECONN=")) {
+    if ((conn = arg_conn(line + 11)) < 0) { at_reply("\r\nERROR\r\n"); return; }
+    sim_link_t *l = &g_link[conn];
+    const char *q = strchr(line, '"');
+    snprintf(l->mac, sizeof(l->mac), "%.*s", q ? (int)strcspn(q + 1, "\"") : 0, q ? q + 1 : "");
+    l->connected = 1;
+    l->discovered = 0;
+    l->prio_on = 0;
+    l->echo = 0;                           // Ends with the connection, as on the robot
+    l->tlm_gap_ms = 0;
+    memset(l->slot_end, 0, sizeof(l->slot_end));
+    l->told = SIM_RX_POOL;
+    replay_reset(&l->replay);
+    snprintf(buf, sizeof(buf), "+BLECONN:%d,\"%s\"\r\n\r\nOK\r\n", conn, l->mac);
+    ev_push((uint64_t)g_cfg.conn_ms * 1000u + at_delay_us(), buf, strlen(buf));
+  } else if (starts(line, "AT+BLEDISCONN")) {
+    conn = line[13] == '=' ? arg_conn(line + 14) : 0;
+    if (conn < 0) { at_reply("\r\nERROR\r\n"); return; }
+    sim_link_t *l = &g_link[conn];
+    int was = l->connected;
+    l->connected = l->notify_on = l->discovered = 0;
+    at_reply("\r\nOK\r\n");
+    if (was) {
+      snprintf(buf, sizeof(buf), "+BLEDISCONN:%d,\"%s\"\r\n", conn, l->mac);
+      at_reply(buf);
+    }
+  } else if (strcmp(line, "AT+BLECFGMTU?") == 0) {         // One line per connected link
+    for (conn = 0; conn < BLE_LINKS_MAX; conn++)
+      if (g_link[conn].connected)
+        off += (size_t)snprintf(buf + off, sizeof(buf) - off, "+BLECFGMTU:%d,%d\r\n", conn, g_cfg.mtu);
+    snprintf(buf + off, sizeof(buf) - off, "\r\nOK\r\n");
+    at_reply(buf);
+  } else if (strcmp(line, "AT+BLECONNPARAM?") == 0) {
+    for (conn = 0; conn < BLE_LINKS_MAX; conn++)
+      if (g_link[conn].connected)
+        off += (size_t)snprintf(buf + off, sizeof(buf) - off, "+BLECONNPARAM:%d,%d,%d,%d,%d,%d\r\n", conn,
+                                BLE_LINK_INTERVAL_MIN, BLE_LINK_INTERVAL_MAX, BLE_LINK_INTERVAL_MIN,
+                                BLE_LINK_LATENCY, BLE_LINK_TIMEOUT);
+    snprintf(buf + off, sizeof(buf) - off, "\r\nOK\r\n");
+    at_reply(buf);
+  } else if (starts(line, "AT+BLERSSI=")) {
+    if (!g_cfg.rssi || (conn = arg_conn(line + 11)) < 0 || !g_link[conn].connected) { at_reply("\r\nERROR\r\n"); return; }
+    snprintf(buf, sizeof(buf), "+BLERSSI:%d,%d\r\n\r\nOK\r\n", conn, g_cfg.rssi);
+    at_reply(buf);
+  } else if (strcmp(line, "AT+BLENAME?") == 0) {
+    at_reply("+BLENAME:" PMOD_DEV_NAME "\r\n\r\nOK\r\n");
+  } else if (starts(line, "AT+BLEGATTCPRIMSRV=")) {
+    if ((conn = arg_conn(line + 19)) < 0 || !g_link[conn].connected) { at_reply("\r\nERROR\r\n"); return; }
+    snprintf(buf, sizeof(buf), "+BLEGATTCPRIMSRV:%d,%d,0xFF00,1\r\n\r\nOK\r\n", conn, ROBOT_SRV);
+    at_reply(buf);
+  } else if (starts(line, "AT+BLEGATTCCHAR=")) {
+    if ((conn = arg_conn(line + 16)) < 0 || !g_link[conn].connected) { at_reply("\r\nERROR\r\n"); return; }
+    snprintf(buf, sizeof(buf), "+BLEGATTCCHAR:\"char\",%d,%d,%d,0xFF01,0x08\r\n"
+             "+BLEGATTCCHAR:\"char\",%d,%d,%d,0xFF02,0x10\r\n\r\nOK\r\n",
+             conn, ROBOT_SRV, ROBOT_TX_CHR, conn, ROBOT_SRV, ROBOT_RX_CHR);
+    at_reply(buf);
+    g_link[conn].discovered = 1;
+  } else if (starts(line, "AT+UART_CUR=")) {
+    if (g_cfg.baud_mode == 1) { at_reply("\r\nERROR\r\n"); return; }
+    at_reply("\r\nOK\r\n");
+    if (g_cfg.baud_mode == 2 && !starts(line, "AT+UART_CUR=115200,")) g_garbled = 1;
+  } else if (starts(line, "AT+BLESPP") && !starts(line, "AT+BLESPPCFG")) {
+    if (!g_link[CONN_IDX].connected) { at_reply("\r\nERROR\r\n"); return; }
+    g_rx_mode = RX_RAW;                    // Bytes after this are passthrough
+    g_data_len = 0;
+    at_reply("\r\nOK\r\n\r\n>");
+  } else {                                 // ATE0, CWMODE, BLEINIT, BLENAME=, DATALEN, CFGMTU=, SPPCFG, ...
+    at_reply("\r\nOK\r\n");
+  }
+}
+
+// Link loss as the modem reports it: URC only, no command involved. The
+// connected links take turns.
+static void link_drop(void) {
+  int conn = -1;
+  for (int i = 0; i < BLE_LINKS_MAX && conn < 0; i++) {
+    int c = (g_drop_next + i) % BLE_LINKS_MAX;
+    if (g_link[c].connected) conn = c;
+  }
+  if (conn < 0) return;
+  g_drop_next = conn + 1;
+
+  sim_link_t *l = &g_link[conn];
+  l->connected = l->notify_on = l->discovered = 0;
+  if (g_rx_mode == RX_RAW && conn == CONN_IDX) g_rx_mode = RX_AT_LINE;   // Passthrough ends with the link
+  g_st.link_drops++;
+  char buf[64];
+  snprintf(buf, sizeof(buf), "+BLEDISCONN:%d,\"%s\"\r\n", conn, l->mac);
+  ev_push(0, buf, strlen(buf));
+}
+
+static void write_done(void) {
+  g_st.writes++;
+  g_rx_mode = RX_AT_LINE;
+  at_reply("\r\nOK\r\n");
+  if (g_wr_chr == ROBOT_RX_CHR && g_wr_desc >= 0)     // CCCD on the notify characteristic
+    g_link[g_wr_conn].notify_on = g_data_len >= 1 && (g_data[0] & 1);
+  else if (g_wr_chr == ROBOT_PRIO_CHR && g_wr_desc >= 0)
+    g_link[g_wr_conn].prio_on = g_data_len >= 1 && (g_data[0] & 1);
+  else if (g_wr_chr == ROBOT_TX_CHR)
+    robot_rx(g_wr_conn, g_data, g_data_len);
+}
+
+// Passthrough: "+++" leaves it; otherwise split by the frame shapes the
+// bridge writes (sealed frames start 0x0A 0xD0 / 0xD1, plain words
+// ROBOT_WRITE_TAG, plain batches ROBOT_BATCH_MAGIC | n; anything else is
+// taken as a bare 8-byte word, like the robot does)
+static size_t raw_one(const uint8_t *p, size_t n) {
+  if (n >= 3 && memcmp(p, "+++", 3) == 0) { g_rx_mode = RX_AT_LINE; return 3; }
+  if (p[0] == '+' && n < 3) return 0;
+  if (p[0] == ROBOT_WRITE_TAG) {
+    if (n < ROBOT_WRITE_TAGGED_LEN) return 0;
+    g_st.writes++;
+    robot_rx(CONN_IDX, p + 1, 8);
+    return ROBOT_WRITE_TAGGED_LEN;
+  }
+  if (p[0] == LINK_ECHO_TAG && g_link[CONN_IDX].echo) {
+    if (n < 2) return 0;
+    size_t len = p[1] < LINK_ECHO_HDR ? 1 : p[1];        // A bad length is one stray byte
+    if (n < len) return 0;
+    g_st.writes++;
+    robot_rx(CONN_IDX, p, len);
+    return len;
+  }
+  if (p[0] == ROBOT_BATCH_MAGIC) {
+    if (n < 2) return 0;
+    size_t len = 2 + (size_t)p[1] * 8;
+    if (n < len) return 0;
+    g_st.writes++;
+    robot_rx(CONN_IDX, p, len);
+    return len;
+  }
+  int clen = seal_frame_len(p, n);
+  if (clen == 0 && p[0] == SEAL_SOF) return 0;
+  if (clen > 0) {
+    if (n < (size_t)clen) return 0;
+    g_st.writes++;
+    robot_rx(CONN_IDX, p, (size_t)clen);
+    return (size_t)clen;
+  }
+  size_t want = (n >= 2 && p[0] == CIPHER_SOF0 && (p[1] == CIPHER_SOF1 || p[1] == CIPHER_SOF1_BATCH)) ? CIPHER_FRAME_SZ : 8;
+  if (p[0] == CIPHER_SOF0 && n < 2) return 0;
+  if (n < want) return 0;
+  g_st.writes++;
+  robot_rx(CONN_IDX, p, want);
+  return want;
+}
+
+static void uart_in(const uint8_t *p, size_t n) {
+  g_st.bytes_in += n;
+  while (n) {
+    if (g_rx_mode == RX_AT_DATA) {
+      size_t take = g_data_want - g_data_len;
+      if (take > n) take = n;
+      memcpy(g_data + g_data_len, p, take);
+      g_data_len += take;
+      p += take;
+      n -= take;
+      if (g_data_len == g_data_want) write_done();
+    } else if (g_rx_mode == RX_RAW) {
+      size_t take = sizeof(g_data) - g_data_len;
+      if (take > n) take = n;
+      memcpy(g_data + g_data_len, p, take);
+      g_data_len += take;
+      p += take;
+      n -= take;
+      size_t off = 0, used;
+      while (g_rx_mode == RX_RAW && off < g_data_len && (used = raw_one(g_data + off, g_data_len - off)) > 0)
+        off += used;
+      memmove(g_data, g_data + off, g_data_len - off);
+      g_data_len -= off;
+      if (g_rx_mode != RX_RAW && g_data_len) {          // Left passthrough: rest is AT text
+        uint8_t rest[SIM_RAW_MAX];
+        size_t rn = g_data_len;
+        memcpy(rest, g_data, rn);
+        g_data_len = 0;
+        uart_in(rest, rn);
+        g_st.bytes_in -= rn;
+      }
+    } else {
+      uint8_t c = *p++;
+      n--;
+      if (g_line_len < sizeof(g_line) - 1) g_line[g_line_len++] = (char)c;
+      if (c != '\n') continue;
+      g_line[g_line_len] = '\0';
+      g_line_len = 0;
+      at_line(g_line);
+    }
+  }
+}
+
+// ------------------------- Main -------------------------
+
+static void print_stats(void) {
+  fprintf(stderr, "{\"type\":\"SIM_STATS\",\"at_cmds\":%llu,\"at_errors\":%llu,\"writes\":%llu,"
+          "\"words\":%llu,\"sealed\":%llu,\"compact\":%llu,\"batches\":%llu,\"acks\":%llu,\"ack_ranges\":%llu,\"health\":%llu,\"imu\":%llu,\"link_drops\":%llu,\"lost_in\":%llu,\"lost_out\":%llu,"
+          "\"bad_frames\":%llu,\"auth_fail\":%llu,\"replays\":%llu,\"ev_drops\":%llu,\"bytes_in\":%llu,\"bytes_out\":%llu,"
+          "\"estops\":%llu,\"estop_marks\":%llu,\"sched\":%llu,\"sched_late\":%llu,\"sched_lead_min_us\":%llu,\"expired\":%llu,\"echoes\":%llu,\"pool_full\":%llu,\"fec_parity\":%llu,\"paced\":%llu,\"prio\":%llu}\n",
+          (unsigned long long)g_st.at_cmds, (unsigned long long)g_st.at_errors,
+          (unsigned long long)g_st.writes, (unsigned long long)g_st.words,
+          (unsigned long long)g_st.sealed, (unsigned long long)g_st.compact, (unsigned long long)g_st.batches, (unsigned long long)g_st.acks,
+          (unsigned long long)g_st.ack_ranges,
+          (unsigned long long)g_st.health, (unsigned long long)g_st.imu, (unsigned long long)g_st.link_drops,
+          (unsigned long long)g_st.lost_in,
+          (unsigned long long)g_st.lost_out, (unsigned long long)g_st.bad_frames,
+          (unsigned long long)g_st.auth_fail, (unsigned long long)g_st.replays, (unsigned long long)g_st.ev_drops,
+          (unsigned long long)g_st.bytes_in, (unsigned long long)g_st.bytes_out,
+          (unsigned long long)g_st.estops, (unsigned long long)g_st.estop_marks,
+          (unsigned long long)g_st.sched, (unsigned long long)g_st.sched_late, (unsigned long long)g_st.sched_lead_min_us,
+          (unsigned long long)g_st.expired,
+          (unsigned long long)g_st.echoes, (unsigned long long)g_st.pool_full,
+          (unsigned long long)g_st.fec_parity, (unsigned long long)g_st.paced, (unsigned long long)g_st.prio);
+}
+
+static void on_signal(int sig) {
+  (void)sig;
+  g_stop = 1;
+}
+
+static int usage(const char *argv0) {
+  fprintf(stderr, "usage: %s [-L link] [-d ms] [-j ms] [-a ms] [-c ms] [-p pct] [-e pct]\n"
+                  "          [-H ms] [-I ms] [-D ms] [-m mtu] [-s sec] [-S seed] [-b mode] [-F rows] [-r dBm] [-T] [-x] [-g]\n", argv0);
+  return 2;
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  while ((opt = getopt(argc, argv, "L:d:j:a:c:p:e:H:I:D:m:s:S:b:F:r:Txg")) != -1) {
+    switch (opt) {
+      case 'L': g_cfg.link = optarg; break;
+      case 'd': g_cfg.at_ms = atoi(optarg); break;
+      case 'j': g_cfg.jitter_ms = atoi(optarg); break;
+      case 'a': g_cfg.ack_ms = atoi(optarg); break;
+      case 'c': g_cfg.conn_ms = atoi(optarg); break;
+      case 'p': g_cfg.loss = atof(optarg) / 100.0; break;
+      case 'e': g_cfg.at_err = atof(optarg) / 100.0; break;
+      case 'H': g_cfg.health_ms = atoi(optarg); break;
+      case 'I': g_cfg.imu_ms = atoi(optarg); break;
+      case 'D': g_cfg.drop_ms = atoi(optarg); break;
+      case 'm': g_cfg.mtu = atoi(optarg); break;
+      case 's': g_cfg.stats_s = atoi(optarg); break;
+      case 'S': g_cfg.seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'T': g_cfg.trace_lat = 1; break;
+      case 'F': g_cfg.fec_rows = atoi(optarg); break;
+      case 'r': g_cfg.rssi = atoi(optarg); break;
+      case 'x': g_cfg.hex_notify = 1; break;
+      case 'g': g_cfg.need_disc = 1; break;
+      case 'b': g_cfg.baud_mode = atoi(optarg); break;
+      default:  return usage(argv[0]);
+    }
+  }
+  g_rng = g_cfg.seed ? g_cfg.seed : 1;
+  g_clock_off = rnd();
+
+  // Same provider selection as the bridge, so sealed frames round-trip
+  const char *crypto = getenv("GS_CRYPTO");
+  if (!(crypto && crypto[0] && gs_crypto_use(crypto) == 0) && gs_crypto_autoselect() != 0)
+    fprintf(stderr, "WARN: no AES-GCM provider, sealed frames will be rejected\n");
+  gs_nonce_set_dir(REPLAY_DIR_ROBOT);      // Reports are sealed as the robot seals them
+
+  g_fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (g_fd < 0 || grantpt(g_fd) != 0 || unlockpt(g_fd) != 0) { perror("pty"); return 1; }
+  struct termios tio;
+  if (tcgetattr(g_fd, &tio) == 0) {        // No echo, no CR/LF translation
+    cfmakeraw(&tio);
+    tcsetattr(g_fd, TCSANOW, &tio);
+  }
+  const char *slave = ptsname(g_fd);
+  int hold = open(slave, O_RDWR | O_NOCTTY); // Keeps the master readable across bridge restarts
+  fcntl(g_fd, F_SETFL, fcntl(g_fd, F_GETFL) | O_NONBLOCK);
+
+  if (g_cfg.link) {
+    unlink(g_cfg.link);
+    if (symlink(slave, g_cfg.link) != 0) { perror("symlink"); return 1; }
+  }
+  printf("esp_sim: UART_DEV=%s\n", g_cfg.link ? g_cfg.link : slave);
+  fflush(stdout);
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  uint64_t next_health = now_us() + (uint64_t)g_cfg.health_ms * 1000u;
+  uint64_t next_imu = now_us() + (uint64_t)g_cfg.imu_ms * 1000u;
+  uint64_t next_stats = now_us() + (uint64_t)g_cfg.stats_s * 1000000u;
+  uint64_t next_drop = now_us() + (uint64_t)g_cfg.drop_ms * 1000u;
+  while (!g_stop) {
+    int timeout = ev_run();
+    uint64_t t = now_us();
+
+    if (g_cfg.health_ms > 0) {
+      if (t >= next_health) {
+        for (int i = 0; i < BLE_LINKS_MAX; i++) robot_health(i);
+        next_health = t + (uint64_t)g_cfg.health_ms * 1000u;
+      }
+      int h = (int)((next_health - t + 999) / 1000);
+      if (timeout < 0 || h < timeout) timeout = h;
+    }
+    if (g_cfg.imu_ms > 0) {
+      if (t >= next_imu) {
+        for (int i = 0; i < BLE_LINKS_MAX; i++) robot_imu(i);
+        next_imu = t + (uint64_t)g_cfg.imu_ms * 1000u;
+      }
+      int m = (int)((next_imu - t + 999) / 1000);
+      if (timeout < 0 || m < timeout) timeout = m;
+    }
+    for (int i = 0; i < BLE_LINKS_MAX; i++) {       // Slots back after a low advertisement
+      sim_link_t *l = &g_link[i];
+      if (!l->connected || l->told > SIM_CREDIT_LOW) continue;
+      if (pool_free(l, t) >= l->told + SIM_CREDIT_STEP) { robot_health(i); continue; }
+      for (int k = 0; k < SIM_RX_POOL; k++) {
+        if (l->slot_end[k] <= t) continue;
+        int c = (int)((l->slot_end[k] - t + 999) / 1000);
+        if (timeout < 0 || c < timeout) timeout = c;
+      }
+    }
+    for (int i = 0; i < BLE_LINKS_MAX; i++) {
+      if (!g_link[i].acks.n) continue;
+      if (t >= g_link[i].ack_due_us) { ack_range_flush(i); continue; }
+      int a = (int)((g_link[i].ack_due_us - t + 999) / 1000);
+      if (timeout < 0 || a < timeout) timeout = a;
+    }
+    if (g_cfg.drop_ms > 0) {
+      if (t >= next_drop) {
+        link_drop();
+        next_drop = t + (uint64_t)g_cfg.drop_ms * 1000u;
+      }
+      int d = (int)((next_drop - t + 999) / 1000);
+      if (timeout < 0 || d < timeout) timeout = d;
+    }
+    if (g_cfg.stats_s > 0 && t >= next_stats) {
+      print_stats();
+      next_stats = t + (uint64_t)g_cfg.stats_s * 1000000u;
+    }
+    if (g_cfg.stats_s > 0 && (timeout < 0 || timeout > 1000)) timeout = 1000;
+
+    struct pollfd pfd = { .fd = g_fd, .events = POLLIN };
+    if (poll(&pfd, 1, timeout) <= 0) continue;
+
+    uint8_t buf[4096];
+    ssize_t r = read(g_fd, buf, sizeof(buf));
+    if (r > 0) uart_in(buf, (size_t)r);
+    else if (r < 0 && errno != EAGAIN && errno != EINTR) usleep(10000);
+  }
+
+  print_stats();
+  if (g_cfg.link) unlink(g_cfg.link);
+  if (hold >= 0) close(hold);
+  close(g_fd);
+  gs_crypto_shutdown();
+  return 0;
+}
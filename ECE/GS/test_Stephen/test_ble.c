@@ -10,7 +10,7 @@
 #include "../includes/ble/ble.h"
 #include "../includes/ble/uart_queue.h"
 #include "../includes/cmd_structure.h"
-//gcc -O2 -Wall -Wextra test_ble.c ../includes/ble/ble.c ../includes/ble/uart_queue.c -I../includes -o test_ble.o
+//gcc -O2 -Wall -Wextra test_ble.c ../includes/ble/ble.c ../includes/ble/uart_queue.c ../includes/ble/uart_reader.c -I../includes -pthread -o test_ble.o
 
 
 #define byte_test_size  156
@@ -58,7 +58,7 @@ int main() {
     while(1){
         ble_uart_check(bt_uart);
         char msg[256];
-        if (uart_queue_pop(&uart_queue, msg) == 0)
+        if (uart_queue_pop(&uart_queue, msg, sizeof(msg)) >= 0)
         {
             if (strstr(msg, "NOTI") != NULL) 
             {
@@ -27,35 +27,28 @@ void app_main(void) {
     }
  
     //imu_tare_process(imu);
-    
-    int64_t last_print_us = esp_timer_get_time();
+
+    if (!imu_start(imu, 0, 4)) {
+        ESP_LOGE(IMU_TAG, "Failed to start IMU task, halting");
+        while (1) { vTaskDelay(pdMS_TO_TICKS(1000)); }
+    }
 
     while (1) {
-        if (gpio_get_level(IMU_INT_PIN) == 0) {
-            while (gpio_get_level(IMU_INT_PIN) == 0) {
-                imu_check_safe(imu);
-            }
-        }
-        
-        // Print at throttled rate
-        int64_t now_us = esp_timer_get_time();
-        if (now_us - last_print_us >= PRINT_EVERY_MS * 1000LL) {
-            last_print_us = now_us;
+        vTaskDelay(pdMS_TO_TICKS(PRINT_EVERY_MS));
 
-            ESP_LOGI(IMU_TAG, "ACCEL  x=%7.3f  y=%7.3f  z=%7.3f m/s2",
-                     g_imu_accel.x, g_imu_accel.y, g_imu_accel.z);
+        imu_sample_t s;
+        if (!imu_get(&s)) continue;
 
-            ESP_LOGI(IMU_TAG, "GYRO   x=%7.3f  y=%7.3f  z=%7.3f rad/s  |  x=%7.2f  y=%7.2f  z=%7.2f deg/s",
-                     g_imu_gyro.x_rads, g_imu_gyro.y_rads, g_imu_gyro.z_rads,
-                     g_imu_gyro.x_degs, g_imu_gyro.y_degs, g_imu_gyro.z_degs);
+        // Samples are fixed point (pinout.h); scaled here for reading only
+        ESP_LOGI(IMU_TAG, "ACCEL  x=%7.3f  y=%7.3f  z=%7.3f m/s2",
+                 s.accel.x / 256.0f, s.accel.y / 256.0f, s.accel.z / 256.0f);
 
-            ESP_LOGI(IMU_TAG, "EULER  yaw=%7.2f  pitch=%7.2f  roll=%7.2f deg",
-                     g_imu_euler.yaw, g_imu_euler.pitch, g_imu_euler.roll);
-                     
-            
-        }
+        ESP_LOGI(IMU_TAG, "GYRO   x=%7.3f  y=%7.3f  z=%7.3f rad/s  |  x=%7.1f  y=%7.1f  z=%7.1f deg/s",
+                 s.gyro.x / 512.0f, s.gyro.y / 512.0f, s.gyro.z / 512.0f,
+                 IMU_GYRO_D10(s.gyro.x) / 10.0f, IMU_GYRO_D10(s.gyro.y) / 10.0f, IMU_GYRO_D10(s.gyro.z) / 10.0f);
 
-        vTaskDelay(pdMS_TO_TICKS(1));
+        ESP_LOGI(IMU_TAG, "EULER  yaw=%7.2f  pitch=%7.2f  roll=%7.2f deg  (%u packets)",
+                 s.euler.yaw / 1000.0f, s.euler.pitch / 1000.0f, s.euler.roll / 1000.0f, (unsigned)s.packets);
     }
 }
 
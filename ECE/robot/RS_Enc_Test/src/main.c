@@ -1,5 +1,6 @@
 #include "aes_gcm_decrypt.h"
 #include "aes_gcm_encrypt.h"
+#include "aes_gcm_backend.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -88,6 +89,10 @@ int app_main(void)
     printf("Decrypted  : \"%s\"\n", plaintext_out);
     printf("Result     : PASS\n");
 
+    // --- backend comparison (wolfSSL vs ESP32 AES peripheral) -----------
+    printf("\n");
+    aes_gcm_bench(1000);
+
     // -----------------------------------------------------------------------
     // Hardcoded packet test — paste a hex packet from a previous run above
     // -----------------------------------------------------------------------
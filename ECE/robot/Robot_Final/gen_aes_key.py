@@ -0,0 +1,47 @@
+# gen_aes_key.py
+#
+# PlatformIO pre-build step (extra_scripts): writes the built-in packet key
+# as a const byte array into components/Encryption_Decryption/aes_key_gen.h,
+# so the firmware neither carries nor parses the hex string.
+#
+# The key comes from the AES_KEY_HEX environment variable (64 hex chars),
+# else the development key below; it must match the GS key. The header is
+# only rewritten when its contents change, so an unchanged key does not
+# rebuild the component; the copy in the tree holds the development key, for
+# builds that do not go through PlatformIO. A key provisioned into NVS (aes_key.h) overrides
+# the built-in one at run time.
+
+import os
+
+Import("env")
+
+DEV_KEY_HEX = "a1b2c3d4e5f6789012345678901234567890abcdef1234567890abcdef123456"
+
+key_hex = os.environ.get("AES_KEY_HEX", DEV_KEY_HEX).strip()
+try:
+    key = bytes.fromhex(key_hex)
+except ValueError:
+    key = b""
+if len(key) != 32:
+    env.Exit("gen_aes_key.py: AES_KEY_HEX must be 64 hex chars (32 bytes)")
+
+rows = ",\n".join("    " + ", ".join("0x%02x" % b for b in key[i:i + 16]) for i in range(0, 32, 16))
+text = (
+    "// Generated by Robot_Final/gen_aes_key.py; do not edit.\n"
+    "#ifndef AES_KEY_GEN_H\n"
+    "#define AES_KEY_GEN_H\n"
+    "\n"
+    "#define AES_KEY_BUILTIN_INIT { \\\n" + rows.replace("\n", " \\\n") + " \\\n}\n"
+    "\n"
+    "#endif\n"
+)
+
+out = os.path.join(env.subst("$PROJECT_DIR"), "..", "components", "Encryption_Decryption", "aes_key_gen.h")
+try:
+    with open(out) as f:
+        same = f.read() == text
+except OSError:
+    same = False
+if not same:
+    with open(out, "w") as f:
+        f.write(text)
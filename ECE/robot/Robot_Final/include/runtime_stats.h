@@ -0,0 +1,17 @@
+#ifndef RUNTIME_STATS_H
+#define RUNTIME_STATS_H
+
+#include <stdint.h>
+
+// Per-task CPU share, core and stack headroom, plus per-core load since
+// the previous dump (100% - idle). Needs CONFIG_FREERTOS_USE_TRACE_FACILITY
+// and CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS; otherwise prints a hint.
+void runtime_stats_dump(void);
+
+// Task body: dump every period_ms (passed as the task parameter, 0 = never);
+// with CONFIG_PM_PROFILING (sdkconfig.pm) the esp_pm mode and lock times
+// too. Every BLE_METRICS_MS it also publishes a metrics snapshot while a
+// link is subscribed (ble_metrics.h).
+void runtime_stats_task(void *pvParameters);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef TASK_PLAN_H
+#define TASK_PLAN_H
+
+#include "sdkconfig.h"
+
+// -------------------------------------------------------------------------
+// Core affinity / priority plan for Robot_Final
+//
+//   core 0   Bluedroid host + BT controller (sdkconfig), telemetry task
+//            (report rates: components/Telemetry/telemetry.h), IMU reader
+//            woken by the BNO08x INT line (components/i2c_imu/imu.h),
+//            alert checks woken by each IMU sample (components/Telemetry/hpr.h)
+//   core 1   command executor (decrypt + dispatch + motion), arm
+//            interpolator just below it (components/ARM/arm.h)
+//
+// The executor owns core 1 so a burst of GATT/BTC work on core 0 cannot
+// delay a decrypt or a motor update, and vice versa. Override any value
+// with -D in platformio.ini build_flags. Stack sizes, and the static
+// allocation build, are in components/task_alloc/task_alloc.h.
+// -------------------------------------------------------------------------
+
+#ifndef CORE_BLE
+#define CORE_BLE            0       // Must match CONFIG_BT_BLUEDROID_PINNED_TO_CORE
+#endif
+#ifndef CORE_EXECUTOR
+#define CORE_EXECUTOR       1
+#endif
+#ifndef CORE_TELEMETRY
+#define CORE_TELEMETRY      CORE_BLE  // Reports end in GATT notifies anyway
+#endif
+#ifndef CORE_ARM
+#define CORE_ARM            CORE_EXECUTOR
+#endif
+#ifndef CORE_IMU
+#define CORE_IMU            CORE_BLE  // Short I2C bursts; keeps core 1 for motion
+#endif
+#ifndef CORE_HPR
+#define CORE_HPR            CORE_IMU  // Right behind the sample it checks
+#endif
+
+#ifndef PRIO_EXECUTOR
+#define PRIO_EXECUTOR       5
+#endif
+#ifndef PRIO_TELEMETRY
+#define PRIO_TELEMETRY      3
+#endif
+#ifndef PRIO_ARM
+#define PRIO_ARM            4       // 200 Hz servo ticks, yields to the executor
+#endif
+#ifndef PRIO_IMU
+#define PRIO_IMU            4       // Above telemetry so reports carry fresh samples
+#endif
+#ifndef PRIO_HPR
+#define PRIO_HPR            PRIO_IMU  // An alert is not held behind a telemetry pass
+#endif
+#ifndef PRIO_RUNTIME_STATS
+#define PRIO_RUNTIME_STATS  1       // Just above idle
+#endif
+
+#ifndef RUNTIME_STATS_PERIOD_MS
+#define RUNTIME_STATS_PERIOD_MS 10000   // 0 = no periodic dump
+#endif
+
+#if defined(CONFIG_BT_BLUEDROID_PINNED_TO_CORE) && !CONFIG_FREERTOS_UNICORE
+_Static_assert(CORE_BLE == CONFIG_BT_BLUEDROID_PINNED_TO_CORE,
+               "CORE_BLE disagrees with the Bluedroid core in sdkconfig");
+_Static_assert(CORE_EXECUTOR != CORE_BLE, "executor should not share the BLE core");
+#endif
+
+#endif
@@ -0,0 +1,9 @@
+# Power management (env:esp32dev_pm, robot_pm.h), on top of sdkconfig.esp32dev
+CONFIG_PM_ENABLE=y
+CONFIG_PM_PROFILING=y
+CONFIG_FREERTOS_USE_TICKLESS_IDLE=y
+CONFIG_FREERTOS_IDLE_TIME_BEFORE_SLEEP=3
+# BLE modem sleep between connection events, clocked from the main XTAL
+CONFIG_BTDM_CTRL_MODEM_SLEEP=y
+CONFIG_BTDM_CTRL_MODEM_SLEEP_MODE_ORIG=y
+CONFIG_BTDM_CTRL_LPCLK_SEL_MAIN_XTAL=y
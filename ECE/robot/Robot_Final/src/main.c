@@ -6,6 +6,7 @@
 #include "driver/uart.h"
 #include "nvs_flash.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "pinout.h"
 #include "Robot_BLE.h"
@@ -14,178 +15,440 @@
 #include "i2c.h"
 #include "imu.h"
 #include "aes_gcm_decrypt.h"
+#include "aes_key.h"
 #include "arm.h"
+#include "task_plan.h"
+#include "task_alloc.h"
+#include "runtime_stats.h"
+#include "telemetry.h"
+#include "hpr.h"
+#include "odometry.h"
+#include "trajectory.h"
+#include "trace.h"
+#include "robot_pm.h"
+#include "battery.h"
+#include "ble_metrics.h"
+#include "hot_path.h"
 
 
 step_mot_t front_left;
 step_mot_t front_right;
 step_mot_t back_left;
 step_mot_t back_right;
+drivetrain_t drivetrain;           // All four wheels as one (control_cmd)
 
-static QueueHandle_t cmd_queue = NULL;
+// -------------------------------------------------------------------------
+// Command executor
+// One task takes pool slots from the BLE callback, decrypts them in place
+// and runs them. Arrivals are sorted into three lanes:
+//   sys_lane     System + Query; always drained before any motion
+//   motion_lane  Control + Arm, from the central owning the control lane
+//                (cmd_codec.h, Multi-central); anyone else's are refused
+//   obs_lane     System + Query from the other central; only when the
+//                owner has nothing to run (its e-stop still goes first)
+// Within a lane the highest pl (priority level) runs first, FIFO on ties.
+// New arrivals are picked up between every command, so a System command
+// overtakes motion that is still queued; an e-stop also drops it. The stop
+// itself has usually happened already, in the BLE callback (robot_estop()).
+// Motion words with an execute-at time (cmd_codec.h, Scheduled execution)
+// sit in motion_lane until it comes; exec_at_timer wakes the executor then.
+// Among due motion words of one pl the earliest deadline runs first, and a
+// drive or arm word past its deadline is dropped and ACKed CMD_EXPIRED.
+// -------------------------------------------------------------------------
+typedef struct {
+    ble_rx_pkt_t *slot[BLE_RX_POOL_SIZE];   // Can't overflow: one entry per pool slot
+    int n;
+} cmd_lane_t;
 
-void ble_recieve_parser(void *pvParameters)
+static cmd_lane_t sys_lane;
+static cmd_lane_t motion_lane;
+static cmd_lane_t obs_lane;
+static esp_timer_handle_t exec_at_timer;
+
+static HOT_PATH void lane_push(cmd_lane_t *lane, ble_rx_pkt_t *pkt)
 {
-    uint8_t received_packet[PACKET_SIZE]; 
-    
-    while (1) {
-        robot_bt_packet_t cmd_packet = {0};
-        int tag_check = -1;
-
-        if (xQueueReceive(ble_recieve_queue, &received_packet, portMAX_DELAY))
-        {   
-            //ESP_LOGI(MAIN_TAG, "RECIEVED BLE DATA");
-            
-            if (security_flag) {
-                ESP_LOGI(MAIN_TAG, "Secure Mode - Decrypting Data");
-                
-                char plaintext[256];
-                size_t pt_len = 0;
-                tag_check = aes_gcm_decrypt_packet(received_packet, plaintext, &pt_len);
-
-                if (tag_check == 0) {
-                    /*
-                    ESP_LOGI(MAIN_TAG, "Decrypted Hex: %02X %02X %02X %02X %02X %02X %02X %02X",
-                         cmd_packet.bytes[0], cmd_packet.bytes[1], cmd_packet.bytes[2], cmd_packet.bytes[3],
-                         cmd_packet.bytes[4], cmd_packet.bytes[5], cmd_packet.bytes[6], cmd_packet.bytes[7]);
-                    */
-                    memcpy(cmd_packet.bytes, plaintext, 8);
-                } else {
-                    ESP_LOGW(MAIN_TAG, "Secure Mode - Decryption Failed");
-                    send_ack(0, RESULT_AUTH_FAIL, security_flag, NO_INFO);
-                }
-                
-            }else{
-                memcpy(cmd_packet.bytes, received_packet, 8);
-                tag_check = 0;
-            }
+    lane->slot[lane->n++] = pkt;
+}
 
-            if (tag_check == 0){
-                if (xQueueSend(cmd_queue, &cmd_packet, 0) != pdPASS) {
-                    ESP_LOGW(MAIN_TAG, "cmd_queue full");
-                }
-                
-            }
+static HOT_PATH ble_rx_pkt_t *lane_pop(cmd_lane_t *lane)
+{
+    if (lane->n == 0) return NULL;
+
+    int best = 0;
+    for (int i = 1; i < lane->n; i++) {
+        if (lane->slot[i]->cmd.ctrl.pl > lane->slot[best]->cmd.ctrl.pl) best = i;
+    }
+    ble_rx_pkt_t *pkt = lane->slot[best];
+    lane->n--;
+    memmove(&lane->slot[best], &lane->slot[best + 1], (lane->n - best) * sizeof(lane->slot[0]));
+    return pkt;
+}
+
+// us until a motion word's execute-at time; <= 0 = run it now
+static int32_t motion_wait_us(const ble_rx_pkt_t *pkt, uint32_t now)
+{
+    uint32_t at = pkt->cmd.ctrl.type == CONTROL_CMD ? pkt->cmd.ctrl.at :
+                  pkt->cmd.ctrl.type == ARM_CMD     ? pkt->cmd.arm.at  : 0;
+    if (!at) return 0;
+    int32_t us = exec_at_until_us(at, now);
+    return us > EXEC_AT_HORIZON_MS * 1000 ? 0 : us;
+}
+
+// us until a motion word's deadline: its execute-at time plus
+// EXEC_AT_LATE_MS, else its arrival plus MOTION_DEADLINE_MS; INT32_MAX for
+// words that never expire (targets, trajectory words)
+static int32_t motion_deadline_us(const ble_rx_pkt_t *pkt, uint32_t now)
+{
+    int type = pkt->cmd.ctrl.type;
+    if (type != CONTROL_CMD && type != ARM_CMD) return INT32_MAX;
+    uint32_t at = type == CONTROL_CMD ? pkt->cmd.ctrl.at : pkt->cmd.arm.at;
+    if (at) {
+        int32_t us = exec_at_until_us(at, now);
+        if (us <= EXEC_AT_HORIZON_MS * 1000) return us + EXEC_AT_LATE_MS * 1000;
+    }
+    return (int32_t)(pkt->t_rx_us + MOTION_DEADLINE_MS * 1000 - now);
+}
+
+// Drops motion_lane slot i unrun
+static void motion_expire(int i, int32_t late_us)
+{
+    ble_rx_pkt_t *pkt = motion_lane.slot[i];
+    uint32_t id = pkt->cmd.ctrl.type == ARM_CMD ? pkt->cmd.arm.id : pkt->cmd.ctrl.id;
+    ESP_LOGW(MAIN_TAG, "Motion cmd %u expired, %d ms late", (unsigned)id, (int)(late_us / 1000));
+    cmd_conn = pkt->conn;
+    send_ack(id, RESULT_CMD_FAILURE, CMD_EXPIRED);
+    motion_lane.n--;
+    memmove(&motion_lane.slot[i], &motion_lane.slot[i + 1], (motion_lane.n - i) * sizeof(motion_lane.slot[0]));
+    ble_rx_pool_free(pkt);
+}
+
+// lane_pop() over the words that are due, earliest deadline first on equal
+// pl, expired ones dropped; if none is due, the timer is armed for the
+// earliest one
+static ble_rx_pkt_t *motion_pop(void)
+{
+    uint32_t now = trace_now_us();
+    int best = -1;
+    int32_t next = INT32_MAX, best_dl = INT32_MAX;
+    for (int i = 0; i < motion_lane.n; ) {
+        ble_rx_pkt_t *pkt = motion_lane.slot[i];
+        int32_t dl = motion_deadline_us(pkt, now);
+        if (dl < 0) {
+            motion_expire(i, -dl);
+            continue;
+        }
+        int32_t us = motion_wait_us(pkt, now);
+        if (us > 0) {
+            if (us < next) next = us;
+        } else if (best < 0 || pkt->cmd.ctrl.pl > motion_lane.slot[best]->cmd.ctrl.pl ||
+                   (pkt->cmd.ctrl.pl == motion_lane.slot[best]->cmd.ctrl.pl && dl < best_dl)) {
+            best = i;
+            best_dl = dl;
+        }
+        i++;
+    }
+    if (best < 0) {
+        if (next != INT32_MAX) {
+            esp_timer_stop(exec_at_timer);
+            esp_timer_start_once(exec_at_timer, (uint64_t)next);
         }
+        return NULL;
     }
+    ble_rx_pkt_t *pkt = motion_lane.slot[best];
+    motion_lane.n--;
+    memmove(&motion_lane.slot[best], &motion_lane.slot[best + 1], (motion_lane.n - best) * sizeof(motion_lane.slot[0]));
+    return pkt;
 }
 
-void command_parser(void *pvParameters)
+static void exec_at_wake(void *arg)
 {
-    robot_bt_packet_t cmd;
-    while (1)
-    {
-        if (xQueueReceive(cmd_queue, &cmd, portMAX_DELAY))
-        {
-            ESP_LOGI(MAIN_TAG, "Packet Parsing Initiated");
-            
-            command_type_t cmd_type = (command_type_t)cmd.ctrl.type;
+    (void)arg;
+    ble_rx_pool_wake();
+}
 
-            switch (cmd_type){
-                case CONTROL_CMD:
-                    control_cmd(cmd.ctrl, &front_left, &front_right, &back_left, &back_right);
-                break;
+static void lane_flush(cmd_lane_t *lane)
+{
+    for (int i = 0; i < lane->n; i++) ble_rx_pool_free(lane->slot[i]);
+    lane->n = 0;
+}
 
-                case ARM_CMD:
-                    ESP_LOGI(MAIN_TAG, "Arm CMD Recieved");
-                    arm_cmd(cmd.arm, &front_left, &front_right, &back_left, &back_right);
-                break;
+// Secure mode: decrypt in place (the 8 plaintext bytes overwrite the spent
+// ciphertext). Plain mode: the command bytes are already pkt->cmd. A sealed
+// CIPHER_MARK_BATCH frame carries [n][n words]: the first word lands in
+// pkt->cmd, the rest in more[]. A compact seal (compact_seal.h) carries the
+// words alone, n from its header. Returns the word count, 0 if rejected.
+static HOT_PATH int cmd_decode(ble_rx_pkt_t *pkt, robot_bt_packet_t more[BLE_BATCH_MAX - 1])
+{
+    if (!pkt->secure) {
+        if (TRACE_LAT) pkt->t_dec_us = trace_now_us();
+        return 1;
+    }
 
-                case System_CMD:
-                    ESP_LOGI(MAIN_TAG, "System CMD Recieved");
-                    system_cmd(cmd.sys, &front_left, &front_right, &back_left, &back_right);
-                break;
-                
-                case Query_CMD:
-                    ESP_LOGI(MAIN_TAG, "Query CMD Recieved");
-                    query_cmd(cmd.query, &front_left, &front_right, &back_left, &back_right);
-                break;
-                
-                default:
-                    send_ack(0, RESULT_UNKNOWN_CMD, security_flag, NO_INFO);
+    // Compact frames carry the nonce after the count, the ciphertext after it
+    const uint8_t *nonce = pkt->data, *ct = NULL;
+    int n = 1;
+    if (pkt->compact) {
+        uint8_t mark = pkt->batch ? SEAL_MARK_BATCH : SEAL_MARK_WORD;
+        n = seal_words(mark, pkt->data);
+        nonce = pkt->data + seal_nonce_off(mark);
+        ct = nonce + SEAL_NONCE_LEN;
+    }
+
+    // Replay window first (the sequence rides in the authenticated nonce);
+    // it only moves once the tag has verified
+    replay_window_t *win = &connected_devices[pkt->conn].sess.replay;
+    uint64_t seq;
+    if (!replay_nonce_seq(nonce, REPLAY_DIR_GS, &seq) || !replay_check(win, seq)) {
+        ESP_LOGW(MAIN_TAG, "Secure Mode - Replayed packet dropped");
+        ble_metrics_count(METRIC_REPLAY_DROP);
+        send_ack(0, RESULT_DUPLICATE_PACKET, NO_INFO);
+        return 0;
+    }
+
+    char plaintext[256];
+    size_t pt_len = 0;
+    int rc;
+    int64_t t_dec = esp_timer_get_time();
+    if (pkt->compact) {
+        rc = aes_gcm_decrypt_raw(nonce, ct, (size_t)n * 8, ct + n * 8, (uint8_t *)plaintext);
+    } else {
+        rc = aes_gcm_decrypt_packet(pkt->data, plaintext, &pt_len);
+    }
+    ble_metrics_decrypt_us((uint32_t)(esp_timer_get_time() - t_dec));
+    TRACE(EXEC, DECRYPT, rc == 0, 0, 0);
+    if (rc != 0) {
+        ESP_LOGW(MAIN_TAG, "Secure Mode - Decryption Failed");
+        ble_metrics_count(METRIC_AUTH_FAIL);
+        send_ack(0, RESULT_AUTH_FAIL, NO_INFO);
+        return 0;
+    }
+    replay_accept(win, seq);
+
+    const char *word = plaintext;
+    if (pkt->batch && !pkt->compact) {
+        n = (uint8_t)plaintext[0];
+        if (n < 1 || n > BLE_BATCH_MAX) {
+            ESP_LOGW(MAIN_TAG, "Secure Mode - Bad batch count %d", n);
+            return 0;
+        }
+        word = plaintext + 1;
+    }
+    for (int i = 1; i < n; i++) memcpy(more[i - 1].bytes, word + i * 8, 8);
+    memcpy(pkt->cmd.bytes, word, 8);
+    if (TRACE_LAT) pkt->t_dec_us = trace_now_us();
+    return n;
+}
+
+static HOT_PATH void cmd_sort(ble_rx_pkt_t *pkt)
+{
+    int owner = ble_control_owner();
+    cmd_lane_t *other = owner >= 0 && owner != pkt->conn ? &obs_lane : &sys_lane;
+
+    switch ((command_type_t)pkt->cmd.ctrl.type) {
+        case System_CMD:
+            if (cmd_word_is_estop(pkt->cmd.raw)) {
+                if (motion_lane.n) {
+                    ESP_LOGW(MAIN_TAG, "Emergency shutdown - dropping %d queued motion cmds", motion_lane.n);
+                    lane_flush(&motion_lane);
+                }
+                lane_push(&sys_lane, pkt);      // Whichever central sent it
                 break;
             }
+            lane_push(other, pkt);
+        break;
 
-            //vTaskDelay(pdMS_TO_TICKS(1)); 
-            
-            step_mot_t* motors[] = { &front_left, &front_right, &back_left, &back_right };
-            bool all_idle = true;
-            for (int i = 0; i < 4; i++) {
-                if (motors[i]->status == MOTOR_RUNNING) {
-                    all_idle = false;
-                    break;
-                }
+        case Query_CMD:
+            lane_push(other, pkt);
+        break;
+
+        case CONTROL_CMD:
+        case ARM_CMD:
+        case ARM_TARGET_CMD:
+            if (!ble_control_claim(pkt->conn)) {
+                uint32_t id = pkt->cmd.ctrl.type == ARM_CMD        ? pkt->cmd.arm.id  :
+                              pkt->cmd.ctrl.type == ARM_TARGET_CMD ? pkt->cmd.armt.id : pkt->cmd.ctrl.id;
+                send_ack(id, RESULT_CMD_FAILURE, CONTROL_HELD);
+                ble_rx_pool_free(pkt);
+                break;
             }
+            lane_push(&motion_lane, pkt);
+        break;
 
-            if (all_idle) {
-                ESP_LOGI(MAIN_TAG, "All motors idle — disabling");
-                stepper_disable(&front_left);
-                stepper_disable(&front_right);
-                stepper_disable(&back_left);
-                stepper_disable(&back_right);
+        case TRAJ_CMD:                          // Segments unACKed: refusals only for RUN / ABORT
+            if (!ble_control_claim(pkt->conn)) {
+                send_ack(pkt->cmd.trajc.op >= TRAJ_OP_RUN ? pkt->cmd.trajc.id : 0, RESULT_CMD_FAILURE, CONTROL_HELD);
+                ble_rx_pool_free(pkt);
+                break;
             }
+            lane_push(pkt->cmd.trajc.op == TRAJ_OP_ABORT ? &sys_lane : &motion_lane, pkt);
+        break;
+
+        default:
+            send_ack(0, RESULT_UNKNOWN_CMD, NO_INFO);
+            ble_rx_pool_free(pkt);
+        break;
+    }
+}
+
+// Words of a sealed batch are admitted in order, each in its own slot, so
+// the lanes and the executor never see the difference from single writes
+static HOT_PATH void cmd_admit(ble_rx_pkt_t *pkt)
+{
+    robot_bt_packet_t more[BLE_BATCH_MAX - 1];
+    cmd_conn = pkt->conn;                   // Refusals here go back to the sender
+    int n = cmd_decode(pkt, more);
+    if (n == 0) {
+        ble_rx_pool_free(pkt);
+        return;
+    }
+    drivetrain_keepalive(&drivetrain);      // Any decoded command feeds the setpoint deadman
+
+    uint8_t  secure  = pkt->secure;         // pkt may be freed by cmd_sort
+    uint8_t  conn    = pkt->conn;
+    uint32_t t_rx_us = pkt->t_rx_us, t_dec_us = pkt->t_dec_us;
+    cmd_sort(pkt);
+
+    for (int i = 1; i < n; i++) {
+        ble_rx_pkt_t *next = ble_rx_pool_alloc();
+        if (!next) {
+            ESP_LOGW(MAIN_TAG, "RX pool exhausted, dropping %d batched cmds", n - i);
+            break;
         }
+        next->cmd      = more[i - 1];
+        next->len      = 8;
+        next->secure   = secure;
+        next->conn     = conn;
+        next->t_rx_us  = t_rx_us;
+        next->t_dec_us = t_dec_us;
+        cmd_sort(next);
     }
 }
 
-void app_main()
+static HOT_PATH void cmd_execute(const robot_bt_packet_t *cmd)
+{
+    TRACE(EXEC, EXEC, cmd->ctrl.type, sys_lane.n, motion_lane.n);
+
+    switch ((command_type_t)cmd->ctrl.type) {
+        case CONTROL_CMD:
+            control_cmd(cmd->ctrl, &drivetrain);
+        break;
+
+        case ARM_CMD:
+            arm_cmd(cmd->arm, &front_left, &front_right, &back_left, &back_right);
+        break;
+
+        case ARM_TARGET_CMD:
+            arm_target_cmd(cmd->armt);
+        break;
+
+        case TRAJ_CMD:
+            traj_cmd(cmd);
+        break;
+
+        case System_CMD:
+            system_cmd(cmd->sys, &front_left, &front_right, &back_left, &back_right);
+        break;
+
+        case Query_CMD:
+            query_cmd(cmd->query, &front_left, &front_right, &back_left, &back_right);
+        break;
+
+        default:
+        break;
+    }
+}
+
+void command_executor(void *pvParameters)
+{
+    const esp_timer_create_args_t wake = { .callback = exec_at_wake, .name = "exec_at" };
+    ESP_ERROR_CHECK(esp_timer_create(&wake, &exec_at_timer));
+
+    bool busy = false;
+    while (1) {
+        // Block only when idle (and no ACK range is due sooner); otherwise
+        // just collect whatever has arrived. Held motion counts as idle:
+        // exec_at_timer ends the wait.
+        TickType_t wait = busy ? 0 : ack_wait();
+        ble_rx_pkt_t *pkt;
+        while ((pkt = ble_rx_pool_receive(wait)) != NULL) {
+            cmd_admit(pkt);
+            wait = 0;
+        }
+        ack_poll();
+        traj_poll();                        // Its timer ends the wait at a segment's end
+        ble_metrics_lanes(sys_lane.n, motion_lane.n, obs_lane.n);
+
+        pkt = lane_pop(&sys_lane);
+        if (!pkt) pkt = motion_pop();
+        if (!pkt) pkt = lane_pop(&obs_lane);
+        busy = pkt != NULL;
+        if (!pkt) continue;
+
+        if (TRACE_LAT) trace_lat_begin(&(trace_lat_t){ pkt->t_rx_us, pkt->t_dec_us, 0 });
+        cmd_rx_us = pkt->t_rx_us;
+        cmd_conn = pkt->conn;
+        cmd_execute(&pkt->cmd);
+        ble_rx_pool_free(pkt);              // Command executed: slot back to the pool
+        if (ble_rx_pool_credit_due()) telemetry_request(TLM_HEALTH);
+    }
+}
+
+// Odometry tick (esp_timer task): queue the reports whose values moved
+static void odom_changed(uint32_t changed)
+{
+    if (changed & ODOM_CHANGED_NAV)  telemetry_request(TLM_NAV);
+    if (changed & ODOM_CHANGED_POSE) telemetry_request(TLM_POSE);
+}
+
+// The BNO08x bring-up is mostly resets and settle delays (over a second),
+// so it runs beside the rest of the boot instead of in front of it
+static void imu_boot_task(void *pvParameters)
 {
-    /*
+    (void)pvParameters;
     i2c_master_bus_handle_t i2c_bus = i2c_init();
     i2c_master_dev_handle_t imu     = device_init(i2c_bus, IMU_ADDR);
 
-    if (!bno08x_init(imu)) {
-        ESP_LOGE(IMU_TAG, "Failed to init BNO08x, halting");
-        while (1) { vTaskDelay(pdMS_TO_TICKS(1000)); }
+    // No IMU is not fatal: the robot still drives and reports zero pose
+    if (!bno08x_init(imu) || !imu_start(imu, CORE_IMU, PRIO_IMU)) {
+        ESP_LOGE(IMU_TAG, "Failed to init BNO08x, continuing without IMU");
+    }
+    vTaskDelete(NULL);
+}
+
+// Boot order: radio first, so the GS can connect (directed advertising,
+// Robot_BLE.h) while the rest comes up. Writes that arrive before the
+// executor runs wait in the RX pool.
+void app_main()
+{
+    robot_pm_init();                   // DFS before anything takes a PM lock (ROBOT_PM)
+    ESP_ERROR_CHECK(nvs_flash_init()); // Initialize NVS (BLE keeps the last GS there)
+    if (aes_gcm_prepare() != 0) {      // Packet key (NVS or built-in) expanded before any packet
+        ESP_LOGE("AES_KEY", "Cipher setup failed, retried on the first packet");
+    }
+    robot_ble_init();                  // Initialize BLE; advertising starts from its callbacks
+
+    if (TASK_CREATE_PINNED( imu_boot_task, "imu_boot", STACK_IMU, NULL, PRIO_IMU, NULL, CORE_IMU) != pdPASS) {
+        ESP_LOGE(IMU_TAG, "Failed to start IMU bring-up, continuing without IMU");
     }
-    */
-    ESP_ERROR_CHECK(nvs_flash_init()); // Initialize NVS
-    robot_ble_init();                  // Initialize BLE
 
     motor_init(&front_left, FL_MOTOR_STEP, FL_MOTOR_DIR, FL_MOTOR_EN, FL_MOTOR_PWM, FL_MOTOR_TIMER );
     motor_init(&back_left, BL_MOTOR_STEP, BL_MOTOR_DIR, BL_MOTOR_EN, BL_MOTOR_PWM, BL_MOTOR_TIMER);
     motor_init(&front_right, FR_MOTOR_STEP, FR_MOTOR_DIR, FR_MOTOR_EN, FR_MOTOR_PWM, FR_MOTOR_TIMER );
     motor_init(&back_right, BR_MOTOR_STEP, BR_MOTOR_DIR, BR_MOTOR_EN, BR_MOTOR_PWM, BR_MOTOR_TIMER );
+    drivetrain_init(&drivetrain, &front_left, &front_right, &back_left, &back_right);
+    drive_attach(&drivetrain);         // System cmds stop the held vector
+    traj_init(&drivetrain);
     arm_init();
+    arm_start(CORE_ARM, PRIO_ARM);     // Servo interpolation off the command path
+    battery_init();                    // health.battery (BATT_SENSE)
 
-    cmd_queue = xQueueCreate(10, sizeof(uint64_t)); // Initialize the command queue
-    
-    int64_t last_send_time = 0;
-    int rotation_step = 0;
-    int64_t now = esp_timer_get_time();
-
-
-    xTaskCreatePinnedToCore( ble_recieve_parser, "ble_recieve_parser", 4096, NULL, 5, NULL, 1);
-    xTaskCreatePinnedToCore( command_parser, "robot_command_parser", 4096, NULL, 5, NULL, 1);
-
-    while (1) {
-        /*
-        if (gpio_get_level(IMU_INT_PIN) == 0) {
-            while (gpio_get_level(IMU_INT_PIN) == 0) {
-               // imu_check_safe(imu);
-            }
-        }
-        */
-        
-        now = esp_timer_get_time();
-        if (num_connected > 0) {
-            if (now - last_send_time >= 5000000) { // in us
-                send_health_report();
-                switch (rotation_step) {
-                    //case 0: send_imu(1); break;
-                    //case 1: send_imu(2); break;
-                    //case 2: send_imu(3); break;
-                    //case 3: send_health_report(); break;
-                }
-                
-                rotation_step = (rotation_step + 1) % 4; 
-
-                last_send_time = now;
-            }
-        }
-        
-        //vTaskDelay(pdMS_TO_TICKS(1));
-        
-    }
-    return;
-}
\ No newline at end of file
+    TASK_CREATE_PINNED( command_executor, "robot_cmd_executor", STACK_EXECUTOR, NULL, PRIO_EXECUTOR, NULL, CORE_EXECUTOR);
+    telemetry_start(CORE_TELEMETRY, PRIO_TELEMETRY);   // Per-report esp_timer rates
+    odom_start(drivetrain.m, odom_changed);            // Nav/pose go out when they change
+    hpr_start(&drivetrain, CORE_HPR, PRIO_HPR);        // Threshold alerts, woken per IMU sample
+#if RUNTIME_STATS_PERIOD_MS > 0 || BLE_METRICS_MS > 0
+    TASK_CREATE_PINNED( runtime_stats_task, "rt_stats", STACK_RUNTIME_STATS, (void *)(uintptr_t)RUNTIME_STATS_PERIOD_MS,
+                        PRIO_RUNTIME_STATS, NULL, tskNO_AFFINITY);
+#endif
+    // app_main returns; its task is deleted and nothing spins in the background
+}
@@ -0,0 +1,193 @@
+#include "runtime_stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_system.h"
+#include "ble_metrics.h"
+#include "trace.h"
+#include "task_alloc.h"
+
+#define STATS_TAG "RT_STATS"
+
+#ifndef RUNTIME_STATS_TASKS_MAX
+#define RUNTIME_STATS_TASKS_MAX 32                      // Static snapshot: must hold every task
+#endif
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+// Every task's status; NULL if there's no memory for it. Only the stats
+// task snapshots, so the static one is never shared.
+static TaskStatus_t *task_snapshot(UBaseType_t *n, configRUN_TIME_COUNTER_TYPE *total)
+{
+#if ROBOT_STATIC_ALLOC
+    static TaskStatus_t ts[RUNTIME_STATS_TASKS_MAX];
+    UBaseType_t cap = RUNTIME_STATS_TASKS_MAX;
+#else
+    UBaseType_t cap = uxTaskGetNumberOfTasks() + 4;     // Room for tasks created meanwhile
+    TaskStatus_t *ts = malloc(cap * sizeof(*ts));
+    if (!ts) {
+        ESP_LOGW(STATS_TAG, "No memory for task snapshot");
+        return NULL;
+    }
+#endif
+    *total = 0;
+    *n = uxTaskGetSystemState(ts, cap, total);
+    if (*n == 0) ESP_LOGW(STATS_TAG, "More than %u tasks, raise RUNTIME_STATS_TASKS_MAX", (unsigned)cap);
+    if (*total == 0) *total = 1;
+    return ts;
+}
+
+static void task_snapshot_free(TaskStatus_t *ts)
+{
+#if ROBOT_STATIC_ALLOC
+    (void)ts;
+#else
+    free(ts);
+#endif
+}
+
+void runtime_stats_dump(void)
+{
+    static configRUN_TIME_COUNTER_TYPE prev_total = 0;
+    static configRUN_TIME_COUNTER_TYPE prev_idle[portNUM_PROCESSORS] = {0};
+
+    configRUN_TIME_COUNTER_TYPE total;
+    UBaseType_t n;
+    TaskStatus_t *ts = task_snapshot(&n, &total);
+    if (!ts) return;
+
+    printf("%-16s %4s %4s %7s %6s\n", "task", "core", "prio", "cpu%", "stack");
+    configRUN_TIME_COUNTER_TYPE idle[portNUM_PROCESSORS] = {0};
+    for (UBaseType_t i = 0; i < n; i++) {
+        BaseType_t core = xTaskGetCoreID(ts[i].xHandle);
+        char core_s[5];
+        if (core == tskNO_AFFINITY) snprintf(core_s, sizeof(core_s), "any");
+        else                        snprintf(core_s, sizeof(core_s), "%d", (int)core);
+
+        for (int c = 0; c < portNUM_PROCESSORS; c++) {
+            if (ts[i].xHandle == xTaskGetIdleTaskHandleForCore(c)) idle[c] = ts[i].ulRunTimeCounter;
+        }
+        // Counters are per task; total is wall time, so one busy core is 100%
+        printf("%-16s %4s %4u %6.1f%% %6u\n", ts[i].pcTaskName, core_s,
+               (unsigned)ts[i].uxCurrentPriority,
+               100.0 * (double)ts[i].ulRunTimeCounter / (double)total,
+               (unsigned)ts[i].usStackHighWaterMark);
+    }
+
+    configRUN_TIME_COUNTER_TYPE span = total - prev_total;
+    if (span == 0) span = 1;
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        double busy = 100.0 - 100.0 * (double)(idle[c] - prev_idle[c]) / (double)span;
+        printf("core %d load %5.1f%% (since last dump)\n", c, busy < 0 ? 0.0 : busy);
+        prev_idle[c] = idle[c];
+    }
+    prev_total = total;
+    task_snapshot_free(ts);
+}
+
+#if BLE_METRICS_MS > 0
+// Load and per-task CPU over the time since the previous snapshot (tasks
+// matched by handle; a new one counts from zero), heap, then the counters
+// in ble_metrics_publish()
+static void runtime_stats_metrics(void)
+{
+    static TaskHandle_t prev_h[BLE_METRICS_TASKS_MAX];
+    static configRUN_TIME_COUNTER_TYPE prev_run[BLE_METRICS_TASKS_MAX];
+    static int prev_n = 0;
+    static configRUN_TIME_COUNTER_TYPE prev_total = 0;
+    static configRUN_TIME_COUNTER_TYPE prev_idle[portNUM_PROCESSORS] = {0};
+    static metrics_task_t rows[BLE_METRICS_TASKS_MAX];
+
+    configRUN_TIME_COUNTER_TYPE total;
+    UBaseType_t n;
+    TaskStatus_t *ts = task_snapshot(&n, &total);
+    if (!ts) return;
+
+    configRUN_TIME_COUNTER_TYPE span = total - prev_total;
+    if (span == 0) span = 1;
+    metrics_sys_t sys = {0};
+    int k = 0;
+    for (UBaseType_t i = 0; i < n; i++) {
+        configRUN_TIME_COUNTER_TYPE run = ts[i].ulRunTimeCounter, was = 0;
+        for (int j = 0; j < prev_n; j++) {
+            if (prev_h[j] == ts[i].xHandle) { was = prev_run[j]; break; }
+        }
+        for (int c = 0; c < portNUM_PROCESSORS && c < 2; c++) {
+            if (ts[i].xHandle == xTaskGetIdleTaskHandleForCore(c)) {
+                uint32_t idle = (uint32_t)(1000ULL * (run - prev_idle[c]) / span);
+                sys.load_pm[c] = (uint16_t)(idle < 1000 ? 1000 - idle : 0);
+                prev_idle[c] = run;
+            }
+        }
+        if (k == BLE_METRICS_TASKS_MAX) continue;
+
+        metrics_task_t *r = &rows[k];
+        BaseType_t core = xTaskGetCoreID(ts[i].xHandle);
+        strncpy(r->name, ts[i].pcTaskName, METRICS_TASK_NAME);
+        r->core       = core == tskNO_AFFINITY ? 0xFF : (uint8_t)core;
+        r->prio       = (uint8_t)ts[i].uxCurrentPriority;
+        r->cpu_pm     = (uint16_t)(1000ULL * (run - was) / span);
+        r->stack_free = ts[i].usStackHighWaterMark > 0xFFFF ? 0xFFFF : (uint16_t)ts[i].usStackHighWaterMark;
+        prev_h[k]   = ts[i].xHandle;
+        prev_run[k] = run;
+        k++;
+    }
+    prev_n = k;
+    prev_total = total;
+    task_snapshot_free(ts);
+
+    sys.heap_free = esp_get_free_heap_size();
+    sys.heap_min  = esp_get_minimum_free_heap_size();
+    ble_metrics_publish(&sys, rows, k);
+}
+#endif
+
+#else
+
+void runtime_stats_dump(void)
+{
+    ESP_LOGW(STATS_TAG, "Enable CONFIG_FREERTOS_USE_TRACE_FACILITY and "
+                        "CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS for runtime stats");
+}
+
+#endif
+
+#if BLE_METRICS_MS > 0 && !(CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS)
+// Counters only: no load or task table without the run time stats
+static void runtime_stats_metrics(void)
+{
+    metrics_sys_t sys = {0};
+    sys.heap_free = esp_get_free_heap_size();
+    sys.heap_min  = esp_get_minimum_free_heap_size();
+    ble_metrics_publish(&sys, NULL, 0);
+}
+#endif
+
+void runtime_stats_task(void *pvParameters)
+{
+    const uint32_t dump_ms = (uint32_t)(uintptr_t)pvParameters;
+    const uint32_t tick_ms = BLE_METRICS_MS > 0 ? BLE_METRICS_MS : dump_ms;
+    uint32_t since_dump = 0;
+    TickType_t last = xTaskGetTickCount();
+    while (1) {
+        vTaskDelayUntil(&last, pdMS_TO_TICKS(tick_ms));
+#if BLE_METRICS_MS > 0
+        if (ble_metrics_wanted()) runtime_stats_metrics();
+#endif
+        since_dump += tick_ms;
+        if (dump_ms == 0 || since_dump < dump_ms) continue;
+        since_dump = 0;
+        runtime_stats_dump();
+#if CONFIG_PM_PROFILING
+        esp_pm_dump_locks(stdout);                      // Time per DFS mode and per PM lock
+#endif
+#if TRACE_ANY
+        trace_dump();                                   // Low priority: formatting happens here
+#endif
+    }
+}
@@ -0,0 +1,87 @@
+#!/bin/sh
+# perf_log.sh
+# -----------------------------------------------------------------------------
+# Runs the on-target timing test (test/test_perf) on the connected robot,
+# keeps its PERF lines as perf/<build>.jsonl (build = the app version, git
+# describe), and compares p50 per test with an earlier build:
+#
+#   | test | base p50 | p50 | change |
+#
+# A test whose p50 grew by more than -t percent is marked SLOWER and makes
+# the script exit 1, so a regression shows up in the build that caused it.
+#
+#   -e env        PlatformIO environment (default esp32dev); host runs the
+#                 host build instead (../host, make perf_host) and compares
+#                 it only with earlier host builds
+#   -b base.jsonl build to compare with (default: the newest other file)
+#   -t pct        tolerance (default 5)
+#   -f log        parse a saved `pio test` log instead of running it
+# Run from Robot_Final with the robot on a stand (the wheels turn).
+# -----------------------------------------------------------------------------
+set -eu
+cd "$(dirname "$0")/.."
+
+env=esp32dev
+base=
+tol=5
+log=
+while getopts e:b:t:f: opt; do
+  case $opt in
+    e) env=$OPTARG ;;
+    b) base=$OPTARG ;;
+    t) tol=$OPTARG ;;
+    f) log=$OPTARG ;;
+    *) echo "Usage: $0 [-e env] [-b base.jsonl] [-t pct] [-f log]" >&2; exit 2 ;;
+  esac
+done
+
+mkdir -p perf
+tmp=$(mktemp)
+trap 'rm -f "$tmp"' EXIT
+if [ -z "$log" ]; then
+  if [ "$env" = host ]; then
+    make -C ../host perf_host >&2
+    ../host/perf_host | tee "$tmp" || true
+  else
+    pio test -e "$env" -f test_perf | tee "$tmp" || true
+  fi
+  log=$tmp
+fi
+
+lines=$(grep -o 'PERF {.*}' "$log" | sed 's/^PERF //') || true
+if [ -z "$lines" ]; then
+  echo "no PERF lines in the test output" >&2
+  exit 1
+fi
+build=$(printf '%s\n' "$lines" | head -n 1 | sed 's/.*"build":"\([^"]*\)".*/\1/' | tr '/ ' '__')
+out=perf/$build.jsonl
+printf '%s\n' "$lines" > "$out"
+echo "wrote $out"
+
+if [ -z "$base" ]; then
+  case $build in                    # Host numbers are nanoseconds: never against the target's cycles
+    host-*) base=$(ls -t perf/host-*.jsonl 2>/dev/null | grep -v "^$out\$" | head -n 1) || true ;;
+    *) base=$(ls -t perf/*.jsonl 2>/dev/null | grep -v "^perf/host-" | grep -v "^$out\$" | head -n 1) || true ;;
+  esac
+fi
+[ -n "$base" ] && [ -f "$base" ] || { echo "no earlier build to compare with"; exit 0; }
+
+echo
+echo "| test | $(basename "$base" .jsonl) p50 | $build p50 | change |"
+echo "|---|---|---|---|"
+awk -v tol="$tol" '
+  function field(s, k,   m) {
+    if (match(s, "\"" k "\":\"?[^,}\"]*")) { m = substr(s, RSTART, RLENGTH); sub(/^[^:]*:"?/, "", m); return m }
+    return ""
+  }
+  FNR == NR { p50[field($0, "test")] = field($0, "p50"); next }
+  {
+    t = field($0, "test"); now = field($0, "p50")
+    if (!(t in p50)) { printf "| %s | - | %s | new |\n", t, now; next }
+    pct = p50[t] > 0 ? (now - p50[t]) * 100.0 / p50[t] : 0
+    flag = pct > tol ? " SLOWER" : ""
+    if (flag != "") bad = 1
+    printf "| %s | %s | %s | %+.1f%%%s |\n", t, p50[t], now, pct, flag
+  }
+  END { exit bad }
+' "$base" "$out"
@@ -0,0 +1,384 @@
+// test_perf.c
+//
+// On-target timing of the firmware hot paths, as a PlatformIO Unity test:
+//
+//   pio test -e esp32dev -f test_perf          (robot on a stand: the wheels turn)
+//
+// Every case runs PERF_ITERS times, checks the result, and prints one line
+//
+//   PERF {"test":"...","build":"...","idf":"...","iters":N,"min":..,"p50":..,"p99":..,"max":..}
+//
+// in CPU cycles (esp_cpu_get_cycle_count, this core). build is the app
+// version (PROJECT_VER / git describe), so ../perf_log.sh can keep one file
+// per build and diff it against the last. A case fails on a wrong result,
+// and on a p50 above its PERF_BUDGET_* when one is set (-D in build_flags;
+// 0 = report only).
+//
+// Paths measured: aes_gcm_encrypt_packet / aes_gcm_decrypt_packet (156-byte
+// packets), arm_ik_solve and arm_ik_solve_fast over a grid inside the reach,
+// control_cmd into the drivetrain, motor_pulse, and ble_rx_write framing a
+// plain word and a sealed frame into the RX pool (the GATT write-to-queue
+// path; the BLE host itself is not started).
+//
+// wake_to_motion is in microseconds, not cycles: a plain CONTROL word from
+// ble_rx_write to control_cmd having started the wheels, each sample after
+// PERF_WAKE_IDLE_MS of idle. Under ROBOT_PM (env:esp32dev_pm) the CPU has
+// dropped to ROBOT_PM_MIN_MHZ by then, so this is the cost of waking up;
+// its p99 is checked against PERF_BUDGET_WAKE_P99_US.
+//
+// word_to_pulse_ns is a plain CONTROL word from ble_rx_write through the RX
+// pool and control_cmd to the motors, in nanoseconds so the 160 and 240 MHz
+// builds compare: warm back to back, cold after reading more flash than the
+// cache holds, as when the BLE stack or telemetry ran in between. The cold
+// p99 is what env:esp32dev_perf (hot_path.h) is for; it is checked against
+// PERF_BUDGET_COLD_P99_NS.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_app_desc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "pinout.h"
+#include "stepper_motor.h"
+#include "robot_commands.h"
+#include "Robot_BLE.h"
+#include "ble_host.h"                     // ble_rx_write
+#include "ble_rx_pool.h"
+#include "aes_gcm_encrypt.h"
+#include "aes_gcm_decrypt.h"
+#include "arm.h"
+#include "robot_pm.h"
+
+#ifndef PERF_ITERS
+#define PERF_ITERS  1000
+#endif
+
+#ifndef PERF_BUDGET_ENCRYPT
+#define PERF_BUDGET_ENCRYPT     0
+#endif
+#ifndef PERF_BUDGET_DECRYPT
+#define PERF_BUDGET_DECRYPT     0
+#endif
+#ifndef PERF_BUDGET_IK
+#define PERF_BUDGET_IK          0
+#endif
+#ifndef PERF_BUDGET_IK_FAST
+#define PERF_BUDGET_IK_FAST     0
+#endif
+#ifndef PERF_BUDGET_CONTROL
+#define PERF_BUDGET_CONTROL     0
+#endif
+#ifndef PERF_BUDGET_PULSE
+#define PERF_BUDGET_PULSE       0
+#endif
+#ifndef PERF_BUDGET_GATT_WORD
+#define PERF_BUDGET_GATT_WORD   0
+#endif
+#ifndef PERF_BUDGET_GATT_SEALED
+#define PERF_BUDGET_GATT_SEALED 0
+#endif
+#ifndef PERF_BUDGET_WAKE_P99_US
+#define PERF_BUDGET_WAKE_P99_US 0
+#endif
+#ifndef PERF_BUDGET_COLD_P99_NS
+#define PERF_BUDGET_COLD_P99_NS 0
+#endif
+
+#define PERF_WAKE_ITERS   200
+#define PERF_WAKE_IDLE_MS 30                // Long enough for esp_pm to drop the clock
+
+#define PERF_EVICT_BYTES  (64 * 1024)      // Twice the flash cache of one core
+#define PERF_CACHE_LINE   32
+
+#define PERF_IK_GRID 10                     // 10^3 targets, inside the reach
+
+static uint32_t samples[PERF_ITERS];
+
+static step_mot_t   front_left, front_right, back_left, back_right;
+static drivetrain_t drivetrain;
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Sorts samples[0..n), prints the PERF line, checks the budget
+static void perf_report(const char *test, int n, uint32_t budget) {
+    qsort(samples, n, sizeof(samples[0]), cmp_u32);
+    uint32_t p50 = samples[n / 2], p99 = samples[(n * 99) / 100];
+    const esp_app_desc_t *app = esp_app_get_description();
+
+    printf("PERF {\"test\":\"%s\",\"build\":\"%s\",\"idf\":\"%s\",\"iters\":%d,"
+           "\"min\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu}\n",
+           test, app->version, app->idf_ver, n, (unsigned long)samples[0], (unsigned long)p50,
+           (unsigned long)p99, (unsigned long)samples[n - 1]);
+    if (budget) TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(budget, p50, test);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ------------------------- AEAD -------------------------
+
+static void plaintext_fill(char pt[128]) {
+    memset(pt, 0, 128);
+    memcpy(pt, "{\"T\":\"C\",\"W\":1,\"S\":50}", 21);
+}
+
+static void test_aes_gcm_encrypt_packet(void) {
+    char pt[128];
+    uint8_t pkt[156];
+    plaintext_fill(pt);
+
+    for (int i = 0; i < PERF_ITERS; i++) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        int rc = aes_gcm_encrypt_packet(pt, pkt);
+        samples[i] = esp_cpu_get_cycle_count() - t0;
+        TEST_ASSERT_EQUAL_INT(0, rc);
+    }
+    perf_report("aes_gcm_encrypt_packet", PERF_ITERS, PERF_BUDGET_ENCRYPT);
+}
+
+static void test_aes_gcm_decrypt_packet(void) {
+    char pt[128], out[129];
+    uint8_t pkt[156];
+    size_t out_len = 0;
+    plaintext_fill(pt);
+    TEST_ASSERT_EQUAL_INT(0, aes_gcm_encrypt_packet(pt, pkt));
+
+    for (int i = 0; i < PERF_ITERS; i++) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        int rc = aes_gcm_decrypt_packet(pkt, out, &out_len);
+        samples[i] = esp_cpu_get_cycle_count() - t0;
+        TEST_ASSERT_EQUAL_INT(0, rc);
+    }
+    TEST_ASSERT_EQUAL_MEMORY(pt, out, sizeof(pt));
+
+    pkt[40] ^= 1;                           // A forged packet must still be refused
+    TEST_ASSERT_EQUAL_INT(-2, aes_gcm_decrypt_packet(pkt, out, &out_len));
+    perf_report("aes_gcm_decrypt_packet", PERF_ITERS, PERF_BUDGET_DECRYPT);
+}
+
+// ------------------------- Arm IK -------------------------
+
+// Grid point i of PERF_IK_GRID^3 inside the reach, ahead of the base
+static void ik_target(int i, float *x, float *y, float *z) {
+    const float span = (ARM_A2 + ARM_A3) * 0.6f;
+    const float step = span / (PERF_IK_GRID - 1);
+    *x = -span / 2 + (i % PERF_IK_GRID) * step;
+    *y = 2.0f + ((i / PERF_IK_GRID) % PERF_IK_GRID) * step / 2;
+    *z = ARM_D1 + (i / (PERF_IK_GRID * PERF_IK_GRID)) * step / 2;
+}
+
+static void run_ik(const char *test, int (*solve)(float, float, float, float[3]), uint32_t budget) {
+    const int n = PERF_IK_GRID * PERF_IK_GRID * PERF_IK_GRID < PERF_ITERS ?
+                  PERF_IK_GRID * PERF_IK_GRID * PERF_IK_GRID : PERF_ITERS;
+    int solved = 0;
+
+    for (int i = 0; i < n; i++) {
+        float x, y, z, ang[3];
+        ik_target(i, &x, &y, &z);
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        int rc = solve(x, y, z, ang);
+        samples[i] = esp_cpu_get_cycle_count() - t0;
+        solved += rc == 0;
+    }
+    TEST_ASSERT_GREATER_THAN_INT_MESSAGE(0, solved, "no reachable target in the grid");
+    perf_report(test, n, budget);
+}
+
+static void test_arm_ik_solve(void) {
+    run_ik("arm_ik_solve", arm_ik_solve, PERF_BUDGET_IK);
+}
+
+static void test_arm_ik_solve_fast(void) {
+    run_ik("arm_ik_solve_fast", arm_ik_solve_fast, PERF_BUDGET_IK_FAST);
+}
+
+// ------------------------- Drive -------------------------
+
+static void test_control_cmd(void) {
+    robot_bt_packet_t w = {0};
+    w.ctrl.type = CONTROL_CMD;
+    w.ctrl.w = 1;
+    w.ctrl.speed = 10;
+    motor_power = 1;
+
+    for (int i = 0; i < PERF_ITERS; i++) {
+        w.ctrl.id = i & 0x7FF;
+        w.ctrl.d = i & 1;                   // Alternate the mix, as a driver would
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        control_cmd(w.ctrl, &drivetrain);
+        samples[i] = esp_cpu_get_cycle_count() - t0;
+    }
+    drivetrain_estop(&drivetrain);
+    perf_report("control_cmd", PERF_ITERS, PERF_BUDGET_CONTROL);
+}
+
+static void test_motor_pulse(void) {
+    for (int i = 0; i < PERF_ITERS; i++) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        motor_pulse(&front_left, 10, i & 1);
+        samples[i] = esp_cpu_get_cycle_count() - t0;
+    }
+    drivetrain_estop(&drivetrain);
+    perf_report("motor_pulse", PERF_ITERS, PERF_BUDGET_PULSE);
+}
+
+// ------------------------- GATT write -> RX pool -------------------------
+
+// One write through ble_rx_write per sample; the slot is taken back off the
+// pool ring outside the timed part
+static void run_gatt(const char *test, bool secure, const uint8_t *frame, uint16_t len, uint32_t budget) {
+    device_conn_t *dev = &connected_devices[0];
+    memset(dev, 0, sizeof(*dev));
+    dev->sess.secure = secure;
+
+    for (int i = 0; i < PERF_ITERS; i++) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        ble_rx_write(dev, frame, len);
+        samples[i] = esp_cpu_get_cycle_count() - t0;
+
+        ble_rx_pkt_t *pkt = ble_rx_pool_receive(0);
+        TEST_ASSERT_NOT_NULL_MESSAGE(pkt, test);
+        ble_rx_pool_free(pkt);
+    }
+    memset(dev, 0, sizeof(*dev));
+    perf_report(test, PERF_ITERS, budget);
+}
+
+static void test_gatt_write_word(void) {
+    robot_bt_packet_t w = {0};
+    w.query.type = Query_CMD;               // Not an e-stop: nothing acts on it in the callback
+    run_gatt("ble_rx_write_word", false, w.bytes, 8, PERF_BUDGET_GATT_WORD);
+}
+
+static void test_gatt_write_sealed(void) {
+    uint8_t frame[CIPHER_FRAME_SIZE];
+    frame[0] = 0x0A;
+    frame[1] = CIPHER_MARK_WORD;
+    for (int i = 0; i < PACKET_SIZE; i++) frame[2 + i] = (uint8_t)i;
+    frame[2 + PACKET_SIZE] = 0xDA;
+    frame[3 + PACKET_SIZE] = 0x0D;
+    run_gatt("ble_rx_write_sealed", true, frame, sizeof(frame), PERF_BUDGET_GATT_SEALED);
+}
+
+// ------------------------- Wake to motion -------------------------
+
+static void test_wake_to_motion(void) {
+    device_conn_t *dev = &connected_devices[0];
+    robot_bt_packet_t w = {0};
+    w.ctrl.type = CONTROL_CMD;
+    w.ctrl.w = 1;
+    w.ctrl.speed = 10;
+    memset(dev, 0, sizeof(*dev));
+    motor_power = 1;
+
+    for (int i = 0; i < PERF_WAKE_ITERS; i++) {
+        vTaskDelay(pdMS_TO_TICKS(PERF_WAKE_IDLE_MS));
+        w.ctrl.id = i & 0x7FF;
+        int64_t t0 = esp_timer_get_time();
+        ble_rx_write(dev, w.bytes, 8);
+        ble_rx_pkt_t *pkt = ble_rx_pool_receive(0);
+        TEST_ASSERT_NOT_NULL(pkt);
+        control_cmd(pkt->cmd.ctrl, &drivetrain);
+        samples[i] = (uint32_t)(esp_timer_get_time() - t0);
+
+        ble_rx_pool_free(pkt);
+        drivetrain_estop(&drivetrain);      // Drivers off: every PM lock is released again
+    }
+    memset(dev, 0, sizeof(*dev));
+    perf_report("wake_to_motion_us", PERF_WAKE_ITERS, 0);
+    if (PERF_BUDGET_WAKE_P99_US) {          // samples[] is sorted now
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(PERF_BUDGET_WAKE_P99_US,
+            samples[(PERF_WAKE_ITERS * 99) / 100], "wake_to_motion p99");
+    }
+}
+
+// ------------------------- Cold flash cache -------------------------
+
+// .rodata, so it is read through the flash cache; non-zero so it is not bss
+static const uint8_t perf_evict[PERF_EVICT_BYTES] = { 1 };
+
+// One read per cache line over twice the cache: the path's code and tables
+// are fetched from flash again on the next sample
+static void cache_evict(void) {
+    const uint8_t *volatile p = perf_evict;  // Not folded from the initialiser
+    uint32_t sum = 0;
+    for (int i = 0; i < PERF_EVICT_BYTES; i += PERF_CACHE_LINE) sum += p[i];
+    __asm__ volatile("" :: "r"(sum));
+}
+
+static void run_word_to_pulse(const char *test, bool cold) {
+    device_conn_t *dev = &connected_devices[0];
+    robot_bt_packet_t w = {0};
+    w.ctrl.type = CONTROL_CMD;
+    w.ctrl.w = 1;
+    w.ctrl.speed = 10;
+    memset(dev, 0, sizeof(*dev));
+    motor_power = 1;
+
+    for (int i = 0; i < PERF_ITERS; i++) {
+        w.ctrl.id = i & 0x7FF;
+        w.ctrl.d = i & 1;
+        if (cold) cache_evict();
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        ble_rx_write(dev, w.bytes, 8);
+        ble_rx_pkt_t *pkt = ble_rx_pool_receive(0);
+        TEST_ASSERT_NOT_NULL_MESSAGE(pkt, test);
+        control_cmd(pkt->cmd.ctrl, &drivetrain);
+        uint32_t cycles = esp_cpu_get_cycle_count() - t0;
+        samples[i] = (uint32_t)((uint64_t)cycles * 1000u / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+        ble_rx_pool_free(pkt);
+    }
+    drivetrain_estop(&drivetrain);
+    memset(dev, 0, sizeof(*dev));
+    perf_report(test, PERF_ITERS, 0);
+}
+
+static void test_word_to_pulse_warm(void) {
+    run_word_to_pulse("word_to_pulse_ns", false);
+}
+
+static void test_word_to_pulse_cold(void) {
+    run_word_to_pulse("cold_word_to_pulse_ns", true);
+    if (PERF_BUDGET_COLD_P99_NS) {          // samples[] is sorted now
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(PERF_BUDGET_COLD_P99_NS,
+            samples[(PERF_ITERS * 99) / 100], "cold_word_to_pulse p99");
+    }
+}
+
+void app_main(void) {
+    vTaskDelay(pdMS_TO_TICKS(2000));        // Let the test runner open the port
+    robot_pm_init();                        // No-op without ROBOT_PM
+    esp_log_level_set("ARM", ESP_LOG_ERROR);    // The IK reference logs every rejection
+
+    motor_init(&front_left, FL_MOTOR_STEP, FL_MOTOR_DIR, FL_MOTOR_EN, FL_MOTOR_PWM, FL_MOTOR_TIMER);
+    motor_init(&back_left, BL_MOTOR_STEP, BL_MOTOR_DIR, BL_MOTOR_EN, BL_MOTOR_PWM, BL_MOTOR_TIMER);
+    motor_init(&front_right, FR_MOTOR_STEP, FR_MOTOR_DIR, FR_MOTOR_EN, FR_MOTOR_PWM, FR_MOTOR_TIMER);
+    motor_init(&back_right, BR_MOTOR_STEP, BR_MOTOR_DIR, BR_MOTOR_EN, BR_MOTOR_PWM, BR_MOTOR_TIMER);
+    drivetrain_init(&drivetrain, &front_left, &front_right, &back_left, &back_right);
+    arm_init();                             // Fast IK's reachability bitmap
+    ble_rx_pool_init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_aes_gcm_encrypt_packet);
+    RUN_TEST(test_aes_gcm_decrypt_packet);
+    RUN_TEST(test_arm_ik_solve);
+    RUN_TEST(test_arm_ik_solve_fast);
+    RUN_TEST(test_control_cmd);
+    RUN_TEST(test_motor_pulse);
+    RUN_TEST(test_gatt_write_word);
+    RUN_TEST(test_gatt_write_sealed);
+    RUN_TEST(test_word_to_pulse_warm);
+    RUN_TEST(test_word_to_pulse_cold);
+    RUN_TEST(test_wake_to_motion);
+    UNITY_END();
+}
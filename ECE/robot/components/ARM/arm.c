@@ -1,5 +1,10 @@
 #include "arm.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "trace.h"
+#include "task_alloc.h"
+#include "robot_pm.h"
+#include "freertos/task.h"
 #include <math.h>
 
 static const char* ARM_TAG = "ARM";
@@ -18,10 +23,10 @@ static void arm_pwm_timer_init(void) {
 }
 
 // Servo instances 
-//  { pin, link_length, pwm_offset_us, current_angle, target_angle, pwm, channel }
-static servo_t servo_base     = {SERVO_BASE_PIN,     ARM_D1,  550,  45, 45, 1000, SERVO_BASE_CHANNEL};
-static servo_t servo_shoulder = {SERVO_SHOULDER_PIN, ARM_A2,  500,  45, 45, 1000, SERVO_SHOULDER_CHANNEL};
-static servo_t servo_elbow    = {SERVO_ELBOW_PIN,    ARM_A3, 1120,  45, 45, 1120, SERVO_ELBOW_CHANNEL};
+//  { pin, link_length, pwm_offset_us, current_angle, target_angle, channel }
+static servo_t servo_base     = {SERVO_BASE_PIN,     ARM_D1,  550,  45, 45, SERVO_BASE_CHANNEL};
+static servo_t servo_shoulder = {SERVO_SHOULDER_PIN, ARM_A2,  500,  45, 45, SERVO_SHOULDER_CHANNEL};
+static servo_t servo_elbow    = {SERVO_ELBOW_PIN,    ARM_A3, 1120,  45, 45, SERVO_ELBOW_CHANNEL};
 
 // Current arm position 
 
@@ -29,12 +34,60 @@ static float arm_x = ARM_HOME_X;
 static float arm_y = ARM_HOME_Y;
 static float arm_z = ARM_HOME_Z;
 
+// Interpolator state. The command path only writes targets (under arm_mux)
+// and wakes the task; the task owns the servo outputs and the tick timer.
+static servo_t *const arm_servos[3] = { &servo_base, &servo_shoulder, &servo_elbow };
+static portMUX_TYPE       arm_mux = portMUX_INITIALIZER_UNLOCKED;
+static float              arm_vlim = ARM_JOINT_VMAX_DPS;
+static float              arm_scale[3] = { 1.0f, 1.0f, 1.0f };  // Per joint share of vlim and accel
+static esp_timer_handle_t arm_tick;
+static TaskHandle_t       arm_task = NULL;
+static volatile bool      arm_detached = false;    // arm_detach(): no PWM until arm_attach()
+static bool               arm_fading = false;      // ARM_FADE after arm_start(): moves are LEDC fades
+
+// Pulse = angle * 100/9 us + offset, at 16384 duty steps per 20 ms period.
+// duty_tab holds the angle part in 1/DUTY_FRAC steps, so a write is a
+// lookup and an add (servo_t.duty_off is the offset part)
+#define DUTY_PER_US  (16384.0f / 20000.0f)
+#define DUTY_FRAC    16
+#define DUTY_TAB_N   (1800 / ARM_DUTY_TAB_TENTHS + 1)
+static uint16_t duty_tab[DUTY_TAB_N];
+
 // Internal helpers 
 static float sin_d(float deg)          { return sinf(deg / 180.0f * (float)M_PI); }
 static float cos_d(float deg)          { return cosf(deg / 180.0f * (float)M_PI); }
 static float atan2_d(float yy, float xx) { return atan2f(yy, xx) / (float)M_PI * 180.0f; }
 static float acos_d(float v)           { return acosf(v)      / (float)M_PI * 180.0f; }
 
+// Polynomial stand-ins for the fast solver. atan: 9th-order minimax on
+// [0, 1], < 1e-5 rad. acos: Abramowitz & Stegun 4.4.45, < 7e-5 rad.
+static float fast_atan2_d(float yy, float xx) {
+    float ax = fabsf(xx), ay = fabsf(yy);
+    float mx = ax > ay ? ax : ay;
+    if (mx == 0.0f) return 0.0f;
+    float t  = (ax > ay ? ay : ax) / mx;
+    float t2 = t * t;
+    float a  = t * (0.9998660f + t2 * (-0.3302995f + t2 * (0.1801410f + t2 * (-0.0851330f + t2 * 0.0208351f))));
+    if (ay > ax) a = 1.5707963f - a;
+    if (xx < 0)  a = 3.1415927f - a;
+    if (yy < 0)  a = -a;
+    return a * (180.0f / (float)M_PI);
+}
+
+static float fast_acos_d(float v) {
+    float av = fabsf(v);
+    float a  = sqrtf(1.0f - av) * (1.5707288f + av * (-0.2121144f + av * (0.0742610f + av * -0.0187293f)));
+    if (v < 0) a = 3.1415927f - a;
+    return a * (180.0f / (float)M_PI);
+}
+
+// Bit per (r, z) cell: set if any corner or the centre of the cell solves,
+// so a clear bit is a safe reject and a set bit still gets the full check
+#define IK_CELL   (1.0f / ARM_IK_CELLS_PER_IN)
+#define IK_NR     ARM_IK_REACH_CELLS
+#define IK_NZ     (2 * ARM_IK_REACH_CELLS)
+static uint8_t ik_reach[(IK_NR * IK_NZ + 7) / 8];
+
 static void servo_init_channel(servo_t *s) {
     ledc_channel_config_t cfg = {
         .gpio_num   = s->servo_pin,
@@ -48,16 +101,186 @@ static void servo_init_channel(servo_t *s) {
     ledc_channel_config(&cfg);
 }
 
-// Writes an angle directly to hardware — called every time a valid move comes in.
+static void duty_tab_init(void) {
+    for (int i = 0; i < DUTY_TAB_N; i++)
+        duty_tab[i] = (uint16_t)lrintf(i * ARM_DUTY_TAB_DEG * (100.0f / 9.0f) * DUTY_PER_US * DUTY_FRAC);
+    for (int i = 0; i < 3; i++)
+        arm_servos[i]->duty_off = (uint32_t)lrintf(arm_servos[i]->pwm_offset_us * DUTY_PER_US * DUTY_FRAC);
+}
+
+static uint32_t servo_duty(const servo_t *s, float angle) {
+    int i = (int)(angle * (1.0f / ARM_DUTY_TAB_DEG) + 0.5f);
+    if (i < 0) i = 0;
+    if (i >= DUTY_TAB_N) i = DUTY_TAB_N - 1;
+    return (duty_tab[i] + s->duty_off) / DUTY_FRAC;
+}
+
+// The way back, for a fade stopped part way
+static float servo_angle_of(const servo_t *s, uint32_t duty) {
+    return ((float)duty - (float)s->duty_off / DUTY_FRAC) / (DUTY_PER_US * (100.0f / 9.0f));
+}
+
+// Where the joint is now; a running fade counts as moving linearly
+static float servo_angle_now(const servo_t *s) {
+    if (!s->fade_ms) return s->current_angle;
+    int64_t t = esp_timer_get_time() - s->fade_t0_us;
+    if (t >= (int64_t)s->fade_ms * 1000) return s->fade_to;
+    return s->current_angle + (s->fade_to - s->current_angle) * (float)t / ((float)s->fade_ms * 1000.0f);
+}
+
+// Writes an angle to hardware; skips the LEDC update when the duty is unchanged
 static void servo_write(servo_t *s, float angle) {
     s->current_angle = angle;
-    s->target_angle  = angle;   // keep in sync — no interpolation in this version
-    s->pwm           = angle * (100.0f / 9.0f) + (float)s->pwm_offset_us;
-    uint32_t duty    = (uint32_t)(s->pwm * 16384.0f / 20000.0f);
+    uint32_t duty    = servo_duty(s, angle);
+    if (duty == s->duty || arm_detached) return;
+    s->duty = duty;
     ledc_set_duty(LEDC_LOW_SPEED_MODE, s->channel, duty);
     ledc_update_duty(LEDC_LOW_SPEED_MODE, s->channel);
 }
 
+// One interpolator tick for one joint; true once it is on target
+static bool servo_step(servo_t *s, float target, float vlim, float accel, float dt) {
+    const float dv = accel * dt;
+    float err = target - s->current_angle;
+    if (fabsf(err) <= ARM_SETTLE_DEG && fabsf(s->velocity) <= dv) {
+        s->velocity = 0;
+        if (err != 0) servo_write(s, target);
+        return true;
+    }
+
+    // Fastest speed that can still stop at the target, capped by vlim,
+    // and reached from the current speed within one tick of acceleration
+    float v = sqrtf(2.0f * accel * fabsf(err));
+    if (v > vlim) v = vlim;
+    if (err < 0) v = -v;
+    if (v > s->velocity + dv) v = s->velocity + dv;
+    if (v < s->velocity - dv) v = s->velocity - dv;
+    s->velocity = v;
+
+    float next = s->current_angle + v * dt;
+    if ((target - next) * err < 0) {            // Would overshoot: land on it
+        next = target;
+        s->velocity = 0;
+    }
+    servo_write(s, next);
+    return false;
+}
+
+// Stops a running fade where the hardware has got to
+static void servo_fade_stop(servo_t *s) {
+    if (!s->fade_ms) return;
+    if (esp_timer_get_time() - s->fade_t0_us < (int64_t)s->fade_ms * 1000) {
+        ledc_fade_stop(LEDC_LOW_SPEED_MODE, s->channel);
+        s->duty = ledc_get_duty(LEDC_LOW_SPEED_MODE, s->channel);
+        s->current_angle = servo_angle_of(s, s->duty);
+    } else {
+        s->current_angle = s->fade_to;
+    }
+    s->fade_ms = 0;
+}
+
+// ARM_FADE: one hardware fade to target, as long as the interpolator's
+// trapezoid would take at these limits
+static void servo_fade(servo_t *s, float target, float vlim, float accel) {
+    servo_fade_stop(s);
+    uint32_t duty = servo_duty(s, target);
+    if (duty == s->duty || arm_detached) {
+        s->current_angle = target;
+        return;
+    }
+    float d = fabsf(target - s->current_angle);
+    float t = d < vlim * vlim / accel ? 2.0f * sqrtf(d / accel) : d / vlim + vlim / accel;
+    uint32_t ms = (uint32_t)(t * 1000.0f);
+    if (ms < ARM_FADE_MIN_MS) ms = ARM_FADE_MIN_MS;
+
+    s->duty = duty;
+    s->fade_to = target;
+    s->fade_t0_us = esp_timer_get_time();
+    s->fade_ms = ms;
+    ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, s->channel, duty, ms);
+    ledc_fade_start(LEDC_LOW_SPEED_MODE, s->channel, LEDC_FADE_NO_WAIT);
+}
+
+static void arm_tick_cb(void *arg) {
+    if (arm_task) xTaskNotifyGive(arm_task);
+}
+
+static void arm_control_task(void *pvParameters) {
+    const float dt = 1.0f / ARM_CTRL_HZ;
+    bool ticking = false;
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);    // Tick, or new targets while idle
+
+        float target[3], scale[3], vlim;
+        taskENTER_CRITICAL(&arm_mux);
+        for (int i = 0; i < 3; i++) {
+            target[i] = arm_servos[i]->target_angle;
+            scale[i] = arm_scale[i];
+        }
+        vlim = arm_vlim;
+        taskEXIT_CRITICAL(&arm_mux);
+
+        bool settled = true;
+        for (int i = 0; i < 3; i++)
+            settled &= servo_step(arm_servos[i], target[i], vlim * scale[i], ARM_JOINT_ACCEL_DPS2 * scale[i], dt);
+
+        // Only this task starts and stops the tick, so a target that lands
+        // after the stop just wakes it again
+        if (settled && ticking) {
+            esp_timer_stop(arm_tick);
+            ticking = false;
+        } else if (!settled && !ticking) {
+            ticking = esp_timer_start_periodic(arm_tick, 1000000 / ARM_CTRL_HZ) == ESP_OK;
+        }
+    }
+}
+
+// Targets are pinned to where each joint is, so the interpolator settles
+// instead of resuming the old move when the PWM comes back
+void arm_detach(void) {
+    arm_detached = true;
+    for (int i = 0; i < 3; i++) servo_fade_stop(arm_servos[i]);
+    taskENTER_CRITICAL(&arm_mux);
+    for (int i = 0; i < 3; i++) arm_servos[i]->target_angle = arm_servos[i]->current_angle;
+    taskEXIT_CRITICAL(&arm_mux);
+    for (int i = 0; i < 3; i++) ledc_stop(LEDC_LOW_SPEED_MODE, arm_servos[i]->channel, 0);
+    robot_pm_set(PM_HOLD_ARM, false);
+}
+
+void arm_attach(void) {
+    if (!arm_detached) return;
+    arm_detached = false;
+    robot_pm_set(PM_HOLD_ARM, true);        // The servos need their PWM to hold position
+    for (int i = 0; i < 3; i++) {
+        servo_t *s = arm_servos[i];
+        s->duty = UINT32_MAX;               // Force the write: ledc_update_duty() restarts the output
+        servo_write(s, s->current_angle);
+    }
+}
+
+// scale NULL = every joint at the full limits (jogs, reset)
+static void arm_set_targets(const float angles[3], const float scale[3]) {
+    taskENTER_CRITICAL(&arm_mux);
+    for (int i = 0; i < 3; i++) {
+        arm_servos[i]->target_angle = angles[i];
+        arm_scale[i] = scale ? scale[i] : 1.0f;
+    }
+    taskEXIT_CRITICAL(&arm_mux);
+
+    if (arm_fading) {
+        for (int i = 0; i < 3; i++) {
+            float k = scale ? scale[i] : 1.0f;
+            servo_fade(arm_servos[i], angles[i], arm_vlim * k, ARM_JOINT_ACCEL_DPS2 * k);
+        }
+        return;
+    }
+    if (arm_task) {
+        xTaskNotifyGive(arm_task);
+        return;
+    }
+    for (int i = 0; i < 3; i++) servo_write(arm_servos[i], angles[i]);   // No interpolator yet
+}
+
 
 int arm_ik_solve(float x, float y, float z, float servo_angles[3]) {
     float theta[3];
@@ -112,10 +335,88 @@ int arm_ik_solve(float x, float y, float z, float servo_angles[3]) {
     return 0;
 }
 
-int arm_move_to(float x, float y, float z) {
-    float angles[3];
+// Shoulder and elbow for a planar target; 0 or 1 like arm_ik_solve()
+static int ik_planar_fast(float xr, float zr, float *t1, float *t2) {
+    float r2   = xr * xr + zr * zr;
+    float r    = sqrtf(r2);
+    float cos1 = (r2 + ARM_A2 * ARM_A2 - ARM_A3 * ARM_A3) / (2.0f * r * ARM_A2);
+    float cos2 = (ARM_A3 * ARM_A3 + ARM_A2 * ARM_A2 - r2) / (2.0f * ARM_A2 * ARM_A3);
+    if (!(cos1 >= -1.0f && cos1 <= 1.0f) || !(cos2 >= -1.0f && cos2 <= 1.0f)) return 1;  // NaN at r = 0 too
+
+    *t1 = fast_atan2_d(zr, xr) + fast_acos_d(cos1);
+    *t2 = 170.0f - fast_acos_d(cos2);
+    if (*t1 < ARM_THETA1_MIN || *t1 > ARM_THETA1_MAX) return 1;
+    if (*t2 < ARM_THETA2_MIN || *t2 > ARM_THETA2_MAX) return 1;
+    return 0;
+}
+
+static void ik_reach_init(void) {
+    static const float probe[5][2] = { {0, 0}, {1, 0}, {0, 1}, {1, 1}, {0.5f, 0.5f} };
+    for (int iz = 0; iz < IK_NZ; iz++) {
+        for (int ir = 0; ir < IK_NR; ir++) {
+            for (int p = 0; p < 5; p++) {
+                float t1, t2;
+                float xr = (ir + probe[p][0]) * IK_CELL;
+                float zr = (iz + probe[p][1]) * IK_CELL - IK_NR * IK_CELL;
+                if (ik_planar_fast(xr, zr, &t1, &t2) == 0) {
+                    int bit = iz * IK_NR + ir;
+                    ik_reach[bit >> 3] |= (uint8_t)(1u << (bit & 7));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+static bool ik_reach_test(float xr, float zr) {
+    int ir = (int)(xr * ARM_IK_CELLS_PER_IN);
+    int iz = (int)floorf(zr * ARM_IK_CELLS_PER_IN) + IK_NR;
+    if (ir < 0 || ir >= IK_NR || iz < 0 || iz >= IK_NZ) return false;
+    int bit = iz * IK_NR + ir;
+    return ik_reach[bit >> 3] & (1u << (bit & 7));
+}
+
+bool arm_ik_reachable(float x, float y, float z) {
+    return ik_reach_test(sqrtf(x * x + y * y), z - ARM_D1);
+}
+
+int arm_ik_solve_fast(float x, float y, float z, float servo_angles[3]) {
+    // Base yaw first: it is one atan2 and rejects anything behind the arm
+    float t0 = fast_atan2_d(y, x);
+    if (t0 < ARM_THETA0_MIN || t0 > ARM_THETA0_MAX) return 1;
+
+    // cos(t0) * x + sin(t0) * y in the reference is just the XY distance
+    float xr = sqrtf(x * x + y * y);
+    float zr = z - ARM_D1;
+    if (!ik_reach_test(xr, zr)) return 1;
 
-    if (arm_ik_solve(x, y, z, angles) != 0) {
+    float t1, t2;
+    if (ik_planar_fast(xr, zr, &t1, &t2) != 0) return 1;
+    servo_angles[0] = t0;
+    servo_angles[1] = t1;
+    servo_angles[2] = t2;
+    return 0;
+}
+
+// Coordinated: each joint's speed and acceleration limits are scaled by its
+// travel over the longest one, so the three trapezoids have the same shape
+// and every joint arrives when the slowest does (exactly so from rest)
+static void arm_sync_scale(const float angles[3], float scale[3]) {
+    float d[3], dmax = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        d[i] = fabsf(angles[i] - servo_angle_now(arm_servos[i]));
+        if (d[i] > dmax) dmax = d[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        scale[i] = dmax > ARM_SETTLE_DEG ? d[i] / dmax : 1.0f;
+        if (scale[i] < ARM_SYNC_SCALE_MIN) scale[i] = ARM_SYNC_SCALE_MIN;
+    }
+}
+
+static int arm_move(float x, float y, float z, bool sync) {
+    float angles[3], scale[3];
+
+    if (arm_ik_solve_fast(x, y, z, angles) != 0) {
         ESP_LOGW(ARM_TAG, "Move rejected — IK failed for (%.2f, %.2f, %.2f)", x, y, z);
         return 1;
     }
@@ -124,25 +425,30 @@ int arm_move_to(float x, float y, float z) {
     arm_y = y;
     arm_z = z;
 
-    servo_write(&servo_base,     angles[0]);
-    servo_write(&servo_shoulder, angles[1]);
-    servo_write(&servo_elbow,    angles[2]);
+    if (sync) arm_sync_scale(angles, scale);
+    arm_set_targets(angles, sync ? scale : NULL);
 
-    ESP_LOGI(ARM_TAG, "Moved to (%.2f, %.2f, %.2f) | θ: %.1f° %.1f° %.1f°",
-             arm_x, arm_y, arm_z, angles[0], angles[1], angles[2]);
+    TRACE(ARM, ARM_MOVE, lrintf(z * 100), lrintf(x * 100), lrintf(y * 100));
+    TRACE(ARM, ARM_IK, lrintf(angles[0] * 10), lrintf(angles[1] * 10), lrintf(angles[2] * 10));
     return 0;
 }
 
+int arm_move_to(float x, float y, float z) {
+    return arm_move(x, y, z, false);
+}
+
+int arm_move_sync(float x, float y, float z) {
+    return arm_move(x, y, z, true);
+}
+
 void arm_reset(void) {
     arm_x = ARM_HOME_X;
     arm_y = ARM_HOME_Y;
     arm_z = ARM_HOME_Z;
 
     float angles[3];
-    if (arm_ik_solve(arm_x, arm_y, arm_z, angles) == 0) {
-        servo_write(&servo_base,     angles[0]);
-        servo_write(&servo_shoulder, angles[1]);
-        servo_write(&servo_elbow,    angles[2]);
+    if (arm_ik_solve_fast(arm_x, arm_y, arm_z, angles) == 0) {
+        arm_set_targets(angles, NULL);
     }
     ESP_LOGI(ARM_TAG, "Arm reset to home (%.2f, %.2f, %.2f)", arm_x, arm_y, arm_z);
 }
@@ -155,11 +461,45 @@ void arm_get_position(float *x, float *y, float *z) {
 
 void arm_init(void) {
     arm_pwm_timer_init();
+    ik_reach_init();
+    duty_tab_init();
+    if (ARM_FADE) ledc_fade_func_install(0);
 
     servo_init_channel(&servo_base);
     servo_init_channel(&servo_shoulder);
     servo_init_channel(&servo_elbow);
 
     arm_reset();
+    robot_pm_set(PM_HOLD_ARM, !arm_detached);
     ESP_LOGI(ARM_TAG, "Arm initialized at home (%.2f, %.2f, %.2f)", arm_x, arm_y, arm_z);
+}
+
+void arm_set_speed(float frac) {
+    if (frac < 0.0f) frac = 0.0f;
+    if (frac > 1.0f) frac = 1.0f;
+    taskENTER_CRITICAL(&arm_mux);
+    arm_vlim = ARM_JOINT_VMIN_DPS + frac * (ARM_JOINT_VMAX_DPS - ARM_JOINT_VMIN_DPS);
+    taskEXIT_CRITICAL(&arm_mux);
+}
+
+bool arm_start(BaseType_t core, UBaseType_t prio) {
+    if (arm_task || arm_fading) return true;
+    if (ARM_FADE) {
+        arm_fading = true;
+        ESP_LOGI(ARM_TAG, "Arm moves as LEDC fades");
+        return true;
+    }
+
+    esp_timer_create_args_t args = {
+        .callback = arm_tick_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "arm_tick"
+    };
+    if (esp_timer_create(&args, &arm_tick) != ESP_OK) return false;
+    if (TASK_CREATE_PINNED(arm_control_task, "arm_ctrl", STACK_ARM, NULL, prio, &arm_task, core) != pdPASS) {
+        ESP_LOGE(ARM_TAG, "Failed to start arm interpolator");
+        arm_task = NULL;
+        return false;
+    }
+    return true;
 }
\ No newline at end of file
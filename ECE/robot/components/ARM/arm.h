@@ -3,6 +3,7 @@
 
 #include "driver/ledc.h"
 #include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
 #include "pinout.h"
 #include <math.h>
 
@@ -35,24 +36,86 @@ A typical servo does 60° in ~150ms, so 10° takes ~25ms
 Your commands arrive every 50ms
 */
 
+// Interpolator: once arm_start() runs, a task at ARM_CTRL_HZ walks each
+// joint's current_angle toward target_angle, limited to ARM_JOINT_ACCEL_DPS2
+// and to a speed set per command. arm_set_speed() maps the command speed
+// onto VMIN..VMAX in the same ratio as ARM_SPEED_MIN_STEP..MAX_STEP, so a
+// slow command both steps and moves slowly. The task sleeps while every
+// joint is on target.
+#define ARM_CTRL_HZ           200
+#define ARM_JOINT_VMAX_DPS    400.0f    // ~60 deg in 150 ms, a typical hobby servo
+#define ARM_JOINT_VMIN_DPS    (ARM_JOINT_VMAX_DPS * ARM_SPEED_MIN_STEP / ARM_SPEED_MAX_STEP)
+#define ARM_JOINT_ACCEL_DPS2  4000.0f   // Full speed in 100 ms
+#define ARM_SETTLE_DEG        0.05f     // Closer than this counts as on target
+#define ARM_SYNC_SCALE_MIN    0.05f     // arm_move_sync: floor on a joint's share of the limits
+
+// ARM_FADE=1: no interpolator task. arm_start() hands each move to the LEDC
+// fade engine instead, one hardware fade per joint from where it is to its
+// target, timed as the interpolator's trapezoid at the same limits would
+// take (the fade itself ramps linearly). Between commands the CPU does
+// nothing; a new target stops a running fade where it is and starts the
+// next one from there.
+#ifndef ARM_FADE
+#define ARM_FADE              0
+#endif
+#define ARM_FADE_MIN_MS       20        // One PWM period: the fade engine steps once per period
+
+// Angle -> duty goes through a table, ARM_DUTY_TAB_TENTHS tenths of a degree
+// apart over 0..180 (an integer, so the table size is a constant expression)
+#define ARM_DUTY_TAB_TENTHS   1
+#define ARM_DUTY_TAB_DEG      (ARM_DUTY_TAB_TENTHS / 10.0f)
+
+// Fast IK (arm_ik_solve_fast, used by arm_move_to): polynomial atan2/acos
+// instead of libm, and a reachability bitmap over the planar (r, z)
+// workspace so most out-of-reach targets are rejected before any math.
+// Cells are 1/ARM_IK_CELLS_PER_IN on a side; r covers 0..ARM_A2 + ARM_A3
+// and z (above the shoulder) covers +-ARM_A2 + ARM_A3.
+#define ARM_IK_CELLS_PER_IN   4
+#define ARM_IK_REACH_CELLS    60        // ceil((ARM_A2 + ARM_A3) * ARM_IK_CELLS_PER_IN)
+
 // Servo descriptor
 
 typedef struct {
     int            servo_pin;
     float          link_length;
     int            pwm_offset_us;
-    float          current_angle;   // angle currently written to hardware
-    float          target_angle;    // mirrors current_angle — reserved for future interpolation
-    float          pwm;
+    float          current_angle;   // angle currently written to hardware (ARM_FADE: where the fade began)
+    float          target_angle;    // where the interpolator is heading (IK output)
     ledc_channel_t channel;
+    float          velocity;        // deg/s, interpolator state
+    uint32_t       duty;            // last LEDC duty written (ARM_FADE: the fade's end)
+    uint32_t       duty_off;        // pwm_offset_us in 1/16 duty steps, from arm_init()
+    float          fade_to;         // ARM_FADE: the running fade's end angle
+    int64_t        fade_t0_us;      //           and its start
+    uint32_t       fade_ms;         //           0 = not fading
 } servo_t;
 
 
 
 void arm_init(void);
+bool arm_start(BaseType_t core, UBaseType_t prio);  // Interpolator task (or fades); until then moves jump
+void arm_set_speed(float frac);                     // 0..1 of the command speed range
 int arm_move_to(float x, float y, float z);
+int arm_move_sync(float x, float y, float z);       // Same, every joint arriving together
 void arm_reset(void);
 void arm_get_position(float *x, float *y, float *z);
-int arm_ik_solve(float x, float y, float z, float servo_angles[3]);
+void arm_detach(void);                              // PWM off, servos limp (any task, BLE callback too)
+void arm_attach(void);                              // PWM back on at the last written angles
+int arm_ik_solve(float x, float y, float z, float servo_angles[3]);       // libm reference
+int arm_ik_solve_fast(float x, float y, float z, float servo_angles[3]);  // Same contract, ~0.01 deg
+bool arm_ik_reachable(float x, float y, float z);                         // Bitmap only: false = surely not
+
+#ifdef ESP_PLATFORM
+/**
+ * On-target comparison of arm_ik_solve() and arm_ik_solve_fast() over a
+ * grid of `points` targets per axis: CPU cycles per solve, worst angle
+ * difference and any accept/reject disagreement. Run from a task pinned
+ * to one core; the cycle counter is per-core.
+ *
+ * @return 0 if solved angles agree within 0.05 deg (and disagreements, which
+ *         only occur on joint-limit edges, stay under 0.1%), -1 otherwise
+ */
+int arm_ik_bench(int points);
+#endif
 
 #endif
@@ -0,0 +1,67 @@
+// arm_ik_bench.c
+//
+// On-target comparison of the libm IK reference and the fast solver:
+// cycles per solve and worst-case angle difference over a grid spanning
+// the whole reach.  Call arm_ik_bench() after arm_init() (the fast path
+// needs its reachability bitmap).
+
+#ifdef ESP_PLATFORM
+
+#include "arm.h"
+
+#include <stdio.h>
+#include "esp_cpu.h"
+#include "esp_log.h"
+
+#define BENCH_SPAN  (ARM_A2 + ARM_A3 + 1.0f)  // Grid runs a little past full reach
+#define BENCH_TOL   0.05f                     // deg
+
+int arm_ik_bench(int points)
+{
+    if (points <= 1) points = 24;
+
+    // The reference logs every rejection; keep the console readable
+    esp_log_level_set("ARM", ESP_LOG_ERROR);
+
+    uint32_t cyc_ref = 0, cyc_fast = 0;
+    int solved = 0, rejected = 0, disagree = 0;
+    float worst = 0.0f;
+    const float step = 2.0f * BENCH_SPAN / (float)(points - 1);
+
+    for (int i = 0; i < points; i++) {
+        for (int j = 0; j < points; j++) {
+            for (int k = 0; k < points; k++) {
+                float x = -BENCH_SPAN + i * step;
+                float y = -BENCH_SPAN + j * step;
+                float z = -BENCH_SPAN + ARM_D1 + k * step;
+                float a_ref[3], a_fast[3];
+
+                uint32_t t0 = esp_cpu_get_cycle_count();
+                int r_ref = arm_ik_solve(x, y, z, a_ref);
+                uint32_t t1 = esp_cpu_get_cycle_count();
+                int r_fast = arm_ik_solve_fast(x, y, z, a_fast);
+                uint32_t t2 = esp_cpu_get_cycle_count();
+                cyc_ref  += t1 - t0;
+                cyc_fast += t2 - t1;
+
+                if (r_ref != r_fast) { disagree++; continue; }
+                if (r_ref)           { rejected++; continue; }
+                solved++;
+                for (int n = 0; n < 3; n++) {
+                    float e = fabsf(a_ref[n] - a_fast[n]);
+                    if (e > worst) worst = e;
+                }
+            }
+        }
+    }
+    esp_log_level_set("ARM", ESP_LOG_INFO);
+
+    int total = points * points * points;
+    printf("=== Arm IK, %d targets (%d solved, %d rejected) ===\n", total, solved, rejected);
+    printf("  libm     %7lu cycles/solve\n", (unsigned long)(cyc_ref / total));
+    printf("  fast     %7lu cycles/solve\n", (unsigned long)(cyc_fast / total));
+    printf("  max diff %.4f deg, %d accept/reject disagreements (joint-limit edges)\n", worst, disagree);
+    return (worst <= BENCH_TOL && disagree * 1000 <= total) ? 0 : -1;
+}
+
+#endif /* ESP_PLATFORM */
@@ -1,112 +1,44 @@
 #include "Robot_BLE.h"
+#include "ble_host.h"
+#include "ble_metrics.h"
+#include "trace.h"
+#include "hot_path.h"
+#include "aes_gcm_decrypt.h"
+#include "esp_timer.h"
+
+// Host-neutral half of the robot link: connection slots, inbound framing,
+// the TX queues, sealing and the last-GS address. The stack itself (GATT
+// table, GAP events, advertising) is in ble_host_bluedroid.c or
+// ble_host_nimble.c, whichever host sdkconfig enables.
 
 typedef enum {
     WAITING          = 0x00,
     START            = 0x01,
     COLLECTING       = 0x02,
     FINISH           = 0x03,
+    BATCH            = 0x04,   // Plain: BATCH_MAGIC seen, count byte next
 } data_retrieval_t;
 
 device_conn_t connected_devices[MAX_DEVICES];
 int num_connected = 0;
 volatile bool ble_congested = false;  // tracks BLE TX congestion state
 
-uint16_t robot_handle_table[ROBOT_IDX_NB];
-
-static const uint16_t GATTS_SERVICE_UUID           = 0x00FF;
-static const uint16_t GATTS_ROBOT_TX_UUID          = 0xFF01;  // central writes here
-static const uint16_t GATTS_ROBOT_RX_UUID          = 0xFF02;  // peripheral notifies here
-static const uint16_t primary_service_uuid         = ESP_GATT_UUID_PRI_SERVICE;
-static const uint16_t character_declaration_uuid   = ESP_GATT_UUID_CHAR_DECLARE;
-static const uint16_t character_client_config_uuid = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+uint32_t spp_handle = 0;
 
-static const uint8_t char_prop_write    = ESP_GATT_CHAR_PROP_BIT_WRITE |
-                                          ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
-static const uint8_t char_prop_notify   = ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static uint8_t gs_bda[BLE_ADDR_LEN];
+static uint8_t gs_addr_type;
+static bool    gs_known = false;
 
-static const uint8_t robot_measurement_ccc[2] = {0x00, 0x00};
+static uint8_t conn_lut[BLE_CONN_LUT];      // conn_id bucket -> slot + 1, 0 = empty
+static volatile int ctrl_owner = -1;        // Slot that owns the control lane
+static bool sess_secure_default;            // Last SECURITY_LEVEL: a GS that reconnects keeps it
 
-uint32_t spp_handle = 0;
-QueueHandle_t ble_recieve_queue = NULL;
-
-static uint8_t service_uuid[16] = {
-    0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00,
-};
-
-esp_ble_adv_data_t adv_data = {
-    .set_scan_rsp        = false,
-    .include_name        = true,
-    .include_txpower     = true,
-    .service_uuid_len    = sizeof(service_uuid),
-    .p_service_uuid      = service_uuid,
-    .flag                = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT),
-};
-
-esp_ble_adv_params_t adv_params = {
-    .adv_int_min         = 0x20,
-    .adv_int_max         = 0x40,
-    .adv_type            = ADV_TYPE_IND,
-    .own_addr_type       = BLE_ADDR_TYPE_PUBLIC,
-    .channel_map         = ADV_CHNL_ALL,
-    .adv_filter_policy   = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
-};
-
-struct gatts_profile_inst {
-    esp_gatts_cb_t gatts_cb;
-    uint16_t gatts_if;
-    uint16_t app_id;
-    uint16_t conn_id;
-    uint16_t service_handle;
-    esp_gatt_srvc_id_t service_id;
-    uint16_t char_handle;
-    esp_bt_uuid_t char_uuid;
-    esp_gatt_perm_t perm;
-    esp_gatt_char_prop_t property;
-    uint16_t descr_handle;
-    esp_bt_uuid_t descr_uuid;
-};
-
-static struct gatts_profile_inst robot_profile_tab[ROBOT_PROFILE_NUM] = {
-    [ROBOT_PROFILE_APP_IDX] = {
-        .gatts_cb = gatts_event_handler,
-        .gatts_if = ESP_GATT_IF_NONE,
-    },
-};
-
-static const esp_gatts_attr_db_t gatt_db[ROBOT_IDX_NB] =
-{
-    // Service Declaration
-    [ROBOT_IDX_SVC] =
-    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&primary_service_uuid, ESP_GATT_PERM_READ,
-      sizeof(uint16_t), sizeof(GATTS_SERVICE_UUID), (uint8_t *)&GATTS_SERVICE_UUID}},
-
-    // TX Characteristic Declaration — central writes commands to robot
-    [ROBOT_IDX_CHAR] =
-    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid, ESP_GATT_PERM_READ,
-      CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE, (uint8_t *)&char_prop_write}},
-
-    // TX Characteristic Value (0xFF01) — WRITE only
-    [ROBOT_IDX_VAL] =
-    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&GATTS_ROBOT_TX_UUID, ESP_GATT_PERM_WRITE,
-      GATTS_DEMO_CHAR_VAL_LEN_MAX, 0, NULL}},
-
-    // RX Characteristic Declaration — robot notifies central with responses
-    [ROBOT_IDX_RX_CHAR] =
-    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid, ESP_GATT_PERM_READ,
-      CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE, (uint8_t *)&char_prop_notify}},
-
-    // RX Characteristic Value (0xFF02) — NOTIFY only
-    [ROBOT_IDX_RX_VAL] =
-    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&GATTS_ROBOT_RX_UUID, ESP_GATT_PERM_READ,
-      GATTS_DEMO_CHAR_VAL_LEN_MAX, 0, NULL}},
-
-    // CCCD — subscribe to notifications on the RX characteristic
-    [ROBOT_IDX_CFG] =
-    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
-      sizeof(uint16_t), sizeof(robot_measurement_ccc), (uint8_t *)robot_measurement_ccc}},
-};
-
-static device_conn_t *find_device_by_conn_id(uint16_t conn_id) {
+// Every write looks its link up: one bucket, checked. Host ids are small
+// and handed out in order, so two live links share a bucket only by
+// chance; then (and for CONN_ID_INVALID, a free slot) the slots are scanned.
+device_conn_t *ble_conn_find(uint16_t conn_id) {
+    uint8_t s = conn_lut[conn_id & (BLE_CONN_LUT - 1)];
+    if (s && connected_devices[s - 1].conn_id == conn_id) return &connected_devices[s - 1];
     for (int i = 0; i < MAX_DEVICES; i++) {
         if (connected_devices[i].conn_id == conn_id) {
             return &connected_devices[i];
@@ -115,314 +47,610 @@ static device_conn_t *find_device_by_conn_id(uint16_t conn_id) {
     return NULL;
 }
 
-void robot_ble_init(){
-    esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_bt_controller_init(&bt_cfg));
-    ESP_ERROR_CHECK(esp_bt_controller_enable(ESP_BT_MODE_BLE));
+device_conn_t *ble_conn_find_bda(const uint8_t *bda) {
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        if (connected_devices[i].conn_id != CONN_ID_INVALID &&
+            memcmp(connected_devices[i].bda, bda, BLE_ADDR_LEN) == 0) {
+            return &connected_devices[i];
+        }
+    }
+    return NULL;
+}
 
-    ESP_LOGI(BLE_TAG, "%s init bluetooth", __func__);
+static bool any_congested(void) {
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        if (connected_devices[i].conn_id != CONN_ID_INVALID && connected_devices[i].congested) return true;
+    }
+    return false;
+}
 
-    ESP_ERROR_CHECK(esp_bluedroid_init());
-    ESP_ERROR_CHECK(esp_bluedroid_enable());
+static void conn_reset(device_conn_t *dev) {
+    dev->conn_id = CONN_ID_INVALID;
+    dev->notify_enabled = false;
+    dev->metrics_notify = false;
+    dev->prio_notify = false;
+    dev->rx_pkt = NULL;
+    dev->rx_idx = 0;
+    dev->data_mode = WAITING;
+    dev->rx_batch_left = 0;
+    dev->rx_echo_left = 0;
+    dev->congested = false;
+    dev->coc = NULL;
+}
 
-    ble_recieve_queue = xQueueCreate(10, PACKET_SIZE);
+device_conn_t *ble_conn_open(uint16_t conn_id, const uint8_t *bda, uint16_t conn_int) {
+    device_conn_t *dev = ble_conn_find(CONN_ID_INVALID);
+    if (!dev) {
+        ESP_LOGW(BLE_TAG, "No free connection slots, rejecting device");
+        return NULL;
+    }
+    conn_reset(dev);
+    dev->conn_id = conn_id;
+    uint8_t *bucket = &conn_lut[conn_id & (BLE_CONN_LUT - 1)];
+    if (!*bucket) *bucket = (uint8_t)(dev - connected_devices + 1);
+    dev->sess.secure = sess_secure_default;
+    dev->sess.topics = TOPIC_ALL;
+    dev->sess.tlm_gap_ms = 0;
+    dev->sess.echo = false;
+    replay_reset(&dev->sess.replay);            // New central, new sequence
+    memcpy(dev->bda, bda, BLE_ADDR_LEN);
+    dev->mtu = BLE_ATT_MTU_DEFAULT;
+    dev->conn_int = conn_int;
+    dev->phy = 1;
+    txq_clear(&dev->txq);
+    txq_clear(&dev->prio_txq);
+    num_connected++;
+    return dev;
+}
 
-    if (ble_recieve_queue == NULL) {
-        ESP_LOGE(BLE_TAG, "Queue creation failed!");
-        return;
+void ble_conn_close(device_conn_t *dev) {
+    if (dev) {
+        int slot = (int)(dev - connected_devices);
+        uint8_t *bucket = &conn_lut[dev->conn_id & (BLE_CONN_LUT - 1)];
+        if (*bucket == slot + 1) *bucket = 0;
+        ble_control_release(slot);
+        ble_rx_pool_free(dev->rx_pkt);          // Drop a half-framed packet
+        conn_reset(dev);
+        txq_clear(&dev->txq);
+        txq_clear(&dev->prio_txq);
+        if (num_connected > 0) num_connected--;
     }
+    ble_congested = any_congested();
+    ble_metrics_congest(ble_congested);
+}
 
-    for (int i = 0; i < MAX_DEVICES; i++) {
-        connected_devices[i].conn_id = CONN_ID_INVALID;
-        connected_devices[i].gatts_if = ESP_GATT_IF_NONE;
-        connected_devices[i].notify_enabled = false;
-        memset(connected_devices[i].rx_buf, 0, sizeof(connected_devices[i].rx_buf));
-        connected_devices[i].rx_idx = 0;
-        connected_devices[i].data_mode = WAITING;
+bool ble_gs_addr(uint8_t *bda, uint8_t *type) {
+    if (!gs_known) return false;
+    memcpy(bda, gs_bda, BLE_ADDR_LEN);
+    *type = gs_addr_type;
+    return true;
+}
+
+static void gs_addr_load(void) {
+    nvs_handle_t h;
+    uint8_t blob[BLE_ADDR_LEN + 1];
+    size_t len = sizeof(blob);
+    if (nvs_open(BLE_NVS_NS, NVS_READONLY, &h) != ESP_OK) return;
+    if (nvs_get_blob(h, BLE_NVS_GS_KEY, blob, &len) == ESP_OK && len == sizeof(blob)) {
+        memcpy(gs_bda, blob, BLE_ADDR_LEN);
+        gs_addr_type = blob[BLE_ADDR_LEN];
+        gs_known = true;
+        ESP_LOGI(BLE_TAG, "Last GS %02x:%02x:%02x:%02x:%02x:%02x, directed advertising first",
+                 gs_bda[0], gs_bda[1], gs_bda[2], gs_bda[3], gs_bda[4], gs_bda[5]);
     }
-    num_connected = 0;
+    nvs_close(h);
+}
 
-    esp_ble_gatt_set_local_mtu(512);
+// Written only when the central changes: a flash write stalls both cores
+void ble_gs_remember(const uint8_t *bda, uint8_t type) {
+    if (gs_known && gs_addr_type == type && memcmp(gs_bda, bda, BLE_ADDR_LEN) == 0) return;
+    memcpy(gs_bda, bda, BLE_ADDR_LEN);
+    gs_addr_type = type;
+    gs_known = true;
+
+    nvs_handle_t h;
+    uint8_t blob[BLE_ADDR_LEN + 1];
+    memcpy(blob, bda, BLE_ADDR_LEN);
+    blob[BLE_ADDR_LEN] = type;
+    if (nvs_open(BLE_NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    if (nvs_set_blob(h, BLE_NVS_GS_KEY, blob, sizeof(blob)) == ESP_OK) nvs_commit(h);
+    nvs_close(h);
+}
 
-    esp_ble_gatts_register_callback(gatts_event_handler);
-    esp_ble_gap_register_callback(gap_event_handler);
-    esp_ble_gatts_app_register(ESP_ROBOT_APP_ID);
+void ble_log_link(const device_conn_t *dev) {
+    ESP_LOGI(BLE_TAG, "Link conn_id=%d: MTU %d, interval %d.%02d ms, PHY %dM",
+             dev->conn_id, dev->mtu, dev->conn_int * 5 / 4, (dev->conn_int * 125) % 100, dev->phy);
 }
 
-void send_bytes_to_all(uint8_t *packet, size_t len) {
-    if (ble_congested) return;  // drop if BLE TX queue is backed up
+int ble_notify_max(void) {
+    int max = 0;
     for (int i = 0; i < MAX_DEVICES; i++) {
-        if (connected_devices[i].conn_id != CONN_ID_INVALID && connected_devices[i].notify_enabled) {
-            esp_ble_gatts_send_indicate(
-                connected_devices[i].gatts_if,
-                connected_devices[i].conn_id,
-                robot_handle_table[ROBOT_IDX_RX_VAL],
-                len,
-                packet,
-                false
-            );
-        }
+        const device_conn_t *dev = &connected_devices[i];
+        if (dev->conn_id == CONN_ID_INVALID || !(dev->notify_enabled || dev->coc)) continue;
+        int room = dev->coc ? dev->coc_mtu : dev->mtu - 3;
+        if (max == 0 || room < max) max = room;
     }
+    return max ? max : BLE_ATT_MTU_DEFAULT - 3;
 }
 
-void send_bytes(uint8_t *packet, size_t len){
-    send_bytes_to_all(packet, len);
+// Pool slot for the frame being collected (one copy out of the BLE stack,
+// straight into the buffer the command tasks will read)
+static HOT_PATH ble_rx_pkt_t *rx_slot(device_conn_t *dev) {
+    if (!dev->rx_pkt) dev->rx_pkt = ble_rx_pool_alloc();
+    if (!dev->rx_pkt) {
+        ESP_LOGW(BLE_TAG, "RX pool exhausted, dropping packet");
+        ble_metrics_count(METRIC_RX_DROP);
+    }
+    return dev->rx_pkt;
 }
 
-void send_string(char *txt){
-    send_bytes_to_all((uint8_t *)txt, strlen(txt));
+static int64_t rx_write_us;              // esp_timer time the current GATT write arrived
+
+// Emergency lane: an e-stop word is acted on here, before it waits behind
+// anything in the pool ring or the executor's lanes. Plain words are read
+// as they are; sealed ones only in a SEAL_MARK_ESTOP frame, opened with a
+// read-only replay check (the executor still runs the word and moves the
+// window). A replayed stop would still stop, which is the safe way round.
+static void estop_peek(const ble_rx_pkt_t *pkt) {
+    robot_bt_packet_t w;
+    if (!pkt->secure) {
+        if (pkt->len != 8) return;
+        w = pkt->cmd;
+    } else {
+        if (!pkt->urgent) return;
+        const uint8_t *nonce = pkt->data;
+        uint64_t seq;
+        if (!replay_nonce_seq(nonce, REPLAY_DIR_GS, &seq) ||
+            !replay_check(&connected_devices[pkt->conn].sess.replay, seq)) return;
+        const uint8_t *ct = pkt->data + SEAL_NONCE_LEN;
+        if (aes_gcm_decrypt_raw(nonce, ct, 8, ct + 8, w.bytes) != 0) return;
+    }
+    if (cmd_word_is_estop(w.raw) && w.sys.ac == AC) robot_estop(ESTOP_FAST, rx_write_us);
 }
 
-void send_cmd(uint8_t* pkt, int sec_lvl) {
-    if(!sec_lvl){
-        char hex_str[17];
-        for(int i = 0; i < 8; i++){
-            sprintf(hex_str + (i * 2), "%02X", pkt[i]);
+// Pass a complete frame to the parser by index; the next frame gets a new slot
+static HOT_PATH void rx_submit(device_conn_t *dev, uint16_t len) {
+    ble_rx_pkt_t *pkt = dev->rx_pkt;
+    pkt->len = len;
+    pkt->secure = dev->sess.secure ? 1 : 0;
+    pkt->conn = (uint8_t)(dev - connected_devices);
+    pkt->t_rx_us = trace_now_us();
+    dev->rx_pkt = NULL;
+    dev->rx_idx = 0;
+    TRACE(BLE, RX, dev->conn_id, len, pkt->secure);
+    estop_peek(pkt);
+    if (!ble_rx_pool_submit(pkt)) {
+        ESP_LOGW(BLE_TAG, "BT Queue full, dropping packet");
+        ble_metrics_count(METRIC_RX_DROP);
+    }
+}
+
+#define ECHO_LEN_CUT 0xFF     // rx_echo_left: the write ended between a tag and its length byte
+
+// LINK_ECHO: a write that starts a LINK_ECHO_TAG frame, or carries the
+// rest of one passthrough cut, goes straight back on the same link. The
+// frames' length bytes are walked only to know whether the last one ends
+// in a later write; that part must never reach the word parser.
+static bool rx_echo(device_conn_t *dev, const uint8_t *data, uint16_t len) {
+    if (!dev->sess.echo || len == 0) return false;
+    if (!dev->rx_echo_left && data[0] != LINK_ECHO_TAG) return false;
+
+    uint32_t i = dev->rx_echo_left;
+    if (i == ECHO_LEN_CUT) i = data[0] >= LINK_ECHO_HDR ? data[0] - 1u : 0;   // Counted from the length byte
+    dev->rx_echo_left = 0;
+    while (i < len && data[i] == LINK_ECHO_TAG) {
+        if (i + 1 == len) {
+            dev->rx_echo_left = ECHO_LEN_CUT;
+            break;
         }
-        send_string(hex_str);
-    }else{
-        /*
-        uint8_t cipher_text[PACKET_SIZE] = {0};
+        if (data[i + 1] < LINK_ECHO_HDR) break;
+        i += data[i + 1];
+    }
+    if (i > len) dev->rx_echo_left = (uint8_t)(i - len);
+    ble_host_notify(dev, data, len);
+    return true;
+}
 
-        if(aes_gcm_encrypt_packet((const char *)pkt, cipher_text) == 0){
-            send_bytes_to_all(cipher_text, sizeof(cipher_text));
-        }else{
-            ESP_LOGE("SEND_CMD", "Encryption FAILED");
+// One GATT write to 0xFF01, however the host delivered it
+HOT_PATH void ble_rx_write(device_conn_t *dev, const uint8_t *incoming_data, uint16_t incoming_len) {
+    rx_write_us = esp_timer_get_time();
+    if (rx_echo(dev, incoming_data, incoming_len)) return;
+
+    if (!dev->sess.secure) {
+        // Bare 8-byte words (GS AT writes), WRITE_TAG_WORD
+        // frames cut wherever SPP passthrough likes, or a
+        // BATCH_MAGIC | n | n words burst; a tag can never
+        // start a word, so it also resyncs. Every word of a
+        // batch gets its own pool slot, submitted in order.
+        for (int i = 0; i < incoming_len; i++) {
+            uint8_t current_byte = incoming_data[i];
+
+            if (dev->data_mode == BATCH) {
+                dev->rx_batch_left = current_byte;
+                dev->rx_idx = 0;
+                if (current_byte == 0 || current_byte > BLE_BATCH_MAX) {
+                    dev->data_mode = WAITING;
+                } else if (rx_slot(dev)) {
+                    dev->data_mode = COLLECTING;
+                } else {
+                    dev->data_mode = WAITING;
+                    break;
+                }
+                continue;
+            }
+            if (dev->data_mode != START && dev->data_mode != COLLECTING) {
+                dev->rx_batch_left = 0;
+                if (current_byte == BATCH_MAGIC) {
+                    dev->data_mode = BATCH;
+                    continue;
+                }
+                if (!rx_slot(dev)) break;
+                dev->rx_idx = 0;
+                dev->data_mode = current_byte == WRITE_TAG_WORD ? COLLECTING : START;
+                if (dev->data_mode == COLLECTING) continue;
+            }
+            dev->rx_pkt->data[dev->rx_idx++] = current_byte;
+            if (dev->rx_idx == 8) {
+                rx_submit(dev, 8);
+                dev->data_mode = WAITING;
+                if (dev->rx_batch_left > 1) {
+                    dev->rx_batch_left--;
+                    if (!rx_slot(dev)) break;
+                    dev->data_mode = COLLECTING;
+                }
+            }
         }
-        */
-        uint8_t cipher_text[PACKET_SIZE] = {0};
-        
-        if(aes_gcm_encrypt_packet((const char *)pkt, cipher_text) == 0){
-            ESP_LOGI("SEND_CMD", "Secure packet sent (156 bytes)");
-            char hex_cipher[PACKET_SIZE * 2 + 1];
-            for(int i = 0; i < PACKET_SIZE; i++){
-                sprintf(hex_cipher + (i * 2), "%02X", cipher_text[i]);
+    } else {
+        for (int i = 0; i < incoming_len; i++) {
+            uint8_t current_byte = incoming_data[i];
+
+            switch (dev->data_mode) {
+                case WAITING:
+                    if (current_byte == 0x0A) {
+                        dev->data_mode = START;
+                    }
+                    break;
+                case START:
+                    if ((current_byte == CIPHER_MARK_WORD || current_byte == CIPHER_MARK_BATCH ||
+                         current_byte == SEAL_MARK_WORD || current_byte == SEAL_MARK_BATCH ||
+                         current_byte == SEAL_MARK_ESTOP) &&
+                        rx_slot(dev)) {
+                        dev->rx_pkt->batch = current_byte == CIPHER_MARK_BATCH ||
+                                             current_byte == SEAL_MARK_BATCH;
+                        dev->rx_pkt->compact = current_byte == SEAL_MARK_WORD ||
+                                               current_byte == SEAL_MARK_BATCH ||
+                                               current_byte == SEAL_MARK_ESTOP;
+                        dev->rx_pkt->urgent = current_byte == SEAL_MARK_ESTOP;
+                        // A compact batch's length follows from its count byte
+                        dev->rx_need = current_byte == SEAL_MARK_BATCH ? 1 :
+                                       dev->rx_pkt->compact ? SEAL_WORD_BODY : PACKET_SIZE;
+                        dev->data_mode = COLLECTING;
+                    } else {
+                        dev->data_mode = WAITING;
+                    }
+                    dev->rx_idx = 0;
+                    break;
+                case COLLECTING:
+                    if (dev->rx_idx < dev->rx_need) {
+                        dev->rx_pkt->data[dev->rx_idx] = current_byte;
+                        dev->rx_idx++;
+                        if (dev->rx_pkt->compact && dev->rx_pkt->batch && dev->rx_idx == 1) {
+                            int words = seal_words(SEAL_MARK_BATCH, dev->rx_pkt->data);
+                            if (words) dev->rx_need = SEAL_BATCH_BODY(words);
+                            else dev->data_mode = WAITING;
+                        }
+                    } else if (current_byte == 0xDA) {
+                        dev->rx_idx++;
+                        dev->data_mode = FINISH;
+                    } else {
+                        dev->data_mode = WAITING;
+                    }
+                    break;
+                case FINISH:
+                    if (current_byte == 0x0D) {
+                        rx_submit(dev, dev->rx_need);
+                    }
+                    dev->data_mode = WAITING;
+                    break;
             }
-            send_string(hex_cipher);
-        }else{
-            ESP_LOGE("SEND_CMD", "Encryption FAILED");
         }
     }
 }
 
-void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
-{
-    switch (event) {
-        case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
-            esp_ble_gap_start_advertising(&adv_params);
-            break;
+void robot_ble_init(){
+    if (!ble_rx_pool_init()) {
+        return;
+    }
 
-        case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
-            if (param->adv_start_cmpl.status != ESP_BT_STATUS_SUCCESS) {
-                ESP_LOGE(BLE_TAG, "Advertising start failed");
-            } else {
-                ESP_LOGI(BLE_TAG, "Advertising start successfully");
-            }
-            break;
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        conn_reset(&connected_devices[i]);
+        replay_reset(&connected_devices[i].sess.replay);
+    }
+    memset(conn_lut, 0, sizeof(conn_lut));
+    num_connected = 0;
+    gs_addr_load();                                    // NVS is up (app_main)
+
+    // Controller + host footprint, to compare the two hosts on the bench
+    uint32_t heap_before = esp_get_free_heap_size();
+    ble_host_start();
+    uint32_t heap_after = esp_get_free_heap_size();
+    ESP_LOGI(BLE_TAG, "%s host up: %lu bytes of heap taken, %lu free (low %lu)", ble_host_name,
+             (unsigned long)(heap_before - heap_after), (unsigned long)heap_after,
+             (unsigned long)esp_get_minimum_free_heap_size());
+}
 
-        case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT:
-            if (param->adv_stop_cmpl.status != ESP_BT_STATUS_SUCCESS) {
-                ESP_LOGE(BLE_TAG, "Advertising stop failed");
-            } else {
-                ESP_LOGI(BLE_TAG, "Advertising stopped successfully");
-            }
-            break;
+void ble_set_name(const char *name) {
+    ble_host_set_name(name);
+}
 
-        case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
-            ESP_LOGI(BLE_TAG,
-                     "Conn params updated: status=%d, int=%d, latency=%d, timeout=%d",
-                     param->update_conn_params.status,
-                     param->update_conn_params.conn_int,
-                     param->update_conn_params.latency,
-                     param->update_conn_params.timeout);
-            break;
+// ------------------------- Sessions -------------------------
 
-        default:
-            break;
+static bool slot_live(int conn) {
+    return conn >= 0 && conn < MAX_DEVICES && connected_devices[conn].conn_id != CONN_ID_INVALID;
+}
+
+bool ble_session_secure(int conn) {
+    if (conn >= 0) return slot_live(conn) && connected_devices[conn].sess.secure;
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        if (slot_live(i) && connected_devices[i].sess.secure) return true;
     }
+    return false;
 }
 
-void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
-{
-    switch (event) {
-        case ESP_GATTS_REG_EVT:
-        {
-            esp_ble_gap_set_device_name(DEVICE_NAME);
-            esp_ble_gap_config_adv_data(&adv_data);
-            esp_ble_gatts_create_attr_tab(gatt_db, gatts_if, ROBOT_IDX_NB, SVC_INST_ID);
-            break;
-        }
-        case ESP_GATTS_CREAT_ATTR_TAB_EVT:
-        {
-            if (param->add_attr_tab.status == ESP_GATT_OK) {
-                memcpy(robot_handle_table, param->add_attr_tab.handles, sizeof(robot_handle_table));
-                esp_ble_gatts_start_service(robot_handle_table[ROBOT_IDX_SVC]);
-            }
-            break;
-        }
+void ble_session_set_secure(int conn, bool secure) {
+    sess_secure_default = secure;
+    if (slot_live(conn)) connected_devices[conn].sess.secure = secure;
+}
+
+void ble_session_subscribe(int conn, uint8_t topics, uint16_t tlm_gap_ms) {
+    if (!slot_live(conn)) return;
+    connected_devices[conn].sess.topics = topics & TOPIC_ALL;
+    connected_devices[conn].sess.tlm_gap_ms = tlm_gap_ms;
+}
 
-        case ESP_GATTS_CONNECT_EVT:
-        {
-            ESP_LOGI(BLE_TAG, "Device connected, conn_id=%d", param->connect.conn_id);
+uint32_t ble_tlm_gap_ms(void) {
+    uint32_t gap = 0;
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        const ble_session_t *s = &connected_devices[i].sess;
+        if (slot_live(i) && (s->topics & TOPIC_TELEMETRY) && s->tlm_gap_ms > gap) gap = s->tlm_gap_ms;
+    }
+    return gap;
+}
 
-            int slot = -1;
-            for (int i = 0; i < MAX_DEVICES; i++) {
-                if (connected_devices[i].conn_id == CONN_ID_INVALID) {
-                    slot = i;
-                    break;
-                }
-            }
+void ble_session_set_echo(int conn, bool on) {
+    if (!slot_live(conn)) return;
+    connected_devices[conn].sess.echo = on;
+    connected_devices[conn].rx_echo_left = 0;
+}
 
-            if (slot == -1) {
-                ESP_LOGW(BLE_TAG, "No free connection slots, rejecting device");
-                esp_ble_gap_disconnect(param->connect.remote_bda);
-                break;
-            }
+int ble_control_owner(void) {
+    return ctrl_owner;
+}
 
-            connected_devices[slot].conn_id = param->connect.conn_id;
-            connected_devices[slot].gatts_if = gatts_if;
-            connected_devices[slot].notify_enabled = false;
-            memset(connected_devices[slot].rx_buf, 0, sizeof(connected_devices[slot].rx_buf));
-            connected_devices[slot].rx_idx = 0;
-            connected_devices[slot].data_mode = WAITING;
-            num_connected++;
-
-            esp_ble_gap_set_pkt_data_len(param->connect.remote_bda, 251);
-
-            if (num_connected < MAX_DEVICES) {
-                ESP_LOGI(BLE_TAG, "Slot %d/%d used, restarting advertising", num_connected, MAX_DEVICES);
-                esp_ble_gap_start_advertising(&adv_params);
-            } else {
-                ESP_LOGI(BLE_TAG, "All %d slots full, stopping advertising", MAX_DEVICES);
-            }
-            break;
-        }
+bool ble_control_claim(int conn) {
+    if (ctrl_owner < 0 && slot_live(conn)) {
+        ctrl_owner = conn;
+        ESP_LOGI(BLE_TAG, "Control lane: conn_id=%d", connected_devices[conn].conn_id);
+    }
+    return ctrl_owner == conn;
+}
 
-        case ESP_GATTS_DISCONNECT_EVT:
-        {
-            ESP_LOGI(BLE_TAG, "Device disconnected, conn_id=%d", param->disconnect.conn_id);
-            device_conn_t *dev = find_device_by_conn_id(param->disconnect.conn_id);
-            if (dev) {
-                dev->conn_id = CONN_ID_INVALID;
-                dev->gatts_if = ESP_GATT_IF_NONE;
-                dev->notify_enabled = false;
-                dev->rx_idx = 0;
-                dev->data_mode = WAITING;
-                if (num_connected > 0) num_connected--;
-            }
-            ble_congested = false;  // reset on disconnect
-            esp_ble_gap_start_advertising(&adv_params);
-            break;
+void ble_control_release(int conn) {
+    if (ctrl_owner != conn) return;
+    ctrl_owner = -1;
+    ESP_LOGI(BLE_TAG, "Control lane free");
+}
+
+// The priority lane (ACK / HPR) goes on ROBOT_PRIO_UUID where the central
+// subscribed to it, on 0xFF02 otherwise
+static int lane_notify(device_conn_t *dev, bool prio, const uint8_t *data, size_t len) {
+    return prio && dev->prio_notify ? ble_host_notify_prio(dev, data, len) : ble_host_notify(dev, data, len);
+}
+
+// Push out what waited in one lane, until the link backs up again; true
+// when the lane is empty. Only a host that refuses holds the priority lane:
+// the congestion flag holds bulk notifies, which would otherwise stand in
+// front of it in the stack.
+static bool lane_drain(device_conn_t *dev, bool prio) {
+    txq_t *q = prio ? &dev->prio_txq : &dev->txq;
+    txq_entry_t e;
+    while ((prio || !dev->congested) && dev->conn_id != CONN_ID_INVALID && txq_pop(q, &e)) {
+        if (lane_notify(dev, prio, e.data, e.len) != 0) {
+            txq_push(q, e.data, e.len, (txq_class_t)e.cls, e.key);   // Back in line (or a drop)
+            return false;
         }
+    }
+    return txq_depth(q) == 0;
+}
 
-        // Congestion event — BLE TX queue full/clear feedback from stack
-        case ESP_GATTS_CONGEST_EVT:
-        {
-            ble_congested = param->congest.congested;
-            ESP_LOGW(BLE_TAG, "BLE congestion: %s", ble_congested ? "CONGESTED" : "CLEAR");
-            break;
+static void txq_drain(device_conn_t *dev) {
+    if (lane_drain(dev, true)) lane_drain(dev, false);
+}
+
+void ble_conn_congest(device_conn_t *dev, bool congested) {
+    if (dev) dev->congested = congested;
+    ble_congested = any_congested();
+    ble_metrics_congest(ble_congested);
+    if (dev && !congested) txq_drain(dev);
+}
+
+// Class and replace-key of one report word: ACK/HPR take the priority lane,
+// periodic reports of the same type (and IMU part) replace each other
+static txq_class_t word_class(const uint8_t *pkt, uint8_t *key) {
+    uint8_t type = (pkt[0] >> 2) & 0x1F;
+    *key = TXQ_KEY_NONE;
+    if (type == ACK_CMD || type == HPR_CMD) return TXQ_URGENT;
+    if (type == HEALTH_CMD || type == ROBOT_UPDATE_CMD) {
+        *key = (uint8_t)(((pkt[0] | (pkt[1] << 8)) >> 2) & 0x7F);     // type + part, bits 2-8
+        return TXQ_PERIODIC;
+    }
+    return TXQ_NORMAL;
+}
+
+// Report topic of one word (cmd_codec.h, Multi-central)
+static uint8_t word_topic(const uint8_t *pkt) {
+    uint8_t type = (pkt[0] >> 2) & 0x1F;
+    if (type == HEALTH_CMD) return TOPIC_HEALTH;
+    if (type == ROBOT_UPDATE_CMD) return TOPIC_TELEMETRY;
+    if (type == FEC_CMD) return TOPIC_TELEMETRY | TOPIC_HEALTH;    // Parity batches cover both
+    return TOPIC_ACK;
+}
+
+// Which links a notify goes to: one slot or BLE_CONN_ALL, a topic they
+// subscribed to (0 = any) and the encoding their session reads (-1 = any)
+typedef struct {
+    int conn;
+    uint8_t topic;
+    int8_t secure;
+} notify_to_t;
+
+static bool link_wants(int i, const notify_to_t *to) {
+    const device_conn_t *dev = &connected_devices[i];
+    return dev->conn_id != CONN_ID_INVALID && (dev->notify_enabled || dev->coc) &&
+           (to->conn == BLE_CONN_ALL || to->conn == i) &&
+           (!to->topic || (dev->sess.topics & to->topic)) &&
+           (to->secure < 0 || to->secure == dev->sess.secure);
+}
+
+static bool any_link_wants(const notify_to_t *to) {
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        if (link_wants(i, to)) return true;
+    }
+    return false;
+}
+
+static void send_notify(const uint8_t *packet, size_t len, txq_class_t cls, uint8_t key, const notify_to_t *to) {
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        device_conn_t *dev = &connected_devices[i];
+        if (!link_wants(i, to)) continue;
+
+        if (cls == TXQ_URGENT) {                // Priority lane: behind its own queue only
+            if (lane_drain(dev, true) && lane_notify(dev, true, packet, len) == 0) continue;
+            txq_push(&dev->prio_txq, packet, (uint16_t)len, cls, key);
+            continue;
         }
+        if (!dev->congested) txq_drain(dev);
+        if (!dev->congested && txq_depth(&dev->prio_txq) == 0 && txq_depth(&dev->txq) == 0 &&
+            ble_host_notify(dev, packet, len) == 0) continue;
+        txq_push(&dev->txq, packet, (uint16_t)len, cls, key);     // Counts a drop if it can't stay
+    }
+}
 
-        case ESP_GATTS_WRITE_EVT:
-        {
-            if (!param->write.is_prep) {
-                device_conn_t *dev = find_device_by_conn_id(param->write.conn_id);
-
-                if (param->write.handle == robot_handle_table[ROBOT_IDX_CFG]) {
-                    uint16_t descr_value =
-                        param->write.value[1] << 8 |
-                        param->write.value[0];
-
-                    if (descr_value == 0x0001) {
-                        ESP_LOGI(BLE_TAG, "Notifications ENABLED (conn_id=%d)", param->write.conn_id);
-                        if (dev) dev->notify_enabled = true;
-                    } else if (descr_value == 0x0000) {
-                        ESP_LOGI(BLE_TAG, "Notifications DISABLED (conn_id=%d)", param->write.conn_id);
-                        if (dev) dev->notify_enabled = false;
-                    }
-                } else if (param->write.handle == robot_handle_table[ROBOT_IDX_VAL]) {
-                    if (!dev) {
-                        ESP_LOGE(BLE_TAG, "Write from unknown conn_id=%d", param->write.conn_id);
-                        break;
-                    }
+void send_bytes_to_all(uint8_t *packet, size_t len) {
+    send_notify(packet, len, TXQ_NORMAL, TXQ_KEY_NONE, &(notify_to_t){ BLE_CONN_ALL, 0, -1 });
+}
 
-                    uint16_t incoming_len = param->write.len;
-                    uint8_t *incoming_data = param->write.value;
+void send_bytes(uint8_t *packet, size_t len){
+    send_bytes_to_all(packet, len);
+}
 
-                    if (dev->rx_idx + incoming_len > sizeof(dev->rx_buf)) {
-                        ESP_LOGE(BLE_TAG, "Incoming data exceeds buffer, resetting index");
-                        dev->rx_idx = 0;
-                        return;
-                    }
+void send_string(char *txt){
+    send_bytes_to_all((uint8_t *)txt, strlen(txt));
+}
 
-                    if (!security_flag) {
-                        memcpy(&dev->rx_buf[dev->rx_idx], incoming_data, incoming_len);
-                        dev->rx_idx += incoming_len;
-                        if (dev->rx_idx == 8) {
-                            if (xQueueSend(ble_recieve_queue, (void *)dev->rx_buf, (TickType_t)0) != pdPASS) {
-                                ESP_LOGW(BLE_TAG, "BT Queue full, dropping packet");
-                            }
-                            dev->rx_idx = 0;
-                        } else if (dev->rx_idx > 8) {
-                            ESP_LOGE(BLE_TAG, "Unsecure Mode - Packet Longer than 8 Bytes");
-                            dev->rx_idx = 0;
-                        }
-                    } else if (security_flag) {
-                        for (int i = 0; i < incoming_len; i++) {
-                            uint8_t current_byte = incoming_data[i];
-
-                            switch (dev->data_mode) {
-                                case WAITING:
-                                    if (current_byte == 0x0A) {
-                                        dev->data_mode = START;
-                                    }
-                                    break;
-                                case START:
-                                    if (current_byte == 0xD0) {
-                                        dev->data_mode = COLLECTING;
-                                    } else {
-                                        dev->data_mode = WAITING;
-                                    }
-                                    dev->rx_idx = 0;
-                                    break;
-                                case COLLECTING:
-                                    if (dev->rx_idx < 156) {
-                                        dev->rx_buf[dev->rx_idx] = current_byte;
-                                        dev->rx_idx++;
-                                    } else if (current_byte == 0xDA) {
-                                        dev->rx_idx++;
-                                        dev->data_mode = FINISH;
-                                    } else {
-                                        dev->data_mode = WAITING;
-                                    }
-                                    break;
-                                case FINISH:
-                                    if (current_byte == 0x0D) {
-                                        if (xQueueSend(ble_recieve_queue, (void *)dev->rx_buf, (TickType_t)0) != pdPASS) {
-                                            ESP_LOGW(BLE_TAG, "BT Queue full, dropping packet");
-                                        }
-                                        dev->rx_idx = 0;
-                                    }
-                                    dev->data_mode = WAITING;
-                                    break;
-                            }
-                        }
-                    }
-                }
+int ble_tx_depth(void) {
+    int depth = 0;
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        if (connected_devices[i].conn_id == CONN_ID_INVALID) continue;
+        int d = txq_depth(&connected_devices[i].txq), p = txq_depth(&connected_devices[i].prio_txq);
+        if (d > depth) depth = d;
+        if (p > depth) depth = p;
+    }
+    return depth;
+}
 
-                if (param->write.need_rsp) {
-                    esp_ble_gatts_send_response(
-                        gatts_if,
-                        param->write.conn_id,
-                        param->write.trans_id,
-                        ESP_GATT_OK,
-                        NULL);
-                }
-            }
-            break;
+// Seal one 128-byte plaintext and notify it to the sealed sessions in to;
+// marker is the second frame byte (CIPHER_MARK_WORD for a single word,
+// CIPHER_MARK_BATCH for a batch)
+static void send_sealed(const uint8_t *plain, uint8_t marker, txq_class_t cls, uint8_t key, const notify_to_t *to) {
+    uint8_t cipher_text[PACKET_SIZE] = {0};
+
+    if(aes_gcm_encrypt_packet((const char *)plain, cipher_text) == 0){
+        if (BLE_CIPHER_HEX && !notify_mode) {
+            TRACE(BLE, SEAL, marker, cls, 1);
+            char hex_cipher[PACKET_SIZE * 2 + 1];
+            hexc_encode(cipher_text, PACKET_SIZE, hex_cipher, 1);
+            send_notify((uint8_t *)hex_cipher, PACKET_SIZE * 2, cls, key, to);   // Too long to queue
+            return;
         }
+        if (ble_notify_max() < CIPHER_FRAME_SIZE) {
+            ESP_LOGW("SEND_CMD", "MTU too small for a secure frame (%d < %d)", ble_notify_max(), CIPHER_FRAME_SIZE);
+        }
+        uint8_t frame[CIPHER_FRAME_SIZE];
+        frame[0] = 0x0A;
+        frame[1] = marker;
+        memcpy(frame + 2, cipher_text, PACKET_SIZE);
+        frame[PACKET_SIZE + 2] = 0xDA;
+        frame[PACKET_SIZE + 3] = 0x0D;
+        send_notify(frame, sizeof(frame), cls, key, to);
+        TRACE(BLE, SEAL, marker, cls, 1);
+    }else{
+        TRACE(BLE, SEAL, marker, cls, 0);
+        ESP_LOGE("SEND_CMD", "Encryption FAILED");
+    }
+}
 
-        default:
-            break;
+// Plain sessions get the word as notify_mode says, sealed ones one seal;
+// with both kinds connected, both go out
+void send_cmd_to(int conn, uint8_t* pkt) {
+    uint8_t key;
+    txq_class_t cls = word_class(pkt, &key);
+    notify_to_t plain_to = { conn, word_topic(pkt), 0 }, sealed_to = plain_to;
+    sealed_to.secure = 1;
+
+    if(any_link_wants(&plain_to)){
+        if(notify_mode){
+            uint8_t frame[9];
+            frame[0] = NOTIFY_TAG_WORD;
+            memcpy(frame + 1, pkt, 8);
+            send_notify(frame, sizeof(frame), cls, key, &plain_to);
+        }else{
+            char hex_str[17];
+            hexc_encode(pkt, 8, hex_str, 1);
+            send_notify((uint8_t *)hex_str, 16, cls, key, &plain_to);
+        }
+    }
+    if(any_link_wants(&sealed_to)){
+        uint8_t plain[128] = {0};           // Cipher input is always one 128-byte block run
+        memcpy(plain, pkt, 8);
+        send_sealed(plain, CIPHER_MARK_WORD, cls, key, &sealed_to);
     }
-}
\ No newline at end of file
+}
+
+void send_cmd(uint8_t* pkt) {
+    send_cmd_to(BLE_CONN_ALL, pkt);
+}
+
+void send_cmd_batch(const robot_bt_packet_t *words, int n) {
+    if (n <= 0) return;
+    if (n == 1) {
+        send_cmd((uint8_t *)words[0].bytes);
+        return;
+    }
+    if (n > BLE_BATCH_MAX) n = BLE_BATCH_MAX;
+    notify_to_t plain_to = { BLE_CONN_ALL, word_topic(words[0].bytes), 0 }, sealed_to = plain_to;
+    sealed_to.secure = 1;
+
+    if(any_link_wants(&plain_to)){
+        // As many words per notification as the smallest peer MTU allows
+        int per = (ble_notify_max() - 2) / 8;
+        if (per < 1) per = 1;
+        if (per > BLE_BATCH_MAX) per = BLE_BATCH_MAX;
+
+        uint8_t frame[2 + BLE_BATCH_MAX * 8];
+        for (int at = 0; at < n; at += per) {
+            int k = (n - at < per) ? n - at : per;
+            frame[0] = BATCH_MAGIC;
+            frame[1] = (uint8_t)k;
+            for (int i = 0; i < k; i++) memcpy(frame + 2 + i * 8, words[at + i].bytes, 8);
+            send_notify(frame, 2 + k * 8, TXQ_PERIODIC, TXQ_KEY_BATCH | (at / per), &plain_to);
+        }
+    }
+    if(any_link_wants(&sealed_to)){
+        // One seal for the whole batch: [n][n x 8 bytes] zero padded to 128
+        uint8_t plain[128] = {0};
+        plain[0] = (uint8_t)n;
+        for (int i = 0; i < n; i++) memcpy(plain + 1 + i * 8, words[i].bytes, 8);
+        send_sealed(plain, CIPHER_MARK_BATCH, TXQ_PERIODIC, TXQ_KEY_BATCH, &sealed_to);
+    }
+}
@@ -8,65 +8,151 @@
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "esp_bt.h"
+#include "sdkconfig.h"
+
+// Host: Component config > Bluetooth > Host in menuconfig. Bluedroid
+// (ble_host_bluedroid.c) is the default build; NimBLE (ble_host_nimble.c,
+// env:esp32dev_nimble in platformio.ini) is smaller and hands a GATT write
+// to the access callback straight from its host task. Everything above the
+// glue (framing, TX queues, sealing) is shared, in Robot_BLE.c.
 
-#include "esp_gap_ble_api.h"
-#include "esp_gatts_api.h"
-#include "esp_bt_main.h"
-#include "esp_bt_device.h"
-#include "esp_gatt_common_api.h"
 #include "pinout.h"
 #include "robot_commands.h"
 #include "aes_gcm_encrypt.h"
+#include "hex_codec.h"
+#include "ble_rx_pool.h"
+#include "replay_window.h"
+#include "compact_seal.h"
+#include "ble_tx_queue.h"
 
-#define ROBOT_PROFILE_NUM                       1
-#define ROBOT_PROFILE_APP_IDX                   0
 #define ESP_ROBOT_APP_ID                        0x55
 #define DEVICE_NAME                             "ROBOT_ESP32"
 #define SVC_INST_ID                             0
 #define CHAR_DECLARATION_SIZE                   (sizeof(uint8_t))
 #define GATTS_DEMO_CHAR_VAL_LEN_MAX             500
 
+// Secure-mode notify encoding in text mode. 0: raw ciphertext framed like
+// the inbound link (0x0A 0xD0 | 156 bytes | 0xDA 0x0D). 1: legacy 312-char
+// hex string. Binary notify mode always sends the raw frame.
+#ifndef BLE_CIPHER_HEX
+#define BLE_CIPHER_HEX  0
+#endif
+
+// Start-up notify_mode (switchable with the NOTIFY_MODE System command).
+// 0: plain words as 16 hex chars. 1: plain words as NOTIFY_TAG_WORD | 8 bytes.
+// Every binary notify starts with a tag byte (NOTIFY_TAG_WORD, BATCH_MAGIC
+// or 0x0A), so the GS can split an unframed passthrough stream.
+#ifndef BLE_NOTIFY_BINARY
+#define BLE_NOTIFY_BINARY 0
+#endif
+#define NOTIFY_TAG_WORD 0xB6
+// GS -> robot in SPP passthrough: plain words arrive as WRITE_TAG_WORD | 8
+// bytes in an unframed stream (type bits 13: never the first byte of a word)
+#define WRITE_TAG_WORD  0xB5
+#define CIPHER_FRAME_SIZE (PACKET_SIZE + 4)
+#define CIPHER_MARK_WORD  0xD0       // Sealed frame carries one 8-byte word
+#define CIPHER_MARK_BATCH 0xD1       // Sealed frame carries [n][n words]
+// The GS may also send compact seals (SEAL_MARK_WORD / SEAL_MARK_BATCH,
+// compact_seal.h): the words alone, 40 bytes for one; both forms are taken
+
+// Batching: several 8-byte words in one notification or one GATT write,
+// same layout both ways (n = 1..BLE_BATCH_MAX).
+//   plain:  BATCH_MAGIC | n | n x 8 bytes   (binary, so never valid hex text)
+//   secure: [n][n x 8 bytes] as the 128-byte plaintext of one GCM frame
+//           marked CIPHER_MARK_BATCH
+#define BATCH_MAGIC     0xB7
+#define BLE_BATCH_MAX   15           // (128 - 1) / 8 words fit one seal
+#define TXQ_KEY_BATCH   0x80         // | chunk index: queued telemetry batch (words use type+part keys)
+
 #define MAX_DEVICES     2
 #define CONN_ID_INVALID 0xFFFF
+#define BLE_CONN_ALL    (-1)         // send_cmd_to(): every subscribed link
+#define BLE_CONN_LUT    16           // conn_id -> slot buckets (power of two)
 
+// Link tuning requested on every connection (interval x1.25 ms, timeout
+// x10 ms): 7.5-15 ms, no latency, 5 s supervision. 2M PHY is asked for
+// only on chips with BLE 5 (the ESP32 is 4.2 and stays on 1M).
+#define BLE_CONN_INT_MIN     6
+#define BLE_CONN_INT_MAX     12
+#define BLE_CONN_LATENCY     0
+#define BLE_CONN_TIMEOUT     500
+#define BLE_ATT_MTU_DEFAULT  23
+
+// Advertising after boot / a drop (host glue, Advertising): a directed
+// burst at the last GS for BLE_ADV_DIRECT_MS (high duty is capped at
+// 1.28 s by the spec), then BLE_ADV_FAST_INT (x0.625 ms) for
+// BLE_ADV_FAST_MS, then 20-40 ms. The GS address lives in NVS.
+#ifndef BLE_ADV_DIRECT_MS
+#define BLE_ADV_DIRECT_MS    1280
+#endif
+#ifndef BLE_ADV_FAST_INT
+#define BLE_ADV_FAST_INT     0x20    // 20 ms
+#endif
+#ifndef BLE_ADV_FAST_MS
+#define BLE_ADV_FAST_MS      30000
+#endif
+#define BLE_NVS_NS           "robot_ble"
+#define BLE_NVS_GS_KEY       "gs_bda"     // 6 address bytes (most significant first) + type
+#define BLE_ADDR_LEN         6
+
+// Per-central session (cmd_codec.h, Multi-central). The AEAD key, suite
+// and the robot's TX sequence stay shared: one key, one nonce counter.
 typedef struct {
-    uint16_t conn_id;
-    esp_gatt_if_t gatts_if;
+    bool secure;                 // SECURITY_LEVEL as this central set it
+    uint8_t topics;              // enum report_topics it receives
+    uint16_t tlm_gap_ms;         // SUBSCRIBE telemetry gap, 0 = none
+    replay_window_t replay;      // Sealed commands accepted from it (executor)
+    bool echo;                   // LINK_ECHO: LINK_ECHO_TAG writes come straight back
+} ble_session_t;
+
+typedef struct {
+    uint16_t conn_id;            // Host connection id / handle
     bool notify_enabled;
-    uint8_t rx_buf[200];
+    bool metrics_notify;         // Subscribed to ROBOT_METRICS_UUID (ble_metrics.h)
+    bool prio_notify;            // Subscribed to ROBOT_PRIO_UUID: ACK / HPR go there
+    ble_rx_pkt_t *rx_pkt;        // Pool slot being framed, NULL between frames
     int rx_idx;
+    uint16_t rx_need;            // Sealed frame body bytes expected before 0xDA 0x0D
     uint8_t data_mode;
+    uint8_t rx_batch_left;       // Words of a plain BATCH_MAGIC write still to come
+    uint8_t rx_echo_left;        // Bytes of a cut LINK_ECHO_TAG frame still to come
+    uint8_t bda[BLE_ADDR_LEN];   // Peer address, most significant byte first
+    uint16_t mtu;                // Exchanged ATT MTU
+    void *coc;                   // Open L2CAP channel (NimBLE), NULL = GATT only
+    uint16_t coc_mtu;            // Largest SDU the peer takes on it
+    uint16_t conn_int;           // Current interval, x1.25 ms (0 = not reported yet)
+    uint8_t phy;                 // 1 = 1M, 2 = 2M
+    bool congested;              // Host has no room for another notify on this link
+    txq_t txq;                   // Notifies waiting for the congestion to clear
+    txq_t prio_txq;              // ACK / HPR waiting; drains before txq
+    ble_session_t sess;
 } device_conn_t;
 
 extern device_conn_t connected_devices[MAX_DEVICES];
 extern int num_connected;
-extern QueueHandle_t ble_recieve_queue;
-
-enum
-{
-    ROBOT_IDX_SVC,
-
-    ROBOT_IDX_CHAR,      // TX char declaration  (central → peripheral, WRITE)
-    ROBOT_IDX_VAL,       // TX char value        (0xFF01)
+extern volatile bool ble_congested;      // Any link congested
 
-    ROBOT_IDX_RX_CHAR,   // RX char declaration  (peripheral → central, NOTIFY)
-    ROBOT_IDX_RX_VAL,    // RX char value        (0xFF02)
-    ROBOT_IDX_CFG,       // RX CCCD (notify subscription descriptor)
-
-    ROBOT_IDX_NB,
-};
-
-extern uint16_t robot_handle_table[ROBOT_IDX_NB];
-extern esp_ble_adv_data_t adv_data;
-extern esp_ble_adv_params_t adv_params;
 extern uint32_t spp_handle;
 
 void robot_ble_init();
 void send_bytes(uint8_t *packet, size_t len);
 void send_bytes_to_all(uint8_t *packet, size_t len);
 void send_string(char *txt);
-void send_cmd(uint8_t* pkt, int sec_lvl);
-void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
-void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+void send_cmd(uint8_t* pkt);                  // Links subscribed to the word's topic, each in its session's encoding
+void send_cmd_to(int conn, uint8_t* pkt);     // One slot's link (ACKs); BLE_CONN_ALL = send_cmd()
+int  ble_tx_depth(void);     // Deepest per-connection TX queue (either lane) right now
+int  ble_notify_max(void);   // Largest notify payload every subscribed peer can take
+void send_cmd_batch(const robot_bt_packet_t *words, int n);    // n == 1 sends a plain send_cmd()
+void ble_set_name(const char *name);     // GAP device name, either host
+
+// Sessions and the control lane; conn = connected_devices[] slot
+bool ble_session_secure(int conn);       // conn < 0: any link sealed
+void ble_session_set_secure(int conn, bool secure);
+void ble_session_subscribe(int conn, uint8_t topics, uint16_t tlm_gap_ms);
+uint32_t ble_tlm_gap_ms(void);           // Largest gap a telemetry subscriber asked for
+void ble_session_set_echo(int conn, bool on);
+int  ble_control_owner(void);            // Slot, -1 = nobody
+bool ble_control_claim(int conn);        // Owner now (taken if free)? Motion words call it
+void ble_control_release(int conn);      // No-op unless conn owns it
 
 #endif
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef BLE_HOST_H
+#define BLE_HOST_H
+
+#include "Robot_BLE.h"
+
+// -------------------------------------------------------------------------
+// Between Robot_BLE.c and the glue for the BLE host sdkconfig picked
+// (ble_host_bluedroid.c / ble_host_nimble.c; exactly one compiles to code).
+// Addresses are BLE_ADDR_LEN bytes, most significant first, with the HCI
+// address type (0 public, 1 random, ...) where one is needed.
+// -------------------------------------------------------------------------
+
+// Robot_BLE.c, called from the host's callbacks
+device_conn_t *ble_conn_open(uint16_t conn_id, const uint8_t *bda, uint16_t conn_int);   // NULL: all slots taken
+device_conn_t *ble_conn_find(uint16_t conn_id);
+device_conn_t *ble_conn_find_bda(const uint8_t *bda);
+void ble_conn_close(device_conn_t *dev);                          // dev may be NULL
+void ble_conn_congest(device_conn_t *dev, bool congested);       // Clearing drains the TX queue
+void ble_rx_write(device_conn_t *dev, const uint8_t *data, uint16_t len);    // Write to 0xFF01
+void ble_log_link(const device_conn_t *dev);
+bool ble_gs_addr(uint8_t *bda, uint8_t *type);                   // Last GS, false if none yet
+void ble_gs_remember(const uint8_t *bda, uint8_t type);          // NVS, only when it changes
+
+// Host glue
+extern const char ble_host_name[];
+void ble_host_start(void);               // Controller + host up, service registered, advertising
+int  ble_host_notify(device_conn_t *dev, const uint8_t *data, size_t len);   // 0: the host took it
+int  ble_host_notify_metrics(device_conn_t *dev, const uint8_t *data, size_t len);  // On ROBOT_METRICS_UUID
+int  ble_host_notify_prio(device_conn_t *dev, const uint8_t *data, size_t len);     // On ROBOT_PRIO_UUID, as ble_host_notify
+void ble_host_set_name(const char *name);
+
+#endif
@@ -0,0 +1,473 @@
+#include "sdkconfig.h"
+#if !CONFIG_BT_NIMBLE_ENABLED
+
+#include "ble_host.h"
+#include "ble_metrics.h"
+#include "esp_timer.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+#include "esp_bt_main.h"
+#include "esp_bt_device.h"
+#include "esp_gatt_common_api.h"
+
+// Bluedroid glue for the robot service: attribute table, GATTS / GAP
+// callbacks (BTC task) and the advertising sequence
+
+const char ble_host_name[] = "Bluedroid";
+
+enum
+{
+    ROBOT_IDX_SVC,
+
+    ROBOT_IDX_CHAR,      // TX char declaration  (central → peripheral, WRITE)
+    ROBOT_IDX_VAL,       // TX char value        (0xFF01)
+
+    ROBOT_IDX_RX_CHAR,   // RX char declaration  (peripheral → central, NOTIFY)
+    ROBOT_IDX_RX_VAL,    // RX char value        (0xFF02)
+    ROBOT_IDX_CFG,       // RX CCCD (notify subscription descriptor)
+
+    ROBOT_IDX_MET_CHAR,  // Metrics char declaration (READ, NOTIFY)
+    ROBOT_IDX_MET_VAL,   // Metrics char value   (0xFF03)
+    ROBOT_IDX_MET_CFG,   // Metrics CCCD
+
+    ROBOT_IDX_PRIO_CHAR, // Priority char declaration (NOTIFY)
+    ROBOT_IDX_PRIO_VAL,  // Priority char value  (0xFF04)
+    ROBOT_IDX_PRIO_CFG,  // Priority CCCD
+
+    ROBOT_IDX_NB,
+};
+
+static uint16_t robot_handle_table[ROBOT_IDX_NB];
+static esp_gatt_if_t robot_gatts_if = ESP_GATT_IF_NONE;
+
+static const uint16_t GATTS_SERVICE_UUID           = 0x00FF;
+static const uint16_t GATTS_ROBOT_TX_UUID          = 0xFF01;  // central writes here
+static const uint16_t GATTS_ROBOT_RX_UUID          = 0xFF02;  // peripheral notifies here
+static const uint16_t GATTS_ROBOT_METRICS_UUID     = ROBOT_METRICS_UUID;  // runtime metrics
+static const uint16_t GATTS_ROBOT_PRIO_UUID        = ROBOT_PRIO_UUID;     // ACK / HPR
+static const uint16_t primary_service_uuid         = ESP_GATT_UUID_PRI_SERVICE;
+static const uint16_t character_declaration_uuid   = ESP_GATT_UUID_CHAR_DECLARE;
+static const uint16_t character_client_config_uuid = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+
+static const uint8_t char_prop_write    = ESP_GATT_CHAR_PROP_BIT_WRITE |
+                                          ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
+static const uint8_t char_prop_notify   = ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static const uint8_t char_prop_read_notify = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+
+static const uint8_t robot_measurement_ccc[2] = {0x00, 0x00};
+static const uint8_t robot_metrics_ccc[2]     = {0x00, 0x00};
+static const uint8_t robot_prio_ccc[2]        = {0x00, 0x00};
+
+static uint8_t service_uuid[16] = {
+    0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00,
+};
+
+static esp_ble_adv_data_t adv_data = {
+    .set_scan_rsp        = false,
+    .include_name        = true,
+    .include_txpower     = true,
+    .service_uuid_len    = sizeof(service_uuid),
+    .p_service_uuid      = service_uuid,
+    .flag                = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT),
+};
+
+static esp_ble_adv_params_t adv_params = {
+    .adv_int_min         = 0x20,
+    .adv_int_max         = 0x40,
+    .adv_type            = ADV_TYPE_IND,
+    .own_addr_type       = BLE_ADDR_TYPE_PUBLIC,
+    .channel_map         = ADV_CHNL_ALL,
+    .adv_filter_policy   = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
+};
+
+static const esp_gatts_attr_db_t gatt_db[ROBOT_IDX_NB] =
+{
+    // Service Declaration
+    [ROBOT_IDX_SVC] =
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&primary_service_uuid, ESP_GATT_PERM_READ,
+      sizeof(uint16_t), sizeof(GATTS_SERVICE_UUID), (uint8_t *)&GATTS_SERVICE_UUID}},
+
+    // TX Characteristic Declaration — central writes commands to robot
+    [ROBOT_IDX_CHAR] =
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid, ESP_GATT_PERM_READ,
+      CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE, (uint8_t *)&char_prop_write}},
+
+    // TX Characteristic Value (0xFF01) — WRITE only
+    [ROBOT_IDX_VAL] =
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&GATTS_ROBOT_TX_UUID, ESP_GATT_PERM_WRITE,
+      GATTS_DEMO_CHAR_VAL_LEN_MAX, 0, NULL}},
+
+    // RX Characteristic Declaration — robot notifies central with responses
+    [ROBOT_IDX_RX_CHAR] =
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid, ESP_GATT_PERM_READ,
+      CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE, (uint8_t *)&char_prop_notify}},
+
+    // RX Characteristic Value (0xFF02) — NOTIFY only
+    [ROBOT_IDX_RX_VAL] =
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&GATTS_ROBOT_RX_UUID, ESP_GATT_PERM_READ,
+      GATTS_DEMO_CHAR_VAL_LEN_MAX, 0, NULL}},
+
+    // CCCD — subscribe to notifications on the RX characteristic
+    [ROBOT_IDX_CFG] =
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+      sizeof(uint16_t), sizeof(robot_measurement_ccc), (uint8_t *)robot_measurement_ccc}},
+
+    // Metrics Characteristic Declaration — runtime snapshots (ble_metrics.h)
+    [ROBOT_IDX_MET_CHAR] =
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid, ESP_GATT_PERM_READ,
+      CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE, (uint8_t *)&char_prop_read_notify}},
+
+    // Metrics Characteristic Value (0xFF03) — reads answered from the last snapshot
+    [ROBOT_IDX_MET_VAL] =
+    {{ESP_GATT_RSP_BY_APP}, {ESP_UUID_LEN_16, (uint8_t *)&GATTS_ROBOT_METRICS_UUID, ESP_GATT_PERM_READ,
+      sizeof(metrics_sys_t), 0, NULL}},
+
+    // Metrics CCCD
+    [ROBOT_IDX_MET_CFG] =
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+      sizeof(uint16_t), sizeof(robot_metrics_ccc), (uint8_t *)robot_metrics_ccc}},
+
+    // Priority Characteristic Declaration — ACK / HPR ahead of telemetry (cmd_codec.h)
+    [ROBOT_IDX_PRIO_CHAR] =
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid, ESP_GATT_PERM_READ,
+      CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE, (uint8_t *)&char_prop_notify}},
+
+    // Priority Characteristic Value (0xFF04) — NOTIFY only
+    [ROBOT_IDX_PRIO_VAL] =
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&GATTS_ROBOT_PRIO_UUID, ESP_GATT_PERM_READ,
+      GATTS_DEMO_CHAR_VAL_LEN_MAX, 0, NULL}},
+
+    // Priority CCCD
+    [ROBOT_IDX_PRIO_CFG] =
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+      sizeof(uint16_t), sizeof(robot_prio_ccc), (uint8_t *)robot_prio_ccc}},
+};
+
+// -------------------------------------------------------------------------
+// Advertising
+// At boot and after every drop: a high-duty directed burst at the last GS
+// (the central that connected last, kept in NVS), which its initiator
+// answers within a few ms; then fast undirected advertising for anyone, and
+// after BLE_ADV_FAST_MS the normal adv_params interval. Without a stored GS
+// the burst is skipped. Each step ends on adv_timer: stop, and the next
+// mode starts on ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT.
+// -------------------------------------------------------------------------
+typedef enum { ADV_NONE = -1, ADV_DIRECT, ADV_FAST, ADV_NORMAL } adv_mode_t;
+
+static esp_timer_handle_t   adv_timer;
+static volatile adv_mode_t  adv_mode = ADV_NONE;      // Running now (a connection stops it)
+static volatile adv_mode_t  adv_next = ADV_NONE;      // Started once the running one has stopped
+
+static void adv_start(adv_mode_t mode) {
+    static esp_ble_adv_params_t p;                     // BTC copies it, but keep it stable anyway
+    uint32_t ms = 0;
+    uint8_t gs_type;
+    p = adv_params;
+    if (mode == ADV_DIRECT && !ble_gs_addr(p.peer_addr, &gs_type)) mode = ADV_FAST;
+    if (mode == ADV_DIRECT) {
+        p.adv_type = ADV_TYPE_DIRECT_IND_HIGH;
+        p.peer_addr_type = (esp_ble_addr_type_t)gs_type;
+        ms = BLE_ADV_DIRECT_MS;
+    } else if (mode == ADV_FAST) {
+        p.adv_int_min = BLE_ADV_FAST_INT;
+        p.adv_int_max = BLE_ADV_FAST_INT;
+        ms = BLE_ADV_FAST_MS;
+    }
+    esp_timer_stop(adv_timer);                         // Fails harmlessly if not running
+    if (ms) esp_timer_start_once(adv_timer, (uint64_t)ms * 1000);
+    adv_mode = mode;
+    esp_ble_gap_start_advertising(&p);
+}
+
+// Parameters only change while stopped
+static void adv_switch(adv_mode_t mode) {
+    if (adv_mode == ADV_NONE) {
+        adv_start(mode);
+        return;
+    }
+    adv_next = mode;
+    esp_ble_gap_stop_advertising();
+}
+
+static void adv_timer_cb(void *arg) {
+    (void)arg;
+    adv_switch(adv_mode == ADV_DIRECT ? ADV_FAST : ADV_NORMAL);
+}
+
+// A free slot again: burst, then fast, then normal
+static void adv_restart(void) {
+    adv_switch(ADV_DIRECT);
+}
+
+// Ask the central for the tuning profile; it may pick anything in range
+static void request_link_params(device_conn_t *dev) {
+    esp_ble_conn_update_params_t p = {0};
+    memcpy(p.bda, dev->bda, sizeof(esp_bd_addr_t));
+    p.min_int = BLE_CONN_INT_MIN;
+    p.max_int = BLE_CONN_INT_MAX;
+    p.latency = BLE_CONN_LATENCY;
+    p.timeout = BLE_CONN_TIMEOUT;
+    esp_ble_gap_update_conn_params(&p);
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    esp_ble_gap_set_preferred_phy(dev->bda, 0, ESP_BLE_GAP_PHY_2M_PREF_MASK,
+                                  ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+#endif
+}
+
+int ble_host_notify(device_conn_t *dev, const uint8_t *data, size_t len) {
+    // A full BTC queue shows up as ESP_GATTS_CONGEST_EVT, not as an error here
+    return esp_ble_gatts_send_indicate(robot_gatts_if, dev->conn_id,
+                                       robot_handle_table[ROBOT_IDX_RX_VAL],
+                                       len, (uint8_t *)data, false) == ESP_OK ? 0 : -1;
+}
+
+int ble_host_notify_prio(device_conn_t *dev, const uint8_t *data, size_t len) {
+    return esp_ble_gatts_send_indicate(robot_gatts_if, dev->conn_id,
+                                       robot_handle_table[ROBOT_IDX_PRIO_VAL],
+                                       len, (uint8_t *)data, false) == ESP_OK ? 0 : -1;
+}
+
+int ble_host_notify_metrics(device_conn_t *dev, const uint8_t *data, size_t len) {
+    return esp_ble_gatts_send_indicate(robot_gatts_if, dev->conn_id,
+                                       robot_handle_table[ROBOT_IDX_MET_VAL],
+                                       len, (uint8_t *)data, false) == ESP_OK ? 0 : -1;
+}
+
+// Read (or read blob) of the metrics value: the latest METRICS_SYS frame
+static void metrics_read_rsp(esp_gatt_if_t gatts_if, const esp_ble_gatts_cb_param_t *param) {
+    static esp_gatt_rsp_t rsp;                          // Too big for the BTC task's stack
+    size_t len;
+    const uint8_t *snap = ble_metrics_last(&len);
+    uint16_t off = param->read.is_long ? param->read.offset : 0;
+    memset(&rsp, 0, sizeof(rsp));
+    rsp.attr_value.handle = param->read.handle;
+    rsp.attr_value.offset = off;
+    if (off < len) {
+        rsp.attr_value.len = (uint16_t)(len - off);
+        memcpy(rsp.attr_value.value, snap + off, rsp.attr_value.len);
+    }
+    esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id,
+                                off <= len ? ESP_GATT_OK : ESP_GATT_INVALID_OFFSET, &rsp);
+}
+
+void ble_host_set_name(const char *name) {
+    esp_ble_gap_set_device_name(name);
+}
+
+static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+    switch (event) {
+        case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
+            adv_restart();
+            break;
+
+        case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+            if (param->adv_start_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+                ESP_LOGE(BLE_TAG, "Advertising start failed");
+            } else {
+                ESP_LOGI(BLE_TAG, "Advertising start successfully");
+            }
+            break;
+
+        case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT:
+            if (param->adv_stop_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+                ESP_LOGE(BLE_TAG, "Advertising stop failed");
+            } else {
+                ESP_LOGI(BLE_TAG, "Advertising stopped successfully");
+            }
+            adv_mode = ADV_NONE;
+            if (adv_next != ADV_NONE) {                 // Next step, if a slot is still free
+                adv_mode_t next = adv_next;
+                adv_next = ADV_NONE;
+                if (num_connected < MAX_DEVICES) adv_start(next);
+            }
+            break;
+
+        case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+            ESP_LOGI(BLE_TAG,
+                     "Conn params updated: status=%d, int=%d, latency=%d, timeout=%d",
+                     param->update_conn_params.status,
+                     param->update_conn_params.conn_int,
+                     param->update_conn_params.latency,
+                     param->update_conn_params.timeout);
+            if (param->update_conn_params.status == ESP_BT_STATUS_SUCCESS) {
+                device_conn_t *dev = ble_conn_find_bda(param->update_conn_params.bda);
+                if (dev) {
+                    dev->conn_int = param->update_conn_params.conn_int;
+                    ble_log_link(dev);
+                }
+            }
+            break;
+
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+        case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT:
+            if (param->phy_update.status == ESP_BT_STATUS_SUCCESS) {
+                device_conn_t *dev = ble_conn_find_bda(param->phy_update.bda);
+                if (dev) {
+                    dev->phy = (param->phy_update.tx_phy == ESP_BLE_GAP_PHY_2M) ? 2 : 1;
+                    ble_log_link(dev);
+                }
+            }
+            break;
+#endif
+
+        default:
+            break;
+    }
+}
+
+static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+    switch (event) {
+        case ESP_GATTS_REG_EVT:
+        {
+            robot_gatts_if = gatts_if;
+            esp_ble_gap_set_device_name(DEVICE_NAME);
+            esp_ble_gap_config_adv_data(&adv_data);
+            esp_ble_gatts_create_attr_tab(gatt_db, gatts_if, ROBOT_IDX_NB, SVC_INST_ID);
+            break;
+        }
+        case ESP_GATTS_CREAT_ATTR_TAB_EVT:
+        {
+            if (param->add_attr_tab.status == ESP_GATT_OK) {
+                memcpy(robot_handle_table, param->add_attr_tab.handles, sizeof(robot_handle_table));
+                esp_ble_gatts_start_service(robot_handle_table[ROBOT_IDX_SVC]);
+            }
+            break;
+        }
+
+        case ESP_GATTS_CONNECT_EVT:
+        {
+            ESP_LOGI(BLE_TAG, "Device connected, conn_id=%d", param->connect.conn_id);
+
+            device_conn_t *dev = ble_conn_open(param->connect.conn_id, param->connect.remote_bda,
+                                               param->connect.conn_params.interval);
+            if (!dev) {
+                esp_ble_gap_disconnect(param->connect.remote_bda);
+                break;
+            }
+
+            esp_ble_gap_set_pkt_data_len(param->connect.remote_bda, 251);
+            request_link_params(dev);
+            ble_gs_remember(param->connect.remote_bda, (uint8_t)param->connect.ble_addr_type);
+
+            esp_timer_stop(adv_timer);                 // The connection ended the running step
+            adv_mode = ADV_NONE;
+            adv_next = ADV_NONE;
+            if (num_connected < MAX_DEVICES) {
+                ESP_LOGI(BLE_TAG, "Slot %d/%d used, restarting advertising", num_connected, MAX_DEVICES);
+                adv_start(ADV_NORMAL);
+            } else {
+                ESP_LOGI(BLE_TAG, "All %d slots full, stopping advertising", MAX_DEVICES);
+            }
+            break;
+        }
+
+        case ESP_GATTS_DISCONNECT_EVT:
+        {
+            ESP_LOGI(BLE_TAG, "Device disconnected, conn_id=%d", param->disconnect.conn_id);
+            ble_conn_close(ble_conn_find(param->disconnect.conn_id));
+            adv_restart();                             // Most likely our GS, coming straight back
+            break;
+        }
+
+        case ESP_GATTS_MTU_EVT:
+        {
+            device_conn_t *dev = ble_conn_find(param->mtu.conn_id);
+            if (dev) {
+                dev->mtu = param->mtu.mtu;
+                ble_log_link(dev);
+            }
+            break;
+        }
+
+        // Congestion event — BLE TX queue full/clear feedback from stack
+        case ESP_GATTS_CONGEST_EVT:
+        {
+            device_conn_t *dev = ble_conn_find(param->congest.conn_id);
+            ESP_LOGW(BLE_TAG, "BLE congestion: %s (conn_id=%d, queued %d)",
+                     param->congest.congested ? "CONGESTED" : "CLEAR", param->congest.conn_id,
+                     dev ? txq_depth(&dev->txq) + txq_depth(&dev->prio_txq) : 0);
+            ble_conn_congest(dev, param->congest.congested);
+            break;
+        }
+
+        case ESP_GATTS_READ_EVT:
+        {
+            if (param->read.need_rsp && param->read.handle == robot_handle_table[ROBOT_IDX_MET_VAL]) {
+                metrics_read_rsp(gatts_if, param);
+            }
+            break;
+        }
+
+        case ESP_GATTS_WRITE_EVT:
+        {
+            if (!param->write.is_prep) {
+                device_conn_t *dev = ble_conn_find(param->write.conn_id);
+
+                if (param->write.handle == robot_handle_table[ROBOT_IDX_CFG]) {
+                    uint16_t descr_value =
+                        param->write.value[1] << 8 |
+                        param->write.value[0];
+
+                    if (descr_value == 0x0001) {
+                        ESP_LOGI(BLE_TAG, "Notifications ENABLED (conn_id=%d)", param->write.conn_id);
+                        if (dev) dev->notify_enabled = true;
+                    } else if (descr_value == 0x0000) {
+                        ESP_LOGI(BLE_TAG, "Notifications DISABLED (conn_id=%d)", param->write.conn_id);
+                        if (dev) dev->notify_enabled = false;
+                    }
+                } else if (param->write.handle == robot_handle_table[ROBOT_IDX_MET_CFG] && param->write.len == 2) {
+                    bool on = (param->write.value[0] & 0x01) != 0;
+                    ESP_LOGI(BLE_TAG, "Metrics %s (conn_id=%d)", on ? "ENABLED" : "DISABLED", param->write.conn_id);
+                    if (dev) dev->metrics_notify = on;
+                } else if (param->write.handle == robot_handle_table[ROBOT_IDX_PRIO_CFG] && param->write.len == 2) {
+                    bool on = (param->write.value[0] & 0x01) != 0;
+                    ESP_LOGI(BLE_TAG, "Priority notifications %s (conn_id=%d)", on ? "ENABLED" : "DISABLED", param->write.conn_id);
+                    if (dev) dev->prio_notify = on;
+                } else if (param->write.handle == robot_handle_table[ROBOT_IDX_VAL]) {
+                    if (!dev) {
+                        ESP_LOGE(BLE_TAG, "Write from unknown conn_id=%d", param->write.conn_id);
+                        break;
+                    }
+                    ble_rx_write(dev, param->write.value, param->write.len);
+                }
+
+                if (param->write.need_rsp) {
+                    esp_ble_gatts_send_response(
+                        gatts_if,
+                        param->write.conn_id,
+                        param->write.trans_id,
+                        ESP_GATT_OK,
+                        NULL);
+                }
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void ble_host_start(void) {
+    esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_bt_controller_init(&bt_cfg));
+    ESP_ERROR_CHECK(esp_bt_controller_enable(ESP_BT_MODE_BLE));
+
+    ESP_LOGI(BLE_TAG, "%s init bluetooth", __func__);
+
+    ESP_ERROR_CHECK(esp_bluedroid_init());
+    ESP_ERROR_CHECK(esp_bluedroid_enable());
+
+    const esp_timer_create_args_t adv_args = { .callback = adv_timer_cb, .name = "ble_adv" };
+    ESP_ERROR_CHECK(esp_timer_create(&adv_args, &adv_timer));
+
+    esp_ble_gatt_set_local_mtu(512);
+
+    esp_ble_gatts_register_callback(gatts_event_handler);
+    esp_ble_gap_register_callback(gap_event_handler);
+    esp_ble_gatts_app_register(ESP_ROBOT_APP_ID);
+}
+
+#endif
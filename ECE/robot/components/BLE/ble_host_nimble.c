@@ -0,0 +1,460 @@
+#include "sdkconfig.h"
+#if CONFIG_BT_NIMBLE_ENABLED
+
+#include "ble_host.h"
+#include "ble_metrics.h"
+#include "nimble/nimble_port.h"
+#include "nimble/nimble_port_freertos.h"
+#include "host/ble_hs.h"
+#include "host/util/util.h"
+#include "services/gap/ble_svc_gap.h"
+#include "services/gatt/ble_svc_gatt.h"
+
+// NimBLE glue for the same robot service (0x00FF: 0xFF01 write, 0xFF02
+// notify, 0xFF03 metrics, 0xFF04 priority notify). Writes reach robot_access() on the NimBLE host task with no BTC
+// hop in between, and the whole host is a fraction of Bluedroid's RAM
+// (robot_ble_init logs what each one took). Congestion has no event here:
+// a notify that finds no mbuf marks the link congested, and the next
+// BLE_GAP_EVENT_NOTIFY_TX, when the controller has taken one, clears it.
+//
+// A central may also open the L2CAP data channel (ROBOT_L2CAP_PSM,
+// cmd_codec.h): SDUs in go to the same framer as writes, and while it is
+// open every notify for that link goes out as an SDU instead, paced by
+// the channel's credits (a stalled send marks the link congested until
+// BLE_L2CAP_EVENT_COC_TX_UNSTALLED).
+
+const char ble_host_name[] = "NimBLE";
+
+static uint16_t rx_val_handle;           // 0xFF02 value, filled in by ble_gatts_add_svcs()
+static uint16_t metrics_val_handle;      // ROBOT_METRICS_UUID value
+static uint16_t prio_val_handle;         // ROBOT_PRIO_UUID value
+static uint8_t  own_addr_type;
+
+#define ROBOT_COC (CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM > 0)
+
+static int robot_access(uint16_t conn_handle, uint16_t attr_handle,
+                        struct ble_gatt_access_ctxt *ctxt, void *arg);
+static int gap_event(struct ble_gap_event *event, void *arg);
+
+static const struct ble_gatt_svc_def robot_svcs[] = {
+    {
+        .type = BLE_GATT_SVC_TYPE_PRIMARY,
+        .uuid = BLE_UUID16_DECLARE(0x00FF),
+        .characteristics = (struct ble_gatt_chr_def[]) {
+            {
+                // TX (0xFF01) — central writes commands to robot
+                .uuid = BLE_UUID16_DECLARE(0xFF01),
+                .access_cb = robot_access,
+                .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP,
+            },
+            {
+                // RX (0xFF02) — robot notifies central; NimBLE adds the CCCD
+                .uuid = BLE_UUID16_DECLARE(0xFF02),
+                .access_cb = robot_access,
+                .flags = BLE_GATT_CHR_F_NOTIFY,
+                .val_handle = &rx_val_handle,
+            },
+            {
+                // Metrics (0xFF03) — runtime snapshots, read or notified (ble_metrics.h)
+                .uuid = BLE_UUID16_DECLARE(ROBOT_METRICS_UUID),
+                .access_cb = robot_access,
+                .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
+                .val_handle = &metrics_val_handle,
+            },
+            {
+                // Priority (0xFF04) — ACK / HPR ahead of telemetry (cmd_codec.h)
+                .uuid = BLE_UUID16_DECLARE(ROBOT_PRIO_UUID),
+                .access_cb = robot_access,
+                .flags = BLE_GATT_CHR_F_NOTIFY,
+                .val_handle = &prio_val_handle,
+            },
+            { 0 },
+        },
+    },
+    { 0 },
+};
+
+// ble_addr_t keeps the address least significant byte first
+static void addr_get(const ble_addr_t *a, uint8_t *bda) {
+    for (int i = 0; i < BLE_ADDR_LEN; i++) bda[i] = a->val[BLE_ADDR_LEN - 1 - i];
+}
+
+static void addr_put(const uint8_t *bda, uint8_t type, ble_addr_t *a) {
+    a->type = type;
+    for (int i = 0; i < BLE_ADDR_LEN; i++) a->val[i] = bda[BLE_ADDR_LEN - 1 - i];
+}
+
+// The mbuf chain goes to the framer segment by segment, without a flat copy
+static int robot_access(uint16_t conn_handle, uint16_t attr_handle,
+                        struct ble_gatt_access_ctxt *ctxt, void *arg) {
+    (void)arg;
+    if (ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR && attr_handle == metrics_val_handle) {
+        size_t len;
+        const uint8_t *snap = ble_metrics_last(&len);
+        return os_mbuf_append(ctxt->om, snap, len) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) return BLE_ATT_ERR_UNLIKELY;
+
+    device_conn_t *dev = ble_conn_find(conn_handle);
+    if (!dev) {
+        ESP_LOGE(BLE_TAG, "Write from unknown conn_id=%d", conn_handle);
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+    for (const struct os_mbuf *om = ctxt->om; om; om = SLIST_NEXT(om, om_next)) {
+        ble_rx_write(dev, om->om_data, om->om_len);
+    }
+    return 0;
+}
+
+#if ROBOT_COC
+// An ESTALLED SDU is the channel's now and goes out with the next credits
+static int coc_send(device_conn_t *dev, struct os_mbuf *om) {
+    int rc = ble_l2cap_send((struct ble_l2cap_chan *)dev->coc, om);
+    if (rc == 0) return 0;
+    ble_conn_congest(dev, true);
+    if (rc == BLE_HS_ESTALLED) return 0;
+    os_mbuf_free_chain(om);
+    return -1;
+}
+
+// Room for the next SDU; the previous buffer went up with its data event
+static void coc_recv_ready(struct ble_l2cap_chan *chan) {
+    struct os_mbuf *sdu = os_msys_get_pkthdr(ROBOT_L2CAP_MTU, 0);
+    if (!sdu || ble_l2cap_recv_ready(chan, sdu) != 0) {
+        ESP_LOGE(BLE_TAG, "L2CAP: no SDU buffer, closing the channel");
+        if (sdu) os_mbuf_free_chain(sdu);
+        ble_l2cap_disconnect(chan);
+    }
+}
+
+static int l2cap_event(struct ble_l2cap_event *event, void *arg) {
+    (void)arg;
+    struct ble_l2cap_chan_info info;
+
+    switch (event->type) {
+        case BLE_L2CAP_EVENT_COC_ACCEPT:
+            coc_recv_ready(event->accept.chan);
+            return 0;
+
+        case BLE_L2CAP_EVENT_COC_CONNECTED:
+        {
+            device_conn_t *dev = ble_conn_find(event->connect.conn_handle);
+            if (event->connect.status != 0 || !dev) return 0;
+            ble_l2cap_get_chan_info(event->connect.chan, &info);
+            dev->coc = event->connect.chan;
+            dev->coc_mtu = info.peer_coc_mtu;
+            ESP_LOGI(BLE_TAG, "L2CAP channel open (conn_id=%d, SDU %d/%d)",
+                     dev->conn_id, info.our_coc_mtu, info.peer_coc_mtu);
+            return 0;
+        }
+
+        case BLE_L2CAP_EVENT_COC_DISCONNECTED:
+        {
+            device_conn_t *dev = ble_conn_find(event->disconnect.conn_handle);
+            if (dev && dev->coc == event->disconnect.chan) {
+                dev->coc = NULL;
+                ble_conn_congest(dev, false);          // Back to notifications
+                ESP_LOGI(BLE_TAG, "L2CAP channel closed (conn_id=%d)", dev->conn_id);
+            }
+            return 0;
+        }
+
+        case BLE_L2CAP_EVENT_COC_DATA_RECEIVED:
+        {
+            device_conn_t *dev = ble_conn_find(event->receive.conn_handle);
+            struct os_mbuf *sdu = event->receive.sdu_rx;
+            for (const struct os_mbuf *om = sdu; dev && om; om = SLIST_NEXT(om, om_next)) {
+                ble_rx_write(dev, om->om_data, om->om_len);
+            }
+            os_mbuf_free_chain(sdu);
+            coc_recv_ready(event->receive.chan);
+            return 0;
+        }
+
+        case BLE_L2CAP_EVENT_COC_TX_UNSTALLED:
+            ble_conn_congest(ble_conn_find(event->tx_unstalled.conn_handle), false);
+            return 0;
+
+        default:
+            return 0;
+    }
+}
+#endif
+
+static int notify_on(device_conn_t *dev, uint16_t val_handle, const uint8_t *data, size_t len) {
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(data, len);
+#if ROBOT_COC
+    if (dev->coc) {
+        if (!om) {
+            ble_conn_congest(dev, true);
+            return -1;
+        }
+        return coc_send(dev, om);
+    }
+#endif
+    int rc = om ? ble_gatts_notify_custom(dev->conn_id, val_handle, om) : BLE_HS_ENOMEM;   // Takes om
+    if (rc == BLE_HS_ENOMEM) ble_conn_congest(dev, true);
+    return rc == 0 ? 0 : -1;
+}
+
+int ble_host_notify(device_conn_t *dev, const uint8_t *data, size_t len) {
+    return notify_on(dev, rx_val_handle, data, len);
+}
+
+// The channel, when open, carries the priority lane too: Robot_BLE.c drains
+// it first
+int ble_host_notify_prio(device_conn_t *dev, const uint8_t *data, size_t len) {
+    return notify_on(dev, prio_val_handle, data, len);
+}
+
+// Best effort: without an mbuf the snapshot is dropped, and the link is not
+// marked congested for it
+int ble_host_notify_metrics(device_conn_t *dev, const uint8_t *data, size_t len) {
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(data, len);
+    return om && ble_gatts_notify_custom(dev->conn_id, metrics_val_handle, om) == 0 ? 0 : -1;
+}
+
+static void adv_fields_set(void) {
+    struct ble_hs_adv_fields f = {0};
+    const char *name = ble_svc_gap_device_name();
+    f.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
+    f.name = (const uint8_t *)name;
+    f.name_len = strlen(name);
+    f.name_is_complete = 1;
+    f.tx_pwr_lvl_is_present = 1;
+    f.tx_pwr_lvl = BLE_HS_ADV_TX_PWR_LVL_AUTO;
+    f.uuids16 = (ble_uuid16_t[]){ BLE_UUID16_INIT(0x00FF) };
+    f.num_uuids16 = 1;
+    f.uuids16_is_complete = 1;
+    int rc = ble_gap_adv_set_fields(&f);
+    if (rc) ESP_LOGE(BLE_TAG, "Advertising data rejected (%d)", rc);
+}
+
+void ble_host_set_name(const char *name) {
+    ble_svc_gap_device_name_set(name);
+    adv_fields_set();
+}
+
+// -------------------------------------------------------------------------
+// Advertising
+// Same sequence as the Bluedroid build: directed burst at the last GS, fast
+// undirected for BLE_ADV_FAST_MS, then 20-40 ms. NimBLE times each step
+// itself (the duration argument) and reports the end as
+// BLE_GAP_EVENT_ADV_COMPLETE, so there is no timer and no stop round trip.
+// -------------------------------------------------------------------------
+typedef enum { ADV_NONE = -1, ADV_DIRECT, ADV_FAST, ADV_NORMAL } adv_mode_t;
+
+static adv_mode_t adv_mode = ADV_NONE;   // Host task only
+
+static void adv_start(adv_mode_t mode) {
+    struct ble_gap_adv_params p = {0};
+    ble_addr_t peer;
+    uint8_t bda[BLE_ADDR_LEN], type;
+    int32_t ms = BLE_HS_FOREVER;
+
+    if (mode == ADV_DIRECT && !ble_gs_addr(bda, &type)) mode = ADV_FAST;
+    if (mode == ADV_DIRECT) {
+        addr_put(bda, type, &peer);
+        p.conn_mode = BLE_GAP_CONN_MODE_DIR;
+        p.high_duty_cycle = 1;
+        ms = BLE_ADV_DIRECT_MS;
+    } else {
+        p.conn_mode = BLE_GAP_CONN_MODE_UND;
+        p.disc_mode = BLE_GAP_DISC_MODE_GEN;
+        p.itvl_min = mode == ADV_FAST ? BLE_ADV_FAST_INT : 0x20;
+        p.itvl_max = mode == ADV_FAST ? BLE_ADV_FAST_INT : 0x40;
+        if (mode == ADV_FAST) ms = BLE_ADV_FAST_MS;
+    }
+    if (ble_gap_adv_active()) ble_gap_adv_stop();       // Synchronous here
+    adv_mode = mode;
+    int rc = ble_gap_adv_start(own_addr_type, mode == ADV_DIRECT ? &peer : NULL, ms, &p, gap_event, NULL);
+    if (rc) {
+        ESP_LOGE(BLE_TAG, "Advertising start failed (%d)", rc);
+        adv_mode = ADV_NONE;
+    } else {
+        ESP_LOGI(BLE_TAG, "Advertising start successfully");
+    }
+}
+
+// A free slot again: burst, then fast, then normal
+static void adv_restart(void) {
+    adv_start(ADV_DIRECT);
+}
+
+// Ask the central for the tuning profile; it may pick anything in range
+static void request_link_params(device_conn_t *dev) {
+    struct ble_gap_upd_params p = {
+        .itvl_min = BLE_CONN_INT_MIN,
+        .itvl_max = BLE_CONN_INT_MAX,
+        .latency = BLE_CONN_LATENCY,
+        .supervision_timeout = BLE_CONN_TIMEOUT,
+    };
+    ble_gap_update_params(dev->conn_id, &p);
+    ble_gap_set_data_len(dev->conn_id, 251, 2120);
+#if CONFIG_BT_NIMBLE_50_FEATURE_SUPPORT
+    ble_gap_set_prefered_le_phy(dev->conn_id, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK,
+                                BLE_GAP_LE_PHY_CODED_ANY);
+#endif
+}
+
+static int gap_event(struct ble_gap_event *event, void *arg)
+{
+    (void)arg;
+    struct ble_gap_conn_desc desc;
+
+    switch (event->type) {
+        case BLE_GAP_EVENT_CONNECT:
+        {
+            if (event->connect.status != 0) {          // Directed burst ran out, or a failed attempt
+                adv_mode_t next = adv_mode == ADV_DIRECT ? ADV_FAST : ADV_NORMAL;
+                adv_mode = ADV_NONE;
+                if (num_connected < MAX_DEVICES) adv_start(next);
+                break;
+            }
+            uint16_t handle = event->connect.conn_handle;
+            ESP_LOGI(BLE_TAG, "Device connected, conn_id=%d", handle);
+            if (ble_gap_conn_find(handle, &desc) != 0) break;
+
+            uint8_t bda[BLE_ADDR_LEN];
+            addr_get(&desc.peer_ota_addr, bda);
+            device_conn_t *dev = ble_conn_open(handle, bda, desc.conn_itvl);
+            if (!dev) {
+                ble_gap_terminate(handle, BLE_ERR_REM_USER_CONN_TERM);
+                break;
+            }
+            request_link_params(dev);
+            ble_gs_remember(bda, desc.peer_ota_addr.type);
+
+            adv_mode = ADV_NONE;                       // The connection ended the running step
+            if (num_connected < MAX_DEVICES) {
+                ESP_LOGI(BLE_TAG, "Slot %d/%d used, restarting advertising", num_connected, MAX_DEVICES);
+                adv_start(ADV_NORMAL);
+            } else {
+                ESP_LOGI(BLE_TAG, "All %d slots full, stopping advertising", MAX_DEVICES);
+            }
+            break;
+        }
+
+        case BLE_GAP_EVENT_DISCONNECT:
+            ESP_LOGI(BLE_TAG, "Device disconnected, conn_id=%d", event->disconnect.conn.conn_handle);
+            ble_conn_close(ble_conn_find(event->disconnect.conn.conn_handle));
+            adv_restart();                             // Most likely our GS, coming straight back
+            break;
+
+        case BLE_GAP_EVENT_ADV_COMPLETE:
+            if (event->adv_complete.reason == BLE_HS_ETIMEOUT) {
+                adv_mode_t next = adv_mode == ADV_DIRECT ? ADV_FAST : ADV_NORMAL;
+                adv_mode = ADV_NONE;
+                if (num_connected < MAX_DEVICES) adv_start(next);
+            }
+            break;
+
+        case BLE_GAP_EVENT_CONN_UPDATE:
+            ESP_LOGI(BLE_TAG, "Conn params updated: status=%d", event->conn_update.status);
+            if (event->conn_update.status == 0 &&
+                ble_gap_conn_find(event->conn_update.conn_handle, &desc) == 0) {
+                device_conn_t *dev = ble_conn_find(event->conn_update.conn_handle);
+                if (dev) {
+                    dev->conn_int = desc.conn_itvl;
+                    ble_log_link(dev);
+                }
+            }
+            break;
+
+#if CONFIG_BT_NIMBLE_50_FEATURE_SUPPORT
+        case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+            if (event->phy_updated.status == 0) {
+                device_conn_t *dev = ble_conn_find(event->phy_updated.conn_handle);
+                if (dev) {
+                    dev->phy = event->phy_updated.tx_phy == BLE_GAP_LE_PHY_2M ? 2 : 1;
+                    ble_log_link(dev);
+                }
+            }
+            break;
+#endif
+
+        case BLE_GAP_EVENT_MTU:
+        {
+            device_conn_t *dev = ble_conn_find(event->mtu.conn_handle);
+            if (dev) {
+                dev->mtu = event->mtu.value;
+                ble_log_link(dev);
+            }
+            break;
+        }
+
+        case BLE_GAP_EVENT_SUBSCRIBE:
+            if (event->subscribe.attr_handle == rx_val_handle) {
+                device_conn_t *dev = ble_conn_find(event->subscribe.conn_handle);
+                ESP_LOGI(BLE_TAG, "Notifications %s (conn_id=%d)",
+                         event->subscribe.cur_notify ? "ENABLED" : "DISABLED", event->subscribe.conn_handle);
+                if (dev) dev->notify_enabled = event->subscribe.cur_notify;
+            } else if (event->subscribe.attr_handle == metrics_val_handle) {
+                device_conn_t *dev = ble_conn_find(event->subscribe.conn_handle);
+                ESP_LOGI(BLE_TAG, "Metrics %s (conn_id=%d)",
+                         event->subscribe.cur_notify ? "ENABLED" : "DISABLED", event->subscribe.conn_handle);
+                if (dev) dev->metrics_notify = event->subscribe.cur_notify;
+            } else if (event->subscribe.attr_handle == prio_val_handle) {
+                device_conn_t *dev = ble_conn_find(event->subscribe.conn_handle);
+                ESP_LOGI(BLE_TAG, "Priority notifications %s (conn_id=%d)",
+                         event->subscribe.cur_notify ? "ENABLED" : "DISABLED", event->subscribe.conn_handle);
+                if (dev) dev->prio_notify = event->subscribe.cur_notify;
+            }
+            break;
+
+        // An mbuf is back in the pool, which every link shares
+        case BLE_GAP_EVENT_NOTIFY_TX:
+            for (int i = 0; i < MAX_DEVICES; i++) {
+                device_conn_t *dev = &connected_devices[i];
+                if (dev->conn_id != CONN_ID_INVALID && dev->congested) ble_conn_congest(dev, false);
+            }
+            break;
+
+        default:
+            break;
+    }
+    return 0;
+}
+
+static void on_sync(void) {
+    ble_hs_util_ensure_addr(0);
+    ble_hs_id_infer_auto(0, &own_addr_type);
+    adv_fields_set();
+    adv_restart();
+}
+
+static void on_reset(int reason) {
+    ESP_LOGE(BLE_TAG, "NimBLE host reset (%d)", reason);
+}
+
+static void host_task(void *param) {
+    (void)param;
+    nimble_port_run();                                 // Returns only on nimble_port_stop()
+    nimble_port_freertos_deinit();
+}
+
+void ble_host_start(void) {
+    ESP_LOGI(BLE_TAG, "%s init bluetooth", __func__);
+    ESP_ERROR_CHECK(nimble_port_init());               // Controller included
+
+    ble_hs_cfg.sync_cb = on_sync;
+    ble_hs_cfg.reset_cb = on_reset;
+
+    ble_svc_gap_init();
+    ble_svc_gatt_init();
+    if (ble_gatts_count_cfg(robot_svcs) != 0 || ble_gatts_add_svcs(robot_svcs) != 0) {
+        ESP_LOGE(BLE_TAG, "Robot service registration failed");
+        return;
+    }
+    ble_svc_gap_device_name_set(DEVICE_NAME);
+    ble_att_set_preferred_mtu(512);
+#if ROBOT_COC
+    if (ble_l2cap_create_server(ROBOT_L2CAP_PSM, ROBOT_L2CAP_MTU, l2cap_event, NULL) != 0) {
+        ESP_LOGE(BLE_TAG, "L2CAP server on PSM 0x%04x failed, GATT only", ROBOT_L2CAP_PSM);
+    }
+#endif
+
+    nimble_port_freertos_init(host_task);
+}
+
+#endif
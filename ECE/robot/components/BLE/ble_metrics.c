@@ -0,0 +1,114 @@
+#include "ble_metrics.h"
+
+#include <stdatomic.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "ble_host.h"
+#include "ble_rx_pool.h"
+#include "ble_tx_queue.h"
+
+static _Atomic uint32_t ctr[METRIC_COUNT];
+static _Atomic uint16_t dec_hist[METRICS_DEC_BUCKETS];
+static _Atomic uint8_t  lane_now[3];
+static _Atomic uint8_t  rx_peak;           // Since the previous snapshot
+static _Atomic uint32_t congest_n;
+static _Atomic int64_t  congest_since;      // esp_timer us it was raised, 0 = clear
+static _Atomic uint32_t congest_ms;
+static uint16_t         snap_seq;           // rt_stats task only
+static metrics_sys_t    last_sys;
+
+void ble_metrics_count(metric_ctr_t c) {
+    atomic_fetch_add(&ctr[c], 1);
+}
+
+void ble_metrics_decrypt_us(uint32_t us) {
+    atomic_fetch_add(&dec_hist[metrics_dec_bucket(us)], 1);
+}
+
+static void peak(_Atomic uint8_t *p, uint8_t v) {
+    uint8_t cur = atomic_load(p);
+    while (v > cur && !atomic_compare_exchange_weak(p, &cur, v)) {}
+}
+
+void ble_metrics_lanes(int sys, int motion, int obs) {
+    atomic_store(&lane_now[0], (uint8_t)sys);
+    atomic_store(&lane_now[1], (uint8_t)motion);
+    atomic_store(&lane_now[2], (uint8_t)obs);
+    peak(&rx_peak, (uint8_t)ble_rx_pool_used());
+}
+
+void ble_metrics_congest(bool any) {
+    int64_t now = esp_timer_get_time();
+    if (any) {
+        int64_t clear = 0;
+        if (atomic_compare_exchange_strong(&congest_since, &clear, now)) atomic_fetch_add(&congest_n, 1);
+    } else {
+        int64_t since = atomic_exchange(&congest_since, 0);
+        if (since) atomic_fetch_add(&congest_ms, (uint32_t)((now - since) / 1000));
+    }
+}
+
+bool ble_metrics_wanted(void) {
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        if (connected_devices[i].conn_id != CONN_ID_INVALID && connected_devices[i].metrics_notify) return true;
+    }
+    return false;
+}
+
+static void metrics_fill(metrics_sys_t *sys, int n) {
+    txq_stats_t tx;
+    txq_stats(&tx);
+    int64_t since = atomic_load(&congest_since);
+
+    sys->h = (metrics_hdr_t){ METRICS_VERSION, METRICS_SYS, snap_seq };
+    sys->uptime_ms    = (uint32_t)(esp_timer_get_time() / 1000);
+    sys->rx_used      = (uint8_t)ble_rx_pool_used();
+    sys->rx_peak      = atomic_exchange(&rx_peak, sys->rx_used);
+    if (sys->rx_peak < sys->rx_used) sys->rx_peak = sys->rx_used;
+    sys->tx_depth     = (uint8_t)ble_tx_depth();
+    sys->tx_peak      = tx.depth_max;
+    for (int i = 0; i < 3; i++) sys->lane[i] = atomic_load(&lane_now[i]);
+    sys->ntasks       = (uint8_t)n;
+    sys->rx_drops     = atomic_load(&ctr[METRIC_RX_DROP]);
+    sys->tx_drops     = tx.drops;
+    sys->auth_fail    = atomic_load(&ctr[METRIC_AUTH_FAIL]);
+    sys->replay_drops = atomic_load(&ctr[METRIC_REPLAY_DROP]);
+    sys->congest      = atomic_load(&congest_n);
+    sys->congest_ms   = atomic_load(&congest_ms) +
+                        (since ? (uint32_t)((esp_timer_get_time() - since) / 1000) : 0);
+    for (int i = 0; i < METRICS_DEC_BUCKETS; i++) sys->dec_hist[i] = atomic_load(&dec_hist[i]);
+}
+
+// The whole snapshot to one link, or as much as goes before a refusal
+static void metrics_send(device_conn_t *dev, const metrics_sys_t *sys, const metrics_task_t *rows, int n) {
+    int room = dev->mtu - 3;
+    if (dev->congested || room < (int)sizeof(*sys)) return;
+    if (ble_host_notify_metrics(dev, (const uint8_t *)sys, sizeof(*sys)) != 0) return;
+
+    int per = (room - (int)sizeof(metrics_tasks_t)) / (int)sizeof(metrics_task_t);
+    uint8_t frame[sizeof(metrics_tasks_t) + BLE_METRICS_TASKS_MAX * sizeof(metrics_task_t)];
+    for (int first = 0; first < n; first += per) {
+        int k = n - first < per ? n - first : per;
+        metrics_tasks_t hdr = { { METRICS_VERSION, METRICS_TASKS, sys->h.seq }, (uint8_t)first, (uint8_t)k };
+        memcpy(frame, &hdr, sizeof(hdr));
+        memcpy(frame + sizeof(hdr), rows + first, (size_t)k * sizeof(*rows));
+        if (ble_host_notify_metrics(dev, frame, sizeof(hdr) + (size_t)k * sizeof(*rows)) != 0) return;
+    }
+}
+
+void ble_metrics_publish(metrics_sys_t *sys, const metrics_task_t *rows, int n) {
+    if (n > BLE_METRICS_TASKS_MAX) n = BLE_METRICS_TASKS_MAX;
+    snap_seq++;
+    metrics_fill(sys, n);
+    last_sys = *sys;
+
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        device_conn_t *dev = &connected_devices[i];
+        if (dev->conn_id != CONN_ID_INVALID && dev->metrics_notify) metrics_send(dev, sys, rows, n);
+    }
+}
+
+const uint8_t *ble_metrics_last(size_t *len) {
+    *len = sizeof(last_sys);
+    return (const uint8_t *)&last_sys;
+}
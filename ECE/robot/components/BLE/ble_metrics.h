@@ -0,0 +1,46 @@
+#ifndef BLE_METRICS_H
+#define BLE_METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pinout.h"
+
+/*
+ * Runtime metrics characteristic (ROBOT_METRICS_UUID, cmd_codec.h).
+ *
+ * The counters are bumped where things happen (RX drops and congestion in
+ * Robot_BLE.c, replay / auth failures, decrypt times and lane depths in the
+ * executor), lock-free, so any task may count. The rt_stats task fills in
+ * the task table and calls ble_metrics_publish() every BLE_METRICS_MS while
+ * some link is subscribed. Metrics never queue behind reports: a congested
+ * link, or one whose MTU can't take a METRICS_SYS frame, just misses the
+ * snapshot.
+ */
+
+#ifndef BLE_METRICS_MS
+#define BLE_METRICS_MS 1000                 // Snapshot period while subscribed, 0 = off
+#endif
+#ifndef BLE_METRICS_TASKS_MAX
+#define BLE_METRICS_TASKS_MAX 24            // Task rows per snapshot
+#endif
+
+typedef enum {
+    METRIC_RX_DROP = 0,
+    METRIC_AUTH_FAIL,
+    METRIC_REPLAY_DROP,
+    METRIC_COUNT
+} metric_ctr_t;
+
+void ble_metrics_count(metric_ctr_t c);
+void ble_metrics_decrypt_us(uint32_t us);
+void ble_metrics_lanes(int sys, int motion, int obs);
+void ble_metrics_congest(bool any);         // ble_congested after every change
+
+bool ble_metrics_wanted(void);              // Any link subscribed
+// Fills the counter fields of sys; the caller has set the load and heap
+// ones, and rows[0..n) are the task table. Notifies the subscribed links.
+void ble_metrics_publish(metrics_sys_t *sys, const metrics_task_t *rows, int n);
+const uint8_t *ble_metrics_last(size_t *len);   // Latest METRICS_SYS frame, for reads
+
+#endif
@@ -0,0 +1,112 @@
+#include "ble_rx_pool.h"
+
+#include <stdatomic.h>
+#include "freertos/stream_buffer.h"
+#include "esp_log.h"
+#include "task_alloc.h"
+#include "robot_pm.h"
+#include "hot_path.h"
+
+#define RX_POOL_TAG "BLE_RX_POOL"
+#define RX_POOL_ALL ((uint32_t)((1ULL << BLE_RX_POOL_SIZE) - 1))
+
+_Static_assert(BLE_RX_POOL_SIZE <= 32, "free mask is 32 bits");
+
+static ble_rx_pkt_t          rx_pool[BLE_RX_POOL_SIZE];
+static _Atomic uint32_t      rx_free = 0;                 // Bit set = slot free
+static StreamBufferHandle_t  rx_ready = NULL;             // Submitted slot indices, 1 byte each
+static portMUX_TYPE          rx_send_mux = portMUX_INITIALIZER_UNLOCKED;
+static _Atomic bool          rx_wake_sent = false;        // One wake byte in the buffer at most
+static _Atomic int           rx_told = BLE_RX_POOL_SIZE;  // Free slots last advertised
+
+#define RX_POOL_WAKE 0xFF                                 // Not a slot index
+
+bool ble_rx_pool_init(void) {
+    if (rx_ready) return true;
+
+    // Room for every slot index and a wake; wake the reader on each byte
+    rx_ready = STREAM_BUFFER_CREATE(BLE_RX_POOL_SIZE + 1, 1);
+    if (!rx_ready) {
+        ESP_LOGE(RX_POOL_TAG, "Stream buffer creation failed!");
+        return false;
+    }
+    atomic_store(&rx_free, RX_POOL_ALL);
+    return true;
+}
+
+HOT_PATH ble_rx_pkt_t *ble_rx_pool_alloc(void) {
+    uint32_t mask = atomic_load(&rx_free);
+    while (mask) {
+        uint32_t bit = mask & -mask;                         // Lowest free slot
+        if (atomic_compare_exchange_weak(&rx_free, &mask, mask & ~bit)) {
+            ble_rx_pkt_t *pkt = &rx_pool[__builtin_ctz(bit)];
+            pkt->len = 0;
+            pkt->secure = 0;
+            pkt->batch = 0;
+            pkt->compact = 0;
+            pkt->urgent = 0;
+            robot_pm_hold(PM_HOLD_CMD);                  // Full speed until the slot is back
+            return pkt;
+        }
+    }
+    return NULL;
+}
+
+HOT_PATH void ble_rx_pool_free(ble_rx_pkt_t *pkt) {
+    if (!pkt) return;
+    uint32_t bit = 1u << ble_rx_pool_index(pkt);
+    if (!(atomic_fetch_or(&rx_free, bit) & bit)) robot_pm_release(PM_HOLD_CMD);
+}
+
+static HOT_PATH size_t rx_send(uint8_t idx) {
+    taskENTER_CRITICAL(&rx_send_mux);
+    size_t n = xStreamBufferSend(rx_ready, &idx, 1, 0);
+    taskEXIT_CRITICAL(&rx_send_mux);
+    return n;
+}
+
+HOT_PATH bool ble_rx_pool_submit(ble_rx_pkt_t *pkt) {
+    if (rx_send(ble_rx_pool_index(pkt)) != 1) {
+        ble_rx_pool_free(pkt);
+        return false;
+    }
+    return true;
+}
+
+void ble_rx_pool_wake(void) {
+    if (atomic_exchange(&rx_wake_sent, true)) return;
+    if (rx_send(RX_POOL_WAKE) != 1) atomic_store(&rx_wake_sent, false);
+}
+
+HOT_PATH ble_rx_pkt_t *ble_rx_pool_receive(TickType_t wait) {
+    uint8_t idx;
+    if (xStreamBufferReceive(rx_ready, &idx, 1, wait) != 1) return NULL;
+    if (idx == RX_POOL_WAKE) atomic_store(&rx_wake_sent, false);
+    return ble_rx_pool_at(idx);
+}
+
+int ble_rx_pool_used(void) {
+    return BLE_RX_POOL_SIZE - __builtin_popcount(atomic_load(&rx_free));
+}
+
+uint8_t ble_rx_pool_credits(void) {
+    int free = BLE_RX_POOL_SIZE - ble_rx_pool_used();
+    atomic_store(&rx_told, free);
+    return (uint8_t)(free + 1 > CREDIT_MAX ? CREDIT_MAX : free + 1);
+}
+
+bool ble_rx_pool_credit_due(void) {
+    int told = atomic_load(&rx_told);
+    if (told > BLE_RX_CREDIT_LOW) return false;
+    int free = BLE_RX_POOL_SIZE - ble_rx_pool_used();
+    if (free < told + BLE_RX_CREDIT_STEP) return false;
+    return atomic_compare_exchange_strong(&rx_told, &told, free);  // Once per recovery
+}
+
+uint8_t ble_rx_pool_index(const ble_rx_pkt_t *pkt) {
+    return (uint8_t)(pkt - rx_pool);
+}
+
+ble_rx_pkt_t *ble_rx_pool_at(uint8_t idx) {
+    return idx < BLE_RX_POOL_SIZE ? &rx_pool[idx] : NULL;
+}
@@ -0,0 +1,67 @@
+#ifndef BLE_RX_POOL_H
+#define BLE_RX_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "pinout.h"
+
+/*
+ * Fixed pool of receive buffers shared by the GATT callback and the
+ * command tasks. A write is framed straight into a pool slot (the only
+ * copy out of the BLE stack); after that, only the one-byte slot index
+ * moves, through a FreeRTOS stream buffer. The task that executes the
+ * command returns the slot with ble_rx_pool_free().
+ *
+ * Slot ownership: BLE callback (alloc, fill, submit) -> parser (decrypt
+ * into cmd; plain commands are already in place) -> executor (run, free).
+ * The free list is a lock-free bitmask, so any task or ISR may free a slot.
+ * ble_rx_pool_wake() lets a timer cut the reader's wait short; sends to the
+ * stream buffer are serialised, as FreeRTOS asks of a second writer.
+ * Each slot in use holds PM_HOLD_CMD (robot_pm.h), so the CPU runs at full
+ * speed from a write's first fragment until its command has run.
+ */
+
+#define BLE_RX_POOL_SIZE 16                 // <= 32 (one bit per slot)
+
+/*
+ * Credits: the robot advertises its free slots to the GS (health.credits
+ * and ACK range words, cmd_codec.h) and the GS never writes more words
+ * than that. ble_rx_pool_credits() is the field value and remembers it as
+ * told; once an advertisement at or below BLE_RX_CREDIT_LOW has been
+ * followed by BLE_RX_CREDIT_STEP slots coming back, ble_rx_pool_credit_due()
+ * says so once, and the executor sends a health word rather than leave the
+ * GS waiting for the next periodic one.
+ */
+#define BLE_RX_CREDIT_LOW  4
+#define BLE_RX_CREDIT_STEP 4
+
+typedef struct {
+    union {
+        uint8_t           data[PACKET_SIZE];  // Frame as received (8 plain / 156 cipher /
+                                              // a compact seal's body)
+        robot_bt_packet_t cmd;                // Plaintext command over data[0..7]; the
+    };                                        // parser writes it back after decrypting
+    uint16_t len;                             // Bytes framed into data[]
+    uint8_t  secure;                          // Its session was sealed when the frame completed
+    uint8_t  batch;                           // Sealed CIPHER_MARK_BATCH frame: [n][n words]
+    uint8_t  compact;                         // Compact seal (compact_seal.h), batch = SEAL_MARK_BATCH
+    uint8_t  urgent;                          // SEAL_MARK_ESTOP: opened in the callback too
+    uint8_t  conn;                            // connected_devices[] slot it arrived on
+    uint32_t t_rx_us;                         // Arrival, esp_timer low 32 bits (CLOCK_SYNC)
+    uint32_t t_dec_us;                        // TRACE_LAT stamp (trace.h)
+} ble_rx_pkt_t;
+
+bool          ble_rx_pool_init(void);
+ble_rx_pkt_t *ble_rx_pool_alloc(void);                     // NULL if every slot is in use
+void          ble_rx_pool_free(ble_rx_pkt_t *pkt);
+bool          ble_rx_pool_submit(ble_rx_pkt_t *pkt);       // Frees the slot if the ring is full
+ble_rx_pkt_t *ble_rx_pool_receive(TickType_t wait);        // Single reader; NULL on a wake too
+void          ble_rx_pool_wake(void);                      // Any task: end the reader's wait
+uint8_t       ble_rx_pool_index(const ble_rx_pkt_t *pkt);
+int           ble_rx_pool_used(void);                      // Slots not free right now
+uint8_t       ble_rx_pool_credits(void);                   // Free slots + 1, capped at CREDIT_MAX
+bool          ble_rx_pool_credit_due(void);
+ble_rx_pkt_t *ble_rx_pool_at(uint8_t idx);
+
+#endif
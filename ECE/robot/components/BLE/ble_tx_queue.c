@@ -0,0 +1,106 @@
+#include "ble_tx_queue.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+_Static_assert(TXQ_DEPTH <= 8, "used mask is 8 bits");
+
+// Senders run on both cores and in the BTC task; entries are small, so a
+// spinlock around each operation is enough
+static portMUX_TYPE txq_mux = portMUX_INITIALIZER_UNLOCKED;
+static txq_stats_t  txq_counts;
+
+static int txq_find(const txq_t *q, uint8_t cls, uint8_t key) {
+    for (int i = 0; i < TXQ_DEPTH; i++) {
+        if ((q->used & (1u << i)) && q->e[i].cls == cls && q->e[i].key == key) return i;
+    }
+    return -1;
+}
+
+// Oldest entry of the highest class (pop) or oldest periodic entry (evict)
+static int txq_pick(const txq_t *q, bool periodic_only) {
+    int best = -1;
+    for (int i = 0; i < TXQ_DEPTH; i++) {
+        if (!(q->used & (1u << i))) continue;
+        const txq_entry_t *e = &q->e[i];
+        if (periodic_only && e->cls != TXQ_PERIODIC) continue;
+        if (best < 0 || e->cls > q->e[best].cls ||
+            (e->cls == q->e[best].cls && (int32_t)(e->seq - q->e[best].seq) < 0)) best = i;
+    }
+    return best;
+}
+
+bool txq_push(txq_t *q, const uint8_t *data, uint16_t len, txq_class_t cls, uint8_t key) {
+    if (len > TXQ_FRAME_MAX) {
+        taskENTER_CRITICAL(&txq_mux);
+        txq_counts.drops++;
+        taskEXIT_CRITICAL(&txq_mux);
+        return false;
+    }
+
+    bool ok = true;
+    taskENTER_CRITICAL(&txq_mux);
+    int slot = (cls == TXQ_PERIODIC && key != TXQ_KEY_NONE) ? txq_find(q, cls, key) : -1;
+    if (slot >= 0) {
+        txq_counts.replaced++;                              // Keep the seq: same position
+    } else {
+        uint8_t free = (uint8_t)~q->used & (uint8_t)((1u << TXQ_DEPTH) - 1);
+        if (free) {
+            slot = __builtin_ctz(free);
+        } else if (cls != TXQ_PERIODIC && (slot = txq_pick(q, true)) >= 0) {
+            txq_counts.drops++;                             // Evicted a periodic report
+        } else {
+            txq_counts.drops++;
+            ok = false;
+        }
+        if (ok) {
+            q->e[slot].seq = q->seq++;
+            q->used |= 1u << slot;
+        }
+    }
+    if (ok) {
+        memcpy(q->e[slot].data, data, len);
+        q->e[slot].len = len;
+        q->e[slot].cls = (uint8_t)cls;
+        q->e[slot].key = key;
+        uint8_t depth = (uint8_t)__builtin_popcount(q->used);
+        if (depth > txq_counts.depth_max) txq_counts.depth_max = depth;
+    }
+    taskEXIT_CRITICAL(&txq_mux);
+    return ok;
+}
+
+bool txq_pop(txq_t *q, txq_entry_t *out) {
+    taskENTER_CRITICAL(&txq_mux);
+    int slot = txq_pick(q, false);
+    if (slot >= 0) {
+        memcpy(out, &q->e[slot], sizeof(*out));
+        q->used &= ~(1u << slot);
+    }
+    taskEXIT_CRITICAL(&txq_mux);
+    return slot >= 0;
+}
+
+int txq_depth(const txq_t *q) {
+    return __builtin_popcount(q->used);
+}
+
+void txq_clear(txq_t *q) {
+    taskENTER_CRITICAL(&txq_mux);
+    q->used = 0;
+    taskEXIT_CRITICAL(&txq_mux);
+}
+
+void txq_count_drop(void) {
+    taskENTER_CRITICAL(&txq_mux);
+    txq_counts.drops++;
+    taskEXIT_CRITICAL(&txq_mux);
+}
+
+void txq_stats(txq_stats_t *out) {
+    if (!out) return;
+    taskENTER_CRITICAL(&txq_mux);
+    memcpy(out, &txq_counts, sizeof(*out));
+    taskEXIT_CRITICAL(&txq_mux);
+}
@@ -0,0 +1,57 @@
+#ifndef BLE_TX_QUEUE_H
+#define BLE_TX_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Bounded notify queue, two per connection: device_conn_t.txq and, for
+ * ACK / HPR, prio_txq, which drains first (Robot_BLE.c). Notifies go
+ * straight to the stack while the link is clear; while it is congested
+ * they wait here and drain on the ESP_GATTS_CONGEST_EVT clear.
+ *
+ * Entries pop highest class first, FIFO within a class. A periodic report
+ * with a key replaces the queued report with the same key in place (the
+ * fresh sample takes the old one's position). When the queue is full an
+ * urgent or normal entry evicts the oldest periodic one; otherwise the new
+ * entry is dropped. Every eviction or drop counts in txq_stats().
+ */
+
+#define TXQ_DEPTH      8                // Entries per connection (<= 8, bit per slot)
+#define TXQ_FRAME_MAX  160              // CIPHER_FRAME_SIZE; longer notifies are never queued
+#define TXQ_KEY_NONE   0
+
+typedef enum {
+    TXQ_PERIODIC = 0,                   // Telemetry: may be replaced or evicted
+    TXQ_NORMAL,                         // Strings, everything unclassified
+    TXQ_URGENT                          // ACK / HPR
+} txq_class_t;
+
+typedef struct {
+    uint8_t  data[TXQ_FRAME_MAX];
+    uint16_t len;
+    uint8_t  cls;
+    uint8_t  key;
+    uint32_t seq;                       // Push order, FIFO within a class
+} txq_entry_t;
+
+typedef struct {
+    txq_entry_t e[TXQ_DEPTH];
+    uint8_t     used;                   // Bit set = slot holds an entry
+    uint32_t    seq;
+} txq_t;
+
+typedef struct {
+    uint32_t drops;                     // Dropped or evicted, all connections
+    uint32_t replaced;                  // Periodic reports refreshed in place
+    uint8_t  depth_max;                 // High-water mark of any one queue
+} txq_stats_t;
+
+bool txq_push(txq_t *q, const uint8_t *data, uint16_t len, txq_class_t cls, uint8_t key);
+bool txq_pop(txq_t *q, txq_entry_t *out);
+int  txq_depth(const txq_t *q);
+void txq_clear(txq_t *q);               // Connection gone; nothing is counted
+void txq_count_drop(void);              // Popped entry the stack refused
+void txq_stats(txq_stats_t *out);
+
+#endif
@@ -0,0 +1,160 @@
+// aes_gcm_backend.c
+//
+// wolfCrypt (software) and mbedTLS / ESP32 AES peripheral (hardware)
+// implementations of the packet GCM pass, and the wolfCrypt ChaCha20-Poly1305
+// suite.  See aes_gcm_backend.h.
+
+#include "aes_gcm_backend.h"
+
+#include <string.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+
+// -------------------------------------------------------------------------
+// wolfSSL (software)
+// -------------------------------------------------------------------------
+static int wolf_setkey(gcm_ctx_t *c, const uint8_t *key, size_t key_len)
+{
+    if (wc_AesInit(&c->wolf, NULL, INVALID_DEVID) != 0)
+        return -1;
+    if (wc_AesGcmSetKey(&c->wolf, key, (word32)key_len) != 0) {
+        wc_AesFree(&c->wolf);
+        return -1;
+    }
+    return 0;
+}
+
+static int wolf_encrypt(gcm_ctx_t *c, const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                        const uint8_t *in, size_t len, uint8_t *out, uint8_t *tag)
+{
+    int ret = wc_AesGcmEncrypt(&c->wolf, out, in, (word32)len,
+                               nonce, GCM_NONCE_LEN, tag, GCM_TAG_LEN,
+                               aad, (word32)aad_len);
+    return ret == 0 ? 0 : -1;
+}
+
+static int wolf_decrypt(gcm_ctx_t *c, const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                        const uint8_t *in, size_t len, const uint8_t *tag, uint8_t *out)
+{
+    int ret = wc_AesGcmDecrypt(&c->wolf, out, in, (word32)len,
+                               nonce, GCM_NONCE_LEN, tag, GCM_TAG_LEN,
+                               aad, (word32)aad_len);
+    if (ret == AES_GCM_AUTH_E) return -2;
+    return ret == 0 ? 0 : -1;
+}
+
+static void wolf_release(gcm_ctx_t *c)
+{
+    wc_AesFree(&c->wolf);
+}
+
+const gcm_backend_t gcm_backend_wolfssl = {
+    "wolfssl", wolf_setkey, wolf_encrypt, wolf_decrypt, wolf_release
+};
+
+// -------------------------------------------------------------------------
+// mbedTLS GCM (AES block on the ESP32 peripheral)
+// -------------------------------------------------------------------------
+#if AES_GCM_HAVE_HW
+static int hw_setkey(gcm_ctx_t *c, const uint8_t *key, size_t key_len)
+{
+    mbedtls_gcm_init(&c->hw);
+    if (mbedtls_gcm_setkey(&c->hw, MBEDTLS_CIPHER_ID_AES, key, (unsigned int)(key_len * 8)) != 0) {
+        mbedtls_gcm_free(&c->hw);
+        return -1;
+    }
+    return 0;
+}
+
+static int hw_encrypt(gcm_ctx_t *c, const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                      const uint8_t *in, size_t len, uint8_t *out, uint8_t *tag)
+{
+    int ret = mbedtls_gcm_crypt_and_tag(&c->hw, MBEDTLS_GCM_ENCRYPT, len,
+                                        nonce, GCM_NONCE_LEN, aad, aad_len,
+                                        in, out, GCM_TAG_LEN, tag);
+    return ret == 0 ? 0 : -1;
+}
+
+static int hw_decrypt(gcm_ctx_t *c, const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                      const uint8_t *in, size_t len, const uint8_t *tag, uint8_t *out)
+{
+    int ret = mbedtls_gcm_auth_decrypt(&c->hw, len, nonce, GCM_NONCE_LEN, aad, aad_len,
+                                       tag, GCM_TAG_LEN, in, out);
+    if (ret == MBEDTLS_ERR_GCM_AUTH_FAILED) return -2;
+    return ret == 0 ? 0 : -1;
+}
+
+static void hw_release(gcm_ctx_t *c)
+{
+    mbedtls_gcm_free(&c->hw);
+}
+
+const gcm_backend_t gcm_backend_esp_aes = {
+    "esp_aes", hw_setkey, hw_encrypt, hw_decrypt, hw_release
+};
+#endif
+
+// -------------------------------------------------------------------------
+// wolfCrypt ChaCha20-Poly1305 (software; no ESP32 peripheral for it)
+// -------------------------------------------------------------------------
+static int chacha_setkey(gcm_ctx_t *c, const uint8_t *key, size_t key_len)
+{
+    if (key_len != CHACHA20_POLY1305_AEAD_KEYSIZE) return -1;
+    memcpy(c->chacha_key, key, key_len);
+    return 0;
+}
+
+static int chacha_encrypt(gcm_ctx_t *c, const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                          const uint8_t *in, size_t len, uint8_t *out, uint8_t *tag)
+{
+    int ret = wc_ChaCha20Poly1305_Encrypt(c->chacha_key, nonce, aad, (word32)aad_len,
+                                          in, (word32)len, out, tag);
+    return ret == 0 ? 0 : -1;
+}
+
+static int chacha_decrypt(gcm_ctx_t *c, const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                          const uint8_t *in, size_t len, const uint8_t *tag, uint8_t *out)
+{
+    int ret = wc_ChaCha20Poly1305_Decrypt(c->chacha_key, nonce, aad, (word32)aad_len,
+                                          in, (word32)len, tag, out);
+    if (ret == MAC_CMP_FAILED_E) return -2;
+    return ret == 0 ? 0 : -1;
+}
+
+static void chacha_release(gcm_ctx_t *c)
+{
+    memset(c->chacha_key, 0, sizeof(c->chacha_key));
+}
+
+const gcm_backend_t gcm_backend_chacha = {
+    "chacha", chacha_setkey, chacha_encrypt, chacha_decrypt, chacha_release
+};
+
+// -------------------------------------------------------------------------
+// Suite selection
+// -------------------------------------------------------------------------
+static volatile int active_suite = GCM_SUITE_AES;
+
+void gcm_suite_set(int suite)
+{
+    if (suite == GCM_SUITE_AES || suite == GCM_SUITE_CHACHA) active_suite = suite;
+}
+
+int gcm_suite(void)
+{
+    return active_suite;
+}
+
+const gcm_backend_t *gcm_suite_backend(int suite)
+{
+    if (suite == GCM_SUITE_CHACHA) return &gcm_backend_chacha;
+#if AES_GCM_BACKEND_HW
+    return &gcm_backend_esp_aes;
+#else
+    return &gcm_backend_wolfssl;
+#endif
+}
+
+const gcm_backend_t *gcm_backend(void)
+{
+    return gcm_suite_backend(active_suite);
+}
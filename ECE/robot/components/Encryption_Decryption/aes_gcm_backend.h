@@ -0,0 +1,103 @@
+#ifndef AES_GCM_BACKEND_H
+#define AES_GCM_BACKEND_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <wolfssl/wolfcrypt/aes.h>
+#include <wolfssl/wolfcrypt/chacha20_poly1305.h>
+
+/*
+ * AES-256-GCM backend used by aes_gcm_encrypt_packet() / aes_gcm_decrypt_packet().
+ *
+ *   wolfssl  wolfCrypt in software (default)
+ *   esp_aes  mbedTLS GCM on the ESP32 AES peripheral. ESP-IDF routes
+ *            mbedtls_gcm_* to esp_aes_gcm when CONFIG_MBEDTLS_HARDWARE_AES=y
+ *            (already set in the robot sdkconfigs).
+ *
+ * Select the hardware path at build time with -D AES_GCM_BACKEND_HW=1
+ * (platformio.ini build_flags).  Both backends are always compiled on the
+ * target so aes_gcm_bench() can compare them.  Host builds (including the
+ * host firmware build, ROBOT_HOST in ../../host) only get the hardware entry
+ * when built with -D AES_GCM_WITH_MBEDTLS -lmbedcrypto.
+ *
+ * The GS may negotiate ChaCha20-Poly1305 instead (SECURITY_LEVEL specific
+ * SEC_CHACHA20_POLY1305, cmd_codec.h).  Same 12-byte nonce and 16-byte tag,
+ * so the packets keep their layout; wolfCrypt runs it in software (needs
+ * HAVE_CHACHA and HAVE_POLY1305 in user_settings.h).  gcm_suite_set()
+ * switches every later encrypt / decrypt pass.
+ */
+
+#ifndef AES_GCM_BACKEND_HW
+#define AES_GCM_BACKEND_HW 0
+#endif
+
+#if (defined(ESP_PLATFORM) && !defined(ROBOT_HOST)) || defined(AES_GCM_WITH_MBEDTLS)
+#define AES_GCM_HAVE_HW 1
+#include "mbedtls/gcm.h"
+#else
+#define AES_GCM_HAVE_HW 0
+#endif
+
+#if AES_GCM_BACKEND_HW && !AES_GCM_HAVE_HW
+#error "AES_GCM_BACKEND_HW=1 needs mbedTLS (ESP-IDF, or -DAES_GCM_WITH_MBEDTLS on the host)"
+#endif
+
+#define GCM_NONCE_LEN 12
+#define GCM_TAG_LEN   16
+
+#define GCM_SUITE_AES     0
+#define GCM_SUITE_CHACHA  1
+#define GCM_SUITES        2
+
+// Keyed context; large enough for any backend
+typedef union {
+    Aes                 wolf;
+#if AES_GCM_HAVE_HW
+    mbedtls_gcm_context hw;
+#endif
+    uint8_t             chacha_key[CHACHA20_POLY1305_AEAD_KEYSIZE];  // One-shot API: key per call
+} gcm_ctx_t;
+
+typedef struct {
+    const char *name;
+    // 0 on success, -1 on error
+    int  (*setkey)(gcm_ctx_t *c, const uint8_t *key, size_t key_len);
+    // 12-byte nonce, 16-byte tag.  0 on success, -1 on error
+    int  (*encrypt)(gcm_ctx_t *c, const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                    const uint8_t *in, size_t len, uint8_t *out, uint8_t *tag);
+    // 0 on success, -2 on tag mismatch, -1 on other errors
+    int  (*decrypt)(gcm_ctx_t *c, const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                    const uint8_t *in, size_t len, const uint8_t *tag, uint8_t *out);
+    void (*release)(gcm_ctx_t *c);
+} gcm_backend_t;
+
+extern const gcm_backend_t gcm_backend_wolfssl;
+#if AES_GCM_HAVE_HW
+extern const gcm_backend_t gcm_backend_esp_aes;
+#endif
+
+extern const gcm_backend_t gcm_backend_chacha;
+
+// Backend of the current suite: for AES, the one chosen by AES_GCM_BACKEND_HW
+const gcm_backend_t *gcm_backend(void);
+
+// Suite for the encrypt / decrypt passes (GCM_SUITE_AES until changed)
+void gcm_suite_set(int suite);
+int  gcm_suite(void);
+const gcm_backend_t *gcm_suite_backend(int suite);
+
+#ifdef ESP_PLATFORM
+/**
+ * On-target benchmark: encrypt + decrypt `iters` 156-byte packets with each
+ * backend (both AES-GCM paths and ChaCha20-Poly1305) and print CPU cycles
+ * per packet.  Also checks that the two AES-GCM backends interoperate
+ * (hardware-encrypted packets decrypt in software and back).
+ * Run from a task pinned to one core; the cycle counter is per-core.
+ *
+ * @return 0 if every backend round-tripped, -1 otherwise
+ */
+int aes_gcm_bench(int iters);
+#endif
+
+#endif /* AES_GCM_BACKEND_H */
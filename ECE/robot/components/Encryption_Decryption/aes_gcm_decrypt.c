@@ -1,6 +1,6 @@
 // aes_gcm_decrypt.c
 //
-// Provides: aes_gcm_decrypt_packet()
+// Provides: aes_gcm_decrypt_packet(), aes_gcm_decrypt_raw()
 // Optionally compiled as a standalone test binary when AES_GCM_MAIN is defined.
 //
 // ESP-IDF / WolfSSL build notes:
@@ -10,19 +10,25 @@
 //        #define HAVE_AESGCM
 //        #define WOLFSSL_AES_256
 //   3. Add this source file to your CMakeLists.txt component sources.
+//   4. Optional: -D AES_GCM_BACKEND_HW=1 runs the GCM pass on the ESP32 AES
+//      peripheral (mbedTLS) instead of wolfCrypt, see aes_gcm_backend.h.
+//   5. The ChaCha20-Poly1305 suite also needs HAVE_CHACHA and HAVE_POLY1305.
 //
 // Standalone host test (Linux, wolfssl installed):
-//   gcc -DAES_GCM_MAIN aes_gcm_decrypt.c -o aes_gcm_test -lwolfssl
+//   gcc -DAES_GCM_MAIN aes_gcm_decrypt.c aes_key.c aes_gcm_backend.c -o aes_gcm_test -lwolfssl
 
 #include "aes_gcm_decrypt.h"
 
 #include <string.h>
 #include <stdio.h>
+#include "hex_codec.h"
+#include "aes_gcm_backend.h"
+#include "aes_key.h"
+#include "hot_path.h"
 
 // WolfSSL on ESP-IDF: the component exposes headers under "wolfssl/"
 // On a host build with an installed wolfssl package the same paths apply.
 #include <wolfssl/wolfcrypt/aes.h>
-#include <wolfssl/wolfcrypt/error-crypt.h>
 
 // -------------------------------------------------------------------------
 // Packet layout constants
@@ -36,52 +42,83 @@
 #define TAG_LEN       16
 // NONCE_LEN + CT_LEN + TAG_LEN == 156 ✓
 
-// -------------------------------------------------------------------------
-// Hard-coded AES-256 key (must be exactly 32 bytes).
-// Replace with your actual key.
-// -------------------------------------------------------------------------
-// NOTE: This string is 64 hex chars but we use it as raw bytes — it is 64
-// bytes long, not 32.  To get a 32-byte key either:
-//   (a) use a 32-char ASCII secret directly, or
-//   (b) hex-decode a 64-char hex string at runtime.
-// Here we keep byte-for-byte parity with the original file: the string is
-// used as raw bytes and the first 32 are taken as the AES-256 key.
-// If you need a specific key value, replace AES_KEY_STR with your 32-char
-// secret or adjust the hex-decode logic below.
-// Replace the AES_KEY_STR / AES_KEY / AES_KEY_LEN block with this:
-
-#define AES_KEY_HEX "a1b2c3d4e5f6789012345678901234567890abcdef1234567890abcdef123456"
-#define AES_KEY_LEN 32
-
-static uint8_t AES_KEY[AES_KEY_LEN];
-static int aes_key_ready = 0;
-
-static void init_aes_key(void) {
-    if (aes_key_ready) return;
-    const char *h = AES_KEY_HEX;
-    for (int i = 0; i < AES_KEY_LEN; i++) {
-        int hi = (h[2*i]   >= 'a') ? h[2*i]   - 'a' + 10 : h[2*i]   - '0';
-        int lo = (h[2*i+1] >= 'a') ? h[2*i+1] - 'a' + 10 : h[2*i+1] - '0';
-        AES_KEY[i] = (uint8_t)((hi << 4) | lo);
-    }
-    aes_key_ready = 1;
-}
-
 // -------------------------------------------------------------------------
 // Optional AAD.  Set AAD_LEN to 0 if not used.
 // -------------------------------------------------------------------------
 static const uint8_t *AAD     = NULL;
 static const int      AAD_LEN = 0;
 
+// -------------------------------------------------------------------------
+// Cached decrypt context.
+// Key expansion and the GHASH table are built once, by aes_gcm_prepare() at
+// boot (aes_key.h), or on first use if nothing prepared them; again after
+// aes_key_provision().  The context is shared by every task that decrypts, so
+// it is held under a mutex for the duration of one GCM pass.
+// -------------------------------------------------------------------------
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static StaticSemaphore_t dec_lock_buf;
+static SemaphoreHandle_t dec_lock = NULL;
+static portMUX_TYPE      dec_lock_init = portMUX_INITIALIZER_UNLOCKED;
+
+static void dec_ctx_lock(void) {
+    if (!dec_lock) {
+        taskENTER_CRITICAL(&dec_lock_init);
+        if (!dec_lock) dec_lock = xSemaphoreCreateMutexStatic(&dec_lock_buf);
+        taskEXIT_CRITICAL(&dec_lock_init);
+    }
+    xSemaphoreTake(dec_lock, portMAX_DELAY);
+}
+
+static void dec_ctx_unlock(void) {
+    xSemaphoreGive(dec_lock);
+}
+#else
+static void dec_ctx_lock(void)   {}   // Host test build: single-threaded
+static void dec_ctx_unlock(void) {}
+#endif
+
+static gcm_ctx_t dec_ctx[GCM_SUITES];
+static int       dec_ctx_set[GCM_SUITES];
+static uint32_t  dec_ctx_gen[GCM_SUITES];   // aes_key_generation() it was keyed under
+
+// Caller holds the lock
+static int dec_ctx_ready(int suite) {
+    uint32_t gen = aes_key_generation();
+    if (dec_ctx_set[suite] && dec_ctx_gen[suite] == gen) return 0;
+
+    const gcm_backend_t *b = gcm_suite_backend(suite);
+    if (dec_ctx_set[suite]) {
+        b->release(&dec_ctx[suite]);
+        dec_ctx_set[suite] = 0;
+    }
+    if (b->setkey(&dec_ctx[suite], aes_key(), AES_KEY_LEN) != 0) return -1;
+    dec_ctx_set[suite] = 1;
+    dec_ctx_gen[suite] = gen;
+    return 0;
+}
+
 // =========================================================================
 // Public API
 // =========================================================================
 
-int aes_gcm_decrypt_packet(const uint8_t received_packet[PACKET_LEN],
+int aes_gcm_decrypt_prepare(void)
+{
+    int ret = 0;
+    dec_ctx_lock();
+    for (int suite = 0; suite < GCM_SUITES; suite++) {
+        if (dec_ctx_ready(suite) != 0) ret = -1;
+    }
+    dec_ctx_unlock();
+    return ret;
+}
+
+HOT_PATH int aes_gcm_decrypt_packet(const uint8_t received_packet[PACKET_LEN],
                            char         *out_plaintext,
                            size_t       *out_len)
 {
-    init_aes_key();
     if (!received_packet || !out_plaintext || !out_len)
         return -1;
 
@@ -90,57 +127,10 @@ int aes_gcm_decrypt_packet(const uint8_t received_packet[PACKET_LEN],
     const uint8_t *ct    = received_packet + CT_OFFSET;
     const uint8_t *tag   = received_packet + TAG_OFFSET;
 
-    // ------------------------------------------------------------------
-    // Initialise WolfSSL AES context and set key
-    // ------------------------------------------------------------------
-    Aes aes;
-    int wc_ret = wc_AesInit(&aes, NULL, INVALID_DEVID);
-    if (wc_ret != 0)
-        return -1;
-
-    wc_ret = wc_AesGcmSetKey(&aes, AES_KEY, AES_KEY_LEN);
-    if (wc_ret != 0) {
-        wc_AesFree(&aes);
-        return -1;
-    }
+    int ret = aes_gcm_decrypt_raw(nonce, ct, CT_LEN, tag, (uint8_t *)out_plaintext);
 
-    // ------------------------------------------------------------------
-    // Decrypt + verify tag in one call.
-    //
-    // wc_AesGcmDecrypt signature:
-    //   int wc_AesGcmDecrypt(Aes*          aes,
-    //                        byte*         out,        // plaintext output
-    //                        const byte*   in,         // ciphertext input
-    //                        word32        sz,         // ciphertext length
-    //                        const byte*   iv,         // nonce
-    //                        word32        ivSz,       // nonce length
-    //                        const byte*   authTag,    // expected tag
-    //                        word32        authTagSz,  // tag length
-    //                        const byte*   authIn,     // AAD (may be NULL)
-    //                        word32        authInSz);  // AAD length (0 if none)
-    //
-    // Returns 0 on success, AES_GCM_AUTH_E (-180) on authentication failure.
-    // ------------------------------------------------------------------
-    wc_ret = wc_AesGcmDecrypt(
-        &aes,
-        (uint8_t *)out_plaintext,   // plaintext output
-        ct,                          // ciphertext input
-        (word32)CT_LEN,              // ciphertext length
-        nonce,                       // IV / nonce
-        (word32)NONCE_LEN,           // nonce length
-        tag,                         // expected GCM authentication tag
-        (word32)TAG_LEN,             // tag length
-        AAD,                         // additional authenticated data (or NULL)
-        (word32)AAD_LEN              // AAD length (0 if none)
-    );
-
-    wc_AesFree(&aes);
-
-    if (wc_ret == AES_GCM_AUTH_E) {
-        return -2;  // authentication failure — mirrors the OpenSSL behaviour
-    } else if (wc_ret != 0) {
-        return -1;  // other wolfCrypt error
-    }
+    if (ret != 0)
+        return ret;  // -2 = authentication failure, mirrors the OpenSSL behaviour
 
     *out_len = (size_t)CT_LEN;
 
@@ -150,28 +140,40 @@ int aes_gcm_decrypt_packet(const uint8_t received_packet[PACKET_LEN],
     return 0;
 }
 
+HOT_PATH int aes_gcm_decrypt_raw(const uint8_t nonce[NONCE_LEN], const uint8_t *ct, size_t len,
+                        const uint8_t tag[TAG_LEN], uint8_t *out)
+{
+    if (!nonce || !ct || !tag || !out)
+        return -1;
+
+    dec_ctx_lock();
+    int suite = gcm_suite();
+    if (dec_ctx_ready(suite) != 0) {
+        dec_ctx_unlock();
+        return -1;
+    }
+
+    // ------------------------------------------------------------------
+    // Decrypt + verify tag in one pass.
+    // Returns 0 on success, -2 on authentication failure, -1 otherwise.
+    // ------------------------------------------------------------------
+    int ret = gcm_suite_backend(suite)->decrypt(&dec_ctx[suite], nonce, AAD, (size_t)AAD_LEN,
+                                                ct, len, tag, out);
+
+    dec_ctx_unlock();
+    return ret;
+}
+
 // =========================================================================
 // Optional standalone test / demo  (compile with -DAES_GCM_MAIN)
 // =========================================================================
 #ifdef AES_GCM_MAIN
 
-// ---------- tiny hex helpers (only needed for the test harness) ----------
-static int from_hex(char c) {
-    if (c >= '0' && c <= '9') return c - '0';
-    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-    return -1;
-}
-
+// ---------- tiny hex helper (only needed for the test harness) ----------
 static int hex_decode_into(const char *hex, uint8_t *out, size_t expected_len) {
     size_t n = strlen(hex);
     if (n != expected_len * 2) return 0;
-    for (size_t i = 0; i < n; i += 2) {
-        int hi = from_hex(hex[i]), lo = from_hex(hex[i + 1]);
-        if (hi < 0 || lo < 0) return 0;
-        out[i / 2] = (uint8_t)((hi << 4) | lo);
-    }
-    return 1;
+    return hexc_decode(hex, n, out) == (int)expected_len;
 }
 
 int main(int argc, char **argv) {
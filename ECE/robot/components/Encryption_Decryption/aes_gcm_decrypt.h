@@ -26,4 +26,27 @@ int aes_gcm_decrypt_packet(const uint8_t received_packet[156],
                            char         *out_plaintext,
                            size_t       *out_len);
 
+/**
+ * Decrypt a ciphertext of any length under an explicit nonce (compact
+ * sealed frames, compact_seal.h: the nonce is rebuilt from the frame's
+ * sequence and the ciphertext is just the command words).
+ *
+ * @param nonce  12-byte GCM nonce.
+ * @param ct     Ciphertext, len bytes.
+ * @param tag    16-byte GCM tag.
+ * @param out    Caller-allocated buffer of at least len bytes.
+ *
+ * @return  0 on success, -1 on argument / key error, -2 on authentication failure
+ */
+int aes_gcm_decrypt_raw(const uint8_t nonce[12], const uint8_t *ct, size_t len,
+                        const uint8_t tag[16], uint8_t *out);
+
+/**
+ * Key the decrypt context of every suite now (aes_gcm_prepare(), aes_key.h)
+ * rather than on the first packet.
+ *
+ * @return  0 on success, -1 on key setup failure
+ */
+int aes_gcm_decrypt_prepare(void);
+
 #endif /* AES_GCM_DECRYPT_H */
\ No newline at end of file
@@ -11,19 +11,24 @@
 //        #define WOLFSSL_AES_256
 //        #define HAVE_HASHDRBG   // required for wc_RNG_GenerateBlock
 //   3. Add this source file to your CMakeLists.txt component sources.
+//   4. Optional: -D AES_GCM_BACKEND_HW=1 runs the GCM pass on the ESP32 AES
+//      peripheral (mbedTLS) instead of wolfCrypt, see aes_gcm_backend.h.
+//   5. The ChaCha20-Poly1305 suite also needs HAVE_CHACHA and HAVE_POLY1305.
 //
 // Standalone host test (Linux, wolfssl installed):
-//   gcc -DAES_GCM_MAIN aes_gcm_encrypt.c -o aes_gcm_test -lwolfssl
+//   gcc -DAES_GCM_MAIN aes_gcm_encrypt.c aes_key.c aes_gcm_backend.c -o aes_gcm_test -lwolfssl
 
 #include "aes_gcm_encrypt.h"
 
 #include <string.h>
 #include <stdio.h>
+#include "hex_codec.h"
+#include "aes_gcm_backend.h"
+#include "aes_key.h"
+#include "replay_window.h"
 
 // WolfSSL on ESP-IDF: the component exposes headers under "wolfssl/"
 // On a host build with an installed wolfssl package the same paths apply.
-#include <wolfssl/wolfcrypt/aes.h>
-#include <wolfssl/wolfcrypt/error-crypt.h>
 #include <wolfssl/wolfcrypt/random.h>
 
 // -------------------------------------------------------------------------
@@ -38,26 +43,6 @@
 #define TAG_LEN       16
 // NONCE_LEN + CT_LEN + TAG_LEN == 156 ✓
 
-// -------------------------------------------------------------------------
-// Hard-coded AES-256 key — must be identical to the one in aes_gcm_decrypt.c
-// -------------------------------------------------------------------------
-#define AES_KEY_HEX "a1b2c3d4e5f6789012345678901234567890abcdef1234567890abcdef123456"
-#define AES_KEY_LEN 32
-
-static uint8_t AES_KEY[AES_KEY_LEN];
-static int aes_key_ready = 0;
-
-static void init_aes_key(void) {
-    if (aes_key_ready) return;
-    const char *h = AES_KEY_HEX;
-    for (int i = 0; i < AES_KEY_LEN; i++) {
-        int hi = (h[2*i]   >= 'a') ? h[2*i]   - 'a' + 10 : h[2*i]   - '0';
-        int lo = (h[2*i+1] >= 'a') ? h[2*i+1] - 'a' + 10 : h[2*i+1] - '0';
-        AES_KEY[i] = (uint8_t)((hi << 4) | lo);
-    }
-    aes_key_ready = 1;
-}
-
 // -------------------------------------------------------------------------
 // Optional AAD.  Must match the values in aes_gcm_decrypt.c.
 // Set AAD_LEN to 0 if not used.
@@ -65,6 +50,81 @@ static void init_aes_key(void) {
 static const uint8_t *AAD     = NULL;
 static const int      AAD_LEN = 0;
 
+// -------------------------------------------------------------------------
+// Cached encrypt context.
+// Key expansion and the GHASH table are built once, by aes_gcm_prepare() at
+// boot (aes_key.h), or on first use if nothing prepared them; again after
+// aes_key_provision().  The context is shared by every task that encrypts, so
+// it is held under a mutex for the duration of one GCM pass.
+// -------------------------------------------------------------------------
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static StaticSemaphore_t enc_lock_buf;
+static SemaphoreHandle_t enc_lock = NULL;
+static portMUX_TYPE      enc_lock_init = portMUX_INITIALIZER_UNLOCKED;
+
+static void enc_ctx_lock(void) {
+    if (!enc_lock) {
+        taskENTER_CRITICAL(&enc_lock_init);
+        if (!enc_lock) enc_lock = xSemaphoreCreateMutexStatic(&enc_lock_buf);
+        taskEXIT_CRITICAL(&enc_lock_init);
+    }
+    xSemaphoreTake(enc_lock, portMAX_DELAY);
+}
+
+static void enc_ctx_unlock(void) {
+    xSemaphoreGive(enc_lock);
+}
+#else
+static void enc_ctx_lock(void)   {}   // Host test build: single-threaded
+static void enc_ctx_unlock(void) {}
+#endif
+
+static gcm_ctx_t enc_ctx[GCM_SUITES];
+static int       enc_keyed[GCM_SUITES];
+static uint32_t  enc_key_gen[GCM_SUITES];   // aes_key_generation() it was keyed under
+static WC_RNG    enc_rng;               // Seeded once: draws the session salt
+static uint8_t   enc_salt[4];           // Nonce = salt | REPLAY_DIR_ROBOT || sequence
+static uint64_t  enc_seq = 0;           // Shared by both suites: a nonce never repeats under the key
+static int       enc_ready = 0;
+
+// Caller holds the lock.  -3 = RNG could not be seeded, -1 = key setup failed.
+static int enc_ctx_ready(int suite) {
+    if (!enc_ready) {
+        if (wc_InitRng(&enc_rng) != 0) return -3;
+        if (wc_RNG_GenerateBlock(&enc_rng, enc_salt, sizeof(enc_salt)) != 0) {
+            wc_FreeRng(&enc_rng);
+            return -3;
+        }
+        enc_ready = 1;
+    }
+    uint32_t gen = aes_key_generation();
+    if (enc_keyed[suite] && enc_key_gen[suite] == gen) return 0;
+
+    const gcm_backend_t *b = gcm_suite_backend(suite);
+    if (enc_keyed[suite]) {
+        b->release(&enc_ctx[suite]);
+        enc_keyed[suite] = 0;
+    }
+    if (b->setkey(&enc_ctx[suite], aes_key(), AES_KEY_LEN) != 0)
+        return -1;
+    enc_keyed[suite] = 1;
+    enc_key_gen[suite] = gen;
+    return 0;
+}
+
+int aes_gcm_encrypt_prepare(void)
+{
+    int ret = 0;
+    enc_ctx_lock();
+    for (int suite = 0; suite < GCM_SUITES && ret == 0; suite++)
+        ret = enc_ctx_ready(suite);
+    enc_ctx_unlock();
+    return ret;
+}
+
 // =========================================================================
 // Public API
 // =========================================================================
@@ -72,7 +132,6 @@ static const int      AAD_LEN = 0;
 int aes_gcm_encrypt_packet(const char    *plaintext,
                            uint8_t        out_packet[PACKET_LEN])
 {
-    init_aes_key();
     if (!plaintext || !out_packet)
         return -1;
 
@@ -81,65 +140,30 @@ int aes_gcm_encrypt_packet(const char    *plaintext,
     uint8_t *ct    = out_packet + CT_OFFSET;
     uint8_t *tag   = out_packet + TAG_OFFSET;
 
-    // ------------------------------------------------------------------
-    // Generate a fresh random 12-byte nonce for every packet.
-    // Re-using a nonce with the same key completely breaks GCM security.
-    // ------------------------------------------------------------------
-    WC_RNG rng;
-    int wc_ret = wc_InitRng(&rng);
-    if (wc_ret != 0)
-        return -3;
-
-    wc_ret = wc_RNG_GenerateBlock(&rng, nonce, NONCE_LEN);
-    wc_FreeRng(&rng);
-    if (wc_ret != 0)
-        return -3;
+    enc_ctx_lock();
+    int suite  = gcm_suite();
+    int wc_ret = enc_ctx_ready(suite);
+    if (wc_ret != 0) {
+        enc_ctx_unlock();
+        return wc_ret;
+    }
 
     // ------------------------------------------------------------------
-    // Initialise WolfSSL AES context and set key
+    // Session salt + sequence number (replay_window.h): never repeats
+    // under this key, and the GS drops a report it has already seen.
     // ------------------------------------------------------------------
-    Aes aes;
-    wc_ret = wc_AesInit(&aes, NULL, INVALID_DEVID);
-    if (wc_ret != 0)
-        return -1;
-
-    wc_ret = wc_AesGcmSetKey(&aes, AES_KEY, AES_KEY_LEN);
-    if (wc_ret != 0) {
-        wc_AesFree(&aes);
-        return -1;
+    if (!replay_nonce_next(nonce, enc_salt, REPLAY_DIR_ROBOT, &enc_seq)) {
+        enc_ctx_unlock();
+        return -3;
     }
 
     // ------------------------------------------------------------------
-    // Encrypt + generate tag in one call.
-    //
-    // wc_AesGcmEncrypt signature:
-    //   int wc_AesGcmEncrypt(Aes*          aes,
-    //                        byte*         out,        // ciphertext output
-    //                        const byte*   in,         // plaintext input
-    //                        word32        sz,         // plaintext length
-    //                        const byte*   iv,         // nonce
-    //                        word32        ivSz,       // nonce length
-    //                        byte*         authTag,    // tag output
-    //                        word32        authTagSz,  // tag length
-    //                        const byte*   authIn,     // AAD (may be NULL)
-    //                        word32        authInSz);  // AAD length (0 if none)
-    //
-    // Returns 0 on success.
+    // Encrypt + generate tag in one pass (0 on success).
     // ------------------------------------------------------------------
-    wc_ret = wc_AesGcmEncrypt(
-        &aes,
-        ct,                           // ciphertext output
-        (const uint8_t *)plaintext,   // plaintext input
-        (word32)CT_LEN,               // plaintext length
-        nonce,                        // IV / nonce (written above)
-        (word32)NONCE_LEN,            // nonce length
-        tag,                          // GCM authentication tag output
-        (word32)TAG_LEN,              // tag length
-        AAD,                          // additional authenticated data (or NULL)
-        (word32)AAD_LEN               // AAD length (0 if none)
-    );
-
-    wc_AesFree(&aes);
+    wc_ret = gcm_suite_backend(suite)->encrypt(&enc_ctx[suite], nonce, AAD, (size_t)AAD_LEN,
+                                               (const uint8_t *)plaintext, CT_LEN, ct, tag);
+
+    enc_ctx_unlock();
 
     if (wc_ret != 0)
         return -1;
@@ -154,12 +178,7 @@ int aes_gcm_encrypt_packet(const char    *plaintext,
 
 // ---------- tiny hex helper (only needed for the test harness) -----------
 static void hex_encode(const uint8_t *in, size_t len, char *out) {
-    static const char lut[] = "0123456789abcdef";
-    for (size_t i = 0; i < len; i++) {
-        out[i * 2]     = lut[in[i] >> 4];
-        out[i * 2 + 1] = lut[in[i] & 0x0f];
-    }
-    out[len * 2] = '\0';
+    hexc_encode(in, len, out, 0);
 }
 
 int main(int argc, char **argv) {
@@ -8,7 +8,7 @@
  * Encrypt a plaintext buffer into a 156-byte AES-256-GCM packet.
  *
  * Packet layout (all raw bytes, no hex encoding):
- *   [0  .. 11 ]  nonce      (12 bytes)  — randomly generated per call
+ *   [0  .. 11 ]  nonce      (12 bytes)  — session salt || sequence (replay_window.h)
  *   [12 .. 139]  ciphertext (128 bytes)
  *   [140.. 155]  GCM tag    (16 bytes)
  *
@@ -22,9 +22,17 @@
  *
  * @return  0  on success
  *         -1  on argument / initialisation error
- *         -3  on nonce generation failure
+ *         -3  on nonce generation failure (salt draw, or sequence exhausted)
  */
 int aes_gcm_encrypt_packet(const char    *plaintext,
                            uint8_t        out_packet[156]);
 
+/**
+ * Seed the nonce RNG and key the encrypt context of every suite now
+ * (aes_gcm_prepare(), aes_key.h) rather than on the first packet.
+ *
+ * @return  0 on success, -1 on key setup failure, -3 if the RNG could not be seeded
+ */
+int aes_gcm_encrypt_prepare(void);
+
 #endif /* AES_GCM_ENCRYPT_H */
@@ -0,0 +1,77 @@
+// aes_key.c
+//
+// Built-in or NVS-provisioned packet key, and the boot-time context setup.
+// See aes_key.h.
+
+#include "aes_key.h"
+
+#include <string.h>
+#include "aes_key_gen.h"
+#include "aes_gcm_encrypt.h"
+#include "aes_gcm_decrypt.h"
+
+#ifdef ESP_PLATFORM
+#include "nvs.h"
+#include "esp_log.h"
+
+#define AES_KEY_TAG "AES_KEY"
+#endif
+
+static const uint8_t key_builtin[AES_KEY_LEN] = AES_KEY_BUILTIN_INIT;
+static uint8_t       key_nvs[AES_KEY_LEN];
+static const uint8_t *key_cur = NULL;
+static volatile uint32_t key_gen = 0;
+
+#ifdef ESP_PLATFORM
+static int key_nvs_load(void) {
+    nvs_handle_t h;
+    size_t len = sizeof(key_nvs);
+    if (nvs_open(AES_KEY_NVS_NS, NVS_READONLY, &h) != ESP_OK) return 0;
+    int ok = nvs_get_blob(h, AES_KEY_NVS_KEY, key_nvs, &len) == ESP_OK && len == AES_KEY_LEN;
+    nvs_close(h);
+    return ok;
+}
+#else
+static int key_nvs_load(void) { return 0; }     // Host test build: built-in key only
+#endif
+
+const uint8_t *aes_key(void) {
+    if (!key_cur) {
+        key_cur = key_nvs_load() ? key_nvs : key_builtin;
+#ifdef ESP_PLATFORM
+        ESP_LOGI(AES_KEY_TAG, "Packet key: %s", key_cur == key_nvs ? "provisioned (NVS)" : "built-in");
+#endif
+    }
+    return key_cur;
+}
+
+uint32_t aes_key_generation(void) {
+    return key_gen;
+}
+
+// Target only: the host test binaries link one direction each
+#ifdef ESP_PLATFORM
+int aes_gcm_prepare(void) {
+    aes_key();
+    int ret = aes_gcm_encrypt_prepare();
+    int dec = aes_gcm_decrypt_prepare();
+    return ret != 0 ? ret : dec;
+}
+
+int aes_key_provision(const uint8_t key[AES_KEY_LEN]) {
+    nvs_handle_t h;
+    if (nvs_open(AES_KEY_NVS_NS, NVS_READWRITE, &h) != ESP_OK) return -1;
+    esp_err_t err = nvs_set_blob(h, AES_KEY_NVS_KEY, key, AES_KEY_LEN);
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    if (err != ESP_OK) return -1;
+
+    // The contexts read key_nvs only while rekeying, under their locks,
+    // and they rekey only after the generation moves
+    memcpy(key_nvs, key, AES_KEY_LEN);
+    key_cur = key_nvs;
+    key_gen++;
+    aes_gcm_prepare();
+    return 0;
+}
+#endif
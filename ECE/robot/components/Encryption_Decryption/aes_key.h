@@ -0,0 +1,42 @@
+#ifndef AES_KEY_H
+#define AES_KEY_H
+
+#include <stdint.h>
+
+/*
+ * The packet key, for aes_gcm_encrypt.c and aes_gcm_decrypt.c.
+ *
+ *   built-in   AES_KEY_BUILTIN_INIT from aes_key_gen.h, generated at build
+ *              time by Robot_Final/gen_aes_key.py (AES_KEY_HEX): const flash
+ *              data, nothing parsed at boot
+ *   NVS        a 32-byte blob at AES_KEY_NVS_NS / AES_KEY_NVS_KEY, written by
+ *              aes_key_provision() or flashed with nvs_partition_gen.py;
+ *              when present it replaces the built-in key
+ *
+ * aes_gcm_prepare() keys every suite's encrypt and decrypt context and
+ * seeds the nonce RNG. app_main() calls it once NVS is up, before the radio
+ * starts, so the first secure packet after boot finds everything set up.
+ * aes_key_provision() rekeys the same way before it returns.
+ */
+
+#define AES_KEY_LEN       32
+#define AES_KEY_NVS_NS    "robot_aes"
+#define AES_KEY_NVS_KEY   "key"
+
+// Current key (AES_KEY_LEN bytes); reads NVS on the first call
+const uint8_t *aes_key(void);
+
+// Bumped by aes_key_provision(); a context keyed under an older one rekeys
+uint32_t aes_key_generation(void);
+
+#ifdef ESP_PLATFORM
+// Key both directions for every suite now. 0 on success, else the first
+// failing side's error code
+int aes_gcm_prepare(void);
+
+// Store a field-rotated key in NVS and rekey. 0 on success, -1 on a
+// flash error (the old key stays in use)
+int aes_key_provision(const uint8_t key[AES_KEY_LEN]);
+#endif
+
+#endif
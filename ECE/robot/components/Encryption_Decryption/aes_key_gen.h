@@ -0,0 +1,10 @@
+// Generated by Robot_Final/gen_aes_key.py; do not edit.
+#ifndef AES_KEY_GEN_H
+#define AES_KEY_GEN_H
+
+#define AES_KEY_BUILTIN_INIT { \
+    0xa1, 0xb2, 0xc3, 0xd4, 0xe5, 0xf6, 0x78, 0x90, 0x12, 0x34, 0x56, 0x78, 0x90, 0x12, 0x34, 0x56, \
+    0x78, 0x90, 0xab, 0xcd, 0xef, 0x12, 0x34, 0x56, 0x78, 0x90, 0xab, 0xcd, 0xef, 0x12, 0x34, 0x56 \
+}
+
+#endif
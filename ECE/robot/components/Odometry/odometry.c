@@ -0,0 +1,160 @@
+#include "odometry.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "imu.h"
+
+#define ODOM_TAG "ODOM"
+
+// sin(i * 90 deg / 64) in Q15, i = 0..64
+static const int16_t sin_q15_tab[65] = {
+        0,   804,  1608,  2410,  3212,  4011,  4808,  5602,
+     6393,  7179,  7962,  8739,  9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767,
+};
+
+static portMUX_TYPE       odom_mux = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t odom_timer = NULL;
+static step_mot_t        *odom_wheel[4];
+static int32_t            odom_last[4];
+static odom_change_cb_t   odom_cb;
+static odom_pose_t        odom_pose;                // Guarded by odom_mux
+static odom_pose_t        odom_sent;                // Last reported, timer task only
+static int64_t            odom_nav_us, odom_pose_us;
+
+// Quarter-wave lookup, linear between entries (error < 1e-4)
+static int32_t sin_q15(uint16_t a) {
+    uint32_t i = a & 0x3FFF;
+    if (a & 0x4000) i = 0x4000 - i;                 // Second and fourth quadrant mirror
+    uint32_t k = i >> 8, frac = i & 0xFF;
+    int32_t v = sin_q15_tab[k];
+    if (k < 64) v += ((sin_q15_tab[k + 1] - v) * (int32_t)frac) >> 8;
+    return (a & 0x8000) ? -v : v;
+}
+
+static int32_t cos_q15(uint16_t a) { return sin_q15((uint16_t)(a + 0x4000)); }
+
+static int32_t mul_q15(int32_t v, int32_t q15) {
+    return (int32_t)(((int64_t)v * q15 + (1 << 14)) >> 15);
+}
+
+// Signed yaw difference, wrapped into +-180 deg
+static int32_t mdeg_diff(int32_t a, int32_t b) {
+    int32_t d = a - b;
+    if (d > 180000)       d -= 360000;
+    else if (d < -180000) d += 360000;
+    return d;
+}
+
+static uint32_t odom_changed(const odom_pose_t *p, int64_t now_us) {
+    uint32_t changed = 0;
+    const odom_pose_t *s = &odom_sent;
+
+    if (abs(p->x_um - s->x_um) >= ODOM_POS_DELTA_MM * 1000 ||
+        abs(p->y_um - s->y_um) >= ODOM_POS_DELTA_MM * 1000 ||
+        abs(p->speed_mm_s - s->speed_mm_s) >= ODOM_SPEED_DELTA_CMS * 10) changed |= ODOM_CHANGED_NAV;
+
+    if (abs(mdeg_diff(p->yaw_mdeg, s->yaw_mdeg)) >= ODOM_ANGLE_DELTA_MDEG ||
+        abs(p->pitch_mdeg - s->pitch_mdeg)         >= ODOM_ANGLE_DELTA_MDEG ||
+        abs(p->roll_mdeg - s->roll_mdeg)           >= ODOM_ANGLE_DELTA_MDEG) changed |= ODOM_CHANGED_POSE;
+
+#if ODOM_REPORT_MAX_MS > 0
+    if (now_us - odom_nav_us  >= ODOM_REPORT_MAX_MS * 1000LL) changed |= ODOM_CHANGED_NAV;
+    if (now_us - odom_pose_us >= ODOM_REPORT_MAX_MS * 1000LL) changed |= ODOM_CHANGED_POSE;
+#endif
+    return changed;
+}
+
+static void odom_tick(void *arg) {
+    int32_t d[4];
+    for (int i = 0; i < 4; i++) {
+        int32_t now = stepper_steps(odom_wheel[i]);
+        d[i] = now - odom_last[i];
+        odom_last[i] = now;
+    }
+    // Right wheels run dir 0 for forward, so their counts fall; turning in
+    // place cancels out
+    int32_t fwd_um = (d[0] + d[2] - d[1] - d[3]) * ODOM_UM_PER_STEP / 4;
+
+    odom_pose_t p;
+    taskENTER_CRITICAL(&odom_mux);
+    p = odom_pose;
+    taskEXIT_CRITICAL(&odom_mux);
+
+    // The IMU hands over milli-degrees already
+    imu_sample_t imu;
+    p.imu = imu_get(&imu);
+    if (p.imu) {
+        p.yaw_mdeg   = imu.euler.yaw;
+        p.pitch_mdeg = imu.euler.pitch;
+        p.roll_mdeg  = imu.euler.roll;
+        p.heading    = (uint16_t)(p.yaw_mdeg * 2048LL / 11250);       // 65536 / 360000
+    }
+
+    p.x_um += mul_q15(fwd_um, cos_q15(p.heading));
+    p.y_um += mul_q15(fwd_um, sin_q15(p.heading));
+    p.speed_mm_s = fwd_um * ODOM_RATE_HZ / 1000;
+
+    taskENTER_CRITICAL(&odom_mux);
+    odom_pose = p;
+    taskEXIT_CRITICAL(&odom_mux);
+
+    int64_t now_us = esp_timer_get_time();
+    uint32_t changed = odom_changed(&p, now_us);
+    if (!changed) return;
+
+    if (changed & ODOM_CHANGED_NAV) {
+        odom_sent.x_um = p.x_um;
+        odom_sent.y_um = p.y_um;
+        odom_sent.speed_mm_s = p.speed_mm_s;
+        odom_nav_us = now_us;
+    }
+    if (changed & ODOM_CHANGED_POSE) {
+        odom_sent.yaw_mdeg   = p.yaw_mdeg;
+        odom_sent.pitch_mdeg = p.pitch_mdeg;
+        odom_sent.roll_mdeg  = p.roll_mdeg;
+        odom_pose_us = now_us;
+    }
+    if (odom_cb) odom_cb(changed);
+}
+
+bool odom_start(step_mot_t *const wheels[4], odom_change_cb_t on_change) {
+    if (odom_timer) return true;
+
+    for (int i = 0; i < 4; i++) {
+        odom_wheel[i] = wheels[i];
+        odom_last[i]  = stepper_steps(wheels[i]);
+    }
+    memset(&odom_pose, 0, sizeof(odom_pose));
+    memset(&odom_sent, 0, sizeof(odom_sent));
+    odom_cb = on_change;
+    odom_nav_us = odom_pose_us = esp_timer_get_time();
+
+    const esp_timer_create_args_t args = {
+        .callback = odom_tick,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "odom",
+        .skip_unhandled_events = true,              // Steps accumulate; a late tick loses nothing
+    };
+    if (esp_timer_create(&args, &odom_timer) != ESP_OK ||
+        esp_timer_start_periodic(odom_timer, 1000000 / ODOM_RATE_HZ) != ESP_OK) {
+        ESP_LOGE(ODOM_TAG, "Timer start failed!");
+        return false;
+    }
+    return true;
+}
+
+void odom_get(odom_pose_t *out) {
+    taskENTER_CRITICAL(&odom_mux);
+    *out = odom_pose;
+    taskEXIT_CRITICAL(&odom_mux);
+}
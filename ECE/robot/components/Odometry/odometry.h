@@ -0,0 +1,60 @@
+#ifndef ODOMETRY_H
+#define ODOMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "stepper_motor.h"
+
+/*
+ * Dead-reckoning pose. An esp_timer tick at ODOM_RATE_HZ reads the four
+ * step counters, averages them into forward travel and projects it onto
+ * the IMU heading (the wheels give distance, the BNO08x gives direction;
+ * without an IMU sample the last heading is held).
+ *
+ * All integration is fixed point: travel in um, heading as a 16-bit
+ * binary angle (65536 = 360 deg), sin/cos from a quarter-wave Q15 table.
+ *
+ * Reports are delta driven: after each tick the estimate is compared with
+ * what was last reported and on_change() is called with the report that
+ * moved past its threshold. ODOM_REPORT_MAX_MS can force one anyway;
+ * it is off by default since the health heartbeat already shows the link
+ * is up (telemetry.h).
+ */
+
+#ifndef ODOM_RATE_HZ
+#define ODOM_RATE_HZ            50      // Matches the BNO08x report rate
+#endif
+#ifndef ODOM_UM_PER_STEP
+#define ODOM_UM_PER_STEP        1257    // 80 mm wheel, 200 steps/rev (-D to match the build)
+#endif
+#ifndef ODOM_POS_DELTA_MM
+#define ODOM_POS_DELTA_MM       10      // Nav report once either axis moves this far
+#endif
+#ifndef ODOM_SPEED_DELTA_CMS
+#define ODOM_SPEED_DELTA_CMS    2
+#endif
+#ifndef ODOM_ANGLE_DELTA_MDEG
+#define ODOM_ANGLE_DELTA_MDEG   1000    // Pose report on 1 deg of yaw, pitch or roll
+#endif
+#ifndef ODOM_REPORT_MAX_MS
+#define ODOM_REPORT_MAX_MS      0       // 0 = only on change
+#endif
+
+#define ODOM_CHANGED_NAV        (1u << 0)
+#define ODOM_CHANGED_POSE       (1u << 1)
+
+typedef struct {
+    int32_t  x_um, y_um;                // From where odom_start() was called
+    int32_t  speed_mm_s;                // Signed, forward positive
+    uint16_t heading;                   // Binary angle, 0 = start heading of the IMU
+    int32_t  yaw_mdeg, pitch_mdeg, roll_mdeg;
+    bool     imu;                       // Heading came from the IMU on the last tick
+} odom_pose_t;
+
+typedef void (*odom_change_cb_t)(uint32_t changed);    // ODOM_CHANGED_* bits, esp_timer task
+
+// wheels: F_L, F_R, B_L, B_R (drivetrain_t.m order)
+bool odom_start(step_mot_t *const wheels[4], odom_change_cb_t on_change);
+void odom_get(odom_pose_t *out);
+
+#endif
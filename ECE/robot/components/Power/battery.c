@@ -0,0 +1,88 @@
+#include "battery.h"
+
+#if BATT_SENSE
+
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#define BATT_TAG "BATTERY"
+
+static adc_oneshot_unit_handle_t batt_adc;
+static adc_cali_handle_t         batt_cali;
+static adc_channel_t             batt_chan;
+static uint32_t                  batt_mv;          // Smoothed, 0 = no reading yet
+static int64_t                   batt_at_us;
+
+void battery_init(void)
+{
+    adc_unit_t unit;
+    if (adc_oneshot_io_to_channel(BATT_ADC_GPIO, &unit, &batt_chan) != ESP_OK || unit != ADC_UNIT_1) {
+        ESP_LOGE(BATT_TAG, "GPIO %d is not an ADC1 pin", BATT_ADC_GPIO);
+        return;
+    }
+
+    const adc_oneshot_unit_init_cfg_t unit_cfg = { .unit_id = ADC_UNIT_1 };
+    const adc_oneshot_chan_cfg_t chan_cfg = { .atten = ADC_ATTEN_DB_12, .bitwidth = ADC_BITWIDTH_DEFAULT };
+    if (adc_oneshot_new_unit(&unit_cfg, &batt_adc) != ESP_OK ||
+        adc_oneshot_config_channel(batt_adc, batt_chan, &chan_cfg) != ESP_OK) {
+        ESP_LOGE(BATT_TAG, "ADC1 init failed");
+        batt_adc = NULL;
+        return;
+    }
+
+    const adc_cali_line_fitting_config_t cali_cfg = {
+        .unit_id = ADC_UNIT_1, .atten = ADC_ATTEN_DB_12, .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    if (adc_cali_create_scheme_line_fitting(&cali_cfg, &batt_cali) != ESP_OK) {
+        ESP_LOGW(BATT_TAG, "No eFuse calibration, battery level is approximate");
+        batt_cali = NULL;
+    }
+}
+
+// Pack voltage in mV from one averaged burst; 0 on a read error
+static uint32_t batt_read_mv(void)
+{
+    int sum = 0;
+    for (int i = 0; i < BATT_SAMPLES; i++) {
+        int raw, mv;
+        if (adc_oneshot_read(batt_adc, batt_chan, &raw) != ESP_OK) return 0;
+        if (!batt_cali || adc_cali_raw_to_voltage(batt_cali, raw, &mv) != ESP_OK) {
+            mv = raw * 3100 / 4095;             // Nominal full scale at 12 dB
+        }
+        sum += mv;
+    }
+    return (uint32_t)sum / BATT_SAMPLES * BATT_DIV_NUM / BATT_DIV_DEN;
+}
+
+uint32_t battery_mv(void)
+{
+    int64_t now = esp_timer_get_time();
+    if (!batt_adc || (batt_mv && now - batt_at_us < (int64_t)BATT_PERIOD_MS * 1000)) return batt_mv;
+
+    uint32_t mv = batt_read_mv();
+    if (mv) {
+        batt_mv = batt_mv ? (batt_mv * 7 + mv) / 8 : mv;    // First read seeds the filter
+        batt_at_us = now;
+    }
+    return batt_mv;
+}
+
+uint8_t battery_percent(void)
+{
+    uint32_t mv = battery_mv();
+    if (!mv) return 100;                        // No reading: as without BATT_SENSE
+    if (mv <= BATT_MV_EMPTY) return 0;
+    if (mv >= BATT_MV_FULL)  return 100;
+    return (uint8_t)((mv - BATT_MV_EMPTY) * 100 / (BATT_MV_FULL - BATT_MV_EMPTY));
+}
+
+#else
+
+void     battery_init(void)    {}
+uint8_t  battery_percent(void) { return 100; }
+uint32_t battery_mv(void)      { return 0; }
+
+#endif
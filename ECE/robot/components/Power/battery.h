@@ -0,0 +1,49 @@
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#include <stdint.h>
+
+/*
+ * Battery level for the health report (health.battery, 0-100 %).
+ *
+ * BATT_SENSE=1 reads the pack through a resistor divider on BATT_ADC_GPIO
+ * (ADC1, so it works with the radio on): BATT_SAMPLES calibrated one-shot
+ * reads, averaged, scaled back by BATT_DIV_NUM / BATT_DIV_DEN, mapped
+ * linearly from BATT_MV_EMPTY..BATT_MV_FULL and smoothed, since the pack
+ * sags while the wheels draw. The ADC is read at most every BATT_PERIOD_MS;
+ * calls in between return the last level. The defaults are a 2S LiPo
+ * behind 100k / 33k.
+ *
+ * Without BATT_SENSE (nothing wired to the pin) the level stays 100.
+ */
+
+#ifndef BATT_SENSE
+#define BATT_SENSE      0
+#endif
+#ifndef BATT_ADC_GPIO
+#define BATT_ADC_GPIO   35          // ADC1_CH7, input only
+#endif
+#ifndef BATT_DIV_NUM
+#define BATT_DIV_NUM    133         // (R_top + R_bottom) / R_bottom, as a fraction
+#endif
+#ifndef BATT_DIV_DEN
+#define BATT_DIV_DEN    33
+#endif
+#ifndef BATT_MV_EMPTY
+#define BATT_MV_EMPTY   6400
+#endif
+#ifndef BATT_MV_FULL
+#define BATT_MV_FULL    8400
+#endif
+#ifndef BATT_SAMPLES
+#define BATT_SAMPLES    8
+#endif
+#ifndef BATT_PERIOD_MS
+#define BATT_PERIOD_MS  1000
+#endif
+
+void     battery_init(void);
+uint8_t  battery_percent(void);
+uint32_t battery_mv(void);          // Smoothed pack voltage, 0 without a reading
+
+#endif
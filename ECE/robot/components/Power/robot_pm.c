@@ -0,0 +1,87 @@
+#include "robot_pm.h"
+
+#if ROBOT_PM && CONFIG_PM_ENABLE
+
+#include "freertos/FreeRTOS.h"
+#include "esp_pm.h"
+#include "esp_log.h"
+
+#define PM_TAG "ROBOT_PM"
+
+#if ROBOT_PM_MIN_MHZ < 80
+#error "ROBOT_PM_MIN_MHZ below 80 MHz also slows APB_CLK (LEDC, MCPWM, PCNT, I2C)"
+#endif
+
+static esp_pm_lock_handle_t pm_lock[PM_HOLD_COUNT];
+static bool                 pm_on[PM_HOLD_COUNT];         // robot_pm_set() state
+static uint64_t             pm_en_low;                    // Energized driver EN pins
+static portMUX_TYPE         pm_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void robot_pm_init(void)
+{
+    static const struct {
+        esp_pm_lock_type_t type;
+        const char        *name;
+    } locks[PM_HOLD_COUNT] = {
+        [PM_HOLD_CMD]    = { ESP_PM_CPU_FREQ_MAX,   "cmd"    },
+        [PM_HOLD_MOTION] = { ESP_PM_CPU_FREQ_MAX,   "motion" },
+        [PM_HOLD_ARM]    = { ESP_PM_NO_LIGHT_SLEEP, "arm"    },
+    };
+
+    esp_pm_config_t cfg = {
+        .max_freq_mhz       = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz       = ROBOT_PM_MIN_MHZ,
+        .light_sleep_enable = ROBOT_PM_LIGHT_SLEEP,
+    };
+    esp_err_t err = esp_pm_configure(&cfg);
+    if (err != ESP_OK) {
+        ESP_LOGE(PM_TAG, "esp_pm_configure failed (%s), running at full speed", esp_err_to_name(err));
+        return;
+    }
+
+    for (int i = 0; i < PM_HOLD_COUNT; i++) {
+        if (esp_pm_lock_create(locks[i].type, 0, locks[i].name, &pm_lock[i]) != ESP_OK) {
+            ESP_LOGE(PM_TAG, "No PM lock '%s'", locks[i].name);
+            pm_lock[i] = NULL;
+        }
+    }
+    ESP_LOGI(PM_TAG, "DFS %d-%d MHz, light sleep %s", ROBOT_PM_MIN_MHZ,
+             CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, ROBOT_PM_LIGHT_SLEEP ? "on" : "off");
+}
+
+void robot_pm_hold(pm_hold_t why)
+{
+    if (pm_lock[why]) esp_pm_lock_acquire(pm_lock[why]);
+}
+
+void robot_pm_release(pm_hold_t why)
+{
+    if (pm_lock[why]) esp_pm_lock_release(pm_lock[why]);
+}
+
+// Caller holds pm_mux
+static void pm_switch(pm_hold_t why, bool on)
+{
+    if (pm_on[why] == on) return;
+    pm_on[why] = on;
+    if (on) robot_pm_hold(why);
+    else    robot_pm_release(why);
+}
+
+void robot_pm_set(pm_hold_t why, bool on)
+{
+    portENTER_CRITICAL_SAFE(&pm_mux);
+    pm_switch(why, on);
+    portEXIT_CRITICAL_SAFE(&pm_mux);
+}
+
+void robot_pm_drivers(uint64_t en_gpios, bool energized)
+{
+    portENTER_CRITICAL_SAFE(&pm_mux);
+    if (energized) pm_en_low |= en_gpios;
+    else           pm_en_low &= ~en_gpios;
+    pm_switch(PM_HOLD_MOTION, pm_en_low != 0);
+    portEXIT_CRITICAL_SAFE(&pm_mux);
+}
+
+#endif
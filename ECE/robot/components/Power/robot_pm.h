@@ -0,0 +1,72 @@
+#ifndef ROBOT_PM_H
+#define ROBOT_PM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+/*
+ * Power management (ROBOT_PM=1, env:esp32dev_pm with sdkconfig.pm).
+ *
+ * esp_pm scales the CPU between CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ and
+ * ROBOT_PM_MIN_MHZ whenever no lock below is held, FreeRTOS runs tickless,
+ * and the BLE controller keeps its modem sleep (sdkconfig.esp32dev). The
+ * locks are held only for as long as something time-critical is going on:
+ *
+ *   PM_HOLD_CMD     per RX pool slot in use (ble_rx_pool.c): from the first
+ *                   fragment of a write until its command has run, so
+ *                   framing, decryption and execution all get full speed
+ *   PM_HOLD_MOTION  while any stepper driver is energized (EN low); the
+ *                   step engines and the stop timers run at full speed
+ *   PM_HOLD_ARM     while the arm is powered: the servo PWM (LEDC) stops
+ *                   in light sleep, so this only forbids that
+ *
+ * ROBOT_PM_MIN_MHZ stays >= 80: below it APB_CLK follows the CPU, and the
+ * LEDC, MCPWM, PCNT and I2C timing is all derived from APB. Light sleep is
+ * off unless ROBOT_PM_LIGHT_SLEEP=1; with the controller's low-power clock
+ * on the main XTAL (no 32 kHz crystal on this board) the gain is small.
+ *
+ * With CONFIG_PM_PROFILING the runtime stats dump adds the time spent in
+ * each mode and under each lock, which is what the current draw measured
+ * at the battery lead is set against (test/test_perf: wake_to_motion for
+ * the latency cost).
+ *
+ * Without ROBOT_PM (or CONFIG_PM_ENABLE) every call here is a no-op.
+ */
+
+#ifndef ROBOT_PM
+#define ROBOT_PM             0
+#endif
+#ifndef ROBOT_PM_MIN_MHZ
+#define ROBOT_PM_MIN_MHZ     80
+#endif
+#ifndef ROBOT_PM_LIGHT_SLEEP
+#define ROBOT_PM_LIGHT_SLEEP 0
+#endif
+
+typedef enum {
+    PM_HOLD_CMD = 0,
+    PM_HOLD_MOTION,
+    PM_HOLD_ARM,
+    PM_HOLD_COUNT
+} pm_hold_t;
+
+#if ROBOT_PM && CONFIG_PM_ENABLE
+
+void robot_pm_init(void);                            // Before anything takes a lock
+void robot_pm_hold(pm_hold_t why);                   // Counted: one release per hold
+void robot_pm_release(pm_hold_t why);
+void robot_pm_set(pm_hold_t why, bool on);           // Not counted: held while on
+void robot_pm_drivers(uint64_t en_gpios, bool energized);   // PM_HOLD_MOTION by EN pin
+
+#else
+
+static inline void robot_pm_init(void) {}
+static inline void robot_pm_hold(pm_hold_t why) { (void)why; }
+static inline void robot_pm_release(pm_hold_t why) { (void)why; }
+static inline void robot_pm_set(pm_hold_t why, bool on) { (void)why; (void)on; }
+static inline void robot_pm_drivers(uint64_t en_gpios, bool energized) { (void)en_gpios; (void)energized; }
+
+#endif
+
+#endif
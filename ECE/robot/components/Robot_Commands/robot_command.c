@@ -1,33 +1,157 @@
 #include "robot_commands.h"
 #include "Robot_BLE.h"
+#include "ble_rx_pool.h"
 #include "imu.h"
 #include "arm.h"
+#include "odometry.h"
+#include "trajectory.h"
+#include "trace.h"
+#include "hot_path.h"
 #include "aes_gcm_encrypt.h"
+#include "aes_gcm_backend.h"
+#include "esp_timer.h"
+#include "battery.h"
+#include <stdlib.h>
 
-volatile int security_flag = 0;
 volatile uint16_t AC = 0x3FF;  // PUT IN NVS
 volatile int motor_power = 1;
 char robot_name[32] = DEVICE_NAME; // PUT IN NVS
 volatile int arm_power = 1;
 volatile int sys_shtdwn = 0;
+volatile int notify_mode = BLE_NOTIFY_BINARY;
+volatile int drive_mode = 0;
+volatile uint32_t drive_watchdog_ms = DRIVE_WATCHDOG_MS;
+volatile int ack_mode = 0;
+volatile uint32_t ack_hold_ms = ACK_RANGE_HOLD_MS;
+volatile uint32_t cmd_rx_us = 0;
+volatile int cmd_conn = BLE_CONN_ALL;
+static drivetrain_t *drive;
+static ack_range_t ack_held;            // Executor task only, like every send_ack()
+static TickType_t  ack_due;             // Tick the held range must be out by
+static int         ack_conn;            // Slot the held ids came from
+static uint32_t    ack_win_ms;          // Adaptive hold, 0 .. ack_hold_ms
+static volatile uint32_t estop_worst_us;
+
+/*
+      FRONT OF THE BOT
+    F_L               F_R
+
+
+    B_L               B_R
+
+  Motion primitives, indexed by the CONTROL bits w | a << 1 | s << 2 | d << 3.
+  ratio[] is { F_L, F_R, B_L, B_R } in DRIVE_RATIO_ONE units, + = that wheel
+  forward. Conflicting keys resolve as the original if/else chain did:
+  w+d / s+d win over a, w+a / s+a over nothing, w+s and a+d stop.
+*/
+#define F  DRIVE_RATIO_ONE
+#define T  DRIVE_TURN_RATIO
+static const drive_mix_t drive_mix[16] = {
+    [0x0] = { "Stop",               {  0,  0,  0,  0 } },
+    [0x1] = { "Forward",            {  F,  F,  F,  F } },   // w
+    [0x2] = { "In Place Left",      { -F,  F, -F,  F } },   // a
+    [0x3] = { "Diagonal FWD-Left",  {  T,  F,  T,  F } },   // w a
+    [0x4] = { "Backward",           { -F, -F, -F, -F } },   // s
+    [0x5] = { "Stop",               {  0,  0,  0,  0 } },   // w s
+    [0x6] = { "Diagonal BWD-Left",  { -T, -F, -T, -F } },   // a s
+    [0x7] = { "Diagonal FWD-Left",  {  T,  F,  T,  F } },   // w a s
+    [0x8] = { "In Place Right",     {  F, -F,  F, -F } },   // d
+    [0x9] = { "Diagonal FWD-Right", {  F,  T,  F,  T } },   // w d
+    [0xA] = { "Stop",               {  0,  0,  0,  0 } },   // a d
+    [0xB] = { "Diagonal FWD-Right", {  F,  T,  F,  T } },   // w a d
+    [0xC] = { "Diagonal BWD-Right", { -F, -T, -F, -T } },   // s d
+    [0xD] = { "Diagonal FWD-Right", {  F,  T,  F,  T } },   // w s d
+    [0xE] = { "Diagonal BWD-Right", { -F, -T, -F, -T } },   // a s d
+    [0xF] = { "Diagonal FWD-Right", {  F,  T,  F,  T } },   // w a s d
+};
+#undef F
+#undef T
+
+void ack_flush(void) {
+    if (!ack_held.n) return;
+    robot_bt_packet_t range = { .raw = ack_range_word(&ack_held, 1, ble_rx_pool_credits()) };
+    TRACE(CMD, ACK, ack_held.newest, RESULT_ACK_RANGE, ack_held.n);
+    ack_held.n = 0;
+    send_cmd_to(ack_conn, range.bytes);
+}
+
+TickType_t ack_wait(void) {
+    if (!ack_held.n) return portMAX_DELAY;
+    int32_t left = (int32_t)(ack_due - xTaskGetTickCount());
+    return left > 0 ? (TickType_t)left : 0;
+}
+
+// One connection interval of the range's link: a hold shorter than that
+// would not save a connection event
+static uint32_t ack_step_ms(void) {
+    uint16_t itvl = BLE_CONN_INT_MIN;
+    if (ack_conn >= 0 && ack_conn < MAX_DEVICES && connected_devices[ack_conn].conn_int)
+        itvl = connected_devices[ack_conn].conn_int;
+    uint32_t ms = (uint32_t)itvl * 5 / 4;
+    return ms ? ms : 1;
+}
+
+// The hold follows the backlog: a range that filled up, or went out with
+// commands still waiting, doubles it from one connection interval; one that
+// held a single id with nothing behind it halves it, down to 0 (each ACK
+// goes out after its command). ack_hold_ms stays the ceiling.
+static void ack_window(bool grow) {
+    uint32_t step = ack_step_ms();
+    if (grow) ack_win_ms = ack_win_ms ? ack_win_ms * 2 : step;
+    else if (ack_win_ms < step * 2) ack_win_ms = 0;
+    else ack_win_ms /= 2;
+    if (ack_win_ms > ack_hold_ms) ack_win_ms = ack_hold_ms;
+}
+
+uint32_t ack_window_ms(void) {
+    return ack_win_ms;
+}
+
+void ack_poll(void) {
+    if (!ack_held.n || ack_wait() != 0) return;
+    bool backlog = ble_rx_pool_used() > 0 || ble_tx_depth() > 0;
+    if (backlog) ack_window(true);
+    else if (ack_held.n == 1) ack_window(false);
+    ack_flush();
+}
+
+// An ACK goes to the central whose command it answers (cmd_conn); a range
+// only ever holds one central's ids
+void send_ack(uint16_t id, uint8_t result, uint64_t instr_specfic) {
+    uint64_t info = result == RESULT_SUCCESS ? trace_lat_ack(instr_specfic) : instr_specfic;
+
+    // ACK_MODE ranges: a plain success is only held; ack_poll() sends it
+    if (ack_mode && result == RESULT_SUCCESS && info == NO_INFO) {
+        if (ack_held.n && ack_conn != cmd_conn) ack_flush();
+        if (ack_range_add(&ack_held, id) != 0) {
+            ack_window(true);           // Full before it was due
+            ack_flush();
+            ack_range_add(&ack_held, id);
+        }
+        if (ack_held.n == 1) {
+            ack_conn = cmd_conn;
+            ack_due = xTaskGetTickCount() + pdMS_TO_TICKS(ack_win_ms);
+        }
+        return;
+    }
+    ack_flush();                        // Held ids first, so ACKs stay in order
 
-void send_ack(uint16_t id, uint8_t result, int secure, uint64_t instr_specfic) {
     robot_bt_packet_t response = {0};
 
     response.ack.pl = 1;
     response.ack.type = ACK_CMD;  
     response.ack.id = id;             
     response.ack.result_code = result;
-    response.ack.instruction_specific = instr_specfic;
-    send_cmd(response.bytes, secure);
+    response.ack.instruction_specific = info;
+    send_cmd_to(cmd_conn, response.bytes);
 
-    ESP_LOGI(CMD_TAG, "Sent ACK for ID %d with Result %d", id, result);
+    TRACE(CMD, ACK, id, result, 0);
 }
 
-void control_cmd(control_format_t ctrl, step_mot_t* F_L, step_mot_t* F_R, step_mot_t* B_L, step_mot_t* B_R){
+HOT_PATH void control_cmd(control_format_t ctrl, drivetrain_t* dt){
     if (motor_power == 0){
-        ESP_LOGI(CMD_TAG, "Control CMD - Motor OFF");
-        send_ack(ctrl.id, RESULT_CMD_FAILURE, security_flag, MOTORS_DISABLED);
+        TRACE(CMD, MOTOR_OFF, ctrl.id, 0, 0);
+        send_ack(ctrl.id, RESULT_CMD_FAILURE, MOTORS_DISABLED);
         return;
     }
 
@@ -37,95 +161,38 @@ void control_cmd(control_format_t ctrl, step_mot_t* F_L, step_mot_t* F_R, step_m
 
     // Check if any valid move input exists
     bool any_input = w || s || a || d;
-    if (!any_input) return;
+    uint32_t hold_ms = drive_mode ? drive_watchdog_ms : 0;
+    if (!any_input && !drive_mode) return;      // Setpoint mode: empty = the stop setpoint
+    traj_stop();                                // Manual driving takes over
 
-    // Enable all motors on any valid move — caller handles disable
-    stepper_enable(F_L); 
-    stepper_enable(F_R);
-    stepper_enable(B_L);
-    stepper_enable(B_R);
+    // drivetrain_set enables the drivers; its idle timer disables them after the hold
+    const drive_mix_t *mix = &drive_mix[w | a << 1 | s << 2 | d << 3];
+    TRACE(CMD, DRIVE, w | a << 1 | s << 2 | d << 3, speed, hold_ms);   // drive_mix[a] names it
 
-    ESP_LOGI(CMD_TAG, "Motor Moving");
-    /*
-      FRONT OF THE BOT
-    F_L               F_R
-    
-    
-    B_L               B_R
+    int8_t vel[WHEEL_COUNT];
+    for (int i = 0; i < WHEEL_COUNT; i++) vel[i] = (int8_t)(speed * mix->ratio[i] / DRIVE_RATIO_ONE);
+    drivetrain_set(dt, vel, hold_ms);
 
-    */
-    if (w && !s && !a && !d) {
-        ESP_LOGI(CMD_TAG, "Forward at speed %d", speed);
-        motor_pulse(F_L, speed, 1);
-        motor_pulse(F_R, speed, 0);
-        motor_pulse(B_L, speed, 1); 
-        motor_pulse(B_R, speed, 0);
-    }
-    else if (s && !w && !a && !d) {
-        ESP_LOGI(CMD_TAG, "Backward at speed %d", speed);
-        motor_pulse(F_L, speed, 0);
-        motor_pulse(F_R, speed, 1);
-        motor_pulse(B_L, speed, 0);
-        motor_pulse(B_R, speed, 1);
-    }
-    else if (d && !w && !s && !a) {
-        ESP_LOGI(CMD_TAG, "In Place Right at speed %d", speed);
-        motor_pulse(F_L, speed, 1);
-        motor_pulse(F_R, speed, 1);
-        motor_pulse(B_L, speed, 1); 
-        motor_pulse(B_R, speed, 1);  
-    }
-    else if (a && !w && !s && !d) {
-        ESP_LOGI(CMD_TAG, "In Place Left at speed %d", speed);
-        motor_pulse(F_L, speed, 0);
-        motor_pulse(F_R, speed, 0);
-        motor_pulse(B_L, speed, 0); 
-        motor_pulse(B_R, speed, 0);
-    }
-    else if (w && d) {
-        ESP_LOGI(CMD_TAG, "Diagonal FWD-Right at speed %d", speed);
-        motor_pulse(F_L, speed, 1);
-        motor_pulse(F_R, speed/2, 0);
-        motor_pulse(B_L, speed, 1); 
-        motor_pulse(B_R, speed/2, 0);  
-    }
-    else if (w && a) {
-        ESP_LOGI(CMD_TAG, "Diagonal FWD-Left at speed %d", speed);
-        motor_pulse(F_L, speed/2, 1);
-        motor_pulse(F_R, speed, 0);
-        motor_pulse(B_L, speed/2, 1); 
-        motor_pulse(B_R, speed, 0); 
-    }
-    else if (s && d) {
-        ESP_LOGI(CMD_TAG, "Diagonal BWD-Right at speed %d", speed);
-        motor_pulse(F_L, speed, 0);
-        motor_pulse(F_R, speed/2, 1);
-        motor_pulse(B_L, speed, 0);
-        motor_pulse(B_R, speed/2, 1);
-    }
-    else if (s && a) {
-        ESP_LOGI(CMD_TAG, "Diagonal BWD-Left at speed %d", speed);
-        motor_pulse(F_L, speed/2, 0);
-        motor_pulse(F_R, speed, 1);
-        motor_pulse(B_L, speed/2, 0);
-        motor_pulse(B_R, speed, 1);
-    }
-
-    send_ack(ctrl.id, RESULT_SUCCESS, security_flag, NO_INFO);
+    send_ack(ctrl.id, RESULT_SUCCESS, NO_INFO);
 }
 
 void arm_cmd(arm_format_t arm, step_mot_t* F_L, step_mot_t* F_R, step_mot_t* B_L, step_mot_t* B_R){
-    ESP_LOGI(CMD_TAG, "Executing Arm CMD");
+    TRACE(CMD, ARM_CMD, arm.id, arm.reset, arm.speed);
+    if (!arm_power) {
+        send_ack(arm.id, RESULT_CMD_FAILURE, ARM_DISABLED);
+        return;
+    }
+    traj_stop();
     if (arm.reset) {
         arm_reset();
-        ESP_LOGI(CMD_TAG, "Arm reset to home");
-        send_ack(arm.id, RESULT_SUCCESS, security_flag, NO_INFO);
+        send_ack(arm.id, RESULT_SUCCESS, NO_INFO);
         return;
     }
 
     // Map speed (1–127) to step size in cm
     float step = ARM_SPEED_MIN_STEP + 
                  (arm.speed / 127.0f) * (ARM_SPEED_MAX_STEP - ARM_SPEED_MIN_STEP);
+    arm_set_speed(arm.speed / 127.0f);      // Joint speed limit for the interpolator
 
     // Read current position and apply deltas
     float x, y, z;
@@ -146,23 +213,43 @@ void arm_cmd(arm_format_t arm, step_mot_t* F_L, step_mot_t* F_R, step_mot_t* B_L
     // arm_move_to solves IK internally and rejects bad positions
     if (arm_move_to(x, y, z) != 0) {
         ESP_LOGW(CMD_TAG, "ARM move rejected (%.2f, %.2f, %.2f)", x, y, z);
-        send_ack(arm.id, RESULT_CMD_FAILURE, security_flag, ARM_CORDINATES_ISSUE);
+        send_ack(arm.id, RESULT_CMD_FAILURE, ARM_CORDINATES_ISSUE);
+        return;
+    }
+    send_ack(arm.id, RESULT_SUCCESS, NO_INFO);
+}
+
+// One word for a whole jog sequence: straight to the pose, joints in step
+void arm_target_cmd(arm_target_format_t armt) {
+    TRACE(CMD, ARM_TARGET, armt.id, armt.speed, 0);
+    if (!arm_power) {
+        send_ack(armt.id, RESULT_CMD_FAILURE, ARM_DISABLED);
+        return;
+    }
+    traj_stop();
+
+    float x = (float)armt.x / ARMT_UNITS_PER_IN;
+    float y = (float)armt.y / ARMT_UNITS_PER_IN;
+    float z = (float)armt.z / ARMT_UNITS_PER_IN;
+    arm_set_speed(armt.speed / 127.0f);
+    if (arm_move_sync(x, y, z) != 0) {
+        ESP_LOGW(CMD_TAG, "ARM target rejected (%.2f, %.2f, %.2f)", x, y, z);
+        send_ack(armt.id, RESULT_CMD_FAILURE, ARM_CORDINATES_ISSUE);
         return;
     }
-    send_ack(arm.id, RESULT_SUCCESS, security_flag, NO_INFO);
+    send_ack(armt.id, RESULT_SUCCESS, NO_INFO);
 }
 
 void system_cmd(system_format_t sys, step_mot_t* F_L, step_mot_t* F_R, step_mot_t* B_L, step_mot_t* B_R){
-    ESP_LOGI(CMD_TAG, "Executing System CMD");
- 
     uint64_t inst_type = (uint64_t)sys.instruction;
     uint16_t authorization_code = (uint16_t)sys.ac;
     uint32_t payload = (uint32_t)sys.specific;
-    
+    TRACE(CMD, SYS_CMD, sys.id, inst_type, payload);
+    ack_flush();                        // Held ACKs go out under the settings they were earned under
 
     if (AC != authorization_code) { 
         ESP_LOGW(CMD_TAG, "System CMD - Incorrect Authorization Code");
-        send_ack(sys.id, RESULT_AUTH_FAIL, security_flag, NO_INFO );
+        send_ack(sys.id, RESULT_AUTH_FAIL, NO_INFO );
         return;
     }
 
@@ -173,16 +260,21 @@ void system_cmd(system_format_t sys, step_mot_t* F_L, step_mot_t* F_R, step_mot_
     {
         
         case SECURITY_LEVEL:
-            if( payload != 0 && payload != 1){
+            if( payload != SEC_PLAIN && payload != SEC_AES_GCM && payload != SEC_CHACHA20_POLY1305){
                 ESP_LOGW(CMD_TAG, "System CMD - Security LVL Not Possible");
                 result = RESULT_INVALID_PARAMS;
                 break;
             }
             ESP_LOGI(CMD_TAG, "System CMD - Security Flag Updated %d", payload );
-            security_flag = payload;
+            // Suite first, so nothing is sealed under the old one once the
+            // session is up. The suite (and key) is shared by every session.
+            if (payload != SEC_PLAIN)
+                gcm_suite_set(payload == SEC_CHACHA20_POLY1305 ? GCM_SUITE_CHACHA : GCM_SUITE_AES);
+            ble_session_set_secure(cmd_conn, payload != SEC_PLAIN);
             result = RESULT_SUCCESS;
-            if(security_flag){instr_spc_rsp = SECURITY_ON; }
-            else             {instr_spc_rsp = SECURITY_OFF;}
+            if(payload == SEC_PLAIN)                  {instr_spc_rsp = SECURITY_OFF;}
+            else if(gcm_suite() == GCM_SUITE_CHACHA)  {instr_spc_rsp = SECURITY_ON_CHACHA;}
+            else                                      {instr_spc_rsp = SECURITY_ON; }
             
         break;
         
@@ -192,7 +284,14 @@ void system_cmd(system_format_t sys, step_mot_t* F_L, step_mot_t* F_R, step_mot_
                 result = RESULT_INVALID_PARAMS;
                 break;
             }
+            if (payload && sys_shtdwn) {
+                result = RESULT_CMD_FAILURE;
+                instr_spc_rsp = SHTDWN_ENABLED;
+                break;
+            }
             motor_power = payload;
+            if (!motor_power) traj_stop();
+            if (!motor_power && drive) drivetrain_set(drive, (int8_t[WHEEL_COUNT]){0}, 0);  // Drop a held setpoint
             result = RESULT_SUCCESS;
             if(motor_power){instr_spc_rsp = MOTORS_ENABLED; }
             else          {instr_spc_rsp = MOTORS_DISABLED;}
@@ -206,7 +305,7 @@ void system_cmd(system_format_t sys, step_mot_t* F_L, step_mot_t* F_R, step_mot_
                 strncpy(robot_name, new_name_ptr, sizeof(robot_name) - 1);
                 robot_name[sizeof(robot_name) - 1] = '\0';
 
-                esp_ble_gap_set_device_name(robot_name);
+                ble_set_name(robot_name);
         
                 ESP_LOGI(CMD_TAG, "Robot renamed to: %s", robot_name);
                 result = RESULT_SUCCESS;
@@ -243,7 +342,14 @@ void system_cmd(system_format_t sys, step_mot_t* F_L, step_mot_t* F_R, step_mot_
                 break;
             }
 
+            if (payload && sys_shtdwn) {
+                result = RESULT_CMD_FAILURE;
+                instr_spc_rsp = SHTDWN_ENABLED;
+                break;
+            }
             arm_power = payload;
+            if (arm_power) arm_attach();
+            else           arm_detach();
             result = RESULT_SUCCESS;
             if(arm_power){instr_spc_rsp = ARM_ENABLED; }
             else         {instr_spc_rsp = ARM_DISABLED;}
@@ -251,7 +357,108 @@ void system_cmd(system_format_t sys, step_mot_t* F_L, step_mot_t* F_R, step_mot_
         break;
 
         case EMERGENCY_SHTDWN:
-            result = RESULT_CMD_FAILURE;
+            if (payload == ESTOP_RELEASE) {
+                // Power stays off; ROBOT_POWER / ARM_POWER_CMD bring it back
+                sys_shtdwn = 0;
+                ESP_LOGI(CMD_TAG, "System CMD - E-stop released");
+                instr_spc_rsp = SHTDWN_DISABLED;
+            } else {
+                robot_estop(ESTOP_EXEC, 0);     // Usually done already in the BLE callback
+                instr_spc_rsp = SHTDWN_ENABLED;
+            }
+            result = RESULT_SUCCESS;
+        break;
+
+        case NOTIFY_MODE:
+            if( payload != 0 && payload != 1){
+                ESP_LOGW(CMD_TAG, "System CMD - Notify Mode Unclear");
+                result = RESULT_INVALID_PARAMS;
+                break;
+            }
+            notify_mode = payload;              // The ACK below already uses it
+            result = RESULT_SUCCESS;
+            if(notify_mode){instr_spc_rsp = NOTIFY_BINARY; }
+            else           {instr_spc_rsp = NOTIFY_TEXT;}
+        break;
+
+        case DRIVE_MODE: {
+            uint32_t mode = payload & 0xFF;
+            uint32_t wd_ms = (payload >> 8) & 0xFFFF;
+            if (mode > 1 || wd_ms > DRIVE_WATCHDOG_MAX_MS) {
+                ESP_LOGW(CMD_TAG, "System CMD - Drive Mode Unclear");
+                result = RESULT_INVALID_PARAMS;
+                break;
+            }
+            // Either way the current vector stops; the next CONTROL uses the new mode
+            traj_stop();
+            if (drive) drivetrain_set(drive, (int8_t[WHEEL_COUNT]){0}, 0);
+            drive_mode = mode;
+            drive_watchdog_ms = wd_ms ? wd_ms : DRIVE_WATCHDOG_MS;
+            ESP_LOGI(CMD_TAG, "System CMD - Drive mode %d, watchdog %u ms", drive_mode, (unsigned)drive_watchdog_ms);
+            result = RESULT_SUCCESS;
+            if(drive_mode){instr_spc_rsp = DRIVE_SETPOINT; }
+            else          {instr_spc_rsp = DRIVE_PULSE;}
+        break;
+        }
+
+        case ACK_MODE: {
+            uint32_t mode = payload & 0xFF;
+            uint32_t hold_ms = (payload >> 8) & 0xFFFF;
+            if (mode > 1 || hold_ms > ACK_HOLD_MAX_MS) {
+                ESP_LOGW(CMD_TAG, "System CMD - ACK Mode Unclear");
+                result = RESULT_INVALID_PARAMS;
+                break;
+            }
+            ack_mode = mode;
+            ack_hold_ms = hold_ms ? hold_ms : ACK_RANGE_HOLD_MS;
+            ack_win_ms = 0;
+            ESP_LOGI(CMD_TAG, "System CMD - ACK mode %d, hold %u ms", ack_mode, (unsigned)ack_hold_ms);
+            result = RESULT_SUCCESS;
+            if(ack_mode){instr_spc_rsp = ACK_RANGES; }
+            else        {instr_spc_rsp = ACK_EACH;}
+        break;
+        }
+
+        case CONTROL_OWNER:
+            if( payload != 0 && payload != 1){
+                ESP_LOGW(CMD_TAG, "System CMD - Control Owner Unclear");
+                result = RESULT_INVALID_PARAMS;
+                break;
+            }
+            if (!payload) {
+                ble_control_release(cmd_conn);
+                instr_spc_rsp = CONTROL_RELEASED;
+            } else if (ble_control_claim(cmd_conn)) {
+                instr_spc_rsp = CONTROL_GRANTED;
+            } else {
+                result = RESULT_CMD_FAILURE;
+                instr_spc_rsp = CONTROL_HELD;
+            }
+        break;
+
+        case SUBSCRIBE: {
+            uint32_t topics = payload & 0xFF;
+            uint32_t gap_ms = (payload >> 8) & 0xFFFF;
+            if ((topics & ~(uint32_t)TOPIC_ALL) || gap_ms > TLM_GAP_MAX_MS || (payload >> 24)) {
+                ESP_LOGW(CMD_TAG, "System CMD - Unknown Topics 0x%x", (unsigned)payload);
+                result = RESULT_INVALID_PARAMS;
+                break;
+            }
+            ble_session_subscribe(cmd_conn, (uint8_t)topics, (uint16_t)gap_ms);   // Without TOPIC_ACK this is the last ACK
+            instr_spc_rsp = TOPICS_SET;
+        break;
+        }
+
+        case LINK_ECHO:
+            if( payload != 0 && payload != 1){
+                ESP_LOGW(CMD_TAG, "System CMD - Link Echo Unclear");
+                result = RESULT_INVALID_PARAMS;
+                break;
+            }
+            ble_session_set_echo(cmd_conn, payload);
+            ESP_LOGI(CMD_TAG, "System CMD - Link echo %s on slot %d", payload ? "on" : "off", cmd_conn);
+            if(payload){instr_spc_rsp = ECHO_ON; }
+            else       {instr_spc_rsp = ECHO_OFF;}
         break;
 
         default:
@@ -259,20 +466,20 @@ void system_cmd(system_format_t sys, step_mot_t* F_L, step_mot_t* F_R, step_mot_
             break;
     }
 
-    send_ack(sys.id, result, security_flag, instr_spc_rsp);
+    send_ack(sys.id, result, instr_spc_rsp);
 }
 void query_cmd(query_format_t query, step_mot_t* F_L, step_mot_t* F_R, step_mot_t* B_L, step_mot_t* B_R){
-    ESP_LOGI(CMD_TAG, "Executing Query CMD");
-    
     uint64_t inst_type = (uint64_t)query.instruction;
+    TRACE(CMD, QUERY_CMD, query.id, inst_type, 0);
     uint8_t result = RESULT_SUCCESS;
     uint64_t instr_spc_rsp = NO_INFO;
 
     switch (inst_type)
     {
         case SECURITY_STATUS: 
-            if(security_flag){instr_spc_rsp = SECURITY_ON; }
-            else             {instr_spc_rsp = SECURITY_OFF;}
+            if(!ble_session_secure(cmd_conn))         {instr_spc_rsp = SECURITY_OFF;}
+            else if(gcm_suite() == GCM_SUITE_CHACHA)  {instr_spc_rsp = SECURITY_ON_CHACHA;}
+            else                                      {instr_spc_rsp = SECURITY_ON; }
 
         break;
 
@@ -281,15 +488,20 @@ void query_cmd(query_format_t query, step_mot_t* F_L, step_mot_t* F_R, step_mot_
             else           {instr_spc_rsp = MOTORS_DISABLED;}
         break;
 
-        case CURRENT_POSITION:
-            // TODO: READ IMU
-            result = RESULT_CMD_FAILURE;
+        case CURRENT_POSITION: {        // NAV word from the odometry estimate, then the ACK, as the GS cache answers
+            robot_bt_packet_t nav = build_imu(0);
+            ack_flush();
+            send_cmd_to(cmd_conn, nav.bytes);
         break;
+        }
 
-        case ROBOT_BATT:
-            // TODO : Battery Check
-            result = RESULT_CMD_FAILURE;
+        case ROBOT_BATT: {
+            // Percent in info, as the GS cache answers. 0 is NO_INFO, which an
+            // ACK range would hold and trace_lat_ack replace, so empty reads 1
+            uint8_t pct = battery_percent();
+            instr_spc_rsp = pct ? pct : 1;
         break;
+        }
 
         case ARM_POWER:
             if(arm_power){instr_spc_rsp = ARM_ENABLED; }
@@ -301,6 +513,11 @@ void query_cmd(query_format_t query, step_mot_t* F_L, step_mot_t* F_R, step_mot_
             else          {instr_spc_rsp = SHTDWN_DISABLED;}
         break;
 
+        case CLOCK_SYNC:
+            ack_flush();                // Out first, so the hold below ends at our own notify
+            instr_spc_rsp = clock_sync_info(cmd_rx_us, trace_now_us() - cmd_rx_us);
+        break;
+
         default:
             result = RESULT_UNSUPPORTED_CMD;
         break;
@@ -308,12 +525,38 @@ void query_cmd(query_format_t query, step_mot_t* F_L, step_mot_t* F_R, step_mot_
     }
 
 
-    send_ack(query.id, result, security_flag, instr_spc_rsp);
+    send_ack(query.id, result, instr_spc_rsp);
 }
 
 
-void send_imu(int part) {
+void drive_attach(drivetrain_t* dt) {
+    drive = dt;
+}
+
+// Flags first, so a CONTROL or ARM the executor is about to run is refused,
+// then the hardware. Nothing here blocks, which is what lets the BLE
+// callback call it.
+void robot_estop(int src, int64_t t_rx_us) {
+    motor_power = 0;
+    arm_power = 0;
+    sys_shtdwn = 1;
+    if (drive) drivetrain_estop(drive);
+    arm_detach();
+
+    uint32_t us = t_rx_us ? (uint32_t)(esp_timer_get_time() - t_rx_us) : 0;
+    if (us > estop_worst_us) estop_worst_us = us;
+    TRACE(CMD, ESTOP, src, us, estop_worst_us);
+    if (src == ESTOP_FAST) ESP_LOGW(CMD_TAG, "E-STOP in %u us (worst %u us)", (unsigned)us, (unsigned)estop_worst_us);
+}
+
+uint32_t robot_estop_worst_us(void) {
+    return estop_worst_us;
+}
+
+robot_bt_packet_t build_imu(int part) {
     robot_bt_packet_t pkt = {0};
+    imu_sample_t imu = {0};
+    if (part != 0) imu_get(&imu);
 
     // PART 0: NAV
     if (part == 0) {
@@ -321,14 +564,15 @@ void send_imu(int part) {
         pkt.nav.type = ROBOT_UPDATE_CMD;
         pkt.nav.part = 0; 
 
-        pkt.nav.speed = 0; 
+        odom_pose_t odom;
+        odom_get(&odom);
+        int32_t v = abs(odom.speed_mm_s) / 10;  // cm/s, 7 bits
+        pkt.nav.speed = v > 127 ? 127 : (uint8_t)v;
 
-        // Position in mm
-        pkt.nav.pos_x = 0;
-        pkt.nav.pos_y = 0;
+        // Position in mm (wraps past +-32 m)
+        pkt.nav.pos_x = (int16_t)(odom.x_um / 1000);
+        pkt.nav.pos_y = (int16_t)(odom.y_um / 1000);
         pkt.nav.pos_z = 0;
-
-        send_cmd(pkt.bytes, security_flag);
     }
 
     // PART 1: POSE
@@ -337,11 +581,9 @@ void send_imu(int part) {
         pkt.pose.type = ROBOT_UPDATE_CMD;
         pkt.pose.part = 1; 
 
-        pkt.pose.yaw   = (uint32_t)(g_imu_euler.yaw * 1000.0f);
-        pkt.pose.pitch = (int32_t)(g_imu_euler.pitch * 1000.0f);
-        pkt.pose.roll  = (int32_t)(g_imu_euler.roll * 1000.0f);
-
-        send_cmd(pkt.bytes, security_flag);
+        pkt.pose.yaw   = (uint32_t)imu.euler.yaw;     // Already mdeg
+        pkt.pose.pitch = imu.euler.pitch;
+        pkt.pose.roll  = imu.euler.roll;
     }
 
     // PART 2: INERTIA
@@ -350,41 +592,70 @@ void send_imu(int part) {
         pkt.inert.type = ROBOT_UPDATE_CMD;
         pkt.inert.part = 2; 
 
-        pkt.inert.accel_x = (int16_t)(g_imu_accel.x * 10.0f);
-        pkt.inert.accel_y = (int16_t)(g_imu_accel.y * 10.0f);
-        pkt.inert.accel_z = (int16_t)(g_imu_accel.z * 10.0f);
+        pkt.inert.accel_x = IMU_ACCEL_D10(imu.accel.x);
+        pkt.inert.accel_y = IMU_ACCEL_D10(imu.accel.y);
+        pkt.inert.accel_z = IMU_ACCEL_D10(imu.accel.z);
 
-        pkt.inert.gyro_x  = (int16_t)(g_imu_gyro.x_degs * 10.0f);
-        pkt.inert.gyro_y  = (int16_t)(g_imu_gyro.y_degs * 10.0f);
-        pkt.inert.gyro_z  = (int16_t)(g_imu_gyro.z_degs * 10.0f);
-
-        send_cmd(pkt.bytes, security_flag);
+        pkt.inert.gyro_x  = IMU_GYRO_D10(imu.gyro.x);
+        pkt.inert.gyro_y  = IMU_GYRO_D10(imu.gyro.y);
+        pkt.inert.gyro_z  = IMU_GYRO_D10(imu.gyro.z);
     }
-    else {
-        send_imu(0);
-        vTaskDelay(pdMS_TO_TICKS(5));
 
-        send_imu(1);
-        vTaskDelay(pdMS_TO_TICKS(5));
+    return pkt;
+}
 
-        send_imu(2);
+void send_imu(int part) {
+    if (part >= 0 && part <= 2) {
+        robot_bt_packet_t pkt = build_imu(part);
+        send_cmd(pkt.bytes);
+    }
+    else {
+        // All three parts in one notification
+        robot_bt_packet_t parts[3] = { build_imu(0), build_imu(1), build_imu(2) };
+        send_cmd_batch(parts, 3);
     }
 }
 
-void send_health_report(){
+robot_bt_packet_t build_health_report(){
     robot_bt_packet_t health_report = {0};
     health_report.health.pl   = 1;
     health_report.health.type = HEALTH_CMD;
-    health_report.health.battery  = 100; // TODO
-    health_report.health.sec_en = security_flag;
+    health_report.health.battery  = battery_percent();
+    health_report.health.sec_en = ble_session_secure(-1);    // Any central sealed
     health_report.health.motor_en = motor_power;
     health_report.health.arm_en = arm_power;
+    uint8_t traj, seg;
+    traj_progress(&traj, &seg);
+    health_report.health.traj = traj;
+    health_report.health.traj_seg = seg;
+
+    txq_stats_t tx;
+    txq_stats(&tx);
+    health_report.health.tx_depth = ble_tx_depth();
+    health_report.health.tx_drops = tx.drops > 0xFFF ? 0xFFF : tx.drops;
+    health_report.health.credits = ble_rx_pool_credits();
+    return health_report;
+}
 
-    send_cmd(health_report.bytes, security_flag);
+void send_health_report(){
+    robot_bt_packet_t health_report = build_health_report();
+
+    send_cmd(health_report.bytes);
 
     ESP_LOGI(CMD_TAG, "Sending Health Report");
 }
 
-void send_HPA(){
-
+void send_HPA(uint8_t alert, int16_t value, uint16_t limit, bool cleared){
+    static uint8_t seq = 0;
+    robot_bt_packet_t hpr = {0};
+    hpr.hpr.pl         = 1;
+    hpr.hpr.type       = HPR_CMD;
+    hpr.hpr.alert_type = alert;
+    hpr.hpr.cleared    = cleared;
+    hpr.hpr.value      = value;
+    hpr.hpr.limit      = limit;
+    hpr.hpr.seq        = seq++;
+
+    send_cmd(hpr.bytes);                    // TXQ_URGENT: ahead of queued reports
+    TRACE(CMD, HPR, alert, cleared, value);
 }
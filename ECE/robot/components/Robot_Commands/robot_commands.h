@@ -3,26 +3,76 @@
 
 #include "../stepper_motor/stepper_motor.h"
 #include "pinout.h"
+#include "freertos/FreeRTOS.h"
 #include <stdio.h>
 #include <string.h>
 
 //Robot State Variables
-extern volatile int security_flag;
 extern volatile uint16_t AC;        // Stored in NVS
 extern volatile int motor_power;
 extern char robot_name[32];         // Stored in NVS
 extern volatile int arm_power;
 extern volatile int sys_shtdwn;
+extern volatile int notify_mode;    // NOTIFY_MODE: 0 = hex text, 1 = tagged binary
+extern volatile int drive_mode;     // DRIVE_MODE: 0 = 200 ms pulses, 1 = setpoint
+extern volatile uint32_t drive_watchdog_ms;
+extern volatile int ack_mode;       // ACK_MODE: 0 = ACK each command, 1 = ranges (ack_range_t)
+extern volatile uint32_t ack_hold_ms;
+extern volatile uint32_t cmd_rx_us;  // Arrival of the command executing (esp_timer, low 32 bits)
+extern volatile int cmd_conn;        // connected_devices[] slot it came from: its session, its ACKs
 
+// Setpoint mode: a CONTROL vector holds until the next one, and stops when
+// no command of any kind arrives for drive_watchdog_ms (the deadman)
+#ifndef DRIVE_WATCHDOG_MS
+#define DRIVE_WATCHDOG_MS     1000
+#endif
+#define DRIVE_WATCHDOG_MAX_MS 10000
 
-void send_ack(uint16_t id, uint8_t result, int secure, uint64_t instr_specfic);
-void control_cmd(control_format_t ctrl, step_mot_t* F_L, step_mot_t* F_R, step_mot_t* B_L, step_mot_t* B_R);
+// ACK_MODE ranges: plain successes wait for company, up to a window that
+// adapts to the load (ack_window_ms()): 0 while commands come one at a
+// time, growing by connection intervals while they queue up behind each
+// other or the notify queue backs up, never past ack_hold_ms.
+// Failures, ACKs with info and HPR alerts are never held.
+#define ACK_HOLD_MAX_MS       1000
+
+// control_cmd wheel mixing (table in robot_command.c). Ratios are per wheel
+// in 1/DRIVE_RATIO_ONE of the commanded speed; the slow side of a diagonal
+// runs at DRIVE_TURN_RATIO.
+#define DRIVE_RATIO_ONE       256
+#ifndef DRIVE_TURN_RATIO
+#define DRIVE_TURN_RATIO      (DRIVE_RATIO_ONE / 2)
+#endif
+
+// robot_estop() callers: the BLE callback (before the word is queued) and
+// the executor's EMERGENCY_SHTDWN. Both run it; the second one is a no-op
+// for the hardware and still answers the ACK.
+enum { ESTOP_FAST = 0, ESTOP_EXEC };
+
+typedef struct {
+    const char *name;
+    int16_t ratio[WHEEL_COUNT];
+} drive_mix_t;
+
+
+void send_ack(uint16_t id, uint8_t result, uint64_t instr_specfic);   // To cmd_conn's central
+void ack_flush(void);               // Send the held ACK range now (no-op when empty)
+TickType_t ack_wait(void);          // Ticks until it is due, portMAX_DELAY if none held
+void ack_poll(void);                // Send it if due
+uint32_t ack_window_ms(void);       // Current hold, ms
+void control_cmd(control_format_t ctrl, drivetrain_t* dt);
 void arm_cmd   (arm_format_t arm, step_mot_t* F_L, step_mot_t* F_R, step_mot_t* B_L, step_mot_t* B_R);
+void arm_target_cmd(arm_target_format_t armt);
 void system_cmd (system_format_t sys, step_mot_t* F_L, step_mot_t* F_R, step_mot_t* B_L, step_mot_t* B_R);
 void query_cmd  (query_format_t query, step_mot_t* F_L, step_mot_t* F_R, step_mot_t* B_L, step_mot_t* B_R);
+void drive_attach(drivetrain_t* dt);  // Stopped by System cmds (nav report: components/Odometry)
+void robot_estop(int src, int64_t t_rx_us);  // Any task; t_rx_us = arrival (esp_timer), 0 = unknown
+uint32_t robot_estop_worst_us(void);  // Slowest arrival -> drivers off so far
 
-void send_imu(int part);
+// build_* fill a report word without sending it (for send_cmd_batch)
+robot_bt_packet_t build_imu(int part);
+robot_bt_packet_t build_health_report();
+void send_imu(int part);            // part outside 0..2 sends all three as one batch
 void send_health_report();
-void send_HPA();
+void send_HPA(uint8_t alert, int16_t value, uint16_t limit, bool cleared);   // enum hpr_alerts; urgent, never batched
 
 #endif
\ No newline at end of file
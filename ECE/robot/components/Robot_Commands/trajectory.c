@@ -0,0 +1,164 @@
+#include "trajectory.h"
+
+#include "robot_commands.h"
+#include "ble_rx_pool.h"
+#include "telemetry.h"
+#include "arm.h"
+#include "trace.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#define TRAJ_TAG "TRAJ"
+
+static drivetrain_t      *traj_dt;
+static esp_timer_handle_t traj_timer;               // Wakes the executor at a segment's end
+static robot_bt_packet_t traj_drive[TRAJ_SEGS_MAX];  // TRAJ_OP_DRIVE word per slot, raw 0 = not loaded
+static robot_bt_packet_t traj_arm[TRAJ_SEGS_MAX];    // TRAJ_OP_ARM word, raw 0 = none
+static int      traj_count;                         // Segments in the running trajectory
+static uint16_t traj_id;                            // Its RUN id
+static int64_t  traj_end_us;                        // Running segment's end (esp_timer)
+static volatile uint8_t traj_state = TRAJ_IDLE;
+static volatile uint8_t traj_seg;
+
+static void traj_wake(void *arg) {
+    (void)arg;
+    ble_rx_pool_wake();
+}
+
+void traj_init(drivetrain_t *dt) {
+    traj_dt = dt;
+    const esp_timer_create_args_t args = {
+        .callback = traj_wake,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "traj",
+    };
+    if (esp_timer_create(&args, &traj_timer) != ESP_OK) ESP_LOGE(TRAJ_TAG, "Timer create failed!");
+}
+
+void traj_progress(uint8_t *state, uint8_t *seg) {
+    *state = traj_state;
+    *seg = traj_seg;
+}
+
+static void traj_set_state(uint8_t state) {
+    if (traj_state == state) return;
+    traj_state = state;
+    telemetry_request(TLM_HEALTH);
+}
+
+static void traj_end(uint8_t state) {
+    esp_timer_stop(traj_timer);
+    drivetrain_set(traj_dt, (int8_t[WHEEL_COUNT]){0}, 0);
+    TRACE(CMD, TRAJ, traj_seg, 0, state);
+    traj_set_state(state);
+}
+
+static void traj_begin(int i) {
+    traj_drive_format_t d = traj_drive[i].trajd;
+    int8_t vel[WHEEL_COUNT] = { d.fl, d.fr, d.bl, d.br };
+
+    traj_seg = i;
+    traj_end_us += (int64_t)d.ms * 1000;
+    drivetrain_set(traj_dt, vel, d.ms + TRAJ_HOLD_SLACK_MS);
+    TRACE(CMD, TRAJ, i, d.ms, TRAJ_RUNNING);
+
+    if (traj_arm[i].raw && arm_power) {
+        traj_arm_format_t a = traj_arm[i].traja;
+        arm_set_speed(a.speed / 127.0f);
+        if (arm_move_sync((float)a.x / ARMT_UNITS_PER_IN, (float)a.y / ARMT_UNITS_PER_IN,
+                          (float)a.z / ARMT_UNITS_PER_IN) != 0)
+            ESP_LOGW(TRAJ_TAG, "Segment %d arm target rejected", i);   // The wheels go on
+    }
+
+    int64_t left = traj_end_us - esp_timer_get_time();
+    esp_timer_stop(traj_timer);
+    esp_timer_start_once(traj_timer, left > 0 ? (uint64_t)left : 1);
+    telemetry_request(TLM_HEALTH);
+}
+
+void traj_stop(void) {
+    if (traj_state == TRAJ_RUNNING) traj_end(TRAJ_ABORTED);
+}
+
+void traj_poll(void) {
+    if (traj_state != TRAJ_RUNNING) return;
+    if (sys_shtdwn || !motor_power) {
+        traj_end(TRAJ_ABORTED);
+        return;
+    }
+    if (esp_timer_get_time() < traj_end_us) return;
+    if (traj_seg + 1 < traj_count) traj_begin(traj_seg + 1);
+    else traj_end(TRAJ_DONE);
+}
+
+static void traj_run(traj_ctl_format_t c) {
+    if (traj_state == TRAJ_RUNNING && c.id == traj_id) {   // A resend: the first one got through
+        send_ack(c.id, RESULT_SUCCESS, NO_INFO);
+        return;
+    }
+    if (!motor_power) {
+        send_ack(c.id, RESULT_CMD_FAILURE, MOTORS_DISABLED);
+        return;
+    }
+    if (c.count == 0 || c.count > TRAJ_SEGS_MAX) {
+        send_ack(c.id, RESULT_INVALID_PARAMS, NO_INFO);
+        return;
+    }
+
+    uint16_t crc = 0xFFFF;
+    bool arm = false;
+    for (int i = 0; i < c.count; i++) {
+        if (!traj_drive[i].raw) {
+            send_ack(c.id, RESULT_INVALID_PARAMS, TRAJ_INCOMPLETE);
+            return;
+        }
+        crc = traj_crc(crc, traj_drive[i].raw);
+        if (traj_arm[i].raw) crc = traj_crc(crc, traj_arm[i].raw);
+        arm |= traj_arm[i].raw != 0;
+    }
+    if (crc != c.crc) {
+        ESP_LOGW(TRAJ_TAG, "RUN %u: crc %04x, loaded %04x", (unsigned)c.id, (unsigned)c.crc, crc);
+        send_ack(c.id, RESULT_INVALID_PARAMS, TRAJ_CRC_MISMATCH);
+        return;
+    }
+    if (arm && !arm_power) {
+        send_ack(c.id, RESULT_CMD_FAILURE, ARM_DISABLED);
+        return;
+    }
+
+    traj_stop();
+    traj_count = c.count;
+    traj_id = c.id;
+    traj_end_us = esp_timer_get_time();
+    traj_set_state(TRAJ_RUNNING);
+    traj_begin(0);
+    send_ack(c.id, RESULT_SUCCESS, NO_INFO);
+}
+
+void traj_cmd(const robot_bt_packet_t *cmd) {
+    switch (cmd->trajd.op) {
+        case TRAJ_OP_DRIVE:
+        case TRAJ_OP_ARM: {
+            int i = cmd->trajd.idx;             // Same bits in both layouts
+            if (i >= TRAJ_SEGS_MAX) {
+                ESP_LOGW(TRAJ_TAG, "Segment %d past TRAJ_SEGS_MAX", i);
+                return;
+            }
+            traj_stop();                        // A new upload replaces the running one
+            if (cmd->trajd.op == TRAJ_OP_DRIVE) {
+                traj_drive[i] = *cmd;
+                traj_arm[i].raw = 0;
+            } else {
+                traj_arm[i] = *cmd;
+            }
+            return;
+        }
+        case TRAJ_OP_RUN:
+            traj_run(cmd->trajc);
+            return;
+        case TRAJ_OP_ABORT:
+            traj_stop();
+            send_ack(cmd->trajc.id, RESULT_SUCCESS, NO_INFO);
+            return;
+    }
+}
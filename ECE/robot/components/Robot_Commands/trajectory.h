@@ -0,0 +1,31 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <stdint.h>
+#include "stepper_motor.h"
+#include "cmd_codec.h"
+
+/*
+ * On-robot trajectory runner (TRAJ_CMD, cmd_codec.h Trajectory). Segment
+ * words are stored by idx as they arrive; TRAJ_OP_RUN checks them and
+ * starts segment 0. Each segment is one drivetrain_set() held a little
+ * past its ms (TRAJ_HOLD_SLACK_MS, so a late executor never sees the
+ * wheels drop out between segments) and, with an arm word, one
+ * arm_move_sync(). Segment ends are kept on an absolute schedule from the
+ * RUN, so a late wake-up shortens the next segment instead of shifting
+ * the rest of the path; a one-shot timer wakes the executor for them.
+ *
+ * Everything but traj_progress() runs on the executor task.
+ */
+
+#ifndef TRAJ_HOLD_SLACK_MS
+#define TRAJ_HOLD_SLACK_MS  200
+#endif
+
+void traj_init(drivetrain_t *dt);
+void traj_cmd(const robot_bt_packet_t *cmd);
+void traj_poll(void);                               // Executor loop: segment ends, power loss
+void traj_stop(void);                               // A running trajectory ends ABORTED
+void traj_progress(uint8_t *state, uint8_t *seg);   // enum traj_states, segment (any task)
+
+#endif
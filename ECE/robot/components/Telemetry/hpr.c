@@ -0,0 +1,179 @@
+#include "hpr.h"
+
+#include <stdlib.h>
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "Robot_BLE.h"
+#include "ble_rx_pool.h"
+#include "ble_tx_queue.h"
+#include "robot_commands.h"
+#include "imu.h"
+#include "task_alloc.h"
+
+#define HPR_TAG "HPR"
+
+#define HPR_G_Q8    2511                // 9.80665 m/s^2 in Q8
+
+typedef struct {
+    uint16_t limit;                     // 0 = off
+    bool     active;
+    bool     announced;                 // The raise went out (a central was connected)
+    int64_t  raised_us;
+    int16_t  value;                     // As raised
+} hpr_alert_t;
+
+static hpr_alert_t   hpr_alerts[HPR_ALERTS] = {
+    [HPR_TIP_OVER]    = { .limit = HPR_TIP_DEG10 },
+    [HPR_IMPACT]      = { .limit = HPR_IMPACT_D10 },
+    [HPR_SPIN]        = { .limit = HPR_SPIN_D10 },
+    [HPR_MOTOR_STALL] = { .limit = HPR_STALL_MS },
+    [HPR_RX_FULL]     = { .limit = HPR_RX_FULL_SLOTS },
+    [HPR_TX_DROPS]    = { .limit = HPR_TX_DROPS_MAX },
+    [HPR_IMU_LOST]    = { .limit = HPR_IMU_LOST_MS },
+};
+static hpr_stats_t   hpr_counts;
+static TaskHandle_t  hpr_task_handle = NULL;
+static drivetrain_t *hpr_dt = NULL;
+
+static int16_t clamp16(int32_t v) {
+    return v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : (int16_t)v;
+}
+
+static uint32_t isqrt32(uint32_t x) {
+    uint32_t r = 0, bit = 1u << 30;
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= r + bit) { x -= r + bit; r = (r >> 1) + bit; }
+        else r >>= 1;
+        bit >>= 2;
+    }
+    return r;
+}
+
+// One alert's reading: raise when mag reaches the limit, clear under
+// HPR_CLEAR_PCT of it once the hold-off has passed; at most one word either
+// way, carrying value (mag itself for all but the stall's wheel)
+static void hpr_check_as(uint8_t id, int32_t mag, int32_t value, int64_t now_us) {
+    hpr_alert_t *a = &hpr_alerts[id];
+    if (!a->limit) {
+        a->active = false;
+        return;
+    }
+    mag = abs(mag);
+
+    if (!a->active) {
+        if (mag < a->limit) return;
+        a->active = true;
+        a->announced = false;
+        a->raised_us = now_us;
+        a->value = clamp16(value);
+        hpr_counts.raised[id]++;
+        ESP_LOGW(HPR_TAG, "Alert %u: %d (limit %u)", id, (int)mag, a->limit);
+    }
+    if (!a->announced && num_connected > 0) {
+        send_HPA(id, a->value, a->limit, false);
+        a->announced = true;
+    }
+    if (mag * 100 < (int32_t)a->limit * HPR_CLEAR_PCT &&
+        now_us - a->raised_us >= (int64_t)HPR_HOLDOFF_MS * 1000) {
+        a->active = false;
+        hpr_counts.cleared[id]++;
+        if (a->announced) send_HPA(id, clamp16(value), a->limit, true);
+    }
+}
+
+static void hpr_check(uint8_t id, int32_t value, int64_t now_us) {
+    hpr_check_as(id, value, value, now_us);
+}
+
+static void hpr_check_imu(const imu_sample_t *s, int64_t now_us) {
+    int32_t pitch = abs(s->euler.pitch), roll = abs(s->euler.roll);
+    hpr_check(HPR_TIP_OVER, (pitch > roll ? pitch : roll) / 100, now_us);
+
+    int32_t ax = s->accel.x, ay = s->accel.y, az = s->accel.z;
+    uint32_t a = isqrt32((uint32_t)(ax * ax) + (uint32_t)(ay * ay) + (uint32_t)(az * az));
+    hpr_check(HPR_IMPACT, ((int32_t)a - HPR_G_Q8) * 10 / 256, now_us);
+
+    int32_t gx = s->gyro.x, gy = s->gyro.y, gz = s->gyro.z;
+    uint32_t g = isqrt32((uint32_t)(gx * gx) + (uint32_t)(gy * gy) + (uint32_t)(gz * gz));
+    hpr_check(HPR_SPIN, (int32_t)((g * 18335u) >> 14), now_us);    // IMU_GYRO_D10 without the int16 cast
+}
+
+// A wheel that should be stepping and is not: worst one, by how long
+static void hpr_check_motors(int64_t now_us) {
+    static int32_t last_steps[WHEEL_COUNT];
+    static int64_t moved_us[WHEEL_COUNT];
+    int32_t worst_ms = 0, wheel = 0;
+
+    for (int i = 0; i < WHEEL_COUNT && hpr_dt; i++) {
+        int32_t steps = stepper_steps(hpr_dt->m[i]);
+        if (!hpr_dt->holding || hpr_dt->vel[i] == 0 || steps != last_steps[i]) {
+            last_steps[i] = steps;
+            moved_us[i] = now_us;
+            continue;
+        }
+        int32_t ms = (int32_t)((now_us - moved_us[i]) / 1000);
+        if (ms > worst_ms) { worst_ms = ms; wheel = i; }
+    }
+    hpr_check_as(HPR_MOTOR_STALL, worst_ms, wheel, now_us);   // The limit is a time, the word names the wheel
+}
+
+static void hpr_check_queues(int64_t now_us) {
+    static int64_t window_us;
+    static uint32_t window_drops;
+
+    hpr_check(HPR_RX_FULL, ble_rx_pool_used(), now_us);
+
+    if (now_us - window_us >= (int64_t)HPR_TX_WINDOW_MS * 1000) {
+        txq_stats_t tx;
+        txq_stats(&tx);
+        hpr_check(HPR_TX_DROPS, (int32_t)(tx.drops - window_drops), now_us);
+        window_drops = tx.drops;
+        window_us = now_us;
+    }
+}
+
+static void hpr_task(void *arg) {
+    (void)arg;
+    imu_sample_t s;
+    uint32_t seen = 0;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(HPR_TICK_MS));
+        int64_t now = esp_timer_get_time();
+
+        if (imu_get(&s)) {
+            if (s.packets != seen) {
+                seen = s.packets;
+                hpr_check_imu(&s, now);
+            }
+            hpr_check(HPR_IMU_LOST, clamp16((int32_t)((now - s.t_us) / 1000)), now);
+        }
+        hpr_check_motors(now);
+        hpr_check_queues(now);
+    }
+}
+
+bool hpr_start(drivetrain_t *dt, BaseType_t core, UBaseType_t prio) {
+    if (hpr_task_handle) return true;
+    hpr_dt = dt;
+
+    if (TASK_CREATE_PINNED(hpr_task, "hpr", STACK_HPR, NULL, prio, &hpr_task_handle, core) != pdPASS) {
+        ESP_LOGE(HPR_TAG, "Task creation failed!");
+        hpr_task_handle = NULL;
+        return false;
+    }
+    imu_notify_task(hpr_task_handle);
+    return true;
+}
+
+bool hpr_set_limit(uint8_t alert, uint16_t limit) {
+    if (alert == 0 || alert >= HPR_ALERTS) return false;
+    hpr_alerts[alert].limit = limit;
+    return true;
+}
+
+void hpr_stats(hpr_stats_t *out) {
+    *out = hpr_counts;
+}
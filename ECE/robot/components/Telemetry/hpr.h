@@ -0,0 +1,80 @@
+#ifndef HPR_H
+#define HPR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "stepper_motor.h"
+
+/*
+ * High-priority alerts. A small task checks a set of thresholds at sensor
+ * rate: the IMU reader wakes it with every new sample (imu_notify_task()),
+ * and HPR_TICK_MS covers the checks that do not wait for one (motors,
+ * queues, a silent IMU). A crossing goes out at once as one HPR word
+ * (cmd_codec.h, enum hpr_alerts) through send_HPA(): the urgent TX class
+ * that ACKs use, never held for a telemetry pass or merged into a batch.
+ *
+ *   HPR_TIP_OVER     max(|pitch|, |roll|) >= HPR_TIP_DEG10
+ *   HPR_IMPACT       ||accel| - 1 g| >= HPR_IMPACT_D10 (a hit, a fall)
+ *   HPR_SPIN         |gyro| >= HPR_SPIN_D10
+ *   HPR_MOTOR_STALL  a wheel driven for HPR_STALL_MS without a step counted
+ *   HPR_RX_FULL      every RX pool slot in use (commands about to be refused)
+ *   HPR_TX_DROPS     HPR_TX_DROPS_MAX report words dropped in HPR_TX_WINDOW_MS
+ *   HPR_IMU_LOST     no IMU sample for HPR_IMU_LOST_MS (after the first one)
+ *
+ * Each alert is raised once and cleared once (hpr.cleared = 1) when its
+ * value is back under HPR_CLEAR_PCT of the limit, no sooner than
+ * HPR_HOLDOFF_MS after it was raised, so a condition that hovers at the
+ * limit does not flood the link. One raised while no central is connected
+ * goes out when the first one connects, if it still holds.
+ *
+ * Limits: -D at build time, or hpr_set_limit() at run time; 0 turns an
+ * alert off.
+ */
+
+#ifndef HPR_TICK_MS
+#define HPR_TICK_MS         20
+#endif
+#ifndef HPR_HOLDOFF_MS
+#define HPR_HOLDOFF_MS      1000
+#endif
+#ifndef HPR_CLEAR_PCT
+#define HPR_CLEAR_PCT       80
+#endif
+#ifndef HPR_TIP_DEG10
+#define HPR_TIP_DEG10       450         // 45 deg
+#endif
+#ifndef HPR_IMPACT_D10
+#define HPR_IMPACT_D10      150         // 15 m/s^2 off 1 g, about 1.5 g
+#endif
+#ifndef HPR_SPIN_D10
+#define HPR_SPIN_D10        3600        // One turn per second
+#endif
+#ifndef HPR_STALL_MS
+#define HPR_STALL_MS        300
+#endif
+#ifndef HPR_RX_FULL_SLOTS
+#define HPR_RX_FULL_SLOTS   BLE_RX_POOL_SIZE
+#endif
+#ifndef HPR_TX_WINDOW_MS
+#define HPR_TX_WINDOW_MS    1000
+#endif
+#ifndef HPR_TX_DROPS_MAX
+#define HPR_TX_DROPS_MAX    8
+#endif
+#ifndef HPR_IMU_LOST_MS
+#define HPR_IMU_LOST_MS     500
+#endif
+
+#define HPR_ALERTS          8           // enum hpr_alerts, 1-based
+
+typedef struct {
+    uint32_t raised[HPR_ALERTS];
+    uint32_t cleared[HPR_ALERTS];
+} hpr_stats_t;
+
+bool hpr_start(drivetrain_t *dt, BaseType_t core, UBaseType_t prio);
+bool hpr_set_limit(uint8_t alert, uint16_t limit);   // false = no such alert
+void hpr_stats(hpr_stats_t *out);
+
+#endif
@@ -0,0 +1,285 @@
+#include "telemetry.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "Robot_BLE.h"
+#include "ble_tx_queue.h"
+#include "robot_commands.h"
+#include "task_alloc.h"
+#include "tlm_fec.h"
+
+#define TLM_TAG "TELEMETRY"
+
+_Static_assert(TLM_COUNT <= BLE_BATCH_MAX, "one pass must fit one batch");
+_Static_assert(TLM_COUNT <= FEC_SLOTS_MAX, "one pass and its tag must fit one batch");
+_Static_assert(TLM_FEC_K >= 1 && TLM_FEC_K <= FEC_K_MAX, "TLM_FEC_K out of range");
+
+static const char *const tlm_names[TLM_COUNT] = { "health", "nav", "pose", "inertia" };
+static const uint32_t tlm_default_ms[TLM_COUNT] = {
+    TLM_HEALTH_MS, TLM_NAV_MS, TLM_POSE_MS, TLM_INERTIA_MS
+};
+
+static esp_timer_handle_t tlm_timers[TLM_COUNT];
+static _Atomic uint32_t   tlm_due = 0;              // Bit per report type
+static TaskHandle_t       tlm_task = NULL;
+static tlm_stats_t        tlm_counts;
+static robot_bt_packet_t  tlm_last[TLM_COUNT];      // Last word sent, task only
+static uint32_t           tlm_valid = 0;            // Bit per tlm_last entry
+static uint8_t            tlm_credits = 0;          // health.credits last sent, full or heartbeat
+static fec_enc_t          tlm_fec;                  // Open parity group, task only
+static int64_t            tlm_fec_t0 = 0;           // Its first batch
+static uint32_t           tlm_batches = 0;          // Batches sent, for the loss rate
+static int64_t            tlm_sent_us = 0;          // Last batch, for the pace gap
+static bool               tlm_held = false;         // Due reports waited for the gap
+
+static void tlm_mark_due(tlm_report_t type) {
+    uint32_t bit = 1u << type;
+    if (atomic_fetch_or(&tlm_due, bit) & bit) tlm_counts.merged[type]++;
+    if (tlm_task) xTaskNotifyGive(tlm_task);
+}
+
+static void tlm_timer_cb(void *arg) {
+    tlm_mark_due((tlm_report_t)(uintptr_t)arg);
+}
+
+// One task's stack headroom per HR word, round robin over the ones that
+// exist (no IMU task without the sensor, no rt_stats with the dump off)
+static void tlm_stack_fill(robot_bt_packet_t *pkt) {
+    static const char *const names[] = { HEALTH_STACK_TASKS };
+    static TaskHandle_t handles[sizeof(names) / sizeof(names[0])];
+    static unsigned next = 0;
+    const unsigned count = sizeof(names) / sizeof(names[0]);
+
+    for (unsigned tries = 0; tries < count; tries++) {
+        unsigned i = next;
+        next = (next + 1) % count;
+        if (!handles[i]) handles[i] = xTaskGetHandle(names[i]);   // Robot tasks never exit
+        if (!handles[i]) continue;
+        UBaseType_t words = uxTaskGetStackHighWaterMark(handles[i]) / 4;
+        pkt->health.stack_task = i;
+        pkt->health.stack_free = words > 0xFFF ? 0xFFF : words;
+        return;
+    }
+}
+
+static robot_bt_packet_t tlm_build(tlm_report_t type) {
+    switch (type) {
+        case TLM_HEALTH:  return build_health_report();
+        case TLM_NAV:     return build_imu(0);
+        case TLM_POSE:    return build_imu(1);
+        default:          return build_imu(2);
+    }
+}
+
+static bool past(int32_t diff, int32_t band) {
+    return abs(diff) >= (band > 0 ? band : 1);
+}
+
+static bool tlm_changed(tlm_report_t type, const robot_bt_packet_t *a, const robot_bt_packet_t *b) {
+    switch (type) {
+        case TLM_HEALTH:
+            return past((int32_t)a->health.battery - (int32_t)b->health.battery, TLM_BATT_DEADBAND) ||
+                   a->health.sec_en   != b->health.sec_en   ||
+                   a->health.motor_en != b->health.motor_en ||
+                   a->health.arm_en   != b->health.arm_en   ||
+                   a->health.traj     != b->health.traj     ||
+                   a->health.traj_seg != b->health.traj_seg ||
+                   a->health.tx_depth != b->health.tx_depth ||
+                   a->health.tx_drops != b->health.tx_drops;
+        case TLM_NAV:                                   // Positions wrap at 16 bits
+            return past((int32_t)a->nav.speed - (int32_t)b->nav.speed, TLM_SPEED_DEADBAND) ||
+                   past((int16_t)(a->nav.pos_x - b->nav.pos_x), TLM_POS_DEADBAND) ||
+                   past((int16_t)(a->nav.pos_y - b->nav.pos_y), TLM_POS_DEADBAND) ||
+                   past((int16_t)(a->nav.pos_z - b->nav.pos_z), TLM_POS_DEADBAND);
+        case TLM_POSE: {
+            int32_t yaw = (int32_t)((a->pose.yaw - b->pose.yaw) & 0x3FFFF);     // 18 bits, wraps
+            if (yaw >= 0x20000) yaw -= 0x40000;
+            return past(yaw, TLM_ANGLE_DEADBAND) ||
+                   past((int32_t)(a->pose.pitch - b->pose.pitch), TLM_ANGLE_DEADBAND) ||
+                   past((int32_t)(a->pose.roll  - b->pose.roll),  TLM_ANGLE_DEADBAND);
+        }
+        default:
+            return past((int32_t)(a->inert.accel_x - b->inert.accel_x), TLM_ACCEL_DEADBAND) ||
+                   past((int32_t)(a->inert.accel_y - b->inert.accel_y), TLM_ACCEL_DEADBAND) ||
+                   past((int32_t)(a->inert.accel_z - b->inert.accel_z), TLM_ACCEL_DEADBAND) ||
+                   past((int32_t)(a->inert.gyro_x  - b->inert.gyro_x),  TLM_GYRO_DEADBAND)  ||
+                   past((int32_t)(a->inert.gyro_y  - b->inert.gyro_y),  TLM_GYRO_DEADBAND)  ||
+                   past((int32_t)(a->inert.gyro_z  - b->inert.gyro_z),  TLM_GYRO_DEADBAND);
+    }
+}
+
+// Parity rows for the next group: the notify drops over the last window
+// against the batches sent in it
+static uint8_t tlm_fec_rows(int64_t now) {
+    static int64_t window_us;
+    static uint32_t window_drops, window_batches;
+
+    if (now - window_us >= (int64_t)TLM_FEC_WINDOW_MS * 1000) {
+        txq_stats_t tx;
+        txq_stats(&tx);
+        uint32_t drops = tx.drops - window_drops, sent = tlm_batches - window_batches;
+        int rows = drops == 0 ? 0 : drops * 100 < sent * TLM_FEC_LOSS2_PCT ? 1 : 2;
+        if (rows < TLM_FEC_ROWS_MIN) rows = TLM_FEC_ROWS_MIN;
+        if (rows > FEC_ROWS_MAX) rows = FEC_ROWS_MAX;
+        if (rows != tlm_counts.fec_rows) ESP_LOGI(TLM_TAG, "FEC: %d parity rows (%u drops / %u batches)",
+                                                  rows, (unsigned)drops, (unsigned)sent);
+        tlm_counts.fec_rows = (uint8_t)rows;
+        window_drops = tx.drops;
+        window_batches = tlm_batches;
+        window_us = now;
+    }
+    return tlm_counts.fec_rows;
+}
+
+// The open group's parity, once it is full or its flush time is up
+static void tlm_fec_poll(int64_t now) {
+    if (!tlm_fec.count) return;
+    if (tlm_fec.count < TLM_FEC_K && now - tlm_fec_t0 < (int64_t)TLM_FEC_FLUSH_MS * 1000) return;
+
+    robot_bt_packet_t parity[1 + FEC_SLOTS_MAX];
+    for (int row = 1; row <= tlm_counts.fec_rows; row++) {
+        send_cmd_batch(parity, fec_enc_parity(&tlm_fec, row, parity));
+        tlm_counts.fec_parity++;
+    }
+    fec_enc_next(&tlm_fec);
+}
+
+// Ticks until the open group must be flushed, or wait if that is sooner;
+// one already overdue is held by congestion and retried like the reports
+static TickType_t tlm_fec_wait(TickType_t wait) {
+    if (!tlm_fec.count) return wait;
+    int64_t left_ms = ((int64_t)TLM_FEC_FLUSH_MS * 1000 - (esp_timer_get_time() - tlm_fec_t0)) / 1000;
+    TickType_t t = left_ms > 0 ? pdMS_TO_TICKS(left_ms) + 1 : pdMS_TO_TICKS(TLM_CONGEST_RETRY_MS);
+    return t < wait ? t : wait;
+}
+
+// Time until the gap a subscriber asked for (ble_tlm_gap_ms) has passed
+// since the last batch; due reports wait for it and merge meanwhile
+static int64_t tlm_pace_left_us(int64_t now) {
+    uint32_t gap = ble_tlm_gap_ms();
+    int64_t left = tlm_sent_us + (int64_t)gap * 1000 - now;
+    return gap && tlm_sent_us && left > 0 ? left : 0;
+}
+
+static void telemetry_task(void *pvParameters) {
+    while (1) {
+        // Sleep until a timer fires; with work held back by congestion,
+        // look again after a short retry period instead
+        TickType_t wait = atomic_load(&tlm_due) ? pdMS_TO_TICKS(TLM_CONGEST_RETRY_MS) : portMAX_DELAY;
+        ulTaskNotifyTake(pdTRUE, tlm_fec_wait(wait));
+
+        if (num_connected == 0) {
+            tlm_valid = 0;                              // Next client gets full reports
+            if (tlm_fec.count) fec_enc_next(&tlm_fec);
+            uint32_t due = atomic_exchange(&tlm_due, 0);
+            for (int t = 0; t < TLM_COUNT; t++) {
+                if (due & (1u << t)) tlm_counts.skipped[t]++;
+            }
+            continue;
+        }
+
+        if (ble_congested) continue;                    // Everything stays pending
+        int64_t now = esp_timer_get_time();
+        tlm_fec_poll(now);
+        if (tlm_pace_left_us(now) > 0) {                // Looked at again after the retry period
+            tlm_held = true;
+            continue;
+        }
+
+        // Every changed report due right now goes out in one notification
+        robot_bt_packet_t batch[TLM_COUNT + 1];         // + the FEC tag
+        int n = 0;
+        bool heartbeat = false;
+        uint8_t credits = 0;
+        uint32_t due = atomic_exchange(&tlm_due, 0);
+        for (int t = 0; t < TLM_COUNT; t++) {
+            if (!(due & (1u << t))) continue;
+            robot_bt_packet_t pkt = tlm_build((tlm_report_t)t);
+            if ((tlm_valid & (1u << t)) && !tlm_changed((tlm_report_t)t, &pkt, &tlm_last[t])) {
+                tlm_counts.unchanged[t]++;
+                if (t == TLM_HEALTH) {
+                    heartbeat = true;
+                    credits = pkt.health.credits;
+                }
+                continue;
+            }
+            if (t == TLM_HEALTH) {
+                tlm_stack_fill(&pkt);
+                tlm_credits = pkt.health.credits;
+            }
+            tlm_last[t] = pkt;
+            tlm_valid |= 1u << t;
+            batch[n++] = pkt;
+            tlm_counts.sent[t]++;
+        }
+        // Any other report proves the link too, but not the robot's credits
+        if (heartbeat && (n == 0 || credits != tlm_credits)) {
+            batch[n] = (robot_bt_packet_t){0};
+            batch[n].health.pl = 1;
+            batch[n].health.type = HEALTH_CMD;
+            batch[n].health.unchanged = 1;
+            batch[n].health.credits = credits;
+            tlm_stack_fill(&batch[n]);
+            tlm_credits = credits;
+            n++;
+        }
+        if (n == 0) continue;
+        if (TLM_FEC && !tlm_fec.count) {
+            tlm_fec_t0 = now;
+            tlm_fec_rows(now);                          // Fixed for the whole group
+        }
+        if (TLM_FEC && tlm_counts.fec_rows) n = fec_enc_data(&tlm_fec, batch, n);
+        send_cmd_batch(batch, n);
+        tlm_batches++;
+        tlm_sent_us = now;
+        if (tlm_held) tlm_counts.paced++;
+        tlm_held = false;
+        tlm_fec_poll(now);
+    }
+}
+
+bool telemetry_set_rate(tlm_report_t type, uint32_t period_ms) {
+    if (type >= TLM_COUNT || !tlm_timers[type]) return false;
+
+    esp_timer_stop(tlm_timers[type]);                   // Fails harmlessly if not running
+    atomic_fetch_and(&tlm_due, ~(1u << type));
+    if (period_ms == 0) return true;
+    return esp_timer_start_periodic(tlm_timers[type], (uint64_t)period_ms * 1000) == ESP_OK;
+}
+
+void telemetry_request(tlm_report_t type) {
+    if (type < TLM_COUNT) tlm_mark_due(type);
+}
+
+bool telemetry_start(BaseType_t core, UBaseType_t prio) {
+    if (tlm_task) return true;
+
+    if (TASK_CREATE_PINNED(telemetry_task, "robot_telemetry", STACK_TELEMETRY, NULL, prio, &tlm_task, core) != pdPASS) {
+        ESP_LOGE(TLM_TAG, "Task creation failed!");
+        return false;
+    }
+
+    for (int t = 0; t < TLM_COUNT; t++) {
+        const esp_timer_create_args_t args = {
+            .callback = tlm_timer_cb,
+            .arg = (void *)(uintptr_t)t,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = tlm_names[t],
+            .skip_unhandled_events = true,              // Catch-up bursts would only merge anyway
+        };
+        if (esp_timer_create(&args, &tlm_timers[t]) != ESP_OK) {
+            ESP_LOGE(TLM_TAG, "Timer '%s' creation failed!", tlm_names[t]);
+            return false;
+        }
+        telemetry_set_rate((tlm_report_t)t, tlm_default_ms[t]);
+    }
+    return true;
+}
+
+void telemetry_stats(tlm_stats_t *out) {
+    if (out) memcpy(out, &tlm_counts, sizeof(*out));
+}
@@ -0,0 +1,132 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+/*
+ * Report scheduler. Each report type has its own esp_timer periodic
+ * callback; the callback only marks the report due and wakes the
+ * telemetry task, which samples the latest values and sends them.
+ *
+ * While the BLE TX path is congested, due reports stay pending instead
+ * of being sent: a report that comes due again before it went out is
+ * merged (sent once, with fresh values), and the task retries every
+ * TLM_CONGEST_RETRY_MS rather than spinning.
+ *
+ * Reports that are due in the same pass are packed into one notification
+ * (send_cmd_batch: count + words, one GCM seal when secure).
+ *
+ * telemetry_request() marks a report due outside its timer; nav and pose
+ * are sent that way by the odometry module when the pose changes.
+ *
+ * A due report only goes out when a field moved past its deadband since
+ * the last one sent (TLM_*_DEADBAND, in the report's own units). An
+ * unchanged health report becomes a heartbeat word (health.unchanged = 1)
+ * and is left out entirely when anything else shares the notification.
+ * Every report is sent in full once after each (re)connect.
+ * health.credits (ble_rx_pool.h) is no reason for a full report either,
+ * but a heartbeat that carries new credits goes out even when other
+ * reports share the notification.
+ *
+ * Telemetry FEC (cmd_codec/tlm_fec.h, TLM_FEC=1): while notifies are being
+ * lost, batches carry a group tag and every TLM_FEC_K of them (or
+ * TLM_FEC_FLUSH_MS after the group's first) are followed by one or two
+ * parity batches, from which the GS rebuilds one or two lost batches of
+ * the group. The rows follow the loss the robot sees over the last
+ * TLM_FEC_WINDOW_MS (notify drops, txq_stats()): none while nothing was
+ * lost, so a clean link pays nothing, one below TLM_FEC_LOSS2_PCT of the
+ * batches sent, two above. TLM_FEC_ROWS_MIN sets a floor for links whose
+ * losses happen past the robot (the GS modem's UART).
+ *
+ * A central on a poor link may ask for a gap between telemetry batches
+ * (SUBSCRIBE, cmd_codec.h Multi-central): due reports then stay pending,
+ * merging, until the largest gap asked for has passed since the last batch.
+ *
+ * Each HR word also carries the stack high-water mark of one robot task,
+ * the next one every report (health.stack_task / stack_free, cmd_codec.h);
+ * it does not count as a change. That is what STACK_* in task_alloc.h are
+ * sized from.
+ */
+
+typedef enum {
+    TLM_HEALTH = 0,
+    TLM_NAV,
+    TLM_POSE,
+    TLM_INERTIA,
+    TLM_COUNT
+} tlm_report_t;
+
+// Default periods in ms (0 = off); override with -D or telemetry_set_rate()
+#ifndef TLM_HEALTH_MS
+#define TLM_HEALTH_MS   5000
+#endif
+#ifndef TLM_NAV_MS
+#define TLM_NAV_MS      0           // Delta based: components/Odometry/odometry.h
+#endif
+#ifndef TLM_POSE_MS
+#define TLM_POSE_MS     0
+#endif
+#ifndef TLM_INERTIA_MS
+#define TLM_INERTIA_MS  0
+#endif
+#ifndef TLM_CONGEST_RETRY_MS
+#define TLM_CONGEST_RETRY_MS 20
+#endif
+
+#ifndef TLM_FEC
+#define TLM_FEC              1      // 0 = batches never carry parity
+#endif
+#ifndef TLM_FEC_K
+#define TLM_FEC_K            4      // Data batches per group, <= FEC_K_MAX
+#endif
+#ifndef TLM_FEC_FLUSH_MS
+#define TLM_FEC_FLUSH_MS     250    // A group's parity goes out no later than this
+#endif
+#ifndef TLM_FEC_WINDOW_MS
+#define TLM_FEC_WINDOW_MS    5000
+#endif
+#ifndef TLM_FEC_LOSS2_PCT
+#define TLM_FEC_LOSS2_PCT    10     // Drops per batch sent from which Q goes out too
+#endif
+#ifndef TLM_FEC_ROWS_MIN
+#define TLM_FEC_ROWS_MIN     0
+#endif
+
+// Changes smaller than these are not worth a notify (flags always are)
+#ifndef TLM_BATT_DEADBAND
+#define TLM_BATT_DEADBAND    2      // %
+#endif
+#ifndef TLM_SPEED_DEADBAND
+#define TLM_SPEED_DEADBAND   1      // cm/s
+#endif
+#ifndef TLM_POS_DEADBAND
+#define TLM_POS_DEADBAND     5      // mm
+#endif
+#ifndef TLM_ANGLE_DEADBAND
+#define TLM_ANGLE_DEADBAND   500    // 0.001 deg
+#endif
+#ifndef TLM_ACCEL_DEADBAND
+#define TLM_ACCEL_DEADBAND   3      // 0.1 m/s2
+#endif
+#ifndef TLM_GYRO_DEADBAND
+#define TLM_GYRO_DEADBAND    3      // 0.1 deg/s
+#endif
+
+typedef struct {
+    uint32_t sent[TLM_COUNT];
+    uint32_t merged[TLM_COUNT];     // Came due again while still pending
+    uint32_t skipped[TLM_COUNT];    // Dropped: nobody connected
+    uint32_t unchanged[TLM_COUNT];  // Held back: nothing past its deadband
+    uint32_t fec_parity;            // Parity batches sent
+    uint32_t paced;                 // Batches that waited for a subscriber's gap
+    uint8_t  fec_rows;              // Rows per group right now (0 = untagged)
+} tlm_stats_t;
+
+bool telemetry_start(BaseType_t core, UBaseType_t prio);
+bool telemetry_set_rate(tlm_report_t type, uint32_t period_ms);
+void telemetry_request(tlm_report_t type);       // Send once on the next pass
+void telemetry_stats(tlm_stats_t *out);
+
+#endif
@@ -0,0 +1,103 @@
+#include "trace.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#define TRACE_TAG "TRACE"
+
+#if TRACE_ANY
+
+_Static_assert((TRACE_DEPTH & (TRACE_DEPTH - 1)) == 0, "TRACE_DEPTH must be a power of two");
+_Static_assert(sizeof(trace_rec_t) == 16, "trace record layout");
+
+static const char *const trace_names[TRC_EVENT_COUNT] = {
+    "ack", "drive", "motor_off", "arm_cmd", "sys_cmd", "query_cmd",
+    "arm_move", "arm_ik", "rx", "seal", "decrypt", "exec", "idle_off", "estop",
+    "arm_target", "traj", "hpr",
+};
+
+static trace_rec_t       trace_ring[TRACE_DEPTH];
+static _Atomic uint32_t  trace_head = 0;            // Records ever written
+
+// Any task or core; a slot is claimed atomically, so writers never share one
+void trace_record(trace_event_t ev, int16_t a, int32_t b, int32_t c) {
+    uint32_t i = atomic_fetch_add_explicit(&trace_head, 1, memory_order_relaxed);
+    trace_rec_t *r = &trace_ring[i & (TRACE_DEPTH - 1)];
+    r->t_us = (uint32_t)esp_timer_get_time();
+    r->ev   = (uint8_t)ev;
+    r->core = (uint8_t)xPortGetCoreID();
+    r->a = a;
+    r->b = b;
+    r->c = c;
+}
+
+void trace_dump(void) {
+    uint32_t head = atomic_load(&trace_head);
+    uint32_t n = head < TRACE_DEPTH ? head : TRACE_DEPTH;
+
+    printf("%10s %4s %-10s %6s %10s %10s  (%u of %u records)\n",
+           "t_us", "core", "event", "a", "b", "c", (unsigned)n, (unsigned)head);
+    for (uint32_t i = head - n; i != head; i++) {
+        const trace_rec_t *r = &trace_ring[i & (TRACE_DEPTH - 1)];
+        const char *name = r->ev < TRC_EVENT_COUNT ? trace_names[r->ev] : "?";
+        printf("%10u %4u %-10s %6d %10d %10d\n", (unsigned)r->t_us, (unsigned)r->core,
+               name, r->a, (int)r->b, (int)r->c);
+    }
+}
+
+#else
+
+void trace_record(trace_event_t ev, int16_t a, int32_t b, int32_t c) {
+    (void)ev; (void)a; (void)b; (void)c;
+}
+
+void trace_dump(void) {
+    ESP_LOGW(TRACE_TAG, "Tracing compiled out; build with -D TRACE_<component>=1");
+}
+
+#endif
+
+uint32_t trace_now_us(void) {
+    return (uint32_t)esp_timer_get_time();
+}
+
+#if TRACE_LAT
+
+static trace_lat_t trace_lat;           // Executor task only
+
+void trace_lat_begin(const trace_lat_t *lat) {
+    trace_lat = *lat;
+    trace_lat.exec_us = trace_now_us();
+}
+
+static uint64_t lat_field(uint32_t from, uint32_t to) {
+    uint32_t units = (to - from) / TRACE_LAT_UNIT_US;   // Wraps with the 32-bit clock
+    uint32_t max = (1u << TRACE_LAT_BITS) - 1;
+    return units > max ? max : units;
+}
+
+uint64_t trace_lat_ack(uint64_t instr_specific) {
+    if (instr_specific != 0 || !trace_lat.exec_us) return instr_specific;   // NO_INFO only
+    uint32_t now = trace_now_us();
+    uint64_t v = TRACE_LAT_MARK
+               | lat_field(trace_lat.rx_us, trace_lat.dec_us)
+               | lat_field(trace_lat.dec_us, trace_lat.exec_us) << TRACE_LAT_BITS
+               | lat_field(trace_lat.exec_us, now) << (2 * TRACE_LAT_BITS);
+    trace_lat.exec_us = 0;              // One ACK per command carries it
+    return v;
+}
+
+#else
+
+void trace_lat_begin(const trace_lat_t *lat) {
+    (void)lat;
+}
+
+uint64_t trace_lat_ack(uint64_t instr_specific) {
+    return instr_specific;
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Hot-path trace. TRACE(comp, ev, a, b, c) stores one 16-byte binary
+ * record (time, core, event, three integer args) in a RAM ring instead of
+ * formatting a log line; trace_dump() prints the ring afterwards.
+ *
+ * Each component has its own switch (TRACE_CMD, TRACE_ARM, TRACE_BLE,
+ * TRACE_EXEC). They default to 0, where every TRACE() of that component
+ * is dead code and the ring is not allocated. Enable one with -D in
+ * platformio.ini build_flags, e.g. -D TRACE_CMD=1.
+ */
+
+#ifndef TRACE_CMD
+#define TRACE_CMD    0          // components/Robot_Commands
+#endif
+#ifndef TRACE_ARM
+#define TRACE_ARM    0          // components/ARM
+#endif
+#ifndef TRACE_BLE
+#define TRACE_BLE    0          // components/BLE
+#endif
+#ifndef TRACE_EXEC
+#define TRACE_EXEC   0          // Robot_Final command executor, drivetrain idle-off
+#endif
+#ifndef TRACE_LAT
+#define TRACE_LAT    0          // Stage times in success ACKs (GS_TRACE on the bridge)
+#endif
+#ifndef TRACE_DEPTH
+#define TRACE_DEPTH  256        // Records, power of two (16 bytes each)
+#endif
+
+#define TRACE_ANY (TRACE_CMD || TRACE_ARM || TRACE_BLE || TRACE_EXEC)
+
+// Args per event (a, b, c); unused ones are 0
+typedef enum {
+    TRC_ACK = 0,                // id, result, ids (RESULT_ACK_RANGE)
+    TRC_DRIVE,                  // mix index, speed, hold ms
+    TRC_MOTOR_OFF,              // id
+    TRC_ARM_CMD,                // id, reset, speed
+    TRC_SYS_CMD,                // id, instruction, payload
+    TRC_QUERY_CMD,              // id, instruction, -
+    TRC_ARM_MOVE,               // z, x, y (0.01 in)
+    TRC_ARM_IK,                 // base, shoulder, elbow (0.1 deg)
+    TRC_RX,                     // conn_id, len, secure
+    TRC_SEAL,                   // marker, class, ok
+    TRC_DECRYPT,                // ok, -, -
+    TRC_EXEC,                   // command type, sys lane depth, motion lane depth
+    TRC_IDLE_OFF,               // -
+    TRC_ESTOP,                  // source (ESTOP_FAST / ESTOP_EXEC), rx->stopped us, worst us
+    TRC_ARM_TARGET,             // id, speed, -
+    TRC_TRAJ,                   // segment, ms, traj_states
+    TRC_HPR,                    // alert, cleared, value
+    TRC_EVENT_COUNT
+} trace_event_t;
+
+typedef struct {
+    uint32_t t_us;              // esp_timer time, low 32 bits
+    uint8_t  ev;
+    uint8_t  core;
+    int16_t  a;
+    int32_t  b, c;
+} trace_rec_t;
+
+/*
+ * Command latency stamps (TRACE_LAT). The BLE callback stamps each pool
+ * slot on arrival, the executor after decrypt and at dispatch; send_ack()
+ * then replaces NO_INFO in a RESULT_SUCCESS ACK with the three stage times,
+ * in TRACE_LAT_UNIT_US, saturating at 13 bits:
+ *   bit 40 = marker, [0..12] rx->decoded, [13..25] decoded->exec, [26..38] exec->ack
+ * The GS (cmd_trace.h) matches the ACK to its own stamps by command id.
+ */
+#define TRACE_LAT_MARK    ((uint64_t)1 << 40)
+#define TRACE_LAT_BITS    13
+#define TRACE_LAT_UNIT_US 20
+
+typedef struct {
+    uint32_t rx_us, dec_us, exec_us;    // esp_timer time, low 32 bits
+} trace_lat_t;
+
+#define TRACE(comp, ev, a, b, c) \
+    do { if (TRACE_##comp) trace_record(TRC_##ev, (int16_t)(a), (int32_t)(b), (int32_t)(c)); } while (0)
+
+void trace_record(trace_event_t ev, int16_t a, int32_t b, int32_t c);
+void trace_dump(void);          // Oldest first; prints a hint when tracing is compiled out
+
+uint32_t trace_now_us(void);
+void     trace_lat_begin(const trace_lat_t *lat);       // Command now executing
+uint64_t trace_lat_ack(uint64_t instr_specific);        // ACK payload to send
+
+#endif
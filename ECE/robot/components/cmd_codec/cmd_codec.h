@@ -0,0 +1,749 @@
+#ifndef CMD_CODEC_H
+#define CMD_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// -----------------------------------------------------------------------------
+// Shared 64-bit command/report codec (GS bridge, robot firmware, wasm).
+// Every message layout is one field table below; the bitfield structs used
+// by robot_bt_packet_t, a plain-value struct, pack/unpack and per-field
+// get/set are all generated from it, so the GS and the robot cannot drift.
+// Bits are numbered LSB first; on the wire the word is bytes[0..7] of the
+// union, i.e. little-endian.
+//
+// Generated per message <m> (ctrl, arm, armt, trajd, traja, trajc, sys,
+// query, nav, pose, inert, health, ack, hpr, fec):
+//   cmd_<m>_t                 natural-width field values
+//   cmd_<m>_pack(&v)          -> uint64_t word (OR of masked shifts, no branches)
+//   cmd_<m>_unpack(w, &v)
+//   cmd_<m>_get_<f>(w)        one field (signed fields are sign-extended)
+//   cmd_<m>_set_<f>(w, x)     -> w with that field replaced
+// -----------------------------------------------------------------------------
+
+// Command Types
+typedef enum {
+    CONTROL_CMD      = 0x01,
+    ARM_CMD          = 0x02,
+    System_CMD       = 0x03,
+    Query_CMD        = 0x04,
+    ROBOT_UPDATE_CMD = 0x05,
+    HEALTH_CMD       = 0x06,
+    ACK_CMD          = 0x07,
+    HPR_CMD          = 0x08,
+    ARM_TARGET_CMD   = 0x09,
+    TRAJ_CMD         = 0x0A,  // Trajectory below
+    FEC_CMD          = 0x0B,  // Telemetry parity, tlm_fec.h
+
+} command_type_t;
+
+// System Instruction
+enum system_instructions {
+    DISCONNECT        = 0x01,
+    Connect_Reconnect = 0x02,
+    SECURITY_LEVEL    = 0x03,  // specific: enum security_suites
+    ROBOT_POWER       = 0x04,
+    ROBOT_NAME_CHANGE = 0x05,
+    UPDATE_AUTH_CODE  = 0x06,
+    GS_BLE_RESET      = 0x07,
+    ARM_POWER_CMD     = 0x08,
+    EMERGENCY_SHTDWN  = 0x09,  // specific: ESTOP_RELEASE clears the latch, anything else stops
+    NOTIFY_MODE       = 0x0A,  // specific: 0 = hex text words, 1 = tagged binary
+    DRIVE_MODE        = 0x0B,  // specific: bits 0-7 0 = pulse, 1 = setpoint; bits 8-23 watchdog ms (0 = default)
+    ACK_MODE          = 0x0C,  // specific: bits 0-7 0 = ACK each command, 1 = ranges; bits 8-23 hold ms (0 = default)
+    CONTROL_OWNER     = 0x0D,  // specific: 1 = take the control lane, 0 = release it (Multi-central below)
+    SUBSCRIBE         = 0x0E,  // specific: bits 0-7 enum report_topics mask for the sending central; bits 8-23 telemetry gap ms (Multi-central below)
+    LINK_ECHO         = 0x0F,  // specific: 1 = echo LINK_ECHO_TAG writes on this link, 0 = off (Link benchmark below)
+
+};
+
+enum instruction_specfic_rsp {
+    NO_INFO                 = 0x00,
+    MOTORS_DISABLED         = 0x01,
+    MOTORS_ENABLED          = 0x02,
+    ARM_CORDINATES_ISSUE    = 0x03,  // Arm Cordinates Out of Bounds
+    SECURITY_OFF            = 0x04,
+    SECURITY_ON             = 0x05,
+    NAME_UPDATED            = 0x06,
+    NAME_CHANGE_FAILED      = 0x07,
+    AUTH_CODE_UPDATED       = 0x08,
+    AUTH_CODE_UPDATE_FAIL   = 0x09,
+    ARM_ENABLED             = 0x0A,
+    ARM_DISABLED            = 0x0B,
+    SHTDWN_ENABLED          = 0x0C,
+    SHTDWN_DISABLED         = 0x0D,
+    NOTIFY_TEXT             = 0x0E,
+    NOTIFY_BINARY           = 0x0F,
+    DRIVE_PULSE             = 0x10,
+    DRIVE_SETPOINT          = 0x11,
+    SECURITY_ON_CHACHA      = 0x12,
+    ACK_EACH                = 0x13,
+    ACK_RANGES              = 0x14,
+    CONTROL_GRANTED         = 0x15,
+    CONTROL_RELEASED        = 0x16,
+    CONTROL_HELD            = 0x17,  // Another central has the control lane
+    TOPICS_SET              = 0x18,
+    TRAJ_INCOMPLETE         = 0x19,  // TRAJ_OP_RUN: a segment below count was never loaded
+    TRAJ_CRC_MISMATCH       = 0x1A,  // TRAJ_OP_RUN: the loaded words are not the ones the sender meant
+    ECHO_ON                 = 0x1B,
+    ECHO_OFF                = 0x1C,
+    CMD_EXPIRED             = 0x1D,  // Drive / arm word past its deadline, dropped unrun
+};
+
+// SECURITY_LEVEL specific: which AEAD seals the link. Both use the same
+// frames, 12-byte nonces (replay_window.h) and 16-byte tags; ChaCha20-
+// Poly1305 is for endpoints without AES hardware, where it runs faster.
+enum security_suites {
+    SEC_PLAIN              = 0,
+    SEC_AES_GCM            = 1,
+    SEC_CHACHA20_POLY1305  = 2,
+};
+
+enum query_instructions {
+    CONNNECTION_STAT = 0x01,
+    SECURITY_STATUS  = 0x02,
+    MOTOR_STATUS     = 0x03,
+    CURRENT_POSITION = 0x04,
+    ROBOT_BATT       = 0x05,
+    ROBOT_NAME       = 0x06,
+    ARM_POWER        = 0x07,
+    SHTDWN_STATUS    = 0x08,
+    CLOCK_SYNC       = 0x09,  // ACK info: clock_sync_info() (Scheduled execution below)
+
+};
+
+// Acknowledgment Result Types
+enum result_code {
+    RESULT_SUCCESS              = 0x00, // Command executed successfully
+    RESULT_UNKNOWN_CMD          = 0x01, // Unknown command type
+    RESULT_INVALID_PARAMS       = 0x02, // Invalid or conflicting parameters
+    RESULT_UNSUPPORTED_CMD      = 0x03, // Command valid but not supported
+    RESULT_AUTH_FAIL            = 0x04, // Authentication failed
+    RESULT_DUPLICATE_PACKET     = 0x05, // Duplicate or old packet detected
+    RESULT_BT_NOT_INITIALIZED   = 0x06, // Bluetooth connection not initialized
+    RESULT_CMD_FAILURE          = 0x07,
+    RESULT_ACK_RANGE            = 0x08, // Cumulative: every id in the range succeeded (ack_range_t)
+};
+
+// ------------------------- Field tables -------------------------
+// X(msg, field, lo, width, kind): kind U = unsigned (uint32_t value),
+// S = two's complement (int32_t), W = unsigned wider than 32 bits.
+// Fields must be listed in bit order with no gaps (checked below).
+
+// Control Command
+#define CMD_CTRL_FIELDS(X) \
+    X(ctrl, pl,     0,  2, U) \
+    X(ctrl, type,   2,  5, U) \
+    X(ctrl, w,      7,  1, U) \
+    X(ctrl, a,      8,  1, U) \
+    X(ctrl, s,      9,  1, U) \
+    X(ctrl, d,     10,  1, U) \
+    X(ctrl, speed, 11,  7, U) \
+    X(ctrl, id,    18, 11, U) \
+    X(ctrl, at,    29, 16, U)
+
+// Arm Command
+#define CMD_ARM_FIELDS(X) \
+    X(arm, pl,      0,  2, U) \
+    X(arm, type,    2,  5, U) \
+    X(arm, up,      7,  1, U) \
+    X(arm, down,    8,  1, U) \
+    X(arm, left,    9,  1, U) \
+    X(arm, right,  10,  1, U) \
+    X(arm, in,     11,  1, U) \
+    X(arm, out,    12,  1, U) \
+    X(arm, speed,  13,  7, U) \
+    X(arm, reset,  20,  1, U) \
+    X(arm, id,     21, 11, U) \
+    X(arm, at,     32, 16, U) \
+    X(arm, unused, 48, 16, U)
+
+// Arm Target: absolute (x, y, z) in the arm frame, 0.01 in (+-20.47). The
+// robot runs one coordinated move there, every joint arriving together, at
+// speed as for the jogs. Executes on arrival (no at: one word, not a stream).
+#define CMD_ARMT_FIELDS(X) \
+    X(armt, pl,        0,  2, U) \
+    X(armt, type,      2,  5, U) \
+    X(armt, speed,     7,  7, U) \
+    X(armt, id,       14, 11, U) \
+    X(armt, x,        25, 12, S) \
+    X(armt, y,        37, 12, S) \
+    X(armt, z,        49, 12, S) \
+    X(armt, reserved, 61,  3, U)
+
+#define ARMT_UNITS_PER_IN  100
+
+// Trajectory words (TRAJ_CMD), one layout per op (Trajectory below)
+#define CMD_TRAJD_FIELDS(X) \
+    X(trajd, pl,        0,  2, U) \
+    X(trajd, type,      2,  5, U) \
+    X(trajd, op,        7,  2, U) \
+    X(trajd, idx,       9,  6, U) \
+    X(trajd, ms,       15, 16, U) \
+    X(trajd, fl,       31,  8, S) \
+    X(trajd, fr,       39,  8, S) \
+    X(trajd, bl,       47,  8, S) \
+    X(trajd, br,       55,  8, S) \
+    X(trajd, reserved, 63,  1, U)
+
+#define CMD_TRAJA_FIELDS(X) \
+    X(traja, pl,        0,  2, U) \
+    X(traja, type,      2,  5, U) \
+    X(traja, op,        7,  2, U) \
+    X(traja, idx,       9,  6, U) \
+    X(traja, speed,    15,  7, U) \
+    X(traja, x,        22, 12, S) \
+    X(traja, y,        34, 12, S) \
+    X(traja, z,        46, 12, S) \
+    X(traja, reserved, 58,  6, U)
+
+#define CMD_TRAJC_FIELDS(X) \
+    X(trajc, pl,        0,  2, U) \
+    X(trajc, type,      2,  5, U) \
+    X(trajc, op,        7,  2, U) \
+    X(trajc, id,        9, 11, U) \
+    X(trajc, count,    20,  7, U) \
+    X(trajc, crc,      27, 16, U) \
+    X(trajc, reserved, 43, 21, U)
+
+// System Command
+#define CMD_SYS_FIELDS(X) \
+    X(sys, pl,           0,  2, U) \
+    X(sys, type,         2,  5, U) \
+    X(sys, instruction,  7,  4, U) \
+    X(sys, ac,          11, 10, U) \
+    X(sys, id,          21, 11, U) \
+    X(sys, specific,    32, 32, U)
+
+// Query Command (r = read/request, extra = padding)
+#define CMD_QUERY_FIELDS(X) \
+    X(query, pl,           0,  2, U) \
+    X(query, type,         2,  5, U) \
+    X(query, instruction,  7,  4, U) \
+    X(query, id,          11, 11, U) \
+    X(query, r,           22,  1, U) \
+    X(query, extra,       23, 41, W)
+
+// Part 0: Navigation (position in signed mm)
+#define CMD_NAV_FIELDS(X) \
+    X(nav, pl,     0,  2, U) \
+    X(nav, type,   2,  5, U) \
+    X(nav, part,   7,  2, U) \
+    X(nav, speed,  9,  7, U) \
+    X(nav, pos_x, 16, 16, S) \
+    X(nav, pos_y, 32, 16, S) \
+    X(nav, pos_z, 48, 16, S)
+
+// Part 1: Pose (Euler angles, 0.001 precision)
+#define CMD_POSE_FIELDS(X) \
+    X(pose, pl,        0,  2, U) \
+    X(pose, type,      2,  5, U) \
+    X(pose, part,      7,  2, U) \
+    X(pose, yaw,       9, 18, U) \
+    X(pose, pitch,    27, 18, S) \
+    X(pose, roll,     45, 18, S) \
+    X(pose, reserved, 63,  1, U)
+
+// Part 2: Inertia (accel & gyro, 0.1 precision)
+#define CMD_INERT_FIELDS(X) \
+    X(inert, pl,        0, 2, U) \
+    X(inert, type,      2, 5, U) \
+    X(inert, part,      7, 2, U) \
+    X(inert, accel_x,   9, 9, S) \
+    X(inert, accel_y,  18, 9, S) \
+    X(inert, accel_z,  27, 9, S) \
+    X(inert, gyro_x,   36, 9, S) \
+    X(inert, gyro_y,   45, 9, S) \
+    X(inert, gyro_z,   54, 9, S) \
+    X(inert, reserved, 63, 1, U)
+
+// Health Status (HR); unchanged = heartbeat, bits 7-32 as the last full report.
+// Every HR word (heartbeats too) carries one task's stack high-water mark:
+// stack_free 4-byte words left on HEALTH_STACK_TASKS[stack_task], a
+// different task each report.
+#define CMD_HEALTH_FIELDS(X) \
+    X(health, pl,          0,  2, U) \
+    X(health, type,        2,  5, U) \
+    X(health, battery,     7,  7, U) \
+    X(health, sec_en,     14,  1, U) \
+    X(health, motor_en,   15,  1, U) \
+    X(health, arm_en,     16,  1, U) \
+    X(health, tx_depth,   17,  4, U) \
+    X(health, tx_drops,   21, 12, U) \
+    X(health, unchanged,  33,  1, U) \
+    X(health, stack_task, 34,  3, U) \
+    X(health, stack_free, 37, 12, U) \
+    X(health, traj,       49,  2, U) \
+    X(health, traj_seg,   51,  6, U) \
+    X(health, credits,    57,  5, U) \
+    X(health, reserved,   62,  2, U)
+
+// health.credits and the top of an ACK range's instruction_specific: the
+// command words the robot can still take (free RX pool slots) + 1, so that
+// 0 = not advertised, as firmware without flow control sends
+#define CREDIT_MAX        31                // Field width
+
+// FreeRTOS task names, in stack_task order (at most 8)
+#define HEALTH_STACK_TASKS \
+    "robot_cmd_executor", "robot_telemetry", "arm_ctrl", "imu", "rt_stats", "BTC_TASK", "esp_timer", "hpr"
+
+// Acknowledge
+#define CMD_ACK_FIELDS(X) \
+    X(ack, pl,                    0,  2, U) \
+    X(ack, type,                  2,  5, U) \
+    X(ack, id,                    7, 11, U) \
+    X(ack, result_code,          18,  5, U) \
+    X(ack, instruction_specific, 23, 41, W)
+
+// High Priority Alert, sent the moment a condition is seen (components/
+// Telemetry/hpr.h): alert_type from enum hpr_alerts, value what was measured
+// and limit the threshold it crossed, both in the alert's units; cleared = 1
+// once it is back under the limit. seq counts every HPR the robot sent.
+#define CMD_HPR_FIELDS(X) \
+    X(hpr, pl,          0,  2, U) \
+    X(hpr, type,        2,  5, U) \
+    X(hpr, alert_type,  7,  5, U) \
+    X(hpr, cleared,    12,  1, U) \
+    X(hpr, value,      13, 16, S) \
+    X(hpr, limit,      29, 16, U) \
+    X(hpr, seq,        45,  8, U) \
+    X(hpr, reserved,   53, 11, U)
+
+// Telemetry FEC tag (tlm_fec.h): last word of a data batch (row 0, index
+// = its place in the group) or first word of a parity batch (row 1 = XOR,
+// 2 = Reed-Solomon Q; k data batches covered, slots parity words follow)
+#define CMD_FEC_FIELDS(X) \
+    X(fec, pl,        0,  2, U) \
+    X(fec, type,      2,  5, U) \
+    X(fec, group,     7,  8, U) \
+    X(fec, index,    15,  4, U) \
+    X(fec, row,      19,  2, U) \
+    X(fec, k,        21,  4, U) \
+    X(fec, slots,    25,  4, U) \
+    X(fec, reserved, 29, 35, W)
+
+enum hpr_alerts {
+    HPR_TIP_OVER     = 0x01,  // |pitch| or |roll|, 0.1 deg
+    HPR_IMPACT       = 0x02,  // |accel| away from 1 g, 0.1 m/s^2
+    HPR_SPIN         = 0x03,  // |gyro|, 0.1 deg/s
+    HPR_MOTOR_STALL  = 0x04,  // value: wheel (wheel_t) driven with no steps counted; limit: ms
+    HPR_RX_FULL      = 0x05,  // value: RX pool slots in use, limit: the pool size
+    HPR_TX_DROPS     = 0x06,  // value: report words dropped in the last window, limit: per window
+    HPR_IMU_LOST     = 0x07,  // value: ms since the last IMU sample, limit: ms
+};
+
+#define CMD_CODEC_MESSAGES(M) \
+    M(ctrl,   control_format_t, CMD_CTRL_FIELDS) \
+    M(arm,    arm_format_t,     CMD_ARM_FIELDS) \
+    M(armt,   arm_target_format_t, CMD_ARMT_FIELDS) \
+    M(trajd,  traj_drive_format_t, CMD_TRAJD_FIELDS) \
+    M(traja,  traj_arm_format_t,   CMD_TRAJA_FIELDS) \
+    M(trajc,  traj_ctl_format_t,   CMD_TRAJC_FIELDS) \
+    M(sys,    system_format_t,  CMD_SYS_FIELDS) \
+    M(query,  query_format_t,   CMD_QUERY_FIELDS) \
+    M(nav,    nav_format_t,     CMD_NAV_FIELDS) \
+    M(pose,   pose_format_t,    CMD_POSE_FIELDS) \
+    M(inert,  inertia_format_t, CMD_INERT_FIELDS) \
+    M(health, health_format_t,  CMD_HEALTH_FIELDS) \
+    M(ack,    ack_format_t,     CMD_ACK_FIELDS) \
+    M(hpr,    hpr_format_t,     CMD_HPR_FIELDS) \
+    M(fec,    fec_format_t,     CMD_FEC_FIELDS)
+
+// ------------------------- Bit primitives -------------------------
+
+static inline uint64_t cmd_bits_mask(unsigned width) {
+    return width >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
+}
+
+static inline uint64_t cmd_bits_get(uint64_t w, unsigned lo, unsigned width) {
+    return (w >> lo) & cmd_bits_mask(width);
+}
+
+// Field moved to the top, then arithmetic-shifted back down: sign-extends without a branch
+static inline int64_t cmd_bits_sget(uint64_t w, unsigned lo, unsigned width) {
+    return (int64_t)(w << (64 - lo - width)) >> (64 - width);
+}
+
+static inline uint64_t cmd_bits_put(uint64_t v, unsigned lo, unsigned width) {
+    return (v & cmd_bits_mask(width)) << lo;
+}
+
+static inline uint64_t cmd_bits_set(uint64_t w, uint64_t v, unsigned lo, unsigned width) {
+    return (w & ~(cmd_bits_mask(width) << lo)) | cmd_bits_put(v, lo, width);
+}
+
+#define CMD_BF_U uint64_t
+#define CMD_BF_S int64_t
+#define CMD_BF_W uint64_t
+#define CMD_VT_U uint32_t
+#define CMD_VT_S int32_t
+#define CMD_VT_W uint64_t
+#define CMD_GET_U(w, lo, wd) ((uint32_t)cmd_bits_get(w, lo, wd))
+#define CMD_GET_S(w, lo, wd) ((int32_t)cmd_bits_sget(w, lo, wd))
+#define CMD_GET_W(w, lo, wd) cmd_bits_get(w, lo, wd)
+
+// ------------------------- Generators -------------------------
+
+#define CMD_GEN_BITFIELD(m, f, lo, wd, k) CMD_BF_##k f : wd;
+#define CMD_GEN_MEMBER(m, f, lo, wd, k)   CMD_VT_##k f;
+#define CMD_GEN_BITMAP(m, f, lo, wd, k)   char f[wd];
+#define CMD_GEN_WIDTH(m, f, lo, wd, k)    + wd
+#define CMD_GEN_PACK(m, f, lo, wd, k)     | cmd_bits_put((uint64_t)v->f, lo, wd)
+#define CMD_GEN_UNPACK(m, f, lo, wd, k)   v->f = CMD_GET_##k(w, lo, wd);
+#define CMD_GEN_CHECK(m, f, lo, wd, k) \
+    _Static_assert(offsetof(cmd_##m##_bitmap_t, f) == lo, #m "." #f " is not at bit " #lo);
+#define CMD_GEN_ACCESS(m, f, lo, wd, k) \
+    static inline CMD_VT_##k cmd_##m##_get_##f(uint64_t w) { return CMD_GET_##k(w, lo, wd); } \
+    static inline uint64_t cmd_##m##_set_##f(uint64_t w, CMD_VT_##k x) { return cmd_bits_set(w, (uint64_t)x, lo, wd); }
+
+// cmd_<m>_bitmap_t has one byte per bit, so offsetof() is each field's
+// running bit position: the explicit lo in the table is checked against it.
+#define CMD_GEN_MESSAGE(m, bf_t, FIELDS) \
+    typedef struct __attribute__((packed)) { FIELDS(CMD_GEN_BITFIELD) } bf_t; \
+    typedef struct { FIELDS(CMD_GEN_MEMBER) } cmd_##m##_t; \
+    typedef struct { FIELDS(CMD_GEN_BITMAP) } cmd_##m##_bitmap_t; \
+    FIELDS(CMD_GEN_CHECK) \
+    _Static_assert((0 FIELDS(CMD_GEN_WIDTH)) <= 64, #m " does not fit 64 bits"); \
+    static inline uint64_t cmd_##m##_pack(const cmd_##m##_t *v) { return 0 FIELDS(CMD_GEN_PACK); } \
+    static inline void cmd_##m##_unpack(uint64_t w, cmd_##m##_t *v) { FIELDS(CMD_GEN_UNPACK) } \
+    FIELDS(CMD_GEN_ACCESS)
+
+CMD_CODEC_MESSAGES(CMD_GEN_MESSAGE)
+
+// Every layout starts with pl:2, type:5, so any word can be routed on these
+static inline uint32_t cmd_word_pl(uint64_t w)   { return CMD_GET_U(w, 0, 2); }
+static inline uint32_t cmd_word_type(uint64_t w) { return CMD_GET_U(w, 2, 5); }
+
+typedef union {
+    uint8_t bytes[8];      // For raw BT transmission
+    uint64_t raw;          // For logging/debugging
+    control_format_t ctrl; // Map to Control Commands
+    system_format_t sys;   // Map to System Commands
+    query_format_t query;  // Map to Query Commands
+    arm_format_t arm;      // Map to Arm Commands
+    arm_target_format_t armt; // Arm Target
+    traj_drive_format_t trajd; // Trajectory: TRAJ_OP_DRIVE
+    traj_arm_format_t traja;  // Trajectory: TRAJ_OP_ARM
+    traj_ctl_format_t trajc;  // Trajectory: TRAJ_OP_RUN / TRAJ_OP_ABORT
+    ack_format_t ack;      // Map to Acknowledgment Commands
+    hpr_format_t hpr;      // High Priority Alert
+    fec_format_t fec;      // Telemetry parity tag
+    nav_format_t nav;      // Navigation (Part 0)
+    pose_format_t pose;    // Pose/Orientation (Part 1)
+    inertia_format_t inert;// Inertia (Part 2)
+    health_format_t health;// Health (Part 11)
+} robot_bt_packet_t;
+
+_Static_assert(sizeof(robot_bt_packet_t) == 8, "robot_bt_packet_t must stay one 64-bit word");
+
+// ------------------------- Emergency stop -------------------------
+// EMERGENCY_SHTDWN stops at once and latches: motor and arm power drop, the
+// stepper drivers are disabled, the arm PWM is detached, and ROBOT_POWER /
+// ARM_POWER_CMD are refused (SHTDWN_ENABLED) until an EMERGENCY_SHTDWN with
+// specific ESTOP_RELEASE. Any other specific stops, so no sender releases
+// by accident. Both ends move a stop word ahead of everything queued: the
+// GS writes it next on the modem, the robot acts on it in its BLE callback
+// (sealed links: SEAL_MARK_ESTOP frames, compact_seal.h).
+
+#define ESTOP_RELEASE     0x5AFE
+
+static inline int cmd_word_is_estop(uint64_t w) {
+    return cmd_word_type(w) == System_CMD && cmd_sys_get_instruction(w) == EMERGENCY_SHTDWN &&
+           cmd_sys_get_specific(w) != ESTOP_RELEASE;
+}
+
+// ------------------------- Scheduled execution -------------------------
+// CONTROL and ARM words may carry at: the robot clock (esp_timer) in
+// 2^EXEC_AT_SHIFT us ticks, mod 2^16, when the word is to run; 0 = on
+// arrival. The robot holds an early word in its motion lane until then (a
+// jitter buffer), so link jitter shorter than the sender's lead never
+// reaches the wheels. A word whose time has passed (but not its deadline,
+// below), or is more than EXEC_AT_HORIZON_MS ahead (a stale clock
+// estimate), runs at once.
+//
+// Deadlines: a drive or arm word that runs late is worse than none. Each
+// has one, its execute-at time plus EXEC_AT_LATE_MS or, with no usable at,
+// its arrival plus MOTION_DEADLINE_MS; the robot runs due words earliest
+// deadline first and drops one that is past it (RESULT_CMD_FAILURE,
+// CMD_EXPIRED) instead of running it. The GS holds queued words to the same
+// budget (tx_sched.h). Targets, trajectory words and System / Query words
+// never expire: they run late rather than not at all.
+//
+// The sender learns the robot clock from CLOCK_SYNC queries. The ACK's
+// instruction_specific is the robot clock when the query arrived (us, low
+// 32 bits) and, in bits 32..39, the time from there to the ACK in
+// CLOCK_HOLD_UNIT_US (CLOCK_HOLD_MAX = saturated, drop the sample). With
+// its own write and ACK times that is one NTP exchange.
+
+#define EXEC_AT_SHIFT       10              // 1024 us ticks: 2^32 us is a whole number of 2^16 ticks
+#define EXEC_AT_MASK        0xFFFF
+#define EXEC_AT_HORIZON_MS  1000
+#define EXEC_AT_LATE_MS     250             // Deadline past the execute-at time
+#define MOTION_DEADLINE_MS  250             // ... past arrival, words without one
+#define CLOCK_HOLD_UNIT_US  16
+#define CLOCK_HOLD_MAX      0xFF
+
+// at for robot clock clock_us (low 32 bits)
+static inline uint32_t exec_at_of(uint32_t clock_us) {
+    uint32_t at = (clock_us >> EXEC_AT_SHIFT) & EXEC_AT_MASK;
+    return at ? at : 1;                     // 0 means "on arrival"
+}
+
+// us from clock_us until at; negative once it is due
+static inline int32_t exec_at_until_us(uint32_t at, uint32_t clock_us) {
+    int32_t ticks = (int16_t)(uint16_t)(at - (clock_us >> EXEC_AT_SHIFT));
+    return ticks * (1 << EXEC_AT_SHIFT) - (int32_t)(clock_us & ((1u << EXEC_AT_SHIFT) - 1));
+}
+
+// CLOCK_SYNC ACK info for a query that arrived at t_rx_us and was held hold_us
+static inline uint64_t clock_sync_info(uint32_t t_rx_us, uint32_t hold_us) {
+    uint32_t hold = hold_us / CLOCK_HOLD_UNIT_US;
+    uint64_t v = (uint64_t)t_rx_us | (uint64_t)(hold > CLOCK_HOLD_MAX ? CLOCK_HOLD_MAX : hold) << 32;
+    return v ? v : 1;                       // Never NO_INFO: an ACK range would swallow it
+}
+
+// ------------------------- Trajectory -------------------------
+// A maneuver is uploaded once and run by the robot on its own clock, so
+// link latency and loss no longer turn into path error. Segment idx is a
+// TRAJ_OP_DRIVE word (ms at wheel velocities fl..br, as drivetrain_set())
+// and, optionally, a TRAJ_OP_ARM word after it (an arm target reached by
+// one coordinated move starting with the segment, as ARM_TARGET_CMD). A
+// drive word clears its slot's arm word. Neither carries an id or is
+// ACKed; TRAJ_OP_RUN is, and checks the upload first: every slot below
+// count loaded (else TRAJ_INCOMPLETE) and traj_crc() over the slots equal
+// to crc (else TRAJ_CRC_MISMATCH). A resent RUN with the id already
+// running is ACKed again without a restart. TRAJ_OP_ABORT stops at once
+// (drive ramps down, the arm holds where it is heading). A load, a manual
+// CONTROL or ARM word, power off or an e-stop also ends a running
+// trajectory. HR words report health.traj (enum traj_states) and the
+// segment running (traj_seg).
+
+enum traj_ops {
+    TRAJ_OP_DRIVE = 0,
+    TRAJ_OP_ARM   = 1,
+    TRAJ_OP_RUN   = 2,
+    TRAJ_OP_ABORT = 3,
+};
+
+enum traj_states {
+    TRAJ_IDLE    = 0,
+    TRAJ_RUNNING = 1,
+    TRAJ_DONE    = 2,
+    TRAJ_ABORTED = 3,
+};
+
+#define TRAJ_SEGS_MAX  32                   // Segments per upload (idx is 6 bits)
+
+// CRC-16/CCITT-FALSE over the word's 8 wire bytes; chain from 0xFFFF over
+// each slot's drive word, then its arm word when it has one, in idx order
+static inline uint16_t traj_crc(uint16_t crc, uint64_t w) {
+    for (int i = 0; i < 8; i++) {
+        crc ^= (uint16_t)((w >> (8 * i)) & 0xFF) << 8;
+        for (int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (uint16_t)(crc << 1) ^ 0x1021 : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+// ------------------------- ACK ranges -------------------------
+// ACK_MODE 1: a command that succeeded with nothing to report (NO_INFO) is
+// not ACKed on its own. The robot holds its id and sends one ACK word for
+// the lot: result_code RESULT_ACK_RANGE, id = the newest id held, bit i of
+// instruction_specific = id - 1 - i (11-bit wrap) was held too. An id that
+// does not fit the window, any other ACK and the hold time running out send
+// the range first, so the receiver still sees ACKs in order. Repeated ids
+// are ACKed once. The bits above the window carry the robot's credits
+// (CREDIT_MAX above).
+
+#define ACK_RANGE_BITS    32
+#define ACK_RANGE_ID_MASK 0x7FF             // ack.id width
+#define ACK_RANGE_CREDIT_SHIFT ACK_RANGE_BITS
+#define ACK_RANGE_HOLD_MS 50                // Default ACK_MODE hold time
+
+typedef struct {
+    uint32_t newest;                        // Highest id held (mod 2048)
+    uint64_t older;                         // Bit i = newest - 1 - i held
+    int      n;                             // Ids held, 0 = empty
+} ack_range_t;
+
+// 0 = held, -1 = outside the window: send the range, clear it, add again
+static inline int ack_range_add(ack_range_t *r, uint32_t id) {
+    id &= ACK_RANGE_ID_MASK;
+    if (r->n == 0) {
+        r->newest = id;
+        r->older = 0;
+        r->n = 1;
+        return 0;
+    }
+    uint32_t ahead = (id - r->newest) & ACK_RANGE_ID_MASK;
+    uint32_t back  = (r->newest - id) & ACK_RANGE_ID_MASK;
+    if (ahead == 0) return 0;
+    if (ahead <= ACK_RANGE_BITS) {
+        if (r->older >> (ACK_RANGE_BITS - ahead)) return -1;        // Would push held ids out
+        r->older = (r->older << ahead) | ((uint64_t)1 << (ahead - 1));
+        r->newest = id;
+        r->n++;
+        return 0;
+    }
+    if (back <= ACK_RANGE_BITS) {
+        uint64_t bit = (uint64_t)1 << (back - 1);
+        if (!(r->older & bit)) r->n++;
+        r->older |= bit;
+        return 0;
+    }
+    return -1;
+}
+
+static inline uint64_t ack_range_word(const ack_range_t *r, uint32_t pl, uint32_t credits) {
+    uint64_t info = r->older | (uint64_t)(credits & CREDIT_MAX) << ACK_RANGE_CREDIT_SHIFT;
+    cmd_ack_t a = { .pl = pl, .type = ACK_CMD, .id = r->newest,
+                    .result_code = RESULT_ACK_RANGE, .instruction_specific = info };
+    return cmd_ack_pack(&a);
+}
+
+static inline uint32_t ack_range_credits(uint64_t w) {
+    return (uint32_t)(cmd_ack_get_instruction_specific(w) >> ACK_RANGE_CREDIT_SHIFT) & CREDIT_MAX;
+}
+
+// Ids a RESULT_ACK_RANGE word acknowledges, oldest first; returns the count
+static inline int ack_range_ids(uint64_t w, uint16_t ids[ACK_RANGE_BITS + 1]) {
+    uint32_t newest = cmd_ack_get_id(w);
+    uint64_t older = cmd_ack_get_instruction_specific(w) & (((uint64_t)1 << ACK_RANGE_BITS) - 1);
+    int n = 0;
+    for (int i = ACK_RANGE_BITS - 1; i >= 0; i--) {
+        if (older & ((uint64_t)1 << i)) ids[n++] = (uint16_t)((newest - 1 - (uint32_t)i) & ACK_RANGE_ID_MASK);
+    }
+    ids[n++] = (uint16_t)newest;
+    return n;
+}
+
+// ------------------------- L2CAP data channel -------------------------
+// Besides the GATT service (0x00FF), a robot on the NimBLE host accepts one
+// LE credit-based L2CAP channel per connection on ROBOT_L2CAP_PSM. Each SDU
+// carries exactly what one GATT write or notification would (a word, a
+// batch, a sealed or compact frame), up to ROBOT_L2CAP_MTU bytes. Once the
+// channel is open every report for that central goes over it; GATT stays
+// for discovery and for centrals that never open the channel.
+
+#define ROBOT_L2CAP_PSM     0x0081          // LE dynamic range 0x0080-0x00FF
+#define ROBOT_L2CAP_MTU     512
+
+// ------------------------- Runtime metrics -------------------------
+// A third characteristic in the robot service, ROBOT_METRICS_UUID (read,
+// notify), for profiling a robot in the field without a cable. Every
+// BLE_METRICS_MS a subscribed link gets one METRICS_SYS frame and then the
+// task table in METRICS_TASKS frames, as many rows per frame as its MTU
+// allows; a read returns the latest METRICS_SYS frame. seq ties the frames
+// of one snapshot together. Little-endian, packed. Counters are running
+// totals since boot (the 16-bit histogram ones wrap); cpu_pm and load_pm
+// cover the time since the previous snapshot.
+
+#define ROBOT_METRICS_UUID     0xFF03
+#define METRICS_VERSION        1
+#define METRICS_SYS            1
+#define METRICS_TASKS          2
+#define METRICS_TASK_NAME      8            // Truncated, not NUL-terminated when full
+#define METRICS_DEC_BUCKETS    8            // Decrypt time: < 32 us, then doubling, >= 2048 us last
+#define METRICS_DEC_BUCKET0_US 32
+
+typedef struct __attribute__((packed)) {
+    uint8_t  version;                       // METRICS_VERSION
+    uint8_t  kind;                          // METRICS_SYS / METRICS_TASKS
+    uint16_t seq;
+} metrics_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    metrics_hdr_t h;
+    uint32_t uptime_ms;
+    uint16_t load_pm[2];                    // Per-core load, 0.1 %
+    uint32_t heap_free, heap_min;
+    uint8_t  rx_used, rx_peak;              // RX pool slots in use (the receive queue)
+    uint8_t  tx_depth, tx_peak;             // Deepest per-link notify queue
+    uint8_t  lane[3];                       // Executor lanes: sys, motion, obs (the command queue)
+    uint8_t  ntasks;                        // Rows in this snapshot's METRICS_TASKS frames
+    uint32_t rx_drops;                      // Writes lost: RX pool exhausted or ring full
+    uint32_t tx_drops;                      // Notifies dropped or evicted (txq_stats)
+    uint32_t auth_fail;                     // Sealed frames that failed the tag
+    uint32_t replay_drops;
+    uint32_t congest;                       // Times ble_congested was raised
+    uint32_t congest_ms;                    // Time it stayed raised
+    uint16_t dec_hist[METRICS_DEC_BUCKETS];
+} metrics_sys_t;
+
+typedef struct __attribute__((packed)) {
+    char     name[METRICS_TASK_NAME];
+    uint8_t  core;                          // 0xFF = either core
+    uint8_t  prio;
+    uint16_t cpu_pm;                        // Share of the interval, 0.1 % of one core
+    uint16_t stack_free;                    // High-water mark, bytes
+} metrics_task_t;
+
+typedef struct __attribute__((packed)) {
+    metrics_hdr_t h;
+    uint8_t  first;                         // Index of the first row in this frame
+    uint8_t  count;                         // metrics_task_t rows that follow
+} metrics_tasks_t;
+
+_Static_assert(sizeof(metrics_sys_t) == 68, "metrics_sys_t layout is shared with the GS");
+_Static_assert(sizeof(metrics_task_t) == 14, "metrics_task_t layout is shared with the GS");
+
+static inline int metrics_dec_bucket(uint32_t us) {
+    int b = 0;
+    for (uint32_t lim = METRICS_DEC_BUCKET0_US; b < METRICS_DEC_BUCKETS - 1 && us >= lim; lim <<= 1) b++;
+    return b;
+}
+
+// ------------------------- Priority characteristic -------------------------
+// A fourth characteristic in the robot service, ROBOT_PRIO_UUID (notify).
+// A central that enables its CCCD gets ACK and HPR words there (which
+// includes the e-stop's ACK), in the same encoding as on 0xFF02; every other
+// report stays on 0xFF02. The robot keeps a separate notify queue per link
+// for it that drains before the 0xFF02 one, and a priority word never waits
+// behind queued telemetry. A central that leaves the CCCD off (older
+// firmware has none to write) gets everything on 0xFF02 as before. An open
+// L2CAP channel carries both, priority SDUs first.
+
+#define ROBOT_PRIO_UUID        0xFF04
+
+// ------------------------- Multi-central -------------------------
+// A robot takes up to two centrals, each with its own session: security
+// level (SECURITY_LEVEL applies to the central that sent it), replay
+// window and the report topics it receives (SUBSCRIBE; all of them after
+// connecting). One central at a time owns the control lane: the first to
+// send a motion word (CONTROL, ARM, ARM_TARGET or TRAJ), or the one whose
+// CONTROL_OWNER 1 is granted, until it sends CONTROL_OWNER 0 or
+// disconnects. Motion words from any other central are refused
+// (RESULT_CMD_FAILURE, CONTROL_HELD); its System and Query words run only
+// when the owner has nothing queued. An e-stop stops the robot whoever
+// sends it.
+//
+// A central on a poor link can also ask for a telemetry gap (SUBSCRIBE bits
+// 8-23, up to TLM_GAP_MAX_MS; 0 after connecting): telemetry batches then
+// go out at least that far apart, reports due in between merging into the
+// next one, which leaves the air time to commands and ACKs. Telemetry is
+// built once for every central, so the largest gap any subscribed central
+// asked for paces them all.
+
+enum report_topics {
+    TOPIC_ACK        = 0x01,                // ACK and HPR words
+    TOPIC_TELEMETRY  = 0x02,                // ROBOT_UPDATE words and batches
+    TOPIC_HEALTH     = 0x04,
+    TOPIC_ALL        = 0x07,
+};
+
+#define TLM_GAP_MAX_MS  5000
+
+// ------------------------- Link benchmark -------------------------
+// LINK_ECHO 1 makes the link a loopback for the GS's link benchmark: a
+// write (or L2CAP SDU) starting with LINK_ECHO_TAG comes straight back as
+// a notification from the BLE receive path, byte for byte, without the RX
+// pool, the executor or the session's cipher. Every other write is handled
+// as usual, so LINK_ECHO 0 and an e-stop still get through. The mode ends
+// with the connection. Layout (the GS's; the robot only reads the tag):
+//   [0] LINK_ECHO_TAG  [1] frame length  [2..3] seq (LE)  [4] suite  [5..] body
+// The length byte lets the GS split an unframed passthrough stream.
+
+#define LINK_ECHO_TAG     0xB8
+#define LINK_ECHO_HDR     5
+#define LINK_ECHO_MAX     244               // One write at the largest ATT MTU (247 - 3)
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef COMPACT_SEAL_H
+#define COMPACT_SEAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "replay_window.h"
+
+// -----------------------------------------------------------------------------
+// Compact sealed command frame (GS bridge -> robot firmware).
+//
+// The 160-byte 0x0A 0xD0 / 0xD1 frame seals a 128-byte padded block to carry
+// one 8-byte word. The compact frame seals just the words:
+//
+//   0x0A | SEAL_MARK_WORD  |     nonce[12] | ct[8]      | tag[16] | 0xDA 0x0D   40 bytes
+//   0x0A | SEAL_MARK_BATCH | n | nonce[12] | ct[8 * n]  | tag[16] | 0xDA 0x0D   33 + 8n
+//   0x0A | SEAL_MARK_ESTOP |     nonce[12] | ct[8]      | tag[16] | 0xDA 0x0D   40 bytes
+//
+// SEAL_MARK_ESTOP is a SEAL_MARK_WORD frame whose word is an emergency stop
+// (cmd_word_is_estop). It only tells the robot which frame is worth opening
+// in its BLE callback; the tag still decides, so a forged mark stops nothing.
+//
+// The nonce is the one the 160-byte frames carry (replay_window.h): the
+// sender's random session salt with the direction bit, then its 64-bit
+// sequence, so both forms share the sender's counter and the receiver's
+// replay window. It goes whole: the sequence starts from the sender's
+// clock, and a bridge that boots to the same clock every time would repeat
+// (key, nonce) pairs under an implied fixed salt. n is in clear so the
+// frame can be cut without decrypting; it sets the ciphertext length GCM
+// authenticates, so an edited n fails the tag.
+//
+// Body = the bytes between the mark and 0xDA 0x0D.
+// -----------------------------------------------------------------------------
+
+#define SEAL_SOF          0x0A
+#define SEAL_MARK_WORD    0xD2
+#define SEAL_MARK_BATCH   0xD3
+#define SEAL_MARK_ESTOP   0xD4
+#define SEAL_EOF0         0xDA
+#define SEAL_EOF1         0x0D
+#define SEAL_NONCE_LEN    REPLAY_NONCE_LEN
+#define SEAL_TAG_LEN      16
+#define SEAL_BATCH_MAX    15                // Same word limit as a 160-byte seal
+
+#define SEAL_WORD_BODY        (SEAL_NONCE_LEN + 8 + SEAL_TAG_LEN)
+#define SEAL_BATCH_BODY(n)    (1 + SEAL_NONCE_LEN + 8 * (n) + SEAL_TAG_LEN)
+#define SEAL_FRAME_LEN(body)  ((body) + 4)
+#define SEAL_FRAME_MAX        SEAL_FRAME_LEN(SEAL_BATCH_BODY(SEAL_BATCH_MAX))
+
+// Words in a compact body: 1 for SEAL_MARK_WORD / SEAL_MARK_ESTOP, n for
+// SEAL_MARK_BATCH, 0 if n is out of range
+static inline int seal_words(uint8_t mark, const uint8_t *body)
+{
+    if (mark == SEAL_MARK_WORD || mark == SEAL_MARK_ESTOP) return 1;
+    return (body[0] >= 1 && body[0] <= SEAL_BATCH_MAX) ? body[0] : 0;
+}
+
+// Offset of the nonce in a compact body
+static inline size_t seal_nonce_off(uint8_t mark)
+{
+    return mark == SEAL_MARK_BATCH ? 1 : 0;
+}
+
+// Whole frame length of the compact frame at p: 0 = more bytes needed,
+// -1 = not a compact frame (or a bad count)
+static inline int seal_frame_len(const uint8_t *p, size_t n)
+{
+    if (n < 2) return (n == 0 || p[0] == SEAL_SOF) ? 0 : -1;
+    if (p[0] != SEAL_SOF) return -1;
+    if (p[1] == SEAL_MARK_WORD || p[1] == SEAL_MARK_ESTOP) return SEAL_FRAME_LEN(SEAL_WORD_BODY);
+    if (p[1] != SEAL_MARK_BATCH) return -1;
+    if (n < 3) return 0;
+    int words = seal_words(SEAL_MARK_BATCH, p + 2);
+    return words ? SEAL_FRAME_LEN(SEAL_BATCH_BODY(words)) : -1;
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef REPLAY_WINDOW_H
+#define REPLAY_WINDOW_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// -----------------------------------------------------------------------------
+// Shared replay window for sealed frames (GS bridge, robot firmware).
+//
+// Every sealed frame's 12-byte GCM nonce is
+//   [0]      direction (REPLAY_DIR_*) | 7 random session bits
+//   [1..3]   random session salt
+//   [4..11]  64-bit big-endian sequence number, +1 per frame
+// GCM authenticates the nonce, so the sequence cannot be edited without
+// failing the tag. The direction bit keeps the two ends (one shared key)
+// from ever drawing the same nonce and lets a receiver refuse its own
+// frames reflected back at it.
+//
+// A receiver keeps one replay_window_t per link: the highest sequence
+// accepted plus a 64-bit bitmap of the ones just below it. replay_check()
+// before decrypting, replay_accept() only once the tag has verified (a
+// forged frame must not move the window). Both are O(1), no allocation.
+// -----------------------------------------------------------------------------
+
+#define REPLAY_NONCE_LEN  12
+#define REPLAY_DIR_MASK   0x80
+#define REPLAY_DIR_GS     0x00              // GS -> robot commands
+#define REPLAY_DIR_ROBOT  0x80              // Robot -> GS reports
+#define REPLAY_WINDOW     64
+
+typedef struct {
+    uint64_t top;                           // Highest sequence accepted
+    uint64_t seen;                          // Bit i: top - i accepted
+    bool     armed;                         // false until the first frame
+} replay_window_t;
+
+static inline void replay_reset(replay_window_t *w)
+{
+    w->top = 0;
+    w->seen = 0;
+    w->armed = false;
+}
+
+// Sequence number of a nonce sealed by the dir end; false if the nonce
+// comes from the other direction
+static inline bool replay_nonce_seq(const uint8_t nonce[REPLAY_NONCE_LEN], uint8_t dir, uint64_t *seq)
+{
+    if ((nonce[0] & REPLAY_DIR_MASK) != dir) return false;
+    uint64_t s = 0;
+    for (int i = 4; i < REPLAY_NONCE_LEN; i++) s = s << 8 | nonce[i];
+    *seq = s;
+    return true;
+}
+
+// true = seq is new (ahead of the window, or inside it and not yet seen)
+static inline bool replay_check(const replay_window_t *w, uint64_t seq)
+{
+    if (!w->armed || seq > w->top) return true;
+    uint64_t age = w->top - seq;
+    if (age >= REPLAY_WINDOW) return false;
+    return !(w->seen >> age & 1);
+}
+
+static inline void replay_accept(replay_window_t *w, uint64_t seq)
+{
+    if (!w->armed) {
+        w->top = seq;
+        w->seen = 1;
+        w->armed = true;
+        return;
+    }
+    if (seq > w->top) {
+        uint64_t shift = seq - w->top;
+        w->seen = shift >= REPLAY_WINDOW ? 0 : w->seen << shift;
+        w->seen |= 1;
+        w->top = seq;
+        return;
+    }
+    if (w->top - seq < REPLAY_WINDOW) w->seen |= (uint64_t)1 << (w->top - seq);
+}
+
+// Nonce for the next frame sealed by this end: salt[0] gets the direction
+// bit, *seq is post-incremented. false once the sequence would wrap.
+static inline bool replay_nonce_next(uint8_t nonce[REPLAY_NONCE_LEN], const uint8_t salt[4],
+                                     uint8_t dir, uint64_t *seq)
+{
+    if (*seq == UINT64_MAX) return false;
+    uint64_t s = (*seq)++;
+    nonce[0] = (uint8_t)((salt[0] & ~REPLAY_DIR_MASK) | dir);
+    nonce[1] = salt[1];
+    nonce[2] = salt[2];
+    nonce[3] = salt[3];
+    for (int i = 0; i < 8; i++) nonce[4 + i] = (uint8_t)(s >> (56 - 8 * i));
+    return true;
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef TLM_FEC_H
+#define TLM_FEC_H
+
+#include <stdint.h>
+#include <string.h>
+#include "cmd_codec.h"
+
+// -----------------------------------------------------------------------------
+// Telemetry forward error correction (robot firmware -> GS bridge).
+//
+// Telemetry is never retransmitted: a lost batch used to cost a whole report
+// period. With parity on, the robot tags each telemetry batch with one
+// FEC_CMD word (row 0: group, index) and after k batches, or FEC flush time,
+// sends one or two parity batches for the group:
+//
+//   data:    w0 .. wn-1 | tag(group, index)                  index 0 .. k-1
+//   parity:  tag(group, row, k, slots) | r0 .. rslots-1      row 1, then row 2
+//
+// Parity word j runs over word j of every data batch (missing words count
+// as 0; a report word is never 0, its type is not). Bytewise over GF(2^8)
+// (x^8 + x^4 + x^3 + x^2 + 1, generator 2), as RAID-6:
+//   row 1  P_j = D_0j ^ D_1j ^ ... ^ D_(k-1)j                    one loss
+//   row 2  Q_j = D_0j ^ 2 D_1j ^ ... ^ 2^(k-1) D_(k-1)j          with P: two
+// so the GS rebuilds one lost batch from either row and two from both,
+// without a round trip. Batches of an older group, or a group whose parity
+// was lost, are gone as before.
+// -----------------------------------------------------------------------------
+
+#define FEC_K_MAX      15                   // Data batches per group (index field)
+#define FEC_SLOTS_MAX  14                   // Words per data batch; tag + slots fit one batch
+#define FEC_ROWS_MAX   2
+
+static inline uint8_t fec_gf_mul(uint8_t a, uint8_t b)
+{
+    uint8_t r = 0;
+    while (b) {
+        if (b & 1) r ^= a;
+        a = (uint8_t)((a << 1) ^ ((a & 0x80) ? 0x1D : 0));
+        b >>= 1;
+    }
+    return r;
+}
+
+static inline uint8_t fec_gf_pow2(unsigned e)
+{
+    uint8_t r = 1;
+    while (e--) r = fec_gf_mul(r, 2);
+    return r;
+}
+
+static inline uint8_t fec_gf_inv(uint8_t a)   // a^254; a != 0
+{
+    uint8_t r = 1;
+    for (unsigned e = 254; e; e >>= 1) {
+        if (e & 1) r = fec_gf_mul(r, a);
+        a = fec_gf_mul(a, a);
+    }
+    return r;
+}
+
+// Each byte of w times c
+static inline uint64_t fec_mul64(uint64_t w, uint8_t c)
+{
+    uint64_t r = 0;
+    for (int b = 0; b < 64; b += 8) r |= (uint64_t)fec_gf_mul((uint8_t)(w >> b), c) << b;
+    return r;
+}
+
+static inline uint64_t fec_tag(uint32_t group, uint32_t index, uint32_t row, uint32_t k, uint32_t slots)
+{
+    cmd_fec_t t = { .pl = 1, .type = FEC_CMD, .group = group, .index = index, .row = row, .k = k, .slots = slots };
+    return cmd_fec_pack(&t);
+}
+
+// ------------------------- Encoder (robot) -------------------------
+
+typedef struct {
+    uint8_t  group;                         // Current group id, mod 256
+    uint8_t  count;                         // Data batches in it so far
+    uint8_t  slots;                         // Longest one, words
+    uint64_t p[FEC_SLOTS_MAX], q[FEC_SLOTS_MAX];
+} fec_enc_t;
+
+static inline void fec_enc_reset(fec_enc_t *e)
+{
+    uint8_t g = e->group;
+    memset(e, 0, sizeof(*e));
+    e->group = g;
+}
+
+// Folds words[0..n) into the group's parity and appends the tag at words[n]
+// (room for it is the caller's); returns n + 1. n <= FEC_SLOTS_MAX, and
+// count < FEC_K_MAX (send the parity first).
+static inline int fec_enc_data(fec_enc_t *e, robot_bt_packet_t *words, int n)
+{
+    uint8_t g = fec_gf_pow2(e->count);
+    for (int j = 0; j < n; j++) {
+        e->p[j] ^= words[j].raw;
+        e->q[j] ^= fec_mul64(words[j].raw, g);
+    }
+    if (n > e->slots) e->slots = (uint8_t)n;
+    words[n].raw = fec_tag(e->group, e->count++, 0, 0, 0);
+    return n + 1;
+}
+
+// Parity batch of row 1 or 2 into out (1 + slots words); returns its length
+static inline int fec_enc_parity(const fec_enc_t *e, int row, robot_bt_packet_t *out)
+{
+    out[0].raw = fec_tag(e->group, 0, (uint32_t)row, e->count, e->slots);
+    for (int j = 0; j < e->slots; j++) out[1 + j].raw = row == 1 ? e->p[j] : e->q[j];
+    return 1 + e->slots;
+}
+
+// The group is out: the next batch starts a new one
+static inline void fec_enc_next(fec_enc_t *e)
+{
+    e->group++;
+    fec_enc_reset(e);
+}
+
+// ------------------------- Recovery (GS) -------------------------
+
+// Rebuilds the missing data batches of a group: d[i] for every i < k not in
+// have (bit i), from p (row 1) and / or q (row 2), NULL if not received.
+// Returns the number rebuilt, 0 if the rows at hand are not enough.
+static inline int fec_recover(int k, uint32_t have, int slots, uint64_t d[][FEC_SLOTS_MAX],
+                              const uint64_t *p, const uint64_t *q)
+{
+    int miss[FEC_ROWS_MAX + 1], m = 0;
+    for (int i = 0; i < k && m <= FEC_ROWS_MAX; i++)
+        if (!(have & (1u << i))) miss[m++] = i;
+    if (m == 0 || m > FEC_ROWS_MAX || (m == 2 && !(p && q)) || (!p && !q)) return 0;
+
+    for (int j = 0; j < slots; j++) {
+        uint64_t ps = p ? p[j] : 0, qs = q ? q[j] : 0;    // Syndromes: the known batches taken out
+        for (int i = 0; i < k; i++) {
+            if (!(have & (1u << i))) continue;
+            ps ^= d[i][j];
+            qs ^= fec_mul64(d[i][j], fec_gf_pow2((unsigned)i));
+        }
+        int x = miss[0];
+        if (m == 1) {
+            d[x][j] = p ? ps : fec_mul64(qs, fec_gf_inv(fec_gf_pow2((unsigned)x)));
+            continue;
+        }
+        int y = miss[1];
+        uint8_t gx = fec_gf_pow2((unsigned)x), gy = fec_gf_pow2((unsigned)y);
+        uint64_t dx = fec_mul64(fec_mul64(ps, gy) ^ qs, fec_gf_inv(gx ^ gy));
+        d[x][j] = dx;
+        d[y][j] = ps ^ dx;
+    }
+    return m;
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include "hex_codec.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#include <string.h>
+#include <wasm_simd128.h>
+#endif
+
+#define X -1
+const int8_t hexc_nibble[256] = {
+    X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,X, X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,
+    X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,X, 0,1,2,3,4,5,6,7,8,9,X,X,X,X,X,X,
+    X,10,11,12,13,14,15,X,X,X,X,X,X,X,X,X, X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,
+    X,10,11,12,13,14,15,X,X,X,X,X,X,X,X,X, X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,
+    X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,X, X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,
+    X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,X, X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,
+    X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,X, X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,
+    X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,X, X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,X,
+};
+#undef X
+
+// ------------------------- 16 chars -> 8 bytes -------------------------
+
+#if defined(__SSE2__)
+static int decode16(const char *hex, uint8_t *out) {
+    const __m128i v     = _mm_loadu_si128((const __m128i *)hex);
+    const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));          // 'A'-'F' -> 'a'-'f'
+
+    // Signed compares are fine: bytes >= 0x80 are negative and fail both ranges
+    __m128i is_dig = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                   _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    __m128i is_alp = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                   _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    if (_mm_movemask_epi8(_mm_or_si128(is_dig, is_alp)) != 0xFFFF) return -1;
+
+    __m128i dig = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i alp = _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10));
+    __m128i nib = _mm_or_si128(_mm_and_si128(is_dig, dig), _mm_andnot_si128(is_dig, alp));
+
+    // 16-bit lanes hold (hi nibble, lo nibble) pairs: byte = hi << 4 | lo
+    __m128i hi = _mm_slli_epi16(_mm_and_si128(nib, _mm_set1_epi16(0x00FF)), 4);
+    __m128i lo = _mm_srli_epi16(nib, 8);
+    __m128i b  = _mm_packus_epi16(_mm_or_si128(hi, lo), _mm_setzero_si128());
+    _mm_storel_epi64((__m128i *)out, b);
+    return 0;
+}
+#define HEXC_HAVE_SIMD 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+static int decode16(const char *hex, uint8_t *out) {
+    const uint8x8x2_t v = vld2_u8((const uint8_t *)hex);                // [0] = hi chars, [1] = lo chars
+    uint8x8_t nib[2];
+    uint8x8_t ok = vdup_n_u8(0xFF);
+
+    for (int k = 0; k < 2; k++) {
+        uint8x8_t c     = v.val[k];
+        uint8x8_t lower = vorr_u8(c, vdup_n_u8(0x20));
+        uint8x8_t dig   = vsub_u8(c, vdup_n_u8('0'));
+        uint8x8_t alp   = vsub_u8(lower, vdup_n_u8('a'));
+        uint8x8_t is_dig = vclt_u8(dig, vdup_n_u8(10));
+        uint8x8_t is_alp = vclt_u8(alp, vdup_n_u8(6));
+        ok = vand_u8(ok, vorr_u8(is_dig, is_alp));
+        nib[k] = vbsl_u8(is_dig, dig, vadd_u8(alp, vdup_n_u8(10)));
+    }
+    if (vminv_u8(ok) != 0xFF) return -1;
+
+    vst1_u8(out, vorr_u8(vshl_n_u8(nib[0], 4), nib[1]));
+    return 0;
+}
+#define HEXC_HAVE_SIMD 1
+#elif defined(__wasm_simd128__)
+static int decode16(const char *hex, uint8_t *out) {
+    const v128_t v     = wasm_v128_load(hex);
+    const v128_t lower = wasm_v128_or(v, wasm_i8x16_splat(0x20));
+
+    v128_t dig    = wasm_i8x16_sub(v, wasm_i8x16_splat('0'));
+    v128_t alp    = wasm_i8x16_sub(lower, wasm_i8x16_splat('a'));
+    v128_t is_dig = wasm_u8x16_lt(dig, wasm_i8x16_splat(10));
+    v128_t is_alp = wasm_u8x16_lt(alp, wasm_i8x16_splat(6));
+    if (!wasm_i8x16_all_true(wasm_v128_or(is_dig, is_alp))) return -1;
+    v128_t nib = wasm_v128_bitselect(dig, wasm_i8x16_add(alp, wasm_i8x16_splat(10)), is_dig);
+
+    // 16-bit lanes hold (hi nibble, lo nibble) pairs: byte = hi << 4 | lo
+    v128_t hi = wasm_i16x8_shl(wasm_v128_and(nib, wasm_i16x8_splat(0x00FF)), 4);
+    v128_t lo = wasm_u16x8_shr(nib, 8);
+    v128_t b  = wasm_u8x16_narrow_i16x8(wasm_v128_or(hi, lo), wasm_i16x8_splat(0));
+    uint64_t bytes = (uint64_t)wasm_i64x2_extract_lane(b, 0);
+    memcpy(out, &bytes, 8);
+    return 0;
+}
+#define HEXC_HAVE_SIMD 1
+#endif
+
+// ------------------------- Public API -------------------------
+
+int hexc_decode(const char *hex, size_t hex_len, uint8_t *out) {
+    if (!hex || !out || (hex_len & 1)) return -1;
+
+    size_t i = 0;
+#ifdef HEXC_HAVE_SIMD
+    for (; i + 16 <= hex_len; i += 16) {
+        if (decode16(hex + i, out + i / 2) != 0) return -1;
+    }
+#endif
+    for (; i < hex_len; i += 2) {
+        int hi = hexc_nibble[(uint8_t)hex[i]];
+        int lo = hexc_nibble[(uint8_t)hex[i + 1]];
+        if ((hi | lo) < 0) return -1;
+        out[i / 2] = (uint8_t)((hi << 4) | lo);
+    }
+    return (int)(hex_len / 2);
+}
+
+void hexc_encode(const uint8_t *in, size_t n, char *out, int upper) {
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    for (size_t i = 0; i < n; i++) {
+        out[2 * i]     = digits[in[i] >> 4];
+        out[2 * i + 1] = digits[in[i] & 0x0F];
+    }
+    out[2 * n] = '\0';
+}
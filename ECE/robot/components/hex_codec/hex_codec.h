@@ -0,0 +1,23 @@
+#ifndef HEX_CODEC_H
+#define HEX_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// -----------------------------------------------------------------------------
+// Shared hex codec (GS bridge, robot firmware, encryption tools, wasm).
+// Decode validates as it goes: any non-hex character fails the whole call.
+// x86 builds use SSE2 and AArch64 (Zynq A53) builds use NEON for 16-char
+// blocks; everything else (ESP32, wasm) uses the 256-entry table.
+// -----------------------------------------------------------------------------
+
+extern const int8_t hexc_nibble[256];        // '0'-'9','a'-'f','A'-'F' -> 0..15, else -1
+
+// Decode hex_len chars (must be even) into hex_len/2 bytes.
+// Returns the byte count, or -1 on odd length / invalid character.
+int hexc_decode(const char *hex, size_t hex_len, uint8_t *out);
+
+// Encode n bytes as 2n chars plus a NUL terminator (out must hold 2n + 1).
+void hexc_encode(const uint8_t *in, size_t n, char *out, int upper);
+
+#endif
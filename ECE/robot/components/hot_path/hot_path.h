@@ -0,0 +1,35 @@
+#ifndef HOT_PATH_H
+#define HOT_PATH_H
+
+#include "esp_attr.h"
+
+// -------------------------------------------------------------------------
+// Hot-path placement
+//
+// -D ROBOT_IRAM_HOT=1 (env:esp32dev_perf) links the per-word command path
+// into IRAM: the GATT write framing and the RX pool, the executor's decode /
+// sort / dispatch, the AEAD wrappers, control_cmd and motor_pulse, and the
+// tables they read into DRAM. Code and constants in flash are fetched
+// through the 32 KB flash cache, and a line the BLE stack or telemetry
+// evicted stalls the core for a flash read (~microseconds at 40 MHz DIO);
+// IRAM never waits on it. What these call in flash (wolfSSL's AES, the
+// MCPWM / esp_timer drivers) still goes through the cache.
+//
+// Off by default: IRAM is shared with the BLE controller and the ISRs, so
+// the set stays the per-word path. pio run -e esp32dev_perf -t size shows
+// what is left.
+// -------------------------------------------------------------------------
+
+#ifndef ROBOT_IRAM_HOT
+#define ROBOT_IRAM_HOT 0
+#endif
+
+#if ROBOT_IRAM_HOT
+#define HOT_PATH IRAM_ATTR                  // Function in IRAM
+#define HOT_DATA DRAM_ATTR                  // Constant table in DRAM
+#else
+#define HOT_PATH
+#define HOT_DATA
+#endif
+
+#endif
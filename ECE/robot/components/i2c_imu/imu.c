@@ -1,23 +1,64 @@
 #include "imu.h"
 
-quaternion_t g_imu_quat  = {0};
-vec3_t       g_imu_accel = {0};
-gyro_t       g_imu_gyro  = {0};
-euler_t      g_imu_euler = {0};
+#include <stdatomic.h>
+#include "task_alloc.h"
+
+// Double buffer with a sequence count per slot. The writer fills the slot
+// readers are not pointed at, then flips imu_front; a reader retries only
+// if the writer lapped it onto the same slot mid-copy (seq changed or odd).
+typedef struct {
+    _Atomic uint32_t seq;
+    imu_sample_t     s;
+} imu_slot_t;
+
+static imu_slot_t       imu_slot[2];
+static _Atomic uint32_t imu_front = 0;
+static imu_sample_t     imu_work;       // Writer's copy, updated report by report
+static size_t           imu_read_len = IMU_READ_MIN;
+static TaskHandle_t     imu_task_handle = NULL;
+static TaskHandle_t     imu_listener = NULL;
+
+static void imu_publish(const imu_sample_t *s) {
+    uint32_t back = atomic_load_explicit(&imu_front, memory_order_relaxed) ^ 1;
+    imu_slot_t *slot = &imu_slot[back];
+    atomic_fetch_add_explicit(&slot->seq, 1, memory_order_relaxed);    // Odd: being written
+    atomic_thread_fence(memory_order_release);
+    slot->s = *s;
+    atomic_fetch_add_explicit(&slot->seq, 1, memory_order_release);    // Even: stable
+    atomic_store_explicit(&imu_front, back, memory_order_release);
+}
 
+bool imu_get(imu_sample_t *out) {
+    while (1) {
+        imu_slot_t *slot = &imu_slot[atomic_load_explicit(&imu_front, memory_order_acquire)];
+        uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq == 0) return false;                     // Nothing published yet
+        if (seq & 1) continue;
+        *out = slot->s;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq) return true;
+    }
+}
 
+// One I2C read for the usual packet: IMU_READ_MIN bytes or the last
+// packet's length, whichever is larger. A longer packet's tail comes back
+// on the next read behind a fresh header (the continuation), which lands
+// over the 4 bytes it is saved from. buf gets header + payload.
 size_t shtp_read(i2c_master_dev_handle_t dev, uint8_t *buf, size_t buf_len) {
-    uint8_t header[4] = {0};
-    vTaskDelay(pdMS_TO_TICKS(2));
-    if (i2c_master_receive(dev, header, 4, 9000) != ESP_OK) return 0;
-
-    uint16_t packet_len = ((uint16_t)header[1] << 8 | header[0]) & ~0x8000;
-    if (packet_len == 0 || packet_len > buf_len - 4) return 0;
-
-    memcpy(buf, header, 4);
-    vTaskDelay(pdMS_TO_TICKS(2));
-    if (i2c_master_receive(dev, buf + 4, packet_len, 9000) != ESP_OK) return 0;
-
+    size_t first = imu_read_len < buf_len ? imu_read_len : buf_len;
+    if (i2c_master_receive(dev, buf, first, 9000) != ESP_OK) return 0;
+
+    uint16_t packet_len = ((uint16_t)buf[1] << 8 | buf[0]) & ~0x8000;
+    if (packet_len == 0 || packet_len > buf_len) return 0;
+
+    if (packet_len > first) {
+        uint8_t keep[SHTP_HDR_LEN];
+        uint8_t *tail = buf + first - SHTP_HDR_LEN;
+        memcpy(keep, tail, SHTP_HDR_LEN);
+        if (i2c_master_receive(dev, tail, packet_len - first + SHTP_HDR_LEN, 9000) != ESP_OK) return 0;
+        memcpy(tail, keep, SHTP_HDR_LEN);
+    }
+    imu_read_len = packet_len > IMU_READ_MIN ? packet_len : IMU_READ_MIN;
     return packet_len;
 }
 
@@ -99,7 +140,7 @@ bool bno08x_init(i2c_master_dev_handle_t dev) {
 }
 
 static uint8_t g_tare_seq_num = 0;
-inline int16_t read_i16(uint8_t *buf, int offset) {
+static inline int16_t read_i16(const uint8_t *buf, int offset) {
     return (int16_t)((uint16_t)buf[offset] | (uint16_t)buf[offset + 1] << 8);
 }
 
@@ -196,70 +237,119 @@ bool bno085_tare_pitch_only_cmd(i2c_master_dev_handle_t dev) {
 }
 
 
-static bool parse_accelerometer(uint8_t *buf, size_t len, vec3_t *out) {
-    if ((int)len + 4 < DATA_OFFSET + 6) return false;
-    if (buf[REPORT_ID_OFFSET] != REPORT_ACCELEROMETER) return false;
-    const float scale = 1.0f / 256.0f;
-    out->x = read_i16(buf, DATA_OFFSET + 0) * scale;
-    out->y = read_i16(buf, DATA_OFFSET + 2) * scale;
-    out->z = read_i16(buf, DATA_OFFSET + 4) * scale;
-    return true;
+// d points at a report's data (after its 4-byte report header); values
+// stay in the sensor's Q points (pinout.h)
+static void parse_accelerometer(const uint8_t *d, vec3_t *out) {
+    out->x = read_i16(d, 0);
+    out->y = read_i16(d, 2);
+    out->z = read_i16(d, 4);
 }
 
-static bool parse_gyroscope(uint8_t *buf, size_t len, gyro_t *out) {
-    if ((int)len + 4 < DATA_OFFSET + 6) return false;
-    if (buf[REPORT_ID_OFFSET] != REPORT_GYROSCOPE) return false;
-    const float scale = 1.0f / 512.0f;
-    out->x_rads = read_i16(buf, DATA_OFFSET + 0) * scale;
-    out->y_rads = read_i16(buf, DATA_OFFSET + 2) * scale;
-    out->z_rads = read_i16(buf, DATA_OFFSET + 4) * scale;
-    out->x_degs = out->x_rads * R2D;
-    out->y_degs = out->y_rads * R2D;
-    out->z_degs = out->z_rads * R2D;
-    return true;
+static void parse_gyroscope(const uint8_t *d, gyro_t *out) {
+    out->x = read_i16(d, 0);
+    out->y = read_i16(d, 2);
+    out->z = read_i16(d, 4);
 }
 
-static bool parse_rotation_vector(uint8_t *buf, size_t len, quaternion_t *out) {
-    if ((int)len + 4 < DATA_OFFSET + 10) return false;
-    if (buf[REPORT_ID_OFFSET] != REPORT_ROTATION_VECTOR) return false;
-    const float scale_q   = 1.0f / 16384.0f;
-    const float scale_acc = 1.0f / 4096.0f;
-    out->i            = read_i16(buf, DATA_OFFSET + 0) * scale_q;
-    out->j            = read_i16(buf, DATA_OFFSET + 2) * scale_q;
-    out->k            = read_i16(buf, DATA_OFFSET + 4) * scale_q;
-    out->real         = read_i16(buf, DATA_OFFSET + 6) * scale_q;
-    out->accuracy_rad = read_i16(buf, DATA_OFFSET + 8) * scale_acc;
-    return true;
+static void parse_rotation_vector(const uint8_t *d, quaternion_t *out) {
+    out->i        = read_i16(d, 0);
+    out->j        = read_i16(d, 2);
+    out->k        = read_i16(d, 4);
+    out->real     = read_i16(d, 6);
+    out->accuracy = read_i16(d, 8);
 }
 
+// SH-2 record length by report ID, 0 = unknown (stop walking the packet)
+static size_t report_len(uint8_t id) {
+    switch (id) {
+        case REPORT_BASE_TIMESTAMP:
+        case REPORT_TIMESTAMP_REBASE: return 5;
+        case REPORT_ACCELEROMETER:
+        case REPORT_GYROSCOPE:
+        case 0x03: case 0x04: case 0x06: return 10;    // Mag, linear accel, gravity
+        case 0x08:                       return 12;    // Game rotation vector
+        case REPORT_ROTATION_VECTOR:
+        case 0x09:                       return 14;    // Geomagnetic rotation vector
+        case 0x07:                       return 16;    // Uncalibrated gyro
+        default:                         return 0;
+    }
+}
+
+// atan(2^-i) in 1/256 mdeg
+static const int32_t imu_atan_tab[IMU_CORDIC_ITERS] = {
+    11520000, 6800653, 3593278, 1824004, 915542, 458217, 229164, 114589,
+       57295,   28648,   14324,    7162,   3581,   1790,    895,    448,
+};
+
+// CORDIC vectoring: atan2(y, x) in mdeg; *mag (if set) gets hypot(x, y),
+// the CORDIC gain taken back out (0.60725 in Q16). |x|, |y| < 2^30 / 1.65.
+static int32_t cordic_atan2(int32_t y, int32_t x, int32_t *mag) {
+    int32_t z = 0;
+    if (x < 0) {                                    // Rotate into the right half-plane
+        int32_t t = x;
+        if (y >= 0) { x = y;  y = -t; z =  (90000 << IMU_ANG_FRAC); }
+        else        { x = -y; y = t;  z = -(90000 << IMU_ANG_FRAC); }
+    }
+    for (int i = 0; i < IMU_CORDIC_ITERS; i++) {
+        int32_t xs = x >> i, ys = y >> i;
+        if (y > 0) { x += ys; y -= xs; z += imu_atan_tab[i]; }
+        else       { x -= ys; y += xs; z -= imu_atan_tab[i]; }
+    }
+    if (mag) *mag = (int32_t)(((int64_t)x * 39797) >> 16);
+    return (z + (1 << (IMU_ANG_FRAC - 1))) >> IMU_ANG_FRAC;
+}
+
+// Q14 products are Q28, so 2(ab + cd) is ab + cd in Q27. The homogeneous
+// forms (w^2 + k^2 - i^2 - j^2 for 1 - 2(i^2 + j^2)) make every atan2 blind
+// to the quaternion's norm, and pitch comes from atan2(sin, hypot of the
+// roll terms) instead of asin, so it stays exact near +-90 deg.
 static euler_t quaternion_to_euler(const quaternion_t *q) {
+    const int32_t w = q->real, i = q->i, j = q->j, k = q->k;
     euler_t e;
-    float sinr = 2.0f * (q->real * q->i + q->j * q->k);
-    float cosr = 1.0f - 2.0f * (q->i * q->i + q->j * q->j);
-    e.roll  = atan2f(sinr, cosr) * R2D;
-    float sinp = 2.0f * (q->real * q->j - q->k * q->i);
-    e.pitch = (fabsf(sinp) >= 1.0f) ? copysignf(90.0f, sinp) : asinf(sinp) * R2D;
-    float siny = 2.0f * (q->real * q->k + q->i * q->j);
-    float cosy = 1.0f - 2.0f * (q->j * q->j + q->k * q->k);
-    e.yaw   = atan2f(siny, cosy) * R2D;
+    int32_t cosp;
+    e.roll  = cordic_atan2(w * i + j * k, (w * w + k * k - i * i - j * j) >> 1, &cosp);
+    e.pitch = cordic_atan2(w * j - k * i, cosp, NULL);
+    e.yaw   = cordic_atan2(w * k + i * j, (w * w + i * i - j * j - k * k) >> 1, NULL);
     return e;
 }
 
+// Walk every record in one sensor-report packet; true if any was used
+static bool parse_reports(const uint8_t *p, size_t n, imu_sample_t *s) {
+    bool used = false;
+    size_t i = 0;
+    while (i < n) {
+        size_t rec = report_len(p[i]);
+        if (rec == 0 || i + rec > n) break;
+        const uint8_t *d = p + i + REPORT_HDR_LEN;
+        switch (p[i]) {
+            case REPORT_ACCELEROMETER:   parse_accelerometer(d, &s->accel); used = true; break;
+            case REPORT_GYROSCOPE:       parse_gyroscope(d, &s->gyro);      used = true; break;
+            case REPORT_ROTATION_VECTOR:
+                parse_rotation_vector(d, &s->quat);
+                s->euler = quaternion_to_euler(&s->quat);
+                used = true;
+            break;
+            default: break;                             // Timestamps, reports we did not enable
+        }
+        i += rec;
+    }
+    return used;
+}
+
 int imu_check(i2c_master_dev_handle_t imu) {
-    static uint8_t last_seq = 0xFF;
     uint8_t buf[SHTP_BUF_SIZE];
 
     if (gpio_get_level(IMU_INT_PIN) == 1) return -1;  // No data ready
 
     size_t len = shtp_read(imu, buf, sizeof(buf));
     if (len == 0) return -1;
-    //if (buf[3] == last_seq) return -1;
-    last_seq = buf[3];
 
-    if      (parse_accelerometer(buf, len, &g_imu_accel))  {}
-    else if (parse_gyroscope(buf, len, &g_imu_gyro))       {}
-    else if (parse_rotation_vector(buf, len, &g_imu_quat)) {
-        g_imu_euler = quaternion_to_euler(&g_imu_quat);
+    if (buf[2] == SHTP_CHAN_REPORTS &&
+        parse_reports(buf + SHTP_HDR_LEN, len - SHTP_HDR_LEN, &imu_work)) {
+        imu_work.t_us = esp_timer_get_time();
+        imu_work.packets++;
+        imu_publish(&imu_work);
+        if (imu_listener) xTaskNotifyGive(imu_listener);
     }
     return 0;
 }
@@ -302,4 +392,41 @@ void imu_tare_process(i2c_master_dev_handle_t imu){
     drain_packets(imu);
     bno085_save_settings_cmd(imu);
     ESP_LOGI(IMU_TAG, "IMU Tared");
+}
+
+// INT is active low and stays low while the BNO08x has data; the edge
+// wakes the task, which then reads until the pin goes high
+static void IRAM_ATTR imu_int_isr(void *arg) {
+    BaseType_t woken = pdFALSE;
+    if (imu_task_handle) vTaskNotifyGiveFromISR(imu_task_handle, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void imu_task(void *pvParameters) {
+    i2c_master_dev_handle_t imu = (i2c_master_dev_handle_t)pvParameters;
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IMU_STALL_MS));   // Timeout covers a missed edge
+        for (int i = 0; i < 16 && gpio_get_level(IMU_INT_PIN) == 0; i++) {
+            imu_check_safe(imu);
+        }
+    }
+}
+
+void imu_notify_task(TaskHandle_t task) {
+    imu_listener = task;
+}
+
+bool imu_start(i2c_master_dev_handle_t dev, BaseType_t core, UBaseType_t prio) {
+    if (imu_task_handle) return true;
+
+    if (TASK_CREATE_PINNED(imu_task, "imu", STACK_IMU, dev, prio, &imu_task_handle, core) != pdPASS) {
+        ESP_LOGE(IMU_TAG, "Failed to start IMU task");
+        imu_task_handle = NULL;
+        return false;
+    }
+
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) return false;   // Already installed is fine
+    gpio_set_intr_type(IMU_INT_PIN, GPIO_INTR_NEGEDGE);
+    return gpio_isr_handler_add(IMU_INT_PIN, imu_int_isr, NULL) == ESP_OK;
 }
\ No newline at end of file
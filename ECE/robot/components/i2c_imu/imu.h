@@ -9,23 +9,49 @@
 #include "pinout.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
 
 
 #define IMU_ADDR        0x4A
 #define SHTP_BUF_SIZE   512
-#define R2D             (180.0f / (float)M_PI)
 #define REPORT_ACCELEROMETER    0x01
 #define REPORT_GYROSCOPE        0x02
 #define REPORT_ROTATION_VECTOR  0x05
 #define REPORT_SET_FEATURE      0xFD
-#define REPORT_ID_OFFSET  13
-#define DATA_OFFSET       17
+#define REPORT_TIMESTAMP_REBASE 0xFA
+#define REPORT_BASE_TIMESTAMP   0xFB
+#define SHTP_HDR_LEN      4
+#define SHTP_CHAN_REPORTS 3             // Input sensor reports
+#define REPORT_HDR_LEN    4             // id, seq, status, delay; data follows
 #define IMU_MAX_ERROR  1
 
-extern quaternion_t g_imu_quat;
-extern vec3_t       g_imu_accel;
-extern gyro_t       g_imu_gyro;
-extern euler_t      g_imu_euler;
+#define IMU_READ_MIN      24            // Floor for the first read: timebase + rotation vector
+#define IMU_STALL_MS      100           // INT silent this long: poll the pin anyway
+
+// Quaternion -> Euler in integers: CORDIC atan2 on Q27 terms, angles in
+// 1/2^IMU_ANG_FRAC milli-degrees while iterating. 16 steps leave < 2 mdeg,
+// below what a Q14 quaternion resolves.
+#define IMU_CORDIC_ITERS  16
+#define IMU_ANG_FRAC      8
+
+// Report units from the raw fixed point (build_imu)
+#define IMU_ACCEL_D10(q8) ((int16_t)((q8) * 10 / 256))          // 0.1 m/s^2
+#define IMU_GYRO_D10(q9)  ((int16_t)((q9) * 18335 / 16384))     // 0.1 deg/s: 1800 / pi / 512 in Q14
+
+// Latest sensor state. One SHTP packet can carry several reports; the
+// sample is published once per packet with everything it updated.
+typedef struct {
+    quaternion_t quat;
+    vec3_t       accel;
+    gyro_t       gyro;
+    euler_t      euler;
+    int64_t      t_us;                  // esp_timer time the packet was read
+    uint32_t     packets;               // Packets published so far
+} imu_sample_t;
+
+bool imu_get(imu_sample_t *out);        // Newest sample, lock-free; false before the first
+bool imu_start(i2c_master_dev_handle_t dev, BaseType_t core, UBaseType_t prio);  // INT-driven reader task
+void imu_notify_task(TaskHandle_t task);   // Task notified (xTaskNotifyGive) after each new sample
 
 size_t shtp_read(i2c_master_dev_handle_t dev, uint8_t *buf, size_t buf_len);
 esp_err_t shtp_write(i2c_master_dev_handle_t dev, uint8_t channel,uint8_t *payload, size_t payload_len);
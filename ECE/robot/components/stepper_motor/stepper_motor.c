@@ -1,12 +1,203 @@
 #include "stepper_motor.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "robot_pm.h"
+#include "trace.h"
+#include "hot_path.h"
+#include "esp_rom_sys.h"
+#include "hal/gpio_ll.h"
+#include "soc/gpio_struct.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
-// Stops the motor after 60 ms countdown is complete
+#define STEP_TAG "STEPPER"
+
+// Step counter wraps at +-PCNT_LIMIT in hardware; accum_count extends it
+#define PCNT_LIMIT 30000
+
+// Speed (0-127, the 7-bit command field) to step rate, built at compile
+// time: 1 -> MIN, 100+ -> MAX, linear between
+#define HZ_OF(s)  ((s) <= 0 ? 0 : (s) == 1 ? STEPPER_MIN_HZ : (s) >= 100 ? STEPPER_MAX_HZ : \
+                   STEPPER_MIN_HZ + ((s) - 1) * (STEPPER_MAX_HZ - STEPPER_MIN_HZ) / (100 - 1))
+#define HZ4(s)    HZ_OF(s), HZ_OF((s) + 1), HZ_OF((s) + 2), HZ_OF((s) + 3)
+#define HZ16(s)   HZ4(s), HZ4((s) + 4), HZ4((s) + 8), HZ4((s) + 12)
+
+static const HOT_DATA uint16_t speed_hz[STEPPER_SPEED_STEPS] = {
+    HZ16(0), HZ16(16), HZ16(32), HZ16(48), HZ16(64), HZ16(80), HZ16(96), HZ16(112)
+};
+_Static_assert(STEPPER_MAX_HZ <= UINT16_MAX, "speed_hz holds uint16_t");
+
+static inline int speed_clamp(int speed) {
+    return speed < 0 ? 0 : speed >= STEPPER_SPEED_STEPS ? STEPPER_SPEED_STEPS - 1 : speed;
+}
+
+#if STEPPER_USE_MCPWM
+
+static portMUX_TYPE step_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// step_ramp[i] = ticks between steps at sqrt(MIN^2 + 2*ACCEL*i) Hz, so one
+// entry per step is a constant acceleration. Shared by every motor.
+static uint16_t step_ramp[STEPPER_RAMP_MAX];
+static uint16_t speed_ramp[STEPPER_SPEED_STEPS];    // Speed -> step_ramp entry to run at
+static int      ramp_len;
+static int      mc_slots;               // MCPWM timers handed out so far
+
+static void ramp_table_init(void) {
+    if (ramp_len) return;
+    const float vmin2 = (float)STEPPER_MIN_HZ * STEPPER_MIN_HZ;
+    while (ramp_len < STEPPER_RAMP_MAX) {
+        float hz = sqrtf(vmin2 + 2.0f * STEPPER_ACCEL * ramp_len);
+        step_ramp[ramp_len++] = (uint16_t)(STEPPER_TICK_HZ / hz);
+        if (hz >= STEPPER_MAX_HZ) break;
+    }
+    // Inverse of the ramp for every command speed, so setting a target
+    // is a lookup rather than float math inside the critical section
+    for (int s = 0; s < STEPPER_SPEED_STEPS; s++) {
+        float hz = speed_hz[s];
+        int i = hz <= STEPPER_MIN_HZ ? 0 : (int)((hz * hz - vmin2) / (2.0f * STEPPER_ACCEL));
+        speed_ramp[s] = (uint16_t)(i < ramp_len ? i : ramp_len - 1);
+    }
+}
+
+// Runs as each STEP pulse starts: walk one entry toward the target,
+// reversing only at the bottom of the ramp, and stop from there
+static bool IRAM_ATTR step_on_empty(mcpwm_timer_handle_t timer, const mcpwm_timer_event_data_t *edata, void *ctx) {
+    step_mot_t *m = (step_mot_t *)ctx;
+    portENTER_CRITICAL_ISR(&step_mux);
+    int idx  = m->ramp_idx;
+    int goal = (m->want_dir != m->dir) ? -1 : m->target_idx;
+
+    if (idx == 0 && goal < 0) {
+        if (m->want_dir != m->dir && m->target_idx >= 0) {
+            m->dir = m->want_dir;                   // Pulse in flight keeps the old level
+            gpio_ll_set_level(&GPIO, m->dir_gpio, m->dir);
+        } else {
+            // STOP_FULL lets the pulse in flight finish low before the timer halts
+            mcpwm_timer_start_stop(timer, MCPWM_TIMER_STOP_FULL);
+            m->running = false;
+        }
+    } else if (idx < goal) {
+        idx++;
+    } else if (idx > goal && idx > 0) {
+        idx--;
+    }
+    m->ramp_idx = idx;
+    mcpwm_timer_set_period(timer, step_ramp[idx]);
+    portEXIT_CRITICAL_ISR(&step_mux);
+    return false;
+}
+
+// Caller holds step_mux; speed is clamped. Sets the new target; true when
+// the timer is stopped and has to be started (DIR is then the caller's).
+static bool step_target_locked(step_mot_t *m, int speed, int dir) {
+    m->want_dir = dir;
+    m->target_idx = speed ? speed_ramp[speed] : -1;
+    if (!speed || m->running) return false;
+
+    // Standing still: the direction can change before the first step
+    m->dir = dir;
+    m->ramp_idx = 0;
+    m->running = true;
+    return true;
+}
+
+static void step_engine_init(step_mot_t* m) {
+    int group = mc_slots / SOC_MCPWM_TIMERS_PER_GROUP;
+    if (group >= SOC_MCPWM_GROUPS) {
+        ESP_LOGE(STEP_TAG, "No MCPWM timer left for GPIO %d", m->step_gpio);
+        return;
+    }
+    mc_slots++;
+    ramp_table_init();
+
+    mcpwm_timer_config_t tcfg = {
+        .group_id      = group,
+        .clk_src       = MCPWM_TIMER_CLK_SRC_DEFAULT,
+        .resolution_hz = STEPPER_TICK_HZ,
+        .count_mode    = MCPWM_TIMER_COUNT_MODE_UP,
+        .period_ticks  = step_ramp[0],
+        .flags.update_period_on_empty = true,
+    };
+    ESP_ERROR_CHECK(mcpwm_new_timer(&tcfg, &m->mc_timer));
+
+    mcpwm_operator_config_t ocfg = { .group_id = group };
+    ESP_ERROR_CHECK(mcpwm_new_operator(&ocfg, &m->mc_oper));
+    ESP_ERROR_CHECK(mcpwm_operator_connect_timer(m->mc_oper, m->mc_timer));
+
+    mcpwm_comparator_config_t ccfg = { .flags.update_cmp_on_tez = true };
+    ESP_ERROR_CHECK(mcpwm_new_comparator(m->mc_oper, &ccfg, &m->mc_cmp));
+    ESP_ERROR_CHECK(mcpwm_comparator_set_compare_value(m->mc_cmp, STEPPER_PULSE_US * (STEPPER_TICK_HZ / 1000000)));
+
+    // io_loop_back keeps the pin readable by the PCNT unit set up on it
+    mcpwm_generator_config_t gcfg = { .gen_gpio_num = m->step_gpio, .flags.io_loop_back = true };
+    ESP_ERROR_CHECK(mcpwm_new_generator(m->mc_oper, &gcfg, &m->mc_gen));
+    ESP_ERROR_CHECK(mcpwm_generator_set_action_on_timer_event(m->mc_gen,
+        MCPWM_GEN_TIMER_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP, MCPWM_TIMER_EVENT_EMPTY, MCPWM_GEN_ACTION_HIGH)));
+    ESP_ERROR_CHECK(mcpwm_generator_set_action_on_compare_event(m->mc_gen,
+        MCPWM_GEN_COMPARE_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP, m->mc_cmp, MCPWM_GEN_ACTION_LOW)));
+
+    mcpwm_timer_event_callbacks_t cbs = { .on_empty = step_on_empty };
+    ESP_ERROR_CHECK(mcpwm_timer_register_event_callbacks(m->mc_timer, &cbs, m));
+    ESP_ERROR_CHECK(mcpwm_timer_enable(m->mc_timer));
+
+    m->ramp_idx   = 0;
+    m->target_idx = -1;
+    m->dir        = 0;
+    m->want_dir   = 0;
+    m->running    = false;
+}
+
+#endif
+
+// Counts STEP rising edges, up while DIR is high and down while it is low,
+// so the total is signed wheel travel. Set up before the step output so
+// gpio_set_direction() here cannot undo the output routing.
+static void step_counter_init(step_mot_t* m) {
+    pcnt_unit_config_t ucfg = {
+        .high_limit = PCNT_LIMIT,
+        .low_limit  = -PCNT_LIMIT,
+        .flags.accum_count = true,
+    };
+    if (pcnt_new_unit(&ucfg, &m->step_count) != ESP_OK) {
+        ESP_LOGE(STEP_TAG, "No PCNT unit for GPIO %d", m->step_gpio);
+        m->step_count = NULL;
+        return;
+    }
+
+    pcnt_chan_config_t ccfg = {
+        .edge_gpio_num  = m->step_gpio,
+        .level_gpio_num = m->dir_gpio,
+        .flags.io_loop_back = true,
+    };
+    pcnt_channel_handle_t ch;
+    ESP_ERROR_CHECK(pcnt_new_channel(m->step_count, &ccfg, &ch));
+    ESP_ERROR_CHECK(pcnt_channel_set_edge_action(ch, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_HOLD));
+    ESP_ERROR_CHECK(pcnt_channel_set_level_action(ch, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
+    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(m->step_count, PCNT_LIMIT));
+    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(m->step_count, -PCNT_LIMIT));
+    ESP_ERROR_CHECK(pcnt_unit_enable(m->step_count));
+    ESP_ERROR_CHECK(pcnt_unit_clear_count(m->step_count));
+    ESP_ERROR_CHECK(pcnt_unit_start(m->step_count));
+}
+
+// Stops the motor once PULSE_DURATION_US passes without a new pulse; with
+// the ramp engine it first ramps down, re-checking until the motor is still
 static void motor_stop_callback(void* arg) {
     step_mot_t* motor = (step_mot_t*)arg;
+#if STEPPER_USE_MCPWM
+    motor->target_idx = -1;
+    if (motor->running) {
+        esp_timer_start_once(motor->stop_timer, STEPPER_STOP_POLL_US);
+        return;
+    }
+    stepper_disable(motor);
+#else
     stepper_disable(motor);
     ledc_set_duty(LEDC_LOW_SPEED_MODE, motor->channel, 0);
     ledc_update_duty(LEDC_LOW_SPEED_MODE, motor->channel);
+    motor->hz = 0;
+#endif
 }
 
 //Initialize a instance of the stepper motor
@@ -21,8 +212,13 @@ void motor_init(step_mot_t* m, const int step_pin, const int dir_pin, const int
     gpio_set_direction(m->dir_gpio, GPIO_MODE_OUTPUT);
     gpio_set_direction(m->en_gpio, GPIO_MODE_OUTPUT);
     gpio_set_level(m->en_gpio, 1);
+    gpio_set_level(m->dir_gpio, 0);
 
+    step_counter_init(m);
 
+#if STEPPER_USE_MCPWM
+    step_engine_init(m);
+#else
     // 1. Configure LEDC Timer
     ledc_timer_config_t ledc_timer = {
         .speed_mode       = LEDC_LOW_SPEED_MODE,
@@ -44,6 +240,10 @@ void motor_init(step_mot_t* m, const int step_pin, const int dir_pin, const int
         .hpoint         = 0
     };
     ledc_channel_config(&ledc_channel);
+    gpio_input_enable(m->step_gpio);        // Keep the PCNT edge input alive
+    m->hz  = 0;
+    m->dir = 0;
+#endif
 
     // 3. Create high-precision ESP Timer
     esp_timer_create_args_t timer_args = {
@@ -57,6 +257,7 @@ void motor_init(step_mot_t* m, const int step_pin, const int dir_pin, const int
 }
 
 void stepper_enable(step_mot_t* m){
+    robot_pm_drivers(1ULL << m->en_gpio, true);
     gpio_set_level(m->en_gpio, 0); 
     m->status = MOTOR_IDLE;
 }
@@ -64,38 +265,316 @@ void stepper_enable(step_mot_t* m){
 void stepper_disable(step_mot_t* m){
     gpio_set_level(m->en_gpio, 1); 
     m->status = MOTOR_DISABLE;
+    robot_pm_drivers(1ULL << m->en_gpio, false);
+#if STEPPER_USE_MCPWM
+    // Driver is off: drop straight to the bottom of the ramp so no steps
+    // are counted that the wheel never made
+    portENTER_CRITICAL(&step_mux);
+    m->target_idx = -1;
+    m->ramp_idx = 0;
+    portEXIT_CRITICAL(&step_mux);
+#endif
 }
 
 uint32_t map_speed_to_hz(int speed) {
-    if (speed <= 0) return 0;
-    if (speed == 1) return 200;
-    if (speed >= 100) return 3000;
+    return speed_hz[speed_clamp(speed)];
+}
+
+#if STEPPER_USE_MCPWM
 
-    return 200 + (speed - 1) * (3000 - 200) / (100 - 1);
+HOT_PATH void motor_pulse(step_mot_t *motor, uint32_t speed, int dir){
+    int spd = speed_clamp((int)speed);
+    uint32_t freq_hz = speed_hz[spd];
+    esp_timer_stop(motor->stop_timer);
+    if (!motor->mc_timer) return;
+
+    portENTER_CRITICAL(&step_mux);
+    bool start = step_target_locked(motor, spd, dir);
+    bool moving = motor->running;
+    portEXIT_CRITICAL(&step_mux);
+
+    if (start) {
+        gpio_set_level(motor->dir_gpio, dir);
+        mcpwm_timer_set_period(motor->mc_timer, step_ramp[0]);
+        mcpwm_timer_start_stop(motor->mc_timer, MCPWM_TIMER_START_NO_STOP);
+    }
+
+    // Speed 0 ramps down; the motor counts as running until it is still
+    motor->status = moving ? MOTOR_RUNNING : MOTOR_IDLE;
+    if (moving) robot_pm_drivers(1ULL << motor->en_gpio, true);
+    if (moving) esp_timer_start_once(motor->stop_timer, freq_hz ? PULSE_DURATION_US : STEPPER_STOP_POLL_US);
 }
 
-void motor_pulse(step_mot_t *motor, uint32_t speed, int dir){
+#else
+
+// Only what differs from the setpoint applied is reprogrammed: retuning a
+// running LEDC timer can cut a step short, and the same pulse repeated
+// should cost no more than the timer restart
+HOT_PATH void motor_pulse(step_mot_t *motor, uint32_t speed, int dir){
     // Get speed in hz and set motor direction
     uint32_t freq_hz = map_speed_to_hz(speed);
-    gpio_set_level(motor->dir_gpio, dir);
+    if (dir != motor->dir) {
+        gpio_set_level(motor->dir_gpio, dir);
+        motor->dir = dir;
+    }
 
     // if speed is set to 0 return with nothing
     if (freq_hz == 0) {
         esp_timer_stop(motor->stop_timer);
         motor->status = MOTOR_IDLE;
-        ledc_set_duty(LEDC_LOW_SPEED_MODE, motor->channel, 0);
-        ledc_update_duty(LEDC_LOW_SPEED_MODE, motor->channel);
+        if (motor->hz) {
+            ledc_set_duty(LEDC_LOW_SPEED_MODE, motor->channel, 0);
+            ledc_update_duty(LEDC_LOW_SPEED_MODE, motor->channel);
+            motor->hz = 0;
+        }
         return;
     }
 
+    if (freq_hz == motor->hz && esp_timer_restart(motor->stop_timer, PULSE_DURATION_US) == ESP_OK) return;
     esp_timer_stop(motor->stop_timer);
-    
 
-    ledc_set_freq(LEDC_LOW_SPEED_MODE, motor->timer_sel, freq_hz);
-    ledc_set_duty(LEDC_LOW_SPEED_MODE, motor->channel, STEPPER_LEDC_DUTY);
-    ledc_update_duty(LEDC_LOW_SPEED_MODE, motor->channel);
-    
+    if (freq_hz != motor->hz) ledc_set_freq(LEDC_LOW_SPEED_MODE, motor->timer_sel, freq_hz);
+    if (!motor->hz) {
+        ledc_set_duty(LEDC_LOW_SPEED_MODE, motor->channel, STEPPER_LEDC_DUTY);
+        ledc_update_duty(LEDC_LOW_SPEED_MODE, motor->channel);
+    }
+    motor->hz = freq_hz;
+
     // Start timer that goes for 60 ms
     motor->status = MOTOR_RUNNING;
+    robot_pm_drivers(1ULL << motor->en_gpio, true);
     esp_timer_start_once(motor->stop_timer, PULSE_DURATION_US);
 }
+
+#endif
+
+int32_t stepper_steps(const step_mot_t *m) {
+    int count = 0;
+    if (m->step_count) pcnt_unit_get_count(m->step_count, &count);
+    return count;
+}
+
+// ---------------------------------------------------------------------------
+// Drivetrain
+// ---------------------------------------------------------------------------
+
+static inline void mask_add(uint32_t mask[2], int gpio) {
+    mask[gpio >> 5] |= 1u << (gpio & 31);
+}
+
+// One write per bank and per polarity; the pins of a bank change together
+static inline uint64_t mask64(const uint32_t mask[2]) {
+    return mask[0] | (uint64_t)mask[1] << 32;
+}
+
+static inline void gpio_write_masks(const uint32_t set[2], const uint32_t clr[2]) {
+    GPIO.out_w1ts = set[0];
+    GPIO.out_w1tc = clr[0];
+    GPIO.out1_w1ts.val = set[1];
+    GPIO.out1_w1tc.val = clr[1];
+}
+
+// EN high once the hold is over. A vector that came in since the timer was
+// armed wins: under MCPWM the wheels are checked under step_mux, which
+// drivetrain_set() holds while it starts them
+static void drivetrain_idle_callback(void *arg) {
+    drivetrain_t *dt = (drivetrain_t *)arg;
+    const uint32_t none[2] = {0};
+    bool busy = dt->holding;
+#if STEPPER_USE_MCPWM
+    portENTER_CRITICAL(&step_mux);
+    for (int i = 0; i < WHEEL_COUNT; i++) busy |= dt->m[i]->running;
+#endif
+    if (!busy) {
+        gpio_write_masks(dt->en_mask, none);
+        dt->energized = false;
+    }
+#if STEPPER_USE_MCPWM
+    portEXIT_CRITICAL(&step_mux);
+#endif
+    if (busy) return;
+    for (int i = 0; i < WHEEL_COUNT; i++) dt->m[i]->status = MOTOR_DISABLE;
+    robot_pm_drivers(mask64(dt->en_mask), false);
+    TRACE(EXEC, IDLE_OFF, 0, 0, 0);
+}
+
+static void drive_idle_arm(drivetrain_t *dt) {
+    if (STEPPER_EN_HOLD_MS == 0) {
+        drivetrain_idle_callback(dt);
+        return;
+    }
+    esp_timer_stop(dt->idle_timer);
+    esp_timer_start_once(dt->idle_timer, (uint64_t)STEPPER_EN_HOLD_MS * 1000);
+}
+
+static void drivetrain_stop_callback(void *arg) {
+    drivetrain_t *dt = (drivetrain_t *)arg;
+    bool moving = false;
+    dt->holding = false;
+
+#if STEPPER_USE_MCPWM
+    portENTER_CRITICAL(&step_mux);
+    for (int i = 0; i < WHEEL_COUNT; i++) {
+        dt->m[i]->target_idx = -1;
+        moving |= dt->m[i]->running;
+    }
+    portEXIT_CRITICAL(&step_mux);
+#else
+    for (int i = 0; i < WHEEL_COUNT; i++) {
+        ledc_set_duty(LEDC_LOW_SPEED_MODE, dt->m[i]->channel, 0);
+        ledc_update_duty(LEDC_LOW_SPEED_MODE, dt->m[i]->channel);
+        dt->m[i]->hz = 0;
+    }
+#endif
+    if (moving) {
+        esp_timer_start_once(dt->stop_timer, STEPPER_STOP_POLL_US);
+        return;
+    }
+
+    // All four still: EN is active low and shared between wheels, so it
+    // only goes high once none of them is stepping, and not before the hold
+    for (int i = 0; i < WHEEL_COUNT; i++) dt->m[i]->status = MOTOR_IDLE;
+    drive_idle_arm(dt);
+}
+
+void drivetrain_init(drivetrain_t *dt, step_mot_t *fl, step_mot_t *fr, step_mot_t *bl, step_mot_t *br) {
+    memset(dt, 0, sizeof(*dt));
+    step_mot_t *w[WHEEL_COUNT] = { fl, fr, bl, br };
+    for (int i = 0; i < WHEEL_COUNT; i++) {
+        dt->m[i] = w[i];
+        dt->fwd_level[i] = (i == WHEEL_FL || i == WHEEL_BL) ? DRIVE_FWD_LEFT : DRIVE_FWD_RIGHT;
+        mask_add(dt->en_mask, w[i]->en_gpio);
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = drivetrain_stop_callback,
+        .arg = dt,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "drive_stop_timer"
+    };
+    esp_timer_create(&timer_args, &dt->stop_timer);
+
+    esp_timer_create_args_t idle_args = {
+        .callback = drivetrain_idle_callback,
+        .arg = dt,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "drive_idle_timer"
+    };
+    esp_timer_create(&idle_args, &dt->idle_timer);
+}
+
+void drivetrain_set(drivetrain_t *dt, const int8_t vel[WHEEL_COUNT], uint32_t hold_ms) {
+    uint64_t hold_us = hold_ms ? (uint64_t)hold_ms * 1000 : PULSE_DURATION_US;
+
+    // The vector already being held: move its deadline and nothing else. The
+    // restart fails once the stop timer has fired, and the vector then goes
+    // out in full.
+    if (dt->holding && memcmp(vel, dt->vel, sizeof(dt->vel)) == 0 &&
+        esp_timer_restart(dt->stop_timer, hold_us) == ESP_OK) {
+        dt->hold_us = hold_us;
+        return;
+    }
+
+    int spd[WHEEL_COUNT];
+    uint32_t hz[WHEEL_COUNT];
+    int level[WHEEL_COUNT];
+    bool any = false;
+    for (int i = 0; i < WHEEL_COUNT; i++) {
+        spd[i] = speed_clamp(abs(vel[i]));
+        hz[i] = speed_hz[spd[i]];
+        level[i] = vel[i] >= 0 ? dt->fwd_level[i] : !dt->fwd_level[i];
+        any |= hz[i] != 0;
+    }
+
+    esp_timer_stop(dt->stop_timer);
+    esp_timer_stop(dt->idle_timer);
+    dt->hold_us = hold_us;
+    memcpy(dt->vel, vel, sizeof(dt->vel));
+    dt->holding = any;
+    uint32_t set[2] = {0}, clr[2] = {0};
+    if (any) {
+        clr[0] = dt->en_mask[0];            // Enable every driver in the same write
+        clr[1] = dt->en_mask[1];
+        robot_pm_drivers(mask64(dt->en_mask), true);    // Full speed before the first step
+        if (STEPPER_EN_WAKE_US && !dt->energized) {
+            const uint32_t none[2] = {0};
+            gpio_write_masks(none, dt->en_mask);
+            esp_rom_delay_us(STEPPER_EN_WAKE_US);
+        }
+        dt->energized = true;
+    }
+    bool moving = false;
+
+#if STEPPER_USE_MCPWM
+    bool start[WHEEL_COUNT];
+    portENTER_CRITICAL(&step_mux);
+    for (int i = 0; i < WHEEL_COUNT; i++) {
+        step_mot_t *m = dt->m[i];
+        // A running wheel keeps its DIR until the ISR reverses it at standstill
+        start[i] = m->mc_timer && step_target_locked(m, spd[i], level[i]);
+        if (start[i]) mask_add(level[i] ? set : clr, m->dir_gpio);
+    }
+    gpio_write_masks(set, clr);
+    for (int i = 0; i < WHEEL_COUNT; i++) {
+        if (start[i]) mcpwm_timer_start_stop(dt->m[i]->mc_timer, MCPWM_TIMER_START_NO_STOP);
+    }
+    for (int i = 0; i < WHEEL_COUNT; i++) {
+        step_mot_t *m = dt->m[i];
+        m->status = m->running ? MOTOR_RUNNING : (any ? MOTOR_IDLE : m->status);
+        moving |= m->running;
+    }
+    portEXIT_CRITICAL(&step_mux);
+#else
+    for (int i = 0; i < WHEEL_COUNT; i++) {
+        mask_add(level[i] ? set : clr, dt->m[i]->dir_gpio);
+        dt->m[i]->dir = level[i];
+    }
+    gpio_write_masks(set, clr);
+    // A wheel keeping its rate keeps its LEDC timer and duty untouched
+    for (int i = 0; i < WHEEL_COUNT; i++) {
+        step_mot_t *m = dt->m[i];
+        if (hz[i] && hz[i] != m->hz) ledc_set_freq(LEDC_LOW_SPEED_MODE, m->timer_sel, hz[i]);
+    }
+    for (int i = 0; i < WHEEL_COUNT; i++) {
+        step_mot_t *m = dt->m[i];
+        if (!hz[i] != !m->hz) {
+            ledc_set_duty(LEDC_LOW_SPEED_MODE, m->channel, hz[i] ? STEPPER_LEDC_DUTY : 0);
+            ledc_update_duty(LEDC_LOW_SPEED_MODE, m->channel);
+        }
+        m->hz = hz[i];
+        m->status = hz[i] ? MOTOR_RUNNING : (any ? MOTOR_IDLE : m->status);
+        moving |= hz[i] != 0;
+    }
+#endif
+
+    if (moving) esp_timer_start_once(dt->stop_timer, any ? dt->hold_us : STEPPER_STOP_POLL_US);
+    else if (dt->energized) drive_idle_arm(dt);         // Still, but powered: the hold starts over
+}
+
+void drivetrain_keepalive(drivetrain_t *dt) {
+    // Only a live vector is extended; a ramp-down keeps its poll period
+    if (dt->holding) esp_timer_restart(dt->stop_timer, dt->hold_us);
+}
+
+// Emergency stop. The shared EN pins go high in one write first, so the
+// wheels are unpowered whatever the step engines do next; then every engine
+// drops to standstill without a ramp and no stop timer is left to re-enable
+// anything.
+void drivetrain_estop(drivetrain_t *dt) {
+    const uint32_t none[2] = {0};
+    gpio_write_masks(dt->en_mask, none);
+    dt->holding = false;
+    dt->energized = false;
+    esp_timer_stop(dt->stop_timer);
+    esp_timer_stop(dt->idle_timer);
+    for (int i = 0; i < WHEEL_COUNT; i++) {
+        step_mot_t *m = dt->m[i];
+        esp_timer_stop(m->stop_timer);
+        stepper_disable(m);
+#if !STEPPER_USE_MCPWM
+        ledc_set_duty(LEDC_LOW_SPEED_MODE, m->channel, 0);
+        ledc_update_duty(LEDC_LOW_SPEED_MODE, m->channel);
+        m->hz = 0;
+#endif
+    }
+}
@@ -3,13 +3,43 @@
 
 #include "driver/ledc.h"
 #include "driver/gpio.h"
+#include "driver/pulse_cnt.h"
 #include "esp_timer.h"
 
+// Step engine. 1 (default): each motor gets its own MCPWM timer; the step
+// ISR walks a precomputed constant-acceleration step-interval table, so
+// speed ramps up and down (and reverses through standstill) instead of
+// jumping to the target frequency. 0: legacy LEDC frequency jump.
+#ifndef STEPPER_USE_MCPWM
+#define STEPPER_USE_MCPWM        1
+#endif
+
+#if STEPPER_USE_MCPWM
+#include "driver/mcpwm_prelude.h"
+#endif
+
 // Configuration constants
 #define STEPPER_LEDC_RESOLUTION  LEDC_TIMER_8_BIT
 #define STEPPER_LEDC_DUTY        128   // 50% of 255
 #define PULSE_DURATION_US        200000 // 200 ms
 
+#define STEPPER_MIN_HZ           200    // map_speed_to_hz() range; ramp starts/ends here
+#define STEPPER_MAX_HZ           3000
+#define STEPPER_SPEED_STEPS      128    // Command speed field is 7 bits
+#ifndef STEPPER_ACCEL
+#define STEPPER_ACCEL            20000  // steps/s^2 (0 -> 3000 Hz in ~150 ms)
+#endif
+#define STEPPER_TICK_HZ          1000000 // MCPWM resolution: 1 us ticks
+#define STEPPER_PULSE_US         10     // STEP high time, above every driver's minimum
+#define STEPPER_RAMP_MAX         512    // Table entries; (MAX^2 - MIN^2) / (2 * ACCEL) must fit
+#define STEPPER_STOP_POLL_US     20000  // Stop timer re-check while ramping down
+#ifndef STEPPER_EN_HOLD_MS
+#define STEPPER_EN_HOLD_MS       500    // Drivers stay enabled this long after the wheels stop; 0 = off at once
+#endif
+#ifndef STEPPER_EN_WAKE_US
+#define STEPPER_EN_WAKE_US       0      // Enable to first step, for drivers that need it; paid only from off
+#endif
+
 typedef enum {
     MOTOR_DISABLE = 0,
     MOTOR_IDLE    = 1,
@@ -25,12 +55,62 @@ typedef struct step_mot {
     ledc_channel_t channel;
     ledc_timer_t timer_sel;
     motor_state_t status; 
+    pcnt_unit_handle_t step_count;   // Hardware step counter (+ with dir high, - with dir low)
+#if STEPPER_USE_MCPWM
+    mcpwm_timer_handle_t mc_timer;
+    mcpwm_oper_handle_t  mc_oper;
+    mcpwm_cmpr_handle_t  mc_cmp;
+    mcpwm_gen_handle_t   mc_gen;
+    volatile int  ramp_idx;          // Step-interval table entry in use
+    volatile int  target_idx;        // Entry to ramp to; -1 = ramp down and stop
+    volatile int  dir;               // Level on dir_gpio
+    volatile int  want_dir;          // Requested; applied at standstill
+    volatile bool running;           // MCPWM timer generating steps
+#else
+    uint32_t hz;                     // LEDC frequency applied; 0 = duty off
+    int      dir;                    // Level on dir_gpio
+#endif
 } step_mot_t;
 
+// Four wheels driven as one. drivetrain_set() applies a whole velocity
+// vector in one pass: DIR and EN pins go out as one register write per
+// GPIO bank, every wheel that has to start is started back to back, and a
+// single stop timer ramps all four down when no new vector arrives within
+// the hold time: PULSE_DURATION_US for a pulse (hold_ms 0), or hold_ms for
+// a setpoint, which drivetrain_keepalive() extends without resending it.
+// Resending the vector being held only moves that deadline: no pin, timer
+// or LEDC register is touched, so a held key keeps the step trains intact.
+// Once all four are still, the idle timer disables the shared EN pins
+// STEPPER_EN_HOLD_MS later, unless a new vector came first: a drive that
+// resumes within that time finds the drivers powered and holding, with no
+// wake-up (STEPPER_EN_WAKE_US) before its first step.
+typedef enum { WHEEL_FL = 0, WHEEL_FR, WHEEL_BL, WHEEL_BR, WHEEL_COUNT } wheel_t;
+
+#define DRIVE_FWD_LEFT   1              // DIR level that drives a left wheel forward
+#define DRIVE_FWD_RIGHT  0              // Right motors are mounted mirrored
+
+typedef struct {
+    step_mot_t *m[WHEEL_COUNT];
+    int fwd_level[WHEEL_COUNT];
+    uint32_t en_mask[2];                // EN pins: GPIO 0-31, GPIO 32-39
+    esp_timer_handle_t stop_timer;
+    esp_timer_handle_t idle_timer;      // EN off, STEPPER_EN_HOLD_MS after the wheels stopped
+    uint64_t hold_us;                   // Current vector's deadline
+    int8_t vel[WHEEL_COUNT];            // Current vector, while holding
+    volatile bool holding;              // Vector live (not ramping down)
+    volatile bool energized;            // EN pins low
+} drivetrain_t;
+
 void motor_init(step_mot_t* m, const int step_pin, const int dir_pin, const int en_pin, ledc_channel_t channel, ledc_timer_t timer);
 void stepper_enable(step_mot_t* m);
 void stepper_disable(step_mot_t* m);
 uint32_t map_speed_to_hz(int speed);
 void motor_pulse(step_mot_t *motor, uint32_t speed, int dir);
+int32_t stepper_steps(const step_mot_t *m);     // Signed steps since motor_init()
+
+void drivetrain_init(drivetrain_t *dt, step_mot_t *fl, step_mot_t *fr, step_mot_t *bl, step_mot_t *br);
+void drivetrain_set(drivetrain_t *dt, const int8_t vel[WHEEL_COUNT], uint32_t hold_ms);  // Per wheel -100..100, + = forward
+void drivetrain_keepalive(drivetrain_t *dt);    // Restart the hold; no-op once it ran out
+void drivetrain_estop(drivetrain_t *dt);        // No ramp: every driver off now (any task, BLE callback too)
 
 #endif
\ No newline at end of file
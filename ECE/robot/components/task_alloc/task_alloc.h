@@ -0,0 +1,72 @@
+#ifndef TASK_ALLOC_H
+#define TASK_ALLOC_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/stream_buffer.h"
+
+// -------------------------------------------------------------------------
+// Task / stream buffer allocation
+//
+// -D ROBOT_STATIC_ALLOC=1 (platformio.ini build_flags) creates every robot
+// task and the RX slot buffer from memory reserved at link time:
+// xTaskCreateStaticPinnedToCore / xStreamBufferCreateStatic, each call site
+// with its own static stack + TCB. The crypto contexts and the packet pool
+// are static in either build, so after app_main nothing on the command
+// path touches the heap and the footprint is fixed at link time (see the
+// .bss size in the map file). esp_timer handles are still created from the
+// heap, once, during start-up.
+//
+// Stack sizes are in bytes (ESP-IDF counts StackType_t as bytes). They come
+// from the high-water marks the health reports carry (stack_task /
+// stack_free, see telemetry.h) plus margin; override with -D after a
+// firmware change moves them.
+// -------------------------------------------------------------------------
+
+#ifndef ROBOT_STATIC_ALLOC
+#define ROBOT_STATIC_ALLOC 0
+#endif
+
+#ifndef STACK_EXECUTOR
+#define STACK_EXECUTOR       4096    // Decrypt (256 B plaintext) + dispatch + motion
+#endif
+#ifndef STACK_TELEMETRY
+#define STACK_TELEMETRY      4096    // One sealed batch on the stack
+#endif
+#ifndef STACK_ARM
+#define STACK_ARM            3072
+#endif
+#ifndef STACK_IMU
+#define STACK_IMU            4096    // SH-2 packet parse
+#endif
+#ifndef STACK_RUNTIME_STATS
+#define STACK_RUNTIME_STATS  3072    // printf
+#endif
+#ifndef STACK_HPR
+#define STACK_HPR            3072    // One sealed HPR word (send_cmd)
+#endif
+
+// BaseType_t TASK_CREATE_PINNED(fn, name, stack, arg, prio, TaskHandle_t *out, core):
+// xTaskCreatePinnedToCore() either way; out may be NULL
+#if ROBOT_STATIC_ALLOC
+#define TASK_CREATE_PINNED(fn, name, stack, arg, prio, out, core) ({                         \
+    static StackType_t  task_stack_[(stack) / sizeof(StackType_t)];                         \
+    static StaticTask_t task_tcb_;                                                           \
+    TaskHandle_t task_h_ = xTaskCreateStaticPinnedToCore((fn), (name), (stack), (arg),       \
+                                                         (prio), task_stack_, &task_tcb_, (core)); \
+    TaskHandle_t *task_out_ = (out);                                                         \
+    if (task_out_) *task_out_ = task_h_;                                                     \
+    task_h_ ? pdPASS : pdFAIL;                                                               \
+})
+#define STREAM_BUFFER_CREATE(size, trigger) ({                                               \
+    static uint8_t             sb_storage_[(size) + 1];  /* One byte FreeRTOS keeps free */  \
+    static StaticStreamBuffer_t sb_buf_;                                                     \
+    xStreamBufferCreateStatic((size), (trigger), sb_storage_, &sb_buf_);                     \
+})
+#else
+#define TASK_CREATE_PINNED(fn, name, stack, arg, prio, out, core) \
+    xTaskCreatePinnedToCore((fn), (name), (stack), (arg), (prio), (out), (core))
+#define STREAM_BUFFER_CREATE(size, trigger) xStreamBufferCreate((size), (trigger))
+#endif
+
+#endif
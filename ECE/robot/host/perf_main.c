@@ -0,0 +1,16 @@
+// perf_main.c
+//
+// main() for the host build of test/test_perf: the suite's app_main on the
+// main thread, exit status 1 when a case failed
+
+#include <stdio.h>
+#include "unity.h"
+
+void app_main(void);
+
+int main(void)
+{
+    setvbuf(stdout, NULL, _IOLBF, 0);       // PERF lines through a pipe to perf_log.sh as they come
+    app_main();
+    return unity_failures() ? 1 : 0;
+}
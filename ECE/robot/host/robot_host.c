@@ -0,0 +1,196 @@
+// robot_host.c
+//
+// main() for the host build of the firmware (Makefile, robot_host): boots
+// app_main as on the robot, then plays the GS as one central through
+// Robot_BLE.c's own entry points (ble_sim.h). Every CONTROL word goes the
+// whole way: GATT write -> RX pool -> (decrypt) -> executor -> drivetrain ->
+// MCPWM / PCNT, and its ACK comes back through the notify hook.
+//
+//   robot_host [-n words] [-s] [-i idle_ms]
+//     -n  CONTROL words to send, one at a time (default 1000)
+//     -s  sealed session: every word in its own AES-GCM frame, ACKs sealed back
+//     -i  idle between an ACK and the next word (default 0)
+//
+// Prints one PERF line (test_perf.c's format) for write-to-ACK in ns, and the
+// steps each wheel made; exit status 1 when an ACK went missing or a wheel
+// never turned. ROBOT_HOST_LOG=W (or E, I, D) sets the firmware's log level.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "host_shim.h"
+#include "ble_sim.h"
+#include "esp_app_desc.h"
+#include "aes_gcm_backend.h"
+#include "aes_gcm_decrypt.h"
+#include "aes_key.h"
+#include "stepper_motor.h"
+
+#define HOST_CONN_ID   1
+#define HOST_MTU       247
+#define ACK_TIMEOUT_NS 1000000000LL
+#define BOOT_SETTLE_MS 200              // Executor and timers up before the first word
+#define RUN_OUT_MS     100              // Last vector left running, so a short burst still steps
+
+extern drivetrain_t drivetrain;         // main.c
+void app_main(void);
+
+static pthread_mutex_t ack_mu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  ack_cv;
+static int             ack_id = -1;     // Last ACK seen, -1 = none
+static int             ack_result;
+
+// An ACK on either characteristic, in whatever encoding the session uses:
+// NOTIFY_TAG_WORD | word, 16 hex chars, or a sealed frame
+static int on_notify(device_conn_t *dev, ble_sim_chr_t chr, const uint8_t *data, size_t len)
+{
+    robot_bt_packet_t w;
+    if (chr == BLE_SIM_CHR_METRICS) return 0;
+    if (len == 9 && data[0] == NOTIFY_TAG_WORD) {
+        memcpy(w.bytes, data + 1, 8);
+    } else if (len == 16) {
+        if (hexc_decode((const char *)data, 16, w.bytes) != 8) return 0;
+    } else if (len == CIPHER_FRAME_SIZE && data[0] == 0x0A && data[1] == CIPHER_MARK_WORD) {
+        char plain[129];
+        size_t plain_len = 0;
+        if (aes_gcm_decrypt_packet(data + 2, plain, &plain_len) != 0) {
+            fprintf(stderr, "robot_host: sealed notify failed to open\n");
+            return 0;
+        }
+        memcpy(w.bytes, plain, 8);
+    } else {
+        return 0;                       // Telemetry batches, text
+    }
+    if (w.ctrl.type != ACK_CMD) return 0;
+
+    pthread_mutex_lock(&ack_mu);
+    ack_id = w.ack.id;
+    ack_result = w.ack.result_code;
+    pthread_cond_signal(&ack_cv);
+    pthread_mutex_unlock(&ack_mu);
+    return 0;
+}
+
+// Waits for the ACK of id; its result code, -1 on timeout
+static int ack_wait_for(int id)
+{
+    struct timespec ts;
+    int rc = 0, result = -1;
+    host_deadline(&ts, ACK_TIMEOUT_NS);
+    pthread_mutex_lock(&ack_mu);
+    while (ack_id != id && rc == 0) rc = pthread_cond_timedwait(&ack_cv, &ack_mu, &ts);
+    if (ack_id == id) result = ack_result;
+    pthread_mutex_unlock(&ack_mu);
+    return result;
+}
+
+// [0x0A][CIPHER_MARK_WORD][nonce | ciphertext | tag][0xDA][0x0D], as the GS seals a word
+static int seal_word(gcm_ctx_t *ctx, const uint8_t salt[4], uint64_t *seq, const uint8_t word[8],
+                     uint8_t frame[CIPHER_FRAME_SIZE])
+{
+    uint8_t plain[128] = {0};
+    uint8_t *nonce = frame + 2, *ct = nonce + GCM_NONCE_LEN, *tag = ct + sizeof(plain);
+    memcpy(plain, word, 8);
+    if (!replay_nonce_next(nonce, salt, REPLAY_DIR_GS, seq)) return -1;
+    if (gcm_suite_backend(GCM_SUITE_AES)->encrypt(ctx, nonce, NULL, 0, plain, sizeof(plain), ct, tag) != 0) return -1;
+    frame[0] = 0x0A;
+    frame[1] = CIPHER_MARK_WORD;
+    frame[PACKET_SIZE + 2] = 0xDA;
+    frame[PACKET_SIZE + 3] = 0x0D;
+    return 0;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv)
+{
+    int words = 1000, sealed = 0, idle_ms = 0, opt;
+    while ((opt = getopt(argc, argv, "n:si:")) != -1) {
+        switch (opt) {
+            case 'n': words = atoi(optarg); break;
+            case 's': sealed = 1; break;
+            case 'i': idle_ms = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-n words] [-s] [-i idle_ms]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (words < 1) words = 1;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    host_cond_init(&ack_cv);
+
+    ble_sim_set_notify(on_notify);
+    app_main();
+    vTaskDelay(pdMS_TO_TICKS(BOOT_SETTLE_MS));
+
+    static const uint8_t bda[BLE_ADDR_LEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    device_conn_t *dev = ble_conn_open(HOST_CONN_ID, bda, BLE_CONN_INT_MIN);
+    if (!dev) return 1;
+    dev->mtu = HOST_MTU;
+    dev->notify_enabled = true;
+    dev->prio_notify = true;
+
+    gcm_ctx_t ctx;
+    uint8_t salt[4] = { 0x11, 0x22, 0x33, 0x44 };
+    uint64_t seq = 1;
+    if (sealed) {
+        ble_session_set_secure((int)(dev - connected_devices), true);
+        if (gcm_suite_backend(GCM_SUITE_AES)->setkey(&ctx, aes_key(), AES_KEY_LEN) != 0) return 1;
+    }
+
+    uint32_t *samples = calloc((size_t)words, sizeof(*samples));
+    if (!samples) return 1;
+    int lost = 0, failed = 0;
+    robot_bt_packet_t w = {0};
+    w.ctrl.type = CONTROL_CMD;
+    w.ctrl.w = 1;
+    w.ctrl.speed = 10;
+
+    for (int i = 0; i < words; i++) {
+        uint8_t frame[CIPHER_FRAME_SIZE];
+        int id = i % ACK_RANGE_ID_MASK + 1;     // 0 is the id of refusals
+        w.ctrl.id = id;
+        w.ctrl.d = i & 1;
+        if (sealed && seal_word(&ctx, salt, &seq, w.bytes, frame) != 0) return 1;
+
+        int64_t t0 = host_now_ns();
+        if (sealed) ble_rx_write(dev, frame, sizeof(frame));
+        else        ble_rx_write(dev, w.bytes, 8);
+        int result = ack_wait_for(id);
+        samples[i] = (uint32_t)(host_now_ns() - t0);
+
+        if (result < 0) lost++;
+        else if (result != RESULT_SUCCESS) failed++;
+        if (idle_ms) vTaskDelay(pdMS_TO_TICKS(idle_ms));
+    }
+
+    qsort(samples, (size_t)words, sizeof(samples[0]), cmp_u32);
+    const esp_app_desc_t *app = esp_app_get_description();
+    printf("PERF {\"test\":\"%s\",\"build\":\"%s\",\"idf\":\"%s\",\"iters\":%d,"
+           "\"min\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu}\n",
+           sealed ? "host_sealed_word_to_ack_ns" : "host_word_to_ack_ns", app->version, app->idf_ver, words,
+           (unsigned long)samples[0], (unsigned long)samples[words / 2],
+           (unsigned long)samples[(words * 99) / 100], (unsigned long)samples[words - 1]);
+
+    vTaskDelay(pdMS_TO_TICKS(RUN_OUT_MS));
+    int32_t steps[WHEEL_COUNT];
+    int still = 0;
+    for (int i = 0; i < WHEEL_COUNT; i++) {
+        steps[i] = stepper_steps(drivetrain.m[i]);
+        still += steps[i] == 0;
+    }
+    drivetrain_estop(&drivetrain);
+    printf("steps FL %ld FR %ld BL %ld BR %ld; ACKs lost %d, refused %d\n", (long)steps[WHEEL_FL],
+           (long)steps[WHEEL_FR], (long)steps[WHEEL_BL], (long)steps[WHEEL_BR], lost, failed);
+
+    if (sealed) gcm_suite_backend(GCM_SUITE_AES)->release(&ctx);
+    free(samples);
+    return lost || failed || still ? 1 : 0;
+}
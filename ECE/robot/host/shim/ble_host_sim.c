@@ -0,0 +1,45 @@
+// ble_host_sim.c
+//
+// ble_host.h glue for the host build; see ble_sim.h
+
+#include "ble_sim.h"
+
+const char ble_host_name[] = "host";
+
+static ble_sim_notify_fn notify_hook;
+
+void ble_sim_set_notify(ble_sim_notify_fn fn)
+{
+    notify_hook = fn;
+}
+
+void ble_host_start(void)
+{
+    ESP_LOGI(BLE_TAG, "Host build: no radio, the harness is the central");
+}
+
+static int sim_notify(device_conn_t *dev, ble_sim_chr_t chr, const uint8_t *data, size_t len)
+{
+    ble_sim_notify_fn fn = notify_hook;
+    return fn ? fn(dev, chr, data, len) : 0;
+}
+
+int ble_host_notify(device_conn_t *dev, const uint8_t *data, size_t len)
+{
+    return sim_notify(dev, BLE_SIM_CHR_TX, data, len);
+}
+
+int ble_host_notify_metrics(device_conn_t *dev, const uint8_t *data, size_t len)
+{
+    return sim_notify(dev, BLE_SIM_CHR_METRICS, data, len);
+}
+
+int ble_host_notify_prio(device_conn_t *dev, const uint8_t *data, size_t len)
+{
+    return sim_notify(dev, BLE_SIM_CHR_PRIO, data, len);
+}
+
+void ble_host_set_name(const char *name)
+{
+    ESP_LOGI(BLE_TAG, "Device name %s", name);
+}
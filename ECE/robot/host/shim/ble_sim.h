@@ -0,0 +1,25 @@
+#ifndef BLE_SIM_H
+#define BLE_SIM_H
+
+#include "ble_host.h"
+
+// -------------------------------------------------------------------------
+// BLE host glue for the host build (ble_host.h): no controller, no
+// advertising. A harness plays the central through Robot_BLE.c's own entry
+// points (ble_conn_open, ble_rx_write, ...) and sees every notification the
+// firmware sends through the hook below, called on the sending task.
+// -------------------------------------------------------------------------
+
+typedef enum {
+    BLE_SIM_CHR_TX,                     // 0xFF02
+    BLE_SIM_CHR_METRICS,                // ROBOT_METRICS_UUID
+    BLE_SIM_CHR_PRIO,                   // ROBOT_PRIO_UUID
+} ble_sim_chr_t;
+
+// 0: the host took it; anything else is a refusal (the firmware queues and
+// retries, as after a congested notify)
+typedef int (*ble_sim_notify_fn)(device_conn_t *dev, ble_sim_chr_t chr, const uint8_t *data, size_t len);
+
+void ble_sim_set_notify(ble_sim_notify_fn fn);      // NULL: notifications are dropped (taken)
+
+#endif
@@ -0,0 +1,621 @@
+// drivers.c
+//
+// Peripheral drivers for the host build. GPIO and LEDC record what the
+// firmware writes; MCPWM timers tick on their own thread and feed the PCNT
+// step counters, so the ramp ISR, odometry and the nav reports run as on
+// the robot; I2C finds no device and ADC no pin. See each driver/*.h.
+
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "driver/mcpwm_prelude.h"
+#include "driver/pulse_cnt.h"
+#include "driver/i2c_master.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "soc/gpio_struct.h"
+#include "host_shim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// -------------------------------------------------------------------------
+// GPIO
+// -------------------------------------------------------------------------
+static gpio_dev_t gpio_hw;
+
+static pthread_mutex_t gpio_mu = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t        gpio_out;                // Level of each pin set as an output
+static uint64_t        gpio_is_out;
+
+// Applies the w1ts / w1tc registers written since the last read. Set before
+// clear, as the firmware writes them; caller holds gpio_mu
+static void gpio_fold(void)
+{
+    uint64_t set = __atomic_exchange_n(&gpio_hw.out_w1ts, 0, __ATOMIC_ACQ_REL) |
+                   (uint64_t)__atomic_exchange_n(&gpio_hw.out1_w1ts.val, 0, __ATOMIC_ACQ_REL) << 32;
+    uint64_t clr = __atomic_exchange_n(&gpio_hw.out_w1tc, 0, __ATOMIC_ACQ_REL) |
+                   (uint64_t)__atomic_exchange_n(&gpio_hw.out1_w1tc.val, 0, __ATOMIC_ACQ_REL) << 32;
+    gpio_out = (gpio_out | set) & ~clr;
+}
+
+gpio_dev_t *gpio_regs(void)
+{
+    pthread_mutex_lock(&gpio_mu);
+    gpio_fold();
+    pthread_mutex_unlock(&gpio_mu);
+    return &gpio_hw;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode)
+{
+    if (gpio < 0 || gpio >= GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&gpio_mu);
+    if (mode == GPIO_MODE_OUTPUT || mode == GPIO_MODE_INPUT_OUTPUT) gpio_is_out |= 1ULL << gpio;
+    else gpio_is_out &= ~(1ULL << gpio);
+    pthread_mutex_unlock(&gpio_mu);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level)
+{
+    if (gpio < 0 || gpio >= GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&gpio_mu);
+    gpio_fold();
+    if (level) gpio_out |= 1ULL << gpio;
+    else gpio_out &= ~(1ULL << gpio);
+    pthread_mutex_unlock(&gpio_mu);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio)
+{
+    if (gpio < 0 || gpio >= GPIO_NUM_MAX) return 0;
+    pthread_mutex_lock(&gpio_mu);
+    gpio_fold();
+    int level = (gpio_is_out >> gpio & 1) ? (int)(gpio_out >> gpio & 1) : 1;
+    pthread_mutex_unlock(&gpio_mu);
+    return level;
+}
+
+esp_err_t gpio_input_enable(gpio_num_t gpio)
+{
+    return gpio >= 0 && gpio < GPIO_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio, gpio_int_type_t type)
+{
+    (void)type;
+    return gpio_input_enable(gpio);
+}
+
+esp_err_t gpio_install_isr_service(int flags)
+{
+    (void)flags;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t isr, void *arg)
+{
+    (void)isr;
+    (void)arg;
+    return gpio_input_enable(gpio);
+}
+
+// -------------------------------------------------------------------------
+// LEDC
+// -------------------------------------------------------------------------
+static struct {
+    uint32_t freq_hz;
+} ledc_timers[LEDC_TIMER_MAX];
+
+static struct {
+    int          gpio;
+    ledc_timer_t timer;
+    uint32_t     duty, duty_next;
+} ledc_chans[LEDC_CHANNEL_MAX];
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *cfg)
+{
+    if (!cfg || cfg->timer_num >= LEDC_TIMER_MAX) return ESP_ERR_INVALID_ARG;
+    ledc_timers[cfg->timer_num].freq_hz = cfg->freq_hz;
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *cfg)
+{
+    if (!cfg || cfg->channel >= LEDC_CHANNEL_MAX) return ESP_ERR_INVALID_ARG;
+    ledc_chans[cfg->channel].gpio = cfg->gpio_num;
+    ledc_chans[cfg->channel].timer = cfg->timer_sel;
+    ledc_chans[cfg->channel].duty = ledc_chans[cfg->channel].duty_next = cfg->duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_freq(ledc_mode_t mode, ledc_timer_t timer, uint32_t freq_hz)
+{
+    (void)mode;
+    if (timer >= LEDC_TIMER_MAX) return ESP_ERR_INVALID_ARG;
+    ledc_timers[timer].freq_hz = freq_hz;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty)
+{
+    (void)mode;
+    if (channel >= LEDC_CHANNEL_MAX) return ESP_ERR_INVALID_ARG;
+    ledc_chans[channel].duty_next = duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel)
+{
+    (void)mode;
+    if (channel >= LEDC_CHANNEL_MAX) return ESP_ERR_INVALID_ARG;
+    ledc_chans[channel].duty = ledc_chans[channel].duty_next;
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t mode, ledc_channel_t channel)
+{
+    (void)mode;
+    return channel < LEDC_CHANNEL_MAX ? ledc_chans[channel].duty : 0;
+}
+
+esp_err_t ledc_stop(ledc_mode_t mode, ledc_channel_t channel, uint32_t idle_level)
+{
+    (void)mode;
+    (void)idle_level;
+    if (channel >= LEDC_CHANNEL_MAX) return ESP_ERR_INVALID_ARG;
+    ledc_chans[channel].duty = 0;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty, int ms)
+{
+    (void)ms;
+    return ledc_set_duty(mode, channel, duty);
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t mode, ledc_channel_t channel, ledc_fade_mode_t wait)
+{
+    (void)wait;
+    return ledc_update_duty(mode, channel);
+}
+
+esp_err_t ledc_fade_stop(ledc_mode_t mode, ledc_channel_t channel)
+{
+    (void)mode;
+    return channel < LEDC_CHANNEL_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// -------------------------------------------------------------------------
+// PCNT: one channel per unit, as the firmware sets them up
+// -------------------------------------------------------------------------
+#define PCNT_UNITS 8
+
+struct pcnt_unit_t {
+    int  edge_gpio, level_gpio;
+    int  pos_action, high_action, low_action;
+    int  count;
+    bool running;
+};
+
+struct pcnt_chan_t {
+    struct pcnt_unit_t *unit;
+};
+
+static struct pcnt_unit_t pcnt_units[PCNT_UNITS];
+static struct pcnt_chan_t pcnt_chans[PCNT_UNITS];
+static int                pcnt_used;
+static pthread_mutex_t    pcnt_mu = PTHREAD_MUTEX_INITIALIZER;
+
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t *cfg, pcnt_unit_handle_t *out)
+{
+    (void)cfg;
+    pthread_mutex_lock(&pcnt_mu);
+    esp_err_t rc = ESP_ERR_NOT_FOUND;
+    if (pcnt_used < PCNT_UNITS) {
+        struct pcnt_unit_t *u = &pcnt_units[pcnt_used++];
+        memset(u, 0, sizeof(*u));
+        u->edge_gpio = u->level_gpio = -1;
+        *out = u;
+        rc = ESP_OK;
+    }
+    pthread_mutex_unlock(&pcnt_mu);
+    return rc;
+}
+
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t unit, const pcnt_chan_config_t *cfg, pcnt_channel_handle_t *out)
+{
+    pthread_mutex_lock(&pcnt_mu);
+    unit->edge_gpio = cfg->edge_gpio_num;
+    unit->level_gpio = cfg->level_gpio_num;
+    struct pcnt_chan_t *ch = &pcnt_chans[unit - pcnt_units];
+    ch->unit = unit;
+    *out = ch;
+    pthread_mutex_unlock(&pcnt_mu);
+    return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t ch, pcnt_channel_edge_action_t pos,
+                                       pcnt_channel_edge_action_t neg)
+{
+    (void)neg;                                  // Steps are counted on the rising edge only
+    ch->unit->pos_action = pos;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_level_action(pcnt_channel_handle_t ch, pcnt_channel_level_action_t high,
+                                        pcnt_channel_level_action_t low)
+{
+    ch->unit->high_action = high;
+    ch->unit->low_action = low;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t unit, int value)
+{
+    (void)unit;
+    (void)value;                                // accum_count: the count never wraps here
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t unit)
+{
+    (void)unit;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unit)
+{
+    pthread_mutex_lock(&pcnt_mu);
+    unit->count = 0;
+    pthread_mutex_unlock(&pcnt_mu);
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t unit)
+{
+    pthread_mutex_lock(&pcnt_mu);
+    unit->running = true;
+    pthread_mutex_unlock(&pcnt_mu);
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unit, int *value)
+{
+    pthread_mutex_lock(&pcnt_mu);
+    *value = unit->count;
+    pthread_mutex_unlock(&pcnt_mu);
+    return ESP_OK;
+}
+
+// One rising edge on gpio
+static void pcnt_edge(int gpio)
+{
+    pthread_mutex_lock(&pcnt_mu);
+    for (int i = 0; i < pcnt_used; i++) {
+        struct pcnt_unit_t *u = &pcnt_units[i];
+        if (!u->running || u->edge_gpio != gpio) continue;
+        int d = u->pos_action == PCNT_CHANNEL_EDGE_ACTION_INCREASE ? 1 :
+                u->pos_action == PCNT_CHANNEL_EDGE_ACTION_DECREASE ? -1 : 0;
+        int level_action = gpio_get_level((gpio_num_t)u->level_gpio) ? u->high_action : u->low_action;
+        if (level_action == PCNT_CHANNEL_LEVEL_ACTION_INVERSE) d = -d;
+        else if (level_action == PCNT_CHANNEL_LEVEL_ACTION_HOLD) d = 0;
+        u->count += d;
+    }
+    pthread_mutex_unlock(&pcnt_mu);
+}
+
+// -------------------------------------------------------------------------
+// MCPWM timers, on the "mcpwm" thread: each started timer fires on_empty
+// once per period and puts one pulse on its generator's pin
+// -------------------------------------------------------------------------
+#define MCPWM_TIMERS (SOC_MCPWM_GROUPS * SOC_MCPWM_TIMERS_PER_GROUP)
+
+struct mcpwm_timer_t {
+    uint32_t               resolution_hz;
+    uint32_t               period_ticks;
+    bool                   running;
+    int64_t                due_ns;
+    mcpwm_timer_event_cb_t on_empty;
+    void                  *ctx;
+    int                    gen_gpio;
+};
+
+struct mcpwm_oper_t {
+    struct mcpwm_timer_t *timer;
+};
+
+struct mcpwm_cmpr_t {
+    uint32_t ticks;
+};
+
+struct mcpwm_gen_t {
+    int gpio;
+};
+
+static struct mcpwm_timer_t mc_timers[MCPWM_TIMERS];
+static struct mcpwm_oper_t  mc_opers[MCPWM_TIMERS];
+static struct mcpwm_cmpr_t  mc_cmprs[MCPWM_TIMERS];
+static struct mcpwm_gen_t   mc_gens[MCPWM_TIMERS];
+static int                  mc_used, mc_opers_used, mc_cmprs_used, mc_gens_used;
+static pthread_mutex_t      mc_mu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t       mc_cv;
+static pthread_once_t       mc_once = PTHREAD_ONCE_INIT;
+
+static int64_t mc_period_ns(const struct mcpwm_timer_t *t)
+{
+    return (int64_t)t->period_ticks * 1000000000LL / (t->resolution_hz ? t->resolution_hz : 1);
+}
+
+static void *mc_thread(void *arg)
+{
+    (void)arg;
+    host_thread_adopt("mcpwm", 1, true);        // Step ISR ran on the executor's core
+    pthread_setname_np(pthread_self(), "mcpwm");
+    pthread_mutex_lock(&mc_mu);
+    for (;;) {
+        struct mcpwm_timer_t *next = NULL;
+        for (int i = 0; i < mc_used; i++) {
+            if (mc_timers[i].running && (!next || mc_timers[i].due_ns < next->due_ns)) next = &mc_timers[i];
+        }
+        if (!next) {
+            pthread_cond_wait(&mc_cv, &mc_mu);
+            continue;
+        }
+        int64_t now = host_now_ns();
+        if (next->due_ns > now) {
+            struct timespec ts;
+            host_deadline(&ts, next->due_ns - now);
+            pthread_cond_timedwait(&mc_cv, &mc_mu, &ts);
+            continue;
+        }
+
+        // The pulse goes out, then the ISR sets the next period (or stops)
+        int gpio = next->gen_gpio;
+        mcpwm_timer_event_cb_t cb = next->on_empty;
+        void *ctx = next->ctx;
+        pthread_mutex_unlock(&mc_mu);
+        if (gpio >= 0) pcnt_edge(gpio);
+        if (cb) {
+            mcpwm_timer_event_data_t ev = { 0, MCPWM_TIMER_DIRECTION_UP };
+            cb(next, &ev, ctx);
+        }
+        pthread_mutex_lock(&mc_mu);
+        next->due_ns += mc_period_ns(next);
+        if (next->due_ns < now) next->due_ns = now;     // Host preempted us: no burst to catch up
+    }
+    return NULL;
+}
+
+static void mc_start(void)
+{
+    host_cond_init(&mc_cv);
+    pthread_t th;
+    pthread_create(&th, NULL, mc_thread, NULL);
+    pthread_detach(th);
+}
+
+esp_err_t mcpwm_new_timer(const mcpwm_timer_config_t *cfg, mcpwm_timer_handle_t *out)
+{
+    pthread_once(&mc_once, mc_start);
+    pthread_mutex_lock(&mc_mu);
+    esp_err_t rc = ESP_ERR_NOT_FOUND;
+    if (mc_used < MCPWM_TIMERS) {
+        struct mcpwm_timer_t *t = &mc_timers[mc_used++];
+        memset(t, 0, sizeof(*t));
+        t->resolution_hz = cfg->resolution_hz;
+        t->period_ticks = cfg->period_ticks;
+        t->gen_gpio = -1;
+        *out = t;
+        rc = ESP_OK;
+    }
+    pthread_mutex_unlock(&mc_mu);
+    return rc;
+}
+
+esp_err_t mcpwm_timer_register_event_callbacks(mcpwm_timer_handle_t timer, const mcpwm_timer_event_callbacks_t *cbs,
+                                               void *user_data)
+{
+    pthread_mutex_lock(&mc_mu);
+    timer->on_empty = cbs->on_empty;
+    timer->ctx = user_data;
+    pthread_mutex_unlock(&mc_mu);
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_timer_enable(mcpwm_timer_handle_t timer)
+{
+    (void)timer;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_timer_start_stop(mcpwm_timer_handle_t timer, mcpwm_timer_start_stop_cmd_t cmd)
+{
+    pthread_mutex_lock(&mc_mu);
+    bool run = cmd == MCPWM_TIMER_START_NO_STOP;
+    if (run && !timer->running) timer->due_ns = host_now_ns() + mc_period_ns(timer);
+    timer->running = run;
+    pthread_cond_signal(&mc_cv);
+    pthread_mutex_unlock(&mc_mu);
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_timer_set_period(mcpwm_timer_handle_t timer, uint32_t period_ticks)
+{
+    pthread_mutex_lock(&mc_mu);
+    timer->period_ticks = period_ticks;         // update_period_on_empty: from the next period on
+    pthread_mutex_unlock(&mc_mu);
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_new_operator(const mcpwm_operator_config_t *cfg, mcpwm_oper_handle_t *out)
+{
+    (void)cfg;
+    if (mc_opers_used >= MCPWM_TIMERS) return ESP_ERR_NOT_FOUND;
+    *out = &mc_opers[mc_opers_used++];
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_operator_connect_timer(mcpwm_oper_handle_t oper, mcpwm_timer_handle_t timer)
+{
+    oper->timer = timer;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_new_comparator(mcpwm_oper_handle_t oper, const mcpwm_comparator_config_t *cfg,
+                               mcpwm_cmpr_handle_t *out)
+{
+    (void)oper;
+    (void)cfg;
+    if (mc_cmprs_used >= MCPWM_TIMERS) return ESP_ERR_NOT_FOUND;
+    *out = &mc_cmprs[mc_cmprs_used++];
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_comparator_set_compare_value(mcpwm_cmpr_handle_t cmp, uint32_t ticks)
+{
+    cmp->ticks = ticks;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_new_generator(mcpwm_oper_handle_t oper, const mcpwm_generator_config_t *cfg,
+                              mcpwm_gen_handle_t *out)
+{
+    if (mc_gens_used >= MCPWM_TIMERS) return ESP_ERR_NOT_FOUND;
+    struct mcpwm_gen_t *g = &mc_gens[mc_gens_used++];
+    g->gpio = cfg->gen_gpio_num;
+    if (oper->timer) {
+        pthread_mutex_lock(&mc_mu);
+        oper->timer->gen_gpio = g->gpio;
+        pthread_mutex_unlock(&mc_mu);
+    }
+    *out = g;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_generator_set_action_on_timer_event(mcpwm_gen_handle_t gen, mcpwm_gen_timer_event_action_t act)
+{
+    (void)gen;
+    (void)act;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_generator_set_action_on_compare_event(mcpwm_gen_handle_t gen, mcpwm_gen_compare_event_action_t act)
+{
+    (void)gen;
+    (void)act;
+    return ESP_OK;
+}
+
+// -------------------------------------------------------------------------
+// I2C: a bus with nothing on it
+// -------------------------------------------------------------------------
+struct i2c_master_bus_t {
+    int port;
+};
+
+struct i2c_master_dev_t {
+    uint16_t addr;
+};
+
+static struct i2c_master_bus_t i2c_bus;
+static struct i2c_master_dev_t i2c_devs[4];
+static int                     i2c_devs_used;
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *cfg, i2c_master_bus_handle_t *out)
+{
+    i2c_bus.port = cfg->i2c_port;
+    *out = &i2c_bus;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_reset(i2c_master_bus_handle_t bus)
+{
+    (void)bus;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t *cfg,
+                                    i2c_master_dev_handle_t *out)
+{
+    (void)bus;
+    if (i2c_devs_used >= (int)(sizeof(i2c_devs) / sizeof(i2c_devs[0]))) return ESP_ERR_NO_MEM;
+    i2c_devs[i2c_devs_used].addr = cfg->device_address;
+    *out = &i2c_devs[i2c_devs_used++];
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t *data, size_t len, int timeout_ms)
+{
+    (void)dev;
+    (void)data;
+    (void)len;
+    (void)timeout_ms;
+    return ESP_ERR_TIMEOUT;                     // No ACK from the address
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t *data, size_t len, int timeout_ms)
+{
+    (void)dev;
+    (void)data;
+    (void)len;
+    (void)timeout_ms;
+    return ESP_ERR_TIMEOUT;
+}
+
+// -------------------------------------------------------------------------
+// ADC: no pin maps to a channel
+// -------------------------------------------------------------------------
+esp_err_t adc_oneshot_io_to_channel(int io_num, adc_unit_t *unit, adc_channel_t *channel)
+{
+    (void)io_num;
+    (void)unit;
+    (void)channel;
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t adc_oneshot_new_unit(const adc_oneshot_unit_init_cfg_t *cfg, adc_oneshot_unit_handle_t *out)
+{
+    (void)cfg;
+    (void)out;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t adc_oneshot_config_channel(adc_oneshot_unit_handle_t unit, adc_channel_t channel,
+                                     const adc_oneshot_chan_cfg_t *cfg)
+{
+    (void)unit;
+    (void)channel;
+    (void)cfg;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t adc_oneshot_read(adc_oneshot_unit_handle_t unit, adc_channel_t channel, int *raw)
+{
+    (void)unit;
+    (void)channel;
+    (void)raw;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t adc_cali_create_scheme_line_fitting(const adc_cali_line_fitting_config_t *cfg, adc_cali_handle_t *out)
+{
+    (void)cfg;
+    (void)out;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *mv)
+{
+    (void)handle;
+    (void)raw;
+    (void)mv;
+    return ESP_ERR_NOT_SUPPORTED;
+}
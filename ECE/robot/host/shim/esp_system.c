@@ -0,0 +1,283 @@
+// esp_system.c
+//
+// The rest of ESP-IDF the firmware calls, for the host build: console
+// log, error names, heap figures, app description, ROM delay, NVS in
+// memory and the power-management stubs.
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_app_desc.h"
+#include "esp_rom_sys.h"
+#include "esp_pm.h"
+#include "nvs_flash.h"
+#include "host_shim.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef PROJECT_VER
+#define PROJECT_VER "host"
+#endif
+
+// -------------------------------------------------------------------------
+// Log
+// -------------------------------------------------------------------------
+#define LOG_TAGS 16
+
+static pthread_mutex_t log_mu = PTHREAD_MUTEX_INITIALIZER;
+static int             log_default = -1;
+static struct {
+    char            tag[24];
+    esp_log_level_t level;
+} log_tags[LOG_TAGS];
+static int log_ntags;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    pthread_mutex_lock(&log_mu);
+    if (strcmp(tag, "*") == 0) {
+        log_default = level;
+    } else {
+        int i = 0;
+        while (i < log_ntags && strcmp(log_tags[i].tag, tag) != 0) i++;
+        if (i < LOG_TAGS) {
+            snprintf(log_tags[i].tag, sizeof(log_tags[i].tag), "%s", tag);
+            log_tags[i].level = level;
+            if (i == log_ntags) log_ntags++;
+        }
+    }
+    pthread_mutex_unlock(&log_mu);
+}
+
+static esp_log_level_t log_level(const char *tag)
+{
+    if (log_default < 0) {
+        const char *env = getenv("ROBOT_HOST_LOG");
+        log_default = env ? atoi(env) : ESP_LOG_INFO;
+    }
+    for (int i = 0; i < log_ntags; i++) {
+        if (strcmp(log_tags[i].tag, tag) == 0) return log_tags[i].level;
+    }
+    return (esp_log_level_t)log_default;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *fmt, ...)
+{
+    static const char letter[] = "NEWIDV";
+    pthread_mutex_lock(&log_mu);
+    if (level <= log_level(tag)) {
+        va_list ap;
+        va_start(ap, fmt);
+        fprintf(stderr, "%c (%lld) %s: ", letter[level], (long long)(host_now_ns() / 1000000), tag);
+        vfprintf(stderr, fmt, ap);
+        fputc('\n', stderr);
+        va_end(ap);
+    }
+    pthread_mutex_unlock(&log_mu);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK:                        return "ESP_OK";
+        case ESP_FAIL:                      return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:                return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:           return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:         return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:          return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:             return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:         return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:               return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_NVS_NOT_FOUND:         return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_NO_FREE_PAGES:     return "ESP_ERR_NVS_NO_FREE_PAGES";
+        case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+        default:                            return "UNKNOWN ERROR";
+    }
+}
+
+// -------------------------------------------------------------------------
+// System
+// -------------------------------------------------------------------------
+#define HOST_HEAP_BYTES (256 * 1024)
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return HOST_HEAP_BYTES;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return HOST_HEAP_BYTES;
+}
+
+void esp_restart(void)
+{
+    ESP_LOGE("HOST", "esp_restart()");
+    exit(2);
+}
+
+const esp_app_desc_t *esp_app_get_description(void)
+{
+    static const esp_app_desc_t desc = {
+        .version      = PROJECT_VER,
+        .project_name = "Robot_Final",
+        .time         = __TIME__,
+        .date         = __DATE__,
+        .idf_ver      = "host",
+    };
+    return &desc;
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    int64_t until = host_now_ns() + (int64_t)us * 1000;
+    while (host_now_ns() < until) {}
+}
+
+// -------------------------------------------------------------------------
+// NVS: a handful of blobs in memory, one namespace per handle
+// -------------------------------------------------------------------------
+#define NVS_ENTRIES 16
+#define NVS_NAMESPACES 8
+#define NVS_BLOB_MAX 64
+
+static pthread_mutex_t nvs_mu = PTHREAD_MUTEX_INITIALIZER;
+static char            nvs_ns[NVS_NAMESPACES][16];
+static int             nvs_nns;
+static struct {
+    nvs_handle_t ns;
+    char         key[16];
+    uint8_t      val[NVS_BLOB_MAX];
+    size_t       len;
+} nvs_blobs[NVS_ENTRIES];
+static int nvs_nblobs;
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    pthread_mutex_lock(&nvs_mu);
+    nvs_nblobs = 0;
+    pthread_mutex_unlock(&nvs_mu);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out)
+{
+    (void)mode;
+    pthread_mutex_lock(&nvs_mu);
+    int i = 0;
+    while (i < nvs_nns && strcmp(nvs_ns[i], ns) != 0) i++;
+    esp_err_t rc = ESP_OK;
+    if (i == nvs_nns) {
+        if (i < NVS_NAMESPACES) snprintf(nvs_ns[nvs_nns++], sizeof(nvs_ns[0]), "%s", ns);
+        else rc = ESP_ERR_NO_MEM;
+    }
+    *out = (nvs_handle_t)i + 1;
+    pthread_mutex_unlock(&nvs_mu);
+    return rc;
+}
+
+void nvs_close(nvs_handle_t h)
+{
+    (void)h;
+}
+
+esp_err_t nvs_commit(nvs_handle_t h)
+{
+    (void)h;
+    return ESP_OK;
+}
+
+// Caller holds nvs_mu
+static int nvs_find(nvs_handle_t h, const char *key)
+{
+    for (int i = 0; i < nvs_nblobs; i++) {
+        if (nvs_blobs[i].ns == h && strcmp(nvs_blobs[i].key, key) == 0) return i;
+    }
+    return -1;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *len)
+{
+    pthread_mutex_lock(&nvs_mu);
+    int i = nvs_find(h, key);
+    esp_err_t rc = ESP_OK;
+    if (i < 0) {
+        rc = ESP_ERR_NVS_NOT_FOUND;
+    } else if (!out) {
+        *len = nvs_blobs[i].len;
+    } else if (*len < nvs_blobs[i].len) {
+        rc = ESP_ERR_INVALID_SIZE;
+    } else {
+        memcpy(out, nvs_blobs[i].val, nvs_blobs[i].len);
+        *len = nvs_blobs[i].len;
+    }
+    pthread_mutex_unlock(&nvs_mu);
+    return rc;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *val, size_t len)
+{
+    if (len > NVS_BLOB_MAX) return ESP_ERR_INVALID_SIZE;
+    pthread_mutex_lock(&nvs_mu);
+    int i = nvs_find(h, key);
+    esp_err_t rc = ESP_OK;
+    if (i < 0 && nvs_nblobs < NVS_ENTRIES) i = nvs_nblobs++;
+    if (i < 0) {
+        rc = ESP_ERR_NO_MEM;
+    } else {
+        nvs_blobs[i].ns = h;
+        snprintf(nvs_blobs[i].key, sizeof(nvs_blobs[i].key), "%s", key);
+        memcpy(nvs_blobs[i].val, val, len);
+        nvs_blobs[i].len = len;
+    }
+    pthread_mutex_unlock(&nvs_mu);
+    return rc;
+}
+
+// -------------------------------------------------------------------------
+// Power management: not configured on the host (CONFIG_PM_ENABLE 0)
+// -------------------------------------------------------------------------
+struct esp_pm_lock {
+    int held;
+};
+
+esp_err_t esp_pm_configure(const void *config)
+{
+    (void)config;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t type, int arg, const char *name, esp_pm_lock_handle_t *out)
+{
+    (void)type;
+    (void)arg;
+    (void)name;
+    *out = calloc(1, sizeof(**out));
+    return *out ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle)
+{
+    __atomic_add_fetch(&handle->held, 1, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle)
+{
+    __atomic_sub_fetch(&handle->held, 1, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_dump_locks(FILE *stream)
+{
+    (void)stream;
+    return ESP_ERR_NOT_SUPPORTED;
+}
@@ -0,0 +1,175 @@
+// esp_timer.c
+//
+// esp_timer for the host build: a list of armed timers sorted by expiry and
+// one dispatch thread that sleeps until the first of them, then runs its
+// callback, as ESP_TIMER_TASK dispatch does. Return codes follow ESP-IDF
+// (start on an armed timer, stop or restart on an idle one:
+// ESP_ERR_INVALID_STATE); the firmware branches on them.
+
+#include "esp_timer.h"
+#include "host_shim.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+struct esp_timer {
+    struct esp_timer *next;                 // In the armed list
+    esp_timer_cb_t    cb;
+    void             *arg;
+    const char       *name;
+    int64_t           due_ns;
+    int64_t           period_ns;            // 0 = one-shot
+    bool              armed;
+};
+
+static pthread_mutex_t    tm_mu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     tm_cv;
+static pthread_once_t     tm_once = PTHREAD_ONCE_INIT;
+static struct esp_timer  *armed;
+
+int64_t esp_timer_get_time(void)
+{
+    return host_now_ns() / 1000;
+}
+
+// Caller holds tm_mu
+static void list_insert(struct esp_timer *t)
+{
+    struct esp_timer **pp = &armed;
+    while (*pp && (*pp)->due_ns <= t->due_ns) pp = &(*pp)->next;
+    t->next = *pp;
+    *pp = t;
+    t->armed = true;
+    pthread_cond_signal(&tm_cv);
+}
+
+static void list_remove(struct esp_timer *t)
+{
+    for (struct esp_timer **pp = &armed; *pp; pp = &(*pp)->next) {
+        if (*pp == t) {
+            *pp = t->next;
+            break;
+        }
+    }
+    t->armed = false;
+}
+
+static void *dispatch(void *arg)
+{
+    (void)arg;
+    host_thread_adopt("esp_timer", 0, false);
+    pthread_setname_np(pthread_self(), "esp_timer");
+    pthread_mutex_lock(&tm_mu);
+    for (;;) {
+        if (!armed) {
+            pthread_cond_wait(&tm_cv, &tm_mu);
+            continue;
+        }
+        int64_t now = host_now_ns();
+        struct esp_timer *t = armed;
+        if (t->due_ns > now) {
+            struct timespec ts;
+            host_deadline(&ts, t->due_ns - now);
+            pthread_cond_timedwait(&tm_cv, &tm_mu, &ts);
+            continue;                           // The list may have changed meanwhile
+        }
+        list_remove(t);
+        if (t->period_ns) {
+            t->due_ns += t->period_ns;
+            if (t->due_ns < now) t->due_ns = now + t->period_ns;   // Fell behind: no burst of catch-up calls
+            list_insert(t);
+        }
+        esp_timer_cb_t cb = t->cb;
+        void *cb_arg = t->arg;
+        pthread_mutex_unlock(&tm_mu);
+        cb(cb_arg);
+        pthread_mutex_lock(&tm_mu);
+    }
+    return NULL;
+}
+
+static void dispatch_start(void)
+{
+    host_cond_init(&tm_cv);
+    pthread_t th;
+    pthread_create(&th, NULL, dispatch, NULL);
+    pthread_detach(th);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    if (!args || !args->callback || !out) return ESP_ERR_INVALID_ARG;
+    pthread_once(&tm_once, dispatch_start);
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (!t) return ESP_ERR_NO_MEM;
+    t->cb = args->callback;
+    t->arg = args->arg;
+    t->name = args->name;
+    *out = t;
+    return ESP_OK;
+}
+
+static esp_err_t timer_start(esp_timer_handle_t t, uint64_t us, bool periodic, bool restart)
+{
+    if (!t) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&tm_mu);
+    esp_err_t rc = ESP_OK;
+    if (t->armed != restart) {
+        rc = ESP_ERR_INVALID_STATE;
+    } else {
+        if (restart) {
+            list_remove(t);
+            if (t->period_ns) t->period_ns = (int64_t)us * 1000;
+        } else {
+            t->period_ns = periodic ? (int64_t)us * 1000 : 0;
+        }
+        t->due_ns = host_now_ns() + (int64_t)us * 1000;
+        list_insert(t);
+    }
+    pthread_mutex_unlock(&tm_mu);
+    return rc;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_start(timer, timeout_us, false, false);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return timer_start(timer, period_us, true, false);
+}
+
+esp_err_t esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_start(timer, timeout_us, false, true);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&tm_mu);
+    esp_err_t rc = timer->armed ? ESP_OK : ESP_ERR_INVALID_STATE;
+    if (timer->armed) list_remove(timer);
+    pthread_mutex_unlock(&tm_mu);
+    return rc;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&tm_mu);
+    bool busy = timer->armed;
+    pthread_mutex_unlock(&tm_mu);
+    if (busy) return ESP_ERR_INVALID_STATE;
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&tm_mu);
+    bool on = timer && timer->armed;
+    pthread_mutex_unlock(&tm_mu);
+    return on;
+}
@@ -0,0 +1,505 @@
+// freertos.c
+//
+// FreeRTOS on pthreads for the host build: one thread per task, direct
+// notifications, mutexes / semaphores and stream buffers on a mutex and a
+// CLOCK_MONOTONIC condition variable. Ticks are CONFIG_FREERTOS_HZ, counted
+// from start-up. See freertos/FreeRTOS.h.
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+#include "esp_log.h"
+#include "host_shim.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TICK_NS  (1000000000LL / configTICK_RATE_HZ)
+
+struct host_task {
+    struct host_task *next;
+    char              name[16];
+    TaskFunction_t    fn;
+    void             *arg;
+    UBaseType_t       prio;
+    BaseType_t        core;
+    uint32_t          stack;
+    bool              isr;              // Stands for an interrupt (esp_timer ISR dispatch, MCPWM)
+    pthread_mutex_t   mu;
+    pthread_cond_t    cv;
+    uint32_t          notify;
+};
+
+static pthread_mutex_t          tasks_mu = PTHREAD_MUTEX_INITIALIZER;
+static struct host_task        *tasks;
+static UBaseType_t              task_count;
+static __thread struct host_task *self;
+
+// -------------------------------------------------------------------------
+// Clock
+// -------------------------------------------------------------------------
+static struct timespec t_start;
+
+__attribute__((constructor)) static void clock_start(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+}
+
+int64_t host_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)(ts.tv_sec - t_start.tv_sec) * 1000000000LL + (ts.tv_nsec - t_start.tv_nsec);
+}
+
+void host_deadline(struct timespec *ts, int64_t ns_from_now)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    int64_t ns = ts->tv_nsec + ns_from_now;
+    ts->tv_sec += ns / 1000000000LL;
+    ts->tv_nsec = ns % 1000000000LL;
+}
+
+void host_cond_init(pthread_cond_t *cv)
+{
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(cv, &ca);
+    pthread_condattr_destroy(&ca);
+}
+
+// Waits on cv under mu until pred() or the ticks run out; false on timeout
+static bool wait_ticks(pthread_mutex_t *mu, pthread_cond_t *cv, TickType_t ticks,
+                       bool (*pred)(void *), void *ctx)
+{
+    if (pred(ctx)) return true;
+    if (ticks == 0) return false;
+    if (ticks == portMAX_DELAY) {
+        while (!pred(ctx)) pthread_cond_wait(cv, mu);
+        return true;
+    }
+    struct timespec ts;
+    host_deadline(&ts, (int64_t)ticks * TICK_NS);
+    while (!pred(ctx)) {
+        if (pthread_cond_timedwait(cv, mu, &ts) == ETIMEDOUT) return pred(ctx);
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------------
+// Tasks
+// -------------------------------------------------------------------------
+static struct host_task *task_new(const char *name, UBaseType_t prio, BaseType_t core, uint32_t stack)
+{
+    struct host_task *t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+    snprintf(t->name, sizeof(t->name), "%s", name ? name : "");
+    t->prio = prio;
+    t->core = core == tskNO_AFFINITY ? 0 : core;
+    t->stack = stack;
+    pthread_mutex_init(&t->mu, NULL);
+    host_cond_init(&t->cv);
+
+    pthread_mutex_lock(&tasks_mu);
+    t->next = tasks;
+    tasks = t;
+    task_count++;
+    pthread_mutex_unlock(&tasks_mu);
+    return t;
+}
+
+// The calling thread as a task; main() and foreign threads get one on first use
+static struct host_task *task_self(void)
+{
+    if (!self) self = task_new("main", 1, 0, 0);
+    return self;
+}
+
+void host_thread_adopt(const char *name, int core, bool isr)
+{
+    self = task_new(name, configMAX_PRIORITIES - 1, core, 0);
+    if (self) self->isr = isr;
+}
+
+static void *task_main(void *arg)
+{
+    struct host_task *t = arg;
+    self = t;
+    char comm[16];
+    snprintf(comm, sizeof(comm), "%s", t->name);
+    pthread_setname_np(pthread_self(), comm);
+    t->fn(t->arg);
+    // A FreeRTOS task must not return; the target would abort here
+    ESP_LOGE("FREERTOS", "Task %s returned", t->name);
+    abort();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *out, BaseType_t core)
+{
+    struct host_task *t = task_new(name, prio, core, stack);
+    if (!t) return pdFAIL;
+    t->fn = fn;
+    t->arg = arg;
+
+    // Host stacks stay at the thread default: the FreeRTOS sizes are tuned
+    // for Xtensa frames, and sanitizer builds need several times more
+    pthread_t th;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&th, &attr, task_main, t);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) return pdFAIL;
+    if (out) *out = t;
+    return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                           UBaseType_t prio, StackType_t *stack_buf, StaticTask_t *tcb,
+                                           BaseType_t core)
+{
+    (void)stack_buf;
+    (void)tcb;
+    TaskHandle_t h = NULL;
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, &h, core) == pdPASS ? h : NULL;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task && task != self) {
+        ESP_LOGE("FREERTOS", "vTaskDelete of another task (%s) is not supported on the host", task->name);
+        return;
+    }
+    if (!self || !self->fn) {                   // main(): app_main() returning is the end of it
+        ESP_LOGE("FREERTOS", "vTaskDelete(NULL) outside a task");
+        return;
+    }
+    pthread_exit(NULL);                         // The handle stays valid, as a zombie TCB would
+}
+
+static void sleep_ns(int64_t ns)
+{
+    struct timespec ts;
+    host_deadline(&ts, ns);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (ticks == 0) {
+        sched_yield();
+        return;
+    }
+    sleep_ns((int64_t)ticks * TICK_NS);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(host_now_ns() / TICK_NS);
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return xTaskGetTickCount();
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *prev, TickType_t inc)
+{
+    TickType_t wake = *prev + inc;
+    *prev = wake;
+    int64_t now = host_now_ns();
+    int64_t left = (int64_t)(int32_t)(wake - (TickType_t)(now / TICK_NS)) * TICK_NS - now % TICK_NS;
+    if (left <= 0) return pdFALSE;              // Already late: no delay
+    sleep_ns(left);
+    return pdTRUE;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return task_self();
+}
+
+TaskHandle_t xTaskGetHandle(const char *name)
+{
+    struct host_task *found = NULL;
+    pthread_mutex_lock(&tasks_mu);
+    for (struct host_task *t = tasks; t && !found; t = t->next) {
+        if (strncmp(t->name, name, sizeof(t->name) - 1) == 0) found = t;
+    }
+    pthread_mutex_unlock(&tasks_mu);
+    return found;
+}
+
+TaskHandle_t xTaskGetIdleTaskHandleForCore(BaseType_t core)
+{
+    (void)core;
+    return NULL;                                // No idle task: the host idles in the kernel
+}
+
+BaseType_t xTaskGetCoreID(TaskHandle_t task)
+{
+    return task ? task->core : task_self()->core;
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return task_self()->core;
+}
+
+BaseType_t xPortInIsrContext(void)
+{
+    return self && self->isr;
+}
+
+char *pcTaskGetName(TaskHandle_t task)
+{
+    return (task ? task : task_self())->name;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    return (task ? task : task_self())->prio;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return task ? task->stack : 0;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+    return task_count;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *out, UBaseType_t n, configRUN_TIME_COUNTER_TYPE *total)
+{
+    (void)out;
+    (void)n;
+    if (total) *total = 0;
+    return 0;                                   // CONFIG_FREERTOS_USE_TRACE_FACILITY is off
+}
+
+// -------------------------------------------------------------------------
+// Notifications
+// -------------------------------------------------------------------------
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->mu);
+    task->notify++;
+    pthread_cond_signal(&task->cv);
+    pthread_mutex_unlock(&task->mu);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotifyGive(task);
+    if (woken) *woken = pdTRUE;
+}
+
+static bool notified(void *ctx)
+{
+    return ((struct host_task *)ctx)->notify != 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    struct host_task *t = task_self();
+    pthread_mutex_lock(&t->mu);
+    wait_ticks(&t->mu, &t->cv, ticks, notified, t);
+    uint32_t v = t->notify;
+    if (v) t->notify = clear ? 0 : v - 1;
+    pthread_mutex_unlock(&t->mu);
+    return v;
+}
+
+// -------------------------------------------------------------------------
+// Semaphores (a mutex is a binary semaphore that starts given)
+// -------------------------------------------------------------------------
+struct host_sem {
+    pthread_mutex_t mu;
+    pthread_cond_t  cv;
+    UBaseType_t     count;
+    UBaseType_t     max;
+};
+
+static SemaphoreHandle_t sem_new(UBaseType_t max, UBaseType_t initial)
+{
+    struct host_sem *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    pthread_mutex_init(&s->mu, NULL);
+    host_cond_init(&s->cv);
+    s->count = initial;
+    s->max = max;
+    return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return sem_new(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf)
+{
+    (void)buf;
+    return sem_new(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return sem_new(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    return sem_new(max, initial);
+}
+
+static bool sem_avail(void *ctx)
+{
+    return ((struct host_sem *)ctx)->count > 0;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    pthread_mutex_lock(&sem->mu);
+    bool ok = wait_ticks(&sem->mu, &sem->cv, ticks, sem_avail, sem);
+    if (ok) sem->count--;
+    pthread_mutex_unlock(&sem->mu);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->mu);
+    bool ok = sem->count < sem->max;
+    if (ok) {
+        sem->count++;
+        pthread_cond_signal(&sem->cv);
+    }
+    pthread_mutex_unlock(&sem->mu);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+    if (woken) *woken = pdTRUE;
+    return xSemaphoreGive(sem);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    if (!sem) return;
+    pthread_cond_destroy(&sem->cv);
+    pthread_mutex_destroy(&sem->mu);
+    free(sem);
+}
+
+// -------------------------------------------------------------------------
+// Stream buffers
+// -------------------------------------------------------------------------
+struct host_sbuf {
+    pthread_mutex_t mu;
+    pthread_cond_t  cv;
+    uint8_t        *buf;
+    size_t          size, head, used, trigger;
+    size_t          want;                       // Receiver's wake level while it waits
+};
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger)
+{
+    struct host_sbuf *sb = calloc(1, sizeof(*sb));
+    if (!sb) return NULL;
+    sb->buf = malloc(size);
+    if (!sb->buf) {
+        free(sb);
+        return NULL;
+    }
+    pthread_mutex_init(&sb->mu, NULL);
+    host_cond_init(&sb->cv);
+    sb->size = size;
+    sb->trigger = trigger ? trigger : 1;
+    return sb;
+}
+
+StreamBufferHandle_t xStreamBufferCreateStatic(size_t size, size_t trigger, uint8_t *storage,
+                                               StaticStreamBuffer_t *buf)
+{
+    (void)storage;
+    (void)buf;
+    return xStreamBufferCreate(size, trigger);
+}
+
+static bool sb_space(void *ctx)
+{
+    struct host_sbuf *sb = ctx;
+    return sb->used < sb->size;
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t sb, const void *data, size_t len, TickType_t ticks)
+{
+    const uint8_t *p = data;
+    size_t sent = 0;
+    pthread_mutex_lock(&sb->mu);
+    while (sent < len && wait_ticks(&sb->mu, &sb->cv, ticks, sb_space, sb)) {
+        while (sent < len && sb->used < sb->size) {
+            sb->buf[(sb->head + sb->used++) % sb->size] = p[sent++];
+        }
+        pthread_cond_broadcast(&sb->cv);
+    }
+    pthread_mutex_unlock(&sb->mu);
+    return sent;
+}
+
+size_t xStreamBufferSendFromISR(StreamBufferHandle_t sb, const void *data, size_t len, BaseType_t *woken)
+{
+    if (woken) *woken = pdTRUE;
+    return xStreamBufferSend(sb, data, len, 0);
+}
+
+static bool sb_ready(void *ctx)
+{
+    struct host_sbuf *sb = ctx;
+    return sb->used >= sb->want;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t sb, void *out, size_t len, TickType_t ticks)
+{
+    uint8_t *p = out;
+    size_t got = 0;
+    pthread_mutex_lock(&sb->mu);
+    sb->want = sb->trigger < len ? sb->trigger : len;
+    if (!sb->want) sb->want = 1;
+    wait_ticks(&sb->mu, &sb->cv, ticks, sb_ready, sb);
+    while (got < len && sb->used) {
+        p[got++] = sb->buf[sb->head];
+        sb->head = (sb->head + 1) % sb->size;
+        sb->used--;
+    }
+    if (got) pthread_cond_broadcast(&sb->cv);
+    pthread_mutex_unlock(&sb->mu);
+    return got;
+}
+
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t sb)
+{
+    pthread_mutex_lock(&sb->mu);
+    size_t n = sb->used;
+    pthread_mutex_unlock(&sb->mu);
+    return n;
+}
+
+BaseType_t xStreamBufferReset(StreamBufferHandle_t sb)
+{
+    pthread_mutex_lock(&sb->mu);
+    sb->head = sb->used = 0;
+    pthread_cond_broadcast(&sb->cv);
+    pthread_mutex_unlock(&sb->mu);
+    return pdPASS;
+}
@@ -0,0 +1,23 @@
+#ifndef HOST_SHIM_H
+#define HOST_SHIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+
+// -------------------------------------------------------------------------
+// Between the shim sources (freertos.c, esp_timer.c, drivers.c, ...).
+// Time is CLOCK_MONOTONIC; every wait is on a condition variable bound to
+// that clock, so a wall clock step cannot stretch a delay.
+// -------------------------------------------------------------------------
+
+int64_t host_now_ns(void);                              // Since start-up
+void    host_deadline(struct timespec *ts, int64_t ns_from_now);
+void    host_cond_init(pthread_cond_t *cv);             // CLOCK_MONOTONIC condition variable
+
+// Name, core and ISR flag for a thread the shims start themselves
+// (esp_timer dispatch, MCPWM timers); the FreeRTOS calls then see it as a task
+void    host_thread_adopt(const char *name, int core, bool isr);
+
+#endif
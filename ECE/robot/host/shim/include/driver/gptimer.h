@@ -0,0 +1,6 @@
+#ifndef DRIVER_GPTIMER_H
+#define DRIVER_GPTIMER_H
+
+// Included by main.c, which keeps no general-purpose timer
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef ESP_APP_DESC_H
+#define ESP_APP_DESC_H
+
+typedef struct {
+    char version[32];
+    char project_name[32];
+    char time[16];
+    char date[16];
+    char idf_ver[32];
+} esp_app_desc_t;
+
+// version from -D PROJECT_VER (the Makefile passes git describe), idf_ver "host"
+const esp_app_desc_t *esp_app_get_description(void);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef ESP_ATTR_H
+#define ESP_ATTR_H
+
+// One flat address space on the host: placement attributes are no-ops
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define EXT_RAM_BSS_ATTR
+#define WORD_ALIGNED_ATTR __attribute__((aligned(4)))
+
+#endif
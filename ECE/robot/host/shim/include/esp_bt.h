@@ -0,0 +1,6 @@
+#ifndef ESP_BT_H
+#define ESP_BT_H
+
+// No controller on the host; ble_host_sim.c stands in for the BLE host glue
+
+#endif
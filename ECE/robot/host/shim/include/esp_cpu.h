@@ -0,0 +1,16 @@
+#ifndef ESP_CPU_H
+#define ESP_CPU_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Nanoseconds of CLOCK_MONOTONIC, wrapping like the 32-bit CCOUNT register.
+// sdkconfig.h sets CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ to 1000 to match.
+static inline uint32_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+#endif
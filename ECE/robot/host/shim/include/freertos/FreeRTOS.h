@@ -0,0 +1,64 @@
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+
+// -------------------------------------------------------------------------
+// FreeRTOS on pthreads (../../freertos.c). Each task is a thread; core
+// and priority are kept for xPortGetCoreID() / uxTaskPriorityGet() only,
+// the host scheduler decides who runs. A critical section is one
+// recursive mutex per portMUX_TYPE, taken from tasks and from esp_timer
+// callbacks alike, so it excludes what it excludes on the target.
+// -------------------------------------------------------------------------
+
+typedef int32_t  BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t  StackType_t;               // Bytes, as ESP-IDF counts stacks
+
+#define pdFALSE             ((BaseType_t)0)
+#define pdTRUE              ((BaseType_t)1)
+#define pdFAIL              pdFALSE
+#define pdPASS              pdTRUE
+#define errQUEUE_EMPTY      ((BaseType_t)0)
+#define errQUEUE_FULL       ((BaseType_t)0)
+
+#define portMAX_DELAY       ((TickType_t)0xffffffffUL)
+#define portNUM_PROCESSORS  2
+#define configTICK_RATE_HZ  CONFIG_FREERTOS_HZ
+#define configMAX_PRIORITIES 25
+#define configRUN_TIME_COUNTER_TYPE uint32_t
+#define portTICK_PERIOD_MS  ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000U))
+#define pdTICKS_TO_MS(t)    ((uint32_t)(((uint64_t)(t) * 1000U) / configTICK_RATE_HZ))
+#define tskNO_AFFINITY      ((BaseType_t)0x7FFFFFFF)
+
+typedef struct {
+    pthread_mutex_t m;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP }
+
+#define portENTER_CRITICAL(mux)         pthread_mutex_lock(&(mux)->m)
+#define portEXIT_CRITICAL(mux)          pthread_mutex_unlock(&(mux)->m)
+#define portENTER_CRITICAL_ISR(mux)     portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux)      portEXIT_CRITICAL(mux)
+#define portENTER_CRITICAL_SAFE(mux)    portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_SAFE(mux)     portEXIT_CRITICAL(mux)
+#define taskENTER_CRITICAL(mux)         portENTER_CRITICAL(mux)
+#define taskEXIT_CRITICAL(mux)          portEXIT_CRITICAL(mux)
+#define taskENTER_CRITICAL_ISR(mux)     portENTER_CRITICAL(mux)
+#define taskEXIT_CRITICAL_ISR(mux)      portEXIT_CRITICAL(mux)
+
+#define portYIELD_FROM_ISR(...)         ((void)0)
+#define portYIELD()                     sched_yield()
+
+BaseType_t xPortGetCoreID(void);
+BaseType_t xPortInIsrContext(void);         // True on the esp_timer / GPIO ISR threads
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef EVENT_GROUPS_H
+#define EVENT_GROUPS_H
+
+#include "FreeRTOS.h"
+
+// Included by Robot_BLE.h; the firmware keeps no event group
+typedef uint32_t EventBits_t;
+
+#endif
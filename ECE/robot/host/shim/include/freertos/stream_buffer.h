@@ -0,0 +1,23 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include "FreeRTOS.h"
+
+typedef struct host_sbuf *StreamBufferHandle_t;
+
+typedef struct {
+    uint8_t opaque[1];
+} StaticStreamBuffer_t;
+
+// One writer and one reader at a time, as on the target; a receive wakes
+// once trigger bytes are in (or the first byte with trigger <= 1)
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger);
+StreamBufferHandle_t xStreamBufferCreateStatic(size_t size, size_t trigger, uint8_t *storage,
+                                               StaticStreamBuffer_t *buf);
+size_t xStreamBufferSend(StreamBufferHandle_t sb, const void *data, size_t len, TickType_t ticks);
+size_t xStreamBufferSendFromISR(StreamBufferHandle_t sb, const void *data, size_t len, BaseType_t *woken);
+size_t xStreamBufferReceive(StreamBufferHandle_t sb, void *out, size_t len, TickType_t ticks);
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t sb);
+BaseType_t xStreamBufferReset(StreamBufferHandle_t sb);
+
+#endif
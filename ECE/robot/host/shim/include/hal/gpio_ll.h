@@ -0,0 +1,14 @@
+#ifndef HAL_GPIO_LL_H
+#define HAL_GPIO_LL_H
+
+#include <stdint.h>
+#include "soc/gpio_struct.h"
+#include "driver/gpio.h"
+
+static inline void gpio_ll_set_level(gpio_dev_t *hw, uint32_t gpio, uint32_t level)
+{
+    (void)hw;
+    gpio_set_level((gpio_num_t)gpio, level);
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+// Host build (../../Makefile): the esp32dev sdkconfig values the firmware
+// reads, except the CPU clock. esp_cpu_get_cycle_count() counts nanoseconds
+// here, so a "1000 MHz" clock keeps every cycles -> time conversion right.
+
+#define CONFIG_IDF_TARGET "host"
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 1000
+#define CONFIG_BT_BLUEDROID_PINNED_TO_CORE 0
+#define CONFIG_FREERTOS_USE_TRACE_FACILITY 0    // No per-task run time on the host
+#define CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS 0
+#define CONFIG_MBEDTLS_HARDWARE_AES 0
+#define CONFIG_PM_ENABLE 0
+#define CONFIG_PM_PROFILING 0
+
+#endif
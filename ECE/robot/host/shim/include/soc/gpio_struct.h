@@ -0,0 +1,27 @@
+#ifndef SOC_GPIO_STRUCT_H
+#define SOC_GPIO_STRUCT_H
+
+#include <stdint.h>
+
+// The write-1-to-set / write-1-to-clear registers of both banks. The host
+// has no register to act on a store, so GPIO is a call: each access first
+// folds the stores made so far into the pin levels (drivers.c), and a store
+// is seen by the next access or read (gpio_get_level(), the step counters).
+// Two tasks storing the same register at once can still lose one.
+typedef struct {
+    volatile uint32_t out_w1ts;
+    volatile uint32_t out_w1tc;
+    union {
+        struct { volatile uint32_t data : 8; };
+        volatile uint32_t val;
+    } out1_w1ts;
+    union {
+        struct { volatile uint32_t data : 8; };
+        volatile uint32_t val;
+    } out1_w1tc;
+} gpio_dev_t;
+
+gpio_dev_t *gpio_regs(void);
+#define GPIO (*gpio_regs())
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef UNITY_H
+#define UNITY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+// The part of Unity test_perf.c uses, with Unity's output lines
+// (file:line:test:PASS / FAIL: message, then the totals). A failed
+// assertion ends the test case, as in Unity.
+
+void setUp(void);
+void tearDown(void);
+
+extern jmp_buf unity_abort;
+void unity_begin(void);
+int  unity_end(void);                       // Failures
+int  unity_failures(void);                  // Of the last run, for main()
+void unity_run(void (*fn)(void), const char *name, int line);
+void unity_fail(int line, const char *msg, const char *detail) __attribute__((noreturn));
+void unity_fail_int(int line, const char *what, long long expected, long long actual, const char *msg)
+    __attribute__((noreturn));
+
+#define UNITY_BEGIN()       unity_begin()
+#define UNITY_END()         unity_end()
+#define RUN_TEST(fn)        unity_run((fn), #fn, __LINE__)
+
+#define TEST_ASSERT_EQUAL_INT_MESSAGE(e, a, m) do {                                                 \
+        long long e_ = (e), a_ = (a);                                                              \
+        if (e_ != a_) unity_fail_int(__LINE__, "Expected", e_, a_, (m));                          \
+    } while (0)
+#define TEST_ASSERT_EQUAL_INT(e, a)             TEST_ASSERT_EQUAL_INT_MESSAGE((e), (a), NULL)
+#define TEST_ASSERT_GREATER_THAN_INT_MESSAGE(t, a, m) do {                                          \
+        long long t_ = (t), a_ = (a);                                                              \
+        if (!(a_ > t_)) unity_fail_int(__LINE__, "Expected greater than", t_, a_, (m));           \
+    } while (0)
+#define TEST_ASSERT_GREATER_THAN_INT(t, a)      TEST_ASSERT_GREATER_THAN_INT_MESSAGE((t), (a), NULL)
+#define TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(t, a, m) do {                                      \
+        uint32_t t_ = (t), a_ = (a);                                                               \
+        if (!(a_ <= t_)) unity_fail_int(__LINE__, "Expected less than or equal to", t_, a_, (m)); \
+    } while (0)
+#define TEST_ASSERT_LESS_OR_EQUAL_UINT32(t, a)  TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE((t), (a), NULL)
+#define TEST_ASSERT_NOT_NULL_MESSAGE(p, m) do {                                                     \
+        if ((p) == NULL) unity_fail(__LINE__, "Expected Non-NULL", (m));                           \
+    } while (0)
+#define TEST_ASSERT_NOT_NULL(p)                 TEST_ASSERT_NOT_NULL_MESSAGE((p), NULL)
+#define TEST_ASSERT_EQUAL_MEMORY(e, a, n) do {                                                      \
+        if (memcmp((e), (a), (n)) != 0) unity_fail(__LINE__, "Memory Mismatch", NULL);            \
+    } while (0)
+#define TEST_ASSERT_TRUE(c) do {                                                                    \
+        if (!(c)) unity_fail(__LINE__, "Expected TRUE Was FALSE", NULL);                           \
+    } while (0)
+
+#endif
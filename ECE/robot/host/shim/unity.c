@@ -0,0 +1,58 @@
+// unity.c
+//
+// The Unity runner calls test_perf.c makes, for the host build (unity.h)
+
+#include "unity.h"
+
+#include <stdio.h>
+
+jmp_buf unity_abort;
+
+static const char *cur_name;
+static int         tests, failures;
+
+void unity_begin(void)
+{
+    tests = failures = 0;
+}
+
+int unity_end(void)
+{
+    printf("\n-----------------------\n%d Tests %d Failures 0 Ignored\n%s\n", tests, failures,
+           failures ? "FAIL" : "OK");
+    fflush(stdout);
+    return failures;
+}
+
+int unity_failures(void)
+{
+    return failures;
+}
+
+void unity_run(void (*fn)(void), const char *name, int line)
+{
+    cur_name = name;
+    tests++;
+    if (setjmp(unity_abort) == 0) {
+        setUp();
+        fn();
+        tearDown();
+        printf("test_perf.c:%d:%s:PASS\n", line, name);
+    }
+    fflush(stdout);
+}
+
+void unity_fail(int line, const char *msg, const char *detail)
+{
+    failures++;
+    printf("test_perf.c:%d:%s:FAIL: %s%s%s\n", line, cur_name, msg, detail ? ". " : "", detail ? detail : "");
+    longjmp(unity_abort, 1);
+}
+
+void unity_fail_int(int line, const char *what, long long expected, long long actual, const char *msg)
+{
+    failures++;
+    printf("test_perf.c:%d:%s:FAIL: %s %lld Was %lld%s%s\n", line, cur_name, what, expected, actual,
+           msg ? ". " : "", msg ? msg : "");
+    longjmp(unity_abort, 1);
+}
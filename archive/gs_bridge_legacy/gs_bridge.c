@@ -31,6 +31,7 @@
 #include <unistd.h>                     // read(), write(), close(), unlink()
 
 #include "cJSON.h"                      // cJSON library header (vendored)
+#include "../ECE/robot/components/cmd_codec/cmd_codec.h" // Shared word layouts
 // 004B1224B0A6
 // ------------------------- Defaults / Config -------------------------
 
@@ -43,27 +44,8 @@
 #define UART_PREAMBLE_1 0x55                   // Frame sync byte 1
 #define UART_PAYLOAD_LEN 8                     // Payload bytes (64-bit word)
 
-// ------------------------- Type mapping (5-bit) -------------------------
-// These values match your spec table (type in bits 0..4 of the 64-bit word)
-
-typedef enum {
-  TYPE_C   = 0x01,                             // Control
-  TYPE_P   = 0x02,                             // Pose
-  TYPE_S   = 0x03,                             // System
-  TYPE_Q   = 0x04,                             // Query
-  TYPE_SR  = 0x05,                             // Status report
-  TYPE_HR  = 0x06,                             // Health report
-  TYPE_A   = 0x07,                             // Ack
-  TYPE_HPR = 0x08                              // High priority report
-} MsgType5;
-
 // ------------------------- Bit helpers -------------------------
 
-// Extract nbits starting at bit position lo from a 64-bit word, returning up to 32 bits.
-static inline uint32_t get_bits_u32(uint64_t w, int lo, int nbits) {
-  return (uint32_t)((w >> lo) & ((1ULL << nbits) - 1ULL)); // shift down and mask
-}
-
 // Convert uint64_t to 8 bytes big-endian (network byte order).
 static void u64_to_be(uint64_t w, uint8_t out[8]) {
   for (int i = 0; i < 8; i++) {                // For each byte
@@ -93,124 +75,38 @@ static void dump_hex(const char *tag, const uint8_t *b, size_t n) {
   printf("\n");
 }
 // ------------------------- Packers (Node->Robot) -------------------------
-// These pack JSON fields into the 64-bit layouts from your spec.
-
-// Pack Control (C):
-// bits 0..4  type
-// bit 5      W
-// bit 6      A
-// bit 7      S
-// bit 8      d
-// bits 9..15 speed (7 bits)
-// bits 16..17 priority level (2 bits)
+// Thin wrappers over the shared codec (cmd_codec.h): the field table there is
+// the one the robot firmware decodes with, so layouts cannot drift.
+
+// Control (C): W/A/S/D = forward/left/backward/right, speed 0..100
 static inline uint64_t pack_C(uint8_t w, uint8_t a, uint8_t s, uint8_t d,
                               uint8_t speed_0_100, uint8_t pl_0_3) {
-  uint64_t word = 0;                              // Start empty 64-bit word
-  word |= ((uint64_t)(TYPE_C & 0x1F)) << 0;       // Put 5-bit type into bits 0..4
-  word |= ((uint64_t)(w & 1)) << 5;               // forward into bit 5
-  word |= ((uint64_t)(a & 1)) << 6;               // backward into bit 6
-  word |= ((uint64_t)(s & 1)) << 7;               // left into bit 7
-  word |= ((uint64_t)(d & 1)) << 8;               // right into bit 8
-  word |= ((uint64_t)(speed_0_100 & 0x7F)) << 9;  // speed into bits 9..15 (7 bits)
-  word |= ((uint64_t)(pl_0_3 & 0x03)) << 16;      // priority into bits 16..17 (2 bits)
-
-  return word;                                    // Return packed word
+  cmd_ctrl_t c = { .pl = pl_0_3, .type = CONTROL_CMD, .w = w, .a = a, .s = s, .d = d,
+                   .speed = speed_0_100 };
+  return cmd_ctrl_pack(&c);
 }
 
-// Pack Pose (P):
-// bits 0..4  type
-// bits 5..8  instruction (4-bit opcode, TBD mapping)
-// bits 9..10 priority level
-// bits 11..22 id (12 bits)
+// Pose (P): the protocol has no pose command; the 4-bit instruction maps onto
+// the arm direction bits (bit 0 up, 1 down, 2 left, 3 right)
 static inline uint64_t pack_P(uint8_t instr_0_15, uint8_t pl_0_3, uint16_t id_0_2047) {
-  uint64_t w = 0;                              // Start empty
-  w |= ((uint64_t)(TYPE_P & 0x1F)) << 0;       // Type bits
-  w |= ((uint64_t)(instr_0_15 & 0x0F)) << 5;   // Instruction nibble
-  w |= ((uint64_t)(pl_0_3 & 0x03)) << 9;       // Priority (2 bits)
-  w |= ((uint64_t)(id_0_2047 & 0x0FFF)) << 11; // ID (12 bits reserved)
-  return w;                                    // Return packed word
+  cmd_arm_t c = { .pl = pl_0_3, .type = ARM_CMD, .up = instr_0_15 & 1, .down = (instr_0_15 >> 1) & 1,
+                  .left = (instr_0_15 >> 2) & 1, .right = (instr_0_15 >> 3) & 1, .id = id_0_2047 };
+  return cmd_arm_pack(&c);
 }
 
-// Pack System (S):
-// bits 0..4   type
-// bits 5..8   instruction (4-bit opcode)
-// bits 9..18  AC (10 bits)
-// bits 19..20 priority
-// bits 21..31 id (11 bits)
-// bits 32..63 instruction_specific (32 bits)
+// System (S): instruction, auth code, id, 32-bit instruction-specific payload
 static inline uint64_t pack_S(uint8_t instr_0_15, uint16_t ac_0_1023, uint8_t pl_0_3,
                               uint16_t id_0_2047, uint32_t instr_spec) {
-  uint64_t w = 0;                              // Start empty
-  w |= ((uint64_t)(TYPE_S & 0x1F)) << 0;       // Type
-  w |= ((uint64_t)(instr_0_15 & 0x0F)) << 5;   // Instruction nibble
-  w |= ((uint64_t)(ac_0_1023 & 0x03FF)) << 9;  // AC 10-bit field
-  w |= ((uint64_t)(pl_0_3 & 0x03)) << 19;      // Priority 2-bit field
-  w |= ((uint64_t)(id_0_2047 & 0x07FF)) << 21; // ID 11-bit field
-  w |= ((uint64_t)instr_spec) << 32;           // Instruction-specific 32-bit payload
-  return w;                                    // Return packed word
+  cmd_sys_t c = { .pl = pl_0_3, .type = System_CMD, .instruction = instr_0_15, .ac = ac_0_1023,
+                  .id = id_0_2047, .specific = instr_spec };
+  return cmd_sys_pack(&c);
 }
 
-// Pack Query (Q):
-// bits 0..4   type
-// bits 5..8   instruction (what to query, 4-bit)
-// bits 9..10  priority
-// bits 11..22 id
-// bit 23      report_on/off
+// Query (Q): what to query, id, report on/off (r)
 static inline uint64_t pack_Q(uint8_t instr_0_15, uint8_t pl_0_3, uint16_t id_0_2047, uint8_t report_on) {
-  uint64_t w = 0;                              // Start empty
-  w |= ((uint64_t)(TYPE_Q & 0x1F)) << 0;       // Type
-  w |= ((uint64_t)(instr_0_15 & 0x0F)) << 5;   // Instruction nibble
-  w |= ((uint64_t)(pl_0_3 & 0x03)) << 9;       // Priority
-  w |= ((uint64_t)(id_0_2047 & 0x0FFF)) << 11; // ID
-  w |= ((uint64_t)(report_on & 1)) << 23;      // Report on/off bit
-  return w;                                    // Return packed word
-}
-
-// ------------------------- Unpackers (Robot->Node) -------------------------
-// Decode 64-bit words from ESP32 back into values we can send up to Node as JSON.
-
-typedef struct {
-  uint8_t speed;                               // Bits 5..11
-  uint8_t state;                               // Bit 12 (interpretation TBD)
-  uint8_t motor;                               // Bit 13 (interpretation TBD)
-  uint8_t robot_id;                            // Bits 14..15
-  uint32_t curr_pos;                           // Bits 16..46 (31 bits)
-} StatusSR;
-
-// Unpack SR (Status Report) word into struct.
-static int unpack_SR(uint64_t w, StatusSR *out) {
-  uint8_t type = (uint8_t)get_bits_u32(w, 0, 5);  // Read 5-bit type
-  if (type != TYPE_SR) return -1;                 // Not SR -> error
-
-  out->speed = (uint8_t)get_bits_u32(w, 5, 7);    // 7-bit speed
-  out->state = (uint8_t)get_bits_u32(w, 12, 1);   // 1-bit state
-  out->motor = (uint8_t)get_bits_u32(w, 13, 1);   // 1-bit motor status
-  out->robot_id = (uint8_t)get_bits_u32(w, 14, 2);// 2-bit robot id
-
-  // Curr_Pos is 31 bits starting at bit 16.
-  out->curr_pos = (uint32_t)((w >> 16) & ((1ULL << 31) - 1ULL));
-
-  return 0;                                       // Success
-}
-
-typedef struct {
-  uint8_t battery;                              // Bits 5..11
-  uint8_t signal;                               // Bits 12..17
-  uint8_t security;                             // Bits 18..19
-  uint16_t name_id;                             // Bits 20..31 (index into name table)
-} HealthHR;
-
-// Unpack HR (Health Report) word into struct.
-static int unpack_HR(uint64_t w, HealthHR *out) {
-  uint8_t type = (uint8_t)get_bits_u32(w, 0, 5); // Read type
-  if (type != TYPE_HR) return -1;                // Not HR -> error
-
-  out->battery  = (uint8_t)get_bits_u32(w, 5, 7);  // battery field
-  out->signal   = (uint8_t)get_bits_u32(w, 12, 6); // signal field
-  out->security = (uint8_t)get_bits_u32(w, 18, 2); // security field
-  out->name_id  = (uint16_t)get_bits_u32(w, 20, 12);// name id index
-
-  return 0;                                      // Success
+  cmd_query_t c = { .pl = pl_0_3, .type = Query_CMD, .instruction = instr_0_15, .id = id_0_2047,
+                    .r = report_on };
+  return cmd_query_pack(&c);
 }
 
 // ------------------------- UART open/config -------------------------
@@ -651,41 +547,55 @@ static int handle_node_json(int uart_fd, int uds_fd, const char *json_str) {
 // Convert incoming robot u64 into JSON string and send back to Node via UDS.
 
 static void robot_word_to_node_json(int uds_fd, uint64_t w) {
-  uint8_t type = (uint8_t)get_bits_u32(w, 0, 5);           // Extract 5-bit type
-
-  if (type == TYPE_SR) {                                   // Status report
-    StatusSR sr;                                           // Parsed SR struct
-    if (unpack_SR(w, &sr) == 0) {                          // If decode ok
-      char msg[256];                                       // Output JSON buffer
+  char msg[256];                                           // Output JSON buffer
+
+  switch (cmd_word_type(w)) {
+    case ROBOT_UPDATE_CMD:                                 // NAV / POSE / INERT by part
+      if (cmd_nav_get_part(w) == 0) {
+        cmd_nav_t v;
+        cmd_nav_unpack(w, &v);
+        snprintf(msg, sizeof(msg), "{\"type\":\"NAV\",\"px\":%d,\"py\":%d,\"pz\":%d,\"speed\":%u}",
+                 (int)v.pos_x, (int)v.pos_y, (int)v.pos_z, (unsigned)v.speed);
+      } else if (cmd_nav_get_part(w) == 1) {
+        cmd_pose_t v;
+        cmd_pose_unpack(w, &v);
+        snprintf(msg, sizeof(msg), "{\"type\":\"POSE\",\"yaw\":%u,\"pitch\":%d,\"roll\":%d}",
+                 (unsigned)v.yaw, (int)v.pitch, (int)v.roll);
+      } else if (cmd_nav_get_part(w) == 2) {
+        cmd_inert_t v;
+        cmd_inert_unpack(w, &v);
+        snprintf(msg, sizeof(msg),
+                 "{\"type\":\"INERT\",\"ax\":%d,\"ay\":%d,\"az\":%d,\"gx\":%d,\"gy\":%d,\"gz\":%d}",
+                 (int)v.accel_x, (int)v.accel_y, (int)v.accel_z,
+                 (int)v.gyro_x, (int)v.gyro_y, (int)v.gyro_z);
+      } else {
+        return;
+      }
+      break;
+    case HEALTH_CMD: {                                     // Health report
+      cmd_health_t v;
+      cmd_health_unpack(w, &v);
       snprintf(msg, sizeof(msg),
-        "{\"type\":\"SR\",\"speed\":%u,\"state\":%u,\"motor\":%u,\"robot_id\":%u,\"curr_pos\":%u}",
-        sr.speed, sr.state, sr.motor, sr.robot_id, sr.curr_pos);
-      uds_send_json(uds_fd, msg);                          // Send JSON to Node
+               "{\"type\":\"HR\",\"unchanged\":%u,\"battery\":%u,\"security\":%u,\"motor_enabled\":%u,"
+               "\"arm_enabled\":%u,\"tx_queue\":%u,\"tx_drops\":%u}",
+               (unsigned)v.unchanged, (unsigned)v.battery, (unsigned)v.sec_en, (unsigned)v.motor_en,
+               (unsigned)v.arm_en, (unsigned)v.tx_depth, (unsigned)v.tx_drops);
+      break;
     }
-  } else if (type == TYPE_HR) {                            // Health report
-    HealthHR hr;                                           // Parsed HR struct
-    if (unpack_HR(w, &hr) == 0) {                          // If decode ok
-      char msg[256];                                       // Output JSON
-      snprintf(msg, sizeof(msg),
-        "{\"type\":\"HR\",\"battery\":%u,\"signal\":%u,\"security\":%u,\"name_id\":%u}",
-        hr.battery, hr.signal, hr.security, hr.name_id);
-      uds_send_json(uds_fd, msg);                          // Send to Node
+    case ACK_CMD: {                                        // Ack
+      cmd_ack_t v;
+      cmd_ack_unpack(w, &v);
+      snprintf(msg, sizeof(msg), "{\"type\":\"ACK\",\"id\":%u,\"result\":%u,\"info\":%llu}",
+               (unsigned)v.id, (unsigned)v.result_code, (unsigned long long)v.instruction_specific);
+      break;
     }
-  } else if (type == TYPE_A) {                             // Ack
-    // TODO: once you finalize Ack layout, unpack it here. For now forward raw.
-    char msg[128];
-    snprintf(msg, sizeof(msg), "{\"type\":\"A\",\"raw_u64\":\"%llu\"}",
-             (unsigned long long)w);
-    uds_send_json(uds_fd, msg);
-  } else if (type == TYPE_HPR) {                           // High priority report
-    // TODO: once you finalize HPR layout, unpack it here. For now forward raw.
-    char msg[128];
-    snprintf(msg, sizeof(msg), "{\"type\":\"HPR\",\"raw_u64\":\"%llu\"}",
-             (unsigned long long)w);
-    uds_send_json(uds_fd, msg);
-  } else {
-    // Unknown type -> ignore for now (or forward raw if you want).
+    case HPR_CMD:                                          // High priority report
+      snprintf(msg, sizeof(msg), "{\"type\":\"HPR\",\"alert\":%u}", (unsigned)cmd_hpr_get_alert_type(w));
+      break;
+    default:
+      return;                                              // Unknown type -> ignore
   }
+  uds_send_json(uds_fd, msg);                              // Send JSON to Node
 }
 
 // ------------------------- UDS server setup -------------------------
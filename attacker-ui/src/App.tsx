@@ -1,11 +1,13 @@
 import { useCallback, useEffect, useMemo, useRef, useState } from 'react';
 import { useWebSocket } from './hooks/useWebSocket';
+import { useSniffWorker } from './hooks/useSniffWorker';
 import { ConnectionStatusPanel } from './components/ConnectionStatus';
 import { PacketLog } from './components/PacketLog';
 import { AttackPanel } from './components/AttackPanel';
 import { ReplayPanel } from './components/ReplayPanel';
 import { SettingsPanel } from './components/SettingsPanel';
 import type { PacketEntry } from './components/PacketLog';
+import { RingLog } from './utils/ringLog';
 import type { Preset } from './components/SettingsPanel';
 
 const WS_URL = import.meta.env.VITE_WS_URL || 'ws://localhost:8080';
@@ -30,10 +32,14 @@ function loadPresets(): Preset[] {
 
 let packetCounter = 0;
 
+// Sniffed traffic can arrive far faster than the screen refreshes: packets go
+// into a bounded ring and the logs re-render once per frame, windowed
+const PACKET_LOG_CAPACITY = 5000;
+
 type RightTab = 'attack' | 'settings';
 
 function App() {
-  const [packets, setPackets] = useState<PacketEntry[]>([]);
+  const [packets] = useState(() => new RingLog<PacketEntry>(PACKET_LOG_CAPACITY));
   const packetCountRef = useRef(0);
   const [presets, setPresets] = useState<Preset[]>(loadPresets);
   const [rightTab, setRightTab] = useState<RightTab>('attack');
@@ -49,16 +55,17 @@ function App() {
     return map;
   }, [presets]);
 
-  const addPacket = useCallback((payload: string, direction: PacketEntry['direction']) => {
+  const addPacket = useCallback((payload: string, direction: PacketEntry['direction'], decoded?: string) => {
     packetCountRef.current += 1;
     const entry: PacketEntry = {
       id: packetCounter++,
       payload,
       timestamp: new Date().toLocaleTimeString(),
       direction,
+      decoded,
     };
-    setPackets((prev) => [entry, ...prev].slice(0, 100));
-  }, []);
+    packets.push(entry);
+  }, [packets]);
 
   const { status, sendRaw, lastError } = useWebSocket(WS_URL, {
     onMessage: (data) => {
@@ -75,16 +82,10 @@ function App() {
     },
   });
 
-  useWebSocket(SNIFFER_WS_URL, {
-    onMessage: (data) => {
-      try {
-        const pkt = JSON.parse(data);
-        if (pkt.type === 'sniffed_packet' && pkt.value) {
-          addPacket(`[Frame ${pkt.frame}] ${pkt.info} | ${pkt.value}`, 'sniffed');
-        }
-      } catch {
-        /* ignore non-JSON */
-      }
+  // Sniffed traffic is ingested and decoded in a worker; it arrives here in batches
+  useSniffWorker(SNIFFER_WS_URL, {
+    onBatch: (batch) => {
+      for (const pkt of batch) addPacket(pkt.payload, 'sniffed', pkt.decoded || undefined);
     },
   });
 
@@ -178,7 +179,7 @@ function App() {
             />
             <PacketLog
               packets={packets}
-              onClear={() => setPackets([])}
+              onClear={() => packets.clear()}
             />
           </div>
 
@@ -1,12 +1,16 @@
+import { RingLog, useRingLog } from '../utils/ringLog';
+import { VirtualList } from './VirtualList';
+
 export interface PacketEntry {
   id: number;
   payload: string;
   timestamp: string;
   direction: 'sniffed' | 'injected' | 'replayed';
+  decoded?: string;                                  // Robot fields of a sniffed value (sniff worker)
 }
 
 interface PacketLogProps {
-  packets: PacketEntry[];
+  packets: RingLog<PacketEntry>;
   onClear: () => void;
 }
 
@@ -16,7 +20,12 @@ const DIRECTION_STYLES: Record<PacketEntry['direction'], string> = {
   replayed: 'text-orange-400 bg-orange-900/30 border border-orange-800',
 };
 
+const ROW_HEIGHT = 28;
+const LIST_HEIGHT = 288;                             // Was max-h-72
+
 export function PacketLog({ packets, onClear }: PacketLogProps) {
+  useRingLog(packets);
+
   return (
     <div className="bg-gray-900 border border-red-800 rounded-xl shadow-lg shadow-red-950/50 p-6 flex flex-col min-h-0">
       <div className="flex items-center justify-between mb-4">
@@ -43,17 +52,29 @@ export function PacketLog({ packets, onClear }: PacketLogProps) {
       {packets.length === 0 ? (
         <p className="text-sm text-white italic">Awaiting packets…</p>
       ) : (
-        <div className="space-y-1.5 max-h-72 overflow-y-auto">
-          {packets.map((pkt) => (
-            <div key={pkt.id} className="flex gap-2 items-start text-sm">
-              <span className="text-white shrink-0 font-mono">{pkt.timestamp}</span>
-              <span className={`shrink-0 px-1.5 py-0.5 rounded text-xs font-medium ${DIRECTION_STYLES[pkt.direction]}`}>
-                {pkt.direction}
-              </span>
-              <code className="text-white font-mono break-all flex-1 min-w-0">{pkt.payload}</code>
-            </div>
-          ))}
-        </div>
+        <VirtualList
+          count={packets.length}
+          rowHeight={ROW_HEIGHT}
+          height={LIST_HEIGHT}
+          renderRow={(i) => {
+            const pkt = packets.at(i)!;
+            return (
+              <div className="flex gap-2 items-center text-sm h-full">
+                <span className="text-white shrink-0 font-mono">{pkt.timestamp}</span>
+                <span className={`shrink-0 px-1.5 py-0.5 rounded text-xs font-medium ${DIRECTION_STYLES[pkt.direction]}`}>
+                  {pkt.direction}
+                </span>
+                <code
+                  className="text-white font-mono truncate flex-1 min-w-0"
+                  title={pkt.decoded ? `${pkt.payload}\n${pkt.decoded}` : pkt.payload}
+                >
+                  {pkt.payload}
+                  {pkt.decoded && <span className="text-yellow-300 ml-2">{pkt.decoded}</span>}
+                </code>
+              </div>
+            );
+          }}
+        />
       )}
     </div>
   );
@@ -1,17 +1,26 @@
-import { useState } from 'react';
+import { useMemo, useState } from 'react';
 import type { PacketEntry } from './PacketLog';
+import { RingLog, useRingLog } from '../utils/ringLog';
+import { VirtualList } from './VirtualList';
 
 interface ReplayPanelProps {
-  packets: PacketEntry[];
+  packets: RingLog<PacketEntry>;
   onReplay: (payload: string) => void;
   isConnected: boolean;
 }
 
+const ROW_HEIGHT = 40;
+const LIST_HEIGHT = 192;                             // Was max-h-48
+
 export function ReplayPanel({ packets, onReplay, isConnected }: ReplayPanelProps) {
   const [selectedId, setSelectedId] = useState<number | null>(null);
   const [replayCount, setReplayCount] = useState(1);
 
-  const sniffed = packets.filter((p) => p.direction === 'sniffed');
+  const version = useRingLog(packets);
+  const sniffed = useMemo(
+    () => packets.toArray((p) => p.direction === 'sniffed'),
+    [packets, version]
+  );
   const selected = sniffed.find((p) => p.id === selectedId) ?? null;
 
   const handleReplay = () => {
@@ -31,22 +40,28 @@ export function ReplayPanel({ packets, onReplay, isConnected }: ReplayPanelProps
         <p className="text-sm text-white italic">No sniffed packets to replay yet.</p>
       ) : (
         <>
-          <div className="space-y-1.5 max-h-48 overflow-y-auto mb-4">
-            {sniffed.map((pkt) => (
-              <button
-                key={pkt.id}
-                onClick={() => setSelectedId(pkt.id)}
-                className={`w-full text-left px-3 py-2 rounded-lg text-sm font-mono transition-colors ${
-                  selectedId === pkt.id
-                    ? 'bg-red-800/60 border border-red-600 text-white'
-                    : 'bg-gray-800 border border-gray-700 text-white hover:border-red-700 hover:text-white'
-                }`}
-              >
-                <span className="text-white mr-2">{pkt.timestamp}</span>
-                <span className="truncate">{pkt.payload.slice(0, 60)}{pkt.payload.length > 60 ? '…' : ''}</span>
-              </button>
-            ))}
-          </div>
+          <VirtualList
+            className="mb-4"
+            count={sniffed.length}
+            rowHeight={ROW_HEIGHT}
+            height={LIST_HEIGHT}
+            renderRow={(i) => {
+              const pkt = sniffed[i];
+              return (
+                <button
+                  onClick={() => setSelectedId(pkt.id)}
+                  className={`w-full h-[34px] text-left px-3 py-1.5 rounded-lg text-sm font-mono truncate transition-colors ${
+                    selectedId === pkt.id
+                      ? 'bg-red-800/60 border border-red-600 text-white'
+                      : 'bg-gray-800 border border-gray-700 text-white hover:border-red-700 hover:text-white'
+                  }`}
+                >
+                  <span className="text-white mr-2">{pkt.timestamp}</span>
+                  <span>{pkt.payload.slice(0, 60)}{pkt.payload.length > 60 ? '…' : ''}</span>
+                </button>
+              );
+            }}
+          />
 
           <div className="flex items-center gap-3 mb-4">
             <label className="text-sm text-white shrink-0">Repeat</label>
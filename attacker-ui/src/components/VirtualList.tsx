@@ -0,0 +1,42 @@
+import { useState, type ReactNode } from 'react';
+
+interface VirtualListProps {
+  count: number;
+  rowHeight: number;                                 // px; every row is this tall
+  height: number;                                    // px of the scrolling viewport
+  renderRow: (index: number) => ReactNode;
+  overscan?: number;                                 // Rows mounted beyond each edge
+  className?: string;
+}
+
+/**
+ * Windowed list: only the rows in view (plus overscan) are mounted, inside a
+ * spacer as tall as the whole list, so a render costs the same with ten rows
+ * or ten thousand.
+ */
+export function VirtualList({ count, rowHeight, height, renderRow, overscan = 4, className = '' }: VirtualListProps) {
+  const [scrollTop, setScrollTop] = useState(0);
+  const first = Math.max(0, Math.floor(scrollTop / rowHeight) - overscan);
+  const last = Math.min(count, Math.ceil((scrollTop + height) / rowHeight) + overscan);
+
+  const rows: ReactNode[] = [];
+  for (let i = first; i < last; i++) {
+    rows.push(
+      <div key={i} className="absolute inset-x-0" style={{ top: i * rowHeight, height: rowHeight }}>
+        {renderRow(i)}
+      </div>
+    );
+  }
+
+  return (
+    <div
+      className={`overflow-y-auto ${className}`}
+      style={{ height }}
+      onScroll={(e) => setScrollTop(e.currentTarget.scrollTop)}
+    >
+      <div className="relative" style={{ height: count * rowHeight }}>
+        {rows}
+      </div>
+    </div>
+  );
+}
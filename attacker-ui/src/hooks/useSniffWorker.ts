@@ -0,0 +1,65 @@
+import { useEffect, useRef, useState } from 'react';
+import type { SniffWorkerIn, SniffWorkerOut } from '../workers/sniffWorker';
+
+export interface SniffedSummary {
+  frame: number;
+  payload: string;                                   // "[Frame N] info | value", as replayed
+  decoded: string;                                   // Robot fields from the wasm codec, '' if none
+}
+
+interface UseSniffWorkerOptions {
+  onBatch: (packets: SniffedSummary[], dropped: number) => void;
+}
+
+// Codec-only wasm module (encryption/wasm `make codec`), served from public/
+const CODEC_URL = `${import.meta.env.BASE_URL}wasm/cmd_codec.mjs`;
+
+const decoder = new TextDecoder();
+
+function unpackBatch(msg: Extract<SniffWorkerOut, { type: 'batch' }>): SniffedSummary[] {
+  const text = decoder.decode(msg.text);
+  const index = new Uint32Array(msg.index);
+  const out: SniffedSummary[] = new Array(msg.count);
+  let start = 0;
+  for (let i = 0; i < msg.count; i++) {
+    const payloadEnd = index[i * 3 + 1];
+    const decodedEnd = index[i * 3 + 2];
+    out[i] = {
+      frame: index[i * 3],
+      payload: text.slice(start, payloadEnd),
+      decoded: text.slice(payloadEnd, decodedEnd),
+    };
+    start = decodedEnd;
+  }
+  return out;
+}
+
+/**
+ * Sniffer WebSocket ingest and packet decoding in a Worker (sniffWorker.ts).
+ * The UI thread only sees one decoded batch per BATCH_MS, however fast the
+ * sniffer streams.
+ */
+export function useSniffWorker(url: string, { onBatch }: UseSniffWorkerOptions) {
+  const [connected, setConnected] = useState(false);
+  const [codecLoaded, setCodecLoaded] = useState(false);
+  const onBatchRef = useRef(onBatch);
+  onBatchRef.current = onBatch;
+
+  useEffect(() => {
+    const worker = new Worker(new URL('../workers/sniffWorker.ts', import.meta.url), { type: 'module' });
+    worker.onmessage = (event: MessageEvent<SniffWorkerOut>) => {
+      const msg = event.data;
+      if (msg.type === 'status') {
+        setConnected(msg.connected);
+        setCodecLoaded(msg.codec);
+      } else {
+        onBatchRef.current(unpackBatch(msg), msg.dropped);
+      }
+    };
+    const connect: SniffWorkerIn = { type: 'connect', url, codecUrl: CODEC_URL };
+    worker.postMessage(connect);
+    return () => worker.terminate();
+  }, [url]);
+
+  return { connected, codecLoaded };
+}
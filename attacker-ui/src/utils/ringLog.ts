@@ -0,0 +1,77 @@
+import { useSyncExternalStore } from 'react';
+
+/**
+ * Bounded log for high-rate streams. push() is O(1) and overwrites the
+ * oldest entry once the log is full. Subscribers hear about new entries at
+ * most once per animation frame, however many arrived in it, so a burst of
+ * WebSocket messages costs one React render, not one per message.
+ */
+export class RingLog<T> {
+  private buf: (T | undefined)[];
+  private head = 0;                                  // Next slot written
+  private count = 0;
+  private frame = 0;
+  private version = 0;
+  private listeners = new Set<() => void>();
+
+  constructor(readonly capacity: number) {
+    this.buf = new Array(capacity);
+  }
+
+  get length(): number {
+    return this.count;
+  }
+
+  /** i = 0 is the newest entry */
+  at(i: number): T | undefined {
+    if (i < 0 || i >= this.count) return undefined;
+    return this.buf[(this.head - 1 - i + this.capacity) % this.capacity];
+  }
+
+  push(item: T): void {
+    this.buf[this.head] = item;
+    this.head = (this.head + 1) % this.capacity;
+    if (this.count < this.capacity) this.count++;
+    this.schedule();
+  }
+
+  clear(): void {
+    this.buf = new Array(this.capacity);
+    this.head = 0;
+    this.count = 0;
+    this.schedule();
+  }
+
+  /** Newest first, optionally filtered: for views that need every entry */
+  toArray(keep?: (item: T) => boolean): T[] {
+    const out: T[] = [];
+    for (let i = 0; i < this.count; i++) {
+      const item = this.at(i) as T;
+      if (!keep || keep(item)) out.push(item);
+    }
+    return out;
+  }
+
+  subscribe = (listener: () => void): (() => void) => {
+    this.listeners.add(listener);
+    return () => {
+      this.listeners.delete(listener);
+    };
+  };
+
+  getVersion = (): number => this.version;
+
+  private schedule(): void {
+    if (this.frame) return;
+    this.frame = window.requestAnimationFrame(() => {
+      this.frame = 0;
+      this.version++;
+      this.listeners.forEach((listener) => listener());
+    });
+  }
+}
+
+/** Re-renders the caller once per frame in which the log changed */
+export function useRingLog<T>(log: RingLog<T>): number {
+  return useSyncExternalStore(log.subscribe, log.getVersion);
+}
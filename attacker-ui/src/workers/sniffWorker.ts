@@ -0,0 +1,154 @@
+/**
+ * Sniffer stream ingest off the UI thread. The worker owns the sniffer
+ * WebSocket (with the same reconnect backoff as useWebSocket), decodes each
+ * sniffed_packet value into robot command fields with the shared wasm codec
+ * (cmd_codec.mjs, built by encryption/wasm) and posts what arrived as one
+ * batch every BATCH_MS. A batch is packed text plus an index, both
+ * transferred, so the UI thread gets one message and no per-packet clones.
+ *
+ * Batch text per packet: payload, then the decoded fields (may be empty).
+ * index holds three u32 per packet: frame, payload end, decoded end (char
+ * offsets into the text).
+ */
+
+export type SniffWorkerIn = { type: 'connect'; url: string; codecUrl: string };
+
+export type SniffWorkerOut =
+  | { type: 'status'; connected: boolean; codec: boolean }
+  | { type: 'batch'; text: ArrayBuffer; index: ArrayBuffer; count: number; dropped: number };
+
+interface CmdCodecModule {
+  _describe_value(ptr: number, len: number): number;
+  _malloc(size: number): number;
+  HEAPU8: Uint8Array;
+  UTF8ToString(ptr: number): string;
+}
+
+const BATCH_MS = 50;
+const BATCH_MAX = 2000;                              // Oldest half dropped beyond this; the UI log is bounded anyway
+const VALUE_MAX = 256;                               // gs_sniff caps values at 256 bytes
+const INITIAL_RECONNECT_DELAY = 1000;
+const MAX_RECONNECT_DELAY = 30000;
+
+let codec: CmdCodecModule | null = null;
+let scratch = 0;                                     // VALUE_MAX bytes in the wasm heap
+let ws: WebSocket | null = null;
+let url = '';
+let shouldConnect = false;
+let reconnectDelay = INITIAL_RECONNECT_DELAY;
+let reconnectTimer: ReturnType<typeof setTimeout> | null = null;
+
+let pending: { frame: number; payload: string; decoded: string }[] = [];
+let dropped = 0;
+let flushTimer: ReturnType<typeof setTimeout> | null = null;
+
+const encoder = new TextEncoder();
+
+function post(msg: SniffWorkerOut, transfer: Transferable[] = []) {
+  self.postMessage(msg, { transfer });
+}
+
+async function loadCodec(codecUrl: string) {
+  try {
+    const mod = await import(/* @vite-ignore */ codecUrl);
+    codec = (await mod.default()) as CmdCodecModule;
+    scratch = codec._malloc(VALUE_MAX);
+  } catch (err) {
+    console.warn(`Sniff worker: ${codecUrl} not loaded, packets stay undecoded`, err);
+    codec = null;
+  }
+}
+
+function hexToHeap(hex: string): number {
+  const heap = codec!.HEAPU8;
+  const n = Math.min(hex.length >> 1, VALUE_MAX);
+  for (let i = 0; i < n; i++) heap[scratch + i] = parseInt(hex.slice(i * 2, i * 2 + 2), 16);
+  return n;
+}
+
+function decode(hex: string): string {
+  if (!codec || !scratch || !/^[0-9a-fA-F]*$/.test(hex)) return '';
+  const n = hexToHeap(hex);
+  return codec.UTF8ToString(codec._describe_value(scratch, n));
+}
+
+function flush() {
+  flushTimer = null;
+  if (pending.length === 0) return;
+
+  const index = new Uint32Array(pending.length * 3);
+  let text = '';
+  pending.forEach((p, i) => {
+    text += p.payload;
+    index[i * 3] = p.frame;
+    index[i * 3 + 1] = text.length;
+    text += p.decoded;
+    index[i * 3 + 2] = text.length;
+  });
+  const bytes = encoder.encode(text);
+  post({ type: 'batch', text: bytes.buffer, index: index.buffer, count: pending.length, dropped },
+       [bytes.buffer, index.buffer]);
+  pending = [];
+  dropped = 0;
+}
+
+function onMessage(data: string) {
+  let pkt: { type?: string; frame?: number | string; info?: string; value?: string };
+  try {
+    pkt = JSON.parse(data);
+  } catch {
+    return;                                          // Ignore non-JSON
+  }
+  if (pkt.type !== 'sniffed_packet' || !pkt.value) return;
+
+  if (pending.length >= BATCH_MAX) {
+    pending = pending.slice(BATCH_MAX / 2);
+    dropped += BATCH_MAX / 2;
+  }
+  pending.push({
+    frame: Number(pkt.frame) >>> 0,
+    payload: `[Frame ${pkt.frame}] ${pkt.info} | ${pkt.value}`,
+    decoded: decode(pkt.value),
+  });
+  if (flushTimer === null) flushTimer = setTimeout(flush, BATCH_MS);
+}
+
+function scheduleReconnect() {
+  const delay = Math.min(reconnectDelay, MAX_RECONNECT_DELAY);
+  reconnectDelay = Math.min(reconnectDelay * 2, MAX_RECONNECT_DELAY);
+  reconnectTimer = setTimeout(connect, delay);
+}
+
+function connect() {
+  if (!shouldConnect) return;
+  reconnectTimer = null;
+  let sock: WebSocket;
+  try {
+    sock = new WebSocket(url);
+  } catch {
+    scheduleReconnect();
+    return;
+  }
+  sock.onopen = () => {
+    reconnectDelay = INITIAL_RECONNECT_DELAY;
+    post({ type: 'status', connected: true, codec: codec !== null });
+  };
+  sock.onclose = () => {
+    if (ws !== sock) return;
+    post({ type: 'status', connected: false, codec: codec !== null });
+    if (shouldConnect) scheduleReconnect();
+  };
+  sock.onmessage = (event: MessageEvent) => {
+    if (typeof event.data === 'string') onMessage(event.data);
+  };
+  ws = sock;
+}
+
+// The hook terminates the worker to close it
+self.onmessage = async (event: MessageEvent<SniffWorkerIn>) => {
+  const msg = event.data;
+  if (!codec) await loadCodec(msg.codecUrl);
+  url = msg.url;
+  shouldConnect = true;
+  connect();
+};
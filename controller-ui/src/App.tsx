@@ -2,11 +2,12 @@
 //Reviewed by: Sai Raparla
 import { useEffect, useState, useCallback, useRef } from 'react';
 import { useWebSocket } from './hooks/useWebSocket';
-import { useHoldRepeater } from './hooks/useHoldRepeater';
+import { useInputSampler } from './hooks/useInputSampler';
 import { DirectionPad } from './components/DirectionPad';
 import { ArmPad } from './components/ArmPad';
 import { CommandPanel } from './components/CommandPanel';
 import { MessageLog } from './components/MessageLog';
+import type { MessageLogEntry } from './components/MessageLog';
 import {
   Direction,
   formatDirection,
@@ -20,23 +21,29 @@ import {
   keyToArmAction,
   armActionsToAxes,
 } from './utils/armDirection';
-import { buildControlMsg, buildArmControlMsg } from './utils/commands';
+import { buildControlMsg, buildArmControlMsg, buildDriveModeMsg, nextCommandId } from './utils/commands';
 import { useThemePreference } from './hooks/useThemePreference';
 import { ThemeToggle } from './components/ThemeToggle';
-
-interface MessageLogEntry {
-  payload: string;
-  timestamp: string;
-}
+import { RingLog } from './utils/ringLog';
 
 const WS_URL = import.meta.env.VITE_WS_URL || 'ws://localhost:3001';
+// Over wss:// the GS bridge seals commands toward the robot itself, so the
+// browser sends plaintext and skips its own GCM pass (VITE_GS_SEAL=0 to opt out).
+const GS_SEAL = WS_URL.startsWith('wss://') && import.meta.env.VITE_GS_SEAL !== '0';
+// Setpoint driving: a held vector is only re-sent to keep the robot's deadman
+// watchdog from stopping it; a release is sent the frame it happens
+const DRIVE_WATCHDOG_MS = 1500;
+const DRIVE_KEEPALIVE_MS = 500;
+// Every sent command is logged; the ring keeps the newest and the log view
+// re-renders at most once per frame
+const MESSAGE_LOG_CAPACITY = 1000;
 const ENCRYPTION_KEY = 'a1b2c3d4e5f6789012345678901234567890abcdef1234567890abcdef123456'; // 64 hex chars (32 bytes)
 
 function App() {
   const { isDark, toggleTheme } = useThemePreference();
   const [activeDirections, setActiveDirections] = useState<Set<Direction>>(new Set());
   const [activeArmActions, setActiveArmActions] = useState<Set<ArmAction>>(new Set());
-  const [messageLog, setMessageLog] = useState<MessageLogEntry[]>([]);
+  const [messageLog] = useState(() => new RingLog<MessageLogEntry>(MESSAGE_LOG_CAPACITY));
   const [repeatRate, setRepeatRate] = useState(50);
   const [controlSpeed, setControlSpeed] = useState(50);
   const [armSpeed, setArmSpeed] = useState(50);
@@ -46,14 +53,11 @@ function App() {
   const armPressedKeysRef = useRef<Set<string>>(new Set());
 
   const logMessage = useCallback((payload: string) => {
-    setMessageLog((prev) => [
-      { payload, timestamp: new Date().toLocaleTimeString() },
-      ...prev,
-    ].slice(0, 10));
-  }, []);
+    messageLog.push({ payload, timestamp: new Date().toLocaleTimeString() });
+  }, [messageLog]);
 
   const { status, sendMessage, lastError } = useWebSocket(WS_URL, {
-    encryptionKey: encryptionEnabled && ENCRYPTION_KEY ? ENCRYPTION_KEY : undefined,
+    encryptionKey: encryptionEnabled && !GS_SEAL && ENCRYPTION_KEY ? ENCRYPTION_KEY : undefined,
     onMessageSent: logMessage,
   });
 
@@ -64,7 +68,8 @@ function App() {
       axes.backward,
       axes.left,
       axes.right,
-      controlSpeed
+      controlSpeed,
+      nextCommandId()
     );
     sendMessage(msg);
   }, [sendMessage, controlSpeed]);
@@ -72,22 +77,30 @@ function App() {
   const sendActiveArmActions = useCallback((actions: Set<ArmAction>) => {
     const axes = armActionsToAxes(actions);
     const msg = buildArmControlMsg(
-      axes.U, axes.D, axes.L, axes.R, axes.In, axes.O, armSpeed
+      axes.U, axes.D, axes.L, axes.R, axes.In, axes.O, armSpeed, 0, nextCommandId()
     );
     sendMessage(msg);
   }, [sendMessage, armSpeed]);
 
-  useHoldRepeater(
-    activeDirections.size > 0,
-    () => sendActiveDirections(activeDirections),
-    repeatRate
-  );
+  // Every (re)connect puts the robot in setpoint mode before the first vector
+  useEffect(() => {
+    if (status === 'connected') sendMessage(buildDriveModeMsg(true, DRIVE_WATCHDOG_MS));
+  }, [status, sendMessage]);
 
-  useHoldRepeater(
-    activeArmActions.size > 0,
-    () => sendActiveArmActions(activeArmActions),
-    repeatRate
-  );
+  useInputSampler({
+    sample: () => ({
+      drive: activeDirections.size > 0
+        ? `${Object.values(directionsToControlAxes(activeDirections)).join('')}:${controlSpeed}`
+        : '',
+      arm: activeArmActions.size > 0
+        ? `${Object.values(armActionsToAxes(activeArmActions)).join('')}:${armSpeed}`
+        : '',
+    }),
+    sendDrive: () => sendActiveDirections(activeDirections),
+    sendArm: () => sendActiveArmActions(activeArmActions),
+    keepaliveMs: DRIVE_KEEPALIVE_MS,
+    armRepeatMs: repeatRate,
+  });
 
   const handleKeyDown = useCallback((e: KeyboardEvent) => {
     if (pressedKeysRef.current.has(e.key) || armPressedKeysRef.current.has(e.key)) return;
@@ -177,7 +190,7 @@ function App() {
   }, []);
 
   const handleArmReset = useCallback(() => {
-    const msg = buildArmControlMsg(0, 0, 0, 0, 0, 0, armSpeed, 1);
+    const msg = buildArmControlMsg(0, 0, 0, 0, 0, 0, armSpeed, 1, nextCommandId());
     sendMessage(msg);
   }, [sendMessage, armSpeed]);
 
@@ -190,6 +203,7 @@ function App() {
       PL: 1,
       ID: 28,
     });
+    sendMessage(buildDriveModeMsg(true, DRIVE_WATCHDOG_MS));
   }, [sendMessage]);
 
   const handleEncryptionChange = useCallback(
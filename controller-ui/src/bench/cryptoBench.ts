@@ -0,0 +1,134 @@
+/**
+ * crypto-bench.html: seal throughput of each provider in this browser.
+ *
+ * Every provider seals the same padded command into a RECORD_LEN-byte
+ * IV || CT || TAG record under a random key. Each row reports ops/s sealing
+ * one record per call (the send path) and ENCRYPT_BATCH_MAX per call (a
+ * queued burst), the record length, and whether WebCrypto opens the record,
+ * which checks the layout the bridge decrypts. The second table is the
+ * wasm module's own inner loop (aead_bench), without any JS per call.
+ */
+import {
+  ENCRYPT_BATCH_MAX,
+  NONCE_LEN,
+  RECORD_LEN,
+  loadWasmVariant,
+  wasmSimdSupported,
+  type WasmVariant,
+} from '../utils/encryption';
+import { webCryptoProvider, wasmVariantProvider, type SealProvider } from '../utils/sealProvider';
+
+const CMD = { type: 'control', x: 0.5, y: -0.25, rot: 0, seq: 1 };
+const INNER_ITERS = 20000;
+
+const $ = <T extends HTMLElement>(id: string) => document.getElementById(id) as T;
+
+function randomKeyHex(): string {
+  const key = crypto.getRandomValues(new Uint8Array(32));
+  return Array.from(key, (b) => b.toString(16).padStart(2, '0')).join('');
+}
+
+function fmt(n: number | null): string {
+  return n === null || n < 0 ? '-' : Math.round(n).toLocaleString();
+}
+
+function row(tbody: HTMLElement, cells: string[]): void {
+  const tr = document.createElement('tr');
+  for (const c of cells) {
+    const td = document.createElement('td');
+    td.textContent = c;
+    tr.appendChild(td);
+  }
+  tbody.appendChild(tr);
+}
+
+/** Records per second sealing `per` objects per call for `secs` seconds. */
+async function opsPerSec(p: SealProvider, per: number, secs: number): Promise<number | null> {
+  const objs = Array.from({ length: per }, () => CMD);
+  if (!(await p.sealRecords(objs))) return null;              // Warm-up, and fail fast
+  let done = 0;
+  const t0 = performance.now(), end = t0 + secs * 1000;
+  while (performance.now() < end) {
+    if (!(await p.sealRecords(objs))) return null;
+    done += per;
+  }
+  return (done * 1000) / (performance.now() - t0);
+}
+
+/** Opens rec with WebCrypto; null where WebCrypto is not available. */
+async function opens(rec: Uint8Array, keyHex: string): Promise<boolean | null> {
+  const subtle = globalThis.crypto?.subtle;
+  if (!subtle || !globalThis.isSecureContext) return null;
+  const raw = Uint8Array.from(keyHex.match(/../g)!, (h) => parseInt(h, 16));
+  const key = await subtle.importKey('raw', raw, { name: 'AES-GCM' }, false, ['decrypt']);
+  try {
+    const pt = new Uint8Array(
+      await subtle.decrypt({ name: 'AES-GCM', iv: rec.subarray(0, NONCE_LEN), tagLength: 128 }, key,
+                           rec.subarray(NONCE_LEN))
+    );
+    return JSON.parse(new TextDecoder().decode(pt).trimEnd()).seq === CMD.seq;
+  } catch {
+    return false;
+  }
+}
+
+async function providerRows(keyHex: string, secs: number): Promise<void> {
+  const tbody = $('rows');
+  const candidates: [string, () => Promise<SealProvider | null>][] = [
+    ['webcrypto', () => webCryptoProvider(keyHex)],
+    ['wasm-simd', () => wasmVariantProvider('simd', keyHex)],
+    ['wasm', () => wasmVariantProvider('base', keyHex)],
+  ];
+  for (const [name, make] of candidates) {
+    const p = await make();
+    if (!p) {
+      row(tbody, [name, 'unavailable', '', '', '']);
+      continue;
+    }
+    const rec = (await p.sealRecords([CMD]))?.[0];
+    const one = await opsPerSec(p, 1, secs);
+    const batch = await opsPerSec(p, ENCRYPT_BATCH_MAX, secs);
+    const ok = rec ? await opens(rec, keyHex) : false;
+    row(tbody, [
+      name,
+      fmt(one),
+      fmt(batch),
+      rec ? `${rec.length} B${rec.length === RECORD_LEN ? '' : ' (expected ' + RECORD_LEN + ')'}` : '-',
+      ok === null ? 'n/a' : ok ? 'yes' : 'NO',
+    ]);
+  }
+}
+
+async function innerRows(keyHex: string): Promise<void> {
+  const tbody = $('inner');
+  const variants: WasmVariant[] = wasmSimdSupported() ? ['simd', 'base'] : ['base'];
+  for (const v of variants) {
+    try {
+      const mod = await loadWasmVariant(v);
+      if (!mod._aead_bench) {
+        row(tbody, [v, 'no aead_bench export', '']);
+        continue;
+      }
+      mod.ccall('gcm_ctx_init', 'number', ['string'], [keyHex]);
+      mod.ccall('chacha_ctx_init', 'number', ['string'], [keyHex]);
+      row(tbody, [v, fmt(mod._aead_bench(1, INNER_ITERS)), fmt(mod._aead_bench(2, INNER_ITERS))]);
+    } catch {
+      row(tbody, [v, 'not built', '']);
+    }
+  }
+}
+
+$('run').addEventListener('click', async () => {
+  const button = $<HTMLButtonElement>('run');
+  const secs = Math.max(0.2, Number($<HTMLInputElement>('secs').value) || 1);
+  button.disabled = true;
+  $('rows').replaceChildren();
+  $('inner').replaceChildren();
+  const keyHex = randomKeyHex();
+  try {
+    await providerRows(keyHex, secs);
+    await innerRows(keyHex);
+  } finally {
+    button.disabled = false;
+  }
+});
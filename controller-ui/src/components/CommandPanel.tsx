@@ -82,7 +82,7 @@ export function CommandPanel({
 
       {/* Repeat rate */}
       <div className="border border-gray-200 rounded-lg p-4 mt-4 dark:border-slate-600">
-        <h3 className="text-sm font-semibold text-gray-600 mb-2 dark:text-gray-300">Repeat Rate</h3>
+        <h3 className="text-sm font-semibold text-gray-600 mb-2 dark:text-gray-300">Arm Repeat Rate</h3>
         <div className="flex gap-2">
           {REPEAT_RATE_OPTIONS.map((opt) => (
             <button
@@ -1,25 +1,43 @@
 //Author: Krish Shah
 //Reviewed by: Sai Raparla
+import { RingLog, useRingLog } from '../utils/ringLog';
+import { VirtualList } from './VirtualList';
+
+export interface MessageLogEntry {
+  payload: string;
+  timestamp: string;
+}
 
 interface MessageLogProps {
-  logs: { payload: string; timestamp: string }[];
+  logs: RingLog<MessageLogEntry>;
 }
 
+const ROW_HEIGHT = 20;
+const LIST_HEIGHT = 240;
+
 export function MessageLog({ logs }: MessageLogProps) {
+  useRingLog(logs);
+
   return (
     <div className="bg-white rounded-xl shadow-lg p-6 min-w-0 flex flex-col dark:bg-slate-800 dark:shadow-slate-900/50">
       <h2 className="text-lg font-semibold text-gray-700 dark:text-gray-200">Log</h2>
       {logs.length === 0 ? (
         <p className="text-xs text-gray-400 dark:text-gray-500">No messages</p>
       ) : (
-        <div className="space-y-1 overflow-y-auto flex-1">
-          {logs.map((log, idx) => (
-            <div key={idx} className="flex gap-2 text-xs items-start">
-              <span className="text-gray-400 shrink-0 dark:text-gray-500">{log.timestamp}</span>
-              <code className="text-gray-700 font-mono break-all flex-1 min-w-0 dark:text-gray-200">{log.payload}</code>
-            </div>
-          ))}
-        </div>
+        <VirtualList
+          count={logs.length}
+          rowHeight={ROW_HEIGHT}
+          height={LIST_HEIGHT}
+          renderRow={(i) => {
+            const log = logs.at(i)!;
+            return (
+              <div className="flex gap-2 text-xs items-center h-full">
+                <span className="text-gray-400 shrink-0 dark:text-gray-500">{log.timestamp}</span>
+                <code className="text-gray-700 font-mono truncate flex-1 min-w-0 dark:text-gray-200" title={log.payload}>{log.payload}</code>
+              </div>
+            );
+          }}
+        />
       )}
     </div>
   );
@@ -0,0 +1,65 @@
+import { useEffect, useRef } from 'react';
+
+/**
+ * Samples the combined drive (WASD) and arm input once per animation frame
+ * and sends commands from it:
+ *
+ *   drive  only when the vector (keys + speed) changes, releases included,
+ *          plus a keepalive every keepaliveMs while it is not the stop
+ *          vector. The robot runs in setpoint drive mode (DRIVE_MODE), so a
+ *          held vector stays applied and the keepalive only has to beat its
+ *          deadman watchdog; a hidden tab stops sampling and the robot stops.
+ *   arm    every arm command is one step of the arm, so a held arm input is
+ *          still sent every armRepeatMs, but aligned to frames and only while
+ *          something is held.
+ *
+ * Each send gets the next sequence id (nextCommandId) through the callbacks.
+ */
+export interface InputSample {
+  drive: string;                                     // Stable key of the drive vector, '' = stopped
+  arm: string;                                       // '' = nothing held
+}
+
+interface UseInputSamplerOptions {
+  sample: () => InputSample;
+  sendDrive: () => void;
+  sendArm: () => void;
+  keepaliveMs: number;
+  armRepeatMs: number;
+}
+
+export function useInputSampler({ sample, sendDrive, sendArm, keepaliveMs, armRepeatMs }: UseInputSamplerOptions) {
+  // Latest callbacks, so the frame loop never restarts on a re-render
+  const optsRef = useRef({ sample, sendDrive, sendArm, keepaliveMs, armRepeatMs });
+  optsRef.current = { sample, sendDrive, sendArm, keepaliveMs, armRepeatMs };
+
+  useEffect(() => {
+    let frame = 0;
+    let lastDrive = '';
+    let lastDriveAt = 0;
+    let lastArm = '';
+    let lastArmAt = 0;
+
+    const tick = (now: number) => {
+      const o = optsRef.current;
+      const { drive, arm } = o.sample();
+
+      if (drive !== lastDrive || (drive !== '' && now - lastDriveAt >= o.keepaliveMs)) {
+        o.sendDrive();
+        lastDrive = drive;
+        lastDriveAt = now;
+      }
+
+      if (arm !== '' && (arm !== lastArm || now - lastArmAt >= o.armRepeatMs)) {
+        o.sendArm();
+        lastArmAt = now;
+      }
+      lastArm = arm;
+
+      frame = window.requestAnimationFrame(tick);
+    };
+
+    frame = window.requestAnimationFrame(tick);
+    return () => window.cancelAnimationFrame(frame);
+  }, []);
+}
@@ -1,7 +1,15 @@
 //Author: Sai Raparla
 //Reviewed by: Krish Shah
 import { useEffect, useRef, useState, useCallback } from 'react';
-import { loadEncryptionModule, encryptJson } from '../utils/encryption';
+import { sealJson } from '../utils/sealProvider';
+import type { CommandMsg } from '../utils/commands';
+import {
+  WS_BIN_PROTOCOL,
+  WORD_ACK_LEN,
+  WORD_ACK_MAGIC,
+  encodeWordFrame,
+  wordFrameHex,
+} from '../utils/commandWord';
 
 export type ConnectionStatus = 'connecting' | 'connected' | 'reconnecting' | 'disconnected';
 
@@ -27,7 +35,8 @@ const HEARTBEAT_INTERVAL = 25000; // 25s
  * - Auto-reconnect with exponential backoff
  * - Message queue (sends when connection opens)
  * - Heartbeat ping to keep connection alive
- * - Optional AES-256-GCM encryption via WASM
+ * - Optional AES-256-GCM encryption (WebCrypto, else WASM; see sealProvider.ts)
+ * - Binary command words (rbw1 sub-protocol) for plaintext C/A when the server accepts it
  * - Automatic cleanup on visibility change and unmount
  */
 export function useWebSocket(url: string, options?: UseWebSocketOptions): UseWebSocketReturn {
@@ -42,6 +51,7 @@ export function useWebSocket(url: string, options?: UseWebSocketOptions): UseWeb
   const reconnectDelayRef = useRef<number>(INITIAL_RECONNECT_DELAY);
   const messageQueueRef = useRef<unknown[]>([]);
   const shouldConnectRef = useRef<boolean>(true);
+  const wordSeqRef = useRef<number>(0);
 
   // Send a message (queues if not connected, encrypts if encryptionKey is set)
   const sendMessage = useCallback((data: unknown) => {
@@ -49,8 +59,7 @@ export function useWebSocket(url: string, options?: UseWebSocketOptions): UseWeb
       try {
         let message: string;
         if (encryptionKey) {
-          await loadEncryptionModule();
-          const encrypted = encryptJson(payload as object, encryptionKey);
+          const encrypted = (await sealJson([payload as object], encryptionKey))?.[0];
           if (!encrypted) {
             setLastError('Encryption failed');
             return;
@@ -78,6 +87,19 @@ export function useWebSocket(url: string, options?: UseWebSocketOptions): UseWeb
       doSend(data);
     } else {
       try {
+        // rbw1: C/A go as an 8-byte word, everything else stays JSON
+        const ws = wsRef.current;
+        if (ws?.readyState === WebSocket.OPEN && ws.protocol === WS_BIN_PROTOCOL) {
+          const frame = encodeWordFrame(data as CommandMsg, wordSeqRef.current);
+          if (frame) {
+            wordSeqRef.current = (wordSeqRef.current + 1) & 0xffff;
+            ws.send(frame);
+            setLastError(null);
+            onMessageSent?.(`bin ${wordFrameHex(frame)}`);
+            return;
+          }
+        }
+
         const message = JSON.stringify(data);
         if (wsRef.current?.readyState === WebSocket.OPEN) {
           wsRef.current.send(message);
@@ -119,9 +141,8 @@ export function useWebSocket(url: string, options?: UseWebSocketOptions): UseWeb
         try {
           const ping = { type: 'ping' };
           if (key) {
-            loadEncryptionModule().then(() => {
-              const enc = encryptJson(ping, key);
-              if (enc) wsRef.current?.send(enc);
+            sealJson([ping], key).then((enc) => {
+              if (enc) wsRef.current?.send(enc[0]);
             });
           } else {
             wsRef.current.send(JSON.stringify(ping));
@@ -153,7 +174,8 @@ export function useWebSocket(url: string, options?: UseWebSocketOptions): UseWeb
 
     try {
       setStatus('connecting');
-      const ws = new WebSocket(url);
+      const ws = new WebSocket(url, [WS_BIN_PROTOCOL]);
+      ws.binaryType = 'arraybuffer';
 
       ws.onopen = () => {
         console.log('WebSocket connected');
@@ -194,6 +216,20 @@ export function useWebSocket(url: string, options?: UseWebSocketOptions): UseWeb
       };
 
       ws.onmessage = (event) => {
+        // Batched word acks (rbw1)
+        if (event.data instanceof ArrayBuffer) {
+          const ack = new Uint8Array(event.data);
+          if (ack.length === WORD_ACK_LEN && ack[0] === WORD_ACK_MAGIC) {
+            const seq = (ack[2] << 8) | ack[3];
+            if (ack[1] !== 0) {
+              setLastError(ack[1] === 1 ? 'C bridge not connected' : 'Bridge binary mode not active');
+            } else {
+              console.debug(`Words acked through #${seq} (${(ack[4] << 8) | ack[5]})`);
+            }
+          }
+          return;
+        }
+
         // Handle incoming messages (e.g., pong responses)
         try {
           const data = JSON.parse(event.data);
@@ -0,0 +1,58 @@
+/**
+ * Pack repeat-rate commands (C, A) into the 8-byte robot command word for the
+ * "rbw1" WebSocket sub-protocol. Bit layout mirrors the field tables in
+ * ECE/robot/components/cmd_codec/cmd_codec.h (LSB first, little-endian bytes).
+ */
+import type { CommandMsg } from './commands';
+
+export const WS_BIN_PROTOCOL = 'rbw1';
+
+/** [seq u16 BE][8-byte word] */
+export const WORD_FRAME_LEN = 10;
+
+/** Ack frames from the server: [0xAC][status][seq u16 BE][count u16 BE] */
+export const WORD_ACK_MAGIC = 0xac;
+export const WORD_ACK_LEN = 6;
+
+const CONTROL_CMD = 0x01;                            // command_type_t (cmd_codec.h)
+const ARM_CMD = 0x02;
+
+const bit = (v: number, lo: number) => ((v & 1) << lo) >>> 0;
+const field = (v: number, lo: number, width: number) => ((v & ((1 << width) - 1)) << lo) >>> 0;
+
+/** Low 32 bits of the word, or null for commands that stay JSON. */
+function wordLow(msg: CommandMsg): number | null {
+  switch (msg.T) {
+    case 'C':
+      return (
+        field(msg.PL, 0, 2) | field(CONTROL_CMD, 2, 5) |
+        bit(msg.F, 7) | bit(msg.L, 8) | bit(msg.B, 9) | bit(msg.R, 10) |
+        field(msg.S, 11, 7) | field(msg.ID, 18, 11)
+      ) >>> 0;
+    case 'A':
+      return (
+        field(msg.PL, 0, 2) | field(ARM_CMD, 2, 5) |
+        bit(msg.U, 7) | bit(msg.D, 8) | bit(msg.L, 9) | bit(msg.R, 10) |
+        bit(msg.In, 11) | bit(msg.O, 12) | field(msg.S, 13, 7) |
+        bit(msg.Re, 20) | field(msg.ID, 21, 11)
+      ) >>> 0;
+    default:
+      return null;
+  }
+}
+
+/** Build a rbw1 frame for msg, or null if it has no binary form. */
+export function encodeWordFrame(msg: CommandMsg, seq: number): Uint8Array | null {
+  const low = wordLow(msg);
+  if (low === null) return null;
+  const frame = new Uint8Array(WORD_FRAME_LEN);
+  const view = new DataView(frame.buffer);
+  view.setUint16(0, seq & 0xffff, false);
+  view.setUint32(2, low, true);                      // Upper 32 bits unused for C/A
+  return frame;
+}
+
+/** Hex of the frame, for the message log. */
+export function wordFrameHex(frame: Uint8Array): string {
+  return Array.from(frame, (b) => b.toString(16).padStart(2, '0')).join('');
+}
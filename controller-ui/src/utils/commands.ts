@@ -10,7 +10,7 @@ export interface ControlMsg {
   R: 0 | 1;
   S: number;
   PL: 1;
-  ID: 1;
+  ID: number;
 }
 
 /** Pose (P) - 0b00010, Event Driven */
@@ -52,11 +52,37 @@ export interface ArmControlMsg {
   S: number;
   Re: 0 | 1;
   PL: 1;
-  ID: 1;
+  ID: number;
 }
 
 export type CommandMsg = ControlMsg | ArmControlMsg | PoseMsg | SystemMsg | QueryMsg;
 
+/** System instruction that picks pulse or setpoint driving (cmd_codec.h DRIVE_MODE) */
+export const DRIVE_MODE_INSTRUCTION = 0b1011;
+
+// With several robots the bridge routes on the ID bits above the low 9
+// (ROBOT_ID_SHIFT in pmod_esp32.h), so the sequence stays below them: robot 0
+const COMMAND_ID_MAX = 511;
+let commandId = 0;
+
+/** Sequence id for C/A commands: 1..COMMAND_ID_MAX, wrapping */
+export function nextCommandId(): number {
+  commandId = (commandId % COMMAND_ID_MAX) + 1;
+  return commandId;
+}
+
+/** Setpoint driving: a C vector holds until the next one, or until no command arrives for watchdogMs */
+export function buildDriveModeMsg(setpoint: boolean, watchdogMs: number): SystemMsg {
+  return {
+    T: 'S',
+    instruction: DRIVE_MODE_INSTRUCTION,
+    Authorization_Code: 0x03ff,
+    instruction_specific: (setpoint ? 1 : 0) | ((watchdogMs & 0xffff) << 8),
+    PL: 1,
+    ID: 28,
+  };
+}
+
 export function buildArmControlMsg(
   U: 0 | 1,
   D: 0 | 1,
@@ -65,7 +91,8 @@ export function buildArmControlMsg(
   In: 0 | 1,
   O: 0 | 1,
   S: number,
-  Re: 0 | 1 = 0
+  Re: 0 | 1 = 0,
+  ID: number = 1
 ): ArmControlMsg {
   return {
     T: 'A',
@@ -78,7 +105,7 @@ export function buildArmControlMsg(
     S: Math.min(100, Math.max(0, S)),
     Re,
     PL: 1,
-    ID: 1,
+    ID,
   };
 }
 
@@ -87,7 +114,8 @@ export function buildControlMsg(
   B: 0 | 1,
   L: 0 | 1,
   R: 0 | 1,
-  S: number
+  S: number,
+  ID: number = 1
 ): ControlMsg {
   return {
     T: 'C',
@@ -97,6 +125,6 @@ export function buildControlMsg(
     R,
     S: Math.min(100, Math.max(0, S)),
     PL: 1,
-    ID: 1,
+    ID,
   };
 }
@@ -1,6 +1,8 @@
 /**
  * AES-256-GCM encryption via WebAssembly (Emscripten-compiled).
- * Loads aes_gcm_encrypt.wasm from /wasm/ and exposes encrypt API.
+ * Loads aes_gcm_encrypt_simd.wasm (-msimd128) when the browser has wasm SIMD,
+ * otherwise aes_gcm_encrypt.wasm, from /wasm/ and exposes encrypt API.
+ * sealProvider.ts puts WebCrypto in front of it when available.
  */
 
 export interface EncryptedPayload {
@@ -19,37 +21,108 @@ export interface AesGcmModule {
     args?: unknown[]
   ) => number;
   UTF8ToString: (ptr: number) => string;
+  /** Keyed-context exports; absent in wasm builds that predate them. */
+  _gcm_ctx_init?: (keyHexPtr: number) => number;
+  _gcm_encrypt_into?: (noncePtr: number, ptPtr: number, ptLen: number, outPtr: number) => number;
+  _gcm_encrypt_batch?: (
+    noncesPtr: number,
+    ptsPtr: number,
+    ptStride: number,
+    count: number,
+    outPtr: number
+  ) => number;
+  /** Seals iters 156-byte packets in wasm: suite 1 = AES-GCM, 2 = ChaCha20-Poly1305; packets/s. */
+  _aead_bench?: (suite: number, iters: number) => number;
+  _malloc?: (n: number) => number;
+  HEAPU8?: Uint8Array;
 }
 
 declare global {
   interface Window {
     AesGcmEncrypt?: () => Promise<AesGcmModule>;
+    AesGcmEncryptSimd?: () => Promise<AesGcmModule>;
   }
 }
 
+/** Build of the module: -msimd128 or baseline (encryption/wasm/build.sh). */
+export type WasmVariant = 'simd' | 'base';
+
+const VARIANTS: Record<WasmVariant, { script: string; global: 'AesGcmEncryptSimd' | 'AesGcmEncrypt' }> = {
+  simd: { script: '/wasm/aes_gcm_encrypt_simd.js', global: 'AesGcmEncryptSimd' },
+  base: { script: '/wasm/aes_gcm_encrypt.js', global: 'AesGcmEncrypt' },
+};
+
+// Smallest module using a v128 instruction; validate() rejects it without wasm SIMD
+const SIMD_PROBE = new Uint8Array([
+  0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11,
+]);
+
+export function wasmSimdSupported(): boolean {
+  try {
+    return WebAssembly.validate(SIMD_PROBE);
+  } catch {
+    return false;
+  }
+}
+
+const variantLoads: Partial<Record<WasmVariant, Promise<AesGcmModule>>> = {};
+
+/** Load one build of the module (a fresh instance per variant, cached). */
+export function loadWasmVariant(variant: WasmVariant): Promise<AesGcmModule> {
+  const cached = variantLoads[variant];
+  if (cached) return cached;
+
+  const { script, global } = VARIANTS[variant];
+  const load = (async () => {
+    if (!window[global]) {
+      await new Promise<void>((resolve, reject) => {
+        const s = document.createElement('script');
+        s.src = script;
+        s.async = true;
+        s.onload = () => resolve();
+        s.onerror = () => reject(new Error(`Failed to load ${script}`));
+        document.head.appendChild(s);
+      });
+    }
+    const createModule = window[global];
+    if (!createModule) throw new Error(`${global} not found`);
+    return createModule();
+  })();
+  variantLoads[variant] = load;
+  load.catch(() => delete variantLoads[variant]);           // Let a later call retry
+  return load;
+}
+
+let loadedVariant: WasmVariant | null = null;
+
+/** Variant loadEncryptionModule() settled on, null before it has. */
+export function loadedWasmVariant(): WasmVariant | null {
+  return loadedVariant;
+}
+
 /**
  * Load the WASM module. Call once before using encrypt.
- * Expects aes_gcm_encrypt.js and aes_gcm_encrypt.wasm in /wasm/
+ * Expects aes_gcm_encrypt{,_simd}.js and .wasm in /wasm/; the SIMD build is
+ * optional and the baseline is used when it is missing or unsupported.
  */
 export async function loadEncryptionModule(): Promise<AesGcmModule> {
   if (moduleInstance) return moduleInstance;
 
-  if (!window.AesGcmEncrypt) {
-    await new Promise<void>((resolve, reject) => {
-      const s = document.createElement('script');
-      s.src = '/wasm/aes_gcm_encrypt.js';
-      s.async = true;
-      s.onload = () => resolve();
-      s.onerror = () => reject(new Error('Failed to load aes_gcm_encrypt.js'));
-      document.head.appendChild(s);
-    });
+  let variant: WasmVariant = 'base';
+  let module: AesGcmModule | null = null;
+  if (wasmSimdSupported()) {
+    try {
+      module = await loadWasmVariant('simd');
+      variant = 'simd';
+    } catch {
+      module = null;                                       // Not built: baseline
+    }
   }
+  if (!module) module = await loadWasmVariant('base');
 
-  const createModule = window.AesGcmEncrypt;
-  if (!createModule) throw new Error('AesGcmEncrypt not found');
-
-  const module = await createModule();
   moduleInstance = module;
+  defaultSealer = new WasmSealer(module);
+  loadedVariant = variant;
   return moduleInstance;
 }
 
@@ -130,7 +203,157 @@ export function encryptJson(
     return null;
   }
   plaintext = plaintext.padEnd(MAX_PLAINTEXT_LENGTH, ' ');
+  if (defaultSealer?.keyedReady(keyHex)) {
+    const out = encryptJsonBatch([obj], keyHex);
+    return out ? out[0] : null;
+  }
   const encrypted = encrypt(plaintext, keyHex);
   if (!encrypted) return null;
   return encrypted.nonce + encrypted.ct + encrypted.tag + '\r';
 }
+
+// ---------------------------------------------------------------------------
+// Keyed context: the key is expanded once inside the wasm module and each
+// record is encrypted straight from/to preallocated linear memory, so a held
+// key streaming commands costs no per-call key setup, hex/JSON round trips
+// or wasm heap allocations.
+// ---------------------------------------------------------------------------
+
+/** Records per gcm_encrypt_batch call (held-key streams rarely queue more). */
+export const ENCRYPT_BATCH_MAX = 16;
+
+export const NONCE_LEN = 12;
+export const TAG_LEN = 16;
+/** IV || CT || TAG, the 156-byte record the bridge opens (TOTAL_SZ in software_cryptography.h) */
+export const RECORD_LEN = NONCE_LEN + MAX_PLAINTEXT_LENGTH + TAG_LEN;
+
+const HEX = Array.from({ length: 256 }, (_, i) => i.toString(16).padStart(2, '0'));
+const utf8 = new TextEncoder();
+
+/** JSON of obj as UTF-8 in pt, space padded to its end; false if it does not fit. */
+export function padJsonInto(obj: object, pt: Uint8Array): boolean {
+  const json = JSON.stringify(obj);
+  const { read, written } = utf8.encodeInto(json, pt);
+  if (read !== json.length) {
+    console.error(`Plaintext too long (> ${pt.length} bytes)`);
+    return false;
+  }
+  pt.fill(0x20, written);                                  // Space padding, as encryptJson
+  return true;
+}
+
+/** Wire string of one record: hex, then \r (what encryptJson returns). */
+export function recordHex(rec: Uint8Array): string {
+  let hex = '';
+  for (let j = 0; j < rec.length; j++) hex += HEX[rec[j]];
+  return hex + '\r';
+}
+
+export function hexToBytes(hex: string): Uint8Array | null {
+  if (hex.length % 2 !== 0 || /[^0-9a-fA-F]/.test(hex)) return null;
+  const out = new Uint8Array(hex.length / 2);
+  for (let i = 0; i < out.length; i++) out[i] = parseInt(hex.substr(i * 2, 2), 16);
+  return out;
+}
+
+/** Keyed session on one module instance (each wasm variant has its own). */
+export class WasmSealer {
+  private keyedHex: string | null = null;
+  private scratch: { key: number; nonces: number; pts: number; out: number } | null = null;
+
+  constructor(readonly module: AesGcmModule) {}
+
+  /** Set up (or switch) the wasm session key; false if this build has no keyed API. */
+  keyedReady(keyHex: string): boolean {
+    const m = this.module;
+    if (!m._gcm_ctx_init || !m._gcm_encrypt_batch || !m._malloc || !m.HEAPU8) return false;
+    if (this.keyedHex === keyHex) return true;
+    if (keyHex.length !== 64) return false;
+
+    if (!this.scratch) {
+      this.scratch = {
+        key: m._malloc(65),
+        nonces: m._malloc(NONCE_LEN * ENCRYPT_BATCH_MAX),
+        pts: m._malloc(MAX_PLAINTEXT_LENGTH * ENCRYPT_BATCH_MAX),
+        out: m._malloc(RECORD_LEN * ENCRYPT_BATCH_MAX),
+      };
+    }
+    const s = this.scratch;
+    const heap = m.HEAPU8 as Uint8Array;
+    utf8.encodeInto(keyHex, heap.subarray(s.key, s.key + 64));
+    heap[s.key + 64] = 0;
+    const ok = m._gcm_ctx_init(s.key) === 0;
+    heap.fill(0, s.key, s.key + 64);                        // Key now only lives in the GCM context
+    this.keyedHex = ok ? keyHex : null;
+    return ok;
+  }
+
+  /**
+   * Seal objects into RECORD_LEN-byte records, ENCRYPT_BATCH_MAX per wasm
+   * call. Call keyedReady() first. null if any object is too long or
+   * encryption fails.
+   */
+  sealRecords(objs: object[]): Uint8Array[] | null {
+    const m = this.module as Required<AesGcmModule>;
+    const s = this.scratch;
+    if (!s || !this.keyedHex) return null;
+    const result: Uint8Array[] = [];
+
+    for (let base = 0; base < objs.length; base += ENCRYPT_BATCH_MAX) {
+      const count = Math.min(ENCRYPT_BATCH_MAX, objs.length - base);
+      let heap = m.HEAPU8;
+      for (let i = 0; i < count; i++) {
+        const pt = heap.subarray(s.pts + i * MAX_PLAINTEXT_LENGTH, s.pts + (i + 1) * MAX_PLAINTEXT_LENGTH);
+        if (!padJsonInto(objs[base + i], pt)) return null;
+      }
+      crypto.getRandomValues(heap.subarray(s.nonces, s.nonces + count * NONCE_LEN));
+
+      if (m._gcm_encrypt_batch(s.nonces, s.pts, MAX_PLAINTEXT_LENGTH, count, s.out) < 0) return null;
+
+      heap = m.HEAPU8;                                     // Re-read: memory may have grown
+      for (let i = 0; i < count; i++) {
+        const rec = s.out + i * RECORD_LEN;
+        result.push(heap.slice(rec, rec + RECORD_LEN));
+      }
+    }
+    return result;
+  }
+}
+
+let defaultSealer: WasmSealer | null = null;
+
+/**
+ * Encrypt JSON objects into raw RECORD_LEN-byte IV || CT || TAG records with
+ * the loaded module. Returns null if any object is too long or encryption fails.
+ */
+export function encryptRecords(objs: object[], keyHex: string): Uint8Array[] | null {
+  if (defaultSealer?.keyedReady(keyHex)) return defaultSealer.sealRecords(objs);
+
+  const out: Uint8Array[] = [];                            // Builds without the keyed API
+  for (const obj of objs) {
+    const enc = encryptJson(obj, keyHex);
+    const rec = enc ? hexToBytes(enc.slice(0, -1)) : null;
+    if (!rec) return null;
+    out.push(rec);
+  }
+  return out;
+}
+
+/**
+ * Encrypt several JSON objects under one key in a single wasm call.
+ * Each entry is the same wire string encryptJson() returns (nonce + ct + tag
+ * hex, then \r). Returns null if any object is too long or encryption fails.
+ */
+export function encryptJsonBatch(objs: object[], keyHex: string): string[] | null {
+  if (!defaultSealer?.keyedReady(keyHex)) {
+    const out: string[] = [];
+    for (const obj of objs) {
+      const enc = encryptJson(obj, keyHex);
+      if (!enc) return null;
+      out.push(enc);
+    }
+    return out;
+  }
+  const recs = defaultSealer.sealRecords(objs);
+  return recs ? recs.map(recordHex) : null;
+}
@@ -0,0 +1,122 @@
+/**
+ * Seal providers for UI -> bridge commands. Each one turns JSON objects into
+ * the bridge's 156-byte IV || CT || TAG records: the JSON space padded to
+ * MAX_PLAINTEXT_LENGTH, AES-256-GCM under the session key, a random 12-byte
+ * IV, a 16-byte tag. On the wire a record is its hex and \r (encryptJson).
+ *
+ *   webcrypto  crypto.subtle with the key imported non-extractable; native
+ *              AES (AES-NI / ARMv8 crypto) in the browser. Secure contexts only.
+ *   wasm-simd  the -msimd128 Emscripten build (encryption.ts)
+ *   wasm       the baseline build
+ *
+ * getSealProvider() takes the first that works, in that order.
+ */
+import {
+  MAX_PLAINTEXT_LENGTH,
+  NONCE_LEN,
+  RECORD_LEN,
+  WasmSealer,
+  encryptRecords,
+  hexToBytes,
+  loadEncryptionModule,
+  loadWasmVariant,
+  loadedWasmVariant,
+  padJsonInto,
+  recordHex,
+  type WasmVariant,
+} from './encryption';
+
+export type SealProviderName = 'webcrypto' | 'wasm-simd' | 'wasm';
+
+export interface SealProvider {
+  name: SealProviderName;
+  /** One RECORD_LEN-byte record per object; null if any object is too long or sealing fails. */
+  sealRecords(objs: object[]): Promise<Uint8Array[] | null>;
+}
+
+/** WebCrypto provider, or null where crypto.subtle is missing or refuses the key. */
+export async function webCryptoProvider(keyHex: string): Promise<SealProvider | null> {
+  const subtle = globalThis.crypto?.subtle;
+  if (!subtle || !globalThis.isSecureContext) return null;
+
+  const raw = hexToBytes(keyHex);
+  if (!raw || raw.length !== 32) return null;
+  let key: CryptoKey;
+  try {
+    key = await subtle.importKey('raw', raw, { name: 'AES-GCM' }, false, ['encrypt']);
+  } catch {
+    return null;
+  } finally {
+    raw.fill(0);                                           // Key now only lives in the CryptoKey
+  }
+
+  const sealOne = async (obj: object): Promise<Uint8Array | null> => {
+    const pt = new Uint8Array(MAX_PLAINTEXT_LENGTH);
+    if (!padJsonInto(obj, pt)) return null;
+    const iv = crypto.getRandomValues(new Uint8Array(NONCE_LEN));
+    const ct = await subtle.encrypt({ name: 'AES-GCM', iv, tagLength: 128 }, key, pt);
+    const rec = new Uint8Array(RECORD_LEN);
+    rec.set(iv, 0);
+    rec.set(new Uint8Array(ct), NONCE_LEN);                // ciphertext || tag, as the bridge reads it
+    return rec;
+  };
+
+  return {
+    name: 'webcrypto',
+    async sealRecords(objs) {
+      try {
+        const recs = await Promise.all(objs.map(sealOne));
+        return recs.every((r): r is Uint8Array => r !== null) ? recs : null;
+      } catch {
+        return null;
+      }
+    },
+  };
+}
+
+/** Provider on the module loadEncryptionModule() picked (SIMD when available). */
+export async function wasmProvider(keyHex: string): Promise<SealProvider> {
+  await loadEncryptionModule();
+  return {
+    name: loadedWasmVariant() === 'simd' ? 'wasm-simd' : 'wasm',
+    async sealRecords(objs) {
+      return encryptRecords(objs, keyHex);
+    },
+  };
+}
+
+/** Provider on one specific wasm build, for benchmarks; null if it is not built or keyed API is missing. */
+export async function wasmVariantProvider(variant: WasmVariant, keyHex: string): Promise<SealProvider | null> {
+  let sealer: WasmSealer;
+  try {
+    sealer = new WasmSealer(await loadWasmVariant(variant));
+  } catch {
+    return null;
+  }
+  if (!sealer.keyedReady(keyHex)) return null;
+  return {
+    name: variant === 'simd' ? 'wasm-simd' : 'wasm',
+    async sealRecords(objs) {
+      return sealer.sealRecords(objs);
+    },
+  };
+}
+
+let cached: { keyHex: string; provider: Promise<SealProvider> } | null = null;
+
+/** Fastest available provider for keyHex (cached until the key changes). */
+export function getSealProvider(keyHex: string): Promise<SealProvider> {
+  if (cached?.keyHex === keyHex) return cached.provider;
+  const provider = (async () => (await webCryptoProvider(keyHex)) ?? wasmProvider(keyHex))();
+  cached = { keyHex, provider };
+  provider.catch(() => {
+    if (cached?.provider === provider) cached = null;
+  });
+  return provider;
+}
+
+/** Seal objects into wire strings (hex record + \r), the form encryptJson() returns. */
+export async function sealJson(objs: object[], keyHex: string): Promise<string[] | null> {
+  const recs = await (await getSealProvider(keyHex)).sealRecords(objs);
+  return recs ? recs.map(recordHex) : null;
+}
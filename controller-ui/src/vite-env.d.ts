@@ -4,6 +4,7 @@
 
 interface ImportMetaEnv {
   readonly VITE_WS_URL: string;
+  readonly VITE_GS_SEAL?: string;
 }
 
 interface ImportMeta {
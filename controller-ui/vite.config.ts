@@ -8,5 +8,12 @@ export default defineConfig({
     port: 3000,
     open: true,
   },
+  build: {
+    rollupOptions: {
+      input: {
+        main: 'index.html',
+        cryptoBench: 'crypto-bench.html',     // Seal provider benchmark, /crypto-bench.html
+      },
+    },
+  },
 });
-
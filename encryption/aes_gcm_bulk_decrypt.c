@@ -0,0 +1,495 @@
+// aes_gcm_bulk_decrypt.c
+// Bulk decrypt of a captured session: every sealed 156-byte IV||CT||TAG
+// record in a file, decoded word by word with the shared command codec.
+//
+// Input (-i, default auto):
+//   bin    back-to-back 156-byte records (aes_gcm_encrypt --stream output)
+//   frame  link frames 0x0A 0xD0|0xD1 <156 bytes> 0xDA 0x0D, anything between skipped
+//   hex    text, the first run of >= 312 hex chars on each line (bridge logs);
+//          a 320-char run framed 0AD0/0AD1 .. DA0D keeps its word/batch mark
+// Output (-o, default json): one JSON line per record, or tsv with one row per word.
+//
+// The file is mmap'd and indexed once; the records are then cut into equal
+// slices for a pool of worker threads, each with its own keyed
+// EVP_CIPHER_CTX and output buffer, and written back in file order.
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include "hex_codec.h"
+#include "cmd_codec.h"
+#include "replay_window.h"
+
+#define IV_SZ     12
+#define TAG_SZ    16
+#define CT_SZ     128
+#define TOTAL_SZ  (IV_SZ + CT_SZ + TAG_SZ)     // 156 bytes
+#define FRAME_SZ  (TOTAL_SZ + 4)
+#define HEX_SZ    (TOTAL_SZ * 2)
+#define PAD_BYTE  0xFF
+#define BATCH_MAX ((CT_SZ - 1) / 8)
+#define ROUND     16384                         // Records per thread per round
+#define REC_OUT   8192                          // Worst-case output for one record
+
+// Same key as aes_gcm_decrypt_split / software_cryptography.h; -k overrides
+#define DEFAULT_KEY_HEX "a1b2c3d4e5f6789012345678901234567890abcdef1234567890abcdef123456"
+
+enum { IN_AUTO, IN_BIN, IN_FRAME, IN_HEX };
+enum { KIND_GUESS, KIND_WORD, KIND_BATCH };     // From the frame mark when there is one
+
+typedef struct {
+    size_t  off;                                // Byte offset in the file
+    uint8_t kind;
+} rec_t;
+
+typedef struct {
+    pthread_t       tid;
+    EVP_CIPHER_CTX *ctx;
+    size_t          first, count;               // Slice of the current round
+    char           *out;
+    size_t          out_len, out_cap;
+    size_t          ok, bad;
+} worker_t;
+
+static const unsigned char *g_map;
+static size_t      g_map_len;
+static int         g_in = IN_AUTO;
+static int         g_tsv = 0;
+static rec_t      *g_recs;                      // NULL for IN_BIN: record i is at i * TOTAL_SZ
+static size_t      g_nrecs;
+static unsigned char g_key[32];
+static pthread_barrier_t g_start, g_done;
+static int         g_quit = 0;
+
+// ------------------------- Output -------------------------
+
+static size_t put_str(char *o, const char *s){
+    size_t n = strlen(s);
+    memcpy(o, s, n);
+    return n;
+}
+static size_t put_int(char *o, int64_t v){
+    char tmp[24];
+    uint64_t u = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+    size_t n = 0, k = sizeof(tmp);
+    do { tmp[--k] = (char)('0' + u % 10); u /= 10; } while(u);
+    if(v < 0) o[n++] = '-';
+    memcpy(o + n, tmp + k, sizeof(tmp) - k);
+    return n + sizeof(tmp) - k;
+}
+static size_t put_hex(char *o, const unsigned char *b, size_t len){
+    hexc_encode(b, len, o, 0);
+    return len * 2;
+}
+
+// Per-message field emitters generated from the codec's field tables
+#define BULK_FIELD(m, f, lo, wd, k) \
+    n += put_str(o + n, tsv ? " " #f "=" : ",\"" #f "\":"); \
+    n += put_int(o + n, (int64_t)cmd_##m##_get_##f(w));
+#define BULK_MESSAGE(m, bf_t, FIELDS) \
+    static size_t emit_##m(uint64_t w, char *o, int tsv){ size_t n = 0; FIELDS(BULK_FIELD) return n; }
+CMD_CODEC_MESSAGES(BULK_MESSAGE)
+
+typedef size_t (*emit_fn)(uint64_t, char *, int);
+
+static const char *word_msg(uint64_t w, emit_fn *emit){
+    switch(cmd_word_type(w)){
+    case CONTROL_CMD: *emit = emit_ctrl;   return "ctrl";
+    case ARM_CMD:     *emit = emit_arm;    return "arm";
+    case System_CMD:  *emit = emit_sys;    return "sys";
+    case Query_CMD:   *emit = emit_query;  return "query";
+    case HEALTH_CMD:  *emit = emit_health; return "health";
+    case ACK_CMD:     *emit = emit_ack;    return "ack";
+    case HPR_CMD:     *emit = emit_hpr;    return "hpr";
+    case ARM_TARGET_CMD: *emit = emit_armt; return "armt";
+    case FEC_CMD:     *emit = emit_fec;    return "fec";
+    case ROBOT_UPDATE_CMD:
+        switch(cmd_nav_get_part(w)){
+        case 0: *emit = emit_nav;   return "nav";
+        case 1: *emit = emit_pose;  return "pose";
+        case 2: *emit = emit_inert; return "inert";
+        }
+        break;
+    case TRAJ_CMD:
+        switch(cmd_trajd_get_op(w)){
+        case TRAJ_OP_DRIVE: *emit = emit_trajd; return "trajd";
+        case TRAJ_OP_ARM:   *emit = emit_traja; return "traja";
+        default:            *emit = emit_trajc; return "trajc";   // RUN / ABORT
+        }
+    }
+    *emit = NULL;
+    return "unknown";
+}
+
+// ------------------------- Decode -------------------------
+
+static int all_pad(const unsigned char *p, size_t len){
+    for(size_t i = 0; i < len; i++) if(p[i] != PAD_BYTE) return 0;
+    return 1;
+}
+
+// Without a frame mark a short JSON string can look like a padded word:
+// guessed words must also carry a known message type
+static int known_words(const unsigned char *p, int n){
+    for(int i = 0; i < n; i++){
+        uint32_t t = p[8 * i] >> 2 & 0x1F;
+        if(t < CONTROL_CMD || t > FEC_CMD) return 0;
+    }
+    return 1;
+}
+
+// Word count of a decrypted block, or 0 when it is not words (JSON text, other)
+static int block_words(const unsigned char pt[CT_SZ], int kind, const unsigned char **words){
+    int n = pt[0];
+    if(kind != KIND_BATCH && all_pad(pt + 8, CT_SZ - 8) && (kind == KIND_WORD || known_words(pt, 1))){
+        *words = pt;
+        return 1;
+    }
+    if(kind != KIND_WORD && n >= 1 && n <= BATCH_MAX && all_pad(pt + 1 + 8 * n, CT_SZ - 1 - 8 * (size_t)n) &&
+       (kind == KIND_BATCH || known_words(pt + 1, n))){
+        *words = pt + 1;
+        return n;
+    }
+    return 0;
+}
+
+static size_t emit_record(char *o, size_t off, const unsigned char *rec, int auth,
+                          const unsigned char pt[CT_SZ], int kind){
+    uint8_t dir = rec[0] & REPLAY_DIR_MASK;
+    uint64_t seq = 0;
+    replay_nonce_seq(rec, dir, &seq);
+    const char *dname = dir == REPLAY_DIR_ROBOT ? "robot" : "gs";
+    const unsigned char *words = NULL;
+    int nw = auth ? block_words(pt, kind, &words) : 0;
+    size_t n = 0;
+
+    if(g_tsv){
+        // off dir seq status idx msg raw fields
+        for(int i = 0; i < (nw ? nw : 1); i++){
+            n += put_int(o + n, (int64_t)off);
+            o[n++] = '\t'; n += put_str(o + n, dname);
+            o[n++] = '\t'; n += put_int(o + n, (int64_t)seq);
+            o[n++] = '\t'; n += put_str(o + n, !auth ? "auth_fail" : nw ? "ok" : "data");
+            o[n++] = '\t'; n += put_int(o + n, i);
+            o[n++] = '\t';
+            if(nw){
+                robot_bt_packet_t pkt;
+                memcpy(pkt.bytes, words + 8 * i, 8);
+                emit_fn emit;
+                n += put_str(o + n, word_msg(pkt.raw, &emit));
+                o[n++] = '\t'; n += put_hex(o + n, pkt.bytes, 8);
+                o[n++] = '\t';
+                if(emit){
+                    size_t k = emit(pkt.raw, o + n, 1);              // " f=v f=v": drop the leading space
+                    memmove(o + n, o + n + 1, k - 1);
+                    n += k - 1;
+                } else {
+                    o[n++] = '-';
+                }
+            } else {
+                n += put_str(o + n, "-\t");
+                if(auth){
+                    size_t len = CT_SZ;
+                    while(len && pt[len - 1] == PAD_BYTE) len--;
+                    n += put_hex(o + n, pt, len);
+                } else {
+                    o[n++] = '-';
+                }
+                n += put_str(o + n, "\t-");
+            }
+            o[n++] = '\n';
+        }
+        return n;
+    }
+
+    n += put_str(o + n, "{\"off\":");     n += put_int(o + n, (int64_t)off);
+    n += put_str(o + n, ",\"dir\":\"");   n += put_str(o + n, dname);
+    n += put_str(o + n, "\",\"seq\":");   n += put_int(o + n, (int64_t)seq);
+    n += put_str(o + n, ",\"ok\":");      n += put_int(o + n, auth);
+    if(nw){
+        n += put_str(o + n, ",\"words\":[");
+        for(int i = 0; i < nw; i++){
+            robot_bt_packet_t pkt;
+            memcpy(pkt.bytes, words + 8 * i, 8);
+            emit_fn emit;
+            const char *msg = word_msg(pkt.raw, &emit);
+            n += put_str(o + n, i ? ",{\"msg\":\"" : "{\"msg\":\"");
+            n += put_str(o + n, msg);
+            n += put_str(o + n, "\",\"raw\":\"");
+            n += put_hex(o + n, pkt.bytes, 8);
+            o[n++] = '"';
+            if(emit) n += emit(pkt.raw, o + n, 0);
+            o[n++] = '}';
+        }
+        o[n++] = ']';
+    } else if(auth){
+        // Not words: JSON text from encrypt_json, else the unpadded bytes
+        size_t len = CT_SZ, i;
+        while(len && pt[len - 1] == PAD_BYTE) len--;
+        for(i = 0; i < len && pt[i] >= 0x20 && pt[i] < 0x7F; i++) {}
+        if(len && i == len){
+            n += put_str(o + n, ",\"text\":\"");
+            for(i = 0; i < len; i++){
+                if(pt[i] == '"' || pt[i] == '\\') o[n++] = '\\';
+                o[n++] = (char)pt[i];
+            }
+            o[n++] = '"';
+        } else {
+            n += put_str(o + n, ",\"data\":\"");
+            n += put_hex(o + n, pt, len);
+            o[n++] = '"';
+        }
+    }
+    o[n++] = '}';
+    o[n++] = '\n';
+    return n;
+}
+
+// ------------------------- Workers -------------------------
+
+static int decrypt_one(EVP_CIPHER_CTX *ctx, const unsigned char *rec, unsigned char pt[CT_SZ]){
+    int outl = 0, fin = 0;
+    if(!EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, rec)) return 0;        // Key schedule kept, IV only
+    if(!EVP_DecryptUpdate(ctx, pt, &outl, rec + IV_SZ, CT_SZ)) return 0;
+    if(!EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, TAG_SZ, (void *)(rec + IV_SZ + CT_SZ))) return 0;
+    return EVP_DecryptFinal_ex(ctx, pt + outl, &fin) == 1;
+}
+
+static void run_slice(worker_t *w){
+    w->out_len = 0;
+    for(size_t i = w->first; i < w->first + w->count; i++){
+        unsigned char buf[TOTAL_SZ], pt[CT_SZ];
+        const unsigned char *rec;
+        size_t off = g_recs ? g_recs[i].off : i * TOTAL_SZ;
+        int kind = g_recs ? g_recs[i].kind : KIND_GUESS;
+
+        if(g_in == IN_HEX){
+            if(hexc_decode((const char *)g_map + off, HEX_SZ, buf) < 0) continue;   // Indexed as hex
+            rec = buf;
+        } else {
+            rec = g_map + off;
+        }
+
+        int auth = decrypt_one(w->ctx, rec, pt);
+        if(auth) w->ok++; else w->bad++;
+
+        if(w->out_cap - w->out_len < REC_OUT){
+            size_t cap = w->out_cap ? w->out_cap * 2 : (size_t)ROUND * 256;
+            char *p = realloc(w->out, cap);
+            if(!p){ fprintf(stderr, "OOM\n"); exit(1); }
+            w->out = p;
+            w->out_cap = cap;
+        }
+        w->out_len += emit_record(w->out + w->out_len, off, rec, auth, pt, kind);
+    }
+}
+
+static void *worker_main(void *arg){
+    worker_t *w = arg;
+    for(;;){
+        pthread_barrier_wait(&g_start);
+        if(g_quit) return NULL;
+        run_slice(w);
+        pthread_barrier_wait(&g_done);
+    }
+}
+
+// ------------------------- Index -------------------------
+
+static int is_hex(unsigned char c){ return hexc_nibble[c] >= 0; }
+
+static int push_rec(size_t *cap, size_t off, uint8_t kind){
+    if(g_nrecs == *cap){
+        *cap = *cap ? *cap * 2 : 4096;
+        rec_t *p = realloc(g_recs, *cap * sizeof(*p));
+        if(!p) return 0;
+        g_recs = p;
+    }
+    g_recs[g_nrecs].off = off;
+    g_recs[g_nrecs++].kind = kind;
+    return 1;
+}
+
+static int index_frames(void){
+    size_t cap = 0;
+    for(size_t i = 0; i + FRAME_SZ <= g_map_len; ){
+        const unsigned char *p = memchr(g_map + i, 0x0A, g_map_len - i - FRAME_SZ + 1);
+        if(!p) break;
+        i = (size_t)(p - g_map);
+        if((p[1] == 0xD0 || p[1] == 0xD1) && p[FRAME_SZ - 2] == 0xDA && p[FRAME_SZ - 1] == 0x0D){
+            if(!push_rec(&cap, i + 2, p[1] == 0xD1 ? KIND_BATCH : KIND_WORD)) return 0;
+            i += FRAME_SZ;
+        } else {
+            i++;
+        }
+    }
+    return 1;
+}
+
+static int index_hex(void){
+    size_t cap = 0;
+    for(size_t i = 0; i < g_map_len; ){
+        const unsigned char *nl = memchr(g_map + i, '\n', g_map_len - i);
+        size_t end = nl ? (size_t)(nl - g_map) : g_map_len;
+        for(size_t j = i; j < end; ){
+            if(!is_hex(g_map[j])){ j++; continue; }
+            size_t k = j;
+            while(k < end && is_hex(g_map[k])) k++;
+            if(k - j >= HEX_SZ){
+                const char *s = (const char *)g_map + j;
+                uint8_t kind = KIND_GUESS;
+                if(k - j >= HEX_SZ + 8 && strncasecmp(s, "0ad", 3) == 0 && (s[3] == '0' || s[3] == '1') &&
+                   strncasecmp(s + HEX_SZ + 4, "da0d", 4) == 0){
+                    kind = s[3] == '1' ? KIND_BATCH : KIND_WORD;
+                    j += 4;
+                }
+                if(!push_rec(&cap, j, kind)) return 0;
+                break;
+            }
+            j = k;
+        }
+        i = end + 1;
+    }
+    return 1;
+}
+
+static int detect_input(void){
+    if(g_map_len >= FRAME_SZ && g_map[0] == 0x0A && (g_map[1] == 0xD0 || g_map[1] == 0xD1)) return IN_FRAME;
+    size_t run = 0;
+    for(size_t i = 0; i < g_map_len && i < 8192; i++){                  // A record's worth of hex text
+        run = is_hex(g_map[i]) ? run + 1 : 0;
+        if(run >= HEX_SZ) return IN_HEX;
+    }
+    return IN_BIN;
+}
+
+// ------------------------- Main -------------------------
+
+static void usage(const char *prog){
+    fprintf(stderr,
+        "Usage: %s [-i auto|bin|frame|hex] [-o json|tsv] [-j THREADS] [-k KEY_HEX] CAPTURE\n"
+        "  Decrypts every sealed 156-byte record in CAPTURE and decodes its words\n", prog);
+}
+
+int main(int argc, char **argv){
+    const char *key_hex = DEFAULT_KEY_HEX;
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    int c;
+
+    while((c = getopt(argc, argv, "i:o:j:k:h")) != -1){
+        switch(c){
+        case 'i':
+            if(!strcmp(optarg, "auto")) g_in = IN_AUTO;
+            else if(!strcmp(optarg, "bin")) g_in = IN_BIN;
+            else if(!strcmp(optarg, "frame")) g_in = IN_FRAME;
+            else if(!strcmp(optarg, "hex")) g_in = IN_HEX;
+            else { usage(argv[0]); return 1; }
+            break;
+        case 'o':
+            if(!strcmp(optarg, "json")) g_tsv = 0;
+            else if(!strcmp(optarg, "tsv")) g_tsv = 1;
+            else { usage(argv[0]); return 1; }
+            break;
+        case 'j': nthreads = strtol(optarg, NULL, 10); break;
+        case 'k': key_hex = optarg; break;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+    if(optind != argc - 1){ usage(argv[0]); return 1; }
+    if(nthreads < 1) nthreads = 1;
+    if(nthreads > 256) nthreads = 256;
+
+    if(strlen(key_hex) != 64 || hexc_decode(key_hex, 64, g_key) != 32){
+        fprintf(stderr, "Key must be 32 bytes (64 hex chars)\n"); return 1;
+    }
+
+    int fd = open(argv[optind], O_RDONLY);
+    if(fd < 0){ fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno)); return 1; }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0){ fprintf(stderr, "%s: empty or unreadable\n", argv[optind]); return 1; }
+    g_map_len = (size_t)st.st_size;
+    g_map = mmap(NULL, g_map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(g_map == MAP_FAILED){ perror("mmap"); return 1; }
+    madvise((void *)g_map, g_map_len, MADV_SEQUENTIAL);
+
+    if(g_in == IN_AUTO) g_in = detect_input();
+    if(g_in == IN_BIN){
+        g_nrecs = g_map_len / TOTAL_SZ;
+        if(g_map_len % TOTAL_SZ)
+            fprintf(stderr, "Warning: %zu trailing bytes ignored\n", g_map_len % TOTAL_SZ);
+    } else if(!(g_in == IN_FRAME ? index_frames() : index_hex())){
+        fprintf(stderr, "OOM\n"); return 1;
+    }
+
+    if((size_t)nthreads > g_nrecs / 64 + 1) nthreads = (long)(g_nrecs / 64 + 1);   // Small files: fewer threads
+    worker_t *w = calloc((size_t)nthreads, sizeof(*w));
+    if(!w){ fprintf(stderr, "OOM\n"); return 1; }
+    pthread_barrier_init(&g_start, NULL, (unsigned)nthreads + 1);
+    pthread_barrier_init(&g_done, NULL, (unsigned)nthreads + 1);
+    for(long t = 0; t < nthreads; t++){
+        w[t].ctx = EVP_CIPHER_CTX_new();
+        int ok = w[t].ctx != NULL;
+        ok = ok && EVP_DecryptInit_ex(w[t].ctx, EVP_aes_256_gcm(), NULL, NULL, NULL);
+        ok = ok && EVP_CIPHER_CTX_ctrl(w[t].ctx, EVP_CTRL_GCM_SET_IVLEN, IV_SZ, NULL);
+        ok = ok && EVP_DecryptInit_ex(w[t].ctx, NULL, NULL, g_key, NULL);
+        if(!ok){ fprintf(stderr, "DecryptInit failed\n"); return 1; }
+        if(pthread_create(&w[t].tid, NULL, worker_main, &w[t]) != 0){ perror("pthread_create"); return 1; }
+    }
+
+    static char out_buf[1 << 16];
+    setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+    if(g_tsv) fputs("off\tdir\tseq\tstatus\tidx\tmsg\traw\tfields\n", stdout);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    // One round = up to ROUND records per thread; output leaves in file order
+    for(size_t base = 0; base < g_nrecs; ){
+        size_t left = g_nrecs - base, per = (left + (size_t)nthreads - 1) / (size_t)nthreads;
+        if(per > ROUND) per = ROUND;
+        for(long t = 0; t < nthreads; t++){
+            size_t first = base + (size_t)t * per;
+            w[t].first = first;
+            w[t].count = first >= g_nrecs ? 0 : (g_nrecs - first < per ? g_nrecs - first : per);
+        }
+        pthread_barrier_wait(&g_start);
+        pthread_barrier_wait(&g_done);
+        for(long t = 0; t < nthreads; t++){
+            if(fwrite(w[t].out, 1, w[t].out_len, stdout) != w[t].out_len){ perror("write"); return 1; }
+        }
+        base += per * (size_t)nthreads;
+    }
+    g_quit = 1;
+    pthread_barrier_wait(&g_start);
+
+    size_t ok = 0, bad = 0;
+    for(long t = 0; t < nthreads; t++){
+        pthread_join(w[t].tid, NULL);
+        ok += w[t].ok;
+        bad += w[t].bad;
+        EVP_CIPHER_CTX_free(w[t].ctx);
+        free(w[t].out);
+    }
+    if(fflush(stdout) != 0){ perror("write"); return 1; }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    fprintf(stderr, "%zu records, %zu authenticated, %zu failed, %ld threads, %.0f rec/s\n",
+            g_nrecs, ok, bad, nthreads, secs > 0 ? (double)g_nrecs / secs : 0.0);
+
+    pthread_barrier_destroy(&g_start);
+    pthread_barrier_destroy(&g_done);
+    free(w);
+    free(g_recs);
+    munmap((void *)g_map, g_map_len);
+    return bad ? 2 : 0;
+}
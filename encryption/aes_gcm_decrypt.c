@@ -3,29 +3,21 @@
 #include <stdlib.h>
 #include <string.h>
 #include <openssl/evp.h>
+#include "hex_codec.h"
 
 
 
 // Mason
 
 
-static int from_hex(char c){
-    if(c>='0'&&c<='9')return c-'0';
-    if(c>='a'&&c<='f')return c-'a'+10;
-    if(c>='A'&&c<='F')return c-'A'+10;
-    return -1;
-}
 static int hex_decode(const char *hex, unsigned char **out, size_t *out_len){
-    size_t n=strlen(hex);
-    if(n%2!=0) return 0;
-    *out=(unsigned char*)malloc(n/2);
+    size_t n = strlen(hex);
+    if(n % 2 != 0) return 0;
+    *out = (unsigned char*)malloc(n/2 ? n/2 : 1);
     if(!*out) return 0;
-    for(size_t i=0;i<n;i+=2){
-        int hi=from_hex(hex[i]), lo=from_hex(hex[i+1]);
-        if(hi<0||lo<0){ free(*out); return 0; }
-        (*out)[i/2]=(unsigned char)((hi<<4)|lo);
-    }
-    *out_len=n/2; return 1;
+    if(hexc_decode(hex, n, *out) < 0){ free(*out); *out = NULL; return 0; }   // Shared table/SIMD codec
+    *out_len = n/2;
+    return 1;
 }
 static char *read_all_stdin_text(void){
     size_t cap=4096, n=0;
@@ -3,34 +3,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include <openssl/evp.h>
+#include "hex_codec.h"
 
 #define NONCE_HEX_LEN 24   // 12 bytes
 #define TAG_HEX_LEN   32   // 16 bytes
 
 // ---------- helpers ----------
-static int from_hex(char c){
-    if(c>='0'&&c<='9')return c-'0';
-    if(c>='a'&&c<='f')return c-'a'+10;
-    if(c>='A'&&c<='F')return c-'A'+10;
-    return -1;
-}
-
 static int hex_decode(const char *hex, unsigned char **out, size_t *out_len){
     size_t n = strlen(hex);
     if(n % 2 != 0) return 0;
-
-    *out = (unsigned char*)malloc(n/2);
+    *out = (unsigned char*)malloc(n/2 ? n/2 : 1);
     if(!*out) return 0;
-
-    for(size_t i=0; i<n; i+=2){
-        int hi = from_hex(hex[i]), lo = from_hex(hex[i+1]);
-        if(hi < 0 || lo < 0){
-            free(*out);
-            *out = NULL;
-            return 0;
-        }
-        (*out)[i/2] = (unsigned char)((hi<<4) | lo);
-    }
+    if(hexc_decode(hex, n, *out) < 0){ free(*out); *out = NULL; return 0; }   // Shared table/SIMD codec
     *out_len = n/2;
     return 1;
 }
@@ -3,37 +3,29 @@
 #include <stdlib.h>
 #include <string.h>
 #include <openssl/evp.h>
+#include "hex_codec.h"
 
-// Mason
-static int from_hex(char c) {
-    if (c >= '0' && c <= '9') return c - '0';
-    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-    return -1;
-}
+// Streaming record layout, same as software_cryptography.c: IV || CT || TAG
+#define IV_SZ     12
+#define TAG_SZ    16
+#define CT_SZ     128
+#define TOTAL_SZ  (IV_SZ + CT_SZ + TAG_SZ)     // 156 bytes
+#define PAD_BYTE  0xFF
 
-static int hex_decode(const char *hex, unsigned char **out, size_t *out_len) {
+// Mason
+static int hex_decode(const char *hex, unsigned char **out, size_t *out_len){
     size_t n = strlen(hex);
-    if (n % 2 != 0) return 0;
-    *out = (unsigned char*)malloc(n/2);
-    if (!*out) return 0;
-    for (size_t i = 0; i < n; i += 2) {
-        int hi = from_hex(hex[i]), lo = from_hex(hex[i+1]);
-        if (hi < 0 || lo < 0) { free(*out); return 0; }
-        (*out)[i/2] = (unsigned char)((hi<<4) | lo);
-    }
+    if(n % 2 != 0) return 0;
+    *out = (unsigned char*)malloc(n/2 ? n/2 : 1);
+    if(!*out) return 0;
+    if(hexc_decode(hex, n, *out) < 0){ free(*out); *out = NULL; return 0; }   // Shared table/SIMD codec
     *out_len = n/2;
     return 1;
 }
-static char *hex_encode(const unsigned char *buf, size_t len) {
-    static const char *digits = "0123456789abcdef";
+static char *hex_encode(const unsigned char *buf, size_t len){
     char *out = (char*)malloc(len*2 + 1);
-    if (!out) return NULL;
-    for (size_t i = 0; i < len; ++i) {
-        out[i*2]   = digits[(buf[i] >> 4) & 0xF];
-        out[i*2+1] = digits[buf[i] & 0xF];
-    }
-    out[len*2] = '\0';
+    if(!out) return NULL;
+    hexc_encode(buf, len, out, 0);
     return out;
 }
 static unsigned char *read_all_stdin(size_t *len) {
@@ -54,9 +46,104 @@ static unsigned char *read_all_stdin(size_t *len) {
     return buf;
 }
 
+// --stream: one record per newline (blank lines skipped) or per 2-byte
+// big-endian length prefix (--stream=len). The stdin buffer, the record
+// and the EVP context are reused, so a record costs one GCM pass.
+static unsigned char g_in[1 << 16];
+static size_t g_in_pos = 0, g_in_len = 0;
+
+static int in_byte(void){
+    if(g_in_pos == g_in_len){
+        g_in_len = fread(g_in, 1, sizeof(g_in), stdin);
+        g_in_pos = 0;
+        if(!g_in_len) return EOF;
+    }
+    return g_in[g_in_pos++];
+}
+// 1 = record read, 0 = end of input, -1 = record longer than CT_SZ / cut short
+static int next_record(int len_mode, unsigned char rec[CT_SZ], size_t *len){
+    int c;
+    *len = 0;
+    if(len_mode){
+        int hi = in_byte(), lo;
+        if(hi == EOF) return 0;
+        if((lo = in_byte()) == EOF) return -1;
+        size_t n = (size_t)(hi << 8 | lo);
+        if(n == 0 || n > CT_SZ) return -1;
+        for(; *len < n; (*len)++){
+            if((c = in_byte()) == EOF) return -1;
+            rec[*len] = (unsigned char)c;
+        }
+        return 1;
+    }
+    for(;;){
+        while((c = in_byte()) != EOF && c != '\n'){
+            if(*len == CT_SZ) return -1;
+            rec[(*len)++] = (unsigned char)c;
+        }
+        if(*len && rec[*len - 1] == '\r') (*len)--;
+        if(*len) return 1;
+        if(c == EOF) return 0;
+    }
+}
+// Big-endian counter in the nonce's last 8 bytes; 0 once it would wrap
+static int nonce_step(unsigned char nonce[IV_SZ]){
+    for(int i = IV_SZ - 1; i >= IV_SZ - 8; i--){
+        if(++nonce[i]) return 1;
+    }
+    return 0;
+}
+static int stream_main(int len_mode, const unsigned char *key, unsigned char *nonce,
+                       const unsigned char *aad, size_t aad_len){
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if(!ctx){ fprintf(stderr, "CTX new failed\n"); return 1; }
+    int ok = EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, NULL, NULL);
+    ok &= EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, IV_SZ, NULL);
+    ok &= EVP_EncryptInit_ex(ctx, NULL, NULL, key, NULL);
+    if(!ok){ fprintf(stderr, "EncryptInit failed\n"); EVP_CIPHER_CTX_free(ctx); return 1; }
+
+    static char out_buf[1 << 16];
+    setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+
+    unsigned char rec[CT_SZ], out[TOTAL_SZ];
+    size_t len, n = 0;
+    int r, rc = 0;
+    while((r = next_record(len_mode, rec, &len)) > 0){
+        int outl = 0, fin = 0;
+        memset(rec + len, PAD_BYTE, CT_SZ - len);
+        memcpy(out, nonce, IV_SZ);
+        ok = EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, nonce);     // Key schedule kept, IV only
+        if(ok && aad_len) ok = EVP_EncryptUpdate(ctx, NULL, &outl, aad, (int)aad_len);
+        ok = ok && EVP_EncryptUpdate(ctx, out + IV_SZ, &outl, rec, CT_SZ);
+        ok = ok && EVP_EncryptFinal_ex(ctx, out + IV_SZ + outl, &fin);
+        ok = ok && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, TAG_SZ, out + IV_SZ + CT_SZ);
+        if(!ok){ fprintf(stderr, "Record %zu: encrypt failed\n", n); rc = 1; break; }
+        if(fwrite(out, 1, TOTAL_SZ, stdout) != TOTAL_SZ){ perror("write"); rc = 1; break; }
+        n++;
+        if(!nonce_step(nonce)){ fprintf(stderr, "Nonce counter exhausted after %zu records\n", n); rc = 1; break; }
+    }
+    if(r < 0){ fprintf(stderr, "Record %zu: empty, over %d bytes or truncated\n", n, CT_SZ); rc = 1; }
+    if(fflush(stdout) != 0){ perror("write"); rc = 1; }
+    fprintf(stderr, "%zu records\n", n);
+    EVP_CIPHER_CTX_free(ctx);
+    return rc;
+}
+
 int main(int argc, char **argv) {
+    const char *prog = argv[0];
+    int stream = 0, len_mode = 0;
+    if (argc > 1 && strncmp(argv[1], "--stream", 8) == 0) {
+        const char *m = argv[1] + 8;
+        if (*m == '\0' || strcmp(m, "=nl") == 0) stream = 1;
+        else if (strcmp(m, "=len") == 0) stream = len_mode = 1;
+        argc--; argv++;
+        if (!stream) argc = 0;
+    }
     if (argc < 3 || argc > 4) {
-        fprintf(stderr, "Usage: %s KEY_HEX(32B) NONCE_HEX(12B) [AAD_HEX]\n", argv[0]);
+        fprintf(stderr, "Usage: %s KEY_HEX(32B) NONCE_HEX(12B) [AAD_HEX]\n"
+                        "       %s --stream[=nl|=len] KEY_HEX(32B) NONCE_HEX(12B) [AAD_HEX]\n"
+                        "         156-byte IV||CT||TAG records on stdout, nonce +1 per record\n",
+                prog, prog);
         return 1;
     }
 
@@ -73,6 +160,12 @@ int main(int argc, char **argv) {
         fprintf(stderr, "Invalid AAD hex\n"); return 1;
     }
 
+    if (stream) {
+        int rc = stream_main(len_mode, key, nonce, aad, aad_len);
+        free(aad); free(nonce); free(key);
+        return rc;
+    }
+
     size_t pt_len=0;
     unsigned char *pt = read_all_stdin(&pt_len);
     if (!pt) { fprintf(stderr, "Failed to read stdin\n"); return 1; }
@@ -154,6 +154,130 @@ static int test_tampered_tag_fails(void) {
     return 1;
 }
 
+static int test_stream_records(void) {
+    const char *key_hex =
+        "00112233445566778899aabbccddeeff"
+        "00112233445566778899aabbccddeeff";
+    const char *nonce_hex   = "0011223344556677ffffffff";
+    const char *nonce1_hex  = "001122334455667800000000";   // Counter carries into byte 7
+
+    // Two newline records (blank line skipped) -> two 156-byte IV||CT||TAG records.
+    FILE *f = fopen("stream_pt.txt", "w");
+    if (!f) {
+        perror("fopen stream_pt.txt");
+        return 0;
+    }
+    fputs("first\n\nsecond\r\n", f);
+    fclose(f);
+
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd),
+             "./aes_gcm_encrypt --stream %s %s < stream_pt.txt > stream.bin 2>/dev/null",
+             key_hex, nonce_hex);
+    int rc = system(cmd);
+    if (rc != 0) {
+        fprintf(stderr, "Stream encrypt command failed (rc=%d)\n", rc);
+        return 0;
+    }
+
+    unsigned char rec[2 * 156];
+    f = fopen("stream.bin", "rb");
+    if (!f) {
+        perror("fopen stream.bin");
+        return 0;
+    }
+    size_t n = fread(rec, 1, sizeof(rec), f);
+    int extra = fgetc(f) != EOF;
+    fclose(f);
+    if (n != sizeof(rec) || extra) {
+        fprintf(stderr, "Stream output is not two 156-byte records\n");
+        return 0;
+    }
+
+    // Second record: its IV must be nonce + 1; decrypt it with the single-shot tool.
+    char iv_hex[25], ct_hex[257], tag_hex[33];
+    const unsigned char *r = rec + 156;
+    for (int i = 0; i < 12; i++)  sprintf(iv_hex + 2 * i, "%02x", r[i]);
+    for (int i = 0; i < 128; i++) sprintf(ct_hex + 2 * i, "%02x", r[12 + i]);
+    for (int i = 0; i < 16; i++)  sprintf(tag_hex + 2 * i, "%02x", r[140 + i]);
+    if (strcmp(iv_hex, nonce1_hex) != 0) {
+        fprintf(stderr, "Stream record 1 IV %s, expected %s\n", iv_hex, nonce1_hex);
+        return 0;
+    }
+
+    f = fopen("stream_ct.txt", "w");
+    if (!f) {
+        perror("fopen stream_ct.txt");
+        return 0;
+    }
+    fputs(ct_hex, f);
+    fclose(f);
+    snprintf(cmd, sizeof(cmd),
+             "./aes_gcm_decrypt %s %s %s < stream_ct.txt > stream_dec.txt",
+             key_hex, iv_hex, tag_hex);
+    rc = system(cmd);
+    if (rc != 0) {
+        fprintf(stderr, "Stream record decrypt failed (rc=%d)\n", rc);
+        return 0;
+    }
+
+    unsigned char pt[129];
+    f = fopen("stream_dec.txt", "rb");
+    if (!f) {
+        perror("fopen stream_dec.txt");
+        return 0;
+    }
+    n = fread(pt, 1, sizeof(pt), f);
+    fclose(f);
+    if (n < 128 || memcmp(pt, "second", 6) != 0 || pt[6] != 0xFF || pt[127] != 0xFF) {
+        fprintf(stderr, "Stream record plaintext is not \"second\" padded with 0xFF\n");
+        return 0;
+    }
+
+    printf("Stream record test PASSED.\n");
+    return 1;
+}
+
+static int test_bulk_decrypt(void) {
+    const char *key_hex =
+        "00112233445566778899aabbccddeeff"
+        "00112233445566778899aabbccddeeff";
+
+    // Re-use stream.bin from test_stream_records: two text records.
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd),
+             "./aes_gcm_bulk_decrypt -i bin -k %s stream.bin > bulk_out.txt 2>/dev/null",
+             key_hex);
+    int rc = system(cmd);
+    if (rc != 0) {
+        fprintf(stderr, "Bulk decrypt command failed (rc=%d)\n", rc);
+        return 0;
+    }
+
+    FILE *f = fopen("bulk_out.txt", "r");
+    if (!f) {
+        perror("fopen bulk_out.txt");
+        return 0;
+    }
+    char line[1024];
+    int lines = 0, found = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lines++;
+        if (strstr(line, "\"off\":156,") && strstr(line, "\"ok\":1") &&
+            strstr(line, "\"text\":\"second\""))
+            found = 1;
+    }
+    fclose(f);
+    if (lines != 2 || !found) {
+        fprintf(stderr, "Bulk decrypt output: %d lines, second record %s\n",
+                lines, found ? "found" : "missing");
+        return 0;
+    }
+
+    printf("Bulk decrypt test PASSED.\n");
+    return 1;
+}
+
 int main(void) {
     int ok = 1;
 
@@ -170,6 +294,12 @@ int main(void) {
     // Ensures authentication works by tampering with the tag and confirming decryption fails as expected.
     ok &= test_tampered_tag_fails();
 
+    // Streams two records through one encrypt process and checks layout, nonce step and padding.
+    ok &= test_stream_records();
+
+    // Decrypts the streamed records in one bulk pass and checks the JSON line per record.
+    ok &= test_bulk_decrypt();
+
     // Reports final test status, confirming whether all AES-GCM operations behaved correctly.
     if (!ok) {
         fprintf(stderr, "One or more tests FAILED.\n");
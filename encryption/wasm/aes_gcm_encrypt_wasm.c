@@ -2,47 +2,30 @@
  * AES-256-GCM encrypt for WebAssembly (Emscripten)
  * Compatible with aes_gcm_encrypt.c output format - uses mbedtls for WASM portability.
  * Exports: encrypt_aes_gcm_json(key_hex, nonce_hex, plaintext) -> JSON string
+ * Also ChaCha20-Poly1305 (chacha_*), same nonce / tag sizes and layout.
  */
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <emscripten.h>
 #include "mbedtls/gcm.h"
+#include "mbedtls/chachapoly.h"
+#include "hex_codec.h"
 
-static int from_hex(char c) {
-    if (c >= '0' && c <= '9') return c - '0';
-    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-    return -1;
-}
-
-static int hex_decode(const char *hex, unsigned char **out, size_t *out_len) {
+static int hex_decode(const char *hex, unsigned char **out, size_t *out_len){
     size_t n = strlen(hex);
-    if (n % 2 != 0) return 0;
-    *out = (unsigned char *)malloc(n / 2);
-    if (!*out) return 0;
-    for (size_t i = 0; i < n; i += 2) {
-        int hi = from_hex(hex[i]), lo = from_hex(hex[i + 1]);
-        if (hi < 0 || lo < 0) {
-            free(*out);
-            *out = NULL;
-            return 0;
-        }
-        (*out)[i / 2] = (unsigned char)((hi << 4) | lo);
-    }
-    *out_len = n / 2;
+    if(n % 2 != 0) return 0;
+    *out = (unsigned char*)malloc(n/2 ? n/2 : 1);
+    if(!*out) return 0;
+    if(hexc_decode(hex, n, *out) < 0){ free(*out); *out = NULL; return 0; }   // Shared table/SIMD codec
+    *out_len = n/2;
     return 1;
 }
 
-static char *hex_encode(const unsigned char *buf, size_t len) {
-    static const char *digits = "0123456789abcdef";
-    char *out = (char *)malloc(len * 2 + 1);
-    if (!out) return NULL;
-    for (size_t i = 0; i < len; ++i) {
-        out[i * 2] = digits[(buf[i] >> 4) & 0xF];
-        out[i * 2 + 1] = digits[buf[i] & 0xF];
-    }
-    out[len * 2] = '\0';
+static char *hex_encode(const unsigned char *buf, size_t len){
+    char *out = (char*)malloc(len*2 + 1);
+    if(!out) return NULL;
+    hexc_encode(buf, len, out, 0);
     return out;
 }
 
@@ -178,3 +161,160 @@ EMSCRIPTEN_KEEPALIVE
 void free_string(char *s) {
     free(s);
 }
+
+/* ------------------------------------------------------------------------
+ * Stateful API: the key is expanded once, then every encrypt writes raw
+ * nonce || ct || tag bytes (the wire order) into caller-provided linear
+ * memory. No hex, no JSON, no allocation per message.
+ * ------------------------------------------------------------------------ */
+
+#define GCM_NONCE_LEN 12
+#define GCM_TAG_LEN   16
+
+static mbedtls_gcm_context keyed_ctx;
+static int keyed_ready = 0;
+
+/**
+ * Set the session key (64 hex chars). Replaces any previous key.
+ * Returns 0 on success, -1 on a bad key.
+ */
+EMSCRIPTEN_KEEPALIVE
+int gcm_ctx_init(const char *key_hex) {
+    unsigned char key[32];
+    if (!key_hex || strlen(key_hex) != 64 || hexc_decode(key_hex, 64, key) != 32) return -1;
+
+    if (keyed_ready) mbedtls_gcm_free(&keyed_ctx);
+    mbedtls_gcm_init(&keyed_ctx);
+    int ret = mbedtls_gcm_setkey(&keyed_ctx, MBEDTLS_CIPHER_ID_AES, key, 256);
+    memset(key, 0, sizeof(key));
+    keyed_ready = (ret == 0);
+    return keyed_ready ? 0 : -1;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void gcm_ctx_free(void) {
+    if (keyed_ready) mbedtls_gcm_free(&keyed_ctx);
+    keyed_ready = 0;
+}
+
+/**
+ * Encrypt pt_len bytes under the session key and the 12-byte nonce.
+ * out receives nonce || ct || tag (pt_len + 28 bytes); out may not overlap pt.
+ * Returns the byte count written, or -1 (no key / mbedTLS error).
+ */
+EMSCRIPTEN_KEEPALIVE
+int gcm_encrypt_into(const unsigned char *nonce, const unsigned char *pt, int pt_len,
+                     unsigned char *out) {
+    if (!keyed_ready || !nonce || (!pt && pt_len) || pt_len < 0 || !out) return -1;
+
+    memcpy(out, nonce, GCM_NONCE_LEN);
+    int ret = mbedtls_gcm_crypt_and_tag(&keyed_ctx, MBEDTLS_GCM_ENCRYPT, (size_t)pt_len,
+                                        nonce, GCM_NONCE_LEN, NULL, 0, pt,
+                                        out + GCM_NONCE_LEN, GCM_TAG_LEN,
+                                        out + GCM_NONCE_LEN + pt_len);
+    return ret == 0 ? pt_len + GCM_NONCE_LEN + GCM_TAG_LEN : -1;
+}
+
+/**
+ * Batch form for held-key command streams: count records of pt_stride bytes
+ * each (commands are padded to a fixed length), one 12-byte nonce per record.
+ * Record i lands at out + i * (pt_stride + 28).
+ * Returns the total bytes written, or -1 (nothing after the failing record is written).
+ */
+EMSCRIPTEN_KEEPALIVE
+int gcm_encrypt_batch(const unsigned char *nonces, const unsigned char *pts, int pt_stride,
+                      int count, unsigned char *out) {
+    if (count < 0 || pt_stride < 0) return -1;
+    int rec = pt_stride + GCM_NONCE_LEN + GCM_TAG_LEN;
+    for (int i = 0; i < count; i++) {
+        if (gcm_encrypt_into(nonces + (size_t)i * GCM_NONCE_LEN, pts + (size_t)i * pt_stride,
+                             pt_stride, out + (size_t)i * rec) < 0)
+            return -1;
+    }
+    return count * rec;
+}
+
+/* ------------------------------------------------------------------------
+ * ChaCha20-Poly1305 (SECURITY_LEVEL specific 2, cmd_codec.h): the same
+ * stateful API. In WASM there is no AES hardware and no table-free
+ * constant-time AES, so ChaCha is the faster of the two here.
+ * ------------------------------------------------------------------------ */
+
+static mbedtls_chachapoly_context chacha_ctx;
+static int chacha_ready = 0;
+
+/**
+ * Set the ChaCha20-Poly1305 session key (64 hex chars).
+ * Returns 0 on success, -1 on a bad key.
+ */
+EMSCRIPTEN_KEEPALIVE
+int chacha_ctx_init(const char *key_hex) {
+    unsigned char key[32];
+    if (!key_hex || strlen(key_hex) != 64 || hexc_decode(key_hex, 64, key) != 32) return -1;
+
+    if (chacha_ready) mbedtls_chachapoly_free(&chacha_ctx);
+    mbedtls_chachapoly_init(&chacha_ctx);
+    int ret = mbedtls_chachapoly_setkey(&chacha_ctx, key);
+    memset(key, 0, sizeof(key));
+    chacha_ready = (ret == 0);
+    return chacha_ready ? 0 : -1;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void chacha_ctx_free(void) {
+    if (chacha_ready) mbedtls_chachapoly_free(&chacha_ctx);
+    chacha_ready = 0;
+}
+
+/**
+ * As gcm_encrypt_into, under the ChaCha20-Poly1305 key.
+ * Returns the byte count written (pt_len + 28), or -1.
+ */
+EMSCRIPTEN_KEEPALIVE
+int chacha_encrypt_into(const unsigned char *nonce, const unsigned char *pt, int pt_len,
+                        unsigned char *out) {
+    if (!chacha_ready || !nonce || (!pt && pt_len) || pt_len < 0 || !out) return -1;
+
+    memcpy(out, nonce, GCM_NONCE_LEN);
+    int ret = mbedtls_chachapoly_encrypt_and_tag(&chacha_ctx, (size_t)pt_len, nonce, NULL, 0, pt,
+                                                 out + GCM_NONCE_LEN, out + GCM_NONCE_LEN + pt_len);
+    return ret == 0 ? pt_len + GCM_NONCE_LEN + GCM_TAG_LEN : -1;
+}
+
+/**
+ * As gcm_encrypt_batch, under the ChaCha20-Poly1305 key.
+ */
+EMSCRIPTEN_KEEPALIVE
+int chacha_encrypt_batch(const unsigned char *nonces, const unsigned char *pts, int pt_stride,
+                         int count, unsigned char *out) {
+    if (count < 0 || pt_stride < 0) return -1;
+    int rec = pt_stride + GCM_NONCE_LEN + GCM_TAG_LEN;
+    for (int i = 0; i < count; i++) {
+        if (chacha_encrypt_into(nonces + (size_t)i * GCM_NONCE_LEN, pts + (size_t)i * pt_stride,
+                                pt_stride, out + (size_t)i * rec) < 0)
+            return -1;
+    }
+    return count * rec;
+}
+
+/**
+ * Seals iters 128-byte payloads (one 156-byte packet each) with the keyed
+ * suite, 1 = AES-256-GCM, 2 = ChaCha20-Poly1305 (SECURITY_LEVEL values).
+ * Returns packets per second, or -1 if that suite has no key yet.
+ */
+EMSCRIPTEN_KEEPALIVE
+double aead_bench(int suite, int iters) {
+    unsigned char nonce[GCM_NONCE_LEN] = {0}, pt[128], out[128 + GCM_NONCE_LEN + GCM_TAG_LEN];
+    int (*seal)(const unsigned char *, const unsigned char *, int, unsigned char *) =
+        suite == 2 ? chacha_encrypt_into : gcm_encrypt_into;
+    if (iters <= 0) iters = 1000;
+    memset(pt, 0xFF, sizeof(pt));
+
+    double t0 = emscripten_get_now();
+    for (int i = 0; i < iters; i++) {
+        memcpy(nonce + GCM_NONCE_LEN - sizeof(i), &i, sizeof(i));
+        if (seal(nonce, pt, (int)sizeof(pt), out) < 0) return -1;
+    }
+    double ms = emscripten_get_now() - t0;
+    return ms > 0 ? iters * 1000.0 / ms : -1;
+}
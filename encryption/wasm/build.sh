@@ -7,6 +7,8 @@ SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
 cd "$SCRIPT_DIR"
 OUT_DIR="../../controller-ui/public/wasm"
 MBEDTLS_DIR="mbedtls"
+HEXC_DIR="../../ECE/robot/components/hex_codec"
+CODEC_DIR="../../ECE/robot/components/cmd_codec"
 
 # Check for emcc
 if ! command -v emcc &> /dev/null; then
@@ -28,38 +30,58 @@ if [ ! -d "$MBEDTLS_DIR" ]; then
     git clone --depth 1 --branch "$MBEDTLS_TAG" https://github.com/Mbed-TLS/mbedtls.git "$MBEDTLS_DIR"
 fi
 
-# Build mbedtls with Emscripten
-cd "$MBEDTLS_DIR"
-MBEDTLS_BUILD="build"
-if [ ! -f "$MBEDTLS_BUILD/library/libmbedcrypto.a" ]; then
-    echo "Building mbedtls..."
-    rm -rf "$MBEDTLS_BUILD" && mkdir "$MBEDTLS_BUILD" && cd "$MBEDTLS_BUILD"
-    emcmake cmake .. \
-        -DCMAKE_POLICY_VERSION_MINIMUM=3.5 \
-        -DUSE_SHARED_MBEDTLS_LIBRARY=Off \
-        -DENABLE_PROGRAMS=Off \
-        -DENABLE_TESTING=Off
-    emmake make -j4
-    cd ..
-fi
-cd "$SCRIPT_DIR"
+# Build mbedtls with Emscripten: once plain, once with -msimd128 so the
+# compiler may auto-vectorise the GCM / ChaCha inner loops as well
+build_mbedtls() {   # <build dir> <extra CFLAGS>
+    if [ ! -f "$MBEDTLS_DIR/$1/library/libmbedcrypto.a" ]; then
+        echo "Building mbedtls ($1)..."
+        rm -rf "$MBEDTLS_DIR/$1" && mkdir "$MBEDTLS_DIR/$1"
+        (cd "$MBEDTLS_DIR/$1" && emcmake cmake .. \
+            -DCMAKE_POLICY_VERSION_MINIMUM=3.5 \
+            -DCMAKE_C_FLAGS="$2" \
+            -DUSE_SHARED_MBEDTLS_LIBRARY=Off \
+            -DENABLE_PROGRAMS=Off \
+            -DENABLE_TESTING=Off && emmake make -j4)
+    fi
+    if [ ! -f "$MBEDTLS_DIR/$1/library/libmbedcrypto.a" ]; then
+        echo "Error: mbedtls build failed - $1/library/libmbedcrypto.a not found"
+        exit 1
+    fi
+}
+build_mbedtls build ""
+build_mbedtls build-simd "-O3 -msimd128"
 
-MBA="$(find "$MBEDTLS_DIR" -name "libmbedcrypto.a" 2>/dev/null | head -1)"
-if [ -z "$MBA" ]; then
-    echo "Error: mbedtls build failed - libmbedcrypto.a not found"
-    exit 1
-fi
+EXPORTS='["_encrypt_aes_gcm_json","_free_string","_gcm_ctx_init","_gcm_ctx_free","_gcm_encrypt_into","_gcm_encrypt_batch","_chacha_ctx_init","_chacha_ctx_free","_chacha_encrypt_into","_chacha_encrypt_batch","_aead_bench","_pack_control_hex","_pack_arm_hex","_pack_system_hex","_pack_query_hex","_malloc","_free"]'
+
+build_module() {   # <output name> <export name> <mbedtls build dir> <extra flags...>
+    local out="$1" name="$2" lib="$MBEDTLS_DIR/$3/library/libmbedcrypto.a"
+    shift 3
+    echo "Building $out wasm..."
+    emcc -O2 -Wall "$@" -I"$MBEDTLS_DIR/include" -I"$HEXC_DIR" -I"$CODEC_DIR" \
+        -s MODULARIZE=1 -s "EXPORT_NAME=\"$name\"" \
+        -s EXPORTED_FUNCTIONS="$EXPORTS" \
+        -s EXPORTED_RUNTIME_METHODS='["ccall","cwrap","UTF8ToString","HEAPU8"]' \
+        -s ALLOW_MEMORY_GROWTH=1 -s ASSERTIONS=0 \
+        -o "$OUT_DIR/$out.js" \
+        aes_gcm_encrypt_wasm.c cmd_codec_wasm.c "$HEXC_DIR/hex_codec.c" \
+        "$lib"
+}
 
-# Build our WASM module
+# Baseline for every browser, and the SIMD build controller-ui loads when
+# WebAssembly.validate() accepts a v128 probe
 mkdir -p "$OUT_DIR"
-echo "Building aes_gcm_encrypt wasm..."
-emcc -O2 -Wall -I"$MBEDTLS_DIR/include" \
-    -s MODULARIZE=1 -s 'EXPORT_NAME="AesGcmEncrypt"' \
-    -s EXPORTED_FUNCTIONS='["_encrypt_aes_gcm_json","_free_string","_malloc","_free"]' \
-    -s EXPORTED_RUNTIME_METHODS='["ccall","cwrap","UTF8ToString"]' \
-    -s ALLOW_MEMORY_GROWTH=1 -s ASSERTIONS=0 \
-    -o "$OUT_DIR/aes_gcm_encrypt.js" \
-    aes_gcm_encrypt_wasm.c \
-    "$MBA"
+build_module aes_gcm_encrypt      AesGcmEncrypt     build
+build_module aes_gcm_encrypt_simd AesGcmEncryptSimd build-simd -O3 -msimd128
+
+# Codec alone (no mbedtls) for the attacker-ui decode worker, as an ES module
+CODEC_OUT_DIR="../../attacker-ui/public/wasm"
+mkdir -p "$CODEC_OUT_DIR"
+echo "Building cmd_codec wasm..."
+emcc -O2 -Wall -I"$HEXC_DIR" -I"$CODEC_DIR" \
+    -s MODULARIZE=1 -s EXPORT_ES6=1 -s ENVIRONMENT=web,worker -s 'EXPORT_NAME="CmdCodec"' \
+    -s EXPORTED_FUNCTIONS='["_describe_value","_pack_control_hex","_pack_arm_hex","_pack_system_hex","_pack_query_hex","_malloc","_free"]' \
+    -s EXPORTED_RUNTIME_METHODS='["UTF8ToString","HEAPU8"]' -s ASSERTIONS=0 \
+    -o "$CODEC_OUT_DIR/cmd_codec.mjs" \
+    cmd_codec_wasm.c "$HEXC_DIR/hex_codec.c"
 
-echo "Done. Output: $OUT_DIR/aes_gcm_encrypt.js and aes_gcm_encrypt.wasm"
+echo "Done. Output: $OUT_DIR/aes_gcm_encrypt{,_simd}.js and .wasm, $CODEC_OUT_DIR/cmd_codec.mjs and .wasm"
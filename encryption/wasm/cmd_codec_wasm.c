@@ -0,0 +1,154 @@
+/**
+ * Command word packing for WebAssembly (Emscripten)
+ * Same field table as the GS bridge and robot firmware (cmd_codec.h).
+ * Exports: pack_*_hex(...) -> 16 hex chars (the word's 8 wire bytes), valid
+ * until the next call. Out-of-range values are truncated to the field width.
+ * describe_value(v, n) -> one line of decoded fields for a sniffed ATT value
+ * (attacker-ui decode worker), also valid until the next call.
+ */
+#include <emscripten.h>
+#include <stdio.h>
+#include <string.h>
+#include "cmd_codec.h"
+#include "hex_codec.h"
+
+// ATT value framings (GS cmd_parser.h): one word, tagged word, batch
+#define WORD_TAG    0xB6
+#define BATCH_MAGIC 0xB7
+#define BATCH_MAX   15
+
+static char word_hex[17];
+static char value_desc[BATCH_MAX * 64];
+
+static const char *word_to_hex(uint64_t w){
+    robot_bt_packet_t pkt;
+    pkt.raw = w;
+    hexc_encode(pkt.bytes, 8, word_hex, 0);
+    return word_hex;
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char *pack_control_hex(int pl, int w, int a, int s, int d, int speed, int id){
+    cmd_ctrl_t c = { .pl = pl, .type = CONTROL_CMD, .w = w, .a = a, .s = s, .d = d,
+                     .speed = speed, .id = id };
+    return word_to_hex(cmd_ctrl_pack(&c));
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char *pack_arm_hex(int pl, int up, int down, int left, int right, int in, int out,
+                         int speed, int reset, int id){
+    cmd_arm_t c = { .pl = pl, .type = ARM_CMD, .up = up, .down = down, .left = left,
+                    .right = right, .in = in, .out = out, .speed = speed, .reset = reset, .id = id };
+    return word_to_hex(cmd_arm_pack(&c));
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char *pack_system_hex(int pl, int instruction, int ac, int id, unsigned specific){
+    cmd_sys_t c = { .pl = pl, .type = System_CMD, .instruction = instruction, .ac = ac,
+                    .id = id, .specific = specific };
+    return word_to_hex(cmd_sys_pack(&c));
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char *pack_query_hex(int pl, int instruction, int id, int r){
+    cmd_query_t c = { .pl = pl, .type = Query_CMD, .instruction = instruction, .id = id, .r = r };
+    return word_to_hex(cmd_query_pack(&c));
+}
+
+// Words carried by one ATT value, as the GS sniffer splits them
+// (sniff_value_words in pcap_ingest.c); 0 = not robot words
+static int value_words(const uint8_t *v, int n, robot_bt_packet_t *words){
+    if (n == 8) { memcpy(words[0].bytes, v, 8); return 1; }
+    if (n == 9 && v[0] == WORD_TAG) { memcpy(words[0].bytes, v + 1, 8); return 1; }
+    if (n >= 2 && v[0] == BATCH_MAGIC) {
+        int k = v[1];
+        if (k < 1 || k > BATCH_MAX || n != 2 + k * 8) return 0;
+        for (int i = 0; i < k; i++) memcpy(words[i].bytes, v + 2 + i * 8, 8);
+        return k;
+    }
+    if (n == 16 && hexc_decode((const char *)v, 16, words[0].bytes) == 8) return 1;
+    return 0;
+}
+
+static int describe_word(uint64_t w, char *out, size_t cap){
+    switch (cmd_word_type(w)) {
+    case CONTROL_CMD: {
+        cmd_ctrl_t c; cmd_ctrl_unpack(w, &c);
+        return snprintf(out, cap, "C id=%u %s%s%s%s s=%u", (unsigned)c.id,
+                        c.w ? "W" : "", c.a ? "A" : "", c.s ? "S" : "", c.d ? "D" : "", (unsigned)c.speed);
+    }
+    case ARM_CMD: {
+        cmd_arm_t c; cmd_arm_unpack(w, &c);
+        return snprintf(out, cap, "A id=%u %s%s%s%s%s%s s=%u%s", (unsigned)c.id,
+                        c.up ? "U" : "", c.down ? "D" : "", c.left ? "L" : "", c.right ? "R" : "",
+                        c.in ? "I" : "", c.out ? "O" : "", (unsigned)c.speed, c.reset ? " reset" : "");
+    }
+    case System_CMD: {
+        cmd_sys_t c; cmd_sys_unpack(w, &c);
+        return snprintf(out, cap, "SYS id=%u ins=%u spec=%u", (unsigned)c.id, (unsigned)c.instruction,
+                        (unsigned)c.specific);
+    }
+    case Query_CMD: {
+        cmd_query_t c; cmd_query_unpack(w, &c);
+        return snprintf(out, cap, "Q id=%u ins=%u", (unsigned)c.id, (unsigned)c.instruction);
+    }
+    case ROBOT_UPDATE_CMD:
+        if (cmd_nav_get_part(w) == 0) {
+            cmd_nav_t c; cmd_nav_unpack(w, &c);
+            return snprintf(out, cap, "NAV x=%d y=%d z=%d", (int)c.pos_x, (int)c.pos_y, (int)c.pos_z);
+        }
+        return snprintf(out, cap, "RU part=%u", (unsigned)cmd_nav_get_part(w));
+    case HEALTH_CMD: {
+        cmd_health_t c; cmd_health_unpack(w, &c);
+        return snprintf(out, cap, "HR batt=%u drops=%u%s", (unsigned)c.battery, (unsigned)c.tx_drops,
+                        c.unchanged ? " hb" : "");
+    }
+    case ACK_CMD: {
+        cmd_ack_t c; cmd_ack_unpack(w, &c);
+        return snprintf(out, cap, "ACK id=%u res=%u", (unsigned)c.id, (unsigned)c.result_code);
+    }
+    case HPR_CMD:
+        return snprintf(out, cap, "HPR alert=%u", (unsigned)cmd_hpr_get_alert_type(w));
+    case ARM_TARGET_CMD: {
+        cmd_armt_t c; cmd_armt_unpack(w, &c);
+        return snprintf(out, cap, "AT id=%u x=%d y=%d z=%d s=%u", (unsigned)c.id, (int)c.x, (int)c.y, (int)c.z,
+                        (unsigned)c.speed);
+    }
+    case TRAJ_CMD:
+        if (cmd_trajd_get_op(w) == TRAJ_OP_DRIVE) {
+            cmd_trajd_t c; cmd_trajd_unpack(w, &c);
+            return snprintf(out, cap, "TD idx=%u ms=%u fl=%d fr=%d bl=%d br=%d", (unsigned)c.idx, (unsigned)c.ms,
+                            (int)c.fl, (int)c.fr, (int)c.bl, (int)c.br);
+        }
+        if (cmd_trajd_get_op(w) == TRAJ_OP_ARM) {
+            cmd_traja_t c; cmd_traja_unpack(w, &c);
+            return snprintf(out, cap, "TA idx=%u x=%d y=%d z=%d s=%u", (unsigned)c.idx, (int)c.x, (int)c.y,
+                            (int)c.z, (unsigned)c.speed);
+        }
+        {
+            cmd_trajc_t c; cmd_trajc_unpack(w, &c);
+            return snprintf(out, cap, "T%s id=%u count=%u crc=%04x", c.op == TRAJ_OP_RUN ? "RUN" : "ABORT",
+                            (unsigned)c.id, (unsigned)c.count, (unsigned)c.crc);
+        }
+    case FEC_CMD: {
+        cmd_fec_t c; cmd_fec_unpack(w, &c);
+        return snprintf(out, cap, "FEC group=%u index=%u row=%u k=%u slots=%u", (unsigned)c.group,
+                        (unsigned)c.index, (unsigned)c.row, (unsigned)c.k, (unsigned)c.slots);
+    }
+    default:
+        return snprintf(out, cap, "type=%u", (unsigned)cmd_word_type(w));
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char *describe_value(const uint8_t *v, int n){
+    robot_bt_packet_t words[BATCH_MAX];
+    int k = value_words(v, n, words);
+    size_t len = 0;
+    value_desc[0] = '\0';
+    for (int i = 0; i < k && len < sizeof(value_desc); i++) {
+        if (i) len += snprintf(value_desc + len, sizeof(value_desc) - len, "; ");
+        if (len < sizeof(value_desc)) len += describe_word(words[i].raw, value_desc + len, sizeof(value_desc) - len);
+    }
+    return value_desc;
+}
@@ -16,6 +16,6 @@ echo "Running make all..."
 make all
 
 echo "Running GS Bridge"
-./gs_bridge2.o
+./gs_bridge
 
 echo "Build complete."
\ No newline at end of file
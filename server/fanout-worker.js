@@ -0,0 +1,86 @@
+// fanout-worker.js
+// -----------------------------------------------------------------------------
+// WS_FANOUT=worker for production-server.js: telemetry viewers on their own
+// thread and port (TELEMETRY_PORT), so a burst of bridge reports going out to
+// many viewers never sits in front of an operator command on the main
+// thread's event loop.
+//
+// The main thread keeps the bridge socket and the control endpoint and pushes
+// every bridge frame (and every status message, RING_FLAG set) into a
+// SabRing; this worker pops them and fans them out with the same SUB filter
+// and slow-client handling as the main endpoint (ws-fanout.js). Viewers here
+// may SUB and ping; commands are refused, they go to PORT.
+// Every second the worker posts { clients, dropped } to the main thread for
+// /health and /metrics.
+// -----------------------------------------------------------------------------
+
+import { workerData, parentPort } from "worker_threads";
+import { createServer } from "http";
+import { createServer as createTlsServer } from "https";
+import { WebSocketServer } from "ws";
+import fs from "fs";
+import { SabRing } from "./sab-ring.js";
+import { Fanout, frameMeta, parseSub } from "./ws-fanout.js";
+
+const { sab, port, bind, cert, key } = workerData;
+const STATS_MS = 1000;
+
+const ring = new SabRing(sab);
+const server = cert
+  ? createTlsServer({ cert: fs.readFileSync(cert), key: fs.readFileSync(key) })
+  : createServer();
+const wss = new WebSocketServer({ server });
+const fanout = new Fanout(() => wss.clients);
+
+function onMessage(ws, raw) {
+  let data;
+  try {
+    data = JSON.parse(raw.toString());
+  } catch {
+    data = null;
+  }
+  if (data && (data.type ?? data.T) === "SUB") {
+    const r = parseSub(data);
+    if (r.err) {
+      ws.send(JSON.stringify({ type: "ERR", msg: r.err, ts: Date.now() }));
+      return;
+    }
+    ws.sub = r.sub;
+    ws.send(JSON.stringify({ type: "SUB", topics: [...r.sub.topics], robots: data.robots ?? "all", ts: Date.now() }));
+    return;
+  }
+  if (data && data.type === "ping") {
+    ws.send(JSON.stringify({ type: "pong", ts: Date.now() }));
+    return;
+  }
+  ws.send(JSON.stringify({ type: "ERR", msg: "telemetry endpoint: send commands to the control port", ts: Date.now() }));
+}
+
+wss.on("connection", (ws) => {
+  ws.send(JSON.stringify({ type: "hello", telemetry: true, ts: Date.now() }));
+  ws.sub = null;                                // Everything until it sends SUB
+  ws.pend = new Map();
+  ws.on("message", (raw) => onMessage(ws, raw));
+  ws.on("error", () => {});
+});
+
+// Drain what is there, then sleep until the main thread pushes more
+async function pump() {
+  for (;;) {
+    let rec;
+    while ((rec = ring.pop()) !== null) {
+      fanout.broadcast(rec.buf, rec.flag ? null : frameMeta(rec.buf));
+    }
+    await ring.wait();
+  }
+}
+
+server.listen(port, bind, () => {
+  console.log(`📡 Telemetry WS:  ${cert ? "wss" : "ws"}://${bind}:${port} (fan-out worker)`);
+});
+
+setInterval(() => {
+  parentPort.postMessage({ clients: wss.clients.size, dropped: fanout.dropped + ring.dropped });
+}, STATS_MS).unref();
+
+pump();
@@ -0,0 +1,245 @@
+// fleet-gateway.js
+// -----------------------------------------------------------------------------
+// Gateway mode for production-server.js: one operator endpoint in front of
+// several GS bridges, each on its own ground station and board. Every bridge
+// is reached over TCP (GS_TCP_PORT on the bridge), plain or TLS, with the
+// same [4-byte big-endian length][frame] stream as the local UDS link:
+//
+//   GS_BRIDGES="lab=10.0.0.5:7001,field=tls://10.0.0.6:7001"
+//
+// Bridge n (list order) drives fleet robots n*ROBOTS_PER_BRIDGE and up: its
+// local robot r (top bits of a command's 11-bit ID, ECE/GS pmod_esp32.h) is
+// fleet robot n*ROBOTS_PER_BRIDGE + r. route() maps a fleet robot to its
+// bridge, and fleetFrame() turns the "robot" of a bridge report back into the
+// fleet number and names the bridge, so the merged telemetry reads as one
+// fleet.
+//
+// Each bridge has its own connection, reconnect backoff and outbound queue.
+// A frame goes straight to the socket while the socket's own buffer is under
+// BRIDGE_HIGH_WATER; past that it waits in the bridge's queue, which holds at
+// most BRIDGE_QUEUE_MAX frames (the oldest goes, counted in dropped). A slow
+// or unreachable site only ever backs up its own queue; a bridge that is
+// down refuses the frame at once instead of holding commands for later.
+// -----------------------------------------------------------------------------
+
+import net from "net";
+import tls from "tls";
+import fs from "fs";
+
+export const ROBOTS_PER_BRIDGE = 4;          // BLE_LINKS_MAX on the bridge
+export const ROBOT_ID_SHIFT = 9;             // 11-bit ID: robot in the top two bits
+const ROBOT_ID_TAG_MASK = (1 << ROBOT_ID_SHIFT) - 1;
+
+const BRIDGE_HIGH_WATER = 64 * 1024;         // Socket buffer before frames queue here
+const BRIDGE_QUEUE_MAX = 256;                // Queued frames per bridge
+const BRIDGE_FRAME_MAX = 1024 * 1024;        // Same limit as the bridge's UDS_MAX_FRAME
+const RETRY_MIN_MS = 1000;
+const RETRY_MAX_MS = 10000;
+
+// "name=host:port" or "name=tls://host:port"; a missing name is the address
+export function parseBridges(spec) {
+  const out = [];
+  for (const item of String(spec).split(",").map((s) => s.trim()).filter(Boolean)) {
+    const eq = item.indexOf("=");
+    const name = eq > 0 ? item.slice(0, eq) : item;
+    let addr = eq > 0 ? item.slice(eq + 1) : item;
+    const useTls = addr.startsWith("tls://");
+    if (useTls) addr = addr.slice(6);
+    else if (addr.startsWith("tcp://")) addr = addr.slice(6);
+    const colon = addr.lastIndexOf(":");
+    const port = Number(addr.slice(colon + 1));
+    if (colon <= 0 || !Number.isInteger(port) || port <= 0 || port > 65535) {
+      throw new Error(`GS_BRIDGES: bad address "${item}"`);
+    }
+    if (out.some((b) => b.name === name)) throw new Error(`GS_BRIDGES: "${name}" listed twice`);
+    out.push({ name, host: addr.slice(0, colon), port, tls: useTls });
+  }
+  return out;
+}
+
+// A bridge's JSON object as the fleet sees it: "bridge":"<name>" first, so
+// replies and ACKs (which carry the bridge-local ID only) say where they
+// came from, and the fleet number in place of a report's local "robot" (read
+// off the head only, like frameMeta in production-server.js). One copy.
+const ROBOT_FIELD_RE = /"robot":(\d+)/;
+
+export function fleetFrame(payload, bridge) {
+  if (payload[0] !== 0x7b) return payload;   // Arrays pass as they are
+  const parts = [payload[1] === 0x7d ? bridge.tag.subarray(0, -1) : bridge.tag];
+  const head = payload.toString("latin1", 0, Math.min(payload.length, 128));
+  const m = bridge.base ? ROBOT_FIELD_RE.exec(head) : null;
+  if (m) {
+    const at = m.index + 8;                  // After '"robot":'
+    parts.push(payload.subarray(1, at), Buffer.from(String(bridge.base + Number(m[1])), "latin1"),
+               payload.subarray(at + m[1].length));
+  } else {
+    parts.push(payload.subarray(1));
+  }
+  return Buffer.concat(parts);
+}
+
+class BridgeLink {
+  constructor(gw, index, spec) {
+    this.gw = gw;
+    this.index = index;
+    this.name = spec.name;
+    this.host = spec.host;
+    this.port = spec.port;
+    this.tls = spec.tls;
+    this.base = index * ROBOTS_PER_BRIDGE;   // Fleet number of local robot 0
+    this.tag = Buffer.from(`{"bridge":${JSON.stringify(spec.name)},`, "utf8");
+    this.sock = null;
+    this.up = false;
+    this.queue = [];
+    this.dropped = 0;
+    this.retryMs = RETRY_MIN_MS;
+    this.retryTimer = null;
+    this.rxChunks = [];
+    this.rxLen = 0;
+  }
+
+  connect() {
+    this.retryTimer = null;
+    const opts = { host: this.host, port: this.port };
+    const sock = this.tls
+      ? tls.connect({ ...opts, ca: this.gw.ca, servername: net.isIP(this.host) ? undefined : this.host })
+      : net.createConnection(opts);
+    this.sock = sock;
+    sock.setNoDelay(true);
+    sock.once(this.tls ? "secureConnect" : "connect", () => {
+      this.up = true;
+      this.retryMs = RETRY_MIN_MS;
+      this.rxChunks = [];
+      this.rxLen = 0;
+      this.gw.onUp(this);
+    });
+    sock.on("data", (chunk) => this.onData(chunk));
+    sock.on("drain", () => this.flush());
+    sock.on("error", (err) => this.gw.onError(this, err));
+    sock.on("close", () => this.onClose());
+  }
+
+  onClose() {
+    const was = this.up;
+    this.up = false;
+    this.sock = null;
+    this.dropped += this.queue.length;       // Commands for a lost link are not replayed later
+    this.queue = [];
+    if (was) this.gw.onDown(this);
+    if (this.gw.closing) return;
+    this.retryTimer = setTimeout(() => this.connect(), this.retryMs);
+    this.retryMs = Math.min(this.retryMs * 2, RETRY_MAX_MS);
+  }
+
+  onData(chunk) {
+    this.rxChunks.push(chunk);
+    this.rxLen += chunk.length;
+    while (this.rxLen >= 4) {
+      const head = this.rxChunks.length === 1 ? this.rxChunks[0] : Buffer.concat(this.rxChunks);
+      this.rxChunks = [head];
+      const len = head.readUInt32BE(0);
+      if (len === 0 || len > BRIDGE_FRAME_MAX) {
+        console.error(`⚠️  Bad frame length ${len} from bridge ${this.name} -> reconnecting`);
+        this.sock.destroy();
+        return;
+      }
+      if (this.rxLen < 4 + len) return;      // Wait for the rest
+      const payload = head.subarray(4, 4 + len);
+      const rest = head.subarray(4 + len);
+      this.rxChunks = rest.length ? [rest] : [];
+      this.rxLen = rest.length;
+      this.gw.onFrame(this, payload);
+    }
+  }
+
+  // One length-prefixed frame; false if the bridge is down
+  send(frame) {
+    if (!this.up) return false;
+    if (this.queue.length === 0 && this.sock.writableLength < BRIDGE_HIGH_WATER) {
+      this.sock.write(frame);
+      return true;
+    }
+    if (this.queue.length >= BRIDGE_QUEUE_MAX) {
+      this.queue.shift();
+      this.dropped++;
+    }
+    this.queue.push(frame);
+    return true;
+  }
+
+  flush() {
+    while (this.up && this.queue.length && this.sock.writableLength < BRIDGE_HIGH_WATER) {
+      this.sock.write(this.queue.shift());
+    }
+  }
+
+  status() {
+    return {
+      name: this.name,
+      addr: `${this.tls ? "tls" : "tcp"}://${this.host}:${this.port}`,
+      robots: [this.base, this.base + ROBOTS_PER_BRIDGE - 1],
+      connected: this.up,
+      queued: this.queue.length,
+      buffered: this.sock ? this.sock.writableLength : 0,
+      dropped: this.dropped,
+    };
+  }
+}
+
+// handlers: onFrame(bridge, payload), onUp(bridge), onDown(bridge),
+// onError(bridge, err); bridge.index / bridge.name identify the site
+export class FleetGateway {
+  constructor(specs, handlers, { caFile = "" } = {}) {
+    this.ca = caFile ? fs.readFileSync(caFile) : undefined;
+    this.closing = false;
+    this.onFrame = handlers.onFrame;
+    this.onUp = handlers.onUp;
+    this.onDown = handlers.onDown;
+    this.onError = handlers.onError;
+    this.bridges = specs.map((s, i) => new BridgeLink(this, i, s));
+  }
+
+  start() {
+    for (const b of this.bridges) b.connect();
+  }
+
+  close() {
+    this.closing = true;
+    for (const b of this.bridges) {
+      clearTimeout(b.retryTimer);
+      if (b.sock) b.sock.end();
+    }
+  }
+
+  byName(name) {
+    return this.bridges.find((b) => b.name === name) || null;
+  }
+
+  // Fleet robot -> { bridge, local }, null if no bridge drives it
+  route(robot) {
+    if (!Number.isInteger(robot) || robot < 0) return null;
+    const bridge = this.bridges[Math.floor(robot / ROBOTS_PER_BRIDGE)];
+    return bridge ? { bridge, local: robot % ROBOTS_PER_BRIDGE } : null;
+  }
+
+  // A command object addressed to a local robot: "robot" becomes the local
+  // index (TSQ reads it) and the robot bits of a numeric ID follow it
+  static localize(obj, local) {
+    const out = { ...obj, robot: local };
+    if (Number.isInteger(out.ID)) out.ID = (out.ID & ROBOT_ID_TAG_MASK) | (local << ROBOT_ID_SHIFT);
+    return out;
+  }
+
+  sendJson(bridge, obj) {
+    const json = Buffer.from(JSON.stringify(obj), "utf8");
+    if (json.length === 0 || json.length > BRIDGE_FRAME_MAX) return false;
+    const frame = Buffer.allocUnsafe(4 + json.length);
+    frame.writeUInt32BE(json.length, 0);
+    json.copy(frame, 4);
+    return bridge.send(frame);
+  }
+
+  status() {
+    return this.bridges.map((b) => b.status());
+  }
+}
@@ -7,12 +7,23 @@
 //   [4-byte big-endian length] + [JSON bytes]
 //
 // Also forwards robot reports (SR/HR/A/HPR, etc.) coming back from C to all WS clients.
+//
+// Gateway mode (GS_BRIDGES): the same endpoint in front of several bridges
+// reached over TCP/TLS instead of one local socket; see fleet-gateway.js.
 // -----------------------------------------------------------------------------
 
 import express from "express";
 import { createServer } from "http";
+import { createServer as createTlsServer } from "https";
 import { WebSocketServer } from "ws";
 import net from "net";
+import fs from "fs";
+import { createRequire } from "module";
+import { Worker } from "worker_threads";
+import { FleetGateway, fleetFrame, parseBridges } from "./fleet-gateway.js";
+import { createUwsEngine } from "./ws-uws.js";
+import { Fanout, WS_TOPICS, frameMeta, parseSub } from "./ws-fanout.js";
+import { SabRing } from "./sab-ring.js";
 
 // ------------------------- Config -------------------------
 
@@ -20,6 +31,20 @@ const PORT = Number(process.env.PORT || 3001);
 const BIND = process.env.BIND || "0.0.0.0";
 const SOCKET_PATH = process.env.SOCKET_PATH || "/tmp/gs_bridge.sock";
 
+// Optional: "shm" trades frames with the bridge through a pair of shared-memory
+// rings (server/shm_ring addon, `npm run build:shm`) instead of the socket.
+// Same length-prefixed framing; SOCKET_PATH still carries the handshake.
+const UDS_TRANSPORT = process.env.UDS_TRANSPORT === "shm" ? "shm" : "socket";
+const shmRing = UDS_TRANSPORT === "shm" ? createRequire(import.meta.url)("./shm_ring") : null;
+
+// Optional: gateway mode. "name=host:port,name=tls://host:port,..." are GS
+// bridges on other ground stations (GS_TCP_PORT on each); commands are routed
+// by fleet robot number and their telemetry merged. GS_BRIDGE_CA verifies
+// the bridges' TLS certificates. SOCKET_PATH is not used.
+const GS_BRIDGES = parseBridges(process.env.GS_BRIDGES || "");
+const GS_BRIDGE_CA = process.env.GS_BRIDGE_CA || "";
+const GATEWAY = GS_BRIDGES.length > 0;
+
 // If your UI sends just "direction": "w/a/s/d", we map it to a Control (C) command:
 const DEFAULT_SPEED = Number(process.env.DEFAULT_SPEED || 50);          // 0..100
 const DEFAULT_PRIORITY = Number(process.env.DEFAULT_PRIORITY || 0);     // 0..3
@@ -27,43 +52,385 @@ const DEFAULT_PRIORITY = Number(process.env.DEFAULT_PRIORITY || 0);     // 0..3
 // Optional: if UI sends "speed" in direction messages, allow it:
 const ALLOW_SPEED_OVERRIDE = (process.env.ALLOW_SPEED_OVERRIDE || "1") !== "0";
 
+// Optional: negotiate the binary UDS mode ("bin1") so drive commands go to the
+// bridge pre-packed instead of as JSON. JSON stays in use for everything else.
+const UDS_BINARY = (process.env.UDS_BINARY || "0") !== "0";
+
+// Optional: accept the "rbw1" WS sub-protocol — UI sends each command as a
+// binary [seq u16 BE][8-byte command word] frame that is passed to the
+// bridge's binary UDS mode untouched; acks come back batched. Implies bin1.
+const WS_BINARY = (process.env.WS_BINARY || "1") !== "0";
+
+// Optional: serve HTTPS/WSS so the UI link is protected by TLS. With GS_SEAL
+// the UI sends plaintext commands over that link and the bridge performs the
+// one GCM seal toward the robot (no browser-side encrypt, no GS decrypt).
+const TLS_CERT = process.env.TLS_CERT || "";
+const TLS_KEY = process.env.TLS_KEY || "";
+const USE_TLS = Boolean(TLS_CERT && TLS_KEY);
+const GS_SEAL = (process.env.GS_SEAL || (USE_TLS ? "1" : "0")) !== "0";
+
+// Optional: WS_ENGINE=uws serves the UI endpoint from uWebSockets.js (see
+// ws-uws.js): pub/sub topics per SUB and one framing per broadcast, for
+// hundreds of viewers. The WebSocket keeps PORT; Express (/health,
+// /metrics) moves to HTTP_PORT.
+const WS_ENGINE = process.env.WS_ENGINE === "uws" ? "uws" : "ws";
+const HTTP_PORT = Number(process.env.HTTP_PORT || PORT + 1);
+
+// Optional: WS_FANOUT=worker moves telemetry viewers to a worker thread on
+// TELEMETRY_PORT (fanout-worker.js), fed through a SharedArrayBuffer ring.
+// PORT stays the control endpoint: commands, their acks and status only.
+const WS_FANOUT = process.env.WS_FANOUT === "worker" ? "worker" : "inline";
+const TELEMETRY_PORT = Number(process.env.TELEMETRY_PORT || PORT + 2);
+const FANOUT_RING_BYTES = 4 * 1024 * 1024;
+
 // ------------------------- Express -------------------------
 
 const app = express();
 app.use(express.json({ limit: "1mb" }));
 
-// Health-check endpoint
-app.get("/health", (_req, res) => {
+// Health-check endpoint; ?format=prometheus (or /metrics) for a scrape target
+app.get("/health", (req, res) => {
+  if (req.query.format === "prometheus") return sendPrometheus(res);
   res.json({
     status: "ok",
     uptime_s: process.uptime(),
-    wsClients: wss.clients.size,
-    uds: {
+    wsEngine: WS_ENGINE,
+    wsClients: wsClientCount(),
+    wsDropped: fanout.dropped + (uws ? uws.dropped : 0),
+    telemetry: fanWorker ? { port: TELEMETRY_PORT, ...fanStats } : undefined,
+    uds: GATEWAY ? undefined : {
       path: SOCKET_PATH,
+      transport: UDS_TRANSPORT,
       connected: Boolean(cSocket && !cSocket.destroyed),
     },
+    bridges: GATEWAY ? gateway.status() : undefined,
+    latency: latSnapshot(),
   });
 });
 
+app.get("/metrics", (_req, res) => sendPrometheus(res));
+
+// ------------------------- Latency histograms -------------------------
+// Per-stage command latency, microseconds. ws_to_uds is measured here; the
+// GS and robot stages come from the bridge's TRACE records (GS_TRACE=1 on
+// the bridge, TRACE_LAT=1 in the firmware for the robot.* stages). Every
+// process times its own stages on its own monotonic clock.
+
+const LAT_BOUNDS_US = [100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000];
+const latStages = new Map();
+
+function latRecord(stage, us) {
+  let h = latStages.get(stage);
+  if (!h) {
+    h = { count: 0, sum: 0, max: 0, buckets: new Array(LAT_BOUNDS_US.length + 1).fill(0) };
+    latStages.set(stage, h);
+  }
+  let i = 0;
+  while (i < LAT_BOUNDS_US.length && us > LAT_BOUNDS_US[i]) i++;
+  h.buckets[i]++;
+  h.count++;
+  h.sum += us;
+  if (us > h.max) h.max = us;
+}
+
+// Approximate percentile: upper bound of the bucket holding it
+function latPercentile(h, p) {
+  let want = Math.ceil(h.count * p);
+  for (let i = 0; i < h.buckets.length; i++) {
+    want -= h.buckets[i];
+    if (want <= 0) return i < LAT_BOUNDS_US.length ? Math.min(LAT_BOUNDS_US[i], h.max) : h.max;
+  }
+  return h.max;
+}
+
+function latSnapshot() {
+  const stages = {};
+  for (const [name, h] of latStages) {
+    stages[name] = {
+      count: h.count,
+      mean_us: Math.round(h.sum / h.count),
+      p50_us: latPercentile(h, 0.5),
+      p99_us: latPercentile(h, 0.99),
+      max_us: h.max,
+      buckets: h.buckets,
+    };
+  }
+  return { bounds_us: LAT_BOUNDS_US, stages };
+}
+
+// Bridge TRACE record: {"type":"TRACE","parse_us":..,...,"robot":{...}}
+function latIngestTrace(rec) {
+  for (const k of ["parse_us", "queue_us", "seal_us", "at_us", "rtt_us"]) {
+    if (typeof rec[k] === "number" && !(k === "seal_us" && rec[k] === 0)) latRecord(k.slice(0, -3), rec[k]);
+  }
+  if (rec.robot) {
+    for (const [k, v] of Object.entries(rec.robot)) {
+      if (typeof v === "number") latRecord(`robot_${k.slice(0, -3)}`, v);
+    }
+  }
+}
+
+// ------------------------- Bridge metrics -------------------------
+// {"T":"METRICS"} asks the bridge for its counters, gauges and histograms
+// (includes/metrics/metrics.h). A scrape waits briefly for a fresh snapshot and
+// falls back to the last one if the bridge is down or slow. In gateway mode
+// every bridge is asked at once and its series carry a bridge="name" label.
+
+const METRICS_TIMEOUT_MS = 500;
+const metricsLocal = { last: null, waiters: [] };   // Per bridge: last snapshot, scrapes waiting
+
+function metricsResolve(m, snap) {
+  m.last = snap;
+  const waiters = m.waiters;
+  m.waiters = [];
+  for (const w of waiters) w(snap);
+}
+
+function metricsFetch(m = metricsLocal, send = udsSendJson) {
+  return new Promise((resolve) => {
+    if (!send({ T: "METRICS" })) return resolve(m.last);
+    const timer = setTimeout(() => {
+      m.waiters = m.waiters.filter((w) => w !== done);
+      resolve(m.last);
+    }, METRICS_TIMEOUT_MS);
+    const done = (snap) => {
+      clearTimeout(timer);
+      resolve(snap);
+    };
+    m.waiters.push(done);
+  });
+}
+
+// Prometheus text exposition: gs_* from the bridges, node_* from this process.
+// sources: [{ labels, up, snap, link }], one per bridge; a family's lines are
+// kept together whichever bridge they come from.
+function promRender(sources) {
+  const fams = new Map();
+  const add = (name, type, line) => {
+    let f = fams.get(name);
+    if (!f) fams.set(name, (f = [`# TYPE ${name} ${type}`]));
+    f.push(line);
+  };
+  const braces = (...parts) => {
+    const l = parts.filter(Boolean).join(",");
+    return l ? `{${l}}` : "";
+  };
+  const hist = (name, labels, le, cum, sum, count) => {
+    for (let i = 0; i < le.length; i++) add(name, "histogram", `${name}_bucket${braces(labels, `le="${le[i]}"`)} ${cum[i]}`);
+    add(name, "histogram", `${name}_bucket${braces(labels, 'le="+Inf"')} ${count}`);
+    add(name, "histogram", `${name}_sum${braces(labels)} ${sum}`);
+    add(name, "histogram", `${name}_count${braces(labels)} ${count}`);
+  };
+
+  for (const { labels, up, snap, link } of sources) {
+    add("gs_bridge_up", "gauge", `gs_bridge_up${braces(labels)} ${up ? 1 : 0}`);
+    if (link) {
+      add("node_bridge_queued", "gauge", `node_bridge_queued${braces(labels)} ${link.queued}`);
+      add("node_bridge_dropped_total", "counter", `node_bridge_dropped_total${braces(labels)} ${link.dropped}`);
+    }
+    if (!snap) continue;
+    for (const [k, v] of Object.entries(snap.counters || {})) {
+      add(`gs_${k}_total`, "counter", `gs_${k}_total${braces(labels)} ${v}`);
+    }
+    for (const [k, v] of Object.entries(snap.gauges || {})) {
+      add(`gs_${k}`, "gauge", `gs_${k}${braces(labels)} ${v}`);
+    }
+    for (const [k, h] of Object.entries(snap.histograms || {})) {
+      let acc = 0;
+      const le = [], cum = [];
+      for (const [bound, n] of h.buckets || []) {
+        acc += n;
+        le.push(bound);
+        cum.push(acc);
+      }
+      hist(`gs_${k}`, labels, le, cum, h.sum, h.count);
+    }
+  }
+  add("node_ws_clients", "gauge", `node_ws_clients ${wsClientCount()}`);
+  add("node_ws_dropped_total", "counter", `node_ws_dropped_total ${fanout.dropped}`);
+  if (fanWorker) {
+    add("node_telemetry_clients", "gauge", `node_telemetry_clients ${fanStats.clients}`);
+    add("node_telemetry_dropped_total", "counter", `node_telemetry_dropped_total ${fanStats.dropped}`);
+  }
+
+  for (const [stage, h] of latStages) {
+    let acc = 0;
+    const cum = LAT_BOUNDS_US.map((_, i) => (acc += h.buckets[i]));
+    hist("node_cmd_latency_us", `stage="${stage}"`, LAT_BOUNDS_US, cum, h.sum, h.count);
+  }
+  return [...fams.values()].flat().join("\n") + "\n";
+}
+
+async function sendPrometheus(res) {
+  let sources;
+  if (GATEWAY) {
+    sources = await Promise.all(gateway.bridges.map(async (b) => ({
+      labels: `bridge="${b.name}"`,
+      up: b.up,
+      snap: await metricsFetch(b.metrics, (obj) => gateway.sendJson(b, obj)),
+      link: b.status(),
+    })));
+  } else {
+    sources = [{ labels: "", up: cSocket && !cSocket.destroyed, snap: await metricsFetch() }];
+  }
+  res.type("text/plain; version=0.0.4").send(promRender(sources));
+}
+
+// WS receive time of the message being handled; the first UDS write for it
+// closes the ws_to_uds stage
+let wsRxAt = 0n;
+
+function udsWrite(buf) {
+  cSocket.write(buf);
+  latWsSent();
+}
+
+function latWsSent() {
+  if (wsRxAt) {
+    latRecord("ws_to_uds", Number(process.hrtime.bigint() - wsRxAt) / 1000);
+    wsRxAt = 0n;
+  }
+}
+
 // ------------------------- HTTP + WS -------------------------
 
-const server = createServer(app);
-const wss = new WebSocketServer({ server });
+const server = USE_TLS
+  ? createTlsServer({ cert: fs.readFileSync(TLS_CERT), key: fs.readFileSync(TLS_KEY) }, app)
+  : createServer(app);
+
+// ------------------------- Fan-out -------------------------
+// SUB filtering and slow-client handling: ws-fanout.js.
+// WS_ENGINE=uws keeps the same SUB semantics as engine topics instead of
+// the per-client filter (ws-uws.js).
+// WS_FANOUT=worker: every frame also goes into fanRing for the telemetry
+// worker, and this endpoint sends only WS_CONTROL_TOPICS and status, so
+// the viewers' fan-out costs the command path one copy into the ring.
+
+const WS_CONTROL_TOPICS = new Set(["acks", "alerts"]);
+
+// Pick rbw1 only if offered and enabled; otherwise no sub-protocol (JSON)
+// (not in gateway mode: a bare command word names no bridge)
+const wsPickProtocol = (protocols) => (WS_BINARY && !GATEWAY && protocols.has(WS_BIN_PROTOCOL) ? WS_BIN_PROTOCOL : false);
+const wss = WS_ENGINE === "ws" ? new WebSocketServer({ server, handleProtocols: wsPickProtocol }) : null;
+const uws = WS_ENGINE === "uws"
+  ? createUwsEngine({ port: PORT, bind: BIND, cert: TLS_CERT, key: TLS_KEY, allTopics: WS_TOPICS,
+                      pickProtocol: wsPickProtocol },
+                    { onOpen: (ws) => wsOnOpen(ws, ws.ip), onMessage: wsOnRaw, onClose: wsOnClose })
+  : null;
+const fanout = new Fanout(() => (wss ? wss.clients : []));
+
+const fanRing = WS_FANOUT === "worker" ? SabRing.create(FANOUT_RING_BYTES) : null;
+const fanWorker = fanRing
+  ? new Worker(new URL("./fanout-worker.js", import.meta.url), {
+      workerData: { sab: fanRing.sab, port: TELEMETRY_PORT, bind: BIND, cert: TLS_CERT, key: TLS_KEY },
+    })
+  : null;
+let fanStats = { clients: 0, dropped: 0 };
+
+if (fanWorker) {
+  fanWorker.on("message", (st) => { fanStats = st; });
+  fanWorker.on("error", (err) => console.error("⚠️  Fan-out worker error:", err.message));
+}
+
+function wsClientCount() {
+  return uws ? uws.clients.size : wss.clients.size;
+}
+
+function wsSubscribe(ws, data) {
+  const r = parseSub(data);
+  if (r.err) {
+    ws.send(JSON.stringify({ type: "ERR", msg: r.err, ts: Date.now() }));
+    return;
+  }
+  ws.sub = r.sub;
+  if (uws) ws.subscribe(ws.sub.topics, ws.sub.robots);
+  ws.send(JSON.stringify({ type: "SUB", topics: [...ws.sub.topics], robots: data.robots ?? "all", ts: Date.now() }));
+}
 
-// Broadcast helper
+// Broadcast helper (status messages: every client, whatever it subscribed to)
 function wsBroadcast(obj) {
-  const s = JSON.stringify(obj);
-  for (const client of wss.clients) {
-    if (client.readyState === 1) client.send(s);
+  wsBroadcastRaw(JSON.stringify(obj));
+}
+
+// Broadcast an already-serialized JSON text (string or UTF-8 Buffer); every
+// client is sent the same object, nothing is re-encoded per client. With
+// meta (frameMeta) only the clients subscribed to it get it.
+function wsBroadcastRaw(text, meta = null) {
+  if (fanRing) {
+    fanRing.push(typeof text === "string" ? Buffer.from(text) : text, !meta);
+    if (meta && !WS_CONTROL_TOPICS.has(meta.topic)) return;
+  }
+  if (uws) {
+    if (meta) uws.publish(text, meta);
+    else uws.broadcast(text);
+    return;
   }
+  fanout.broadcast(text, meta);
 }
 
 // ------------------------- UDS (Node <-> C) -------------------------
 
 let cSocket = null;
 
-// RX buffer for length-prefixed frames from C
-let udsRxBuf = Buffer.alloc(0);
+// RX chunk list for length-prefixed frames from C. Chunks are kept as they
+// arrive; a frame inside one chunk is a zero-copy view, only frames that
+// straddle chunks are copied.
+let udsRxChunks = [];
+let udsRxOff = 0;   // Consumed bytes of udsRxChunks[0]
+let udsRxLen = 0;   // Unconsumed bytes across all chunks
+
+function udsRxReset() {
+  udsRxChunks = [];
+  udsRxOff = 0;
+  udsRxLen = 0;
+}
+
+// Remove and return the next n buffered bytes (caller checked udsRxLen >= n).
+function udsRxTake(n) {
+  const head = udsRxChunks[0];
+  if (head.length - udsRxOff >= n) {
+    const out = head.subarray(udsRxOff, udsRxOff + n);
+    udsRxOff += n;
+    if (udsRxOff === head.length) { udsRxChunks.shift(); udsRxOff = 0; }
+    udsRxLen -= n;
+    return out;
+  }
+  const out = Buffer.allocUnsafe(n);
+  let filled = 0;
+  while (filled < n) {
+    const c = udsRxChunks[0];
+    const k = Math.min(c.length - udsRxOff, n - filled);
+    c.copy(out, filled, udsRxOff, udsRxOff + k);
+    filled += k;
+    udsRxOff += k;
+    if (udsRxOff === c.length) { udsRxChunks.shift(); udsRxOff = 0; }
+  }
+  udsRxLen -= n;
+  return out;
+}
+
+// Big-endian u32 at the read position, without consuming it.
+function udsRxPeekLen() {
+  const head = udsRxChunks[0];
+  if (head.length - udsRxOff >= 4) return head.readUInt32BE(udsRxOff);
+  let v = 0;
+  let i = 0, off = udsRxOff;
+  for (let got = 0; got < 4; got++) {
+    while (off === udsRxChunks[i].length) { i++; off = 0; }
+    v = v * 256 + udsRxChunks[i][off++];
+  }
+  return v;
+}
+
+// The bridge's MODE, TRACE and METRICS frames are the ones Node consumes itself
+const UDS_MODE_PREFIX = Buffer.from('{"type":"MODE"', "utf8");
+const UDS_TRACE_PREFIX = Buffer.from('{"type":"TRACE"', "utf8");
+const UDS_METRICS_PREFIX = Buffer.from('{"type":"METRICS"', "utf8");
+const UDS_TSQ_PREFIX = Buffer.from('{"type":"TSQ","rid":', "utf8");
+
+function bufStartsWith(buf, prefix) {
+  return buf.length >= prefix.length && prefix.equals(buf.subarray(0, prefix.length));
+}
 
 function udsSendJson(obj) {
   if (!cSocket || cSocket.destroyed) return false;
@@ -77,13 +444,144 @@ function udsSendJson(obj) {
   const lenBuf = Buffer.alloc(4);
   lenBuf.writeUInt32BE(jsonBuf.length, 0);
 
-  cSocket.write(Buffer.concat([lenBuf, jsonBuf]));
+  udsWrite(Buffer.concat([lenBuf, jsonBuf]));
+  return true;
+}
+
+// ------------------------- Binary UDS mode -------------------------
+// Frame payload: [0]=0xB1 [1]=type [2..3]=seq [4..11]=robot_bt_packet_t bytes.
+// control_format_t (LSB first): pl 0-1, type 2-6, w 7, a 8, s 9, d 10,
+// speed 11-17, id 18-28 — see ECE/GS/includes/cmd_structure.h.
+
+const UDS_BIN_MAGIC = 0xb1;
+const CONTROL_CMD = 0x01;
+let udsBinaryActive = false;
+let udsBinSeq = 0;
+
+function packControlWord(c) {
+  return (
+    ((c.PL & 0x3) |
+      ((CONTROL_CMD & 0x1f) << 2) |
+      ((c.F & 1) << 7) |
+      ((c.L & 1) << 8) |
+      ((c.B & 1) << 9) |
+      ((c.R & 1) << 10) |
+      ((c.S & 0x7f) << 11) |
+      ((c.ID & 0x7ff) << 18)) >>> 0
+  );
+}
+
+function udsSendControlBin(c) {
+  if (!cSocket || cSocket.destroyed) return false;
+
+  const frame = Buffer.alloc(4 + 12);
+  frame.writeUInt32BE(12, 0);
+  frame[4] = UDS_BIN_MAGIC;
+  frame[5] = CONTROL_CMD;
+  frame.writeUInt16BE(udsBinSeq, 6);
+  frame.writeUInt32LE(packControlWord(c), 8);   // upper 32 bits stay zero
+  udsBinSeq = (udsBinSeq + 1) & 0xffff;
+
+  udsWrite(frame);
+  return true;
+}
+
+// Send a compact Control message, binary if the bridge agreed to it.
+function udsSendControl(c) {
+  return udsBinaryActive ? udsSendControlBin(c) : udsSendJson(c);
+}
+
+// Encrypted packets: IV(12) || CT(128) || TAG(16). In binary mode they go to
+// the bridge as raw bytes behind UDS_BIN_CIPHER_MAGIC instead of 312 hex chars.
+const CIPHER_BYTES = 156;
+const UDS_BIN_CIPHER_MAGIC = 0xb2;
+const CIPHER_HEX_RE = new RegExp(`^[0-9a-fA-F]{${CIPHER_BYTES * 2}}$`);
+
+function udsSendCipherBin(bytes) {
+  if (!cSocket || cSocket.destroyed) return false;
+  if (bytes.length !== CIPHER_BYTES) return false;
+
+  const frame = Buffer.alloc(4 + 1 + CIPHER_BYTES);
+  frame.writeUInt32BE(1 + CIPHER_BYTES, 0);
+  frame[4] = UDS_BIN_CIPHER_MAGIC;
+  bytes.copy(frame, 5);
+
+  udsWrite(frame);
   return true;
 }
 
+// ------------------------- Binary WS sub-protocol -------------------------
+// UI -> Node (binary): [0..1]=seq (u16 BE) [2..9]=robot_bt_packet_t bytes.
+// Node -> UI (binary): [0]=0xAC [1]=status [2..3]=seq [4..5]=count. status 0
+// acks every word up to seq (count since the last ack), flushed every
+// WS_ACK_BATCH_MS or WS_ACK_BATCH_MAX words; 1 = bridge not connected,
+// 2 = binary UDS mode not active, sent at once for that seq (count 0).
+
+const WS_BIN_PROTOCOL = "rbw1";
+const WS_WORD_FRAME = 2 + 8;
+const WS_ACK_MAGIC = 0xac;
+const WS_ACK_OK = 0;
+const WS_ACK_NO_BRIDGE = 1;
+const WS_ACK_NO_BIN = 2;
+const WS_ACK_BATCH_MS = 50;
+const WS_ACK_BATCH_MAX = 32;
+
+// Forward one pre-packed word; the type byte is read out of the word itself.
+function udsSendWordBin(seq, word) {
+  if (!cSocket || cSocket.destroyed) return WS_ACK_NO_BRIDGE;
+  if (!udsBinaryActive) return WS_ACK_NO_BIN;
+
+  const frame = Buffer.alloc(4 + 12);
+  frame.writeUInt32BE(12, 0);
+  frame[4] = UDS_BIN_MAGIC;
+  frame[5] = (word[0] >> 2) & 0x1f;
+  frame.writeUInt16BE(seq, 6);
+  word.copy(frame, 8, 0, 8);
+
+  udsWrite(frame);
+  return WS_ACK_OK;
+}
+
+function wsSendAck(ws, status, seq, count) {
+  const a = Buffer.alloc(6);
+  a[0] = WS_ACK_MAGIC;
+  a[1] = status;
+  a.writeUInt16BE(seq, 2);
+  a.writeUInt16BE(count, 4);
+  ws.send(a, { binary: true });
+}
+
+function wsFlushAcks(ws) {
+  const st = ws.wordAcks;
+  if (st.timer) { clearTimeout(st.timer); st.timer = null; }
+  if (st.pending === 0 || ws.readyState !== 1) { st.pending = 0; return; }
+  wsSendAck(ws, WS_ACK_OK, st.lastSeq, st.pending);
+  st.pending = 0;
+}
+
+function wsHandleWord(ws, raw) {
+  const seq = raw.readUInt16BE(0);
+  const status = udsSendWordBin(seq, raw.subarray(2, WS_WORD_FRAME));
+  const st = ws.wordAcks;
+
+  if (status !== WS_ACK_OK) {
+    wsFlushAcks(ws);
+    wsSendAck(ws, status, seq, 0);
+    return;
+  }
+  st.lastSeq = seq;
+  if (++st.pending >= WS_ACK_BATCH_MAX) wsFlushAcks(ws);
+  else if (!st.timer) st.timer = setTimeout(() => wsFlushAcks(ws), WS_ACK_BATCH_MS);
+}
+
 function udsSendRaw(str) {
   if (!cSocket || cSocket.destroyed) return false;
 
+  if (udsBinaryActive) {
+    const hex = String(str).replace(/\s+/g, "");
+    if (CIPHER_HEX_RE.test(hex)) return udsSendCipherBin(Buffer.from(hex, "hex"));
+  }
+
   const buf = Buffer.from(String(str), "utf8");
   console.log("udsSendRaw: sending", buf.length, "bytes:", str.slice(0, 32), "...");
 
@@ -95,51 +593,94 @@ function udsSendRaw(str) {
   const lenBuf = Buffer.alloc(4);
   lenBuf.writeUInt32BE(buf.length, 0);
 
-  cSocket.write(Buffer.concat([lenBuf, buf]));
+  udsWrite(Buffer.concat([lenBuf, buf]));
   return true;
 }
 
 function udsProcessIncoming() {
   // Need at least 4 bytes for length
-  while (udsRxBuf.length >= 4) {
-    const len = udsRxBuf.readUInt32BE(0);
+  while (udsRxLen >= 4) {
+    const len = udsRxPeekLen();
 
     // Mirror gs_bridge.c sanity check
     if (len === 0 || len > 1024 * 1024) {
       console.error("⚠️  Bad UDS frame length from C:", len, "-> closing socket");
+      udsRxReset();
       cSocket.destroy();
       return;
     }
 
-    if (udsRxBuf.length < 4 + len) return; // wait for full frame
+    if (udsRxLen < 4 + len) return; // wait for full frame
 
-    const payload = udsRxBuf.slice(4, 4 + len);
-    udsRxBuf = udsRxBuf.slice(4 + len);
+    udsRxTake(4);
+    udsHandleFrame(udsRxTake(len));
+  }
+}
 
+// One frame from a bridge: the local one, or in gateway mode the one given
+function udsHandleFrame(payload, bridge = null) {
+  // Mode replies, trace records and metrics snapshots are for us, not the UI
+  if (bufStartsWith(payload, UDS_METRICS_PREFIX)) {
+    try {
+      metricsResolve(bridge ? bridge.metrics : metricsLocal, JSON.parse(payload.toString("utf8")));
+    } catch (e) {
+      console.warn("⚠️  Failed to parse METRICS snapshot from C:", e?.message || e);
+    }
+    return;
+  }
+  if (bufStartsWith(payload, UDS_TRACE_PREFIX)) {
+    try {
+      latIngestTrace(JSON.parse(payload.toString("utf8")));
+    } catch (e) {
+      console.warn("⚠️  Failed to parse TRACE record from C:", e?.message || e);
+    }
+    return;
+  }
+  if (bufStartsWith(payload, UDS_TSQ_PREFIX)) {
+    tsqReply(payload);
+    return;
+  }
+  if (bufStartsWith(payload, UDS_MODE_PREFIX)) {
     try {
       const msg = JSON.parse(payload.toString("utf8"));
-
-      // Forward to all WS clients
-      wsBroadcast(msg);
+      if (!bridge) udsBinaryActive = msg.proto === "bin1";
+      console.log(bridge ? `🧠 Bridge ${bridge.name} frame mode:` : "🧠 UDS frame mode:",
+                  msg.proto === "bin1" ? "binary" : "JSON", msg.seal === "gs" ? "(bridge seals commands)" : "");
     } catch (e) {
-      console.warn("⚠️  Failed to parse JSON from C:", e?.message || e);
+      console.warn("⚠️  Failed to parse MODE reply from C:", e?.message || e);
     }
+    return;
+  }
+
+  // The bridge only emits JSON objects/arrays: forward the bytes as-is
+  if (payload[0] !== 0x7b && payload[0] !== 0x5b) {
+    console.warn("⚠️  Dropping non-JSON frame from C (", payload.length, "bytes )");
+    return;
   }
+  if (bridge) payload = fleetFrame(payload, bridge);
+  wsBroadcastRaw(payload, frameMeta(payload));
 }
 
 function connectToC() {
-  cSocket = net.createConnection(SOCKET_PATH);
+  cSocket = shmRing ? shmRing.createConnection(SOCKET_PATH) : net.createConnection(SOCKET_PATH);
 
   cSocket.on("connect", () => {
-    console.log("🧠 Connected to C bridge via UDS:", SOCKET_PATH);
-    udsRxBuf = Buffer.alloc(0);
+    console.log("🧠 Connected to C bridge via UDS:", SOCKET_PATH, shmRing ? "(shared-memory rings)" : "");
+    udsRxReset();
+    udsBinaryActive = false;
+    if (UDS_BINARY || WS_BINARY || GS_SEAL) {
+      const mode = { T: "MODE", proto: UDS_BINARY || WS_BINARY ? "bin1" : "json" };
+      if (GS_SEAL) mode.seal = "gs";
+      udsSendJson(mode);
+    }
 
     // Optional: notify WS clients that backend is live
     wsBroadcast({ type: "INFO", msg: "Connected to C bridge", ts: Date.now() });
   });
 
   cSocket.on("data", (chunk) => {
-    udsRxBuf = Buffer.concat([udsRxBuf, chunk]);
+    udsRxChunks.push(chunk);
+    udsRxLen += chunk.length;
     udsProcessIncoming();
   });
 
@@ -155,7 +696,70 @@ function connectToC() {
   });
 }
 
-connectToC();
+// ------------------------- Fleet gateway -------------------------
+// GS_BRIDGES: several bridges over TCP/TLS in place of the one UDS link
+// (fleet-gateway.js). Their frames go through udsHandleFrame with the bridge
+// they came from; a command goes to the bridge of its "robot" (fleet number)
+// or the one its "bridge" names, for commands to a bridge itself (S, Q, ...).
+// With a single bridge neither is needed.
+
+let gateway = null;
+const GW_RAW_REFUSED = "gateway routes JSON commands only";
+
+function gwStart() {
+  gateway = new FleetGateway(GS_BRIDGES, {
+    onFrame: (b, payload) => udsHandleFrame(payload, b),
+    onUp: (b) => {
+      const st = b.status();
+      console.log(`🧠 Connected to bridge ${b.name}: ${st.addr} (robots ${st.robots[0]}-${st.robots[1]})`);
+      if (GS_SEAL) gateway.sendJson(b, { T: "MODE", proto: "json", seal: "gs" });
+      wsBroadcast({ type: "INFO", msg: `Connected to bridge ${b.name}`, bridge: b.name, ts: Date.now() });
+    },
+    onDown: (b) => {
+      console.warn(`⚠️  Bridge ${b.name} closed — retrying`);
+      wsBroadcast({ type: "INFO", msg: `Disconnected from bridge ${b.name}`, bridge: b.name, ts: Date.now() });
+    },
+    onError: (b, err) => console.error(`⚠️  Bridge ${b.name} error:`, err.message),
+  }, { caFile: GS_BRIDGE_CA });
+  for (const b of gateway.bridges) b.metrics = { last: null, waiters: [] };
+  gateway.start();
+}
+
+// Bridge and bridge-local form of a command, or { err }
+function gwTarget(obj) {
+  const { bridge: name, ...cmd } = obj;
+  const b = name === undefined ? null : gateway.byName(String(name));
+  if (name !== undefined && !b) return { err: `unknown bridge ${name}` };
+  if (cmd.robot === undefined) {
+    if (b) return { bridge: b, obj: cmd };
+    if (gateway.bridges.length === 1) return { bridge: gateway.bridges[0], obj: cmd };
+    return { err: "gateway: command names no robot or bridge" };
+  }
+  const r = gateway.route(cmd.robot);
+  if (!r) return { err: `no bridge drives robot ${cmd.robot}` };
+  if (b && r.bridge !== b) return { err: `robot ${cmd.robot} is not on bridge ${name}` };
+  return { bridge: r.bridge, obj: FleetGateway.localize(cmd, r.local) };
+}
+
+// null when sent (or queued for a busy bridge), else why not
+function gwSend(obj) {
+  const t = gwTarget(obj);
+  if (t.err) return t.err;
+  if (!gateway.sendJson(t.bridge, t.obj)) return `bridge ${t.bridge.name} not connected`;
+  latWsSent();
+  return null;
+}
+
+// A command from a UI message to its bridge: the UDS link, or in gateway
+// mode the bridge the message's robot / bridge fields pick
+function bridgeSend(cmd, data) {
+  if (GATEWAY) return gwSend({ ...cmd, robot: data.robot, bridge: data.bridge });
+  const ok = cmd.T === "C" ? udsSendControl(cmd) : udsSendJson(cmd);
+  return ok ? null : "C bridge not connected";
+}
+
+if (GATEWAY) gwStart();
+else connectToC();
 
 // ------------------------- WS Handling -------------------------
 
@@ -194,6 +798,9 @@ const UI_ONLY_TYPES = new Set(["ping", "pong", "hello", "ack", "ERR", "INFO"]);
  * Allows any well-formed T value that is not a UI-internal type:
  *   "C"   - Control (drive)
  *   "A"   - Arm / appendage  e.g. {"T":"A","U":1,"D":0,...}
+ *   "G"   - Arm target (0.01 in) e.g. {"T":"G","X":0,"Y":750,"Z":550,"S":50,"ID":7}
+ *   "TRAJ" - Trajectory upload / abort (traj_upload.h) e.g.
+ *           {"T":"TRAJ","ID":9,"segs":[{"ms":800,"v":[60,60,60,60]},{"ms":400,"v":[0,0,0,0],"arm":[0,750,550],"S":50}]}
  *   "P"   - Peripheral / servo
  *   "S"   - Settings
  *   "Q"   - Query
@@ -252,79 +859,181 @@ function wsPayloadToUds(data) {
   return data;
 }
 
-wss.on("connection", (ws, req) => {
-  const clientIp = req.socket.remoteAddress;
-  console.log(`✅ WS client connected from ${clientIp} (total: ${wss.clients.size})`);
+// ------------------------- Telemetry history -------------------------
+// {"type":"TSQ",...} from a UI client is a range query on the bridge's
+// telemetry store (ECE/GS/includes/tsdb/tsdb.h). It goes over with a rid of
+// ours in place of the client's, and the reply, which echoes it first thing,
+// goes back to that client only, with the client's own rid restored.
+
+const TSQ_TIMEOUT_MS = 5000;
+const tsqPending = new Map();                   // rid -> { ws, rid, timer }
+let tsqSeq = 0;
+
+function tsqForward(ws, data) {
+  const { type, T, rid, ...query } = data;
+  const id = ++tsqSeq;
+  const err = bridgeSend({ T: "TSQ", rid: id, ...query }, data);
+  if (err) {
+    ws.send(JSON.stringify({ type: "ERR", msg: err, ts: Date.now() }));
+    return;
+  }
+  const timer = setTimeout(() => tsqPending.delete(id), TSQ_TIMEOUT_MS);
+  tsqPending.set(id, { ws, rid, timer });
+}
 
-  ws.send(JSON.stringify({ type: "hello", ts: Date.now() }));
+// The payload is the bridge's frame; only its rid is rewritten
+function tsqReply(payload) {
+  const head = payload.toString("latin1", UDS_TSQ_PREFIX.length, UDS_TSQ_PREFIX.length + 24);
+  const m = /^(\d+)/.exec(head);
+  const req = m && tsqPending.get(Number(m[1]));
+  if (!req) return;
+  tsqPending.delete(Number(m[1]));
+  clearTimeout(req.timer);
+  if (req.ws.readyState !== 1) return;
+  const rest = payload.subarray(UDS_TSQ_PREFIX.length + m[1].length);
+  const rid = req.rid === undefined ? "null" : JSON.stringify(req.rid);
+  req.ws.send(Buffer.concat([UDS_TSQ_PREFIX, Buffer.from(rid, "utf8"), rest]), { binary: false });
+}
 
-  ws.on("message", (raw) => {
-    const rawStr = raw.toString();
-    let data;
-    try {
-      data = JSON.parse(rawStr);
-    } catch {
-      // Plain string (invalid JSON) — send to UDS as raw
-      const ok = udsSendRaw(rawStr);
-      ws.send(JSON.stringify({ type: ok ? "ack" : "ERR", msg: ok ? "sent" : "C bridge not connected", ts: Date.now() }));
-      return;
-    }
+// One message from a UI client; see wss.on("connection") below
+function wsOnMessage(ws, raw, isBinary) {
+  // rbw1: one pre-packed command word, straight to the bridge
+  if (isBinary && ws.protocol === WS_BIN_PROTOCOL && raw.length === WS_WORD_FRAME) {
+    wsHandleWord(ws, raw);
+    return;
+  }
 
-    // If parsed result is a string (e.g. JSON "wnsijcfwed"), send to UDS
-    if (typeof data === "string") {
-      const ok = udsSendRaw(data);
-      ws.send(JSON.stringify({ type: ok ? "ack" : "ERR", msg: ok ? "sent" : "C bridge not connected", ts: Date.now() }));
-      return;
-    }
+  // Gateway mode routes JSON commands only: raw bytes name no robot
+  if (GATEWAY && isBinary) {
+    ws.send(JSON.stringify({ type: "ERR", msg: GW_RAW_REFUSED, ts: Date.now() }));
+    return;
+  }
 
-    // Heartbeat
-    if (data.type === "ping") {
-      ws.send(JSON.stringify({ type: "pong", ts: Date.now() }));
-      return;
-    }
+  // Binary WS frame carrying one raw ciphertext packet
+  if (isBinary && raw.length === CIPHER_BYTES) {
+    const ok = udsBinaryActive ? udsSendCipherBin(Buffer.from(raw)) : udsSendRaw(Buffer.from(raw).toString("hex"));
+    ws.send(JSON.stringify({ type: ok ? "ack" : "ERR", msg: ok ? "sent" : "C bridge not connected", ts: Date.now() }));
+    return;
+  }
 
-    // If UI sends direction key, translate to Control (C)
-    if (data.direction) {
-      const cmd = directionToC(data.direction, data.speed, data.id);
-      const ok = udsSendJson(cmd);
-      ws.send(
-        JSON.stringify({
-          type: ok ? "ack" : "ERR",
-          msg: ok ? "sent" : "C bridge not connected",
-          sent: cmd,
-          ts: Date.now(),
-        })
-      );
-      return;
-    }
+  const rawStr = raw.toString();
+  let data;
+  try {
+    data = JSON.parse(rawStr);
+  } catch {
+    // Plain string (invalid JSON) — send to UDS as raw
+    const ok = !GATEWAY && udsSendRaw(rawStr);
+    ws.send(JSON.stringify({ type: ok ? "ack" : "ERR", msg: ok ? "sent" : GATEWAY ? GW_RAW_REFUSED : "C bridge not connected", ts: Date.now() }));
+    return;
+  }
 
-    // All other bridge messages (C, A, P, S, Q, raw, report types, …)
-    const udsPayload = wsPayloadToUds(data);
-    if (udsPayload) {
-      console.log("WS->UDS sending:", udsPayload);
-      const ok = udsSendJson(udsPayload);
-      ws.send(JSON.stringify({ type: ok ? "ack" : "ERR", msg: ok ? "sent" : "C bridge not connected", ts: Date.now() }));
-      return;
-    }
+  // If parsed result is a string (e.g. JSON "wnsijcfwed"), send to UDS
+  if (typeof data === "string") {
+    const ok = !GATEWAY && udsSendRaw(data);
+    ws.send(JSON.stringify({ type: ok ? "ack" : "ERR", msg: ok ? "sent" : GATEWAY ? GW_RAW_REFUSED : "C bridge not connected", ts: Date.now() }));
+    return;
+  }
 
-    ws.send(JSON.stringify({ type: "ERR", msg: "unknown message format", got: data, ts: Date.now() }));
-  });
+  // Subscriptions are per UI client and kept here, never forwarded
+  if ((data.type ?? data.T) === "SUB") {
+    wsSubscribe(ws, data);
+    return;
+  }
 
-  ws.on("close", () => {
-    console.log(`❌ WS client disconnected (remaining: ${wss.clients.size})`);
-  });
+  if ((data.type ?? data.T) === "TSQ") {
+    tsqForward(ws, data);
+    return;
+  }
+
+  // Heartbeat
+  if (data.type === "ping") {
+    ws.send(JSON.stringify({ type: "pong", ts: Date.now() }));
+    return;
+  }
+
+  // If UI sends direction key, translate to Control (C)
+  if (data.direction) {
+    const cmd = directionToC(data.direction, data.speed, data.id);
+    const err = bridgeSend(cmd, data);
+    ws.send(
+      JSON.stringify({
+        type: err ? "ERR" : "ack",
+        msg: err || "sent",
+        sent: cmd,
+        ts: Date.now(),
+      })
+    );
+    return;
+  }
 
-  ws.on("error", (err) => {
-    console.error("⚠️  WS error:", err.message);
+  // All other bridge messages (C, A, P, S, Q, raw, report types, …)
+  const udsPayload = wsPayloadToUds(data);
+  if (udsPayload) {
+    console.log("WS->UDS sending:", udsPayload);
+    const err = bridgeSend(udsPayload, data);
+    ws.send(JSON.stringify({ type: err ? "ERR" : "ack", msg: err || "sent", ts: Date.now() }));
+    return;
+  }
+
+  ws.send(JSON.stringify({ type: "ERR", msg: "unknown message format", got: data, ts: Date.now() }));
+}
+
+// Connection lifecycle, either engine: ws is a `ws` socket or a ws-uws.js client
+function wsOnOpen(ws, clientIp) {
+  console.log(`✅ WS client connected from ${clientIp} (total: ${wsClientCount()})`);
+
+  ws.send(JSON.stringify({ type: "hello", ts: Date.now() }));
+  ws.wordAcks = { pending: 0, lastSeq: 0, timer: null };
+  ws.sub = null;                                // Everything until it sends SUB
+  ws.pend = new Map();
+}
+
+function wsOnRaw(ws, raw, isBinary) {
+  wsRxAt = process.hrtime.bigint();
+  try {
+    wsOnMessage(ws, raw, isBinary);
+  } finally {
+    wsRxAt = 0n;                                  // Only writes made for this message count
+  }
+}
+
+function wsOnClose(ws) {
+  wsFlushAcks(ws);
+  console.log(`❌ WS client disconnected (remaining: ${wsClientCount()})`);
+}
+
+if (wss) {
+  wss.on("connection", (ws, req) => {
+    wsOnOpen(ws, req.socket.remoteAddress);
+    ws.on("message", (raw, isBinary) => wsOnRaw(ws, raw, isBinary));
+    ws.on("close", () => wsOnClose(ws));
+    ws.on("error", (err) => {
+      console.error("⚠️  WS error:", err.message);
+    });
   });
-});
+}
 
 // ------------------------- Start server -------------------------
 
-server.listen(PORT, BIND, () => {
-  console.log(`🚀 HTTP server: http://${BIND}:${PORT}`);
-  console.log(`🔌 WS endpoint: ws://${BIND}:${PORT}`);
-  console.log(`🧠 UDS path:    ${SOCKET_PATH}`);
+if (uws) {
+  uws.listen((ok) => {
+    if (!ok) {
+      console.error(`❌ uWebSockets.js could not listen on ${BIND}:${PORT}`);
+      process.exit(1);
+    }
+  });
+}
+
+server.listen(uws ? HTTP_PORT : PORT, BIND, () => {
+  console.log(`🚀 HTTP server: ${USE_TLS ? "https" : "http"}://${BIND}:${uws ? HTTP_PORT : PORT}`);
+  console.log(`🔌 WS endpoint: ${USE_TLS ? "wss" : "ws"}://${BIND}:${PORT}${uws ? " (uWebSockets.js)" : ""}`);
+  if (GS_SEAL) console.log("🔐 Command sealing: on the GS bridge");
+  if (WS_BINARY && !GATEWAY) console.log(`📦 WS sub-protocol: ${WS_BIN_PROTOCOL} (binary command words)`);
+  if (GATEWAY) {
+    for (const b of gateway.status()) console.log(`🧠 Bridge ${b.name}: ${b.addr} (robots ${b.robots[0]}-${b.robots[1]})`);
+  } else {
+    console.log(`🧠 UDS path:    ${SOCKET_PATH}`);
+  }
   console.log("Waiting for connections...\n");
 });
 
@@ -333,18 +1042,21 @@ server.listen(PORT, BIND, () => {
 process.on("SIGINT", () => {
   console.log("\n🛑 Shutting down...");
 
-  for (const client of wss.clients) {
+  if (uws) uws.close();
+  for (const client of wss ? wss.clients : []) {
     try { client.close(); } catch {}
   }
 
   if (cSocket && !cSocket.destroyed) {
     try { cSocket.end(); } catch {}
   }
+  if (gateway) gateway.close();
+  if (fanWorker) fanWorker.terminate();
 
-  wss.close(() => {
-    server.close(() => {
-      console.log("👋 Server closed");
-      process.exit(0);
-    });
+  const done = () => server.close(() => {
+    console.log("👋 Server closed");
+    process.exit(0);
   });
+  if (wss) wss.close(done);
+  else done();
 });
\ No newline at end of file
@@ -0,0 +1,92 @@
+// sab-ring.js
+// -----------------------------------------------------------------------------
+// Single-producer / single-consumer byte ring over a SharedArrayBuffer, for
+// frames between threads of one process (production-server.js -> its fan-out
+// worker) without a postMessage copy and structured clone per frame.
+//
+// Layout: a 16-byte header of Int32 words, then the data area (power of two):
+//   [0] head  byte position the producer writes next
+//   [1] tail  byte position the consumer reads next
+//   [2] dropped  frames refused for want of room
+// Positions only grow (mod 2^32); head - tail is what is waiting. A record
+// is [u32 len | RING_FLAG][bytes], padded to 4 so the length never wraps.
+// The producer never blocks: a frame that does not fit is dropped and
+// counted, as a full socket buffer would be on the other side. The consumer
+// sleeps in Atomics.waitAsync on head.
+// -----------------------------------------------------------------------------
+
+const HDR_BYTES = 16;
+const H_HEAD = 0;
+const H_TAIL = 1;
+const H_DROPPED = 2;
+export const RING_FLAG = 0x80000000;         // Caller's one bit per record
+const LEN_MASK = 0x7fffffff;
+
+export class SabRing {
+  static create(bytes) {
+    if (bytes & (bytes - 1)) throw new Error("SabRing size must be a power of two");
+    return new SabRing(new SharedArrayBuffer(HDR_BYTES + bytes));
+  }
+
+  constructor(sab) {
+    this.sab = sab;
+    this.hdr = new Int32Array(sab, 0, HDR_BYTES / 4);
+    this.data = new Uint8Array(sab, HDR_BYTES);
+    this.view = new DataView(sab, HDR_BYTES);
+    this.mask = this.data.length - 1;
+  }
+
+  get dropped() {
+    return Atomics.load(this.hdr, H_DROPPED);
+  }
+
+  copyIn(pos, src) {
+    const at = pos & this.mask;
+    const first = Math.min(src.length, this.data.length - at);
+    this.data.set(first === src.length ? src : src.subarray(0, first), at);
+    if (first < src.length) this.data.set(src.subarray(first), 0);
+  }
+
+  copyOut(pos, len) {
+    const out = Buffer.allocUnsafe(len);
+    const at = pos & this.mask;
+    const first = Math.min(len, this.data.length - at);
+    out.set(this.data.subarray(at, at + first), 0);
+    if (first < len) out.set(this.data.subarray(0, len - first), first);
+    return out;
+  }
+
+  // Producer: false (and counted) when the frame does not fit
+  push(buf, flag = false) {
+    const head = Atomics.load(this.hdr, H_HEAD);
+    const tail = Atomics.load(this.hdr, H_TAIL);
+    const need = 4 + ((buf.length + 3) & ~3);
+    if (buf.length > LEN_MASK || need > this.data.length - ((head - tail) | 0)) {
+      Atomics.add(this.hdr, H_DROPPED, 1);
+      return false;
+    }
+    this.view.setUint32(head & this.mask, (buf.length | (flag ? RING_FLAG : 0)) >>> 0);
+    this.copyIn(head + 4, buf);
+    Atomics.store(this.hdr, H_HEAD, (head + need) | 0);
+    Atomics.notify(this.hdr, H_HEAD);
+    return true;
+  }
+
+  // Consumer: { buf, flag } or null when empty
+  pop() {
+    const tail = Atomics.load(this.hdr, H_TAIL);
+    if (tail === Atomics.load(this.hdr, H_HEAD)) return null;
+    const word = this.view.getUint32(tail & this.mask);
+    const len = word & LEN_MASK;
+    const buf = this.copyOut(tail + 4, len);
+    Atomics.store(this.hdr, H_TAIL, (tail + 4 + ((len + 3) & ~3)) | 0);
+    return { buf, flag: (word & RING_FLAG) !== 0 };
+  }
+
+  // Consumer: resolves once something was pushed after the last pop
+  wait() {
+    const tail = Atomics.load(this.hdr, H_TAIL);
+    const r = Atomics.waitAsync(this.hdr, H_HEAD, tail);
+    return r.async ? r.value : Promise.resolve(r.value);
+  }
+}
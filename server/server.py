@@ -13,6 +13,12 @@ from script import opcode_name
 HOST = "localhost"
 PORT = 8765
 
+# Native capture daemon (ECE/GS: make sniff); when built it follows the pcap
+# incrementally and replaces the tshark polling below
+GS_SNIFF = os.environ.get(
+    "GS_SNIFF", os.path.join(os.path.dirname(__file__), "..", "ECE", "GS", "gs_sniff.o"))
+SNIFF_UDS = "/tmp/gs_sniff.sock"
+
 connected_clients: set = set()
 seen_frames: set = set()
 
@@ -46,14 +52,48 @@ async def broadcast(message: str) -> None:
         await asyncio.gather(*(ws.send(message) for ws in connected_clients))
 
 
+async def sniff_relay(pcap_file: str) -> None:
+    """Run gs_sniff on the live capture and forward its UDS frames (4-byte
+    big-endian length + JSON) to the websocket clients unchanged."""
+    proc = subprocess.Popen(
+        [GS_SNIFF, pcap_file],
+        env={**os.environ, "SNIFF_UDS": SNIFF_UDS},
+        stdout=subprocess.DEVNULL,
+    )
+    print(f"[capture] gs_sniff following {pcap_file}")
+    try:
+        for _ in range(50):
+            if os.path.exists(SNIFF_UDS):
+                break
+            await asyncio.sleep(0.1)
+        reader, _ = await asyncio.open_unix_connection(SNIFF_UDS)
+        while True:
+            hdr = await reader.readexactly(4)
+            body = await reader.readexactly(int.from_bytes(hdr, "big"))
+            msg = body.decode()
+            pkt = json.loads(msg)
+            if pkt.get("type") == "sniffed_packet":
+                print(f"[sniff] [{pkt['protocol']}] {pkt['frame']} {pkt['time']} {pkt['info']} | Value: {pkt['value']}")
+            await broadcast(msg)
+    finally:
+        proc.terminate()
+
+
 async def capture_loop() -> None:
     ubertooth = find_tool("ubertooth-btle")
-    tshark = find_tool("tshark")
+    tshark = None if os.access(GS_SNIFF, os.X_OK) else find_tool("tshark")
 
     pcap_file = "/tmp/ubertooth_live.pcap"
     if os.path.exists(pcap_file):
         os.remove(pcap_file)
 
+    # SNIFF_DEVICES=n: gs_sniff starts one ubertooth-btle per dongle itself and
+    # merges their captures (needs USB access to the dongles without sudo)
+    if os.environ.get("SNIFF_DEVICES") and os.access(GS_SNIFF, os.X_OK):
+        await sniff_relay(pcap_file)
+        print("[capture] Pipeline stopped.")
+        return
+
     print("[capture] Starting ubertooth-btle...")
 
     ubertooth_proc = subprocess.Popen(
@@ -63,6 +103,17 @@ async def capture_loop() -> None:
     )
 
     await asyncio.sleep(2)
+
+    if os.access(GS_SNIFF, os.X_OK):
+        try:
+            await sniff_relay(pcap_file)
+        finally:
+            ubertooth_proc.terminate()
+            if os.path.exists(pcap_file):
+                os.remove(pcap_file)
+            print("[capture] Pipeline stopped.")
+        return
+
     print("[capture] Pipeline running, polling for packets...")
 
     connect_ind_seen = False
@@ -154,8 +205,10 @@ async def ws_handler(websocket) -> None:
 
 
 async def main() -> None:
-    if not shutil.which("ubertooth-btle") or not shutil.which("tshark"):
-        sys.exit("[sniffer] ubertooth-btle and tshark are required. Install them and try again.")
+    if not shutil.which("ubertooth-btle"):
+        sys.exit("[sniffer] ubertooth-btle is required. Install it and try again.")
+    if not os.access(GS_SNIFF, os.X_OK) and not shutil.which("tshark"):
+        sys.exit("[sniffer] tshark (or ECE/GS gs_sniff, make sniff) is required. Install it and try again.")
 
     async with websockets.serve(ws_handler, HOST, PORT):
         print(f"[sniffer] Listening on ws://{HOST}:{PORT}")
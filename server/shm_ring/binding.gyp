@@ -0,0 +1,14 @@
+{
+  "targets": [
+    {
+      "target_name": "gs_shm_ring",
+      "sources": [
+        "shm_ring_addon.c",
+        "../../ECE/GS/includes/json_uds/shm_ring.c"
+      ],
+      "include_dirs": ["../../ECE/GS/includes/json_uds"],
+      "cflags_c": ["-std=gnu11", "-O2"],
+      "defines": ["NAPI_VERSION=8"]
+    }
+  ]
+}
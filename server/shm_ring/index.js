@@ -0,0 +1,66 @@
+"use strict";
+// Shared-memory transport to gs_bridge (ECE/GS/includes/json_uds/shm_ring.h)
+// behind the slice of net.Socket that production-server.js uses: write(),
+// destroy(), .destroyed and the connect / data / drain / error / close
+// events. "data" chunks are the same length-prefixed byte stream the socket
+// delivers, so the frame decoder does not change.
+
+const { EventEmitter } = require("events");
+const addon = require("./build/Release/gs_shm_ring.node");
+
+class ShmSocket extends EventEmitter {
+  constructor(path) {
+    super();
+    this.destroyed = false;
+    this._h = null;
+    this._queue = [];   // Frames waiting for room in the ring, in order
+    setImmediate(() => this._open(path));   // Listeners attach first, as with net
+  }
+
+  _open(path) {
+    if (this.destroyed) return;
+    try {
+      this._h = addon.connect(path, (kind, buf) => this._event(kind, buf));
+    } catch (err) {
+      this.destroyed = true;
+      this.emit("error", err);
+      this.emit("close");
+      return;
+    }
+    this.emit("connect");
+  }
+
+  _event(kind, buf) {
+    if (kind === "data") this.emit("data", buf);
+    else if (kind === "drain") this._flush();
+    else if (kind === "close") this.destroy();
+  }
+
+  _flush() {
+    while (this._h && this._queue.length) {
+      if (!addon.write(this._h, this._queue[0])) return;
+      this._queue.shift();
+    }
+    this.emit("drain");
+  }
+
+  write(buf) {
+    if (!this._h) return false;
+    if (this._queue.length || !addon.write(this._h, buf)) {
+      this._queue.push(buf);
+      return false;
+    }
+    return true;
+  }
+
+  destroy() {
+    if (this.destroyed) return;
+    this.destroyed = true;
+    if (this._h) addon.close(this._h);
+    this._h = null;
+    this._queue = [];
+    this.emit("close");
+  }
+}
+
+module.exports = { createConnection: (path) => new ShmSocket(path) };
@@ -0,0 +1,278 @@
+// gs_shm_ring: Node side of the bridge's shared-memory transport
+// (ECE/GS/includes/json_uds/shm_ring.h).
+//
+//   connect(path, onEvent) -> handle    {"T":"SHM"} handshake on a socket of
+//                                       its own, blocking (local, one round trip)
+//   write(handle, buf)     -> bool      whole length-prefixed frame(s) into
+//                                       ring 0; false = no room, wait for "drain"
+//   close(handle)
+//
+// onEvent(kind, buf): "data" with the bytes taken from ring 1 (same stream as
+// the socket's "data" chunks), "drain" once the bridge has made room after a
+// false write, "close" when the bridge's end of the socket goes away.
+// Everything runs on the Node event loop: the bell and the socket are
+// watched with uv_poll.
+
+#define _GNU_SOURCE
+#include <node_api.h>
+#include <uv.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "shm_ring.h"
+
+typedef struct {
+  napi_env           env;
+  napi_ref           cb;
+  napi_async_context actx;
+  int                sock;
+  shm_ring_t         ring;
+  uv_poll_t          bell_poll, sock_poll;
+  int                want_drain;            // A write found ring 0 full
+  int                open_handles;          // uv handles not yet closed
+  int                closed;
+} shm_conn_t;
+
+#define THROW(env, msg) do { napi_throw_error(env, NULL, msg); return NULL; } while (0)
+
+// ------------------------- Handshake -------------------------
+
+// Exactly n bytes; SCM_RIGHTS fds, if any arrive, land in fds[3]
+static int recv_full(int s, void *buf, size_t n, int fds[3]) {
+  size_t got = 0;
+  while (got < n) {
+    struct iovec iov = { (char *)buf + got, n - got };
+    union {
+      char           buf[CMSG_SPACE(3 * sizeof(int))];
+      struct cmsghdr align;
+    } u;
+    struct msghdr m = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = u.buf, .msg_controllen = sizeof(u.buf) };
+    ssize_t r = recvmsg(s, &m, MSG_CMSG_CLOEXEC);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) return -1;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&m); c; c = CMSG_NXTHDR(&m, c)) {
+      if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS && c->cmsg_len == CMSG_LEN(3 * sizeof(int)))
+        memcpy(fds, CMSG_DATA(c), 3 * sizeof(int));
+    }
+    got += (size_t)r;
+  }
+  return 0;
+}
+
+// Frames ahead of the reply (the connect-time HEALTH report) are skipped:
+// the bridge repeats that one on the ring
+static const char *handshake(const char *path, int *sock_out, int fds[3]) {
+  int s = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (s < 0) return "socket() failed";
+  struct sockaddr_un a;
+  memset(&a, 0, sizeof(a));
+  a.sun_family = AF_UNIX;
+  strncpy(a.sun_path, path, sizeof(a.sun_path) - 1);
+  struct timeval tv = { .tv_sec = 2 };
+  setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  if (connect(s, (struct sockaddr *)&a, sizeof(a)) != 0) { close(s); return "connect failed"; }
+
+  static const char req[] = "{\"T\":\"SHM\"}";
+  uint8_t frame[4 + sizeof(req) - 1];
+  uint32_t len_be = htonl(sizeof(req) - 1);
+  memcpy(frame, &len_be, 4);
+  memcpy(frame + 4, req, sizeof(req) - 1);
+  if (send(s, frame, sizeof(frame), MSG_NOSIGNAL) != (ssize_t)sizeof(frame)) { close(s); return "send failed"; }
+
+  char buf[4096];
+  for (int frames = 0; frames < 16; frames++) {
+    uint32_t len;
+    if (recv_full(s, &len, 4, fds) != 0) break;
+    len = ntohl(len);
+    if (len == 0 || len >= sizeof(buf) || recv_full(s, buf, len, fds) != 0) break;
+    buf[len] = '\0';
+    if (strstr(buf, "\"type\":\"SHM\"")) {
+      if (fds[0] < 0) break;
+      *sock_out = s;
+      return NULL;
+    }
+    if (strstr(buf, "\"type\":\"ERR\"")) { close(s); return "bridge refused the shm transport"; }
+  }
+  close(s);
+  return "no shm reply from the bridge";
+}
+
+// ------------------------- Events -------------------------
+
+static void emit(shm_conn_t *c, const char *kind, const uint8_t *p[2], const uint32_t n[2]) {
+  napi_env env = c->env;
+  napi_handle_scope scope;
+  napi_open_handle_scope(env, &scope);
+  napi_value cb, recv, argv[2];
+  napi_get_reference_value(env, c->cb, &cb);
+  napi_get_global(env, &recv);                           // make_callback wants an object
+  napi_create_string_utf8(env, kind, NAPI_AUTO_LENGTH, &argv[0]);
+  if (p) {
+    void *dst;
+    napi_create_buffer(env, n[0] + n[1], &dst, &argv[1]);  // One copy, out of the ring
+    memcpy(dst, p[0], n[0]);
+    memcpy((uint8_t *)dst + n[0], p[1], n[1]);
+  } else {
+    napi_get_undefined(env, &argv[1]);
+  }
+  napi_make_callback(env, c->actx, recv, cb, 2, argv, NULL);
+  napi_close_handle_scope(env, scope);
+}
+
+static void conn_shutdown(shm_conn_t *c);
+
+static void on_bell(uv_poll_t *h, int status, int events) {
+  (void)status; (void)events;
+  shm_conn_t *c = h->data;
+  uint64_t v;
+  while (read(c->ring.bell[SHM_TO_NODE], &v, sizeof(v)) > 0) {}
+
+  if (c->want_drain) {                                     // The bridge took some of ring 0
+    c->want_drain = 0;
+    emit(c, "drain", NULL, NULL);
+  }
+  while (!c->closed) {
+    const uint8_t *p[2];
+    uint32_t n[2];
+    uint32_t avail = shm_ring_peek(&c->ring, SHM_TO_NODE, p, n);
+    if (avail) {
+      emit(c, "data", p, n);
+      if (c->closed) return;                               // The handler closed us
+      shm_ring_take(&c->ring, SHM_TO_NODE, avail);
+      continue;
+    }
+    if (!shm_ring_idle(&c->ring, SHM_TO_NODE)) return;
+  }
+}
+
+// The socket carries nothing after the handshake: readable means EOF
+static void on_sock(uv_poll_t *h, int status, int events) {
+  shm_conn_t *c = h->data;
+  char junk[256];
+  if (status == 0 && !(events & UV_DISCONNECT)) {
+    ssize_t r = recv(c->sock, junk, sizeof(junk), MSG_DONTWAIT);
+    if (r > 0 || (r < 0 && (errno == EAGAIN || errno == EINTR))) return;
+  }
+  conn_shutdown(c);
+  emit(c, "close", NULL, NULL);
+}
+
+// ------------------------- Teardown -------------------------
+
+static void on_handle_closed(uv_handle_t *h) {
+  shm_conn_t *c = h->data;
+  if (--c->open_handles > 0) return;
+  shm_ring_destroy(&c->ring);                              // fds close only once uv is done with them
+  close(c->sock);
+  napi_async_destroy(c->env, c->actx);
+  napi_delete_reference(c->env, c->cb);
+  free(c);
+}
+
+static void conn_shutdown(shm_conn_t *c) {
+  if (c->closed) return;
+  c->closed = 1;
+  uv_poll_stop(&c->bell_poll);
+  uv_poll_stop(&c->sock_poll);
+  uv_close((uv_handle_t *)&c->bell_poll, on_handle_closed);
+  uv_close((uv_handle_t *)&c->sock_poll, on_handle_closed);
+}
+
+// ------------------------- Exports -------------------------
+
+static shm_conn_t *conn_of(napi_env env, napi_value v) {
+  shm_conn_t *c = NULL;
+  if (napi_get_value_external(env, v, (void **)&c) != napi_ok || !c || c->closed) return NULL;
+  return c;
+}
+
+static napi_value js_connect(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value argv[2];
+  napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+  char path[108];
+  size_t plen;
+  if (argc < 2 || napi_get_value_string_utf8(env, argv[0], path, sizeof(path), &plen) != napi_ok)
+    THROW(env, "connect(path, onEvent)");
+
+  int sock = -1, fds[3] = { -1, -1, -1 };
+  const char *err = handshake(path, &sock, fds);
+  if (err) {
+    for (int i = 0; i < 3; i++) if (fds[i] >= 0) close(fds[i]);
+    THROW(env, err);
+  }
+  shm_conn_t *c = calloc(1, sizeof(*c));
+  if (!c) {
+    for (int i = 0; i < 3; i++) close(fds[i]);
+    close(sock);
+    THROW(env, "out of memory");
+  }
+  if (shm_ring_attach(&c->ring, fds[0], fds[1], fds[2]) != 0) {
+    free(c);                                               // attach closed the fds
+    close(sock);
+    THROW(env, "shm ring does not match the bridge's");
+  }
+  c->env = env;
+  c->sock = sock;
+  fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+  napi_create_reference(env, argv[1], 1, &c->cb);
+  napi_value name;
+  napi_create_string_utf8(env, "gs_shm_ring", NAPI_AUTO_LENGTH, &name);
+  napi_async_init(env, NULL, name, &c->actx);
+
+  uv_loop_t *loop;
+  napi_get_uv_event_loop(env, &loop);
+  uv_poll_init(loop, &c->bell_poll, c->ring.bell[SHM_TO_NODE]);
+  uv_poll_init(loop, &c->sock_poll, sock);
+  c->bell_poll.data = c->sock_poll.data = c;
+  c->open_handles = 2;
+  uv_poll_start(&c->bell_poll, UV_READABLE, on_bell);      // Already rung for the HEALTH frame
+  uv_poll_start(&c->sock_poll, UV_READABLE | UV_DISCONNECT, on_sock);
+
+  napi_value handle;
+  napi_create_external(env, c, NULL, NULL, &handle);
+  return handle;
+}
+
+static napi_value js_write(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value argv[2], out;
+  napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+  shm_conn_t *c = argc == 2 ? conn_of(env, argv[0]) : NULL;
+  void *data;
+  size_t len;
+  if (!c || napi_get_buffer_info(env, argv[1], &data, &len) != napi_ok) THROW(env, "write(handle, buffer)");
+
+  int rc = shm_ring_put(&c->ring, SHM_TO_BRIDGE, data, (uint32_t)len, NULL, 0);
+  if (rc < 0) {
+    napi_throw_range_error(env, NULL, "frame larger than the shm ring");
+    return NULL;
+  }
+  if (rc > 0) c->want_drain = 1;
+  napi_get_boolean(env, rc == 0, &out);
+  return out;
+}
+
+static napi_value js_close(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value argv[1];
+  napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+  shm_conn_t *c = argc == 1 ? conn_of(env, argv[0]) : NULL;
+  if (c) conn_shutdown(c);
+  return NULL;
+}
+
+static napi_value init(napi_env env, napi_value exports) {
+  napi_property_descriptor props[] = {
+    { "connect", NULL, js_connect, NULL, NULL, NULL, napi_default, NULL },
+    { "write",   NULL, js_write,   NULL, NULL, NULL, napi_default, NULL },
+    { "close",   NULL, js_close,   NULL, NULL, NULL, napi_default, NULL },
+  };
+  napi_define_properties(env, exports, sizeof(props) / sizeof(props[0]), props);
+  return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, init)
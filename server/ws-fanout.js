@@ -0,0 +1,112 @@
+// ws-fanout.js
+// -----------------------------------------------------------------------------
+// Telemetry fan-out to `ws` clients, shared by production-server.js and its
+// fan-out worker (fanout-worker.js).
+//
+// {"type":"SUB","topics":[...],"robots":[...]} from a UI client picks the
+// bridge frames it is sent (all of them until it asks); the topic names are
+// the bridge's own {"T":"SUB"} ones (ECE/GS/includes/json_uds/json_uds.h).
+// A frame's topic is read once off its first bytes and every subscriber is
+// sent the same Buffer.
+// A client whose socket backs up (bufferedAmount over WS_HIGH_WATER) is not
+// buffered without bound: its frames wait in a per-client map where health
+// and IMU reports replace the older one of the same type and robot (latest
+// wins), and once WS_PEND_MAX are waiting the oldest goes. WS_DRAIN_MS
+// retries while any client has frames waiting.
+// -----------------------------------------------------------------------------
+
+export const WS_TOPICS = ["acks", "health", "imu", "sniffed", "trace", "other", "agg", "metrics", "alerts"];
+const WS_TOPIC_OF = {
+  ACK: "acks", ACK_TIMEOUT: "acks",
+  HR: "health", HPR: "alerts",
+  NAV: "imu", POSE: "imu", INERT: "imu",
+  sniffed_packet: "sniffed", sniffed_word: "sniffed",
+  TRACE: "trace",
+  AGG: "agg",
+  METRICS: "metrics", METRICS_TASKS: "metrics", ADMIT: "metrics",
+};
+const WS_LATEST_TOPICS = new Set(["health", "imu"]);
+const WS_HIGH_WATER = 64 * 1024;
+const WS_PEND_MAX = 128;
+const WS_DRAIN_MS = 25;
+const FRAME_TYPE_RE = /"type":"([^"]{1,32})"/;
+const FRAME_ROBOT_RE = /"robot":(\d+)/;
+
+// Topic, type and robot of a bridge frame, from its head only
+export function frameMeta(buf) {
+  const head = buf.toString("latin1", 0, Math.min(buf.length, 128));
+  const t = FRAME_TYPE_RE.exec(head);
+  const r = FRAME_ROBOT_RE.exec(head);
+  const type = t ? t[1] : "";
+  return { type, topic: WS_TOPIC_OF[type] || "other", robot: r ? Number(r[1]) : -1 };
+}
+
+// A client's subscription from its SUB message: { sub } or { err }
+export function parseSub(data) {
+  const topics = Array.isArray(data.topics) ? data.topics : WS_TOPICS;
+  const robots = Array.isArray(data.robots) ? data.robots : null;
+  const bad = topics.find((t) => !WS_TOPICS.includes(t));
+  if (bad !== undefined) return { err: `unknown topic ${bad}` };
+  if (robots && robots.some((r) => !Number.isInteger(r) || r < 0 || r > 31)) {
+    return { err: "robot out of range" };
+  }
+  return { sub: { topics: new Set(topics), robots: robots ? new Set(robots) : null } };
+}
+
+function subscribed(ws, meta) {
+  const sub = ws.sub;
+  if (!sub) return true;
+  if (!sub.topics.has(meta.topic)) return false;
+  return meta.robot < 0 || !sub.robots || sub.robots.has(meta.robot);
+}
+
+// Fan-out over the clients clients() returns; each carries sub and pend
+export class Fanout {
+  constructor(clients) {
+    this.clients = clients;
+    this.dropped = 0;
+    this.pendSeq = 0;
+    this.drainTimer = null;
+  }
+
+  // Every client (status), or with meta (frameMeta) only its subscribers;
+  // text is sent as-is, nothing is re-encoded per client
+  broadcast(text, meta = null) {
+    for (const client of this.clients()) {
+      if (client.readyState !== 1) continue;
+      if (meta && !subscribed(client, meta)) continue;
+      this.deliver(client, text, meta);
+    }
+  }
+
+  // Send now, or park the frame while this client is behind
+  deliver(ws, text, meta) {
+    if (ws.pend.size === 0 && ws.bufferedAmount < WS_HIGH_WATER) {
+      ws.send(text, { binary: false });
+      return;
+    }
+    const key = meta && WS_LATEST_TOPICS.has(meta.topic) ? `${meta.type}:${meta.robot}` : this.pendSeq++;
+    if (!ws.pend.has(key) && ws.pend.size >= WS_PEND_MAX) {
+      ws.pend.delete(ws.pend.keys().next().value);
+      this.dropped++;
+    }
+    ws.pend.set(key, text);                     // A newer report keeps the older one's place
+    if (!this.drainTimer) this.drainTimer = setInterval(() => this.drain(), WS_DRAIN_MS);
+  }
+
+  drain() {
+    let waiting = false;
+    for (const client of this.clients()) {
+      const pend = client.pend;
+      if (!pend || pend.size === 0) continue;
+      if (client.readyState !== 1) { pend.clear(); continue; }
+      for (const [key, buf] of pend) {
+        if (client.bufferedAmount >= WS_HIGH_WATER) break;
+        client.send(buf, { binary: false });
+        pend.delete(key);
+      }
+      if (pend.size) waiting = true;
+    }
+    if (!waiting) { clearInterval(this.drainTimer); this.drainTimer = null; }
+  }
+}
@@ -0,0 +1,191 @@
+// ws-load.js
+// -----------------------------------------------------------------------------
+// Fan-out load test for production-server.js: stands in for gs_bridge on a
+// throwaway UDS path, starts the server on it with the chosen WS_ENGINE and
+// attaches hundreds of viewers.
+//
+// The fake bridge sends HR frames for LOAD_ROBOTS robots at LOAD_RATE frames
+// per second in total, each stamped with the time it was written. Every
+// viewer takes the stamp off each frame it gets: delivery latency is
+// bridge write -> viewer receive, through the server's fan-out. One more
+// client, the driver, pings every LOAD_PING_MS while this goes on: its
+// round trip is the command path's jitter under the broadcast load.
+//
+// Usage: node ws-load.js                     (ws engine)
+//        WS_ENGINE=uws node ws-load.js       (uWebSockets.js engine)
+//        WS_FANOUT=worker node ws-load.js    (viewers on the fan-out worker)
+// Env:   LOAD_VIEWERS (300), LOAD_RATE (2000), LOAD_ROBOTS (8),
+//        LOAD_SECONDS (10), LOAD_PING_MS (20), LOAD_PORT (3901)
+// Prints one JSON summary line, as gs_load does.
+// -----------------------------------------------------------------------------
+
+import { spawn } from "child_process";
+import { performance } from "perf_hooks";
+import net from "net";
+import fs from "fs";
+import path from "path";
+import os from "os";
+import { fileURLToPath } from "url";
+import WebSocket from "ws";
+
+const ENGINE = process.env.WS_ENGINE === "uws" ? "uws" : "ws";
+const FANOUT = process.env.WS_FANOUT === "worker" ? "worker" : "inline";
+const VIEWERS = Number(process.env.LOAD_VIEWERS || 300);
+const RATE = Number(process.env.LOAD_RATE || 2000);
+const ROBOTS = Number(process.env.LOAD_ROBOTS || 8);
+const SECONDS = Number(process.env.LOAD_SECONDS || 10);
+const PING_MS = Number(process.env.LOAD_PING_MS || 20);
+const PORT = Number(process.env.LOAD_PORT || 3901);
+const SOCK = path.join(os.tmpdir(), `ws-load-${process.pid}.sock`);
+const TICK_MS = 5;
+const STAMP_RE = /"t0":([\d.]+)/;
+
+const here = path.dirname(fileURLToPath(import.meta.url));
+const sleep = (ms) => new Promise((r) => setTimeout(r, ms));
+
+function pct(sorted, p) {
+  if (!sorted.length) return null;
+  return Number(sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))].toFixed(3));
+}
+
+function summary(samples) {
+  const s = Float64Array.from(samples).sort();
+  return { n: s.length, p50: pct(s, 0.5), p99: pct(s, 0.99), max: pct(s, 1) };
+}
+
+// ------------------------- Fake bridge -------------------------
+
+let bridge = null;
+
+function bridgeListen() {
+  try { fs.unlinkSync(SOCK); } catch {}
+  const srv = net.createServer((sock) => {
+    bridge = sock;
+    sock.on("data", () => {});                   // MODE handshake and commands: ignored
+    sock.on("error", () => {});
+    sock.on("close", () => { if (bridge === sock) bridge = null; });
+  });
+  srv.listen(SOCK);
+  return srv;
+}
+
+let sent = 0;
+let robot = 0;
+
+function bridgeTick(n) {
+  if (!bridge || bridge.writableNeedDrain) return;
+  const bufs = [];
+  for (let i = 0; i < n; i++) {
+    const json = Buffer.from(`{"type":"HR","robot":${robot},"t0":${performance.now()},"bat":3900,"rssi":-61}`);
+    const hdr = Buffer.alloc(4);
+    hdr.writeUInt32BE(json.length);
+    bufs.push(hdr, json);
+    robot = (robot + 1) % ROBOTS;
+  }
+  bridge.write(Buffer.concat(bufs));
+  sent += n;
+}
+
+// ------------------------- Clients -------------------------
+
+function connect(port = PORT) {
+  return new Promise((resolve, reject) => {
+    const ws = new WebSocket(`ws://127.0.0.1:${port}`);
+    ws.once("open", () => resolve(ws));
+    ws.once("error", reject);
+  });
+}
+
+async function connectRetry(port, deadlineMs) {
+  const end = Date.now() + deadlineMs;
+  for (;;) {
+    try {
+      return await connect(port);
+    } catch (err) {
+      if (Date.now() > end) throw err;
+      await sleep(100);
+    }
+  }
+}
+
+// ------------------------- Run -------------------------
+
+async function main() {
+  const srv = bridgeListen();
+  const server = spawn(process.execPath, [path.join(here, "production-server.js")], {
+    env: { ...process.env, PORT: String(PORT), HTTP_PORT: String(PORT + 1), BIND: "127.0.0.1",
+           TELEMETRY_PORT: String(PORT + 2), SOCKET_PATH: SOCK, WS_ENGINE: ENGINE,
+           WS_FANOUT: FANOUT, WS_BINARY: "0" },
+    stdio: ["ignore", "ignore", "inherit"],
+  });
+
+  const latency = [];
+  const rtt = [];
+  let received = 0;
+  let measuring = false;
+
+  const viewerPort = FANOUT === "worker" ? PORT + 2 : PORT;
+  const driver = await connectRetry(PORT, 5000);
+  await connectRetry(viewerPort, 5000).then((ws) => ws.terminate());
+  const viewers = [];
+  for (let i = 0; i < VIEWERS; i++) {
+    const ws = await connect(viewerPort);
+    ws.on("message", (data) => {
+      const m = STAMP_RE.exec(data.toString("latin1", 0, 96));
+      if (!m || !measuring) return;
+      received++;
+      latency.push(performance.now() - Number(m[1]));
+    });
+    viewers.push(ws);
+  }
+  while (!bridge) await sleep(50);
+
+  let pingAt = 0;
+  driver.on("message", (data) => {
+    if (pingAt && data.toString().includes('"pong"')) {
+      if (measuring) rtt.push(performance.now() - pingAt);
+      pingAt = 0;
+    }
+  });
+
+  const perTick = Math.max(1, Math.round(RATE * TICK_MS / 1000));
+  const feed = setInterval(() => bridgeTick(perTick), TICK_MS);
+  const ping = setInterval(() => {
+    if (pingAt) return;                          // Previous one still out
+    pingAt = performance.now();
+    driver.send(JSON.stringify({ type: "ping" }));
+  }, PING_MS);
+
+  await sleep(1000);                             // Warm-up, not measured
+  measuring = true;
+  const sent0 = sent;
+  await sleep(SECONDS * 1000);
+  measuring = false;
+  clearInterval(feed);
+  clearInterval(ping);
+
+  const frames = sent - sent0;
+  console.log(JSON.stringify({
+    engine: ENGINE,
+    fanout: FANOUT,
+    viewers: VIEWERS,
+    rate: RATE,
+    seconds: SECONDS,
+    frames,
+    delivered: received,
+    delivery_ratio: frames ? Number((received / (frames * VIEWERS)).toFixed(4)) : null,
+    latency_ms: summary(latency),
+    ping_rtt_ms: summary(rtt),
+  }));
+
+  for (const ws of viewers) ws.terminate();
+  driver.terminate();
+  server.kill("SIGINT");
+  srv.close();
+  try { fs.unlinkSync(SOCK); } catch {}
+}
+
+main().catch((err) => {
+  console.error("ws-load:", err.message);
+  process.exit(1);
+});
@@ -0,0 +1,158 @@
+// ws-uws.js
+// -----------------------------------------------------------------------------
+// WS_ENGINE=uws for production-server.js: the UI endpoint on uWebSockets.js
+// (native, optional dependency) instead of `ws`. Same messages both ways;
+// what changes is the fan-out. Each client's SUB becomes a set of pub/sub
+// topics, and a bridge frame is published once per topic it falls under:
+// the engine frames it once and copies the framed bytes into every
+// subscriber's socket in C++, so neither the framing nor a per-client send
+// allocates on the JS heap.
+//
+// Topics, for a bridge topic t (WS_TOPICS in production-server.js):
+//   "t/all"       every frame of t         (SUB with no robots)
+//   "t/<robot>"   frames of t for a robot  (SUB with robots)
+//   "t/none"      frames of t naming no robot, for the robot-filtered ones
+//   "status"      INFO / bridge status, every client
+// A frame goes to "t/all" and to exactly one of "t/<robot>" / "t/none", so
+// no client is sent it twice. A client that never sent SUB holds every
+// "t/all".
+//
+// Slow viewers: a socket whose send buffer is over UWS_BACKPRESSURE is
+// skipped by publish (the frame is lost for that viewer only, counted in
+// dropped) instead of being parked per client as the ws engine does.
+//
+// The uWS app serves the WebSocket only; with this engine Express (/health,
+// /metrics) listens on its own port (HTTP_PORT in production-server.js).
+// -----------------------------------------------------------------------------
+
+import { createRequire } from "module";
+
+const UWS_BACKPRESSURE = 256 * 1024;         // Per-socket send buffer before publish skips it
+const UWS_MAX_PAYLOAD = 1024 * 1024;         // Same limit as the bridge's UDS frames
+const UWS_IDLE_S = 120;
+
+// A uWS socket as the server's message handlers see a `ws` one: send(),
+// protocol, readyState, bufferedAmount, close(), plus the per-client fields
+// the server keeps on it
+class UwsClient {
+  constructor(engine, sock, protocol, ip) {
+    this.engine = engine;
+    this.sock = sock;
+    this.protocol = protocol;
+    this.ip = ip;
+    this.readyState = 1;
+    this.topics = new Set();
+  }
+
+  get bufferedAmount() {
+    return this.readyState === 1 ? this.sock.getBufferedAmount() : 0;
+  }
+
+  send(data, opts = {}) {
+    if (this.readyState !== 1) return;
+    if (this.sock.send(data, Boolean(opts.binary)) === 2) this.engine.dropped++;
+  }
+
+  close() {
+    if (this.readyState === 1) this.sock.end(1001);
+  }
+
+  // Replaces the client's topic set with the one for topics x robots
+  subscribe(topics, robots) {
+    const want = new Set(["status"]);
+    for (const t of topics) {
+      if (!robots) {
+        want.add(`${t}/all`);
+        continue;
+      }
+      want.add(`${t}/none`);
+      for (const r of robots) want.add(`${t}/${r}`);
+    }
+    if (this.readyState !== 1) return;
+    for (const t of this.topics) if (!want.has(t)) this.sock.unsubscribe(t);
+    for (const t of want) if (!this.topics.has(t)) this.sock.subscribe(t);
+    this.topics = want;
+  }
+}
+
+// opts: { port, bind, cert, key, allTopics, pickProtocol(offered Set) -> name | false }
+// handlers: onOpen(client), onMessage(client, Buffer, isBinary), onClose(client)
+export function createUwsEngine(opts, handlers) {
+  const uWS = createRequire(import.meta.url)("uWebSockets.js");
+  const app = opts.cert
+    ? uWS.SSLApp({ cert_file_name: opts.cert, key_file_name: opts.key })
+    : uWS.App();
+  const engine = {
+    clients: new Set(),
+    dropped: 0,
+    listenSocket: null,
+
+    // One publish per topic the frame falls under (meta from frameMeta)
+    publish(text, meta) {
+      const all = `${meta.topic}/all`;
+      const one = meta.robot >= 0 ? `${meta.topic}/${meta.robot}` : `${meta.topic}/none`;
+      if (app.numSubscribers(all)) app.publish(all, text, false);
+      if (app.numSubscribers(one)) app.publish(one, text, false);
+    },
+
+    broadcast(text) {
+      app.publish("status", text, false);
+    },
+
+    listen(cb) {
+      app.listen(opts.bind, opts.port, (ls) => {
+        engine.listenSocket = ls;
+        cb(Boolean(ls));
+      });
+    },
+
+    close() {
+      for (const c of engine.clients) c.close();
+      if (engine.listenSocket) uWS.us_listen_socket_close(engine.listenSocket);
+      engine.listenSocket = null;
+    },
+  };
+
+  app.ws("/*", {
+    compression: uWS.DISABLED,
+    maxPayloadLength: UWS_MAX_PAYLOAD,
+    maxBackpressure: UWS_BACKPRESSURE,
+    closeOnBackpressureLimit: false,
+    idleTimeout: UWS_IDLE_S,
+
+    upgrade: (res, req, context) => {
+      const offered = new Set((req.getHeader("sec-websocket-protocol") || "")
+        .split(",").map((s) => s.trim()).filter(Boolean));
+      const protocol = opts.pickProtocol(offered) || "";
+      const ip = Buffer.from(res.getRemoteAddressAsText()).toString();
+      res.upgrade({ protocol, ip },
+                  req.getHeader("sec-websocket-key"),
+                  protocol,
+                  req.getHeader("sec-websocket-extensions"),
+                  context);
+    },
+
+    open: (sock) => {
+      const data = sock.getUserData();
+      const client = new UwsClient(engine, sock, data.protocol, data.ip);
+      data.client = client;
+      engine.clients.add(client);
+      client.subscribe(opts.allTopics, null);
+      handlers.onOpen(client);
+    },
+
+    // The ArrayBuffer is only valid during the call: copied once here
+    message: (sock, ab, isBinary) => {
+      handlers.onMessage(sock.getUserData().client, Buffer.from(ab.slice(0)), isBinary);
+    },
+
+    close: (sock) => {
+      const client = sock.getUserData().client;
+      client.readyState = 3;
+      engine.clients.delete(client);
+      handlers.onClose(client);
+    },
+  });
+
+  return engine;
+}
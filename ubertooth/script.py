@@ -1,4 +1,5 @@
 import argparse
+import os
 import shutil
 import subprocess
 import sys
@@ -6,6 +7,10 @@ from typing import List, Tuple
 
 #need to change so that it works in real time
 
+# ECE/GS/gs_attidx.o (make attidx) answers the same queries from an index it
+# builds once per capture; tshark is only the fallback when it isn't built.
+ATTIDX = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "ECE", "GS", "gs_attidx.o")
+
 def run_tshark(pcap_file: str, opcode_filter: str, tshark_path: str) -> List[Tuple[str, str, str]]:
     cmd = [
         tshark_path,
@@ -76,6 +81,9 @@ def main() -> None:
     )
     args = parser.parse_args()
 
+    if not args.tshark and os.access(ATTIDX, os.X_OK):
+        sys.exit(subprocess.call([ATTIDX, "-m", args.mode, args.pcap]))
+
     tshark_path = args.tshark or shutil.which("tshark")
     if not tshark_path:
         sys.exit("Error: tshark not found. Install Wireshark or pass --tshark /path/to/tshark")